@@ -28,6 +28,7 @@
 // Loading Utilities
 #include <vw/BundleAdjustment/CameraRelation.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 
 #endif // __VW_BUNDLE_ADJUSTMENT_H__
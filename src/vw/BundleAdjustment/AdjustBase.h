@@ -16,8 +16,16 @@
 #ifndef __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 #define __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 
+#include <vw/config.h>
 #include <vw/BundleAdjustment/ModelBase.h>
+#include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/Core/Stopwatch.h>
 #include <boost/foreach.hpp>
+#include <algorithm>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace vw {
 namespace ba {
@@ -90,6 +98,48 @@ namespace ba {
   };
 
 
+  // STUDENT-T PIXEL WEIGHTS
+  //----------------------------------------------------------------
+  // The robust adjusters weight a pixel error e, whose components
+  // have inverse variances w, by mu = (df + dim)/(df + S), where S =
+  // e0*w0*e0 + e1*w1*e1, and add 0.5*(df + dim)*log(1 + S/df) to the
+  // objective.  This does that for all of an iteration's errors at
+  // once, held as flat arrays of n pairs, two measures at a time
+  // where SSE2 is available.  It writes the n weights to mu, unless
+  // mu is null, and returns the sum of the objective.  A zero error
+  // adds nothing to it.
+  inline double student_t_pixel_weights( double const* error,
+                                         double const* inverse_variance,
+                                         double* mu, size_t n,
+                                         double df, double dim ) {
+    double objective = 0.0;
+    size_t k = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+    __m128d df_v = _mm_set1_pd( df );
+    __m128d num_v = _mm_set1_pd( df + dim );
+    double S[2];
+    for ( ; k + 2 <= n; k += 2 ) {
+      __m128d e0 = _mm_loadu_pd( error + 2*k );
+      __m128d e1 = _mm_loadu_pd( error + 2*k + 2 );
+      __m128d s0 = _mm_mul_pd( _mm_mul_pd( e0, _mm_loadu_pd( inverse_variance + 2*k ) ), e0 );
+      __m128d s1 = _mm_mul_pd( _mm_mul_pd( e1, _mm_loadu_pd( inverse_variance + 2*k + 2 ) ), e1 );
+      __m128d s = _mm_add_pd( _mm_unpacklo_pd( s0, s1 ), _mm_unpackhi_pd( s0, s1 ) );
+      if ( mu )
+        _mm_storeu_pd( mu + k, _mm_div_pd( num_v, _mm_add_pd( df_v, s ) ) );
+      _mm_storeu_pd( S, s );
+      objective += log(1 + S[0]/df) + log(1 + S[1]/df);
+    }
+#endif
+    for ( ; k < n; k++ ) {
+      double S = error[2*k]*inverse_variance[2*k]*error[2*k] +
+        error[2*k+1]*inverse_variance[2*k+1]*error[2*k+1];
+      if ( mu )
+        mu[k] = (df + dim)/(df + S);
+      objective += log(1 + S/df);
+    }
+    return 0.5*(df + dim)*objective;
+  }
+
   // CHOLEKSY MATH FUNCTIONS
   //--------------------------------------------------------
   // DEVELOPER NOTE TO SELF:
@@ -206,6 +256,41 @@ namespace ba {
     return ret;
   };
 
+  // UPDATE PHASES
+  //--------------------------------------------------------
+  // The phases of an update, which the adjusters time separately:
+  // evaluating the errors and Jacobians, reducing them to the camera
+  // system S, factoring and solving S, and back substituting for the
+  // points and evaluating the step.
+  enum AdjustPhase { JacobianPhase, SchurPhase, FactorPhase, UpdatePhase, NumAdjustPhases };
+
+  inline const char* adjust_phase_name( AdjustPhase phase ) {
+    static const char* names[NumAdjustPhases] = { "jacobian", "schur", "factor", "update" };
+    return names[phase];
+  }
+
+  // Runs one of a set of phase stopwatches at a time, and stops the
+  // last one started when it goes out of scope, however update()
+  // returns.
+  class AdjustPhaseWatch {
+    Stopwatch* m_watches;
+    int m_phase;
+  public:
+    AdjustPhaseWatch( Stopwatch* watches ) : m_watches(watches), m_phase(NumAdjustPhases) {}
+    ~AdjustPhaseWatch() { stop(); }
+
+    void start( AdjustPhase phase ) {
+      stop();
+      m_watches[phase].start();
+      m_phase = phase;
+    }
+    void stop() {
+      if ( m_phase != NumAdjustPhases )
+        m_watches[m_phase].stop();
+      m_phase = NumAdjustPhases;
+    }
+  };
+
   // BUNDLE ADJUSTMENT BASE
   //--------------------------------------------------------
   // This is a base class for the item which actually performs the
@@ -229,6 +314,44 @@ namespace ba {
     bool m_use_camera_constraint;
     bool m_use_gcp_constraint;
 
+    // Cameras held at their current parameters, and the points seen
+    // only by them. The error of those points' measures, and of the
+    // constraints on them, never changes, so it's summed once into
+    // m_fixed_error when m_fixed_error_valid is false.
+    std::vector<bool> m_fixed_camera, m_fixed_point;
+    size_t m_num_fixed_cameras;
+    double m_fixed_error;
+    bool m_fixed_error_valid;
+
+    // Wall time spent in each phase of update(), over all iterations.
+    Stopwatch m_phase_watch[NumAdjustPhases];
+
+    // The pixel error, measured location minus projection, of every
+    // measure, as flat pairs in the adjuster's own order, with the
+    // measured locations in the same order.  The sparse adjusters find
+    // the errors in every update() anyway, keeping those of the trial
+    // step in m_new_pixel_error, and leave the ones at the current
+    // parameters here, so that reports needn't project every point
+    // again.  m_pixel_error_valid says whether they have.
+    std::vector<double> m_pixel_location, m_pixel_error, m_new_pixel_error;
+    bool m_pixel_error_valid;
+
+    // Sizes the pixel error arrays for the measures of a camera
+    // relation network, in its camera by camera order.
+    template <class FeatureT>
+    void init_pixel_errors( CameraRelationNetwork<FeatureT>& crn ) {
+      m_pixel_location.clear();
+      for ( size_t j = 0; j < crn.size(); j++ )
+        for ( typename CameraNode<FeatureT>::iterator fiter = crn[j].begin();
+              fiter != crn[j].end(); fiter++ ) {
+          m_pixel_location.push_back( (**fiter).m_location[0] );
+          m_pixel_location.push_back( (**fiter).m_location[1] );
+        }
+      m_pixel_error.resize( m_pixel_location.size() );
+      m_new_pixel_error.resize( m_pixel_location.size() );
+      m_pixel_error_valid = false;
+    }
+
   public:
     // Constructor
     AdjustBase( BundleAdjustModelT &model,
@@ -241,6 +364,12 @@ namespace ba {
 
       m_iterations = 0;
       m_control_net = m_model.control_network();
+      m_fixed_camera.resize( m_model.num_cameras(), false );
+      m_fixed_point.resize( m_model.num_points(), false );
+      m_num_fixed_cameras = 0;
+      m_fixed_error = 0;
+      m_fixed_error_valid = true;
+      m_pixel_error_valid = false;
 
       m_lambda = 1e-3;
       m_control = 0;
@@ -321,8 +450,43 @@ namespace ba {
     bool camera_constraint() const { return m_use_camera_constraint; }
     bool gcp_constraint() const { return m_use_gcp_constraint; }
 
+    /// Hold the cameras marked in fixed at their current parameters,
+    /// along with the points that only they see, and adjust the
+    /// rest. The sparse adjusters then skip the Jacobians of all that
+    /// is held, so an iteration costs in proportion to what's free.
+    void set_fixed_cameras( std::vector<bool> const& fixed ) {
+      VW_ASSERT( fixed.size() == m_model.num_cameras(),
+                 ArgumentErr() << "set_fixed_cameras: expected one flag per camera." );
+      m_fixed_camera = fixed;
+      m_num_fixed_cameras = std::count( fixed.begin(), fixed.end(), true );
+      for ( size_t i = 0; i < m_fixed_point.size(); i++ ) {
+        m_fixed_point[i] = (*m_control_net)[i].size() != 0;
+        BOOST_FOREACH( ControlMeasure const& cm, (*m_control_net)[i] )
+          if ( !m_fixed_camera[cm.image_id()] ) {
+            m_fixed_point[i] = false;
+            break;
+          }
+      }
+      m_fixed_error_valid = m_num_fixed_cameras == 0;
+      m_fixed_error = 0;
+      m_pixel_error_valid = false;
+    }
+    bool fixed_camera( size_t j ) const { return m_fixed_camera[j]; }
+    bool fixed_point( size_t i ) const { return m_fixed_point[i]; }
+    size_t num_fixed_cameras() const { return m_num_fixed_cameras; }
+
     // Additional Information
     int iterations() const { return m_iterations; }
+    double phase_seconds( AdjustPhase phase ) const { return m_phase_watch[phase].elapsed_seconds(); }
+
+    /// The pixel errors of all measures at the current parameters,
+    /// and their measured locations, as flat pairs in matching order.
+    /// They're only kept by the sparse adjusters, after an update()
+    /// with no cameras held fixed; otherwise pixel_errors_valid() is
+    /// false.
+    bool pixel_errors_valid() const { return m_pixel_error_valid; }
+    std::vector<double> const& pixel_errors() const { return m_pixel_error; }
+    std::vector<double> const& pixel_locations() const { return m_pixel_location; }
     RobustCostT costfunction() const { return m_robust_cost_func; }
     BundleAdjustModelT& bundle_adjust_model() { return m_model; }
 
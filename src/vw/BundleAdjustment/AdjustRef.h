@@ -129,6 +129,9 @@ namespace ba {
       Vector<double> error(num_observations);                   // Error vector
       Matrix<double> sigma(num_observations, num_observations);   // Sigma (uncertainty) matrix
 
+      AdjustPhaseWatch phase( this->m_phase_watch );
+      phase.start( JacobianPhase );
+
       // --- SETUP STEP ----
       // Add rows to J and error for the imaged pixel observations
       int idx = 0;
@@ -232,6 +235,7 @@ namespace ba {
 
 
       // --- SOLVE UPDATE STEP -----------------------------------
+      phase.start( SchurPhase );
       Matrix<double> JTS = transpose(J) * sigma;
 
       // Build up the right side of the normal equation...
@@ -269,6 +273,7 @@ namespace ba {
 
       // set S
       this->set_S(S);
+      phase.start( FactorPhase );
       solve(e, S); // using cholesky
       solve(delta, hessian);
 
@@ -278,6 +283,7 @@ namespace ba {
       for ( unsigned i=0; i<this->m_model.num_points(); ++i )
         nsq_x += norm_2( this->m_model.B_parameters(i) );
 
+      phase.start( UpdatePhase );
       // --- EVALUATE POTENTIAL UPDATE STEP ---
       Vector<double> new_error(num_observations);                  // Error vector
       idx = 0;
@@ -143,6 +143,9 @@ namespace ba {
       // robust objective
       double robust_objective = 0.0;
 
+      AdjustPhaseWatch phase( this->m_phase_watch );
+      phase.start( JacobianPhase );
+
       // --- SETUP STEP ----
       // Add rows to J and error for the imaged pixel observations
 
@@ -274,6 +277,7 @@ namespace ba {
       }
 
       // --- SOLVE UPDATE STEP ----------------------------------------
+      phase.start( SchurPhase );
 
       // Build up the right side of the normal equation for robust algorithm
       Vector<double> epsilon = -1.0 * transpose(J) * sigma * error;
@@ -307,9 +311,11 @@ namespace ba {
 
       // Set S
       this->set_S(S);
+      phase.start( FactorPhase );
       solve(e, S); // using cholesky
       solve(delta, hessian);
 
+      phase.start( UpdatePhase );
       // Solve for update
       double new_objective = 0.0;
 
@@ -15,6 +15,8 @@
 // Vision Workbench
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/BatchLinearAlgebra.h>
+#include <vw/BundleAdjustment/ReducedCameraSystem.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
@@ -52,6 +54,10 @@ namespace ba {
     std::vector<size_t> m_ideal_ordering;
     Vector<size_t> m_ideal_skyline;
     bool m_found_ideal_ordering;
+    bool m_use_conjugate_gradient;
+    ReducedCameraPreconditioner m_cg_preconditioner;
+    double m_cg_tolerance;
+    size_t m_cg_max_iterations;
     CameraRelationNetwork<JFeature> m_crn;
     typedef CameraNode<JFeature>::iterator crn_iter;
 
@@ -61,6 +67,62 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // The inverse variances of the components of each measure's pixel
+    // error, and its robust weight, numbered camera by camera in the
+    // order of m_crn like m_pixel_error.  The errors are found once
+    // per iteration and weighted in one batch, then reused for the
+    // Jacobians and the objective.
+    std::vector< double > m_inverse_variance, m_mu;
+
+    // Degrees of freedom for data, and the dimensions of pixels,
+    // cameras and world points, in the robust objective.
+    static double t_df() { return 4; }
+    static double t_dim_pixel() { return 2; }
+    static double t_dim_cam() { return 6; }
+    static double t_dim_pt() { return 3; }
+
+    // Sums the robust objective of the fixed cameras and points,
+    // which stays the same from one iteration to the next.
+    void sum_fixed_error() {
+      this->m_fixed_error = 0;
+      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        if ( !this->m_fixed_camera[j] )
+          continue;
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ ) {
+          size_t i = (**fiter).m_point_id;
+          if ( !this->m_fixed_point[i] )
+            continue;
+          Vector2 unweighted_error;
+          try {
+            unweighted_error = (**fiter).m_location -
+              this->m_model(i,j,this->m_model.A_parameters(j),
+                            this->m_model.B_parameters(i));
+          } catch (const camera::PixelToRayErr& e) {}
+          Vector2 pixel_sigma = (**fiter).m_scale;
+          double S_weight = unweighted_error[0]*unweighted_error[0] / (pixel_sigma[0]*pixel_sigma[0]) +
+            unweighted_error[1]*unweighted_error[1] / (pixel_sigma[1]*pixel_sigma[1]);
+          this->m_fixed_error += 0.5*(t_df() + t_dim_pixel())*log(1 + S_weight/t_df());
+        }
+      }
+      if ( this->m_use_camera_constraint )
+        for ( size_t j = 0; j < U.size(); ++j )
+          if ( this->m_fixed_camera[j] ) {
+            vector_camera eps_a = this->m_model.A_target(j)-this->m_model.A_parameters(j);
+            double S_weight = transpose(eps_a) * this->m_model.A_inverse_covariance(j) * eps_a;
+            this->m_fixed_error += 0.5*(t_df() + t_dim_cam())*log(1 + S_weight/t_df());
+          }
+      if ( this->m_use_gcp_constraint )
+        for ( size_t i = 0; i < V.size(); ++i )
+          if ( this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
+            vector_point eps_b = this->m_model.B_target(i)-this->m_model.B_parameters(i);
+            double S_weight = transpose(eps_b) * this->m_model.B_inverse_covariance(i) * eps_b;
+            this->m_fixed_error += 0.5*(t_df() + t_dim_pt())*log(1 + S_weight/t_df());
+          }
+      this->m_fixed_error_valid = true;
+    }
+
   public:
 
     AdjustRobustSparse( BundleAdjustModelT & model,
@@ -75,11 +137,52 @@ namespace ba {
       epsilon_a( this->m_model.num_cameras() ), epsilon_b( this->m_model.num_points() ) {
       vw_out(DebugMessage,"ba") << "Constructed Robust Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
+      for ( size_t j = 0; j < m_crn.size(); j++ )
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ ) {
+          Vector2 pixel_sigma = (**fiter).m_scale;
+          m_inverse_variance.push_back( 1/(pixel_sigma(0)*pixel_sigma(0)) );
+          m_inverse_variance.push_back( 1/(pixel_sigma(1)*pixel_sigma(1)) );
+        }
+      this->init_pixel_errors( m_crn );
+      m_mu.resize( m_inverse_variance.size() / 2 );
       m_found_ideal_ordering = false;
+      m_use_conjugate_gradient = false;
+      m_cg_preconditioner = SCHUR_JACOBI_PRECONDITIONER;
+      m_cg_tolerance = 1e-10;
+      m_cg_max_iterations = 0;
     }
 
     math::MatrixSparseSkyline<double> S() const { return m_S; }
 
+    /// Solve for the camera update by preconditioned conjugate
+    /// gradients on products with S, without ever forming S, for
+    /// problems whose S is too large to factor.  Each solve stops at
+    /// a residual of tolerance times norm_2(e), or after
+    /// max_iterations (zero allows one per unknown).  S() and
+    /// covCalc() aren't available in this mode.
+    bool conjugate_gradient() const { return m_use_conjugate_gradient; }
+    void set_conjugate_gradient( bool use,
+                                 ReducedCameraPreconditioner preconditioner = SCHUR_JACOBI_PRECONDITIONER,
+                                 double tolerance = 1e-10, size_t max_iterations = 0 ) {
+      m_use_conjugate_gradient = use;
+      m_cg_preconditioner = preconditioner;
+      m_cg_tolerance = tolerance;
+      m_cg_max_iterations = max_iterations;
+    }
+
+    /// Adjust only the cameras within hops links of cameras in the
+    /// camera relation network, such as the ones just added to a
+    /// survey, and hold the rest fixed.  S keeps the blocks of the
+    /// whole network, so the ordering found for it is reused as the
+    /// window moves.
+    void set_window( std::vector<size_t> const& cameras, size_t hops ) {
+      std::vector<bool> fixed = m_crn.neighborhood( cameras, hops );
+      fixed.resize( this->m_model.num_cameras(), false );
+      fixed.flip();
+      this->set_fixed_cameras( fixed );
+    }
+
     // Covariance Calculator
     // __________________________________________________
     // This routine inverts a sparse matrix S, and prints the individual
@@ -117,6 +220,8 @@ namespace ba {
     double update(double &abs_tol, double &rel_tol) {
       ++this->m_iterations;
       boost::scoped_ptr<Timer> time;
+      AdjustPhaseWatch phase( this->m_phase_watch );
+      phase.start( JacobianPhase );
 
       VW_DEBUG_ASSERT(this->m_control_net->size() == this->m_model.num_points(), LogicErr() << "BundleAdjustment::update() : Number of bundles does not match the number of points in the bundle adjustment model.");
 
@@ -133,55 +238,83 @@ namespace ba {
       size_t num_cam_params = BundleAdjustModelT::camera_params_n;
       size_t num_pt_params = BundleAdjustModelT::point_params_n;
 
-      // Degrees of freedom for data (can be modified later)
-      double t_df = 4;
-      // dimension of pixels
-      double t_dim_pixel = 2;
-      // dimension of cameras
-      double t_dim_cam   = 6;
-      // dimension of world points
-      double t_dim_pt    = 3;
+      double t_df = this->t_df();
+      double t_dim_pixel = this->t_dim_pixel();
+      double t_dim_cam   = this->t_dim_cam();
+      double t_dim_pt    = this->t_dim_pt();
 
       // Populate the Jacobian, which is broken into two sparse
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double robust_objective = 0.0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+      if ( !this->m_fixed_error_valid )
+        sum_fixed_error();
+      double robust_objective = this->m_fixed_error;
+
+      // Find the error of every measure that isn't held fixed, and
+      // weight them all at once. The fixed ones are left at zero,
+      // which adds nothing to the objective.
+      size_t m = 0;
+      for ( size_t j = 0; j < m_crn.size(); j++ )
         for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
+              fiter != m_crn[j].end(); fiter++, m++ ) {
           size_t i = (**fiter).m_point_id;
-
-          matrix_2_camera A = this->m_model.A_jacobian(i,j,this->m_model.A_parameters(j),
-                                                       this->m_model.B_parameters(i));
-          matrix_2_point B = this->m_model.B_jacobian(i,j,this->m_model.A_parameters(j),
-                                                      this->m_model.B_parameters(i));
-
-          // Apply robust cost function weighting
-          Vector2 unweighted_error;
+          this->m_pixel_error[2*m] = this->m_pixel_error[2*m+1] = 0;
+          if ( this->m_fixed_camera[j] && this->m_fixed_point[i] )
+            continue;
           try {
-            unweighted_error = (**fiter).m_location -
+            Vector2 unweighted_error = (**fiter).m_location -
               this->m_model(i,j,this->m_model.A_parameters(j),
                             this->m_model.B_parameters(i));
+            this->m_pixel_error[2*m] = unweighted_error[0];
+            this->m_pixel_error[2*m+1] = unweighted_error[1];
           } catch (const camera::PixelToRayErr& e) {}
+        }
+      if ( !m_mu.empty() )
+        robust_objective += student_t_pixel_weights( &this->m_pixel_error[0],
+                                                     &m_inverse_variance[0],
+                                                     &m_mu[0], m_mu.size(),
+                                                     t_df, t_dim_pixel );
+      this->m_pixel_error_valid = this->m_num_fixed_cameras == 0;
+
+      m = 0;
+      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        bool fixed_camera = this->m_fixed_camera[j];
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++, m++ ) {
+          size_t i = (**fiter).m_point_id;
 
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          Matrix2x2 inverse_cov;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+          // A fixed camera keeps U, epsilon_a, W and Y at zero, and
+          // its measures of fixed points aren't evaluated at all.
+          if ( fixed_camera ) {
+            (**fiter).m_w = matrix_camera_point();
+            (**fiter).m_y = (**fiter).m_w;
+            if ( this->m_fixed_point[i] )
+              continue;
+          }
 
-          double S_weight = transpose(unweighted_error) * inverse_cov * unweighted_error;
-          double mu_weight = (t_df + t_dim_pixel)/(t_df + S_weight);
+          matrix_2_camera A;
+          if ( !fixed_camera )
+            A = this->m_model.A_jacobian(i,j,this->m_model.A_parameters(j),
+                                         this->m_model.B_parameters(i));
+          matrix_2_point B = this->m_model.B_jacobian(i,j,this->m_model.A_parameters(j),
+                                                      this->m_model.B_parameters(i));
 
-          // do NOT want epsilon_inst scaled
-          robust_objective += 0.5*(t_df + t_dim_pixel)*log(1 + S_weight/t_df);
+          // Apply robust cost function weighting
+          Vector2 unweighted_error( this->m_pixel_error[2*m], this->m_pixel_error[2*m+1] );
+          Matrix2x2 inverse_cov;
+          inverse_cov(0,0) = m_inverse_variance[2*m];
+          inverse_cov(1,1) = m_inverse_variance[2*m+1];
+          double mu_weight = m_mu[m];
 
           // Storing intermediate values
-          U[j] += mu_weight * transpose(A) * inverse_cov * A;
           V[i] += mu_weight * transpose(B) * inverse_cov * B;
+          epsilon_b[i] += mu_weight * transpose(B) * inverse_cov * unweighted_error;
+          if ( fixed_camera )
+            continue;
+          U[j] += mu_weight * transpose(A) * inverse_cov * A;
           (**fiter).m_w = mu_weight * transpose(A) * inverse_cov * B;
           epsilon_a[j] += mu_weight * transpose(A) * inverse_cov * unweighted_error;
-          epsilon_b[i] += mu_weight * transpose(B) * inverse_cov * unweighted_error;
         }
       }
       time.reset();
@@ -190,6 +323,8 @@ namespace ba {
       time.reset(new Timer("Solving for Camera and GCP error:",DebugMessage,"ba"));
       if ( this->m_use_camera_constraint )
         for (size_t j = 0; j < U.size(); ++j) {
+          if ( this->m_fixed_camera[j] )
+            continue;
           matrix_camera_camera inverse_cov;
           inverse_cov = this->m_model.A_inverse_covariance(j);
           vector_camera eps_a = this->m_model.A_target(j)-this->m_model.A_parameters(j);
@@ -205,7 +340,8 @@ namespace ba {
       // Points (GCPs), not for 3D tie points.
       if ( this->m_use_gcp_constraint )
         for (size_t i = 0; i < V.size(); ++i) {
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if ( !this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
             matrix_point_point inverse_cov;
             inverse_cov = this->m_model.B_inverse_covariance(i);
             vector_point eps_b = this->m_model.B_target(i)-this->m_model.B_parameters(i);
@@ -218,6 +354,8 @@ namespace ba {
         }
       time.reset();
 
+      phase.start( SchurPhase );
+
       // set initial lambda, and ignore if the user has touched it
       if (this->m_iterations == 1 && this->m_lambda == 1e-3){
         time.reset(new Timer("Solving for Lambda:",DebugMessage,"ba"));
@@ -268,14 +406,14 @@ namespace ba {
       }
 
       // Compute V inverse
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
-        chol_inverse( V_temp );
-        V_inverse[i] = transpose(V_temp)*V_temp;
-      }
+      V_inverse = V;
+      if ( size_t failed = batch_symmetric_inverse( V_inverse, true ) )
+        vw_out(WarningMessage, "ba") << failed << " blocks of V are not positive definite.\n";
 
       // Compute Y and finish constructing e.
       for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        if ( this->m_fixed_camera[j] )
+          continue;
         for ( crn_iter fiter = m_crn[j].begin();
               fiter != m_crn[j].end(); fiter++ ) {
           size_t i = (**fiter).m_point_id;
@@ -289,94 +427,110 @@ namespace ba {
       time.reset();
 
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
+      Vector<double> delta_a;
+      if ( m_use_conjugate_gradient ) {
+        phase.start( FactorPhase );
+        time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+        delta_a = solve_reduced_camera_system<BundleAdjustModelT::camera_params_n,
+                                              BundleAdjustModelT::point_params_n>
+          ( m_crn, U, this->m_model.num_points(), e,
+            m_cg_preconditioner, m_cg_tolerance, m_cg_max_iterations );
+        time.reset();
+      } else {
+        time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
+
+        // The S matrix is a m x m block matrix with blocks that are
+        // camera_params_n x camera_params_n in size.  It has a sparse
+        // skyline structure, which makes it more efficient to solve
+        // through L*D*L^T decomposition and forward/back substitution
+        // below.
+        math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                            this->m_model.num_cameras()*num_cam_params);
+        for ( size_t j = 0; j < m_crn.size(); j++ ) {
+          { // Filling in diagonal
+            matrix_camera_camera S_jj;
 
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
+            // Iterate across all features seen by the camera
+            for ( crn_iter fiter = m_crn[j].begin();
+                  fiter != m_crn[j].end(); fiter++ ) {
+              S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+            }
 
-          // Augmenting Diagonal
-          S_jj += U[j];
+            // Augmenting Diagonal
+            S_jj += U[j];
 
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
+            // Loading into sparse matrix
+            size_t offset = j * num_cam_params;
+            for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
+              for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
+                S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
+              }
             }
           }
-        }
 
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
+          // Filling in off diagonal
+          for ( size_t k = j+1; k < m_crn.size(); k++ ) {
+            typedef boost::weak_ptr<JFeature> w_ptr;
+            typedef boost::shared_ptr<JFeature> f_ptr;
+            typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
+            std::pair< mm_iterator, mm_iterator > feature_range;
+            feature_range = m_crn[j].map.equal_range( k );
+
+            // Iterating through all features in camera j that have
+            // connections to camera k.
+            // The blocks of fixed cameras are zero but kept, so S has
+            // the same structure whatever is fixed.
+            matrix_camera_camera S_jk;
+            bool found = feature_range.first != feature_range.second;
+            if ( this->m_fixed_camera[j] || this->m_fixed_camera[k] )
+              feature_range.first = feature_range.second;
+            for ( mm_iterator f_j_iter = feature_range.first;
+                  f_j_iter != feature_range.second; f_j_iter++ ) {
+              w_ptr f_k = (*f_j_iter).second->m_map[k];
+              S_jk -= (*f_j_iter).second->m_y *
+                transpose( f_k.lock()->m_w );
+            }
 
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
+            // Loading into sparse matrix
+            // - if it seems we are loading in oddly, it's because the sparse
+            //   matrix is row major.
+            if ( found ) {
+              submatrix( S, k*num_cam_params, j*num_cam_params,
+                         num_cam_params, num_cam_params ) = transpose(S_jk);
+            }
           }
         }
-      }
 
-      m_S = S; // S is modified in sparse solve. Keeping a copy;
-      time.reset();
+        m_S = S; // S is modified in sparse solve. Keeping a copy;
+        time.reset();
+        phase.start( FactorPhase );
 
-      // Computing ideal ordering of sparse matrix
-      if ( !m_found_ideal_ordering ) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline( mod_S );
+        // Computing ideal ordering of sparse matrix
+        if ( !m_found_ideal_ordering ) {
+          time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
+          m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
+          math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
+          m_ideal_skyline = solve_for_skyline( mod_S );
 
-        m_found_ideal_ordering = true;
-        time.reset();
-      }
+          m_found_ideal_ordering = true;
+          time.reset();
+        }
 
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+        time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
 
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize( delta_a, modified_S.inverse() );
+        // Compute the LDL^T decomposition and solve using sparse methods.
+        math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
+        delta_a = sparse_solve( modified_S,
+                                reorganize(e, m_ideal_ordering),
+                                m_ideal_skyline );
+        delta_a = reorganize( delta_a, modified_S.inverse() );
+      }
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
       time.reset();
 
       // --- SOLVE B'S UPDATE STEP ---------------------------------
+      phase.start( UpdatePhase );
 
       // Back Solving for Delta B
       time.reset(new Timer("Solve Delta B", DebugMessage, "ba"));
@@ -388,6 +542,8 @@ namespace ba {
         // Building right half, sum( WijT * delta_aj )
         std::vector< vector_point > right_delta_b( this->m_model.num_points() );
         for ( size_t j = 0; j < m_crn.size(); j++ ) {
+          if ( this->m_fixed_camera[j] )
+            continue;
           for ( crn_iter fiter = m_crn[j].begin();
                 fiter != m_crn[j].end(); fiter++ ) {
             right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
@@ -397,6 +553,8 @@ namespace ba {
 
         // Solving for delta b
         for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
+          if ( this->m_fixed_point[i] )
+            continue;
           Vector<double> delta_temp = epsilon_b[i] - right_delta_b[i];
           Matrix<double> hessian = V[i];
           solve( delta_temp, hessian );
@@ -421,11 +579,15 @@ namespace ba {
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_robust_objective = 0;
+      double new_robust_objective = this->m_fixed_error;
+      m = 0;
       for ( size_t j = 0; j < m_crn.size(); j++ ) {
         for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
+              fiter != m_crn[j].end(); fiter++, m++ ) {
           size_t i = (**fiter).m_point_id;
+          this->m_new_pixel_error[2*m] = this->m_new_pixel_error[2*m+1] = 0;
+          if ( this->m_fixed_camera[j] && this->m_fixed_point[i] )
+            continue;
 
           // Computer error vector
           vector_camera new_a = this->m_model.A_parameters(j) +
@@ -433,28 +595,25 @@ namespace ba {
           vector_point new_b = this->m_model.B_parameters(i) +
             subvector( delta_b, num_pt_params*i, num_pt_params );
 
-          // Apply robust cost function weighting
-          Vector2 unweighted_error;
           try {
-            unweighted_error = (**fiter).m_location -
+            Vector2 unweighted_error = (**fiter).m_location -
               this->m_model(i,j,new_a,new_b);
+            this->m_new_pixel_error[2*m] = unweighted_error[0];
+            this->m_new_pixel_error[2*m+1] = unweighted_error[1];
           } catch (const camera::PixelToRayErr& e) {}
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          // Populate the S_weights, mu_weights vectors
-          double S_weight = transpose(unweighted_error) * inverse_cov * unweighted_error;
-
-          new_robust_objective += 0.5*(t_df + t_dim_pixel)*log(1 + S_weight/t_df);
         }
       }
+      if ( !m_mu.empty() )
+        new_robust_objective += student_t_pixel_weights( &this->m_new_pixel_error[0],
+                                                         &m_inverse_variance[0],
+                                                         0, m_mu.size(),
+                                                         t_df, t_dim_pixel );
 
       // Camera Constraints
       if ( this->m_use_camera_constraint )
         for ( size_t j = 0; j < U.size(); ++j ) {
+          if ( this->m_fixed_camera[j] )
+            continue;
           // note the signs here: should be +
           vector_camera new_a = this->m_model.A_parameters(j) +
             subvector(delta_a, num_cam_params*j, num_cam_params);
@@ -468,7 +627,8 @@ namespace ba {
       // GCP Error
       if ( this->m_use_gcp_constraint )
         for ( size_t i = 0; i < V.size(); ++i )
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if ( !this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
             // note the signs here: should be +
             vector_point new_b = this->m_model.B_parameters(i) +
               subvector( delta_b, num_pt_params*i, num_pt_params );
@@ -497,6 +657,7 @@ namespace ba {
       if ( R > 0 ) {
 
         time.reset(new Timer("Setting Parameters",DebugMessage,"ba"));
+        this->m_pixel_error.swap( this->m_new_pixel_error );
         for (size_t j=0; j<this->m_model.num_cameras(); ++j)
           this->m_model.set_A_parameters(j, this->m_model.A_parameters(j) +
                                          subvector(delta_a, num_cam_params*j,num_cam_params));
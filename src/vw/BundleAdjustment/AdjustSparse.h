@@ -14,9 +14,14 @@
 
 // Vision Workbench
 #include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/SparseCholesky.h>
+#include <vw/Math/BatchLinearAlgebra.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/BundleAdjustment/ReducedCameraSystem.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
@@ -38,6 +43,39 @@
 namespace vw {
 namespace ba {
 
+  /// \cond INTERNAL
+  namespace detail {
+    // Calls func( begin, end ) on ranges covering [0,count).
+    template <class FuncT>
+    struct RangeTask {
+      typedef void result_type;
+      FuncT const& func;
+      size_t begin, end;
+      RangeTask( FuncT const& func, size_t begin, size_t end )
+        : func(func), begin(begin), end(end) {}
+      void operator()() const { func( begin, end ); }
+    };
+
+    // Runs func over [0,count), split into a few ranges per thread
+    // when parallel.  func must only write to the elements of its own
+    // range, so the results don't depend on the number of threads.
+    template <class FuncT>
+    void for_each_range( FuncT const& func, size_t count, bool parallel ) {
+      uint32 num_threads = vw_settings().default_num_threads();
+      if ( !parallel || num_threads < 2 || count < 2 ) {
+        func( 0, count );
+        return;
+      }
+      size_t range = std::max( count / ( 4 * size_t(num_threads) ), size_t(1) );
+      FifoWorkQueue queue( num_threads );
+      std::vector<Future<void> > futures;
+      for ( size_t begin = 0; begin < count; begin += range )
+        futures.push_back( queue.submit( RangeTask<FuncT>( func, begin, std::min( begin + range, count ) ) ) );
+      when_all( futures );
+    }
+  }
+  /// \endcond
+
   template <class BundleAdjustModelT, class RobustCostT>
   class AdjustSparse : public AdjustBase<BundleAdjustModelT, RobustCostT> {
 
@@ -54,8 +92,16 @@ namespace ba {
     std::vector<size_t> m_ideal_ordering;
     Vector<size_t> m_ideal_skyline;
     bool m_found_ideal_ordering;
+    bool m_use_conjugate_gradient;
+    ReducedCameraPreconditioner m_cg_preconditioner;
+    double m_cg_tolerance;
+    size_t m_cg_max_iterations;
+    bool m_use_supernodal_cholesky;
+    bool m_use_parallel_assembly;
+    boost::shared_ptr<math::SparseCholesky<double> > m_cholesky;
     CameraRelationNetwork<JFeature> m_crn;
     typedef CameraNode<JFeature>::iterator crn_iter;
+    typedef std::multimap< size_t, boost::shared_ptr<JFeature> >::iterator mm_iterator;
 
     // Reused structures
     std::vector< matrix_camera_camera > U;
@@ -63,6 +109,244 @@ namespace ba {
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
 
+    // Each measure's share of V and epsilon_b, numbered camera by
+    // camera from m_measure_offset[j].  They're summed per point, in
+    // camera order, over measures m_point_measures[m_point_offset[i]]
+    // to m_point_measures[m_point_offset[i+1]-1], so that cameras can
+    // be linearized in parallel without sharing the point blocks.
+    std::vector< size_t > m_measure_offset;
+    std::vector< size_t > m_point_offset, m_point_measures;
+    std::vector< matrix_point_point > m_measure_V;
+    std::vector< vector_point > m_measure_epsilon_b;
+    std::vector< double > m_camera_error;
+
+    // The blocks of the lower triangle of S in column j: S_jj, and
+    // S_kj for each camera k > j that shares a point with camera j.
+    std::vector< matrix_camera_camera > m_S_diagonal;
+    std::vector< std::vector< std::pair<size_t, matrix_camera_camera> > > m_S_column;
+
+    // Sums the error that the fixed cameras and points contribute,
+    // which stays the same from one iteration to the next.
+    void sum_fixed_error() {
+      this->m_fixed_error = 0;
+      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        if ( !this->m_fixed_camera[j] )
+          continue;
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ ) {
+          size_t i = (**fiter).m_point_id;
+          if ( !this->m_fixed_point[i] )
+            continue;
+
+          // Apply robust cost function weighting
+          Vector2 error;
+          try {
+            error = (**fiter).m_location -
+              this->m_model(i,j,this->m_model.A_parameters(j),
+                            this->m_model.B_parameters(i) );
+          } catch (const camera::PixelToRayErr& e) {}
+          if ( error != Vector2() ) {
+            double mag = norm_2(error);
+            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
+            error *= weight;
+          }
+
+          Vector2 pixel_sigma = (**fiter).m_scale;
+          this->m_fixed_error += .5 * ( error[0]*error[0] / (pixel_sigma[0]*pixel_sigma[0]) +
+                                        error[1]*error[1] / (pixel_sigma[1]*pixel_sigma[1]) );
+        }
+      }
+      if ( this->m_use_camera_constraint )
+        for ( size_t j = 0; j < U.size(); ++j )
+          if ( this->m_fixed_camera[j] ) {
+            vector_camera eps_a = this->m_model.A_target(j)-this->m_model.A_parameters(j);
+            this->m_fixed_error += .5 * transpose(eps_a) * this->m_model.A_inverse_covariance(j) * eps_a;
+          }
+      if ( this->m_use_gcp_constraint )
+        for ( size_t i = 0; i < V.size(); ++i )
+          if ( this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
+            vector_point eps_b = this->m_model.B_target(i)-this->m_model.B_parameters(i);
+            this->m_fixed_error += .5 * transpose(eps_b) * this->m_model.B_inverse_covariance(i) * eps_b;
+          }
+      this->m_fixed_error_valid = true;
+    }
+
+    // Fills in U, epsilon_a, the error and W of cameras [begin,end),
+    // and the shares of V and epsilon_b of their measures.  A fixed
+    // camera keeps U, epsilon_a, W and Y at zero, so that it doesn't
+    // move, and its measures of fixed points aren't evaluated at all.
+    void linearize_cameras( size_t begin, size_t end ) {
+      for ( size_t j = begin; j < end; j++ ) {
+        double error_total = 0; // assume this is r^T\Sigma^{-1}r
+        bool fixed_camera = this->m_fixed_camera[j];
+        size_t m = m_measure_offset[j];
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++, m++ ) {
+          JFeature& measure = **fiter;
+          size_t i = measure.m_point_id;
+
+          if ( fixed_camera ) {
+            measure.m_w = matrix_camera_point();
+            measure.m_y = measure.m_w;
+            if ( this->m_fixed_point[i] ) {
+              m_measure_V[m] = matrix_point_point();
+              m_measure_epsilon_b[m] = vector_point();
+              this->m_pixel_error[2*m] = this->m_pixel_error[2*m+1] = 0;
+              continue;
+            }
+          }
+
+          matrix_2_camera A;
+          if ( !fixed_camera )
+            A = this->m_model.A_jacobian( i, j,
+                                          this->m_model.A_parameters(j),
+                                          this->m_model.B_parameters(i) );
+          matrix_2_point B =
+            this->m_model.B_jacobian( i, j,
+                                      this->m_model.A_parameters(j),
+                                      this->m_model.B_parameters(i) );
+
+          // Apply robust cost function weighting
+          Vector2 error;
+          try {
+            error = measure.m_location -
+              this->m_model(i,j,this->m_model.A_parameters(j),
+                            this->m_model.B_parameters(i) );
+          } catch (const camera::PixelToRayErr& e) {}
+          this->m_pixel_error[2*m] = error[0];
+          this->m_pixel_error[2*m+1] = error[1];
+
+          if ( error != Vector2() ) {
+            double mag = norm_2(error);
+            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
+            error *= weight;
+          }
+
+          Matrix2x2 inverse_cov;
+          Vector2 pixel_sigma = measure.m_scale;
+          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
+          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+          error_total += .5 * transpose(error) *
+            inverse_cov * error;
+
+          // Storing intermediate values
+          m_measure_V[m] = transpose(B) * inverse_cov * B;
+          m_measure_epsilon_b[m] = transpose(B) * inverse_cov * error;
+          if ( fixed_camera )
+            continue;
+          U[j] += transpose(A) * inverse_cov * A;
+          epsilon_a[j] += transpose(A) * inverse_cov * error;
+          measure.m_w = transpose(A) * inverse_cov * B;
+        }
+        m_camera_error[j] = error_total;
+      }
+    }
+
+    // Sums V and epsilon_b of points [begin,end) from their measures.
+    void reduce_points( size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        V[i] = matrix_point_point();
+        epsilon_b[i] = vector_point();
+        for ( size_t n = m_point_offset[i]; n < m_point_offset[i+1]; n++ ) {
+          V[i] += m_measure_V[m_point_measures[n]];
+          epsilon_b[i] += m_measure_epsilon_b[m_point_measures[n]];
+        }
+      }
+    }
+
+    // Computes the blocks of Y of cameras [begin,end), and subtracts
+    // their products with epsilon_b from e.
+    void reduce_cameras( size_t begin, size_t end, Vector<double>& e ) {
+      size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      for ( size_t j = begin; j < end; j++ ) {
+        if ( this->m_fixed_camera[j] )
+          continue;
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ ) {
+          // Compute the blocks of Y
+          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
+          // Flatten the block structure to compute 'e'
+          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
+            * epsilon_b[ (**fiter).m_point_id ];
+        }
+      }
+    }
+
+    // Computes columns [begin,end) of the lower triangle of S.  The
+    // blocks of fixed cameras are zero but kept, so S has the same
+    // structure whatever is fixed.
+    void schur_columns( size_t begin, size_t end ) {
+      for ( size_t j = begin; j < end; j++ ) {
+        if ( this->m_fixed_camera[j] ) {
+          m_S_diagonal[j] = U[j];
+          m_S_column[j].clear();
+          mm_iterator f_j_iter = m_crn[j].map.upper_bound( j );
+          while ( f_j_iter != m_crn[j].map.end() ) {
+            m_S_column[j].push_back( std::make_pair( f_j_iter->first, matrix_camera_camera() ) );
+            f_j_iter = m_crn[j].map.upper_bound( f_j_iter->first );
+          }
+          continue;
+        }
+
+        { // Filling in diagonal
+          matrix_camera_camera S_jj;
+
+          // Iterate across all features seen by the camera
+          for ( crn_iter fiter = m_crn[j].begin();
+                fiter != m_crn[j].end(); fiter++ ) {
+            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+          }
+
+          // Augmenting Diagonal
+          m_S_diagonal[j] = S_jj + U[j];
+        }
+
+        // Filling in off diagonal. The camera's map is sorted by the
+        // other camera, so each run of equal keys is one block.
+        m_S_column[j].clear();
+        mm_iterator f_j_iter = m_crn[j].map.upper_bound( j );
+        while ( f_j_iter != m_crn[j].map.end() ) {
+          size_t k = f_j_iter->first;
+
+          // Iterating through all features in camera j that have
+          // connections to camera k.
+          matrix_camera_camera S_jk;
+          if ( this->m_fixed_camera[k] ) {
+            m_S_column[j].push_back( std::make_pair( k, S_jk ) );
+            f_j_iter = m_crn[j].map.upper_bound( k );
+            continue;
+          }
+          for ( ; f_j_iter != m_crn[j].map.end() && f_j_iter->first == k; f_j_iter++ )
+            S_jk -= f_j_iter->second->m_y *
+              transpose( f_j_iter->second->m_map.find( k )->second.lock()->m_w );
+          m_S_column[j].push_back( std::make_pair( k, S_jk ) );
+        }
+      }
+    }
+
+    struct LinearizeCameras {
+      AdjustSparse& ba;
+      LinearizeCameras( AdjustSparse& ba ) : ba(ba) {}
+      void operator()( size_t begin, size_t end ) const { ba.linearize_cameras( begin, end ); }
+    };
+    struct ReducePoints {
+      AdjustSparse& ba;
+      ReducePoints( AdjustSparse& ba ) : ba(ba) {}
+      void operator()( size_t begin, size_t end ) const { ba.reduce_points( begin, end ); }
+    };
+    struct ReduceCameras {
+      AdjustSparse& ba;
+      Vector<double>& e;
+      ReduceCameras( AdjustSparse& ba, Vector<double>& e ) : ba(ba), e(e) {}
+      void operator()( size_t begin, size_t end ) const { ba.reduce_cameras( begin, end, e ); }
+    };
+    struct SchurColumns {
+      AdjustSparse& ba;
+      SchurColumns( AdjustSparse& ba ) : ba(ba) {}
+      void operator()( size_t begin, size_t end ) const { ba.schur_columns( begin, end ); }
+    };
+
   public:
 
     AdjustSparse( BundleAdjustModelT & model,
@@ -78,10 +362,87 @@ namespace ba {
       vw_out(DebugMessage,"ba") << "Constructed Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
       m_found_ideal_ordering = false;
+      m_use_conjugate_gradient = false;
+      m_cg_preconditioner = SCHUR_JACOBI_PRECONDITIONER;
+      m_cg_tolerance = 1e-10;
+      m_cg_max_iterations = 0;
+      m_use_supernodal_cholesky = false;
+      m_use_parallel_assembly = false;
+
+      m_measure_offset.resize( m_crn.size() + 1 );
+      m_point_offset.resize( this->m_model.num_points() + 1 );
+      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        size_t m = m_measure_offset[j];
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++, m++ )
+          m_point_offset[(**fiter).m_point_id + 1]++;
+        m_measure_offset[j+1] = m;
+      }
+      for ( size_t i = 0; i < this->m_model.num_points(); i++ )
+        m_point_offset[i+1] += m_point_offset[i];
+      m_point_measures.resize( m_measure_offset.back() );
+      {
+        std::vector<size_t> next( m_point_offset.begin(), m_point_offset.end() - 1 );
+        for ( size_t j = 0; j < m_crn.size(); j++ ) {
+          size_t m = m_measure_offset[j];
+          for ( crn_iter fiter = m_crn[j].begin();
+                fiter != m_crn[j].end(); fiter++, m++ )
+            m_point_measures[next[(**fiter).m_point_id]++] = m;
+        }
+      }
+      m_measure_V.resize( m_measure_offset.back() );
+      m_measure_epsilon_b.resize( m_measure_offset.back() );
+      m_camera_error.resize( m_crn.size() );
+      this->init_pixel_errors( m_crn );
+      m_S_diagonal.resize( m_crn.size() );
+      m_S_column.resize( m_crn.size() );
     }
 
     math::MatrixSparseSkyline<double> S() const { return m_S; }
 
+    /// Solve for the camera update by preconditioned conjugate
+    /// gradients on products with S, without ever forming S, for
+    /// problems whose S is too large to factor.  Each solve stops at
+    /// a residual of tolerance times norm_2(e), or after
+    /// max_iterations (zero allows one per unknown).  S() and
+    /// covCalc() aren't available in this mode.
+    bool conjugate_gradient() const { return m_use_conjugate_gradient; }
+    void set_conjugate_gradient( bool use,
+                                 ReducedCameraPreconditioner preconditioner = SCHUR_JACOBI_PRECONDITIONER,
+                                 double tolerance = 1e-10, size_t max_iterations = 0 ) {
+      m_use_conjugate_gradient = use;
+      m_cg_preconditioner = preconditioner;
+      m_cg_tolerance = tolerance;
+      m_cg_max_iterations = max_iterations;
+    }
+
+    /// Solve for the camera update with the parallel supernodal
+    /// Cholesky factorization of SparseCholesky.h, rather than the
+    /// skyline L*D*L^T.  If S turns out not to be positive definite,
+    /// that iteration falls back to the skyline solver.
+    bool supernodal_cholesky() const { return m_use_supernodal_cholesky; }
+    void set_supernodal_cholesky( bool use ) { m_use_supernodal_cholesky = use; }
+
+    /// Evaluate the Jacobians and build V, Y and S on the thread
+    /// pool, camera by camera.  The model's Jacobians and operator(),
+    /// and the robust cost function, must then be safe to call from
+    /// several threads at a time.  The sums are taken in the same
+    /// order either way, so the results don't change.
+    bool parallel_assembly() const { return m_use_parallel_assembly; }
+    void set_parallel_assembly( bool use ) { m_use_parallel_assembly = use; }
+
+    /// Adjust only the cameras within hops links of cameras in the
+    /// camera relation network, such as the ones just added to a
+    /// survey, and hold the rest fixed.  S keeps the blocks of the
+    /// whole network, so the ordering and Cholesky analysis found
+    /// for it are reused as the window moves.
+    void set_window( std::vector<size_t> const& cameras, size_t hops ) {
+      std::vector<bool> fixed = m_crn.neighborhood( cameras, hops );
+      fixed.resize( this->m_model.num_cameras(), false );
+      fixed.flip();
+      this->set_fixed_cameras( fixed );
+    }
+
     // Covariance Calculator
     // ___________________________________________________________
     // This routine inverts a sparse matrix S, and prints the individual
@@ -119,18 +480,17 @@ namespace ba {
     double update(double &abs_tol, double &rel_tol) {
       ++this->m_iterations;
       boost::scoped_ptr<Timer> time;
+      AdjustPhaseWatch phase( this->m_phase_watch );
+      phase.start( JacobianPhase );
 
       VW_DEBUG_ASSERT(this->m_control_net->size() == this->m_model.num_points(), LogicErr() << "BundleAdjustment::update() : Number of bundles does not match the number of points in the bundle adjustment model.");
 
-      // Reseting the values for U, V, epsilon
+      // Reseting the values for U and epsilon_a.  V and epsilon_b
+      // are summed afresh from the measures.
       BOOST_FOREACH( matrix_camera_camera& element, U )
         element = matrix_camera_camera();
       BOOST_FOREACH( vector_camera& element, epsilon_a )
         element = vector_camera();
-      BOOST_FOREACH( matrix_point_point& element, V )
-        element = matrix_point_point();
-      BOOST_FOREACH( vector_point& element, epsilon_b )
-        element = vector_point();
 
       size_t num_cam_params = BundleAdjustModelT::camera_params_n;
       size_t num_pt_params = BundleAdjustModelT::point_params_n;
@@ -139,55 +499,22 @@ namespace ba {
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double error_total = 0; // assume this is r^T\Sigma^{-1}r
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
-          size_t i = measure->m_point_id;
-
-          matrix_2_camera A =
-            this->m_model.A_jacobian( i, j,
-                                      this->m_model.A_parameters(j),
-                                      this->m_model.B_parameters(i) );
-          matrix_2_point B =
-            this->m_model.B_jacobian( i, j,
-                                      this->m_model.A_parameters(j),
-                                      this->m_model.B_parameters(i) );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = measure->m_location -
-              this->m_model(i,j,this->m_model.A_parameters(j),
-                            this->m_model.B_parameters(i) );
-          } catch (const camera::PixelToRayErr& e) {}
-
-          if ( error != Vector2() ) {
-            double mag = norm_2(error);
-            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-            error *= weight;
-          }
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = measure->m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          error_total += .5 * transpose(error) *
-            inverse_cov * error;
-
-          // Storing intermediate values
-          U[j] += transpose(A) * inverse_cov * A;
-          V[i] += transpose(B) * inverse_cov * B;
-          epsilon_a[j] += transpose(A) * inverse_cov * error;
-          epsilon_b[i] += transpose(B) * inverse_cov * error;
-          measure->m_w = transpose(A) * inverse_cov * B;
-        }
-      }
+      detail::for_each_range( LinearizeCameras( *this ), m_crn.size(), m_use_parallel_assembly );
+      detail::for_each_range( ReducePoints( *this ), V.size(), m_use_parallel_assembly );
+      if ( !this->m_fixed_error_valid )
+        sum_fixed_error();
+      double error_total = this->m_fixed_error;
+      BOOST_FOREACH( double error, m_camera_error )
+        error_total += error;
+      this->m_pixel_error_valid = this->m_num_fixed_cameras == 0;
       time.reset();
 
       // Add in the camera position and pose constraint terms and covariances.
       time.reset(new Timer("Solving for Camera and GCP error:",DebugMessage,"ba"));
       if ( this->m_use_camera_constraint )
         for ( size_t j = 0; j < U.size(); ++j ) {
+          if ( this->m_fixed_camera[j] )
+            continue;
           matrix_camera_camera inverse_cov =
             this->m_model.A_inverse_covariance(j);
           U[j] += inverse_cov;
@@ -201,7 +528,8 @@ namespace ba {
       // Points (GCPs), not for 3D tie points.
       if (this->m_use_gcp_constraint)
         for ( size_t i = 0; i < V.size(); ++i )
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if ( !this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
             matrix_point_point inverse_cov;
             inverse_cov = this->m_model.B_inverse_covariance(i);
             V[i] += inverse_cov;
@@ -211,6 +539,8 @@ namespace ba {
           }
       time.reset();
 
+      phase.start( SchurPhase );
+
       // set initial lambda, and ignore if the user has touched it
       if ( this->m_iterations == 1 && this->m_lambda == 1e-3 ) {
         time.reset(new Timer("Solving for Lambda:", DebugMessage, "ba"));
@@ -262,115 +592,110 @@ namespace ba {
       }
 
       // Compute V inverse
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
-        chol_inverse( V_temp );
-        V_inverse[i] = transpose(V_temp)*V_temp;
-      }
+      V_inverse = V;
+      if ( size_t failed = batch_symmetric_inverse( V_inverse, true ) )
+        vw_out(WarningMessage, "ba") << failed << " blocks of V are not positive definite.\n";
 
       // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
-        }
-      }
+      detail::for_each_range( ReduceCameras( *this, e ), m_crn.size(), m_use_parallel_assembly );
 
       time.reset();
 
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
+      Vector<double> delta_a;
+      if ( m_use_conjugate_gradient ) {
+        phase.start( FactorPhase );
+        time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+        delta_a = solve_reduced_camera_system<BundleAdjustModelT::camera_params_n,
+                                              BundleAdjustModelT::point_params_n>
+          ( m_crn, U, this->m_model.num_points(), e,
+            m_cg_preconditioner, m_cg_tolerance, m_cg_max_iterations );
+        time.reset();
+      } else {
+        time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
+
+        // The S matrix is a m x m block matrix with blocks that are
+        // camera_params_n x camera_params_n in size.  It has a sparse
+        // skyline structure, which makes it more efficient to solve
+        // through L*D*L^T decomposition and forward/back substitution
+        // below.
+        math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                            this->m_model.num_cameras()*num_cam_params);
+        std::vector<std::pair<size_t,size_t> > S_blocks;
+        detail::for_each_range( SchurColumns( *this ), m_crn.size(), m_use_parallel_assembly );
+        for ( size_t j = 0; j < m_crn.size(); j++ ) {
           // Loading into sparse matrix
           size_t offset = j * num_cam_params;
           for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
             for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
+              S( offset+bb, offset+aa ) = m_S_diagonal[j](aa,bb);  // Transposing
             }
           }
-        }
-
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
 
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
-
-          // Loading into sparse matrix
           // - if it seems we are loading in oddly, it's because the sparse
           //   matrix is row major.
-          if ( found ) {
+          for ( size_t n = 0; n < m_S_column[j].size(); n++ ) {
+            size_t k = m_S_column[j][n].first;
             submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
+                       num_cam_params, num_cam_params ) = transpose(m_S_column[j][n].second);
+            S_blocks.push_back( std::make_pair( k, j ) );
           }
         }
-      }
 
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
-      time.reset();
+        m_S = S; // S is modified in sparse solve. Keeping a copy.
+        time.reset();
+        phase.start( FactorPhase );
+
+        bool solved = false;
+        if ( m_use_supernodal_cholesky ) {
+          // The structure of S is the same every iteration, so it's only
+          // analyzed once.
+          if ( !m_cholesky ) {
+            time.reset(new Timer("Analyzing Sparse Cholesky", DebugMessage, "ba"));
+            m_cholesky.reset( new math::SparseCholesky<double>( this->m_model.num_cameras(),
+                                                                num_cam_params, S_blocks ) );
+            time.reset();
+          }
 
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
+          time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+          try {
+            m_cholesky->factor( S );
+            delta_a = m_cholesky->solve( e );
+            solved = true;
+          } catch ( const MathErr& ) {
+            vw_out(WarningMessage,"ba") << "S is not positive definite; using the skyline solver.\n";
+          }
+          time.reset();
+        }
 
-        m_found_ideal_ordering = true;
-        time.reset();
-      }
+        if ( !solved ) {
+          // Computing ideal ordering
+          if (!m_found_ideal_ordering) {
+            time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
+            m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
+            math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
+            m_ideal_skyline = solve_for_skyline(mod_S);
 
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+            m_found_ideal_ordering = true;
+            time.reset();
+          }
+
+          time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
 
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
+          // Compute the LDL^T decomposition and solve using sparse methods.
+          math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
+          delta_a = sparse_solve( modified_S,
+                                  reorganize(e, m_ideal_ordering),
+                                  m_ideal_skyline );
+          delta_a = reorganize(delta_a, modified_S.inverse());
+        }
+      }
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
       time.reset();
 
       // --- SOLVE B'S UPDATE STEP ---------------------------------
+      phase.start( UpdatePhase );
 
       // Back Solving for Delta B
       time.reset(new Timer("Solve Delta B", DebugMessage, "ba"));
@@ -381,6 +706,8 @@ namespace ba {
         // Building right half, sum( WijT * delta_aj )
         std::vector< vector_point > right_delta_b( this->m_model.num_points() );
         for ( size_t j = 0; j < m_crn.size(); j++ ) {
+          if ( this->m_fixed_camera[j] )
+            continue;
           for ( crn_iter fiter = m_crn[j].begin();
                 fiter != m_crn[j].end(); fiter++ ) {
             right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
@@ -390,6 +717,8 @@ namespace ba {
 
         // Solving for delta b
         for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
+          if ( this->m_fixed_point[i] )
+            continue;
           Vector<double> delta_temp = epsilon_b[i] - right_delta_b[i];
           Matrix<double> hessian = V[i];
           solve( delta_temp, hessian );
@@ -414,10 +743,15 @@ namespace ba {
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_error_total = 0;
+      double new_error_total = this->m_fixed_error;
+      size_t m = 0;
       for ( size_t j = 0; j < m_crn.size(); j++ ) {
         for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
+              fiter != m_crn[j].end(); fiter++, m++ ) {
+          this->m_new_pixel_error[2*m] = this->m_new_pixel_error[2*m+1] = 0;
+          if ( this->m_fixed_camera[j] && this->m_fixed_point[(**fiter).m_point_id] )
+            continue;
+
           // Compute error vector
           vector_camera new_a = this->m_model.A_parameters(j) +
             subvector( delta_a, num_cam_params*j, num_cam_params );
@@ -430,6 +764,8 @@ namespace ba {
             error = (**fiter).m_location -
               this->m_model((**fiter).m_point_id,j,new_a,new_b);
           } catch (const camera::PixelToRayErr& e) {}
+          this->m_new_pixel_error[2*m] = error[0];
+          this->m_new_pixel_error[2*m+1] = error[1];
           double mag = norm_2( error );
           double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
           error *= weight;
@@ -447,6 +783,8 @@ namespace ba {
       // Camera Constraints
       if ( this->m_use_camera_constraint )
         for (size_t j = 0; j < U.size(); ++j) {
+          if ( this->m_fixed_camera[j] )
+            continue;
 
           vector_camera new_a = this->m_model.A_parameters(j) +
             subvector(delta_a, num_cam_params*j, num_cam_params);
@@ -460,7 +798,8 @@ namespace ba {
       // GCP Error
       if ( this->m_use_gcp_constraint )
         for ( size_t i = 0; i < V.size(); ++i )
-          if ( (*this->m_control_net)[i].type() ==
+          if ( !this->m_fixed_point[i] &&
+               (*this->m_control_net)[i].type() ==
                ControlPoint::GroundControlPoint) {
 
             vector_point new_b = this->m_model.B_parameters(i) +
@@ -489,6 +828,7 @@ namespace ba {
       if ( R > 0 ) {
 
         time.reset(new Timer("Setting Parameters",DebugMessage,"ba"));
+        this->m_pixel_error.swap( this->m_new_pixel_error );
         for (size_t j = 0; j < this->m_model.num_cameras(); ++j)
           this->m_model.set_A_parameters(j, this->m_model.A_parameters(j) +
                                          subvector(delta_a, num_cam_params*j,num_cam_params));
@@ -329,4 +329,10 @@ namespace ba {
     return (i.z() > j.z());
   }
 
+  void ControlNetworkKMLTask::operator()() {
+    KMLFile kml( m_filename, m_name, m_prefix );
+    write_kml_styles( kml );
+    write_gcps_kml( kml, *m_network );
+  }
+
 }}
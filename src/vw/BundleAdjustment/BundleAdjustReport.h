@@ -21,6 +21,7 @@
 
 // Vision Workbench
 #include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Cartography/SimplePointImageManipulation.h>
@@ -91,6 +92,14 @@ namespace ba {
                                 float& east, float& west,
                                 int recursive_lvl );
 
+  // Writes the KML of a copy of a control network, so that it can be
+  // done on a thread of its own while the adjustment carries on.
+  struct ControlNetworkKMLTask {
+    std::string m_filename, m_name, m_prefix;
+    boost::shared_ptr<ControlNetwork> m_network;
+    void operator()();
+  };
+
   // Bundle Adjust Report Code
   //template <class BundleAdjustModelT, class BundleAdjusterT>
   template <class BundleAdjusterT>
@@ -104,6 +113,7 @@ namespace ba {
     typedef typename BundleAdjusterT::model_type ModelType;
     ModelType& m_model;
     BundleAdjusterT& m_adjuster;
+    boost::shared_ptr<Thread> m_kml_thread;
 
 #ifndef __APPLE__
     inline std::string current_posix_time_string()  {
@@ -140,7 +150,7 @@ namespace ba {
     BundleAdjustReport(std::string const& name,
                        ModelType& model,
                        BundleAdjusterT& adjuster,
-                       int report_lvl=10)  :  m_model(model), m_adjuster(adjuster), bundleadjust_name(name), report_level(report_lvl) {
+                       int report_lvl=10)  :  m_model(model), m_adjuster(adjuster), bundleadjust_name(name), report_level(report_lvl), report_interval(1) {
 
       m_human_both.add(std::cout);
 
@@ -202,8 +212,14 @@ namespace ba {
       m_human_both << "\n\n";
     }
 
-    // This is a callback from inside the loop of iterations
+    ~BundleAdjustReport() { wait_for_kml(); }
+
+    // This is a callback from inside the loop of iterations. Only
+    // every report_interval'th iteration is reported.
     void loop_tie_in() {
+      if ( report_interval > 1 && m_adjuster.iterations() % report_interval != 0 )
+        return;
+
       m_human_both << "[" << current_posix_time_string() << "]\tFinished Iteration "
                    << m_adjuster.iterations() << std::endl;
 
@@ -227,6 +243,7 @@ namespace ba {
         triangulation_readings();
 
       // Closing all files out
+      wait_for_kml();
       m_human_both.remove( m_human_report );
       m_human_both.remove( std::cout );
 
@@ -247,16 +264,28 @@ namespace ba {
       m_human_both << "\tLambda: " << m_adjuster.lambda() << std::endl;
       boost::shared_ptr<ControlNetwork> network = m_model.control_network();
       { // Grabbing Image Error information
-        size_t cp_index = 0;
         math::CDFAccumulator<double> image_cdf;
-        BOOST_FOREACH( ControlPoint const& cp, *network ) {
+        if ( m_adjuster.pixel_errors_valid() ) {
+          // The adjuster has the errors already, so the projections
+          // are just the locations less the errors.
+          std::vector<double> const& error = m_adjuster.pixel_errors();
+          std::vector<double> const& location = m_adjuster.pixel_locations();
+          for ( size_t k = 0; k < error.size(); k += 2 ) {
+            Vector2 measure( location[k], location[k+1] );
+            image_cdf( m_model.image_compare( measure,
+                                              measure - Vector2( error[k], error[k+1] ) ) );
+          }
+        } else {
+          size_t cp_index = 0;
+          BOOST_FOREACH( ControlPoint const& cp, *network ) {
           BOOST_FOREACH( ControlMeasure const& cm, cp ) {
-            image_cdf(m_model.image_compare(cm.position(),
-                                            m_model(cp_index,cm.image_id(),
-                                                    m_model.A_parameters(cm.image_id()),
-                                                    m_model.B_parameters(cp_index))));
+              image_cdf(m_model.image_compare(cm.position(),
+                                              m_model(cp_index,cm.image_id(),
+                                                      m_model.A_parameters(cm.image_id()),
+                                                      m_model.B_parameters(cp_index))));
+            }
+            cp_index++;
           }
-          cp_index++;
         }
         write_statistics( image_cdf, "Image",
                           m_model.image_unit());
@@ -397,31 +426,40 @@ namespace ba {
         m_human_report << "]\n";
       }
     }
-    // Write KML?
+    // Write KML? This copies the control network and writes it out
+    // on a thread of its own, so the adjustment needn't wait for it.
+    // A second call waits for the first to finish, as does the end of
+    // the report.
     void write_control_network_kml( bool gcps_only=true ) {
+      wait_for_kml();
       m_file_prefix = bundleadjust_name;
       boost::to_lower( m_file_prefix );
       boost::replace_all( m_file_prefix, " ", "_" );
 
-      std::ostringstream kml_filename;
-      kml_filename << m_file_prefix + ".kml";
-      KMLFile kml( kml_filename.str(),
-                   bundleadjust_name,
-                   m_file_prefix );
-      write_kml_styles( kml );
-
-      boost::shared_ptr<ControlNetwork> network = m_model.control_network();
-
-      write_gcps_kml( kml, *network );
+      ControlNetworkKMLTask task;
+      task.m_filename = m_file_prefix + ".kml";
+      task.m_name = bundleadjust_name;
+      task.m_prefix = m_file_prefix;
+      task.m_network.reset( new ControlNetwork( *m_model.control_network() ) );
       if ( !gcps_only ) {
         //m_model.image_errors( image_errors );
         //write_3d_est_kml( kml, *network, image_errors );
       }
+      m_kml_thread.reset( new Thread( task ) );
+    }
+
+    // Blocks until the KML being written in the background is done.
+    void wait_for_kml() {
+      if ( m_kml_thread ) {
+        m_kml_thread->join();
+        m_kml_thread.reset();
+      }
     }
 
     // Public variables
     std::string bundleadjust_name;
     int report_level;
+    int report_interval;
   };
 
 }} // End namespace
@@ -78,48 +78,75 @@ namespace ba {
     }   // end iterating through cameras
   }
 
+  // Attaches a feature to its camera node, adding nodes up to it
+  template <class FeatureT>
+  void CameraRelationNetwork<FeatureT>::add_feature( boost::shared_ptr<FeatureT> const& feature ) {
+    // Seeing if a camera node exists for this measure
+    if ( feature->m_camera_id >= this->size() ) {
+      for ( size_t i = this->size();
+            i <= feature->m_camera_id; i++ ) {
+        this->add_node( CameraNode<FeatureT>( i, "" ) );
+      }
+    }
+    (*this)[feature->m_camera_id].relations.push_back( feature );
+  }
+
+  // Doubly Linking features together
+  template <class FeatureT>
+  void CameraRelationNetwork<FeatureT>::link_features( std::vector<boost::shared_ptr<FeatureT> > const& features ) {
+    typedef boost::weak_ptr<FeatureT> w_ptr;
+    typedef typename std::vector<boost::shared_ptr<FeatureT> >::const_iterator fvi_ptr;
+    if ( features.empty() )
+      return;
+    for ( fvi_ptr first = features.begin();
+          first < features.end() - 1; first++ ) {
+      for ( fvi_ptr second = first + 1;
+            second < features.end(); second++ ) {
+        (*first)->connection( w_ptr( *second ), false );
+        (*second)->connection( w_ptr( *first ), false );
+      }
+    }
+  }
+
   template <class FeatureT>
   void CameraRelationNetwork<FeatureT>::read_controlnetwork( ControlNetwork const& cnet ) {
     typedef boost::shared_ptr<FeatureT> f_ptr;
-    typedef boost::weak_ptr<FeatureT> w_ptr;
     m_nodes.clear();
 
     for ( size_t cp_i = 0; cp_i < cnet.size(); cp_i++ ) {
       std::vector<f_ptr> features_added;
       // Building up features to be added and linking to camera nodes
       BOOST_FOREACH( ControlMeasure const& cm, cnet[cp_i] ) {
-        // Seeing if a camera node exists for this measure
-        if ( cm.image_id() >= this->size() ) {
-          for ( size_t i = this->size();
-                i <= cm.image_id(); i++ ) {
-            this->add_node( CameraNode<FeatureT>( i, "" ) );
-          }
-        }
-
-        // Appending to list
         features_added.push_back( f_ptr( new FeatureT(cm, cp_i) ) );
-
-        // Attaching to camera node
-        (*this)[cm.image_id()].relations.push_back( features_added.back() );
+        add_feature( features_added.back() );
       }
-
-      // Doubly Linking features together
-      typedef typename std::vector<f_ptr>::iterator fvi_ptr;
-      for ( fvi_ptr first = features_added.begin();
-            first < features_added.end() - 1; first++ ) {
-        for ( fvi_ptr second = first + 1;
-              second < features_added.end(); second++ ) {
-          (*first)->connection( w_ptr( *second ), false );
-          (*second)->connection( w_ptr( *first ), false );
-        }
-      }
-
+      link_features( features_added );
     } // end for through control points
 
     // setting up maps
     this->build_map();
   }
 
+  template <class FeatureT>
+  void CameraRelationNetwork<FeatureT>::read_controlnetwork( CompactControlNetwork const& cnet ) {
+    typedef boost::shared_ptr<FeatureT> f_ptr;
+    m_nodes.clear();
+
+    std::vector<f_ptr> features_added;
+    for ( size_t cp_i = 0; cp_i < cnet.size(); cp_i++ ) {
+      features_added.clear();
+      for ( ControlMeasureRecord const* cm = cnet.begin(cp_i); cm != cnet.end(cp_i); ++cm ) {
+        VW_ASSERT( cm->image < cnet.num_images(),
+                   IOErr() << "CameraRelationNetwork: measure of point " << cp_i << " has an image out of range." );
+        features_added.push_back( f_ptr( new FeatureT(*cm, cnet.image_id(cm->image), cp_i) ) );
+        add_feature( features_added.back() );
+      }
+      link_features( features_added );
+    }
+
+    this->build_map();
+  }
+
   template <class FeatureT>
   void CameraRelationNetwork<FeatureT>::write_controlnetwork( ControlNetwork & cnet ) const {
 
@@ -209,6 +236,37 @@ namespace ba {
                Aborted() << "Failed to load any points, Control Network empty\n" );
   }
 
+  template <class FeatureT>
+  std::vector<bool> CameraRelationNetwork<FeatureT>::neighborhood( std::vector<size_t> const& cameras,
+                                                                   size_t hops ) const {
+    typedef typename std::multimap<size_t, boost::shared_ptr<FeatureT> >::const_iterator mm_cit;
+    std::vector<bool> result( m_nodes.size(), false );
+    std::vector<size_t> frontier;
+    BOOST_FOREACH( size_t j, cameras ) {
+      VW_ASSERT( j < m_nodes.size(), ArgumentErr() << "neighborhood: no camera " << j << "." );
+      if ( !result[j] ) {
+        result[j] = true;
+        frontier.push_back( j );
+      }
+    }
+
+    // Breadth first, one hop at a time. The map is sorted by the
+    // other camera, so each of them is found with one upper_bound.
+    for ( size_t hop = 0; hop < hops && !frontier.empty(); hop++ ) {
+      std::vector<size_t> next;
+      BOOST_FOREACH( size_t j, frontier ) {
+        std::multimap<size_t, boost::shared_ptr<FeatureT> > const& map = m_nodes[j].map;
+        for ( mm_cit it = map.begin(); it != map.end(); it = map.upper_bound( it->first ) )
+          if ( !result[it->first] ) {
+            result[it->first] = true;
+            next.push_back( it->first );
+          }
+      }
+      frontier.swap( next );
+    }
+    return result;
+  }
+
   // Explicit template Instantiation
 #define VW_INSTANTIATE_CAMERA_RELATION_TYPES(FEATURET) \
   template class CameraRelationNetwork<FEATURET >; \
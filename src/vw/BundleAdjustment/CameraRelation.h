@@ -25,6 +25,7 @@
 
 #include <vw/Math/Matrix.h>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
 #include <vw/InterestPoint/InterestData.h>
 #include <boost/foreach.hpp>
 #include <map>
@@ -119,6 +120,11 @@ namespace ba {
         ip::InterestPoint( cmeas.position()[0], cmeas.position()[1],
                            cmeas.sigma()[0] );
     }
+    IPFeature( ControlMeasureRecord const& cmeas, uint64 image_id,
+               size_t const& /*point_id*/ ) :
+    FeatureBase<IPFeature>( image_id ) {
+      m_ip = ip::InterestPoint( cmeas.col, cmeas.row, cmeas.col_sigma );
+    }
 
     std::string type() { return "IP"; }
     ControlMeasure control_measure() const;
@@ -145,6 +151,10 @@ namespace ba {
       m_location = cmeas.position();
       m_scale = cmeas.sigma();
     }
+    JFeature ( ControlMeasureRecord const& cmeas, uint64 image_id,
+               size_t const& point_id ) :
+    FeatureBase<JFeature>( image_id ), m_point_id(point_id),
+      m_location( cmeas.col, cmeas.row ), m_scale( cmeas.col_sigma, cmeas.row_sigma ) {}
 
     std::string type() { return "J"; }
     ControlMeasure control_measure() const;
@@ -182,6 +192,9 @@ namespace ba {
     typedef CameraNode<FeatureT> cnode;
     std::vector<cnode> m_nodes;
 
+    void add_feature( boost::shared_ptr<FeatureT> const& feature );
+    void link_features( std::vector<boost::shared_ptr<FeatureT> > const& features );
+
   public:
 
     // Iterator access
@@ -198,7 +211,14 @@ namespace ba {
     void add_node( cnode const& node );
     void build_map();
     void read_controlnetwork( ControlNetwork const& cnet );
+    /// Builds the network straight from the records, without copying
+    /// out ControlPoints.
+    void read_controlnetwork( CompactControlNetwork const& cnet );
     void write_controlnetwork( ControlNetwork & cnet ) const;
+    /// Marks the cameras that are at most hops links from any of
+    /// cameras, where a link joins two cameras that share a feature.
+    /// Uses the maps made by build_map().
+    std::vector<bool> neighborhood( std::vector<size_t> const& cameras, size_t hops ) const;
   };
 
 }}
@@ -0,0 +1,290 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactControlNetwork.cc
+///
+/// Reading and writing of .cnet2 control network files.
+///
+#include <fstream>
+#include <cstring>
+#include <map>
+
+#include <boost/static_assert.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/FileIO/MappedFile.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+
+namespace vw {
+namespace ba {
+
+namespace {
+
+  const char compact_cnet_magic[8] = { 'V', 'W', 'C', 'N', '2', 0, 0, 0 };
+  const uint32 compact_cnet_version = 1;
+  const uint64 compact_cnet_alignment = 64;
+
+  struct CompactCNetHeader {
+    char magic[8];
+    uint32 version;
+    uint32 network_type;
+    uint32 point_record_size;
+    uint32 measure_record_size;
+    uint64 num_points, num_measures, num_images, num_strings;
+    uint64 points_offset, measures_offset, images_offset, strings_offset;
+    uint8 reserved[40];
+  };
+
+  BOOST_STATIC_ASSERT( sizeof(ControlPointRecord) == 64 );
+  BOOST_STATIC_ASSERT( sizeof(ControlMeasureRecord) == 48 );
+  BOOST_STATIC_ASSERT( sizeof(CompactCNetHeader) == 128 );
+
+  uint64 align( uint64 offset ) {
+    return (offset + compact_cnet_alignment - 1) / compact_cnet_alignment * compact_cnet_alignment;
+  }
+
+  // The header of a network of the given sizes, with the offsets of
+  // its sections filled in.  Returns the size of the whole file.
+  uint64 lay_out( CompactCNetHeader& header, uint64 num_points, uint64 num_measures,
+                  uint64 num_images, uint64 num_strings, uint64 string_bytes ) {
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy( header.magic, compact_cnet_magic, sizeof(header.magic) );
+    header.version = compact_cnet_version;
+    header.point_record_size = sizeof(ControlPointRecord);
+    header.measure_record_size = sizeof(ControlMeasureRecord);
+    header.num_points = num_points;
+    header.num_measures = num_measures;
+    header.num_images = num_images;
+    header.num_strings = num_strings;
+    header.points_offset = align( sizeof(header) );
+    header.measures_offset = align( header.points_offset + num_points * sizeof(ControlPointRecord) );
+    header.images_offset = align( header.measures_offset + num_measures * sizeof(ControlMeasureRecord) );
+    header.strings_offset = align( header.images_offset + num_images * sizeof(uint64) );
+    return header.strings_offset + (num_strings + 1) * sizeof(uint64) + string_bytes;
+  }
+
+} // anonymous namespace
+
+  CompactControlNetwork::CompactControlNetwork( std::string const& filename ) {
+    if ( MappedFile::supported() ) {
+      m_file.reset( new MappedFile( filename ) );
+      m_data = m_file->data();
+      m_size = m_file->size();
+    } else {
+      std::ifstream f( filename.c_str(), std::ios::binary | std::ios::in );
+      if ( !f.is_open() )
+        vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a CNET2 file." );
+      f.seekg( 0, std::ios::end );
+      m_buffer.resize( size_t(f.tellg()) );
+      f.seekg( 0, std::ios::beg );
+      if ( !m_buffer.empty() )
+        f.read( (char*)&m_buffer[0], m_buffer.size() );
+      m_data = m_buffer.empty() ? 0 : &m_buffer[0];
+      m_size = m_buffer.size();
+    }
+    attach( filename );
+  }
+
+  CompactControlNetwork::CompactControlNetwork( ControlNetwork const& cnet ) {
+    // Each distinct image gets an entry in the image table, in the
+    // order they are first seen.
+    typedef std::map<std::pair<uint64, std::string>, uint32> ImageLookup;
+    ImageLookup image_lookup;
+    std::vector<ImageLookup::const_iterator> images;
+    uint64 num_measures = 0;
+    for ( size_t i = 0; i < cnet.size(); i++ )
+      for ( ControlPoint::const_iterator cm = cnet[i].begin(); cm != cnet[i].end(); ++cm, ++num_measures ) {
+        std::pair<ImageLookup::iterator, bool> entry =
+          image_lookup.insert( std::make_pair( std::make_pair( cm->image_id(), cm->serial() ), uint32(images.size()) ) );
+        if ( entry.second )
+          images.push_back( entry.first );
+      }
+
+    std::vector<uint64> string_offsets( 1, 0 );
+    std::string strings;
+    std::string network_strings[4] = { cnet.network_id(), cnet.target_name(),
+                                       cnet.description(), cnet.user_name() };
+    for ( size_t s = 0; s < 4; s++ ) {
+      strings += network_strings[s];
+      string_offsets.push_back( strings.size() );
+    }
+    for ( size_t k = 0; k < images.size(); k++ ) {
+      strings += images[k]->first.second;
+      string_offsets.push_back( strings.size() );
+    }
+    for ( size_t i = 0; i < cnet.size(); i++ ) {
+      strings += cnet[i].id();
+      string_offsets.push_back( strings.size() );
+    }
+
+    CompactCNetHeader header;
+    m_buffer.resize( lay_out( header, cnet.size(), num_measures, images.size(),
+                              string_offsets.size() - 1, strings.size() ), 0 );
+    header.network_type = cnet.type();
+    std::memcpy( &m_buffer[0], &header, sizeof(header) );
+
+    ControlPointRecord* points = reinterpret_cast<ControlPointRecord*>( &m_buffer[header.points_offset] );
+    ControlMeasureRecord* measures = reinterpret_cast<ControlMeasureRecord*>( &m_buffer[header.measures_offset] );
+    uint64 m = 0;
+    for ( size_t i = 0; i < cnet.size(); i++ ) {
+      ControlPoint const& cp = cnet[i];
+      ControlPointRecord& point = points[i];
+      for ( size_t d = 0; d < 3; d++ ) {
+        point.position[d] = cp.position()[d];
+        point.sigma[d] = cp.sigma()[d];
+      }
+      point.first_measure = m;
+      point.num_measures = uint32(cp.size());
+      point.type = uint8(cp.type());
+      point.ignore = cp.ignore() ? 1 : 0;
+      for ( ControlPoint::const_iterator cm = cp.begin(); cm != cp.end(); ++cm, ++m ) {
+        ControlMeasureRecord& measure = measures[m];
+        measure.focalplane[0] = cm->focalplane()[0];
+        measure.focalplane[1] = cm->focalplane()[1];
+        measure.ephemeris_time = cm->ephemeris_time();
+        measure.col = float32(cm->position()[0]);
+        measure.row = float32(cm->position()[1]);
+        measure.col_sigma = float32(cm->sigma()[0]);
+        measure.row_sigma = float32(cm->sigma()[1]);
+        measure.image = image_lookup.find( std::make_pair( cm->image_id(), cm->serial() ) )->second;
+        measure.type = uint8(cm->type());
+        measure.ignore = cm->ignore() ? 1 : 0;
+        measure.pixels_dominant = cm->is_pixels_dominant() ? 1 : 0;
+      }
+    }
+
+    uint64* image_ids = reinterpret_cast<uint64*>( &m_buffer[header.images_offset] );
+    for ( size_t k = 0; k < images.size(); k++ )
+      image_ids[k] = images[k]->first.first;
+
+    std::memcpy( &m_buffer[header.strings_offset], &string_offsets[0], string_offsets.size() * sizeof(uint64) );
+    if ( !strings.empty() )
+      std::memcpy( &m_buffer[header.strings_offset + string_offsets.size() * sizeof(uint64)],
+                   strings.data(), strings.size() );
+
+    m_data = &m_buffer[0];
+    m_size = m_buffer.size();
+    attach( "<memory>" );
+  }
+
+  CompactControlNetwork::~CompactControlNetwork() {}
+
+  void CompactControlNetwork::attach( std::string const& name ) {
+    if ( m_size < sizeof(CompactCNetHeader) ||
+         std::memcmp( m_data, compact_cnet_magic, sizeof(compact_cnet_magic) ) != 0 )
+      vw_throw( IOErr() << "\"" << name << "\" is not a CNET2 file." );
+    CompactCNetHeader header;
+    std::memcpy( &header, m_data, sizeof(header) );
+    if ( header.version != compact_cnet_version )
+      vw_throw( IOErr() << "\"" << name << "\" is a CNET2 file of unknown version " << header.version << "." );
+    if ( header.point_record_size != sizeof(ControlPointRecord) ||
+         header.measure_record_size != sizeof(ControlMeasureRecord) ||
+         header.network_type > ControlNetwork::ImageToGround ||
+         header.num_strings != 4 + header.num_images + header.num_points ||
+         header.points_offset % compact_cnet_alignment != 0 ||
+         header.measures_offset % compact_cnet_alignment != 0 ||
+         header.images_offset % compact_cnet_alignment != 0 ||
+         header.strings_offset % compact_cnet_alignment != 0 )
+      vw_throw( IOErr() << "\"" << name << "\" has a corrupt CNET2 header." );
+
+    if ( header.points_offset + header.num_points * sizeof(ControlPointRecord) > header.measures_offset ||
+         header.measures_offset + header.num_measures * sizeof(ControlMeasureRecord) > header.images_offset ||
+         header.images_offset + header.num_images * sizeof(uint64) > header.strings_offset ||
+         header.strings_offset + (header.num_strings + 1) * sizeof(uint64) > m_size )
+      vw_throw( IOErr() << "CNET2 file \"" << name << "\" is truncated." );
+
+    m_num_points = size_t(header.num_points);
+    m_num_measures = size_t(header.num_measures);
+    m_num_images = size_t(header.num_images);
+    m_num_strings = size_t(header.num_strings);
+    m_type = ControlNetwork::ControlNetworkType(header.network_type);
+    m_points = reinterpret_cast<ControlPointRecord const*>( m_data + header.points_offset );
+    m_measures = reinterpret_cast<ControlMeasureRecord const*>( m_data + header.measures_offset );
+    m_image_ids = reinterpret_cast<uint64 const*>( m_data + header.images_offset );
+    m_string_offsets = reinterpret_cast<uint64 const*>( m_data + header.strings_offset );
+    m_strings = reinterpret_cast<char const*>( m_string_offsets + m_num_strings + 1 );
+    if ( m_string_offsets[m_num_strings] > m_size - ( (uint8 const*)m_strings - m_data ) )
+      vw_throw( IOErr() << "CNET2 file \"" << name << "\" is truncated." );
+  }
+
+  std::string CompactControlNetwork::string( size_t s ) const {
+    VW_ASSERT( s < m_num_strings, ArgumentErr() << "CompactControlNetwork: no string " << s << "." );
+    uint64 first = m_string_offsets[s], last = m_string_offsets[s+1];
+    if ( first > last || last > m_string_offsets[m_num_strings] )
+      vw_throw( IOErr() << "CompactControlNetwork: corrupt string table." );
+    return std::string( m_strings + first, m_strings + last );
+  }
+
+  ControlMeasureRecord const* CompactControlNetwork::begin( size_t i ) const {
+    ControlPointRecord const& point = m_points[i];
+    if ( point.first_measure > m_num_measures || point.num_measures > m_num_measures - point.first_measure )
+      vw_throw( IOErr() << "CompactControlNetwork: point " << i << " has measures out of range." );
+    return m_measures + point.first_measure;
+  }
+
+  ControlMeasure CompactControlNetwork::control_measure( size_t m ) const {
+    ControlMeasureRecord const& r = m_measures[m];
+    if ( r.image >= m_num_images )
+      vw_throw( IOErr() << "CompactControlNetwork: measure " << m << " has an image out of range." );
+    ControlMeasure cm( r.col, r.row, r.col_sigma, r.row_sigma, m_image_ids[r.image],
+                       ControlMeasure::ControlMeasureType(r.type) );
+    cm.set_focalplane( r.focalplane[0], r.focalplane[1] );
+    cm.set_ephemeris_time( r.ephemeris_time );
+    cm.set_ignore( r.ignore != 0 );
+    cm.set_pixels_dominant( r.pixels_dominant != 0 );
+    cm.set_serial( image_serial( r.image ) );
+    return cm;
+  }
+
+  ControlPoint CompactControlNetwork::control_point( size_t i ) const {
+    ControlPointRecord const& r = m_points[i];
+    ControlPoint cp( ControlPoint::ControlPointType(r.type) );
+    cp.set_id( point_id(i) );
+    cp.set_ignore( r.ignore != 0 );
+    cp.set_position( Vector3( r.position[0], r.position[1], r.position[2] ) );
+    cp.set_sigma( Vector3( r.sigma[0], r.sigma[1], r.sigma[2] ) );
+    cp.reserve( r.num_measures );
+    for ( size_t m = begin(i) - m_measures; m < size_t(end(i) - m_measures); m++ )
+      cp.add_measure( control_measure( m ) );
+    return cp;
+  }
+
+  ControlNetwork CompactControlNetwork::control_network() const {
+    ControlNetwork cnet( network_id(), m_type, target_name(), description(), user_name() );
+    cnet.reserve( m_num_points );
+    for ( size_t i = 0; i < m_num_points; i++ )
+      cnet.add_control_point( control_point( i ) );
+    return cnet;
+  }
+
+  void CompactControlNetwork::write( std::string const& filename ) const {
+    std::ofstream f( filename.c_str(), std::ios::binary | std::ios::out );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing as CNET2 file." );
+    f.write( (char const*)m_data, std::streamsize(m_size) );
+    if ( !f )
+      vw_throw( IOErr() << "Failed to write CNET2 file \"" << filename << "\"." );
+  }
+
+  void write_compact_control_network( std::string const& filename, ControlNetwork const& cnet ) {
+    CompactControlNetwork( cnet ).write( filename );
+  }
+
+  ControlNetwork read_compact_control_network( std::string const& filename ) {
+    CompactControlNetwork cnet( filename );
+    return cnet.control_network();
+  }
+
+  bool is_compact_control_network( std::string const& filename ) {
+    std::ifstream f( filename.c_str(), std::ios::binary | std::ios::in );
+    char magic[sizeof(compact_cnet_magic)];
+    if ( !f.read( magic, sizeof(magic) ) )
+      return false;
+    return std::memcmp( magic, compact_cnet_magic, sizeof(magic) ) == 0;
+  }
+
+}} // namespace vw::ba
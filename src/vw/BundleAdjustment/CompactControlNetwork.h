@@ -0,0 +1,147 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactControlNetwork.h
+///
+/// A columnar control network format, .cnet2, that can be read in
+/// place through a memory mapping.
+///
+/// The file is a 128 byte header, then one fixed size
+/// ControlPointRecord per point, then one ControlMeasureRecord per
+/// measure with the measures of each point kept together in point
+/// order, then the image table, then a string table.  Measures name
+/// their image by its index in the image table, which holds each
+/// distinct pair of image ID and serial number once.  The string
+/// table holds the network's ID, target, description and user, then
+/// the serial number of each image, then the ID of each point.  The
+/// sections start on 64 byte boundaries, and values are in the byte
+/// order of the machine that wrote the file, as in the .cnet format.
+///
+/// The dates and descriptions of the network and of each measure,
+/// and the names of the measures' choosers, aren't stored.
+///
+/// Opening a CompactControlNetwork maps the file and checks its
+/// header, and costs the same for any number of points.  One can
+/// also be built in memory from a ControlNetwork, in which case it's
+/// laid out exactly as it would be written.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_COMPACTCONTROLNETWORK_H__
+#define __VW_BUNDLEADJUSTMENT_COMPACTCONTROLNETWORK_H__
+
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/BundleAdjustment/ControlNetwork.h>
+
+namespace vw {
+
+  class MappedFile;
+
+namespace ba {
+
+  /// The fields of a control point, as they are stored in a .cnet2
+  /// file.  Its measures are measures [first_measure,
+  /// first_measure + num_measures).
+  struct ControlPointRecord {
+    float64 position[3];
+    float64 sigma[3];
+    uint64 first_measure;
+    uint32 num_measures;
+    uint8 type, ignore;
+    uint8 reserved[2];
+  };
+
+  /// The fields of a control measure, as they are stored in a .cnet2
+  /// file.  image is an index into the file's image table.
+  struct ControlMeasureRecord {
+    float64 focalplane[2];
+    float64 ephemeris_time;
+    float32 col, row, col_sigma, row_sigma;
+    uint32 image;
+    uint8 type, ignore, pixels_dominant;
+    uint8 reserved;
+  };
+
+  /// A control network held as flat arrays of records, either mapped
+  /// from a .cnet2 file or built from a ControlNetwork.
+  class CompactControlNetwork : private boost::noncopyable {
+  public:
+    /// Maps the file, or reads it whole where files can't be mapped.
+    /// Throws IOErr if it isn't a .cnet2 file of a known version.
+    explicit CompactControlNetwork( std::string const& filename );
+
+    /// Lays out cnet in memory as it would be written.
+    explicit CompactControlNetwork( ControlNetwork const& cnet );
+
+    ~CompactControlNetwork();
+
+    size_t size() const { return m_num_points; }
+    size_t num_measures() const { return m_num_measures; }
+    size_t num_images() const { return m_num_images; }
+    ControlNetwork::ControlNetworkType type() const { return m_type; }
+
+    ControlPointRecord const& point( size_t i ) const { return m_points[i]; }
+
+    /// All of the measures, in point order.
+    ControlMeasureRecord const* measures() const { return m_measures; }
+    ControlMeasureRecord const& measure( size_t m ) const { return m_measures[m]; }
+
+    /// The measures of point i.
+    ControlMeasureRecord const* begin( size_t i ) const;
+    ControlMeasureRecord const* end( size_t i ) const { return begin(i) + m_points[i].num_measures; }
+
+    /// The image ID and serial number of entry k of the image table.
+    uint64 image_id( size_t k ) const { return m_image_ids[k]; }
+    std::string image_serial( size_t k ) const { return string( 4 + k ); }
+
+    std::string point_id( size_t i ) const { return string( 4 + m_num_images + i ); }
+    std::string network_id() const { return string( 0 ); }
+    std::string target_name() const { return string( 1 ); }
+    std::string description() const { return string( 2 ); }
+    std::string user_name() const { return string( 3 ); }
+
+    /// Copies measure m, point i, or the whole network out.
+    ControlMeasure control_measure( size_t m ) const;
+    ControlPoint control_point( size_t i ) const;
+    ControlNetwork control_network() const;
+
+    /// Writes the network as a .cnet2 file.
+    void write( std::string const& filename ) const;
+
+  private:
+    void attach( std::string const& name );
+    std::string string( size_t s ) const;
+
+    boost::scoped_ptr<MappedFile> m_file;
+    std::vector<uint8> m_buffer;
+    uint8 const* m_data;
+    size_t m_size;
+    size_t m_num_points, m_num_measures, m_num_images, m_num_strings;
+    ControlNetwork::ControlNetworkType m_type;
+    ControlPointRecord const* m_points;
+    ControlMeasureRecord const* m_measures;
+    uint64 const* m_image_ids;
+    uint64 const* m_string_offsets;
+    char const* m_strings;
+  };
+
+  /// Writes cnet as a .cnet2 file.
+  void write_compact_control_network( std::string const& filename, ControlNetwork const& cnet );
+
+  /// Reads all of a .cnet2 file into a ControlNetwork.
+  ControlNetwork read_compact_control_network( std::string const& filename );
+
+  /// Returns true if the named file starts as a .cnet2 file does.
+  bool is_compact_control_network( std::string const& filename );
+
+}} // namespace vw::ba
+
+#endif // __VW_BUNDLEADJUSTMENT_COMPACTCONTROLNETWORK_H__
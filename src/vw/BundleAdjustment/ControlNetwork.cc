@@ -9,8 +9,12 @@
 ///
 
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
 #include <boost/algorithm/string.hpp>
+#include <vw/Math/FlatKDTree.h>
 #include <boost/foreach.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <map>
 
 // Time Headers
 #include <boost/thread/xtime.hpp>
@@ -510,6 +514,7 @@ namespace ba {
       m_type = ControlNetwork::ImageToGround;
 
     m_control_points.push_back(point);
+    clear_indices();
   }
 
   /// Add a vector of Control Points
@@ -526,6 +531,7 @@ namespace ba {
     }
 
     m_control_points.insert(m_control_points.end(), points.begin(), points.end());
+    clear_indices();
   }
 
   // Delete control point
@@ -537,6 +543,7 @@ namespace ba {
     iter += index;
 
     m_control_points.erase(iter);
+    clear_indices();
   }
 
   // Find measure
@@ -548,6 +555,114 @@ namespace ba {
     return m_control_points.size();
   }
 
+  // Spatial indices
+  struct ControlNetwork::PointIndex {
+    boost::scoped_ptr<math::FlatKDTree<double> > tree;
+  };
+
+  // The measures of each image, sorted by the cell they fall in.  A
+  // cell's key has its column in the high word and its row in the
+  // low one, so the cells of a column are one run of the sorted list.
+  struct ControlNetwork::MeasureIndex {
+    struct Entry {
+      uint64 key;
+      uint32 point, measure;
+      bool operator<( Entry const& other ) const { return key < other.key; }
+    };
+    double cell_size;
+    std::map<size_t, std::vector<Entry> > images;
+
+    int32 cell( double x ) const { return int32( floor( x / cell_size ) ); }
+    static uint64 key( int32 col, int32 row ) {
+      return ( uint64( uint32( col ) ^ 0x80000000u ) << 32 ) | uint64( uint32( row ) ^ 0x80000000u );
+    }
+  };
+
+  void ControlNetwork::build_point_index() {
+    std::vector<double> positions( 3 * m_control_points.size() );
+    for ( size_t i = 0; i < m_control_points.size(); i++ )
+      for ( size_t d = 0; d < 3; d++ )
+        positions[3*i+d] = m_control_points[i].position()[d];
+    boost::shared_ptr<PointIndex> index( new PointIndex );
+    index->tree.reset( new math::FlatKDTree<double>( positions.empty() ? 0 : &positions[0],
+                                                     m_control_points.size(), 3 ) );
+    m_point_index = index;
+  }
+
+  void ControlNetwork::build_measure_index( double cell_size ) {
+    VW_ASSERT( cell_size > 0, ArgumentErr() << "ControlNetwork::build_measure_index: cell size must be positive." );
+    boost::shared_ptr<MeasureIndex> index( new MeasureIndex );
+    index->cell_size = cell_size;
+    for ( size_t i = 0; i < m_control_points.size(); i++ )
+      for ( size_t m = 0; m < m_control_points[i].size(); m++ ) {
+        ControlMeasure const& cm = m_control_points[i][m];
+        MeasureIndex::Entry entry;
+        entry.key = MeasureIndex::key( index->cell( cm.position()[0] ),
+                                       index->cell( cm.position()[1] ) );
+        entry.point = uint32( i );
+        entry.measure = uint32( m );
+        index->images[cm.image_id()].push_back( entry );
+      }
+    typedef std::map<size_t, std::vector<MeasureIndex::Entry> >::iterator image_iter;
+    for ( image_iter image = index->images.begin(); image != index->images.end(); image++ )
+      std::stable_sort( image->second.begin(), image->second.end() );
+    m_measure_index = index;
+  }
+
+  std::vector<size_t> ControlNetwork::points_within( Vector3 const& location, double distance ) const {
+    std::vector<size_t> points;
+    if ( m_point_index ) {
+      std::vector<int32> found;
+      m_point_index->tree->radius_search( &location[0], distance*distance, found );
+      std::sort( found.begin(), found.end() );
+      points.assign( found.begin(), found.end() );
+    } else {
+      for ( size_t i = 0; i < m_control_points.size(); i++ )
+        if ( norm_2_sqr( m_control_points[i].position() - location ) <= distance*distance )
+          points.push_back( i );
+    }
+    return points;
+  }
+
+  std::vector<std::pair<size_t,size_t> >
+  ControlNetwork::measures_within( size_t image_id, Vector2 const& pixel, double radius ) const {
+    std::vector<std::pair<size_t,size_t> > measures;
+    if ( !m_measure_index ) {
+      for ( size_t i = 0; i < m_control_points.size(); i++ )
+        for ( size_t m = 0; m < m_control_points[i].size(); m++ ) {
+          ControlMeasure const& cm = m_control_points[i][m];
+          if ( cm.image_id() == image_id &&
+               norm_2_sqr( cm.position() - pixel ) <= radius*radius )
+            measures.push_back( std::make_pair( i, m ) );
+        }
+      return measures;
+    }
+
+    MeasureIndex const& index = *m_measure_index;
+    std::map<size_t, std::vector<MeasureIndex::Entry> >::const_iterator image =
+      index.images.find( image_id );
+    if ( image == index.images.end() )
+      return measures;
+    std::vector<MeasureIndex::Entry> const& entries = image->second;
+    int32 row_begin = index.cell( pixel[1] - radius ), row_end = index.cell( pixel[1] + radius );
+    for ( int32 col = index.cell( pixel[0] - radius ); col <= index.cell( pixel[0] + radius ); col++ ) {
+      MeasureIndex::Entry low, high;
+      low.key = MeasureIndex::key( col, row_begin );
+      high.key = MeasureIndex::key( col, row_end );
+      std::vector<MeasureIndex::Entry>::const_iterator it =
+        std::lower_bound( entries.begin(), entries.end(), low );
+      std::vector<MeasureIndex::Entry>::const_iterator end =
+        std::upper_bound( it, entries.end(), high );
+      for ( ; it != end; it++ ) {
+        ControlMeasure const& cm = m_control_points[it->point][it->measure];
+        if ( norm_2_sqr( cm.position() - pixel ) <= radius*radius )
+          measures.push_back( std::make_pair( size_t(it->point), size_t(it->measure) ) );
+      }
+    }
+    std::sort( measures.begin(), measures.end() );
+    return measures;
+  }
+
   /// Write a compressed binary style control network
   void ControlNetwork::write_binary( std::string filename ) const {
 
@@ -579,6 +694,11 @@ namespace ba {
   /// Reading a compressed binary style control network
   void ControlNetwork::read_binary( std::string const& filename ) {
 
+    if ( is_compact_control_network( filename ) ) {
+      *this = read_compact_control_network( filename );
+      return;
+    }
+
     // Opening file
     std::ifstream f( filename.c_str() );
     if ( !f.is_open() )
@@ -599,6 +719,7 @@ namespace ba {
 
     // Clearing anything left in this control network
     m_control_points.clear();
+    clear_indices();
     m_control_points.reserve( size );
 
     // Reading in all the control points
@@ -670,6 +791,7 @@ namespace ba {
 
     // Clearing anything left in this control network
     m_control_points.clear();
+    clear_indices();
 
     // Reading file
     std::vector<std::string> tokens;
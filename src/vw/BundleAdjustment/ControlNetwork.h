@@ -22,6 +22,7 @@
 
 // Boost
 #include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace vw {
 namespace ba {
@@ -117,7 +118,7 @@ namespace ba {
         m_focalplane_x = location[0]; m_focalplane_y = location[1];
       }
     }
-    bool is_pixels_dominant() { return m_pixels_dominant; }
+    bool is_pixels_dominant() const { return m_pixels_dominant; }
     void set_pixels_dominant( bool state ) { m_pixels_dominant = state; }
 
     /// Setting/Reading the pixel error for this point.
@@ -303,6 +304,14 @@ namespace ba {
     std::string m_description;        // Text description of network
     std::string m_userName;           // The user who created the network
 
+    // Spatial indices of the points and measures, when built.  They're
+    // never changed once built, so copies of a network share them.
+    struct PointIndex;
+    struct MeasureIndex;
+    boost::shared_ptr<const PointIndex> m_point_index;
+    boost::shared_ptr<const MeasureIndex> m_measure_index;
+    void clear_indices() { m_point_index.reset(); m_measure_index.reset(); }
+
   public:
 
     /// Iterators
@@ -340,6 +349,12 @@ namespace ba {
     ControlNetworkType type() const { return m_type; }
     void set_type( ControlNetworkType type ) { m_type = type; }
 
+    /// Reading the descriptive strings given at construction
+    std::string network_id() const { return m_networkId; }
+    std::string target_name() const { return m_targetName; }
+    std::string description() const { return m_description; }
+    std::string user_name() const { return m_userName; }
+
     /// Returns the number of control measures associated with this
     /// control point.
     size_t size() const { return m_control_points.size(); }
@@ -384,8 +399,8 @@ namespace ba {
     const ControlPoint& operator[] (size_t index) const { return m_control_points[index]; }
 
     /// Vector capacity interface
-    void clear() { m_control_points.clear(); }
-    void resize(size_t sz) { m_control_points.resize(sz); }
+    void clear() { m_control_points.clear(); clear_indices(); }
+    void resize(size_t sz) { m_control_points.resize(sz); clear_indices(); }
     size_t capacity() const { return m_control_points.capacity(); }
     bool empty() const { return m_control_points.empty(); }
     void reserve(size_t sz) { m_control_points.reserve(sz); }
@@ -395,7 +410,31 @@ namespace ba {
     /// found.
     size_t find_measure(ControlMeasure const& query);
 
-    /// File I/O
+    /// Optional spatial indices for the queries below.
+    /// build_point_index() puts the positions of the control points
+    /// in a kd-tree, and build_measure_index() the measures of each
+    /// image in a grid of cell_size pixel cells.  Adding, deleting
+    /// and reading points drops them, but changes made through
+    /// operator[] don't, so build them again after those.
+    void build_point_index();
+    void build_measure_index( double cell_size = 32 );
+    bool has_point_index() const { return bool(m_point_index); }
+    bool has_measure_index() const { return bool(m_measure_index); }
+
+    /// The indices of the control points whose positions are within
+    /// distance of location.  Without a point index, this checks
+    /// every point.
+    std::vector<size_t> points_within( Vector3 const& location, double distance ) const;
+
+    /// The measures of image image_id whose positions are within
+    /// radius pixels of pixel, as pairs of the index of the control
+    /// point and the index of the measure in it.  Without a measure
+    /// index, this checks every measure.
+    std::vector<std::pair<size_t,size_t> >
+    measures_within( size_t image_id, Vector2 const& pixel, double radius ) const;
+
+    /// File I/O.  read_binary() also reads the .cnet2 files of
+    /// CompactControlNetwork.h.
     void read_binary( std::string const& filename );
     void read_isis( std::string const& filename );
     void write_binary( std::string filename ) const;
@@ -6,6 +6,8 @@
 
 
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Stereo/StereoModel.h>
 
 using namespace vw;
@@ -15,23 +17,179 @@ using namespace vw::ba;
 
 namespace fs = boost::filesystem;
 
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
-
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
-};
-
 // Utility for checking that the point is BA safe
 void safe_measurement( ip::InterestPoint& ip ) {
   if ( ip.scale <= 0 ) ip.scale = 10;
 }
 
+namespace {
+
+  typedef boost::shared_ptr< ba::IPFeature > f_ptr;
+
+  // The matches between two images, as read from one match file.
+  struct MatchFile {
+    std::string filename;
+    size_t image1, image2;
+    std::vector<ip::InterestPoint> ip1, ip2;
+    std::vector<f_ptr> features1, features2;
+    bool accepted;
+    MatchFile( std::string const& filename, size_t image1, size_t image2 )
+      : filename(filename), image1(image1), image2(image2), accepted(false) {}
+  };
+
+  struct LoadMatchFileTask {
+    typedef void result_type;
+    MatchFile& match;
+    LoadMatchFileTask( MatchFile& match ) : match(match) {}
+    void operator()() const {
+      ip::read_binary_match_file( match.filename, match.ip1, match.ip2 );
+
+      // Remove descriptors from interest points and correct scale
+      std::for_each( match.ip1.begin(), match.ip1.end(), ip::remove_descriptor );
+      std::for_each( match.ip2.begin(), match.ip2.end(), ip::remove_descriptor );
+      std::for_each( match.ip1.begin(), match.ip1.end(), safe_measurement );
+      std::for_each( match.ip2.begin(), match.ip2.end(), safe_measurement );
+    }
+  };
+
+  // Finds or creates the features of one camera for every match
+  // that involves it.  New features go on the front of the camera's
+  // list in the order they are first seen, and two interest points
+  // at the same location are the same feature.
+  struct CameraFeaturesTask {
+    typedef void result_type;
+    ba::CameraNode<ba::IPFeature>& node;
+    std::vector<MatchFile>& matches;
+    std::vector<size_t> const& camera_matches;
+    CameraFeaturesTask( ba::CameraNode<ba::IPFeature>& node, std::vector<MatchFile>& matches,
+                        std::vector<size_t> const& camera_matches )
+      : node(node), matches(matches), camera_matches(camera_matches) {}
+
+    f_ptr feature( std::map<std::pair<float,float>, f_ptr>& lookup, ip::InterestPoint const& ip ) const {
+      f_ptr& result = lookup[ std::make_pair( ip.x, ip.y ) ];
+      if ( !result ) {
+        result.reset( new ba::IPFeature( ip, node.id ) );
+        node.relations.push_front( result );
+      }
+      return result;
+    }
+
+    void operator()() const {
+      std::map<std::pair<float,float>, f_ptr> lookup;
+      BOOST_FOREACH( f_ptr const& f, node.relations )
+        lookup[ std::make_pair( f->m_ip.x, f->m_ip.y ) ] = f;
+      BOOST_FOREACH( size_t m, camera_matches ) {
+        MatchFile& match = matches[m];
+        if ( match.image1 == node.id )
+          match.features1.resize( match.ip1.size() );
+        if ( match.image2 == node.id )
+          match.features2.resize( match.ip2.size() );
+        for ( size_t k = 0; k < match.ip1.size(); k++ ) {
+          if ( match.image1 == node.id )
+            match.features1[k] = feature( lookup, match.ip1[k] );
+          if ( match.image2 == node.id )
+            match.features2[k] = feature( lookup, match.ip2[k] );
+        }
+      }
+    }
+  };
+
+  // Runs the tasks on the thread pool, or in order if there's only
+  // one thread.
+  template <class TaskT>
+  void run_tasks( std::vector<TaskT> const& tasks ) {
+    uint32 num_threads = vw_settings().default_num_threads();
+    if ( num_threads < 2 || tasks.size() < 2 ) {
+      BOOST_FOREACH( TaskT const& task, tasks )
+        task();
+      return;
+    }
+    FifoWorkQueue queue( num_threads );
+    std::vector<Future<void> > futures;
+    BOOST_FOREACH( TaskT const& task, tasks )
+      futures.push_back( queue.submit( task ) );
+    when_all( futures );
+  }
+
+  // We can't guarantee that image_files is sorted, so we make a
+  // std::map to give ourselves a sorted list and access to a binary
+  // search.
+  std::map<std::string,size_t> image_prefix_map( std::vector<std::string> const& image_files ) {
+    std::map<std::string,size_t> prefixes;
+    for ( size_t i = 0; i < image_files.size(); i++ ) {
+      fs::path file_path(image_files[i]);
+      prefixes[file_path.replace_extension().string()] = i;
+    }
+    return prefixes;
+  }
+
+  // Appends the match file to matches if it's named after two of the
+  // images, as prefix1__prefix2.match.
+  void add_match_file( std::vector<MatchFile>& matches, fs::path const& path,
+                       std::map<std::string,size_t> const& image_prefixes ) {
+    // Pull out the prefixes that made up that match file
+    std::string match_base = path.stem();
+    size_t split_pt = match_base.find("__");
+    if ( split_pt == std::string::npos ) return;
+    std::string prefix1 = match_base.substr(0,split_pt);
+    std::string prefix2 = match_base.substr(split_pt+2,match_base.size()-split_pt-2);
+
+    // Extract the image indices that correspond to image prefixes.
+    typedef std::map<std::string,size_t>::const_iterator MapIterator;
+    MapIterator it1 = image_prefixes.find( prefix1 );
+    MapIterator it2 = image_prefixes.find( prefix2 );
+    if ( it1 == image_prefixes.end() ||
+         it2 == image_prefixes.end() ) return;
+    matches.push_back( MatchFile( path.string(), it1->second, it2->second ) );
+  }
+
+  // Reads the match files on the thread pool, and rejects those with
+  // fewer than min_matches matches.
+  void load_match_files( std::vector<MatchFile>& matches, size_t min_matches ) {
+    std::vector<LoadMatchFileTask> tasks;
+    BOOST_FOREACH( MatchFile& match, matches )
+      tasks.push_back( LoadMatchFileTask( match ) );
+    run_tasks( tasks );
+
+    size_t num_load_rejected = 0, num_loaded = 0;
+    BOOST_FOREACH( MatchFile& match, matches ) {
+      match.accepted = match.ip1.size() >= min_matches;
+      vw_out(VerboseDebugMessage,"ba") << "\t" << match.filename << "    "
+                                       << match.image1 << " <-> " << match.image2 << " : "
+                                       << match.ip1.size() << " matches."
+                                       << ( match.accepted ? "\n" : " [rejected]\n" );
+      if ( match.accepted ) {
+        num_loaded += match.ip1.size();
+      } else {
+        num_load_rejected += match.ip1.size();
+        match.ip1.clear();
+        match.ip2.clear();
+      }
+    }
+    if ( num_load_rejected != 0 ) {
+      vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
+                                  << " matches due to inadequacy.\n";
+      vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
+    }
+  }
+
+  void triangulate_control_points( ba::ControlNetwork& cnet, std::vector<size_t> const& points,
+                                   std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models ) {
+    if ( points.empty() )
+      return;
+    TerminalProgressCallback progress("ba", "Triangulating:");
+    progress.report_progress(0);
+    double inc_prog = 1.0/double(points.size());
+    double min_angle = 5.0*M_PI/180.0;
+    BOOST_FOREACH( size_t i, points ) {
+      progress.report_incremental_progress(inc_prog );
+      ba::triangulate_control_point( cnet[i], camera_models, min_angle );
+    }
+    progress.report_finished();
+  }
+
+} // anonymous namespace
+
 void vw::ba::triangulate_control_point( ControlPoint& cp,
                                         std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
                                         double const& minimum_angle ) {
@@ -89,22 +247,13 @@ void vw::ba::build_control_network( ba::ControlNetwork& cnet,
                                      std::vector<std::string> const& directories ) {
   cnet.clear();
 
-  // We can't guarantee that image_files is sorted, so we make a
-  // std::map to give ourselves a sorted list and access to a binary
-  // search.
-  std::map<std::string,size_t> image_prefix_map;
-  size_t count = 0;
+  std::map<std::string,size_t> image_prefixes = image_prefix_map( image_files );
   ba::CameraRelationNetwork<ba::IPFeature> crn;
-  BOOST_FOREACH( std::string const& file, image_files ) {
-    fs::path file_path(file);
-    image_prefix_map[file_path.replace_extension().string()] = count;
-    crn.add_node( ba::CameraNode<ba::IPFeature>( count,
-                                                 file_path.stem() ) );
-    count++;
-  }
+  for ( size_t i = 0; i < image_files.size(); i++ )
+    crn.add_node( ba::CameraNode<ba::IPFeature>( i, fs::path(image_files[i]).stem() ) );
 
   // Searching through the directories available to us.
-  size_t num_load_rejected = 0, num_loaded = 0;
+  std::vector<MatchFile> matches;
   BOOST_FOREACH( std::string const& directory, directories ) {
     vw_out(VerboseDebugMessage,"ba") << "\tOpening directory \""
                                      << directory << "\".\n";
@@ -116,87 +265,159 @@ void vw::ba::build_control_network( ba::ControlNetwork& cnet,
       // Skip if not a match file
       if ( obj->path().extension() != ".match" ) continue;
 
-      // Pull out the prefixes that made up that match file
-      std::string match_base = obj->path().stem();
-      size_t split_pt = match_base.find("__");
-      if ( split_pt == std::string::npos ) continue;
-      std::string prefix1 = match_base.substr(0,split_pt);
-      std::string prefix2 = match_base.substr(split_pt+2,match_base.size()-split_pt-2);
-
-      // Extract the image indices that correspond to image prefixes.
-      typedef std::map<std::string,size_t>::iterator MapIterator;
-      MapIterator it1 = image_prefix_map.find( prefix1 );
-      MapIterator it2 = image_prefix_map.find( prefix2 );
-      if ( it1 == image_prefix_map.end() ||
-           it2 == image_prefix_map.end() ) continue;
-
-      // Actually read in the file as it seems we've found something correct
-      std::vector<ip::InterestPoint> ip1, ip2;
-      ip::read_binary_match_file( obj->string(), ip1, ip2 );
-      if ( ip1.size() < min_matches ) {
-        vw_out(VerboseDebugMessage,"ba") << "\t" << obj->string() << "    "
-                                         << it1->second << " <-> " << it2->second << " : "
-                                         << ip1.size() << " matches. [rejected]\n";
-        num_load_rejected += ip1.size();
-      } else {
-        vw_out(VerboseDebugMessage,"ba") << "\t" << obj->string() << "    "
-                                         << it1->second << " <-> " << it2->second << " : "
-                                         << ip1.size() << " matches.\n";
-        num_loaded += ip1.size();
-
-        // Remove descriptors from interest points and correct scale
-        std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-        std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-        std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-        std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-        typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-        typedef std::list< f_ptr >::iterator f_itr;
-
-        // Checking to see if features already exist, adding if they
-        // don't, then linking them.
-        for ( size_t k = 0; k < ip1.size(); k++ ) {
-          f_itr ipfeature1 = std::find_if( crn[it1->second].begin(),
-                                           crn[it1->second].end(),
-                                           ContainsEqualIP( ip1[k] ) );
-          f_itr ipfeature2 = std::find_if( crn[it2->second].begin(),
-                                           crn[it2->second].end(),
-                                           ContainsEqualIP( ip2[k] ) );
-          if ( ipfeature1 == crn[it1->second].end() ) {
-            crn[it1->second].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], it1->second ) ) );
-            ipfeature1 = crn[it1->second].begin();
-          }
-          if ( ipfeature2 == crn[it2->second].end() ) {
-            crn[it2->second].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], it2->second ) ) );
-            ipfeature2 = crn[it2->second].begin();
-          }
-
-          // Doubly linking
-          (*ipfeature1)->connection( *ipfeature2, false );
-          (*ipfeature2)->connection( *ipfeature1, false );
-        }
-      }
+      add_match_file( matches, obj->path(), image_prefixes );
     }
   } // end search through directories
-  if ( num_load_rejected != 0 ) {
-    vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
-                                << " matches due to inadequacy.\n";
-    vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
+  load_match_files( matches, min_matches );
+
+  // Finding the features of each camera, then linking them. The
+  // cameras share nothing until they're linked.
+  {
+    std::vector<std::vector<size_t> > camera_matches( crn.size() );
+    for ( size_t m = 0; m < matches.size(); m++ )
+      if ( matches[m].accepted ) {
+        camera_matches[matches[m].image1].push_back( m );
+        if ( matches[m].image2 != matches[m].image1 )
+          camera_matches[matches[m].image2].push_back( m );
+      }
+    std::vector<CameraFeaturesTask> tasks;
+    for ( size_t j = 0; j < crn.size(); j++ )
+      tasks.push_back( CameraFeaturesTask( crn[j], matches, camera_matches[j] ) );
+    run_tasks( tasks );
+  }
+  BOOST_FOREACH( MatchFile& match, matches ) {
+    // Doubly linking
+    for ( size_t k = 0; k < match.ip1.size(); k++ ) {
+      match.features1[k]->connection( match.features2[k], false );
+      match.features2[k]->connection( match.features1[k], false );
+    }
+    match.ip1.clear(); match.ip2.clear();
+    match.features1.clear(); match.features2.clear();
   }
 
   // Building control network
   crn.write_controlnetwork( cnet );
 
   // Triangulating Positions
-  {
-    TerminalProgressCallback progress("ba", "Triangulating:");
-    progress.report_progress(0);
-    double inc_prog = 1.0/double(cnet.size());
-    double min_angle = 5.0*M_PI/180.0;
-    BOOST_FOREACH( ba::ControlPoint& cpoint, cnet ) {
-      progress.report_incremental_progress(inc_prog );
-      ba::triangulate_control_point( cpoint, camera_models, min_angle );
+  std::vector<size_t> points( cnet.size() );
+  for ( size_t i = 0; i < points.size(); i++ )
+    points[i] = i;
+  triangulate_control_points( cnet, points, camera_models );
+}
+
+void vw::ba::add_matches_to_control_network( ba::ControlNetwork& cnet,
+                                             std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
+                                             std::vector<std::string> const& image_files,
+                                             std::vector<std::string> const& match_files,
+                                             size_t min_matches ) {
+  std::map<std::string,size_t> image_prefixes = image_prefix_map( image_files );
+  std::vector<MatchFile> matches;
+  BOOST_FOREACH( std::string const& file, match_files )
+    add_match_file( matches, fs::path( file ), image_prefixes );
+  load_match_files( matches, min_matches );
+
+  // Where each measure already is, by image and location.
+  typedef std::pair<uint64, std::pair<float,float> > MeasureKey;
+  typedef std::map<MeasureKey, size_t> MeasureLookup;
+  MeasureLookup measure_lookup;
+  for ( size_t i = 0; i < cnet.size(); i++ )
+    BOOST_FOREACH( ba::ControlMeasure const& cm, cnet[i] )
+      measure_lookup[ MeasureKey( cm.image_id(), std::make_pair( float(cm.position()[0]),
+                                                                 float(cm.position()[1]) ) ) ] = i;
+
+  std::vector<bool> changed( cnet.size(), false ), removed( cnet.size(), false );
+  size_t num_conflicts = 0;
+  BOOST_FOREACH( MatchFile const& match, matches ) {
+    for ( size_t k = 0; k < match.ip1.size(); k++ ) {
+      ip::InterestPoint const& ip1 = match.ip1[k];
+      ip::InterestPoint const& ip2 = match.ip2[k];
+      MeasureKey key1( match.image1, std::make_pair( ip1.x, ip1.y ) );
+      MeasureKey key2( match.image2, std::make_pair( ip2.x, ip2.y ) );
+      MeasureLookup::iterator it1 = measure_lookup.find( key1 );
+      MeasureLookup::iterator it2 = measure_lookup.find( key2 );
+      ba::ControlMeasure cm1( ip1.x, ip1.y, ip1.scale, ip1.scale, match.image1 );
+      ba::ControlMeasure cm2( ip2.x, ip2.y, ip2.scale, ip2.scale, match.image2 );
+
+      if ( it1 == measure_lookup.end() && it2 == measure_lookup.end() ) {
+        // A new tie point
+        if ( match.image1 == match.image2 ) {
+          num_conflicts++;
+          continue;
+        }
+        ba::ControlPoint cpoint( ba::ControlPoint::TiePoint );
+        cpoint.add_measure( cm1 );
+        cpoint.add_measure( cm2 );
+        measure_lookup[key1] = measure_lookup[key2] = cnet.size();
+        cnet.add_control_point( cpoint );
+        changed.push_back( true );
+        removed.push_back( false );
+        continue;
+      }
+
+      if ( it1 != measure_lookup.end() && it2 != measure_lookup.end() ) {
+        if ( it1->second == it2->second )
+          continue;
+
+        // Merging two points, into the ground control point if
+        // there's one.
+        size_t into = it1->second, from = it2->second;
+        if ( cnet[from].type() == ba::ControlPoint::GroundControlPoint )
+          std::swap( into, from );
+        bool conflict = cnet[into].type() == ba::ControlPoint::GroundControlPoint &&
+          cnet[from].type() == ba::ControlPoint::GroundControlPoint;
+        BOOST_FOREACH( ba::ControlMeasure const& cm, cnet[from] )
+          BOOST_FOREACH( ba::ControlMeasure const& other, cnet[into] )
+            if ( cm.image_id() == other.image_id() )
+              conflict = true;
+        if ( conflict ) {
+          num_conflicts++;
+          continue;
+        }
+        BOOST_FOREACH( ba::ControlMeasure const& cm, cnet[from] ) {
+          measure_lookup[ MeasureKey( cm.image_id(), std::make_pair( float(cm.position()[0]),
+                                                                     float(cm.position()[1]) ) ) ] = into;
+          cnet[into].add_measure( cm );
+        }
+        cnet[from].clear();
+        removed[from] = true;
+        changed[into] = true;
+        continue;
+      }
+
+      // One of the measures is new, and joins the other's point
+      // unless that already sees its image.
+      size_t point = it1 != measure_lookup.end() ? it1->second : it2->second;
+      ba::ControlMeasure const& cm = it1 != measure_lookup.end() ? cm2 : cm1;
+      bool conflict = false;
+      BOOST_FOREACH( ba::ControlMeasure const& other, cnet[point] )
+        if ( other.image_id() == cm.image_id() )
+          conflict = true;
+      if ( conflict ) {
+        num_conflicts++;
+        continue;
+      }
+      measure_lookup[ it1 != measure_lookup.end() ? key2 : key1 ] = point;
+      cnet[point].add_measure( cm );
+      changed[point] = true;
     }
-    progress.report_finished();
   }
+  if ( num_conflicts != 0 )
+    vw_out(WarningMessage,"ba") << "\t" << num_conflicts
+                                << " matches not added as they would see an image twice.\n";
+
+  // Dropping merged points, and then triangulating the tie points
+  // that changed.
+  std::vector<size_t> points;
+  size_t kept = 0;
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    if ( removed[i] )
+      continue;
+    if ( kept != i )
+      cnet[kept] = cnet[i];
+    if ( changed[i] && cnet[kept].type() == ba::ControlPoint::TiePoint )
+      points.push_back( kept );
+    kept++;
+  }
+  cnet.resize( kept );
+  triangulate_control_points( cnet, points, camera_models );
 }
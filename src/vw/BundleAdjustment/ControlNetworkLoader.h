@@ -22,13 +22,27 @@ namespace ba {
   // Builds a control network using given camera models and original
   // image names. This function uses Boost::FS to then find match files
   // that would have been created by 'ipmatch' by searching the entire
-  // permutation of the image_files vector.
+  // permutation of the image_files vector. The match files are read,
+  // and the interest points of each image merged, on the thread pool.
   void build_control_network( ControlNetwork& cnet,
                                std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
                                std::vector<std::string> const& image_files,
                                size_t min_matches = 30,
                               std::vector<std::string> const& directories = std::vector<std::string>(1,".") );
 
+  // Adds the matches of the named match files to a network built
+  // from the same image_files, perhaps with images appended since.
+  // A match extends the points that already hold either of its
+  // measures, merging two points if it joins them, or else starts a
+  // new tie point. Matches that would put two measures of one image
+  // in a point are dropped. Only the tie points that change are
+  // triangulated again.
+  void add_matches_to_control_network( ControlNetwork& cnet,
+                                       std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
+                                       std::vector<std::string> const& image_files,
+                                       std::vector<std::string> const& match_files,
+                                       size_t min_matches = 30 );
+
   void triangulate_control_point( ControlPoint& cp,
                                   std::vector<boost::shared_ptr<camera::CameraModel> > const& camera_models,
                                   double const& minimum_angle );
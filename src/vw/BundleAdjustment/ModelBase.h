@@ -50,6 +50,22 @@ namespace ba {
       return impl()(i,j,a_j,b_i);
     }
 
+    // Models that can differentiate h() in closed form override
+    // these to fill in J and return true. Otherwise A_jacobian() and
+    // B_jacobian() fall back to forward differences.
+    inline bool A_jacobian_analytic ( size_t /*i*/, size_t /*j*/,
+                                      Vector<double, CameraParamsN> const& /*a_j*/,
+                                      Vector<double, PointParamsN> const& /*b_i*/,
+                                      Matrix<double, 2, CameraParamsN>& /*J*/ ) {
+      return false;
+    }
+    inline bool B_jacobian_analytic ( size_t /*i*/, size_t /*j*/,
+                                      Vector<double, CameraParamsN> const& /*a_j*/,
+                                      Vector<double, PointParamsN> const& /*b_i*/,
+                                      Matrix<double, 2, PointParamsN>& /*J*/ ) {
+      return false;
+    }
+
     // Approximate the jacobian for small variations in the a_j
     // parameters (camera parameters).
     inline Matrix<double, 2, CameraParamsN> A_jacobian ( size_t i, size_t j,
@@ -59,6 +75,13 @@ namespace ba {
       // Jacobian is #outputs x #params
       Matrix<double, 2, CameraParamsN> J;
 
+      try {
+        if ( impl().A_jacobian_analytic(i,j,a_j,b_i,J) )
+          return J;
+      } catch (const camera::PixelToRayErr& e) {
+        return Matrix<double, 2, CameraParamsN>();
+      }
+
       Vector2 h0;
       try {
         // Get nominal function value
@@ -99,6 +122,13 @@ namespace ba {
       // Jacobian is #outputs x #params
       Matrix<double, 2, PointParamsN> J;
 
+      try {
+        if ( impl().B_jacobian_analytic(i,j,a_j,b_i,J) )
+          return J;
+      } catch (const camera::PixelToRayErr& e) {
+        return Matrix<double, 2, PointParamsN>();
+      }
+
       Vector2 h0;
       try {
         // Get nominal function value
@@ -0,0 +1,122 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ReducedCameraSystem.h
+///
+/// Iterative solution of the reduced camera system S*delta_a = e of
+/// sparse bundle adjustment, where S = U - W*inverse(V)*W^T.  S is
+/// never formed.  Its products are taken from the W and Y = W*inverse(V)
+/// blocks already stored in each JFeature, so the memory used grows
+/// with the number of measures rather than with the fill of S.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_REDUCEDCAMERASYSTEM_H__
+#define __VW_BUNDLEADJUSTMENT_REDUCEDCAMERASYSTEM_H__
+
+#include <vector>
+
+#include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/PreconditionedConjugateGradient.h>
+#include <vw/BundleAdjustment/CameraRelation.h>
+
+namespace vw {
+namespace ba {
+
+  /// Preconditioners for the reduced camera system.  Block Jacobi
+  /// inverts the U blocks; Schur Jacobi inverts the diagonal blocks of
+  /// S itself, which costs one more pass over the measures and usually
+  /// saves many iterations.
+  enum ReducedCameraPreconditioner {
+    BLOCK_JACOBI_PRECONDITIONER,
+    SCHUR_JACOBI_PRECONDITIONER
+  };
+
+  /// Multiplies by S.  The network's features must hold W in m_w and
+  /// Y in m_y, as the sparse bundle adjusters leave them.
+  template <size_t CameraParamsN, size_t PointParamsN>
+  class ReducedCameraOperator {
+    typedef Matrix<double, CameraParamsN, CameraParamsN> matrix_camera_camera;
+    typedef CameraNode<JFeature>::const_iterator crn_iter;
+
+    CameraRelationNetwork<JFeature> const& m_crn;
+    std::vector<matrix_camera_camera> const& m_U;
+    mutable std::vector<Vector<double, PointParamsN> > m_t;
+
+  public:
+    ReducedCameraOperator( CameraRelationNetwork<JFeature> const& crn,
+                           std::vector<matrix_camera_camera> const& U, size_t num_points )
+      : m_crn(crn), m_U(U), m_t(num_points) {}
+
+    void operator()( Vector<double> const& x, Vector<double>& y ) const {
+      // t_i = sum over the cameras k that see point i of W_ik^T*x_k.
+      for ( size_t i = 0; i < m_t.size(); i++ )
+        m_t[i] = Vector<double, PointParamsN>();
+      size_t j = 0;
+      for ( CameraRelationNetwork<JFeature>::const_iterator camera = m_crn.begin();
+            camera != m_crn.end(); ++camera, ++j )
+        for ( crn_iter fiter = camera->begin(); fiter != camera->end(); ++fiter )
+          m_t[(**fiter).m_point_id] += transpose( (**fiter).m_w ) *
+            subvector( x, j*CameraParamsN, CameraParamsN );
+
+      // y_j = U_j*x_j - sum over the points i camera j sees of Y_ij*t_i.
+      j = 0;
+      for ( CameraRelationNetwork<JFeature>::const_iterator camera = m_crn.begin();
+            camera != m_crn.end(); ++camera, ++j ) {
+        Vector<double, CameraParamsN> y_j = m_U[j] * subvector( x, j*CameraParamsN, CameraParamsN );
+        for ( crn_iter fiter = camera->begin(); fiter != camera->end(); ++fiter )
+          y_j -= (**fiter).m_y * m_t[(**fiter).m_point_id];
+        subvector( y, j*CameraParamsN, CameraParamsN ) = y_j;
+      }
+    }
+  };
+
+  template <size_t CameraParamsN>
+  math::BlockJacobiPreconditioner
+  reduced_camera_preconditioner( CameraRelationNetwork<JFeature> const& crn,
+                                 std::vector<Matrix<double, CameraParamsN, CameraParamsN> > const& U,
+                                 ReducedCameraPreconditioner type ) {
+    math::BlockJacobiPreconditioner M( U.size(), CameraParamsN );
+    size_t j = 0;
+    for ( CameraRelationNetwork<JFeature>::const_iterator camera = crn.begin();
+          camera != crn.end(); ++camera, ++j ) {
+      Matrix<double, CameraParamsN, CameraParamsN> S_jj = U[j];
+      if ( type == SCHUR_JACOBI_PRECONDITIONER )
+        for ( CameraNode<JFeature>::const_iterator fiter = camera->begin();
+              fiter != camera->end(); ++fiter )
+          S_jj -= (**fiter).m_y * transpose( (**fiter).m_w );
+      M.set_block( j, S_jj );
+    }
+    return M;
+  }
+
+  /// Solves S*delta_a = e by preconditioned conjugate gradients,
+  /// from delta_a = 0.  A max_iterations of zero allows as many
+  /// iterations as there are unknowns.
+  template <size_t CameraParamsN, size_t PointParamsN>
+  Vector<double>
+  solve_reduced_camera_system( CameraRelationNetwork<JFeature> const& crn,
+                               std::vector<Matrix<double, CameraParamsN, CameraParamsN> > const& U,
+                               size_t num_points, Vector<double> const& e,
+                               ReducedCameraPreconditioner preconditioner,
+                               double tolerance, size_t max_iterations ) {
+    ReducedCameraOperator<CameraParamsN, PointParamsN> S( crn, U, num_points );
+    math::BlockJacobiPreconditioner M = reduced_camera_preconditioner<CameraParamsN>( crn, U, preconditioner );
+    Vector<double> delta_a( e.size() );
+    math::ConjugateGradientResult result =
+      math::preconditioned_conjugate_gradient( S, M, e, delta_a, tolerance, max_iterations );
+    vw_out(DebugMessage, "ba") << "Conjugate gradient took " << result.iterations
+                               << " iterations to a relative residual of " << result.residual << ".\n";
+    if ( !result.converged )
+      vw_out(WarningMessage, "ba") << "Conjugate gradient stopped at a relative residual of "
+                                   << result.residual << " after " << result.iterations << " iterations.\n";
+    return delta_a;
+  }
+
+}} // namespace vw::ba
+
+#endif // __VW_BUNDLEADJUSTMENT_REDUCEDCAMERASYSTEM_H__
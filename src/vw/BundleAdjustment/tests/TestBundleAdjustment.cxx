@@ -306,6 +306,93 @@ TEST_F( ComparisonTest, Ref_VS_Sparse ) {
                         1e-3 );
 }
 
+TEST_F( ComparisonTest, Sparse_VS_ParallelSparse ) {
+  std::vector<Vector<double> > serial_solution;
+  std::vector<Vector<double> > parallel_solution;
+  uint32 num_threads = vw_settings().default_num_threads();
+
+  for ( uint32 parallel = 0; parallel < 2; parallel++ ) {
+    vw_settings().set_default_num_threads( parallel ? 4 : 1 );
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    adjuster.set_parallel_assembly( parallel );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    // Storing result
+    for ( uint32 i = 0; i < 5; i++ )
+      ( parallel ? parallel_solution : serial_solution ).push_back( model.A_parameters(i) );
+  }
+  vw_settings().set_default_num_threads( num_threads );
+
+  // The sums are taken in the same order, so the answers are the same.
+  for ( uint32 i = 0; i < 5; i++ )
+    for ( uint32 j = 0; j < 6; j++ )
+      EXPECT_EQ( serial_solution[i][j], parallel_solution[i][j] );
+}
+
+TEST_F( ComparisonTest, SparseWindow ) {
+  std::vector<Vector<double> > full_solution, window_solution;
+
+  for ( uint32 windowed = 0; windowed < 2; windowed++ ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    // A window over every camera holds nothing fixed.
+    if ( windowed )
+      adjuster.set_window( std::vector<size_t>( 1, 0 ), 5 );
+    EXPECT_EQ( 0u, adjuster.num_fixed_cameras() );
+
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    for ( uint32 i = 0; i < 5; i++ )
+      ( windowed ? window_solution : full_solution ).push_back( model.A_parameters(i) );
+  }
+  for ( uint32 i = 0; i < 5; i++ )
+    for ( uint32 j = 0; j < 6; j++ )
+      EXPECT_EQ( full_solution[i][j], window_solution[i][j] );
+}
+
+TEST_F( ComparisonTest, FixedCameras ) {
+  // Every pair of cameras shares a point, so a window of no hops
+  // around camera 0 frees only camera 0.
+  {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), true, false);
+    adjuster.set_window( std::vector<size_t>( 1, 0 ), 0 );
+    ASSERT_EQ( 4u, adjuster.num_fixed_cameras() );
+
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 5; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    EXPECT_GT( norm_2( model.A_parameters(0) ), 1e-3 );
+    for ( uint32 j = 1; j < 5; j++ )
+      EXPECT_VECTOR_DOUBLE_EQ( Vector<double>(6), model.A_parameters(j) );
+    for ( uint32 i = 0; i < cnet->size(); i++ )
+      if ( adjuster.fixed_point( i ) )
+        EXPECT_VECTOR_DOUBLE_EQ( (*cnet)[i].position(), model.B_parameters(i) );
+  }
+
+  {
+    TestBAModel model( cameras, cnet );
+    AdjustRobustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), true, false);
+    std::vector<bool> fixed( 5, true );
+    fixed[2] = false;
+    adjuster.set_fixed_cameras( fixed );
+
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 5; i++ )
+      adjuster.update(abs_tol,rel_tol);
+    EXPECT_GT( norm_2( model.A_parameters(2) ), 1e-3 );
+    for ( uint32 j = 0; j < 5; j++ )
+      if ( j != 2 )
+        EXPECT_VECTOR_DOUBLE_EQ( Vector<double>(6), model.A_parameters(j) );
+  }
+}
+
 // For whatever reason .. RobustRef and RobustSparse diverge
 // quickly. This is probably do to unwise application of floats or
 // arithmetic ordering.
@@ -349,3 +436,68 @@ TEST_F( ComparisonTest, RobustRef_VS_RobustSparse ) {
                         spr_solution[i],
                         1e-2 );
 }
+
+// The pixel errors an adjuster keeps should be those at its current
+// parameters, whether or not its last step was taken.
+template <class AdjusterT>
+void check_pixel_errors( TestBAModel& model, AdjusterT& adjuster ) {
+  EXPECT_FALSE( adjuster.pixel_errors_valid() );
+  double abs_tol = 1e10, rel_tol = 1e10;
+  for ( uint32 n = 0; n < 3; n++ ) {
+    adjuster.update(abs_tol,rel_tol);
+    ASSERT_TRUE( adjuster.pixel_errors_valid() );
+
+    std::vector<double> kept, expected;
+    std::vector<double> const& error = adjuster.pixel_errors();
+    for ( size_t k = 0; k < error.size(); k += 2 )
+      kept.push_back( norm_2( Vector2( error[k], error[k+1] ) ) );
+    for ( size_t i = 0; i < model.num_points(); i++ )
+      BOOST_FOREACH( ControlMeasure const& cm, (*model.control_network())[i] )
+        expected.push_back( norm_2( cm.position() -
+                                    model( i, cm.image_id(),
+                                           model.A_parameters(cm.image_id()),
+                                           model.B_parameters(i) ) ) );
+    ASSERT_EQ( expected.size(), kept.size() );
+    std::sort( kept.begin(), kept.end() );
+    std::sort( expected.begin(), expected.end() );
+    for ( size_t k = 0; k < kept.size(); k++ )
+      EXPECT_NEAR( expected[k], kept[k], 1e-8 );
+  }
+
+  std::vector<bool> fixed( model.num_cameras(), false );
+  fixed[0] = true;
+  adjuster.set_fixed_cameras( fixed );
+  EXPECT_FALSE( adjuster.pixel_errors_valid() );
+}
+
+TEST_F( ComparisonTest, SparsePixelErrors ) {
+  TestBAModel model( cameras, cnet );
+  AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false );
+  check_pixel_errors( model, adjuster );
+}
+
+TEST_F( ComparisonTest, RobustSparsePixelErrors ) {
+  TestBAModel model( cameras, cnet );
+  AdjustRobustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false );
+  check_pixel_errors( model, adjuster );
+}
+
+TEST( StudentTWeights, MatchesPerMeasure ) {
+  // An odd count, so that both the paired and the leftover measure
+  // are checked.
+  double error[] = { 1.5, -2.0, 0.0, 0.0, 30.0, 4.0, -0.25, 7.0, 3.0, -3.0 };
+  double inverse_variance[] = { 1.0, 1.0, 1.0, 1.0, 0.25, 4.0, 2.0, 0.5, 1.0, 1.0 };
+  double mu[5];
+  double objective = student_t_pixel_weights( error, inverse_variance, mu, 5, 4, 2 );
+
+  double expected_objective = 0;
+  for ( size_t k = 0; k < 5; k++ ) {
+    double S = error[2*k]*error[2*k]*inverse_variance[2*k] +
+      error[2*k+1]*error[2*k+1]*inverse_variance[2*k+1];
+    EXPECT_NEAR( 6/(4 + S), mu[k], 1e-14 );
+    expected_objective += 0.5*6*log(1 + S/4);
+  }
+  EXPECT_EQ( 1.5, mu[1] );
+  EXPECT_NEAR( expected_objective, objective, 1e-12 );
+  EXPECT_NEAR( objective, student_t_pixel_weights( error, inverse_variance, 0, 5, 4, 2 ), 1e-12 );
+}
@@ -130,3 +130,51 @@ TEST_F( CircleTest, JFeature ) {
 }
 
 
+
+TEST_F( CircleTest, CompactNetwork ) {
+  CameraRelationNetwork<JFeature> crn, compact_crn;
+  crn.read_controlnetwork( cnet );
+  compact_crn.read_controlnetwork( CompactControlNetwork( cnet ) );
+  ASSERT_EQ( crn.size(), compact_crn.size() );
+  for ( uint32 i = 0; i < crn.size(); i++ ) {
+    ASSERT_EQ( crn[i].relations.size(), compact_crn[i].relations.size() );
+    EXPECT_EQ( crn[i].map.size(), compact_crn[i].map.size() );
+    CameraNode<JFeature>::iterator f = crn[i].begin(), g = compact_crn[i].begin();
+    for ( ; f != crn[i].end(); f++, g++ ) {
+      EXPECT_EQ( (**f).m_point_id, (**g).m_point_id );
+      EXPECT_EQ( (**f).m_camera_id, (**g).m_camera_id );
+      EXPECT_VECTOR_DOUBLE_EQ( (**f).m_location, (**g).m_location );
+      EXPECT_VECTOR_DOUBLE_EQ( (**f).m_scale, (**g).m_scale );
+      EXPECT_EQ( (**f).m_connections.size(), (**g).m_connections.size() );
+    }
+  }
+}
+
+TEST( CameraRelation, Neighborhood ) {
+  // A chain of cameras 0-1-2-3-4, each pair sharing one point.
+  ControlNetwork chain( "Chain" );
+  for ( uint32 j = 0; j < 4; j++ ) {
+    ControlPoint cpoint;
+    cpoint.add_measure( ControlMeasure( 10, 10, 1, 1, j ) );
+    cpoint.add_measure( ControlMeasure( 20, 20, 1, 1, j+1 ) );
+    chain.add_control_point( cpoint );
+  }
+  CameraRelationNetwork<JFeature> crn;
+  crn.read_controlnetwork( chain );
+  ASSERT_EQ( 5u, crn.size() );
+
+  std::vector<size_t> start( 1, 1 );
+  std::vector<bool> none = crn.neighborhood( start, 0 );
+  std::vector<bool> near = crn.neighborhood( start, 1 );
+  std::vector<bool> far = crn.neighborhood( start, 2 );
+  for ( uint32 j = 0; j < 5; j++ ) {
+    EXPECT_EQ( j == 1, none[j] );
+    EXPECT_EQ( j <= 2, near[j] );
+    EXPECT_EQ( j <= 3, far[j] );
+  }
+
+  start.push_back( 4 );
+  std::vector<bool> both = crn.neighborhood( start, 1 );
+  for ( uint32 j = 0; j < 5; j++ )
+    EXPECT_TRUE( both[j] );
+}
@@ -9,11 +9,13 @@
 
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
 
 #include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::ba;
+using namespace vw::test;
 
 TEST( ControlNetwork, Construction ) {
 
@@ -77,3 +79,121 @@ TEST( ControlNetwork, Construction ) {
   cnet.clear();
   ASSERT_EQ( cnet.size(), 0u );
 }
+
+TEST( ControlNetwork, Compact ) {
+  ControlNetwork cnet( "TestCNET", ControlNetwork::ImageToImage, "Moon", "Compact", "tester" );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ControlPoint cpoint( i == 2 ? ControlPoint::GroundControlPoint : ControlPoint::TiePoint );
+    std::ostringstream id;
+    id << "point" << i;
+    cpoint.set_id( id.str() );
+    cpoint.set_position( Vector3( i, 2*i, 3.5*i ) );
+    cpoint.set_sigma( Vector3( 1, 2, 3 ) );
+    cpoint.set_ignore( i == 4 );
+    for ( uint32 j = 0; j < i; j++ ) {
+      ControlMeasure cm( 10*i+j, 20*i+j, 0.5, 0.25, j%3, ControlMeasure::Manual );
+      cm.set_serial( j%3 == 1 ? "one" : "other" );
+      cm.set_ephemeris_time( 100.5 + j );
+      cm.set_focalplane( 0.1*j, 0.2*j );
+      cm.set_pixels_dominant( j != 1 );
+      cm.set_ignore( j == 2 );
+      cpoint.add_measure( cm );
+    }
+    cnet.add_control_point( cpoint );
+  }
+
+  UnlinkName cnet_file( "compact.cnet2" );
+  write_compact_control_network( cnet_file, cnet );
+  EXPECT_TRUE( is_compact_control_network( cnet_file ) );
+
+  CompactControlNetwork compact( cnet_file );
+  ASSERT_EQ( 5u, compact.size() );
+  EXPECT_EQ( 10u, compact.num_measures() );
+  EXPECT_EQ( 3u, compact.num_images() );
+  EXPECT_EQ( ControlNetwork::ImageToGround, compact.type() );
+  EXPECT_EQ( "Moon", compact.target_name() );
+  EXPECT_EQ( "point3", compact.point_id(3) );
+  EXPECT_EQ( 3u, compact.point(3).num_measures );
+  EXPECT_EQ( 3u, compact.point(3).first_measure );
+  EXPECT_EQ( compact.begin(4), compact.measures() + 6 );
+  EXPECT_EQ( 1u, compact.image_id( compact.begin(3)[1].image ) );
+  EXPECT_EQ( "one", compact.image_serial( compact.begin(3)[1].image ) );
+
+  // Everything stored comes back out through ControlNetwork.
+  ControlNetwork result( "Empty" );
+  result.read_binary( cnet_file );
+  ASSERT_EQ( cnet.size(), result.size() );
+  EXPECT_EQ( cnet.type(), result.type() );
+  EXPECT_EQ( "TestCNET", result.network_id() );
+  EXPECT_EQ( "Compact", result.description() );
+  EXPECT_EQ( "tester", result.user_name() );
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    EXPECT_EQ( cnet[i].id(), result[i].id() );
+    EXPECT_EQ( cnet[i].type(), result[i].type() );
+    EXPECT_EQ( cnet[i].ignore(), result[i].ignore() );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].position(), result[i].position() );
+    EXPECT_VECTOR_DOUBLE_EQ( cnet[i].sigma(), result[i].sigma() );
+    ASSERT_EQ( cnet[i].size(), result[i].size() );
+    for ( size_t j = 0; j < cnet[i].size(); j++ ) {
+      EXPECT_TRUE( cnet[i][j] == result[i][j] );
+      EXPECT_EQ( cnet[i][j].serial(), result[i][j].serial() );
+      EXPECT_EQ( cnet[i][j].type(), result[i][j].type() );
+      EXPECT_EQ( cnet[i][j].ignore(), result[i][j].ignore() );
+      EXPECT_EQ( cnet[i][j].is_pixels_dominant(), result[i][j].is_pixels_dominant() );
+      EXPECT_VECTOR_DOUBLE_EQ( cnet[i][j].focalplane(), result[i][j].focalplane() );
+    }
+  }
+
+  // A network built in memory is laid out as it's written.
+  CompactControlNetwork in_memory( cnet );
+  EXPECT_EQ( compact.num_measures(), in_memory.num_measures() );
+  EXPECT_EQ( 0, memcmp( compact.measures(), in_memory.measures(),
+                        compact.num_measures() * sizeof(ControlMeasureRecord) ) );
+
+  // Old style files aren't mistaken for compact ones.
+  UnlinkName old_file( "compact.cnet" );
+  cnet.write_binary( old_file );
+  EXPECT_FALSE( is_compact_control_network( old_file ) );
+  EXPECT_THROW( CompactControlNetwork bad( old_file ), IOErr );
+}
+
+TEST( ControlNetwork, SpatialIndex ) {
+  ControlNetwork cnet( "Indexed" );
+  for ( uint32 i = 0; i < 400; i++ ) {
+    ControlPoint cpoint;
+    cpoint.set_position( Vector3( i % 20, i / 20, 0.5 * (i % 3) ) );
+    for ( uint32 j = 0; j < 3; j++ )
+      cpoint.add_measure( ControlMeasure( 7.5 * (i % 20) - 40 + j, 3.5 * (i / 20) + j, 1, 1, j ) );
+    cnet.add_control_point( cpoint );
+  }
+
+  // The indexed queries find just what the scans do.
+  Vector3 locations[] = { Vector3( 5, 5, 0 ), Vector3( 0, 19, 1 ), Vector3( -10, 0, 0 ) };
+  Vector2 pixels[] = { Vector2( 0, 10 ), Vector2( -40, 0 ), Vector2( 500, 500 ) };
+  std::vector<std::vector<size_t> > points;
+  std::vector<std::vector<std::pair<size_t,size_t> > > measures;
+  for ( size_t q = 0; q < 3; q++ ) {
+    points.push_back( cnet.points_within( locations[q], 2.5 ) );
+    for ( size_t j = 0; j < 4; j++ )
+      measures.push_back( cnet.measures_within( j, pixels[q], 9 ) );
+  }
+  EXPECT_EQ( 21u, points[0].size() );
+  EXPECT_TRUE( points[2].empty() );
+  EXPECT_FALSE( measures[0].empty() );
+  EXPECT_TRUE( measures[3].empty() );
+
+  cnet.build_point_index();
+  cnet.build_measure_index( 4 );
+  EXPECT_TRUE( cnet.has_point_index() );
+  EXPECT_TRUE( cnet.has_measure_index() );
+  for ( size_t q = 0; q < 3; q++ ) {
+    EXPECT_EQ( points[q], cnet.points_within( locations[q], 2.5 ) );
+    for ( size_t j = 0; j < 4; j++ )
+      EXPECT_EQ( measures[q*4+j], cnet.measures_within( j, pixels[q], 9 ) );
+  }
+
+  // Adding a point drops the indices.
+  cnet.add_control_point( ControlPoint() );
+  EXPECT_FALSE( cnet.has_point_index() );
+  EXPECT_FALSE( cnet.has_measure_index() );
+}
@@ -9,6 +9,8 @@
 
 #include <sstream>
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/InterestPoint/InterestData.h>
 
 #include <test/Helpers.h>
 
@@ -67,3 +69,67 @@ TEST( ControlNetworkLoad, LoadingGCPNET ) {
   ASSERT_EQ( 2u, net.size() );
   EXPECT_EQ( ControlPoint::GroundControlPoint, net[1].type() );
 }
+
+TEST( ControlNetworkLoad, AddMatches ) {
+  std::vector<std::string> image_names;
+  image_names.push_back("image1.tif");
+  image_names.push_back("image2.tif");
+  image_names.push_back("image3.tif");
+  std::vector<boost::shared_ptr<camera::CameraModel> > cameras;
+  for ( size_t i = 0; i < 3; i++ )
+    cameras.push_back( boost::shared_ptr<camera::CameraModel>
+                       ( new camera::PinholeModel( Vector3(double(i),0,0),
+                                                   math::identity_matrix<3>(),
+                                                   100, 100, 50, 50, Vector3(1,0,0),
+                                                   Vector3(0,1,0), Vector3(0,0,1),
+                                                   camera::NullLensDistortion() ) ) );
+
+  ControlNetwork net("destination");
+  {
+    ControlPoint cp;
+    cp.add_measure( ControlMeasure(10,10,1,1,0) );
+    cp.add_measure( ControlMeasure(20,20,1,1,1) );
+    net.add_control_point(cp);
+  }
+  {
+    ControlPoint cp;
+    cp.add_measure( ControlMeasure(40,40,1,1,2) );
+    net.add_control_point(cp);
+  }
+
+  // Starts a new point, joins the second point to the first, fails
+  // to give the first point a second measure in the third image, and
+  // extends the new point.
+  UnlinkName match1("image1__image3.match");
+  UnlinkName match2("image2__image3.match");
+  {
+    std::vector<ip::InterestPoint> ip1, ip2;
+    ip1.push_back( ip::InterestPoint(50,50) );
+    ip2.push_back( ip::InterestPoint(60,60) );
+    ip1.push_back( ip::InterestPoint(10,10) );
+    ip2.push_back( ip::InterestPoint(40,40) );
+    ip::write_binary_match_file( match1, ip1, ip2 );
+  }
+  {
+    std::vector<ip::InterestPoint> ip1, ip2;
+    ip1.push_back( ip::InterestPoint(20,20) );
+    ip2.push_back( ip::InterestPoint(45,45) );
+    ip1.push_back( ip::InterestPoint(25,25) );
+    ip2.push_back( ip::InterestPoint(60,60) );
+    ip::write_binary_match_file( match2, ip1, ip2 );
+  }
+  std::vector<std::string> match_files;
+  match_files.push_back( match1 );
+  match_files.push_back( match2 );
+  add_matches_to_control_network( net, cameras, image_names, match_files, 1 );
+
+  ASSERT_EQ( 2u, net.size() );
+  ASSERT_EQ( 3u, net[0].size() );
+  ASSERT_EQ( 3u, net[1].size() );
+  EXPECT_VECTOR_NEAR( Vector2(40,40), net[0][2].position(), 1e-6 );
+  EXPECT_EQ( 2u, net[0][2].image_id() );
+  EXPECT_VECTOR_NEAR( Vector2(50,50), net[1][0].position(), 1e-6 );
+  EXPECT_VECTOR_NEAR( Vector2(60,60), net[1][1].position(), 1e-6 );
+  EXPECT_VECTOR_NEAR( Vector2(25,25), net[1][2].position(), 1e-6 );
+  EXPECT_EQ( 1u, net[1][2].image_id() );
+}
@@ -7,19 +7,35 @@
 
 /// \file BayerFilter.h
 ///
-/// This function performs a bayer pattern decoding of a grayscale image..
+/// Bayer pattern decoding (demosaicing) of a grayscale image.
+///
+/// The mosaic is taken to have red at even columns of even rows and
+/// blue at odd columns of odd rows (RGGB), with green elsewhere.
 ///
 #ifndef __VW_CAMERA_BAYER__
 #define __VW_CAMERA_BAYER__
 
+#include <vector>
+#include <cmath>
+
+#include <boost/integer_traits.hpp>
+
+#include <vw/config.h>
 #include <vw/Core/CompoundTypes.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/EdgeExtension.h>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace vw {
 namespace camera {
 
+  /// Demosaics a whole image at once by bilinear interpolation.  Note
+  /// that output pixel (i,j) is interpolated around input pixel
+  /// (i+1,j+1); the views below keep the two aligned.
   template <class ViewT>
   ImageView<PixelRGB<typename CompoundChannelType<typename ViewT::pixel_type>::type > >
   inverse_bayer_filter(ImageViewBase<ViewT > const& view_) {
@@ -55,6 +71,198 @@ namespace camera {
     return output_image;
   }
 
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The four per-pixel estimates that every demosaiced pixel is
+    // assembled from, for n pixels of row 2 of the five rows r, each
+    // padded by two pixels on either side.  cross is green at a red or
+    // blue pixel; h and v are the color whose nearest neighbors lie
+    // horizontally or vertically from a green pixel; diag is the
+    // opposite color at a red or blue pixel.  Both filters are
+    // computed the same way at every pixel, so the rows vectorize
+    // cleanly and the choice by position happens afterwards.
+    template <bool MalvarV>
+    inline void bayer_estimate_row( float const* const* r, int32 n,
+                                    float* cross, float* h, float* v, float* diag ) {
+      float const *nn = r[0]+2, *no = r[1]+2, *c = r[2]+2, *so = r[3]+2, *ss = r[4]+2;
+      int32 x = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+      const __m128 k2 = _mm_set1_ps(2.f), k4 = _mm_set1_ps(4.f), k5 = _mm_set1_ps(5.f), k6 = _mm_set1_ps(6.f);
+      const __m128 khalf = _mm_set1_ps(0.5f), k1_5 = _mm_set1_ps(1.5f), kquarter = _mm_set1_ps(0.25f), keighth = _mm_set1_ps(0.125f);
+      for( ; x+4<=n; x+=4 ) {
+        __m128 h1 = _mm_add_ps( _mm_loadu_ps(c+x-1), _mm_loadu_ps(c+x+1) );
+        __m128 v1 = _mm_add_ps( _mm_loadu_ps(no+x), _mm_loadu_ps(so+x) );
+        __m128 d1 = _mm_add_ps( _mm_add_ps( _mm_loadu_ps(no+x-1), _mm_loadu_ps(no+x+1) ),
+                                _mm_add_ps( _mm_loadu_ps(so+x-1), _mm_loadu_ps(so+x+1) ) );
+        if( MalvarV ) {
+          __m128 c0 = _mm_loadu_ps(c+x);
+          __m128 h2 = _mm_add_ps( _mm_loadu_ps(c+x-2), _mm_loadu_ps(c+x+2) );
+          __m128 v2 = _mm_add_ps( _mm_loadu_ps(nn+x), _mm_loadu_ps(ss+x) );
+          __m128 c5d = _mm_sub_ps( _mm_mul_ps(k5,c0), d1 );
+          _mm_storeu_ps( cross+x, _mm_mul_ps( keighth, _mm_sub_ps( _mm_add_ps( _mm_mul_ps(k4,c0), _mm_mul_ps(k2,_mm_add_ps(h1,v1)) ), _mm_add_ps(h2,v2) ) ) );
+          _mm_storeu_ps( h+x, _mm_mul_ps( keighth, _mm_add_ps( _mm_sub_ps( _mm_add_ps( c5d, _mm_mul_ps(k4,h1) ), h2 ), _mm_mul_ps(khalf,v2) ) ) );
+          _mm_storeu_ps( v+x, _mm_mul_ps( keighth, _mm_add_ps( _mm_sub_ps( _mm_add_ps( c5d, _mm_mul_ps(k4,v1) ), v2 ), _mm_mul_ps(khalf,h2) ) ) );
+          _mm_storeu_ps( diag+x, _mm_mul_ps( keighth, _mm_sub_ps( _mm_add_ps( _mm_mul_ps(k6,c0), _mm_mul_ps(k2,d1) ), _mm_mul_ps(k1_5,_mm_add_ps(h2,v2)) ) ) );
+        }
+        else {
+          _mm_storeu_ps( cross+x, _mm_mul_ps( kquarter, _mm_add_ps(h1,v1) ) );
+          _mm_storeu_ps( h+x, _mm_mul_ps( khalf, h1 ) );
+          _mm_storeu_ps( v+x, _mm_mul_ps( khalf, v1 ) );
+          _mm_storeu_ps( diag+x, _mm_mul_ps( kquarter, d1 ) );
+        }
+      }
+#endif
+      for( ; x<n; ++x ) {
+        float h1 = c[x-1] + c[x+1], v1 = no[x] + so[x];
+        float d1 = no[x-1] + no[x+1] + so[x-1] + so[x+1];
+        if( MalvarV ) {
+          float h2 = c[x-2] + c[x+2], v2 = nn[x] + ss[x];
+          cross[x] = 0.125f * ( 4*c[x] + 2*(h1+v1) - (h2+v2) );
+          h[x]     = 0.125f * ( 5*c[x] - d1 + 4*h1 - h2 + 0.5f*v2 );
+          v[x]     = 0.125f * ( 5*c[x] - d1 + 4*v1 - v2 + 0.5f*h2 );
+          diag[x]  = 0.125f * ( 6*c[x] + 2*d1 - 1.5f*(h2+v2) );
+        }
+        else {
+          cross[x] = 0.25f * (h1+v1);
+          h[x]     = 0.5f * h1;
+          v[x]     = 0.5f * v1;
+          diag[x]  = 0.25f * d1;
+        }
+      }
+    }
+
+    // Converts an estimate back to the channel type, rounding and
+    // clamping for integer channels.
+    template <class ChannelT, bool IntegerV = boost::integer_traits<ChannelT>::is_integer>
+    struct BayerChannel {
+      static inline ChannelT convert( float value ) { return ChannelT(value); }
+    };
+
+    template <class ChannelT>
+    struct BayerChannel<ChannelT,true> {
+      static inline ChannelT convert( float value ) {
+        if( value <= float(boost::integer_traits<ChannelT>::const_min) ) return boost::integer_traits<ChannelT>::const_min;
+        if( value >= float(boost::integer_traits<ChannelT>::const_max) ) return boost::integer_traits<ChannelT>::const_max;
+        return ChannelT( std::floor( value + 0.5f ) );
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// A lazy Bayer demosaicing view.
+  ///
+  /// With MalvarV false each missing color is the bilinear average of
+  /// its nearest neighbors of that color; with MalvarV true the
+  /// gradient-corrected filters of Malvar, He and Cutler (ICASSP 2004)
+  /// are used instead, which are much sharper for the same 5x5
+  /// footprint.  The image is reflected about its edges, which keeps
+  /// the mosaic pattern intact there.  Output pixel (i,j) is
+  /// interpolated around input pixel (i,j).  Accessing individual
+  /// pixels is slow; rasterize instead, e.g. through block_rasterize.
+  template <class ImageT, bool MalvarV>
+  class BayerDemosaicView : public ImageViewBase<BayerDemosaicView<ImageT,MalvarV> >
+  {
+    ImageT m_image;
+
+  public:
+    typedef typename CompoundChannelType<typename ImageT::pixel_type>::type channel_type;
+
+    /// The pixel type of the view.
+    typedef PixelRGB<channel_type> pixel_type;
+    typedef pixel_type result_type;
+
+    /// The view's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<BayerDemosaicView<ImageT,MalvarV> > pixel_accessor;
+
+    BayerDemosaicView( ImageT const& image ) : m_image(image) {
+      VW_ASSERT( image.cols() >= 3 && image.rows() >= 3,
+                 ArgumentErr() << "BayerDemosaicView: Image must be at least 3x3 pixels." );
+    }
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Returns the pixel at the given position.
+    inline result_type operator()( int32 x, int32 y, int32 /*p*/=0 ) const {
+      ImageView<pixel_type> result( 1, 1 );
+      rasterize( result, BBox2i(x,y,1,1) );
+      return result(0,0);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(),-bbox.min().y(),
+                                                            cols(), rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i bbox ) const {
+      typedef typename DestT::pixel_accessor DestAccessT;
+      typedef detail::BayerChannel<channel_type> convert;
+      BBox2i child_bbox = bbox;
+      child_bbox.expand( 2 );
+      ImageView<typename ImageT::pixel_type> src = edge_extend( m_image, child_bbox, ReflectEdgeExtension() );
+
+      // The source as float rows, and the four estimates for one row.
+      int32 width = bbox.width(), scols = src.cols();
+      std::vector<float> buf( size_t(scols) * src.rows() );
+      for( int32 y=0; y<src.rows(); ++y )
+        for( int32 x=0; x<scols; ++x )
+          buf[size_t(y)*scols+x] = float( compound_select_channel<channel_type>( src(x,y), 0 ) );
+      std::vector<float> est( 4*size_t(width) );
+      float *cross = &est[0], *h = cross+width, *v = h+width, *diag = v+width;
+
+      DestAccessT drow = dest.origin();
+      for( int32 y=0; y<bbox.height(); ++y ) {
+        float const* r[5];
+        for( int32 k=0; k<5; ++k ) r[k] = &buf[size_t(y+k)*scols];
+        detail::bayer_estimate_row<MalvarV>( r, width, cross, h, v, diag );
+
+        float const* c = r[2]+2;
+        bool red_row = ((bbox.min().y()+y) & 1) == 0;
+        int32 x0 = bbox.min().x() & 1;
+        DestAccessT dcol = drow;
+        for( int32 x=0; x<width; ++x ) {
+          // Even columns hold red on red rows and green on blue rows.
+          bool even = ((x0+x) & 1) == 0;
+          float rv, gv, bv;
+          if( red_row ) {
+            if( even ) { rv = c[x];    gv = cross[x]; bv = diag[x]; }
+            else       { rv = h[x];    gv = c[x];     bv = v[x];    }
+          } else {
+            if( even ) { rv = v[x];    gv = c[x];     bv = h[x];    }
+            else       { rv = diag[x]; gv = cross[x]; bv = c[x];    }
+          }
+          *dcol = pixel_type( convert::convert(rv), convert::convert(gv), convert::convert(bv) );
+          dcol.next_col();
+        }
+        drow.next_row();
+      }
+    }
+    /// \endcond
+  };
+
+  /// Demosaics a Bayer image by bilinear interpolation, lazily.
+  template <class ViewT>
+  inline BayerDemosaicView<ViewT,false> bayer_demosaic( ImageViewBase<ViewT> const& view ) {
+    return BayerDemosaicView<ViewT,false>( view.impl() );
+  }
+
+  /// Demosaics a Bayer image with the gradient-corrected filters of
+  /// Malvar, He and Cutler, lazily.
+  template <class ViewT>
+  inline BayerDemosaicView<ViewT,true> bayer_demosaic_malvar( ImageViewBase<ViewT> const& view ) {
+    return BayerDemosaicView<ViewT,true>( view.impl() );
+  }
+
 }} // namespace vw::camera
 
 #endif // __VW_CAMERA_BAYER__
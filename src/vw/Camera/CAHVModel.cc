@@ -78,6 +78,36 @@ namespace camera {
     return vec;
   }
 
+  void CAHVModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>& pixels) const {
+    pixels.clear();
+    pixels.reserve(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+      Vector3 d = points[i] - C;
+      double dDot = dot_prod(d, A);
+      pixels.push_back( Vector2( dot_prod(d, H) / dDot, dot_prod(d, V) / dDot ) );
+    }
+  }
+
+  void CAHVModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>& centers,
+                                 std::vector<Vector3>& vectors) const {
+    centers.assign(pixels.size(), C);
+    vectors.clear();
+    vectors.reserve(pixels.size());
+
+    // (V - y*A) x (H - x*A) = VxH + x*(AxV) + y*(HxA), with the sign
+    // for left handed systems folded in up front.
+    Vector3 vh = cross_prod(V, H);
+    Vector3 av = cross_prod(A, V);
+    Vector3 ha = cross_prod(H, A);
+    if (dot_prod(vh, A) < 0.0) {
+      vh *= -1.0; av *= -1.0; ha *= -1.0;
+    }
+    for (size_t i = 0; i < pixels.size(); i++)
+      vectors.push_back( normalize( vh + pixels[i].x()*av + pixels[i].y()*ha ) );
+  }
+
   // --------------------------------------------------
   //                 Private Methods
   // --------------------------------------------------
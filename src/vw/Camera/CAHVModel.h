@@ -150,6 +150,15 @@ namespace camera {
     virtual Vector3 pixel_to_vector (Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const { return C; };
 
+    /// Batch forms of point_to_pixel() and pixel_to_vector().  The
+    /// rays expand the cross product once per batch, so each pixel
+    /// costs two scaled adds and a normalize.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& vectors) const;
+
     /// Write CAHV model to file
     void write(std::string const& filename);
 
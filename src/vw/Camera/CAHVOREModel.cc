@@ -23,7 +23,7 @@ bool CAHVOREModel::check_line( std::istream& istream, char letter ) {
 
 // Overloaded constructor - this one reads in the file name
 // where the CAHVORE camera model is saved.
-CAHVOREModel::CAHVOREModel(std::string const& filename) {
+CAHVOREModel::CAHVOREModel(std::string const& filename) : m_pixel_tolerance(0) {
 
   try {
     std::ifstream input(filename.c_str(), std::ifstream::in);
@@ -182,6 +182,127 @@ vw::Vector3 CAHVOREModel::pixel_to_vector(vw::Vector2 const& pix) const {
   return result;
 }
 
+namespace {
+  // Solve for the refracted angle theta of a ray that is 'zeta' along
+  // the optical axis and 'lambda' off it, by Newton's method from
+  // 'theta'.
+  double cahvore_theta( double zeta, double lambda, Vector3 const& E,
+                        double theta, double tolerance ) {
+    double dtheta = 1;
+    for (int32 n = 0;;++n) {
+
+      // Checking exit conditions
+      if (n > 100)
+        vw_throw( PointToPixelErr() << "CAHVOREModel: Did not converge.\n" );
+      if (fabs(dtheta) < tolerance)
+        break;
+
+      // Compute terms from the current value of theta
+      double costh = cos(theta);
+      double sinth = sin(theta);
+      double theta2 = theta * theta;
+      double theta3 = theta * theta2;
+      double theta4 = theta * theta3;
+      double upsilon = zeta*costh + lambda*sinth
+        - (1     - costh) * (E[0] +  E[1]*theta2 +   E[2]*theta4)
+        - (theta - sinth) * (      2*E[1]*theta  + 4*E[2]*theta3);
+
+      // Update theta
+      dtheta = (
+                zeta*sinth - lambda*costh
+                - (theta - sinth) * (E[0] + E[1]*theta2 + E[2]*theta4)
+                ) / upsilon;
+      theta -= dtheta;
+    }
+    return theta;
+  }
+}
+
+// Theta over a grid of the ray's angle off the axis, psi, and its
+// inverse distance from the camera, q. Far away (q = 0) theta is psi.
+// 'max_error' is the worst interpolation error seen at the cell
+// centers, with a safety factor.
+struct CAHVOREModel::ProjectionTable {
+  Vector3 E;
+  double psi_step, q_step, max_error;
+  int32 psi_n, q_n;
+  std::vector<double> theta;
+
+  bool seed( double psi, double q, double& result ) const {
+    double x = psi / psi_step, y = q / q_step;
+    if ( !(x < psi_n-1) || !(y < q_n-1) )
+      return false;
+    int32 i = int32(x), j = int32(y);
+    double a = x - i, b = y - j;
+    double const* t = &theta[j*psi_n + i];
+    result = (1-b)*((1-a)*t[0] + a*t[1]) + b*((1-a)*t[psi_n] + a*t[psi_n+1]);
+    return true;
+  }
+};
+
+void CAHVOREModel::build_projection_table( Vector2i const& image_size, double min_range ) {
+  VW_ASSERT( min_range > 0, ArgumentErr() << "CAHVOREModel::build_projection_table: min_range must be positive." );
+  m_projection_table.reset();
+
+  // Widest ray around the image border
+  double psi_max = 0;
+  for ( int32 k = 0; k <= 16; k++ ) {
+    Vector2 border[4] = { Vector2( k*(image_size[0]-1)/16.0, 0 ),
+                          Vector2( k*(image_size[0]-1)/16.0, image_size[1]-1 ),
+                          Vector2( 0, k*(image_size[1]-1)/16.0 ),
+                          Vector2( image_size[0]-1, k*(image_size[1]-1)/16.0 ) };
+    for ( int32 b = 0; b < 4; b++ ) {
+      double psi = acos( std::max( -1.0, std::min( 1.0, dot_prod( pixel_to_vector(border[b]), O ) ) ) );
+      psi_max = std::max( psi_max, psi );
+    }
+  }
+  psi_max = std::min( 1.05*psi_max + 1e-3, M_PI );
+
+  boost::shared_ptr<ProjectionTable> table( new ProjectionTable );
+  table->E = E;
+  table->psi_n = 128;
+  table->q_n = 32;
+  table->psi_step = psi_max / (table->psi_n-1);
+  table->q_step = 1.0 / min_range / (table->q_n-1);
+  table->theta.resize( table->psi_n * table->q_n );
+  for ( int32 j = 0; j < table->q_n; j++ ) {
+    for ( int32 i = 0; i < table->psi_n; i++ ) {
+      double psi = i * table->psi_step;
+      double& theta = table->theta[j*table->psi_n + i];
+      theta = psi;
+      if ( j == 0 )
+        continue;
+      double range = 1.0 / (j * table->q_step);
+      try {
+        theta = cahvore_theta( range*cos(psi), range*sin(psi), E, psi, 1e-12 );
+      } catch ( const PointToPixelErr& ) {}
+    }
+  }
+
+  // Check the interpolation between the nodes
+  table->max_error = 0;
+  for ( int32 j = 0; j < table->q_n-1; j++ ) {
+    for ( int32 i = 0; i < table->psi_n-1; i++ ) {
+      double psi = (i+0.5) * table->psi_step;
+      double range = 1.0 / ((j+0.5) * table->q_step);
+      double exact, seeded = psi;
+      try {
+        exact = cahvore_theta( range*cos(psi), range*sin(psi), E, psi, 1e-12 );
+      } catch ( const PointToPixelErr& ) {
+        exact = HUGE_VAL;
+      }
+      table->seed( psi, 1.0/range, seeded );
+      table->max_error = std::max( table->max_error, 2*fabs(exact - seeded) );
+    }
+  }
+  m_projection_table = table;
+}
+
+bool CAHVOREModel::has_projection_table() const {
+  return m_projection_table && m_projection_table->E[0] == E[0] &&
+    m_projection_table->E[1] == E[1] && m_projection_table->E[2] == E[2];
+}
+
 Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
   // Base on JPL's cmod_cahvore_3d_to_2d_general
 
@@ -191,35 +312,24 @@ Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
   Vector3 lambda3 = p_c - zeta * O;
   double lambda = norm_2(lambda3);
 
-  // Calculate theta using Newton's Method
-  double theta = atan2(lambda, zeta);
-  double dtheta = 1;
-  for (int32 n = 0;;++n) {
-
-    // Checking exit conditions
-    if (n > 100)
-      vw_throw( PointToPixelErr() << "CAHVOREModel: Did not converge.\n" );
-    if (fabs(dtheta) < 1e-8)
-      break;
-
-    // Compute terms from the current value of theta
-    double costh = cos(theta);
-    double sinth = sin(theta);
-    double theta2 = theta * theta;
-    double theta3 = theta * theta2;
-    double theta4 = theta * theta3;
-    double upsilon = zeta*costh + lambda*sinth
-      - (1     - costh) * (E[0] +  E[1]*theta2 +   E[2]*theta4)
-      - (theta - sinth) * (      2*E[1]*theta  + 4*E[2]*theta3);
-
-    // Update theta
-    dtheta = (
-              zeta*sinth - lambda*costh
-              - (theta - sinth) * (E[0] + E[1]*theta2 + E[2]*theta4)
-              ) / upsilon;
-    theta -= dtheta;
+  // Convert the pixel tolerance to radians with the longer of the
+  // two focal lengths.
+  double tolerance = 1e-8;
+  if ( m_pixel_tolerance > 0 ) {
+    double hs = norm_2( H - dot_prod(H,A)*A );
+    double vs = norm_2( V - dot_prod(V,A)*A );
+    tolerance = std::max( tolerance, m_pixel_tolerance / std::max(hs, vs) );
   }
 
+  // Calculate theta using Newton's Method, starting from the table
+  // when there is one. Where the table alone is within tolerance
+  // there is nothing left to iterate.
+  double theta = atan2(lambda, zeta);
+  if ( !has_projection_table() ||
+       !m_projection_table->seed( theta, 1.0/sqrt(zeta*zeta + lambda*lambda), theta ) ||
+       m_projection_table->max_error >= tolerance )
+    theta = cahvore_theta( zeta, lambda, E, theta, tolerance );
+
   // Check the value of theta
   if ((theta * fabs(P)) > M_PI/2)
     vw_throw( PointToPixelErr() << "CAHVOREModel: Theta out of bounds.\n" );
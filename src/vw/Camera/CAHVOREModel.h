@@ -17,6 +17,8 @@
 #include <vw/Core/Log.h>
 #include <vw/Camera/CAHVModel.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 namespace camera {
 
@@ -29,7 +31,7 @@ namespace camera {
     //------------------------------------------------------------------
 
     /// Default constructor creates CAHVORE vectors equal to 0.
-    CAHVOREModel() {}
+    CAHVOREModel() : m_pixel_tolerance(0) {}
 
     /// Read a CAHVORE file from disk.
     CAHVOREModel(std::string const& filename);
@@ -37,10 +39,12 @@ namespace camera {
     /// Initialize the CAHVORE vectors directly in the native CAHVORE format.
     CAHVOREModel(Vector3 const& C_vec, Vector3 const& A_vec, Vector3 const& H_vec, Vector3 const& V_vec,
                  Vector3 const& O_vec, Vector3 const& R_vec, Vector3 const& E_Vec) :
-      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(1.0) {}
+      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(1.0),
+      m_pixel_tolerance(0) {}
     CAHVOREModel(Vector3 const& C_vec, Vector3 const& A_vec, Vector3 const& H_vec, Vector3 const& V_vec,
                  Vector3 const& O_vec, Vector3 const& R_vec, Vector3 const& E_Vec, int T, double P_v) :
-      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(P_v) {
+      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(P_v),
+      m_pixel_tolerance(0) {
       switch( T ) {
       case 1: P = 1.0; break;
       case 2: P = 0.0; break;
@@ -52,7 +56,8 @@ namespace camera {
     }
     CAHVOREModel(Vector3 const& C_vec, Vector3 const& A_vec, Vector3 const& H_vec, Vector3 const& V_vec,
                  Vector3 const& O_vec, Vector3 const& R_vec, Vector3 const& E_Vec, double P_v) :
-      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(P_v) {
+      C(C_vec), A(A_vec), H(H_vec), V(V_vec), O(O_vec), R(R_vec), E(E_Vec), P(P_v),
+      m_pixel_tolerance(0) {
       if ( P < 0 || P > 1 ) vw_throw( ArgumentErr() << "Invalid P value: " << P_v << "\n" );
     }
 
@@ -66,6 +71,24 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const { return C; };
 
+    /// point_to_pixel() finds the refracted angle of each ray with
+    /// Newton's method.  By default it iterates until the angle
+    /// settles to 1e-8 radians.  Setting a tolerance in pixels lets it
+    /// stop as soon as the step is below that many pixels at the
+    /// camera's focal length instead.  Zero restores the default.
+    void set_pixel_tolerance( double pixels ) { m_pixel_tolerance = pixels; }
+    double pixel_tolerance() const { return m_pixel_tolerance; }
+
+    /// Solves the refracted angle ahead of time on a grid covering
+    /// the field of view of an image of 'image_size', for points at
+    /// least 'min_range' from the camera.  point_to_pixel() then
+    /// seeds Newton's method from the grid, which usually leaves one
+    /// iteration to do.  The grid is read-only once built and shared
+    /// by copies of the camera.  It is ignored if E changes.
+    void build_projection_table( Vector2i const& image_size, double min_range = 0.1 );
+    void clear_projection_table() { m_projection_table.reset(); }
+    bool has_projection_table() const;
+
     /// Write CAHVORE model to file.
     void write(std::string const& filename);
 
@@ -82,6 +105,10 @@ namespace camera {
     double    P; // We don't have T as it is redundant information
   private:
     bool check_line( std::istream& istream, char letter );
+
+    double m_pixel_tolerance;
+    struct ProjectionTable;
+    boost::shared_ptr<const ProjectionTable> m_projection_table;
   };
 
   // Function to "map" the CAHVORE parameters into CAHV:
@@ -10,6 +10,39 @@
 using namespace vw;
 using namespace vw::camera;
 
+Vector2 CameraModel::point_to_pixel_jacobian(Vector3 const& point,
+                                            Matrix<double,2,3>& jacobian) const {
+  Vector2 h0 = point_to_pixel(point);
+  for (size_t n = 0; n < 3; n++) {
+    Vector3 point_prime = point;
+    double epsilon = 1e-7 + fabs(point[n]*1e-7);
+    point_prime[n] += epsilon;
+    select_col(jacobian,n) = (point_to_pixel(point_prime) - h0)/epsilon;
+  }
+  return h0;
+}
+
+void CameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>& pixels) const {
+  pixels.clear();
+  pixels.reserve(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+    pixels.push_back(point_to_pixel(points[i]));
+}
+
+void CameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>& centers,
+                                 std::vector<Vector3>& vectors) const {
+  centers.clear();
+  vectors.clear();
+  centers.reserve(pixels.size());
+  vectors.reserve(pixels.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    vectors.push_back(pixel_to_vector(pixels[i]));
+    centers.push_back(camera_center(pixels[i]));
+  }
+}
+
 Vector3 AdjustedCameraModel::axis_angle_rotation() const {
   Quat quat = this->rotation();
   return quat.axis_angle();
@@ -26,10 +59,68 @@ Vector2 AdjustedCameraModel::point_to_pixel (Vector3 const& point) const {
   return m_camera->point_to_pixel(new_pt);
 }
 
+Vector2 AdjustedCameraModel::point_to_pixel_jacobian (Vector3 const& point,
+                                                      Matrix<double,2,3>& jacobian) const {
+  Vector3 center = m_camera->camera_center(Vector2(0,0));
+  Vector3 new_pt = m_rotation_inverse.rotate(point-center-m_translation) + center;
+  Matrix<double,2,3> camera_jacobian;
+  Vector2 pixel = m_camera->point_to_pixel_jacobian(new_pt, camera_jacobian);
+  jacobian = camera_jacobian * m_rotation_inverse.rotation_matrix();
+  return pixel;
+}
+
+void AdjustedCameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                           std::vector<Vector2>& pixels) const {
+  if (points.empty()) {
+    pixels.clear();
+    return;
+  }
+  Vector3 center = m_camera->camera_center(Vector2(0,0));
+  Vector3 offset = center + m_translation;
+  std::vector<Vector3> new_pts(points.size());
+  for (size_t i = 0; i < points.size(); i++)
+    new_pts[i] = points[i] - offset;
+  m_rotation_inverse.rotate(&new_pts[0], &new_pts[0], new_pts.size());
+  for (size_t i = 0; i < new_pts.size(); i++)
+    new_pts[i] += center;
+  m_camera->points_to_pixels(new_pts, pixels);
+}
+
+Vector2 AdjustedCameraModel::adjustment_jacobian (Vector3 const& point,
+                                                  Matrix<double,2,3>& translation_jacobian,
+                                                  Matrix<double,2,3>& rotation_jacobian) const {
+  Vector3 center = m_camera->camera_center(Vector2(0,0));
+  Matrix<double,3,3> inverse_rotation = m_rotation_inverse.rotation_matrix();
+  Vector3 w = inverse_rotation * (point-center-m_translation);
+  Matrix<double,2,3> camera_jacobian;
+  Vector2 pixel = m_camera->point_to_pixel_jacobian(w + center, camera_jacobian);
+
+  // Turning by exp(dw) on the right takes w to w - dw x w = w + w x dw.
+  Matrix<double,3,3> cross_w;
+  cross_w(0,1) = -w[2]; cross_w(0,2) =  w[1];
+  cross_w(1,0) =  w[2]; cross_w(1,2) = -w[0];
+  cross_w(2,0) = -w[1]; cross_w(2,1) =  w[0];
+
+  translation_jacobian = -camera_jacobian * inverse_rotation;
+  rotation_jacobian = camera_jacobian * cross_w;
+  return pixel;
+}
+
 Vector3 AdjustedCameraModel::pixel_to_vector (Vector2 const& pix) const {
   return m_rotation.rotate(m_camera->pixel_to_vector(pix));
 }
 
+void AdjustedCameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                         std::vector<Vector3>& centers,
+                                         std::vector<Vector3>& vectors) const {
+  m_camera->pixels_to_rays(pixels, centers, vectors);
+  if (vectors.empty())
+    return;
+  m_rotation.rotate(&vectors[0], &vectors[0], vectors.size());
+  for (size_t i = 0; i < centers.size(); i++)
+    centers[i] += m_translation;
+}
+
 Vector3 AdjustedCameraModel::camera_center(Vector2 const& pix) const {
   return m_camera->camera_center(pix) + m_translation;
 }
@@ -14,6 +14,7 @@
 #define __VW_CAMERA_CAMERAMODEL_H__
 
 #include <fstream>
+#include <vector>
 #include <vw/Math/Quaternion.h>
 
 namespace vw {
@@ -59,6 +60,21 @@ namespace camera {
     /// vw::camera::PointToPixelErr()
     virtual Vector2 point_to_pixel (Vector3 const& point) const = 0;
 
+    /// Computes point_to_pixel() along with its derivative with
+    /// respect to the 3D point.  This default takes forward
+    /// differences, which costs three extra projections; models with
+    /// a closed form should override it.
+    virtual Vector2 point_to_pixel_jacobian (Vector3 const& point,
+                                             Matrix<double,2,3>& jacobian) const;
+
+    /// Computes point_to_pixel() for each of a batch of points, e.g.
+    /// the DEM points under one tile of an orthoimage.  This default
+    /// calls it one point at a time; models that can share work
+    /// between points should override it.  It throws as
+    /// point_to_pixel() does if any point can't be imaged.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+
     /// Returns a pointing vector from the camera center through the
     /// position of the pixel 'pix' on the image plane.  For
     /// consistency, the pointing vector should generally be
@@ -72,6 +88,15 @@ namespace camera {
     /// intersection in a stereo vision algorithm).
     virtual Vector3 camera_center(Vector2 const& pix) const = 0;
 
+    /// Computes camera_center() and pixel_to_vector() for each of a
+    /// batch of pixels, e.g. the pixels of one tile of a disparity
+    /// map.  This default calls them one pixel at a time; models
+    /// that can share work between pixels should override it.  It
+    /// throws as pixel_to_vector() does if any pixel has no ray.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& vectors) const;
+
     /// Subclasses must define a method that return the camera type as a string.
     virtual std::string type() const = 0;
 
@@ -130,10 +155,30 @@ namespace camera {
     }
 
     virtual Vector2 point_to_pixel (Vector3 const&) const;
+    virtual Vector2 point_to_pixel_jacobian (Vector3 const&, Matrix<double,2,3>&) const;
+
+    /// Moves the whole batch into the wrapped camera's frame with one
+    /// rotation and hands it to that camera's points_to_pixels().
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
     virtual Vector3 pixel_to_vector (Vector2 const&) const;
     virtual Vector3 camera_center (Vector2 const&) const;
     virtual Quat camera_pose(Vector2 const&) const;
 
+    /// Derivatives of point_to_pixel() with respect to the
+    /// adjustment.  'translation_jacobian' is taken against the
+    /// translation and 'rotation_jacobian' against a small axis-angle
+    /// turn 'w' composed on the right, i.e. rotation()*exp(w).
+    Vector2 adjustment_jacobian (Vector3 const& point,
+                                 Matrix<double,2,3>& translation_jacobian,
+                                 Matrix<double,2,3>& rotation_jacobian) const;
+
+    /// Takes the rays of the adjusted camera in one batch, and turns
+    /// them all by one rotation matrix.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& vectors) const;
+
     void write(std::string const&);
     void read(std::string const&);
 
@@ -29,11 +29,18 @@ namespace camera{
   /// works if both cameras have the some camera center (focal point).
   /// If the camera centers do not match it will vw_throw an exception.
   ///
+  /// A non-zero tolerance (in pixels) lets TransformView evaluate the
+  /// cameras only on an adaptively refined grid of each tile and
+  /// interpolate in between (see ApproximateTransform), which is
+  /// usually far cheaper than calling the cameras for every pixel.
+  ///
   template <class SrcCameraT, class DstCameraT>
   struct CameraTransform : public TransformBase<CameraTransform<SrcCameraT, DstCameraT> > {
     CameraTransform(SrcCameraT const& src_camera,
-                    DstCameraT const& dst_camera) :
+                    DstCameraT const& dst_camera,
+                    double tolerance = 0.0) :
       m_src_camera(src_camera), m_dst_camera(dst_camera) {
+      this->set_tolerance( tolerance );
     }
 
     /// This defines the transformation from coordinates in our target
@@ -73,8 +80,10 @@ namespace camera{
 
   struct SmartPtrCameraTransform : public TransformBase<SmartPtrCameraTransform> {
     SmartPtrCameraTransform(boost::shared_ptr<CameraModel> const& src_camera,
-                            boost::shared_ptr<CameraModel> const& dst_camera) :
+                            boost::shared_ptr<CameraModel> const& dst_camera,
+                            double tolerance = 0.0) :
       m_src_camera(src_camera), m_dst_camera(dst_camera) {
+      set_tolerance( tolerance );
     }
 
     /// This defines the transformation from coordinates in our target
@@ -123,6 +132,18 @@ namespace camera{
     return transform( image, ctx, edge_func, interp_func );
   }
 
+  /// Transform an image from one camera model to another, explicitly
+  /// specifying the edge extension and interpolation modes, and
+  /// approximating the camera mapping to within the given tolerance
+  /// in pixels.
+  template <class ImageT, class SrcCameraT, class DstCameraT, class EdgeT, class InterpT>
+  TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, CameraTransform<SrcCameraT, DstCameraT> >
+  inline camera_transform( ImageViewBase<ImageT> const& image, SrcCameraT const& src_camera, DstCameraT const& dst_camera, EdgeT const& edge_func, InterpT const& interp_func, double tolerance )
+  {
+    CameraTransform<SrcCameraT, DstCameraT> ctx( src_camera, dst_camera, tolerance );
+    return transform( image, ctx, edge_func, interp_func );
+  }
+
   /// Transform an image from one camera model to another using
   /// bilinear interpolation, explicitly specifying the edge extension
   /// mode.
@@ -158,6 +179,21 @@ namespace camera{
     return transform( image, ctx, edge_func, interp_func );
   }
 
+  /// Transform an image from a camera model to a linearized
+  /// (i.e. undistorted) version of itself, explicitly specifying the
+  /// edge extension and interpolation modes, and approximating the
+  /// camera mapping to within the given tolerance in pixels.
+  template <class ImageT, class SrcCameraT, class EdgeT, class InterpT>
+  TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, CameraTransform<SrcCameraT, typename SrcCameraT::linearized_type> >
+  inline linearize_camera_transform( ImageViewBase<ImageT> const& image, SrcCameraT const& src_camera, EdgeT const& edge_func, InterpT const& interp_func, double tolerance )
+  {
+    typename SrcCameraT::linearized_type dst_camera =
+      linearize_camera( src_camera, Vector2i(image.impl().cols(), image.impl().rows()),
+                        Vector2i(image.impl().cols(), image.impl().rows()) );
+    CameraTransform<SrcCameraT, typename SrcCameraT::linearized_type> ctx( src_camera, dst_camera, tolerance );
+    return transform( image, ctx, edge_func, interp_func );
+  }
+
   /// Transform an image from a camera model to a linearized
   /// (i.e. undistorted) version of itself using bilinear
   /// interpolation, explicitly specifying the edge extension mode.
@@ -64,6 +64,19 @@ vw::camera::LensDistortion::distorted_coordinates(const camera::PinholeModel& ca
   return solution;
 }
 
+vw::Matrix2x2
+vw::camera::LensDistortion::distortion_jacobian(const camera::PinholeModel& cam, Vector2 const& v) const {
+  Matrix2x2 J;
+  Vector2 h0 = this->distorted_coordinates(cam, v);
+  for ( size_t n = 0; n < 2; n++ ) {
+    Vector2 v_prime = v;
+    double epsilon = 1e-7 + fabs(v[n]*1e-7);
+    v_prime[n] += epsilon;
+    select_col(J,n) = (this->distorted_coordinates(cam, v_prime) - h0)/epsilon;
+  }
+  return J;
+}
+
 // Specific Implementations -------------------------------------
 
 Vector2
@@ -94,6 +107,37 @@ vw::camera::TsaiLensDistortion::distorted_coordinates(const camera::PinholeModel
   return result;
 }
 
+vw::Matrix2x2
+vw::camera::TsaiLensDistortion::distortion_jacobian(const camera::PinholeModel& cam, Vector2 const& p) const {
+
+  Vector2 focal = cam.focal_length();
+  Vector2 offset = cam.point_offset();
+
+  if (focal[0] < 1e-300 || focal[1] < 1e-300)
+    return math::identity_matrix<2>();
+
+  // Written out, distorted_coordinates() is
+  //   u' = u + fu * ( r2*p2 + x*(k1*r2 + k2*r4 + 2*p2*x + 2*p1*y) )
+  //   v' = v + fv * ( r2*p1 + y*(k1*r2 + k2*r4 + 2*p2*x + 2*p1*y) )
+  // with x = (u-cu)/fu and y = (v-cv)/fv.
+  double x = (p[0] - offset[0]) / focal[0];
+  double y = (p[1] - offset[1]) / focal[1];
+  double r2 = x*x + y*y;
+  double k1 = m_distortion[0], k2 = m_distortion[1];
+  double p1 = m_distortion[2], p2 = m_distortion[3];
+  double s = k1*r2 + k2*r2*r2 + 2*p2*x + 2*p1*y;
+  double dr = 2*(k1 + 2*k2*r2);
+  double ds_dx = dr*x + 2*p2;
+  double ds_dy = dr*y + 2*p1;
+
+  Matrix2x2 J;
+  J(0,0) = 1 + 2*x*p2 + s + x*ds_dx;
+  J(0,1) = (2*y*p2 + x*ds_dy) * focal[0] / focal[1];
+  J(1,0) = (2*x*p1 + y*ds_dx) * focal[1] / focal[0];
+  J(1,1) = 1 + 2*y*p1 + s + y*ds_dy;
+  return J;
+}
+
 Vector2
 vw::camera::BrownConradyDistortion::undistorted_coordinates(const camera::PinholeModel& cam, Vector2 const& p) const {
   Vector2 offset = cam.point_offset();
@@ -35,6 +35,7 @@
 #define __VW_CAMERA_LENSDISTORTION_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
 #include <boost/shared_ptr.hpp>
 #include <string>
 
@@ -51,6 +52,10 @@ namespace camera {
       virtual ~LensDistortion() {}
       virtual Vector2 distorted_coordinates(const PinholeModel&, Vector2 const&) const;
       virtual Vector2 undistorted_coordinates(const PinholeModel&, Vector2 const&) const;
+      /// Derivative of distorted_coordinates() with respect to the
+      /// undistorted location.  The default takes forward differences;
+      /// models with a closed form should override it.
+      virtual Matrix2x2 distortion_jacobian(const PinholeModel&, Vector2 const&) const;
       virtual void write(std::ostream & os) const = 0;
       virtual boost::shared_ptr<LensDistortion> copy() const = 0;
       virtual Vector<double> distortion_parameters() const { return Vector<double>(); }
@@ -65,6 +70,9 @@ namespace camera {
   struct NullLensDistortion : public LensDistortion {
     Vector2 distorted_coordinates(const PinholeModel&, Vector2 const& v) const { return v; }
     Vector2 undistorted_coordinates(const PinholeModel&, Vector2 const& v) const { return v; }
+    Matrix2x2 distortion_jacobian(const PinholeModel&, Vector2 const&) const {
+      return math::identity_matrix<2>();
+    }
     boost::shared_ptr<LensDistortion> copy() const {
       return boost::shared_ptr<NullLensDistortion>(new NullLensDistortion(*this));
     }
@@ -110,6 +118,7 @@ namespace camera {
 
     //  Location where the given pixel would have appeared if there were no lens distortion.
     Vector2 distorted_coordinates(const PinholeModel&, Vector2 const&) const;
+    Matrix2x2 distortion_jacobian(const PinholeModel&, Vector2 const&) const;
     void write(std::ostream & os) const {
       os << "k1 = " << m_distortion[0] << "\n";
       os << "k2 = " << m_distortion[1] << "\n";
@@ -16,6 +16,8 @@
 #include <vw/Math/Quaternion.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 namespace camera {
 
@@ -37,6 +39,38 @@ namespace camera {
     Vector3 m_pointing_vec;
     Vector3 m_u_vec;
 
+    // Position and world-to-camera rotation at each scanline, see
+    // build_line_cache().
+    struct LineCache {
+      std::vector<Vector3> positions;
+      std::vector<Matrix<double,3,3> > rotations;
+    };
+    boost::shared_ptr<const LineCache> m_line_cache;
+
+    // Time of a fractional line, extrapolated past the last line.
+    double line_time( double v ) const {
+      int y = std::min( std::max( int(floor(v)), 0 ), int(m_line_times.size())-2 );
+      return m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * (v - y);
+    }
+
+    // Distance of 'point' in front of the scan plane of the camera at
+    // 'position' with world-to-camera rotation 'rotation'.
+    double scan_plane_offset( Vector3 const& point, Vector3 const& position,
+                              Matrix<double,3,3> const& rotation ) const {
+      return dot_prod( cross_prod(m_u_vec, m_pointing_vec), rotation * (point - position) );
+    }
+
+    double scan_plane_offset( Vector3 const& point, double v ) const {
+      double t = line_time(v);
+      return scan_plane_offset( point, m_position_func(t), m_pose_func(t).rotation_matrix() );
+    }
+
+    double scan_plane_offset( Vector3 const& point, int line ) const {
+      if ( m_line_cache )
+        return scan_plane_offset( point, m_line_cache->positions[line], m_line_cache->rotations[line] );
+      return scan_plane_offset( point, double(line) );
+    }
+
   public:
     //------------------------------------------------------------------
     // Constructors / Destructors
@@ -116,11 +150,85 @@ namespace camera {
     //------------------------------------------------------------------
     // Interface
     //------------------------------------------------------------------
-    virtual Vector2 point_to_pixel(Vector3 const& /*point*/) const {
-      vw_throw( vw::NoImplErr() << "LinescanModel::point_to_pixel is not yet implemented." );
-      return Vector2(); // never reached
+    /// Finds the scanline whose scan plane holds the point, then the
+    /// sample along it.  The line is bracketed over whole lines by
+    /// regula falsi, reading the line cache when there is one, and
+    /// then refined between its two neighbours with the position and
+    /// pose functions themselves.
+    virtual Vector2 point_to_pixel(Vector3 const& point) const {
+      int last = int(m_line_times.size()) - 1;
+      if ( last < 1 )
+        vw_throw( PointToPixelErr() << "LinescanModel: needs at least two scanlines." );
+
+      // Bracket the line among whole lines. The Illinois variant
+      // halves the end that is kept twice in a row.
+      int lo = 0, hi = last;
+      double f_lo = scan_plane_offset( point, lo ), f_hi = scan_plane_offset( point, hi );
+      if ( (f_lo < 0) == (f_hi < 0) )
+        vw_throw( PointToPixelErr() << "LinescanModel: point is not seen by any scanline." );
+      int side = 0;
+      while ( hi - lo > 1 ) {
+        int k = int( round( lo - f_lo * (hi - lo) / (f_hi - f_lo) ) );
+        k = std::min( std::max( k, lo+1 ), hi-1 );
+        double f_k = scan_plane_offset( point, k );
+        if ( (f_k < 0) == (f_lo < 0) ) {
+          lo = k; f_lo = f_k;
+          if ( side == -1 ) f_hi *= 0.5;
+          side = -1;
+        } else {
+          hi = k; f_hi = f_k;
+          if ( side == 1 ) f_lo *= 0.5;
+          side = 1;
+        }
+      }
+
+      // Refine between the two lines with the exact functions
+      double v_lo = lo, v_hi = hi;
+      f_lo = scan_plane_offset( point, v_lo );
+      f_hi = scan_plane_offset( point, v_hi );
+      double v = v_lo - f_lo * (v_hi - v_lo) / (f_hi - f_lo);
+      for ( int n = 0; n < 20 && v_hi - v_lo > 1e-9; n++ ) {
+        double f_v = scan_plane_offset( point, v );
+        if ( f_v == 0 )
+          break;
+        if ( (f_v < 0) == (f_lo < 0) ) { v_lo = v; f_lo = f_v; }
+        else                           { v_hi = v; f_hi = f_v; }
+        double v_next = v_lo - f_lo * (v_hi - v_lo) / (f_hi - f_lo);
+        if ( fabs(v_next - v) < 1e-9 ) {
+          v = v_next;
+          break;
+        }
+        v = v_next;
+      }
+
+      // The sample follows from the point in that line's camera frame
+      double t = line_time(v);
+      Vector3 cam = m_pose_func(t).rotation_matrix() * (point - m_position_func(t));
+      double depth = dot_prod( cam, m_pointing_vec );
+      if ( depth <= 0 )
+        vw_throw( PointToPixelErr() << "LinescanModel: point is behind the camera." );
+      double u = m_focal_length * dot_prod( cam, m_u_vec ) / depth / m_across_scan_pixel_size - m_sample_offset;
+      return Vector2( u, v );
     }
 
+    /// Evaluates the position and pose functions once for every
+    /// scanline and keeps them with the camera, so point_to_pixel()
+    /// reads them instead while it searches for the line.  The cache
+    /// is read-only once built and shared by copies of the camera;
+    /// set_line_times() drops it.
+    void build_line_cache() {
+      boost::shared_ptr<LineCache> cache( new LineCache );
+      cache->positions.resize( m_line_times.size() );
+      cache->rotations.resize( m_line_times.size() );
+      for ( size_t i = 0; i < m_line_times.size(); i++ ) {
+        cache->positions[i] = m_position_func( m_line_times[i] );
+        cache->rotations[i] = m_pose_func( m_line_times[i] ).rotation_matrix();
+      }
+      m_line_cache = cache;
+    }
+    void clear_line_cache() { m_line_cache.reset(); }
+    bool has_line_cache() const { return bool(m_line_cache); }
+
     /// Given a pixel in image coordinates, what is the pointing
     /// vector in 3-space if you apply the camera model.
     ///
@@ -166,6 +274,41 @@ namespace camera {
       return normalize(rotation_matrix * pixel_direction);
     }
 
+    /// Every pixel on one scanline shares a pose and a position, so
+    /// the batch form only asks the pose and position functions again
+    /// when the line time changes.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& vectors) const {
+      centers.clear();
+      vectors.clear();
+      centers.reserve(pixels.size());
+      vectors.reserve(pixels.size());
+
+      Vector3 focal_vec = m_focal_length * m_pointing_vec;
+      double last_time = 0;
+      Matrix<double,3,3> rotation_matrix;
+      Vector3 position;
+      for (size_t i = 0; i < pixels.size(); i++) {
+        Vector2 const& pix = pixels[i];
+        if (int(round(pix[1])) < 0 || int(round(pix[1])) >= int(m_line_times.size()))
+          vw_throw( PixelToRayErr() << "LinescanModel: requested pixel " << pix << " is not on a valid scanline." );
+
+        int y = int(floor(pix[1]));
+        double normy = pix[1] - y;
+        double approx_line_time = double( m_line_times[y] + (m_line_times[y+1] - m_line_times[y]) * normy );
+        if (i == 0 || approx_line_time != last_time) {
+          rotation_matrix = transpose(m_pose_func(approx_line_time).rotation_matrix());
+          position = m_position_func(approx_line_time);
+          last_time = approx_line_time;
+        }
+
+        double pixel_pos_u = (pix[0] + m_sample_offset) * m_across_scan_pixel_size;
+        vectors.push_back( normalize(rotation_matrix * (pixel_pos_u * m_u_vec + focal_vec)) );
+        centers.push_back( position );
+      }
+    }
+
     virtual Vector3 camera_center(Vector2 const& pix = Vector2() ) const {
       // Check to make sure that this is a valid pixel
       if (int(round(pix[1])) < 0 || int(round(pix[1])) >= int(m_line_times.size()))
@@ -219,7 +362,7 @@ namespace camera {
     virtual void set_along_scan_pixel_size(double val) { m_along_scan_pixel_size = val; }
     virtual void set_across_scan_pixel_size(double val) {m_across_scan_pixel_size = val; }
     virtual void set_focal_length(double val) {m_focal_length = val; }
-    virtual void set_line_times(std::vector<double> val) { m_line_times = val; }
+    virtual void set_line_times(std::vector<double> val) { m_line_times = val; m_line_cache.reset(); }
   };
 
   /// Output stream method for printing a summary of the linear
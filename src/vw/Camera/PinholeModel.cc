@@ -26,6 +26,34 @@ namespace fs = boost::filesystem;
 
 using namespace vw;
 
+// A grid of offsets from the pitch-scaled pixel to its undistorted
+// location. It keeps the lens model and intrinsics it was sampled
+// with, so a camera whose lens has since changed can tell the grid is
+// stale.
+struct camera::PinholeModel::UndistortionTable {
+  boost::shared_ptr<const LensDistortion> distortion;
+  double fu, fv, cu, cv, pitch;
+  int32 spacing, cols, rows;
+  std::vector<Vector2> offsets;
+
+  bool matches(boost::shared_ptr<const LensDistortion> const& d,
+               double f_u, double f_v, double c_u, double c_v, double p) const {
+    return d == distortion && f_u == fu && f_v == fv &&
+      c_u == cu && c_v == cv && p == pitch;
+  }
+
+  bool lookup(Vector2 const& pix, Vector2& result) const {
+    double x = pix[0] / spacing, y = pix[1] / spacing;
+    int32 i = int32(floor(x)), j = int32(floor(y));
+    if (i < 0 || j < 0 || i >= cols-1 || j >= rows-1)
+      return false;
+    double a = x - i, b = y - j;
+    Vector2 const* o = &offsets[j*cols + i];
+    result = pix*pitch + (1-b)*((1-a)*o[0] + a*o[1]) + b*((1-a)*o[cols] + a*o[cols+1]);
+    return true;
+  }
+};
+
 // Old deprecated format of Pinhole I/O. Didn't support all distortion options.
 // Reads in a file containing parameters of a pinhole model with
 // a tsai lens distortion model. An example is provided at the end of this file.
@@ -288,6 +316,43 @@ Vector2 camera::PinholeModel::point_to_pixel(Vector3 const& point) const {
   return m_distortion->distorted_coordinates(*this, pixel)/m_pixel_pitch;
 }
 
+Vector2 camera::PinholeModel::point_to_pixel_jacobian(Vector3 const& point,
+                                                      Matrix<double,2,3>& jacobian) const {
+  double denominator = m_camera_matrix(2,0)*point(0) + m_camera_matrix(2,1)*point(1) +
+    m_camera_matrix(2,2)*point(2) + m_camera_matrix(2,3);
+  Vector2 pixel = Vector2( (m_camera_matrix(0,0)*point(0) + m_camera_matrix(0,1)*point(1) +
+                            m_camera_matrix(0,2)*point(2) + m_camera_matrix(0,3)) / denominator,
+                           (m_camera_matrix(1,0)*point(0) + m_camera_matrix(1,1)*point(1) +
+                            m_camera_matrix(1,2)*point(2) + m_camera_matrix(1,3)) / denominator);
+
+  // d(row_k.X / row_2.X)/dX = (row_k - pixel_k*row_2) / row_2.X
+  Matrix<double,2,3> undistorted_jacobian;
+  for (size_t n = 0; n < 3; n++) {
+    undistorted_jacobian(0,n) = (m_camera_matrix(0,n) - pixel[0]*m_camera_matrix(2,n)) / denominator;
+    undistorted_jacobian(1,n) = (m_camera_matrix(1,n) - pixel[1]*m_camera_matrix(2,n)) / denominator;
+  }
+
+  jacobian = m_distortion->distortion_jacobian(*this, pixel) * undistorted_jacobian / m_pixel_pitch;
+  return m_distortion->distorted_coordinates(*this, pixel)/m_pixel_pitch;
+}
+
+void camera::PinholeModel::points_to_pixels(std::vector<Vector3> const& points,
+                                            std::vector<Vector2>& pixels) const {
+  pixels.clear();
+  pixels.reserve(points.size());
+  bool distorted = dynamic_cast<NullLensDistortion const*>(m_distortion.get()) == 0;
+  Matrix<double,3,4> const& m = m_camera_matrix;
+  for (size_t i = 0; i < points.size(); i++) {
+    Vector3 const& x = points[i];
+    double denominator = m(2,0)*x(0) + m(2,1)*x(1) + m(2,2)*x(2) + m(2,3);
+    Vector2 pixel( (m(0,0)*x(0) + m(0,1)*x(1) + m(0,2)*x(2) + m(0,3)) / denominator,
+                   (m(1,0)*x(0) + m(1,1)*x(1) + m(1,2)*x(2) + m(1,3)) / denominator );
+    if (distorted)
+      pixel = m_distortion->distorted_coordinates(*this, pixel);
+    pixels.push_back(pixel/m_pixel_pitch);
+  }
+}
+
 bool camera::PinholeModel::projection_valid(Vector3 const& point) const {
   // z coordinate after extrinsic transformation
   double z = m_extrinsics(2, 0)*point(0) + m_extrinsics(2, 1)*point(1) +
@@ -295,9 +360,44 @@ bool camera::PinholeModel::projection_valid(Vector3 const& point) const {
   return z > 0;
 }
 
+void camera::PinholeModel::build_undistortion_table( Vector2i const& image_size, int32 spacing ) {
+  VW_ASSERT( spacing > 0, ArgumentErr() << "PinholeModel::build_undistortion_table: spacing must be positive." );
+  m_undistortion_table.reset();
+  if ( dynamic_cast<NullLensDistortion const*>(m_distortion.get()) )
+    return;
+
+  boost::shared_ptr<UndistortionTable> table( new UndistortionTable );
+  table->distortion = m_distortion;
+  table->fu = m_fu; table->fv = m_fv; table->cu = m_cu; table->cv = m_cv;
+  table->pitch = m_pixel_pitch;
+  table->spacing = spacing;
+  table->cols = (image_size[0] + spacing - 1) / spacing + 1;
+  table->rows = (image_size[1] + spacing - 1) / spacing + 1;
+  table->offsets.resize( table->cols * table->rows );
+  for ( int32 j = 0; j < table->rows; j++ ) {
+    for ( int32 i = 0; i < table->cols; i++ ) {
+      Vector2 p = Vector2( i*spacing, j*spacing ) * m_pixel_pitch;
+      table->offsets[j*table->cols + i] = m_distortion->undistorted_coordinates(*this, p) - p;
+    }
+  }
+  m_undistortion_table = table;
+}
+
+bool camera::PinholeModel::has_undistortion_table() const {
+  return m_undistortion_table &&
+    m_undistortion_table->matches(m_distortion, m_fu, m_fv, m_cu, m_cv, m_pixel_pitch);
+}
+
+Vector2 camera::PinholeModel::undistorted_pixel(Vector2 const& pix) const {
+  Vector2 result;
+  if ( has_undistortion_table() && m_undistortion_table->lookup(pix, result) )
+    return result;
+  return m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+}
+
 Vector3 camera::PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   // Apply the inverse lens distortion model
-  Vector2 undistorted_pix = m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+  Vector2 undistorted_pix = undistorted_pixel(pix);
 
   // Compute the direction of the ray emanating from the camera center.
   Vector3 p(0,0,1);
@@ -305,6 +405,28 @@ Vector3 camera::PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   return normalize( m_inv_camera_transform * p);
 }
 
+void camera::PinholeModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                          std::vector<Vector3>& centers,
+                                          std::vector<Vector3>& vectors) const {
+  centers.assign(pixels.size(), m_camera_center);
+  vectors.clear();
+  vectors.reserve(pixels.size());
+  bool distorted = dynamic_cast<NullLensDistortion const*>(m_distortion.get()) == 0;
+  UndistortionTable const* table = has_undistortion_table() ? m_undistortion_table.get() : 0;
+  Matrix<double,3,3> const& m = m_inv_camera_transform;
+  for (size_t i = 0; i < pixels.size(); i++) {
+    Vector2 p;
+    if (!distorted)
+      p = pixels[i]*m_pixel_pitch;
+    else if (!table || !table->lookup(pixels[i], p))
+      p = m_distortion->undistorted_coordinates(*this, pixels[i]*m_pixel_pitch);
+    Vector3 dir( m(0,0)*p[0] + m(0,1)*p[1] + m(0,2),
+                 m(1,0)*p[0] + m(1,1)*p[1] + m(1,2),
+                 m(2,0)*p[0] + m(2,1)*p[1] + m(2,2) );
+    vectors.push_back(normalize(dir));
+  }
+}
+
 void camera::PinholeModel::intrinsic_parameters(double& f_u, double& f_v,
                                                 double& c_u, double& c_v) const {
   f_u = m_fu;  f_v = m_fv;  c_u = m_cu;  c_v = m_cv;
@@ -103,6 +103,11 @@ namespace camera {
     // Cached values for pixel_to_vector
     Matrix<double,3,3> m_inv_camera_transform;
 
+    // Optional grid of undistorted positions, see
+    // build_undistortion_table().
+    struct UndistortionTable;
+    boost::shared_ptr<const UndistortionTable> m_undistortion_table;
+
   public:
     //------------------------------------------------------------------
     // Constructors / Destructors
@@ -240,6 +245,16 @@ namespace camera {
     //  point appears in the image.
     virtual Vector2 point_to_pixel(Vector3 const& point) const;
 
+    // Differentiates the camera matrix in closed form and chains the
+    // lens model's distortion_jacobian() onto it.
+    virtual Vector2 point_to_pixel_jacobian(Vector3 const& point,
+                                            Matrix<double,2,3>& jacobian) const;
+
+    // Reads the camera matrix once for the batch, and skips the lens
+    // model when it has no distortion.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>& pixels) const;
+
     // Is a valid projection of point is possible?
     // This is equal to: Is the point in front of the camera (z > 0)
     // after extinsic transformation?
@@ -249,6 +264,12 @@ namespace camera {
     //  through the position of the pixel 'pix' on the image plane.
     virtual Vector3 pixel_to_vector (Vector2 const& pix) const;
 
+    // The center is shared by every pixel, and the rays skip the
+    // lens model when it has no distortion.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>& centers,
+                                std::vector<Vector3>& vectors) const;
+
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const {
       return m_camera_center;
     };
@@ -320,6 +341,18 @@ namespace camera {
     double pixel_pitch() const { return m_pixel_pitch; }
     void set_pixel_pitch( double pitch ) { m_pixel_pitch = pitch; }
 
+    /// Samples the lens model's undistorted_coordinates() every
+    /// 'spacing' pixels over an image of 'image_size' and keeps the
+    /// grid with the camera.  pixel_to_vector() and pixels_to_rays()
+    /// then interpolate it bilinearly instead of inverting the lens
+    /// model by iteration.  The grid is read-only once built, so
+    /// threads and copies of the camera share it.  It is ignored as
+    /// soon as the lens model, intrinsics or pixel pitch change, and
+    /// pixels off the grid take the iterative path.
+    void build_undistortion_table( Vector2i const& image_size, int32 spacing = 4 );
+    void clear_undistortion_table() { m_undistortion_table.reset(); }
+    bool has_undistortion_table() const;
+
     // Ingest camera matrix
     // This performs a camera matrix decomposition and rewrites most variables
     void set_camera_matrix( Matrix<double,3,4> const& p );
@@ -331,6 +364,10 @@ namespace camera {
   private:
     /// This must be called whenever camera parameters are modified.
     void rebuild_camera_matrix();
+
+    // undistorted_coordinates() of pix*m_pixel_pitch, from the
+    // undistortion table when it covers 'pix'.
+    Vector2 undistorted_pixel(Vector2 const& pix) const;
   };
 
   //   /// Given two pinhole camera models, this method returns two new camera
@@ -89,3 +89,82 @@ TEST( AdjustedCameraModel, AdjustedConstruct ) {
     acos(dot_prod(Vector3(0,0,1),inverse(center_pose).rotate(adjcam2.pixel_to_vector(center_pixel))));
   EXPECT_LT( angle_from_z, 0.5 );
 }
+
+TEST( AdjustedCameraModel, PixelsToRays ) {
+  Matrix<double,3,3> pose = math::euler_to_rotation_matrix(0.3,-0.2,1.1,"xyz");
+  boost::shared_ptr<CameraModel> pinhole(
+      new PinholeModel( Vector3(5,-2,1), pose, 500,500, 500,500,
+                        NullLensDistortion()) );
+  AdjustedCameraModel adjcam( pinhole, Vector3(1,2,3),
+                              math::euler_to_quaternion(0.1,0.2,-0.3,"xyz") );
+
+  std::vector<Vector2> pixels;
+  for ( int i = 0; i < 20; i++ )
+    pixels.push_back( Vector2( 50*i, 1000-30*i ) );
+  std::vector<Vector3> centers, vectors;
+  adjcam.pixels_to_rays( pixels, centers, vectors );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  ASSERT_EQ( pixels.size(), centers.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( adjcam.camera_center( pixels[i] ), centers[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( adjcam.pixel_to_vector( pixels[i] ), vectors[i], 1e-12 );
+  }
+}
+
+TEST( AdjustedCameraModel, AdjustmentJacobian ) {
+  Matrix<double,3,3> pose = math::euler_to_rotation_matrix(0.3,-0.2,1.1,"xyz");
+  boost::shared_ptr<CameraModel> pinhole(
+      new PinholeModel( Vector3(5,-2,1), pose, 500,500, 500,500,
+                        NullLensDistortion()) );
+  Vector3 translation(0.1,0.2,-0.3);
+  Quat rotation = math::euler_to_quaternion(0.01,0.02,-0.03,"xyz");
+  AdjustedCameraModel adjcam( pinhole, translation, rotation );
+
+  Vector3 point = Vector3(5,-2,1) + 20*pose*Vector3(0.2,-0.1,1);
+  Matrix<double,2,3> J_point, J_translation, J_rotation;
+  Vector2 pixel = adjcam.point_to_pixel_jacobian( point, J_point );
+  EXPECT_VECTOR_NEAR( adjcam.point_to_pixel(point), pixel, 1e-12 );
+  EXPECT_VECTOR_NEAR( pixel, adjcam.adjustment_jacobian( point, J_translation,
+                                                        J_rotation ), 1e-12 );
+
+  // Central differences against each kind of change
+  double eps = 1e-6;
+  for ( size_t n = 0; n < 3; n++ ) {
+    Vector3 step;
+    step[n] = eps;
+
+    Vector2 numeric = ( adjcam.point_to_pixel(point+step) -
+                        adjcam.point_to_pixel(point-step) ) / (2*eps);
+    EXPECT_VECTOR_NEAR( numeric, select_col(J_point,n), 1e-4 );
+
+    AdjustedCameraModel plus( pinhole, translation+step, rotation );
+    AdjustedCameraModel minus( pinhole, translation-step, rotation );
+    numeric = ( plus.point_to_pixel(point) - minus.point_to_pixel(point) ) / (2*eps);
+    EXPECT_VECTOR_NEAR( numeric, select_col(J_translation,n), 1e-4 );
+
+    plus.set_rotation( rotation*axis_angle_to_quaternion(step) );
+    minus.set_rotation( rotation*axis_angle_to_quaternion(-step) );
+    plus.set_translation( translation );
+    minus.set_translation( translation );
+    numeric = ( plus.point_to_pixel(point) - minus.point_to_pixel(point) ) / (2*eps);
+    EXPECT_VECTOR_NEAR( numeric, select_col(J_rotation,n), 1e-3 );
+  }
+}
+
+TEST( AdjustedCameraModel, PointsToPixels ) {
+  Matrix<double,3,3> pose = math::euler_to_rotation_matrix(0.3,-0.2,1.1,"xyz");
+  boost::shared_ptr<CameraModel> pinhole(
+      new PinholeModel( Vector3(5,-2,1), pose, 500,500, 500,500,
+                        NullLensDistortion()) );
+  AdjustedCameraModel adjcam( pinhole, Vector3(1,2,3),
+                              math::euler_to_quaternion(0.1,0.2,-0.3,"xyz") );
+
+  std::vector<Vector3> points;
+  for ( int i = 0; i < 20; i++ )
+    points.push_back( Vector3(5,-2,1) + pose*Vector3( 0.3*i-3, 2-0.2*i, 40+i ) );
+  std::vector<Vector2> pixels;
+  adjcam.points_to_pixels( points, pixels );
+  ASSERT_EQ( points.size(), pixels.size() );
+  for ( size_t i = 0; i < points.size(); i++ )
+    EXPECT_VECTOR_NEAR( adjcam.point_to_pixel( points[i] ), pixels[i], 1e-9 );
+}
@@ -0,0 +1,98 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/Camera/BayerFilter.h>
+#include <vw/Image/BlockRasterize.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::camera;
+using namespace vw::test;
+
+namespace {
+  // Each channel is a different linear ramp, sampled through an RGGB
+  // mosaic.
+  PixelRGB<float> ramp( int32 x, int32 y ) {
+    return PixelRGB<float>( 10 + 2*x + y, 50 - x + 3*y, 20 + 0.5f*x - 0.25f*y );
+  }
+
+  ImageView<PixelGray<float> > mosaic( int32 cols, int32 rows ) {
+    ImageView<PixelGray<float> > image( cols, rows );
+    for ( int32 y = 0; y < rows; ++y )
+      for ( int32 x = 0; x < cols; ++x ) {
+        PixelRGB<float> p = ramp(x,y);
+        int32 channel = (y%2 == 0) ? (x%2 == 0 ? 0 : 1) : (x%2 == 0 ? 1 : 2);
+        image(x,y) = p[channel];
+      }
+    return image;
+  }
+}
+
+TEST( BayerFilter, LinearRamp ) {
+  ImageView<PixelGray<float> > image = mosaic(17,12);
+  ImageView<PixelRGB<float> > bilinear = bayer_demosaic(image);
+  ImageView<PixelRGB<float> > malvar = bayer_demosaic_malvar(image);
+  ASSERT_EQ( bilinear.cols(), 17 );
+  ASSERT_EQ( bilinear.rows(), 12 );
+
+  // Both filters reproduce linear ramps exactly away from the edges.
+  for ( int32 y = 2; y < image.rows()-2; ++y )
+    for ( int32 x = 2; x < image.cols()-2; ++x ) {
+      EXPECT_PIXEL_NEAR( ramp(x,y), bilinear(x,y), 1e-4 );
+      EXPECT_PIXEL_NEAR( ramp(x,y), malvar(x,y), 1e-4 );
+    }
+
+  // The measured channel is always passed through.
+  EXPECT_EQ( image(0,0).v(), malvar(0,0).r() );
+  EXPECT_EQ( image(1,0).v(), malvar(1,0).g() );
+  EXPECT_EQ( image(5,3).v(), malvar(5,3).b() );
+}
+
+TEST( BayerFilter, MatchesInverseBayerFilter ) {
+  ImageView<PixelGray<float> > image = mosaic(12,10);
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      image(x,y) = image(x,y).v() + float((x*7+y*13)%5);
+  ImageView<PixelRGB<float> > legacy = inverse_bayer_filter(image);
+  ImageView<PixelRGB<float> > view = bayer_demosaic(image);
+
+  // inverse_bayer_filter() is offset by one pixel.
+  for ( int32 y = 0; y < image.rows()-2; ++y )
+    for ( int32 x = 0; x < image.cols()-2; ++x )
+      EXPECT_PIXEL_NEAR( legacy(x,y), view(x+1,y+1), 1e-4 );
+}
+
+TEST( BayerFilter, Blocks ) {
+  ImageView<PixelGray<float> > image = mosaic(37,29);
+  ImageView<PixelRGB<float> > whole = bayer_demosaic_malvar(image);
+  ImageView<PixelRGB<float> > blocks = block_rasterize( bayer_demosaic_malvar(image), Vector2i(5,7), 4 );
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      EXPECT_PIXEL_NEAR( whole(x,y), blocks(x,y), 1e-6 );
+}
+
+TEST( BayerFilter, IntegerChannels ) {
+  // A saturated checker drives Malvar's correction terms out of
+  // range; integer channels must round and clamp rather than wrap.
+  ImageView<PixelGray<uint8> > image(8,8);
+  ImageView<PixelGray<float> > fimage(8,8);
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x ) {
+      image(x,y) = ((x/2+y/2)%2) ? 255 : 0;
+      fimage(x,y) = image(x,y).v();
+    }
+  ImageView<PixelRGB<uint8> > result = bayer_demosaic_malvar(image);
+  ImageView<PixelRGB<float> > expected = bayer_demosaic_malvar(fimage);
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      for ( int32 c = 0; c < 3; ++c ) {
+        float e = std::min( 255.f, std::max( 0.f, std::floor( expected(x,y)[c] + 0.5f ) ) );
+        EXPECT_EQ( e, float(result(x,y)[c]) );
+      }
+}
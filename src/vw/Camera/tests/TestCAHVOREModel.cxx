@@ -84,3 +84,37 @@ TEST( CAHVOREModel, Linearize ) {
   EXPECT_VECTOR_NEAR(Vector3(177.463,13.6499,548.543),
                      cahv.V, 1e-2);
 }
+
+TEST( CAHVOREModel, ProjectionTable ) {
+  CAHVOREModel cahvore(Vector3(0.606185,-0.043367,-0.234891),
+                       Vector3(0.712013,0.037316,0.701174),
+                       Vector3(353.341,474.873,350.82),
+                       Vector3(44.0102,16.904,683.916),
+                       Vector3(0.712953,0.038186,0.700171),
+                       Vector3(3e-06,-0.013032,-0.00754),
+                       Vector3(0.000942,0.00228,0.001613),
+                       3, 0.37 );
+  CAHVOREModel fast = cahvore;
+  fast.build_projection_table( Vector2i(1024,1024), 0.5 );
+  EXPECT_TRUE( fast.has_projection_table() );
+
+  for ( uint32 i = 100; i < 901; i += 200 ) {
+    for ( uint32 j = 100; j < 901; j+= 200 ) {
+      Vector3 unit = cahvore.pixel_to_vector( Vector2(i,j) );
+      for ( double range = 0.6; range < 100; range *= 3 ) {
+        Vector3 point = cahvore.C + range*unit;
+        EXPECT_VECTOR_NEAR( cahvore.point_to_pixel( point ),
+                            fast.point_to_pixel( point ), 1e-6 );
+      }
+    }
+  }
+
+  // A looser tolerance still lands within it
+  fast.set_pixel_tolerance( 0.01 );
+  Vector3 point = cahvore.C + 2*cahvore.pixel_to_vector( Vector2(850,120) );
+  EXPECT_VECTOR_NEAR( cahvore.point_to_pixel( point ),
+                      fast.point_to_pixel( point ), 0.01 );
+
+  fast.E[0] *= 2;
+  EXPECT_FALSE( fast.has_projection_table() );
+}
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include <vw/Camera/CAHVORModel.h>
+#include <vw/Camera/CameraTransform.h>
 #include <vw/Math/Vector.h>
 #include <test/Helpers.h>
 
@@ -166,3 +167,27 @@ TEST( CAHVORModel, ForwardReverse) {
     }
   }
 }
+
+TEST( CAHVORModel, ApproximateTransform ) {
+  CAHVORModel cahvor(Vector3(0.606185,-0.043367,-0.234891),
+                     Vector3(0.712013,0.037316,0.701174),
+                     Vector3(353.341,474.873,350.82),
+                     Vector3(44.0102,16.904,683.916),
+                     Vector3(0.712953,0.038186,0.700171),
+                     Vector3(3e-06,-0.013032,-0.00754));
+  CAHVModel cahv = linearize_camera(cahvor, Vector2i(1024,1024),
+                                    Vector2i(1024,1024));
+
+  CameraTransform<CAHVORModel,CAHVModel> exact( cahvor, cahv );
+  CameraTransform<CAHVORModel,CAHVModel> ctx( cahvor, cahv, 0.05 );
+  EXPECT_EQ( exact.tolerance(), 0.0 );
+  EXPECT_EQ( ctx.tolerance(), 0.05 );
+
+  BBox2i bbox(0,0,256,256);
+  ApproximateTransform<CameraTransform<CAHVORModel,CAHVModel> > approx( ctx, bbox );
+  EXPECT_LT( approx.num_cells(), size_t(bbox.width()*bbox.height()/64) );
+  for ( int32 y = bbox.min().y(); y < bbox.max().y(); y += 3 )
+    for ( int32 x = bbox.min().x(); x < bbox.max().x(); x += 3 )
+      EXPECT_VECTOR_NEAR( exact.reverse(Vector2(x,y)),
+                          approx.reverse(Vector2(x,y)), 0.1 );
+}
@@ -68,3 +68,48 @@ TEST( LinearPushbroom, PixelToVector ) {
     acos(dot_prod(Vector3(0,0,1),inverse(center_pose).rotate(cam.pixel_to_vector(center_pixel))));
   EXPECT_LT( angle_from_z, 0.5 );
 }
+
+TEST( LinearPushbroom, PixelsToRays ) {
+  LinearPushbroomModel cam(10.0, 1000, 1024, -512, 1.0, 0.01, 0.01,
+                           Vector3(0,0,1), Vector3(0,1,0),
+                           Quaternion<double>(0,0,0,1),
+                           Vector3(0,0,1), Vector3(1,0,0));
+
+  std::vector<Vector2> pixels;
+  for ( int32 j = 0; j < 900; j += 150 )
+    for ( int32 i = 0; i < 1024; i += 100 )
+      pixels.push_back( Vector2(i, j + 0.25) );
+
+  std::vector<Vector3> centers, vectors;
+  cam.pixels_to_rays( pixels, centers, vectors );
+  ASSERT_EQ( pixels.size(), centers.size() );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( cam.camera_center(pixels[i]), centers[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( cam.pixel_to_vector(pixels[i]), vectors[i], 1e-12 );
+  }
+}
+
+TEST( LinearPushbroom, PointToPixel ) {
+  LinearPushbroomModel cam(10.0, 1000, 1024, -512, 1.0, 0.01, 0.01,
+                           Vector3(0,0,1), Vector3(0,1,0),
+                           Quaternion<double>(0,0,0,1),
+                           Vector3(0,0,1), Vector3(1,0,0));
+  LinearPushbroomModel cached = cam;
+  cached.build_line_cache();
+  EXPECT_TRUE( cached.has_line_cache() );
+  EXPECT_FALSE( cam.has_line_cache() );
+
+  for ( int32 j = 10; j < 990; j += 140 ) {
+    for ( int32 i = 20; i < 1000; i += 150 ) {
+      Vector2 pix( i + 0.25, j + 0.5 );
+      Vector3 point = cam.camera_center(pix) + 20*cam.pixel_to_vector(pix);
+      EXPECT_VECTOR_NEAR( pix, cam.point_to_pixel(point), 1e-6 );
+      EXPECT_VECTOR_NEAR( pix, cached.point_to_pixel(point), 1e-6 );
+    }
+  }
+
+  // Off the end of the strip
+  Vector3 point = cam.camera_center(Vector2(0,0)) - Vector3(50,0,0);
+  EXPECT_THROW( cam.point_to_pixel(point), PointToPixelErr );
+}
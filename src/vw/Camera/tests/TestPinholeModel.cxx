@@ -104,6 +104,110 @@ TEST( PinholeModel, TsaiDistortion ) {
 #endif
 }
 
+TEST( PinholeModel, PixelsToRays ) {
+  Matrix<double,3,3> rot = vw::math::euler_to_quaternion(0.2, -0.3, 1.1, "xyz").rotation_matrix();
+  PinholeModel pinhole( Vector3(1,-2,3), rot,
+                        600,580, 510,490,
+                        NullLensDistortion() );
+
+  std::vector<Vector2> pixels;
+  for ( int32 j = 0; j < 1000; j += 111 )
+    for ( int32 i = 0; i < 1000; i += 97 )
+      pixels.push_back( Vector2(i,j) + Vector2(0.25,0.5) );
+
+  std::vector<Vector3> centers, vectors;
+  pinhole.pixels_to_rays( pixels, centers, vectors );
+  ASSERT_EQ( pixels.size(), centers.size() );
+  ASSERT_EQ( pixels.size(), vectors.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( pinhole.camera_center(pixels[i]), centers[i], 1e-12 );
+    EXPECT_VECTOR_NEAR( pinhole.pixel_to_vector(pixels[i]), vectors[i], 1e-12 );
+  }
+}
+
+TEST( PinholeModel, PointToPixelJacobian ) {
+  Matrix<double,3,3> rot = vw::math::euler_to_quaternion(0.2, -0.3, 1.1, "xyz").rotation_matrix();
+  PinholeModel pinhole( Vector3(1,-2,3), rot,
+                        600,580, 510,490,
+                        TsaiLensDistortion(Vector4(-0.2805362343788147,
+                                                   0.1062035113573074,
+                                                   -0.0001422458299202845,
+                                                   0.00116333004552871)) );
+
+  Vector3 point = Vector3(1,-2,3) + 10*rot*Vector3(0.1,-0.15,1);
+  Matrix<double,2,3> J;
+  Vector2 pixel = pinhole.point_to_pixel_jacobian( point, J );
+  EXPECT_VECTOR_NEAR( pinhole.point_to_pixel(point), pixel, 1e-12 );
+
+  // Central differences
+  for ( size_t n = 0; n < 3; n++ ) {
+    Vector3 step;
+    step[n] = 1e-5;
+    Vector2 numeric = ( pinhole.point_to_pixel(point+step) -
+                        pinhole.point_to_pixel(point-step) ) / 2e-5;
+    EXPECT_VECTOR_NEAR( numeric, select_col(J,n), 1e-4 );
+  }
+}
+
+TEST( PinholeModel, PointsToPixels ) {
+  Matrix<double,3,3> rot = vw::math::euler_to_quaternion(0.2, -0.3, 1.1, "xyz").rotation_matrix();
+  PinholeModel pinhole( Vector3(1,-2,3), rot,
+                        600,580, 510,490,
+                        TsaiLensDistortion(Vector4(-0.2805362343788147,
+                                                   0.1062035113573074,
+                                                   -0.0001422458299202845,
+                                                   0.00116333004552871)) );
+  pinhole.set_pixel_pitch( 0.5 );
+
+  std::vector<Vector3> points;
+  for ( int32 i = -4; i < 5; i++ )
+    for ( int32 j = -4; j < 5; j++ )
+      points.push_back( Vector3(1,-2,3) + rot*Vector3(0.1*i, 0.1*j, 10+i+j) );
+
+  std::vector<Vector2> pixels;
+  pinhole.points_to_pixels( points, pixels );
+  ASSERT_EQ( points.size(), pixels.size() );
+  for ( size_t i = 0; i < points.size(); i++ )
+    EXPECT_VECTOR_NEAR( pinhole.point_to_pixel(points[i]), pixels[i], 1e-12 );
+}
+
+#if defined(VW_HAVE_PKG_LAPACK) && VW_HAVE_PKG_LAPACK==1
+TEST( PinholeModel, UndistortionTable ) {
+  PinholeModel pinhole( Vector3(0,0,0), math::identity_matrix<3>(),
+                        500,500, 500,500,
+                        TsaiLensDistortion(Vector4(-0.2805362343788147,
+                                                   0.1062035113573074,
+                                                   -0.0001422458299202845,
+                                                   0.00116333004552871)) );
+  PinholeModel iterative = pinhole;
+  EXPECT_FALSE( pinhole.has_undistortion_table() );
+  pinhole.build_undistortion_table( Vector2i(1000,1000), 4 );
+  EXPECT_TRUE( pinhole.has_undistortion_table() );
+  EXPECT_FALSE( iterative.has_undistortion_table() );
+
+  std::vector<Vector2> pixels;
+  for ( int32 j = 3; j < 1000; j += 97 )
+    for ( int32 i = 5; i < 1000; i += 89 )
+      pixels.push_back( Vector2(i + 0.3, j + 0.7) );
+  pixels.push_back( Vector2(-20,1200) ); // off the grid
+
+  std::vector<Vector3> centers, vectors;
+  pinhole.pixels_to_rays( pixels, centers, vectors );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    Vector3 expected = iterative.pixel_to_vector( pixels[i] );
+    EXPECT_VECTOR_NEAR( expected, pinhole.pixel_to_vector( pixels[i] ), 2e-5 );
+    EXPECT_VECTOR_NEAR( expected, vectors[i], 2e-5 );
+  }
+
+  // Changing the intrinsics leaves the table stale
+  pinhole.set_focal_length( Vector2(600,600) );
+  EXPECT_FALSE( pinhole.has_undistortion_table() );
+  iterative.set_focal_length( Vector2(600,600) );
+  EXPECT_VECTOR_NEAR( iterative.pixel_to_vector( pixels[7] ),
+                      pinhole.pixel_to_vector( pixels[7] ), 1e-12 );
+}
+#endif
+
 TEST( PinholeModel, ScalePinhole ) {
   Matrix<double,3,3> rot = vw::math::euler_to_quaternion(1.15, 0.0, -1.57, "xyz").rotation_matrix();
   PinholeModel pinhole4(Vector3(-0.329, 0.065, -0.82),
@@ -58,28 +58,7 @@ BBox2 cartography::camera_bbox( cartography::GeoReference const& georef,
        camera_llr[0] > 90 )
     center_on_zero = false;
 
-  int32 step_amount = (2*cols+2*rows)/100;
-  detail::CameraDatumBBoxHelper functor( georef, camera_model,
-                                         center_on_zero );
-
-  // Running the edges
-  bresenham_apply( BresenhamLine(0,0,cols,0),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(cols-1,0,cols-1,rows),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(cols-1,rows-1,0,rows-1),
-                   step_amount, functor );
-  functor.last_valid = false;
-  bresenham_apply( BresenhamLine(0,rows-1,0,0),
-                   step_amount, functor );
-  functor.last_valid = false;
-
-  // Running once through the center
-  bresenham_apply( BresenhamLine(0,0,cols,rows),
-                   step_amount, functor );
-
-  scale = functor.scale/double(step_amount);
-  return functor.box;
+  detail::CameraDatumBBoxHelper helper( georef, camera_model,
+                                       center_on_zero );
+  return detail::camera_footprint_bbox( helper, cols, rows, scale );
 }
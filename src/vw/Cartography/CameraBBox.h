@@ -11,6 +11,8 @@
 #include <vw/config.h>
 #if defined(VW_HAVE_PKG_CAMERA) && (VW_HAVE_PKG_CAMERA==1)
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Interpolation.h>
@@ -18,9 +20,13 @@
 #include <vw/Camera/CameraModel.h>
 #include <vw/Cartography/SimplePointImageManipulation.h>
 #include <vw/Cartography/GeoReference.h>
-#include <vw/Cartography/detail/BresenhamLine.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 namespace vw {
 namespace cartography {
@@ -82,121 +88,245 @@ namespace cartography {
     }
   };
 
+  /// \cond INTERNAL
   namespace detail {
 
-    template <class FunctionT>
-    void bresenham_apply( BresenhamLine line, size_t step,
-                          FunctionT& f ) {
-      while ( line.is_good() ) {
-        f( *line );
-        for ( size_t i = 0; i < step; i++ )
-          ++line;
-      }
-    }
+    // One sample of a camera's footprint.  'datum' is where the ray
+    // meets the datum, 'raw' is the (possibly refined) intersection
+    // and 'point' is 'raw' with the longitude wrapped for the bbox.
+    struct CameraFootprintSample {
+      Vector2 pixel, datum, raw, point;
+      bool valid;
+      CameraFootprintSample() : valid(false) {}
+    };
 
+    // Intersects pixels with the datum.  Safe to call from several
+    // threads at once.
     class CameraDatumBBoxHelper {
       GeoReference m_georef;
       boost::shared_ptr<camera::CameraModel> m_camera;
       double m_z_scale;
-      Vector2 m_last_intersect;
+      bool m_center_on_zero;
 
     public:
-      bool last_valid, center_on_zero;
-      BBox2 box;
-      double scale;
-
       CameraDatumBBoxHelper( GeoReference const& georef,
                              boost::shared_ptr<camera::CameraModel> camera,
-                             bool center=false) : m_georef(georef), m_camera(camera), last_valid(false), center_on_zero(center), scale( std::numeric_limits<double>::max() ) {
+                             bool center=false) : m_georef(georef), m_camera(camera), m_center_on_zero(center) {
         m_z_scale = m_georef.datum().semi_major_axis() / m_georef.datum().semi_minor_axis();
       }
 
-      void operator() ( Vector2 pixel ) {
+      CameraFootprintSample operator()( Vector2 const& pixel,
+                                        CameraFootprintSample const* /*neighbor*/ ) const {
+        CameraFootprintSample sample;
+        sample.pixel = pixel;
         bool test_intersect;
-        Vector2 geospatial_point =
+        sample.datum =
           geospatial_intersect( pixel, m_georef, m_camera,
                                 m_z_scale, test_intersect );
-        if ( !test_intersect ) {
-          last_valid = false;
-          return;
-        }
-
-        if ( center_on_zero && geospatial_point[0] > 180 )
-          geospatial_point[0] -= 360.0;
-
-        if ( last_valid ) {
-          double current_scale =
-            norm_2( geospatial_point - m_last_intersect );
-          if ( current_scale < scale )
-            scale = current_scale;
-        }
-        m_last_intersect = geospatial_point;
-        box.grow( geospatial_point );
-        last_valid = true;
+        if ( !test_intersect )
+          return sample;
+
+        sample.raw = sample.point = sample.datum;
+        if ( m_center_on_zero && sample.point[0] > 180 )
+          sample.point[0] -= 360.0;
+        sample.valid = true;
+        return sample;
       }
     };
 
+    // Intersects pixels with the DEM, starting the solver from a
+    // neighboring sample when there is one.  Safe to call from
+    // several threads at once.
     template <class DEMImageT>
     class CameraDEMBBoxHelper {
       GeoReference m_georef;
       boost::shared_ptr<camera::CameraModel> m_camera;
-      DEMImageT m_dem;
+      DEMIntersectionLMA<DEMImageT> m_model;
       double m_z_scale;
-      Vector2 m_last_intersect;
+      bool m_center_on_zero;
 
     public:
-      bool last_valid, center_on_zero;
-      BBox2 box;
-      double scale;
-
       CameraDEMBBoxHelper( ImageViewBase<DEMImageT> const& dem_image,
                            GeoReference const& georef,
                            boost::shared_ptr<camera::CameraModel> camera,
-                           bool center=false ) : m_georef(georef), m_camera(camera), m_dem(dem_image.impl()), last_valid(false), center_on_zero(center), scale( std::numeric_limits<double>::max() ) {
+                           bool center=false ) : m_georef(georef), m_camera(camera), m_model(dem_image, georef, camera), m_center_on_zero(center) {
         m_z_scale = m_georef.datum().semi_major_axis() / m_georef.datum().semi_minor_axis();
       }
 
-      void operator() ( Vector2 pixel ) {
+      CameraFootprintSample operator()( Vector2 const& pixel,
+                                        CameraFootprintSample const* neighbor ) const {
+        CameraFootprintSample sample;
+        sample.pixel = pixel;
         bool test_intersect;
-        Vector2 geospatial_point =
+        sample.datum =
           geospatial_intersect( pixel, m_georef, m_camera,
                                 m_z_scale, test_intersect );
-        if ( !test_intersect ) {
-          last_valid = false;
-          return;
-        }
+        if ( !test_intersect )
+          return sample;
+
+        // Refining with more accurate intersection.  The neighbor's
+        // offset from the datum is usually a much better guess than
+        // the datum itself; fall back to the datum if it fails.
+        int status = -1;
+        if ( neighbor && neighbor->valid )
+          sample.raw = math::levenberg_marquardt( m_model, Vector2( neighbor->raw + sample.datum - neighbor->datum ),
+                                                  pixel, status, 1e-3 );
+        if ( status < 0 )
+          sample.raw = math::levenberg_marquardt( m_model, sample.datum,
+                                                  pixel, status, 1e-3 );
+        if ( status < 0 )
+          return sample;
+
+        sample.point = sample.raw;
+        if ( m_center_on_zero && sample.point[0] > 180 )
+          sample.point[0] -= 360.0;
+        else if ( m_center_on_zero && sample.point[0] < -180 )
+          sample.point[0] += 360.0;
+        else if ( !m_center_on_zero && sample.point[0] < 0 )
+          sample.point[0] += 360.0;
+        else if ( !m_center_on_zero && sample.point[0] > 360 )
+          sample.point[0] -= 360.0;
+        sample.valid = true;
+        return sample;
+      }
+    };
 
-        // Refining with more accurate intersection
-        DEMIntersectionLMA<DEMImageT> model( m_dem, m_georef, m_camera );
-        int status = 0;
-        geospatial_point = math::levenberg_marquardt( model, geospatial_point,
-                                                      pixel, status );
-        if ( status < 0 ) {
-          last_valid = false;
+    // Samples a line of pixels evenly, in order, so each sample can
+    // start from the one before it.
+    template <class HelperT>
+    struct CameraFootprintLineTask {
+      typedef void result_type;
+      HelperT const& helper;
+      Vector2 start, end;
+      std::vector<CameraFootprintSample>& samples;
+      CameraFootprintLineTask( HelperT const& helper, Vector2 const& start, Vector2 const& end,
+                               std::vector<CameraFootprintSample>& samples )
+        : helper(helper), start(start), end(end), samples(samples) {}
+      void operator()() const {
+        size_t spans = samples.size() - 1;
+        for ( size_t i = 0; i <= spans; i++ )
+          samples[i] = helper( start + ( end - start ) * ( double(i) / double(spans) ),
+                               i ? &samples[i-1] : 0 );
+      }
+    };
+
+    // Subdivides the span between two samples until the footprint is
+    // locally linear or the span is min_length pixels long, or a
+    // pixel long where it crosses the edge of the planet.  The new
+    // samples are appended to 'interior' in order.
+    template <class HelperT>
+    struct CameraFootprintSpanTask {
+      typedef void result_type;
+      HelperT const& helper;
+      CameraFootprintSample const& first;
+      CameraFootprintSample const& last;
+      double min_length;
+      std::vector<CameraFootprintSample>& interior;
+      CameraFootprintSpanTask( HelperT const& helper, CameraFootprintSample const& first,
+                               CameraFootprintSample const& last, double min_length,
+                               std::vector<CameraFootprintSample>& interior )
+        : helper(helper), first(first), last(last), min_length(min_length), interior(interior) {}
+
+      void refine( CameraFootprintSample const& a, CameraFootprintSample const& b ) const {
+        // Chase the limb of the planet down to a pixel; elsewhere
+        // stop at min_length.
+        if ( norm_2( b.pixel - a.pixel ) <= ( a.valid == b.valid ? min_length : 1.0 ) )
           return;
+        CameraFootprintSample mid = helper( ( a.pixel + b.pixel ) / 2, a.valid ? &a : &b );
+
+        // Stop where the three samples agree on validity and the
+        // midpoint lies within 1% of the chord's length from it.
+        if ( a.valid == b.valid && mid.valid == a.valid ) {
+          Vector2 chord = b.raw - a.raw, offset = mid.raw - a.raw;
+          if ( !mid.valid ||
+               fabs( chord[0] * offset[1] - chord[1] * offset[0] ) <= 0.01 * norm_2_sqr( chord ) ) {
+            interior.push_back( mid );
+            return;
+          }
         }
+        refine( a, mid );
+        interior.push_back( mid );
+        refine( mid, b );
+      }
 
-        if ( center_on_zero && geospatial_point[0] > 180 )
-          geospatial_point[0] -= 360.0;
-        else if ( center_on_zero && geospatial_point[0] < -180 )
-          geospatial_point[0] += 360.0;
-        else if ( !center_on_zero && geospatial_point[0] < 0 )
-          geospatial_point[0] += 360.0;
-        else if ( !center_on_zero && geospatial_point[0] > 360 )
-          geospatial_point[0] -= 360.0;
-
-        if ( last_valid ) {
-          double current_scale =
-            norm_2( geospatial_point - m_last_intersect );
-          if ( current_scale < scale )
-            scale = current_scale;
-        }
-        m_last_intersect = geospatial_point;
-        box.grow( geospatial_point );
-        last_valid = true;
+      void operator()() const {
+        interior.clear();
+        refine( first, last );
       }
     };
+
+    // Runs task on the queue, or right away when there is none.
+    template <class TaskT>
+    void camera_footprint_submit( FifoWorkQueue* queue, TaskT const& task,
+                                  std::vector<Future<void> >& futures ) {
+      if ( queue )
+        futures.push_back( queue->submit( task ) );
+      else
+        task();
+    }
+
+    // Walks the image edges and the diagonal, sampling each line
+    // coarsely and then refining only where the footprint bends or
+    // leaves the planet.  The result doesn't depend on the number of
+    // threads.
+    template <class HelperT>
+    BBox2 camera_footprint_bbox( HelperT const& helper, int32 cols, int32 rows, float& scale ) {
+      const size_t num_lines = 5, num_spans = 8;
+      Vector2 corners[4] = { Vector2(0,0), Vector2(cols-1,0),
+                             Vector2(cols-1,rows-1), Vector2(0,rows-1) };
+      // Never sample more finely than the old fixed step did.
+      double min_length = std::max( (2*cols+2*rows)/100, 1 );
+
+      boost::scoped_ptr<FifoWorkQueue> queue;
+      uint32 num_threads = vw_settings().default_num_threads();
+      if ( num_threads > 1 )
+        queue.reset( new FifoWorkQueue( num_threads ) );
+
+      std::vector<std::vector<CameraFootprintSample> > lines( num_lines, std::vector<CameraFootprintSample>( num_spans + 1 ) );
+      std::vector<Future<void> > futures;
+      for ( size_t i = 0; i < 4; i++ )
+        camera_footprint_submit( queue.get(), CameraFootprintLineTask<HelperT>( helper, corners[i], corners[(i+1)%4], lines[i] ), futures );
+      camera_footprint_submit( queue.get(), CameraFootprintLineTask<HelperT>( helper, corners[0], corners[2], lines[4] ), futures );
+      when_all( futures );
+
+      std::vector<std::vector<CameraFootprintSample> > interiors( num_lines * num_spans );
+      futures.clear();
+      for ( size_t i = 0; i < num_lines; i++ )
+        for ( size_t j = 0; j < num_spans; j++ )
+          camera_footprint_submit( queue.get(), CameraFootprintSpanTask<HelperT>( helper, lines[i][j], lines[i][j+1], min_length,
+                                                                                   interiors[i*num_spans+j] ), futures );
+      when_all( futures );
+
+      // Merge each line in order; scale is the smallest step in
+      // points per pixel between neighboring valid samples.
+      BBox2 box;
+      double min_scale = std::numeric_limits<double>::max();
+      for ( size_t i = 0; i < num_lines; i++ ) {
+        CameraFootprintSample const* prev = 0;
+        for ( size_t j = 0; j <= num_spans; j++ ) {
+          size_t count = j < num_spans ? interiors[i*num_spans+j].size() + 1 : 1;
+          for ( size_t k = 0; k < count; k++ ) {
+            CameraFootprintSample const& sample = k ? interiors[i*num_spans+j][k-1] : lines[i][j];
+            if ( !sample.valid ) {
+              prev = 0;
+              continue;
+            }
+            double length = prev ? norm_2( sample.pixel - prev->pixel ) : 0;
+            if ( length > 0 ) {
+              double current_scale = norm_2( sample.point - prev->point ) / length;
+              if ( current_scale < min_scale )
+                min_scale = current_scale;
+            }
+            box.grow( sample.point );
+            prev = &sample;
+          }
+        }
+      }
+      scale = min_scale;
+      return box;
+    }
   }
+  /// \endcond
 
   // Functions for Users
   //////////////////////////////////////////////////////
@@ -228,30 +358,9 @@ namespace cartography {
          camera_llr[0] > 90 )
       center_on_zero = false;
 
-    int32 step_amount = (2*cols+2*rows)/100;
-    detail::CameraDEMBBoxHelper<DEMImageT> functor( dem_image, georef, camera_model,
-                                                    center_on_zero );
-
-    // Running the edges
-    bresenham_apply( BresenhamLine(0,0,cols,0),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(cols-1,0,cols-1,rows),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(cols-1,rows-1,0,rows-1),
-                     step_amount, functor );
-    functor.last_valid = false;
-    bresenham_apply( BresenhamLine(0,rows-1,0,0),
-                     step_amount, functor );
-    functor.last_valid = false;
-
-    // Running once through the center
-    bresenham_apply( BresenhamLine(0,0,cols,rows),
-                     step_amount, functor );
-
-    scale = functor.scale/double(step_amount);
-    return functor.box;
+    detail::CameraDEMBBoxHelper<DEMImageT> helper( dem_image, georef, camera_model,
+                                                   center_on_zero );
+    return detail::camera_footprint_bbox( helper, cols, rows, scale );
   }
 
   template< class DEMImageT >
@@ -7,6 +7,12 @@
 
 #include <vw/Cartography/Datum.h>
 #include <vw/Math/Functions.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #if defined(VW_HAVE_PKG_PROTOBUF) && VW_HAVE_PKG_PROTOBUF==1
 #include <vw/Cartography/DatumDesc.pb.h>
@@ -310,6 +316,220 @@ vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& p
   return Vector3( lon - m_meridian_offset, atan(slat/fabs(clat))/(M_PI/180), alt );
 }
 
+namespace {
+
+  // pi/2 split for Cody-Waite range reduction, and the Cephes minimax
+  // polynomials for sin and cos on [-pi/4,pi/4].  Together they are
+  // good to about 2e-16 for arguments well under 1e6 radians.
+  const double pio2_1 = 1.5707962512969970703125;
+  const double pio2_2 = 7.54978941586159635335e-8;
+  const double pio2_3 = 5.39030285815811905290e-15;
+  const double sin_coeff[6] = {  1.58962301576546568060e-10, -2.50507477628578072866e-8,
+                                 2.75573136213857245213e-6,  -1.98412698295895385996e-4,
+                                 8.33333333332211858878e-3,  -1.66666666666666307295e-1 };
+  const double cos_coeff[6] = { -1.13585365213876817300e-11,  2.08757008419747316778e-9,
+                                -2.75573141792967388112e-7,   2.48015872888517045348e-5,
+                                -1.38888888888730564116e-3,   4.16666666666665929218e-2 };
+
+  inline void poly_sincos( double x, double& s, double& c ) {
+    double jd = floor( x * M_2_PI + 0.5 );
+    int j = int(jd);
+    double r = ((x - jd*pio2_1) - jd*pio2_2) - jd*pio2_3;
+    double z = r*r;
+    double ps = sin_coeff[0];
+    double pc = cos_coeff[0];
+    for ( int k = 1; k < 6; k++ ) {
+      ps = ps*z + sin_coeff[k];
+      pc = pc*z + cos_coeff[k];
+    }
+    ps = r + r*z*ps;
+    pc = 1.0 - 0.5*z + z*z*pc;
+    switch ( j & 3 ) {
+    case 0: s =  ps; c =  pc; break;
+    case 1: s =  pc; c = -ps; break;
+    case 2: s = -ps; c = -pc; break;
+    default: s = -pc; c = ps; break;
+    }
+  }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+  // Two lanes of poly_sincos().  The quadrant decides, per lane,
+  // whether sin and cos trade places and which of them change sign.
+  inline void poly_sincos( __m128d x, __m128d& s, __m128d& c ) {
+    __m128i j = _mm_cvtpd_epi32( _mm_mul_pd( x, _mm_set1_pd( M_2_PI ) ) );
+    __m128d jd = _mm_cvtepi32_pd( j );
+    __m128d r = _mm_sub_pd( x, _mm_mul_pd( jd, _mm_set1_pd( pio2_1 ) ) );
+    r = _mm_sub_pd( r, _mm_mul_pd( jd, _mm_set1_pd( pio2_2 ) ) );
+    r = _mm_sub_pd( r, _mm_mul_pd( jd, _mm_set1_pd( pio2_3 ) ) );
+    __m128d z = _mm_mul_pd( r, r );
+    __m128d ps = _mm_set1_pd( sin_coeff[0] );
+    __m128d pc = _mm_set1_pd( cos_coeff[0] );
+    for ( int k = 1; k < 6; k++ ) {
+      ps = _mm_add_pd( _mm_mul_pd( ps, z ), _mm_set1_pd( sin_coeff[k] ) );
+      pc = _mm_add_pd( _mm_mul_pd( pc, z ), _mm_set1_pd( cos_coeff[k] ) );
+    }
+    ps = _mm_add_pd( r, _mm_mul_pd( _mm_mul_pd( r, z ), ps ) );
+    pc = _mm_add_pd( _mm_sub_pd( _mm_set1_pd( 1.0 ), _mm_mul_pd( _mm_set1_pd( 0.5 ), z ) ),
+                     _mm_mul_pd( _mm_mul_pd( z, z ), pc ) );
+
+    // Each 64-bit lane holds its quadrant twice.
+    __m128i jj = _mm_shuffle_epi32( j, _MM_SHUFFLE(1,1,0,0) );
+    __m128d swap = _mm_castsi128_pd( _mm_cmpeq_epi32( _mm_and_si128( jj, _mm_set1_epi32(1) ), _mm_set1_epi32(1) ) );
+    __m128d sin_sign = _mm_castsi128_pd( _mm_slli_epi64( _mm_and_si128( jj, _mm_set1_epi32(2) ), 62 ) );
+    __m128d cos_sign = _mm_castsi128_pd( _mm_slli_epi64( _mm_and_si128( _mm_add_epi32( jj, _mm_set1_epi32(1) ),
+                                                                        _mm_set1_epi32(2) ), 62 ) );
+    s = _mm_xor_pd( _mm_or_pd( _mm_and_pd( swap, pc ), _mm_andnot_pd( swap, ps ) ), sin_sign );
+    c = _mm_xor_pd( _mm_or_pd( _mm_and_pd( swap, ps ), _mm_andnot_pd( swap, pc ) ), cos_sign );
+  }
+#endif
+
+  class GeodeticToCartesianRange {
+    double m_a, m_e2, m_offset;
+    vw::Vector3 const* m_in;
+    vw::Vector3* m_out;
+
+    inline void apply( size_t i ) const {
+      double lat = m_in[i][1];
+      if ( lat < -90 ) lat = -90;
+      if ( lat > 90 ) lat = 90;
+      double h = m_in[i][2];
+      double slat, clat, slon, clon;
+      poly_sincos( lat * (M_PI/180), slat, clat );
+      poly_sincos( (m_in[i][0] + m_offset) * (M_PI/180), slon, clon );
+      double radius = m_a / sqrt(1.0-m_e2*slat*slat);
+      m_out[i] = vw::Vector3( (radius+h) * clat * clon,
+                              (radius+h) * clat * slon,
+                              (radius*(1-m_e2)+h) * slat );
+    }
+
+  public:
+    GeodeticToCartesianRange( vw::cartography::Datum const& datum,
+                              vw::Vector3 const* in, vw::Vector3* out )
+      : m_a(datum.semi_major_axis()), m_offset(datum.meridian_offset()), m_in(in), m_out(out) {
+      double b = datum.semi_minor_axis();
+      m_e2 = (m_a*m_a - b*b) / (m_a*m_a);
+    }
+
+    void operator()( size_t begin, size_t end ) const {
+      size_t i = begin;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+      const __m128d to_rad = _mm_set1_pd( M_PI/180 );
+      const __m128d a = _mm_set1_pd( m_a ), e2 = _mm_set1_pd( m_e2 ), one = _mm_set1_pd( 1.0 );
+      for ( ; i + 1 < end; i += 2 ) {
+        __m128d lon = _mm_set_pd( m_in[i+1][0], m_in[i][0] );
+        __m128d lat = _mm_set_pd( m_in[i+1][1], m_in[i][1] );
+        __m128d h   = _mm_set_pd( m_in[i+1][2], m_in[i][2] );
+        lat = _mm_min_pd( _mm_max_pd( lat, _mm_set1_pd( -90.0 ) ), _mm_set1_pd( 90.0 ) );
+        __m128d slat, clat, slon, clon;
+        poly_sincos( _mm_mul_pd( lat, to_rad ), slat, clat );
+        poly_sincos( _mm_mul_pd( _mm_add_pd( lon, _mm_set1_pd( m_offset ) ), to_rad ), slon, clon );
+        __m128d radius = _mm_div_pd( a, _mm_sqrt_pd( _mm_sub_pd( one, _mm_mul_pd( e2, _mm_mul_pd( slat, slat ) ) ) ) );
+        __m128d rc = _mm_mul_pd( _mm_add_pd( radius, h ), clat );
+        __m128d x = _mm_mul_pd( rc, clon );
+        __m128d y = _mm_mul_pd( rc, slon );
+        __m128d z = _mm_mul_pd( _mm_add_pd( _mm_mul_pd( radius, _mm_sub_pd( one, e2 ) ), h ), slat );
+        _mm_storel_pd( &m_out[i][0], x );
+        _mm_storel_pd( &m_out[i][1], y );
+        _mm_storel_pd( &m_out[i][2], z );
+        _mm_storeh_pd( &m_out[i+1][0], x );
+        _mm_storeh_pd( &m_out[i+1][1], y );
+        _mm_storeh_pd( &m_out[i+1][2], z );
+      }
+#endif
+      for ( ; i < end; i++ )
+        apply( i );
+    }
+  };
+
+  // Vermeille, "Direct transformation from geocentric coordinates to
+  // geodetic coordinates", J. Geodesy 76 (2002).  The closed form
+  // needs r > 0, which holds everywhere except within about e^2*a of
+  // the center; there, and for prolate datums, this uses the
+  // iteration instead.
+  class CartesianToGeodeticRange {
+    vw::cartography::Datum const& m_datum;
+    double m_a, m_e2, m_e4, m_offset;
+    vw::Vector3 const* m_in;
+    vw::Vector3* m_out;
+
+  public:
+    CartesianToGeodeticRange( vw::cartography::Datum const& datum,
+                              vw::Vector3 const* in, vw::Vector3* out )
+      : m_datum(datum), m_a(datum.semi_major_axis()), m_offset(datum.meridian_offset()), m_in(in), m_out(out) {
+      double b = datum.semi_minor_axis();
+      m_e2 = (m_a*m_a - b*b) / (m_a*m_a);
+      m_e4 = m_e2*m_e2;
+    }
+
+    void operator()( size_t begin, size_t end ) const {
+      for ( size_t i = begin; i < end; i++ ) {
+        double x = m_in[i][0], y = m_in[i][1], z = m_in[i][2];
+        double normxy = sqrt( x*x + y*y );
+        double p = (normxy/m_a) * (normxy/m_a);
+        double q = (1-m_e2) * (z/m_a) * (z/m_a);
+        double r = (p + q - m_e4) / 6;
+        if ( !(r > 0) || m_e2 < 0 ) {
+          m_out[i] = m_datum.cartesian_to_geodetic( m_in[i] );
+          continue;
+        }
+        double s = m_e4 * p * q / (4*r*r*r);
+        double t = cbrt( 1 + s + sqrt( s*(2+s) ) );
+        double u = r * ( 1 + t + 1/t );
+        double v = sqrt( u*u + m_e4*q );
+        double w = m_e2 * ( u + v - q ) / ( 2*v );
+        double k = sqrt( u + v + w*w ) - w;
+        double d = k * normxy / ( k + m_e2 );
+        double dz = sqrt( d*d + z*z );
+        double lon = normxy/m_a < 1.0e-12 ? 0.0 : atan2( y, x ) / (M_PI/180);
+        m_out[i] = vw::Vector3( lon - m_offset,
+                                2 * atan2( z, d + dz ) / (M_PI/180),
+                                ( k + m_e2 - 1 ) / k * dz );
+      }
+    }
+  };
+
+  template <class FuncT>
+  struct DatumRangeTask {
+    typedef void result_type;
+    FuncT const& func;
+    size_t begin, end;
+    DatumRangeTask( FuncT const& func, size_t begin, size_t end )
+      : func(func), begin(begin), end(end) {}
+    void operator()() const { func( begin, end ); }
+  };
+
+  // Runs func over [0,count), split into ranges over the threads when
+  // the batch is large enough to be worth it.
+  template <class FuncT>
+  void for_each_datum_range( FuncT const& func, size_t count ) {
+    const size_t range_size = 4096;
+    vw::uint32 num_threads = vw::vw_settings().default_num_threads();
+    if ( num_threads < 2 || count <= range_size ) {
+      func( 0, count );
+      return;
+    }
+    vw::FifoWorkQueue queue( num_threads );
+    std::vector<vw::Future<void> > futures;
+    for ( size_t begin = 0; begin < count; begin += range_size )
+      futures.push_back( queue.submit( DatumRangeTask<FuncT>( func, begin, std::min( begin + range_size, count ) ) ) );
+    vw::when_all( futures );
+  }
+}
+
+void vw::cartography::Datum::geodetic_to_cartesian( std::vector<Vector3> const& llh, std::vector<Vector3>& xyz ) const {
+  xyz.resize( llh.size() );
+  if ( llh.empty() )
+    return;
+  for_each_datum_range( GeodeticToCartesianRange( *this, &llh[0], &xyz[0] ), llh.size() );
+}
+
+void vw::cartography::Datum::cartesian_to_geodetic( std::vector<Vector3> const& xyz, std::vector<Vector3>& llh ) const {
+  llh.resize( xyz.size() );
+  if ( xyz.empty() )
+    return;
+  for_each_datum_range( CartesianToGeodeticRange( *this, &xyz[0], &llh[0] ), xyz.size() );
+}
+
 std::ostream& vw::cartography::operator<<( std::ostream& os, vw::cartography::Datum const& datum ) {
   os << "Geodeditic Datum --> Name: " << datum.name() << "  Spheroid: " << datum.spheroid_name()
      << "  Semi-major: " << datum.semi_major_axis()
@@ -0,0 +1,37 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/DemGradient.h>
+
+#include <cmath>
+#include <algorithm>
+
+// For a geographic DEM, a degree of longitude spans the prime
+// vertical radius of curvature N times the cosine of the latitude,
+// and a degree of latitude the meridional radius M, where
+//
+//   N = a / sqrt(1 - e^2 sin^2 lat),   M = a (1 - e^2) / (1 - e^2 sin^2 lat)^(3/2)
+//
+// Each row is evaluated at the latitude of its pixel centers.
+std::vector<vw::Vector2> vw::cartography::dem_pixel_spacing( GeoReference const& georef, int32 rows ) {
+  std::vector<Vector2> spacing( std::max( rows, int32(1) ) );
+  Matrix3x3 const& M = georef.transform();
+  if( georef.is_projected() ) {
+    std::fill( spacing.begin(), spacing.end(), Vector2( M(0,0), M(1,1) ) );
+    return spacing;
+  }
+
+  double a = georef.datum().semi_major_axis(), b = georef.datum().semi_minor_axis();
+  double e2 = 1 - (b*b)/(a*a);
+  for( int32 j=0; j<int32(spacing.size()); ++j ) {
+    double lat = georef.pixel_to_lonlat( Vector2(0,j) ).y() * M_PI/180;
+    double s = sin(lat), w = 1 - e2*s*s;
+    double n = a / sqrt(w), m = a*(1-e2) / (w*sqrt(w));
+    spacing[j] = Vector2( M(0,0) * M_PI/180 * n * cos(lat), M(1,1) * M_PI/180 * m );
+  }
+  return spacing;
+}
@@ -0,0 +1,226 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DemGradient.h
+///
+/// Surface gradients of a DEM from finite differences over each
+/// pixel's 3x3 neighborhood, as used for hillshading and slope maps.
+///
+#ifndef __VW_CARTOGRAPHY_DEMGRADIENT_H__
+#define __VW_CARTOGRAPHY_DEMGRADIENT_H__
+
+#include <vector>
+#include <limits>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/config.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Cartography/GeoReference.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+#include <xmmintrin.h>
+#endif
+
+namespace vw {
+namespace cartography {
+
+  /// The finite difference stencils.  Each weighs the differences
+  /// across the three rows (or columns) of the neighborhood.
+  enum DemGradientMethod {
+    HornGradient,              ///< Horn (1981): weights 1,2,1
+    SharpnackAkinGradient,     ///< Sharpnack and Akin (1969): weights 1,1,1
+    ZevenbergenThorneGradient  ///< Zevenbergen and Thorne (1987): direct neighbors only
+  };
+
+  /// The signed ground distance covered by one pixel step in +x
+  /// (eastward) and +y (northward) for each row of a DEM with the
+  /// given georeference.  Geographic DEMs use the radii of curvature
+  /// of the datum at each row's latitude; projected ones the pixel
+  /// size in projected units.
+  std::vector<Vector2> dem_pixel_spacing( GeoReference const& georef, int32 rows );
+
+  namespace detail {
+
+    // The unscaled differences for one row of output pixels.  The
+    // three source rows each hold two more pixels than the output.
+    // Invalid source pixels are NaN, and poison any output that
+    // depends on them, including through the center pixel.
+    inline void dem_gradient_row( float const* r0, float const* r1, float const* r2,
+                                  float* dx, float* dy, int32 n, float corner, float edge ) {
+      int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+      const __m128 k = _mm_set1_ps(corner), w = _mm_set1_ps(edge);
+      for( ; i+4 <= n; i += 4 ) {
+        __m128 a = _mm_loadu_ps(r0+i), b = _mm_loadu_ps(r0+i+1), c = _mm_loadu_ps(r0+i+2);
+        __m128 d = _mm_loadu_ps(r1+i), e = _mm_loadu_ps(r1+i+1), f = _mm_loadu_ps(r1+i+2);
+        __m128 g = _mm_loadu_ps(r2+i), h = _mm_loadu_ps(r2+i+1), l = _mm_loadu_ps(r2+i+2);
+        __m128 center = _mm_sub_ps(e, e);
+        __m128 ex = _mm_add_ps(_mm_mul_ps(w, _mm_sub_ps(f, d)), center);
+        __m128 ey = _mm_add_ps(_mm_mul_ps(w, _mm_sub_ps(h, b)), center);
+        if( corner != 0 ) {
+          ex = _mm_add_ps(ex, _mm_mul_ps(k, _mm_sub_ps(_mm_add_ps(c, l), _mm_add_ps(a, g))));
+          ey = _mm_add_ps(ey, _mm_mul_ps(k, _mm_sub_ps(_mm_add_ps(g, l), _mm_add_ps(a, c))));
+        }
+        _mm_storeu_ps(dx+i, ex);
+        _mm_storeu_ps(dy+i, ey);
+      }
+#endif
+      for( ; i < n; ++i ) {
+        float center = r1[i+1] - r1[i+1];
+        dx[i] = edge*(r1[i+2] - r1[i]) + center;
+        dy[i] = edge*(r2[i+1] - r0[i+1]) + center;
+        if( corner != 0 ) {
+          dx[i] += corner*((r0[i+2] + r2[i+2]) - (r0[i] + r2[i]));
+          dy[i] += corner*((r2[i] + r2[i+2]) - (r0[i] + r0[i+2]));
+        }
+      }
+    }
+
+    inline void dem_gradient_weights( DemGradientMethod method, float& corner, float& edge ) {
+      switch( method ) {
+      case SharpnackAkinGradient:     corner = 1; edge = 1; break;
+      case ZevenbergenThorneGradient: corner = 0; edge = 1; break;
+      default:                        corner = 1; edge = 2; break;
+      }
+    }
+
+    template <class PixelT>
+    inline float dem_gradient_value( PixelT const& pix ) {
+      if( is_transparent(pix) ) return std::numeric_limits<float>::quiet_NaN();
+      return float( pix );
+    }
+
+  } // namespace detail
+
+  /// A view of the gradient of a DEM with respect to ground distance,
+  /// as the rate of change of elevation eastward and northward.
+  /// Pixels whose neighborhood includes invalid elevations are
+  /// invalid.  The DEM is extended past its edges by repeating its
+  /// border pixels.  Tiles are computed a row at a time from a
+  /// single rasterization of the DEM, so the view is best written out
+  /// with block_write_image().
+  template <class ImageT>
+  class DemGradientView : public ImageViewBase<DemGradientView<ImageT> > {
+    ImageT m_dem;
+    DemGradientMethod m_method;
+    boost::shared_ptr<std::vector<Vector2> > m_spacing;
+
+    template <class OtherT> friend class DemGradientView;
+
+    // The spacing of the given row, rows past the edges taking that
+    // of the nearest row.
+    Vector2 const& spacing( int32 row ) const {
+      std::vector<Vector2> const& s = *m_spacing;
+      if( row < 0 ) return s.front();
+      if( row >= int32(s.size()) ) return s.back();
+      return s[row];
+    }
+
+  public:
+    typedef PixelMask<Vector2f> pixel_type;
+    typedef PixelMask<Vector2f> result_type;
+    typedef ProceduralPixelAccessor<DemGradientView> pixel_accessor;
+
+    /// Gradients with the datum-aware spacing of the georeference.
+    DemGradientView( ImageT const& dem, GeoReference const& georef, DemGradientMethod method = HornGradient )
+      : m_dem(dem), m_method(method),
+        m_spacing( new std::vector<Vector2>( dem_pixel_spacing( georef, dem.rows() ) ) ) {}
+
+    /// Gradients with a fixed signed spacing per pixel in x and y.
+    DemGradientView( ImageT const& dem, Vector2 const& spacing, DemGradientMethod method = HornGradient )
+      : m_dem(dem), m_method(method),
+        m_spacing( new std::vector<Vector2>( std::max( dem.rows(), int32(1) ), spacing ) ) {}
+
+    DemGradientView( ImageT const& dem, DemGradientMethod method, boost::shared_ptr<std::vector<Vector2> > const& spacing )
+      : m_dem(dem), m_method(method), m_spacing(spacing) {}
+
+    inline int32 cols() const { return m_dem.cols(); }
+    inline int32 rows() const { return m_dem.rows(); }
+    inline int32 planes() const { return m_dem.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      EdgeExtensionView<ImageT,ConstantEdgeExtension> dem( m_dem, ConstantEdgeExtension() );
+      float z[3][3];
+      for( int32 v=0; v<3; ++v )
+        for( int32 u=0; u<3; ++u )
+          z[v][u] = detail::dem_gradient_value( dem(i+u-1, j+v-1, p) );
+      float corner, edge, dx, dy;
+      detail::dem_gradient_weights( m_method, corner, edge );
+      detail::dem_gradient_row( z[0], z[1], z[2], &dx, &dy, 1, corner, edge );
+      float norm = 2*(2*corner+edge);
+      Vector2 const& s = spacing(j);
+      if( dx != dx || dy != dy ) return result_type();
+      return result_type( Vector2f( dx/(norm*s.x()), dy/(norm*s.y()) ) );
+    }
+
+    /// \cond INTERNAL
+    typedef DemGradientView<typename ImageT::prerasterize_type> prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      BBox2i src = bbox;
+      src.expand(1);
+      src.crop( BBox2i(0,0,cols(),rows()) );
+      return prerasterize_type( m_dem.prerasterize(src), m_method, m_spacing );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      prerasterize(bbox).rasterize_batch(dest, bbox);
+    }
+
+    template <class DestT> void rasterize_batch( DestT const& dest, BBox2i const& bbox ) const {
+      int32 width = bbox.width(), height = bbox.height();
+      ImageView<typename ImageT::pixel_type> dem =
+        crop( edge_extend( m_dem, ConstantEdgeExtension() ),
+              bbox.min().x()-1, bbox.min().y()-1, width+2, height+2 );
+      ImageView<float> values( width+2, height+2 );
+      std::vector<float> dx( width ), dy( width );
+      ImageView<result_type> tile( width, height, dem.planes() );
+
+      float corner, edge;
+      detail::dem_gradient_weights( m_method, corner, edge );
+      float norm = 2*(2*corner+edge);
+      for( int32 p=0; p<dem.planes(); ++p ) {
+        for( int32 j=0; j<height+2; ++j )
+          for( int32 i=0; i<width+2; ++i )
+            values(i,j) = detail::dem_gradient_value( dem(i,j,p) );
+        for( int32 j=0; j<height; ++j ) {
+          detail::dem_gradient_row( &values(0,j), &values(0,j+1), &values(0,j+2),
+                                    &dx[0], &dy[0], width, corner, edge );
+          Vector2 const& s = spacing( bbox.min().y()+j );
+          float sx = float( 1/(norm*s.x()) ), sy = float( 1/(norm*s.y()) );
+          for( int32 i=0; i<width; ++i )
+            if( dx[i] == dx[i] && dy[i] == dy[i] )
+              tile(i,j,p) = result_type( Vector2f( dx[i]*sx, dy[i]*sy ) );
+        }
+      }
+      vw::rasterize( crop( tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() ), dest, bbox );
+    }
+    /// \endcond
+  };
+
+  /// The gradient of a DEM with the datum-aware pixel spacing of its
+  /// georeference.
+  template <class ImageT>
+  inline DemGradientView<ImageT> dem_gradient( ImageViewBase<ImageT> const& dem, GeoReference const& georef,
+                                               DemGradientMethod method = HornGradient ) {
+    return DemGradientView<ImageT>( dem.impl(), georef, method );
+  }
+
+  /// The gradient of a DEM with a fixed signed pixel spacing in x and y.
+  template <class ImageT>
+  inline DemGradientView<ImageT> dem_gradient( ImageViewBase<ImageT> const& dem, Vector2 const& spacing,
+                                               DemGradientMethod method = HornGradient ) {
+    return DemGradientView<ImageT>( dem.impl(), spacing, method );
+  }
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_DEMGRADIENT_H__
@@ -17,8 +17,12 @@
 #include <vw/Cartography/GeoReferenceResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
 
+#include <vw/Core/Thread.h>
+
 // Boost
 #include <boost/algorithm/string.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/tss.hpp>
 
 // Proj.4
 #include <projects.h>
@@ -142,14 +146,14 @@ namespace cartography {
   // the center of upper left pixel) if file is georeferenced
   // according to the convention that [0,0] is the upper left hand
   // corner of the upper left pixel.
-  inline Matrix3x3 const& GeoReference::vw_native_transform() const {
+  Matrix3x3 const& GeoReference::vw_native_transform() const {
     if (m_pixel_interpretation == GeoReference::PixelAsArea)
       return m_shifted_transform;
     else
       return m_transform;
   }
 
-  inline Matrix3x3 const& GeoReference::vw_native_inverse_transform() const {
+  Matrix3x3 const& GeoReference::vw_native_inverse_transform() const {
     if (m_pixel_interpretation == GeoReference::PixelAsArea)
       return m_inv_shifted_transform;
     else
@@ -427,7 +431,155 @@ namespace cartography {
     return Vector2(projected.u, projected.v);
   }
 
+  /// Batch version of point_to_lonlat().
+  void GeoReference::points_to_lonlats(std::vector<Vector2> const& points, std::vector<Vector2>& lonlats) const {
+    if ( ! m_is_projected ) { lonlats = points; return; }
+    size_t n = points.size();
+    if ( n == 0 ) { lonlats.clear(); return; }
+
+    std::vector<double> x(n), y(n), z(n, 0.0);
+    for ( size_t i = 0; i < n; ++i ) {
+      x[i] = points[i][0];
+      y[i] = points[i][1];
+    }
+    int err = pj_transform(m_proj_context->proj_ptr(), m_proj_context->latlong_ptr(),
+                           long(n), 1, &x[0], &y[0], &z[0]);
+    if ( err )
+      vw_throw(ProjectionErr() << "Proj.4 error: " << pj_strerrno(err));
+
+    lonlats.resize(n);
+    for ( size_t i = 0; i < n; ++i ) {
+      if ( x[i] == HUGE_VAL )
+        vw_throw(ProjectionErr() << "Proj.4 failed to unproject point " << points[i]);
+      lonlats[i] = Vector2(x[i] * RAD_TO_DEG, y[i] * RAD_TO_DEG);
+    }
+  }
+
+  /// Batch version of lonlat_to_point().
+  void GeoReference::lonlats_to_points(std::vector<Vector2> const& lonlats, std::vector<Vector2>& points) const {
+    if ( ! m_is_projected ) { points = lonlats; return; }
+    static const double BOUND = HALFPI-(1e-10)-std::numeric_limits<double>::epsilon();
+    size_t n = lonlats.size();
+    if ( n == 0 ) { points.clear(); return; }
+
+    // Radians, with the latitude clamped as in lonlat_to_point().
+    std::vector<double> x(n), y(n), z(n, 0.0);
+    for ( size_t i = 0; i < n; ++i ) {
+      x[i] = lonlats[i][0] * DEG_TO_RAD;
+      y[i] = std::max(-BOUND, std::min(BOUND, lonlats[i][1] * DEG_TO_RAD));
+    }
+    int err = pj_transform(m_proj_context->latlong_ptr(), m_proj_context->proj_ptr(),
+                           long(n), 1, &x[0], &y[0], &z[0]);
+    if ( err )
+      vw_throw(ProjectionErr() << "Proj.4 error: " << pj_strerrno(err));
+
+    points.resize(n);
+    for ( size_t i = 0; i < n; ++i ) {
+      if ( x[i] == HUGE_VAL )
+        vw_throw(ProjectionErr() << "Proj.4 failed to project point " << lonlats[i]);
+      points[i] = Vector2(x[i], y[i]);
+    }
+  }
+
+  void GeoReference::pixels_to_lonlats(std::vector<Vector2> const& pixels, std::vector<Vector2>& lonlats) const {
+    lonlats.resize(pixels.size());
+    for ( size_t i = 0; i < pixels.size(); ++i )
+      lonlats[i] = pixel_to_point(pixels[i]);
+    points_to_lonlats(lonlats, lonlats);
+  }
+
+  void GeoReference::lonlats_to_pixels(std::vector<Vector2> const& lonlats, std::vector<Vector2>& pixels) const {
+    lonlats_to_points(lonlats, pixels);
+    for ( size_t i = 0; i < pixels.size(); ++i )
+      pixels[i] = point_to_pixel(pixels[i]);
+  }
+
   /************** Functions for class ProjContext *******************/
+  namespace {
+    // The proj.4 objects one thread has made for one ProjContext.
+    struct ThreadProj {
+      boost::weak_ptr<int> token;
+      PJ *proj, *latlong;
+    };
+    typedef std::vector<ThreadProj> ThreadProjList;
+
+    void free_thread_proj( ThreadProj const& p ) {
+      if ( p.latlong ) pj_free(p.latlong);
+      if ( p.proj ) pj_free(p.proj);
+    }
+
+    void free_thread_proj_list( ThreadProjList* list ) {
+      for ( size_t i = 0; i < list->size(); ++i )
+        free_thread_proj((*list)[i]);
+      delete list;
+    }
+
+    boost::thread_specific_ptr<ThreadProjList>& thread_proj_lists() {
+      static boost::thread_specific_ptr<ThreadProjList> lists( &free_thread_proj_list );
+      return lists;
+    }
+
+    // pj_init() reads init files and reports errors through the
+    // global pj_errno, so only one thread may run it at a time.
+    Mutex& proj_init_mutex() {
+      static Mutex mutex;
+      return mutex;
+    }
+  }
+
+  PJ* ProjContext::thread_proj_ptr(bool latlong) {
+    ThreadProjList* list = thread_proj_lists().get();
+    if ( ! list ) {
+      list = new ThreadProjList;
+      thread_proj_lists().reset(list);
+    }
+
+    // Contexts are matched by ownership, which stays unique even
+    // after the token is gone.
+    boost::weak_ptr<int> token(m_token);
+    for ( size_t i = 0; i < list->size(); ++i ) {
+      ThreadProj& p = (*list)[i];
+      if ( !(p.token < token) && !(token < p.token) ) {
+        if ( latlong && ! p.latlong ) {
+          Mutex::Lock lock(proj_init_mutex());
+          p.latlong = pj_latlong_from_proj(p.proj);
+          CHECK_PROJ_INIT_ERROR(m_proj4_str);
+        }
+        return latlong ? p.latlong : p.proj;
+      }
+    }
+
+    // A miss: drop the objects of contexts that have gone away, and
+    // make this thread's objects for this one.
+    ThreadProjList live;
+    for ( size_t i = 0; i < list->size(); ++i ) {
+      if ( (*list)[i].token.expired() ) free_thread_proj((*list)[i]);
+      else live.push_back((*list)[i]);
+    }
+    list->swap(live);
+
+    ThreadProj p;
+    p.token = token;
+    p.proj = p.latlong = 0;
+    {
+      Mutex::Lock lock(proj_init_mutex());
+      int num;
+      char** proj_strings = split_proj4_string(m_proj4_str, num);
+      p.proj = pj_init(num, proj_strings);
+      for (int i = 0; i < num; i++)
+        delete [] proj_strings[i];
+      delete [] proj_strings;
+      CHECK_PROJ_INIT_ERROR(m_proj4_str);
+      if ( latlong ) {
+        p.latlong = pj_latlong_from_proj(p.proj);
+        if ( pj_errno ) pj_free(p.proj);
+        CHECK_PROJ_INIT_ERROR(m_proj4_str);
+      }
+    }
+    list->push_back(p);
+    return latlong ? p.latlong : p.proj;
+  }
+
   char** ProjContext::split_proj4_string(std::string const& proj4_str, int &num_strings) {
     std::vector<std::string> arg_strings;
     std::string trimmed_proj4_str = boost::trim_copy(proj4_str);
@@ -442,23 +594,14 @@ namespace cartography {
     return strings;
   }
 
-  ProjContext::ProjContext(std::string const& proj4_str) {
-
-    // proj.4 is expecting the parameters to be split up into seperate
-    // c-style strings.
-    int num;
-    char** proj_strings = split_proj4_string(proj4_str, num);
-    m_proj_ptr = pj_init(num, proj_strings);
-    CHECK_PROJ_INIT_ERROR(proj4_str);
-
-    for (int i = 0; i < num; i++)
-      delete [] proj_strings[i];
-    delete [] proj_strings;
+  ProjContext::ProjContext(std::string const& proj4_str)
+    : m_proj4_str(proj4_str), m_token(new int(0)) {
+    // Initialize the calling thread's projection now, so that a bad
+    // string is reported here rather than on first use.
+    thread_proj_ptr(false);
   }
 
-  ProjContext::~ProjContext() {
-    pj_free(m_proj_ptr);
-  }
+  ProjContext::~ProjContext() {}
 
   // Simple GeoReference modification tools
   GeoReference crop( GeoReference const& input,
@@ -12,6 +12,9 @@
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/Core/Exception.h>
 
+#include <string>
+#include <vector>
+
 // Boost
 #include <boost/algorithm/string.hpp>
 #include <boost/shared_ptr.hpp>
@@ -40,21 +43,35 @@ namespace cartography {
   // here simplies the rest of the GeoReference class considerably, and
   // reduces the possibility of a memory related bug. Implementation
   // code for most of it is in GeoReference.cc.
+  //
+  // Proj.4 objects are not safe to share between threads, so each
+  // thread that uses a ProjContext gets its own, made on first use and
+  // kept until the thread next makes one after the context is gone
+  // (or exits).
   class ProjContext : private boost::noncopyable {
     // Declare PJconsts as PJ like done in projects.h; sadly, C++ has no
     // forward declaration of typedefs. So if Proj ever changes their
     // names, we get screwed over here and have to change this as well.
     typedef PJconsts PJ;
 
-    PJ* m_proj_ptr;
+    std::string m_proj4_str;
+    // Tells the per-thread objects when this context has gone away.
+    boost::shared_ptr<int> m_token;
 
     char** split_proj4_string(std::string const& proj4_str, int &num_strings);
+    PJ* thread_proj_ptr(bool latlong);
 
   public:
     ProjContext(std::string const& proj4_str);
 
     ~ProjContext();
-    inline PJ* proj_ptr() { return m_proj_ptr; }
+
+    /// The projection, for the calling thread.
+    inline PJ* proj_ptr() { return thread_proj_ptr(false); }
+
+    /// The geographic (lon,lat) system the projection is defined
+    /// over, for the calling thread.
+    inline PJ* latlong_ptr() { return thread_proj_ptr(true); }
   };
 
 
@@ -69,14 +86,6 @@ namespace cartography {
 
     void init_proj();
 
-    /// This method returns a version of the affine transform
-    /// compatible with the VW standard notion that (0,0) is the
-    /// center of the top left pixel.  If pixel_interpretation() is
-    /// set to PixelAsArea, this method will adjust the affine
-    /// transform my 0.5 pixels right and down.
-    Matrix3x3 const& vw_native_transform() const;
-    Matrix3x3 const& vw_native_inverse_transform() const;
-
   public:
 
     /// Construct a default georeference.  This georeference will use
@@ -104,6 +113,14 @@ namespace cartography {
     /// Destructor.
     virtual ~GeoReference() {}
 
+    /// This method returns a version of the affine transform
+    /// compatible with the VW standard notion that (0,0) is the
+    /// center of the top left pixel.  If pixel_interpretation() is
+    /// set to PixelAsArea, this method will adjust the affine
+    /// transform my 0.5 pixels right and down.
+    Matrix3x3 const& vw_native_transform() const;
+    Matrix3x3 const& vw_native_inverse_transform() const;
+
     void set_transform(Matrix<double,3,3> transform);
     virtual void set_datum(Datum const& datum);
 
@@ -177,6 +194,16 @@ namespace cartography {
     /// the location in the projected coordinate system.
     virtual Vector2 lonlat_to_point(Vector2 lon_lat) const;
 
+    /// Batch versions of point_to_lonlat() and lonlat_to_point(),
+    /// which hand the whole array to proj.4 at once.  The output may
+    /// be the same vector as the input.
+    void points_to_lonlats(std::vector<Vector2> const& points, std::vector<Vector2>& lonlats) const;
+    void lonlats_to_points(std::vector<Vector2> const& lonlats, std::vector<Vector2>& points) const;
+
+    /// Batch versions of pixel_to_lonlat() and lonlat_to_pixel().
+    void pixels_to_lonlats(std::vector<Vector2> const& pixels, std::vector<Vector2>& lonlats) const;
+    void lonlats_to_pixels(std::vector<Vector2> const& lonlats, std::vector<Vector2>& pixels) const;
+
     /// For a bbox in pixel coordinates, find what that bbox covers
     /// in lonlat 
     virtual BBox2 pixel_to_lonlat_bbox(BBox2i pixel_bbox) const {
@@ -9,6 +9,8 @@
 #include <vw/Cartography/GeoTransform.h>
 
 // Vision Workbench
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 
 // Proj.4
@@ -24,14 +26,18 @@ namespace cartography {
     const std::string dst_datum = m_dst_georef.datum().proj4_str();
 
     // This optimizes in the common case where the two images are
-    // already in the same map projection, and we need only apply
-    // the affine transform.  This will break, of course, as soon as
-    // we have mare than one type of GeoReference object, but it
-    // makes life faster for now. -mbroxton
-    if (m_src_georef.proj4_str() == m_dst_georef.proj4_str())
-      m_skip_map_projection = true;
-    else
-      m_skip_map_projection = false;
+    // already in the same map projection and datum (or are both
+    // unprojected), and we need only apply the affine transforms,
+    // which we compose into one.  This will break, of course, as
+    // soon as we have mare than one type of GeoReference object, but
+    // it makes life faster for now. -mbroxton
+    bool same_projection = m_src_georef.proj4_str() == m_dst_georef.proj4_str() ||
+      (!m_src_georef.is_projected() && !m_dst_georef.is_projected());
+    m_skip_map_projection = same_projection && src_datum == dst_datum;
+    if (m_skip_map_projection) {
+      m_forward_matrix = m_dst_georef.vw_native_inverse_transform() * m_src_georef.vw_native_transform();
+      m_reverse_matrix = m_src_georef.vw_native_inverse_transform() * m_dst_georef.vw_native_transform();
+    }
 
     // This optimizes the case where the two datums are the same,
     // and thus we don't need to call proj to convert between them
@@ -57,8 +63,19 @@ namespace cartography {
       CHECK_PROJ_INIT_ERROR(ss_dst.str().c_str());
     }
     // Because GeoTransform is typically very slow, we default to a tolerance
-    // of 0.1 pixels to allow ourselves to be approximated.
-    set_tolerance( 0.1 );
+    // of 0.1 pixels to allow ourselves to be approximated.  The affine
+    // case is cheap and exact already.
+    set_tolerance( m_skip_map_projection ? 0.0 : 0.1 );
+  }
+
+  AffineTransform GeoTransform::affine_transform() const {
+    VW_ASSERT( m_skip_map_projection,
+               LogicErr() << "GeoTransform: the georeferences do not share a projection and datum." );
+    Matrix3x3 const& M = m_forward_matrix;
+    VW_ASSERT( M(2,0) == 0 && M(2,1) == 0 && M(2,2) != 0,
+               LogicErr() << "GeoTransform: the pixel transforms are not affine." );
+    return AffineTransform( Matrix2x2( M(0,0)/M(2,2), M(0,1)/M(2,2), M(1,0)/M(2,2), M(1,1)/M(2,2) ),
+                            Vector2( M(0,2)/M(2,2), M(1,2)/M(2,2) ) );
   }
 
   // Performs a forward or reverse datum conversion.
@@ -76,7 +93,54 @@ namespace cartography {
     return Vector2(x, y);
   }
 
+  // Batch datum conversion, with one pj_transform() call.
+  void GeoTransform::datum_convert(std::vector<Vector2>& v, bool forward) const {
+    size_t n = v.size();
+    if ( n == 0 )
+      return;
+    std::vector<double> z(n, 0.0);
+    if(forward)
+      pj_transform(m_src_datum->proj_ptr(), m_dst_datum->proj_ptr(), long(n), 2, &v[0][0], &v[0][1], &z[0]);
+    else
+      pj_transform(m_dst_datum->proj_ptr(), m_src_datum->proj_ptr(), long(n), 2, &v[0][0], &v[0][1], &z[0]);
+    CHECK_PROJ_ERROR;
+  }
+
+  void GeoTransform::reverse(std::vector<Vector2> const& in, std::vector<Vector2>& out) const {
+    if (m_skip_map_projection) {
+      out.resize(in.size());
+      for ( size_t i = 0; i < in.size(); ++i )
+        out[i] = apply(m_reverse_matrix, in[i]);
+      return;
+    }
+    m_dst_georef.pixels_to_lonlats(in, out);
+    if (!m_skip_datum_conversion)
+      datum_convert(out, false);
+    m_src_georef.lonlats_to_pixels(out, out);
+  }
+
+  void GeoTransform::forward(std::vector<Vector2> const& in, std::vector<Vector2>& out) const {
+    if (m_skip_map_projection) {
+      out.resize(in.size());
+      for ( size_t i = 0; i < in.size(); ++i )
+        out[i] = apply(m_forward_matrix, in[i]);
+      return;
+    }
+    m_src_georef.pixels_to_lonlats(in, out);
+    if (!m_skip_datum_conversion)
+      datum_convert(out, true);
+    m_dst_georef.lonlats_to_pixels(out, out);
+  }
+
   BBox2i GeoTransform::forward_bbox( BBox2i const& bbox ) const {
+    if (m_skip_map_projection) {
+      BBox2 r;
+      r.grow( this->forward( Vector2(bbox.min().x(),bbox.min().y()) ) );
+      r.grow( this->forward( Vector2(bbox.max().x()-1,bbox.min().y()) ) );
+      r.grow( this->forward( Vector2(bbox.min().x(),bbox.max().y()-1) ) );
+      r.grow( this->forward( Vector2(bbox.max().x()-1,bbox.max().y()-1) ) );
+      return grow_bbox_to_int(r);
+    }
     BBox2 r = TransformHelper<GeoTransform,ContinuousFunction,ContinuousFunction>::forward_bbox(bbox);
     BresenhamLine l1( bbox.min(), bbox.max() );
     while ( l1.is_good() ) {
@@ -98,6 +162,14 @@ namespace cartography {
   }
 
   BBox2i GeoTransform::reverse_bbox( BBox2i const& bbox ) const {
+    if (m_skip_map_projection) {
+      BBox2 r;
+      r.grow( this->reverse( Vector2(bbox.min().x(),bbox.min().y()) ) );
+      r.grow( this->reverse( Vector2(bbox.max().x()-1,bbox.min().y()) ) );
+      r.grow( this->reverse( Vector2(bbox.min().x(),bbox.max().y()-1) ) );
+      r.grow( this->reverse( Vector2(bbox.max().x()-1,bbox.max().y()-1) ) );
+      return grow_bbox_to_int(r);
+    }
     BBox2 r = TransformHelper<GeoTransform,ContinuousFunction,ContinuousFunction>::reverse_bbox(bbox);
     BresenhamLine l1( bbox.min(), bbox.max() );
     while ( l1.is_good() ) {
@@ -118,25 +190,56 @@ namespace cartography {
     return grow_bbox_to_int(r);
   }
 
+  namespace {
+    // Reprojects the nonzero points of rows [begin,end) in place, with
+    // one batch call for the whole range.
+    struct ReprojectRowsTask {
+      typedef void result_type;
+      ImageView<Vector3> const& image;
+      GeoTransform const& gtx;
+      int32 begin, end;
+      ReprojectRowsTask(ImageView<Vector3> const& image, GeoTransform const& gtx, int32 begin, int32 end)
+        : image(image), gtx(gtx), begin(begin), end(end) {}
+      void operator()() const {
+        std::vector<Vector2> points;
+        for (int32 j=begin; j < end; ++j)
+          for (int32 i=0; i < image.cols(); ++i)
+            if (image(i,j) != Vector3())
+              points.push_back(Vector2(image(i,j)[0], image(i,j)[1]));
+        gtx.forward(points, points);
+        size_t n = 0;
+        for (int32 j=begin; j < end; ++j)
+          for (int32 i=0; i < image.cols(); ++i)
+            if (image(i,j) != Vector3()) {
+              image(i,j).x() = points[n][0];
+              image(i,j).y() = points[n][1];
+              ++n;
+            }
+      }
+    };
+  }
+
   void reproject_point_image(ImageView<Vector3> const& point_image,
                              GeoReference const& src_georef,
                              GeoReference const& dst_georef) {
 
     GeoTransform gtx(src_georef, dst_georef);
 
-    // Iterate over the image, transforming the first two coordinates
-    // in the Vector one at a time.  The third coordinate is taken to
-    // be the altitude value, and this value is not touched.
-    for (int32 j=0; j < point_image.rows(); ++j) {
-      for (int32 i=0; i < point_image.cols(); ++i) {
-        if (point_image(i,j) != Vector3()) {
-          Vector2 in(point_image(i,j)[0], point_image(i,j)[1]);
-          Vector2 out = gtx.forward(in);
-          point_image(i,j).x() = out[0];
-          point_image(i,j).y() = out[1];
-        }
-      }
+    // Transform the first two coordinates of each nonzero point.  The
+    // third coordinate is taken to be the altitude value, and this
+    // value is not touched.
+    int32 rows = point_image.rows();
+    uint32 num_threads = vw_settings().default_num_threads();
+    if (num_threads < 2 || rows < 2) {
+      ReprojectRowsTask(point_image, gtx, 0, rows)();
+      return;
     }
+    int32 range = std::max(rows / int32(4 * num_threads), 1);
+    FifoWorkQueue queue(num_threads);
+    std::vector<Future<void> > futures;
+    for (int32 begin = 0; begin < rows; begin += range)
+      futures.push_back(queue.submit(ReprojectRowsTask(point_image, gtx, begin, std::min(begin + range, rows))));
+    when_all(futures);
   }
 }} // namespace vw::cartography
 
@@ -10,6 +10,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <vw/Math/Vector.h>
 #include <vw/Image/Transform.h>
@@ -26,11 +27,21 @@ namespace cartography {
     boost::shared_ptr<ProjContext> m_dst_datum;
     bool m_skip_map_projection;
     bool m_skip_datum_conversion;
+    // When the two georeferences share a projection and a datum, the
+    // whole mapping is the composition of their pixel transforms.
+    Matrix3x3 m_forward_matrix, m_reverse_matrix;
+
+    static inline Vector2 apply( Matrix3x3 const& M, Vector2 const& v ) {
+      double denom = v[0] * M(2,0) + v[1] * M(2,1) + M(2,2);
+      return Vector2( (v[0] * M(0,0) + v[1] * M(0,1) + M(0,2)) / denom,
+                      (v[0] * M(1,0) + v[1] * M(1,1) + M(1,2)) / denom );
+    }
 
     /* Converts between datums. The parameter 'forward' specifies whether
      * we convert forward (true) or reverse (false).
     */
     Vector2 datum_convert(Vector2 const& v, bool forward) const;
+    void datum_convert(std::vector<Vector2>& v, bool forward) const;
 
   public:
     /// Normal constructor
@@ -41,7 +52,7 @@ namespace cartography {
     /// pixel from an image in the source georeference frame.
     Vector2 reverse(Vector2 const& v) const {
       if (m_skip_map_projection)
-        return m_src_georef.point_to_pixel(m_dst_georef.pixel_to_point(v));
+        return apply(m_reverse_matrix, v);
       if(m_skip_datum_conversion)
         return m_src_georef.lonlat_to_pixel(m_dst_georef.pixel_to_lonlat(v));
       Vector2 dst_lonlat = m_dst_georef.pixel_to_lonlat(v);
@@ -54,7 +65,7 @@ namespace cartography {
     /// pixel the destination (transformed) image.
     Vector2 forward(Vector2 const& v) const {
       if (m_skip_map_projection)
-        return m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(v));
+        return apply(m_forward_matrix, v);
       if(m_skip_datum_conversion)
         return m_dst_georef.lonlat_to_pixel(m_src_georef.pixel_to_lonlat(v));
       Vector2 src_lonlat = m_src_georef.pixel_to_lonlat(v);
@@ -62,6 +73,19 @@ namespace cartography {
       return m_dst_georef.lonlat_to_pixel(src_lonlat);
     }
 
+    /// Batch versions of reverse() and forward(), which hand the
+    /// whole array to the georeferences' batch projections.  The
+    /// output may be the same vector as the input.
+    void reverse(std::vector<Vector2> const& in, std::vector<Vector2>& out) const;
+    void forward(std::vector<Vector2> const& in, std::vector<Vector2>& out) const;
+
+    /// True if the source and destination share a projection and a
+    /// datum, so that this transform is just a change of pixel grid.
+    bool is_affine() const { return m_skip_map_projection; }
+
+    /// The equivalent AffineTransform, when is_affine().
+    AffineTransform affine_transform() const;
+
     // We override forward_bbox so it understands to check if the image
     // crosses the poles or not.
     BBox2i forward_bbox( BBox2i const& bbox ) const;
@@ -173,6 +197,9 @@ namespace cartography {
   ///
   /// Important Note: The convention here is that the Vector3 contains
   /// the ordered triple: (longitude, latitude, altitude).
+  ///
+  /// The rows are split over the thread pool, and each range of rows
+  /// goes through GeoTransform's batch forward() at once.
   void reproject_point_image(ImageView<Vector3> const& point_image,
                              GeoReference const& src_georef,
                              GeoReference const& dst_georef);
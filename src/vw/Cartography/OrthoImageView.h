@@ -9,6 +9,8 @@
 #define __VW_CARTOGRAPHY_ORTHOIMAGEVIEW_H__
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/Cartography/GeoReference.h>
@@ -25,6 +27,10 @@ namespace cartography {
   /// This image view assumes the dimensions and georeferencing of the
   /// Terrain image (i.e. the DTM), but it assumes the pixel type of
   /// the camera image.
+  ///
+  /// Rasterizing works a tile at a time, converting the tile's DEM
+  /// posts and imaging them in batches, so wrap the view in
+  /// block_rasterize() to orthoproject large DEMs on several threads.
   template <class TerrainImageT, class CameraImageT, class InterpT, class EdgeT>
   class OrthoImageView : public ImageViewBase<OrthoImageView<TerrainImageT, CameraImageT, InterpT, EdgeT> > {
 
@@ -110,7 +116,47 @@ namespace cartography {
                                 m_georef, m_camera_image_ref,
                                 m_camera_model, m_interp_func, m_edge_func);
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      prerasterize(bbox).rasterize_batch( dest, bbox );
+    }
+
+    // Converts the tile's DEM posts to XYZ with one batch projection
+    // and one batch datum call, and images them with one
+    // points_to_pixels() call, instead of one of each per output pixel.
+    template <class DestT> void rasterize_batch( DestT const& dest, BBox2i const& bbox ) const {
+      ImageView<pixel_type> tile( bbox.width(), bbox.height(), planes() );
+      std::vector<Vector2> lonlats;
+      std::vector<size_t> index;
+      lonlats.reserve( bbox.width()*bbox.height() );
+      index.reserve( bbox.width()*bbox.height() );
+      for ( int32 j = 0; j < bbox.height(); j++ ) {
+        for ( int32 i = 0; i < bbox.width(); i++ ) {
+          int32 x = bbox.min().x() + i, y = bbox.min().y() + j;
+          if ( is_transparent(m_terrain(x,y)) )
+            continue;
+          lonlats.push_back( Vector2(x,y) );
+          index.push_back( j*bbox.width() + i );
+        }
+      }
+      m_georef.pixels_to_lonlats( lonlats, lonlats );
+
+      std::vector<Vector3> points( lonlats.size() );
+      for ( size_t n = 0; n < lonlats.size(); n++ ) {
+        int32 x = bbox.min().x() + int32(index[n] % bbox.width());
+        int32 y = bbox.min().y() + int32(index[n] / bbox.width());
+        points[n] = Vector3( lonlats[n].x(), lonlats[n].y(), Helper<typename TerrainImageT::pixel_type>(x,y) );
+      }
+      m_georef.datum().geodetic_to_cartesian( points, points );
+
+      std::vector<Vector2> pixels;
+      m_camera_model->points_to_pixels( points, pixels );
+      for ( size_t n = 0; n < pixels.size(); n++ ) {
+        int32 i = index[n] % bbox.width(), j = index[n] / bbox.width();
+        for ( int32 p = 0; p < tile.planes(); p++ )
+          tile(i,j,p) = m_camera_image(pixels[n][0], pixels[n][1], p);
+      }
+      vw::rasterize( crop( tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() ), dest, bbox );
+    }
     /// \endcond
   };
 
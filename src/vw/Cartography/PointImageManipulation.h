@@ -8,9 +8,13 @@
 #ifndef __VW_CARTOGRAPHY_POINTIMAGEMANIPLULATION_H__
 #define __VW_CARTOGRAPHY_POINTIMAGEMANIPLULATION_H__
 
+#include <vector>
+
 #include <vw/Math/Vector.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/UtilityViews.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Cartography/GeoReference.h>
 
 // This include is here to keep compat (the contents of that header used to be
@@ -42,6 +46,22 @@ namespace cartography {
       return T(lon_lat(0), lon_lat(1),
                p(2)+m_src.datum().radius(lon_lat(0), lon_lat(1))-m_dst.datum().radius(lon_lat(0), lon_lat(1)));
     }
+
+    /// Applies the functor to every point in place, with one batch
+    /// projection call for the lot.
+    template <class T>
+    void apply_batch(std::vector<T>& points) const {
+      std::vector<Vector2> lon_lats(points.size());
+      for (size_t n = 0; n < points.size(); ++n)
+        lon_lats[n] = Vector2(points[n](0), points[n](1));
+      m_src.points_to_lonlats(lon_lats, lon_lats);
+      m_dst.lonlats_to_points(lon_lats, lon_lats);
+      for (size_t n = 0; n < points.size(); ++n) {
+        Vector<typename T::value_type,2> lon_lat = lon_lats[n];
+        points[n] = T(lon_lat(0), lon_lat(1),
+                      points[n](2)+m_src.datum().radius(lon_lat(0), lon_lat(1))-m_dst.datum().radius(lon_lat(0), lon_lat(1)));
+      }
+    }
   };
 
   // This version of the functor assumes that the point inputs are
@@ -63,6 +83,27 @@ namespace cartography {
       return T(lon_lat(0), lon_lat(1),
                m_forward ? p(2) - offset : p(2) + offset);
     }
+
+    /// Applies the functor to every point in place, with one batch
+    /// projection call for all the nonzero ones.
+    template <class T>
+    void apply_batch(std::vector<T>& points) const {
+      std::vector<Vector2> lon_lats;
+      std::vector<size_t> index;
+      for (size_t n = 0; n < points.size(); ++n)
+        if (points[n] != T()) {
+          lon_lats.push_back(Vector2(points[n](0), points[n](1)));
+          index.push_back(n);
+        }
+      m_dst.lonlats_to_points(lon_lats, lon_lats);
+      for (size_t k = 0; k < index.size(); ++k) {
+        T& p = points[index[k]];
+        Vector<typename T::value_type,2> lon_lat = lon_lats[k];
+        typename T::value_type offset = m_dst.datum().radius(lon_lat(0), lon_lat(1));
+        p = T(lon_lat(0), lon_lat(1),
+              m_forward ? p(2) - offset : p(2) + offset);
+      }
+    }
   };
 
   template <class PixelT>
@@ -83,6 +124,115 @@ namespace cartography {
       }
   };
 
+  /// A per-pixel view of ReprojectPointFunctor or ProjectPointFunctor.
+  /// Single pixels go through the functor one at a time, but
+  /// rasterizing a region converts each of its planes with one call
+  /// to the functor's apply_batch().  Wrap the view in
+  /// block_rasterize() to spread the blocks over the threads.
+  template <class ImageT, class FuncT>
+  class PointProjectionView : public ImageViewBase<PointProjectionView<ImageT,FuncT> > {
+    ImageT m_image;
+    FuncT m_func;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<PointProjectionView> pixel_accessor;
+
+    PointProjectionView(ImageT const& image, FuncT const& func) : m_image(image), m_func(func) {}
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const { return m_func(m_image(i,j,p)); }
+
+    /// \cond INTERNAL
+    typedef PointProjectionView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      return prerasterize_type(m_image.prerasterize(bbox), m_func);
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      prerasterize(bbox).rasterize_batch(dest, bbox);
+    }
+
+    template <class DestT> void rasterize_batch(DestT const& dest, BBox2i const& bbox) const {
+      ImageView<pixel_type> tile = crop(m_image, bbox);
+      std::vector<pixel_type> points(tile.cols()*tile.rows());
+      for (int32 p = 0; p < tile.planes(); ++p) {
+        for (int32 j = 0; j < tile.rows(); ++j)
+          for (int32 i = 0; i < tile.cols(); ++i)
+            points[j*tile.cols()+i] = tile(i,j,p);
+        m_func.apply_batch(points);
+        for (int32 j = 0; j < tile.rows(); ++j)
+          for (int32 i = 0; i < tile.cols(); ++i)
+            tile(i,j,p) = points[j*tile.cols()+i];
+      }
+      vw::rasterize(crop(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows()), dest, bbox);
+    }
+    /// \endcond
+  };
+
+  /// The view returned by dem_to_point_image().  Single pixels go
+  /// through DemToPointImageFunctor, but rasterizing a region converts
+  /// all of its valid posts with one batch pixels_to_lonlats() call.
+  /// Wrap the view in block_rasterize() to spread the blocks over the
+  /// threads.
+  template <class ImageT>
+  class DemToPointImageView : public ImageViewBase<DemToPointImageView<ImageT> > {
+    ImageT m_dem;
+    GeoReference m_georef;
+    DemToPointImageFunctor<typename ImageT::pixel_type> m_func;
+
+  public:
+    typedef Vector3 pixel_type;
+    typedef Vector3 result_type;
+    typedef ProceduralPixelAccessor<DemToPointImageView> pixel_accessor;
+
+    DemToPointImageView(ImageT const& dem, GeoReference const& georef) : m_dem(dem), m_georef(georef), m_func(georef) {}
+
+    inline int32 cols() const { return m_dem.cols(); }
+    inline int32 rows() const { return m_dem.rows(); }
+    inline int32 planes() const { return m_dem.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const { return m_func(Vector2(i,j), m_dem(i,j,p)); }
+
+    /// \cond INTERNAL
+    typedef DemToPointImageView<typename ImageT::prerasterize_type> prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      return prerasterize_type(m_dem.prerasterize(bbox), m_georef);
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      prerasterize(bbox).rasterize_batch(dest, bbox);
+    }
+
+    template <class DestT> void rasterize_batch(DestT const& dest, BBox2i const& bbox) const {
+      ImageView<typename ImageT::pixel_type> dem = crop(m_dem, bbox);
+      ImageView<Vector3> tile(dem.cols(), dem.rows(), dem.planes());
+      std::vector<Vector2> lon_lats;
+      for (int32 p = 0; p < dem.planes(); ++p) {
+        lon_lats.clear();
+        for (int32 j = 0; j < dem.rows(); ++j)
+          for (int32 i = 0; i < dem.cols(); ++i)
+            if (!is_transparent(dem(i,j,p)))
+              lon_lats.push_back(Vector2(bbox.min().x()+i, bbox.min().y()+j));
+        m_georef.pixels_to_lonlats(lon_lats, lon_lats);
+        size_t n = 0;
+        for (int32 j = 0; j < dem.rows(); ++j)
+          for (int32 i = 0; i < dem.cols(); ++i)
+            if (!is_transparent(dem(i,j,p))) {
+              Vector3& result = tile(i,j,p);
+              subvector(result, 0, 2) = lon_lats[n++];
+              result.z() = dem(i,j,p);
+            }
+      }
+      vw::rasterize(crop(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows()), dest, bbox);
+    }
+    /// \endcond
+  };
+
   /// Takes an ImageView of Vector<ElemT,3> in some source projected space
   /// with (lon,lat,alt) or (x,y,alt) and returns an ImageView of
   /// vectors that are in the destination projection.
@@ -97,27 +247,24 @@ namespace cartography {
   /// the notion of horizontal (x) and vertical (y) coordinates in an
   /// image.
   template <class ImageT>
-  UnaryPerPixelView<ImageT, ReprojectPointFunctor>
+  PointProjectionView<ImageT, ReprojectPointFunctor>
   inline reproject_point_image( ImageViewBase<ImageT> const& image, GeoReference const& src_georef, GeoReference const& dst_georef) {
-    return UnaryPerPixelView<ImageT,ReprojectPointFunctor>( image.impl(), ReprojectPointFunctor(src_georef, dst_georef) );
+    return PointProjectionView<ImageT,ReprojectPointFunctor>( image.impl(), ReprojectPointFunctor(src_georef, dst_georef) );
   }
 
   // This variant, which only accepts a destination projection,
   // assumes that the source points are [lon, lat, radius] values.
   template <class ImageT>
-  UnaryPerPixelView<ImageT, ProjectPointFunctor>
+  PointProjectionView<ImageT, ProjectPointFunctor>
   inline project_point_image( ImageViewBase<ImageT> const& image, GeoReference const& dst_georef, bool forward=true) {
-    return UnaryPerPixelView<ImageT,ProjectPointFunctor>( image.impl(), ProjectPointFunctor(dst_georef, forward) );
+    return PointProjectionView<ImageT,ProjectPointFunctor>( image.impl(), ProjectPointFunctor(dst_georef, forward) );
   }
 
   // This utility function converts a DEM to a point image
   template <class ImageT>
-  BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, DemToPointImageFunctor<typename ImageT::pixel_type> >
+  DemToPointImageView<ImageT>
   inline dem_to_point_image(ImageViewBase<ImageT> const& dem, GeoReference georef) {
-    typedef DemToPointImageFunctor<typename ImageT::pixel_type> func_type;
-    typedef BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, func_type> result_type;
-    func_type func(georef);
-    return result_type(pixel_index_view(dem), dem.impl(), func);
+    return DemToPointImageView<ImageT>(dem.impl(), georef);
   }
 }} // namespace vw::cartography
 
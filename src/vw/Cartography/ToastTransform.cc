@@ -6,6 +6,45 @@
 
 
 #include <vw/Cartography/ToastTransform.h>
+#include <vw/Core/Thread.h>
+
+#include <algorithm>
+
+
+namespace {
+
+  // The footprint lattice is 2^levels cells on a side, as fine as 64
+  // but with cells no smaller than 16 pixels.
+  vw::int32 footprint_levels( vw::int32 resolution ) {
+    vw::int32 levels = 0;
+    while( levels < 6 && (resolution-1) / double(2 << levels) >= 16 ) ++levels;
+    return levels;
+  }
+
+}
+
+
+struct vw::cartography::ToastTransform::FootprintCache {
+  Mutex mutex;
+  bool ready;
+  // One grid of bounding boxes per level, from the single cell at
+  // level 0 down to the finest.
+  std::vector<std::vector<BBox2> > levels;
+  FootprintCache() : ready(false) {}
+};
+
+
+vw::cartography::ToastTransform::ToastTransform(GeoReference const& georef, int32 resolution)
+  : m_georef(georef), m_resolution(resolution), m_footprints(new FootprintCache)
+{
+  // We enable approximation of the TOAST transform by
+  // linear interpolation into lookup tables, because it is
+  // quite slow.  The 0.2 pixel tolerance is fairly wide; it
+  // would be great to speed up the algorithm enough to at
+  // least use the 0.1 pixel tolerance that is used by default
+  // for GeoTransform.
+  set_tolerance(0.2);
+}
 
 
 // A helper function to convert a point on the unit sphere to
@@ -371,3 +410,220 @@ vw::BBox2 vw::cartography::ToastTransform::reverse_line( Vector2 const& a, Vecto
   bbox.max() += max_error;
   return bbox;
 }
+
+
+// Reverse-projects the finest lattice at half-cell spacing, so that
+// each cell sees its corners, edge midpoints and center.  A cell's
+// footprint is the bounding box of those nine points padded by the
+// largest deviation of a midpoint from the linear estimate, as in
+// reverse_line(), and grown to any poles it contains.  Coarser
+// levels are unions of their four children.
+void vw::cartography::ToastTransform::build_footprints() const {
+  Mutex::Lock lock( m_footprints->mutex );
+  if( m_footprints->ready ) return;
+
+  int32 levels = footprint_levels( m_resolution );
+  int32 n = 1 << levels, side = 2*n+1;
+  double cell = (m_resolution-1) / double(n);
+  std::vector<Vector2> points( size_t(side)*side );
+  for( int32 j=0; j<side; ++j )
+    for( int32 i=0; i<side; ++i )
+      points[j*side+i] = reverse( Vector2( i*cell/2, j*cell/2 ) );
+
+  std::vector<std::vector<BBox2> > &grids = m_footprints->levels;
+  grids.resize( levels+1 );
+  grids[levels].resize( size_t(n)*n );
+  for( int32 j=0; j<n; ++j ) {
+    for( int32 i=0; i<n; ++i ) {
+      Vector2 const* p[3][3];
+      for( int32 v=0; v<3; ++v )
+        for( int32 u=0; u<3; ++u )
+          p[v][u] = &points[(2*j+v)*side+2*i+u];
+      BBox2 bbox;
+      Vector2 max_error;
+      for( int32 k=0; k<3; ++k ) {
+        for( int32 m=0; m<3; ++m ) bbox.grow( *p[k][m] );
+        Vector2 row_error = *p[k][1] - (*p[k][0] + *p[k][2])/2;
+        Vector2 col_error = *p[1][k] - (*p[0][k] + *p[2][k])/2;
+        max_error.x() = std::max( max_error.x(), std::max( fabs(row_error.x()), fabs(col_error.x()) ) );
+        max_error.y() = std::max( max_error.y(), std::max( fabs(row_error.y()), fabs(col_error.y()) ) );
+      }
+      bbox.min() -= max_error;
+      bbox.max() += max_error;
+      reverse_bbox_poles( BBox2( i*cell-0.5, j*cell-0.5, cell+1, cell+1 ), bbox );
+      grids[levels][j*n+i] = bbox;
+    }
+  }
+
+  for( int32 level=levels-1; level>=0; --level ) {
+    int32 m = 1 << level;
+    grids[level].resize( size_t(m)*m );
+    for( int32 j=0; j<m; ++j )
+      for( int32 i=0; i<m; ++i ) {
+        BBox2 &bbox = grids[level][j*m+i];
+        for( int32 k=0; k<4; ++k )
+          bbox.grow( grids[level+1][(2*j+k/2)*2*m+2*i+k%2] );
+      }
+  }
+  m_footprints->ready = true;
+}
+
+
+// Unions the footprints of the cells overlapping the box at the
+// finest level whose cells are at least as large as the box, so that
+// there are never more than four of them.
+vw::BBox2 vw::cartography::ToastTransform::reverse_footprint( BBox2i const& bbox ) const {
+  if( bbox.empty() ) return BBox2();
+  build_footprints();
+
+  int32 level = int32(m_footprints->levels.size()) - 1;
+  int32 size = std::max( bbox.width(), bbox.height() );
+  while( level > 0 && (m_resolution-1) / double(1 << level) < size ) --level;
+  int32 n = 1 << level;
+  double cell = (m_resolution-1) / double(n);
+  int32 i0 = std::max( 0, math::impl::_floor( bbox.min().x() / cell ) );
+  int32 j0 = std::max( 0, math::impl::_floor( bbox.min().y() / cell ) );
+  int32 i1 = std::min( n-1, math::impl::_floor( bbox.max().x() / cell ) );
+  int32 j1 = std::min( n-1, math::impl::_floor( bbox.max().y() / cell ) );
+
+  std::vector<BBox2> const& grid = m_footprints->levels[level];
+  BBox2 result;
+  for( int32 j=j0; j<=j1; ++j )
+    for( int32 i=i0; i<=i1; ++i )
+      result.grow( grid[j*n+i] );
+  return result;
+}
+
+
+double vw::cartography::ToastTransform::footprint_cell_size() const {
+  return (m_resolution-1) / double(1 << footprint_levels( m_resolution ));
+}
+
+
+// std::max() takes these by reference, so they need definitions.
+const vw::int32 vw::ApproximateTransform<vw::cartography::ToastTransform>::max_cell;
+const vw::int32 vw::ApproximateTransform<vw::cartography::ToastTransform>::min_cell;
+
+
+// Covers the box, plus a pixel of margin for the interpolation
+// kernels, with the coarsest TOAST lattice whose cells are at most
+// max_cell pixels on a side.  Every quadrant boundary is a line of
+// that lattice, so each root cell lies within a single quadrant and
+// takes that quadrant's facet diagonal.
+vw::ApproximateTransform<vw::cartography::ToastTransform>::ApproximateTransform( cartography::ToastTransform const& transform, BBox2i const& bbox )
+  : cartography::ToastTransform( transform ), m_spacing( 1 ), m_i0(0), m_j0(0), m_cols(0), m_rows(0)
+{
+  double extent = resolution() - 1;
+  if( bbox.empty() || extent < 2 ) return;
+  int32 n = 2;
+  while( extent / n > max_cell ) n *= 2;
+  m_spacing = extent / n;
+
+  m_i0 = std::max( 0, math::impl::_floor( (bbox.min().x()-1) / m_spacing ) );
+  m_j0 = std::max( 0, math::impl::_floor( (bbox.min().y()-1) / m_spacing ) );
+  int32 i1 = std::min( n, math::impl::_floor( (bbox.max().x()+1) / m_spacing ) + 1 );
+  int32 j1 = std::min( n, math::impl::_floor( (bbox.max().y()+1) / m_spacing ) + 1 );
+  if( i1 <= m_i0 || j1 <= m_j0 ) return;
+  m_cols = i1 - m_i0;
+  m_rows = j1 - m_j0;
+
+  double tol_sqr = cartography::ToastTransform::tolerance() * cartography::ToastTransform::tolerance();
+  double half = extent / 2;
+  m_roots.resize( size_t(m_cols)*m_rows );
+  for( int32 j=0; j<m_rows; ++j ) {
+    for( int32 i=0; i<m_cols; ++i ) {
+      BBox2 root( (m_i0+i)*m_spacing, (m_j0+j)*m_spacing, m_spacing, m_spacing );
+      Node node;
+      node.origin = root.min();
+      node.size = m_spacing;
+      node.c00 = sample( Vector2(root.min().x(), root.min().y()), root );
+      node.c10 = sample( Vector2(root.max().x(), root.min().y()), root );
+      node.c01 = sample( Vector2(root.min().x(), root.max().y()), root );
+      node.c11 = sample( Vector2(root.max().x(), root.max().y()), root );
+      node.child = -1;
+      Vector2 center = root.center();
+      node.main_diagonal = ( (center.x() < half) == (center.y() > half) );
+      node.exact = false;
+      m_roots[j*m_cols+i] = int32(m_nodes.size());
+      m_nodes.push_back( node );
+      refine( m_roots[j*m_cols+i], root, tol_sqr );
+    }
+  }
+}
+
+
+// The exact transform, nudged into the root cell at its border.  The
+// longitude seam runs along a lattice line, and this evaluates its
+// vertices on the same side as the cell using them.
+vw::Vector2 vw::ApproximateTransform<vw::cartography::ToastTransform>::sample( Vector2 const& p, BBox2 const& root ) const {
+  static const double nudge = 1e-6;
+  Vector2 q = p;
+  if( q.x() <= root.min().x() ) q.x() = root.min().x() + nudge;
+  if( q.x() >= root.max().x() ) q.x() = root.max().x() - nudge;
+  if( q.y() <= root.min().y() ) q.y() = root.min().y() + nudge;
+  if( q.y() >= root.max().y() ) q.y() = root.max().y() - nudge;
+  return cartography::ToastTransform::reverse( q );
+}
+
+
+void vw::ApproximateTransform<vw::cartography::ToastTransform>::refine( int32 id, BBox2 const& root, double tol_sqr ) {
+  Node node = m_nodes[id];
+  double s = node.size, h = s/2;
+  double x0 = node.origin.x(), y0 = node.origin.y();
+
+  Vector2 top    = sample( Vector2(x0+h, y0  ), root );
+  Vector2 bottom = sample( Vector2(x0+h, y0+s), root );
+  Vector2 left   = sample( Vector2(x0,   y0+h), root );
+  Vector2 right  = sample( Vector2(x0+s, y0+h), root );
+  Vector2 center = sample( Vector2(x0+h, y0+h), root );
+
+  double err = 0;
+  err = std::max( err, norm_2_sqr( top    - interpolate(node, Vector2(x0+h, y0  )) ) );
+  err = std::max( err, norm_2_sqr( bottom - interpolate(node, Vector2(x0+h, y0+s)) ) );
+  err = std::max( err, norm_2_sqr( left   - interpolate(node, Vector2(x0,   y0+h)) ) );
+  err = std::max( err, norm_2_sqr( right  - interpolate(node, Vector2(x0+s, y0+h)) ) );
+  err = std::max( err, norm_2_sqr( center - interpolate(node, Vector2(x0+h, y0+h)) ) );
+  // The facet centroids.
+  double a = s/3, b = 2*s/3;
+  Vector2 f1 = node.main_diagonal ? Vector2(x0+b, y0+a) : Vector2(x0+a, y0+a);
+  Vector2 f2 = node.main_diagonal ? Vector2(x0+a, y0+b) : Vector2(x0+b, y0+b);
+  err = std::max( err, norm_2_sqr( sample(f1, root) - interpolate(node, f1) ) );
+  err = std::max( err, norm_2_sqr( sample(f2, root) - interpolate(node, f2) ) );
+
+  if( err <= tol_sqr ) return;
+  if( h < min_cell ) {
+    m_nodes[id].exact = true;
+    return;
+  }
+
+  Vector2 corners[4][4] = { { node.c00, top,    left,   center },
+                            { top,      node.c10, center, right },
+                            { left,     center, node.c01, bottom },
+                            { center,   right,  bottom, node.c11 } };
+  int32 first = int32(m_nodes.size());
+  m_nodes[id].child = first;
+  for( int32 k=0; k<4; ++k ) {
+    Node child = node;
+    child.origin = Vector2( x0 + h*(k%2), y0 + h*(k/2) );
+    child.size = h;
+    child.c00 = corners[k][0]; child.c10 = corners[k][1];
+    child.c01 = corners[k][2]; child.c11 = corners[k][3];
+    m_nodes.push_back( child );
+  }
+  for( int32 k=0; k<4; ++k )
+    refine( first+k, root, tol_sqr );
+}
+
+
+size_t vw::ApproximateTransform<vw::cartography::ToastTransform>::num_cells() const {
+  size_t n = 0;
+  for( size_t i=0; i<m_nodes.size(); ++i ) n += (m_nodes[i].child < 0);
+  return n;
+}
+
+
+size_t vw::ApproximateTransform<vw::cartography::ToastTransform>::num_exact_cells() const {
+  size_t n = 0;
+  for( size_t i=0; i<m_nodes.size(); ++i ) n += (m_nodes[i].child < 0 && m_nodes[i].exact);
+  return n;
+}
@@ -52,15 +52,17 @@
 // A more complete description is available here:
 // http://research.microsoft.com/en-us/um/people/dinos/spheretoaster.pdf
 //
-// The TOAST transform is not cheap, and we work around that by using
-// the lookup-table-based approximation capabilities of TransformView.
-// We could get back some precision, and possibly make things even
-// faster, by exploiting the fact that the first many iterations will
-// be identical for nearby points.  We typically compute the reverse
-// transform for a large number of nearby points at a time.  We could
-// either cache the stack used in the most recent calculation, or
-// directly expose a the ability to reverse-transform a block of
-// points at a time.
+// The TOAST transform is not cheap, and we work around that in two
+// ways.  TransformView approximates it tile by tile, and the
+// ApproximateTransform specialization below does so by interpolating
+// over the TOAST lattice itself: each lattice cell is split into the
+// two triangular facets of the tessellation, so the octant edges and
+// the 180 degree seam never cut through a facet.  SparseImageCheck,
+// which is asked about every tile of a planet, starts from bounding
+// boxes cached once per transform for the cells of a coarse lattice.
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
 
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
@@ -75,6 +77,12 @@ namespace cartography {
     GeoReference m_georef;
     int32 m_resolution;
 
+    // The reverse-projected footprints of a coarse TOAST lattice,
+    // built on first use and shared by all copies of the transform.
+    struct FootprintCache;
+    boost::shared_ptr<FootprintCache> m_footprints;
+    void build_footprints() const;
+
     // A helper function to convert a point on the unit sphere to
     // a lon/lat vector.
     Vector2 unitvec_to_lonlat(Vector3 const& vec) const;
@@ -102,17 +110,9 @@ namespace cartography {
     }
 
   public:
-    ToastTransform(GeoReference const& georef, int32 resolution)
-      : m_georef(georef), m_resolution(resolution)
-    {
-      // We enable approximation of the TOAST transform by
-      // linear interpolation into lookup tables, because it is
-      // quite slow.  The 0.2 pixel tolerance is fairly wide; it
-      // would be great to speed up the algorithm enough to at
-      // least use the 0.1 pixel tolerance that is used by default
-      // for GeoTransform.
-      set_tolerance(0.2);
-    }
+    ToastTransform(GeoReference const& georef, int32 resolution);
+
+    int32 resolution() const { return m_resolution; }
 
     virtual Vector2 forward( Vector2 const& point ) const;
     virtual Vector2 reverse( Vector2 const& point ) const;
@@ -140,10 +140,87 @@ namespace cartography {
     // A heuristic that back-projects a line on to a conservative
     // bounding box.  Used by SparseImageCheck.
     BBox2 reverse_line( Vector2 const& a, Vector2 const& b, int num_divisions ) const;
+
+    // A conservative bounding box in the source pixel space for the
+    // given TOAST bounding box, assembled from the cached footprints
+    // of the lattice cells it overlaps.  Cheap, but no tighter than
+    // footprint_cell_size() allows.  Used by SparseImageCheck.
+    BBox2 reverse_footprint( BBox2i const& bbox ) const;
+    double footprint_cell_size() const;
   };
 
 } // namespace vw::cartography
 
+  /// ApproximateTransform specialized to follow the TOAST lattice.
+  ///
+  /// The box is covered by square TOAST lattice cells, each split
+  /// along the diagonal of the tessellation for its quadrant into two
+  /// triangular facets over which the exact values at the corners are
+  /// interpolated linearly.  Cells are refined down to min_cell pixels
+  /// while the interpolation misses the exact transform by more than
+  /// the tolerance at the edge midpoints or facet centroids, after
+  /// which they fall back to the exact transform.
+  template <>
+  class ApproximateTransform<cartography::ToastTransform> : public cartography::ToastTransform {
+  public:
+    static const int32 max_cell = 64;
+    static const int32 min_cell = 4;
+
+  private:
+    struct Node {
+      Vector2 origin;
+      double size;
+      Vector2 c00, c10, c01, c11;
+      int32 child;       // The first of four children, or -1 for a leaf
+      bool main_diagonal; // Facets split along c00-c11 rather than c10-c01
+      bool exact;
+    };
+
+    double m_spacing;
+    int32 m_i0, m_j0, m_cols, m_rows;
+    std::vector<int32> m_roots;
+    std::vector<Node> m_nodes;
+
+    static inline Vector2 interpolate( Node const& n, Vector2 const& p ) {
+      double u = (p.x() - n.origin.x()) / n.size;
+      double v = (p.y() - n.origin.y()) / n.size;
+      if( n.main_diagonal ) {
+        if( u >= v ) return n.c00 + (n.c10-n.c00)*u + (n.c11-n.c10)*v;
+        return n.c00 + (n.c01-n.c00)*v + (n.c11-n.c01)*u;
+      }
+      if( u + v <= 1 ) return n.c00 + (n.c10-n.c00)*u + (n.c01-n.c00)*v;
+      return n.c11 + (n.c01-n.c11)*(1-u) + (n.c10-n.c11)*(1-v);
+    }
+
+    Vector2 sample( Vector2 const& p, BBox2 const& root ) const;
+    void refine( int32 id, BBox2 const& root, double tol_sqr );
+
+  public:
+    ApproximateTransform( cartography::ToastTransform const& transform, BBox2i const& bbox );
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      int32 i = math::impl::_floor( p.x() / m_spacing ) - m_i0;
+      int32 j = math::impl::_floor( p.y() / m_spacing ) - m_j0;
+      if( i < 0 || j < 0 || i >= m_cols || j >= m_rows )
+        return cartography::ToastTransform::reverse( p );
+      Node const* n = &m_nodes[ m_roots[j*m_cols+i] ];
+      while( n->child >= 0 ) {
+        double half = n->size / 2;
+        n = &m_nodes[ n->child + (p.x() >= n->origin.x()+half) + 2*(p.y() >= n->origin.y()+half) ];
+      }
+      if( n->exact ) return cartography::ToastTransform::reverse( p );
+      return interpolate( *n, p );
+    }
+
+    /// The number of leaf cells, and how many of them fell back to
+    /// the exact transform.
+    size_t num_cells() const;
+    size_t num_exact_cells() const;
+
+    // Never re-approximate the approximation.
+    virtual double tolerance() const { return 0; }
+  };
+
   template <class ChildT>
   class SparseImageCheck<TransformView<ChildT, cartography::ToastTransform> > {
 
@@ -155,25 +232,30 @@ namespace cartography {
 
     bool operator()( BBox2i const& bbox ) const {
       // We could just call ToastTransform::reverse_bbox() here, but we
-      // anticipate getting called with very large bounding boxes, so
-      // even walking around the edges could be unacceptably slow.
-      // Since this function is just an optimization heuristic, we only
-      // sample a small number of points around the border of the tile,
-      // and then pad out the resulting bounding box aggressively based
-      // on a measurement of the sampling error.  This will result in
-      // some false positives, but it will be orders of magnitude faster
-      // than reverse_bbox() for large tiles.
-
+      // anticipate getting called with very large bounding boxes, and
+      // for every tile of the planet.  Since this function is just an
+      // optimization heuristic, we first look the tile up in the
+      // cached footprints of the coarse lattice cells it overlaps,
+      // which rejects most empty tiles outright.
       cartography::ToastTransform const& txform = m_view.transform();
+      SparseImageCheck<ChildT> child_check( m_view.child() );
+
+      BBox2 src_bbox = txform.reverse_footprint( bbox );
+      if( ! child_check( src_bbox ) ) return false;
+      if( 2*std::max( bbox.width(), bbox.height() ) > txform.footprint_cell_size() ) return true;
 
-      BBox2 src_bbox;
+      // Tiles much smaller than a lattice cell get a second look: we
+      // sample a small number of points around the border of the
+      // tile, and then pad out the resulting bounding box aggressively
+      // based on a measurement of the sampling error.
+      src_bbox = BBox2();
       src_bbox.grow( txform.reverse_line( Vector2( bbox.min().x(), bbox.min().y() ), Vector2( bbox.max().x(), bbox.min().y() ), 8 ) );
       src_bbox.grow( txform.reverse_line( Vector2( bbox.min().x(), bbox.min().y() ), Vector2( bbox.min().x(), bbox.max().y() ), 8 ) );
       src_bbox.grow( txform.reverse_line( Vector2( bbox.max().x(), bbox.min().y() ), Vector2( bbox.max().x(), bbox.max().y() ), 8 ) );
       src_bbox.grow( txform.reverse_line( Vector2( bbox.min().x(), bbox.max().y() ), Vector2( bbox.max().x(), bbox.max().y() ), 8 ) );
       txform.reverse_bbox_poles( bbox, src_bbox );
 
-      return SparseImageCheck<ChildT>(m_view.child())( src_bbox );
+      return child_check( src_bbox );
     }
   };
 
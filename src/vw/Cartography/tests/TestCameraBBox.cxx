@@ -75,4 +75,28 @@ TEST_F( CameraBBoxTest, CameraBBoxDEM ) {
   EXPECT_VECTOR_NEAR( image_bbox.max(), Vector2(94,6), 2 );
 }
 
+TEST_F( CameraBBoxTest, CameraBBoxThreads ) {
+  ImageView<float> DEM(20,20);
+  for ( uint32 i = 0; i < 20; i++ )
+    for ( uint32 j = 0; j <20; j++ )
+      DEM(i,j) = 1000 - 10*(pow(10.-i,2.)+pow(10.-j,2));
+  Matrix<double> geotrans = vw::math::identity_matrix<3>();
+  geotrans(0,2) = 80;
+  geotrans(1,1) = -1;
+  geotrans(1,2) = 10;
+  moon.set_transform(geotrans);
+
+  // The samples don't depend on how the work is split up
+  int num_threads = vw_settings().default_num_threads();
+  float scale1, scale4;
+  vw_settings().set_default_num_threads(1);
+  BBox2 bbox1 = camera_bbox( DEM, moon, apollo, 4096, 4096, scale1 );
+  vw_settings().set_default_num_threads(4);
+  BBox2 bbox4 = camera_bbox( DEM, moon, apollo, 4096, 4096, scale4 );
+  vw_settings().set_default_num_threads(num_threads);
+  EXPECT_VECTOR_EQ( bbox1.min(), bbox4.min() );
+  EXPECT_VECTOR_EQ( bbox1.max(), bbox4.max() );
+  EXPECT_EQ( scale1, scale4 );
+}
+
 #endif
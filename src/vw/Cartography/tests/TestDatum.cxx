@@ -27,3 +27,44 @@ TEST( Datum, DatumDesc ) {
   EXPECT_EQ(datum.build_desc().DebugString(), datum2.build_desc().DebugString());
 }
 #endif
+
+TEST( Datum, BatchConversions ) {
+  Datum wgs84("WGS84"), moon("D_MOON");
+  moon.meridian_offset() = 10;
+
+  std::vector<Vector3> llh;
+  for ( int i = 0; i < 10000; i++ )
+    llh.push_back( Vector3( 720.0*rand()/RAND_MAX - 360, 180.0*rand()/RAND_MAX - 90,
+                            5e5*rand()/RAND_MAX - 1e4 ) );
+  llh.push_back( Vector3( 10, 90, 0 ) );
+  llh.push_back( Vector3( -10, -90, 100 ) );
+  llh.push_back( Vector3( 45, 0, -6.3e6 ) ); // Near the center
+
+  Datum const* datums[2] = { &wgs84, &moon };
+  for ( int d = 0; d < 2; d++ ) {
+    Datum const& datum = *datums[d];
+    std::vector<Vector3> xyz, llh2;
+    datum.geodetic_to_cartesian( llh, xyz );
+    ASSERT_EQ( llh.size(), xyz.size() );
+    for ( size_t i = 0; i < llh.size(); i++ )
+      EXPECT_VECTOR_NEAR( datum.geodetic_to_cartesian( llh[i] ), xyz[i], 1e-7 );
+
+    datum.cartesian_to_geodetic( xyz, llh2 );
+    for ( size_t i = 0; i < xyz.size(); i++ ) {
+      Vector3 expected = datum.cartesian_to_geodetic( xyz[i] );
+      if ( fabs( expected[1] ) < 90 - 1e-6 ) // Longitude is arbitrary at the poles
+        EXPECT_NEAR( expected[0], llh2[i][0], 1e-9 );
+      EXPECT_NEAR( expected[1], llh2[i][1], 1e-9 );
+      EXPECT_NEAR( expected[2], llh2[i][2], 1e-6 );
+    }
+
+    // In place
+    std::vector<Vector3> points = llh;
+    datum.geodetic_to_cartesian( points, points );
+    for ( size_t i = 0; i < points.size(); i++ )
+      EXPECT_VECTOR_EQ( xyz[i], points[i] );
+    datum.cartesian_to_geodetic( points, points );
+    for ( size_t i = 0; i < points.size(); i++ )
+      EXPECT_VECTOR_EQ( llh2[i], points[i] );
+  }
+}
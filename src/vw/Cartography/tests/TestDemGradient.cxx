@@ -0,0 +1,80 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestDemGradient.h
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Cartography/DemGradient.h>
+#include <vw/Image/ImageViewRef.h>
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+
+TEST( DemGradient, Plane ) {
+  ImageView<PixelMask<float> > dem(37,23);
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ )
+      dem(i,j) = 3.0f*i - 2.0f*j;
+  dem(20,10).invalidate();
+
+  DemGradientMethod methods[] = { HornGradient, SharpnackAkinGradient, ZevenbergenThorneGradient };
+  for ( int m = 0; m < 3; m++ ) {
+    DemGradientView<ImageView<PixelMask<float> > > gradient = dem_gradient( dem, Vector2(2,-4), methods[m] );
+    // Rasterize in tiles through an ImageViewRef, as block_write_image would.
+    ImageViewRef<PixelMask<Vector2f> > ref = gradient;
+    ImageView<PixelMask<Vector2f> > result(dem.cols(), dem.rows());
+    for ( int32 y = 0; y < dem.rows(); y += 8 )
+      for ( int32 x = 0; x < dem.cols(); x += 8 ) {
+        BBox2i tile(x, y, std::min(8, dem.cols()-x), std::min(8, dem.rows()-y));
+        crop(result, tile) = crop(ref, tile);
+      }
+
+    for ( int32 j = 1; j < dem.rows()-1; j++ )
+      for ( int32 i = 1; i < dem.cols()-1; i++ ) {
+        bool near_hole = abs(i-20) <= 1 && abs(j-10) <= 1;
+        if ( methods[m] == ZevenbergenThorneGradient )
+          near_hole = abs(i-20) + abs(j-10) <= 1;
+        EXPECT_EQ( !near_hole, is_valid(result(i,j)) ) << i << " " << j;
+        EXPECT_EQ( is_valid(gradient(i,j)), is_valid(result(i,j)) );
+        if ( !near_hole ) {
+          EXPECT_VECTOR_NEAR( result(i,j).child(), Vector2f(1.5, 0.5), 1e-5 );
+          EXPECT_VECTOR_NEAR( gradient(i,j).child(), Vector2f(1.5, 0.5), 1e-5 );
+        }
+      }
+
+    // Edge pixels repeat their neighbors, halving the difference.
+    EXPECT_NEAR( result(0,5).child()[0], 0.75, 1e-5 );
+    EXPECT_NEAR( result(5,0).child()[1], 0.25, 1e-5 );
+  }
+}
+
+TEST( DemGradient, GeographicSpacing ) {
+  GeoReference georef;
+  Matrix3x3 M;
+  M(0,0) = 0.01;
+  M(0,2) = 10;
+  M(1,1) = -0.01;
+  M(1,2) = 80;
+  M(2,2) = 1;
+  georef.set_transform(M);
+  std::vector<Vector2> spacing = dem_pixel_spacing( georef, 8000 );
+  ASSERT_EQ( 8000u, spacing.size() );
+
+  // Compare with the distances between neighboring pixels on the datum.
+  for ( int32 j = 0; j < 8000; j += 999 ) {
+    Vector2 ll = georef.pixel_to_lonlat( Vector2(0,j) );
+    Vector3 p = georef.datum().geodetic_to_cartesian( Vector3(ll.x(), ll.y(), 0) );
+    Vector2 ll_x = georef.pixel_to_lonlat( Vector2(1,j) );
+    Vector2 ll_y = georef.pixel_to_lonlat( Vector2(0,j+1) );
+    double dx = norm_2( georef.datum().geodetic_to_cartesian( Vector3(ll_x.x(), ll_x.y(), 0) ) - p );
+    double dy = norm_2( georef.datum().geodetic_to_cartesian( Vector3(ll_y.x(), ll_y.y(), 0) ) - p );
+    EXPECT_NEAR( spacing[j].x(), dx, 1e-3*dx );
+    EXPECT_NEAR( spacing[j].y(), -dy, 1e-3*dy );
+  }
+}
@@ -226,6 +226,47 @@ TEST( GeoReference, UTM_to_LonLat ) {
   }
 }
 
+TEST( GeoReference, BatchProjection ) {
+  GeoReference georef;
+  Matrix3x3 map;
+  map(0,0) = 15;
+  map(1,1) = -15;
+  map(0,2) = 419832.648;
+  map(1,2) = 5184829.285;
+  map(2,2) = 1;
+  georef.set_transform(map);
+  georef.set_UTM(59, false);
+
+  std::vector<Vector2> px;
+  for ( int j = 0; j < 3700; j += 370 )
+    for ( int i = 0; i < 3300; i += 330 )
+      px.push_back(Vector2(i,j));
+
+  std::vector<Vector2> lonlat, pixel;
+  georef.pixels_to_lonlats(px, lonlat);
+  ASSERT_EQ( lonlat.size(), px.size() );
+  for ( size_t i = 0; i < px.size(); ++i )
+    EXPECT_VECTOR_NEAR( georef.pixel_to_lonlat(px[i]), lonlat[i], 1e-9 );
+
+  georef.lonlats_to_pixels(lonlat, pixel);
+  ASSERT_EQ( pixel.size(), px.size() );
+  for ( size_t i = 0; i < px.size(); ++i ) {
+    EXPECT_VECTOR_NEAR( georef.lonlat_to_pixel(lonlat[i]), pixel[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( px[i], pixel[i], 1e-5 );
+  }
+
+  // In place
+  georef.lonlats_to_points(lonlat, lonlat);
+  for ( size_t i = 0; i < px.size(); ++i )
+    EXPECT_VECTOR_NEAR( georef.pixel_to_point(px[i]), lonlat[i], 1e-4 );
+
+  // Unprojected georeferences pass points straight through.
+  GeoReference geographic;
+  geographic.points_to_lonlats(px, lonlat);
+  for ( size_t i = 0; i < px.size(); ++i )
+    EXPECT_VECTOR_EQ( px[i], lonlat[i] );
+}
+
 TEST( GeoReference, IOLoop ) {
   ImageView<PixelRGB<float> > test_image(2,2);
   test_image(0,0) = PixelRGB<float>(1,2,3);
@@ -11,6 +11,7 @@
 
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/GeoTransform.h>
+#include <vw/Core/Settings.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -32,6 +33,94 @@ TEST( GeoTransform, BasicTransform ) {
   EXPECT_VECTOR_NEAR( rev, Vector2(25,25), 1e-16 );
 }
 
+TEST( GeoTransform, AffineOnly ) {
+  // Same projection and datum, different pixel grids.
+  GeoReference src_georef, dst_georef;
+  Matrix3x3 src_map, dst_map;
+  src_map(0,0) = 30; src_map(1,1) = -30;
+  src_map(0,2) = 419832.648; src_map(1,2) = 5184829.285; src_map(2,2) = 1;
+  dst_map(0,0) = 45; dst_map(1,1) = -45;
+  dst_map(0,2) = 420000; dst_map(1,2) = 5184000; dst_map(2,2) = 1;
+  src_georef.set_transform(src_map);
+  dst_georef.set_transform(dst_map);
+  src_georef.set_UTM(59, false);
+  dst_georef.set_UTM(59, false);
+
+  GeoTransform geotx(src_georef, dst_georef);
+  EXPECT_TRUE( geotx.is_affine() );
+  EXPECT_EQ( 0.0, geotx.tolerance() );
+
+  AffineTransform affine = geotx.affine_transform();
+  for ( int32 y = 0; y < 1000; y += 111 )
+    for ( int32 x = 0; x < 1000; x += 97 ) {
+      Vector2 p(x,y);
+      Vector2 expected = dst_georef.point_to_pixel(src_georef.pixel_to_point(p));
+      EXPECT_VECTOR_NEAR( expected, geotx.forward(p), 1e-8 );
+      EXPECT_VECTOR_NEAR( expected, affine.forward(p), 1e-8 );
+      EXPECT_VECTOR_NEAR( p, geotx.reverse(geotx.forward(p)), 1e-8 );
+    }
+  EXPECT_EQ( affine.forward_bbox(BBox2i(0,0,100,100)), geotx.forward_bbox(BBox2i(0,0,100,100)) );
+
+  // A different projection needs the full chain.
+  dst_georef.set_UTM(58, false);
+  GeoTransform geotx2(src_georef, dst_georef);
+  EXPECT_FALSE( geotx2.is_affine() );
+  EXPECT_THROW( geotx2.affine_transform(), LogicErr );
+}
+
+TEST( GeoTransform, Batch ) {
+  GeoReference src_georef, dst_georef;
+  src_georef.set_well_known_geogcs("WGS84");
+  src_georef.set_UTM(13);
+  Matrix3x3 src_map = math::identity_matrix<3>();
+  src_map(0,0) = 30; src_map(1,1) = -30;
+  src_map(0,2) = 419832.648; src_map(1,2) = 5184829.285;
+  src_georef.set_transform(src_map);
+  dst_georef.set_well_known_geogcs("WGS84");
+  Matrix3x3 dst_map = math::identity_matrix<3>();
+  dst_map(0,0) = 1e-3; dst_map(1,1) = -1e-3;
+  dst_map(0,2) = -106; dst_map(1,2) = 47;
+  dst_georef.set_transform(dst_map);
+  GeoTransform geotx(src_georef, dst_georef);
+
+  std::vector<Vector2> pixels, fwd, rev;
+  for ( int i = 0; i < 50; i++ )
+    pixels.push_back( Vector2( 37*i % 100, 13*i % 70 ) );
+  geotx.forward( pixels, fwd );
+  geotx.reverse( fwd, rev );
+  ASSERT_EQ( pixels.size(), fwd.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( geotx.forward( pixels[i] ), fwd[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( geotx.reverse( fwd[i] ), rev[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( pixels[i], rev[i], 1e-4 );
+  }
+
+  // The one-shot point image reprojection leaves zeros alone and
+  // doesn't depend on how the rows are split up.
+  ImageView<Vector3> points(40,30);
+  for ( int32 j = 0; j < points.rows(); j++ )
+    for ( int32 i = 0; i < points.cols(); i++ )
+      if ( (i+j) % 5 )
+        points(i,j) = Vector3( 2*i, 3*j, i-j );
+  ImageView<Vector3> serial = copy(points), threaded = copy(points);
+  int num_threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads(1);
+  reproject_point_image( serial, src_georef, dst_georef );
+  vw_settings().set_default_num_threads(4);
+  reproject_point_image( threaded, src_georef, dst_georef );
+  vw_settings().set_default_num_threads(num_threads);
+  for ( int32 j = 0; j < points.rows(); j++ )
+    for ( int32 i = 0; i < points.cols(); i++ ) {
+      EXPECT_VECTOR_EQ( serial(i,j), threaded(i,j) );
+      if ( points(i,j) == Vector3() ) {
+        EXPECT_VECTOR_EQ( Vector3(), serial(i,j) );
+      } else {
+        Vector2 expected = geotx.forward( subvector(points(i,j),0,2) );
+        EXPECT_VECTOR_NEAR( Vector3( expected[0], expected[1], points(i,j)[2] ), serial(i,j), 1e-6 );
+      }
+    }
+}
+
 TEST( GeoTransform, UTMFarZone ) {
   // This tests for a bug where forward_bbox calls latlon_to_* for a latlon
   // that is invalid for a utm zone.
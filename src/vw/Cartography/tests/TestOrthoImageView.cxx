@@ -14,6 +14,7 @@
 #include <vw/Cartography/SimplePointImageManipulation.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Image/Transform.h>
+#include <vw/Image/BlockRasterize.h>
 
 // Must have protobuf to be able to read camera
 #if defined(VW_HAVE_PKG_PROTOBUF) && VW_HAVE_PKG_PROTOBUF==1 && defined(VW_HAVE_PKG_CAMERA) && VW_HAVE_PKG_CAMERA==1
@@ -136,6 +137,21 @@ TEST_F( OrthoImageTest, OrthoImageRun ) {
 }
 
 
+TEST_F( OrthoImageTest, OrthoBlocks ) {
+  ImageView<PixelGray<uint8> > whole =
+    orthoproject( DEM, moon, test_pattern_view(PixelGray<uint8>(),5725,5725),
+                  apollo, BilinearInterpolation(), ZeroEdgeExtension() );
+  ImageView<PixelGray<uint8> > blocks =
+    block_rasterize( orthoproject( DEM, moon, test_pattern_view(PixelGray<uint8>(),5725,5725),
+                                   apollo, BilinearInterpolation(), ZeroEdgeExtension() ),
+                     Vector2i(6,7), 4 );
+  ASSERT_EQ( whole.cols(), blocks.cols() );
+  ASSERT_EQ( whole.rows(), blocks.rows() );
+  for ( int32 j = 0; j < whole.rows(); j++ )
+    for ( int32 i = 0; i < whole.cols(); i++ )
+      EXPECT_EQ( whole(i,j), blocks(i,j) );
+}
+
 TEST_F( OrthoImageTest, OrthoTraits ) {
   OrthoImageView<ImageView<float>,TestPatternView<PixelGray<uint8> >,
     BicubicInterpolation, ZeroEdgeExtension>
@@ -10,6 +10,8 @@
 #include <test/Helpers.h>
 
 #include <vw/Cartography/PointImageManipulation.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/PixelMask.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -38,3 +40,36 @@ TEST( PointImageManip, XYZ_to_LonLat ) {
   EXPECT_VECTOR_NEAR( xyz, xyz2, 1e-2 );
 }
 
+
+TEST( PointImageManip, BlockViews ) {
+  GeoReference georef;
+  georef.set_well_known_geogcs("WGS84");
+  georef.set_UTM(13);
+  Matrix3x3 map = math::identity_matrix<3>();
+  map(0,0) = 30; map(1,1) = -30;
+  map(0,2) = 419832.648; map(1,2) = 5184829.285;
+  georef.set_transform(map);
+
+  ImageView<PixelMask<float> > dem(23,17);
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ )
+      dem(i,j) = (i*7+j*3) % 11 ? PixelMask<float>(100.0f+i-2*j) : PixelMask<float>();
+
+  // Rasterizing a region converts it in one batch; that must match
+  // converting the pixels one at a time.
+  ImageView<Vector3> points = dem_to_point_image(dem, georef);
+  ImageView<Vector3> blocks = block_rasterize(dem_to_point_image(dem, georef), Vector2i(8,5), 4);
+  ImageView<Vector3> projected = project_point_image(points, georef);
+  ImageView<Vector3> reprojected = reproject_point_image(projected, georef, georef);
+  for ( int32 j = 0; j < dem.rows(); j++ )
+    for ( int32 i = 0; i < dem.cols(); i++ ) {
+      EXPECT_VECTOR_NEAR( dem_to_point_image(dem, georef)(i,j), points(i,j), 1e-9 );
+      EXPECT_VECTOR_NEAR( points(i,j), blocks(i,j), 1e-9 );
+      EXPECT_VECTOR_NEAR( project_point_image(points, georef)(i,j), projected(i,j), 1e-6 );
+      EXPECT_VECTOR_NEAR( reproject_point_image(projected, georef, georef)(i,j), reprojected(i,j), 1e-6 );
+      if ( is_valid(dem(i,j)) )
+        EXPECT_EQ( dem(i,j).child(), points(i,j).z() );
+      else
+        EXPECT_VECTOR_EQ( Vector3(), points(i,j) );
+    }
+}
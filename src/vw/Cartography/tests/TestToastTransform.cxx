@@ -321,3 +321,56 @@ TEST_F( ToastTransformTest, StereographicBBox ) {
   BBox2i global(0,0,toast_resolution,toast_resolution);
   EXPECT_TRUE( global.contains(out_box) );
 }
+
+TEST_F( ToastTransformTest, ApproximateReverse ) {
+  // The whole planet, so that both poles, the octant edges and the
+  // longitude seam are all covered.
+  BBox2i bbox(0,0,toast_resolution,toast_resolution);
+  ApproximateTransform<ToastTransform> approx( txform, bbox );
+  EXPECT_EQ( 0, approx.tolerance() );
+  EXPECT_LT( approx.num_exact_cells(), approx.num_cells()/4 );
+
+  for( int32 y=0; y<toast_resolution; y+=3 ) {
+    // Points right on the seam may come out on either side of it.
+    if( y == (toast_resolution-1)/2 ) continue;
+    for( int32 x=0; x<toast_resolution; x+=3 ) {
+      Vector2 p( x+0.25, y+0.5 );
+      EXPECT_VECTOR_NEAR( approx.reverse(p), txform.reverse(p), txform.tolerance() );
+    }
+  }
+}
+
+TEST_F( ToastTransformTest, SparseCheck ) {
+  // A small image covering 0E to 10E and 0N to 10N.
+  GeoReference georef;
+  Matrix3x3 M;
+  M(0,0) = 0.1;
+  M(1,1) = -0.1;
+  M(1,2) = 10;
+  M(2,2) = 1;
+  georef.set_transform(M);
+  ToastTransform tx( georef, toast_resolution );
+  ImageView<float> image(100,100);
+  BBox2i image_bbox(0,0,100,100);
+
+  TransformView<ImageView<float>, ToastTransform> view( image, tx, toast_resolution, toast_resolution );
+  int32 nonempty = 0;
+  for( int32 size=256; size>=16; size/=4 ) {
+    for( int32 y=0; y<toast_resolution; y+=size ) {
+      for( int32 x=0; x<toast_resolution; x+=size ) {
+        BBox2i tile(x,y,size,size);
+        bool sparse = sparse_check( view, tile );
+        nonempty += sparse;
+        // Never a false negative.
+        bool hit = false;
+        for( int32 j=y; j<y+size && !hit; j+=2 )
+          for( int32 i=x; i<x+size && !hit; i+=2 )
+            hit = image_bbox.contains( tx.reverse( Vector2(i,j) ) );
+        if( hit ) EXPECT_TRUE( sparse );
+      }
+    }
+  }
+  // And most of the planet is empty.
+  EXPECT_GT( nonempty, 0 );
+  EXPECT_LT( nonempty, 400 );
+}
@@ -0,0 +1,167 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/BufferPool.h>
+
+#include <cstdlib>
+
+namespace vw {
+
+  struct BufferPool::LocalFreelist {
+    BufferPool* pool;
+    std::vector<void*> buffers[BufferPool::num_classes];
+    LocalFreelist( BufferPool* p ) : pool(p) {}
+  };
+
+  BufferPool::BufferPool( size_t max_size )
+    : m_max_size(max_size), m_size(0), m_hits(0), m_misses(0),
+      m_local(&BufferPool::release_local) {}
+
+  BufferPool::~BufferPool() {
+    clear();
+  }
+
+  // Each doubling of size is split into four classes, so a buffer is
+  // never more than 25% larger than the request it serves.
+  size_t BufferPool::size_class( size_t size ) {
+    if (size < min_pooled_size)
+      return no_class;
+
+    size_t exponent = 0;
+    while ((size >> exponent) > 1)
+      ++exponent;
+    size_t step = size_t(1) << (exponent - 2);
+    size_t steps = (size + step - 1) / step; // 4 through 8
+    if (steps == 8) {
+      ++exponent;
+      steps = 4;
+    }
+
+    size_t cls = (exponent - 16) * 4 + (steps - 4);
+    return cls < num_classes ? cls : no_class;
+  }
+
+  BufferPool::LocalFreelist* BufferPool::local() {
+    LocalFreelist* list = m_local.get();
+    if (!list) {
+      list = new LocalFreelist(this);
+      m_local.reset(list);
+    }
+    return list;
+  }
+
+  // Called by boost::thread_specific_ptr when a thread exits.
+  void BufferPool::release_local( LocalFreelist* list ) {
+    for (size_t cls = 0; cls < num_classes; ++cls)
+      for (size_t i = 0; i < list->buffers[cls].size(); ++i)
+        list->pool->release( list->buffers[cls][i], cls );
+    delete list;
+  }
+
+  void BufferPool::release( void* buffer, size_t cls ) {
+    if (m_size.load() > m_max_size.load()) {
+      m_size.sub(class_bytes(cls));
+      std::free(buffer);
+      return;
+    }
+    Mutex::Lock lock(m_mutex);
+    m_shared[cls].push_back(buffer);
+  }
+
+  void* BufferPool::allocate( size_t size ) {
+    // Even with pooling off, round up to the class size: the pool may
+    // be enabled by the time this buffer is returned to it.
+    size_t cls = size_class(size);
+    if (cls == no_class)
+      return std::malloc(size);
+    if (m_max_size.load() == 0)
+      return std::malloc(class_bytes(cls));
+
+    std::vector<void*>& mine = local()->buffers[cls];
+    void* buffer = 0;
+    if (!mine.empty()) {
+      buffer = mine.back();
+      mine.pop_back();
+    } else {
+      Mutex::Lock lock(m_mutex);
+      if (!m_shared[cls].empty()) {
+        buffer = m_shared[cls].back();
+        m_shared[cls].pop_back();
+      }
+    }
+
+    if (buffer) {
+      m_size.sub(class_bytes(cls));
+      ++m_hits;
+      return buffer;
+    }
+
+    ++m_misses;
+    return std::malloc(class_bytes(cls));
+  }
+
+  void BufferPool::deallocate( void* buffer, size_t size ) {
+    if (!buffer)
+      return;
+
+    size_t cls = size_class(size);
+    if (cls == no_class) {
+      std::free(buffer);
+      return;
+    }
+
+    size_t bytes = class_bytes(cls);
+    if (m_size.add(bytes) > m_max_size.load()) {
+      m_size.sub(bytes);
+      std::free(buffer);
+      return;
+    }
+
+    std::vector<void*>& mine = local()->buffers[cls];
+    if (mine.size() < thread_buffers) {
+      mine.push_back(buffer);
+      return;
+    }
+    Mutex::Lock lock(m_mutex);
+    m_shared[cls].push_back(buffer);
+  }
+
+  void BufferPool::set_max_size( size_t max_size ) {
+    m_max_size.store(max_size);
+
+    Mutex::Lock lock(m_mutex);
+    for (size_t cls = num_classes; cls-- > 0 && m_size.load() > max_size; ) {
+      while (!m_shared[cls].empty() && m_size.load() > max_size) {
+        std::free(m_shared[cls].back());
+        m_shared[cls].pop_back();
+        m_size.sub(class_bytes(cls));
+      }
+    }
+  }
+
+  void BufferPool::clear() {
+    if (LocalFreelist* list = m_local.get()) {
+      for (size_t cls = 0; cls < num_classes; ++cls) {
+        for (size_t i = 0; i < list->buffers[cls].size(); ++i) {
+          std::free(list->buffers[cls][i]);
+          m_size.sub(class_bytes(cls));
+        }
+        list->buffers[cls].clear();
+      }
+    }
+
+    Mutex::Lock lock(m_mutex);
+    for (size_t cls = 0; cls < num_classes; ++cls) {
+      for (size_t i = 0; i < m_shared[cls].size(); ++i) {
+        std::free(m_shared[cls][i]);
+        m_size.sub(class_bytes(cls));
+      }
+      m_shared[cls].clear();
+    }
+  }
+
+} // namespace vw
@@ -0,0 +1,126 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/BufferPool.h
+///
+/// A pool of large, recently freed memory buffers.
+///
+/// Block processing allocates and frees many equally sized buffers
+/// (one per image block) from many threads at once.  Going to malloc
+/// for each of them means contending on the allocator's locks and
+/// faulting in fresh pages every time.  A BufferPool instead keeps
+/// freed buffers on freelists, one per size class, and hands them out
+/// again to the next request of that class.  Each thread keeps a few
+/// buffers per class for itself so that the common case takes no
+/// lock at all; the rest go to a shared freelist.
+///
+/// The pool used by ImageView is vw_buffer_pool(), which is sized
+/// by the buffer_pool_size setting and is disabled by default.
+///
+#ifndef __VW_CORE_BUFFERPOOL_H__
+#define __VW_CORE_BUFFERPOOL_H__
+
+#include <vector>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/thread/tss.hpp>
+
+namespace vw {
+
+  class BufferPool : private boost::noncopyable {
+  public:
+    /// Requests smaller than this are not pooled; malloc handles them
+    /// well enough.
+    static const size_t min_pooled_size = 64 * 1024;
+
+    /// How many buffers of each size class a thread keeps on its own
+    /// freelist before handing them to the shared one.
+    static const size_t thread_buffers = 4;
+
+    /// A deleter for boost::shared_array and friends that returns the
+    /// buffer to its pool.
+    class Deleter {
+      BufferPool* m_pool;
+      size_t m_size;
+    public:
+      Deleter( BufferPool& pool, size_t size ) : m_pool(&pool), m_size(size) {}
+      void operator()( void* buffer ) const { m_pool->deallocate( buffer, m_size ); }
+    };
+
+    /// Creates a pool that holds at most max_size bytes of free
+    /// buffers.  A max_size of zero disables pooling.  The pool must
+    /// outlive every thread that uses it.
+    explicit BufferPool( size_t max_size = 0 );
+    ~BufferPool();
+
+    /// Returns a buffer of at least size bytes, or 0 if the memory
+    /// could not be allocated.  The contents are undefined.
+    void* allocate( size_t size );
+
+    /// Returns a buffer obtained from allocate( size ) to the pool.
+    void deallocate( void* buffer, size_t size );
+
+    /// True if requests of this size are worth sending to the pool.
+    bool pooled( size_t size ) const {
+      return size >= min_pooled_size && m_max_size.load() > 0;
+    }
+
+    /// Changes the byte budget for free buffers.  Shrinking it
+    /// releases buffers from the shared freelist right away; buffers
+    /// on per-thread freelists are released when their thread calls
+    /// clear() or exits.
+    void set_max_size( size_t max_size );
+    size_t max_size() const { return m_max_size.load(); }
+
+    /// The number of bytes currently held on freelists.
+    size_t size() const { return m_size.load(); }
+
+    /// Allocations satisfied from a freelist, and those that had to
+    /// go to malloc.
+    uint64 hits() const { return m_hits.load(); }
+    uint64 misses() const { return m_misses.load(); }
+
+    /// Frees every buffer on the shared freelist and on the calling
+    /// thread's freelist.
+    void clear();
+
+  private:
+    struct LocalFreelist;
+
+    static const size_t num_classes = 4 * 25; // Sizes up to 2^40 bytes
+    static const size_t no_class = size_t(-1);
+
+    // Maps a request to its size class, or to no_class if the pool
+    // does not handle requests of that size.
+    static size_t size_class( size_t size );
+
+    // The number of bytes a buffer of a size class holds.
+    static size_t class_bytes( size_t cls ) {
+      return (size_t(1) << (cls / 4 + 14)) * (cls % 4 + 4);
+    }
+
+    LocalFreelist* local();
+    static void release_local( LocalFreelist* local );
+
+    // Moves a buffer that is already counted in m_size to the shared
+    // freelist, or frees it if the pool is over budget.
+    void release( void* buffer, size_t cls );
+
+    Atomic<size_t> m_max_size;
+    Atomic<size_t> m_size;
+    Atomic<uint64> m_hits, m_misses;
+
+    Mutex m_mutex;
+    std::vector<void*> m_shared[num_classes];
+    boost::thread_specific_ptr<LocalFreelist> m_local;
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_BUFFERPOOL_H__
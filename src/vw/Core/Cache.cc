@@ -9,82 +9,505 @@
 ///
 /// Types and functions to assist cacheing regeneratable data.
 ///
+#include <vw/config.h>
 #include <vw/Core/Cache.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/PerfCounters.h>
 
-void vw::Cache::allocate( size_t size ) {
-  while( m_size+size > m_max_size ) {
-    if( ! m_last_valid ) {
-      vw_out(WarningMessage, "console") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size << "\n";
-      vw_out(WarningMessage, "cache") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size << "\n";
-      break;
+#include <algorithm>
+#include <vector>
+#include <list>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef VW_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+// Evict one line, unless another thread holds it.
+bool vw::Cache::evict( Shard& shard, CacheLineBase *line ) {
+  if( ! line->try_invalidate() ) return false;
+  line->m_evicted = true;
+  shard.m_evictions++;
+  line->m_stats->evictions++;
+  static PerfCounter& evictions = vw_perf_counters().counter("cache.evictions");
+  evictions.add();
+  return true;
+}
+
+void vw::Cache::count_lookup( bool hit, bool reloaded, uint64 microseconds ) {
+  static PerfCounterRegistry& counters = vw_perf_counters();
+  static PerfCounter& hits = counters.counter("cache.hits");
+  static PerfCounter& misses = counters.counter("cache.misses");
+  static PerfCounter& spill_hits = counters.counter("cache.spill_hits");
+  static PerfHistogram& generate = counters.histogram("cache.generate_us");
+  if( hit ) {
+    hits.add();
+    return;
+  }
+  misses.add();
+  if( reloaded ) spill_hits.add();
+  else generate.record( microseconds );
+}
+
+// Walk a list from the least recently used end, skipping lines that
+// another thread is using right now, until there is room for size
+// more bytes or the list is down to keep_bytes.
+void vw::Cache::evict_lru( Shard& shard, LineList list, size_t size, size_t keep_bytes ) {
+  CacheLineBase *line = shard.m_last[list];
+  while( over_budget(size) && shard.m_list_bytes[list] > keep_bytes && line ) {
+    CacheLineBase *prev = line->m_prev;
+    evict( shard, line );
+    line = prev;
+  }
+}
+
+// Cheapest to regenerate per byte first.
+bool vw::Cache::cheaper_per_byte( CacheLineBase const* a, CacheLineBase const* b ) {
+  return a->m_cost * b->m_size < b->m_cost * a->m_size;
+}
+
+// Like evict_lru(), but looks at the least recently used lines a
+// handful at a time and evicts the cheapest of each batch first.
+void vw::Cache::evict_cheapest( Shard& shard, LineList list, size_t size ) {
+  const size_t batch_size = 8;
+  std::vector<CacheLineBase*> batch;
+  CacheLineBase *line = shard.m_last[list];
+  while( over_budget(size) && line ) {
+    batch.clear();
+    for( ; line && batch.size() < batch_size; line = line->m_prev )
+      batch.push_back( line );
+    std::sort( batch.begin(), batch.end(), cheaper_per_byte );
+    for( size_t i = 0; i < batch.size() && over_budget(size); ++i )
+      evict( shard, batch[i] );
+  }
+}
+
+void vw::Cache::make_room( Shard& shard, size_t size ) {
+  switch( eviction_policy() ) {
+  case TwoQueueEviction: {
+    // Keep the probation list to about a quarter of this shard's
+    // share of the cache, then take from the protected list.
+    size_t keep = m_max_size / (4 * m_num_shards.load());
+    evict_lru( shard, ProbationList, size, keep );
+    evict_lru( shard, ProtectedList, size );
+    evict_lru( shard, ProbationList, size );
+    break;
+  }
+  case CostWeightedEviction:
+    evict_cheapest( shard, ProbationList, size );
+    evict_cheapest( shard, ProtectedList, size );
+    break;
+  default:
+    // The protected list is only non-empty if the policy changed.
+    evict_lru( shard, ProbationList, size );
+    evict_lru( shard, ProtectedList, size );
+    break;
+  }
+}
+
+void vw::Cache::allocate( Shard& shard, size_t size ) {
+  make_room( shard, size );
+  if( over_budget(size) && ! shard.m_last[ProbationList] && ! shard.m_last[ProtectedList] ) {
+    // With several shards, the rest of the budget may be held by
+    // other shards.  They trim themselves the next time they
+    // allocate, so only complain if this object can never fit.
+    if( m_num_shards.load() == 1 || size > m_max_size ) {
+      vw_out(WarningMessage, "console") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size.load() << "\n";
+      vw_out(WarningMessage, "cache") << "Warning: Cached object (" << size << ") larger than requested maximum cache size (" << m_max_size << "). Current Size = " << m_size.load() << "\n";
     }
-    m_last_valid->invalidate();
-    m_evictions++;
   }
-  m_size += size;
-  VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache allocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
+  size_t new_size = m_size.add(size);
+  VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache allocated " << size << " bytes (" << new_size << " / " << m_max_size << " used)" << "\n"; )
 }
 
 void vw::Cache::resize( size_t size ) {
-  Mutex::Lock lock(m_mutex);
+  Mutex::Lock shards_lock(m_shards_mutex);
   m_max_size = size;
-  while( m_size > m_max_size ) {
-    VW_ASSERT( m_last_valid, LogicErr() << "Cache is empty but has nonzero size!" );
-    m_last_valid->invalidate();
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i ) {
+    Shard& shard = *m_shards[i];
+    {
+      Mutex::Lock lock(shard.m_mutex);
+      make_room( shard, 0 );
+    }
+    write_spills( shard );
+  }
+}
+
+void vw::Cache::set_num_shards( uint32 num_shards ) {
+  Mutex::Lock shards_lock(m_shards_mutex);
+  num_shards = std::max(uint32(1), std::min(uint32(MaxShards), num_shards));
+  // Create the shards before publishing the new count, so that
+  // next_shard() never sees a shard that does not exist yet.
+  for( uint32 i = 0; i < num_shards; ++i )
+    if( ! m_shards[i] )
+      m_shards[i].reset( new Shard );
+  m_num_shards.store(num_shards);
+}
+
+vw::uint64 vw::Cache::hits() const {
+  uint64 total = 0;
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i )
+    total += m_shards[i]->m_hits;
+  return total;
+}
+
+vw::uint64 vw::Cache::misses() const {
+  uint64 total = 0;
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i )
+    total += m_shards[i]->m_misses;
+  return total;
+}
+
+vw::uint64 vw::Cache::evictions() const {
+  uint64 total = 0;
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i )
+    total += m_shards[i]->m_evictions;
+  return total;
+}
+
+void vw::Cache::clear_stats() {
+  Mutex::Lock shards_lock(m_shards_mutex);
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i ) {
+    Mutex::Lock lock(m_shards[i]->m_mutex);
+    m_shards[i]->m_hits = m_shards[i]->m_misses = m_shards[i]->m_evictions = 0;
+    // Reset rather than erase; cache lines point at these entries.
+    typedef std::map<std::string, GeneratorStats>::iterator iter_t;
+    for( iter_t it = m_shards[i]->m_generator_stats.begin(); it != m_shards[i]->m_generator_stats.end(); ++it )
+      it->second = GeneratorStats();
+  }
+}
+
+namespace {
+  std::string demangle( std::string const& name ) {
+#ifdef __GNUC__
+    int status = 0;
+    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+    if( status == 0 && result ) {
+      std::string demangled(result);
+      free(result);
+      return demangled;
+    }
+#endif
+    return name;
+  }
+
+  typedef std::pair<std::string, vw::Cache::GeneratorStats> named_stats_t;
+  bool generation_time_gt( named_stats_t const& a, named_stats_t const& b ) {
+    return a.second.generation_microseconds > b.second.generation_microseconds;
+  }
+}
+
+vw::Cache::GeneratorStats vw::Cache::stats() const {
+  GeneratorStats total;
+  typedef std::map<std::string, GeneratorStats>::const_iterator iter_t;
+  std::map<std::string, GeneratorStats> by_type = generator_stats();
+  for( iter_t it = by_type.begin(); it != by_type.end(); ++it )
+    total += it->second;
+  return total;
+}
+
+std::map<std::string, vw::Cache::GeneratorStats> vw::Cache::generator_stats() const {
+  std::map<std::string, GeneratorStats> result;
+  typedef std::map<std::string, GeneratorStats>::const_iterator iter_t;
+  for( uint32 i = 0; i < MaxShards && m_shards[i]; ++i ) {
+    Mutex::Lock lock(m_shards[i]->m_mutex);
+    for( iter_t it = m_shards[i]->m_generator_stats.begin(); it != m_shards[i]->m_generator_stats.end(); ++it )
+      result[demangle(it->first)] += it->second;
+  }
+  return result;
+}
+
+std::string vw::Cache::stats_report() const {
+  std::map<std::string, GeneratorStats> by_type = generator_stats();
+  std::vector<named_stats_t> sorted(by_type.begin(), by_type.end());
+  std::sort(sorted.begin(), sorted.end(), generation_time_gt);
+
+  std::ostringstream out;
+  out << "Cache statistics (" << m_size.load() << " / " << m_max_size << " bytes used, "
+      << m_num_shards.load() << " shard(s)):\n";
+  for( size_t i = 0; i < sorted.size(); ++i ) {
+    GeneratorStats const& s = sorted[i].second;
+    out << "  " << sorted[i].first << ":\n"
+        << "    hits " << s.hits << ", misses " << s.misses << ", evictions " << s.evictions
+        << ", prefetches " << s.prefetches << "\n"
+        << "    spills " << s.spills << " (" << s.spill_hits << " reloaded)\n"
+        << "    bytes generated " << s.bytes_generated << " (" << s.bytes_regenerated << " regenerated)"
+        << ", generation time " << double(s.generation_microseconds) / 1e6 << " s\n";
+  }
+  return out.str();
+}
+
+// ---------------------------------------------------
+// Spill tier
+// ---------------------------------------------------
+
+// One file per spilled cache line, evicted least recently used first
+// when the byte budget is exceeded.  The file I/O itself happens
+// outside the store's lock; callers serialize access to any one
+// cache line with that line's own lock.
+class vw::Cache::SpillStore : private boost::noncopyable {
+  struct Entry {
+    size_t size;
+    std::list<uint64>::iterator lru;
+  };
+  std::string m_prefix;
+  size_t m_max_size, m_size;
+  std::list<uint64> m_lru; // Most recently used first
+  std::map<uint64, Entry> m_entries;
+  Mutex m_mutex;
+
+  std::string filename( uint64 id ) const {
+    std::ostringstream oss;
+    oss << m_prefix << id;
+    return oss.str();
+  }
+
+  // The caller must hold m_mutex.
+  void erase_locked( std::map<uint64, Entry>::iterator it ) {
+    std::remove( filename(it->first).c_str() );
+    m_size -= it->second.size;
+    m_lru.erase( it->second.lru );
+    m_entries.erase( it );
+  }
+
+public:
+  SpillStore( std::string const& directory, size_t max_size )
+    : m_max_size(max_size), m_size(0) {
+    long pid = 0;
+#ifdef VW_HAVE_UNISTD_H
+    pid = long(getpid());
+#endif
+    std::ostringstream oss;
+    oss << directory << "/vw_spill_" << pid << "_" << this << "_";
+    m_prefix = oss.str();
   }
+
+  ~SpillStore() {
+    while( ! m_entries.empty() )
+      erase_locked( m_entries.begin() );
+  }
+
+  size_t size() {
+    Mutex::Lock lock(m_mutex);
+    return m_size;
+  }
+
+  bool contains( uint64 id ) {
+    Mutex::Lock lock(m_mutex);
+    return m_entries.count(id) != 0;
+  }
+
+  bool write( uint64 id, std::string const& bytes ) {
+    if( bytes.size() > m_max_size ) return false;
+    {
+      std::ofstream out( filename(id).c_str(), std::ios::binary | std::ios::trunc );
+      out.write( bytes.data(), bytes.size() );
+      if( ! out ) {
+        vw_out(DebugMessage, "cache") << "Cache failed to write spill file " << filename(id) << "\n";
+        out.close();
+        std::remove( filename(id).c_str() );
+        return false;
+      }
+    }
+    Mutex::Lock lock(m_mutex);
+    std::map<uint64, Entry>::iterator it = m_entries.find(id);
+    if( it != m_entries.end() ) {
+      m_size -= it->second.size;
+      m_lru.erase( it->second.lru );
+      m_entries.erase( it );
+    }
+    while( m_size + bytes.size() > m_max_size && ! m_lru.empty() )
+      erase_locked( m_entries.find( m_lru.back() ) );
+    m_lru.push_front( id );
+    Entry entry = { bytes.size(), m_lru.begin() };
+    m_entries[id] = entry;
+    m_size += bytes.size();
+    return true;
+  }
+
+  bool read( uint64 id, std::string& bytes ) {
+    std::ifstream in;
+    {
+      Mutex::Lock lock(m_mutex);
+      std::map<uint64, Entry>::iterator it = m_entries.find(id);
+      if( it == m_entries.end() ) return false;
+      m_lru.splice( m_lru.begin(), m_lru, it->second.lru );
+      bytes.resize( it->second.size );
+      // Open while locked so that a concurrent eviction can only
+      // unlink the file, not remove it before we get to it.
+      in.open( filename(id).c_str(), std::ios::binary );
+    }
+    if( bytes.empty() ) return in.good();
+    return in.read( &bytes[0], bytes.size() ).good();
+  }
+
+  void erase( uint64 id ) {
+    Mutex::Lock lock(m_mutex);
+    std::map<uint64, Entry>::iterator it = m_entries.find(id);
+    if( it != m_entries.end() )
+      erase_locked( it );
+  }
+};
+
+void vw::Cache::set_spill( std::string const& directory, size_t max_size ) {
+  // Declared before the lock so the old store (and its files) goes
+  // away after the lock is released.
+  boost::shared_ptr<SpillStore> old;
+  Mutex::Lock lock(m_spill_mutex);
+  old = m_spill;
+  if( max_size > 0 )
+    m_spill.reset( new SpillStore( directory, max_size ) );
+  else
+    m_spill.reset();
+  m_spill_enabled.store( m_spill ? 1 : 0 );
+}
+
+size_t vw::Cache::spill_size() const {
+  boost::shared_ptr<SpillStore> spill = spill_store();
+  return spill ? spill->size() : 0;
+}
+
+boost::shared_ptr<vw::Cache::SpillStore> vw::Cache::spill_store() const {
+  if( ! spill_enabled() ) return boost::shared_ptr<SpillStore>();
+  Mutex::Lock lock(m_spill_mutex);
+  return m_spill;
+}
+
+bool vw::Cache::spill_contains( uint64 id ) const {
+  boost::shared_ptr<SpillStore> spill = spill_store();
+  return spill && spill->contains(id);
+}
+
+bool vw::Cache::spill_write( uint64 id, std::string const& bytes ) {
+  boost::shared_ptr<SpillStore> spill = spill_store();
+  return spill && spill->write(id, bytes);
+}
+
+bool vw::Cache::spill_read( uint64 id, std::string& bytes ) {
+  boost::shared_ptr<SpillStore> spill = spill_store();
+  return spill && spill->read(id, bytes);
+}
+
+void vw::Cache::spill_erase( uint64 id ) {
+  boost::shared_ptr<SpillStore> spill = spill_store();
+  if( spill ) spill->erase(id);
+}
+
+// Evictions only queue their values, since serializing a value and
+// writing it to disk under the shard lock would stall every other
+// thread using that shard.  The writes happen here instead, after the
+// lock is released.
+void vw::Cache::write_spills( Shard& shard ) {
+  if( ! spill_enabled() ) return;
+  std::vector<boost::shared_ptr<PendingSpill> > pending;
+  {
+    Mutex::Lock lock(shard.m_mutex);
+    pending.swap( shard.m_pending_spills );
+  }
+  for( size_t i = 0; i < pending.size(); ++i ) {
+    PendingSpill const& spill = *pending[i];
+    bool written = false;
+    try {
+      std::ostringstream os;
+      spill.write( os );
+      written = spill_write( spill.id, os.str() );
+    } catch( const std::exception& e ) {
+      vw_out(DebugMessage, "cache") << "Cache failed to spill line " << spill.id << ": " << e.what() << "\n";
+    }
+    bool orphaned;
+    {
+      Mutex::Lock lock(shard.m_mutex);
+      orphaned = shard.m_spilling.erase( spill.id ) == 0;
+      if( written && ! orphaned ) spill.stats->spills++;
+    }
+    // The line was destroyed while its value was being written.
+    if( written && orphaned ) spill_erase( spill.id );
+  }
+}
+
+vw::FifoWorkQueue& vw::Cache::prefetch_queue() {
+  Mutex::Lock lock(m_prefetch_mutex);
+  if( ! m_prefetch_queue )
+    m_prefetch_queue.reset( new FifoWorkQueue( vw_settings().default_num_threads() ) );
+  return *m_prefetch_queue;
 }
 
 void vw::Cache::deallocate( size_t size ) {
-  m_size -= size;
-  VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache deallocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
+  size_t new_size = m_size.sub(size);
+  VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache deallocated " << size << " bytes (" << new_size << " / " << m_max_size << " used)" << "\n"; )
 }
 
-// Move the cache line to the top of the valid list.
-void vw::Cache::validate( CacheLineBase *line ) {
-  if( line == m_first_valid ) return;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
-  if( line == m_first_invalid ) m_first_invalid = line->m_next;
+// Take the cache line off whichever list it is on.
+void vw::Cache::unlink( CacheLineBase *line ) {
+  if( line->m_list == NumLineLists ) return;
+  Shard& shard = line->m_shard;
+  CacheLineBase *&first = shard.m_first[line->m_list];
+  CacheLineBase *&last = shard.m_last[line->m_list];
+  if( line == first ) first = line->m_next;
+  if( line == last ) last = line->m_prev;
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_next = m_first_valid;
+  line->m_next = line->m_prev = 0;
+  shard.m_list_bytes[line->m_list] -= line->m_size;
+  line->m_list = NumLineLists;
+}
+
+void vw::Cache::push_front( CacheLineBase *line, LineList list ) {
+  Shard& shard = line->m_shard;
   line->m_prev = 0;
-  if( m_first_valid ) m_first_valid->m_prev = line;
-  m_first_valid = line;
-  if( ! m_last_valid ) m_last_valid = line;
+  line->m_next = shard.m_first[list];
+  if( shard.m_first[list] ) shard.m_first[list]->m_prev = line;
+  shard.m_first[list] = line;
+  if( ! shard.m_last[list] ) shard.m_last[list] = line;
+  shard.m_list_bytes[list] += line->m_size;
+  line->m_list = list;
+}
+
+void vw::Cache::push_back( CacheLineBase *line, LineList list ) {
+  Shard& shard = line->m_shard;
+  line->m_next = 0;
+  line->m_prev = shard.m_last[list];
+  if( shard.m_last[list] ) shard.m_last[list]->m_next = line;
+  shard.m_last[list] = line;
+  if( ! shard.m_first[list] ) shard.m_first[list] = line;
+  shard.m_list_bytes[list] += line->m_size;
+  line->m_list = list;
+}
+
+// Move the cache line to the top of the valid list.  Under
+// TwoQueueEviction a line that is used while already valid, or that
+// comes back after being evicted, goes to the protected list instead.
+void vw::Cache::validate( CacheLineBase *line ) {
+  LineList list = ProbationList;
+  if( eviction_policy() == TwoQueueEviction &&
+      ( line->m_list == ProbationList || line->m_list == ProtectedList || line->m_evicted ) )
+    list = ProtectedList;
+  if( line->m_list == list && line == line->m_shard.m_first[list] ) return;
+  unlink( line );
+  push_front( line, list );
 }
 
 // Move the cache line to the top of the invalid list.
 void vw::Cache::invalidate( CacheLineBase *line ) {
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
-  if( line->m_next ) line->m_next->m_prev = line->m_prev;
-  if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_next = m_first_invalid;
-  line->m_prev = 0;
-  if( m_first_invalid ) m_first_invalid->m_prev = line;
-  m_first_invalid = line;
+  unlink( line );
+  push_front( line, InvalidList );
 }
 
 // Remove the cache line from the cache lists.
 void vw::Cache::remove( CacheLineBase *line ) {
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line == m_last_valid ) m_last_valid = line->m_prev;
-  if( line == m_first_invalid ) m_first_invalid = line->m_next;
-  if( line->m_next ) line->m_next->m_prev = line->m_prev;
-  if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_next = line->m_prev = 0;
+  unlink( line );
 }
 
-// Move the cache line to the bottom of the valid list.
+// Move the cache line to the bottom of the valid list, so that it
+// is the next to be evicted.
 void vw::Cache::deprioritize( CacheLineBase *line ) {
-  if( line == m_last_valid ) return;
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line->m_next ) line->m_next->m_prev = line->m_prev;
-  if( line->m_prev ) line->m_prev->m_next = line->m_next;
-  line->m_prev = m_last_valid;
-  line->m_next = 0;
-  m_last_valid->m_next = line;
-  m_last_valid = line;
+  if( line->m_list == ProbationList && line == line->m_shard.m_last[ProbationList] ) return;
+  unlink( line );
+  push_back( line, ProbationList );
 }
-
@@ -32,13 +32,39 @@
 ///  The entire Handle<GeneratorT> class
 ///
 /// No other functions are guaranteed to be thread-safe.  There are
-/// two levels of synchronization: one lock per cache to protect the
-/// cache data structure itself, and one lock per cache line to
-/// protect the m_value pointer and synchronize the (potentially very
-/// expensive) generation operation.  However, the lock on the cache
-/// line ends just before the generate() method is called on the
-/// m_value object itself, so that object is responsible for its own
-/// thread safety.
+/// two levels of synchronization: one lock per cache shard to protect
+/// the LRU lists, and one lock per cache line to protect the m_value
+/// pointer and synchronize the (potentially very expensive)
+/// generation operation.  However, the lock on the cache line ends
+/// just before the generate() method is called on the m_value object
+/// itself, so that object is responsible for its own thread safety.
+///
+/// By default a cache has a single shard, which gives exact LRU
+/// behavior.  When many threads are hitting the same cache, the
+/// shard lock becomes a bottleneck, so the cache can be split into
+/// several shards with set_num_shards() (or the system_cache_shards
+/// setting for the system cache).  Each new cache line is assigned
+/// to a shard round-robin; each shard keeps its own LRU lists and
+/// lock, and all shards share one memory budget.  A shard that needs
+/// room evicts its own least recently used lines, so eviction order
+/// is only LRU within a shard.
+///
+/// Which line is evicted is chosen by the cache's EvictionPolicy (see
+/// set_eviction_policy()).  The default is plain LRU.  TwoQueueEviction
+/// resists a single streaming pass (say, block_write_image sweeping
+/// a large image) flushing a small working set that is being reused.
+/// CostWeightedEviction prefers to evict whatever was cheap to
+/// generate.
+///
+/// A cache can also be given a second tier on local disk with
+/// set_spill().  Evicted values whose type has a CacheSpillTraits
+/// specialization (see CacheSpill.h) are written to a scratch
+/// directory, within a separate byte budget, and read back on the
+/// next miss instead of being regenerated.  This pays off when
+/// generation is much slower than a local disk read, e.g. for warped
+/// or decoded image blocks.  The spill tier is disabled by default.
+/// Values are written after the shard lock is released, by the
+/// thread whose allocation evicted them.
 ///
 /// Note also that the valid() function is only useful as a heuristic:
 /// there is no guarantee that the cache line won't be invalidated
@@ -58,10 +84,16 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/System.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/CacheSpill.h>
 
 #include <boost/shared_ptr.hpp>
 #include <typeinfo>
 #include <sstream>
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
 
 namespace vw {
 namespace core {
@@ -92,24 +124,125 @@ namespace vw {
 
   // An LRU-based regeneratable-data cache
   class Cache {
+  public:
+    /// Usage counters for one generator type (or, from stats(), for
+    /// the cache as a whole).  A miss on a line that has been
+    /// generated before is a regeneration; lots of those mean the
+    /// cache is too small for the working set.  Misses that were
+    /// generated by Handle::prefetch() are also counted in prefetches.
+    /// Evictions written to the spill tier are counted in spills, and
+    /// misses satisfied from it in spill_hits (these are not counted
+    /// as generated bytes or generation time).
+    struct GeneratorStats {
+      uint64 hits, misses, evictions, prefetches;
+      uint64 spills, spill_hits;
+      uint64 bytes_generated, bytes_regenerated;
+      uint64 generation_microseconds;
+      GeneratorStats() : hits(0), misses(0), evictions(0), prefetches(0),
+                         spills(0), spill_hits(0),
+                         bytes_generated(0), bytes_regenerated(0),
+                         generation_microseconds(0) {}
+      GeneratorStats& operator+=( GeneratorStats const& o ) {
+        hits += o.hits; misses += o.misses; evictions += o.evictions; prefetches += o.prefetches;
+        spills += o.spills; spill_hits += o.spill_hits;
+        bytes_generated += o.bytes_generated; bytes_regenerated += o.bytes_regenerated;
+        generation_microseconds += o.generation_microseconds;
+        return *this;
+      }
+    };
+
+    /// How a cache chooses which lines to evict when it needs room.
+    enum EvictionPolicy {
+      /// Least recently used first.
+      LRUEviction,
+      /// Scan resistant "2Q".  New lines go into a probationary list
+      /// and are promoted to a protected list when they are used
+      /// again, or regenerated after an eviction.  Lines are evicted
+      /// from the probationary list while it holds more than a quarter
+      /// of the cache, so one pass over many lines cannot push out a
+      /// working set that keeps being reused.
+      TwoQueueEviction,
+      /// Among the least recently used lines, evict the ones that were
+      /// cheapest to generate per byte first, using the generation
+      /// time measured the last time each was generated.
+      CostWeightedEviction
+    };
+
+  private:
 
     // The abstract base class for all cache line objects.
+    class CacheLineBase;
+
+    // The lists a cache line can be on.  A line that is not on any
+    // list (only while it is being constructed or destroyed) has
+    // NumLineLists as its list.  Valid lines are on the probation list,
+    // except under TwoQueueEviction, which also uses the protected list.
+    enum LineList { InvalidList = 0, ProbationList, ProtectedList, NumLineLists };
+
+    // A value evicted under a shard lock.  Serializing it and writing
+    // it to the spill tier waits until the lock is released; see
+    // write_spills().
+    class PendingSpill {
+    public:
+      const uint64 id;
+      GeneratorStats *const stats;
+      PendingSpill( uint64 id, GeneratorStats *stats ) : id(id), stats(stats) {}
+      virtual ~PendingSpill() {}
+      virtual void write( std::ostream& os ) const = 0;
+    };
+
+    // One independently locked set of LRU lists.
+    struct Shard : private boost::noncopyable {
+      // Each list is kept most recently used first.
+      CacheLineBase *m_first[NumLineLists], *m_last[NumLineLists];
+      size_t m_list_bytes[NumLineLists];
+      Mutex m_mutex;
+      vw::uint64 m_hits, m_misses, m_evictions;
+      // Keyed by typeid(GeneratorT).name().  Entries are never erased,
+      // so cache lines can keep a pointer to theirs.
+      std::map<std::string, GeneratorStats> m_generator_stats;
+      // Values evicted but not yet written to the spill tier, and the
+      // ids of the lines with a write queued or in progress.  A line
+      // that is destroyed drops its id, so a late write is undone.
+      std::vector<boost::shared_ptr<PendingSpill> > m_pending_spills;
+      std::set<uint64> m_spilling;
+      Shard() : m_hits(0), m_misses(0), m_evictions(0) {
+        for( int i = 0; i < NumLineLists; ++i ) {
+          m_first[i] = m_last[i] = 0;
+          m_list_bytes[i] = 0;
+        }
+      }
+    };
+
     class CacheLineBase {
       Cache& m_cache;
+      Shard& m_shard;
+      const uint64 m_id; // Key for this line in the spill tier
       CacheLineBase *m_prev, *m_next;
       const size_t m_size;
+      // Guarded by the shard lock
+      GeneratorStats *m_stats;
+      LineList m_list;
+      bool m_evicted;  // Has been evicted at least once
+      uint64 m_cost;   // Microseconds the last generation took
       friend class Cache;
     protected:
       Cache& cache() const { return m_cache; }
-      inline void allocate() { m_cache.allocate(m_size); }
+      Shard& shard() const { return m_shard; }
+      uint64 id() const { return m_id; }
+      GeneratorStats& stats() const { return *m_stats; }
+      void set_stats( GeneratorStats *stats ) { m_stats = stats; }
+      void set_cost( uint64 microseconds ) { m_cost = microseconds; }
+      inline void allocate() { m_cache.allocate(m_shard, m_size); }
       inline void deallocate() { m_cache.deallocate(m_size); }
       inline void validate() { m_cache.validate(this); }
       inline void remove() { m_cache.remove( this ); }
       inline void deprioritize() { m_cache.deprioritize(this); }
     public:
-      CacheLineBase( Cache& cache, size_t size ) : m_cache(cache), m_prev(0), m_next(0), m_size(size) {}
+      CacheLineBase( Cache& cache, size_t size ) : m_cache(cache), m_shard(cache.next_shard()), m_id(cache.m_next_line_id.add(1)), m_prev(0), m_next(0), m_size(size), m_stats(0), m_list(NumLineLists), m_evicted(false), m_cost(0) {}
       virtual ~CacheLineBase() {}
       virtual inline void invalidate() { m_cache.invalidate(this); }
+      virtual inline bool try_invalidate() { invalidate(); return true; }
       virtual size_t size() const { return m_size; }
     };
     friend class CacheLineBase;
@@ -119,24 +252,31 @@ namespace vw {
     class CacheLine : public CacheLineBase {
       GeneratorT m_generator;
       typedef typename boost::shared_ptr<typename core::detail::GenValue<GeneratorT>::type> value_type;
+      typedef CacheSpillTraits<typename core::detail::GenValue<GeneratorT>::type> spill_traits;
       value_type m_value;
       Mutex m_mutex; // Mutex for m_value and generation of this cache line
       unsigned m_generation_count;
+      bool m_prefetch_pending;
 
     public:
       CacheLine( Cache& cache, GeneratorT const& generator )
-        : CacheLineBase(cache,core::detail::pointerish(generator)->size()), m_generator(generator), m_generation_count(0)
+        : CacheLineBase(cache,core::detail::pointerish(generator)->size()), m_generator(generator), m_generation_count(0), m_prefetch_pending(false)
       {
         VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache creating CacheLine " << info() << "\n"; )
-        Mutex::Lock cache_lock(cache.m_mutex);
+        Mutex::Lock cache_lock(shard().m_mutex);
+        set_stats( &shard().m_generator_stats[typeid(GeneratorT).name()] );
         CacheLineBase::invalidate();
       }
 
       virtual ~CacheLine() {
-        Mutex::Lock cache_lock(cache().m_mutex);
+        Mutex::Lock cache_lock(shard().m_mutex);
         invalidate();
         VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache destroying CacheLine " << info() << "\n"; )
         remove();
+        if( spill_traits::value ) {
+          shard().m_spilling.erase( id() );
+          cache().spill_erase( id() );
+        }
       }
 
       virtual void invalidate() {
@@ -148,6 +288,24 @@ namespace vw {
         m_value.reset();
       }
 
+      // Like invalidate(), but gives up if another thread holds the
+      // line lock.  Eviction calls this with the shard lock held, and
+      // a thread in value() holds its line lock while waiting for the
+      // shard lock, so blocking here could deadlock.  A line that is
+      // locked is in use anyway, so it is a poor eviction candidate.
+      virtual bool try_invalidate() {
+        if( ! m_mutex.try_lock() ) return false;
+        if( m_value ) {
+          VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache invalidating CacheLine " << info() << "\n"; );
+          queue_spill();
+          CacheLineBase::invalidate();
+          CacheLineBase::deallocate();
+          m_value.reset();
+        }
+        m_mutex.unlock();
+        return true;
+      }
+
       std::string info() {
         std::ostringstream oss;
         oss << typeid(this).name() << " " << this
@@ -155,33 +313,156 @@ namespace vw {
         return oss.str();
       }
 
-      value_type const& value() {
-        bool hit = true;
-        Mutex::Lock line_lock(m_mutex);
+      // Keeps an evicted value alive until write_spills() gets to it.
+      class SpillValue : public PendingSpill {
+        value_type m_value;
+      public:
+        SpillValue( uint64 id, GeneratorStats *stats, value_type const& value )
+          : PendingSpill(id, stats), m_value(value) {}
+        virtual void write( std::ostream& os ) const { spill_traits::write( os, *m_value ); }
+      };
+
+      // Queue the value for the spill tier as it is evicted, unless a
+      // copy is already there or on its way.  The caller must hold the
+      // line lock and the shard lock.
+      void queue_spill() {
+        if( ! spill_traits::value || ! cache().spill_enabled() ||
+            shard().m_spilling.count( id() ) || cache().spill_contains( id() ) )
+          return;
+        shard().m_spilling.insert( id() );
+        shard().m_pending_spills.push_back( boost::shared_ptr<PendingSpill>( new SpillValue( id(), &stats(), m_value ) ) );
+      }
+
+      // Try to read an evicted value back from the spill tier.  The
+      // caller must hold the line lock.
+      bool read_spilled( std::string& bytes ) {
+        return spill_traits::value && cache().spill_read( id(), bytes );
+      }
+
+      bool unspill( std::string const& bytes ) {
+        std::istringstream is( bytes );
+        m_value = spill_traits::read( is );
+        return (bool)m_value;
+      }
+
+      // Generate the value if needed and move the line to the front of
+      // the LRU list.  The caller must hold the line lock.
+      void fill( bool count_hit ) {
+        bool hit = true, reloaded = false;
+        uint64 elapsed = 0;
         if( !m_value ) {
-          m_generation_count++;
           hit = false;
-          VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache generating CacheLine " << info() << "\n"; )
+          uint64 start = Stopwatch::microtime();
+          // Read before allocating, since making room may spill other
+          // lines and push this one out of the spill tier.
+          std::string bytes;
+          bool spilled = read_spilled( bytes );
           {
-            Mutex::Lock cache_lock(cache().m_mutex);
+            Mutex::Lock cache_lock(shard().m_mutex);
             CacheLineBase::allocate();
           }
-          ScopedWatch sw((std::string("Cache ")
-                          + (m_generation_count == 1 ? "generating " : "regenerating ")
-                          + typeid(this).name()).c_str());
-          m_value = core::detail::pointerish(m_generator)->generate();
+          cache().write_spills( shard() );
+          if( spilled )
+            reloaded = unspill( bytes );
+          if( ! reloaded ) {
+            m_generation_count++;
+            VW_CACHE_DEBUG( vw_out(DebugMessage, "cache") << "Cache generating CacheLine " << info() << "\n"; )
+            ScopedWatch sw((std::string("Cache ")
+                            + (m_generation_count == 1 ? "generating " : "regenerating ")
+                            + typeid(this).name()).c_str());
+            m_value = core::detail::pointerish(m_generator)->generate();
+          }
+          elapsed = Stopwatch::microtime() - start;
         }
         {
-          Mutex::Lock cache_lock(cache().m_mutex);
+          Mutex::Lock cache_lock(shard().m_mutex);
           CacheLineBase::validate();
-          if (hit)
-            cache().m_hits++;
-          else
-            cache().m_misses++;
+          if (hit) {
+            if (count_hit) {
+              shard().m_hits++;
+              stats().hits++;
+            }
+          } else {
+            shard().m_misses++;
+            stats().misses++;
+            if (reloaded) {
+              stats().spill_hits++;
+            } else {
+              stats().bytes_generated += size();
+              if (m_generation_count > 1)
+                stats().bytes_regenerated += size();
+              stats().generation_microseconds += elapsed;
+              set_cost( elapsed );
+            }
+            if (!count_hit)
+              stats().prefetches++;
+          }
         }
+        if (!hit || count_hit)
+          Cache::count_lookup( hit, reloaded, elapsed );
+      }
+
+      // Returns a copy of the pointer taken under the line lock, so the
+      // value stays alive even if another thread evicts this line.  If
+      // a prefetch is generating the value right now, this waits for it
+      // on the line lock.
+      value_type value() {
+        Mutex::Lock line_lock(m_mutex);
+        fill( true );
         return m_value;
       }
 
+      // Claim this line for a background prefetch.  Returns false if
+      // there is nothing to do: the value is already there, a prefetch
+      // is already queued, or another thread holds the line right now
+      // (and is presumably generating it).  Never blocks.
+      bool begin_prefetch() {
+        if( ! m_mutex.try_lock() ) return false;
+        bool claimed = ! m_value && ! m_prefetch_pending;
+        if( claimed ) m_prefetch_pending = true;
+        m_mutex.unlock();
+        return claimed;
+      }
+
+      // True if the value is not there and nobody is making it.  Never
+      // blocks: a line another thread holds counts as being made.
+      bool missing() {
+        if( ! m_mutex.try_lock() ) return false;
+        bool result = ! m_value && ! m_prefetch_pending;
+        m_mutex.unlock();
+        return result;
+      }
+
+      // Move the line to the front of the LRU list if its value is
+      // there, without generating it or counting a hit.  Never blocks:
+      // a line another thread holds is left where it is.
+      void touch() {
+        if( ! m_mutex.try_lock() ) return;
+        if( m_value ) {
+          Mutex::Lock cache_lock(shard().m_mutex);
+          CacheLineBase::validate();
+        }
+        m_mutex.unlock();
+      }
+
+      // Run from the prefetch thread.  Does not count as a hit if a
+      // foreground dereference already generated the value.  Errors are
+      // not reported here; the value stays empty and the foreground
+      // dereference regenerates it and sees the error itself.
+      void finish_prefetch() {
+        Mutex::Lock line_lock(m_mutex);
+        m_prefetch_pending = false;
+        try {
+          fill( false );
+        } catch( const std::exception& e ) {
+          vw_out(DebugMessage, "cache") << "Cache prefetch failed for CacheLine " << info() << ": " << e.what() << "\n";
+        }
+      }
+
+      void prefetch( boost::shared_ptr<CacheLine> const& self ) {
+        cache().prefetch( self );
+      }
+
       bool valid() {
         Mutex::Lock line_lock(m_mutex);
         return (bool)m_value;
@@ -190,19 +471,79 @@ namespace vw {
       void deprioritize() {
         Mutex::Lock line_lock(m_mutex);
         if( m_value ) {
-          Mutex::Lock cache_lock(cache().m_mutex);
+          Mutex::Lock cache_lock(shard().m_mutex);
           CacheLineBase::deprioritize();
         }
       }
     };
 
+    // Generates one cache line in the background.  It holds a shared
+    // pointer to the line so the line outlives the task.
+    template <class GeneratorT>
+    class PrefetchTask : public Task {
+      boost::shared_ptr<CacheLine<GeneratorT> > m_line;
+    public:
+      PrefetchTask( boost::shared_ptr<CacheLine<GeneratorT> > const& line ) : m_line(line) {}
+      virtual void operator()() { m_line->finish_prefetch(); }
+    };
+
+    template <class GeneratorT>
+    void prefetch( boost::shared_ptr<CacheLine<GeneratorT> > const& line ) {
+      if( ! line->begin_prefetch() ) return;
+      prefetch_queue().add_task( boost::shared_ptr<Task>( new PrefetchTask<GeneratorT>( line ) ) );
+    }
 
-    CacheLineBase *m_first_valid, *m_last_valid, *m_first_invalid;
-    size_t m_size, m_max_size;
-    Mutex m_mutex;
-    vw::uint64 m_hits, m_misses, m_evictions;
+    FifoWorkQueue& prefetch_queue();
+
+    // Shards are created on demand by set_num_shards() and are never
+    // destroyed before the cache itself, so cache lines can hold a
+    // plain reference to theirs.
+    enum { MaxShards = 64 };
+    boost::shared_ptr<Shard> m_shards[MaxShards];
+    Atomic<uint32> m_num_shards, m_next_shard;
+    Mutex m_shards_mutex;
+
+    Atomic<size_t> m_size;
+    size_t m_max_size;
+    Atomic<uint64> m_next_line_id;
+    Atomic<uint32> m_eviction_policy;
+
+    // The on-disk second tier, defined in Cache.cc.  Lines reach it
+    // through the spill_*() helpers, which are cheap no-ops while it
+    // is disabled.
+    class SpillStore;
+    boost::shared_ptr<SpillStore> m_spill;
+    Atomic<uint32> m_spill_enabled;
+    mutable Mutex m_spill_mutex;
+
+    boost::shared_ptr<SpillStore> spill_store() const;
+    bool spill_enabled() const { return m_spill_enabled.load() != 0; }
+    bool spill_contains( uint64 id ) const;
+    bool spill_write( uint64 id, std::string const& bytes );
+    bool spill_read( uint64 id, std::string& bytes );
+    void spill_erase( uint64 id );
+    // Writes the values evictions have queued on a shard.  The caller
+    // must not hold the shard lock.
+    void write_spills( Shard& shard );
+
+    Shard& next_shard() {
+      uint32 n = m_num_shards.load();
+      return *m_shards[n == 1 ? 0 : m_next_shard.add(1) % n];
+    }
 
-    void allocate( size_t size );
+    bool over_budget( size_t size ) const { return m_size.load() + size > m_max_size; }
+    bool evict( Shard& shard, CacheLineBase *line );
+    void evict_lru( Shard& shard, LineList list, size_t size, size_t keep_bytes = 0 );
+    void evict_cheapest( Shard& shard, LineList list, size_t size );
+    static bool cheaper_per_byte( CacheLineBase const* a, CacheLineBase const* b );
+    // Reports a lookup to vw_perf_counters().
+    static void count_lookup( bool hit, bool reloaded, uint64 microseconds );
+    void make_room( Shard& shard, size_t size );
+    void unlink( CacheLineBase *line );
+    void push_front( CacheLineBase *line, LineList list );
+    void push_back( CacheLineBase *line, LineList list );
+
+    void allocate( Shard& shard, size_t size );
     void deallocate( size_t size );
     void validate( CacheLineBase *line );
     void invalidate( CacheLineBase *line );
@@ -245,15 +586,37 @@ namespace vw {
         VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
         return m_line_ptr->deprioritize();
       }
+      /// Start generating the value on a background thread and return
+      /// immediately.  A later dereference only waits if generation is
+      /// still in progress.  Does nothing if the value is already
+      /// valid or being generated.
+      void prefetch() const {
+        VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+        m_line_ptr->prefetch( m_line_ptr );
+      }
+      /// True if the value is neither cached nor being generated.
+      /// Unlike valid(), this never waits for another thread.
+      bool missing() const {
+        VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+        return m_line_ptr->missing();
+      }
+      /// Mark the value as just used, if it is cached, so that it is
+      /// the last to be evicted.  For values that are used through a
+      /// copy held elsewhere; never generates and never waits.
+      void touch() const {
+        VW_ASSERT( m_line_ptr, NullPtrErr() << "Invalid cache handle!" );
+        m_line_ptr->touch();
+      }
       bool attached() const {
         return (bool)m_line_ptr;
       }
     };
 
-    Cache( size_t max_size ) :
-      m_first_valid(0), m_last_valid(0), m_first_invalid(0),
-      m_size(0), m_max_size(max_size),
-      m_hits(0), m_misses(0), m_evictions(0) {}
+    Cache( size_t max_size, uint32 num_shards = 1 ) :
+      m_num_shards(0), m_next_shard(0), m_size(0), m_max_size(max_size),
+      m_next_line_id(0), m_eviction_policy(LRUEviction), m_spill_enabled(0) {
+      set_num_shards(num_shards);
+    }
 
     template <class GeneratorT>
     Handle<GeneratorT> insert( GeneratorT const& generator ) {
@@ -265,13 +628,47 @@ namespace vw {
     void resize( size_t size );
     size_t max_size() { return m_max_size; }
 
-    uint64 hits() const { return m_hits; }
-    uint64 misses() const { return m_misses; }
-    uint64 evictions() const {return m_evictions; }
-    void clear_stats() {
-      Mutex::Lock cache_lock(m_mutex);
-      m_hits = m_misses = m_evictions = 0;
-    }
+    /// Set the number of shards that new cache lines are spread
+    /// across (clamped to [1, 64]).  Existing cache lines stay in the
+    /// shard they were created in.
+    void set_num_shards( uint32 num_shards );
+    uint32 num_shards() const { return m_num_shards.load(); }
+
+    /// Choose how lines are picked for eviction.  This can be changed
+    /// at any time; lines already in the cache keep their place.
+    void set_eviction_policy( EvictionPolicy policy ) { m_eviction_policy.store(policy); }
+    EvictionPolicy eviction_policy() const { return EvictionPolicy(m_eviction_policy.load()); }
+
+    /// Enable the on-disk spill tier, keeping up to max_size bytes of
+    /// evicted values in files under directory.  A max_size of zero
+    /// disables it.  Any previously spilled data is discarded.
+    void set_spill( std::string const& directory, size_t max_size );
+    /// Bytes currently held in the spill tier.
+    size_t spill_size() const;
+
+    uint64 hits() const;
+    uint64 misses() const;
+    uint64 evictions() const;
+    void clear_stats();
+
+    /// Counters summed over every generator type.
+    GeneratorStats stats() const;
+
+    /// Counters broken down by generator type, keyed by the
+    /// (demangled, where possible) name of the generator type.
+    std::map<std::string, GeneratorStats> generator_stats() const;
+
+    /// A human-readable table of generator_stats(), with the most
+    /// expensive generators first.  The system cache writes this to
+    /// vw_out(DebugMessage, "cache") when the program exits.
+    std::string stats_report() const;
+
+  private:
+    // Created the first time something is prefetched.  Declared last
+    // so it is destroyed (and its pending tasks joined) before the
+    // shards the tasks refer to.
+    Mutex m_prefetch_mutex;
+    boost::shared_ptr<FifoWorkQueue> m_prefetch_queue;
   };
 } // namespace vw
 
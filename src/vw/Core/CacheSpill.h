@@ -0,0 +1,41 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/CacheSpill.h
+///
+/// Traits that let a vw::Cache write evicted values to its on-disk
+/// spill tier (see Cache::set_spill()) and read them back later
+/// instead of regenerating them.
+///
+/// This lives apart from Cache.h so that value types can opt in
+/// without pulling in the whole cache.  A specialization must be
+/// visible wherever the value type is complete, so it belongs in the
+/// header that defines the type (see ImageView.h for an example).
+///
+#ifndef __VW_CORE_CACHESPILL_H__
+#define __VW_CORE_CACHESPILL_H__
+
+#include <iostream>
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  /// Specialize this with value = true to allow values of type T to
+  /// be spilled.  write() serializes a value to the stream; read()
+  /// returns a new value read from the stream, or an empty pointer
+  /// if the data is unusable.  The data is only ever read back by
+  /// the same process that wrote it.
+  template <class T>
+  struct CacheSpillTraits {
+    static const bool value = false;
+    static void write( std::ostream& /*os*/, T const& /*value*/ ) {}
+    static boost::shared_ptr<T> read( std::istream& /*is*/ ) { return boost::shared_ptr<T>(); }
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_CACHESPILL_H__
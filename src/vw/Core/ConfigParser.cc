@@ -89,12 +89,32 @@ void vw::parse_config(std::basic_istream<char>& stream,
     try {
       if (o.string_key == "general.default_num_threads")
         settings.set_default_num_threads(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.worker_affinity")
+        settings.set_worker_affinity(o.value[0]);
       else if (o.string_key == "general.system_cache_size")
         settings.set_system_cache_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.system_cache_shards")
+        settings.set_system_cache_shards(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.system_cache_spill_size")
+        settings.set_system_cache_spill_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.buffer_pool_size")
+        settings.set_buffer_pool_size(boost::lexical_cast<size_t>(o.value[0]));
       else if (o.string_key == "general.default_tile_size")
         settings.set_default_tile_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.approximate_gaussian")
+        settings.set_approximate_gaussian(boost::lexical_cast<bool>(o.value[0]));
+      else if (o.string_key == "general.max_open_resources")
+        settings.set_max_open_resources(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.write_pool_size")
         settings.set_write_pool_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.io_threads")
+        settings.set_io_threads(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.hdf_chunk_cache_size")
+        settings.set_hdf_chunk_cache_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.perf_counters_file")
+        settings.set_perf_counters_file(o.value[0]);
+      else if (o.string_key == "general.perf_counters_period")
+        settings.set_perf_counters_period(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.tmp_directory")
         settings.set_tmp_directory(o.value[0]);
       else if (o.string_key.compare(0, 8, "logfile ") == 0) {
@@ -152,6 +152,11 @@ namespace vw {
 
     VW_IF_EXCEPTIONS( virtual void default_throw() const { throw *this; } )
 
+    /// Returns a heap-allocated copy of this exception with the same
+    /// dynamic type, so it can be stored and rethrown later (via
+    /// default_throw()) from another thread.
+    virtual Exception* clone() const { return new Exception(*this); }
+
   protected:
       virtual std::ostringstream& stream() {return m_desc;}
 
@@ -207,6 +212,7 @@ namespace vw {
   #define VW_EXCEPTION_API(exception_type)                                     \
     virtual std::string name() const { return #exception_type; }               \
     VW_IF_EXCEPTIONS( virtual void default_throw() const { throw *this; } )    \
+    virtual exception_type* clone() const { return new exception_type(*this); } \
     template <class T>                                                         \
     exception_type& operator<<( T const& t ) { stream() << t; return *this; }
 
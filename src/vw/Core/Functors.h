@@ -215,6 +215,7 @@ namespace vw {
     const ValT m_val;
   public:
     ArgValSumFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename SumType<ArgT,ValT>::type operator()( ArgT const& arg ) const { return arg+m_val; }
@@ -227,6 +228,7 @@ namespace vw {
     const ValT m_val;
   public:
     ValArgSumFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename SumType<ValT,ArgT>::type operator()( ArgT const& arg ) const { return m_val+arg; }
@@ -263,6 +265,7 @@ namespace vw {
     const ValT m_val;
   public:
     ArgValDifferenceFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename DifferenceType<ArgT,ValT>::type operator()( ArgT const& arg ) const { return arg-m_val; }
@@ -275,6 +278,7 @@ namespace vw {
     const ValT m_val;
   public:
     ValArgDifferenceFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename DifferenceType<ValT,ArgT>::type operator()( ArgT const& arg ) const { return m_val-arg; }
@@ -311,6 +315,7 @@ namespace vw {
     const ValT m_val;
   public:
     ArgValProductFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename ProductType<ArgT,ValT>::type operator()( ArgT const& arg ) const { return arg*m_val; }
@@ -323,6 +328,7 @@ namespace vw {
     const ValT m_val;
   public:
     ValArgProductFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename ProductType<ValT,ArgT>::type operator()( ArgT const& arg ) const { return m_val*arg; }
@@ -416,6 +422,7 @@ namespace vw {
     const ValT m_val;
   public:
     ArgValSafeQuotientFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename QuotientType<ArgT,ValT>::type operator()( ArgT const& arg ) const {
@@ -431,6 +438,7 @@ namespace vw {
     const ValT m_val;
   public:
     ValArgSafeQuotientFunctor( ValT const& val ) : m_val(val) {}
+    ValT const& value() const { return m_val; }
 
     template <class ArgT>
     inline typename QuotientType<ValT,ArgT>::type operator()( ArgT const& arg ) const {
@@ -10,6 +10,9 @@
 #include <vw/Core/Log.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Settings.h>
+#include <vw/Core/ThreadQueue.h>
+
+#include <cstdlib>
 
 // C Standard Library headers ( for stat(2) and getpwuid() )
 #include <sys/types.h>
@@ -63,6 +66,160 @@ void vw::set_output_stream( std::ostream& stream ) {
   vw_log().set_console_stream(stream);
 }
 
+// ---------------------------------------------------
+// Asynchronous writer
+// ---------------------------------------------------
+namespace {
+
+  struct LogLine {
+    std::streambuf *out;
+    std::string text;
+    LogLine() : out(0) {}
+  };
+
+  // Drains a bounded queue of completed lines on its own thread.
+  class AsyncLogWriter : private boost::noncopyable {
+    vw::BoundedThreadQueue<LogLine> m_queue;
+    vw::Atomic<vw::uint64> &m_dropped;
+    vw::Atomic<vw::uint64> m_queued, m_written;
+    vw::uint64 m_reported_dropped;
+    vw::Atomic<vw::uint32> m_stop;
+    boost::shared_ptr<vw::Thread> m_thread;
+
+    struct Worker {
+      AsyncLogWriter *writer;
+      void operator()() { writer->run(); }
+    };
+
+    void write(LogLine const& line) {
+      vw::uint64 dropped = m_dropped.load();
+      if (dropped != m_reported_dropped) {
+        std::ostringstream note;
+        note << "[ " << dropped - m_reported_dropped << " log messages were dropped ]\n";
+        line.out->sputn(note.str().data(), note.str().size());
+        m_reported_dropped = dropped;
+      }
+      line.out->sputn(line.text.data(), line.text.size());
+      line.out->pubsync();
+    }
+
+    void run() {
+      LogLine line;
+      while (true) {
+        if (m_queue.timed_wait_pop(line, 100)) {
+          write(line);
+          ++m_written;
+        } else if (m_stop.load()) {
+          break;
+        }
+      }
+    }
+
+  public:
+    AsyncLogWriter(size_t backlog, vw::Atomic<vw::uint64> &dropped)
+      : m_queue(backlog), m_dropped(dropped), m_queued(0), m_written(0),
+        m_reported_dropped(dropped.load()), m_stop(0) {
+      Worker worker = { this };
+      m_thread.reset(new vw::Thread(worker));
+    }
+
+    // Writes out whatever is still queued before returning.
+    ~AsyncLogWriter() {
+      m_stop.store(1);
+      m_thread->join();
+    }
+
+    size_t capacity() const { return m_queue.capacity(); }
+
+    void push(std::streambuf *out, const char* s, std::streamsize num) {
+      LogLine line;
+      line.out = out;
+      line.text.assign(s, num);
+      if (m_queue.try_push(line))
+        ++m_queued;
+      else
+        ++m_dropped;
+    }
+
+    void flush() {
+      vw::uint64 target = m_queued.load();
+      while (m_written.load() < target)
+        vw::Thread::sleep_ms(1);
+    }
+  };
+
+  struct AsyncLogState {
+    vw::Mutex mutex;          // Read-locked to use the writer
+    AsyncLogWriter *writer;   // Null when writing synchronously
+    vw::Atomic<vw::uint32> enabled;
+    vw::Atomic<vw::uint64> dropped;
+    bool registered_atexit;
+    AsyncLogState() : writer(0), enabled(0), dropped(0), registered_atexit(false) {}
+  };
+
+  // Never destroyed; log lines can be written during static destruction.
+  AsyncLogState *async_log_ptr = 0;
+  vw::RunOnce async_log_once = VW_RUNONCE_INIT;
+  void init_async_log() { async_log_ptr = new AsyncLogState(); }
+
+  AsyncLogState& async_log() {
+    async_log_once.run(init_async_log);
+    return *async_log_ptr;
+  }
+
+  void flush_async_log_at_exit() { vw::detail::flush_async_log(); }
+}
+
+void vw::detail::write_log_line(std::basic_streambuf<char>* out, const char* s, std::streamsize num) {
+  AsyncLogState &state = async_log();
+  if (state.enabled.load()) {
+    Mutex::ReadLock lock(state.mutex);
+    if (state.writer) {
+      state.writer->push(out, s, num);
+      return;
+    }
+  }
+  out->sputn(s, num);
+  out->pubsync();
+}
+
+void vw::detail::flush_async_log() {
+  AsyncLogState &state = async_log();
+  if (!state.enabled.load())
+    return;
+  Mutex::ReadLock lock(state.mutex);
+  if (state.writer)
+    state.writer->flush();
+}
+
+void vw::Log::set_asynchronous(bool enabled, size_t backlog) {
+  AsyncLogState &state = async_log();
+  Mutex::Lock lock(state.mutex);
+  if (state.writer && enabled && state.writer->capacity() >= backlog)
+    return;
+  // Stop the old writer (which drains its queue) before starting a
+  // new one, so that lines are never written out of order.  Logging
+  // threads wait on the lock meanwhile.
+  delete state.writer;
+  state.writer = 0;
+  if (enabled) {
+    state.writer = new AsyncLogWriter(backlog, state.dropped);
+    if (!state.registered_atexit) {
+      std::atexit(flush_async_log_at_exit);
+      state.registered_atexit = true;
+    }
+  }
+  state.enabled.store(enabled ? 1 : 0);
+}
+
+bool vw::Log::asynchronous() {
+  return async_log().enabled.load() != 0;
+}
+
+vw::uint64 vw::Log::dropped_messages() {
+  return async_log().dropped.load();
+}
+
 // ---------------------------------------------------
 // LogInstance Methods
 // ---------------------------------------------------
@@ -19,6 +19,12 @@
 /// - A new line in the logfile starts every time a newline character
 ///   appears at the end of a string of characters, or when you
 ///   exlicitly add std::flush() to the stream of operators.
+///
+/// - By default each completed line is written to its stream on the
+///   thread that logged it.  Log::set_asynchronous() instead hands
+///   lines to a background writer through a bounded queue, so that
+///   logging threads never wait on file or console I/O.  If the queue
+///   is full, lines are dropped and counted rather than waited for.
 
 #ifndef __VW_CORE_LOG_H__
 #define __VW_CORE_LOG_H__
@@ -180,6 +186,23 @@ namespace vw {
   typedef MultiOutputStream<char> multi_ostream;
 
 
+  namespace detail {
+    // Write one completed line of log output to out.  Output to char
+    // streams goes through the asynchronous writer when that is
+    // enabled (see Log::set_asynchronous()); anything else is written
+    // directly.
+    template<class CharT, class traits>
+    inline void write_log_line(std::basic_streambuf<CharT, traits>* out, const CharT* s, std::streamsize num) {
+      out->sputn(s, num);
+      out->pubsync();
+    }
+    void write_log_line(std::basic_streambuf<char>* out, const char* s, std::streamsize num);
+
+    // Wait until everything handed to the asynchronous writer so far
+    // has been written.  Returns at once if it is not enabled.
+    void flush_async_log();
+  }
+
   // In order to create our own C++ streams compatible ostream object,
   // we must first define a subclass of basic_streambuf<>, which
   // handles stream output on a character by character basis.  This is
@@ -245,8 +268,7 @@ namespace vw {
     // You must call this with the lock already held!
     int locked_sync(buffer_type& buffer) {
       if(!buffer.empty() && m_out ) {
-        m_out->sputn(&buffer[0], boost::numeric_cast<std::streamsize>(buffer.size()));
-        m_out->pubsync();
+        detail::write_log_line(m_out, &buffer[0], boost::numeric_cast<std::streamsize>(buffer.size()));
         buffer.clear();
       }
       return 0;
@@ -375,6 +397,9 @@ namespace vw {
     LogInstance(std::ostream& log_ostream, bool prepend_infostamp = true);
 
     ~LogInstance() {
+      // Lines for our stream may still be waiting in the
+      // asynchronous writer's queue.
+      detail::flush_async_log();
       m_log_stream.set_stream(std::cout);
       if (m_log_ostream_ptr)
         delete static_cast<std::ofstream*>(m_log_ostream_ptr);
@@ -476,6 +501,22 @@ namespace vw {
       m_console_log = boost::shared_ptr<LogInstance>(new LogInstance(stream, prepend_infostamp) );
       m_console_log->rule_set() = rule_set;
     }
+
+    /// Write log output from a background thread instead of the
+    /// thread that logged it.  At most backlog lines are held in
+    /// memory; while the backlog is full, new lines are dropped and
+    /// counted in dropped_messages().  Disabling, or asking for a
+    /// larger backlog, first waits for queued lines to be written.
+    /// This setting is shared by every Log and LogInstance.
+    static void set_asynchronous(bool enabled, size_t backlog = 4096);
+    static bool asynchronous();
+
+    /// The number of lines dropped because the asynchronous backlog
+    /// was full.
+    static uint64 dropped_messages();
+
+    /// Wait for the asynchronous writer to catch up.
+    static void flush() { detail::flush_async_log(); }
   };
 
   /// The vision workbench logging operator.  Use this to generate a
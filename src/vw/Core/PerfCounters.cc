@@ -0,0 +1,173 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Core/PerfCounters.h>
+#include <vw/Core/Log.h>
+
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+  // Counter names are chosen by the code, but quote them properly anyway.
+  void write_json_string( std::ostream& out, std::string const& s ) {
+    out << '"';
+    for( size_t i=0; i<s.size(); ++i ) {
+      char c = s[i];
+      if( c == '"' || c == '\\' ) out << '\\' << c;
+      else if( (unsigned char)c < 0x20 ) out << ' ';
+      else out << c;
+    }
+    out << '"';
+  }
+
+}
+
+vw::uint64 vw::PerfHistogram::quantile( double fraction ) const {
+  uint64 total = count();
+  if( total == 0 ) return 0;
+  uint64 rank = uint64( fraction * double(total) );
+  if( rank >= total ) rank = total - 1;
+  uint64 seen = 0;
+  for( int i=0; i<num_buckets; ++i ) {
+    seen += bucket(i);
+    if( seen > rank ) return (std::min)( bucket_limit(i), max() );
+  }
+  return max();
+}
+
+void vw::PerfHistogram::reset() {
+  for( int i=0; i<num_buckets; ++i )
+    m_buckets[i].store( 0 );
+  m_count.store( 0 );
+  m_sum.store( 0 );
+  m_max.store( 0 );
+}
+
+// Dumps the registry every period seconds until told to stop.
+class vw::PerfCounterRegistry::DumpTask {
+  PerfCounterRegistry& m_registry;
+  uint32 m_period;
+public:
+  DumpTask( PerfCounterRegistry& registry, uint32 period ) : m_registry(registry), m_period(period) {}
+  void operator()() {
+    Mutex::Lock lock( m_registry.m_dump_mutex );
+    while( ! m_registry.m_dump_stop ) {
+      m_registry.m_dump_condition.timed_wait( lock, m_period * 1000 );
+      if( m_registry.m_dump_stop ) break;
+      lock.unlock();
+      m_registry.dump();
+      lock.lock();
+    }
+  }
+};
+
+vw::PerfCounterRegistry::PerfCounterRegistry() : m_dump_period(0), m_dump_stop(false) {}
+
+vw::PerfCounterRegistry::~PerfCounterRegistry() {
+  stop_dump_thread();
+}
+
+vw::PerfCounter& vw::PerfCounterRegistry::counter( std::string const& name ) {
+  Mutex::Lock lock( m_mutex );
+  boost::shared_ptr<PerfCounter>& c = m_counters[name];
+  if( ! c ) c.reset( new PerfCounter() );
+  return *c;
+}
+
+vw::PerfHistogram& vw::PerfCounterRegistry::histogram( std::string const& name ) {
+  Mutex::Lock lock( m_mutex );
+  boost::shared_ptr<PerfHistogram>& h = m_histograms[name];
+  if( ! h ) h.reset( new PerfHistogram() );
+  return *h;
+}
+
+void vw::PerfCounterRegistry::write_json( std::ostream& out ) const {
+  Mutex::Lock lock( m_mutex );
+  out << "{\n  \"time\": " << Stopwatch::microtime() / 1000000 << ",\n  \"counters\": {";
+  for( counter_map::const_iterator i = m_counters.begin(); i != m_counters.end(); ++i ) {
+    out << (i == m_counters.begin() ? "\n    " : ",\n    ");
+    write_json_string( out, i->first );
+    out << ": " << i->second->value();
+  }
+  out << "\n  },\n  \"histograms\": {";
+  for( histogram_map::const_iterator i = m_histograms.begin(); i != m_histograms.end(); ++i ) {
+    PerfHistogram const& h = *i->second;
+    out << (i == m_histograms.begin() ? "\n    " : ",\n    ");
+    write_json_string( out, i->first );
+    out << ": { \"count\": " << h.count() << ", \"sum\": " << h.sum() << ", \"max\": " << h.max()
+        << ", \"p50\": " << h.quantile(0.5) << ", \"p90\": " << h.quantile(0.9)
+        << ", \"p99\": " << h.quantile(0.99) << ", \"buckets\": [";
+    bool first = true;
+    for( int b=0; b<PerfHistogram::num_buckets; ++b ) {
+      uint64 n = h.bucket(b);
+      if( n == 0 ) continue;
+      out << (first ? "" : ", ") << "[" << PerfHistogram::bucket_limit(b) << ", " << n << "]";
+      first = false;
+    }
+    out << "] }";
+  }
+  out << "\n  }\n}\n";
+}
+
+void vw::PerfCounterRegistry::reset() {
+  Mutex::Lock lock( m_mutex );
+  for( counter_map::const_iterator i = m_counters.begin(); i != m_counters.end(); ++i )
+    i->second->set( 0 );
+  for( histogram_map::const_iterator i = m_histograms.begin(); i != m_histograms.end(); ++i )
+    i->second->reset();
+}
+
+void vw::PerfCounterRegistry::stop_dump_thread() {
+  {
+    Mutex::Lock lock( m_dump_mutex );
+    if( ! m_dump_thread ) return;
+    m_dump_stop = true;
+    m_dump_condition.notify_all();
+  }
+  m_dump_thread->join();
+  m_dump_thread.reset();
+  m_dump_stop = false;
+}
+
+void vw::PerfCounterRegistry::set_dump( std::string const& filename, uint32 period_seconds ) {
+  stop_dump_thread();
+  Mutex::Lock lock( m_dump_mutex );
+  m_dump_file = filename;
+  m_dump_period = period_seconds;
+  if( ! filename.empty() && period_seconds > 0 )
+    m_dump_thread.reset( new Thread( DumpTask( *this, period_seconds ) ) );
+}
+
+void vw::PerfCounterRegistry::dump() const {
+  std::string filename;
+  {
+    Mutex::Lock lock( m_dump_mutex );
+    filename = m_dump_file;
+  }
+  if( filename.empty() ) return;
+
+  // Write the whole dump aside and move it into place, so that
+  // whatever is watching the file never sees half of one.
+  Mutex::Lock lock( m_write_mutex );
+  std::string tmp = filename + ".tmp";
+  {
+    std::ofstream out( tmp.c_str() );
+    write_json( out );
+    if( ! out ) {
+      vw_out(WarningMessage, "perf") << "Could not write performance counters to " << tmp << "\n";
+      return;
+    }
+  }
+  if( std::rename( tmp.c_str(), filename.c_str() ) != 0 )
+    vw_out(WarningMessage, "perf") << "Could not write performance counters to " << filename << "\n";
+}
+
+void vw::PerfCounterRegistry::finish() {
+  stop_dump_thread();
+  dump();
+}
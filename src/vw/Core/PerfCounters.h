@@ -0,0 +1,168 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Core/PerfCounters.h
+///
+/// A registry of named performance counters and histograms, for
+/// watching what long-running jobs spend their time on.
+///
+/// Counters and histograms are looked up by name in the global
+/// registry, vw_perf_counters(), and updated with atomic operations,
+/// so updating one costs about as much as an uncontended atomic add.
+/// The lookup takes a lock, so code on a hot path looks its counters
+/// up once and keeps the reference:
+///
+///   static PerfCounter& bytes = vw_perf_counters().counter("blob.read_bytes");
+///   bytes.add( size );
+///
+/// Names are dotted, starting with the subsystem that reports them.
+/// Times are recorded in microseconds, in histograms whose names end
+/// in "_us".
+///
+/// Setting vw_settings().perf_counters_file() (or general.
+/// perf_counters_file in ~/.vwrc) writes the registry to that file as
+/// JSON at exit, and also every perf_counters_period() seconds if that
+/// is non-zero.  Each dump replaces the file whole.
+///
+#ifndef __VW_CORE_PERFCOUNTERS_H__
+#define __VW_CORE_PERFCOUNTERS_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Thread.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace vw {
+
+  /// A count of events or bytes, or a level such as a queue depth
+  /// that goes up and down.
+  class PerfCounter : private boost::noncopyable {
+    Atomic<uint64> m_value;
+  public:
+    inline void add( uint64 n = 1 ) { m_value.add( n ); }
+    inline void sub( uint64 n = 1 ) { m_value.sub( n ); }
+    inline void set( uint64 n ) { m_value.store( n ); }
+    inline uint64 value() const { return m_value.load(); }
+  };
+
+  /// A distribution of values, such as latencies, in power-of-two
+  /// buckets.  Bucket 0 counts zeros and bucket i counts the values
+  /// in [2^(i-1), 2^i).
+  class PerfHistogram : private boost::noncopyable {
+  public:
+    static const int num_buckets = 65;
+
+  private:
+    Atomic<uint64> m_buckets[num_buckets];
+    Atomic<uint64> m_count, m_sum, m_max;
+
+  public:
+    static int bucket_index( uint64 value ) {
+      return value ? 64 - __builtin_clzll( value ) : 0;
+    }
+
+    /// The largest value that lands in the given bucket.
+    static uint64 bucket_limit( int bucket ) {
+      return bucket == 0 ? 0 : bucket == 64 ? ~uint64(0) : (uint64(1) << bucket) - 1;
+    }
+
+    void record( uint64 value ) {
+      m_buckets[bucket_index( value )].add( 1 );
+      m_count.add( 1 );
+      m_sum.add( value );
+      uint64 max = m_max.load();
+      while( value > max && ! m_max.compare_and_swap( max, value ) )
+        max = m_max.load();
+    }
+
+    uint64 count() const { return m_count.load(); }
+    uint64 sum() const { return m_sum.load(); }
+    uint64 max() const { return m_max.load(); }
+    uint64 bucket( int i ) const { return m_buckets[i].load(); }
+
+    /// Returns an upper bound on the given fraction (0 to 1) of the
+    /// recorded values: the limit of the bucket it falls in.
+    uint64 quantile( double fraction ) const;
+
+    void reset();
+  };
+
+  /// Records the time from its construction to its destruction, in
+  /// microseconds, into a histogram.
+  class PerfTimer : private boost::noncopyable {
+    PerfHistogram& m_histogram;
+    uint64 m_start;
+  public:
+    PerfTimer( PerfHistogram& histogram ) : m_histogram(histogram), m_start(Stopwatch::microtime()) {}
+    ~PerfTimer() { m_histogram.record( Stopwatch::microtime() - m_start ); }
+  };
+
+  /// The registry of counters and histograms.  Use the global instance,
+  /// vw_perf_counters().
+  class PerfCounterRegistry : private boost::noncopyable {
+    typedef std::map<std::string, boost::shared_ptr<PerfCounter> > counter_map;
+    typedef std::map<std::string, boost::shared_ptr<PerfHistogram> > histogram_map;
+
+    mutable Mutex m_mutex;
+    counter_map m_counters;
+    histogram_map m_histograms;
+
+    class DumpTask;
+    friend class DumpTask;
+    mutable Mutex m_dump_mutex, m_write_mutex;
+    Condition m_dump_condition;
+    std::string m_dump_file;
+    uint32 m_dump_period;
+    bool m_dump_stop;
+    boost::shared_ptr<Thread> m_dump_thread;
+
+    void stop_dump_thread();
+
+  public:
+    PerfCounterRegistry();
+    ~PerfCounterRegistry();
+
+    /// Returns the counter with the given name, creating it (at zero)
+    /// if there isn't one.  The reference stays valid for the life of
+    /// the registry.
+    PerfCounter& counter( std::string const& name );
+
+    /// Returns the histogram with the given name, creating it (empty)
+    /// if there isn't one.  The reference stays valid for the life of
+    /// the registry.
+    PerfHistogram& histogram( std::string const& name );
+
+    /// Writes every counter and histogram as a JSON object.
+    void write_json( std::ostream& out ) const;
+
+    /// Zeroes every counter and empties every histogram.
+    void reset();
+
+    /// Sets the file the registry is dumped to, and how often.  An
+    /// empty filename turns dumping off, and a period of zero only
+    /// dumps at exit (see dump()).  Normally set through
+    /// vw_settings().set_perf_counters_file() and
+    /// set_perf_counters_period().
+    void set_dump( std::string const& filename, uint32 period_seconds );
+
+    /// Writes the registry to the dump file now, if one is set.
+    void dump() const;
+
+    /// Stops periodic dumping and writes a last dump.  Called at exit.
+    void finish();
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_PERFCOUNTERS_H__
@@ -17,7 +17,7 @@ const vw::ProgressCallback &vw::ProgressCallback::dummy_instance() {
 }
 
 // Deprecrated Progress Bar
-vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std::string pre_progress_text, uint32_t precision) : m_level(level), m_namespace(".progress"), m_pre_progress_text(pre_progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))) {
+vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std::string pre_progress_text, uint32_t precision) : m_level(level), m_namespace(".progress"), m_pre_progress_text(pre_progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))), m_render_stop(false), m_rendering(0) {
   boost::replace_all(m_pre_progress_text,"\t","        ");
   if ( m_level <  InfoMessage )
     vw_throw( ArgumentErr() << "TerminalProgressBar must be message level InfoMessage or higher." );
@@ -28,26 +28,75 @@ vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std:
     m_bar_length -= m_precision + 1; // 1 for decimal point
 }
 
+// Redraws the bar every render_interval_ms until told to stop.
+class vw::TerminalProgressCallback::RenderTask {
+  TerminalProgressCallback const& m_callback;
+public:
+  RenderTask( TerminalProgressCallback const& callback ) : m_callback(callback) {}
+  void operator()() {
+    Mutex::Lock lock( m_callback.m_render_mutex );
+    while ( ! m_callback.m_render_stop ) {
+      lock.unlock();
+      m_callback.print_progress();
+      lock.lock();
+      if ( m_callback.m_render_stop ) break;
+      m_callback.m_render_condition.timed_wait( lock, render_interval_ms );
+    }
+  }
+};
+
+void vw::TerminalProgressCallback::start_render_thread() const {
+  Mutex::Lock lock(m_render_mutex);
+  if ( m_render_thread ) return;
+  m_render_thread.reset( new Thread( RenderTask( *this ) ) );
+  m_rendering.store(1);
+}
+
+void vw::TerminalProgressCallback::stop_rendering() const {
+  {
+    Mutex::Lock lock(m_render_mutex);
+    if ( ! m_render_thread ) return;
+    m_render_stop = true;
+    m_render_condition.notify_all();
+  }
+  m_render_thread->join();
+  Mutex::Lock lock(m_render_mutex);
+  m_render_thread.reset();
+  m_render_stop = false;
+  m_rendering.store(0);
+  lock.unlock();
+
+  // Show where things stood, in case the last change came after the
+  // last redraw.
+  print_progress();
+}
+
 void vw::TerminalProgressCallback::print_progress() const {
-  if (fabs(m_progress - m_last_reported_progress) > m_step) {
-    m_last_reported_progress = m_progress;
-    int pi = static_cast<int>(m_progress * double(m_bar_length));
+  Mutex::Lock lock(m_mutex);
+  double progress = this->progress();
+  if (fabs(progress - m_last_reported_progress) > m_step) {
+    m_last_reported_progress = progress;
+    int pi = static_cast<int>(progress * double(m_bar_length));
     std::ostringstream p;
     p << "\r" << m_pre_progress_text << "[";
     for( int i=0; i<pi; ++i ) p << "*";
     for( int i=m_bar_length; i>pi; --i ) p << ".";
-    p << "] " << std::setprecision(m_precision) << std::fixed << (m_progress*100.0) << "%";
+    p << "] " << std::setprecision(m_precision) << std::fixed << (progress*100.0) << "%";
     vw_out(m_level, m_namespace) << p.str() << std::flush;
   }
 }
 
 void vw::TerminalProgressCallback::report_aborted(std::string why) const {
+  stop_rendering();
   Mutex::Lock lock(m_mutex);
   vw_out(m_level, m_namespace) << " Aborted: " << why << std::endl;
 }
 
 void vw::TerminalProgressCallback::report_finished() const {
+  stop_rendering();
+  set_progress(1.0);
   Mutex::Lock lock(m_mutex);
+  m_last_reported_progress = 1.0;
   uint32 cbar_length = m_max_characters - static_cast<uint32>(m_pre_progress_text.size()) -12;
   std::ostringstream p;
   for ( uint32 i = 0; i < cbar_length; i++ )
@@ -55,4 +104,3 @@ void vw::TerminalProgressCallback::report_finished() const {
   vw_out(m_level, m_namespace) << "\r" << m_pre_progress_text
                                << "[" << p.str() << "] Complete!\n";
 }
-
@@ -13,6 +13,7 @@
 #define __VW_CORE_PROGRESSCALLBACK_H__
 
 #include <cmath>
+#include <cstring>
 #include <string>
 
 #include <vw/Core/Log.h>
@@ -26,44 +27,71 @@
 namespace vw {
 
   /// The base class for progress monitoring.
+  ///
+  /// Progress is kept in an atomic accumulator, so many worker threads
+  /// can report into one callback (or SubProgressCallbacks of it)
+  /// without serializing on a lock.
   class ProgressCallback {
+    // The progress, as the bits of a double, so that it can be
+    // updated with compare-and-swap.
+    mutable Atomic<uint64> m_progress;
+    mutable Atomic<uint32> m_abort_requested;
+
+    static uint64 to_bits( double value ) {
+      uint64 bits;
+      std::memcpy( &bits, &value, sizeof(bits) );
+      return bits;
+    }
+    static double from_bits( uint64 bits ) {
+      double value;
+      std::memcpy( &value, &bits, sizeof(value) );
+      return value;
+    }
+
   protected:
-    // WARNING:  These may not be valid for some subclasses.  Always access these
-    // values through the relevant public functions unless you know what you're doing.
     // Arguably having every single member variable be mutable suggests a design
     // flaw.  The idea is that we often want to create a temporary progress callback
     // object to pass to a function performing some complex task, but that requires
     // that all the key functions be const.  This isn't pretty, but it works for now.
-    mutable bool m_abort_requested;
-    mutable double m_progress;
     mutable Mutex m_mutex;
 
-  public:
-    ProgressCallback() : m_abort_requested( false ), m_progress(0) {}
-    ProgressCallback( const ProgressCallback& copy ) {
-      m_progress = copy.progress();
-      m_abort_requested = copy.abort_requested();
+    /// Sets the stored progress.  Safe to call from any thread.
+    void set_progress( double progress ) const {
+      m_progress.store( to_bits( progress ) );
     }
 
+    /// Adds to the stored progress, without taking a lock, and returns
+    /// the new value.  Safe to call from any thread.
+    double add_progress( double increment ) const {
+      while (true) {
+        uint64 old_bits = m_progress.load();
+        double result = from_bits( old_bits ) + increment;
+        if ( m_progress.compare_and_swap( old_bits, to_bits( result ) ) )
+          return result;
+      }
+    }
+
+  public:
+    ProgressCallback() : m_progress( to_bits(0) ), m_abort_requested( 0 ) {}
+    ProgressCallback( const ProgressCallback& copy )
+      : m_progress( to_bits( copy.progress() ) ), m_abort_requested( copy.abort_requested() ) {}
+
     // Reporting functions
     // Subclasses should reimplement where appropriate
     //
     // progress is from 0 (not done) to 1 (finished)
     //
     virtual void report_progress(double progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress = progress;
+      set_progress(progress);
     }
 
     virtual void report_incremental_progress(double incremental_progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress += incremental_progress;
+      add_progress(incremental_progress);
     }
 
     virtual void report_aborted(std::string /*why*/="") const {}
     virtual void report_finished() const {
-      Mutex::Lock lock(m_mutex);
-      m_progress = 1.0;
+      set_progress(1.0);
     }
 
     // Helper method which computes progress and calls report_progress
@@ -73,8 +101,7 @@ namespace vw {
 
     // Has an abort been requested?
     virtual bool abort_requested() const {
-      Mutex::Lock lock(m_mutex);
-      return m_abort_requested;
+      return m_abort_requested.load() != 0;
     }
 
     // Throw vw::Aborted if abort has been requested
@@ -87,11 +114,10 @@ namespace vw {
 
     // Request abort
     virtual void request_abort() const {
-      Mutex::Lock lock(m_mutex);
-      m_abort_requested = true;
+      m_abort_requested.store(1);
     }
 
-    virtual double progress() const { return m_progress; }
+    virtual double progress() const { return from_bits( m_progress.load() ); }
 
     virtual ~ProgressCallback() {}
     static const ProgressCallback &dummy_instance();
@@ -132,6 +158,12 @@ namespace vw {
 
 
   /// A progress monitor that prints a progress bar on STDOUT.
+  ///
+  /// Reports only update the progress; the bar is redrawn by a thread
+  /// of its own, at most every render_interval_ms, which the first
+  /// report starts and report_finished() or report_aborted() stops.
+  /// Workers reporting every block therefore never wait on the
+  /// terminal.
   class TerminalProgressCallback : public ProgressCallback {
     MessageLevel m_level;
     std::string m_namespace;
@@ -143,6 +175,14 @@ namespace vw {
     static const uint32 m_max_characters = 80;
     uint32 m_bar_length;
 
+    class RenderTask;
+    friend class RenderTask;
+    mutable Mutex m_render_mutex;
+    mutable Condition m_render_condition;
+    mutable bool m_render_stop;
+    mutable boost::shared_ptr<Thread> m_render_thread;
+    mutable Atomic<uint32> m_rendering;
+
     void calculate_bar_length() {
       VW_ASSERT( m_pre_progress_text.size()+8+m_precision < 80,
                  ArgumentErr() << "Pre-progress Text or Precision too big to allow progress bar to fit inside 80 char" );
@@ -151,11 +191,25 @@ namespace vw {
         m_bar_length -= m_precision + 1; // 1 for decimal point
     }
 
+    // Starts the render thread if it is not running.
+    void start_rendering() const {
+      if ( ! m_rendering.load() ) start_render_thread();
+    }
+    void start_render_thread() const;
+
+    // Stops the render thread, if any, after a last redraw.
+    void stop_rendering() const;
+
   public:
+    /// How often, in milliseconds, the bar is redrawn while progress
+    /// is being reported.
+    static const uint32 render_interval_ms = 100;
+
     TerminalProgressCallback( MessageLevel level = InfoMessage, std::string pre_progress_text = "", uint32_t precision = 0 ) VW_DEPRECATED;
 
     TerminalProgressCallback( std::string log_namespace, std::string progress_text, MessageLevel log_level = InfoMessage, uint32_t precision = 0) :
-      m_level(log_level), m_namespace(log_namespace), m_pre_progress_text(progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))) {
+      m_level(log_level), m_namespace(log_namespace), m_pre_progress_text(progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))),
+      m_render_stop(false), m_rendering(0) {
 
       m_namespace += ".progress";
       boost::replace_all(m_pre_progress_text,"\t","        ");
@@ -166,14 +220,14 @@ namespace vw {
       calculate_bar_length();
     }
 
-    virtual ~TerminalProgressCallback() {}
+    virtual ~TerminalProgressCallback() { stop_rendering(); }
 
-    TerminalProgressCallback( const TerminalProgressCallback& copy ) : ProgressCallback(copy) {
+    TerminalProgressCallback( const TerminalProgressCallback& copy ) : ProgressCallback(copy),
+      m_last_reported_progress(-1), m_precision(copy.m_precision), m_step(copy.m_step),
+      m_bar_length(copy.m_bar_length), m_render_stop(false), m_rendering(0) {
       m_level = copy.message_level();
       m_namespace = copy.message_namespace();
       m_pre_progress_text = copy.pre_progress_text();
-      m_progress = copy.progress();
-      m_abort_requested = copy.abort_requested();
     }
 
     void set_progress_text( std::string const& text ) {
@@ -184,23 +238,23 @@ namespace vw {
     }
 
     virtual void report_progress(double progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress = progress;
-      print_progress();
+      set_progress(progress);
+      start_rendering();
     }
 
     virtual void report_incremental_progress(double incremental_progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress += incremental_progress;
-      print_progress();
+      add_progress(incremental_progress);
+      start_rendering();
     }
 
     virtual void report_aborted(std::string why="") const;
     virtual void report_finished() const;
 
+    /// Redraws the bar now, if the progress has moved far enough to
+    /// show.
     void print_progress() const;
 
-    std::string pre_progress_text() const { return m_pre_progress_text; }
+    std::string pre_progress_text() const { Mutex::Lock lock(m_mutex); return m_pre_progress_text; }
     MessageLevel message_level() const { return m_level; }
     std::string message_namespace() const { return m_namespace; }
   };
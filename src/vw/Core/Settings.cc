@@ -10,6 +10,8 @@
 #include <vw/config.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/Cache.h>
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/PerfCounters.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/ConfigParser.h>
 
@@ -168,9 +170,19 @@ namespace {
 
 Settings::Settings()
   : _VW_SET1(default_num_threads, VW_NUM_THREADS),
+    _VW_SET1(worker_affinity, "none"),
     _VW_SET1(system_cache_size, size_t(VW_CACHE_SIZE) * 1024 * 1024),
+    _VW_SET1(system_cache_shards, 1),
+    _VW_SET1(system_cache_spill_size, 0),
+    _VW_SET1(buffer_pool_size, 0),
+    _VW_SET1(max_open_resources, 0),
     _VW_SET1(write_pool_size, 21), // 21 threads is about 252MB of back data for RGB f32 1024x1024 blocks
+    _VW_SET1(io_threads, 8),
+    _VW_SET1(hdf_chunk_cache_size, 0),
     _VW_SET1(default_tile_size, 256),
+    _VW_SET1(approximate_gaussian, false),
+    _VW_SET1(perf_counters_file, ""),
+    _VW_SET1(perf_counters_period, 0),
     _VW_SET1(tmp_directory, default_tmp_dir()),
     m_rc_poll_period(5.0f)
 {
@@ -192,9 +204,19 @@ Settings::Settings()
   }
 
 GETSET(default_num_threads, uint32, ;);
+GETSET(worker_affinity, std::string, ;);
 GETSET(system_cache_size, size_t, vw_system_cache().resize(x););
+GETSET(system_cache_shards, uint32, vw_system_cache().set_num_shards(x););
+GETSET(system_cache_spill_size, size_t, vw_system_cache().set_spill(m_tmp_directory, x););
+GETSET(buffer_pool_size, size_t, vw_buffer_pool().set_max_size(x););
+GETSET(max_open_resources, uint32, ;);
 GETSET(write_pool_size, uint32, ;);
+GETSET(io_threads, uint32, ;);
+GETSET(hdf_chunk_cache_size, uint32, ;);
 GETSET(default_tile_size, uint32, ;);
+GETSET(approximate_gaussian, bool, ;);
+GETSET(perf_counters_file, std::string, vw_perf_counters().set_dump(x, m_perf_counters_period););
+GETSET(perf_counters_period, uint32, vw_perf_counters().set_dump(m_perf_counters_file, x););
 GETSET(tmp_directory, std::string, ;);
 
 } // namespace vw
@@ -49,18 +49,71 @@ namespace vw {
     // The default number of threads used in block processing operations.
     VW_DECLARE_SETTING(default_num_threads, uint32);
 
+    // How worker threads of the thread pools are pinned to CPUs: "none"
+    // (the default) leaves placement to the OS, "core" pins each worker
+    // to its own CPU and "node" pins each worker to one NUMA node,
+    // round robin.  See Thread::place_worker().
+    VW_DECLARE_SETTING(worker_affinity, std::string);
+
     // The current system cache size (in bytes). The system cache is shared by
     // all BlockRasterizeView<>'s, including DiskImageView<>'s.
     VW_DECLARE_SETTING(system_cache_size, size_t);
 
+    // The number of independently locked shards the system cache is split
+    // into. More shards means less lock contention between threads hitting
+    // the cache, at the cost of LRU order only being kept per shard.
+    VW_DECLARE_SETTING(system_cache_shards, uint32);
+
+    // The byte budget for the system cache's on-disk spill tier, which
+    // keeps evicted image blocks in tmp_directory so they can be read
+    // back instead of regenerated. Zero (the default) disables it.
+    VW_DECLARE_SETTING(system_cache_spill_size, size_t);
+
+    // The byte budget for free buffers kept by vw_buffer_pool() for
+    // reuse by large ImageView<>s, such as the blocks produced by block
+    // rasterization and block writing.  Zero (the default) disables
+    // pooling.
+    VW_DECLARE_SETTING(buffer_pool_size, size_t);
+
+    // The most files DiskImageView<>s opened by name keep open at once.
+    // Past this the least recently read are closed, and reopened when
+    // next read (see DiskImageResourcePooled).  Zero (the default)
+    // keeps every file open for as long as its view exists.
+    VW_DECLARE_SETTING(max_open_resources, uint32);
+
     // Write cache is only used in block writing. This is the number of threads
     // that can be blocked on IO before the code stops creating more jobs (to
     // let the writes catch up).
     VW_DECLARE_SETTING(write_pool_size, uint32);
 
+    // The number of threads in vw_io_queue(), which runs asynchronous
+    // image resource reads.  These threads mostly wait on the disk (or
+    // the network, for NFS), so there can usefully be more of them than
+    // there are CPUs.  Only read when the queue is first used.
+    VW_DECLARE_SETTING(io_threads, uint32);
+
+    // The number of chunks of each selected SDS that HDF files keep
+    // decoded, so that reads overlapping the same chunk decompress it
+    // once.  Zero (the default) leaves it to the HDF library, which
+    // caches one row of chunks.  Only read when an SDS is selected.
+    VW_DECLARE_SETTING(hdf_chunk_cache_size, uint32);
+
     // The default tile size (in pixels) used for block processing ops.
     VW_DECLARE_SETTING(default_tile_size, uint32);
 
+    // Lets filters that support it, such as the stereo preprocessing
+    // filters, replace Gaussian convolution with recursive_gaussian_filter(),
+    // whose cost does not grow with sigma.  Off by default.
+    VW_DECLARE_SETTING(approximate_gaussian, bool);
+
+    // The file the performance counter registry (see PerfCounters.h) is
+    // written to as JSON at exit.  Empty (the default) writes nothing.
+    VW_DECLARE_SETTING(perf_counters_file, std::string);
+
+    // If non-zero, perf_counters_file is also rewritten this often, in
+    // seconds, so that long-running jobs can be watched.
+    VW_DECLARE_SETTING(perf_counters_period, uint32);
+
     // The directory used to store temporary files.
     VW_DECLARE_SETTING(tmp_directory, std::string);
 
@@ -11,6 +11,8 @@
 #include <vw/Core/Exception.h>
 
 #include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/scoped_array.hpp>
 
 // Time
 #ifdef WIN32
@@ -21,6 +23,7 @@
 
 #include <iostream>
 #include <vector>
+#include <set>
 #include <algorithm>
 #include <sstream>
 
@@ -92,4 +95,158 @@ namespace vw {
   Stopwatch stopwatch_get(const std::string &name) {
     return vw_stopwatch_set().get(name);
   }
+
+  // ---------------------------------------------------
+  // Tracing
+  // ---------------------------------------------------
+
+  namespace {
+
+    struct TraceEvent {
+      const std::string *name;
+      uint64 timestamp;
+      char phase;
+    };
+
+    // Events recorded by one thread.  Only the owning thread writes;
+    // it fills in an event and then publishes it by bumping m_count,
+    // so a reader that loads m_count first only sees complete events.
+    // Storage grows a chunk at a time and is never moved or freed.
+    class TraceBuffer {
+      enum { ChunkSize = 4096, MaxChunks = (stopwatch_trace_capacity + ChunkSize - 1) / ChunkSize };
+      boost::scoped_array<TraceEvent> m_chunks[MaxChunks];
+      Atomic<size_t> m_count;
+    public:
+      const uint64 thread_id;
+      Atomic<uint64> dropped;
+
+      TraceBuffer() : m_count(0), thread_id(Thread::id()), dropped(0) {}
+
+      void record(const std::string *name, char phase) {
+        size_t n = m_count.load();
+        if (n >= size_t(MaxChunks) * ChunkSize) {
+          ++dropped;
+          return;
+        }
+        if (n % ChunkSize == 0 && !m_chunks[n / ChunkSize])
+          m_chunks[n / ChunkSize].reset(new TraceEvent[ChunkSize]);
+        TraceEvent &e = m_chunks[n / ChunkSize][n % ChunkSize];
+        e.name = name;
+        e.timestamp = Stopwatch::microtime();
+        e.phase = phase;
+        m_count.store(n + 1);
+      }
+
+      size_t size() const { return m_count.load(); }
+      TraceEvent const& operator[](size_t i) const { return m_chunks[i / ChunkSize][i % ChunkSize]; }
+    };
+
+    // Buffers belong to the registry rather than their threads, so the
+    // trace survives worker threads exiting.
+    class TraceRegistry {
+      Mutex m_mutex;
+      std::vector<boost::shared_ptr<TraceBuffer> > m_buffers;
+      std::set<std::string> m_names;
+      boost::thread_specific_ptr<TraceBuffer> m_local;
+
+      static void no_cleanup(TraceBuffer*) {}
+    public:
+      Atomic<uint32> enabled;
+
+      TraceRegistry() : m_local(no_cleanup), enabled(0) {}
+
+      TraceBuffer& local() {
+        TraceBuffer *buffer = m_local.get();
+        if (!buffer) {
+          boost::shared_ptr<TraceBuffer> created(new TraceBuffer());
+          {
+            Mutex::Lock lock(m_mutex);
+            m_buffers.push_back(created);
+          }
+          buffer = created.get();
+          m_local.reset(buffer);
+        }
+        return *buffer;
+      }
+
+      const std::string* intern(const std::string &name) {
+        Mutex::Lock lock(m_mutex);
+        return &*m_names.insert(name).first;
+      }
+
+      std::vector<boost::shared_ptr<TraceBuffer> > buffers() {
+        Mutex::Lock lock(m_mutex);
+        return m_buffers;
+      }
+    };
+
+    // Never destroyed, since ScopedWatches may still be running in
+    // other threads at exit.
+    TraceRegistry *trace_registry_ptr = 0;
+    vw::RunOnce trace_registry_once = VW_RUNONCE_INIT;
+    void init_trace_registry() { trace_registry_ptr = new TraceRegistry(); }
+
+    TraceRegistry& trace_registry() {
+      trace_registry_once.run(init_trace_registry);
+      return *trace_registry_ptr;
+    }
+
+    void write_json_string(std::ostream &out, const std::string &s) {
+      out << '"';
+      for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+      }
+      out << '"';
+    }
+  }
+
+  Stopwatch StopwatchSet::get(const std::string &name) {
+    Mutex::Lock lock(m_mutex);
+    Stopwatch &sw = m_stopwatches[name];
+    if (!sw.m_data->m_trace_name)
+      sw.m_data->m_trace_name = trace_registry().intern(name);
+    return sw;
+  }
+
+  void stopwatch_set_tracing(bool enabled) {
+    trace_registry().enabled.store(enabled ? 1 : 0);
+  }
+
+  bool stopwatch_tracing() {
+    return trace_registry().enabled.load() != 0;
+  }
+
+  uint64 stopwatch_trace_dropped() {
+    std::vector<boost::shared_ptr<TraceBuffer> > buffers = trace_registry().buffers();
+    uint64 total = 0;
+    for (size_t i = 0; i < buffers.size(); ++i)
+      total += buffers[i]->dropped.load();
+    return total;
+  }
+
+  void stopwatch_write_trace(std::ostream &out) {
+    std::vector<boost::shared_ptr<TraceBuffer> > buffers = trace_registry().buffers();
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t b = 0; b < buffers.size(); ++b) {
+      TraceBuffer const& buffer = *buffers[b];
+      size_t n = buffer.size();
+      for (size_t i = 0; i < n; ++i) {
+        TraceEvent const& e = buffer[i];
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, *e.name);
+        out << ",\"cat\":\"vw\",\"ph\":\"" << e.phase << "\",\"ts\":" << e.timestamp
+            << ",\"pid\":1,\"tid\":" << buffer.thread_id << "}";
+        first = false;
+      }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  }
+
+  void detail::stopwatch_trace_event(const std::string *name, char phase) {
+    trace_registry().local().record(name, phase);
+  }
 }; // namespace vw
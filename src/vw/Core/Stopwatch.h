@@ -11,6 +11,7 @@
 // System includes
 #include <map>
 #include <string>
+#include <iosfwd>
 
 // BOOST includes
 #include <boost/shared_ptr.hpp>
@@ -29,12 +30,15 @@ namespace vw {
       uint64 m_last_start;    // from Stopwatch::microtime
       uint32 m_startdepth;
       uint32 m_numstops;
+      const std::string *m_trace_name; // Interned; null if not traced
       mutable Mutex m_mutex;
       data() :  m_total_elapsed(0),
                 m_last_start(0),
                 m_startdepth(0),
-                m_numstops(0) {}
+                m_numstops(0),
+                m_trace_name(0) {}
     };
+    friend class StopwatchSet;
 
     boost::shared_ptr<data> m_data;
     bool m_use_cpu_time;
@@ -76,6 +80,12 @@ namespace vw {
       return m_data->m_numstops;
     }
 
+    /// The name this stopwatch is recorded under when tracing, or
+    /// null for stopwatches that did not come from a StopwatchSet.
+    const std::string* trace_name() const {
+      return m_data->m_trace_name;
+    }
+
   }; // class Stopwatch
 
   // StopwatchSet is a named set of Stopwatches
@@ -90,10 +100,7 @@ namespace vw {
       m_construction_time(Stopwatch::microtime()) {}
 
     // Find or create stopwatch named "name"
-    Stopwatch get(const std::string &name) {
-      Mutex::Lock lock(m_mutex);
-      return m_stopwatches[name];
-    }
+    Stopwatch get(const std::string &name);
 
     uint64 elapsed_microseconds_since_construction() const {
       return Stopwatch::microtime()-m_construction_time;
@@ -127,6 +134,34 @@ namespace vw {
   // Stop the named stopwatch from the global StopwatchSet
   inline void stopwatch_stop(const std::string &name) { stopwatch_get(name).stop(); }
 
+  //
+  // Tracing: while enabled, every ScopedWatch on a named stopwatch
+  //  records a begin and an end event, with a timestamp, in a buffer
+  //  owned by the calling thread.  Recording takes no locks.  Each
+  //  thread keeps at most stopwatch_trace_capacity events; the rest are
+  //  counted and dropped.  The events can be written out in the Chrome
+  //  trace event format, for chrome://tracing or Perfetto.
+  //
+  //  Setting the VW_TRACE_FILE environment variable turns tracing on
+  //  at startup and writes the trace to that file at exit.
+  //
+
+  const size_t stopwatch_trace_capacity = 1 << 20;
+
+  void stopwatch_set_tracing(bool enabled);
+  bool stopwatch_tracing();
+
+  // Number of events dropped because a thread's buffer was full
+  uint64 stopwatch_trace_dropped();
+
+  // Write every event recorded so far as Chrome trace JSON.  This is
+  // safe to call while other threads are still recording.
+  void stopwatch_write_trace(std::ostream &out);
+
+  namespace detail {
+    void stopwatch_trace_event(const std::string *name, char phase);
+  }
+
   //
   // ScopedWatch starts a Stopwatch on construction and stops is
   //  on destruction
@@ -135,22 +170,35 @@ namespace vw {
   class ScopedWatch {
   private:
     Stopwatch m_stopwatch;
+    bool m_traced;
+
+    void start() {
+      m_stopwatch.start();
+      if (m_stopwatch.trace_name() && stopwatch_tracing()) {
+        detail::stopwatch_trace_event(m_stopwatch.trace_name(), 'B');
+        m_traced = true;
+      }
+    }
   public:
     ScopedWatch(const Stopwatch &stopwatch)
-      : m_stopwatch(stopwatch) {
-      m_stopwatch.start();
+      : m_stopwatch(stopwatch), m_traced(false) {
+      start();
     }
     // Use the named Stopwatch from the global StopwatchSet
     ScopedWatch(const std::string &name)
-      : m_stopwatch(stopwatch_get(name)) {
-      m_stopwatch.start();
+      : m_stopwatch(stopwatch_get(name)), m_traced(false) {
+      start();
     }
     // This must be overloaded to prevent ambiguity
     ScopedWatch(const char * name)
-      : m_stopwatch(stopwatch_get(name)) {
-      m_stopwatch.start();
+      : m_stopwatch(stopwatch_get(name)), m_traced(false) {
+      start();
     }
     ~ScopedWatch() {
+      // End the event even if tracing was turned off in the meantime,
+      // so that begin and end events always pair up.
+      if (m_traced)
+        detail::stopwatch_trace_event(m_stopwatch.trace_name(), 'E');
       m_stopwatch.stop();
     }
   }; // class ScopedWatch
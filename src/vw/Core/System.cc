@@ -6,10 +6,17 @@
 
 
 #include <vw/Core/System.h>
+#include <vw/Core/BufferPool.h>
 #include <vw/Core/Cache.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/PerfCounters.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 
 namespace {
   vw::RunOnce settings_once      = VW_RUNONCE_INIT;
@@ -17,11 +24,17 @@ namespace {
   vw::RunOnce stopwatch_set_once = VW_RUNONCE_INIT;
   vw::RunOnce system_cache_once  = VW_RUNONCE_INIT;
   vw::RunOnce log_once           = VW_RUNONCE_INIT;
+  vw::RunOnce buffer_pool_once   = VW_RUNONCE_INIT;
+  vw::RunOnce io_queue_once      = VW_RUNONCE_INIT;
+  vw::RunOnce perf_counters_once = VW_RUNONCE_INIT;
 
   vw::Settings     *settings_ptr      = 0;
   vw::StopwatchSet *stopwatch_set_ptr = 0;
   vw::Cache        *system_cache_ptr  = 0;
   vw::Log          *log_ptr           = 0;
+  vw::BufferPool   *buffer_pool_ptr   = 0;
+  vw::FifoWorkQueue *io_queue_ptr     = 0;
+  vw::PerfCounterRegistry *perf_counters_ptr = 0;
 
   void init_settings() {
     settings_ptr = new vw::Settings();
@@ -30,19 +43,58 @@ namespace {
   void resize_cache() {
     if (system_cache_ptr->max_size() == 0)
       system_cache_ptr->resize(settings_ptr->system_cache_size());
+    system_cache_ptr->set_num_shards(settings_ptr->system_cache_shards());
+    if (settings_ptr->system_cache_spill_size() > 0)
+      system_cache_ptr->set_spill(settings_ptr->tmp_directory(), settings_ptr->system_cache_spill_size());
+  }
+
+  void dump_system_cache_stats() {
+    vw::vw_out(vw::DebugMessage, "cache") << system_cache_ptr->stats_report();
   }
 
   void init_system_cache() {
     system_cache_ptr = new vw::Cache(0);
+    std::atexit(dump_system_cache_stats);
+  }
+
+  void write_stopwatch_trace() {
+    const char *filename = ::getenv("VW_TRACE_FILE");
+    std::ofstream out(filename);
+    vw::stopwatch_write_trace(out);
   }
 
   void init_stopwatch_set() {
     stopwatch_set_ptr = new vw::StopwatchSet();
+    if (::getenv("VW_TRACE_FILE")) {
+      vw::stopwatch_set_tracing(true);
+      std::atexit(write_stopwatch_trace);
+    }
   }
 
   void init_log() {
     log_ptr = new vw::Log();
   }
+
+  vw::Atomic<vw::uint32> buffer_pool_sized;
+
+  void init_buffer_pool() {
+    buffer_pool_ptr = new vw::BufferPool(0);
+  }
+
+  void init_io_queue() {
+    io_queue_ptr = new vw::FifoWorkQueue( (std::max)( vw::vw_settings().io_threads(), vw::uint32(1) ) );
+  }
+
+  vw::Atomic<vw::uint32> perf_counters_configured;
+
+  void finish_perf_counters() {
+    perf_counters_ptr->finish();
+  }
+
+  void init_perf_counters() {
+    perf_counters_ptr = new vw::PerfCounterRegistry();
+    std::atexit(finish_perf_counters);
+  }
 }
 
 vw::Settings &vw::vw_settings() {
@@ -68,3 +120,30 @@ vw::Log &vw::vw_log() {
   log_once.run( init_log );
   return *log_ptr;
 }
+
+vw::BufferPool &vw::vw_buffer_pool() {
+  buffer_pool_once.run( init_buffer_pool );
+  // Reading the setting can load the config file, whose setter calls
+  // back in here, so this can't happen inside the RunOnce.
+  if (!buffer_pool_sized.load()) {
+    buffer_pool_ptr->set_max_size(vw_settings().buffer_pool_size());
+    buffer_pool_sized.store(1);
+  }
+  return *buffer_pool_ptr;
+}
+
+vw::FifoWorkQueue &vw::vw_io_queue() {
+  io_queue_once.run( init_io_queue );
+  return *io_queue_ptr;
+}
+
+vw::PerfCounterRegistry &vw::vw_perf_counters() {
+  perf_counters_once.run( init_perf_counters );
+  // As for the buffer pool, reading the settings can load the config
+  // file, whose setters call back in here.
+  if (!perf_counters_configured.load()) {
+    perf_counters_configured.store(1);
+    perf_counters_ptr->set_dump(vw_settings().perf_counters_file(), vw_settings().perf_counters_period());
+  }
+  return *perf_counters_ptr;
+}
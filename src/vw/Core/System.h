@@ -13,8 +13,11 @@
 
 namespace vw {
 
+  class BufferPool;
   class Cache;
+  class FifoWorkQueue;
   class Log;
+  class PerfCounterRegistry;
   class Settings;
   class StopwatchSet;
 
@@ -22,6 +25,16 @@ namespace vw {
   // DiskImageView<>.
   Cache& vw_system_cache();
 
+  // The pool that large ImageView<> buffers are recycled through.  It is
+  // sized by vw_settings().buffer_pool_size() and disabled by default.
+  BufferPool& vw_buffer_pool();
+
+  // The threads that asynchronous image resource reads run on (see
+  // SrcImageResource::read_async()).  There are vw_settings().io_threads()
+  // of them, kept apart from the block processing threads so that those
+  // aren't stuck waiting on the disk.
+  FifoWorkQueue& vw_io_queue();
+
   // You should *always* use this method if you want to access Vision Workbench
   // system log, where all Vision Workbench log messages go.  For example:
   //     vw_log().console_log() << "Some text\n";
@@ -32,6 +45,11 @@ namespace vw {
 
   // Global instance of StopwatchSet
   StopwatchSet& vw_stopwatch_set();
+
+  // The registry of performance counters that the Cache, image resource
+  // reads and writes, block processing and the platefile RPC and blob
+  // layers report into.  See PerfCounters.h.
+  PerfCounterRegistry& vw_perf_counters();
 }
 
 #endif
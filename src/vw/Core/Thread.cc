@@ -6,8 +6,17 @@
 
 
 #include <vw/Core/Thread.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Log.h>
 #include <vw/config.h>
 
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 namespace vw {
 namespace thread {
 
@@ -34,6 +43,74 @@ namespace thread {
     return *ptr;
   }
 
+  // The CPUs this process was allowed to run on at startup, and the
+  // same CPUs grouped by NUMA node.  Machines without NUMA information
+  // are treated as a single node.
+  struct Topology {
+    std::vector<uint32> cpus;
+    std::vector<std::vector<uint32> > nodes;
+  };
+
+  static Topology* vw_topology_ptr = 0;
+  static RunOnce vw_topology_once = VW_RUNONCE_INIT;
+
+  // Parses a Linux cpulist such as "0-7,16-23".
+  static std::vector<uint32> parse_cpulist( std::string const& list ) {
+    std::vector<uint32> cpus;
+    std::istringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+      uint32 first, last;
+      char dash;
+      std::istringstream r(range);
+      if (!(r >> first))
+        continue;
+      if (r >> dash >> last && dash == '-')
+        for (uint32 cpu = first; cpu <= last; ++cpu)
+          cpus.push_back(cpu);
+      else
+        cpus.push_back(first);
+    }
+    return cpus;
+  }
+
+  static void init_topology() {
+    Topology* topo = new Topology();
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+      for (uint32 cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &allowed))
+          topo->cpus.push_back(cpu);
+
+      // Node ids may have gaps, so look at every possible one.
+      for (int node = 0; node < 1024; ++node) {
+        std::ostringstream path;
+        path << "/sys/devices/system/node/node" << node << "/cpulist";
+        std::ifstream file(path.str().c_str());
+        std::string list;
+        if (!file || !std::getline(file, list))
+          continue;
+        std::vector<uint32> cpus = parse_cpulist(list), usable;
+        for (size_t i = 0; i < cpus.size(); ++i)
+          if (cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], &allowed))
+            usable.push_back(cpus[i]);
+        if (!usable.empty())
+          topo->nodes.push_back(usable);
+      }
+    }
+#endif
+    if (topo->nodes.empty() && !topo->cpus.empty())
+      topo->nodes.push_back(topo->cpus);
+    vw_topology_ptr = topo;
+  }
+
+  static Topology const& topology() {
+    vw_topology_once.run( init_topology );
+    return *vw_topology_ptr;
+  }
+
 }} // namespace vw::thread
 
 vw::uint64 vw::Thread::id() {
@@ -49,3 +126,41 @@ vw::uint64 vw::Thread::id() {
   vw::uint64* result = thread::vw_thread_id_ptr().get();
   return *result;
 }
+
+bool vw::Thread::set_affinity( std::vector<uint32> const& cpus ) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); ++i)
+    if (cpus[i] < CPU_SETSIZE)
+      CPU_SET(cpus[i], &set);
+  if (CPU_COUNT(&set) == 0)
+    return false;
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+void vw::Thread::place_worker( uint32 index ) {
+  std::string mode = vw_settings().worker_affinity();
+  if (mode.empty() || mode == "none")
+    return;
+
+  thread::Topology const& topo = thread::topology();
+  std::vector<uint32> cpus;
+  if (mode == "core") {
+    if (!topo.cpus.empty())
+      cpus.push_back(topo.cpus[index % topo.cpus.size()]);
+  } else if (mode == "node") {
+    if (!topo.nodes.empty())
+      cpus = topo.nodes[index % topo.nodes.size()];
+  } else {
+    vw_out(WarningMessage, "thread") << "Unknown worker_affinity \"" << mode
+                                     << "\" (expected none, core or node).\n";
+    return;
+  }
+
+  if (cpus.empty() || !set_affinity(cpus))
+    vw_out(DebugMessage, "thread") << "Could not set the affinity of worker " << index << ".\n";
+}
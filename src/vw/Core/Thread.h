@@ -49,6 +49,8 @@
 
 #include <vw/Core/FundamentalTypes.h>
 
+#include <vector>
+
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/thread/xtime.hpp>
@@ -88,6 +90,7 @@ namespace vw {
     inline Mutex() {}
 
     void lock()          { boost::shared_mutex::lock(); }
+    bool try_lock()      { return boost::shared_mutex::try_lock(); }
     void lock_shared()   { boost::shared_mutex::lock_shared(); }
     void unlock()        { boost::shared_mutex::unlock(); }
     void unlock_shared() { boost::shared_mutex::unlock_shared(); }
@@ -186,6 +189,44 @@ namespace vw {
     }
   };
 
+  // --------------------------------------------------------------
+  //                            ATOMIC
+  // --------------------------------------------------------------
+
+  // A word-sized integer (or pointer) that supports lock-free
+  // increment, decrement and compare-and-swap.  Every operation is a
+  // full memory barrier.  This is a thin wrapper around the GCC
+  // __sync builtins, so T must be an integral or pointer type no
+  // larger than 8 bytes.
+  template <class T>
+  class Atomic : private boost::noncopyable {
+    volatile T m_value;
+
+  public:
+    inline Atomic( T value = T() ) : m_value(value) {}
+
+    inline T load() const { __sync_synchronize(); return m_value; }
+    inline void store( T value ) { __sync_synchronize(); m_value = value; __sync_synchronize(); }
+
+    /// Add an amount and return the new value.
+    inline T add( T value ) { return __sync_add_and_fetch(&m_value, value); }
+    /// Subtract an amount and return the new value.
+    inline T sub( T value ) { return __sync_sub_and_fetch(&m_value, value); }
+
+    inline T operator++() { return add(1); }
+    inline T operator--() { return sub(1); }
+
+    /// Set the value to new_value if it currently equals expected.
+    /// Returns true if the swap took place.
+    inline bool compare_and_swap( T expected, T new_value ) {
+      return __sync_bool_compare_and_swap(&m_value, expected, new_value);
+    }
+  };
+
+  /// A full memory barrier, for ordering plain reads and writes around
+  /// an Atomic used as a sequence lock.
+  inline void memory_barrier() { __sync_synchronize(); }
+
   // --------------------------------------------------------------
   //                            THREAD
   // --------------------------------------------------------------
@@ -248,6 +289,19 @@ namespace vw {
     /// will be assigned in the same order that threads are created.
     static vw::uint64 id();
 
+    /// Restrict the current thread to run only on the given logical
+    /// CPUs.  Returns false if the platform does not support thread
+    /// affinity or the request was refused.
+    static bool set_affinity( std::vector<uint32> const& cpus );
+
+    /// Pin the current thread according to the worker_affinity
+    /// setting, treating it as worker number \p index of a pool.
+    /// "core" pins worker i to the i'th CPU this process may run on,
+    /// "node" pins it to every CPU of the i'th NUMA node, and "none"
+    /// (the default) leaves it alone.  Memory a worker touches first
+    /// is then allocated on its own node by the kernel.
+    static void place_worker( uint32 index );
+
     /// Cause the current thread to yield the remainder of its
     /// execution time to the kernel's scheduler.
     static inline void yield() { boost::thread::yield(); }
@@ -15,6 +15,7 @@
 
 #include <vector>
 #include <list>
+#include <deque>
 
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
@@ -24,6 +25,9 @@
 // STL
 #include <map>
 
+#include <boost/optional.hpp>
+#include <boost/utility/result_of.hpp>
+
 namespace vw {
   // ----------------------  --------------  ---------------------------
   // ----------------------       Task       ---------------------------
@@ -58,6 +62,152 @@ namespace vw {
     }
   };
 
+  // ----------------------  --------------  ---------------------------
+  // ----------------------      Future      ---------------------------
+  // ----------------------  --------------  ---------------------------
+
+  namespace detail {
+
+    // Shared by all FutureStates: holds the exception, if any, that
+    // the task's callable threw.
+    class FutureStateBase : public Task {
+      boost::shared_ptr<Exception> m_error;
+    protected:
+      // Call from inside a catch block to record the active exception.
+      // Exceptions that are not vw::Exceptions become LogicErrs
+      // carrying their what() text.
+      void capture_error() {
+        try {
+          throw;
+        } catch (const Exception& e) {
+          m_error.reset(e.clone());
+        } catch (const std::exception& e) {
+          m_error.reset(new LogicErr(LogicErr() << "Exception in submitted task: " << e.what()));
+        } catch (...) {
+          m_error.reset(new LogicErr(LogicErr() << "Unknown exception in submitted task."));
+        }
+      }
+      // Waits for the task and rethrows its exception, if it had one.
+      void check() {
+        this->join();
+        if (m_error)
+          vw_throw(*m_error);
+      }
+    };
+
+    // The result of a submitted task, filled in by FutureTask.
+    template <class T>
+    class FutureState : public FutureStateBase {
+    protected:
+      boost::optional<T> m_value;
+    public:
+      typedef T const& result_type;
+      T const& get() { this->check(); return *m_value; }
+    };
+
+    template <>
+    class FutureState<void> : public FutureStateBase {
+    public:
+      typedef void result_type;
+      void get() { this->check(); }
+    };
+
+    // Runs a callable and stores its result or exception.
+    template <class T, class FuncT>
+    class FutureTask : public FutureState<T> {
+      FuncT m_func;
+    public:
+      FutureTask( FuncT const& func ) : m_func(func) {}
+      virtual void operator()() {
+        try {
+          this->m_value = m_func();
+        } catch (...) {
+          this->capture_error();
+        }
+      }
+    };
+
+    template <class FuncT>
+    class FutureTask<void, FuncT> : public FutureState<void> {
+      FuncT m_func;
+    public:
+      FutureTask( FuncT const& func ) : m_func(func) {}
+      virtual void operator()() {
+        try {
+          m_func();
+        } catch (...) {
+          this->capture_error();
+        }
+      }
+    };
+
+  } // namespace detail
+
+  /// A handle to the result of a callable submitted to a work queue
+  /// with submit().  Copies share the same result.  get() blocks until
+  /// the task has run and returns its result, or rethrows the
+  /// exception it threw.  Don't wait on a future from a worker of the
+  /// queue that will run it; if every worker waits, nothing runs.
+  template <class T>
+  class Future {
+    boost::shared_ptr<detail::FutureState<T> > m_state;
+  public:
+    typedef T value_type;
+
+    Future() {}
+    explicit Future( boost::shared_ptr<detail::FutureState<T> > const& state ) : m_state(state) {}
+
+    /// False for a default-constructed future.
+    bool valid() const { return bool(m_state); }
+
+    /// True once the task has run.
+    bool is_ready() const { return m_state->is_finished(); }
+
+    /// Blocks until the task has run.
+    void wait() const { m_state->join(); }
+
+    /// Blocks until the task has run, then returns its result or
+    /// rethrows its exception.
+    typename detail::FutureState<T>::result_type get() const { return m_state->get(); }
+
+    /// The underlying task, e.g. to use as a TaskGraphWorkQueue
+    /// dependency.
+    boost::shared_ptr<Task> task() const { return m_state; }
+  };
+
+  /// Wraps a callable in a Task whose result a Future can collect.
+  /// The callable must work with boost::result_of, so functors need a
+  /// result_type typedef (boost::bind results and function pointers
+  /// already qualify).
+  template <class FuncT>
+  boost::shared_ptr<detail::FutureTask<typename boost::result_of<FuncT()>::type, FuncT> >
+  make_future_task( FuncT const& func ) {
+    typedef typename boost::result_of<FuncT()>::type result_type;
+    return boost::shared_ptr<detail::FutureTask<result_type, FuncT> >(
+             new detail::FutureTask<result_type, FuncT>(func) );
+  }
+
+  /// Waits for every future and returns their results in order.  If
+  /// any task threw, the first such exception (in sequence order) is
+  /// rethrown once all of them have finished.
+  template <class T>
+  std::vector<T> when_all( std::vector<Future<T> > const& futures ) {
+    for (size_t i = 0; i < futures.size(); ++i)
+      futures[i].wait();
+    std::vector<T> results;
+    results.reserve(futures.size());
+    for (size_t i = 0; i < futures.size(); ++i)
+      results.push_back(futures[i].get());
+    return results;
+  }
+
+  inline void when_all( std::vector<Future<void> > const& futures ) {
+    for (size_t i = 0; i < futures.size(); ++i)
+      futures[i].wait();
+    for (size_t i = 0; i < futures.size(); ++i)
+      futures[i].get();
+  }
+
   // ----------------------  --------------  ---------------------------
   // ----------------------  Task Generator  ---------------------------
   // ----------------------  --------------  ---------------------------
@@ -80,6 +230,7 @@ namespace vw {
         m_queue(queue), m_task(initial_task), m_thread_id(thread_id), m_should_die(should_die) {}
       ~WorkerThread() {}
       void operator()() {
+        Thread::place_worker(m_thread_id);
         do {
           vw_out(DebugMessage, "thread") << "ThreadPool: running worker thread "
                                          << m_thread_id << "\n";
@@ -220,6 +371,10 @@ namespace vw {
 
     FifoWorkQueue(int num_threads = vw_settings().default_num_threads()) : WorkQueue(num_threads) {}
 
+    // Idle workers ask us for more tasks until they exit, so wait for
+    // them before our members are destroyed.
+    ~FifoWorkQueue() { this->join_all(); }
+
     size_t size() {
       Mutex::Lock lock(m_mutex);
       return m_queued_tasks.size();
@@ -234,6 +389,15 @@ namespace vw {
       this->notify();
     }
 
+    // Queue a callable and return a Future for its result.
+    template <class FuncT>
+    Future<typename boost::result_of<FuncT()>::type> submit( FuncT func ) {
+      typedef typename boost::result_of<FuncT()>::type result_type;
+      boost::shared_ptr<detail::FutureTask<result_type, FuncT> > task = make_future_task(func);
+      this->add_task(task);
+      return Future<result_type>(task);
+    }
+
     virtual boost::shared_ptr<Task> get_next_task() {
       Mutex::Lock lock(m_mutex);
       if (m_queued_tasks.empty())
@@ -259,6 +423,9 @@ namespace vw {
       m_next_index = 0;
     }
 
+    // As for FifoWorkQueue.
+    ~OrderedWorkQueue() { this->join_all(); }
+
     size_t size() {
       Mutex::Lock lock(m_mutex);
       return m_queued_tasks.size();
@@ -295,6 +462,321 @@ namespace vw {
     }
   };
 
+  /// A work queue for tasks that depend on each other.  Each task is
+  /// added along with the tasks it depends on, and is only handed to
+  /// a worker thread once all of those have finished.  This lets the
+  /// stages of a block pipeline (read, filter, correlate, write, ...)
+  /// overlap, with each block moving on as soon as its own inputs are
+  /// ready, rather than running each stage as a full pass followed by
+  /// a join_all().
+  ///
+  /// Dependencies must already have been added to the queue (they may
+  /// have finished since), so the graph cannot have cycles.  Tasks
+  /// whose dependencies are met run in the order they became ready.
+  /// As with the other work queues, join_all() waits for every task.
+  /// signal_finished() is called on each task itself, so a single
+  /// task can also be waited for with Task::join().
+  class TaskGraphWorkQueue : public WorkQueue {
+  public:
+    typedef std::vector<boost::shared_ptr<Task> > TaskList;
+
+  private:
+    struct Node {
+      boost::shared_ptr<Task> task;
+      size_t unfinished_dependencies;
+      std::vector<boost::shared_ptr<Node> > dependents;
+    };
+
+    // What the WorkQueue actually runs: the user's task, followed by
+    // the bookkeeping that releases its dependents.
+    class NodeTask : public Task {
+      TaskGraphWorkQueue &m_queue;
+      boost::shared_ptr<Node> m_node;
+    public:
+      NodeTask(TaskGraphWorkQueue &queue, boost::shared_ptr<Node> node) : m_queue(queue), m_node(node) {}
+      virtual void operator()() {
+        (*m_node->task)();
+        m_queue.task_complete(m_node);
+      }
+    };
+
+    // Tasks that have been added but have not finished, keyed by the
+    // user's task.
+    std::map<Task*, boost::shared_ptr<Node> > m_nodes;
+    std::list<boost::shared_ptr<Task> > m_ready_tasks;
+    Mutex m_mutex;
+
+    void task_complete(boost::shared_ptr<Node> node) {
+      {
+        Mutex::Lock lock(m_mutex);
+        // Finish the task under our lock, so that add_task() sees it
+        // either as unfinished and in m_nodes, or as finished.
+        node->task->signal_finished();
+        m_nodes.erase(node->task.get());
+        for (size_t i = 0; i < node->dependents.size(); ++i) {
+          boost::shared_ptr<Node> const& dependent = node->dependents[i];
+          if (--dependent->unfinished_dependencies == 0)
+            m_ready_tasks.push_back(boost::shared_ptr<Task>(new NodeTask(*this, dependent)));
+        }
+        node->dependents.clear();
+      }
+      this->notify();
+    }
+
+  public:
+    TaskGraphWorkQueue(int num_threads = vw_settings().default_num_threads()) : WorkQueue(num_threads) {}
+
+    // Running tasks use our members, so wait for them before those
+    // are destroyed.
+    ~TaskGraphWorkQueue() { this->join_all(); }
+
+    /// The number of tasks that have been added but not finished.
+    size_t size() {
+      Mutex::Lock lock(m_mutex);
+      return m_nodes.size();
+    }
+
+    /// Add a task that may run once every task in dependencies has
+    /// finished.
+    void add_task(boost::shared_ptr<Task> task, TaskList const& dependencies = TaskList()) {
+      VW_ASSERT(task, ArgumentErr() << "TaskGraphWorkQueue: cannot add a null task.");
+      {
+        Mutex::Lock lock(m_mutex);
+        VW_ASSERT(m_nodes.find(task.get()) == m_nodes.end(),
+                  ArgumentErr() << "TaskGraphWorkQueue: task was added twice.");
+        // Check every dependency before linking any of them, so that a
+        // bad one leaves the graph untouched.
+        std::vector<boost::shared_ptr<Node> > unfinished;
+        for (size_t i = 0; i < dependencies.size(); ++i) {
+          std::map<Task*, boost::shared_ptr<Node> >::iterator dep = m_nodes.find(dependencies[i].get());
+          if (dep != m_nodes.end())
+            unfinished.push_back(dep->second);
+          else if (!dependencies[i] || !dependencies[i]->is_finished())
+            vw_throw(ArgumentErr() << "TaskGraphWorkQueue: a dependency has not been added to this queue.");
+        }
+
+        boost::shared_ptr<Node> node(new Node);
+        node->task = task;
+        node->unfinished_dependencies = unfinished.size();
+        for (size_t i = 0; i < unfinished.size(); ++i)
+          unfinished[i]->dependents.push_back(node);
+        m_nodes[task.get()] = node;
+        if (node->unfinished_dependencies == 0)
+          m_ready_tasks.push_back(boost::shared_ptr<Task>(new NodeTask(*this, node)));
+      }
+      this->notify();
+    }
+
+    /// Add a task that depends on a single other task.
+    void add_task(boost::shared_ptr<Task> task, boost::shared_ptr<Task> dependency) {
+      this->add_task(task, TaskList(1, dependency));
+    }
+
+    virtual boost::shared_ptr<Task> get_next_task() {
+      Mutex::Lock lock(m_mutex);
+      if (m_ready_tasks.empty())
+        return boost::shared_ptr<Task>();
+
+      boost::shared_ptr<Task> task = m_ready_tasks.front();
+      m_ready_tasks.pop_front();
+      return task;
+    }
+  };
+
+  /// A work queue that gives each worker thread its own task deque.
+  ///
+  /// The WorkQueue base class hands out every task while holding a
+  /// single queue mutex, which becomes a point of contention when
+  /// many threads are chewing through many small tasks.  Here each
+  /// worker pops tasks from the back of its own deque, and an idle
+  /// worker steals from the front of another worker's deque.  Tasks
+  /// added from outside the pool are dealt out round-robin; tasks
+  /// added from inside a running task go onto that worker's own deque
+  /// so that related work stays on the same thread.
+  ///
+  /// The interface (add_task, size, join_all) matches FifoWorkQueue,
+  /// so it can be swapped in wherever a FifoWorkQueue is used.  Unlike
+  /// the other work queues, the worker threads are started up front
+  /// and live as long as the queue does.  Tasks are not guaranteed to
+  /// run in the order they were added.
+  class WorkStealingWorkQueue : private boost::noncopyable {
+
+    struct TaskDeque {
+      Mutex mutex;
+      std::deque<boost::shared_ptr<Task> > tasks;
+    };
+
+    class WorkerThread {
+      WorkStealingWorkQueue &m_queue;
+      size_t m_index;
+    public:
+      WorkerThread(WorkStealingWorkQueue& queue, size_t index) : m_queue(queue), m_index(index) {}
+      void operator()() { m_queue.worker_loop(m_index); }
+    };
+
+    std::vector<boost::shared_ptr<TaskDeque> > m_deques;
+    std::vector<boost::shared_ptr<Thread> > m_threads;
+
+    // Identifies which of our deques belongs to the calling thread.
+    // The cleanup function is a no-op because the deques are owned by
+    // m_deques.
+    boost::thread_specific_ptr<TaskDeque> m_local_deque;
+    static void no_cleanup(TaskDeque*) {}
+
+    Atomic<int32> m_queued;      // Tasks sitting in a deque
+    Atomic<int32> m_outstanding; // Tasks queued or running
+    Atomic<int32> m_sleeping;    // Workers waiting for m_work_event
+    Atomic<uint32> m_next_deque;
+
+    // m_sleep_mutex only guards the sleep/wake handshake; it is never
+    // taken on the fast path where a worker finds a task to run.
+    Mutex m_sleep_mutex;
+    Condition m_work_event;
+    Condition m_joined_event;
+    bool m_should_die;
+
+    boost::shared_ptr<Task> pop_local(size_t index) {
+      TaskDeque& d = *m_deques[index];
+      Mutex::Lock lock(d.mutex);
+      if (d.tasks.empty())
+        return boost::shared_ptr<Task>();
+      boost::shared_ptr<Task> task = d.tasks.back();
+      d.tasks.pop_back();
+      --m_queued;
+      return task;
+    }
+
+    boost::shared_ptr<Task> steal(size_t thief) {
+      for (size_t i = 1; i < m_deques.size(); ++i) {
+        TaskDeque& d = *m_deques[(thief + i) % m_deques.size()];
+        Mutex::Lock lock(d.mutex);
+        if (d.tasks.empty())
+          continue;
+        boost::shared_ptr<Task> task = d.tasks.front();
+        d.tasks.pop_front();
+        --m_queued;
+        return task;
+      }
+      return boost::shared_ptr<Task>();
+    }
+
+    void task_complete() {
+      if (--m_outstanding == 0) {
+        Mutex::Lock lock(m_sleep_mutex);
+        m_joined_event.notify_all();
+      }
+    }
+
+    void worker_loop(size_t index) {
+      m_local_deque.reset(m_deques[index].get());
+      Thread::place_worker(index);
+      vw_out(DebugMessage, "thread") << "WorkStealingWorkQueue: starting worker thread " << index << "\n";
+      while (1) {
+        boost::shared_ptr<Task> task = pop_local(index);
+        if (!task)
+          task = steal(index);
+
+        if (task) {
+          (*task)();
+          task->signal_finished();
+          task_complete();
+          continue;
+        }
+
+        // Nothing to do.  We advertise that we are going to sleep
+        // before re-checking for queued work; add_task() does the
+        // opposite (queue, then check for sleepers), so one of the two
+        // is guaranteed to see the other.
+        Mutex::Lock lock(m_sleep_mutex);
+        if (m_should_die)
+          break;
+        ++m_sleeping;
+        if (m_queued.load() == 0)
+          m_work_event.wait(lock);
+        --m_sleeping;
+      }
+      vw_out(DebugMessage, "thread") << "WorkStealingWorkQueue: terminating worker thread " << index << "\n";
+      m_local_deque.release();
+    }
+
+  public:
+    WorkStealingWorkQueue(int num_threads = vw_settings().default_num_threads())
+      : m_local_deque(&WorkStealingWorkQueue::no_cleanup), m_should_die(false) {
+      VW_ASSERT(num_threads > 0, ArgumentErr() << "WorkStealingWorkQueue: need at least one thread.");
+      m_deques.resize(num_threads);
+      for (int i = 0; i < num_threads; ++i)
+        m_deques[i].reset(new TaskDeque);
+      m_threads.resize(num_threads);
+      for (int i = 0; i < num_threads; ++i)
+        m_threads[i].reset(new Thread(WorkerThread(*this, i)));
+    }
+
+    ~WorkStealingWorkQueue() {
+      this->join_all();
+      {
+        Mutex::Lock lock(m_sleep_mutex);
+        m_should_die = true;
+        m_work_event.notify_all();
+      }
+      for (size_t i = 0; i < m_threads.size(); ++i)
+        m_threads[i]->join();
+    }
+
+    /// Return the number of tasks waiting to run.
+    size_t size() { return m_queued.load(); }
+
+    int max_threads() { return int(m_threads.size()); }
+
+    /// Return the number of workers that are not asleep.
+    int active_threads() { return int(m_threads.size()) - m_sleeping.load(); }
+
+    // Add a task that is being tracked by a shared pointer.
+    void add_task(boost::shared_ptr<Task> task) {
+      ++m_outstanding;
+
+      TaskDeque* d = m_local_deque.get();
+      if (!d)
+        d = m_deques[m_next_deque.add(1) % m_deques.size()].get();
+      {
+        Mutex::Lock lock(d->mutex);
+        d->tasks.push_back(task);
+      }
+      ++m_queued;
+
+      if (m_sleeping.load() > 0) {
+        Mutex::Lock lock(m_sleep_mutex);
+        m_work_event.notify_one();
+      }
+    }
+
+    // Queue a callable and return a Future for its result.
+    template <class FuncT>
+    Future<typename boost::result_of<FuncT()>::type> submit( FuncT func ) {
+      typedef typename boost::result_of<FuncT()>::type result_type;
+      boost::shared_ptr<detail::FutureTask<result_type, FuncT> > task = make_future_task(func);
+      this->add_task(task);
+      return Future<result_type>(task);
+    }
+
+    // Wait for every task that has been added to finish running.
+    void join_all() {
+      Mutex::Lock lock(m_sleep_mutex);
+      while (m_outstanding.load() != 0)
+        m_joined_event.wait(lock);
+    }
+
+    // Throw away any tasks that have not started yet, then wait for
+    // the running ones to finish.
+    void kill_and_join() {
+      for (size_t i = 0; i < m_deques.size(); ++i) {
+        boost::shared_ptr<Task> task;
+        while ((task = pop_local(i)))
+          task_complete();
+      }
+      this->join_all();
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_CORE_THREADPOOL_H__
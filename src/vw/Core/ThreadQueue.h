@@ -14,6 +14,7 @@
 #define __VW_CORE_QUEUE_H__
 
 #include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
 
 #include <queue>
 #include <vw/Core/FundamentalTypes.h>
@@ -95,6 +96,194 @@ class ThreadQueue : private boost::noncopyable {
     }
 };
 
+/// A fixed-capacity, multi-producer multi-consumer queue.
+///
+/// Unlike ThreadQueue, pushing and popping do not take a lock when
+/// the queue is neither full nor empty; slots in a ring buffer are
+/// claimed with compare-and-swap on a per-slot sequence number (this
+/// is Dmitry Vyukov's bounded MPMC queue).  A thread only blocks when
+/// it has to wait: push() blocks while the queue is full, which gives
+/// producers backpressure, and wait_pop() blocks while it is empty.
+///
+/// The capacity is rounded up to a power of two.  T must be default
+/// constructible and assignable; a popped slot is reset to T() so
+/// that the queue does not keep e.g. shared pointers alive.
+template<typename T>
+class BoundedThreadQueue : private boost::noncopyable {
+  private:
+    struct Cell {
+      Atomic<size_t> sequence;
+      T data;
+    };
+
+    // Keep the producer and consumer cursors on separate cache lines.
+    enum { CacheLineSize = 64 };
+
+    boost::scoped_array<Cell> m_buffer;
+    size_t m_mask;
+    char m_pad0[CacheLineSize];
+    Atomic<size_t> m_enqueue_pos;
+    char m_pad1[CacheLineSize];
+    Atomic<size_t> m_dequeue_pos;
+    char m_pad2[CacheLineSize];
+
+    // Slow path: threads waiting for room or for data.
+    Mutex m_mutex;
+    Condition m_not_full, m_not_empty;
+    Atomic<int32> m_push_waiters, m_pop_waiters;
+
+    static size_t round_up_pow2(size_t n) {
+      size_t p = 2;
+      while (p < n) p <<= 1;
+      return p;
+    }
+
+    void wake(Atomic<int32>& waiters, Condition& cond) {
+      if (waiters.load() > 0) {
+        Mutex::Lock lock(m_mutex);
+        cond.notify_all();
+      }
+    }
+
+    bool has_data() const { return size() > 0; }
+
+    // Claim a slot and fill it.  Fails only if the queue is full.
+    bool push_slot(T const& data) {
+      Cell* cell;
+      size_t pos = m_enqueue_pos.load();
+      while (1) {
+        cell = &m_buffer[pos & m_mask];
+        intptr_t dif = intptr_t(cell->sequence.load()) - intptr_t(pos);
+        if (dif == 0) {
+          if (m_enqueue_pos.compare_and_swap(pos, pos + 1))
+            break;
+          pos = m_enqueue_pos.load();
+        } else if (dif < 0) {
+          return false;
+        } else {
+          pos = m_enqueue_pos.load();
+        }
+      }
+      cell->data = data;
+      cell->sequence.store(pos + 1);
+      return true;
+    }
+
+    // Claim a slot and empty it.  Fails only if the queue is empty.
+    bool pop_slot(T& data) {
+      Cell* cell;
+      size_t pos = m_dequeue_pos.load();
+      while (1) {
+        cell = &m_buffer[pos & m_mask];
+        intptr_t dif = intptr_t(cell->sequence.load()) - intptr_t(pos + 1);
+        if (dif == 0) {
+          if (m_dequeue_pos.compare_and_swap(pos, pos + 1))
+            break;
+          pos = m_dequeue_pos.load();
+        } else if (dif < 0) {
+          return false;
+        } else {
+          pos = m_dequeue_pos.load();
+        }
+      }
+      data = cell->data;
+      cell->data = T();
+      cell->sequence.store(pos + m_mask + 1);
+      return true;
+    }
+
+  public:
+    BoundedThreadQueue(size_t capacity = 1024)
+      : m_mask(round_up_pow2(capacity) - 1) {
+      m_buffer.reset(new Cell[m_mask + 1]);
+      for (size_t i = 0; i <= m_mask; ++i)
+        m_buffer[i].sequence.store(i);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Try to push something on, return indicates success.  Fails only
+    // if the queue is full.
+    bool try_push(T const& data) {
+      if (!push_slot(data))
+        return false;
+      wake(m_pop_waiters, m_not_empty);
+      return true;
+    }
+
+    // Try to pop something off, return indicates success.  Fails only
+    // if the queue is empty.
+    bool try_pop(T& data) {
+      if (!pop_slot(data))
+        return false;
+      wake(m_push_waiters, m_not_full);
+      return true;
+    }
+
+    // Push, waiting for room if the queue is full.
+    void push(T const& data) {
+      if (try_push(data))
+        return;
+      Mutex::Lock lock(m_mutex);
+      ++m_push_waiters;
+      // Re-check after advertising ourselves as a waiter so that a
+      // concurrent pop either sees us or leaves room we can see.
+      while (!push_slot(data))
+        m_not_full.wait(lock);
+      --m_push_waiters;
+      if (m_pop_waiters.load() > 0)
+        m_not_empty.notify_all();
+    }
+
+    // Wait for data forever
+    void wait_pop(T& data) {
+      if (try_pop(data))
+        return;
+      Mutex::Lock lock(m_mutex);
+      ++m_pop_waiters;
+      while (!pop_slot(data))
+        m_not_empty.wait(lock);
+      --m_pop_waiters;
+      if (m_push_waiters.load() > 0)
+        m_not_full.notify_all();
+    }
+
+    // Wait for data with a timeout (in ms)
+    bool timed_wait_pop(T& data, unsigned long duration) {
+      if (try_pop(data))
+        return true;
+      Mutex::Lock lock(m_mutex);
+      ++m_pop_waiters;
+      bool success = pop_slot(data);
+      while (!success) {
+        if (!m_not_empty.timed_wait(lock, duration, boost::bind(&BoundedThreadQueue::has_data, this)))
+          break;
+        success = pop_slot(data);
+      }
+      --m_pop_waiters;
+      if (success && m_push_waiters.load() > 0)
+        m_not_full.notify_all();
+      return success;
+    }
+
+    // Returns the number of messages waiting in the queue.  This is
+    // only a snapshot if other threads are pushing or popping.
+    size_t size() const {
+      size_t tail = m_dequeue_pos.load();
+      size_t head = m_enqueue_pos.load();
+      return head >= tail ? head - tail : 0;
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    void flush() {
+      T data;
+      while (try_pop(data)) {}
+    }
+};
+
 } // namespace vw
 
 
@@ -0,0 +1,101 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/Thread.h>
+
+using namespace vw;
+
+static const size_t MB = 1024 * 1024;
+
+TEST(BufferPool, Reuse) {
+  BufferPool pool(16*MB);
+
+  void* a = pool.allocate(2*MB);
+  ASSERT_TRUE(a != 0);
+  EXPECT_EQ( 1u, pool.misses() );
+  pool.deallocate(a, 2*MB);
+  EXPECT_LE( 2*MB, pool.size() );
+
+  // A slightly smaller request falls in the same size class.
+  void* b = pool.allocate(2*MB - 4096);
+  EXPECT_EQ( a, b );
+  EXPECT_EQ( 1u, pool.hits() );
+  EXPECT_EQ( 0u, pool.size() );
+  pool.deallocate(b, 2*MB - 4096);
+
+  // A request twice as large does not.
+  void* c = pool.allocate(4*MB);
+  EXPECT_NE( a, c );
+  EXPECT_EQ( 2u, pool.misses() );
+  pool.deallocate(c, 4*MB);
+
+  pool.clear();
+  EXPECT_EQ( 0u, pool.size() );
+}
+
+TEST(BufferPool, Budget) {
+  BufferPool pool(3*MB);
+  std::vector<void*> buffers;
+  for (int i = 0; i < 4; ++i)
+    buffers.push_back(pool.allocate(1*MB));
+  for (int i = 0; i < 4; ++i)
+    pool.deallocate(buffers[i], 1*MB);
+  EXPECT_EQ( 3*MB, pool.size() );
+
+  pool.set_max_size(1*MB);
+  // The calling thread's freelist is only trimmed by clear().
+  EXPECT_LE( 1*MB, pool.size() );
+  pool.clear();
+  EXPECT_EQ( 0u, pool.size() );
+
+  // A disabled pool holds nothing.
+  pool.set_max_size(0);
+  EXPECT_FALSE( pool.pooled(1*MB) );
+  pool.deallocate(pool.allocate(1*MB), 1*MB);
+  EXPECT_EQ( 0u, pool.size() );
+
+  // Small requests are never pooled.
+  pool.set_max_size(3*MB);
+  EXPECT_FALSE( pool.pooled(BufferPool::min_pooled_size - 1) );
+  pool.deallocate(pool.allocate(100), 100);
+  EXPECT_EQ( 0u, pool.size() );
+}
+
+struct ReleaseBuffers {
+  BufferPool& m_pool;
+  ReleaseBuffers(BufferPool& pool) : m_pool(pool) {}
+  void operator()() {
+    // More than one thread's worth, so some go straight to the shared
+    // freelist and the rest when this thread exits.
+    std::vector<void*> buffers;
+    for (size_t i = 0; i < 2*BufferPool::thread_buffers; ++i)
+      buffers.push_back(m_pool.allocate(1*MB));
+    for (size_t i = 0; i < buffers.size(); ++i)
+      m_pool.deallocate(buffers[i], 1*MB);
+  }
+};
+
+TEST(BufferPool, SharedBetweenThreads) {
+  BufferPool pool(64*MB);
+  {
+    Thread thread( (ReleaseBuffers(pool)) );
+    thread.join();
+  }
+  EXPECT_EQ( 2*BufferPool::thread_buffers*MB, pool.size() );
+
+  std::vector<void*> buffers;
+  for (size_t i = 0; i < 2*BufferPool::thread_buffers; ++i)
+    buffers.push_back(pool.allocate(1*MB));
+  EXPECT_EQ( 2*BufferPool::thread_buffers, pool.hits() );
+  EXPECT_EQ( 0u, pool.size() );
+
+  for (size_t i = 0; i < buffers.size(); ++i)
+    pool.deallocate(buffers[i], 1*MB);
+}
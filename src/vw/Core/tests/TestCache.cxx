@@ -6,6 +6,7 @@
 
 
 #include <memory>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <vw/Core/Cache.h>
@@ -114,6 +115,28 @@ TEST_F(CacheTest, Priority) {
   EXPECT_FALSE(cache_handles[num_actual_blocks-1].valid());
 }
 
+TEST_F(CacheTest, Touch) {
+  // prime the cache
+  for (int i = 0; i < num_actual_blocks; ++i) {
+    EXPECT_EQ(i, *cache_handles[i]);
+  }
+
+  // touching an evicted line does not bring it back
+  ASSERT_FALSE(cache_handles[0].valid());
+  cache_handles[0].touch();
+  EXPECT_FALSE(cache_handles[0].valid());
+
+  // touch the oldest cached element, then bring in a new one
+  int oldest = num_actual_blocks - num_cache_blocks;
+  ASSERT_TRUE(cache_handles[oldest].valid());
+  cache_handles[oldest].touch();
+  EXPECT_EQ( 0, *cache_handles[0] );
+
+  // the touched element survived, and the next oldest went instead
+  EXPECT_TRUE(cache_handles[oldest].valid());
+  EXPECT_FALSE(cache_handles[oldest+1].valid());
+}
+
 // Every copy increases the fill_value by one
 class GenGen : public BlockGenerator {
   public:
@@ -224,3 +247,388 @@ TEST(Cache, Stats) {
   EXPECT_EQ(0u, cache.misses());
   EXPECT_EQ(0u, cache.evictions());
 }
+
+TEST(Cache, Sharded) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+
+  // Room for 8 one-byte blocks spread over 4 shards
+  vw::Cache cache(8*sizeof(handle_t::value_type), 4);
+  EXPECT_EQ(4u, cache.num_shards());
+
+  std::vector<handle_t> h(32);
+  for (uint8 i = 0; i < h.size(); ++i)
+    h[i] = cache.insert(BlockGenerator(1, i));
+
+  for (uint8 i = 0; i < h.size(); ++i)
+    EXPECT_EQ(i, *h[i]);
+
+  // The budget is global, so no more than 8 lines can be resident.
+  size_t resident = 0;
+  for (size_t i = 0; i < h.size(); ++i)
+    if (h[i].valid())
+      resident++;
+  EXPECT_LE(resident, 8u);
+  EXPECT_GT(resident, 0u);
+
+  EXPECT_EQ(0u,  cache.hits());
+  EXPECT_EQ(32u, cache.misses());
+  EXPECT_EQ(32u - resident, cache.evictions());
+
+  // The most recently used line is always still around
+  EXPECT_TRUE(h.back().valid());
+  EXPECT_EQ(31, *h.back());
+  EXPECT_EQ(1u, cache.hits());
+
+  // Shrinking the cache evicts from every shard
+  cache.resize(2*sizeof(handle_t::value_type));
+  resident = 0;
+  for (size_t i = 0; i < h.size(); ++i)
+    if (h[i].valid())
+      resident++;
+  EXPECT_LE(resident, 2u);
+
+  cache.clear_stats();
+  EXPECT_EQ(0u, cache.hits());
+  EXPECT_EQ(0u, cache.misses());
+  EXPECT_EQ(0u, cache.evictions());
+
+  // Out-of-range shard counts are clamped
+  cache.set_num_shards(0);
+  EXPECT_EQ(1u, cache.num_shards());
+  cache.set_num_shards(1000);
+  EXPECT_EQ(64u, cache.num_shards());
+}
+
+class CacheHammerTask {
+  std::vector<Cache::Handle<BlockGenerator> > &m_handles;
+  size_t m_offset;
+public:
+  bool ok;
+  CacheHammerTask(std::vector<Cache::Handle<BlockGenerator> > &handles, size_t offset)
+    : m_handles(handles), m_offset(offset), ok(true) {}
+  void operator()() {
+    for (size_t i = 0; i < 2000; ++i) {
+      size_t idx = (i * 7 + m_offset) % m_handles.size();
+      boost::shared_ptr<BlockGenerator::value_type> ptr = m_handles[idx];
+      if (*ptr != idx)
+        ok = false;
+    }
+  }
+};
+
+TEST(Cache, ShardedThreaded) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+  vw::Cache cache(16*sizeof(handle_t::value_type), 8);
+
+  std::vector<handle_t> h(64);
+  for (uint8 i = 0; i < h.size(); ++i)
+    h[i] = cache.insert(BlockGenerator(1, i));
+
+  std::vector<boost::shared_ptr<CacheHammerTask> > tasks(8);
+  std::vector<boost::shared_ptr<Thread> > threads(8);
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i].reset(new CacheHammerTask(h, i));
+    threads[i].reset(new Thread(tasks[i]));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->join();
+    EXPECT_TRUE(tasks[i]->ok);
+  }
+  EXPECT_EQ(8u*2000u, cache.hits() + cache.misses());
+}
+
+TEST(Cache, GeneratorStats) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+
+  // Cache can hold 2 items
+  vw::Cache cache(2*sizeof(handle_t::value_type));
+
+  handle_t h[3] = {
+    cache.insert(BlockGenerator(1, 0)),
+    cache.insert(BlockGenerator(1, 1)),
+    cache.insert(BlockGenerator(1, 2))};
+  Cache::Handle<GenGen> g = cache.insert(GenGen());
+
+  EXPECT_EQ(0, *h[0]); // miss
+  EXPECT_EQ(0, *h[0]); // hit
+  EXPECT_EQ(1, *h[1]); // miss
+  EXPECT_EQ(2, *h[2]); // miss, evicts h[0]
+  EXPECT_EQ(0, *h[0]); // miss, regenerates h[0], evicts h[1]
+  EXPECT_EQ(1, *g);    // miss, evicts h[2]
+
+  typedef std::map<std::string, Cache::GeneratorStats> stats_t;
+  stats_t stats = cache.generator_stats();
+  ASSERT_EQ(2u, stats.size());
+
+  Cache::GeneratorStats block, gengen;
+  for (stats_t::const_iterator i = stats.begin(); i != stats.end(); ++i) {
+    if (i->first.find("GenGen") != std::string::npos)
+      gengen = i->second;
+    else if (i->first.find("BlockGenerator") != std::string::npos)
+      block = i->second;
+  }
+
+  EXPECT_EQ(1u, block.hits);
+  EXPECT_EQ(4u, block.misses);
+  EXPECT_EQ(3u, block.evictions);
+  EXPECT_EQ(4u, block.bytes_generated);
+  EXPECT_EQ(1u, block.bytes_regenerated);
+
+  EXPECT_EQ(0u, gengen.hits);
+  EXPECT_EQ(1u, gengen.misses);
+  EXPECT_EQ(0u, gengen.evictions);
+  EXPECT_EQ(1u, gengen.bytes_generated);
+  EXPECT_EQ(0u, gengen.bytes_regenerated);
+
+  Cache::GeneratorStats total = cache.stats();
+  EXPECT_EQ(cache.hits(), total.hits);
+  EXPECT_EQ(cache.misses(), total.misses);
+  EXPECT_EQ(cache.evictions(), total.evictions);
+
+  EXPECT_NE(std::string::npos, cache.stats_report().find("BlockGenerator"));
+
+  cache.clear_stats();
+  EXPECT_EQ(0u, cache.stats().misses);
+  EXPECT_EQ(0u, cache.stats().bytes_generated);
+
+  // Lines keep counting into their (reset) entries after a clear
+  EXPECT_EQ(1, *h[1]);
+  EXPECT_EQ(1u, cache.stats().misses);
+  EXPECT_EQ(1u, cache.stats().bytes_regenerated);
+}
+
+TEST(Cache, Prefetch) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+  vw::Cache cache(4*sizeof(handle_t::value_type));
+
+  handle_t h = cache.insert(BlockGenerator(1, 7));
+  EXPECT_FALSE(h.valid());
+  h.prefetch();
+  h.prefetch(); // already queued or done, so this is a no-op
+
+  for (int i = 0; i < 500 && !h.valid(); ++i)
+    Thread::sleep_ms(10);
+  ASSERT_TRUE(h.valid());
+
+  EXPECT_EQ(7, *h);
+  h.prefetch(); // already valid
+
+  Cache::GeneratorStats total = cache.stats();
+  EXPECT_EQ(1u, total.misses);
+  EXPECT_EQ(1u, total.prefetches);
+  EXPECT_EQ(1u, total.hits);
+}
+
+// A value type that opts in to the spill tier.
+struct SpillValue {
+  int32 value;
+};
+
+namespace vw {
+  template <>
+  struct CacheSpillTraits<SpillValue> {
+    static const bool value = true;
+    static void write( std::ostream& os, SpillValue const& v ) {
+      os.write( reinterpret_cast<const char*>(&v.value), sizeof(v.value) );
+    }
+    static boost::shared_ptr<SpillValue> read( std::istream& is ) {
+      boost::shared_ptr<SpillValue> v( new SpillValue );
+      if( ! is.read( reinterpret_cast<char*>(&v->value), sizeof(v->value) ) )
+        return boost::shared_ptr<SpillValue>();
+      return v;
+    }
+  };
+}
+
+class SpillGenerator {
+  int32 m_value;
+  int *m_generated;
+public:
+  typedef SpillValue value_type;
+  SpillGenerator( int32 value, int *generated ) : m_value(value), m_generated(generated) {}
+  size_t size() const { return 1; }
+  boost::shared_ptr<SpillValue> generate() const {
+    ++*m_generated;
+    boost::shared_ptr<SpillValue> v( new SpillValue );
+    v->value = m_value;
+    return v;
+  }
+};
+
+TEST(Cache, Spill) {
+  typedef Cache::Handle<SpillGenerator> handle_t;
+  int generated = 0;
+
+  // Room for 1 value in memory and 2 on disk
+  vw::Cache cache(1);
+  cache.set_spill(vw_settings().tmp_directory(), 2*sizeof(int32));
+
+  handle_t h[3] = {
+    cache.insert(SpillGenerator(10, &generated)),
+    cache.insert(SpillGenerator(11, &generated)),
+    cache.insert(SpillGenerator(12, &generated))};
+
+  EXPECT_EQ(10, h[0]->value);
+  EXPECT_EQ(11, h[1]->value); // spills h[0]
+  EXPECT_EQ(12, h[2]->value); // spills h[1]
+  EXPECT_EQ(3, generated);
+  EXPECT_EQ(2*sizeof(int32), cache.spill_size());
+
+  EXPECT_EQ(10, h[0]->value); // reloaded; h[2] spilled, dropping h[1] from disk
+  EXPECT_EQ(3, generated);
+  EXPECT_EQ(11, h[1]->value); // regenerated
+  EXPECT_EQ(4, generated);
+
+  Cache::GeneratorStats total = cache.stats();
+  EXPECT_EQ(1u, total.spill_hits);
+  EXPECT_EQ(3u, total.spills); // h[0] was not rewritten
+  EXPECT_EQ(5u, total.misses);
+
+  // Lines remove their files when destroyed
+  for (int i = 0; i < 3; ++i)
+    h[i].reset();
+  EXPECT_EQ(0u, cache.spill_size());
+
+  cache.set_spill("", 0);
+  EXPECT_EQ(0u, cache.spill_size());
+}
+
+// A value type whose spill writer checks, from another thread, that
+// the cache is not locked while the value is serialized.
+struct ProbedValue {
+  int32 value;
+};
+
+struct SpillProbe {
+  vw::Cache& cache;
+  Mutex mutex;
+  Condition cond;
+  bool done;
+  SpillProbe( vw::Cache& cache ) : cache(cache), done(false) {}
+  void operator()() {
+    cache.stats();
+    Mutex::Lock lock(mutex);
+    done = true;
+    cond.notify_all();
+  }
+};
+
+vw::Cache *probed_cache = 0;
+int probes_blocked = 0;
+std::vector<boost::shared_ptr<Thread> > probe_threads;
+
+namespace vw {
+  template <>
+  struct CacheSpillTraits<ProbedValue> {
+    static const bool value = true;
+    static void write( std::ostream& os, ProbedValue const& v ) {
+      boost::shared_ptr<SpillProbe> probe( new SpillProbe( *probed_cache ) );
+      probe_threads.push_back( boost::shared_ptr<Thread>( new Thread( probe ) ) );
+      Mutex::Lock lock(probe->mutex);
+      while( ! probe->done && probe->cond.timed_wait( lock, 5000 ) ) {}
+      if( ! probe->done ) ++probes_blocked;
+      os.write( reinterpret_cast<const char*>(&v.value), sizeof(v.value) );
+    }
+    static boost::shared_ptr<ProbedValue> read( std::istream& is ) {
+      boost::shared_ptr<ProbedValue> v( new ProbedValue );
+      if( ! is.read( reinterpret_cast<char*>(&v->value), sizeof(v->value) ) )
+        return boost::shared_ptr<ProbedValue>();
+      return v;
+    }
+  };
+}
+
+class ProbedGenerator {
+  int32 m_value;
+public:
+  typedef ProbedValue value_type;
+  ProbedGenerator( int32 value ) : m_value(value) {}
+  size_t size() const { return 1; }
+  boost::shared_ptr<ProbedValue> generate() const {
+    boost::shared_ptr<ProbedValue> v( new ProbedValue );
+    v->value = m_value;
+    return v;
+  }
+};
+
+TEST(Cache, SpillOutsideLock) {
+  typedef Cache::Handle<ProbedGenerator> handle_t;
+  vw::Cache cache(1);
+  cache.set_spill(vw_settings().tmp_directory(), 4*sizeof(int32));
+  probed_cache = &cache;
+
+  handle_t a = cache.insert(ProbedGenerator(1));
+  handle_t b = cache.insert(ProbedGenerator(2));
+  EXPECT_EQ(1, a->value);
+  EXPECT_EQ(2, b->value); // spills a
+  cache.resize(0);        // spills b
+  EXPECT_EQ(2u, cache.stats().spills);
+  EXPECT_EQ(2u, probe_threads.size());
+  EXPECT_EQ(0, probes_blocked);
+
+  cache.resize(1);
+  EXPECT_EQ(1, a->value);
+  EXPECT_EQ(1u, cache.stats().spill_hits);
+
+  for (size_t i = 0; i < probe_threads.size(); ++i)
+    probe_threads[i]->join();
+  probe_threads.clear();
+  probed_cache = 0;
+}
+
+TEST(Cache, TwoQueueEviction) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+  const size_t block = sizeof(handle_t::value_type);
+
+  for (int two_queue = 0; two_queue < 2; ++two_queue) {
+    vw::Cache cache(4*block);
+    if (two_queue)
+      cache.set_eviction_policy(Cache::TwoQueueEviction);
+
+    // A small working set, used twice
+    handle_t hot[2] = {cache.insert(BlockGenerator(1, 0)), cache.insert(BlockGenerator(1, 1))};
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(0, *hot[0]);
+      EXPECT_EQ(1, *hot[1]);
+    }
+
+    // One pass over many more blocks than fit
+    std::vector<handle_t> scan;
+    for (int i = 0; i < 10; ++i) {
+      scan.push_back(cache.insert(BlockGenerator(1, uint8(10+i))));
+      EXPECT_EQ(10+i, *scan.back());
+    }
+
+    EXPECT_EQ(bool(two_queue), hot[0].valid());
+    EXPECT_EQ(bool(two_queue), hot[1].valid());
+    EXPECT_TRUE(scan.back().valid());
+  }
+}
+
+// Takes a measurable amount of time to generate.
+class SlowGenerator : public BlockGenerator {
+public:
+  SlowGenerator(vw::uint8 fill_value) : BlockGenerator(1, fill_value) {}
+  boost::shared_ptr<value_type> generate() const {
+    Thread::sleep_ms(20);
+    return BlockGenerator::generate();
+  }
+};
+
+TEST(Cache, CostWeightedEviction) {
+  const size_t block = sizeof(BlockGenerator::value_type);
+  vw::Cache cache(2*block);
+  cache.set_eviction_policy(Cache::CostWeightedEviction);
+  EXPECT_EQ(Cache::CostWeightedEviction, cache.eviction_policy());
+
+  Cache::Handle<SlowGenerator> slow = cache.insert(SlowGenerator(1));
+  Cache::Handle<BlockGenerator> cheap = cache.insert(BlockGenerator(1, 2));
+  EXPECT_EQ(1, *slow);
+  EXPECT_EQ(2, *cheap);
+
+  // Plain LRU would evict the slow block here
+  Cache::Handle<BlockGenerator> other = cache.insert(BlockGenerator(1, 3));
+  EXPECT_EQ(3, *other);
+  EXPECT_TRUE(slow.valid());
+  EXPECT_FALSE(cheap.valid());
+}
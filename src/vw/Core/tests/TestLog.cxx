@@ -477,3 +477,72 @@ TEST(Log, WarningsCanBeTurnedOff4) {
   const std::string& x = sstr.str();
   ASSERT_TRUE(x.empty());
 }
+
+TEST(Log, Asynchronous) {
+  std::ostringstream sstr;
+  {
+    LogInstance log(sstr, false);
+    Log::set_asynchronous(true);
+    EXPECT_TRUE(Log::asynchronous());
+    uint64 dropped = Log::dropped_messages();
+
+    for (int i = 0; i < 100; ++i)
+      log(InfoMessage) << "line " << i << "\n";
+    Log::flush();
+    EXPECT_EQ(dropped, Log::dropped_messages());
+
+    Log::set_asynchronous(false);
+    EXPECT_FALSE(Log::asynchronous());
+  }
+
+  std::ostringstream expected;
+  for (int i = 0; i < 100; ++i)
+    expected << "line " << i << "\n";
+  EXPECT_EQ(expected.str(), sstr.str());
+}
+
+namespace {
+  // A streambuf that blocks writes until it is opened.
+  class GateBuf : public std::stringbuf {
+    Mutex m_mutex;
+    Condition m_cond;
+    bool m_open;
+  protected:
+    virtual std::streamsize xsputn(const char* s, std::streamsize num) {
+      {
+        Mutex::Lock lock(m_mutex);
+        while (!m_open)
+          m_cond.wait(lock);
+      }
+      return std::stringbuf::xsputn(s, num);
+    }
+  public:
+    GateBuf() : m_open(false) {}
+    void open() {
+      Mutex::Lock lock(m_mutex);
+      m_open = true;
+      m_cond.notify_all();
+    }
+  };
+}
+
+TEST(Log, AsynchronousDropsWhenFull) {
+  GateBuf buf;
+  std::ostream stream(&buf);
+  {
+    LogInstance log(stream, false);
+    Log::set_asynchronous(true, 4);
+    uint64 dropped = Log::dropped_messages();
+
+    // The writer blocks on the first line it takes, so at most the
+    // backlog plus that one line get through.
+    for (int i = 0; i < 20; ++i)
+      log(InfoMessage) << "line " << i << "\n";
+    EXPECT_GE(Log::dropped_messages() - dropped, 20u - 5u);
+
+    buf.open();
+    Log::set_asynchronous(false);
+  }
+  EXPECT_NE(std::string::npos, buf.str().find("line 0\n"));
+  EXPECT_NE(std::string::npos, buf.str().find("log messages were dropped"));
+}
@@ -0,0 +1,112 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <fstream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <vw/Core/PerfCounters.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::test;
+
+TEST(PerfCounters, Counter) {
+  PerfCounterRegistry registry;
+  PerfCounter& c = registry.counter("test.counter");
+  EXPECT_EQ(0u, c.value());
+  c.add();
+  c.add(10);
+  c.sub(3);
+  EXPECT_EQ(8u, c.value());
+
+  // The same name gives the same counter.
+  EXPECT_EQ(&c, &registry.counter("test.counter"));
+  EXPECT_NE(&c, &registry.counter("test.other"));
+
+  registry.reset();
+  EXPECT_EQ(0u, c.value());
+}
+
+TEST(PerfCounters, Histogram) {
+  EXPECT_EQ(0, PerfHistogram::bucket_index(0));
+  EXPECT_EQ(1, PerfHistogram::bucket_index(1));
+  EXPECT_EQ(2, PerfHistogram::bucket_index(2));
+  EXPECT_EQ(2, PerfHistogram::bucket_index(3));
+  EXPECT_EQ(11, PerfHistogram::bucket_index(1024));
+  EXPECT_EQ(64, PerfHistogram::bucket_index(~uint64(0)));
+  for (int i = 0; i < PerfHistogram::num_buckets; ++i)
+    EXPECT_EQ(i, PerfHistogram::bucket_index(PerfHistogram::bucket_limit(i)));
+
+  PerfCounterRegistry registry;
+  PerfHistogram& h = registry.histogram("test.latency_us");
+  EXPECT_EQ(0u, h.quantile(0.5));
+
+  // 90 fast values and 10 slow ones.
+  for (int i = 0; i < 90; ++i) h.record(5);
+  for (int i = 0; i < 10; ++i) h.record(1000);
+  EXPECT_EQ(100u, h.count());
+  EXPECT_EQ(90u*5 + 10u*1000, h.sum());
+  EXPECT_EQ(1000u, h.max());
+  EXPECT_EQ(90u, h.bucket(PerfHistogram::bucket_index(5)));
+  EXPECT_EQ(7u, h.quantile(0.5));
+  EXPECT_EQ(1000u, h.quantile(0.95));
+  EXPECT_EQ(1000u, h.quantile(1.0));
+
+  registry.reset();
+  EXPECT_EQ(0u, h.count());
+  EXPECT_EQ(0u, h.max());
+}
+
+TEST(PerfCounters, WriteJson) {
+  PerfCounterRegistry registry;
+  registry.counter("b.count").add(3);
+  registry.counter("a.count").add(4);
+  registry.histogram("c.time_us").record(100);
+
+  std::ostringstream out;
+  registry.write_json(out);
+  std::string json = out.str();
+  EXPECT_NE(std::string::npos, json.find("\"a.count\": 4,\n    \"b.count\": 3"));
+  EXPECT_NE(std::string::npos, json.find("\"c.time_us\": { \"count\": 1, \"sum\": 100, \"max\": 100"));
+  EXPECT_NE(std::string::npos, json.find("\"buckets\": [[127, 1]]"));
+}
+
+TEST(PerfCounters, Dump) {
+  UnlinkName file("perf_counters.json");
+  PerfCounterRegistry registry;
+  registry.counter("test.count").add(42);
+
+  // Without a file, dumping does nothing.
+  registry.dump();
+
+  registry.set_dump(file, 0);
+  registry.finish();
+
+  std::ifstream in(file.c_str());
+  ASSERT_TRUE(in.good());
+  std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  EXPECT_NE(std::string::npos, json.find("\"test.count\": 42"));
+}
+
+TEST(PerfCounters, PeriodicDump) {
+  UnlinkName file("perf_counters_periodic.json");
+  PerfCounterRegistry registry;
+  registry.counter("test.count").add(1);
+  registry.set_dump(file, 1);
+
+  // The dump thread writes the file within a period or so.
+  bool found = false;
+  for (int i = 0; i < 30 && !found; ++i) {
+    Thread::sleep_ms(100);
+    found = std::ifstream(file.c_str()).good();
+  }
+  EXPECT_TRUE(found);
+
+  // Turning dumping off stops the thread.
+  registry.set_dump("", 0);
+}
@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
+#include <test/Helpers.h>
+
+#include <vector>
+
+using namespace vw;
+
+// Reports its share of progress in many small increments.
+class ReportTask {
+  ProgressCallback const& m_progress;
+  int m_count;
+public:
+  ReportTask( ProgressCallback const& progress, int count ) : m_progress(progress), m_count(count) {}
+  void operator()() {
+    SubProgressCallback sub( m_progress, 0, 1 );
+    for (int i = 0; i < m_count; ++i)
+      sub.report_incremental_progress( 1.0 / 8192 );
+  }
+};
+
+TEST(ProgressCallback, Basic) {
+  ProgressCallback pc;
+  EXPECT_EQ(0, pc.progress());
+  pc.report_progress(0.25);
+  EXPECT_EQ(0.25, pc.progress());
+  pc.report_incremental_progress(0.5);
+  EXPECT_EQ(0.75, pc.progress());
+  pc.report_fractional_progress(1, 8);
+  EXPECT_EQ(0.125, pc.progress());
+  pc.report_finished();
+  EXPECT_EQ(1, pc.progress());
+
+  EXPECT_FALSE(pc.abort_requested());
+  pc.request_abort();
+  EXPECT_TRUE(pc.abort_requested());
+  EXPECT_THROW(pc.abort_if_requested(), Aborted);
+
+  ProgressCallback copy(pc);
+  EXPECT_EQ(1, copy.progress());
+  EXPECT_TRUE(copy.abort_requested());
+}
+
+TEST(ProgressCallback, SubProgress) {
+  ProgressCallback pc;
+  SubProgressCallback sub(pc, 0.5, 0.75);
+  sub.report_progress(0.5);
+  EXPECT_EQ(0.625, pc.progress());
+  EXPECT_EQ(0.5, sub.progress());
+  sub.report_incremental_progress(0.5);
+  EXPECT_EQ(0.75, pc.progress());
+  sub.request_abort();
+  EXPECT_TRUE(pc.abort_requested());
+}
+
+TEST(ProgressCallback, Concurrent) {
+  // Increments of a power of two add up exactly, so no update may
+  // be lost.
+  const int num_threads = 8, count = 1024;
+  ProgressCallback pc;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back( boost::shared_ptr<Thread>( new Thread( ReportTask( pc, count ) ) ) );
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->join();
+  EXPECT_EQ(1.0, pc.progress());
+}
+
+TEST(ProgressCallback, Terminal) {
+  const int num_threads = 8, count = 1024;
+  TerminalProgressCallback tpc("test", "Testing: ");
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back( boost::shared_ptr<Thread>( new Thread( ReportTask( tpc, count ) ) ) );
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->join();
+  EXPECT_EQ(1.0, tpc.progress());
+  tpc.report_finished();
+
+  // The callback can be used again after it finishes.
+  tpc.set_progress_text("Again: ");
+  tpc.report_progress(0.5);
+  EXPECT_EQ(0.5, tpc.progress());
+  tpc.report_finished();
+  EXPECT_EQ(1.0, tpc.progress());
+}
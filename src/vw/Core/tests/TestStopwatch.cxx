@@ -0,0 +1,74 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/System.h>
+
+#include <sstream>
+
+using namespace vw;
+
+namespace {
+  size_t count(const std::string &haystack, const std::string &needle) {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos+1))
+      n++;
+    return n;
+  }
+}
+
+TEST(Stopwatch, ScopedWatch) {
+  {
+    ScopedWatch sw("TestStopwatch.ScopedWatch");
+  }
+  Stopwatch sw = stopwatch_get("TestStopwatch.ScopedWatch");
+  EXPECT_EQ(1u, sw.num_stops());
+  EXPECT_FALSE(sw.is_running());
+  ASSERT_TRUE(sw.trace_name() != 0);
+  EXPECT_EQ("TestStopwatch.ScopedWatch", *sw.trace_name());
+
+  // Stopwatches outside a StopwatchSet are not traced
+  EXPECT_TRUE(Stopwatch().trace_name() == 0);
+}
+
+TEST(Stopwatch, Trace) {
+  {
+    // Not recorded
+    ScopedWatch sw("TestStopwatch.Untraced");
+  }
+
+  stopwatch_set_tracing(true);
+  EXPECT_TRUE(stopwatch_tracing());
+  {
+    ScopedWatch outer("TestStopwatch.Outer");
+    for (int i = 0; i < 3; ++i) {
+      ScopedWatch inner("TestStopwatch.\"Inner\"");
+    }
+    // Turning tracing off mid-scope still ends the event
+    stopwatch_set_tracing(false);
+  }
+  EXPECT_FALSE(stopwatch_tracing());
+  {
+    ScopedWatch sw("TestStopwatch.Untraced");
+  }
+
+  std::ostringstream out;
+  stopwatch_write_trace(out);
+  std::string json = out.str();
+
+  EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+  EXPECT_EQ(0u, count(json, "TestStopwatch.Untraced"));
+  EXPECT_EQ(2u, count(json, "\"TestStopwatch.Outer\""));
+  EXPECT_EQ(6u, count(json, "\"TestStopwatch.\\\"Inner\\\"\""));
+  EXPECT_EQ(4u, count(json, "\"ph\":\"B\""));
+  EXPECT_EQ(4u, count(json, "\"ph\":\"E\""));
+  EXPECT_EQ(0u, stopwatch_trace_dropped());
+
+  // Begin events come before their end events
+  EXPECT_LT(json.find("\"ph\":\"B\""), json.find("\"ph\":\"E\""));
+}
@@ -8,6 +8,11 @@
 #include <gtest/gtest.h>
 
 #include <vw/Core/Thread.h>
+#include <vw/Core/Settings.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 using namespace vw;
 
@@ -153,3 +158,30 @@ TEST(Thread, ReaderLock) {
   Mutex::ReadLock lock1(m);
   Mutex::ReadLock lock2(m);
 }
+
+#if defined(__linux__)
+struct PlacedWorker {
+  int& m_cpus;
+  PlacedWorker(int& cpus) : m_cpus(cpus) {}
+  void operator()() {
+    Thread::place_worker(1);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      m_cpus = CPU_COUNT(&set);
+  }
+};
+
+TEST(Thread, PlaceWorker) {
+  EXPECT_FALSE( Thread::set_affinity(std::vector<uint32>()) );
+
+  vw_settings().set_worker_affinity("core");
+  int cpus = 0;
+  {
+    Thread thread( (PlacedWorker(cpus)) );
+    thread.join();
+  }
+  vw_settings().set_worker_affinity("none");
+  EXPECT_EQ( 1, cpus );
+}
+#endif
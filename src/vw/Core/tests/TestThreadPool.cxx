@@ -11,6 +11,8 @@
 
 #include <iostream>
 
+#include <boost/bind.hpp>
+
 using namespace vw;
 
 class TestTask : public Task, private boost::noncopyable {
@@ -212,3 +214,175 @@ TEST(ThreadPool, OrderedWorkQueue) {
 
   queue.join_all();
 }
+
+class CountingTask : public Task, private boost::noncopyable {
+  Atomic<int32> &m_count;
+public:
+  CountingTask(Atomic<int32> &count) : m_count(count) {}
+  void operator()() { ++m_count; }
+};
+
+// Adds more work to the queue from inside a running task.
+class SpawningTask : public Task, private boost::noncopyable {
+  WorkStealingWorkQueue &m_queue;
+  Atomic<int32> &m_count;
+  int m_children;
+public:
+  SpawningTask(WorkStealingWorkQueue &queue, Atomic<int32> &count, int children)
+    : m_queue(queue), m_count(count), m_children(children) {}
+  void operator()() {
+    for (int i = 0; i < m_children; ++i)
+      m_queue.add_task(boost::shared_ptr<Task>(new CountingTask(m_count)));
+    ++m_count;
+  }
+};
+
+TEST(ThreadPool, WorkStealingBasic) {
+  boost::shared_ptr<TestTask> task1 (new TestTask);
+  boost::shared_ptr<TestTask> task2 (new TestTask);
+  ASSERT_EQ( 0, task1->value() );
+  ASSERT_EQ( 0, task2->value() );
+
+  WorkStealingWorkQueue queue(4);
+  EXPECT_EQ( 4, queue.max_threads() );
+  queue.add_task(task1);
+  queue.add_task(task2);
+
+  Thread::sleep_ms(200);
+  EXPECT_EQ( 1, task1->value() );
+  EXPECT_EQ( 1, task2->value() );
+
+  task1->kill();
+  task2->kill();
+  queue.join_all();
+  EXPECT_EQ( 3, task1->value() );
+  EXPECT_EQ( 3, task2->value() );
+  EXPECT_TRUE( task1->is_finished() );
+  EXPECT_EQ( 0u, queue.size() );
+}
+
+TEST(ThreadPool, WorkStealingManyTasks) {
+  Atomic<int32> count(0);
+  WorkStealingWorkQueue queue(8);
+
+  for (int i = 0; i < 2000; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new CountingTask(count)));
+  for (int i = 0; i < 100; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new SpawningTask(queue, count, 10)));
+  queue.join_all();
+  EXPECT_EQ( 2000 + 100*11, count.load() );
+
+  // The queue should be reusable after a join.
+  for (int i = 0; i < 50; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new CountingTask(count)));
+  queue.join_all();
+  EXPECT_EQ( 2000 + 100*11 + 50, count.load() );
+}
+
+// Records the order in which tasks ran.
+class StampTask : public Task, private boost::noncopyable {
+  Atomic<int32> &m_clock;
+  int32 m_stamp;
+public:
+  StampTask(Atomic<int32> &clock) : m_clock(clock), m_stamp(-1) {}
+  void operator()() { Thread::sleep_ms(1); m_stamp = ++m_clock; }
+  int32 stamp() const { return m_stamp; }
+};
+
+TEST(ThreadPool, TaskGraphPipeline) {
+  typedef boost::shared_ptr<StampTask> task_t;
+  const int blocks = 20;
+  Atomic<int32> clock(0);
+  std::vector<task_t> read, process, write;
+
+  TaskGraphWorkQueue queue(4);
+  for (int i = 0; i < blocks; ++i) {
+    read.push_back(task_t(new StampTask(clock)));
+    process.push_back(task_t(new StampTask(clock)));
+    write.push_back(task_t(new StampTask(clock)));
+
+    queue.add_task(read[i]);
+    queue.add_task(process[i], read[i]);
+    // Writes also go out in block order
+    TaskGraphWorkQueue::TaskList deps(1, process[i]);
+    if (i > 0)
+      deps.push_back(write[i-1]);
+    queue.add_task(write[i], deps);
+  }
+  queue.join_all();
+  EXPECT_EQ(0u, queue.size());
+  EXPECT_EQ(3*blocks, clock.load());
+
+  for (int i = 0; i < blocks; ++i) {
+    EXPECT_TRUE(write[i]->is_finished());
+    EXPECT_LT(read[i]->stamp(), process[i]->stamp());
+    EXPECT_LT(process[i]->stamp(), write[i]->stamp());
+    if (i > 0) {
+      EXPECT_LT(write[i-1]->stamp(), write[i]->stamp());
+    }
+  }
+
+  // Finished tasks can still be depended on
+  task_t late(new StampTask(clock));
+  queue.add_task(late, write[blocks-1]);
+  late->join();
+  EXPECT_EQ(3*blocks+1, late->stamp());
+}
+
+TEST(ThreadPool, TaskGraphUnknownDependency) {
+  Atomic<int32> clock(0);
+  boost::shared_ptr<Task> stranger(new StampTask(clock));
+  boost::shared_ptr<Task> task(new StampTask(clock));
+
+  TaskGraphWorkQueue queue(2);
+  EXPECT_THROW(queue.add_task(task, stranger), ArgumentErr);
+  EXPECT_EQ(0u, queue.size());
+  queue.add_task(task);
+  queue.join_all();
+  EXPECT_TRUE(task->is_finished());
+}
+
+static int square( int x ) { return x * x; }
+static int fail( int x ) { vw_throw(ArgumentErr() << "bad " << x); return x; }
+static void add_to( Atomic<int32>* total, int x ) { total->add(x); }
+
+TEST(ThreadPool, SubmitFutures) {
+  FifoWorkQueue queue(4);
+  std::vector<Future<int> > futures;
+  for (int i = 0; i < 20; ++i)
+    futures.push_back( queue.submit(boost::bind(&square, i)) );
+
+  EXPECT_EQ( 49, futures[7].get() );
+  std::vector<int> results = when_all(futures);
+  ASSERT_EQ( 20u, results.size() );
+  for (int i = 0; i < 20; ++i)
+    EXPECT_EQ( i*i, results[i] );
+
+  WorkStealingWorkQueue stealing(4);
+  Atomic<int32> total;
+  std::vector<Future<void> > done;
+  for (int i = 1; i <= 100; ++i)
+    done.push_back( stealing.submit(boost::bind(&add_to, &total, i)) );
+  when_all(done);
+  EXPECT_EQ( 5050, total.load() );
+  EXPECT_TRUE( done.back().is_ready() );
+
+  queue.join_all();
+  stealing.join_all();
+}
+
+TEST(ThreadPool, SubmitRethrows) {
+  FifoWorkQueue queue(2);
+  Future<int> ok  = queue.submit(boost::bind(&square, 3));
+  Future<int> bad = queue.submit(boost::bind(&fail, 3));
+  EXPECT_EQ( 9, ok.get() );
+  EXPECT_THROW( bad.get(), ArgumentErr );
+  // The error stays with the future.
+  EXPECT_THROW( bad.get(), ArgumentErr );
+
+  std::vector<Future<int> > futures;
+  futures.push_back(ok);
+  futures.push_back(bad);
+  EXPECT_THROW( when_all(futures), ArgumentErr );
+  queue.join_all();
+}
@@ -73,3 +73,70 @@ TEST(ThreadQueue, Threaded) {
     EXPECT_EQ(10u, ret[i]);
   }
 }
+
+TEST(BoundedThreadQueue, Basic) {
+  BoundedThreadQueue<uint32> q(50);
+  EXPECT_EQ(64u, q.capacity());
+
+  ASSERT_TRUE(q.empty());
+  for (uint32 i = 0; i < 64; ++i)
+    EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(64));
+  EXPECT_EQ(64u, q.size());
+
+  uint32 pop;
+  for (uint32 i = 0; i < 64; ++i) {
+    ASSERT_FALSE(q.empty());
+    q.wait_pop(pop);
+    EXPECT_EQ(i, pop);
+  }
+  EXPECT_TRUE(q.empty());
+  EXPECT_FALSE(q.try_pop(pop));
+  EXPECT_FALSE(q.timed_wait_pop(pop, 10));
+}
+
+class BoundedPushTask {
+    BoundedThreadQueue<uint32>& m_queue;
+    unsigned m_count, m_value;
+  public:
+    BoundedPushTask(BoundedThreadQueue<uint32>& q, uint32 count, uint32 value) : m_queue(q), m_count(count), m_value(value) {}
+    void operator()() {
+      for (uint32 i = 0; i < m_count; ++i) {
+        m_queue.push(m_value);
+      }
+    }
+};
+
+TEST(BoundedThreadQueue, Threaded) {
+  typedef boost::shared_ptr<BoundedPushTask> TheTask;
+  typedef boost::shared_ptr<vw::Thread>      TheThread;
+
+  // Much smaller than the number of items, so producers have to block.
+  BoundedThreadQueue<uint32> q(8);
+  ASSERT_TRUE(q.empty());
+
+  std::vector<std::pair<TheTask, TheThread> > threads(20);
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    TheTask task(new BoundedPushTask(q, 500, uint32(i)));
+    TheThread thread( new Thread(task) );
+    threads[i] = std::make_pair(task, thread);
+  }
+
+  std::vector<uint32> ret(threads.size());
+  uint32 value = uint32(ret.size())+1;
+  for (size_t i = 0; i < threads.size() * 500; ++i) {
+    q.wait_pop(value);
+    ASSERT_LT(value, ret.size());
+    ret[value]++;
+  }
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].second->join();
+  }
+
+  EXPECT_TRUE(q.empty());
+  for (size_t i = 0; i < ret.size(); ++i) {
+    EXPECT_EQ(500u, ret[i]);
+  }
+}
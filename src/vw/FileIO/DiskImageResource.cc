@@ -19,8 +19,12 @@
 #include <vw/config.h>
 
 #include <iostream>
+#include <fstream>
+#include <cctype>
+#include <cstring>
 #include <set>
 #include <map>
+#include <vector>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/convenience.hpp>
 namespace fs = boost::filesystem;
@@ -31,6 +35,7 @@ namespace fs = boost::filesystem;
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
 
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
 #include <vw/FileIO/DiskImageResourcePNG.h>
@@ -60,8 +65,10 @@ static void register_default_file_types_impl();
 namespace {
   typedef std::map<std::string,vw::DiskImageResource::construct_open_func> OpenMapType;
   typedef std::map<std::string,vw::DiskImageResource::construct_create_func> CreateMapType;
+  typedef std::map<std::string,std::string> TypeMapType;
   OpenMapType *open_map = 0;
   CreateMapType *create_map = 0;
+  TypeMapType *type_map = 0;
 
   // This extra class helps to ensure that register_file_type() is only run once.
   vw::RunOnce rdft_once = VW_RUNONCE_INIT;
@@ -72,13 +79,248 @@ namespace {
   // this one avoids calling the registration function, so it can be called
   // from INSIDE the registration function.
   void register_file_type_internal( std::string const& extension,
-      std::string const& /*disk_image_resource_type*/,
+      std::string const& disk_image_resource_type,
       vw::DiskImageResource::construct_open_func open_func,
       vw::DiskImageResource::construct_create_func create_func ) {
 
     // This will create the entries if they don't exist
     (*open_map)[extension]   = open_func;
     (*create_map)[extension] = create_func;
+    (*type_map)[extension]   = disk_image_resource_type;
+  }
+
+  using vw::uint8;
+  using vw::uint16;
+  using vw::uint32;
+
+  inline uint16 get16( uint8 const* p, bool big ) {
+    return big ? uint16( (p[0] << 8) | p[1] ) : uint16( (p[1] << 8) | p[0] );
+  }
+  inline uint32 get32( uint8 const* p, bool big ) {
+    return big ? ( uint32(p[0]) << 24 | uint32(p[1]) << 16 | uint32(p[2]) << 8 | p[3] )
+               : ( uint32(p[3]) << 24 | uint32(p[2]) << 16 | uint32(p[1]) << 8 | p[0] );
+  }
+
+  // The extension whose driver reads files starting with these bytes,
+  // or an empty string if none is known.
+  std::string sniff_bytes( uint8 const* b, size_t n ) {
+    if( n >= 8 && std::memcmp( b, "\x89PNG\r\n\x1a\n", 8 ) == 0 ) return ".png";
+    if( n >= 3 && b[0] == 0xFF && b[1] == 0xD8 && b[2] == 0xFF )      return ".jpg";
+    if( n >= 4 && ( std::memcmp( b, "II*\0", 4 ) == 0 || std::memcmp( b, "MM\0*", 4 ) == 0 ||
+                    std::memcmp( b, "II+\0", 4 ) == 0 || std::memcmp( b, "MM\0+", 4 ) == 0 ) )
+      return ".tif";
+    if( n >= 4 && std::memcmp( b, "\x76\x2f\x31\x01", 4 ) == 0 )      return ".exr";
+    if( n >= 12 && std::memcmp( b, "\0\0\0\x0cjP  \r\n\x87\n", 12 ) == 0 ) return ".jp2";
+    if( n >= 4 && std::memcmp( b, "\xFF\x4F\xFF\x51", 4 ) == 0 )      return ".j2k";
+    if( n >= 14 && std::memcmp( b, "PDS_VERSION_ID", 14 ) == 0 )      return ".img";
+    if( n >= 7 && std::memcmp( b, "CCSD3ZF", 7 ) == 0 )               return ".img";
+    if( n >= 5 && std::memcmp( b, "VWRAW", 5 ) == 0 )                 return ".vwraw";
+    if( n >= 3 && b[0] == 'P' && b[1] >= '1' && b[1] <= '6' && isspace( b[2] ) ) {
+      static const char* pbm_ext[] = { ".pbm", ".pgm", ".ppm" };
+      return pbm_ext[ (b[1] - '1') % 3 ];
+    }
+    return std::string();
+  }
+
+  std::string sniff_file( std::string const& filename ) {
+    uint8 bytes[16];
+    std::ifstream file( filename.c_str(), std::ios::binary );
+    file.read( reinterpret_cast<char*>(bytes), sizeof(bytes) );
+    return sniff_bytes( bytes, size_t( file.gcount() ) );
+  }
+
+  // The extension of the driver that opens the file: the one its
+  // contents name, if that is registered, and otherwise its own.
+  std::string open_extension( std::string const& filename ) {
+    std::string sniffed = sniff_file( filename );
+    if( ! sniffed.empty() && open_map->find( sniffed ) != open_map->end() )
+      return sniffed;
+    return boost::to_lower_copy( fs::extension( filename ) );
+  }
+
+  // The header parsers below each set format just as their driver's
+  // open() does, or return false to leave it to the driver.
+
+  bool peek_png( std::istream& file, vw::ImageFormat& format ) {
+    uint8 b[8+8+13];
+    if( ! file.read( reinterpret_cast<char*>(b), sizeof(b) ) || std::memcmp( b+12, "IHDR", 4 ) != 0 )
+      return false;
+    uint8 const* ihdr = b + 16;
+    int bit_depth = ihdr[8], color_type = ihdr[9];
+    format.cols = get32( ihdr, true );
+    format.rows = get32( ihdr+4, true );
+    format.planes = 1;
+    format.premultiplied = false;
+    format.channel_type = ( bit_depth == 16 ) ? vw::VW_CHANNEL_UINT16 : vw::VW_CHANNEL_UINT8;
+    switch( color_type ) {
+    case 0: format.pixel_format = vw::VW_PIXEL_GRAY;  break;
+    case 4: format.pixel_format = vw::VW_PIXEL_GRAYA; break;
+    case 2: format.pixel_format = vw::VW_PIXEL_RGB;   break;
+    case 6: format.pixel_format = vw::VW_PIXEL_RGBA;  break;
+    case 3: {
+      // Paletted images gain alpha from a tRNS chunk, which comes
+      // before the image data.
+      format.pixel_format = vw::VW_PIXEL_RGB;
+      file.seekg( 4, std::ios::cur ); // IHDR's CRC
+      uint8 chunk[8];
+      while( file.read( reinterpret_cast<char*>(chunk), 8 ) ) {
+        if( std::memcmp( chunk+4, "tRNS", 4 ) == 0 ) {
+          format.pixel_format = vw::VW_PIXEL_RGBA;
+          break;
+        }
+        if( std::memcmp( chunk+4, "IDAT", 4 ) == 0 )
+          break;
+        file.seekg( std::streamoff( get32( chunk, true ) ) + 4, std::ios::cur );
+      }
+      if( ! file ) return false;
+      break;
+    }
+    default: return false;
+    }
+    return bit_depth <= 16;
+  }
+
+  bool peek_jpeg( std::istream& file, vw::ImageFormat& format ) {
+    file.seekg( 2 );
+    for(;;) {
+      int c = file.get();
+      if( c != 0xFF ) return false;
+      int marker;
+      while( (marker = file.get()) == 0xFF ) {}
+      if( ! file ) return false;
+      if( marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7) ) continue;
+      if( marker == 0xDA || marker == 0xD9 ) return false;
+      uint8 len[2];
+      if( ! file.read( reinterpret_cast<char*>(len), 2 ) ) return false;
+      uint16 length = get16( len, true );
+      // Start-of-frame markers, excepting DHT, JPG and DAC.
+      if( marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC ) {
+        uint8 sof[6];
+        if( ! file.read( reinterpret_cast<char*>(sof), 6 ) || sof[0] != 8 ) return false;
+        format.rows = get16( sof+1, true );
+        format.cols = get16( sof+3, true );
+        if( format.rows == 0 ) return false; // set later, by a DNL marker
+        format.channel_type = vw::VW_CHANNEL_UINT8;
+        format.planes = 1;
+        switch( sof[5] ) {
+        case 1: format.pixel_format = vw::VW_PIXEL_GRAY;  break;
+        case 2: format.pixel_format = vw::VW_PIXEL_GRAYA; break;
+        case 3: format.pixel_format = vw::VW_PIXEL_RGB;   break;
+        case 4: format.pixel_format = vw::VW_PIXEL_RGBA;  break;
+        default:
+          format.pixel_format = vw::VW_PIXEL_SCALAR;
+          format.planes = sof[5];
+        }
+        return true;
+      }
+      file.seekg( length - 2, std::ios::cur );
+    }
+  }
+
+  // Skips whitespace and comments in a Netpbm header.
+  void skip_pbm_space( std::istream& file ) {
+    for(;;) {
+      int c = file.peek();
+      if( c == '#' ) file.ignore( 1<<20, '\n' );
+      else if( isspace( c ) ) file.get();
+      else return;
+    }
+  }
+
+  bool peek_pbm( std::istream& file, vw::ImageFormat& format ) {
+    std::string magic;
+    vw::int32 cols = 0, rows = 0;
+    file >> magic;
+    skip_pbm_space( file );
+    file >> cols;
+    skip_pbm_space( file );
+    file >> rows;
+    if( ! file || cols <= 0 || rows <= 0 || magic.size() != 2 || magic[0] != 'P' ) return false;
+    format.cols = cols;
+    format.rows = rows;
+    format.planes = 1;
+    switch( magic[1] ) {
+    case '1': case '4': format.channel_type = vw::VW_CHANNEL_BOOL;  format.pixel_format = vw::VW_PIXEL_GRAY; break;
+    case '2': case '5': format.channel_type = vw::VW_CHANNEL_UINT8; format.pixel_format = vw::VW_PIXEL_GRAY; break;
+    case '3': case '6': format.channel_type = vw::VW_CHANNEL_UINT8; format.pixel_format = vw::VW_PIXEL_RGB;  break;
+    default: return false;
+    }
+    return true;
+  }
+
+  // Reads the first value of a tag in a classic TIFF's first IFD.
+  bool tiff_tag( std::istream& file, bool big, std::vector<uint8> const& ifd, uint16 tag, uint32& value ) {
+    uint16 count = get16( &ifd[0], big );
+    for( uint16 i = 0; i < count; ++i ) {
+      uint8 const* e = &ifd[2 + 12*i];
+      if( get16( e, big ) != tag ) continue;
+      uint16 type = get16( e+2, big );
+      uint32 n = get32( e+4, big );
+      size_t size = ( type == 3 ) ? 2 : ( type == 4 ) ? 4 : 0;
+      if( size == 0 || n == 0 ) return false;
+      uint8 v[4];
+      if( n * size <= 4 )
+        std::memcpy( v, e+8, 4 );
+      else {
+        file.seekg( get32( e+8, big ) );
+        if( ! file.read( reinterpret_cast<char*>(v), size ) ) return false;
+      }
+      value = ( size == 2 ) ? get16( v, big ) : get32( v, big );
+      return true;
+    }
+    return false;
+  }
+
+  bool peek_tiff( std::istream& file, vw::ImageFormat& format ) {
+    uint8 header[8];
+    if( ! file.read( reinterpret_cast<char*>(header), 8 ) ) return false;
+    bool big = ( header[0] == 'M' );
+    if( get16( header+2, big ) != 42 ) return false; // BigTIFF
+    file.seekg( get32( header+4, big ) );
+    uint8 count[2];
+    if( ! file.read( reinterpret_cast<char*>(count), 2 ) ) return false;
+    std::vector<uint8> ifd( 2 + 12 * size_t( get16( count, big ) ) );
+    std::memcpy( &ifd[0], count, 2 );
+    if( ! file.read( reinterpret_cast<char*>(&ifd[2]), ifd.size()-2 ) ) return false;
+
+    uint32 cols, rows, photometric, samples = 1, bits = 1, sample_format = 1;
+    if( ! tiff_tag( file, big, ifd, 256, cols ) || ! tiff_tag( file, big, ifd, 257, rows ) ||
+        ! tiff_tag( file, big, ifd, 262, photometric ) )
+      return false;
+    tiff_tag( file, big, ifd, 277, samples );
+    tiff_tag( file, big, ifd, 258, bits );
+    tiff_tag( file, big, ifd, 339, sample_format );
+
+    static const vw::ChannelTypeEnum uint_types[] = { vw::VW_CHANNEL_UINT8, vw::VW_CHANNEL_UINT16, vw::VW_CHANNEL_UINT32, vw::VW_CHANNEL_UINT64 };
+    static const vw::ChannelTypeEnum int_types[]  = { vw::VW_CHANNEL_INT8, vw::VW_CHANNEL_INT16, vw::VW_CHANNEL_INT32, vw::VW_CHANNEL_INT64 };
+    static const vw::ChannelTypeEnum float_types[] = { vw::VW_CHANNEL_UNKNOWN, vw::VW_CHANNEL_FLOAT16, vw::VW_CHANNEL_FLOAT32, vw::VW_CHANNEL_FLOAT64 };
+    int size_index = ( bits == 8 ) ? 0 : ( bits == 16 ) ? 1 : ( bits == 32 ) ? 2 : ( bits == 64 ) ? 3 : -1;
+    if( size_index < 0 ) return false;
+    switch( sample_format ) {
+    case 1: format.channel_type = uint_types[size_index];  break;
+    case 2: format.channel_type = int_types[size_index];   break;
+    case 3: format.channel_type = float_types[size_index]; break;
+    default: return false;
+    }
+    if( format.channel_type == vw::VW_CHANNEL_UNKNOWN ) return false;
+
+    format.cols = cols;
+    format.rows = rows;
+    format.planes = 1;
+    if( photometric == 3 ) { // palette
+      format.channel_type = vw::VW_CHANNEL_UINT16;
+      format.pixel_format = vw::VW_PIXEL_RGB;
+    }
+    else switch( samples ) {
+    case 1: format.pixel_format = vw::VW_PIXEL_GRAY;  break;
+    case 2: format.pixel_format = vw::VW_PIXEL_GRAYA; break;
+    case 3: format.pixel_format = vw::VW_PIXEL_RGB;   break;
+    case 4: format.pixel_format = vw::VW_PIXEL_RGBA;  break;
+    default:
+      format.pixel_format = vw::VW_PIXEL_SCALAR;
+      format.planes = samples;
+    }
+    return true;
   }
 }
 
@@ -124,6 +366,7 @@ static void register_default_file_types_impl() {
 
   if( ! open_map ) open_map = new OpenMapType();
   if( ! create_map ) create_map = new CreateMapType();
+  if( ! type_map ) type_map = new TypeMapType();
 
 // Let's cut the verbosity of this func just a bit.
 #define REGISTER(ext, driver) register_file_type_internal( ext, vw::DiskImageResource ## driver::type_static(), &vw::DiskImageResource ## driver::construct_open, &vw::DiskImageResource ## driver::construct_create );
@@ -195,6 +438,7 @@ static void register_default_file_types_impl() {
   REGISTER(".pbm", PBM)
   REGISTER(".pgm", PBM)
   REGISTER(".ppm", PBM)
+  REGISTER(".vwraw", Raw)
 #undef REGISTER
 }
 
@@ -205,7 +449,7 @@ void vw::DiskImageResource::register_default_file_types() {
 
 vw::DiskImageResource* vw::DiskImageResource::open( std::string const& filename ) {
   register_default_file_types_internal();
-  std::string extension = boost::to_lower_copy(fs::extension(filename));
+  std::string extension = open_extension( filename );
 
   if( open_map ) {
     OpenMapType::iterator i = open_map->find( extension );
@@ -230,6 +474,28 @@ vw::DiskImageResource* vw::DiskImageResource::open( std::string const& filename
   return 0; // never reached
 }
 
+std::string vw::DiskImageResource::sniff_extension( std::string const& filename ) {
+  return sniff_file( filename );
+}
+
+vw::ImageFormat vw::DiskImageResource::peek_format( std::string const& filename ) {
+  register_default_file_types_internal();
+  TypeMapType::const_iterator type = type_map->find( open_extension( filename ) );
+  if( type != type_map->end() ) {
+    std::ifstream file( filename.c_str(), std::ios::binary );
+    ImageFormat format;
+    bool parsed = false;
+    if( type->second == "PNG" )       parsed = peek_png( file, format );
+    else if( type->second == "JPEG" ) parsed = peek_jpeg( file, format );
+    else if( type->second == "TIFF" ) parsed = peek_tiff( file, format );
+    else if( type->second == "PBM" )  parsed = peek_pbm( file, format );
+    if( parsed )
+      return format;
+  }
+  boost::scoped_ptr<DiskImageResource> resource( open( filename ) );
+  return resource->format();
+}
+
 /// Returns a disk image resource with the given filename.  The file
 /// type is determined by the value in 'type'.
 vw::DiskImageResource* vw::DiskImageResource::create( std::string const& filename, ImageFormat const& format, std::string const& type ) {
@@ -15,6 +15,9 @@
 #include <set>
 #include <string>
 #include <boost/type_traits.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/format.hpp>
 
@@ -56,8 +59,24 @@ namespace vw {
     ///
     /// Don't forget to delete the DiskImageResource object when
     /// you're finished with it!
+    ///
+    /// The driver is the one registered for the format the file's
+    /// first bytes name (see sniff_extension()), so misnamed files
+    /// open too.  Files it doesn't recognize go by their extension.
     static DiskImageResource* open( std::string const& filename );
 
+    /// Returns the registered extension for the format the first
+    /// bytes of the file name, such as ".png" for a file starting with
+    /// the PNG signature, or an empty string if they name none.
+    static std::string sniff_extension( std::string const& filename );
+
+    /// Returns the format open( filename )->format() would, reading
+    /// only the file's header where it can.  PNG, JPEG, TIFF and
+    /// Netpbm headers are parsed directly when their own drivers are
+    /// the ones registered; other files are opened to ask.  Use this
+    /// to survey many files without the cost of opening each.
+    static ImageFormat peek_format( std::string const& filename );
+
     /// Create a new DiskImageResource of the appropriate type
     /// pointing to a newly-created empty file on disk.
     ///
@@ -104,6 +123,14 @@ namespace vw {
     // TODO: This has always been the default, but it probably shouldn't be.
     virtual void flush() {}
 
+    /// Returns a buffer describing the pixels where they lie in a
+    /// memory mapping of the file, and sets owner to the mapping.
+    /// The pixels stay valid for as long as owner is held.  Drivers
+    /// that cannot map this file as it is, because it is compressed,
+    /// byte-swapped or stored band-sequential, return a buffer with
+    /// null data.  See map_image().
+    virtual ImageBuffer mapped_buffer( boost::shared_ptr<void>& /*owner*/ ) const { return ImageBuffer(); }
+
   protected:
     DiskImageResource( std::string const& filename ) : m_filename(filename), m_rescale(default_rescale) {}
     ImageFormat m_format;
@@ -135,6 +162,59 @@ namespace vw {
   }
 
 
+  /// \cond INTERNAL
+  namespace detail {
+    // Keeps a file mapping alive for as long as an ImageView of its
+    // pixels exists.
+    class MappedPixelsDeleter {
+      boost::shared_ptr<void> m_owner;
+    public:
+      MappedPixelsDeleter( boost::shared_ptr<void> const& owner ) : m_owner(owner) {}
+      template <class T> void operator()( T* ) { m_owner.reset(); }
+    };
+  }
+  /// \endcond
+
+  /// Points image at the pixels of a resource where they lie in a
+  /// memory mapping of its file, with no copy and no conversion.
+  /// This works for drivers that support mapping, when the file
+  /// stores the pixels in native byte order exactly as an ImageView
+  /// of PixelT lays them out.  Otherwise it returns false and leaves
+  /// image alone, and the caller should use read_image() instead.
+  /// Writing to the image changes private copies of the pages, never
+  /// the file.  The resource may be deleted while the image is in use.
+  template <class PixelT>
+  bool map_image( ImageView<PixelT>& image, DiskImageResource const& resource ) {
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    boost::shared_ptr<void> owner;
+    ImageBuffer buf = resource.mapped_buffer( owner );
+    if( ! buf.data ) return false;
+
+    PixelFormatEnum pixel_format = PixelFormatID<PixelT>::value;
+    bool same_layout = buf.format.pixel_format == pixel_format ||
+      ( num_channels( buf.format.pixel_format ) == 1 && num_channels( pixel_format ) == 1 );
+    if( ! same_layout || buf.format.channel_type != ChannelTypeID<channel_type>::value )
+      return false;
+    ssize_t rstride = ssize_t(sizeof(PixelT)) * buf.format.cols;
+    if( buf.cstride != ssize_t(sizeof(PixelT)) || buf.rstride != rstride ||
+        ( buf.format.planes > 1 && buf.pstride != rstride * buf.format.rows ) )
+      return false;
+    if( reinterpret_cast<size_t>( buf.data ) % sizeof(channel_type) != 0 )
+      return false;
+
+    boost::shared_array<PixelT> data( static_cast<PixelT*>( buf.data ), detail::MappedPixelsDeleter( owner ) );
+    image = ImageView<PixelT>( data, buf.format.cols, buf.format.rows, buf.format.planes );
+    return true;
+  }
+
+  /// Maps an image on disk; see map_image() above.
+  template <class PixelT>
+  bool map_image( ImageView<PixelT>& image, std::string const& filename ) {
+    boost::scoped_ptr<DiskImageResource> resource( DiskImageResource::open( filename ) );
+    return map_image( image, *resource );
+  }
+
+
   /// Write an image view to disk.  If you supply a filename with an
   /// asterisk ('*'), each plane of the image will be saved as a
   /// seperate file with the asterisk replaced with the plane number.
@@ -0,0 +1,179 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceCache.cc
+///
+/// Provides the block-compressed scratch files behind DiskCacheImageView.
+///
+
+#include <vw/config.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/FileIO/DiskImageResourceCache.h>
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+#include <zlib.h>
+#endif
+
+using namespace vw;
+
+DiskImageResourceCache::DiskImageResourceCache( std::string const& filename,
+                                                ImageFormat const& format,
+                                                Vector2i const& block_size )
+  : DiskImageResource( filename ), m_file_size( 0 )
+{
+  VW_ASSERT( format.cols > 0 && format.rows > 0 && format.planes > 0,
+             ArgumentErr() << "DiskImageResourceCache: Invalid image size " << format.cols << "x" << format.rows << "." );
+  m_format = format;
+
+  m_file.open( filename.c_str(), std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary );
+  if( !m_file.is_open() )
+    vw_throw( IOErr() << "DiskImageResourceCache: Failed to create \"" << filename << "\"." );
+
+  if( block_size.x() > 0 && block_size.y() > 0 )
+    set_block_write_size( block_size );
+  else
+    set_block_write_size( Vector2i( vw_settings().default_tile_size(), vw_settings().default_tile_size() ) );
+}
+
+void DiskImageResourceCache::set_block_write_size( Vector2i const& block_size ) {
+  VW_ASSERT( block_size.x() > 0 && block_size.y() > 0,
+             ArgumentErr() << "DiskImageResourceCache: Invalid block size " << block_size << "." );
+  VW_ASSERT( m_file_size == 0,
+             LogicErr() << "DiskImageResourceCache: Cannot change the block size after writing." );
+  m_block_size = Vector2i( (std::min)( block_size.x(), int32(m_format.cols) ),
+                           (std::min)( block_size.y(), int32(m_format.rows) ) );
+  m_table_width  = (int32(m_format.cols)-1) / m_block_size.x() + 1;
+  m_table_height = (int32(m_format.rows)-1) / m_block_size.y() + 1;
+  m_index.assign( size_t(m_table_width) * m_table_height, Block() );
+}
+
+BBox2i DiskImageResourceCache::block_bbox( size_t index ) const {
+  BBox2i bbox( int32(index % m_table_width) * m_block_size.x(),
+               int32(index / m_table_width) * m_block_size.y(),
+               m_block_size.x(), m_block_size.y() );
+  bbox.crop( BBox2i( 0, 0, cols(), rows() ) );
+  return bbox;
+}
+
+size_t DiskImageResourceCache::block_index( int32 x, int32 y ) const {
+  return size_t(y / m_block_size.y()) * m_table_width + x / m_block_size.x();
+}
+
+void DiskImageResourceCache::encode_block( ImageBuffer const& src, BBox2i const& bbox,
+                                           std::vector<uint8>& encoded ) const {
+  VW_ASSERT( block_bbox( block_index( bbox.min().x(), bbox.min().y() ) ) == bbox,
+             ArgumentErr() << "DiskImageResourceCache: " << bbox << " is not a block." );
+
+  ImageFormat block_format = m_format;
+  block_format.cols = bbox.width();
+  block_format.rows = bbox.height();
+  std::vector<uint8> block( block_format.byte_size() );
+  convert( ImageBuffer( block_format, &block[0] ), src, m_rescale );
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  uLongf encoded_bytes = compressBound( uLong(block.size()) );
+  encoded.resize( encoded_bytes );
+  int result = compress2( &encoded[0], &encoded_bytes, &block[0], uLong(block.size()), Z_BEST_SPEED );
+  if( result != Z_OK )
+    vw_throw( IOErr() << "DiskImageResourceCache: Failed to compress block " << bbox << " (zlib error " << result << ")." );
+  encoded.resize( encoded_bytes );
+#else
+  encoded.swap( block );
+#endif
+}
+
+void DiskImageResourceCache::write_encoded_block( std::vector<uint8> const& encoded, BBox2i const& bbox ) {
+  VW_ASSERT( !encoded.empty(),
+             ArgumentErr() << "DiskImageResourceCache: Empty encoded block at " << bbox << "." );
+  Mutex::Lock lock( m_file_mutex );
+
+  // Rewriting a block leaves its old bytes behind; the cache is
+  // written once, so that isn't worth reclaiming.
+  Block& block = m_index[ block_index( bbox.min().x(), bbox.min().y() ) ];
+  block.offset = m_file_size;
+  block.size = encoded.size();
+
+  m_file.seekp( std::streamoff(block.offset) );
+  m_file.write( reinterpret_cast<const char*>(&encoded[0]), std::streamsize(encoded.size()) );
+  if( !m_file )
+    vw_throw( IOErr() << "DiskImageResourceCache: Failed to write block " << bbox << " to \"" << m_filename << "\"." );
+  m_file_size += block.size;
+}
+
+void DiskImageResourceCache::write( ImageBuffer const& src, BBox2i const& bbox ) {
+  std::vector<uint8> encoded;
+  encode_block( src, bbox, encoded );
+  write_encoded_block( encoded, bbox );
+}
+
+void DiskImageResourceCache::flush() {
+  Mutex::Lock lock( m_file_mutex );
+  m_file.flush();
+}
+
+void DiskImageResourceCache::decode_block( size_t index, std::vector<uint8>& data ) const {
+  BBox2i bbox = block_bbox( index );
+  ImageFormat block_format = m_format;
+  block_format.cols = bbox.width();
+  block_format.rows = bbox.height();
+  data.resize( block_format.byte_size() );
+
+  Block const& block = m_index[index];
+  if( block.size == 0 ) {
+    // Never written.
+    std::fill( data.begin(), data.end(), uint8(0) );
+    return;
+  }
+
+  std::vector<uint8> encoded( block.size );
+  {
+    Mutex::Lock lock( m_file_mutex );
+    m_file.seekg( std::streamoff(block.offset) );
+    m_file.read( reinterpret_cast<char*>(&encoded[0]), std::streamsize(encoded.size()) );
+    if( !m_file )
+      vw_throw( IOErr() << "DiskImageResourceCache: Failed to read block " << bbox << " from \"" << m_filename << "\"." );
+  }
+
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  uLongf data_bytes = uLongf(data.size());
+  int result = uncompress( &data[0], &data_bytes, &encoded[0], uLong(encoded.size()) );
+  if( result != Z_OK || data_bytes != data.size() )
+    vw_throw( IOErr() << "DiskImageResourceCache: Corrupt block " << bbox << " in \"" << m_filename << "\" (zlib error " << result << ")." );
+#else
+  VW_ASSERT( encoded.size() == data.size(),
+             IOErr() << "DiskImageResourceCache: Corrupt block " << bbox << " in \"" << m_filename << "\"." );
+  data.swap( encoded );
+#endif
+}
+
+void DiskImageResourceCache::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+  VW_ASSERT( dest.format.cols == size_t(bbox.width()) && dest.format.rows == size_t(bbox.height()),
+             ArgumentErr() << "DiskImageResourceCache: Destination buffer has wrong dimensions!" );
+  VW_ASSERT( BBox2i( 0, 0, cols(), rows() ).contains( bbox ),
+             ArgumentErr() << "DiskImageResourceCache: " << bbox << " is outside the image." );
+
+  // Decode each block under bbox and copy out the part that overlaps.
+  std::vector<uint8> data;
+  for( int32 y = bbox.min().y() / m_block_size.y() * m_block_size.y(); y < bbox.max().y(); y += m_block_size.y() ) {
+    for( int32 x = bbox.min().x() / m_block_size.x() * m_block_size.x(); x < bbox.max().x(); x += m_block_size.x() ) {
+      size_t index = block_index( x, y );
+      BBox2i block = block_bbox( index );
+      decode_block( index, data );
+
+      ImageFormat block_format = m_format;
+      block_format.cols = block.width();
+      block_format.rows = block.height();
+
+      BBox2i overlap = block;
+      overlap.crop( bbox );
+      convert( dest.cropped( overlap - bbox.min() ),
+               ImageBuffer( block_format, &data[0] ).cropped( overlap - block.min() ),
+               m_rescale );
+    }
+  }
+}
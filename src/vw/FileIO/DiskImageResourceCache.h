@@ -0,0 +1,95 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceCache.h
+///
+/// A scratch file of compressed blocks, used by DiskCacheImageView to
+/// hold intermediate images.  Each block is compressed on its own
+/// with zlib at its fastest level (stored as is when VW is built
+/// without zlib) and appended to the file, and the resource keeps the
+/// index of where each block went in memory.  The file therefore only
+/// means anything to the resource that wrote it: it is written once
+/// with block_write_image() and then read back through the same
+/// resource, a block at a time and in any order.
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOURCECACHE_H__
+#define __VW_FILEIO_DISKIMAGERESOURCECACHE_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <vw/Core/Thread.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  class DiskImageResourceCache : public DiskImageResource {
+  public:
+
+    /// Creates the file, which must not be read until every block of
+    /// the image has been written.  The block size defaults to the
+    /// tile size.
+    DiskImageResourceCache( std::string const& filename,
+                            ImageFormat const& format,
+                            Vector2i const& block_size = Vector2i(-1,-1) );
+
+    virtual ~DiskImageResourceCache() {}
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "VWCACHE"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+    virtual void write( ImageBuffer const& src, BBox2i const& bbox );
+    virtual void flush();
+
+    virtual bool has_block_write()  const {return true;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read()   const {return true;}
+    virtual bool has_nodata_read()  const {return false;}
+
+    virtual Vector2i block_write_size() const { return m_block_size; }
+    virtual void set_block_write_size( Vector2i const& block_size );
+    virtual Vector2i block_read_size() const { return m_block_size; }
+
+    // Blocks are compressed on the threads that rasterize them.
+    virtual bool has_block_encode() const {return true;}
+    virtual void encode_block( ImageBuffer const& src, BBox2i const& bbox,
+                               std::vector<uint8>& encoded ) const;
+    virtual void write_encoded_block( std::vector<uint8> const& encoded, BBox2i const& bbox );
+
+    /// The bytes written so far, for comparing against the image size.
+    uint64 file_size() const { return m_file_size; }
+
+  private:
+    struct Block {
+      uint64 offset, size; // size is 0 until the block is written
+      Block() : offset(0), size(0) {}
+    };
+
+    // The bounds of the block with the given index, and the index of
+    // the block holding a pixel.
+    BBox2i block_bbox( size_t index ) const;
+    size_t block_index( int32 x, int32 y ) const;
+
+    // The block's pixels, in the native format, in data.
+    void decode_block( size_t index, std::vector<uint8>& data ) const;
+
+    Vector2i m_block_size;
+    int32 m_table_width, m_table_height;
+    std::vector<Block> m_index;
+    uint64 m_file_size;
+    mutable std::fstream m_file;
+    mutable Mutex m_file_mutex;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOURCECACHE_H__
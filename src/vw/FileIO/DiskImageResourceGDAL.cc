@@ -27,6 +27,7 @@
 #include <list>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/PixelTypes.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/convenience.hpp>
@@ -52,6 +53,51 @@ namespace {
     if (x)
       ::GDALClose(x);
   }
+
+  // Averages each 2x2 square of an image of doubles, stored plane by
+  // plane with interleaved channels, halving its size the way GDAL
+  // sizes overviews.  An odd last row or column averages what it has.
+  void halve_image( std::vector<double>& image, vw::int32& cols, vw::int32& rows,
+                    vw::int32 planes, vw::int32 channels ) {
+    using vw::int32;
+    int32 half_cols = (cols+1)/2, half_rows = (rows+1)/2;
+    std::vector<double> half( size_t(half_cols) * half_rows * planes * channels );
+    for ( int32 p = 0; p < planes; ++p ) {
+      const double *src = &image[0] + size_t(p) * cols * rows * channels;
+      double *dst = &half[0] + size_t(p) * half_cols * half_rows * channels;
+      for ( int32 y = 0; y < half_rows; ++y ) {
+        const double *row0 = src + size_t(2*y) * cols * channels;
+        const double *row1 = src + size_t((std::min)(2*y+1, rows-1)) * cols * channels;
+        for ( int32 x = 0; x < half_cols; ++x ) {
+          int32 x0 = 2*x*channels, x1 = (std::min)(2*x+1, cols-1)*channels;
+          for ( int32 c = 0; c < channels; ++c )
+            *dst++ = 0.25 * ( row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] );
+        }
+      }
+    }
+    image.swap( half );
+    cols = half_cols;
+    rows = half_rows;
+  }
+
+  // Writes a region of an image laid out as for halve_image() into
+  // the given overview of every band.  GDAL rounds and clamps the
+  // doubles to the band type.
+  void write_overview_locked( GDALDataset *dataset, int level, std::vector<double>& image,
+                              vw::int32 x, vw::int32 y, vw::int32 cols, vw::int32 rows,
+                              vw::int32 planes, vw::int32 channels ) {
+    for ( vw::int32 p = 0; p < planes; ++p ) {
+      for ( vw::int32 c = 0; c < channels; ++c ) {
+        // Only one of channels or planes will be more than one.
+        GDALRasterBand *band = dataset->GetRasterBand(c+p+1)->GetOverview(level);
+        if ( !band || band->RasterIO( GF_Write, x, y, cols, rows,
+                                      &image[0] + size_t(p) * cols * rows * channels + c,
+                                      cols, rows, GDT_Float64,
+                                      channels * sizeof(double), cols * channels * sizeof(double) ) != CE_None )
+          vw_throw( vw::IOErr() << "DiskImageResourceGDAL: Failed to write overview " << level << "." );
+      }
+    }
+  }
 }
 
 namespace vw {
@@ -190,7 +236,11 @@ namespace vw {
   /// \endcond
 
   DiskImageResourceGDAL::~DiskImageResourceGDAL() {
-    flush();
+    try {
+      flush();
+    } catch ( const Exception& e ) {
+      vw_out(ErrorMessage, "fileio") << "DiskImageResourceGDAL: " << e.what() << std::endl;
+    }
     // Ensure that the read dataset gets destroyed while we're holding
     // the global lock.  (In the unlikely event that the user has
     // retained a reference to it, it's alredy their responsibility to
@@ -330,6 +380,18 @@ namespace vw {
     m_blocksize = block_size;
     m_options = user_options;
 
+    m_cog = false;
+    BOOST_FOREACH( Options::value_type const& i, m_options )
+      if( boost::iequals(i.first, "COG") )
+        m_cog = boost::iequals(i.second, "YES");
+    if( m_cog ) {
+      // Everything is written to a scratch GeoTIFF first, which flush()
+      // copies into the final layout.
+      m_cog_scratch = m_filename + ".vwcog.tif";
+      if( m_blocksize[0] == -1 || m_blocksize[1] == -1 )
+        m_blocksize = Vector2i( vw_settings().default_tile_size(), vw_settings().default_tile_size() );
+    }
+
     Mutex::Lock lock(d::gdal());
     initialize_write_resource_locked();
   }
@@ -353,6 +415,33 @@ namespace vw {
     }
 
     GDALDriver *driver = ret.first;
+    if( m_cog && driver != GetGDALDriverManager()->GetDriverByName("GTiff") )
+      vw_throw( NoImplErr() << "DiskImageResourceGDAL: Cloud-optimized output needs a GeoTIFF, not " << m_filename << "." );
+
+    char **options = creation_options_locked( driver, m_cog );
+    GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(m_format.channel_type);
+
+    std::string const& dataset_filename = m_cog ? m_cog_scratch : m_filename;
+    m_write_dataset_ptr.reset(
+        driver->Create( dataset_filename.c_str(), cols(), rows(), num_bands, gdal_pix_fmt, options ),
+        GDALCloseNullOk);
+    CSLDestroy( options );
+
+    if (m_blocksize[0] == -1 || m_blocksize[1] == -1) {
+      m_blocksize = default_block_size();
+    }
+
+    if( m_cog ) {
+      if( !m_write_dataset_ptr )
+        vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to create " << m_cog_scratch << "." );
+      initialize_cog_locked();
+    }
+  }
+
+  // Builds the GDAL creation options.  The scratch file of a
+  // cloud-optimized GeoTIFF is left uncompressed, since it is read
+  // back once; the user's options apply to the final copy.
+  char **DiskImageResourceGDAL::creation_options_locked( GDALDriver *driver, bool cog_scratch ) const {
     char **options = NULL;
 
     if( m_format.pixel_format == VW_PIXEL_GRAYA || m_format.pixel_format == VW_PIXEL_RGBA ) {
@@ -376,19 +465,139 @@ namespace vw {
       options = CSLSetNameValue( options, "BLOCKYSIZE", y_str.str().c_str() );
     }
 
+    if( cog_scratch ) {
+      options = CSLSetNameValue( options, "BIGTIFF", "IF_NEEDED" );
+      return options;
+    }
+
+    // GTiff can compress blocks on its own worker threads (GDAL 2.1
+    // and later; older versions ignore the option).  Otherwise all the
+    // compression happens serially inside write(), under the GDAL lock.
+    Options::const_iterator compress = m_options.find("COMPRESS");
+    if( driver == GetGDALDriverManager()->GetDriverByName("GTiff") &&
+        compress != m_options.end() && !boost::iequals(compress->second, "NONE") ) {
+      std::ostringstream threads_str;
+      threads_str << vw_settings().default_num_threads();
+      options = CSLSetNameValue( options, "NUM_THREADS", threads_str.str().c_str() );
+    }
+
+    // Copying the overviews along puts them and all the directories
+    // ahead of the full resolution tiles.  BigTIFF is chosen whenever
+    // the file might pass 4GB, unless the user says otherwise.
+    if( m_cog ) {
+      options = CSLSetNameValue( options, "COPY_SRC_OVERVIEWS", "YES" );
+      options = CSLSetNameValue( options, "BIGTIFF", "IF_SAFER" );
+    }
+
     BOOST_FOREACH( Options::value_type const& i, m_options )
-      options = CSLSetNameValue( options, i.first.c_str(), i.second.c_str() );
+      if( !boost::iequals(i.first, "COG") )
+        options = CSLSetNameValue( options, i.first.c_str(), i.second.c_str() );
 
-    GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(m_format.channel_type);
+    return options;
+  }
 
-    m_write_dataset_ptr.reset(
-        driver->Create( m_filename.c_str(), cols(), rows(), num_bands, gdal_pix_fmt, options ),
-        GDALCloseNullOk);
-    CSLDestroy( options );
+  // Adds empty overviews to the scratch file, halving down until the
+  // image fits in one block, and works out how many of them can be
+  // built from each block as it is written.
+  void DiskImageResourceGDAL::initialize_cog_locked() {
+    m_cog_levels = 0;
+    while( (cols()-1)/(1<<m_cog_levels)+1 > m_blocksize[0] ||
+           (rows()-1)/(1<<m_cog_levels)+1 > m_blocksize[1] )
+      ++m_cog_levels;
+    m_cog_block_levels = 0;
+    while( m_cog_block_levels < m_cog_levels &&
+           (2<<m_cog_block_levels) <= (std::min)(m_blocksize[0], m_blocksize[1]) )
+      ++m_cog_block_levels;
+    m_cog_block_aligned = true;
+
+    if( m_cog_levels > 0 ) {
+      std::vector<int> factors( m_cog_levels );
+      for( int32 i = 0; i < m_cog_levels; ++i )
+        factors[i] = 2 << i;
+      if( m_write_dataset_ptr->BuildOverviews( "NONE", m_cog_levels, &factors[0], 0, NULL,
+                                               GDALDummyProgress, NULL ) != CE_None )
+        vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to add overviews to " << m_cog_scratch << "." );
+    }
 
-    if (m_blocksize[0] == -1 || m_blocksize[1] == -1) {
-      m_blocksize = default_block_size();
+    int32 factor = 1 << m_cog_block_levels;
+    m_cog_top.assign( size_t((cols()-1)/factor+1) * ((rows()-1)/factor+1) *
+                      planes() * num_channels(m_format.pixel_format), 0.0 );
+  }
+
+  // Builds the overviews that fall within the block just written.  The
+  // coarsest of them is also kept whole, to build the rest from.
+  void DiskImageResourceGDAL::write_cog_overviews_locked( ImageBuffer const& block, BBox2i const& bbox ) {
+    if( m_cog_levels == 0 || !m_cog_block_aligned )
+      return;
+    int32 factor = 1 << m_cog_block_levels;
+    if( bbox.min().x() % factor || bbox.min().y() % factor ||
+        (bbox.max().x() != cols() && bbox.width() % factor) ||
+        (bbox.max().y() != rows() && bbox.height() % factor) ) {
+      // flush() falls back on resampling the whole scratch file.
+      m_cog_block_aligned = false;
+      return;
     }
+
+    int32 planes = block.format.planes, channels = num_channels(block.format.pixel_format);
+    ImageFormat level_fmt = block.format;
+    level_fmt.channel_type = VW_CHANNEL_FLOAT64;
+    std::vector<double> level( size_t(bbox.width()) * bbox.height() * planes * channels );
+    convert( ImageBuffer(level_fmt, &level[0]), block );
+
+    int32 x = bbox.min().x(), y = bbox.min().y(), w = bbox.width(), h = bbox.height();
+    for( int32 k = 0; k < m_cog_block_levels; ++k ) {
+      halve_image( level, w, h, planes, channels );
+      x /= 2;
+      y /= 2;
+      write_overview_locked( m_write_dataset_ptr.get(), k, level, x, y, w, h, planes, channels );
+    }
+
+    int32 top_cols = (cols()-1)/factor+1, top_rows = (rows()-1)/factor+1;
+    for( int32 p = 0; p < planes; ++p )
+      for( int32 j = 0; j < h; ++j )
+        std::copy( &level[0] + (size_t(p)*h + j) * w * channels,
+                   &level[0] + (size_t(p)*h + j + 1) * w * channels,
+                   &m_cog_top[0] + ((size_t(p)*top_rows + y + j) * top_cols + x) * channels );
+  }
+
+  // Finishes the overviews and copies the scratch file into the final
+  // cloud-optimized layout.
+  void DiskImageResourceGDAL::finish_cog_locked() {
+    int32 planes = m_format.planes, channels = num_channels(m_format.pixel_format);
+    if( m_cog_levels > 0 ) {
+      if( m_cog_block_aligned ) {
+        int32 factor = 1 << m_cog_block_levels;
+        int32 w = (cols()-1)/factor+1, h = (rows()-1)/factor+1;
+        std::vector<double> level( m_cog_top );
+        for( int32 k = m_cog_block_levels; k < m_cog_levels; ++k ) {
+          halve_image( level, w, h, planes, channels );
+          write_overview_locked( m_write_dataset_ptr.get(), k, level, 0, 0, w, h, planes, channels );
+        }
+      } else {
+        vw_out(DebugMessage, "fileio") << "DiskImageResourceGDAL: Writes to " << m_filename
+                                       << " did not follow the blocks; resampling the overviews." << std::endl;
+        std::vector<int> factors( m_cog_levels );
+        for( int32 i = 0; i < m_cog_levels; ++i )
+          factors[i] = 2 << i;
+        if( m_write_dataset_ptr->BuildOverviews( "AVERAGE", m_cog_levels, &factors[0], 0, NULL,
+                                                 GDALDummyProgress, NULL ) != CE_None )
+          vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to build overviews for " << m_filename << "." );
+      }
+    }
+
+    GDALDriver *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+    char **options = creation_options_locked( driver, false );
+    boost::shared_ptr<GDALDataset> cog(
+        driver->CreateCopy( m_filename.c_str(), m_write_dataset_ptr.get(), FALSE, options,
+                            GDALDummyProgress, NULL ),
+        GDALCloseNullOk );
+    CSLDestroy( options );
+    cog.reset();
+    m_write_dataset_ptr.reset();
+    driver->Delete( m_cog_scratch.c_str() );
+    m_cog_top.clear();
+    if( !fs::exists( m_filename ) )
+      vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to write " << m_filename << "." );
   }
 
   Vector2i DiskImageResourceGDAL::default_block_size() {
@@ -415,17 +624,55 @@ namespace vw {
   }
 
   /// Read the disk image into the given buffer.
+  // The overview of band whose size is the image reduced by factor,
+  // or the band itself for a factor of 1.  Returns NULL if there is
+  // no such overview.
+  static GDALRasterBand* reduced_band( GDALRasterBand* band, int32 factor ) {
+    if ( factor == 1 )
+      return band;
+    int32 cols = (band->GetXSize() + factor - 1) / factor;
+    int32 rows = (band->GetYSize() + factor - 1) / factor;
+    for ( int i = 0; i < band->GetOverviewCount(); ++i ) {
+      GDALRasterBand *overview = band->GetOverview(i);
+      if ( overview && overview->GetXSize() == cols && overview->GetYSize() == rows )
+        return overview;
+    }
+    return NULL;
+  }
+
+  int32 DiskImageResourceGDAL::reduced_read_factor( int32 scale ) const
+  {
+    Mutex::Lock lock(d::gdal());
+    GDALRasterBand *band = get_dataset_ptr()->GetRasterBand(1);
+    int32 factor = 1;
+    for ( int32 f = 2; f <= scale; f *= 2 )
+      if ( reduced_band( band, f ) )
+        factor = f;
+    return factor;
+  }
+
   void DiskImageResourceGDAL::read( ImageBuffer const& dest, BBox2i const& bbox ) const
+  {
+    read_reduced( dest, bbox, 1 );
+  }
+
+  void DiskImageResourceGDAL::read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const
   {
     VW_ASSERT( channels() == 1 || planes()==1,
                LogicErr() << "DiskImageResourceGDAL: cannot read an image that has both multiple channels and multiple planes." );
 
-    ImageFormat src_fmt = m_format;
-    src_fmt.cols = bbox.width();
-    src_fmt.rows = bbox.height();
-
-    boost::scoped_array<uint8> src_data(new uint8[src_fmt.byte_size()]);
-    ImageBuffer src(src_fmt, src_data.get());
+    // GDAL takes any strides, so when dest holds the file's own pixels
+    // the bands are read straight into it.
+    bool direct = has_direct_read( dest, bbox );
+    ImageBuffer src = dest;
+    boost::scoped_array<uint8> src_data;
+    if( ! direct ) {
+      ImageFormat src_fmt = m_format;
+      src_fmt.cols = bbox.width();
+      src_fmt.rows = bbox.height();
+      src_data.reset( new uint8[src_fmt.byte_size()] );
+      src = ImageBuffer(src_fmt, src_data.get());
+    }
 
     {
       Mutex::Lock lock(d::gdal());
@@ -436,7 +683,9 @@ namespace vw {
         for ( int32 p = 0; p < planes(); ++p ) {
           for ( int32 c = 0; c < channels(); ++c ) {
             // Only one of channels() or planes() will be nonzero.
-            GDALRasterBand  *band = dataset->GetRasterBand(c+p+1);
+            GDALRasterBand  *band = reduced_band( dataset->GetRasterBand(c+p+1), factor );
+            if ( !band )
+              vw_throw( ArgumentErr() << "DiskImageResourceGDAL: No overview reduced by " << factor << " in " << m_filename << "." );
             GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
             band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
                             (uint8*)src(0,0,p) + channel_size(src.format.channel_type)*c,
@@ -445,7 +694,9 @@ namespace vw {
         }
       }
       else { // palette conversion
-        GDALRasterBand  *band = dataset->GetRasterBand(1);
+        GDALRasterBand  *band = reduced_band( dataset->GetRasterBand(1), factor );
+        if ( !band )
+          vw_throw( ArgumentErr() << "DiskImageResourceGDAL: No overview reduced by " << factor << " in " << m_filename << "." );
         uint8 *index_data = new uint8[bbox.width() * bbox.height()];
         band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
                         index_data, bbox.width(), bbox.height(), GDT_Byte, 1, bbox.width() );
@@ -456,7 +707,13 @@ namespace vw {
       }
     }
 
-    convert( dest, src, m_rescale );
+    if( ! direct )
+      convert( dest, src, m_rescale );
+  }
+
+  bool DiskImageResourceGDAL::has_direct_read( ImageBuffer const& buf, BBox2i const& /*bbox*/ ) const
+  {
+    return m_palette.empty() && convert_is_copy( buf.format, m_format );
   }
 
 
@@ -486,6 +743,9 @@ namespace vw {
                           dst.format.cols, dst.format.rows, gdal_pix_fmt, dst.cstride, dst.rstride );
         }
       }
+
+      if( m_cog )
+        write_cog_overviews_locked( dst, bbox );
     }
   }
 
@@ -510,6 +770,8 @@ namespace vw {
   void DiskImageResourceGDAL::flush() {
     if (m_write_dataset_ptr) {
       Mutex::Lock lock(d::gdal());
+      if (m_cog)
+        finish_cog_locked();
       m_write_dataset_ptr.reset();
     }
   }
@@ -22,6 +22,24 @@
 ///                                   options );
 ///   write_image( resource, image );
 ///
+/// Compressed GeoTIFFs are compressed on default_num_threads() of
+/// GDAL's own threads unless the NUM_THREADS option says otherwise.
+///
+/// Setting the option "COG" to "YES" for a GeoTIFF writes a
+/// cloud-optimized GeoTIFF instead.  The overviews are averaged from
+/// each block as it is written, and flush() copies everything into a
+/// file with the overviews and directories ahead of the full
+/// resolution tiles.  Blocks default to the tile size, and BigTIFF is
+/// chosen when the file might pass 4GB unless BIGTIFF is given.
+///
+///   DiskImageResourceGDAL::Options options;
+///   options["COG"] = "YES";
+///   options["COMPRESS"] = "DEFLATE";
+///   DiskImageResourceGDAL resource( "filename.tif", image.format(),
+///                                   Vector2i(-1,-1), options );
+///   block_write_image( resource, image );
+///   resource.flush();
+///
 #ifndef __VW_FILEIO_DISKIMAGERESOUCEGDAL_H__
 #define __VW_FILEIO_DISKIMAGERESOUCEGDAL_H__
 
@@ -39,6 +57,7 @@
 
 // Forward declarations
 class GDALDataset;
+class GDALDriver;
 namespace vw {
   class Mutex;
 }
@@ -52,7 +71,7 @@ namespace vw {
     typedef std::map<std::string,std::string> Options;
 
     DiskImageResourceGDAL( std::string const& filename )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_cog( false )
     {
       open( filename );
     }
@@ -60,7 +79,7 @@ namespace vw {
     DiskImageResourceGDAL( std::string const& filename,
                            ImageFormat const& format,
                            Vector2i block_size = Vector2i(-1,-1) )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_cog( false )
     {
       create( filename, format, block_size );
     }
@@ -69,7 +88,7 @@ namespace vw {
                            ImageFormat const& format,
                            Vector2i block_size,
                            Options const& options )
-      : DiskImageResource( filename )
+      : DiskImageResource( filename ), m_cog( false )
     {
       create( filename, format, block_size, options );
     }
@@ -100,6 +119,15 @@ namespace vw {
 
     virtual void flush();
 
+    // Reduced reads come from the file's overviews, for each power of
+    // two that has one.
+    virtual int32 reduced_read_factor( int32 scale ) const;
+    virtual void read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const;
+
+    // Unpaletted bands are read straight into buffers of the file's own
+    // pixels, whatever their strides.
+    virtual bool has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const;
+
     // Ask GDAL if it's compiled with support for this file
     static bool gdal_has_support(std::string const& filename);
 
@@ -146,6 +174,10 @@ namespace vw {
 
   private:
     void initialize_write_resource_locked();
+    char **creation_options_locked( GDALDriver *driver, bool cog_scratch ) const;
+    void initialize_cog_locked();
+    void write_cog_overviews_locked( ImageBuffer const& block, BBox2i const& bbox );
+    void finish_cog_locked();
     Vector2i default_block_size();
 
     std::string m_filename;
@@ -154,6 +186,14 @@ namespace vw {
     Vector2i m_blocksize;
     Options m_options;
     boost::shared_ptr<GDALDataset> m_read_dataset_ptr;
+
+    // Cloud-optimized output
+    bool m_cog;
+    std::string m_cog_scratch;
+    int32 m_cog_levels;            // overviews, each half the last
+    int32 m_cog_block_levels;      // overviews built from each block
+    bool m_cog_block_aligned;      // false once a write missed the blocks
+    std::vector<double> m_cog_top; // the coarsest block-built overview
   };
 
   void UnloadGDAL();
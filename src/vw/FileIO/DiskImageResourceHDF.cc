@@ -32,8 +32,12 @@
 #define H4_MAX_NC_NAME MAX_NC_NAME
 #endif
 
+#include <map>
+#include <boost/scoped_array.hpp>
+
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
 
 #include <vw/FileIO/DiskImageResourceHDF.h>
 
@@ -77,12 +81,18 @@ public:
   struct PlaneInfo {
     ::int32 sds;
     ::int32 band;
+    // The SDS's chunk dimensions, or zero if it isn't chunked.
+    ::int32 chunk_bands, chunk_rows, chunk_cols;
   };
 
   DiskImageResourceHDF &resource;
   ::int32 sd_id;
   std::vector<SDSInfo> sds_info;
   std::vector<PlaneInfo> plane_info;
+  // The selected SDSs stay open, by index, so their chunk caches
+  // last from one read to the next.
+  std::map< ::int32, ::int32 > sds_ids;
+  Vector2i chunk_size;
 
   DiskImageResourceInfoHDF( std::string const& filename, DiskImageResourceHDF& resource  ) : resource(resource), sd_id(FAIL) {
 
@@ -149,9 +159,50 @@ public:
   }
 
   ~DiskImageResourceInfoHDF() {
+    end_sds_access();
     if( sd_id != FAIL ) SDend( sd_id );
   }
 
+  void end_sds_access() {
+    for( std::map< ::int32, ::int32 >::const_iterator i = sds_ids.begin(); i != sds_ids.end(); ++i )
+      SDendaccess( i->second );
+    sds_ids.clear();
+  }
+
+  // Opens the SDS for reading, reads its chunking into info, and sets
+  // its chunk cache size.
+  ::int32 access_sds( ::int32 sds, PlaneInfo& info ) {
+    ::int32 sds_id;
+    std::map< ::int32, ::int32 >::const_iterator i = sds_ids.find( sds );
+    if( i != sds_ids.end() )
+      sds_id = i->second;
+    else {
+      if( (sds_id = SDselect( sd_id, sds )) == FAIL )
+        vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+      sds_ids[sds] = sds_id;
+    }
+
+    info.chunk_bands = info.chunk_rows = info.chunk_cols = 0;
+    HDF_CHUNK_DEF chunk_def;
+    ::int32 flags;
+    if( SDgetchunkinfo( sds_id, &chunk_def, &flags ) == FAIL || ! (flags & HDF_CHUNK) )
+      return sds_id;
+    // Every member of HDF_CHUNK_DEF starts with the chunk lengths.
+    ::int32 const* lengths = chunk_def.chunk_lengths;
+    if( sds_info[sds].rank == 3 ) {
+      info.chunk_bands = lengths[0];
+      ++lengths;
+    }
+    else info.chunk_bands = 1;
+    info.chunk_rows = lengths[0];
+    info.chunk_cols = lengths[1];
+
+    ::int32 cache_size = vw_settings().hdf_chunk_cache_size();
+    if( cache_size > 0 && SDsetchunkcache( sds_id, cache_size, 0 ) == FAIL )
+      vw_throw( IOErr() << "Unable to set the SDS chunk cache size in HDF file \"" << resource.filename() << "\"!" );
+    return sds_id;
+  }
+
   vw::DiskImageResourceHDF::sds_iterator sds_begin() const {
     return sds_info.begin();
   }
@@ -206,6 +257,13 @@ public:
       if( sds == sds_info.size() )
         vw_throw( IOErr() << "Requested SDS not found in HDF file \"" << resource.filename() << "\"!" );
     }
+    end_sds_access();
+    for( unsigned plane=0; plane<new_plane_info.size(); ++plane )
+      access_sds( new_plane_info[plane].sds, new_plane_info[plane] );
+    chunk_size = Vector2i( new_plane_info[0].chunk_cols, new_plane_info[0].chunk_rows );
+    if( chunk_size.x() > 0 )
+      vw_out(VerboseDebugMessage, "fileio") << "Chunked " << chunk_size.x() << "x" << chunk_size.y() << std::endl;
+
     ImageFormat new_format;
     new_format.channel_type = data_type;
     new_format.cols = cols;
@@ -237,38 +295,33 @@ public:
     return ImageFormat();
   }
 
-  void read( ImageBuffer &dstbuf, BBox2i const& bbox ) const {
-    boost::scoped_array<uint8> buffer( new uint8[ bbox.width() * bbox.height() * resource.planes() * channel_size( resource.channel_type() ) ] );
-    dstbuf.data = buffer.get();
-    dstbuf.format.cols = bbox.width();
-    dstbuf.format.rows = bbox.height();
-    dstbuf.format.planes = resource.planes();
-    dstbuf.format.channel_type = resource.channel_type();
-    dstbuf.format.pixel_format = VW_PIXEL_SCALAR;
-    dstbuf.cstride = channel_size( dstbuf.format.channel_type );
-    dstbuf.rstride = dstbuf.cstride * bbox.width();
-    dstbuf.pstride = dstbuf.rstride * bbox.height();
+  // Reads into dstbuf, which holds the selected planes' pixels packed
+  // tightly, as SDreaddata() writes them.
+  void read( ImageBuffer const& dstbuf, BBox2i const& bbox ) const {
     // For each requested plane...
     for( uint32 p=0; p<uint32(dstbuf.format.planes); ++p ) {
-      // Select the SDS
-      ::int32 sds_id = SDselect( sd_id, plane_info[p].sds );
-      if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
-
-      if( sds_info[plane_info[p].sds].rank == 2 ) {
-        ::int32 start[2] = { bbox.min().y(), bbox.min().x() };
-        ::int32 edges[2] = { bbox.height(), bbox.width() };
-        if ( SDreaddata( sds_id, start, NULL, edges, (uint8*)dstbuf.data + p*dstbuf.pstride ) == FAIL )
-          vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
+      PlaneInfo const& info = plane_info[p];
+      ::int32 sds_id = sds_ids.find( info.sds )->second;
+      uint8 *data = (uint8*)dstbuf.data + p*dstbuf.pstride;
+      ::int32 rank = sds_info[info.sds].rank;
+      if( rank != 2 && rank != 3 )
+        vw_throw( IOErr() << "Invalid SDS rank in HDF file \"" << resource.filename() << "\"!" );
+
+      // A region that is exactly one chunk, of one band, is read as
+      // that chunk, skipping the hyperslab machinery and chunk cache.
+      if( info.chunk_cols > 0 && info.chunk_bands == 1 &&
+          bbox.width() == info.chunk_cols && bbox.height() == info.chunk_rows &&
+          bbox.min().x() % info.chunk_cols == 0 && bbox.min().y() % info.chunk_rows == 0 ) {
+        ::int32 origin[3] = { info.band, bbox.min().y() / info.chunk_rows, bbox.min().x() / info.chunk_cols };
+        if( SDreadchunk( sds_id, rank == 3 ? origin : origin+1, data ) == FAIL )
+          vw_throw( IOErr() << "Unable to read chunk from HDF file \"" << resource.filename() << "\"!" );
+        continue;
       }
-      else if( sds_info[plane_info[p].sds].rank == 3 ) {
-        ::int32 start[3] = { plane_info[p].band,   bbox.min().y(), bbox.min().x() };
-        ::int32 edges[3] = { 1, bbox.height(), bbox.width() };
-        if ( SDreaddata( sds_id, start, NULL, edges, (uint8*)dstbuf.data + p*dstbuf.pstride ) == FAIL )
-          vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
-      }
-      else vw_throw( IOErr() << "Invalid SDS rank in HDF file \"" << resource.filename() << "\"!" );
 
-      SDendaccess( sds_id );
+      ::int32 start[3] = { info.band, bbox.min().y(), bbox.min().x() };
+      ::int32 edges[3] = { 1, bbox.height(), bbox.width() };
+      if ( SDreaddata( sds_id, rank == 3 ? start : start+1, NULL, rank == 3 ? edges : edges+1, data ) == FAIL )
+        vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
     }
   }
 
@@ -559,11 +612,35 @@ vw::DiskImageResource* vw::DiskImageResourceHDF::construct_open( std::string con
 }
 
 void vw::DiskImageResourceHDF::read( ImageBuffer const& dstbuf, BBox2i const& bbox ) const {
-  ImageBuffer srcbuf;
+  if( has_direct_read( dstbuf, bbox ) ) {
+    m_info->read( dstbuf, bbox );
+    return;
+  }
+  ImageFormat format = m_format;
+  format.cols = bbox.width();
+  format.rows = bbox.height();
+  boost::scoped_array<uint8> data( new uint8[ format.byte_size() ] );
+  ImageBuffer srcbuf( format, data.get() );
   m_info->read( srcbuf, bbox );
   convert( dstbuf, srcbuf, m_rescale );
 }
 
+bool vw::DiskImageResourceHDF::has_direct_read( ImageBuffer const& buf, BBox2i const& /*bbox*/ ) const {
+  ptrdiff_t cstride = channel_size( m_format.channel_type );
+  return convert_is_copy( buf.format, m_format ) && buf.cstride == cstride &&
+    buf.rstride == cstride * buf.format.cols && buf.pstride == buf.rstride * buf.format.rows;
+}
+
+bool vw::DiskImageResourceHDF::has_block_read() const {
+  return m_info->chunk_size.x() > 0;
+}
+
+vw::Vector2i vw::DiskImageResourceHDF::block_read_size() const {
+  if( m_info->chunk_size.x() > 0 )
+    return m_info->chunk_size;
+  return DiskImageResource::block_read_size();
+}
+
 vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_begin() const {
   return m_info->sds_begin();
 }
@@ -56,9 +56,18 @@ namespace vw {
 
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read()   const {return false;}
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Chunked SDSs are read a chunk at a time, taking the chunk
+    /// dimensions of the first selected plane.  Whole chunks are read
+    /// with SDreadchunk(), and other regions as hyperslabs.
+    virtual bool has_block_read() const;
+    virtual Vector2i block_read_size() const;
+
+    /// Planes are read straight into buffers of the SDS's channel type
+    /// whose pixels and planes are packed tightly.
+    virtual bool has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const;
+
     // The HDF-specific interface:
 
     struct SDSInfo {
@@ -323,6 +323,29 @@ void DiskImageResourceJPEG::read( ImageBuffer const& dest, BBox2i const& bbox) c
 
 }
 
+int32 DiskImageResourceJPEG::reduced_read_factor( int32 scale ) const {
+  int32 factor = 1;
+  while ( 2*factor <= scale && 2*factor*m_subsample_factor <= 8 )
+    factor *= 2;
+  return factor;
+}
+
+void DiskImageResourceJPEG::read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const
+{
+  if ( factor == 1 ) {
+    read( dest, bbox );
+    return;
+  }
+  VW_ASSERT( reduced_read_factor(factor) == factor,
+             ArgumentErr() << "DiskImageResourceJPEG: Cannot read reduced by " << factor << "." );
+
+  if ( !m_reduced || m_reduced->m_subsample_factor != factor*m_subsample_factor ) {
+    m_reduced.reset( new DiskImageResourceJPEG( m_filename, factor*m_subsample_factor, m_byte_offset ) );
+    m_reduced->set_rescale( m_rescale );
+  }
+  m_reduced->read( dest, bbox );
+}
+
 void DiskImageResourceJPEG::read_reset() const {
   ctx = boost::shared_ptr<DiskImageResourceJPEG::vw_jpeg_decompress_context>(new DiskImageResourceJPEG::vw_jpeg_decompress_context(const_cast<DiskImageResourceJPEG*>(this)));
 }
@@ -102,6 +102,11 @@ namespace vw {
     virtual bool has_block_read()   const {return false;}
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Reduced reads use libjpeg's DCT scaling, so they can go down
+    /// to 1/8 of the full size, counting the subsample factor.
+    virtual int32 reduced_read_factor( int32 scale ) const;
+    virtual void read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const;
+
   private:
     // Forward declare an abstraction class that contains jpeg stuff.
     class vw_jpeg_decompress_context;
@@ -127,6 +132,11 @@ namespace vw {
     */
     mutable boost::shared_ptr<vw_jpeg_decompress_context> ctx;
 
+    /* The file opened again at the last reduced size read, so that
+     * reading it a few lines at a time stays sequential.
+    */
+    mutable boost::shared_ptr<DiskImageResourceJPEG> m_reduced;
+
     /* Resets the decompression context and current point in the file to
      * the beginning.
     */
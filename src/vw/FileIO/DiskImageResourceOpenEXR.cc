@@ -28,8 +28,11 @@
 #include <ImfArray.h>
 #include <ImfLineOrder.h>
 #include <ImfChannelList.h>
+#include <ImfThreading.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/Statistics.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
@@ -66,6 +69,18 @@ namespace {
 
   }
 
+  // OpenEXR (de)compresses the lines or tiles of a file on a global
+  // pool of threads.  This sizes the pool to default_num_threads() and
+  // returns the number of threads to give each file.
+  int openexr_num_threads() {
+    static vw::Mutex pool_mutex;
+    int threads = vw::vw_settings().default_num_threads();
+    vw::Mutex::Lock lock(pool_mutex);
+    if (Imf::globalThreadCount() != threads)
+      Imf::setGlobalThreadCount(threads);
+    return threads;
+  }
+
 }
 
 
@@ -108,12 +123,12 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     if (m_input_file_ptr)
       vw_throw( IOErr() << "Disk image resources do not yet support reuse." );
 
-    m_input_file_ptr = new Imf::InputFile(filename.c_str());
+    m_input_file_ptr = new Imf::InputFile(filename.c_str(), openexr_num_threads());
 
     // Check to see if the file is tiled.  If it does, close the descriptor and reopen as a tiled file.
     if (reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().hasTileDescription()) {
       delete reinterpret_cast<Imf::InputFile*>(m_input_file_ptr);
-      m_input_file_ptr = new Imf::TiledInputFile(filename.c_str());
+      m_input_file_ptr = new Imf::TiledInputFile(filename.c_str(), openexr_num_threads());
       m_tiled = true;
     } else {
       m_tiled = false;
@@ -184,7 +199,7 @@ void vw::DiskImageResourceOpenEXR::set_tiled_write(int32 tile_width, int32 tile_
     if (random_tile_order)
       header.lineOrder() = Imf::RANDOM_Y;
 
-    m_output_file_ptr = new Imf::TiledOutputFile(m_filename.c_str(), header);
+    m_output_file_ptr = new Imf::TiledOutputFile(m_filename.c_str(), header, openexr_num_threads());
   } catch (const Iex::BaseExc& e) {
     vw_throw( vw::IOErr() << "DiskImageResourceOpenEXR: Failed to create " << m_filename << ".\n\t" << e.what() );
   }
@@ -220,7 +235,7 @@ void vw::DiskImageResourceOpenEXR::set_scanline_write(int32 scanlines_per_block)
     header.lineOrder() = Imf::INCREASING_Y;
 
     m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
-    m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header);
+    m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header, openexr_num_threads());
 
   } catch (const Iex::BaseExc& e) {
     vw_throw( vw::IOErr() << "DiskImageResourceOpenEXR: Failed to create " << m_filename << ".\n\t" << e.what() );
@@ -9,6 +9,9 @@
 ///
 /// Provides support for the OpenEXR file format.
 ///
+/// Lines and tiles are compressed and decompressed on
+/// default_num_threads() of OpenEXR's own threads.
+///
 #ifndef __VW_FILEIO_DISKIMAGERESOUCEOPENEXR_H__
 #define __VW_FILEIO_DISKIMAGERESOUCEOPENEXR_H__
 
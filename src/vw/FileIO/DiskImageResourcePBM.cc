@@ -27,6 +27,7 @@ using namespace boost;
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
+#include <vw/FileIO/MappedFile.h>
 
 using namespace vw;
 using std::fstream;
@@ -148,6 +149,15 @@ void DiskImageResourcePBM::read( ImageBuffer const& dest, BBox2i const& bbox )
   VW_ASSERT( dest.format.cols==uint32(cols()) && dest.format.rows==uint32(rows()),
              IOErr() << "Buffer has wrong dimensions in PBM read." );
 
+  // Files that need no normalizing are converted straight out of a
+  // mapping, with no intermediate copy.
+  boost::shared_ptr<void> mapping;
+  ImageBuffer mapped = mapped_buffer( mapping );
+  if( mapped.data ) {
+    convert( dest, mapped, m_rescale );
+    return;
+  }
+
   ifstream input(m_filename.c_str(), fstream::in|fstream::binary);
 
   if (!input.is_open())
@@ -184,6 +194,22 @@ void DiskImageResourcePBM::read( ImageBuffer const& dest, BBox2i const& bbox )
   convert( dest, src, m_rescale );
 }
 
+ImageBuffer DiskImageResourcePBM::mapped_buffer( boost::shared_ptr<void>& owner ) const {
+  if ( !( m_magic == "P5" || m_magic == "P6" ) || m_max_value != 255 || !MappedFile::supported() )
+    return ImageBuffer();
+  boost::shared_ptr<MappedFile> map;
+  try {
+    map.reset( new MappedFile( m_filename ) );
+  } catch ( IOErr const& ) {
+    return ImageBuffer();
+  }
+  size_t offset = size_t( std::streamoff( m_image_data_position ) );
+  if ( map->size() < offset + m_format.byte_size() )
+    return ImageBuffer();
+  owner = map;
+  return ImageBuffer( m_format, map->data() + offset );
+}
+
 // Bind the resource to a file for writing.
 void DiskImageResourcePBM::create( std::string const& filename,
                                    ImageFormat const& format ) {
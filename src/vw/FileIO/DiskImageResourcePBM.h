@@ -46,6 +46,9 @@ namespace vw {
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
     virtual void flush() {}
 
+    // Maps binary graymaps and pixmaps with a maximum value of 255.
+    virtual ImageBuffer mapped_buffer( boost::shared_ptr<void>& owner ) const;
+
     void open( std::string const& filename );
 
     void create( std::string const& filename,
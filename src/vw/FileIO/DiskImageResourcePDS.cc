@@ -24,6 +24,7 @@ using namespace boost;
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
+#include <vw/FileIO/MappedFile.h>
 
 
 static bool cpu_is_big_endian() {
@@ -255,85 +256,93 @@ void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox
   VW_ASSERT( dest.format.cols==uint32(cols()) && dest.format.rows==uint32(rows()),
              IOErr() << "Buffer has wrong dimensions in PDS read." );
 
-  // Re-open the file, and shift the file offset to the position of
-  // the first image byte (as indicated by the PDS header).  Some PDS
-  // files will have the actual data in a seperate file that is
-  // pointed to by the PDS image header, so we may actually be opening
-  // that file here instead of the original file that the user
-  // specified.
-  //
-  // NOTE: The filename encoded in the ^IMAGE tag seems to sometimes
-  // differ in case from the actual data file, so we try a few
-  // different combinations here.
-  std::ifstream image_file(m_pds_data_filename.c_str(), std::ios::in | std::ios::binary);
-  if (image_file.bad()) {
-    image_file.open(boost::to_lower_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
+  // Samples that need no reordering are converted straight out of a
+  // mapping, with no intermediate copy.
+  boost::shared_ptr<void> mapping;
+  ImageBuffer src = mapped_buffer( mapping );
+  uint8* image_data = 0;
+  if ( ! src.data ) {
+    // Re-open the file, and shift the file offset to the position of
+    // the first image byte (as indicated by the PDS header).  Some PDS
+    // files will have the actual data in a seperate file that is
+    // pointed to by the PDS image header, so we may actually be opening
+    // that file here instead of the original file that the user
+    // specified.
+    //
+    // NOTE: The filename encoded in the ^IMAGE tag seems to sometimes
+    // differ in case from the actual data file, so we try a few
+    // different combinations here.
+    std::ifstream image_file(m_pds_data_filename.c_str(), std::ios::in | std::ios::binary);
     if (image_file.bad()) {
-      image_file.open(boost::to_upper_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
+      image_file.open(boost::to_lower_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
       if (image_file.bad()) {
-        vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
-                  << DiskImageResource::m_filename << "\"." );
+        image_file.open(boost::to_upper_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
+        if (image_file.bad()) {
+          vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
+                    << DiskImageResource::m_filename << "\"." );
+        }
       }
     }
-  }
-  image_file.seekg(m_image_data_offset, std::ios::beg);
-
-  // Grab the pixel data from the file.
-  unsigned total_pixels = (unsigned)( m_format.cols * m_format.rows * m_format.planes );
-  unsigned bytes_per_pixel = 1;
-  if ( m_format.channel_type == VW_CHANNEL_UINT16 ||
-       m_format.channel_type == VW_CHANNEL_INT16 ) {
-    bytes_per_pixel = 2;
-  }
-  else if ( ! ( m_format.channel_type == VW_CHANNEL_UINT8 ||
-                m_format.channel_type == VW_CHANNEL_INT8 ) ) {
-    vw_throw( IOErr() << "DiskImageResourcePDS: Unsupported channel type (" << m_format.channel_type << ")." );
-  }
-  bytes_per_pixel *= num_channels(m_format.pixel_format);
-  uint8* image_data = new uint8[total_pixels * bytes_per_pixel];
-  image_file.read((char*)image_data, bytes_per_pixel*total_pixels);
-
-  if (image_file.bad())
-    vw_throw(IOErr() << "DiskImageResourcePDS: an unrecoverable error occured while reading the image data.");
-
-  // Convert the endian-ness of the data if the architecture of the
-  // machine and the endianness of the file do not match.
-  if (m_format.channel_type == VW_CHANNEL_INT16 ||
-      m_format.channel_type == VW_CHANNEL_UINT16) {
-    if ((cpu_is_big_endian() && !m_file_is_msb_first) ||
-        (!cpu_is_big_endian() && m_file_is_msb_first) ) {
-      for ( unsigned i=0; i<total_pixels*bytes_per_pixel; i+=2 ) {
-        uint8 temp = image_data[i+1];
-        image_data[i+1] = image_data[i];
-        image_data[i] = temp;
+    image_file.seekg(m_image_data_offset, std::ios::beg);
+
+    // Grab the pixel data from the file.
+    unsigned total_pixels = (unsigned)( m_format.cols * m_format.rows * m_format.planes );
+    unsigned bytes_per_pixel = 1;
+    if ( m_format.channel_type == VW_CHANNEL_UINT16 ||
+         m_format.channel_type == VW_CHANNEL_INT16 ) {
+      bytes_per_pixel = 2;
+    }
+    else if ( ! ( m_format.channel_type == VW_CHANNEL_UINT8 ||
+                  m_format.channel_type == VW_CHANNEL_INT8 ) ) {
+      vw_throw( IOErr() << "DiskImageResourcePDS: Unsupported channel type (" << m_format.channel_type << ")." );
+    }
+    bytes_per_pixel *= num_channels(m_format.pixel_format);
+    image_data = new uint8[total_pixels * bytes_per_pixel];
+    image_file.read((char*)image_data, bytes_per_pixel*total_pixels);
+
+    if (image_file.bad())
+      vw_throw(IOErr() << "DiskImageResourcePDS: an unrecoverable error occured while reading the image data.");
+
+    // Convert the endian-ness of the data if the architecture of the
+    // machine and the endianness of the file do not match.
+    if (m_format.channel_type == VW_CHANNEL_INT16 ||
+        m_format.channel_type == VW_CHANNEL_UINT16) {
+      if ((cpu_is_big_endian() && !m_file_is_msb_first) ||
+          (!cpu_is_big_endian() && m_file_is_msb_first) ) {
+        for ( unsigned i=0; i<total_pixels*bytes_per_pixel; i+=2 ) {
+          uint8 temp = image_data[i+1];
+          image_data[i+1] = image_data[i];
+          image_data[i] = temp;
+        }
       }
     }
-  }
 
-  // For band sequential images, we must copy the data over into
-  // interleaved format.
-  if ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR) {
-    uint8* intermediate_data = new uint8[total_pixels * bytes_per_pixel];
-    int n_channels = num_channels(m_format.pixel_format);
-    int n_pixels = m_format.cols * m_format.rows;
-    for (int n = 0; n < n_channels; ++n) {
-      for (int p = 0; p < n_pixels; ++p) {
-        intermediate_data[n_channels*p+n] = image_data[n_pixels*n+p];
+    // For band sequential images, we must copy the data over into
+    // interleaved format.
+    if ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR) {
+      uint8* intermediate_data = new uint8[total_pixels * bytes_per_pixel];
+      int n_channels = num_channels(m_format.pixel_format);
+      int n_pixels = m_format.cols * m_format.rows;
+      for (int n = 0; n < n_channels; ++n) {
+        for (int p = 0; p < n_pixels; ++p) {
+          intermediate_data[n_channels*p+n] = image_data[n_pixels*n+p];
+        }
       }
+      // Swap over to the new image buffer
+      uint8* temporary_ptr = image_data;
+      image_data = intermediate_data;
+      delete[] temporary_ptr;
     }
-    // Swap over to the new image buffer
-    uint8* temporary_ptr = image_data;
-    image_data = intermediate_data;
-    delete[] temporary_ptr;
+
+    // set up an image buffer around the PDS data.
+    src.data = image_data;
+    src.format = m_format;
+    src.cstride = bytes_per_pixel;
+    src.rstride = bytes_per_pixel * m_format.cols;
+    src.pstride = bytes_per_pixel * m_format.cols * m_format.rows;
+    image_file.close();
   }
 
-  // set up an image buffer around the PDS data.
-  ImageBuffer src;
-  src.data = image_data;
-  src.format = m_format;
-  src.cstride = bytes_per_pixel;
-  src.rstride = bytes_per_pixel * m_format.cols;
-  src.pstride = bytes_per_pixel * m_format.cols * m_format.rows;
   convert( dest, src, m_rescale );
 
   if ( m_invalid_as_alpha ) {
@@ -366,7 +375,35 @@ void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox
   }
 
   delete[] image_data;
-  image_file.close();
+}
+
+vw::ImageBuffer vw::DiskImageResourcePDS::mapped_buffer( boost::shared_ptr<void>& owner ) const
+{
+  unsigned bytes_per_channel = channel_size_nothrow( m_format.channel_type );
+  if ( bytes_per_channel == 0 || m_image_data_offset < 0 )
+    return ImageBuffer();
+  if ( bytes_per_channel == 2 && cpu_is_big_endian() != m_file_is_msb_first )
+    return ImageBuffer();
+  if ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR )
+    return ImageBuffer();
+  if ( m_image_data_offset % bytes_per_channel != 0 || ! MappedFile::supported() )
+    return ImageBuffer();
+
+  // As in read(), the data file name may differ in case from the label.
+  std::string names[3] = { m_pds_data_filename,
+                           boost::to_lower_copy(m_pds_data_filename),
+                           boost::to_upper_copy(m_pds_data_filename) };
+  if ( m_pds_data_filename.empty() ) names[0] = names[1] = names[2] = m_filename;
+  boost::shared_ptr<MappedFile> map;
+  for ( int i = 0; i < 3 && ! map; ++i ) {
+    try {
+      map.reset( new MappedFile( names[i] ) );
+    } catch ( IOErr const& ) {}
+  }
+  if ( ! map || map->size() < size_t(m_image_data_offset) + m_format.byte_size() )
+    return ImageBuffer();
+  owner = map;
+  return ImageBuffer( m_format, map->data() + m_image_data_offset );
 }
 
 // Write the given buffer into the disk image.
@@ -52,6 +52,10 @@ namespace vw {
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
     virtual void flush() {}
 
+    /// Maps images whose samples are in native byte order and, for
+    /// multi-channel images, interleaved.
+    virtual ImageBuffer mapped_buffer( boost::shared_ptr<void>& owner ) const;
+
     /// Query for a string value in the PDS header.  Places the value
     /// in the result field and returns true if the value is found,
     /// otherwise returns false.
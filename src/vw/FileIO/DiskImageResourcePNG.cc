@@ -19,6 +19,7 @@
 #endif
 
 #include <vw/FileIO/DiskImageResourcePNG.h>
+#include <vw/FileIO/PngIO.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Exception.h>
 #include <vw/Image/Manipulation.h>
@@ -286,14 +287,27 @@ struct DiskImageResourcePNG::vw_png_read_context:
     current_line++;
   }
 
+  // Reads the next line straight into row, which holds a whole line.
+  void readline(uint8 *row)
+  {
+    png_read_row(ctx.ptr, static_cast<png_bytep>(row), NULL);
+    current_line++;
+  }
+
   void readall(boost::scoped_array<uint8> &dst)
+  {
+    readall(dst.get(), outer->m_format.cols * cstride);
+  }
+
+  // Reads the entire image into rows rstride bytes apart.
+  void readall(uint8 *dst, ptrdiff_t rstride)
   {
     if(current_line != 0)
       vw_throw(IOErr() << "DiskImageResourcePNG: cannot read entire file unless line marker set at beginning.");
 
     boost::scoped_array<png_bytep> row_pointers( new png_bytep[outer->m_format.rows] );
     for(size_t i=0; i < outer->m_format.rows; i++)
-      row_pointers[i] = static_cast<png_bytep>(dst.get()) + i * outer->m_format.cols * cstride;
+      row_pointers[i] = static_cast<png_bytep>(dst) + i * rstride;
     png_read_image(ctx.ptr, row_pointers.get());
     current_line = outer->m_format.rows;
   }
@@ -370,9 +384,16 @@ struct DiskImageResourcePNG::vw_png_write_context:
   public DiskImageResourcePNG::vw_png_context
 {
   png_context_t ctx;
+  int compression_level;
+  bool parallel; // deflate on several threads
+  bool interlaced;
+  int32 next_row; // the first row not yet written by write_rows()
 
   vw_png_write_context(DiskImageResourcePNG *outer, const DiskImageResourcePNG::Options &options):
-    vw_png_context(outer), ctx(outer->m_filename.c_str(), png_context_t::PNG_WRITE)
+    vw_png_context(outer), ctx(outer->m_filename.c_str(), png_context_t::PNG_WRITE),
+    compression_level(options.compression_level),
+    parallel(!options.using_interlace && !options.using_palette),
+    interlaced(options.using_interlace), next_row(0)
   {
     // Set some needed values.
     int width     = outer->m_format.cols;
@@ -465,6 +486,10 @@ struct DiskImageResourcePNG::vw_png_write_context:
   // to the file. Closing happens when the context is destroyed.
   void write(const ImageBuffer &buf) const
   {
+    if (parallel && fileio::detail::png_write_rows_parallel(ctx.ptr, ctx.info, reinterpret_cast<const uint8*>(buf.data),
+                                                             cstride * outer->m_format.cols, compression_level))
+      return;
+
     boost::scoped_array<png_bytep> row_pointers( new png_bytep[outer->m_format.rows] );
 
     for(size_t i=0; i < outer->m_format.rows; i++)
@@ -474,6 +499,17 @@ struct DiskImageResourcePNG::vw_png_write_context:
     png_write_end(ctx.ptr, ctx.info);
   }
 
+  // Writes the next buf.format.rows rows of a non-interlaced image,
+  // finishing the file after the last one.
+  void write_rows(const ImageBuffer &buf)
+  {
+    for(size_t i=0; i < buf.format.rows; i++)
+      png_write_row(ctx.ptr, reinterpret_cast<uint8*>(buf.data) + i * buf.rstride);
+    next_row += buf.format.rows;
+    if(next_row == int32(outer->m_format.rows))
+      png_write_end(ctx.ptr, ctx.info);
+  }
+
 private:
   // Function for libpng to use to write as we're not using FILE*.
   static void write_data( png_structp png_ptr, png_bytep data, png_size_t length )
@@ -551,6 +587,31 @@ void DiskImageResourcePNG::read( ImageBuffer const& dest, BBox2i const& bbox ) c
   VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
              ArgumentErr() << "DiskImageResourcePNG (read) Error: Destination buffer has wrong dimensions!" );
 
+  // When dest holds pixels just as the file does, decode into it.
+  if( has_direct_read( dest, bbox ) ) {
+    uint8 *row = static_cast<uint8*>(dest.data);
+    if( ctx->interlaced ) {
+      if( ctx->current_line != 0 )
+        read_reset();
+      ctx->readall( row, dest.rstride );
+      return;
+    }
+    if(start_line < ctx->current_line)
+      read_reset();
+    if(start_line > ctx->current_line)
+      ctx->advance(start_line - ctx->current_line);
+    bool full_width = ( bbox.width() == cols() );
+    for( ; ctx->current_line < end_line; row += dest.rstride ) {
+      if( full_width )
+        ctx->readline( row );
+      else {
+        ctx->readline();
+        std::memcpy( row, ctx->scanline.get() + ctx->cstride * bbox.min().x(), bbox.width() * ctx->cstride );
+      }
+    }
+    return;
+  }
+
   boost::scoped_array<uint8> buf( new uint8[ctx->cstride * bbox.width() * bbox.height()] );
   // Interlacing is causing problems when read line-by-line...I think it's
   // a bug in libpng.
@@ -606,6 +667,15 @@ void DiskImageResourcePNG::read( ImageBuffer const& dest, BBox2i const& bbox ) c
   convert(dest, src, m_rescale);
 }
 
+bool DiskImageResourcePNG::has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const
+{
+  vw_png_read_context *ctx = dynamic_cast<vw_png_read_context *>(m_ctx.get());
+  if( ! ctx || ! convert_is_copy( buf.format, m_format ) || buf.cstride != ctx->cstride )
+    return false;
+  // Interlaced files can only be read whole.
+  return ! ctx->interlaced || bbox == BBox2i( 0, 0, cols(), rows() );
+}
+
 void DiskImageResourcePNG::read_reset() const {
   m_ctx.reset( new DiskImageResourcePNG::vw_png_read_context( const_cast<DiskImageResourcePNG *>(this) ) );
 }
@@ -658,9 +728,11 @@ void DiskImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbox )
 {
   vw_png_write_context *ctx = dynamic_cast<vw_png_write_context *>( m_ctx.get() );
 
-  VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
-             NoImplErr() << "DiskImageResourcePNG does not support partial writes." );
-  VW_ASSERT( src.format.cols==uint32(cols()) && src.format.rows==uint32(rows()),
+  // Anything less than the whole image must be the next strip.
+  bool whole = ( bbox == BBox2i(0,0,cols(),rows()) && ctx->next_row == 0 );
+  VW_ASSERT( whole || ( bbox.width()==int(cols()) && bbox.min().y()==ctx->next_row && !ctx->interlaced ),
+             NoImplErr() << "DiskImageResourcePNG only supports writing whole images or, if they are not interlaced, full-width strips in order." );
+  VW_ASSERT( src.format.cols==uint32(bbox.width()) && src.format.rows==uint32(bbox.height()),
              ArgumentErr() << "DiskImageResourcePNG: Buffer has wrong dimensions in PNG write." );
 
   // Set up the image buffer and convert the data into this buffer.
@@ -683,5 +755,14 @@ void DiskImageResourcePNG::write( ImageBuffer const& src, BBox2i const& bbox )
   convert(dst, src, m_rescale);
 
   // Write.
-  ctx->write(dst);
+  if( whole )
+    ctx->write(dst);
+  else
+    ctx->write_rows(dst);
+}
+
+bool DiskImageResourcePNG::has_scanline_write() const
+{
+  vw_png_write_context *ctx = dynamic_cast<vw_png_write_context *>( m_ctx.get() );
+  return ctx && !ctx->interlaced;
 }
@@ -50,6 +50,11 @@ namespace vw {
 
     virtual void read(ImageBuffer const& buf, BBox2i const& bbox ) const;
 
+    /// Lines are decoded straight into buffers of the file's own pixel
+    /// type and channel stride, as long as the file isn't interlaced or
+    /// is read whole.
+    virtual bool has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const;
+
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
 
     void open( std::string const& filename );
@@ -111,6 +116,10 @@ namespace vw {
 
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
+
+    /// Non-interlaced files are written whole or as full-width strips,
+    /// in order from the top.  Strips are deflated on one thread.
+    virtual bool has_scanline_write() const;
     virtual bool has_block_read()   const {return true;}
     virtual bool has_nodata_read()  const {return false;}
 
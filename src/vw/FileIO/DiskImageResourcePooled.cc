@@ -0,0 +1,96 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourcePooled.cc
+///
+/// Provides the pool of open files behind DiskImageView.
+///
+
+#include <algorithm>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/FileIO/DiskImageResourcePooled.h>
+
+using namespace vw;
+
+namespace {
+  vw::RunOnce pool_once = VW_RUNONCE_INIT;
+  vw::Cache *pool_ptr = 0;
+
+  void init_pool() {
+    pool_ptr = new vw::Cache( (std::max)( vw::vw_settings().max_open_resources(), vw::uint32(1) ) );
+  }
+}
+
+Cache& DiskImageResourcePooled::pool() {
+  pool_once.run( init_pool );
+  return *pool_ptr;
+}
+
+DiskImageResource* DiskImageResourcePooled::open( std::string const& filename ) {
+  uint32 max_open = vw_settings().max_open_resources();
+  if( max_open == 0 )
+    return DiskImageResource::open( filename );
+  if( pool().max_size() != max_open )
+    pool().resize( max_open );
+  return new DiskImageResourcePooled( filename );
+}
+
+boost::shared_ptr<DiskImageResource> DiskImageResourcePooled::Opener::generate() const {
+  return boost::shared_ptr<DiskImageResource>( DiskImageResource::open( m_filename ) );
+}
+
+DiskImageResourcePooled::DiskImageResourcePooled( std::string const& filename )
+  : DiskImageResource( filename ), m_handle( pool().insert( Opener( filename ) ) ), m_nodata( 0 )
+{
+  boost::shared_ptr<DiskImageResource> rsrc = m_handle;
+  m_type = rsrc->type();
+  m_format = rsrc->format();
+  m_block_read_size = rsrc->block_read_size();
+  m_has_block_read = rsrc->has_block_read();
+  m_has_nodata_read = rsrc->has_nodata_read();
+  if( m_has_nodata_read )
+    m_nodata = rsrc->nodata_read();
+}
+
+boost::shared_ptr<DiskImageResource> DiskImageResourcePooled::resource() const {
+  boost::shared_ptr<DiskImageResource> rsrc = m_handle;
+  rsrc->set_rescale( m_rescale );
+  return rsrc;
+}
+
+void DiskImageResourcePooled::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+  resource()->read( dest, bbox );
+}
+
+void DiskImageResourcePooled::write( ImageBuffer const& /*src*/, BBox2i const& /*bbox*/ ) {
+  vw_throw( NoImplErr() << "DiskImageResourcePooled: \"" << m_filename << "\" is open read-only." );
+}
+
+double DiskImageResourcePooled::nodata_read() const {
+  if( ! m_has_nodata_read )
+    vw_throw( NoImplErr() << "DiskImageResourcePooled: \"" << m_filename << "\" has no nodata value." );
+  return m_nodata;
+}
+
+int32 DiskImageResourcePooled::reduced_read_factor( int32 scale ) const {
+  return resource()->reduced_read_factor( scale );
+}
+
+void DiskImageResourcePooled::read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const {
+  resource()->read_reduced( dest, bbox, factor );
+}
+
+ImageBuffer DiskImageResourcePooled::mapped_buffer( boost::shared_ptr<void>& owner ) const {
+  return resource()->mapped_buffer( owner );
+}
+
+bool DiskImageResourcePooled::has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+  return resource()->has_direct_read( buf, bbox );
+}
@@ -0,0 +1,98 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourcePooled.h
+///
+/// A read-only resource that only holds its file open while it is
+/// being used.  Programs that mosaic hundreds of images would
+/// otherwise keep a file descriptor, and for GDAL a block cache, per
+/// image for as long as its DiskImageView lives.
+///
+/// The underlying resources are kept in a pool, a Cache in which each
+/// open file counts as one unit, so the pool's size is the number of
+/// files that stay open.  Those least recently read are closed once
+/// there are more, and reopened when they are next read; a file in
+/// the middle of a read stays open until the read is done.  The
+/// format, block size and nodata value are remembered, so the file is
+/// opened only to read pixels.
+///
+/// DiskImageView<>s opened by name go through the pool when the
+/// max_open_resources setting is nonzero, which also sets its size.
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOURCEPOOLED_H__
+#define __VW_FILEIO_DISKIMAGERESOURCEPOOLED_H__
+
+#include <string>
+
+#include <vw/Core/Cache.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  class DiskImageResourcePooled : public DiskImageResource {
+  public:
+
+    /// Opens filename through the pool if the max_open_resources
+    /// setting is nonzero, and directly (as DiskImageResource::open()
+    /// does) if it is zero.
+    static DiskImageResource* open( std::string const& filename );
+
+    /// Opens the file to read its format.  It may be closed again as
+    /// soon as other files are opened.
+    DiskImageResourcePooled( std::string const& filename );
+
+    virtual ~DiskImageResourcePooled() {}
+
+    /// Returns the type of the file's own resource, e.g. "GDAL".
+    virtual std::string type() { return m_type; }
+
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+    virtual void write( ImageBuffer const& src, BBox2i const& bbox );
+    virtual void flush() {}
+
+    virtual bool has_block_write()  const {return false;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read()   const {return m_has_block_read;}
+    virtual bool has_nodata_read()  const {return m_has_nodata_read;}
+
+    virtual Vector2i block_read_size() const { return m_block_read_size; }
+    virtual double nodata_read() const;
+
+    virtual int32 reduced_read_factor( int32 scale ) const;
+    virtual void read_reduced( ImageBuffer const& dest, BBox2i const& bbox, int32 factor ) const;
+    virtual ImageBuffer mapped_buffer( boost::shared_ptr<void>& owner ) const;
+    virtual bool has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const;
+
+    /// The pool the files are opened in.  Its stats() count each open
+    /// as a miss and each reopen of a closed file as a regenerated
+    /// byte, with the time spent opening in generation_microseconds.
+    static Cache& pool();
+
+  private:
+    // Opens the file, as the pool needs.
+    class Opener {
+      std::string m_filename;
+    public:
+      typedef DiskImageResource value_type;
+      Opener( std::string const& filename ) : m_filename(filename) {}
+      size_t size() const { return 1; }
+      boost::shared_ptr<DiskImageResource> generate() const;
+    };
+
+    // The open resource, with this resource's rescale setting.
+    boost::shared_ptr<DiskImageResource> resource() const;
+
+    Cache::Handle<Opener> m_handle;
+    std::string m_type;
+    Vector2i m_block_read_size;
+    bool m_has_block_read, m_has_nodata_read;
+    double m_nodata;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOURCEPOOLED_H__
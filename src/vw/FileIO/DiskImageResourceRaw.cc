@@ -0,0 +1,260 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceRaw.cc
+///
+/// Provides support for raw rasters with a .vwraw sidecar.
+///
+
+#include <fstream>
+#include <algorithm>
+
+#include <boost/scoped_array.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
+#include <vw/FileIO/MappedFile.h>
+
+namespace fs = boost::filesystem;
+
+using namespace vw;
+
+namespace {
+
+  std::string native_byte_order() {
+#if VW_BYTE_ORDER == VW_BIG_ENDIAN
+    return "big";
+#else
+    return "little";
+#endif
+  }
+
+  // Reverses the bytes of each channel of a packed buffer.
+  void swap_channels( uint8* data, size_t bytes, size_t channel_bytes ) {
+    if( channel_bytes < 2 ) return;
+    for( size_t i=0; i+channel_bytes<=bytes; i+=channel_bytes )
+      std::reverse( data+i, data+i+channel_bytes );
+  }
+
+  // The directory part of a path, with its trailing separator, or
+  // nothing for a bare file name.
+  std::string directory_of( std::string const& filename ) {
+    size_t slash = filename.find_last_of( '/' );
+    return ( slash == std::string::npos ) ? std::string() : filename.substr( 0, slash+1 );
+  }
+
+} // end anonymous
+
+DiskImageResourceRaw::DiskImageResourceRaw( std::string const& filename )
+  : DiskImageResource( filename ), m_offset( 0 ), m_native_order( true ) {
+  open( filename );
+}
+
+DiskImageResourceRaw::DiskImageResourceRaw( std::string const& filename, ImageFormat const& format )
+  : DiskImageResource( filename ), m_offset( 0 ), m_native_order( true ) {
+  create( filename, format );
+}
+
+// Parse the sidecar and check that the data file is big enough.
+void DiskImageResourceRaw::open( std::string const& filename ) {
+  std::ifstream input( filename.c_str() );
+  if( !input.is_open() )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: Failed to open \"" << filename << "\"." );
+
+  std::string magic;
+  int version = 0;
+  input >> magic >> version;
+  if( magic != "VWRAW" || version != 1 )
+    vw_throw( IOErr() << "DiskImageResourceRaw: \"" << filename << "\" is not a version 1 VWRAW sidecar." );
+
+  std::string key, data, byte_order = "little";
+  int32 pixel_format = VW_PIXEL_UNKNOWN, channel_type = VW_CHANNEL_UNKNOWN;
+  while( input >> key ) {
+    if     ( key == "cols" )         input >> m_format.cols;
+    else if( key == "rows" )         input >> m_format.rows;
+    else if( key == "planes" )       input >> m_format.planes;
+    else if( key == "pixel_format" ) input >> pixel_format;
+    else if( key == "channel_type" ) input >> channel_type;
+    else if( key == "byte_order" )   input >> byte_order;
+    else if( key == "offset" )       input >> m_offset;
+    else if( key == "data" )         { std::getline( input, data ); boost::trim( data ); }
+    else
+      vw_throw( IOErr() << "DiskImageResourceRaw: Unknown key \"" << key << "\" in \"" << filename << "\"." );
+    if( input.fail() )
+      vw_throw( IOErr() << "DiskImageResourceRaw: Bad value for \"" << key << "\" in \"" << filename << "\"." );
+  }
+  m_format.pixel_format = PixelFormatEnum( pixel_format );
+  m_format.channel_type = ChannelTypeEnum( channel_type );
+
+  if( !m_format.complete() || data.empty() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Incomplete image description in \"" << filename << "\"." );
+  if( byte_order != "little" && byte_order != "big" )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Unknown byte order \"" << byte_order << "\" in \"" << filename << "\"." );
+  m_native_order = ( byte_order == native_byte_order() ) || channel_size( m_format.channel_type ) == 1;
+
+  m_data_filename = ( data[0] == '/' ) ? data : directory_of( filename ) + data;
+  if( !fs::exists( m_data_filename ) )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Data file \"" << m_data_filename << "\" does not exist." );
+  if( boost::uintmax_t( fs::file_size( m_data_filename ) ) < m_offset + m_format.byte_size() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Data file \"" << m_data_filename << "\" is too small for "
+              << m_format.cols << "x" << m_format.rows << "x" << m_format.planes << " pixels." );
+
+  // Without a mapping, reads fall back to the stream.
+  if( MappedFile::supported() ) {
+    try {
+      m_map.reset( new MappedFile( m_data_filename ) );
+    } catch( IOErr const& ) {
+      m_map.reset();
+    }
+  }
+}
+
+// Write the sidecar and size the data file to match.
+void DiskImageResourceRaw::create( std::string const& filename, ImageFormat const& format ) {
+  if( !format.complete() )
+    vw_throw( ArgumentErr() << "DiskImageResourceRaw: Cannot create \"" << filename << "\" with an incomplete format." );
+  m_format = format;
+  m_offset = 0;
+  m_native_order = true;
+
+  std::string base = filename;
+  if( boost::algorithm::iends_with( base, ".vwraw" ) )
+    base.erase( base.size() - 6 );
+  m_data_filename = base + ".raw";
+
+  {
+    std::ofstream data( m_data_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+    if( !data.is_open() )
+      vw_throw( IOErr() << "DiskImageResourceRaw: Failed to create \"" << m_data_filename << "\"." );
+    if( m_format.byte_size() > 0 ) {
+      data.seekp( std::streamoff( m_format.byte_size() - 1 ) );
+      data.put( 0 );
+    }
+    if( data.fail() )
+      vw_throw( IOErr() << "DiskImageResourceRaw: Failed to size \"" << m_data_filename << "\"." );
+  }
+
+  std::ofstream sidecar( filename.c_str() );
+  if( !sidecar.is_open() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Failed to create \"" << filename << "\"." );
+  sidecar << "VWRAW 1\n"
+          << "cols " << m_format.cols << "\n"
+          << "rows " << m_format.rows << "\n"
+          << "planes " << m_format.planes << "\n"
+          << "pixel_format " << int32( m_format.pixel_format ) << "\n"
+          << "channel_type " << int32( m_format.channel_type ) << "\n"
+          << "byte_order " << native_byte_order() << "\n"
+          << "data " << m_data_filename.substr( directory_of( m_data_filename ).size() ) << "\n"
+          << "offset 0\n";
+  if( sidecar.fail() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Failed to write \"" << filename << "\"." );
+}
+
+ImageBuffer DiskImageResourceRaw::file_buffer( uint8* data, BBox2i const& bbox ) const {
+  ImageBuffer buf;
+  buf.format = m_format;
+  buf.format.cols = bbox.width();
+  buf.format.rows = bbox.height();
+  buf.cstride = m_format.cstride();
+  buf.rstride = m_format.rstride();
+  buf.pstride = m_format.pstride();
+  buf.data = data + m_offset + bbox.min().y()*buf.rstride + bbox.min().x()*buf.cstride;
+  return buf;
+}
+
+ImageBuffer DiskImageResourceRaw::mapped_buffer( boost::shared_ptr<void>& owner ) const {
+  if( !m_map || !m_native_order ) return ImageBuffer();
+  owner = m_map;
+  return file_buffer( m_map->data(), BBox2i( 0, 0, cols(), rows() ) );
+}
+
+// Read the disk image into the given buffer.
+void DiskImageResourceRaw::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceRaw: Read bbox " << bbox << " is outside the image." );
+  VW_ASSERT( dest.format.cols==uint32(bbox.width()) && dest.format.rows==uint32(bbox.height()),
+             IOErr() << "Buffer has wrong dimensions in raw read." );
+
+  // Native data is converted straight out of the mapping.
+  if( m_map && m_native_order ) {
+    convert( dest, file_buffer( m_map->data(), bbox ), m_rescale );
+    return;
+  }
+
+  ImageFormat format = m_format;
+  format.cols = bbox.width();
+  format.rows = bbox.height();
+  boost::scoped_array<uint8> data( new uint8[format.byte_size()] );
+  size_t row_bytes = format.rstride();
+  uint8* dst = data.get();
+  if( m_map ) {
+    ImageBuffer src = file_buffer( m_map->data(), bbox );
+    for( uint32 p=0; p<format.planes; ++p )
+      for( uint32 y=0; y<format.rows; ++y, dst+=row_bytes )
+        std::copy( (uint8*)src.data + p*src.pstride + y*src.rstride,
+                   (uint8*)src.data + p*src.pstride + y*src.rstride + row_bytes, dst );
+  }
+  else {
+    std::ifstream input( m_data_filename.c_str(), std::ios::in | std::ios::binary );
+    if( !input.is_open() )
+      vw_throw( IOErr() << "DiskImageResourceRaw: Failed to open \"" << m_data_filename << "\"." );
+    for( uint32 p=0; p<format.planes; ++p )
+      for( uint32 y=0; y<format.rows; ++y, dst+=row_bytes ) {
+        input.seekg( std::streamoff( m_offset + p*m_format.pstride() + (bbox.min().y()+y)*m_format.rstride()
+                                     + bbox.min().x()*m_format.cstride() ) );
+        input.read( reinterpret_cast<char*>( dst ), row_bytes );
+      }
+    if( input.fail() )
+      vw_throw( IOErr() << "DiskImageResourceRaw: Failed to read \"" << m_data_filename << "\"." );
+  }
+  if( !m_native_order )
+    swap_channels( data.get(), format.byte_size(), channel_size( format.channel_type ) );
+  convert( dest, ImageBuffer( format, data.get() ), m_rescale );
+}
+
+// Write the given buffer into the disk image.
+void DiskImageResourceRaw::write( ImageBuffer const& src, BBox2i const& bbox ) {
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 && bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceRaw: Write bbox " << bbox << " is outside the image." );
+  VW_ASSERT( src.format.cols==uint32(bbox.width()) && src.format.rows==uint32(bbox.height()),
+             IOErr() << "Buffer has wrong dimensions in raw write." );
+
+  ImageFormat format = m_format;
+  format.cols = bbox.width();
+  format.rows = bbox.height();
+  boost::scoped_array<uint8> data( new uint8[format.byte_size()] );
+  convert( ImageBuffer( format, data.get() ), src, m_rescale );
+  if( !m_native_order )
+    swap_channels( data.get(), format.byte_size(), channel_size( format.channel_type ) );
+
+  std::fstream output( m_data_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary );
+  if( !output.is_open() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Failed to open \"" << m_data_filename << "\" for writing." );
+  size_t row_bytes = format.rstride();
+  uint8 const* row = data.get();
+  for( uint32 p=0; p<format.planes; ++p )
+    for( uint32 y=0; y<format.rows; ++y, row+=row_bytes ) {
+      output.seekp( std::streamoff( m_offset + p*m_format.pstride() + (bbox.min().y()+y)*m_format.rstride()
+                                    + bbox.min().x()*m_format.cstride() ) );
+      output.write( reinterpret_cast<char const*>( row ), row_bytes );
+    }
+  if( output.fail() )
+    vw_throw( IOErr() << "DiskImageResourceRaw: Failed to write \"" << m_data_filename << "\"." );
+}
+
+// A FileIO hook to open a file for reading
+DiskImageResource* DiskImageResourceRaw::construct_open( std::string const& filename ) {
+  return new DiskImageResourceRaw( filename );
+}
+
+// A FileIO hook to open a file for writing
+DiskImageResource* DiskImageResourceRaw::construct_create( std::string const& filename,
+                                                           ImageFormat const& format ) {
+  return new DiskImageResourceRaw( filename, format );
+}
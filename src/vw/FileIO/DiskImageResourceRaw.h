@@ -0,0 +1,101 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceRaw.h
+///
+/// Provides support for raw, uncompressed rasters described by a
+/// small text sidecar file with the extension .vwraw, like
+///
+/// \code
+///   VWRAW 1
+///   cols 1024
+///   rows 768
+///   planes 1
+///   pixel_format 3
+///   channel_type 5
+///   byte_order little
+///   data image.raw
+///   offset 0
+/// \endcode
+///
+/// The pixel format and channel type are the numeric values of
+/// PixelFormatEnum and ChannelTypeEnum.  The data file holds the
+/// pixels packed the way ImageView lays them out, starting offset
+/// bytes in; a relative data path is relative to the sidecar.  An
+/// existing raw dump can be read by writing a sidecar for it.
+/// Created images put their data next to the sidecar, with the
+/// extension .raw.
+///
+/// Files in native byte order are read through a memory mapping and
+/// can be handed out without copying by map_image().
+///
+#ifndef __VW_FILEIO_DISKIMAGERESOURCERAW_H__
+#define __VW_FILEIO_DISKIMAGERESOURCERAW_H__
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  class MappedFile;
+
+  class DiskImageResourceRaw : public DiskImageResource {
+  public:
+
+    DiskImageResourceRaw( std::string const& filename ); // Reading
+
+    DiskImageResourceRaw( std::string const& filename,
+                          ImageFormat const& format ); // Writing
+
+    virtual ~DiskImageResourceRaw() {}
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "VWRAW"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+    virtual void write( ImageBuffer const& src, BBox2i const& bbox );
+    virtual void flush() {}
+
+    virtual ImageBuffer mapped_buffer( boost::shared_ptr<void>& owner ) const;
+
+    void open( std::string const& filename );
+
+    void create( std::string const& filename,
+                 ImageFormat const& format );
+
+    /// The file holding the pixels.
+    std::string data_filename() const { return m_data_filename; }
+
+    static DiskImageResource* construct_open( std::string const& filename );
+
+    static DiskImageResource* construct_create( std::string const& filename,
+                                                ImageFormat const& format );
+
+    virtual bool has_block_write()  const {return false;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read()   const {return false;}
+    virtual bool has_nodata_read()  const {return false;}
+
+  private:
+    // A buffer describing the pixels of bbox in data, which holds
+    // the file from its start.
+    ImageBuffer file_buffer( uint8* data, BBox2i const& bbox ) const;
+
+    std::string m_data_filename;
+    size_t m_offset;
+    bool m_native_order;
+    boost::shared_ptr<MappedFile> m_map;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOURCERAW_H__
@@ -16,12 +16,17 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <vw/config.h>
 #include <vector>
 
 #include <tiffio.h>
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+#include <zlib.h>
+#endif
 
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
 #include <vw/FileIO/DiskImageResourceTIFF.h>
 
 #ifndef VW_ERROR_BUFFER_SIZE
@@ -40,8 +45,13 @@ namespace vw {
     std::string filename;
     int current_line;
     bool striped;
+    bool encode_strips;
+    // Whether the file stores single-plane pixels just as an
+    // ImageBuffer does, so blocks can be decoded straight into one.
+    bool contiguous;
+    bool tiled;
 
-    DiskImageResourceInfoTIFF() : tif(0), block_size(), current_line(0) {}
+    DiskImageResourceInfoTIFF() : tif(0), block_size(), current_line(0), encode_strips(false), contiguous(false), tiled(false) {}
     ~DiskImageResourceInfoTIFF() {
       close();
     }
@@ -199,6 +209,10 @@ void vw::DiskImageResourceTIFF::open( std::string const& filename ) {
     }
   }
 
+  m_info->contiguous = photometric != PHOTOMETRIC_PALETTE && m_format.planes == 1 &&
+    ( plane_configuration == PLANARCONFIG_CONTIG || planes_tmp == 1 );
+  m_info->tiled = TIFFIsTiled(tif);
+
   if( TIFFIsTiled(tif) ) {
     uint32 tile_width, tile_length;
     check_retval(TIFFGetField( tif, TIFFTAG_TILEWIDTH, &tile_width ), 0);
@@ -248,7 +262,14 @@ void vw::DiskImageResourceTIFF::create( std::string const& filename,
   check_retval(TIFFSetField(tif, TIFFTAG_YRESOLUTION, 70.0), 0);
 
   if (m_use_compression) {
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+    check_retval(TIFFSetField(tif, TIFFTAG_COMPRESSION,COMPRESSION_ADOBE_DEFLATE), 0);
+    // We deflate strips ourselves in encode_block(), which packs
+    // pixels the way a single-plane TIFF stores them.
+    m_info->encode_strips = (m_format.planes == 1);
+#else
     check_retval(TIFFSetField(tif, TIFFTAG_COMPRESSION,COMPRESSION_LZW), 0);
+#endif
   }
 
   switch (m_format.channel_type) {
@@ -285,7 +306,10 @@ void vw::DiskImageResourceTIFF::create( std::string const& filename,
     check_retval(TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, (uint16)num_channels(m_format.pixel_format)), 0);
   }
 
-  uint32 rows_per_strip = TIFFDefaultStripSize( tif, 0 );
+  // libTIFF's default of 8K strips makes for far too many blocks when
+  // they are compressed in parallel, so encoded strips default to the
+  // tile size instead.
+  uint32 rows_per_strip = TIFFDefaultStripSize( tif, m_info->encode_strips ? vw_settings().default_tile_size() : 0 );
   check_retval(TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rows_per_strip), 0);
   m_info->block_size = Vector2i(cols(),rows_per_strip);
 
@@ -359,6 +383,10 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
   src_buf.rstride = block_cols*src_buf.cstride;
   src_buf.pstride = block_rows*src_buf.rstride;
 
+  // Whole blocks whose rows lie just as dest's do are decoded into it.
+  bool direct = m_info->contiguous && convert_is_copy( dest.format, m_format ) &&
+    dest.cstride == src_buf.cstride && dest.rstride == src_buf.rstride;
+
   for( int block_y = bbox.min().y()/block_rows; block_y <= int((bbox.max().y()-1)/block_rows); ++block_y ) {
     for( int block_x = bbox.min().x()/block_cols; block_x <= int((bbox.max().x()-1)/block_cols); ++block_x ) {
       int block_id = block_y * blocks_per_row + block_x;
@@ -367,6 +395,20 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
       int data_right = (std::min)((block_x+1)*block_cols,uint32(bbox.max().x()))-block_x*block_cols;
       int data_bottom = (std::min)((block_y+1)*block_rows,uint32(bbox.max().y()))-block_y*block_rows;
 
+      dest_buf.data = (uint8*)dest.data + (data_left+block_x*block_cols-bbox.min().x())*dest.cstride + (data_top+block_y*block_rows-bbox.min().y())*dest.rstride;
+
+      // The last strip may be short, and libTIFF decodes only its rows.
+      if( direct && data_left == 0 && data_top == 0 && data_right == int(block_cols) &&
+          ( data_bottom == int(block_rows) || ( !is_tiled && int(block_y*block_rows) + data_bottom == rows() ) ) ) {
+        if( is_tiled ) {
+          check_retval(TIFFReadEncodedTile( m_info->tif, block_id, dest_buf.data, (tsize_t) -1 ), -1);
+        } else {
+          check_retval(TIFFReadEncodedStrip( m_info->tif, block_id, dest_buf.data, (tsize_t) -1 ), -1);
+          m_info->current_line++;
+        }
+        continue;
+      }
+
       // Read the block into the buffer, converting planar or palettized data as needed.
       if( is_planar ) {
         // At the moment we make an extra copy here to spoof plane contiguity
@@ -426,7 +468,6 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
       }
 
       src_buf.data = (uint8*)buf + data_left*src_buf.cstride + data_top*src_buf.rstride;
-      dest_buf.data = (uint8*)dest.data + (data_left+block_x*block_cols-bbox.min().x())*dest.cstride + (data_top+block_y*block_rows-bbox.min().y())*dest.rstride;
       src_buf.format.cols = dest_buf.format.cols = data_right-data_left;
       src_buf.format.rows = dest_buf.format.rows = data_bottom-data_top;
 
@@ -442,6 +483,21 @@ void vw::DiskImageResourceTIFF::read( ImageBuffer const& dest, BBox2i const& bbo
   m_info->close();
 }
 
+/// Blocks are decoded straight into buffers holding the file's own
+/// pixels, with its rows one block wide, when bbox covers whole blocks.
+bool vw::DiskImageResourceTIFF::has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const
+{
+  if( !m_info->contiguous || !convert_is_copy( buf.format, m_format ) )
+    return false;
+  Vector2i const& block = m_info->block_size;
+  ptrdiff_t cstride = channel_size( m_format.channel_type ) * num_channels( m_format.pixel_format );
+  if( buf.cstride != cstride || buf.rstride != block.x()*cstride )
+    return false;
+  if( bbox.width() != block.x() || bbox.min().x() % block.x() != 0 || bbox.min().y() % block.y() != 0 )
+    return false;
+  return bbox.height() % block.y() == 0 || ( !m_info->tiled && bbox.max().y() == rows() );
+}
+
 // Write the given buffer into the disk image.
 void vw::DiskImageResourceTIFF::write( ImageBuffer const& src, BBox2i const& bbox )
 {
@@ -477,6 +533,64 @@ void vw::DiskImageResourceTIFF::write( ImageBuffer const& src, BBox2i const& bbo
   _TIFFfree(buf);
 }
 
+bool vw::DiskImageResourceTIFF::has_block_write() const {
+  return m_info->encode_strips;
+}
+
+vw::Vector2i vw::DiskImageResourceTIFF::block_write_size() const {
+  if( !m_info->encode_strips )
+    vw_throw( NoImplErr() << "DiskImageResourceTIFF: Block writes are only supported for compressed files." );
+  return m_info->block_size;
+}
+
+void vw::DiskImageResourceTIFF::set_block_write_size( Vector2i const& block_size ) {
+  if( !m_info->encode_strips )
+    vw_throw( NoImplErr() << "DiskImageResourceTIFF: Block writes are only supported for compressed files." );
+  VW_ASSERT( block_size.y() > 0, ArgumentErr() << "DiskImageResourceTIFF: Invalid block size " << block_size << "." );
+  uint32 rows_per_strip = (std::min)( uint32(block_size.y()), uint32(rows()) );
+  check_retval(TIFFSetField(m_info->tif, TIFFTAG_ROWSPERSTRIP, rows_per_strip), 0);
+  m_info->block_size = Vector2i(cols(),rows_per_strip);
+}
+
+bool vw::DiskImageResourceTIFF::has_block_encode() const {
+  return m_info->encode_strips;
+}
+
+void vw::DiskImageResourceTIFF::encode_block( ImageBuffer const& src, BBox2i const& bbox,
+                                              std::vector<uint8>& encoded ) const {
+#if defined(VW_HAVE_PKG_Z) && VW_HAVE_PKG_Z==1
+  VW_ASSERT( m_info->encode_strips,
+             NoImplErr() << "DiskImageResourceTIFF: Block encoding is only supported for compressed single-plane files." );
+  VW_ASSERT( bbox.min().x() == 0 && bbox.width() == cols() && bbox.min().y() % m_info->block_size.y() == 0 &&
+             (bbox.height() == m_info->block_size.y() || bbox.max().y() == rows()),
+             ArgumentErr() << "DiskImageResourceTIFF: Encoded block " << bbox << " is not a strip." );
+
+  // Pack the pixels the way the file stores them.
+  ImageFormat strip_format = m_format;
+  strip_format.rows = bbox.height();
+  size_t strip_bytes = size_t(cols()) * bbox.height() *
+    num_channels(m_format.pixel_format) * channel_size(m_format.channel_type);
+  std::vector<uint8> strip( strip_bytes );
+  convert( ImageBuffer(strip_format, &strip[0]), src, m_rescale );
+
+  uLongf encoded_bytes = compressBound( uLong(strip_bytes) );
+  encoded.resize( encoded_bytes );
+  int result = compress2( &encoded[0], &encoded_bytes, &strip[0], uLong(strip_bytes), Z_DEFAULT_COMPRESSION );
+  if( result != Z_OK )
+    vw_throw( IOErr() << "DiskImageResourceTIFF: Failed to compress strip " << bbox << " (zlib error " << result << ")." );
+  encoded.resize( encoded_bytes );
+#else
+  vw_throw( NoImplErr() << "DiskImageResourceTIFF: Block encoding requires zlib." );
+#endif
+}
+
+void vw::DiskImageResourceTIFF::write_encoded_block( std::vector<uint8> const& encoded, BBox2i const& bbox ) {
+  VW_ASSERT( m_info->encode_strips && !encoded.empty(),
+             ArgumentErr() << "DiskImageResourceTIFF: Invalid encoded block at " << bbox << "." );
+  tstrip_t strip = bbox.min().y() / m_info->block_size.y();
+  check_retval(TIFFWriteRawStrip(m_info->tif, strip, (tdata_t)&encoded[0], tsize_t(encoded.size())), -1);
+}
+
 // A FileIO hook to open a file for reading
 vw::DiskImageResource* vw::DiskImageResourceTIFF::construct_open( std::string const& filename ) {
   return new DiskImageResourceTIFF( filename );
@@ -37,17 +37,33 @@ namespace vw {
     /// Returns the type of disk image resource.
     virtual std::string type() { return type_static(); }
 
-    virtual bool has_block_write()  const {return false;}
+    virtual bool has_block_write()  const;
+    virtual bool has_scanline_write() const {return true;}
     virtual bool has_nodata_write() const {return false;}
     virtual bool has_block_read()   const {return true;}
     virtual bool has_nodata_read()  const {return false;}
 
     virtual Vector2i block_read_size() const;
 
+    // Compressed files are written a strip at a time.  Strips span the
+    // whole image, so only the number of rows is taken from the
+    // requested block size.
+    virtual Vector2i block_write_size() const;
+    virtual void set_block_write_size( Vector2i const& block_size );
+
     virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
+    virtual bool has_direct_read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
     virtual void write( ImageBuffer const& dest, BBox2i const& bbox );
 
+    // Compressed single-plane files are deflated a strip at a time on
+    // the caller's thread, so block_write_image() compresses on all of
+    // its threads and the writer only appends the finished strips.
+    virtual bool has_block_encode() const;
+    virtual void encode_block( ImageBuffer const& src, BBox2i const& bbox,
+                               std::vector<uint8>& encoded ) const;
+    virtual void write_encoded_block( std::vector<uint8> const& encoded, BBox2i const& bbox );
+
     void open( std::string const& filename );
 
     void create( std::string const& filename,
@@ -58,6 +74,7 @@ namespace vw {
     static DiskImageResource* construct_create( std::string const& filename,
                                                 ImageFormat const& format );
 
+    // Compression is deflate when VW is built with zlib, and LZW otherwise.
     void use_lzw_compression(bool state) { m_use_compression = state; }
 
   protected:
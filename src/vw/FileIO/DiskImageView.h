@@ -14,6 +14,8 @@
 #define __VW_FILEIO_DISKIMAGEVIEW_H__
 
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageResourceCache.h>
+#include <vw/FileIO/DiskImageResourcePooled.h>
 #include <vw/FileIO/TemporaryFile.h>
 #include <vw/Image/ImageResourceView.h>
 #include <vw/Image/BlockRasterize.h>
@@ -35,6 +37,7 @@ namespace vw {
     // to the underlying resource.
     boost::shared_ptr<DiskImageResource> m_rsrc;
     impl_type m_impl;
+    template <class> friend class RasterizeFootprint;
 
   public:
     typedef typename impl_type::pixel_type pixel_type;
@@ -43,8 +46,10 @@ namespace vw {
 
     /// Constructs a DiskImageView of the given file on disk
     /// using the specified cache area. NULL cache means skip it.
+    /// The file is opened through DiskImageResourcePooled, so it may
+    /// be closed between reads when max_open_resources is set.
     DiskImageView( std::string const& filename, Cache* cache = &vw_system_cache() )
-      : m_rsrc( DiskImageResource::open( filename ) ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+      : m_rsrc( DiskImageResourcePooled::open( filename ) ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
 
     /// Constructs a DiskImageView of the given resource using the
     /// specified cache area.
@@ -78,9 +83,63 @@ namespace vw {
 
     std::string filename() const { return m_rsrc->filename(); }
 
+    /// Reads up to depth blocks ahead of the ones being rasterized.
+    /// See ImageResourceView::set_read_ahead().
+    void set_read_ahead( int32 depth ) { m_impl.child().set_read_ahead( depth ); }
+    ReadAheadStats read_ahead_stats() const { return m_impl.child().read_ahead_stats(); }
+
+    /// Starts reading the blocks under bbox that aren't cached on the
+    /// I/O threads.  See ImageResourceView::prefetch().
+    void prefetch( BBox2i const& bbox ) const { m_impl.prefetch( bbox ); }
+
+    /// Returns a view of the image reduced by factor, which must come
+    /// from the resource's reduced_read_factor().  See
+    /// ImageResourceView::reduced().
+    DiskImageView reduced( int32 factor ) const {
+      if( factor == 1 ) return *this;
+      ImageResourceView<PixelT> child = m_impl.child().reduced( factor );
+      return DiskImageView( m_rsrc, impl_type( child, child.resource()->block_read_size(), 1, m_impl.cache() ) );
+    }
+
+    const DiskImageResource *resource() const { return m_rsrc.get(); }
+
+  private:
+    DiskImageView( boost::shared_ptr<DiskImageResource> const& resource, impl_type const& impl )
+      : m_rsrc( resource ), m_impl( impl ) {}
+  };
+
+  /// Subsamples a disk image, reading it at a reduced resolution where
+  /// the resource can.  See the ImageResourceView overload.
+  template <class PixelT>
+  inline SubsampleView<DiskImageView<PixelT> > subsample( DiskImageView<PixelT> const& v, int32 xfactor, int32 yfactor ) {
+    int32 factor = detail::reduced_subsample_factor( *v.resource(), xfactor, yfactor );
+    return SubsampleView<DiskImageView<PixelT> >( v.reduced( factor ), xfactor/factor, yfactor/factor );
+  }
+
+  template <class PixelT>
+  inline SubsampleView<DiskImageView<PixelT> > subsample( DiskImageView<PixelT> const& v, int32 subsampling_factor ) {
+    return subsample( v, subsampling_factor, subsampling_factor );
+  }
+
+  template <class PixelT>
+  class RasterizeFootprint<DiskImageView<PixelT> > {
+    DiskImageView<PixelT> const& m_view;
+  public:
+    RasterizeFootprint( DiskImageView<PixelT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return RasterizeFootprint<typename DiskImageView<PixelT>::impl_type>( m_view.m_impl )( bbox );
+    }
   };
 
 
+  template <class PixelT>
+  class RasterizePrefetch<DiskImageView<PixelT> > {
+    DiskImageView<PixelT> const& m_view;
+  public:
+    RasterizePrefetch( DiskImageView<PixelT> const& view ) : m_view(view) {}
+    void operator()( BBox2i const& bbox ) const { m_view.prefetch( bbox ); }
+  };
+
   template <class PixelT>
     class DiskCacheHandle : private boost::noncopyable {
     DiskImageView<PixelT> m_disk_image_view;
@@ -92,6 +151,11 @@ namespace vw {
       m_disk_image_view(filename), m_filename(filename) {
     }
 
+    // Holds on to resource, which is the only way to read a VWCACHE file.
+    DiskCacheHandle(boost::shared_ptr<DiskImageResource> const& resource) :
+      m_disk_image_view(resource), m_filename(resource->filename()) {
+    }
+
     ~DiskCacheHandle() {
       vw_out(DebugMessage, "fileio") << "DiskCacheImageView: deleting temporary cache file: " << m_filename << "\n";
       boost::filesystem::remove( m_filename );
@@ -105,6 +169,10 @@ namespace vw {
   /// interface (a la DiskImageView) to that data.  The temporary file
   /// persists until this object and all copies of this object are
   /// destroyed.
+  ///
+  /// A file_type of "vwcache" stores the image as blocks compressed
+  /// on the threads that rasterize them (see DiskImageResourceCache),
+  /// which is usually both smaller and faster than a TIFF.
   template <class PixelT>
   class DiskCacheImageView : public ImageViewBase< DiskCacheImageView<PixelT> > {
   private:
@@ -121,6 +189,14 @@ namespace vw {
       ImageFormat fmt(view.format());
       fmt.pixel_format = PixelFormatID<PixelT>::value;
 
+      if (m_file_type == "vwcache") {
+        boost::shared_ptr<DiskImageResource> r(new DiskImageResourceCache( file.filename(), fmt ));
+        block_write_image(*r, pixel_cast_rescale<PixelT>(view), progress_callback);
+        r->flush();
+        m_handle = boost::shared_ptr<DiskCacheHandle<PixelT> >(new DiskCacheHandle<PixelT>(r));
+        return;
+      }
+
       boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create( file.filename(), fmt));
       if (r->has_block_write())
         r->set_block_write_size(Vector2i(vw_settings().default_tile_size(), vw_settings().default_tile_size()));
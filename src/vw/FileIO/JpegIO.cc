@@ -8,6 +8,7 @@
 #include <vw/FileIO/JpegIO.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
+#include <algorithm>
 
 static void vw_jpeg_error_exit(j_common_ptr cinfo) {
   char buffer[JMSG_LENGTH_MAX];
@@ -36,8 +37,11 @@ void JpegIO::init_base(jpeg_error_mgr** mgr) {
 ////////////////////////////////////////////////////////////////////////////////
 // Decompress
 ////////////////////////////////////////////////////////////////////////////////
-JpegIODecompress::JpegIODecompress()
+JpegIODecompress::JpegIODecompress(int scale_denom)
+  : m_scale_denom(scale_denom)
 {
+  VW_ASSERT(scale_denom == 1 || scale_denom == 2 || scale_denom == 4 || scale_denom == 8,
+            ArgumentErr() << "JpegIODecompress: scale_denom must be 1, 2, 4, or 8");
   init_base(&m_ctx.err);
   jpeg_create_decompress(&m_ctx);
 }
@@ -67,6 +71,8 @@ void JpegIODecompress::read(uint8* buffer, size_t bufsize) {
 void JpegIODecompress::open() {
   bind();
   jpeg_read_header(&m_ctx, TRUE);
+  m_ctx.scale_num = 1;
+  m_ctx.scale_denom = m_scale_denom;
   jpeg_calc_output_dimensions(&m_ctx);
 
   m_fmt.cols = m_ctx.output_width;
@@ -218,8 +224,9 @@ struct vector_dest_mgr {
 
   static void init_destination (j_compress_ptr cinfo) {
     vector_dest_mgr *dest = reinterpret_cast<vector_dest_mgr*>(cinfo->dest);
-    dest->vec->resize(BLOCK_SIZE);
-    dest->pub.free_in_buffer = BLOCK_SIZE;
+    // Start with all the room a reused vector already has.
+    dest->vec->resize((std::max)(BLOCK_SIZE, dest->vec->capacity()));
+    dest->pub.free_in_buffer = dest->vec->size();
     dest->pub.next_output_byte = &(dest->vec->operator[](0));
   }
   static ::boolean empty_output_buffer (j_compress_ptr cinfo) {
@@ -37,8 +37,10 @@ class JpegIO {
 class JpegIODecompress : public JpegIO, public ScanlineReadBackend {
   protected:
     jpeg_decompress_struct m_ctx;
+    int m_scale_denom;
   public:
-    JpegIODecompress();
+    // Decodes at 1/scale_denom of the full size, which can be 1, 2, 4 or 8.
+    JpegIODecompress(int scale_denom = 1);
     virtual ~JpegIODecompress();
 
     void open();
@@ -0,0 +1,66 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/config.h>
+#include <vw/FileIO/MappedFile.h>
+#include <vw/Core/Exception.h>
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(VW_HAVE_SYS_MMAN_H) && VW_HAVE_SYS_MMAN_H == 1
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  define VW_MAPPED_FILE_SUPPORTED 1
+#endif
+
+#ifdef VW_MAPPED_FILE_SUPPORTED
+
+vw::MappedFile::MappedFile( std::string const& filename ) : m_data(0), m_size(0) {
+  int fd = ::open( filename.c_str(), O_RDONLY );
+  if( fd < 0 )
+    vw_throw( IOErr() << "MappedFile: Failed to open \"" << filename << "\": " << std::strerror(errno) );
+  struct stat info;
+  if( ::fstat( fd, &info ) != 0 ) {
+    int err = errno;
+    ::close( fd );
+    vw_throw( IOErr() << "MappedFile: Failed to stat \"" << filename << "\": " << std::strerror(err) );
+  }
+  m_size = size_t(info.st_size);
+  if( m_size > 0 ) {
+    void* data = ::mmap( 0, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+    if( data == MAP_FAILED ) {
+      int err = errno;
+      ::close( fd );
+      vw_throw( IOErr() << "MappedFile: Failed to map \"" << filename << "\": " << std::strerror(err) );
+    }
+    m_data = static_cast<uint8*>( data );
+  }
+  // The mapping holds its own reference to the file.
+  ::close( fd );
+}
+
+vw::MappedFile::~MappedFile() {
+  if( m_data ) ::munmap( m_data, m_size );
+}
+
+bool vw::MappedFile::supported() { return true; }
+
+#else
+
+vw::MappedFile::MappedFile( std::string const& filename ) : m_data(0), m_size(0) {
+  vw_throw( NoImplErr() << "MappedFile: Cannot map \"" << filename << "\": memory mapping is not supported on this platform." );
+}
+
+vw::MappedFile::~MappedFile() {}
+
+bool vw::MappedFile::supported() { return false; }
+
+#endif
@@ -0,0 +1,44 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file MappedFile.h
+///
+/// A memory mapping of a whole file, for drivers of uncompressed
+/// formats that can hand out their pixels where they lie.
+///
+#ifndef __VW_FILEIO_MAPPEDFILE_H__
+#define __VW_FILEIO_MAPPEDFILE_H__
+
+#include <string>
+#include <boost/utility.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+
+namespace vw {
+
+  /// A private, copy-on-write mapping of a file.  Reads come straight
+  /// from the page cache; writes through data() go to private copies
+  /// of the pages and never reach the file.
+  class MappedFile : private boost::noncopyable {
+    uint8* m_data;
+    size_t m_size;
+  public:
+    /// Maps the named file.  Throws IOErr if the file cannot be
+    /// opened or mapped, and NoImplErr on platforms without mmap.
+    MappedFile( std::string const& filename );
+    ~MappedFile();
+
+    uint8* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    /// Returns true if files can be mapped on this platform.
+    static bool supported();
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_MAPPEDFILE_H__
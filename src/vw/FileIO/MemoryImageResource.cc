@@ -7,6 +7,7 @@
 
 #include <vw/config.h>
 #include <vw/FileIO/MemoryImageResource.h>
+#include <vw/Core/Debugging.h>
 
 #if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
 #  include <vw/FileIO/MemoryImageResourceJPEG.h>
@@ -21,21 +22,34 @@
 #endif
 
 #include <boost/assign/list_of.hpp>
-#include <boost/lambda/construct.hpp>
 #include <boost/function.hpp>
 #include <boost/algorithm/string.hpp>
 #include <map>
 
 
 namespace {
-  typedef boost::function<vw::SrcMemoryImageResource*(const boost::shared_array<const vw::uint8>, size_t)> open_func;
-  typedef boost::function<vw::DstMemoryImageResource*(const vw::ImageFormat&)> create_func;
+  // Borrows data when owner is null, and shares ownership of it otherwise.
+  typedef boost::function<vw::SrcMemoryImageResource*(const vw::uint8*, size_t, boost::shared_array<const vw::uint8>)> open_func;
+  // Encodes into output, or into the resource's own buffer if it is null.
+  typedef boost::function<vw::DstMemoryImageResource*(const vw::ImageFormat&, std::vector<vw::uint8>*)> create_func;
 
   typedef std::map<std::string, open_func> open_map_t;
   typedef std::map<std::string, create_func> create_map_t;
 
-#define OPEN(Name, Type) (Name, boost::lambda::new_ptr<vw::SrcMemoryImageResource ## Type>())
-#define CREAT(Name, Type) (Name, boost::lambda::new_ptr<vw::DstMemoryImageResource ## Type>())
+  template <class ResourceT>
+  vw::SrcMemoryImageResource* open_as(const vw::uint8* data, size_t len, boost::shared_array<const vw::uint8> owner) {
+    if (owner)
+      return new ResourceT(owner, len);
+    return new ResourceT(data, len);
+  }
+
+  template <class ResourceT>
+  vw::DstMemoryImageResource* create_as(const vw::ImageFormat& fmt, std::vector<vw::uint8>* output) {
+    return new ResourceT(fmt, output);
+  }
+
+#define OPEN(Name, Type) (Name, &open_as<vw::SrcMemoryImageResource ## Type>)
+#define CREAT(Name, Type) (Name, &create_as<vw::DstMemoryImageResource ## Type>)
 
   open_map_t open_map = boost::assign::list_of<std::pair<std::string, open_func> >
 #if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
@@ -78,23 +92,38 @@ namespace {
 
 namespace vw {
 
+  namespace {
+    open_func const& find_open( const std::string& type ) {
+      open_map_t::const_iterator i = open_map.find(clean_type(type));
+      if (i == open_map.end())
+        vw_throw( NoImplErr() << "Unsupported file format: " << type );
+      return i->second;
+    }
+
+    create_func const& find_create( const std::string& type ) {
+      create_map_t::const_iterator i = create_map.find(clean_type(type));
+      if (i == create_map.end())
+        vw_throw( NoImplErr() << "Unsupported file format: " << type );
+      return i->second;
+    }
+  }
+
   SrcMemoryImageResource* SrcMemoryImageResource::open( const std::string& type, const uint8* data, size_t len ) {
-    boost::shared_array<const uint8> p(data, NOP());
-    return SrcMemoryImageResource::open(type, p, len);
+    return find_open(type)(data, len, boost::shared_array<const uint8>());
   }
 
   SrcMemoryImageResource* SrcMemoryImageResource::open( const std::string& type, boost::shared_array<const uint8> data, size_t len ) {
-    open_map_t::const_iterator i = open_map.find(clean_type(type));
-    if (i == open_map.end())
-      vw_throw( NoImplErr() << "Unsupported file format: " << type );
-    return i->second(data, len);
+    VW_ASSERT(data, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
+    return find_open(type)(data.get(), len, data);
   }
 
   DstMemoryImageResource* DstMemoryImageResource::create( const std::string& type, const ImageFormat& format ) {
-    create_map_t::const_iterator i = create_map.find(clean_type(type));
-    if (i == create_map.end())
-      vw_throw( NoImplErr() << "Unsupported file format: " << type );
-    return i->second(format);
+    return find_create(type)(format, 0);
+  }
+
+  DstMemoryImageResource* DstMemoryImageResource::create( const std::string& type, const ImageFormat& format, std::vector<uint8>* output ) {
+    VW_ASSERT(output, ArgumentErr() << VW_CURRENT_FUNCTION << ": output must be non-null");
+    return find_create(type)(format, output);
   }
 
 } // namespace vw
@@ -11,12 +11,15 @@
 
 #include <vw/Image/ImageResource.h>
 
+#include <vector>
+
 namespace vw {
 
   class SrcMemoryImageResource : public SrcImageResource {
     public:
       // constructs the appropriate subclass for the type
-      // Does not take ownership of data
+      // Does not take ownership of data, which must outlive the resource.
+      // It is decoded where it lies, so nothing is copied or allocated for it.
       static SrcMemoryImageResource* open( const std::string& type, const uint8* data, size_t len);
       // Takes ownership of data
       static SrcMemoryImageResource* open( const std::string& type, boost::shared_array<const uint8> data, size_t len);
@@ -26,6 +29,12 @@ namespace vw {
     public:
       // constructs the appropriate subclass for the type
       static DstMemoryImageResource* create( const std::string& type, const ImageFormat& format );
+      // Encodes into output instead of a buffer of the resource's own.
+      // output is cleared first but keeps its capacity, so a caller who
+      // reuses one vector for many images (e.g. tiles) stops allocating
+      // once it has grown to fit the largest. data() and size() then
+      // refer to output, which must outlive the resource.
+      static DstMemoryImageResource* create( const std::string& type, const ImageFormat& format, std::vector<uint8>* output );
       virtual const uint8* data() const = 0;
       virtual size_t size() const = 0;
   };
@@ -26,12 +26,14 @@ namespace {
 namespace vw {
 
 class SrcMemoryImageResourceGDAL::Data : public fileio::detail::GdalIODecompress {
-    boost::shared_array<const uint8> m_data;
+    // Null when the buffer is borrowed
+    boost::shared_array<const uint8> m_owner;
+    const uint8* m_data;
     size_t m_len;
   protected:
     virtual void bind() {
-      const std::string src_fn(make_fn("src", m_data.get()));
-      VSIFCloseL(VSIFileFromMemBuffer(src_fn.c_str(), const_cast<uint8*>(m_data.get()), m_len, false));
+      const std::string src_fn(make_fn("src", m_data));
+      VSIFCloseL(VSIFileFromMemBuffer(src_fn.c_str(), const_cast<uint8*>(m_data), m_len, false));
       m_dataset.reset(reinterpret_cast<GDALDataset*>(GDALOpen(src_fn.c_str(), GA_ReadOnly)), GDALCloseNullOk);
       if (!m_dataset) {
         VSIUnlink(src_fn.c_str());
@@ -40,14 +42,19 @@ class SrcMemoryImageResourceGDAL::Data : public fileio::detail::GdalIODecompress
     }
     Data* rewind() const {vw_throw(NoImplErr() << VW_CURRENT_FUNCTION << ": not supported");}
   public:
-    Data(boost::shared_array<const uint8> buffer, size_t len) : m_data(buffer), m_len(len) {
+    Data(boost::shared_array<const uint8> owner, const uint8* buffer, size_t len) : m_owner(owner), m_data(buffer), m_len(len) {
       VW_ASSERT(buffer, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
       VW_ASSERT(len,    ArgumentErr() << VW_CURRENT_FUNCTION << ": len must be non-zero");
     }
 };
 
 SrcMemoryImageResourceGDAL::SrcMemoryImageResourceGDAL(boost::shared_array<const uint8> buffer, size_t len)
-  : m_data(new Data(buffer, len)) {
+  : m_data(new Data(buffer, buffer.get(), len)) {
+    m_data->open();
+}
+
+SrcMemoryImageResourceGDAL::SrcMemoryImageResourceGDAL(const uint8* buffer, size_t len)
+  : m_data(new Data(boost::shared_array<const uint8>(), buffer, len)) {
     m_data->open();
 }
 
@@ -113,9 +120,11 @@ class DstMemoryImageResourceGDAL::Data : public fileio::detail::GdalIOCompress {
 };
 
 
-DstMemoryImageResourceGDAL::DstMemoryImageResourceGDAL(const ImageFormat& fmt)
-  : m_data(new Data(fmt))
+DstMemoryImageResourceGDAL::DstMemoryImageResourceGDAL(const ImageFormat& fmt, std::vector<uint8>* output)
+  : m_data(new Data(fmt)), m_output(output)
 {
+  if (m_output)
+    m_output->clear();
   m_data->open();
 }
 
@@ -149,13 +158,21 @@ void DstMemoryImageResourceGDAL::write( ImageBuffer const& src, BBox2i const& bb
   }
 
   m_data->write(buf.get(), bufsize, width, height, planes);
+
+  // GDAL encodes into a memory file of its own, so copy it out.
+  if (m_output)
+    m_output->assign(m_data->data(), m_data->data() + m_data->size());
 }
 
 const uint8* DstMemoryImageResourceGDAL::data() const {
+  if (m_output)
+    return &(*m_output)[0];
   return m_data->data();
 }
 
 size_t DstMemoryImageResourceGDAL::size() const {
+  if (m_output)
+    return m_output->size();
   return m_data->size();
 }
 
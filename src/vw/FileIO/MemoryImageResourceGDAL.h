@@ -19,6 +19,8 @@ namespace vw {
 
     public:
       SrcMemoryImageResourceGDAL(boost::shared_array<const uint8> buffer, size_t len);
+      // Borrows buffer, which must outlive the resource.
+      SrcMemoryImageResourceGDAL(const uint8* buffer, size_t len);
 
       virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
@@ -32,9 +34,12 @@ namespace vw {
   class DstMemoryImageResourceGDAL : public DstMemoryImageResource {
       struct Data;
       boost::shared_ptr<Data> m_data;
+      std::vector<uint8>* m_output;
 
     public:
-      DstMemoryImageResourceGDAL(const ImageFormat& fmt);
+      // Copies what GDAL encodes into output if it is non-null (see
+      // DstMemoryImageResource::create()).
+      DstMemoryImageResourceGDAL(const ImageFormat& fmt, std::vector<uint8>* output = 0);
 
       virtual void write( ImageBuffer const& buf, BBox2i const& bbox );
       virtual void flush() {}
@@ -9,23 +9,35 @@
 #include <vw/FileIO/JpegIO.h>
 #include <vw/Core/Debugging.h>
 
+#include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
+
 namespace vw {
 
 class SrcMemoryImageResourceJPEG::Data : public fileio::detail::JpegIODecompress {
-    boost::shared_array<const uint8> m_data;
+    // Null when the buffer is borrowed
+    boost::shared_array<const uint8> m_owner;
+    const uint8* m_data;
     size_t m_len;
   protected:
-    virtual void bind() { fileio::detail::jpeg_ptr_src(&m_ctx, m_data.get(), m_len); }
+    virtual void bind() { fileio::detail::jpeg_ptr_src(&m_ctx, m_data, m_len); }
   public:
-    Data* rewind() const VW_WARN_UNUSED {std::auto_ptr<Data> r(new Data(m_data, m_len)); r->open(); return r.release();}
-    Data(boost::shared_array<const uint8> buffer, size_t len) : m_data(buffer), m_len(len) {
+    Data* rewind() const VW_WARN_UNUSED {return reduced(m_scale_denom);}
+    Data* reduced(int scale_denom) const VW_WARN_UNUSED {std::auto_ptr<Data> r(new Data(m_owner, m_data, m_len, scale_denom)); r->open(); return r.release();}
+    Data(boost::shared_array<const uint8> owner, const uint8* buffer, size_t len, int scale_denom = 1)
+      : JpegIODecompress(scale_denom), m_owner(owner), m_data(buffer), m_len(len) {
       VW_ASSERT(buffer, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
       VW_ASSERT(len,    ArgumentErr() << VW_CURRENT_FUNCTION << ": len must be non-zero");
     }
 };
 
 SrcMemoryImageResourceJPEG::SrcMemoryImageResourceJPEG(boost::shared_array<const uint8> buffer, size_t len)
-  : m_data(new Data(buffer, len)) {
+  : m_data(new Data(buffer, buffer.get(), len)) {
+    m_data->open();
+}
+
+SrcMemoryImageResourceJPEG::SrcMemoryImageResourceJPEG(const uint8* buffer, size_t len)
+  : m_data(new Data(boost::shared_array<const uint8>(), buffer, len)) {
     m_data->open();
 }
 
@@ -67,24 +79,57 @@ void SrcMemoryImageResourceJPEG::read( ImageBuffer const& dst, BBox2i const& bbo
   convert(dst, src, true);
 }
 
+int32 SrcMemoryImageResourceJPEG::reduced_read_factor( int32 scale ) const {
+  int32 factor = 1;
+  while (2*factor <= scale && 2*factor <= 8)
+    factor *= 2;
+  return factor;
+}
+
+void SrcMemoryImageResourceJPEG::read_reduced( ImageBuffer const& dst, BBox2i const& bbox, int32 factor ) const {
+  if (factor == 1) {
+    read(dst, bbox);
+    return;
+  }
+  VW_ASSERT( reduced_read_factor(factor) == factor,
+             ArgumentErr() << VW_CURRENT_FUNCTION << ": Cannot read reduced by " << factor );
+  VW_ASSERT( dst.format.cols == size_t(bbox.width()) && dst.format.rows == size_t(bbox.height()),
+             ArgumentErr() << VW_CURRENT_FUNCTION << ": Destination buffer has wrong dimensions!" );
+
+  // The reduced image is small, so decode all of it and convert the
+  // part that was asked for.
+  boost::scoped_ptr<Data> reduced(m_data->reduced(factor));
+  ImageFormat src_fmt(reduced->fmt());
+  VW_ASSERT( BBox2i(0,0,src_fmt.cols,src_fmt.rows).contains(bbox),
+             ArgumentErr() << VW_CURRENT_FUNCTION << ": " << bbox << " is outside the reduced image" );
+  size_t bufsize = reduced->line_bytes() * src_fmt.rows;
+  boost::scoped_array<uint8> buf(new uint8[bufsize]);
+  reduced->read(buf.get(), bufsize);
+
+  convert(dst, ImageBuffer(src_fmt, buf.get()).cropped(bbox), true);
+}
+
 ImageFormat SrcMemoryImageResourceJPEG::format() const {
   return m_data->fmt();
 }
 
 class DstMemoryImageResourceJPEG::Data : public fileio::detail::JpegIOCompress {
-  std::vector<uint8> m_data;
+  std::vector<uint8> m_own;
+  // m_own, or the caller's buffer
+  std::vector<uint8>* m_data;
 
   protected:
-    virtual void bind() { fileio::detail::jpeg_vector_dest(&m_ctx, &m_data); }
+    virtual void bind() { fileio::detail::jpeg_vector_dest(&m_ctx, m_data); }
   public:
-    Data(const ImageFormat &fmt) : JpegIOCompress(fmt) {}
-    const uint8* data() const {return &m_data[0];}
-    size_t size() const {return m_data.size();}
+    Data(const ImageFormat &fmt, std::vector<uint8>* output)
+      : JpegIOCompress(fmt), m_data(output ? output : &m_own) { m_data->clear(); }
+    const uint8* data() const {return &(*m_data)[0];}
+    size_t size() const {return m_data->size();}
 };
 
 
-DstMemoryImageResourceJPEG::DstMemoryImageResourceJPEG(const ImageFormat& fmt)
-  : m_data(new Data(fmt))
+DstMemoryImageResourceJPEG::DstMemoryImageResourceJPEG(const ImageFormat& fmt, std::vector<uint8>* output)
+  : m_data(new Data(fmt, output))
 {
   m_data->open();
 }
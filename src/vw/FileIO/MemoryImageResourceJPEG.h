@@ -19,6 +19,8 @@ namespace vw {
 
     public:
       SrcMemoryImageResourceJPEG(boost::shared_array<const uint8> buffer, size_t len);
+      // Borrows buffer, which must outlive the resource.
+      SrcMemoryImageResourceJPEG(const uint8* buffer, size_t len);
 
       virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
@@ -26,6 +28,10 @@ namespace vw {
 
       virtual bool has_block_read() const  {return false;}
       virtual bool has_nodata_read() const {return false;}
+
+      // Reduced reads use libjpeg's DCT scaling.
+      virtual int32 reduced_read_factor( int32 scale ) const;
+      virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 factor ) const;
   };
 
   class DstMemoryImageResourceJPEG : public DstMemoryImageResource {
@@ -33,7 +39,9 @@ namespace vw {
       boost::shared_ptr<Data> m_data;
 
     public:
-      DstMemoryImageResourceJPEG(const ImageFormat& fmt);
+      // Encodes into output if it is non-null (see
+      // DstMemoryImageResource::create()), and into a buffer of its own if not.
+      DstMemoryImageResourceJPEG(const ImageFormat& fmt, std::vector<uint8>* output = 0);
 
       virtual void write( ImageBuffer const& buf, BBox2i const& bbox );
       virtual void flush() {}
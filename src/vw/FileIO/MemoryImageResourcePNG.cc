@@ -12,13 +12,15 @@
 namespace vw {
 
 class SrcMemoryImageResourcePNG::Data : public fileio::detail::PngIODecompress {
-    boost::shared_array<const uint8> m_data;
+    // Null when the buffer is borrowed
+    boost::shared_array<const uint8> m_owner;
+    const uint8 * const m_begin;
     const uint8 * m_cur;
     const uint8 * const m_end;
   protected:
     virtual void bind() { png_set_read_fn(m_ctx, reinterpret_cast<png_voidp>(this), &SrcMemoryImageResourcePNG::Data::read_fn); }
   public:
-    Data* rewind() const VW_WARN_UNUSED {std::auto_ptr<Data> r(new Data(m_data, m_end-m_data.get())); r->open(); return r.release();}
+    Data* rewind() const VW_WARN_UNUSED {std::auto_ptr<Data> r(new Data(m_owner, m_begin, m_end-m_begin)); r->open(); return r.release();}
 
     static void read_fn( png_structp ctx, png_bytep data, png_size_t len ) {
       Data *mgr = reinterpret_cast<Data*>(png_get_io_ptr(ctx));
@@ -26,14 +28,20 @@ class SrcMemoryImageResourcePNG::Data : public fileio::detail::PngIODecompress {
       std::copy(mgr->m_cur, mgr->m_cur+len, data);
       mgr->m_cur += len;
     }
-    Data(boost::shared_array<const uint8> buffer, size_t len) : m_data(buffer), m_cur(buffer.get()), m_end(buffer.get()+len) {
+    Data(boost::shared_array<const uint8> owner, const uint8* buffer, size_t len)
+      : m_owner(owner), m_begin(buffer), m_cur(buffer), m_end(buffer+len) {
       VW_ASSERT(buffer, ArgumentErr() << VW_CURRENT_FUNCTION << ": buffer must be non-null");
       VW_ASSERT(len,    ArgumentErr() << VW_CURRENT_FUNCTION << ": len must be non-zero");
     }
 };
 
 SrcMemoryImageResourcePNG::SrcMemoryImageResourcePNG(boost::shared_array<const uint8> buffer, size_t len)
-  : m_data(new Data(buffer, len)) {
+  : m_data(new Data(buffer, buffer.get(), len)) {
+    m_data->open();
+}
+
+SrcMemoryImageResourcePNG::SrcMemoryImageResourcePNG(const uint8* buffer, size_t len)
+  : m_data(new Data(boost::shared_array<const uint8>(), buffer, len)) {
     m_data->open();
 }
 
@@ -80,7 +88,9 @@ ImageFormat SrcMemoryImageResourcePNG::format() const {
 }
 
 class DstMemoryImageResourcePNG::Data : public fileio::detail::PngIOCompress {
-  std::vector<uint8> m_data;
+  std::vector<uint8> m_own;
+  // m_own, or the caller's buffer
+  std::vector<uint8>* m_data;
   typedef DstMemoryImageResourcePNG::Data this_type;
 
   protected:
@@ -88,22 +98,23 @@ class DstMemoryImageResourcePNG::Data : public fileio::detail::PngIOCompress {
       png_set_write_fn(m_ctx, reinterpret_cast<png_voidp>(this), &this_type::write_fn, &this_type::flush_fn);
     }
   public:
-    Data(const ImageFormat &fmt) : PngIOCompress(fmt) {}
-    const uint8* data() const {return &m_data[0];}
-    size_t size() const {return m_data.size();}
+    Data(const ImageFormat &fmt, std::vector<uint8>* output)
+      : PngIOCompress(fmt), m_data(output ? output : &m_own) { m_data->clear(); }
+    const uint8* data() const {return &(*m_data)[0];}
+    size_t size() const {return m_data->size();}
 
     static void write_fn( png_structp ctx, png_bytep data, png_size_t length )
     {
       Data *mgr = reinterpret_cast<Data*>(png_get_io_ptr(ctx));
-      mgr->m_data.insert(mgr->m_data.end(), data, data+length);
+      mgr->m_data->insert(mgr->m_data->end(), data, data+length);
     }
 
     static void flush_fn( png_structp /*ctx*/) {}
 };
 
 
-DstMemoryImageResourcePNG::DstMemoryImageResourcePNG(const ImageFormat& fmt)
-  : m_data(new Data(fmt))
+DstMemoryImageResourcePNG::DstMemoryImageResourcePNG(const ImageFormat& fmt, std::vector<uint8>* output)
+  : m_data(new Data(fmt, output))
 {
   m_data->open();
 }
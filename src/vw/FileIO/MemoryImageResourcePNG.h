@@ -19,6 +19,8 @@ namespace vw {
 
     public:
       SrcMemoryImageResourcePNG(boost::shared_array<const uint8> buffer, size_t len);
+      // Borrows buffer, which must outlive the resource.
+      SrcMemoryImageResourcePNG(const uint8* buffer, size_t len);
 
       virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const;
 
@@ -33,7 +35,9 @@ namespace vw {
       boost::shared_ptr<Data> m_data;
 
     public:
-      DstMemoryImageResourcePNG(const ImageFormat& fmt);
+      // Encodes into output if it is non-null (see
+      // DstMemoryImageResource::create()), and into a buffer of its own if not.
+      DstMemoryImageResourcePNG(const ImageFormat& fmt, std::vector<uint8>* output = 0);
 
       virtual void write( ImageBuffer const& buf, BBox2i const& bbox );
       virtual void flush() {}
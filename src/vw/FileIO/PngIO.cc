@@ -9,6 +9,12 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/Settings.h>
+#include <vw/Image/BlockProcessor.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <zlib.h>
 
 static void png_error_handler(png_structp /*png_ptr*/, png_const_charp error_msg)
 {
@@ -124,6 +130,217 @@ void PngIODecompress::open() {
   png_free_data(m_ctx, m_info, PNG_FREE_ROWS, 0);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Parallel deflate
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+  // The png filters, applied to byte i of a row given the byte a
+  // pixel to the left (a), above (b) and above-left (c).
+  inline uint8 png_filter_byte(int filter, uint8 x, uint8 a, uint8 b, uint8 c) {
+    switch (filter) {
+      case PNG_FILTER_VALUE_SUB:   return uint8(x - a);
+      case PNG_FILTER_VALUE_UP:    return uint8(x - b);
+      case PNG_FILTER_VALUE_AVG:   return uint8(x - ((int(a) + int(b)) >> 1));
+      case PNG_FILTER_VALUE_PAETH: {
+        int p = int(a) + int(b) - int(c);
+        int pa = std::abs(p - int(a)), pb = std::abs(p - int(b)), pc = std::abs(p - int(c));
+        return uint8(x - ((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c));
+      }
+      default:                     return x;
+    }
+  }
+
+  struct PngDeflateBand {
+    std::vector<uint8> deflated;
+    uLong adler;
+    uLong bytes;
+  };
+
+  // Filters and deflates a band of rows into its own raw deflate
+  // stream.  Each band ends on a byte boundary with a sync flush (the
+  // last one finishes the stream), so the bands can be concatenated.
+  class PngDeflateFunctor {
+    const uint8* m_rows;
+    size_t m_row_bytes, m_num_rows, m_pixel_bytes;
+    bool m_swap16, m_adaptive;
+    int m_level;
+    std::vector<PngDeflateBand>* m_bands;
+    size_t m_band_rows;
+
+    // Row y in png byte order, or zeros above the image.
+    void get_row(ptrdiff_t y, std::vector<uint8>& row) const {
+      row.resize(m_row_bytes);
+      if (y < 0) {
+        std::fill(row.begin(), row.end(), uint8(0));
+        return;
+      }
+      std::memcpy(&row[0], m_rows + y * m_row_bytes, m_row_bytes);
+      if (m_swap16)
+        for (size_t i = 0; i + 1 < m_row_bytes; i += 2)
+          std::swap(row[i], row[i+1]);
+    }
+
+    // Appends the filter byte and filtered bytes of cur, choosing the
+    // filter the way libpng does: the smallest sum of the bytes taken
+    // as signed values.
+    void filter_row(std::vector<uint8> const& cur, std::vector<uint8> const& prev, std::vector<uint8>& out) const {
+      int best = PNG_FILTER_VALUE_NONE;
+      if (m_adaptive) {
+        unsigned long best_sum = ~0ul;
+        for (int f = PNG_FILTER_VALUE_NONE; f <= PNG_FILTER_VALUE_PAETH; ++f) {
+          unsigned long sum = 0;
+          for (size_t i = 0; i < m_row_bytes && sum < best_sum; ++i) {
+            uint8 a = i >= m_pixel_bytes ? cur[i-m_pixel_bytes] : 0;
+            uint8 c = i >= m_pixel_bytes ? prev[i-m_pixel_bytes] : 0;
+            uint8 v = png_filter_byte(f, cur[i], a, prev[i], c);
+            sum += v < 128 ? v : 256 - v;
+          }
+          if (sum < best_sum) {
+            best_sum = sum;
+            best = f;
+          }
+        }
+      }
+      out.push_back(uint8(best));
+      for (size_t i = 0; i < m_row_bytes; ++i) {
+        uint8 a = i >= m_pixel_bytes ? cur[i-m_pixel_bytes] : 0;
+        uint8 c = i >= m_pixel_bytes ? prev[i-m_pixel_bytes] : 0;
+        out.push_back(png_filter_byte(best, cur[i], a, prev[i], c));
+      }
+    }
+
+    // The filtered rows [begin,end).
+    void filter_rows(size_t begin, size_t end, std::vector<uint8>& out) const {
+      std::vector<uint8> prev, cur;
+      get_row(ptrdiff_t(begin) - 1, prev);
+      out.reserve(out.size() + (end - begin) * (m_row_bytes + 1));
+      for (size_t y = begin; y < end; ++y) {
+        get_row(y, cur);
+        filter_row(cur, prev, out);
+        prev.swap(cur);
+      }
+    }
+
+  public:
+    PngDeflateFunctor(const uint8* rows, size_t row_bytes, size_t num_rows, size_t pixel_bytes,
+                      bool swap16, bool adaptive, int level,
+                      std::vector<PngDeflateBand>& bands, size_t band_rows)
+      : m_rows(rows), m_row_bytes(row_bytes), m_num_rows(num_rows), m_pixel_bytes(pixel_bytes),
+        m_swap16(swap16), m_adaptive(adaptive), m_level(level), m_bands(&bands), m_band_rows(band_rows) {}
+
+    void operator()(BBox2i const& bbox) const {
+      size_t begin = bbox.min().y(), end = bbox.max().y();
+      PngDeflateBand& band = (*m_bands)[begin / m_band_rows];
+      bool last = (end == m_num_rows);
+
+      std::vector<uint8> filtered;
+      filter_rows(begin, end, filtered);
+      band.bytes = uLong(filtered.size());
+      band.adler = adler32(adler32(0, Z_NULL, 0), &filtered[0], band.bytes);
+
+      z_stream strm;
+      std::memset(&strm, 0, sizeof(strm));
+      if (deflateInit2(&strm, m_level, Z_DEFLATED, -MAX_WBITS, 8,
+                       m_adaptive ? Z_FILTERED : Z_DEFAULT_STRATEGY) != Z_OK)
+        vw_throw(IOErr() << "PngIO: Failed to initialize zlib");
+
+      // Seed the dictionary with the rows before the band, as a single
+      // stream would have seen them, so splitting costs little ratio.
+      if (begin > 0) {
+        size_t window = size_t(1) << MAX_WBITS;
+        size_t context = std::min(begin, (window + m_row_bytes) / (m_row_bytes + 1) + 1);
+        std::vector<uint8> dictionary;
+        filter_rows(begin - context, begin, dictionary);
+        size_t n = std::min(window, dictionary.size());
+        deflateSetDictionary(&strm, &dictionary[dictionary.size() - n], uInt(n));
+      }
+
+      band.deflated.resize(deflateBound(&strm, band.bytes) + 16);
+      strm.next_in   = &filtered[0];
+      strm.avail_in  = uInt(filtered.size());
+      strm.next_out  = &band.deflated[0];
+      strm.avail_out = uInt(band.deflated.size());
+      int result = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+      size_t written = band.deflated.size() - strm.avail_out;
+      deflateEnd(&strm);
+      if (result != (last ? Z_STREAM_END : Z_OK) || strm.avail_in != 0 || strm.avail_out == 0)
+        vw_throw(IOErr() << "PngIO: Failed to compress rows " << begin << " to " << end << " (zlib error " << result << ")");
+      band.deflated.resize(written);
+    }
+  };
+
+  void png_write_idat(png_structp ctx, const uint8* data, size_t size) {
+    png_byte name[5] = "IDAT";
+    // Chunks the size libpng uses for big images.
+    const size_t chunk = 1 << 20;
+    for (size_t i = 0; i < size; i += chunk)
+      png_write_chunk(ctx, name, const_cast<png_bytep>(data + i), png_size_t(std::min(chunk, size - i)));
+  }
+
+} // anonymous namespace
+
+bool png_write_rows_parallel(png_structp ctx, png_infop info, const uint8* rows, size_t row_bytes,
+                             int compression_level, int num_threads) {
+  if (num_threads <= 0)
+    num_threads = vw_settings().default_num_threads();
+
+  png_uint_32 width, height;
+  int bit_depth, color_type, interlace_type, compression_type, filter_method;
+  png_get_IHDR(ctx, info, &width, &height, &bit_depth, &color_type, &interlace_type, &compression_type, &filter_method);
+
+  // Bands of at least 256kB, a few per thread.
+  const size_t min_band_bytes = 256 * 1024;
+  size_t band_rows = std::max((size_t(height) + 4*num_threads - 1) / (4*num_threads),
+                              (min_band_bytes + row_bytes - 1) / row_bytes);
+  if (num_threads < 2 || band_rows >= height || interlace_type != PNG_INTERLACE_NONE || bit_depth < 8)
+    return false;
+
+  size_t pixel_bytes = png_get_channels(ctx, info) * bit_depth / 8;
+  VW_ASSERT(pixel_bytes * width == row_bytes, LogicErr() << "PngIO: Row size does not match the png header");
+#if VW_BYTE_ORDER == VW_LITTLE_ENDIAN
+  bool swap16 = (bit_depth == 16);
+#else
+  bool swap16 = false;
+#endif
+  if (compression_level < 0 || compression_level > 9)
+    compression_level = Z_DEFAULT_COMPRESSION;
+
+  std::vector<PngDeflateBand> bands((height + band_rows - 1) / band_rows);
+  PngDeflateFunctor func(rows, row_bytes, height, pixel_bytes, swap16,
+                         color_type != PNG_COLOR_TYPE_PALETTE, compression_level, bands, band_rows);
+  BlockProcessor<PngDeflateFunctor> process(func, Vector2i(1, int32(band_rows)), num_threads);
+  process(BBox2i(0, 0, 1, height));
+
+  // The zlib header: 32k window, and the level hint zlib would give.
+  int level = compression_level == Z_DEFAULT_COMPRESSION ? 6 : compression_level;
+  int flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+  uint8 header[2] = { 0x78, uint8(flevel << 6) };
+  header[1] = uint8(header[1] + 31 - (header[0] * 256 + header[1]) % 31);
+
+  uLong adler = adler32(0, Z_NULL, 0);
+  size_t size = sizeof(header) + 4;
+  for (size_t i = 0; i < bands.size(); ++i) {
+    adler = adler32_combine(adler, bands[i].adler, bands[i].bytes);
+    size += bands[i].deflated.size();
+  }
+
+  std::vector<uint8> stream;
+  stream.reserve(size);
+  stream.insert(stream.end(), header, header + sizeof(header));
+  for (size_t i = 0; i < bands.size(); ++i) {
+    stream.insert(stream.end(), bands[i].deflated.begin(), bands[i].deflated.end());
+    std::vector<uint8>().swap(bands[i].deflated);
+  }
+  for (int shift = 24; shift >= 0; shift -= 8)
+    stream.push_back(uint8(adler >> shift));
+
+  png_write_idat(ctx, &stream[0], stream.size());
+  png_byte iend[5] = "IEND";
+  png_write_chunk(ctx, iend, NULL, 0);
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Compress
 ////////////////////////////////////////////////////////////////////////////////
@@ -159,6 +376,8 @@ void PngIOCompress::write(const uint8* data, size_t bufsize, size_t rows, size_t
     png_set_IHDR(m_ctx, m_info, cols, rows, bit_depth, color_type, interlace_type, compression_type, filter_method);
   }
   png_write_info(m_ctx, m_info);
+  if (png_write_rows_parallel(m_ctx, m_info, data, skip, 1))
+    return;
   png_set_swap(m_ctx);
 
   boost::scoped_array<png_bytep> row_pointers( new png_bytep[rows] );
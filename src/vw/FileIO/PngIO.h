@@ -42,6 +42,17 @@ class PngIODecompress : public PngIO, public ScanlineReadBackend {
     void read(uint8* data, size_t bufsize);
 };
 
+// Writes the image data and the end of a non-interlaced png, in place
+// of png_write_image() and png_write_end(), once png_write_info() has
+// been called.  Bands of rows are filtered and deflated on num_threads
+// threads (zero means default_num_threads()), each band seeded with
+// the end of the one before, and the pieces are joined into one zlib
+// stream.  rows holds the samples in native byte order, row_bytes
+// apart.  Returns false, having written nothing, when the image is
+// too small to be worth splitting; use libpng's writer then.
+bool png_write_rows_parallel(png_structp ctx, png_infop info, const uint8* rows, size_t row_bytes,
+                             int compression_level, int num_threads = 0);
+
 class PngIOCompress : public PngIO, public ScanlineWriteBackend {
   private:
     bool m_written;
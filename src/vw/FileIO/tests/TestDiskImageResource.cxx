@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <vw/FileIO.h>
 #include <vw/FileIO/DiskImageResource_internal.h>
+#include <vw/FileIO/MappedFile.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/config.h>
@@ -354,3 +355,134 @@ TEST( DiskImageResource, WrongFiles ) {
   EXPECT_THROW(r.reset(DiskImageResourcePBM::construct_open("rgb2x2.tif")),
                vw::ArgumentErr);
 }
+
+TEST( DiskImageResource, MapImage ) {
+  if ( !MappedFile::supported() ) return;
+
+  ImageView<PixelRGB<float> > img(5,3);
+  for ( int32 j = 0; j < img.rows(); ++j )
+    for ( int32 i = 0; i < img.cols(); ++i )
+      img(i,j) = PixelRGB<float>( float(i), float(j), float(i*j) );
+  UnlinkName fn("maptest.vwraw"), data("maptest.raw");
+  write_image( fn, img );
+
+  ImageView<PixelRGB<float> > mapped;
+  ASSERT_TRUE( map_image( mapped, fn ) );
+  ASSERT_EQ( mapped.cols(), img.cols() );
+  ASSERT_EQ( mapped.rows(), img.rows() );
+  EXPECT_RANGE_EQ( img.begin(), img.end(), mapped.begin(), mapped.end() );
+
+  // Writes to the mapping never reach the file.
+  mapped(0,0) = PixelRGB<float>(9,9,9);
+  ImageView<PixelRGB<float> > reread;
+  read_image( reread, fn );
+  EXPECT_EQ( reread(0,0), img(0,0) );
+
+  // Other pixel types are read, not mapped.
+  ImageView<PixelRGB<uint8> > other;
+  EXPECT_FALSE( map_image( other, fn ) );
+
+  // Raw images read any region.
+  DiskImageResourceRaw resource( fn );
+  ImageView<PixelRGB<float> > part(2,2);
+  resource.read( part.buffer(), BBox2i(2,1,2,2) );
+  EXPECT_EQ( part(0,0), img(2,1) );
+  EXPECT_EQ( part(1,1), img(3,2) );
+
+  // So do binary graymaps.
+  ImageView<PixelGray<uint8> > gray(4,3);
+  for ( int32 j = 0; j < gray.rows(); ++j )
+    for ( int32 i = 0; i < gray.cols(); ++i )
+      gray(i,j) = uint8( 20*i + 60*j );
+  UnlinkName pgm("maptest.pgm");
+  write_image( pgm, gray );
+  ImageView<uint8> mapped_gray;
+  ASSERT_TRUE( map_image( mapped_gray, pgm ) );
+  EXPECT_EQ( mapped_gray(3,2), 180 );
+}
+
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+TEST( DiskImageResource, ParallelPNG ) {
+  // Big enough to be deflated in bands on several threads.
+  uint32 threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 4 );
+
+  ImageView<PixelRGB<uint16> > rgb(700,900);
+  for ( int32 j = 0; j < rgb.rows(); ++j )
+    for ( int32 i = 0; i < rgb.cols(); ++i )
+      rgb(i,j) = PixelRGB<uint16>( uint16(i*97), uint16(j*31 + i), uint16((i*j) % 65521) );
+  ImageView<uint8> gray(1500,800);
+  for ( int32 j = 0; j < gray.rows(); ++j )
+    for ( int32 i = 0; i < gray.cols(); ++i )
+      gray(i,j) = uint8( (i/7 + j/5) % 17 * 15 );
+
+  UnlinkName rgb_fn("paralleltest-rgb.png"), gray_fn("paralleltest-gray.png");
+  write_image( rgb_fn, rgb );
+  write_image( gray_fn, gray );
+  vw_settings().set_default_num_threads( threads );
+
+  ImageView<PixelRGB<uint16> > rgb2;
+  read_image( rgb2, rgb_fn );
+  ASSERT_EQ( rgb.cols(), rgb2.cols() );
+  ASSERT_EQ( rgb.rows(), rgb2.rows() );
+  EXPECT_RANGE_EQ( rgb.begin(), rgb.end(), rgb2.begin(), rgb2.end() );
+
+  ImageView<uint8> gray2;
+  read_image( gray2, gray_fn );
+  ASSERT_EQ( gray.cols(), gray2.cols() );
+  ASSERT_EQ( gray.rows(), gray2.rows() );
+  EXPECT_RANGE_EQ( gray.begin(), gray.end(), gray2.begin(), gray2.end() );
+}
+#endif
+
+// Expects peek_format() to agree with the driver that open() picks.
+static void expect_peek_matches( std::string const& filename ) {
+  ImageFormat peeked = DiskImageResource::peek_format( filename );
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::open( filename ) );
+  ImageFormat opened = r->format();
+  EXPECT_EQ( opened.cols,          peeked.cols ) << filename;
+  EXPECT_EQ( opened.rows,          peeked.rows ) << filename;
+  EXPECT_EQ( opened.planes,        peeked.planes ) << filename;
+  EXPECT_EQ( opened.pixel_format,  peeked.pixel_format ) << filename;
+  EXPECT_EQ( opened.channel_type,  peeked.channel_type ) << filename;
+  EXPECT_EQ( opened.premultiplied, peeked.premultiplied ) << filename;
+}
+
+TEST( DiskImageResource, SniffAndPeek ) {
+  EXPECT_EQ( ".png", DiskImageResource::sniff_extension( "rgb2x2.png" ) );
+  EXPECT_EQ( ".jpg", DiskImageResource::sniff_extension( "rgb2x2.jpg" ) );
+  EXPECT_EQ( ".tif", DiskImageResource::sniff_extension( "rgb2x2.tif" ) );
+  EXPECT_EQ( "",     DiskImageResource::sniff_extension( "TestDiskImageResource.cxx" ) );
+  EXPECT_EQ( "",     DiskImageResource::sniff_extension( "nonfile.png" ) );
+
+  ImageView<PixelGray<uint8> > gray(5,3);
+  UnlinkName pgm("peektest.pgm");
+  write_image( pgm, gray );
+  EXPECT_EQ( ".pgm", DiskImageResource::sniff_extension( pgm ) );
+  expect_peek_matches( pgm );
+
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+  expect_peek_matches( "rgb2x2.png" );
+  expect_peek_matches( "rgb4x4_alpha.png" );
+  expect_peek_matches( "png16.png" );
+#endif
+#if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
+  expect_peek_matches( "rgb2x2.jpg" );
+  expect_peek_matches( "mural.jpg" );
+
+  // A misnamed file opens with the driver its contents call for.
+  UnlinkName misnamed("peektest-jpeg.pgm");
+  {
+    std::ifstream in( "rgb2x2.jpg", std::ios::binary );
+    std::ofstream out( misnamed.c_str(), std::ios::binary );
+    out << in.rdbuf();
+  }
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::open( misnamed ) );
+  EXPECT_EQ( "JPEG", r->type() );
+  expect_peek_matches( misnamed );
+#endif
+#if (defined(VW_HAVE_PKG_TIFF) && VW_HAVE_PKG_TIFF==1) || (defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1)
+  expect_peek_matches( "rgb2x2.tif" );
+  expect_peek_matches( "rgb4x4f_band.tif" );
+#endif
+}
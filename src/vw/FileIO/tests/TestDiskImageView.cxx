@@ -12,6 +12,9 @@
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageResourceJPEG.h>
+#include <test/Helpers.h>
 
 using namespace vw;
 
@@ -94,3 +97,83 @@ TEST( DiskCacheImageView, Construction ) {
 
 }
 #endif
+
+#if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
+TEST( DiskImageView, ReducedSubsample ) {
+  DiskImageView<PixelRGB<uint8> > view( TEST_SRCDIR"/mural.jpg" );
+  ImageView<PixelRGB<uint8> > full = subsample( ImageView<PixelRGB<uint8> >( view ), 4 );
+
+  // libjpeg decodes at a quarter of the size, so the pixels are
+  // averages rather than samples, but they should be close to both
+  // the samples and a separately scaled decode.
+  ImageView<PixelRGB<uint8> > reduced = subsample( view, 4 );
+  ASSERT_EQ( full.cols(), reduced.cols() );
+  ASSERT_EQ( full.rows(), reduced.rows() );
+
+  ImageView<PixelRGB<uint8> > scaled;
+  {
+    DiskImageResourceJPEG resource( TEST_SRCDIR"/mural.jpg", 4 );
+    read_image( scaled, resource );
+  }
+  EXPECT_RANGE_EQ( scaled.begin(), scaled.end(), reduced.begin(), reduced.end() );
+
+  // Factors without a common power of two above 2 sample a half
+  // size decode instead.
+  ImageView<PixelRGB<uint8> > mixed = subsample( view, 6, 4 );
+  EXPECT_EQ( full.rows(), mixed.rows() );
+  EXPECT_EQ( 1 + (view.cols()-1)/6, mixed.cols() );
+}
+
+TEST( DiskImageView, PooledFiles ) {
+  ImageView<PixelRGB<uint8> > mural, small;
+  read_image( mural, TEST_SRCDIR"/mural.jpg" );
+  read_image( small, TEST_SRCDIR"/rgb2x2.jpg" );
+
+  vw_settings().set_max_open_resources( 1 );
+  Cache::GeneratorStats before = DiskImageResourcePooled::pool().stats();
+  DiskImageView<PixelRGB<uint8> > a( TEST_SRCDIR"/mural.jpg", 0 ), b( TEST_SRCDIR"/rgb2x2.jpg", 0 );
+  EXPECT_EQ( mural.cols(), a.cols() );
+  EXPECT_EQ( small.rows(), b.rows() );
+
+  // With one file open at a time, each read reopens its file.
+  for( int i=0; i<2; ++i ) {
+    ImageView<PixelRGB<uint8> > image = a;
+    EXPECT_RANGE_EQ( mural.begin(), mural.end(), image.begin(), image.end() );
+    image = b;
+    EXPECT_RANGE_EQ( small.begin(), small.end(), image.begin(), image.end() );
+  }
+  Cache::GeneratorStats after = DiskImageResourcePooled::pool().stats();
+  EXPECT_LE( before.bytes_regenerated + 4, after.bytes_regenerated );
+  vw_settings().set_max_open_resources( 0 );
+}
+#endif
+
+TEST( DiskCacheImageView, Compressed ) {
+  ImageView<PixelRGB<float> > orig_image(300,200);
+  for( int32 y=0; y<orig_image.rows(); ++y )
+    for( int32 x=0; x<orig_image.cols(); ++x )
+      orig_image(x,y) = PixelRGB<float>( float(x), float(y), float(x*y % 7) );
+
+  DiskCacheImageView<PixelRGB<float> > image( orig_image, "vwcache" );
+  ASSERT_EQ( orig_image.cols(), image.cols() );
+  ASSERT_EQ( orig_image.rows(), image.rows() );
+  ASSERT_EQ( orig_image.planes(), image.planes() );
+
+  // Random access reaches into blocks out of order.
+  EXPECT_EQ( orig_image(299,199), image(299,199) );
+  EXPECT_EQ( orig_image(0,0), image(0,0) );
+  EXPECT_EQ( orig_image(150,37), image(150,37) );
+
+  ImageView<PixelRGB<float> > copy = image;
+  EXPECT_RANGE_EQ( orig_image.begin(), orig_image.end(), copy.begin(), copy.end() );
+
+  ImageView<PixelRGB<float> > cropped = crop( image, BBox2i(250,20,50,180) );
+  ImageView<PixelRGB<float> > expected = crop( orig_image, BBox2i(250,20,50,180) );
+  EXPECT_RANGE_EQ( expected.begin(), expected.end(), cropped.begin(), cropped.end() );
+
+  // Copies share the cache, and re-assignment makes a new one.
+  DiskCacheImageView<PixelRGB<float> > image2 = image;
+  image = orig_image + PixelRGB<float>(1,1,1);
+  EXPECT_EQ( orig_image(10,10), image2(10,10) );
+  EXPECT_EQ( orig_image(10,10) + PixelRGB<float>(1,1,1), image(10,10) );
+}
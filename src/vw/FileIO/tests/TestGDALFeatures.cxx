@@ -17,6 +17,8 @@ using namespace vw::test;
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
 
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <gdal_priv.h>
+#include <boost/filesystem/operations.hpp>
 
 TEST( GDALFeatures, NoDataValue ) {
   UnlinkName nodata("nodata.tif");
@@ -42,4 +44,41 @@ TEST( GDALFeatures, NoDataValue ) {
   EXPECT_EQ( -1, r_rsrc.nodata_read() );
 }
 
+TEST( GDALFeatures, CloudOptimized ) {
+  UnlinkName cog("cog.tif");
+
+  ImageView<float> image(100,70);
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      image(x,y) = float( x + 100*y );
+
+  {
+    DiskImageResourceGDAL::Options options;
+    options["COG"] = "YES";
+    DiskImageResourceGDAL w_rsrc( cog, image.format(), Vector2i(16,16), options );
+    block_write_image( w_rsrc, image );
+    w_rsrc.flush();
+  }
+  EXPECT_FALSE( boost::filesystem::exists( cog + ".vwcog.tif" ) );
+
+  ImageView<float> image_return;
+  DiskImageResourceGDAL r_rsrc( cog );
+  read_image( image_return, r_rsrc );
+  EXPECT_RANGE_EQ( image.begin(), image.end(), image_return.begin(), image_return.end() );
+
+  // Halving 100x70 until it fits a 16x16 block takes three overviews.
+  GDALRasterBand *band = r_rsrc.get_dataset_ptr()->GetRasterBand(1);
+  ASSERT_EQ( 3, band->GetOverviewCount() );
+  GDALRasterBand *half = band->GetOverview(0);
+  EXPECT_EQ( 50, half->GetXSize() );
+  EXPECT_EQ( 35, half->GetYSize() );
+  float corner[2];
+  ASSERT_EQ( CE_None, half->RasterIO( GF_Read, 0, 0, 2, 1, corner, 2, 1, GDT_Float32, 0, 0 ) );
+  EXPECT_EQ( 50.5, corner[0] );
+  EXPECT_EQ( 52.5, corner[1] );
+  GDALRasterBand *coarse = band->GetOverview(2);
+  EXPECT_EQ( 13, coarse->GetXSize() );
+  EXPECT_EQ( 9, coarse->GetYSize() );
+}
+
 #endif
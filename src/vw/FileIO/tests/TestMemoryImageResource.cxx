@@ -109,6 +109,39 @@ TEST_P(MemoryImageResourceTest, BasicWriteRead) {
   EXPECT_SEQ_NEAR(src, img1, 6);
 }
 
+TEST_P(MemoryImageResourceTest, ReuseOutput) {
+  typedef PixelRGBA<uint8> Px;
+  ImageView<Px> src(16,16);
+  for (int32 row = 0; row < src.rows(); ++row)
+    for (int32 col = 0; col < src.cols(); ++col)
+      src(col, row) = Px(64 + 4*row, 64 + 4*col, 128, 255);
+
+  std::string type(fs::extension(GetParam()));
+  vector<uint8> out;
+
+  boost::scoped_ptr<DstMemoryImageResource> dst;
+  ASSERT_NO_THROW(dst.reset(DstMemoryImageResource::create(type, src.format(), &out)));
+  EXPECT_NO_THROW(write_image(*dst, src));
+  ASSERT_FALSE(out.empty());
+  EXPECT_EQ(&out[0], dst->data());
+  EXPECT_EQ(out.size(), dst->size());
+
+  // A second image of the same size fits in what the first left behind.
+  vector<uint8> first(out);
+  const uint8* p = &out[0];
+  ASSERT_NO_THROW(dst.reset(DstMemoryImageResource::create(type, src.format(), &out)));
+  EXPECT_NO_THROW(write_image(*dst, src));
+  ASSERT_EQ(first.size(), out.size());
+  EXPECT_EQ(p, &out[0]);
+  EXPECT_TRUE(std::equal(first.begin(), first.end(), out.begin()));
+
+  boost::scoped_ptr<SrcImageResource> r;
+  ASSERT_NO_THROW(r.reset(SrcMemoryImageResource::open(type, &out[0], out.size())));
+  ImageView<Px> img;
+  read_image(img, *r);
+  EXPECT_SEQ_NEAR(src, img, 6);
+}
+
 vector<string> test_paths() {
   vector<string> v;
 #if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
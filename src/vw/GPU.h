@@ -21,6 +21,10 @@
 #include <vw/GPU/Manipulation.h>
 #include <vw/GPU/Statistics.h>
 #include <vw/GPU/Transform.h>
+#include <vw/GPU/ComputeImage.h>
+#include <vw/GPU/ComputeFilter.h>
+#include <vw/GPU/ComputeCorrelate.h>
+#include <vw/GPU/ComputeTile.h>
 
 
 #endif // __VW_IMAGE_H__
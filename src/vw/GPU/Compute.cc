@@ -0,0 +1,192 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/GPU/Compute.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/GPU/Shaders.h>
+#include <vw/Core/Log.h>
+
+namespace vw { namespace GPU {
+
+  void check_cl(cl_int status, const char* what) {
+    if (status != CL_SUCCESS)
+      vw_throw(ComputeErr() << what << " failed with OpenCL error " << status);
+  }
+
+  //########################################################################
+  //#    ComputeBuffer
+  //########################################################################
+
+  ComputeBuffer::ComputeBuffer(size_t size) : m_mem(0), m_size(size) {
+    cl_int status;
+    m_mem = clCreateBuffer(ComputeContext::instance().context(), CL_MEM_READ_WRITE,
+                           size ? size : 1, 0, &status);
+    check_cl(status, "clCreateBuffer");
+  }
+
+  ComputeBuffer::ComputeBuffer(size_t size, const void* data) : m_mem(0), m_size(size) {
+    cl_int status;
+    m_mem = clCreateBuffer(ComputeContext::instance().context(), CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                           size, const_cast<void*>(data), &status);
+    check_cl(status, "clCreateBuffer");
+  }
+
+  ComputeBuffer::~ComputeBuffer() {
+    // An upload may still be reading the host memory.  Commands that
+    // use the buffer itself hold their own reference to it.
+    if (m_host)
+      m_ready.wait();
+    if (m_mem) clReleaseMemObject(m_mem);
+  }
+
+  void ComputeBuffer::write_async(const void* data, boost::shared_ptr<const void> owner) {
+    ComputeWaitList wait;
+    wait(m_ready);
+    cl_event event;
+    check_cl(clEnqueueWriteBuffer(ComputeContext::instance().transfer_queue(), m_mem, CL_FALSE,
+                                  0, m_size, data, wait.size(), wait.events(), &event),
+             "clEnqueueWriteBuffer");
+    clFlush(ComputeContext::instance().transfer_queue());
+    m_ready = ComputeEvent(event);
+    m_host = owner;
+  }
+
+  ComputeEvent ComputeBuffer::read_async(void* data) const {
+    ComputeWaitList wait;
+    wait(m_ready);
+    cl_event event;
+    check_cl(clEnqueueReadBuffer(ComputeContext::instance().transfer_queue(), m_mem, CL_FALSE,
+                                 0, m_size, data, wait.size(), wait.events(), &event),
+             "clEnqueueReadBuffer");
+    clFlush(ComputeContext::instance().transfer_queue());
+    return ComputeEvent(event);
+  }
+
+  //########################################################################
+  //#    ComputeContext
+  //########################################################################
+
+  namespace {
+    RunOnce compute_once = VW_RUNONCE_INIT;
+    ComputeContext* compute_instance = 0;
+  }
+
+  void ComputeContext::init() { compute_instance = new ComputeContext(); }
+
+  ComputeContext& ComputeContext::instance() {
+    compute_once.run(init);
+    return *compute_instance;
+  }
+
+  ComputeContext::ComputeContext()
+    : m_platform(0), m_device(0), m_context(0), m_transfer_queue(0), m_compute_queue(0) {
+    cl_uint num_platforms = 0;
+    check_cl(clGetPlatformIDs(0, 0, &num_platforms), "clGetPlatformIDs");
+    VW_ASSERT(num_platforms > 0, ComputeErr() << "No OpenCL platforms found");
+    std::vector<cl_platform_id> platforms(num_platforms);
+    check_cl(clGetPlatformIDs(num_platforms, &platforms[0], 0), "clGetPlatformIDs");
+
+    for (int pass = 0; pass < 2 && !m_device; ++pass) {
+      const cl_device_type wanted = pass == 0 ? CL_DEVICE_TYPE_GPU : CL_DEVICE_TYPE_ALL;
+      for (cl_uint i = 0; i < num_platforms && !m_device; ++i) {
+        if (clGetDeviceIDs(platforms[i], wanted, 1, &m_device, 0) == CL_SUCCESS)
+          m_platform = platforms[i];
+        else
+          m_device = 0;
+      }
+    }
+    VW_ASSERT(m_device, ComputeErr() << "No OpenCL devices found");
+
+    char name[256] = "";
+    clGetDeviceInfo(m_device, CL_DEVICE_NAME, sizeof(name), name, 0);
+    vw_out(DebugMessage, "gpu") << "Using OpenCL device " << name << "\n";
+
+    cl_int status;
+    cl_context_properties props[] = { CL_CONTEXT_PLATFORM, (cl_context_properties)m_platform, 0 };
+    m_context = clCreateContext(props, 1, &m_device, 0, 0, &status);
+    check_cl(status, "clCreateContext");
+    m_transfer_queue = clCreateCommandQueue(m_context, m_device, 0, &status);
+    check_cl(status, "clCreateCommandQueue");
+    m_compute_queue = clCreateCommandQueue(m_context, m_device, 0, &status);
+    check_cl(status, "clCreateCommandQueue");
+
+    if (standard_shaders_map.empty())
+      init_standard_shaders();
+  }
+
+  ComputeContext::~ComputeContext() {
+    for (std::map<std::string, cl_program>::iterator i = m_programs.begin(); i != m_programs.end(); ++i)
+      clReleaseProgram(i->second);
+    if (m_compute_queue) clReleaseCommandQueue(m_compute_queue);
+    if (m_transfer_queue) clReleaseCommandQueue(m_transfer_queue);
+    if (m_context) clReleaseContext(m_context);
+  }
+
+  cl_kernel ComputeContext::create_kernel(std::string const& file, std::string const& kernel,
+                                          std::string const& options) {
+    cl_program program;
+    {
+      Mutex::Lock lock(m_programs_mutex);
+      const std::string key = file + " " + options;
+      std::map<std::string, cl_program>::iterator it = m_programs.find(key);
+      if (it != m_programs.end()) {
+        program = it->second;
+      } else {
+        std::map<std::string, const char*>::const_iterator src = standard_shaders_map.find("Compute/" + file);
+        VW_ASSERT(src != standard_shaders_map.end(), ComputeErr() << "No compute kernel source Compute/" << file);
+
+        cl_int status;
+        const char* source = src->second;
+        program = clCreateProgramWithSource(m_context, 1, &source, 0, &status);
+        check_cl(status, "clCreateProgramWithSource");
+        status = clBuildProgram(program, 1, &m_device, options.c_str(), 0, 0);
+        if (status != CL_SUCCESS) {
+          size_t log_size = 0;
+          clGetProgramBuildInfo(program, m_device, CL_PROGRAM_BUILD_LOG, 0, 0, &log_size);
+          std::string log(log_size, ' ');
+          if (log_size)
+            clGetProgramBuildInfo(program, m_device, CL_PROGRAM_BUILD_LOG, log_size, &log[0], 0);
+          clReleaseProgram(program);
+          vw_throw(ComputeErr() << "Building Compute/" << file << " failed:\n" << log);
+        }
+        m_programs[key] = program;
+      }
+    }
+
+    cl_int status;
+    cl_kernel k = clCreateKernel(program, kernel.c_str(), &status);
+    check_cl(status, "clCreateKernel");
+    return k;
+  }
+
+  void ComputeContext::finish() {
+    check_cl(clFinish(m_transfer_queue), "clFinish");
+    check_cl(clFinish(m_compute_queue), "clFinish");
+  }
+
+  //########################################################################
+  //#    ComputeLaunch
+  //########################################################################
+
+  ComputeEvent ComputeLaunch::run(size_t width, size_t height, ComputeWaitList const& wait) {
+    const size_t global[2] = { width ? width : 1, height ? height : 1 };
+    cl_event event;
+    check_cl(clEnqueueNDRangeKernel(ComputeContext::instance().compute_queue(), m_kernel, 2, 0,
+                                    global, 0, wait.size(), wait.events(), &event),
+             "clEnqueueNDRangeKernel");
+    // Work on the compute queue may wait for the transfer queue, so make
+    // sure both are moving.
+    clFlush(ComputeContext::instance().transfer_queue());
+    clFlush(ComputeContext::instance().compute_queue());
+    return ComputeEvent(event);
+  }
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
@@ -0,0 +1,161 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Compute.h
+///
+/// The OpenCL compute backend: one device, a queue for transfers and a
+/// queue for kernels (so uploads and downloads overlap with compute),
+/// and the buffers and events that tie them together.  The kernels are
+/// the Shaders/Compute/*.cl sources, built on first use.
+///
+#ifndef __VW_GPU_COMPUTE_H__
+#define __VW_GPU_COMPUTE_H__
+
+#include <vw/config.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#ifdef __APPLE__
+  #include <OpenCL/opencl.h>
+#else
+  #include <CL/cl.h>
+#endif
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace vw { namespace GPU {
+
+  VW_DEFINE_EXCEPTION(ComputeErr, Exception);
+
+  /// Throws a ComputeErr naming what failed if status isn't CL_SUCCESS.
+  void check_cl(cl_int status, const char* what);
+
+  /// A reference-counted cl_event.  A null event is always complete.
+  class ComputeEvent {
+    cl_event m_event;
+  public:
+    ComputeEvent() : m_event(0) {}
+    explicit ComputeEvent(cl_event event) : m_event(event) {} // takes ownership
+    ComputeEvent(ComputeEvent const& other) : m_event(other.m_event) { if (m_event) clRetainEvent(m_event); }
+    ComputeEvent& operator=(ComputeEvent const& other) {
+      if (other.m_event) clRetainEvent(other.m_event);
+      if (m_event) clReleaseEvent(m_event);
+      m_event = other.m_event;
+      return *this;
+    }
+    ~ComputeEvent() { if (m_event) clReleaseEvent(m_event); }
+
+    cl_event get() const { return m_event; }
+    void wait() const { if (m_event) check_cl(clWaitForEvents(1, &m_event), "clWaitForEvents"); }
+  };
+
+  /// The events a command has to wait for, as OpenCL wants them.
+  class ComputeWaitList {
+    std::vector<cl_event> m_events;
+  public:
+    ComputeWaitList& operator()(ComputeEvent const& event) {
+      if (event.get()) m_events.push_back(event.get());
+      return *this;
+    }
+    cl_uint size() const { return cl_uint(m_events.size()); }
+    const cl_event* events() const { return m_events.empty() ? 0 : &m_events[0]; }
+  };
+
+  /// A device buffer.  ready() is the event after which its contents
+  /// are valid; every command that writes the buffer replaces it.
+  class ComputeBuffer : private boost::noncopyable {
+    cl_mem m_mem;
+    size_t m_size;
+    ComputeEvent m_ready;
+    boost::shared_ptr<const void> m_host; // the source of a pending upload
+  public:
+    explicit ComputeBuffer(size_t size);
+    /// A buffer holding a copy of size bytes of data, made right away.
+    ComputeBuffer(size_t size, const void* data);
+    ~ComputeBuffer();
+
+    cl_mem mem() const { return m_mem; }
+    size_t size() const { return m_size; }
+    ComputeEvent const& ready() const { return m_ready; }
+    void set_ready(ComputeEvent const& event) { m_ready = event; }
+
+    /// Copies size() bytes from data to the buffer, on the transfer
+    /// queue, without waiting.  The buffer keeps owner (whatever holds
+    /// data) until the copy is done.
+    void write_async(const void* data, boost::shared_ptr<const void> owner);
+
+    /// Copies the buffer to data, on the transfer queue, once ready().
+    /// data must stay valid until the returned event completes.
+    ComputeEvent read_async(void* data) const;
+  };
+
+  /// The process-wide OpenCL device, context and queues.  The first
+  /// GPU device found is used, or the first device of any kind if
+  /// there is no GPU.
+  class ComputeContext : private boost::noncopyable {
+    cl_platform_id m_platform;
+    cl_device_id m_device;
+    cl_context m_context;
+    cl_command_queue m_transfer_queue, m_compute_queue;
+
+    Mutex m_programs_mutex;
+    std::map<std::string, cl_program> m_programs;
+
+    ComputeContext();
+    static void init();
+  public:
+    ~ComputeContext();
+    static ComputeContext& instance();
+
+    cl_context context() const { return m_context; }
+    cl_device_id device() const { return m_device; }
+    cl_command_queue transfer_queue() const { return m_transfer_queue; }
+    cl_command_queue compute_queue() const { return m_compute_queue; }
+
+    /// A new kernel object for the named kernel of Shaders/Compute/<file>,
+    /// which is built with options the first time it is asked for.
+    /// Kernels hold their arguments, so every launch gets its own.
+    cl_kernel create_kernel(std::string const& file, std::string const& kernel,
+                            std::string const& options = std::string());
+
+    /// Blocks until both queues are empty.
+    void finish();
+  };
+
+  /// Sets a kernel's arguments in order and runs it over a 2D range of
+  /// work items on the compute queue, after the given events.
+  class ComputeLaunch {
+    cl_kernel m_kernel;
+    cl_uint m_arg;
+  public:
+    ComputeLaunch(std::string const& file, std::string const& kernel,
+                  std::string const& options = std::string())
+      : m_kernel(ComputeContext::instance().create_kernel(file, kernel, options)), m_arg(0) {}
+    ~ComputeLaunch() { clReleaseKernel(m_kernel); }
+
+    template <class T>
+    ComputeLaunch& arg(T const& value) {
+      check_cl(clSetKernelArg(m_kernel, m_arg++, sizeof(T), &value), "clSetKernelArg");
+      return *this;
+    }
+    ComputeLaunch& arg(ComputeBuffer const& buffer) { return arg(buffer.mem()); }
+
+    ComputeEvent run(size_t width, size_t height, ComputeWaitList const& wait = ComputeWaitList());
+  };
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_GPU_COMPUTE_H__
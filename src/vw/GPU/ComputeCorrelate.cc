@@ -0,0 +1,115 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/GPU/ComputeCorrelate.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <sstream>
+
+namespace vw { namespace GPU {
+
+  namespace {
+    typedef boost::shared_ptr<ComputeBuffer> BufferPtr;
+
+    std::string cost_options(ComputeCostType cost) {
+      std::ostringstream options;
+      options << "-DCOST=" << (cost == NCC_COST ? 1 : 0);
+      return options.str();
+    }
+
+    // Sums of src over the (2*half+1)^2 window around each pixel.
+    BufferPtr box_sum(ComputeBuffer const& src, int32 w, int32 h, int32 half, std::string const& options) {
+      BufferPtr rows(new ComputeBuffer(src.size())), out(new ComputeBuffer(src.size()));
+      rows->set_ready(ComputeLaunch("correlation.cl", "box_rows", options)
+                      .arg(src).arg(*rows).arg(w).arg(h).arg(half)
+                      .run(w, h, ComputeWaitList()(src.ready())));
+      out->set_ready(ComputeLaunch("correlation.cl", "box_columns", options)
+                     .arg(*rows).arg(*out).arg(w).arg(h).arg(half)
+                     .run(w, h, ComputeWaitList()(rows->ready())));
+      return out;
+    }
+
+    BufferPtr box_sum_of_squares(ComputeBuffer const& src, int32 w, int32 h, int32 half, std::string const& options) {
+      ComputeBuffer squares(src.size());
+      squares.set_ready(ComputeLaunch("correlation.cl", "square", options)
+                        .arg(src).arg(squares).arg(w).arg(h)
+                        .run(w, h, ComputeWaitList()(src.ready())));
+      return box_sum(squares, w, h, half, options);
+    }
+  }
+
+  ComputeImage<PixelRGB<float> >
+  correlate(ComputeImage<PixelGray<float> > const& left, ComputeImage<PixelGray<float> > const& right,
+            int32 min_dx, int32 max_dx, int32 min_dy, int32 max_dy,
+            int32 kernel_half, ComputeCostType cost) {
+    VW_ASSERT(left.width() == right.width() && left.height() == right.height(),
+              ArgumentErr() << "correlate: the images must be the same size");
+    VW_ASSERT(min_dx <= max_dx && min_dy <= max_dy && kernel_half >= 0,
+              ArgumentErr() << "correlate: bad search range or kernel size");
+
+    const int32 w = left.width(), h = left.height();
+    const std::string options = cost_options(cost);
+
+    ComputeImage<PixelRGB<float> > best(w, h);
+    ComputeEvent last = ComputeLaunch("correlation.cl", "init_best", options)
+      .arg(best.buffer()).arg(w).arg(h).run(w, h);
+
+    // The window sums NCC needs don't depend on the disparity.  SAD
+    // never reads them, but the kernel's arguments must all be set.
+    BufferPtr left_sum, left_sq, right_sum, right_sq;
+    if (cost == NCC_COST) {
+      left_sum = box_sum(left.buffer(), w, h, kernel_half, options);
+      left_sq = box_sum_of_squares(left.buffer(), w, h, kernel_half, options);
+      right_sum = box_sum(right.buffer(), w, h, kernel_half, options);
+      right_sq = box_sum_of_squares(right.buffer(), w, h, kernel_half, options);
+    }
+    ComputeBuffer const& ls = left_sum ? *left_sum : left.buffer();
+    ComputeBuffer const& lq = left_sq ? *left_sq : left.buffer();
+    ComputeBuffer const& rs = right_sum ? *right_sum : right.buffer();
+    ComputeBuffer const& rq = right_sq ? *right_sq : right.buffer();
+
+    // One pair of scratch buffers serves every disparity: the compute
+    // queue runs in order, and each step waits for the one before it.
+    const size_t size = size_t(w) * h * sizeof(float);
+    ComputeBuffer terms(size), row_sums(size);
+    for (int32 dy = min_dy; dy <= max_dy; ++dy) {
+      for (int32 dx = min_dx; dx <= max_dx; ++dx) {
+        last = ComputeLaunch("correlation.cl", "cost_terms", options)
+          .arg(left.buffer()).arg(right.buffer()).arg(terms).arg(w).arg(h).arg(dx).arg(dy)
+          .run(w, h, ComputeWaitList()(last)(left.ready())(right.ready()));
+        last = ComputeLaunch("correlation.cl", "box_rows", options)
+          .arg(terms).arg(row_sums).arg(w).arg(h).arg(kernel_half)
+          .run(w, h, ComputeWaitList()(last));
+        last = ComputeLaunch("correlation.cl", "update_best", options)
+          .arg(row_sums).arg(best.buffer()).arg(w).arg(h).arg(kernel_half).arg(dx).arg(dy)
+          .arg(ls).arg(lq).arg(rs).arg(rq)
+          .run(w, h, ComputeWaitList()(last)(ls.ready())(lq.ready())(rs.ready())(rq.ready()));
+      }
+    }
+    best.buffer().set_ready(last);
+    return best;
+  }
+
+  ComputeImage<PixelRGB<float> >
+  cross_check(ComputeImage<PixelRGB<float> > const& left_result,
+              ComputeImage<PixelRGB<float> > const& right_result,
+              float threshold, float missing) {
+    VW_ASSERT(left_result.width() == right_result.width() && left_result.height() == right_result.height(),
+              ArgumentErr() << "cross_check: the results must be the same size");
+    const int32 w = left_result.width(), h = left_result.height();
+    ComputeImage<PixelRGB<float> > out(w, h);
+    out.buffer().set_ready(ComputeLaunch("correlation.cl", "cross_check", cost_options(SAD_COST))
+                           .arg(left_result.buffer()).arg(right_result.buffer()).arg(out.buffer())
+                           .arg(w).arg(h).arg(threshold).arg(missing)
+                           .run(w, h, ComputeWaitList()(left_result.ready())(right_result.ready())));
+    return out;
+  }
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
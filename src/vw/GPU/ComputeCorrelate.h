@@ -0,0 +1,51 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ComputeCorrelate.h
+///
+/// Window correlation of ComputeImages, the whole disparity search
+/// queued on the device at once.
+///
+#ifndef __VW_GPU_COMPUTECORRELATE_H__
+#define __VW_GPU_COMPUTECORRELATE_H__
+
+#include <vw/GPU/ComputeImage.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/Image/PixelTypes.h>
+
+namespace vw { namespace GPU {
+
+  enum ComputeCostType {
+    SAD_COST, ///< Sum of absolute differences
+    NCC_COST  ///< One minus the normalized cross correlation
+  };
+
+  /// The best disparity of each left pixel, over dx in [min_dx, max_dx]
+  /// and dy in [min_dy, max_dy], with windows of (2*kernel_half+1)^2
+  /// pixels: red is the score (lower is better), green dx and blue dy,
+  /// so that left (x,y) matches right (x+dx, y+dy).  Pixels whose
+  /// windows never fit in both images keep a score of FLT_MAX.
+  ComputeImage<PixelRGB<float> >
+  correlate(ComputeImage<PixelGray<float> > const& left, ComputeImage<PixelGray<float> > const& right,
+            int32 min_dx, int32 max_dx, int32 min_dy, int32 max_dy,
+            int32 kernel_half, ComputeCostType cost = SAD_COST);
+
+  /// Keeps the disparities of left_result (left to right) that
+  /// right_result (right to left, over the negated range) maps back to
+  /// within threshold pixels, and sets the rest to missing.
+  ComputeImage<PixelRGB<float> >
+  cross_check(ComputeImage<PixelRGB<float> > const& left_result,
+              ComputeImage<PixelRGB<float> > const& right_result,
+              float threshold, float missing);
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_GPU_COMPUTECORRELATE_H__
@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/GPU/ComputeFilter.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <sstream>
+
+namespace vw { namespace GPU {
+
+  namespace {
+    std::string build_options(int32 channels, int edge, int interp = 0) {
+      std::ostringstream options;
+      options << "-DCHANNELS=" << channels << " -DEDGE=" << edge;
+      if (interp)
+        options << " -DINTERP=" << interp;
+      return options.str();
+    }
+
+    size_t buffer_size(int32 w, int32 h, int32 channels) {
+      return size_t(w) * h * channels * sizeof(float);
+    }
+  }
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_convolution(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                      ImageView<float> const& kernel, int edge) {
+    VW_ASSERT(kernel.cols() > 0 && kernel.rows() > 0,
+              ArgumentErr() << "convolution_filter: the kernel is empty");
+    ImageView<float> taps = kernel;
+    ComputeBuffer kern(sizeof(float) * taps.cols() * taps.rows(), &taps(0, 0));
+
+    boost::shared_ptr<ComputeBuffer> out(new ComputeBuffer(buffer_size(w, h, channels)));
+    out->set_ready(ComputeLaunch("filter.cl", "convolution", build_options(channels, edge))
+                   .arg(src).arg(*out).arg(w).arg(h)
+                   .arg(kern).arg(int32(taps.cols())).arg(int32(taps.rows()))
+                   .run(w, h, ComputeWaitList()(src.ready())));
+    return out;
+  }
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_separable_convolution(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                                std::vector<float> const& h_kernel, std::vector<float> const& v_kernel,
+                                int edge) {
+    const std::string options = build_options(channels, edge);
+    const ComputeBuffer* input = &src;
+    boost::shared_ptr<ComputeBuffer> rows_out, out;
+
+    if (!h_kernel.empty()) {
+      ComputeBuffer kern(sizeof(float) * h_kernel.size(), &h_kernel[0]);
+      rows_out.reset(new ComputeBuffer(buffer_size(w, h, channels)));
+      rows_out->set_ready(ComputeLaunch("filter.cl", "convolution_rows", options)
+                          .arg(*input).arg(*rows_out).arg(w).arg(h)
+                          .arg(kern).arg(int32(h_kernel.size()))
+                          .run(w, h, ComputeWaitList()(input->ready())));
+      input = rows_out.get();
+      out = rows_out;
+    }
+
+    if (!v_kernel.empty()) {
+      ComputeBuffer kern(sizeof(float) * v_kernel.size(), &v_kernel[0]);
+      out.reset(new ComputeBuffer(buffer_size(w, h, channels)));
+      out->set_ready(ComputeLaunch("filter.cl", "convolution_columns", options)
+                     .arg(*input).arg(*out).arg(w).arg(h)
+                     .arg(kern).arg(int32(v_kernel.size()))
+                     .run(w, h, ComputeWaitList()(input->ready())));
+    }
+
+    VW_ASSERT(out, ArgumentErr() << "seperable_convolution_filter: both kernels are empty");
+    return out;
+  }
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_homography(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                     int32 out_w, int32 out_h, Matrix<float> const& H,
+                     int interp, int edge) {
+    boost::shared_ptr<ComputeBuffer> out(new ComputeBuffer(buffer_size(out_w, out_h, channels)));
+    out->set_ready(ComputeLaunch("transform.cl", "homography", build_options(channels, edge, interp))
+                   .arg(src).arg(w).arg(h).arg(*out).arg(out_w).arg(out_h)
+                   .arg(H(0,0)).arg(H(0,1)).arg(H(0,2))
+                   .arg(H(1,0)).arg(H(1,1)).arg(H(1,2))
+                   .arg(H(2,0)).arg(H(2,1)).arg(H(2,2))
+                   .run(out_w, out_h, ComputeWaitList()(src.ready())));
+    return out;
+  }
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
@@ -0,0 +1,215 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ComputeFilter.h
+///
+/// The filters and transforms of Filter.h and Transform.h, for
+/// ComputeImages.  Each one queues its kernels behind the uploads and
+/// kernels that produce its input, and returns without waiting.
+///
+#ifndef __VW_GPU_COMPUTEFILTER_H__
+#define __VW_GPU_COMPUTEFILTER_H__
+
+#include <vw/GPU/ComputeImage.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/GPU/Interpolation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Filter.h>
+#include <vw/Math/Matrix.h>
+
+#include <cmath>
+#include <vector>
+
+namespace vw { namespace GPU {
+
+  // The EDGE and INTERP values the kernels are built with.  (The
+  // traits in EdgeExtension.h come with GL texture setup.)
+
+  template <class EdgeT> struct ComputeEdgeT {};
+  template <> struct ComputeEdgeT<ZeroEdgeExtension> { static const int value = 0; };
+  template <> struct ComputeEdgeT<ConstantEdgeExtension> { static const int value = 1; };
+
+  template <class InterpT> struct ComputeInterpT {};
+  template <> struct ComputeInterpT<NearestPixelInterpolation> { static const int value = 1; };
+  template <> struct ComputeInterpT<BilinearInterpolation> { static const int value = 2; };
+
+  // The type-erased kernels, on buffers of w x h pixels of the given
+  // number of float channels.  Each returns the output buffer.
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_convolution(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                      ImageView<float> const& kernel, int edge);
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_separable_convolution(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                                std::vector<float> const& h_kernel, std::vector<float> const& v_kernel,
+                                int edge);
+
+  boost::shared_ptr<ComputeBuffer>
+  compute_homography(ComputeBuffer const& src, int32 w, int32 h, int32 channels,
+                     int32 out_w, int32 out_h, Matrix<float> const& homography,
+                     int interp, int edge);
+
+  // Convolution
+
+  /// Convolves image with kernel, whose origin is its centre.
+  template <class PixelT, class EdgeT>
+  inline ComputeImage<PixelT>
+  convolution_filter(ComputeImage<PixelT> const& image, ImageView<float> const& kernel, EdgeT) {
+    return ComputeImage<PixelT>(image.width(), image.height(),
+                                compute_convolution(image.buffer(), image.width(), image.height(), image.channels(),
+                                                    kernel, ComputeEdgeT<EdgeT>::value));
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  convolution_filter(ComputeImage<PixelT> const& image, ImageView<float> const& kernel) {
+    return convolution_filter(image, kernel, ZeroEdgeExtension());
+  }
+
+  /// Convolves image's rows with h_kernel, then its columns with
+  /// v_kernel.  An empty kernel skips its pass.
+  template <class PixelT, class EdgeT>
+  inline ComputeImage<PixelT>
+  seperable_convolution_filter(ComputeImage<PixelT> const& image,
+                               std::vector<float> const& h_kernel,
+                               std::vector<float> const& v_kernel, EdgeT) {
+    return ComputeImage<PixelT>(image.width(), image.height(),
+                                compute_separable_convolution(image.buffer(), image.width(), image.height(),
+                                                              image.channels(), h_kernel, v_kernel,
+                                                              ComputeEdgeT<EdgeT>::value));
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  seperable_convolution_filter(ComputeImage<PixelT> const& image,
+                               std::vector<float> const& h_kernel,
+                               std::vector<float> const& v_kernel) {
+    return seperable_convolution_filter(image, h_kernel, v_kernel, ZeroEdgeExtension());
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  gaussian_filter(ComputeImage<PixelT> const& image, float x_sigma, float y_sigma, int x_dim = 0, int y_dim = 0) {
+    std::vector<float> x_kernel, y_kernel;
+    generate_gaussian_kernel(x_kernel, x_sigma, x_dim);
+    generate_gaussian_kernel(y_kernel, y_sigma, y_dim);
+    return seperable_convolution_filter(image, x_kernel, y_kernel);
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  derivative_filter(ComputeImage<PixelT> const& image, int x_deriv, int y_deriv, int x_dim = 0, int y_dim = 0) {
+    std::vector<float> x_kernel, y_kernel;
+    generate_derivative_kernel(x_kernel, x_deriv, x_dim);
+    generate_derivative_kernel(y_kernel, y_deriv, y_dim);
+    return seperable_convolution_filter(image, x_kernel, y_kernel);
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  laplacian_filter(ComputeImage<PixelT> const& image) {
+    ImageView<float> kernel(3, 3);
+    kernel(0,0)=0; kernel(1,0)=1;  kernel(2,0)=0;
+    kernel(0,1)=1; kernel(1,1)=-4; kernel(2,1)=1;
+    kernel(0,2)=0; kernel(1,2)=1;  kernel(2,2)=0;
+    return convolution_filter(image, kernel);
+  }
+
+  // Transforms
+
+  /// Samples image at homography * p for each pixel p of a new_width x
+  /// new_height image (image's size if they are 0).
+  template <class PixelT, class InterpT, class EdgeT>
+  inline ComputeImage<PixelT>
+  fixed_homography_transform(ComputeImage<PixelT> const& image, Matrix<float> const& homography,
+                             InterpT, EdgeT, int32 new_width = 0, int32 new_height = 0) {
+    VW_ASSERT(homography.cols() == 3 && homography.rows() == 3,
+              ArgumentErr() << "fixed_homography_transform: the homography must be 3x3");
+    if (!new_width) new_width = image.width();
+    if (!new_height) new_height = image.height();
+    return ComputeImage<PixelT>(new_width, new_height,
+                                compute_homography(image.buffer(), image.width(), image.height(), image.channels(),
+                                                   new_width, new_height, homography,
+                                                   ComputeInterpT<InterpT>::value, ComputeEdgeT<EdgeT>::value));
+  }
+
+  template <class PixelT, class InterpT>
+  inline ComputeImage<PixelT>
+  fixed_homography_transform(ComputeImage<PixelT> const& image, Matrix<float> const& homography, InterpT) {
+    return fixed_homography_transform(image, homography, InterpT(), ZeroEdgeExtension());
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  fixed_homography_transform(ComputeImage<PixelT> const& image, Matrix<float> const& homography) {
+    return fixed_homography_transform(image, homography, DefaultInterpolation(), ZeroEdgeExtension());
+  }
+
+  /// Rotates image by theta about its centre.
+  template <class PixelT, class InterpT, class EdgeT>
+  inline ComputeImage<PixelT>
+  fixed_rotate(ComputeImage<PixelT> const& image, float theta, InterpT, EdgeT) {
+    const float cx = image.width() / 2.0, cy = image.height() / 2.0;
+    Matrix<float> h(3, 3);
+    h.set_identity();
+    h(0,0) = ::cos(theta); h(0,1) = ::sin(theta);  h(0,2) = cx - ::cos(theta)*cx - ::sin(theta)*cy;
+    h(1,0) = -::sin(theta); h(1,1) = ::cos(theta); h(1,2) = cy + ::sin(theta)*cx - ::cos(theta)*cy;
+    return fixed_homography_transform(image, h, InterpT(), EdgeT());
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  fixed_rotate(ComputeImage<PixelT> const& image, float theta) {
+    return fixed_rotate(image, theta, DefaultInterpolation(), ZeroEdgeExtension());
+  }
+
+  /// Scales image by the given factors into a new_width x new_height
+  /// image (the scaled size if they are 0).
+  template <class PixelT, class InterpT, class EdgeT>
+  inline ComputeImage<PixelT>
+  resample(ComputeImage<PixelT> const& image, float x_scale_factor, float y_scale_factor,
+           int32 new_width, int32 new_height, InterpT, EdgeT) {
+    Matrix<float> h(3, 3);
+    h.set_identity();
+    h(0,0) = 1 / x_scale_factor;
+    h(1,1) = 1 / y_scale_factor;
+    if (!new_width) new_width = int32(image.width() * x_scale_factor);
+    if (!new_height) new_height = int32(image.height() * y_scale_factor);
+    return fixed_homography_transform(image, h, InterpT(), EdgeT(), new_width, new_height);
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  resample(ComputeImage<PixelT> const& image, float x_scale_factor, float y_scale_factor) {
+    return resample(image, x_scale_factor, y_scale_factor, 0, 0, DefaultInterpolation(), ZeroEdgeExtension());
+  }
+
+  /// Shifts image by (x, y) pixels.
+  template <class PixelT, class InterpT, class EdgeT>
+  inline ComputeImage<PixelT>
+  translate(ComputeImage<PixelT> const& image, float x, float y, InterpT, EdgeT) {
+    Matrix<float> h(3, 3);
+    h.set_identity();
+    h(0,2) = -x;
+    h(1,2) = -y;
+    return fixed_homography_transform(image, h, InterpT(), EdgeT());
+  }
+
+  template <class PixelT>
+  inline ComputeImage<PixelT>
+  translate(ComputeImage<PixelT> const& image, float x, float y) {
+    return translate(image, x, y, DefaultInterpolation(), ZeroEdgeExtension());
+  }
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_GPU_COMPUTEFILTER_H__
@@ -0,0 +1,115 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ComputeImage.h
+///
+/// An image in an OpenCL device buffer, with the same interface as
+/// GPUImage: it is made from an ImageView (uploaded without waiting),
+/// handed to the filters, and written back to an ImageView or a file.
+///
+#ifndef __VW_GPU_COMPUTEIMAGE_H__
+#define __VW_GPU_COMPUTEIMAGE_H__
+
+#include <vw/GPU/Compute.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <vw/FileIO.h>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
+
+namespace vw { namespace GPU {
+
+  /// A device image of float pixels, their channels interleaved as in
+  /// an ImageView.  Copies share the same buffer, as GPUImages share a
+  /// texture.  Every command on the image is queued; only reading it
+  /// back to the host waits.
+  template <class PixelT>
+  class ComputeImage {
+    BOOST_STATIC_ASSERT((boost::is_same<typename PixelChannelType<PixelT>::type, float>::value));
+
+    int32 m_width, m_height;
+    boost::shared_ptr<ComputeBuffer> m_buffer;
+
+  public:
+    typedef PixelT pixel_type;
+
+    ComputeImage() : m_width(0), m_height(0) {}
+
+    ComputeImage(int32 w, int32 h)
+      : m_width(w), m_height(h), m_buffer(new ComputeBuffer(size_t(w) * h * sizeof(PixelT))) {}
+
+    /// An image whose pixels some command is going to write to buffer.
+    ComputeImage(int32 w, int32 h, boost::shared_ptr<ComputeBuffer> buffer)
+      : m_width(w), m_height(h), m_buffer(buffer) {}
+
+    /// Starts uploading image, and returns without waiting for it.
+    /// (The upload reads from a copy of image, which shares its pixels.)
+    ComputeImage(ImageView<PixelT> const& image)
+      : m_width(image.cols()), m_height(image.rows()),
+        m_buffer(new ComputeBuffer(size_t(image.cols()) * image.rows() * sizeof(PixelT))) {
+      if (m_width && m_height) {
+        boost::shared_ptr<ImageView<PixelT> > source(new ImageView<PixelT>(image));
+        m_buffer->write_async(&(*source)(0, 0), source);
+      }
+    }
+
+    int32 cols() const { return m_width; }
+    int32 rows() const { return m_height; }
+    int32 planes() const { return 1; }
+    int32 width() const { return m_width; }
+    int32 height() const { return m_height; }
+    static int32 channels() { return PixelNumChannels<PixelT>::value; }
+
+    ComputeBuffer& buffer() const {
+      VW_ASSERT(m_buffer, ComputeErr() << "ComputeImage: the image is empty");
+      return *m_buffer;
+    }
+    ComputeEvent const& ready() const { return buffer().ready(); }
+
+    /// Starts copying the image to dest, which is resized to fit and
+    /// must not be touched until the returned event completes.
+    ComputeEvent read_async(ImageView<PixelT>& dest) const {
+      dest.set_size(m_width, m_height);
+      if (!m_width || !m_height)
+        return ComputeEvent();
+      return buffer().read_async(&dest(0, 0));
+    }
+
+    void write_image_view(ImageView<PixelT>& dest) const {
+      read_async(dest).wait();
+    }
+
+    operator ImageView<PixelT>() const {
+      ImageView<PixelT> dest;
+      write_image_view(dest);
+      return dest;
+    }
+  };
+
+  template <class PixelT>
+  inline void read_image(ComputeImage<PixelT>& image, const std::string& filename) {
+    ImageView<PixelT> imageView;
+    read_image(imageView, filename);
+    image = imageView;
+  }
+
+  template <class PixelT>
+  inline void write_image(const std::string& filename, const ComputeImage<PixelT>& image) {
+    ImageView<PixelT> imageView;
+    image.write_image_view(imageView);
+    write_image(filename, imageView);
+  }
+
+}} // namespace vw::GPU
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_GPU_COMPUTEIMAGE_H__
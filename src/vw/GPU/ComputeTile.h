@@ -0,0 +1,214 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ComputeTile.h
+///
+/// Runs ComputeImage filters over views of any size, a device-sized
+/// tile at a time.  ComputeTileView is an ordinary lazy view, so it can
+/// go under block_rasterize() or straight to block_write_image(); each
+/// region it is asked for is cut into tiles, each read from the child
+/// with a halo around it, and the upload and filtering of one tile are
+/// queued while the tile before it is still on the device.
+///
+/// A filter is a functor that maps ComputeImage<PixelT> to an image of
+/// the same size, each output pixel depending only on inputs within
+/// halo() pixels of it.
+///
+#ifndef __VW_GPU_COMPUTETILE_H__
+#define __VW_GPU_COMPUTETILE_H__
+
+#include <vw/GPU/ComputeFilter.h>
+
+#if defined(VW_HAVE_PKG_OPENCL) && VW_HAVE_PKG_OPENCL==1
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/RasterizeFootprint.h>
+
+#include <list>
+
+namespace vw { namespace GPU {
+
+  // Filters
+
+  class ComputeConvolutionFunc {
+    ImageView<float> m_kernel;
+  public:
+    ComputeConvolutionFunc(ImageView<float> const& kernel) : m_kernel(kernel) {}
+    int32 halo() const { return (std::max)(m_kernel.cols(), m_kernel.rows()) / 2; }
+    template <class PixelT>
+    ComputeImage<PixelT> operator()(ComputeImage<PixelT> const& image) const {
+      return convolution_filter(image, m_kernel);
+    }
+  };
+
+  class ComputeSeparableConvolutionFunc {
+    std::vector<float> m_h_kernel, m_v_kernel;
+  public:
+    ComputeSeparableConvolutionFunc(std::vector<float> const& h_kernel, std::vector<float> const& v_kernel)
+      : m_h_kernel(h_kernel), m_v_kernel(v_kernel) {}
+    int32 halo() const { return int32((std::max)(m_h_kernel.size(), m_v_kernel.size()) / 2); }
+    template <class PixelT>
+    ComputeImage<PixelT> operator()(ComputeImage<PixelT> const& image) const {
+      return seperable_convolution_filter(image, m_h_kernel, m_v_kernel);
+    }
+  };
+
+  class ComputeGaussianFunc : public ComputeSeparableConvolutionFunc {
+    static std::vector<float> kernel(float sigma) {
+      std::vector<float> k;
+      generate_gaussian_kernel(k, sigma, 0);
+      return k;
+    }
+  public:
+    ComputeGaussianFunc(float x_sigma, float y_sigma)
+      : ComputeSeparableConvolutionFunc(kernel(x_sigma), kernel(y_sigma)) {}
+  };
+
+  // The view
+
+  namespace detail {
+    // A tile on its way through the device.  The input is kept until
+    // the tile is done so that releasing it never waits on its upload.
+    template <class PixelT>
+    struct ComputeTile {
+      BBox2i bbox;
+      ComputeImage<PixelT> input;
+      ImageView<PixelT> result;
+      ComputeEvent done;
+    };
+  }
+
+  template <class ImageT, class FuncT, class EdgeT = ZeroEdgeExtension>
+  class ComputeTileView : public ImageViewBase<ComputeTileView<ImageT, FuncT, EdgeT> > {
+    ImageT m_image;
+    FuncT m_func;
+    Vector2i m_tile_size;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<ComputeTileView> pixel_accessor;
+
+    ComputeTileView(ImageT const& image, FuncT const& func, Vector2i const& tile_size)
+      : m_image(image), m_func(func), m_tile_size(tile_size) {
+      VW_ASSERT(image.planes() == 1, ArgumentErr() << "ComputeTileView: multi-plane images are not supported");
+      VW_ASSERT(tile_size.x() > 0 && tile_size.y() > 0, ArgumentErr() << "ComputeTileView: bad tile size");
+    }
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline result_type operator()(int32 i, int32 j, int32 p = 0) const {
+      return prerasterize(BBox2i(i, j, 1, 1))(i, j, p);
+    }
+
+    ImageT const& child() const { return m_image; }
+    FuncT const& func() const { return m_func; }
+    Vector2i const& tile_size() const { return m_tile_size; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      ImageView<pixel_type> out(bbox.width(), bbox.height());
+      const int32 halo = m_func.halo();
+
+      // Results are read back into the tiles asynchronously, so they
+      // live in a list that doesn't move them.
+      typedef detail::ComputeTile<pixel_type> Tile;
+      std::list<Tile> in_flight;
+
+      std::vector<BBox2i> tiles = image_blocks(out, m_tile_size.x(), m_tile_size.y());
+      for (size_t t = 0; t <= tiles.size(); ++t) {
+        if (t < tiles.size()) {
+          BBox2i tile = tiles[t] + bbox.min();
+          BBox2i source = tile;
+          source.expand(halo);
+          ImageView<pixel_type> input = crop(edge_extend(m_image, EdgeT()), source);
+
+          in_flight.push_back(Tile());
+          Tile& queued = in_flight.back();
+          queued.bbox = tile;
+          queued.input = ComputeImage<pixel_type>(input);
+          queued.done = m_func(queued.input).read_async(queued.result);
+        }
+        // With the next tile queued behind it, finish the oldest one.
+        while (!in_flight.empty() && (in_flight.size() > 1 || t == tiles.size())) {
+          Tile& tile = in_flight.front();
+          tile.done.wait();
+          crop(out, tile.bbox - bbox.min()) =
+            crop(tile.result, BBox2i(halo, halo, tile.bbox.width(), tile.bbox.height()));
+          in_flight.pop_front();
+        }
+      }
+      return prerasterize_type(out, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()));
+    }
+
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  };
+
+  /// Filters image on the device a tile of at most tile_size at a
+  /// time, reading the pixels around it through the edge extension.
+  template <class ImageT, class FuncT, class EdgeT>
+  inline ComputeTileView<ImageT, FuncT, EdgeT>
+  compute_tiled(ImageViewBase<ImageT> const& image, FuncT const& func, EdgeT,
+                Vector2i const& tile_size = Vector2i(2048, 2048)) {
+    return ComputeTileView<ImageT, FuncT, EdgeT>(image.impl(), func, tile_size);
+  }
+
+  template <class ImageT, class FuncT>
+  inline ComputeTileView<ImageT, FuncT>
+  compute_tiled(ImageViewBase<ImageT> const& image, FuncT const& func,
+                Vector2i const& tile_size = Vector2i(2048, 2048)) {
+    return ComputeTileView<ImageT, FuncT>(image.impl(), func, tile_size);
+  }
+
+  template <class ImageT>
+  inline ComputeTileView<ImageT, ComputeGaussianFunc>
+  compute_gaussian_filter(ImageViewBase<ImageT> const& image, float x_sigma, float y_sigma) {
+    return compute_tiled(image, ComputeGaussianFunc(x_sigma, y_sigma));
+  }
+
+  template <class ImageT>
+  inline ComputeTileView<ImageT, ComputeConvolutionFunc>
+  compute_convolution_filter(ImageViewBase<ImageT> const& image, ImageView<float> const& kernel) {
+    return compute_tiled(image, ComputeConvolutionFunc(kernel));
+  }
+
+}} // namespace vw::GPU
+
+namespace vw {
+
+  /// The output buffer, plus the host side of the two tiles in flight
+  /// and what the child needs for one of them.
+  template <class ImageT, class FuncT, class EdgeT>
+  class RasterizeFootprint<GPU::ComputeTileView<ImageT, FuncT, EdgeT> > {
+    GPU::ComputeTileView<ImageT, FuncT, EdgeT> const& m_view;
+  public:
+    RasterizeFootprint(GPU::ComputeTileView<ImageT, FuncT, EdgeT> const& view) : m_view(view) {}
+    size_t operator()(BBox2i const& bbox) const {
+      typedef typename ImageT::pixel_type pixel_type;
+      if (bbox.empty()) return 0;
+      BBox2i tile(bbox.min(), bbox.min() + m_view.tile_size());
+      tile.crop(bbox);
+      tile.expand(m_view.func().halo());
+      return raster_bytes<pixel_type>(bbox, 1) + 4 * raster_bytes<pixel_type>(tile, 1)
+        + RasterizeFootprint<ImageT>(m_view.child())(tile);
+    }
+  };
+
+} // namespace vw
+
+#endif // VW_HAVE_PKG_OPENCL
+
+#endif // __VW_GPU_COMPUTETILE_H__
@@ -92,15 +92,15 @@ GPUImageBase seperable_convolution_filter(const GPUImageBase& image,
   if(v_kernel_size) {
       ShaderInvocation_SetupGLState(input->width(), input->height());
           // Program - Install
-          fAttributes[0] = h_kernel_size;
-          GPUProgram* program = create_gpu_program("Filter/convolution-rows", fAttributes);
+          fAttributes[0] = v_kernel_size;
+          GPUProgram* program = create_gpu_program("Filter/convolution-columns", fAttributes);
           program->install();
           // OUTPUT
           glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, output->target(), output->name(), 0);
           // INPUT
           program->set_input_image("image", *input);
-          program->set_input_image("kernel", hKernel);
-          program->set_input_float("halfSize", hKernel.width() / 2);
+          program->set_input_image("kernel", vKernel);
+          program->set_input_float("halfSize", vKernel.width() / 2);
           // DRAW
           ShaderInvocation_DrawRectOneTexture(*input);
           program->uninstall();
@@ -210,6 +210,11 @@ namespace GPU {
     void read(int x, int y, int w, int h, Tex_Format outputFormat, Tex_Type outputType, void* data) const
     { rasterize_homography(); m_texObj->read(x + m_xOffset, y + m_yOffset, w, h, outputFormat, outputType, data); }
 
+    // Starts a read() of the whole image in the background; the read
+    // itself then only waits for whatever of it hasn't finished.
+    void prefetch(Tex_Format outputFormat, Tex_Type outputType) const
+    { rasterize_homography(); m_texObj->prefetch(m_xOffset, m_yOffset, m_width, m_height, outputFormat, outputType); }
+
     GLuint target() const { return m_texObj->target(); }
 
     GLuint name() const { return m_texObj->name(); }
@@ -504,6 +509,13 @@ namespace GPU {
       read(get_format_for_pixelt(), cpu_type, &(image(0, 0)));
     }
 
+    /// Starts copying the image back to the host, so that a later
+    /// write_image_view() doesn't have to wait for all of it.  Call it
+    /// as soon as the result is drawn, and keep working on the GPU.
+    void prefetch() const {
+      GPUImageBase::prefetch(get_format_for_pixelt(), get_cpu_type_for_pixelt());
+    }
+
     // void rasterize(ImageView<PixelT>& image) {
     // Tex_Type gpu_type =  get_gpu_type_for_pixelt();
     // read(get_format_for_pixelt(), gpu_type, &(image(0, 0)));
@@ -112,6 +112,10 @@ namespace vw { namespace GPU {
     TexAlloc::set_recycling(value);
   }
 
+  void set_gpu_memory_pool_limit(int bytes) {
+    TexAlloc::set_pool_limit(bytes);
+  }
+
   void gpu_log(const char* string) {
     if(loggingEnabled) {
       gpuLogFile << string;
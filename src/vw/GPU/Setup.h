@@ -60,6 +60,9 @@ extern bool loggingEnabled;
 
  void set_gpu_memory_recycling(bool value);
 
+ // The most bytes of released textures kept for reuse (256MB by default).
+ void set_gpu_memory_pool_limit(int bytes);
+
  void set_shader_base_path(const std::string& path);
 
  void set_shader_assembly_cache_path(const std::string& path);
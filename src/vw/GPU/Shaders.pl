@@ -36,12 +36,17 @@ foreach my $filename (@files) {
   $filename =~ m#.*/Shaders/(.*)#;
   my $mapname = $1;
   open(IN, $filename);
-  print OUT "standard_shaders_map[\"", $mapname, "\"] = \" \\\n";
+  # One string literal per line, keeping the newlines: a // comment
+  # (like the license header) would otherwise swallow the whole
+  # shader, and preprocessor lines need them.
+  print OUT "standard_shaders_map[\"", $mapname, "\"] =\n";
   while (my $line = <IN>) {
     chomp($line);
-    print OUT $line, " \\\n";
+    $line =~ s/\\/\\\\/g;
+    $line =~ s/"/\\"/g;
+    print OUT "  \"", $line, "\\n\"\n";
   }
-  print OUT "\";\n\n";
+  print OUT "  \"\";\n\n";
 }
 
 # Print End Code
@@ -0,0 +1,127 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// Window correlation of single channel float images, a disparity at a
+// time: the per-pixel cost terms of a disparity are box-summed over
+// the window, and each pixel keeps the disparity of the lowest score
+// so far.  COST 0 scores with the sum of absolute differences, COST 1
+// with one minus the normalized cross correlation.  A best is three
+// floats: the score, dx and dy.  Left pixel (x,y) is matched with
+// right pixel (x+dx, y+dy).
+
+float fetch(__global const float* image, int w, int h, int x, int y) {
+  return image[clamp(y, 0, h - 1) * w + clamp(x, 0, w - 1)];
+}
+
+__kernel void init_best(__global float* best, int w, int h) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  const int i = (y * w + x) * 3;
+  best[i] = MAXFLOAT;
+  best[i + 1] = 0.0f;
+  best[i + 2] = 0.0f;
+}
+
+__kernel void square(__global const float* image, __global float* out, int w, int h) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  const float v = image[y * w + x];
+  out[y * w + x] = v * v;
+}
+
+__kernel void cost_terms(__global const float* left, __global const float* right,
+                         __global float* out, int w, int h, int dx, int dy) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  const float l = left[y * w + x], r = fetch(right, w, h, x + dx, y + dy);
+#if COST == 0
+  out[y * w + x] = fabs(l - r);
+#else
+  out[y * w + x] = l * r;
+#endif
+}
+
+__kernel void box_rows(__global const float* image, __global float* out, int w, int h, int half_size) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  float sum = 0.0f;
+  for (int i = max(x - half_size, 0); i <= min(x + half_size, w - 1); ++i)
+    sum += image[y * w + i];
+  out[y * w + x] = sum;
+}
+
+__kernel void box_columns(__global const float* image, __global float* out, int w, int h, int half_size) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  float sum = 0.0f;
+  for (int j = max(y - half_size, 0); j <= min(y + half_size, h - 1); ++j)
+    sum += image[j * w + x];
+  out[y * w + x] = sum;
+}
+
+// row_sums are the cost terms summed along each row of the window; the
+// window sums of the images and their squares are only used for NCC.
+__kernel void update_best(__global const float* row_sums, __global float* best,
+                          int w, int h, int half_size, int dx, int dy,
+                          __global const float* left_sum, __global const float* left_sq,
+                          __global const float* right_sum, __global const float* right_sq) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  const int rx = x + dx, ry = y + dy;
+  if (x - half_size < 0 || x + half_size >= w || y - half_size < 0 || y + half_size >= h ||
+      rx - half_size < 0 || rx + half_size >= w || ry - half_size < 0 || ry + half_size >= h)
+    return;
+
+  float sum = 0.0f;
+  for (int j = y - half_size; j <= y + half_size; ++j)
+    sum += row_sums[j * w + x];
+
+#if COST == 0
+  const float score = sum;
+#else
+  const float n = (2 * half_size + 1) * (2 * half_size + 1);
+  const float ml = left_sum[y * w + x] / n, mr = right_sum[ry * w + rx] / n;
+  const float vl = left_sq[y * w + x] - n * ml * ml, vr = right_sq[ry * w + rx] - n * mr * mr;
+  if (vl <= 0.0f || vr <= 0.0f)
+    return;
+  const float score = 1.0f - (sum - n * ml * mr) / sqrt(vl * vr);
+#endif
+
+  const int i = (y * w + x) * 3;
+  if (score < best[i]) {
+    best[i] = score;
+    best[i + 1] = dx;
+    best[i + 2] = dy;
+  }
+}
+
+// Keeps the left bests whose match in the right image points back to
+// within threshold of where it started, and marks the rest missing.
+__kernel void cross_check(__global const float* left_best, __global const float* right_best,
+                          __global float* out, int w, int h, float threshold, float missing) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  const int i = (y * w + x) * 3;
+  const int rx = x + (int)left_best[i + 1], ry = y + (int)left_best[i + 2];
+  bool ok = left_best[i] != MAXFLOAT && rx >= 0 && rx < w && ry >= 0 && ry < h;
+  if (ok) {
+    const int j = (ry * w + rx) * 3;
+    ok = right_best[j] != MAXFLOAT &&
+         fabs(left_best[i + 1] + right_best[j + 1]) <= threshold &&
+         fabs(left_best[i + 2] + right_best[j + 2]) <= threshold;
+  }
+  out[i] = ok ? left_best[i] : missing;
+  out[i + 1] = ok ? left_best[i + 1] : missing;
+  out[i + 2] = ok ? left_best[i + 2] : missing;
+}
@@ -0,0 +1,61 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// Convolution of images of CHANNELS interleaved float channels, with
+// zero (EDGE 0) or constant (EDGE 1) edge extension.  The kernel's
+// origin is its centre, and it is flipped, as in vw::convolution_filter.
+
+float fetch(__global const float* image, int w, int h, int x, int y, int c) {
+#if EDGE == 1
+  x = clamp(x, 0, w - 1);
+  y = clamp(y, 0, h - 1);
+#else
+  if (x < 0 || x >= w || y < 0 || y >= h)
+    return 0.0f;
+#endif
+  return image[(y * w + x) * CHANNELS + c];
+}
+
+__kernel void convolution(__global const float* image, __global float* out,
+                          int w, int h, __global const float* kern, int kw, int kh) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  for (int c = 0; c < CHANNELS; ++c) {
+    float sum = 0.0f;
+    for (int j = 0; j < kh; ++j)
+      for (int i = 0; i < kw; ++i)
+        sum += kern[j * kw + i] * fetch(image, w, h, x + kw / 2 - i, y + kh / 2 - j, c);
+    out[(y * w + x) * CHANNELS + c] = sum;
+  }
+}
+
+__kernel void convolution_rows(__global const float* image, __global float* out,
+                               int w, int h, __global const float* kern, int size) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  for (int c = 0; c < CHANNELS; ++c) {
+    float sum = 0.0f;
+    for (int i = 0; i < size; ++i)
+      sum += kern[i] * fetch(image, w, h, x + size / 2 - i, y, c);
+    out[(y * w + x) * CHANNELS + c] = sum;
+  }
+}
+
+__kernel void convolution_columns(__global const float* image, __global float* out,
+                                  int w, int h, __global const float* kern, int size) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= w || y >= h)
+    return;
+  for (int c = 0; c < CHANNELS; ++c) {
+    float sum = 0.0f;
+    for (int j = 0; j < size; ++j)
+      sum += kern[j] * fetch(image, w, h, x, y + size / 2 - j, c);
+    out[(y * w + x) * CHANNELS + c] = sum;
+  }
+}
@@ -0,0 +1,49 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// Homography transform of images of CHANNELS interleaved float
+// channels: each output pixel p samples the input at H p, with nearest
+// pixel (INTERP 1) or bilinear (INTERP 2) interpolation and zero
+// (EDGE 0) or constant (EDGE 1) edge extension.  Pixel centres are at
+// integer coordinates, as in vw::transform.
+
+float fetch(__global const float* image, int w, int h, int x, int y, int c) {
+#if EDGE == 1
+  x = clamp(x, 0, w - 1);
+  y = clamp(y, 0, h - 1);
+#else
+  if (x < 0 || x >= w || y < 0 || y >= h)
+    return 0.0f;
+#endif
+  return image[(y * w + x) * CHANNELS + c];
+}
+
+__kernel void homography(__global const float* image, int w, int h,
+                         __global float* out, int out_w, int out_h,
+                         float h00, float h01, float h02,
+                         float h10, float h11, float h12,
+                         float h20, float h21, float h22) {
+  const int x = get_global_id(0), y = get_global_id(1);
+  if (x >= out_w || y >= out_h)
+    return;
+  const float d = h20 * x + h21 * y + h22;
+  const float sx = (h00 * x + h01 * y + h02) / d;
+  const float sy = (h10 * x + h11 * y + h12) / d;
+  for (int c = 0; c < CHANNELS; ++c) {
+#if INTERP == 1
+    const float v = fetch(image, w, h, (int)floor(sx + 0.5f), (int)floor(sy + 0.5f), c);
+#else
+    const int x0 = (int)floor(sx), y0 = (int)floor(sy);
+    const float fx = sx - x0, fy = sy - y0;
+    const float v = (1 - fx) * (1 - fy) * fetch(image, w, h, x0, y0, c)
+                  + fx * (1 - fy) * fetch(image, w, h, x0 + 1, y0, c)
+                  + (1 - fx) * fy * fetch(image, w, h, x0, y0 + 1, c)
+                  + fx * fy * fetch(image, w, h, x0 + 1, y0 + 1, c);
+#endif
+    out[(y * out_w + x) * CHANNELS + c] = v;
+  }
+}
@@ -14,11 +14,15 @@ namespace vw { namespace GPU {
   //############################################################
 
   bool TexAlloc::isInit = false;
-  list<TexObj*> TexAlloc::texRecycleList;
+  TexAlloc::TexPool TexAlloc::texPool;
+  list<TexAlloc::TexPool::iterator> TexAlloc::texPoolOrder;
   int TexAlloc::allocatedCount = 0;
   int TexAlloc::allocatedSize = 0;
-  bool TexAlloc::recylingEnabled = false;
+  int TexAlloc::pooledSize = 0;
+  int TexAlloc::poolLimit = 256 * 1024 * 1024;
+  bool TexAlloc::recylingEnabled = true;
   std::map<pair<Tex_Format, Tex_Type>, pair<Tex_Format, Tex_Type> > TexAlloc::textureSubstitutesMap;
+  std::multimap<int, GLuint> TexAlloc::stagingPool;
 
   //#############################################################
   //                  TexAlloc: Class Functions
@@ -39,21 +43,15 @@ namespace vw { namespace GPU {
     // Try to find it in recycling if enabled...
     TexObj* texObj = NULL;
     if(recylingEnabled) {
-      TexObj* bestTex = NULL;
-      TexObj* cTex;
-      std::list<TexObj*>::iterator iter;
-      for(iter = texRecycleList.begin(); iter != texRecycleList.end(); iter++) {
-        cTex = *iter;
-        if(cTex->format() == realFormat && cTex->type() == realType && cTex->width() == w && cTex->height() == h)
-          bestTex = cTex;
-      }
-      if(bestTex) {
-        texRecycleList.remove(bestTex);
-        texObj = bestTex;
+      TexPool::iterator iter = texPool.find(TexKey(w, h, realFormat, realType));
+      if(iter != texPool.end()) {
+        texObj = iter->second;
+        texPoolOrder.remove(iter);
+        texPool.erase(iter);
+        pooledSize -= texObj->MemorySize();
         if(gpu_log_enabled()) {
-          sprintf(buffer, "+++ Creating Texture: { %s, %s, (%i x %i) } - RECYCLED from (%i x %i)    (Total Allocated: %.2fMB)\n",
-                  TexFormatToString(format), TexTypeToString(type), w, h, bestTex->width(), bestTex->height(),
-                  allocatedSize/1000000.0);
+          sprintf(buffer, "+++ Creating Texture: { %s, %s, (%i x %i) } - RECYCLED    (Total Allocated: %.2fMB)\n",
+                  TexFormatToString(format), TexTypeToString(type), w, h, allocatedSize/1000000.0);
           gpu_log(buffer);
         }
       }
@@ -81,13 +79,18 @@ namespace vw { namespace GPU {
 
   void
   TexAlloc::release(TexObj* texObj) {
-    if(recylingEnabled) {
-      texRecycleList.push_back(texObj);
+    texObj->discard_prefetch();
+    if(recylingEnabled && texObj->MemorySize() <= poolLimit) {
+      texPoolOrder.push_back(texPool.insert(std::make_pair(TexKey(texObj->width(), texObj->height(),
+                                                                  texObj->format(), texObj->type()), texObj)));
+      pooledSize += texObj->MemorySize();
       if(gpu_log_enabled()) {
         sprintf(buffer, "--- Recycling Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
                 TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
         gpu_log(buffer);
       }
+      while(pooledSize > poolLimit)
+        evict_oldest();
     }
     else {
       allocatedCount--;
@@ -101,20 +104,64 @@ namespace vw { namespace GPU {
     }
   }
 
+  void TexAlloc::evict_oldest() {
+    TexPool::iterator iter = texPoolOrder.front();
+    texPoolOrder.pop_front();
+    TexObj* texObj = iter->second;
+    texPool.erase(iter);
+    pooledSize -= texObj->MemorySize();
+    allocatedCount--;
+    allocatedSize -= texObj->MemorySize();
+    if(gpu_log_enabled()) {
+      sprintf(buffer, "--- Deleting Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
+              TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
+      gpu_log(buffer);
+    }
+    delete texObj;
+  }
+
   void TexAlloc::clear_recycled() {
-    std::list<TexObj*>::iterator iter;
-    for(iter = texRecycleList.begin(); iter != texRecycleList.end(); iter++) {
-      TexObj* texObj = *iter;
-      allocatedCount--;
-      allocatedSize -= texObj->MemorySize();
-      if(gpu_log_enabled()) {
-        sprintf(buffer, "--- Deleting Texture: { %s, %s, (%i x %i) }    (Total Allocated %.2fMB)\n",
-                TexFormatToString(texObj->format()), TexTypeToString(texObj->type()), texObj->width(), texObj->height(), allocatedSize/1000000.0);
-        gpu_log(buffer);
-      }
-      delete *iter;
+    while(!texPoolOrder.empty())
+      evict_oldest();
+    std::multimap<int, GLuint>::iterator iter;
+    for(iter = stagingPool.begin(); iter != stagingPool.end(); iter++)
+      glDeleteBuffers(1, &iter->second);
+    stagingPool.clear();
+  }
+
+  bool TexAlloc::staging_supported() {
+#ifdef __APPLE__
+    return true;
+#else
+    return GLEW_ARB_pixel_buffer_object;
+#endif
+  }
+
+  GLuint TexAlloc::acquire_staging(int size) {
+    if(!staging_supported())
+      return 0;
+    // Users respecify the storage, so any buffer will do, but one last
+    // used for the same size lets the driver recycle its memory too.
+    std::multimap<int, GLuint>::iterator iter = stagingPool.find(size);
+    if(iter == stagingPool.end())
+      iter = stagingPool.begin();
+    if(iter != stagingPool.end()) {
+      GLuint buffer = iter->second;
+      stagingPool.erase(iter);
+      return buffer;
     }
-    texRecycleList.clear();
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    return buffer;
+  }
+
+  void TexAlloc::release_staging(GLuint buffer, int size) {
+    if(!buffer)
+      return;
+    if(recylingEnabled)
+      stagingPool.insert(std::make_pair(size, buffer));
+    else
+      glDeleteBuffers(1, &buffer);
   }
 
   void TexAlloc::generate_texture_substitutions(bool verbose) {
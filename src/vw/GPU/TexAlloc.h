@@ -18,16 +18,36 @@ namespace GPU {
 
   class TexAlloc {
 
+    // Textures are pooled by everything that makes them interchangeable.
+    struct TexKey {
+      int width, height;
+      Tex_Format format;
+      Tex_Type type;
+      TexKey(int w, int h, Tex_Format f, Tex_Type t) : width(w), height(h), format(f), type(t) {}
+      bool operator<(const TexKey& o) const {
+        if(width != o.width) return width < o.width;
+        if(height != o.height) return height < o.height;
+        if(format != o.format) return format < o.format;
+        return type < o.type;
+      }
+    };
+    typedef std::multimap<TexKey, TexObj*> TexPool;
+
     // Class Variables
     static bool isInit;
-    static std::list<TexObj*> texRecycleList;
+    static TexPool texPool;
+    static std::list<TexPool::iterator> texPoolOrder; // least recently released first
     static int allocatedCount;
     static int allocatedSize;
+    static int pooledSize;
+    static int poolLimit;
     static bool recylingEnabled;
     static std::map<std::pair<Tex_Format, Tex_Type>, std::pair<Tex_Format, Tex_Type> > textureSubstitutesMap;
+    static std::multimap<int, GLuint> stagingPool;
 
     // Class Functions - Private
     static void initialize_texalloc();
+    static void evict_oldest();
 
   public:
 
@@ -38,10 +58,22 @@ namespace GPU {
     static void generate_texture_substitutions(bool verbose = false);
     static bool get_texture_substitution(Tex_Format inFormat, Tex_Type inType, Tex_Format& outFormat, Tex_Type& outType); \
 
+    // Staging buffers: pixel buffer objects for uploads and readbacks,
+    // which the driver transfers by DMA without making the caller wait.
+    // Whoever acquires one gives it size bytes of storage with
+    // glBufferData, and hands it back with the same size.
+    // acquire_staging returns 0 if the GL doesn't have them.
+    static bool staging_supported();
+    static GLuint acquire_staging(int size);
+    static void release_staging(GLuint buffer, int size);
+
     // Class Functions - Inline
     static void set_recycling(bool value) { recylingEnabled = value; if(!value) clear_recycled(); }
+    /// The most bytes of released textures kept for reuse.
+    static void set_pool_limit(int bytes) { poolLimit = bytes; while(pooledSize > poolLimit && !texPoolOrder.empty()) evict_oldest(); }
     static int get_allocated_count() { return allocatedCount; }
     static int get_allocated_size() { return allocatedSize; }
+    static int get_pooled_size() { return pooledSize; }
 
   private:
   };
@@ -14,7 +14,23 @@
 namespace vw {
 namespace GPU {
 
-#define USE_PBO false
+  // Uploads smaller than this many bytes aren't worth a staging buffer.
+  static const int min_staged_size = 64 * 1024;
+
+  static GLuint gl_type_for(Tex_Type type) {
+    return type == GPU_UINT8 ? GL_UNSIGNED_BYTE : GL_FLOAT;
+  }
+
+  static int transfer_size(int w, int h, Tex_Format format, Tex_Type type) {
+    int nComps;
+    if(format == GPU_RGBA)
+      nComps = 4;
+    else if(format == GPU_RGB)
+      nComps = 3;
+    else
+      nComps = 1;
+    return w * h * nComps * (type == GPU_UINT8 ? 1 : 4);
+  }
 
   //###################################################################
   //                     TexObj: Instance Functions
@@ -22,6 +38,7 @@ namespace GPU {
 
   TexObj::TexObj(int w, int h, Tex_Format internalFormat, Tex_Type internalType) {
     m_refCount = 0;
+    m_prefetch.buffer = 0;
     GLuint format_gl;
 
     if(internalFormat == GPU_DEPTH) {
@@ -94,6 +111,7 @@ namespace GPU {
   }
 
   TexObj::~TexObj() {
+    discard_prefetch();
     if(texName) {
       glDeleteTextures(1, &texName);
     }
@@ -111,6 +129,7 @@ namespace GPU {
   void TexObj::write(int x, int y, int w, int h,
                      Tex_Format inputFormat,
                      Tex_Type inputType, void* data) {
+    discard_prefetch();
     // FORMAT
     GLuint inputFormat_gl;
     if(inputFormat == GPU_RED && m_format == GPU_RED)
@@ -118,50 +137,65 @@ namespace GPU {
     else
       inputFormat_gl = inputFormat;
     // TYPE
-    GLuint type_gl;
-    if(inputType == GPU_FLOAT32)
-      type_gl = GL_FLOAT;
-    else if(inputType == GPU_FLOAT16) {
-      type_gl = GL_FLOAT;
-    }
-    else
-      type_gl = GL_UNSIGNED_BYTE;
-    // WRITE
-    if(USE_PBO) { // This code is supposed to speed up the CPU->GPU transfer, but it never quite seemed to work.
-      int nComps;
-      if(inputFormat == GPU_RGBA)
-        nComps = 4;
-      else if(inputFormat == GPU_RGB)
-        nComps = 3;
-      else
-        nComps = 1;
-      int texSize = w * h * inputType * nComps;
-      GLuint pboBuffer;
-      glGenBuffers(1, &pboBuffer);
-      glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, pboBuffer);
-
+    GLuint type_gl = gl_type_for(inputType);
+    // WRITE - through a staging buffer if it's big enough to matter, so
+    // the copy to the texture doesn't stall on pageable memory.  The
+    // buffer's storage is respecified each time, so a buffer the GPU
+    // is still reading from is never overwritten.
+    int texSize = transfer_size(w, h, inputFormat, inputType);
+    GLuint staging = texSize >= min_staged_size ? TexAlloc::acquire_staging(texSize) : 0;
+    glBindTexture(GL_TEXTURE_RECTANGLE_ARB, texName);
+    glGetError();
+    if(staging) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, staging);
       glBufferData(GL_PIXEL_UNPACK_BUFFER_ARB, texSize, NULL, GL_STREAM_DRAW);
       void* mappedTexPtr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY);
-      memcpy(mappedTexPtr, data, texSize);
-      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
-
-      glBindTexture(GL_TEXTURE_RECTANGLE_ARB, texName);
-      glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, x, y, w, h, inputFormat_gl, type_gl, 0);
+      if(mappedTexPtr) {
+        memcpy(mappedTexPtr, data, texSize);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER_ARB);
+        glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, x, y, w, h, inputFormat_gl, type_gl, 0);
+      }
       glBindBuffer(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
-      glDeleteBuffers(1, &pboBuffer);
+      TexAlloc::release_staging(staging, texSize);
+      if(!mappedTexPtr)
+        glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, x, y, w, h, inputFormat_gl, type_gl, data);
     }
-    {
-      glBindTexture(GL_TEXTURE_RECTANGLE_ARB, texName);
-      glGetError();
+    else {
       glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, x, y, w, h, inputFormat_gl, type_gl, data);
-      if(glGetError())
-        throw(Exception("[vw::GPU::TexObj::write()] gl error from glTexSubImage2D."));
     }
+    if(glGetError())
+      throw(Exception("[vw::GPU::TexObj::write()] gl error from glTexSubImage2D."));
+  }
+
+  // Attaches the texture to the framebuffer for glReadPixels.
+  static void bind_for_read(GLuint texName) {
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, g_framebuffer);
+    glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_RECTANGLE_ARB, texName, 0);
+    glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
+    glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+    if(!CheckFramebuffer(true))
+      throw(Exception("[vw::GPU::TexObj::read()] Framebuffer error."));
   }
 
   void TexObj::read(int x, int y, int w, int h,
                     Tex_Format outputFormat,
                     Tex_Type outputType, void* data) {
+    // A prefetch of this very region is (or soon will be) waiting in
+    // its staging buffer.
+    if(m_prefetch.buffer && m_prefetch.x == x && m_prefetch.y == y && m_prefetch.w == w && m_prefetch.h == h &&
+       m_prefetch.format == outputFormat && m_prefetch.type == outputType) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, m_prefetch.buffer);
+      void* mappedPtr = glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY);
+      if(mappedPtr) {
+        memcpy(data, mappedPtr, m_prefetch.size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+      }
+      glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+      discard_prefetch();
+      if(mappedPtr)
+        return;
+    }
+    discard_prefetch();
 
     // Format
     GLuint outFormat_gl;
@@ -170,20 +204,9 @@ namespace GPU {
     else
       outFormat_gl = outputFormat;
     // Type
-    GLuint outType_gl;
-    if(outputType == GPU_FLOAT32)
-      outType_gl = GL_FLOAT;
-    else if(outputType == GPU_FLOAT16)
-      outType_gl = GL_FLOAT;
-    else
-      outType_gl = GL_UNSIGNED_BYTE;
+    GLuint outType_gl = gl_type_for(outputType);
 
-    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, g_framebuffer);
-    glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_RECTANGLE_ARB, texName, 0);
-    glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
-    glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
-    if(!CheckFramebuffer(true))
-      throw(Exception("[vw::GPU::TexObj::read()] Framebuffer error."));
+    bind_for_read(texName);
     glGetError();
     glReadPixels(x, y, w, h, outFormat_gl, outType_gl, data);
     if(glGetError())
@@ -192,4 +215,49 @@ namespace GPU {
     glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
   }
 
+  void TexObj::prefetch(int x, int y, int w, int h,
+                        Tex_Format outputFormat,
+                        Tex_Type outputType) {
+    discard_prefetch();
+    int size = transfer_size(w, h, outputFormat, outputType);
+    GLuint staging = TexAlloc::acquire_staging(size);
+    if(!staging)
+      return;
+
+    GLuint outFormat_gl;
+    if(outputFormat == GPU_RED &&  m_format == GPU_RED)
+      outFormat_gl = GL_LUMINANCE;
+    else
+      outFormat_gl = outputFormat;
+
+    bind_for_read(texName);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, staging);
+    glBufferData(GL_PIXEL_PACK_BUFFER_ARB, size, NULL, GL_STREAM_READ);
+    glGetError();
+    glReadPixels(x, y, w, h, outFormat_gl, gl_type_for(outputType), 0);
+    bool failed = glGetError() != GL_NO_ERROR;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+    if(failed) {
+      TexAlloc::release_staging(staging, size);
+      return;
+    }
+
+    m_prefetch.buffer = staging;
+    m_prefetch.x = x;
+    m_prefetch.y = y;
+    m_prefetch.w = w;
+    m_prefetch.h = h;
+    m_prefetch.size = size;
+    m_prefetch.format = outputFormat;
+    m_prefetch.type = outputType;
+  }
+
+  void TexObj::discard_prefetch() {
+    if(m_prefetch.buffer) {
+      TexAlloc::release_staging(m_prefetch.buffer, m_prefetch.size);
+      m_prefetch.buffer = 0;
+    }
+  }
+
 }} // namespaces GPU, vw
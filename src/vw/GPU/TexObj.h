@@ -74,6 +74,13 @@ protected:
   int m_width;
   int m_height;
   int m_refCount;
+  // A readback started by prefetch(), waiting in a staging buffer.
+  struct Prefetch {
+    GLuint buffer;
+    int x, y, w, h, size;
+    Tex_Format format;
+    Tex_Type type;
+  } m_prefetch;
 public:
   TexObj(int w, int h, Tex_Format internalFormat, Tex_Type internalType);
 
@@ -130,6 +137,13 @@ public:
 
   void read(int x, int y, int w, int h, Tex_Format outputFormat, Tex_Type outputType, void* data);
 
+  // Starts reading the region back into a staging buffer, and returns
+  // without waiting.  A read() of the same region and format then
+  // copies it from there, as it was when prefetch() was called.
+  void prefetch(int x, int y, int w, int h, Tex_Format outputFormat, Tex_Type outputType);
+
+  void discard_prefetch();
+
 };
 
 } } // namespaces GPU, vw
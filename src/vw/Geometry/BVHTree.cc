@@ -0,0 +1,587 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Geometry/BVHTree.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace vw {
+namespace geometry {
+
+  namespace {
+    // Centroids are sorted into this many bins along the split axis,
+    // and the split is chosen among the boundaries between them.
+    const int32 NUM_BINS = 16;
+
+    // Subtrees of at least this many primitives are built on a thread
+    // of their own, down to the depth that keeps every thread busy.
+    const int32 PARALLEL_MIN_PRIMITIVES = 4096;
+
+    // The measure the surface area heuristic weighs a box by: its
+    // surface area in 3D, half its perimeter in 2D, and so on.
+    double box_area(const double *lo, const double *hi, int32 dim) {
+      if (dim == 1)
+        return hi[0] - lo[0];
+      double area = 0;
+      for (int32 i = 0; i < dim; ++i) {
+        double face = 1;
+        for (int32 j = 0; j < dim; ++j)
+          if (j != i)
+            face *= hi[j] - lo[j];
+        area += face;
+      }
+      return area;
+    }
+
+    void reset_box(double *lo, double *hi, int32 dim) {
+      std::fill(lo, lo + dim, std::numeric_limits<double>::max());
+      std::fill(hi, hi + dim, -std::numeric_limits<double>::max());
+    }
+
+    void grow_box(double *lo, double *hi, const double *plo, const double *phi, int32 dim) {
+      for (int32 a = 0; a < dim; ++a) {
+        lo[a] = std::min(lo[a], plo[a]);
+        hi[a] = std::max(hi[a], phi[a]);
+      }
+    }
+
+    // The distance from point to the nearest point of box.
+    double box_distance(const double *lo, const double *hi, BVHTree::VectorT const& point, int32 dim) {
+      double sum = 0;
+      for (int32 a = 0; a < dim; ++a) {
+        double d = std::max(std::max(lo[a] - point[a], point[a] - hi[a]), 0.0);
+        sum += d * d;
+      }
+      return sqrt(sum);
+    }
+
+    double bbox_distance(BVHTree::BBoxT const& bbox, BVHTree::VectorT const& point) {
+      return box_distance(&bbox.min()[0], &bbox.max()[0], point, bbox.min().size());
+    }
+
+    typedef std::pair<double, GeomPrimitive*> Candidate;
+
+    // Orders the k best so far with the worst on top of the heap.
+    bool nearer(Candidate const& a, Candidate const& b) { return a.first < b.first; }
+  }
+
+  // --------------------------------------------------------------
+  //                     BVHBuilder
+  // --------------------------------------------------------------
+
+  class BVHBuilder {
+  public:
+    typedef BVHTree::Node Node;
+
+    struct Subtree {
+      std::vector<Node> nodes;
+      std::vector<double> bounds;
+    };
+
+  private:
+    int32 m_dim, m_leaf_size, m_parallel_depth;
+    std::vector<double> m_prim_bounds; // 2*dim per primitive, as for nodes
+    std::vector<double> m_centroids;   // dim per primitive
+    std::vector<int32> m_order;
+
+    struct BuildTask {
+      BVHBuilder *builder;
+      int32 begin, end, depth;
+      Subtree *out;
+      void operator()() { builder->build(begin, end, depth, *out); }
+    };
+
+    // Which of NUM_BINS bins primitive p's centroid falls in.
+    struct BinOf {
+      const BVHBuilder *builder;
+      int32 axis;
+      double lo, scale;
+      int32 operator()(int32 p) const {
+        int32 bin = int32((builder->m_centroids[size_t(p) * builder->m_dim + axis] - lo) * scale);
+        return std::min(std::max(bin, 0), NUM_BINS - 1);
+      }
+    };
+
+    struct InLowerBins {
+      BinOf bin_of;
+      int32 split;
+      bool operator()(int32 p) const { return bin_of(p) <= split; }
+    };
+
+    struct CentroidLess {
+      const BVHBuilder *builder;
+      int32 axis;
+      bool operator()(int32 a, int32 b) const {
+        return builder->m_centroids[size_t(a) * builder->m_dim + axis] <
+               builder->m_centroids[size_t(b) * builder->m_dim + axis];
+      }
+    };
+
+    // Where to split m_order[begin, end), whose centroids span
+    // [clo, chi), after partitioning it there.
+    int32 partition(int32 begin, int32 end, std::vector<double> const& clo, std::vector<double> const& chi) {
+      const int32 dim = m_dim;
+      int32 axis = 0;
+      for (int32 a = 1; a < dim; ++a)
+        if (chi[a] - clo[a] > chi[axis] - clo[axis])
+          axis = a;
+      double extent = chi[axis] - clo[axis];
+
+      if (extent > 0) {
+        BinOf bin_of = { this, axis, clo[axis], NUM_BINS / extent };
+        int32 counts[NUM_BINS] = { 0 };
+        std::vector<double> bins(size_t(NUM_BINS) * 2 * dim);
+        for (int32 b = 0; b < NUM_BINS; ++b)
+          reset_box(&bins[2*dim*b], &bins[2*dim*b + dim], dim);
+        for (int32 i = begin; i < end; ++i) {
+          int32 p = m_order[i], b = bin_of(p);
+          counts[b]++;
+          grow_box(&bins[2*dim*b], &bins[2*dim*b + dim],
+                   &m_prim_bounds[size_t(p) * 2 * dim], &m_prim_bounds[size_t(p) * 2 * dim + dim], dim);
+        }
+
+        // The cost of splitting after bin s is the area of each side
+        // times the primitives in it.
+        double right_area[NUM_BINS];
+        int32 right_count[NUM_BINS];
+        std::vector<double> lo(dim), hi(dim);
+        reset_box(&lo[0], &hi[0], dim);
+        int32 count = 0;
+        for (int32 b = NUM_BINS - 1; b > 0; --b) {
+          if (counts[b])
+            grow_box(&lo[0], &hi[0], &bins[2*dim*b], &bins[2*dim*b + dim], dim);
+          count += counts[b];
+          right_count[b] = count;
+          right_area[b] = count ? box_area(&lo[0], &hi[0], dim) : 0;
+        }
+
+        int32 best_split = -1;
+        double best_cost = std::numeric_limits<double>::max();
+        reset_box(&lo[0], &hi[0], dim);
+        count = 0;
+        for (int32 s = 0; s < NUM_BINS - 1; ++s) {
+          if (counts[s])
+            grow_box(&lo[0], &hi[0], &bins[2*dim*s], &bins[2*dim*s + dim], dim);
+          count += counts[s];
+          if (count == 0 || right_count[s+1] == 0)
+            continue;
+          double cost = box_area(&lo[0], &hi[0], dim) * count + right_area[s+1] * right_count[s+1];
+          if (cost < best_cost) {
+            best_cost = cost;
+            best_split = s;
+          }
+        }
+
+        if (best_split >= 0) {
+          InLowerBins lower = { bin_of, best_split };
+          return int32(std::partition(m_order.begin() + begin, m_order.begin() + end, lower) - m_order.begin());
+        }
+      }
+
+      // Every centroid in one bin: split by count instead.
+      int32 mid = begin + (end - begin) / 2;
+      CentroidLess less = { this, axis };
+      std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end, less);
+      return mid;
+    }
+
+  public:
+    BVHBuilder(std::vector<GeomPrimitive*> const& prims, int32 dim, int32 leaf_size)
+      : m_dim(dim), m_leaf_size(std::max(leaf_size, 1)), m_parallel_depth(0),
+        m_prim_bounds(prims.size() * 2 * dim), m_centroids(prims.size() * dim), m_order(prims.size()) {
+      for (size_t p = 0; p < prims.size(); ++p) {
+        BVHTree::BBoxT const& bbox = prims[p]->bounding_box();
+        VW_ASSERT(int32(bbox.min().size()) == dim,
+                  ArgumentErr() << "BVHTree: primitives must all have the same dimension.");
+        for (int32 a = 0; a < dim; ++a) {
+          m_prim_bounds[p * 2 * dim + a] = bbox.min()[a];
+          m_prim_bounds[p * 2 * dim + dim + a] = bbox.max()[a];
+          m_centroids[p * dim + a] = (bbox.min()[a] + bbox.max()[a]) / 2;
+        }
+        m_order[p] = int32(p);
+      }
+      for (uint32 threads = 1; threads < vw_settings().default_num_threads(); threads *= 2)
+        m_parallel_depth++;
+    }
+
+    std::vector<int32> const& order() const { return m_order; }
+
+    // Appends the subtree over m_order[begin, end) to out.
+    void build(int32 begin, int32 end, int32 depth, Subtree &out) {
+      const int32 dim = m_dim;
+      const int32 self = int32(out.nodes.size());
+      out.nodes.push_back(Node());
+      out.bounds.resize(out.bounds.size() + 2 * dim);
+      double *lo = &out.bounds[size_t(self) * 2 * dim], *hi = lo + dim;
+
+      std::vector<double> clo(dim), chi(dim);
+      reset_box(lo, hi, dim);
+      reset_box(&clo[0], &chi[0], dim);
+      for (int32 i = begin; i < end; ++i) {
+        size_t p = m_order[i];
+        grow_box(lo, hi, &m_prim_bounds[p * 2 * dim], &m_prim_bounds[p * 2 * dim + dim], dim);
+        grow_box(&clo[0], &chi[0], &m_centroids[p * dim], &m_centroids[p * dim], dim);
+      }
+
+      if (end - begin <= m_leaf_size) {
+        out.nodes[self].first = begin;
+        out.nodes[self].count = end - begin;
+        return;
+      }
+
+      int32 mid = partition(begin, end, clo, chi);
+      out.nodes[self].count = 0;
+
+      if (depth < m_parallel_depth && end - begin >= PARALLEL_MIN_PRIMITIVES) {
+        Subtree left, right;
+        BuildTask task = { this, begin, mid, depth + 1, &left };
+        Thread thread(task);
+        build(mid, end, depth + 1, right);
+        thread.join();
+        out.nodes[self].first = 1 + int32(left.nodes.size());
+        out.nodes.insert(out.nodes.end(), left.nodes.begin(), left.nodes.end());
+        out.nodes.insert(out.nodes.end(), right.nodes.begin(), right.nodes.end());
+        out.bounds.insert(out.bounds.end(), left.bounds.begin(), left.bounds.end());
+        out.bounds.insert(out.bounds.end(), right.bounds.begin(), right.bounds.end());
+      } else {
+        build(begin, mid, depth + 1, out);
+        out.nodes[self].first = int32(out.nodes.size()) - self;
+        build(mid, end, depth + 1, out);
+      }
+    }
+  };
+
+  // --------------------------------------------------------------
+  //                     BVHTree
+  // --------------------------------------------------------------
+
+  BVHTree::BVHTree(std::vector<GeomPrimitive*> const& prims, int32 leaf_size) : m_dim(0) {
+    build(prims, leaf_size);
+  }
+
+  BVHTree::BVHTree(int32 num_primitives, GeomPrimitive **prims, int32 leaf_size) : m_dim(0) {
+    build(std::vector<GeomPrimitive*>(prims, prims + num_primitives), leaf_size);
+  }
+
+  void BVHTree::build(std::vector<GeomPrimitive*> const& prims, int32 leaf_size) {
+    if (prims.empty())
+      return;
+    m_dim = int32(prims[0]->bounding_box().min().size());
+
+    BVHBuilder builder(prims, m_dim, leaf_size);
+    BVHBuilder::Subtree tree;
+    tree.nodes.reserve(2 * prims.size() / std::max(leaf_size, 1) + 1);
+    tree.bounds.reserve(tree.nodes.capacity() * 2 * m_dim);
+    builder.build(0, int32(prims.size()), 0, tree);
+    m_nodes.swap(tree.nodes);
+    m_bounds.swap(tree.bounds);
+
+    m_prims.resize(prims.size());
+    for (size_t i = 0; i < prims.size(); ++i)
+      m_prims[i] = prims[builder.order()[i]];
+  }
+
+  BVHTree::BBoxT BVHTree::bounding_box() const {
+    BBoxT bbox;
+    if (m_nodes.empty())
+      return bbox;
+    VectorT lo(m_dim), hi(m_dim);
+    std::copy(&m_bounds[0], &m_bounds[0] + m_dim, lo.begin());
+    std::copy(&m_bounds[0] + m_dim, &m_bounds[0] + 2 * m_dim, hi.begin());
+    return BBoxT(lo, hi);
+  }
+
+  bool BVHTree::node_intersects(int32 node, BBoxT const& box) const {
+    const double *lo = &m_bounds[size_t(node) * 2 * m_dim], *hi = lo + m_dim;
+    for (int32 a = 0; a < m_dim; ++a)
+      if (lo[a] > box.max()[a] || hi[a] < box.min()[a])
+        return false;
+    return true;
+  }
+
+  bool BVHTree::node_contains(int32 node, VectorT const& point) const {
+    const double *lo = &m_bounds[size_t(node) * 2 * m_dim], *hi = lo + m_dim;
+    for (int32 a = 0; a < m_dim; ++a)
+      if (point[a] < lo[a] || point[a] > hi[a])
+        return false;
+    return true;
+  }
+
+  double BVHTree::node_distance(int32 node, VectorT const& point) const {
+    const double *lo = &m_bounds[size_t(node) * 2 * m_dim];
+    return box_distance(lo, lo + m_dim, point, m_dim);
+  }
+
+  void BVHTree::intersects_indices(BBoxT const& box, std::vector<int32> &indices) const {
+    if (m_nodes.empty())
+      return;
+    VW_ASSERT(int32(box.min().size()) == m_dim, ArgumentErr() << "BVHTree: box has the wrong dimension.");
+    std::vector<int32> stack(1, 0);
+    while (!stack.empty()) {
+      int32 node = stack.back();
+      stack.pop_back();
+      if (!node_intersects(node, box))
+        continue;
+      Node const& n = m_nodes[node];
+      if (n.count) {
+        for (int32 i = n.first; i < n.first + n.count; ++i)
+          if (m_prims[i]->bounding_box().intersects(box))
+            indices.push_back(i);
+      } else {
+        stack.push_back(node + n.first);
+        stack.push_back(node + 1);
+      }
+    }
+  }
+
+  void BVHTree::intersects(BBoxT const& box, std::vector<GeomPrimitive*> &prims) const {
+    std::vector<int32> indices;
+    intersects_indices(box, indices);
+    for (size_t i = 0; i < indices.size(); ++i)
+      prims.push_back(m_prims[indices[i]]);
+  }
+
+  void BVHTree::contains(VectorT const& point, std::vector<GeomPrimitive*> &prims) const {
+    if (m_nodes.empty())
+      return;
+    VW_ASSERT(int32(point.size()) == m_dim, ArgumentErr() << "BVHTree: point has the wrong dimension.");
+    std::vector<int32> stack(1, 0);
+    while (!stack.empty()) {
+      int32 node = stack.back();
+      stack.pop_back();
+      if (!node_contains(node, point))
+        continue;
+      Node const& n = m_nodes[node];
+      if (n.count) {
+        for (int32 i = n.first; i < n.first + n.count; ++i)
+          if (m_prims[i]->bounding_box().contains(point) && m_prims[i]->contains(point))
+            prims.push_back(m_prims[i]);
+      } else {
+        stack.push_back(node + n.first);
+        stack.push_back(node + 1);
+      }
+    }
+  }
+
+  // Best first: nodes come off the queue nearest first, and the search
+  // stops when the nearest left is further than the k-th best so far.
+  void BVHTree::nearest_within(VectorT const& point, size_t k, double max_distance,
+                               std::vector<Candidate> &best) const {
+    best.clear();
+    if (m_nodes.empty() || k == 0)
+      return;
+    VW_ASSERT(int32(point.size()) == m_dim, ArgumentErr() << "BVHTree: point has the wrong dimension.");
+
+    typedef std::pair<double, int32> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+    queue.push(Entry(node_distance(0, point), 0));
+
+    while (!queue.empty()) {
+      double bound = best.size() == k ? best.front().first : max_distance;
+      Entry entry = queue.top();
+      queue.pop();
+      if (entry.first > bound)
+        break;
+
+      Node const& n = m_nodes[entry.second];
+      if (n.count) {
+        for (int32 i = n.first; i < n.first + n.count; ++i) {
+          bound = best.size() == k ? best.front().first : max_distance;
+          if (bbox_distance(m_prims[i]->bounding_box(), point) > bound)
+            continue;
+          double distance = m_prims[i]->distance(point);
+          if (distance > bound || (best.size() == k && distance == bound))
+            continue;
+          if (best.size() == k) {
+            std::pop_heap(best.begin(), best.end(), nearer);
+            best.pop_back();
+          }
+          best.push_back(Candidate(distance, m_prims[i]));
+          std::push_heap(best.begin(), best.end(), nearer);
+        }
+      } else {
+        int32 children[2] = { entry.second + 1, entry.second + n.first };
+        for (int32 c = 0; c < 2; ++c) {
+          double distance = node_distance(children[c], point);
+          if (distance <= bound)
+            queue.push(Entry(distance, children[c]));
+        }
+      }
+    }
+    std::sort_heap(best.begin(), best.end(), nearer);
+  }
+
+  GeomPrimitive *BVHTree::closest(VectorT const& point, double distance_threshold, double *distance) const {
+    std::vector<Candidate> best;
+    nearest_within(point, 1, distance_threshold < 0 ? std::numeric_limits<double>::max() : distance_threshold, best);
+    if (best.empty()) {
+      if (distance)
+        *distance = -1;
+      return 0;
+    }
+    if (distance)
+      *distance = best[0].first;
+    return best[0].second;
+  }
+
+  void BVHTree::nearest(VectorT const& point, size_t k, std::vector<GeomPrimitive*> &prims,
+                        std::vector<double> *distances) const {
+    std::vector<Candidate> best;
+    nearest_within(point, k, std::numeric_limits<double>::max(), best);
+    prims.resize(best.size());
+    for (size_t i = 0; i < best.size(); ++i)
+      prims[i] = best[i].second;
+    if (distances) {
+      distances->resize(best.size());
+      for (size_t i = 0; i < best.size(); ++i)
+        (*distances)[i] = best[i].first;
+    }
+  }
+
+  void BVHTree::overlap_pairs(std::vector<PairT> &overlaps) const {
+    // Each primitive is only paired with those after it in m_prims,
+    // so that each pair is found once.
+    std::vector<int32> indices;
+    for (int32 i = 0; i < int32(m_prims.size()); ++i) {
+      indices.clear();
+      intersects_indices(m_prims[i]->bounding_box(), indices);
+      for (size_t j = 0; j < indices.size(); ++j)
+        if (indices[j] > i && m_prims[i]->intersects(m_prims[indices[j]]))
+          overlaps.push_back(PairT(m_prims[i], m_prims[indices[j]]));
+    }
+  }
+
+  // --------------------------------------------------------------
+  //                     Batched queries
+  // --------------------------------------------------------------
+
+  namespace {
+    struct IntersectsBatch {
+      typedef void result_type;
+      BVHTree const *tree;
+      std::vector<BVHTree::BBoxT> const *boxes;
+      std::vector<std::vector<GeomPrimitive*> > *prims;
+      size_t begin, end;
+      void operator()() const {
+        for (size_t i = begin; i < end; ++i)
+          tree->intersects((*boxes)[i], (*prims)[i]);
+      }
+    };
+
+    struct NearestBatch {
+      typedef void result_type;
+      BVHTree const *tree;
+      std::vector<BVHTree::VectorT> const *points;
+      size_t k;
+      std::vector<std::vector<GeomPrimitive*> > *prims;
+      size_t begin, end;
+      void operator()() const {
+        for (size_t i = begin; i < end; ++i)
+          tree->nearest((*points)[i], k, (*prims)[i]);
+      }
+    };
+
+    // Runs batch over [0, size) in one contiguous chunk per thread.
+    template <class BatchT>
+    void run_batches(BatchT batch, size_t size) {
+      size_t threads = std::max<size_t>(1, vw_settings().default_num_threads());
+      size_t chunk = (size + threads - 1) / threads;
+      if (threads == 1 || size < 2) {
+        batch.begin = 0;
+        batch.end = size;
+        batch();
+        return;
+      }
+      FifoWorkQueue queue((int(threads)));
+      std::vector<Future<void> > futures;
+      for (size_t begin = 0; begin < size; begin += chunk) {
+        batch.begin = begin;
+        batch.end = std::min(begin + chunk, size);
+        futures.push_back(queue.submit(batch));
+      }
+      when_all(futures);
+    }
+  }
+
+  void BVHTree::intersects(std::vector<BBoxT> const& boxes,
+                           std::vector<std::vector<GeomPrimitive*> > &prims) const {
+    prims.clear();
+    prims.resize(boxes.size());
+    IntersectsBatch batch = { this, &boxes, &prims, 0, 0 };
+    run_batches(batch, boxes.size());
+  }
+
+  void BVHTree::nearest(std::vector<VectorT> const& points, size_t k,
+                        std::vector<std::vector<GeomPrimitive*> > &prims) const {
+    prims.clear();
+    prims.resize(points.size());
+    NearestBatch batch = { this, &points, k, &prims, 0, 0 };
+    run_batches(batch, points.size());
+  }
+
+  // --------------------------------------------------------------
+  //                     Checking
+  // --------------------------------------------------------------
+
+  bool BVHTree::check(std::ostream &os) const {
+    if (m_nodes.empty())
+      return m_prims.empty();
+
+    std::vector<int32> seen(m_prims.size(), 0);
+    std::vector<int32> stack(1, 0);
+    bool ok = true;
+    while (!stack.empty()) {
+      int32 node = stack.back();
+      stack.pop_back();
+      const double *lo = &m_bounds[size_t(node) * 2 * m_dim], *hi = lo + m_dim;
+      Node const& n = m_nodes[node];
+
+      std::vector<double> inner_lo(m_dim), inner_hi(m_dim);
+      reset_box(&inner_lo[0], &inner_hi[0], m_dim);
+      if (n.count) {
+        for (int32 i = n.first; i < n.first + n.count; ++i) {
+          seen[i]++;
+          BBoxT const& bbox = m_prims[i]->bounding_box();
+          grow_box(&inner_lo[0], &inner_hi[0], &bbox.min()[0], &bbox.max()[0], m_dim);
+        }
+      } else {
+        int32 children[2] = { node + 1, node + n.first };
+        for (int32 c = 0; c < 2; ++c) {
+          if (children[c] <= node || children[c] >= int32(m_nodes.size())) {
+            os << "BVHTree: node " << node << " has a bad child " << children[c] << "\n";
+            return false;
+          }
+          const double *clo = &m_bounds[size_t(children[c]) * 2 * m_dim];
+          grow_box(&inner_lo[0], &inner_hi[0], clo, clo + m_dim, m_dim);
+          stack.push_back(children[c]);
+        }
+      }
+      for (int32 a = 0; a < m_dim; ++a) {
+        if (inner_lo[a] < lo[a] || inner_hi[a] > hi[a]) {
+          os << "BVHTree: node " << node << " does not bound its contents\n";
+          ok = false;
+          break;
+        }
+      }
+    }
+    for (size_t i = 0; i < seen.size(); ++i) {
+      if (seen[i] != 1) {
+        os << "BVHTree: primitive " << i << " is in " << seen[i] << " leaves\n";
+        ok = false;
+      }
+    }
+    return ok;
+  }
+
+}} // namespace vw::geometry
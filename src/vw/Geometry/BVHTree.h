@@ -0,0 +1,122 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BVHTree.h
+///
+/// A bounding volume hierarchy over GeomPrimitives, an alternative to
+/// SpatialTree for primitive sets that are known up front.
+///
+/// SpatialTree splits space at fixed centers, so skewed data (many
+/// small footprints in one corner of a large extent, say) makes deep,
+/// lopsided trees.  BVHTree instead splits the primitives themselves,
+/// choosing each split by the surface area heuristic over binned
+/// centroids, so the tree adapts to how they are spread out.  Its
+/// nodes live in one array, each internal node followed by its first
+/// child, and their boxes in another, so queries walk memory mostly
+/// forwards.  The top levels of the build run on their own threads.
+///
+/// The tree is static: build a new one if the primitives or their
+/// bounding boxes change.  It holds pointers to the primitives, which
+/// must outlive it.
+///
+/// The queries follow SpatialTree's: intersects() tests bounding boxes
+/// only, contains() and closest() call the primitives' contains() and
+/// distance(), and overlap_pairs() calls intersects() on pairs whose
+/// boxes overlap.  The batched forms answer many queries at once,
+/// spread over vw_settings().default_num_threads() threads.
+///
+#ifndef __VW_GEOMETRY_BVHTREE_H__
+#define __VW_GEOMETRY_BVHTREE_H__
+
+#include <vw/Geometry/SpatialTree.h>
+#include <vw/Core/FundamentalTypes.h>
+
+#include <vector>
+#include <utility>
+
+namespace vw {
+namespace geometry {
+
+  class BVHTree {
+  public:
+    typedef BBox<double> BBoxT;
+    typedef Vector<double> VectorT;
+    typedef std::pair<GeomPrimitive*, GeomPrimitive*> PairT;
+
+    /// Builds the tree over prims, with at most leaf_size primitives
+    /// in each leaf.  All of them must have the same dimension.
+    BVHTree(std::vector<GeomPrimitive*> const& prims, int32 leaf_size = 4);
+    BVHTree(int32 num_primitives, GeomPrimitive **prims, int32 leaf_size = 4);
+
+    size_t size() const { return m_prims.size(); }
+    size_t num_nodes() const { return m_nodes.size(); }
+    int32 dim() const { return m_dim; }
+
+    /// The box around every primitive; empty if there are none.
+    BBoxT bounding_box() const;
+
+    /// Appends the primitives whose bounding boxes intersect box.
+    void intersects(BBoxT const& box, std::vector<GeomPrimitive*> &prims) const;
+
+    /// Appends the primitives that contain point.
+    void contains(VectorT const& point, std::vector<GeomPrimitive*> &prims) const;
+
+    /// The primitive nearest point, and its distance, or 0 if there is
+    /// none within distance_threshold (when that is not negative).
+    GeomPrimitive *closest(VectorT const& point, double distance_threshold = -1, double *distance = 0) const;
+
+    /// The k primitives nearest point, nearest first, replacing the
+    /// contents of prims (and of distances, if given).
+    void nearest(VectorT const& point, size_t k, std::vector<GeomPrimitive*> &prims,
+                 std::vector<double> *distances = 0) const;
+
+    /// Appends each pair of distinct primitives that intersect, once.
+    void overlap_pairs(std::vector<PairT> &overlaps) const;
+
+    /// intersects() for each of boxes, into the matching entry of prims.
+    void intersects(std::vector<BBoxT> const& boxes,
+                    std::vector<std::vector<GeomPrimitive*> > &prims) const;
+
+    /// nearest() for each of points, into the matching entry of prims.
+    void nearest(std::vector<VectorT> const& points, size_t k,
+                 std::vector<std::vector<GeomPrimitive*> > &prims) const;
+
+    /// Checks that every node's box holds its children and primitives,
+    /// and that every primitive is in exactly one leaf.
+    bool check(std::ostream &os = std::cerr) const;
+
+  private:
+    // A leaf holds m_prims[first, first+count).  An internal node has
+    // count 0, its first child right after it and its second at its
+    // own index plus first.  Offsets rather than indices let subtrees
+    // be built separately and appended as they are.
+    struct Node {
+      int32 first;
+      int32 count;
+    };
+
+    // Node i's box is m_bounds[2*dim*i, 2*dim*i + dim) for its minimum
+    // and the dim after that for its maximum.
+    int32 m_dim;
+    std::vector<Node> m_nodes;
+    std::vector<double> m_bounds;
+    std::vector<GeomPrimitive*> m_prims;
+
+    friend class BVHBuilder;
+    void build(std::vector<GeomPrimitive*> const& prims, int32 leaf_size);
+
+    bool node_intersects(int32 node, BBoxT const& box) const;
+    bool node_contains(int32 node, VectorT const& point) const;
+    double node_distance(int32 node, VectorT const& point) const;
+    void intersects_indices(BBoxT const& box, std::vector<int32> &indices) const;
+    void nearest_within(VectorT const& point, size_t k, double max_distance,
+                        std::vector<std::pair<double, GeomPrimitive*> > &best) const;
+  };
+
+}} // namespace vw::geometry
+
+#endif // __VW_GEOMETRY_BVHTREE_H__
@@ -20,6 +20,17 @@ namespace vw
 
     FrameHandle const FrameStore::NULL_HANDLE = FrameHandle(NULL);
 
+    // Held alongside the lock by everything that changes the tree, so
+    // that the version moves on once the change is done (or abandoned)
+    // and before any other thread can fill the cache again.
+    class FrameStore::VersionBump
+    {
+      FrameStore & m_store;
+    public:
+      VersionBump(FrameStore & store) : m_store(store) {}
+      ~VersionBump() { ++m_store.m_version; }
+    };
+
     FrameStore::~FrameStore() throw()
     {
       // delete all frames
@@ -265,6 +276,7 @@ namespace vw
     FrameStore::add(FrameTreeNode * node, FrameHandle parent)
     {
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
 
       VW_ASSERT (node != NULL,
                  vw::LogicErr() << "NULL pointer not allowed as node parameter.");
@@ -293,6 +305,7 @@ namespace vw
     FrameStore::del(FrameHandle frame, bool recursive)
     {
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
 
       VW_ASSERT (frame.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
@@ -325,6 +338,7 @@ namespace vw
     FrameStore::set_parent(FrameHandle frame, FrameHandle parent)
     {
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
 
       VW_ASSERT (frame.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as frame parameter.");
@@ -387,40 +401,35 @@ namespace vw
     Frame::Transform
     FrameStore::get_transform_of(FrameHandle frame, FrameHandle source, Transform const& trans)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (frame.node != NULL && source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
-      return vw::geometry::get_transform_of(frame.node, source.node, trans);
+      return composed_transform(frame.node, source.node) * trans;
     }
 
     Vector3
     FrameStore::get_position_of(FrameHandle frame, FrameHandle source, Vector3 const& trans)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (frame.node != NULL && source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
-      return vw::geometry::get_transform(frame.node, source.node) * trans;
+      return composed_transform(frame.node, source.node) * trans;
     }
 
     Frame::Transform
     FrameStore::get_transform(FrameHandle frame, FrameHandle source)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as frame parameter.");
 
-      return vw::geometry::get_transform(frame.node, source.node);
+      return composed_transform(frame.node, source.node);
     }
 
     void
     FrameStore::set_transform(FrameHandle frame, FrameHandle wrt_frame, Transform const& update)
     {
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
 
       VW_ASSERT (frame.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
@@ -432,6 +441,7 @@ namespace vw
     FrameStore::set_transform_rel(FrameHandle frame, Transform const& update)
     {
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
 
       VW_ASSERT (frame.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
@@ -449,6 +459,9 @@ namespace vw
     bool
     FrameStore::merge_tree(FrameTreeNode * tree, FrameHandle start_frame)
     {
+      RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
+
       VW_ASSERT (!is_member(tree),
                  vw::LogicErr() << "Merged tree must not yet be member of the FrameStore.");
 
@@ -496,6 +509,7 @@ namespace vw
                 vw::LogicErr() << "Parameter vectors not of same size.");
 
       RecursiveMutex::Lock lock(m_mutex);
+      VersionBump bump(*this);
       FrameHandleVector::const_iterator first, last = frames.end();
       TransformVector::const_iterator trans = transforms.begin();
       for (first = frames.begin(); first != last; ++first, ++trans) {
@@ -503,6 +517,57 @@ namespace vw
       }
     }
 
+    FrameStore::TransformCacheEntry &
+    FrameStore::cache_entry(FrameTreeNode const * frame, FrameTreeNode const * source)
+    {
+      // Nodes are heap allocated, so the low bits of their addresses
+      // carry little; fold them away before mixing the two.
+      size_t h = (reinterpret_cast<size_t>(frame) >> 4) * 31 + (reinterpret_cast<size_t>(source) >> 4);
+      h ^= h >> 8;
+      return m_transform_cache[h % TRANSFORM_CACHE_SIZE];
+    }
+
+    bool
+    FrameStore::cached_transform(FrameTreeNode const * frame, FrameTreeNode const * source, Transform & transform)
+    {
+      TransformCacheEntry & entry = cache_entry(frame, source);
+      uint64 version = m_version.load();
+
+      uint32 seq = entry.seq.load();
+      if (seq & 1)
+        return false;
+      memory_barrier();
+      bool hit = entry.version == version && entry.frame == frame && entry.source == source;
+      if (hit)
+        transform = entry.transform;
+      // A writer got in while we were copying: the copy may be torn.
+      return hit && entry.seq.load() == seq;
+    }
+
+    Frame::Transform
+    FrameStore::composed_transform(FrameTreeNode const * frame, FrameTreeNode const * source)
+    {
+      Transform transform;
+      if (cached_transform(frame, source, transform))
+        return transform;
+
+      RecursiveMutex::Lock lock(m_mutex);
+      transform = vw::geometry::get_transform(frame, source);
+
+      // Writers of the tree hold the lock too, so the version can't
+      // move between here and the end of the fill.
+      TransformCacheEntry & entry = cache_entry(frame, source);
+      ++entry.seq;
+      entry.version = m_version.load();
+      entry.frame = frame;
+      entry.source = source;
+      entry.transform = transform;
+      memory_barrier();
+      ++entry.seq;
+
+      return transform;
+    }
+
     bool
     FrameStore::is_member(FrameTreeNode * node) const throw()
     {
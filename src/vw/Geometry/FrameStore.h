@@ -43,6 +43,12 @@ namespace geometry
      * erronous arguments does only affect the the return value, but not
      * the integrity of the tree. For instance, is_root() does not check
      * for membership of the frame to the FrameStore.
+     *
+     * The transforms returned by get_transform() and friends are
+     * cached per pair of frames until the tree next changes, and
+     * cache hits are read without taking the lock, so many threads
+     * can query the same pairs at a high rate without contending
+     * with each other or with the (rarer) updates.
 
    */
   class FrameStore {
@@ -343,6 +349,36 @@ namespace geometry
       mutable RecursiveMutex m_mutex;
       /** The vector of root nodes. */
       FrameTreeNodeVector m_root_nodes;
+
+      /**
+       * Composed transforms are cached per (frame, source) pair, so
+       * that the same pairs queried over and over don't walk the tree
+       * or take m_mutex.  Every change to the tree bumps m_version,
+       * which invalidates all entries at once.  Entries are filled
+       * under m_mutex and read without it: each is guarded by its own
+       * sequence number, odd while it is being written, and a read
+       * that sees it change retries under the lock.
+       */
+      struct TransformCacheEntry {
+        Atomic<uint32> seq;
+        uint64 version;
+        FrameTreeNode const * frame;
+        FrameTreeNode const * source;
+        Transform transform;
+        TransformCacheEntry() : seq(0), version(0), frame(0), source(0) {}
+      };
+      enum { TRANSFORM_CACHE_SIZE = 256 };
+
+      /** Bumps m_version when a change to the tree is done. */
+      class VersionBump;
+      friend class VersionBump;
+
+      Atomic<uint64> m_version;
+      TransformCacheEntry m_transform_cache[TRANSFORM_CACHE_SIZE];
+
+      TransformCacheEntry & cache_entry(FrameTreeNode const * frame, FrameTreeNode const * source);
+      bool cached_transform(FrameTreeNode const * frame, FrameTreeNode const * source, Transform & transform);
+      Transform composed_transform(FrameTreeNode const * frame, FrameTreeNode const * source);
     };
   }
 }
@@ -0,0 +1,202 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Geometry/BVHTree.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+#include <vw/Core.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include <algorithm>
+#include <sstream>
+
+using namespace vw;
+using namespace vw::geometry;
+
+class TestGeomPrimitive : public BBoxN, public GeomPrimitive
+{
+  virtual double distance(const Vector<double> &point) const {
+    double sum = 0;
+    for (size_t i = 0; i < point.size(); i++) {
+      double d = std::max(std::max(min()[i] - point[i], point[i] - max()[i]), 0.0);
+      sum += d * d;
+    }
+    return sqrt(sum);
+  }
+  virtual bool contains(const Vector<double> &point) const {return BBoxN::contains(point);}
+  virtual bool intersects(const GeomPrimitive *prim) const {return BBoxN::intersects(prim->bounding_box());}
+  virtual const BBox<double> &bounding_box() const {return *this;}
+};
+
+class BVHTreeTest : public ::testing::Test {
+protected:
+  // Small boxes, most of them crowded into one corner, so that the
+  // tree has some skew to cope with.
+  virtual void SetUp() {
+    boost::mt19937 gen(42);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > uniform(gen, boost::uniform_real<>(0, 1));
+    prims.resize(2000);
+    for (size_t i = 0; i < prims.size(); i++) {
+      double scale = (i % 4 == 0) ? 100 : 10;
+      Vector2 lo(uniform() * scale, uniform() * scale);
+      Vector2 hi = lo + Vector2(uniform(), uniform());
+      prims[i].grow(Vector<double>(lo));
+      prims[i].grow(Vector<double>(hi));
+      ptrs.push_back(&prims[i]);
+    }
+  }
+
+  std::vector<GeomPrimitive*> brute_intersects(BBoxN const& box) const {
+    std::vector<GeomPrimitive*> result;
+    for (size_t i = 0; i < ptrs.size(); i++)
+      if (ptrs[i]->bounding_box().intersects(box))
+        result.push_back(ptrs[i]);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  std::vector<TestGeomPrimitive> prims;
+  std::vector<GeomPrimitive*> ptrs;
+};
+
+TEST_F(BVHTreeTest, Empty) {
+  BVHTree tree(std::vector<GeomPrimitive*>(), 4);
+  EXPECT_EQ(0u, tree.size());
+  EXPECT_TRUE(tree.check());
+  EXPECT_TRUE(tree.bounding_box().empty());
+  std::vector<GeomPrimitive*> result;
+  tree.intersects(BBoxN(Vector2(0, 0), Vector2(1, 1)), result);
+  EXPECT_TRUE(result.empty());
+  EXPECT_EQ(0, tree.closest(Vector<double>(Vector2(0, 0))));
+}
+
+TEST_F(BVHTreeTest, Build) {
+  BVHTree tree(ptrs, 4);
+  EXPECT_EQ(ptrs.size(), tree.size());
+  EXPECT_EQ(2, tree.dim());
+  std::ostringstream os;
+  EXPECT_TRUE(tree.check(os)) << os.str();
+
+  BBoxN all;
+  for (size_t i = 0; i < ptrs.size(); i++)
+    all.grow(ptrs[i]->bounding_box());
+  EXPECT_VECTOR_DOUBLE_EQ(all.min(), tree.bounding_box().min());
+  EXPECT_VECTOR_DOUBLE_EQ(all.max(), tree.bounding_box().max());
+}
+
+TEST_F(BVHTreeTest, Intersects) {
+  BVHTree tree(ptrs, 4);
+  for (int i = 0; i < 50; i++) {
+    Vector2 lo(i * 2.0 - 5, i * 1.5 - 3);
+    BBoxN box(Vector<double>(lo), Vector<double>(lo + Vector2(i % 7 + 0.5, i % 5 + 0.5)));
+    std::vector<GeomPrimitive*> result;
+    tree.intersects(box, result);
+    std::sort(result.begin(), result.end());
+    EXPECT_TRUE(result == brute_intersects(box));
+  }
+}
+
+TEST_F(BVHTreeTest, Contains) {
+  BVHTree tree(ptrs, 4);
+  Vector<double> point(Vector2(5, 5));
+  std::vector<GeomPrimitive*> result, expected;
+  tree.contains(point, result);
+  for (size_t i = 0; i < ptrs.size(); i++)
+    if (ptrs[i]->contains(point))
+      expected.push_back(ptrs[i]);
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(result == expected);
+}
+
+TEST_F(BVHTreeTest, Nearest) {
+  BVHTree tree(ptrs, 4);
+  for (int i = 0; i < 20; i++) {
+    Vector<double> point(Vector2(i * 6.0 - 10, 110 - i * 5.0));
+
+    std::vector<double> expected;
+    for (size_t j = 0; j < ptrs.size(); j++)
+      expected.push_back(ptrs[j]->distance(point));
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<GeomPrimitive*> result;
+    std::vector<double> distances;
+    tree.nearest(point, 5, result, &distances);
+    ASSERT_EQ(5u, result.size());
+    for (size_t j = 0; j < 5; j++) {
+      EXPECT_DOUBLE_EQ(expected[j], distances[j]);
+      EXPECT_DOUBLE_EQ(distances[j], result[j]->distance(point));
+    }
+
+    double distance;
+    GeomPrimitive *closest = tree.closest(point, -1, &distance);
+    ASSERT_TRUE(closest != 0);
+    EXPECT_DOUBLE_EQ(expected[0], distance);
+    if (expected[0] > 0)
+      EXPECT_EQ(0, tree.closest(point, expected[0] / 2));
+  }
+}
+
+TEST_F(BVHTreeTest, OverlapPairs) {
+  BVHTree tree(ptrs, 4);
+  std::vector<BVHTree::PairT> overlaps;
+  tree.overlap_pairs(overlaps);
+
+  size_t expected = 0;
+  for (size_t i = 0; i < ptrs.size(); i++)
+    for (size_t j = i + 1; j < ptrs.size(); j++)
+      if (ptrs[i]->intersects(ptrs[j]))
+        expected++;
+  EXPECT_EQ(expected, overlaps.size());
+  for (size_t i = 0; i < overlaps.size(); i++) {
+    EXPECT_NE(overlaps[i].first, overlaps[i].second);
+    EXPECT_TRUE(overlaps[i].first->intersects(overlaps[i].second));
+  }
+}
+
+TEST_F(BVHTreeTest, Batched) {
+  BVHTree tree(ptrs, 4);
+  std::vector<BVHTree::BBoxT> boxes;
+  std::vector<BVHTree::VectorT> points;
+  for (int i = 0; i < 100; i++) {
+    Vector2 lo(i * 1.1 - 5, 100 - i * 0.9);
+    boxes.push_back(BBoxN(Vector<double>(lo), Vector<double>(lo + Vector2(3, 3))));
+    points.push_back(Vector<double>(lo));
+  }
+
+  std::vector<std::vector<GeomPrimitive*> > batch;
+  tree.intersects(boxes, batch);
+  ASSERT_EQ(boxes.size(), batch.size());
+  for (size_t i = 0; i < boxes.size(); i++) {
+    std::vector<GeomPrimitive*> single;
+    tree.intersects(boxes[i], single);
+    EXPECT_TRUE(single == batch[i]);
+  }
+
+  tree.nearest(points, 3, batch);
+  ASSERT_EQ(points.size(), batch.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    std::vector<GeomPrimitive*> single;
+    tree.nearest(points[i], 3, single);
+    ASSERT_EQ(single.size(), batch[i].size());
+    for (size_t j = 0; j < single.size(); j++)
+      EXPECT_DOUBLE_EQ(single[j]->distance(points[i]), batch[i][j]->distance(points[i]));
+  }
+}
+
+TEST_F(BVHTreeTest, LargeLeaves) {
+  BVHTree tree(ptrs, 64);
+  EXPECT_TRUE(tree.check());
+  BBoxN box(Vector<double>(Vector2(2, 2)), Vector<double>(Vector2(6, 6)));
+  std::vector<GeomPrimitive*> result;
+  tree.intersects(box, result);
+  std::sort(result.begin(), result.end());
+  EXPECT_TRUE(result == brute_intersects(box));
+}
@@ -0,0 +1,155 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestFrameStore.h
+#include <gtest/gtest.h>
+#include <vw/Geometry/FrameStore.h>
+#include <vw/Core/Thread.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+#include <vector>
+
+using namespace vw;
+using namespace vw::geometry;
+
+typedef FrameStore::Transform Transform;
+
+static Transform shift( double x, double y = 0, double z = 0 ) {
+  return Transform( Vector3(x,y,z), math::identity_matrix<3>() );
+}
+
+// The x offset of source relative to frame.  Every transform in these
+// tests is a pure translation, so offsets add up along the tree.
+static double offset( FrameStore& store, FrameHandle frame, FrameHandle source ) {
+  return store.get_transform( frame, source ).translation()[0];
+}
+
+class FrameStoreCache : public ::testing::Test {
+protected:
+  FrameStore store;
+  FrameHandle root, a, b;
+
+  virtual void SetUp() {
+    root = store.add( "root", FrameStore::NULL_HANDLE, shift(0) );
+    a = store.add( "a", root, shift(1) );
+    b = store.add( "b", a, shift(2) );
+    // Twice, so the second one comes from the cache.
+    EXPECT_EQ( 3, offset(store, root, b) );
+    EXPECT_EQ( 3, offset(store, root, b) );
+  }
+};
+
+TEST_F( FrameStoreCache, SetTransform ) {
+  store.set_transform( a, root, shift(10) );
+  EXPECT_EQ( 12, offset(store, root, b) );
+  EXPECT_EQ( -12, offset(store, b, root) );
+
+  store.set_transform_rel( b, shift(5) );
+  EXPECT_EQ( 15, offset(store, root, b) );
+
+  FrameStore::FrameHandleVector frames( 1, a );
+  FrameStore::TransformVector transforms( 1, shift(20) );
+  store.set_frame_transforms( frames, transforms );
+  EXPECT_EQ( 25, offset(store, root, b) );
+}
+
+TEST_F( FrameStoreCache, Add ) {
+  FrameTreeNode * node = new FrameTreeNode( NULL, Frame("c", shift(4)) );
+  FrameHandle c( node );
+  // Not yet in the tree, so there is no path from root.
+  EXPECT_EQ( 0, offset(store, root, c) );
+  store.add( node, b );
+  EXPECT_EQ( 7, offset(store, root, c) );
+}
+
+TEST_F( FrameStoreCache, Del ) {
+  store.del( a, false );
+  EXPECT_TRUE( store.is_root(b) );
+  EXPECT_EQ( 0, offset(store, root, b) );
+}
+
+TEST_F( FrameStoreCache, SetParent ) {
+  FrameHandle c = store.add( "c", root, shift(7) );
+  EXPECT_EQ( 7, offset(store, root, c) );
+  store.set_parent( b, c );
+  EXPECT_EQ( 9, offset(store, root, b) );
+  store.set_parent( b, FrameStore::NULL_HANDLE );
+  EXPECT_EQ( 0, offset(store, root, b) );
+}
+
+TEST_F( FrameStoreCache, MergeTree ) {
+  FrameTreeNode * tree = new FrameTreeNode( NULL, Frame("root") );
+  FrameTreeNode * node = new FrameTreeNode( tree, Frame("c", shift(6)) );
+  FrameHandle c( node );
+  EXPECT_EQ( 0, offset(store, root, c) );
+  EXPECT_TRUE( store.merge_tree( tree ) );
+  EXPECT_EQ( c, store.lookup( "/root/c" ) );
+  EXPECT_EQ( 6, offset(store, root, c) );
+}
+
+namespace {
+  // Reads the transform of b in root until told to stop.  The writer
+  // only ever moves a to (k, 2k, 3k) for increasing k, so a consistent
+  // read has that shape, and reads never go back in time.
+  struct Reader {
+    FrameStore& store;
+    FrameHandle root, b;
+    Atomic<uint32> &started, &stop;
+    int reads, torn, stale;
+    Reader( FrameStore& store, FrameHandle root, FrameHandle b, Atomic<uint32>& started, Atomic<uint32>& stop )
+      : store(store), root(root), b(b), started(started), stop(stop), reads(0), torn(0), stale(0) {}
+    void operator()() {
+      double last = 0;
+      ++started;
+      while( ! stop.load() ) {
+        Transform t = store.get_transform( root, b );
+        Vector3 p = t.translation();
+        if( p[1] != 2*p[0] || p[2] != 3*p[0] || t.rotation() != math::identity_matrix<3>() )
+          ++torn;
+        if( p[0] < last )
+          ++stale;
+        last = p[0];
+        ++reads;
+      }
+    }
+  };
+}
+
+TEST( FrameStore, ConcurrentReadersAndWriter ) {
+  FrameStore store;
+  FrameHandle root = store.add( "root", FrameStore::NULL_HANDLE, shift(0) );
+  FrameHandle a = store.add( "a", root, shift(0) );
+  FrameHandle b = store.add( "b", a, shift(0) );
+
+  const int num_readers = 4, num_writes = 2000;
+  Atomic<uint32> started(0), stop(0);
+  std::vector<boost::shared_ptr<Reader> > readers;
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for( int i = 0; i < num_readers; ++i ) {
+    readers.push_back( boost::shared_ptr<Reader>( new Reader(store, root, b, started, stop) ) );
+    threads.push_back( boost::shared_ptr<Thread>( new Thread( readers.back() ) ) );
+  }
+  while( started.load() < uint32(num_readers) )
+    Thread::yield();
+
+  for( int k = 1; k <= num_writes; ++k ) {
+    store.set_transform_rel( a, shift(k, 2*k, 3*k) );
+    Transform t = store.get_transform( root, b );
+    EXPECT_EQ( k, t.translation()[0] );
+  }
+  stop.store(1);
+  for( int i = 0; i < num_readers; ++i )
+    threads[i]->join();
+
+  for( int i = 0; i < num_readers; ++i ) {
+    EXPECT_LT( 0, readers[i]->reads );
+    EXPECT_EQ( 0, readers[i]->torn );
+    EXPECT_EQ( 0, readers[i]->stale );
+  }
+  EXPECT_EQ( num_writes, offset(store, root, b) );
+}
@@ -13,11 +13,17 @@
 #ifndef __VW_HDR_CAMERACURVE_H__
 #define __VW_HDR_CAMERACURVE_H__
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/PerPixelViews.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Statistics.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
+#include <vw/HDR/ChannelTable.h>
+
+#include <algorithm>
 
 // Number of LDR intensity pairs to sample
 const int VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES = 300;
@@ -73,6 +79,108 @@ namespace hdr {
     return channel_type(average);
   }
 
+  namespace detail {
+
+    // Orders sample points by the block they fall in, row by row.
+    class BlockOrder {
+      std::vector<Vector2i> const& m_points;
+      int32 m_block;
+    public:
+      BlockOrder(std::vector<Vector2i> const& points, int32 block) : m_points(points), m_block(block) {}
+      bool operator()(size_t a, size_t b) const {
+        const Vector2i &pa = m_points[a], &pb = m_points[b];
+        const int32 ra = pa.y() / m_block, rb = pb.y() / m_block;
+        if (ra != rb) return ra < rb;
+        return pa.x() / m_block < pb.x() / m_block;
+      }
+    };
+
+    // Samples one image at its points, reading each block of the image
+    // that has points in it once.
+    template <class ViewT>
+    class SampleImageTask {
+      typedef typename CompoundChannelCast<typename ViewT::pixel_type, double>::type sample_type;
+      ViewT const& m_image;
+      std::vector<Vector2i> const& m_points;
+      int m_kernel_size;
+      int32 m_block;
+      std::vector<sample_type>& m_samples;
+    public:
+      typedef void result_type;
+      SampleImageTask(ViewT const& image, std::vector<Vector2i> const& points, int kernel_size,
+                      int32 block, std::vector<sample_type>& samples)
+        : m_image(image), m_points(points), m_kernel_size(kernel_size), m_block(block), m_samples(samples) {}
+
+      void operator()() const {
+        const int halfsize = m_kernel_size / 2;
+        m_samples.assign(m_points.size(), sample_type());
+
+        std::vector<size_t> order(m_points.size());
+        for (size_t k = 0; k < order.size(); ++k)
+          order[k] = k;
+        BlockOrder less(m_points, m_block);
+        std::sort(order.begin(), order.end(), less);
+
+        ImageView<typename ViewT::pixel_type> region;
+        for (size_t begin = 0, end; begin < order.size(); begin = end) {
+          // The points in this block, and the region their kernels cover.
+          BBox2i bbox;
+          for (end = begin; end < order.size() && !less(order[begin], order[end]); ++end)
+            bbox.grow(m_points[order[end]]);
+          bbox.max() += Vector2i(1,1);
+          bbox.expand(halfsize);
+
+          region = crop(edge_extend(m_image, ConstantEdgeExtension()), bbox);
+          for (size_t k = begin; k < end; ++k) {
+            const Vector2i p = m_points[order[k]] - bbox.min();
+            sample_type sum = sample_type();
+            for (int row = p.y() - halfsize; row <= p.y() + halfsize; ++row)
+              for (int col = p.x() - halfsize; col <= p.x() + halfsize; ++col)
+                sum += pixel_cast<sample_type>(region(col, row));
+            m_samples[order[k]] = sum / double(m_kernel_size * m_kernel_size);
+          }
+        }
+      }
+    };
+
+    /// Samples images[j] at each of points[j], averaging the pixels in a
+    /// kernel_size square as sample_image() does, into samples[j].
+    /// Scattered reads on a DiskImageView can each load a block, so
+    /// the points are grouped by the block they fall in, and each
+    /// block is read once.  The images are sampled in parallel.
+    template <class ViewT>
+    void sample_images(std::vector<ViewT> const& images,
+                       std::vector<std::vector<Vector2i> > const& points, int kernel_size,
+                       std::vector<std::vector<typename CompoundChannelCast<typename ViewT::pixel_type, double>::type> >& samples) {
+      VW_ASSERT(points.size() == images.size(), ArgumentErr() << "sample_images: need a list of points for each image.");
+      const int32 block = vw_settings().default_tile_size();
+      samples.resize(images.size());
+
+      FifoWorkQueue queue(std::min(int(images.size()), int(vw_settings().default_num_threads())));
+      std::vector<Future<void> > futures;
+      for (size_t j = 0; j < images.size(); ++j)
+        futures.push_back(queue.submit(SampleImageTask<ViewT>(images[j], points[j], kernel_size, block, samples[j])));
+      when_all(futures);
+    }
+
+    /// Samples all the images at the same num_samples random points.
+    template <class ViewT>
+    void sample_images_at_random(std::vector<ViewT> const& images, int num_samples, int kernel_size,
+                                 std::vector<std::vector<typename CompoundChannelCast<typename ViewT::pixel_type, double>::type> >& samples) {
+      const int height = images[0].impl().rows();
+      const int width = images[0].impl().cols();
+
+      srand(time(0)); // Initialize random number generator
+      std::vector<std::vector<Vector2i> > points(images.size());
+      for (int i = 0; i < num_samples; ++i)
+        points[0].push_back(Vector2i(dice(width), dice(height)));
+      for (unsigned j = 1; j < images.size(); ++j)
+        points[j] = points[0];
+
+      sample_images(images, points, kernel_size, samples);
+    }
+  }
+
   /// Generates an Nx3 matrix where each row contains a channel value
   /// from one LDR image, the corresponding pixel value from a second
   /// LDR image, and the ratio of exposure between these two images.
@@ -93,39 +201,56 @@ namespace hdr {
     int height = images[0].impl().rows();
     int width = images[0].impl().cols();
 
+    typedef typename CompoundChannelCast<typename ViewT::pixel_type, double>::type sample_type;
+
     srand(time(0)); // Initialize random number generator
     int i = 0;
     while (i < num_pairs) {
-      // Generate random indices for two images
-      int rand_x = detail::dice(width);
-      int rand_y = detail::dice(height);
-
-      // Pick two distinct images to sample from
-      int id1 = detail::dice(images.size());
-      int id2;
-      while (true) {
-        id2 = detail::dice(images.size());
-        if (id1 != id2) break;
+      // Draw candidates in batches, so each batch is read a block at a
+      // time.  Some get rejected, so draw more than are still needed.
+      const int batch = 2 * (num_pairs - i);
+      std::vector<std::vector<Vector2i> > points(images.size());
+      std::vector<Vector2i> candidates(batch); // image 1, image 2
+      for (int k = 0; k < batch; ++k) {
+        // Generate random indices for two images
+        Vector2i p(detail::dice(width), detail::dice(height));
+
+        // Pick two distinct images to sample from
+        int id1 = detail::dice(images.size());
+        int id2;
+        while (true) {
+          id2 = detail::dice(images.size());
+          if (id1 != id2) break;
+        }
+
+        candidates[k] = Vector2i(id1, id2);
+        points[id1].push_back(p);
+        points[id2].push_back(p);
       }
 
       // Sample both images at those indices
-      channel_type I_1 = sample_image(images[id1].impl(), rand_x, rand_y, channel, kernel_size);
-      channel_type I_2 = sample_image(images[id2].impl(), rand_x, rand_y, channel, kernel_size);
-
-      // We would prefer to avoid points that are very close to
-      // saturated.  If the values are within 90% of the dynamic
-      // range, add the sample pair to the list along with the
-      // exposure ratio
-      if ((I_1 > 0.01) && (I_1 < 0.99) && (I_2 > 0.01) && (I_2 < 0.99)) {
-
-        // FOR DEBUGGING:
-        //                vw_out() << "Adding ["<< id1 << " " << id2 <<"] " << I_1 << "   " << I_2 << "   " << brightness_values[id1] << "    " << brightness_values[id2] << "\n";
-        //                vw_out() << "      " << pow(2.0, (brightness_values[id2] - brightness_values[id1]) * 0.5) << "  " << brightness_values[id2]/brightness_values[id1] << "\n";
-
-        pair_list(i, 0) = I_1;
-        pair_list(i, 1) = I_2;
-        pair_list(i, 2) = brightness_values[id2]/brightness_values[id1];
-        ++i;
+      std::vector<std::vector<sample_type> > samples;
+      detail::sample_images(images, points, kernel_size, samples);
+
+      // Each image's points were added in candidate order, so walking
+      // the candidates in order finds their samples.
+      std::vector<size_t> next(images.size(), 0);
+      for (int k = 0; k < batch && i < num_pairs; ++k) {
+        const int id1 = candidates[k][0], id2 = candidates[k][1];
+        const size_t k1 = next[id1]++, k2 = next[id2]++;
+        channel_type I_1 = channel_type(compound_select_channel<double const&>(samples[id1][k1], channel));
+        channel_type I_2 = channel_type(compound_select_channel<double const&>(samples[id2][k2], channel));
+
+        // We would prefer to avoid points that are very close to
+        // saturated.  If the values are within 90% of the dynamic
+        // range, add the sample pair to the list along with the
+        // exposure ratio
+        if ((I_1 > 0.01) && (I_1 < 0.99) && (I_2 > 0.01) && (I_2 < 0.99)) {
+          pair_list(i, 0) = I_1;
+          pair_list(i, 1) = I_2;
+          pair_list(i, 2) = brightness_values[id2]/brightness_values[id1];
+          ++i;
+        }
       }
     }
 
@@ -149,20 +274,12 @@ namespace hdr {
     VW_ASSERT((channel >= 0) && (channel < int(n_channels)), ArgumentErr() << "No such channel.");
 
     Matrix<channel_type> pair_list(num_pairs, images.size());
-    int height = images[0].impl().rows();
-    int width = images[0].impl().cols();
-
-    srand(time(0)); // Initialize random number generator
-    int i = 0;
-    while (i < num_pairs) {
-      // Generate random indices for two images
-      int rand_x = detail::dice(width);
-      int rand_y = detail::dice(height);
 
+    std::vector<std::vector<typename CompoundChannelCast<typename ViewT::pixel_type, double>::type> > samples;
+    detail::sample_images_at_random(images, num_pairs, kernel_size, samples);
+    for (int i = 0; i < num_pairs; ++i)
       for (unsigned j = 0; j < images.size(); ++j)
-        pair_list(i,j) = sample_image(images[j].impl(), rand_x, rand_y, channel, kernel_size);
-      ++i;
-    }
+        pair_list(i,j) = channel_type(compound_select_channel<double const&>(samples[j][i], channel));
 
     return pair_list;
   }
@@ -195,6 +312,14 @@ namespace hdr {
     // value.
     std::vector<Vector<double> > m_lookup_tables;
 
+    struct ScaledCurve {
+      CameraCurveFn const& curves;
+      double scale, max;
+      ScaledCurve(CameraCurveFn const& curves, double scale, double max) : curves(curves), scale(scale), max(max) {}
+      template <class ChannelT>
+      double operator()(size_t channel, ChannelT value) const { return scale * curves(double(value) / max, channel); }
+    };
+
   public:
     CameraCurveFn(std::vector<Vector<double> > const& lookup_tables) :
       m_lookup_tables(lookup_tables) {}
@@ -225,13 +350,22 @@ namespace hdr {
       if (CompoundNumChannels<PixelT>::value != this->num_channels())
         vw_throw(ArgumentErr() << "CameraCurveFn: pixel does not have the same number of channels as there are curves.");
 
+      // Integer channels are scaled to [0.0 1.0] first.
+      const double max = ChannelRange<typename CompoundChannelType<PixelT>::type>::max();
       pixel_type result;
       for (size_t c = 0; c < CompoundNumChannels<PixelT>::value; ++c) {
-        result[c] = this->operator()(double(pixel_val[c]), c);
+        result[c] = this->operator()(double(pixel_val[c]) / max, c);
       }
       return result;
     }
 
+    /// Tabulates scale times the curves, for every value of an 8- or
+    /// 16-bit channel type, to look pixels of that type up in.
+    template <class ChannelT>
+    ChannelTable<ChannelT> table(double scale = 1.0) const {
+      return ChannelTable<ChannelT>(ScaledCurve(*this, scale, ChannelRange<ChannelT>::max()), num_channels());
+    }
+
     size_t num_channels() const { return m_lookup_tables.size(); }
 
     Vector<double> const& lookup_table(size_t channel) const {
@@ -265,10 +399,19 @@ namespace hdr {
 
     int32 n_channels = PixelNumChannels<typename ViewT::pixel_type>::value;
 
-    // Sample each image channel
+    VW_ASSERT(images.size() > 1, ArgumentErr() << "Need at least two images.");
+
+    // Sample every channel of the images in one pass
+    std::vector<std::vector<typename CompoundChannelCast<typename ViewT::pixel_type, double>::type> > samples;
+    detail::sample_images_at_random(images, VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES, sample_region_size, samples);
+
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
     std::vector<vw::Matrix<double> > pixels(n_channels);
-    for ( int32 i = 0; i < n_channels; ++i ) {
-      pixels[i] = sample_ldr_images(images, brightness_values, VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES, i, sample_region_size);
+    for ( int32 c = 0; c < n_channels; ++c ) {
+      pixels[c].set_size(VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES, images.size());
+      for ( int i = 0; i < VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES; ++i )
+        for ( unsigned j = 0; j < images.size(); ++j )
+          pixels[c](i,j) = channel_type(compound_select_channel<double const&>(samples[j][i], c));
     }
 
     // Compute camera response curve for each channel.
@@ -286,18 +429,45 @@ namespace hdr {
   /// Read the camera curve values from a tabulated format on disk.
   CameraCurveFn read_curves(std::string const& curves_file);
 
-  /// A pixel casting functor, used by \ref pixel_cast().
+  /// A pixel casting functor, used by \ref pixel_cast().  Pixels with
+  /// 8- or 16-bit channels are looked up in a table of the scaled
+  /// curves, built once when the functor is made (and shared by its
+  /// copies).
   template <class PixelT>
   class LuminanceFunc : public ReturnFixedType<typename CompoundChannelCast<PixelT,double>::type> {
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    typedef typename CompoundChannelCast<PixelT,double>::type result_type;
+    typedef IsTabulatedChannel<channel_type> tabulated;
+
     CameraCurveFn m_curves;
     double m_brightness_val;
+    ChannelTable<channel_type> m_table;
+
+    void init_table( boost::true_type ) {
+      if (CompoundNumChannels<PixelT>::value != m_curves.num_channels())
+        vw_throw(ArgumentErr() << "LuminanceFunc: pixel does not have the same number of channels as there are curves.");
+      m_table = m_curves.template table<channel_type>(m_brightness_val);
+    }
+    void init_table( boost::false_type ) {}
+
+    inline result_type apply( PixelT const& pixel, boost::true_type ) const {
+      result_type result;
+      for (size_t c = 0; c < CompoundNumChannels<PixelT>::value; ++c)
+        result[c] = m_table(c, pixel[c]);
+      return result;
+    }
+    inline result_type apply( PixelT const& pixel, boost::false_type ) const {
+      return m_brightness_val*m_curves(pixel);
+    }
 
   public:
     LuminanceFunc(CameraCurveFn const& curves, double brightness_val) :
-      m_curves(curves), m_brightness_val(brightness_val) {}
+      m_curves(curves), m_brightness_val(brightness_val) {
+      init_table( tabulated() );
+    }
 
-    inline typename CompoundChannelCast<PixelT,double>::type operator()( PixelT pixel ) const {
-      return m_brightness_val*m_curves(pixel);
+    inline result_type operator()( PixelT pixel ) const {
+      return apply( pixel, tabulated() );
     }
   };
 
@@ -0,0 +1,70 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ChannelTable.h
+///
+/// Lookup tables of a per-channel function at every value of an 8-
+/// or 16-bit channel type.  The HDR functors that map pixels one
+/// channel at a time (camera curves, tone mapping operators) build
+/// one when they are constructed for such a channel type, so mapping
+/// a pixel costs a table lookup per channel instead of logs and
+/// exps.
+///
+#ifndef __VW_HDR_CHANNELTABLE_H__
+#define __VW_HDR_CHANNELTABLE_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <vector>
+
+namespace vw {
+namespace hdr {
+
+  /// Channel types with few enough values to tabulate all of them.
+  template <class ChannelT> struct IsTabulatedChannel : public boost::false_type {};
+  template <> struct IsTabulatedChannel<uint8>  : public boost::true_type {};
+  template <> struct IsTabulatedChannel<uint16> : public boost::true_type {};
+
+  /// A table of func(channel, value) for every channel of a pixel
+  /// type and every value of its (tabulated) channel type.  Copies
+  /// share the table, so functors holding one copy cheaply.
+  template <class ChannelT>
+  class ChannelTable {
+    boost::shared_ptr<const std::vector<double> > m_table;
+    const double* m_data;
+    size_t m_values;
+
+  public:
+    static size_t values() { return size_t(ChannelRange<ChannelT>::max()) + 1; }
+
+    ChannelTable() : m_data(0), m_values(0) {}
+
+    template <class FuncT>
+    ChannelTable( FuncT const& func, size_t num_channels ) {
+      const size_t n = values();
+      boost::shared_ptr<std::vector<double> > table( new std::vector<double>(num_channels * n) );
+      for ( size_t c = 0; c < num_channels; ++c )
+        for ( size_t v = 0; v < n; ++v )
+          (*table)[c * n + v] = func( c, ChannelT(v) );
+      m_table = table;
+      m_data = &(*table)[0];
+      m_values = n;
+    }
+
+    bool empty() const { return m_data == 0; }
+
+    inline double operator()( size_t channel, ChannelT value ) const {
+      return m_data[channel * m_values + value];
+    }
+  };
+
+}} // namespace vw::hdr
+
+#endif // __VW_HDR_CHANNELTABLE_H__
@@ -21,17 +21,52 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PerPixelViews.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Statistics.h>
+#include <vw/HDR/ChannelTable.h>
 
 namespace vw {
 namespace hdr {
 
   const float DRAGO_DEFAULT_BIAS = 0.85;
 
+  /// Drago's operator.  Pixels with 8- or 16-bit channels are looked
+  /// up in a table of the operator at every channel value, built once
+  /// when the functor is made (and shared by its copies).
   template <class PixelT>
   class DragoFunctor : public vw::ReturnFixedType<typename CompoundChannelCast<PixelT,double>::type> {
   private:
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    typedef typename CompoundChannelCast<PixelT,double>::type result_type;
+    typedef IsTabulatedChannel<channel_type> tabulated;
+
     double L_wmax, power, offset, scale;
     int b_min, b_diff;
+    ChannelTable<channel_type> m_table;
+
+    // The operator for one channel value.
+    struct Channel {
+      DragoFunctor const& f;
+      Channel(DragoFunctor const& f) : f(f) {}
+      double operator()(size_t /*channel*/, channel_type value) const {
+        const double L_w = value;
+        return (log(L_w + 1.0) / log(f.b_min + f.b_diff * pow(L_w / f.L_wmax, f.power)) - f.offset) / f.scale;
+      }
+    };
+
+    void init_table( boost::true_type ) { m_table = ChannelTable<channel_type>(Channel(*this), 1); }
+    void init_table( boost::false_type ) {}
+
+    inline result_type apply( PixelT const& L_w, boost::true_type ) const {
+      result_type result;
+      for (size_t c = 0; c < CompoundNumChannels<PixelT>::value; ++c)
+        compound_select_channel<double&>(result, c) = m_table(0, compound_select_channel<channel_type const&>(L_w, c));
+      return result;
+    }
+    inline result_type apply( PixelT const& L_w, boost::false_type ) const {
+      return (log(L_w + 1.0) / log(b_min + b_diff * pow(L_w / L_wmax, power)) - offset) / scale;
+    }
+
   public:
 
     DragoFunctor(double L_wmin, double L_wmax, double bias, int b_min, int b_max) :
@@ -41,10 +76,11 @@ namespace hdr {
 
       offset = log(L_wmin + 1.0) / log(b_min + b_diff * pow(L_wmin / L_wmax, power));
       scale = log(L_wmax + 1.0) / log(b_min + b_diff * pow(L_wmax / L_wmax, power)) - offset;
+      init_table( tabulated() );
     }
 
-    typename CompoundChannelCast<PixelT,double>::type operator() (PixelT L_w) const {
-      return (log(L_w + 1.0) / log(b_min + b_diff * pow(L_w / L_wmax, power)) - offset) / scale;
+    result_type operator() (PixelT L_w) const {
+      return apply( L_w, tabulated() );
     }
   };
 
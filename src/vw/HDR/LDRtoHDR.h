@@ -25,6 +25,8 @@
 #define __VW_HDR_LDRTOHDR_H__
 
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/RasterizeFootprint.h>
 #include <vw/HDR/CameraCurve.h>
 
 #include <vector>
@@ -35,6 +37,11 @@ namespace hdr {
   /// Converts each pixel value in the image to scaled illuminance
   /// values based on a set of polynomial response curves, one
   /// curve for each image channel.
+  ///
+  /// Rasterizing a region merges the exposures into it one at a time,
+  /// so only one exposure's block and the running sums are in memory
+  /// at once.  Write the view with block_write_image() (or use
+  /// write_hdr_image()) to merge an image of any size in parallel.
   template <class SrcPixelT>
   class HighDynamicRangeView : public ImageViewBase<HighDynamicRangeView<SrcPixelT> > {
 
@@ -49,14 +56,36 @@ namespace hdr {
     CameraCurveFn m_curves;
     std::vector<double> m_brightness_vals;
 
+    // We will use a gaussian weighting scheme that peak at 0.5 and
+    // falls off to very close to zero at 0.0 and 1.0.
+    //
+    // Although it was constructed by "eyeballing it" in MATLAB,
+    // we find that this scheme works very well in practice.  It
+    // is certainly better than our old "linear" weighting scheme:
+    //
+    //        double weight = 2.0 * (-abs(0.5 - gray) + 0.5);
+    //
+    static inline double weight( SrcPixelT const& pix ) {
+      PixelGray<double> gray(pix);  // Convert to grayscale
+      return exp(-pow((gray-0.5),2)/(0.07));
+    }
+
   public:
 
     HighDynamicRangeView( std::vector<ImageViewRef<SrcPixelT> > const& views,
                           CameraCurveFn const& curves,
                           std::vector<double> brightness_vals) :
       m_views(views), m_curves(curves), m_brightness_vals(brightness_vals) {
+      VW_ASSERT( !m_views.empty(), ArgumentErr() << "HighDynamicRangeView: no exposures to merge." );
+      VW_ASSERT( m_brightness_vals.size() == m_views.size(),
+                 ArgumentErr() << "HighDynamicRangeView: need one brightness value per exposure." );
+      for ( unsigned c = 1; c < m_views.size(); ++c )
+        VW_ASSERT( m_views[c].cols() == cols() && m_views[c].rows() == rows() && m_views[c].planes() == planes(),
+                   ArgumentErr() << "HighDynamicRangeView: the exposures must all be the same size." );
     }
 
+    std::vector<ImageViewRef<SrcPixelT> > const& views() const { return m_views; }
+
     inline int32 cols() const { return m_views[0].cols(); }
     inline int32 rows() const { return m_views[0].rows(); }
     inline int32 planes() const { return m_views[0].planes(); }
@@ -70,25 +99,14 @@ namespace hdr {
       // Bring all images into same domain and average pixels across images using
       // a weighting function that favors pixels in middle of dynamic range.
       for ( unsigned c = 0; c < m_views.size(); ++c ) {
-
-        // We will use a gaussian weighting scheme that peak at 0.5 and
-        // falls off to very close to zero at 0.0 and 1.0.
-        //
-        // Although it was constructed by "eyeballing it" in MATLAB,
-        // we find that this scheme works very well in practice.  It
-        // is certainly better than our old "linear" weighting scheme:
-        //
-        //        double weight = 2.0 * (-abs(0.5 - gray) + 0.5);
-        //
-        // Gaussian Weighting:
-        PixelGray<double> gray(m_views[c](i,j,p));  // Convert to grayscale
-        double weight = exp(-pow((gray-0.5),2)/(0.07));
+        SrcPixelT src = m_views[c](i,j,p);
+        double w = weight(src);
 
         // The camera response function returns a relative luminance
         // value between 0.0 and 2.0.
-        pixel_type src_val = m_curves( m_views[c](i,j,p) );
-        hdr_pix += weight * m_brightness_vals[c] * src_val;
-        weight_sum += weight;
+        pixel_type src_val = m_curves( src );
+        hdr_pix += w * m_brightness_vals[c] * src_val;
+        weight_sum += w;
       }
 
       // Divide by sum of weights
@@ -133,20 +151,74 @@ namespace hdr {
     }
 
     /// \COND INTERNAL
-    typedef HighDynamicRangeView<SrcPixelT> prerasterize_type;
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> hdr( bbox.width(), bbox.height(), planes() );
+      ImageView<double> weight_sum( bbox.width(), bbox.height(), planes() );
+      ImageView<SrcPixelT> src( bbox.width(), bbox.height(), planes() );
 
-      // Rasterize each of the individual LDR images if necessary.
-      std::vector<ImageViewRef<SrcPixelT> > m_prerast_views(m_views.size());
-      for (unsigned i = 0; i < m_views.size(); ++i)
-        m_prerast_views[i] = m_views[i].prerasterize(bbox);
+      // Merge the exposures in one at a time, reusing one block for
+      // all of them.
+      for ( unsigned c = 0; c < m_views.size(); ++c ) {
+        m_views[c].rasterize( src, bbox );
+        const double brightness = m_brightness_vals[c];
+        for ( int32 p = 0; p < src.planes(); ++p )
+          for ( int32 j = 0; j < src.rows(); ++j )
+            for ( int32 i = 0; i < src.cols(); ++i ) {
+              double w = weight( src(i,j,p) );
+              hdr(i,j,p) += w * brightness * m_curves( src(i,j,p) );
+              weight_sum(i,j,p) += w;
+            }
+      }
 
-      return prerasterize_type( m_prerast_views, m_curves, m_brightness_vals );
+      // Divide by sum of weights
+      for ( int32 p = 0; p < hdr.planes(); ++p )
+        for ( int32 j = 0; j < hdr.rows(); ++j )
+          for ( int32 i = 0; i < hdr.cols(); ++i )
+            hdr(i,j,p) /= weight_sum(i,j,p);
+
+      return prerasterize_type( hdr, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
+} // namespace hdr
+
+  // The merged block and its weights, one exposure's block, and
+  // whatever the deepest exposure needs (they're rasterized in turn).
+  template <class SrcPixelT>
+  class RasterizeFootprint<hdr::HighDynamicRangeView<SrcPixelT> > {
+    hdr::HighDynamicRangeView<SrcPixelT> const& m_view;
+  public:
+    RasterizeFootprint( hdr::HighDynamicRangeView<SrcPixelT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return 0;
+      size_t child = 0;
+      for ( unsigned c = 0; c < m_view.views().size(); ++c )
+        child = std::max( child, RasterizeFootprint<ImageViewRef<SrcPixelT> >( m_view.views()[c] )( bbox ) );
+      return raster_bytes<typename hdr::HighDynamicRangeView<SrcPixelT>::pixel_type>( bbox, m_view.planes() ) +
+             raster_bytes<double>( bbox, m_view.planes() ) +
+             raster_bytes<SrcPixelT>( bbox, m_view.planes() ) + child;
+    }
+  };
+
+namespace hdr {
+
+  /// Merges the exposures into resource with block_write_image(), so
+  /// the blocks are merged on all threads, and each thread only holds
+  /// its block of one exposure at a time.  Give the resource a block
+  /// write size first (if it has one): a resource that only writes
+  /// whole images is merged as one block.
+  template <class SrcPixelT>
+  void write_hdr_image( DstImageResource& resource,
+                        std::vector<ImageViewRef<SrcPixelT> > const& views,
+                        CameraCurveFn const& curves,
+                        std::vector<double> const& brightness_vals,
+                        ProgressCallback const& progress_callback = ProgressCallback::dummy_instance() ) {
+    block_write_image( resource, HighDynamicRangeView<SrcPixelT>( views, curves, brightness_vals ), progress_callback );
+  }
+
 //     // First pick a reasonable middle threshold value for picking
 //     // whether a pixel is saturated as white or black.
 //     double min, max;
@@ -11,6 +11,7 @@
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
 #include <vw/Core/Functors.h>
 
 #include <vector>
@@ -24,40 +25,6 @@ using namespace vw::hdr;
 // ********************************************************************
 const unsigned ASH_MAX_KERNEL = 10;
 
-ImageView<double> ashikhmin_world_adaptation_luminance(ImageView<double> L_w, double threshold) {
-  typedef ImageView<double> Map;
-
-  std::vector<Map> L_w_blur(ASH_MAX_KERNEL * 2);
-  std::vector<Map> V(ASH_MAX_KERNEL);
-
-  vw_out() << "Computing L_w_blur\n";
-  for ( unsigned s = 1; s <= ASH_MAX_KERNEL * 2; ++s ) {
-    if ((s < ASH_MAX_KERNEL) || (s % 2 == 0)) {
-      vw_out() << "L_w_blur[" << (s) << "]\n";
-      L_w_blur[s-1] = gaussian_filter(L_w, 1.0, 1.0, s, s);
-    }
-  }
-
-  vw_out() << "Computing Vs\n";
-  for ( unsigned s = 1; s <= ASH_MAX_KERNEL; ++s ) {
-    V[s-1] = abs((L_w_blur[s-1] - L_w_blur[2*s - 1]) / (L_w_blur[s-1] + 0.0001));
-  }
-
-  vw_out() << "Computing L_wa\n";
-  Map L_wa(L_w.cols(), L_w.rows());
-  for ( int32 x = 0; x < L_wa.cols(); ++x ) {
-    for ( int32 y = 0; y < L_wa.rows(); ++y ) {
-      unsigned s_t = 1;
-      while ((s_t < ASH_MAX_KERNEL) && (V[s_t - 1](x,y) <= threshold)) {
-        ++s_t;
-      }
-      L_wa(x,y) = L_w_blur[s_t - 1](x,y);
-    }
-  }
-
-  return L_wa;
-}
-
 struct AshikhminCompressiveFunctor : ReturnFixedType<double> {
 private:
   double C_L_wmin, k;
@@ -66,8 +33,6 @@ public:
   AshikhminCompressiveFunctor(double L_wmin, double L_wmax, double L_dmax = 1.0) {
     C_L_wmin = C(L_wmin);
     k = L_dmax / (C(L_wmax) - C_L_wmin);
-    vw_out() << "C(L_wmin) = " << C_L_wmin << "\n";
-    vw_out() << "k = " << k << "\n";
   }
 
   double C(double L) const {
@@ -82,28 +47,48 @@ public:
   }
 };
 
-ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
-  ImageView<PixelGray<double> > gray = hdr_image;
-  ImageView<double> L_w = channels_to_planes(gray);
-  //  write_image("lw.jpg", L_w);
-  ImageView<PixelRGB<double> > out_image = copy(hdr_image) / L_w;
-
-  // Compute world adaptation luminance
-  ImageView<double> L_wa = ashikhmin_world_adaptation_luminance(L_w, threshold);
-  //  write_image("lwa.jpg", L_wa);
-
-  // Compute display luminances
-  vw_out() << "Computing L_wmin and L_wmax\n";
-  double L_wmin, L_wmax;
-  min_max_channel_values(L_w, L_wmin, L_wmax);
-  vw_out() << "Computing F(L_wa)\n";
+int32 vw::hdr::detail::ashikhmin_padding() {
+  // The widest blur has a kernel of 2*ASH_MAX_KERNEL taps.
+  return ASH_MAX_KERNEL + 1;
+}
+
+void vw::hdr::detail::ashikhmin_display_scale( ImageView<float> const& L_w, double threshold,
+                                               double L_wmin, double L_wmax, ImageView<float>& scale ) {
+  const int32 pad = ashikhmin_padding();
+  const int32 cols = L_w.cols() - 2*pad, rows = L_w.rows() - 2*pad;
+  VW_ASSERT( cols > 0 && rows > 0, ArgumentErr() << "ashikhmin_display_scale: the luminance is not padded." );
+
+  // The luminance blurred by kernels of s taps, for each s the
+  // operator looks at (s and 2s, for s up to ASH_MAX_KERNEL).  They
+  // all come from the same padded block.
+  std::vector<ImageView<float> > L_w_blur(ASH_MAX_KERNEL * 2 + 1);
+  for ( unsigned s = 1; s <= ASH_MAX_KERNEL * 2; ++s ) {
+    if ((s <= ASH_MAX_KERNEL) || (s % 2 == 0))
+      L_w_blur[s] = crop(gaussian_filter(L_w, 1.0, 1.0, s, s), pad, pad, cols, rows);
+  }
+
+  // The world adaptation luminance is the blur at the first scale
+  // whose contrast with the next one up exceeds the threshold.
   AshikhminCompressiveFunctor F(L_wmin, L_wmax);
-  ImageView<double> F_L_wa = per_pixel_filter(L_wa, F);
-  //  write_image("flwa.jpg", F_L_wa);
-  vw_out() << "Computing display luminances\n";
-  ImageView<double> L_d = F_L_wa * L_w / L_wa;
-  //  write_image("ld.jpg", L_d);
-
-  // Recombine luminance values into color image
-  return normalize(out_image * L_d);
+  scale.set_size(cols, rows);
+  for ( int32 y = 0; y < rows; ++y ) {
+    for ( int32 x = 0; x < cols; ++x ) {
+      unsigned s_t = 1;
+      while (s_t < ASH_MAX_KERNEL) {
+        const float b1 = L_w_blur[s_t](x,y), b2 = L_w_blur[2*s_t](x,y);
+        if (fabs((b1 - b2) / (b1 + 0.0001)) > threshold)
+          break;
+        ++s_t;
+      }
+      const double L_wa = L_w_blur[s_t](x,y);
+
+      // L_d = F(L_wa) * L_w / L_wa, and each channel is scaled by L_d / L_w.
+      scale(x,y) = float(F(L_wa) / L_wa);
+    }
+  }
+}
+
+ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
+  const Vector2i block( vw_settings().default_tile_size(), vw_settings().default_tile_size() );
+  return pixel_cast<PixelRGB<double> >(block_rasterize(ashikhmin_tone_map_view(hdr_image, threshold), block));
 }
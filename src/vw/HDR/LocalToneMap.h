@@ -12,11 +12,20 @@
 ///
 /// This file implements the following tone mapping operators.
 ///
+///  - Ashikhmin: ashikhmin_tone_map() tone maps an image in memory;
+///    ashikhmin_tone_map_view() returns a view that tone maps one
+///    block at a time, for images of any size.
 ///
 #ifndef __VW_HDR_LOCALTONEMAP_H__
 #define __VW_HDR_LOCALTONEMAP_H__
 
+#include <vw/Core/Settings.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/Statistics.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 namespace hdr {
@@ -24,6 +33,124 @@ namespace hdr {
   ImageView<PixelRGB<double> > ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image,
                                                   double threshold = 0.5);
 
+  namespace detail {
+    /// How far the adaptation luminance of a pixel looks: the
+    /// luminance of a block must be this much bigger on every side.
+    int32 ashikhmin_padding();
+
+    /// Computes F(L_wa) / L_wa, the factor that takes a pixel of the
+    /// world image to the display, for the pixels of a block, given
+    /// its world luminance padded by ashikhmin_padding() on every side.
+    void ashikhmin_display_scale( ImageView<float> const& L_w_padded, double threshold,
+                                  double L_wmin, double L_wmax, ImageView<float>& scale );
+  }
+
+  /// Ashikhmin's local tone mapping operator, computed one block at a
+  /// time: each block reads its source block padded by a few pixels,
+  /// blurs the luminance at every scale the operator looks at, and
+  /// maps its pixels to the display.  Memory goes with the block size
+  /// (times the fifteen scales), not the image, and blocks are
+  /// independent, so block_write_image() tone maps an image of any
+  /// size on all threads.
+  ///
+  /// The operator needs the range of the world luminance, and the
+  /// output is normalized to [0,1] like ashikhmin_tone_map()'s, which
+  /// needs the range of the output; ashikhmin_tone_map_view() finds
+  /// both with a parallel pass over the image.
+  template <class ImageT>
+  class AshikhminToneMapView : public ImageViewBase<AshikhminToneMapView<ImageT> > {
+    ImageT m_image;
+    double m_threshold, m_L_wmin, m_L_wmax;
+    double m_out_min, m_out_scale;
+
+  public:
+    typedef PixelRGB<float> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<AshikhminToneMapView> pixel_accessor;
+
+    /// Maps pixels to (display value - out_min) * out_scale.
+    AshikhminToneMapView( ImageT const& image, double threshold, double L_wmin, double L_wmax,
+                          double out_min = 0.0, double out_scale = 1.0 )
+      : m_image(image), m_threshold(threshold), m_L_wmin(L_wmin), m_L_wmax(L_wmax),
+        m_out_min(out_min), m_out_scale(out_scale) {}
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    // Costs a whole (small) block per pixel: rasterize instead.
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize( BBox2i(i,j,1,1) )(i,j,p);
+    }
+
+    ImageT const& child() const { return m_image; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      const int32 pad = detail::ashikhmin_padding();
+      BBox2i padded = bbox;
+      padded.expand( pad );
+
+      ImageView<PixelRGB<float> > src = crop( edge_extend( pixel_cast<PixelRGB<float> >(m_image), ConstantEdgeExtension() ), padded );
+      ImageView<float> L_w( src.cols(), src.rows() );
+      for ( int32 j = 0; j < src.rows(); ++j )
+        for ( int32 i = 0; i < src.cols(); ++i )
+          L_w(i,j) = PixelGray<float>( src(i,j) ).v();
+
+      ImageView<float> scale;
+      detail::ashikhmin_display_scale( L_w, m_threshold, m_L_wmin, m_L_wmax, scale );
+
+      ImageView<pixel_type> out( bbox.width(), bbox.height() );
+      const float out_min = float(m_out_min), out_scale = float(m_out_scale);
+      for ( int32 j = 0; j < out.rows(); ++j )
+        for ( int32 i = 0; i < out.cols(); ++i )
+          out(i,j) = (src(i+pad,j+pad) * scale(i,j) - out_min) * out_scale;
+
+      return prerasterize_type( out, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()) );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    /// \endcond
+  };
+
+  /// Returns a view that tone maps image with Ashikhmin's operator a
+  /// block at a time; see AshikhminToneMapView.  The ranges it needs
+  /// are found here with two parallel passes, one over the luminance
+  /// and one over the (unnormalized) tone mapped image.
+  template <class ImageT>
+  AshikhminToneMapView<ImageT> ashikhmin_tone_map_view( ImageViewBase<ImageT> const& image, double threshold = 0.5 ) {
+    const Vector2i block( vw_settings().default_tile_size(), vw_settings().default_tile_size() );
+
+    float L_wmin, L_wmax;
+    parallel_min_max_channel_values( pixel_cast<PixelGray<float> >(pixel_cast<PixelRGB<float> >(image.impl())), L_wmin, L_wmax, block );
+
+    float out_min, out_max;
+    parallel_min_max_channel_values( AshikhminToneMapView<ImageT>( image.impl(), threshold, L_wmin, L_wmax ), out_min, out_max, block );
+    const double out_scale = out_max > out_min ? 1.0 / (double(out_max) - out_min) : 1.0;
+
+    return AshikhminToneMapView<ImageT>( image.impl(), threshold, L_wmin, L_wmax, out_min, out_scale );
+  }
+
 }} // namespace vw::HDR
 
+namespace vw {
+  // The padded source block, its luminance, the blurs, and the output.
+  template <class ImageT>
+  class RasterizeFootprint<hdr::AshikhminToneMapView<ImageT> > {
+    hdr::AshikhminToneMapView<ImageT> const& m_view;
+  public:
+    RasterizeFootprint( hdr::AshikhminToneMapView<ImageT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return 0;
+      BBox2i padded = bbox;
+      padded.expand( hdr::detail::ashikhmin_padding() );
+      return RasterizeFootprint<ImageT>( m_view.child() )( padded ) +
+             raster_bytes<PixelRGB<float> >( padded, 1 ) + raster_bytes<float>( padded, 1 ) +
+             16 * raster_bytes<float>( bbox, 1 ) + raster_bytes<PixelRGB<float> >( bbox, 1 );
+    }
+  };
+} // namespace vw
+
 #endif  // __VW_HDR_LOCALTONEMAP_H__
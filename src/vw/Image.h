@@ -33,6 +33,7 @@
 #include <vw/Image/ViewImageResource.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/DistanceTransform.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/Image/Convolution.h>
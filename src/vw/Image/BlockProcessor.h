@@ -14,6 +14,9 @@
 /// passing it an arbitrarily large bounding box.  It will chop that
 /// bounding box up into blocks and call the callback function on
 /// each block, spawning as many child threads as you request.
+/// Blocks can be handed out in chunks, skipped when a check proves
+/// them empty, and ordered by a cost hint so that the expensive ones
+/// do not end up at the tail.
 ///
 /// Strictly speaking, this doesn't need to be in the Image module.
 /// However, it was designed for large image processing, it depends
@@ -23,21 +26,76 @@
 #ifndef __VW_IMAGE_BLOCKPROCESSOR_H__
 #define __VW_IMAGE_BLOCKPROCESSOR_H__
 
+#include <vw/Core/PerfCounters.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
 #include <vw/Math/BBox.h>
+#include <vw/Image/SparseImageCheck.h>
+
+#include <vector>
+#include <algorithm>
+#include <boost/function.hpp>
 
 namespace vw {
 
+  /// How a BlockProcessor hands blocks out to its threads.  With the
+  /// dynamic schedule each thread takes a fixed chunk of blocks at a
+  /// time.  With the guided schedule a chunk is a share of the
+  /// blocks still outstanding, so chunks start large and shrink
+  /// toward the chunk size as the work runs out, which keeps lock
+  /// traffic low without leaving threads idle at the tail.
+  enum BlockSchedule {
+    DynamicBlockSchedule,
+    GuidedBlockSchedule
+  };
+
   template <class FuncT>
   class BlockProcessor {
+  public:
+    /// Returns true if a block needs processing at all.
+    typedef boost::function<bool(BBox2i const&)> block_check_type;
+    /// Returns the relative cost of processing a block.
+    typedef boost::function<double(BBox2i const&)> block_cost_type;
+
+  private:
     FuncT m_func;
     Vector2i m_block_size;
     int m_num_threads;
+    BlockSchedule m_schedule;
+    int32 m_chunk_size;
+    block_check_type m_check;
+    block_cost_type m_cost;
+
   public:
     BlockProcessor( FuncT const& func, Vector2i const& block_size, int threads = 0 )
       : m_func(func), m_block_size(block_size),
-        m_num_threads(threads?threads:(vw_settings().default_num_threads())) {}
+        m_num_threads(threads?threads:(vw_settings().default_num_threads())),
+        m_schedule(DynamicBlockSchedule), m_chunk_size(1) {}
+
+    /// Sets the schedule and the (minimum) number of blocks a thread
+    /// takes at a time.  The default is dynamic, one block at a time.
+    void set_schedule( BlockSchedule schedule, int32 chunk_size = 1 ) {
+      m_schedule = schedule;
+      m_chunk_size = (chunk_size < 1) ? 1 : chunk_size;
+    }
+
+    /// Blocks for which the check returns false are skipped entirely:
+    /// the processing function is never called on them.
+    void set_block_check( block_check_type const& check ) { m_check = check; }
+
+    /// Skips the blocks that the image's SparseImageCheck proves
+    /// empty.
+    template <class ImageT>
+    void set_sparse_check( ImageT const& image ) {
+      m_check = SparseImageCheck<ImageT>( image );
+    }
+
+    /// Supplies an estimate of the cost of each block.  Blocks are
+    /// then handed out most expensive first, so that the cheap ones
+    /// fill in the gaps at the end instead of one expensive block
+    /// holding up the finish.  The hint is evaluated once per block
+    /// up front, so it should be cheap compared to the processing.
+    void set_cost_hint( block_cost_type const& cost ) { m_cost = cost; }
 
     // We will construct and call one BlockThread per thread.
     class BlockThread {
@@ -46,16 +104,54 @@ namespace vw {
       // which stores information about what block should be processed next.
       class Info {
       public:
-        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size )
+        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size,
+              BlockSchedule schedule, int32 chunk_size, int num_threads,
+              block_check_type const& check, block_cost_type const& cost )
           : m_func(func), m_total_bbox(total_bbox),
-            m_block_bbox(round_down(total_bbox.min().x(),block_size.x()),round_down(total_bbox.min().y(),block_size.y()),block_size.x(),block_size.y()),
-            m_block_size(block_size) {}
+            m_origin(round_down(total_bbox.min().x(),block_size.x()),round_down(total_bbox.min().y(),block_size.y())),
+            m_block_size(block_size), m_schedule(schedule), m_chunk_size(chunk_size),
+            m_num_threads(num_threads), m_check(check), m_next(0) {
+          if( total_bbox.empty() ) {
+            m_blocks_x = m_num_blocks = 0;
+            return;
+          }
+          m_blocks_x = (total_bbox.max().x() - m_origin.x() + block_size.x() - 1) / block_size.x();
+          int32 blocks_y = (total_bbox.max().y() - m_origin.y() + block_size.y() - 1) / block_size.y();
+          m_num_blocks = m_blocks_x * blocks_y;
+          if( ! cost.empty() ) {
+            // Sort by descending cost, keeping row order among equals.
+            std::vector<std::pair<double,int32> > costs( m_num_blocks );
+            for( int32 i=0; i<m_num_blocks; ++i )
+              costs[i] = std::make_pair( -cost( block(i) ), i );
+            std::stable_sort( costs.begin(), costs.end(), CompareCost() );
+            m_order.resize( m_num_blocks );
+            for( int32 i=0; i<m_num_blocks; ++i )
+              m_order[i] = costs[i].second;
+          }
+          pending_counter().add( m_num_blocks );
+        }
 
-        // Return the next block bbox to process.
-        BBox2i bbox() const {
-          BBox2i block_bbox = m_block_bbox;
-          block_bbox.crop( m_total_bbox );
-          return block_bbox;
+        // Blocks never claimed (because a thread threw) are no longer
+        // pending either.
+        ~Info() {
+          if( m_num_blocks > m_next ) pending_counter().sub( m_num_blocks - m_next );
+        }
+
+        // The number of blocks, over all block processors, that are
+        // waiting for a thread to claim them.
+        static PerfCounter& pending_counter() {
+          static PerfCounter& pending = vw_perf_counters().counter("block_processor.pending_blocks");
+          return pending;
+        }
+
+        // Return the bbox of the i'th block in processing order.
+        BBox2i bbox( int32 i ) const {
+          return block( m_order.empty() ? i : m_order[i] );
+        }
+
+        // Should the given block be processed at all?
+        bool check( BBox2i const& bbox ) const {
+          return m_check.empty() || m_check( bbox );
         }
 
         // Return the processing function.
@@ -63,25 +159,26 @@ namespace vw {
           return m_func;
         }
 
-        // Are we finished?
-        bool complete() const {
-          return ( m_block_bbox.min().y() >= m_total_bbox.max().y() );
-        }
-
         // Returns the info mutex, for locking.
         Mutex& mutex() {
           return m_mutex;
         }
 
-        // Advance the block_bbox to point to the next block to process.
-        void advance() {
-          m_block_bbox.min().x() += m_block_size.x();
-          if( m_block_bbox.min().x() >= m_total_bbox.max().x() ) {
-            m_block_bbox.min().x() = round_down(m_total_bbox.min().x(),m_block_size.x());
-            m_block_bbox.min().y() += m_block_size.y();
-            m_block_bbox.max().y() = m_block_bbox.min().y() + m_block_size.y();
+        // Claims the next chunk of blocks, [begin,end).  Returns false
+        // when there is nothing left.  Call with the mutex held.
+        bool next_chunk( int32& begin, int32& end ) {
+          int32 remaining = m_num_blocks - m_next;
+          if( remaining <= 0 ) return false;
+          int32 chunk = m_chunk_size;
+          if( m_schedule == GuidedBlockSchedule ) {
+            int32 guided = (remaining + 2*m_num_threads - 1) / (2*m_num_threads);
+            if( guided > chunk ) chunk = guided;
           }
-          m_block_bbox.max().x() = m_block_bbox.min().x() + m_block_size.x();
+          if( chunk > remaining ) chunk = remaining;
+          begin = m_next;
+          end = m_next = m_next + chunk;
+          pending_counter().sub( chunk );
+          return true;
         }
 
       private:
@@ -93,26 +190,50 @@ namespace vw {
           return val + ((val>=0) ? (-(val%mod)) : (((-val-1)%mod)-mod+1));
         }
 
+        struct CompareCost {
+          bool operator()( std::pair<double,int32> const& a, std::pair<double,int32> const& b ) const {
+            return a.first < b.first;
+          }
+        };
+
+        // Return the bbox of the i'th block in row order.
+        BBox2i block( int32 i ) const {
+          BBox2i block_bbox( m_origin.x() + (i % m_blocks_x) * m_block_size.x(),
+                             m_origin.y() + (i / m_blocks_x) * m_block_size.y(),
+                             m_block_size.x(), m_block_size.y() );
+          block_bbox.crop( m_total_bbox );
+          return block_bbox;
+        }
+
         FuncT const& m_func;
-        BBox2i m_total_bbox, m_block_bbox;
-        Vector2i m_block_size;
+        BBox2i m_total_bbox;
+        Vector2i m_origin, m_block_size;
+        BlockSchedule m_schedule;
+        int32 m_chunk_size;
+        int m_num_threads;
+        block_check_type const& m_check;
+        std::vector<int32> m_order;
+        int32 m_blocks_x, m_num_blocks, m_next;
         Mutex m_mutex;
       };
 
       BlockThread( Info &info ) : info(info) {}
 
       void operator()() {
+        static PerfCounter& processed = vw_perf_counters().counter("block_processor.blocks");
         while( true ) {
-          BBox2i bbox;
+          int32 begin, end;
           {
-            // Grab the next bbox to process, and update it with the
-            // subsequent bbox for the next thread to grab.
+            // Claim the next chunk of blocks to process.
             Mutex::Lock lock(info.mutex());
-            if( info.complete() ) return;
-            bbox = info.bbox();
-            info.advance();
+            if( ! info.next_chunk( begin, end ) ) return;
+          }
+          for( int32 i=begin; i<end; ++i ) {
+            BBox2i bbox = info.bbox( i );
+            if( ! info.check( bbox ) ) continue;
+            info.func()( bbox );
+            processed.add();
           }
-          info.func()( bbox );
         }
       }
 
@@ -121,7 +242,8 @@ namespace vw {
     };
 
     inline void operator()( BBox2i bbox ) const {
-      typename BlockThread::Info info( m_func, bbox, m_block_size );
+      typename BlockThread::Info info( m_func, bbox, m_block_size, m_schedule, m_chunk_size,
+                                       m_num_threads, m_check, m_cost );
 
       // Avoid threads altogether in the single-threaded case.
       // Annoyingly, this still creates an unnecessary Mutex.
@@ -14,6 +14,11 @@
 /// block at a time can dramatically improve performance by reducing
 /// memory utilization.
 ///
+/// While each block is rasterized, the one a wave of threads further
+/// on is prefetched through its child's RasterizePrefetch, so that a
+/// child reading from disk has it in memory by the time a thread gets
+/// to it.
+///
 #ifndef __VW_IMAGE_BLOCKRASTERIZE_H__
 #define __VW_IMAGE_BLOCKRASTERIZE_H__
 
@@ -22,9 +27,21 @@
 #include <vw/Image/PixelAccessors.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/BlockProcessor.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
+  /// Tells a view which region is going to be rasterized next, so that
+  /// it can start fetching it in the background.  The default does
+  /// nothing; views that read from slow storage specialize it in the
+  /// header that defines them, as ImageResourceView does.
+  template <class ViewT>
+  class RasterizePrefetch {
+  public:
+    RasterizePrefetch( ViewT const& /*view*/ ) {}
+    void operator()( BBox2i const& /*bbox*/ ) const {}
+  };
+
   /// A wrapper view that rasterizes its child in blocks.
   template <class ImageT>
   class BlockRasterizeView : public ImageViewBase<BlockRasterizeView<ImageT> > {
@@ -66,6 +83,9 @@ namespace vw {
     ImageT& child() { return *m_child; }
     ImageT const& child() const { return *m_child; }
 
+    /// The cache blocks are kept in, or 0.
+    Cache* cache() const { return m_cache_ptr; }
+
     typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const {
       ImageView<pixel_type> buf( bbox.width(), bbox.height(), planes() );
@@ -73,11 +93,36 @@ namespace vw {
       return CropView<ImageView<pixel_type> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
-      RasterizeFunctor<DestT> rasterizer( *this, dest, bbox.min() );
-      BlockProcessor<RasterizeFunctor<DestT> > process( rasterizer, m_block_size, m_num_threads );
+      int32 threads = m_num_threads ? m_num_threads : int32(vw_settings().default_num_threads());
+      RasterizeFunctor<DestT> rasterizer( *this, dest, bbox, threads );
+      BlockProcessor<RasterizeFunctor<DestT> > process( rasterizer, m_block_size, threads );
       process(bbox);
     }
 
+    /// Asks the child to start fetching bbox, or with a cache, the
+    /// blocks under bbox that are neither cached nor being generated.
+    /// See RasterizePrefetch.
+    void prefetch( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return;
+      RasterizePrefetch<ImageT> prefetch_child( *m_child );
+      if( ! m_cache_ptr ) {
+        prefetch_child( bbox );
+        return;
+      }
+      BBox2i view_bbox( 0, 0, cols(), rows() );
+      BBox2i region = bbox;
+      region.crop( view_bbox );
+      if( region.empty() ) return;
+      for( int32 iy=region.min().y()/m_block_size.y(); iy<=(region.max().y()-1)/m_block_size.y(); ++iy ) {
+        for( int32 ix=region.min().x()/m_block_size.x(); ix<=(region.max().x()-1)/m_block_size.x(); ++ix ) {
+          if( ! block(ix,iy).missing() ) continue;
+          BBox2i block_bbox( ix*m_block_size.x(), iy*m_block_size.y(), m_block_size.x(), m_block_size.y() );
+          block_bbox.crop( view_bbox );
+          prefetch_child( block_bbox );
+        }
+      }
+    }
+
   private:
     // These function objects are spawned to rasterize the child image.
     // One functor is created per child thread, and they are called
@@ -87,14 +132,38 @@ namespace vw {
     class RasterizeFunctor {
       BlockRasterizeView const& m_view;
       DestT const& m_dest;
-      Vector2i m_offset;
+      BBox2i m_total;
+      Vector2i m_offset, m_origin;
+      int32 m_blocks_x, m_num_blocks, m_ahead;
     public:
-      RasterizeFunctor( BlockRasterizeView const& view, DestT const& dest, Vector2i const& offset )
-        : m_view(view), m_dest(dest), m_offset(offset) {}
+      RasterizeFunctor( BlockRasterizeView const& view, DestT const& dest, BBox2i const& total, int32 threads )
+        : m_view(view), m_dest(dest), m_total(total), m_offset(total.min()), m_ahead(threads) {
+        // The BlockProcessor's grid, which it walks in row-major order.
+        Vector2i size = m_view.m_block_size;
+        m_origin = Vector2i( total.min().x() - ((total.min().x() % size.x()) + size.x()) % size.x(),
+                             total.min().y() - ((total.min().y() % size.y()) + size.y()) % size.y() );
+        m_blocks_x = (total.max().x() - m_origin.x() + size.x() - 1) / size.x();
+        m_num_blocks = total.empty() ? 0 : m_blocks_x * ((total.max().y() - m_origin.y() + size.y() - 1) / size.y());
+      }
+
+      // Prefetches the block the threads will get to once the ones
+      // they are on now are done.
+      void prefetch_ahead( BBox2i const& bbox ) const {
+        Vector2i size = m_view.m_block_size;
+        int32 next = ((bbox.min().y() - m_origin.y()) / size.y()) * m_blocks_x
+                   + (bbox.min().x() - m_origin.x()) / size.x() + m_ahead;
+        if( next >= m_num_blocks ) return;
+        BBox2i block( m_origin.x() + (next % m_blocks_x)*size.x(), m_origin.y() + (next / m_blocks_x)*size.y(),
+                      size.x(), size.y() );
+        block.crop( m_total );
+        m_view.prefetch( block );
+      }
+
       void operator()( BBox2i const& bbox ) const {
 #if VW_DEBUG_LEVEL > 1
         vw_out(VerboseDebugMessage, "image") << "BlockRasterizeView::RasterizeFunctor( " << bbox << " )" << std::endl;
 #endif
+        prefetch_ahead( bbox );
         if( m_view.m_cache_ptr ) {
           int32 ix=bbox.min().x()/m_view.m_block_size.x(), iy=bbox.min().y()/m_view.m_block_size.y();
 #if VW_DEBUG_LEVEL > 1
@@ -111,6 +180,7 @@ namespace vw {
 
     // Allows RasterizeFunctor to access cache-related members.
     template <class DestT> friend class RasterizeFunctor;
+    template <class> friend class RasterizeFootprint;
 
     // These objects rasterize a full block of image data to be
     // stored in the cache.
@@ -127,6 +197,9 @@ namespace vw {
         return m_bbox.width() * m_bbox.height() * m_child->planes() * sizeof(pixel_type);
       }
 
+      // The block is allocated and first written by the thread that
+      // generates it, so with worker_affinity set the kernel places its
+      // pages on that worker's NUMA node.
       boost::shared_ptr<ImageView<pixel_type> > generate() const {
         boost::shared_ptr<ImageView<pixel_type> > ptr( new ImageView<pixel_type>( m_bbox.width(), m_bbox.height(), m_child->planes() ) );
         m_child->rasterize( *ptr, m_bbox );
@@ -180,6 +253,47 @@ namespace vw {
     boost::shared_ptr<std::vector<Cache::Handle<BlockGenerator> > > m_block_table;
   };
 
+  /// Counts the buffer prerasterize() returns, and for each thread
+  /// that can be busy at once, what the child needs to rasterize one
+  /// block plus, when caching, the block itself.
+  template <class ImageT>
+  class RasterizeFootprint<BlockRasterizeView<ImageT> > {
+    BlockRasterizeView<ImageT> const& m_view;
+  public:
+    RasterizeFootprint( BlockRasterizeView<ImageT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      typedef typename BlockRasterizeView<ImageT>::pixel_type pixel_type;
+      if( bbox.empty() ) return 0;
+      Vector2i size = m_view.m_block_size;
+      size_t bytes = raster_bytes<pixel_type>( bbox, m_view.planes() );
+      Vector2i first( (bbox.min().x()/size.x())*size.x(), (bbox.min().y()/size.y())*size.y() );
+      size_t blocks = size_t( (bbox.max().x()-first.x()+size.x()-1)/size.x() )
+                    * size_t( (bbox.max().y()-first.y()+size.y()-1)/size.y() );
+      int32 threads = m_view.m_num_threads ? m_view.m_num_threads : vw_settings().default_num_threads();
+      BBox2i block;
+      size_t per_block = 0;
+      if( m_view.m_cache_ptr ) {
+        block = BBox2i( first.x(), first.y(), size.x(), size.y() );
+        block.crop( BBox2i( 0, 0, m_view.cols(), m_view.rows() ) );
+        per_block = raster_bytes<pixel_type>( block, m_view.planes() );
+      }
+      else {
+        block = BBox2i( bbox.min().x(), bbox.min().y(), size.x(), size.y() );
+        block.crop( bbox );
+      }
+      per_block += RasterizeFootprint<ImageT>( m_view.child() )( block );
+      return bytes + (std::min)( size_t( (std::max)( threads, 1 ) ), blocks ) * per_block;
+    }
+  };
+
+  template <class ImageT>
+  class RasterizePrefetch<BlockRasterizeView<ImageT> > {
+    BlockRasterizeView<ImageT> const& m_view;
+  public:
+    RasterizePrefetch( BlockRasterizeView<ImageT> const& view ) : m_view(view) {}
+    void operator()( BBox2i const& bbox ) const { m_view.prefetch( bbox ); }
+  };
+
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image, Vector2i const& block_size, int num_threads = 0 ) {
     return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads );
@@ -195,6 +309,85 @@ namespace vw {
     return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads, &cache );
   }
 
+  namespace detail {
+
+    // Rasterizes one block of a parallel_rasterize() call straight
+    // into the matching region of the destination.  Blocks are given
+    // in destination coordinates and offset into the source.
+    template <class SrcT, class DestT>
+    class ParallelRasterizeFunctor {
+      SrcT const& m_src;
+      DestT const& m_dest;
+      Vector2i m_offset;
+    public:
+      ParallelRasterizeFunctor( SrcT const& src, DestT const& dest, Vector2i const& offset )
+        : m_src(src), m_dest(dest), m_offset(offset) {}
+      void operator()( BBox2i const& bbox ) const {
+        m_src.rasterize( crop( m_dest, bbox ), bbox+m_offset );
+      }
+    };
+
+    // A band that spans the full width of a single-plane ImageView is
+    // contiguous, so it is handed to the source as an ImageView of
+    // its own and keeps the source's ImageView-only fast paths.
+    template <class SrcT, class PixelT>
+    class ParallelRasterizeFunctor<SrcT, ImageView<PixelT> > {
+      SrcT const& m_src;
+      ImageView<PixelT> const& m_dest;
+      Vector2i m_offset;
+    public:
+      ParallelRasterizeFunctor( SrcT const& src, ImageView<PixelT> const& dest, Vector2i const& offset )
+        : m_src(src), m_dest(dest), m_offset(offset) {}
+      void operator()( BBox2i const& bbox ) const {
+        if( m_dest.planes() == 1 && bbox.width() == m_dest.cols() )
+          m_src.rasterize( m_dest.row_band( bbox.min().y(), bbox.height() ), bbox+m_offset );
+        else
+          m_src.rasterize( crop( m_dest, bbox ), bbox+m_offset );
+      }
+    };
+
+  } // namespace detail
+
+  /// Rasterizes the region bbox of src into dest on several threads,
+  /// with no cache and no intermediate buffers: each thread
+  /// rasterizes its blocks directly into the corresponding region of
+  /// dest.  By default the region is cut into full-width row bands,
+  /// four per thread, so that threads which finish early pick up the
+  /// remaining work.  A num_threads of zero uses the
+  /// default_num_threads setting.
+  ///
+  /// The source view must tolerate being rasterized from several
+  /// threads at once, which is true of ImageView and the views built
+  /// from it, but not of views that keep per-call state.
+  template <class SrcT, class DestT>
+  void parallel_rasterize( ImageViewBase<SrcT> const& src, ImageViewBase<DestT> const& dest, BBox2i const& bbox,
+                           Vector2i block_size = Vector2i(), int num_threads = 0 ) {
+    VW_ASSERT( dest.impl().cols() == bbox.width() && dest.impl().rows() == bbox.height() && dest.impl().planes() == src.impl().planes(),
+               ArgumentErr() << "parallel_rasterize: Destination dimensions do not match the source region." );
+    if( bbox.empty() ) return;
+    if( num_threads <= 0 ) num_threads = vw_settings().default_num_threads();
+    if( block_size.x() <= 0 || block_size.y() <= 0 ) {
+      int32 band_rows = (bbox.height() + 4*num_threads - 1) / (4*num_threads);
+      block_size = Vector2i( bbox.width(), band_rows );
+    }
+    // The blocks are laid out over the destination, so the bands line
+    // up with its rows wherever the region sits in the source.
+    typedef detail::ParallelRasterizeFunctor<SrcT,DestT> func_type;
+    func_type func( src.impl(), dest.impl(), bbox.min() );
+    BlockProcessor<func_type> process( func, block_size, num_threads );
+    process( BBox2i( 0, 0, bbox.width(), bbox.height() ) );
+  }
+
+  /// Rasterizes all of src into dest on several threads, resizing
+  /// dest to match.  This is the parallel counterpart of assigning a
+  /// view to an ImageView.
+  template <class SrcT, class PixelT>
+  void parallel_rasterize( ImageViewBase<SrcT> const& src, ImageView<PixelT>& dest,
+                           Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    dest.set_size( src.impl().cols(), src.impl().rows(), src.impl().planes() );
+    parallel_rasterize( src, dest, BBox2i( 0, 0, src.impl().cols(), src.impl().rows() ), block_size, num_threads );
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_BLOCKRASTERIZE_H__
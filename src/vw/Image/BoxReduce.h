@@ -0,0 +1,163 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BoxReduce.h
+///
+/// Halving an image by averaging 2x2 blocks of pixels, the reduction
+/// used to build tile pyramids.
+///
+#ifndef __VW_IMAGE_BOXREDUCE_H__
+#define __VW_IMAGE_BOXREDUCE_H__
+
+#include <cmath>
+#include <boost/type_traits/is_integral.hpp>
+
+#include <vw/config.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The mean of four channel values, rounded to nearest for
+    // integer channels.
+    template <class ChannelT>
+    inline ChannelT box_reduce_mean( double sum ) {
+      if( boost::is_integral<ChannelT>::value ) return ChannelT( floor( sum*0.25 + 0.5 ) );
+      return ChannelT( sum*0.25 );
+    }
+
+    // Averages each 2x2 block of pixels from the rows r0 and r1, 2n
+    // pixels each, into the n pixels of dest.  The specializations
+    // below handle whole vectors of channels at a time.
+    template <class PixelT>
+    struct BoxReduceRow {
+      static void apply( PixelT const* r0, PixelT const* r1, PixelT* dest, int32 n ) {
+        typedef typename CompoundChannelType<PixelT>::type channel_type;
+        for( int32 i=0; i<n; ++i ) {
+          for( size_t c=0; c<CompoundNumChannels<PixelT>::value; ++c ) {
+            double sum = double( compound_select_channel<channel_type const&>( r0[2*i], c ) )
+                       + double( compound_select_channel<channel_type const&>( r0[2*i+1], c ) )
+                       + double( compound_select_channel<channel_type const&>( r1[2*i], c ) )
+                       + double( compound_select_channel<channel_type const&>( r1[2*i+1], c ) );
+            compound_select_channel<channel_type&>( dest[i], c ) = box_reduce_mean<channel_type>( sum );
+          }
+        }
+      }
+    };
+
+    template <class ChannelT>
+    inline void box_reduce_rgba_tail( PixelRGBA<ChannelT> const* r0, PixelRGBA<ChannelT> const* r1,
+                                      PixelRGBA<ChannelT>* dest, int32 i, int32 n ) {
+      for( ; i<n; ++i )
+        for( int32 c=0; c<4; ++c ) {
+          // Integer channels are summed exactly, before rounding once.
+          uint32 sum = uint32(r0[2*i][c]) + r0[2*i+1][c] + r1[2*i][c] + r1[2*i+1][c];
+          dest[i][c] = ChannelT( (sum + 2) >> 2 );
+        }
+    }
+
+    template <>
+    struct BoxReduceRow<PixelRGBA<uint8> > {
+      static void apply( PixelRGBA<uint8> const* r0, PixelRGBA<uint8> const* r1, PixelRGBA<uint8>* dest, int32 n ) {
+        int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+        // Four source pixels from each row give two results.
+        const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+        for( ; i+2 <= n; i += 2 ) {
+          __m128i a = _mm_loadu_si128( (__m128i const*)(r0+2*i) );
+          __m128i b = _mm_loadu_si128( (__m128i const*)(r1+2*i) );
+          __m128i lo = _mm_add_epi16( _mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero) );
+          __m128i hi = _mm_add_epi16( _mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero) );
+          lo = _mm_add_epi16( lo, _mm_srli_si128(lo, 8) );
+          hi = _mm_add_epi16( hi, _mm_srli_si128(hi, 8) );
+          __m128i sum = _mm_srli_epi16( _mm_add_epi16( _mm_unpacklo_epi64(lo, hi), two ), 2 );
+          _mm_storel_epi64( (__m128i*)(dest+i), _mm_packus_epi16(sum, sum) );
+        }
+#endif
+        box_reduce_rgba_tail( r0, r1, dest, i, n );
+      }
+    };
+
+    template <>
+    struct BoxReduceRow<PixelRGBA<uint16> > {
+      static void apply( PixelRGBA<uint16> const* r0, PixelRGBA<uint16> const* r1, PixelRGBA<uint16>* dest, int32 n ) {
+        int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+        // Two source pixels from each row give one result.  SSE2 has
+        // no unsigned 32-to-16 bit pack, so the sums are biased into
+        // the signed range and back.
+        const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi32(2);
+        const __m128i bias32 = _mm_set1_epi32(32768), bias16 = _mm_set1_epi16(-32768);
+        for( ; i+2 <= n; i += 2 ) {
+          __m128i a0 = _mm_loadu_si128( (__m128i const*)(r0+2*i) );
+          __m128i b0 = _mm_loadu_si128( (__m128i const*)(r1+2*i) );
+          __m128i a1 = _mm_loadu_si128( (__m128i const*)(r0+2*i+2) );
+          __m128i b1 = _mm_loadu_si128( (__m128i const*)(r1+2*i+2) );
+          __m128i s0 = _mm_add_epi32( _mm_add_epi32( _mm_unpacklo_epi16(a0, zero), _mm_unpackhi_epi16(a0, zero) ),
+                                      _mm_add_epi32( _mm_unpacklo_epi16(b0, zero), _mm_unpackhi_epi16(b0, zero) ) );
+          __m128i s1 = _mm_add_epi32( _mm_add_epi32( _mm_unpacklo_epi16(a1, zero), _mm_unpackhi_epi16(a1, zero) ),
+                                      _mm_add_epi32( _mm_unpacklo_epi16(b1, zero), _mm_unpackhi_epi16(b1, zero) ) );
+          s0 = _mm_sub_epi32( _mm_srli_epi32( _mm_add_epi32(s0, two), 2 ), bias32 );
+          s1 = _mm_sub_epi32( _mm_srli_epi32( _mm_add_epi32(s1, two), 2 ), bias32 );
+          _mm_storeu_si128( (__m128i*)(dest+i), _mm_xor_si128( _mm_packs_epi32(s0, s1), bias16 ) );
+        }
+#endif
+        box_reduce_rgba_tail( r0, r1, dest, i, n );
+      }
+    };
+
+    template <>
+    struct BoxReduceRow<PixelRGBA<float32> > {
+      static void apply( PixelRGBA<float32> const* r0, PixelRGBA<float32> const* r1, PixelRGBA<float32>* dest, int32 n ) {
+        int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        for( ; i < n; ++i ) {
+          float const* a = (float const*)(r0+2*i);
+          float const* b = (float const*)(r1+2*i);
+          __m128 sum = _mm_add_ps( _mm_add_ps( _mm_loadu_ps(a), _mm_loadu_ps(a+4) ),
+                                   _mm_add_ps( _mm_loadu_ps(b), _mm_loadu_ps(b+4) ) );
+          _mm_storeu_ps( (float*)(dest+i), _mm_mul_ps( sum, quarter ) );
+        }
+#endif
+        for( ; i < n; ++i )
+          for( int32 c=0; c<4; ++c )
+            dest[i][c] = ( (r0[2*i][c] + r0[2*i+1][c]) + (r1[2*i][c] + r1[2*i+1][c]) ) * 0.25f;
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// Halves an image by averaging each 2x2 block of pixels, writing
+  /// the (cols/2) by (rows/2) result into dest with its top left
+  /// corner at (x,y); a trailing odd row or column is dropped.
+  /// Integer channels are rounded to nearest.  Every channel is
+  /// averaged alike, which for premultiplied alpha pixels weights each
+  /// color by its alpha.  RGBA pixels with uint8, uint16 and float32
+  /// channels use SSE2 kernels where enabled.  Nothing is allocated,
+  /// so this can write straight into part of a larger tile.
+  template <class PixelT>
+  void box_reduce( ImageView<PixelT> const& src, ImageView<PixelT> const& dest, int32 x = 0, int32 y = 0 ) {
+    int32 cols = src.cols()/2, rows = src.rows()/2;
+    VW_ASSERT( x >= 0 && y >= 0 && x+cols <= dest.cols() && y+rows <= dest.rows() && src.planes() == dest.planes(),
+               ArgumentErr() << "box_reduce: The destination is too small." );
+    for( int32 p=0; p<src.planes(); ++p )
+      for( int32 j=0; j<rows; ++j )
+        detail::BoxReduceRow<PixelT>::apply( &src(0,2*j,p), &src(0,2*j+1,p), &dest(x,y+j,p), cols );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_BOXREDUCE_H__
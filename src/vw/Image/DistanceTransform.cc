@@ -0,0 +1,61 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Image/DistanceTransform.h>
+
+namespace {
+
+  // The one-dimensional transform of the n values f[0], f[stride],
+  // ..., the lower envelope of the parabolas rooted at each finite
+  // one.  v holds the roots of the parabolas in the envelope and z
+  // the boundaries between them; d receives the result.
+  void squared_distance_1d( double* f, ptrdiff_t stride, vw::int32 n,
+                            std::vector<vw::int32>& v, std::vector<double>& z, std::vector<double>& d ) {
+    const double inf = std::numeric_limits<double>::infinity();
+    vw::int32 k = -1;
+    for( vw::int32 q=0; q<n; ++q ) {
+      double fq = f[q*stride];
+      if( fq == inf ) continue;
+      double s = -inf;
+      if( k >= 0 ) {
+        // z[0] is -inf, so this stops before k goes negative.
+        while( true ) {
+          vw::int32 p = v[k];
+          s = ( (fq + double(q)*q) - (f[p*stride] + double(p)*p) ) / (2.0*(q-p));
+          if( s > z[k] ) break;
+          --k;
+        }
+      }
+      ++k;
+      v[k] = q;
+      z[k] = s;
+      z[k+1] = inf;
+    }
+    if( k < 0 ) return;
+
+    k = 0;
+    for( vw::int32 q=0; q<n; ++q ) {
+      while( z[k+1] < q ) ++k;
+      double dq = q - v[k];
+      d[q] = dq*dq + f[v[k]*stride];
+    }
+    for( vw::int32 q=0; q<n; ++q ) f[q*stride] = d[q];
+  }
+
+}
+
+// Columns first and then rows; each pass is the one-dimensional
+// transform of the result of the one before.
+void vw::detail::squared_distance_transform( double* f, int32 cols, int32 rows ) {
+  int32 n = (std::max)( cols, rows );
+  std::vector<int32> v( n );
+  std::vector<double> z( n+1 ), d( n );
+  for( int32 i=0; i<cols; ++i )
+    squared_distance_1d( f+i, cols, rows, v, z, d );
+  for( int32 j=0; j<rows; ++j )
+    squared_distance_1d( f+ptrdiff_t(j)*cols, 1, cols, v, z, d );
+}
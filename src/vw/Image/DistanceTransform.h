@@ -0,0 +1,161 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file DistanceTransform.h
+///
+/// Exact Euclidean distance transforms, the straight-line
+/// counterpart of grassfire(), computed in linear time with the
+/// method of Felzenszwalb and Huttenlocher, "Distance Transforms of
+/// Sampled Functions" (2004).
+///
+#ifndef __VW_IMAGE_DISTANCETRANSFORM_H__
+#define __VW_IMAGE_DISTANCETRANSFORM_H__
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Replaces each value f(x,y) of a row-major cols by rows buffer
+    // with the least of (x-u)^2 + (y-v)^2 + f(u,v) over the buffer.
+    // Infinite values take no part, and stay infinite where there
+    // is no finite one to draw on.
+    void squared_distance_transform( double* f, int32 cols, int32 rows );
+
+    // Fills a buffer covering window of the image, extended with
+    // zero pixels, with 0 at zero pixels and infinity elsewhere.
+    template <class ImageT>
+    void distance_transform_seeds( ImageT const& image, BBox2i const& window, std::vector<double>& f ) {
+      typedef typename ImageT::pixel_type pixel_type;
+      const pixel_type zero = pixel_type();
+      ImageView<pixel_type> src = crop( edge_extend( image, ZeroEdgeExtension() ), window );
+      f.resize( size_t(window.width()) * window.height() );
+      std::vector<double>::iterator out = f.begin();
+      for( int32 j=0; j<window.height(); ++j )
+        for( int32 i=0; i<window.width(); ++i, ++out )
+          *out = ( src(i,j) == zero ) ? 0 : std::numeric_limits<double>::infinity();
+    }
+
+  } // namespace detail
+  /// \endcond
+
+  // *******************************************************************
+  // euclidean_distance()
+  // *******************************************************************
+
+  /// Computes the Euclidean distance from each pixel to the nearest
+  /// pixel with zero value, assuming the borders of the image are
+  /// zero as grassfire() does, so that non-zero pixels on the edge
+  /// are at distance 1.  Zero pixels are at distance 0.  The result
+  /// is exact, in time linear in the number of pixels, and the whole
+  /// image is held in memory; see capped_euclidean_distance() for
+  /// the tiled alternative.
+  template <class SourceT, class OutputT>
+  void euclidean_distance( ImageViewBase<SourceT> const& src, ImageView<OutputT>& dst ) {
+    int32 cols = src.impl().cols(), rows = src.impl().rows();
+    BBox2i window( -1, -1, cols+2, rows+2 );
+    std::vector<double> f;
+    detail::distance_transform_seeds( src.impl(), window, f );
+    detail::squared_distance_transform( &f[0], window.width(), window.height() );
+    dst.set_size( cols, rows );
+    for( int32 j=0; j<rows; ++j )
+      for( int32 i=0; i<cols; ++i )
+        dst(i,j) = OutputT( sqrt( f[size_t(j+1)*window.width() + (i+1)] ) );
+  }
+
+  /// Without destination given, return in a newly-created ImageView<float32>
+  template <class SourceT>
+  ImageView<float32> euclidean_distance( ImageViewBase<SourceT> const& src ) {
+    ImageView<float32> result;
+    euclidean_distance( src, result );
+    return result;
+  }
+
+  // *******************************************************************
+  // capped_euclidean_distance()
+  // *******************************************************************
+
+  /// A view of the Euclidean distance transform of an image, as
+  /// computed by euclidean_distance(), with distances beyond a cap
+  /// clamped to it.  Each block is computed from the source within
+  /// the cap of it, so the view rasterizes exactly in bounded memory
+  /// and in parallel with block_rasterize() or block_write_image().
+  /// Feathering weights rarely need more than a few hundred pixels.
+  template <class ImageT>
+  class CappedEuclideanDistanceView : public ImageViewBase<CappedEuclideanDistanceView<ImageT> > {
+    ImageT m_image;
+    float32 m_cap;
+  public:
+    typedef float32 pixel_type;
+    typedef float32 result_type;
+    typedef ProceduralPixelAccessor<CappedEuclideanDistanceView> pixel_accessor;
+
+    CappedEuclideanDistanceView( ImageT const& image, float32 cap ) : m_image(image), m_cap(cap) {
+      VW_ASSERT( cap > 0, ArgumentErr() << "CappedEuclideanDistanceView: The cap must be positive." );
+    }
+
+    inline int32 cols() const { return m_image.cols(); }
+    inline int32 rows() const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      return prerasterize( BBox2i(i,j,1,1) )(i,j);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()) );
+    }
+
+    // Any zero pixel within the cap of the block lies in the window,
+    // and the ring of zeros just outside the image is as near as
+    // anything further out, so the window need go no further.
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      BBox2i window = bbox;
+      window.expand( int32( ceil( m_cap ) ) );
+      window.crop( BBox2i( -1, -1, cols()+2, rows()+2 ) );
+      std::vector<double> f;
+      detail::distance_transform_seeds( m_image, window, f );
+      detail::squared_distance_transform( &f[0], window.width(), window.height() );
+      ImageView<pixel_type> tile( bbox.width(), bbox.height() );
+      double cap2 = double(m_cap) * m_cap;
+      for( int32 j=0; j<bbox.height(); ++j ) {
+        double const* row = &f[size_t(bbox.min().y()+j-window.min().y())*window.width() + (bbox.min().x()-window.min().x())];
+        for( int32 i=0; i<bbox.width(); ++i )
+          tile(i,j) = ( row[i] < cap2 ) ? pixel_type( sqrt( row[i] ) ) : m_cap;
+      }
+      vw::rasterize( tile, dest, BBox2i(0,0,bbox.width(),bbox.height()) );
+    }
+    /// \endcond
+  };
+
+  /// The Euclidean distance transform of an image, clamped to cap,
+  /// as a view that can be computed a block at a time.
+  template <class ImageT>
+  inline CappedEuclideanDistanceView<ImageT> capped_euclidean_distance( ImageViewBase<ImageT> const& image, float32 cap ) {
+    return CappedEuclideanDistanceView<ImageT>( image.impl(), cap );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_DISTANCETRANSFORM_H__
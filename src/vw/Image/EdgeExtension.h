@@ -30,7 +30,9 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/RasterizeFootprint.h>
 #include <vw/Core/Log.h>
 
 namespace vw {
@@ -362,6 +364,9 @@ namespace vw {
 
     ImageT const& child() const { return m_image; }
     ExtensionT const& func() const { return m_extension_func; }
+    /// The position in the child of this view's origin.
+    int32 xoffset() const { return m_xoffset; }
+    int32 yoffset() const { return m_yoffset; }
     BBox2i source_bbox( BBox2i const& bbox ) const {
       return m_extension_func.source_bbox( m_image, bbox + Vector2i( m_xoffset, m_yoffset ) );
     }
@@ -374,7 +379,38 @@ namespace vw {
       vw_out(VerboseDebugMessage, "image") << "EdgeExtensionView: prerasterizing child view with bbox " << src_bbox << ".\n";
       return prerasterize_type(m_image.prerasterize(src_bbox), m_xoffset, m_yoffset, m_cols, m_rows, m_extension_func );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    /// Rasterization splits the requested region into the part that
+    /// lies inside the child image and a border around it.  A region
+    /// entirely inside the child is handed to the child's own
+    /// rasterize.  Otherwise the interior is copied straight from the
+    /// prerasterized child, and only the border pixels go through the
+    /// edge extension functor.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
+      Vector2i offset( m_xoffset, m_yoffset );
+      BBox2i interior = bbox + offset;
+      interior.crop( BBox2i( 0, 0, m_image.cols(), m_image.rows() ) );
+      if( interior == bbox + offset ) {
+        m_image.rasterize( dest, interior );
+        return;
+      }
+      prerasterize_type src = prerasterize( bbox );
+      if( interior.empty() ) {
+        vw::rasterize( src, dest, bbox );
+        return;
+      }
+      interior -= offset;
+      vw::rasterize( src.child(), crop( dest, interior - bbox.min() ), interior + offset );
+      // Full-width bands above and below the interior, then the
+      // pieces to its left and right.
+      BBox2i bands[4] = {
+        BBox2i( bbox.min().x(), bbox.min().y(), bbox.width(), interior.min().y() - bbox.min().y() ),
+        BBox2i( bbox.min().x(), interior.max().y(), bbox.width(), bbox.max().y() - interior.max().y() ),
+        BBox2i( bbox.min().x(), interior.min().y(), interior.min().x() - bbox.min().x(), interior.height() ),
+        BBox2i( interior.max().x(), interior.min().y(), bbox.max().x() - interior.max().x(), interior.height() ) };
+      for( int i=0; i<4; ++i )
+        if( !bands[i].empty() )
+          vw::rasterize( src, crop( dest, bands[i] - bbox.min() ), bands[i] );
+    }
   };
 
   template <class ImageT, class ExtensionT>
@@ -388,6 +424,19 @@ namespace vw {
     }
   };
 
+  template <class ImageT, class ExtensionT>
+  class RasterizeFootprint<EdgeExtensionView<ImageT, ExtensionT> > {
+    EdgeExtensionView<ImageT, ExtensionT> const& m_view;
+  public:
+    RasterizeFootprint(EdgeExtensionView<ImageT, ExtensionT> const& view)
+      : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      BBox2i src_bbox = m_view.source_bbox( bbox );
+      if( src_bbox.empty() ) return 0;
+      return RasterizeFootprint<ImageT>(m_view.child())( src_bbox );
+    }
+  };
+
 
   // *******************************************************************
   // General-purpose edge extension functions
@@ -23,6 +23,7 @@
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Convolution.h>
+#include <vw/Image/Morphology.h>
 
 namespace vw {
 
@@ -228,6 +229,69 @@ namespace vw {
   }
 
 
+  // Box and recursive Gaussian filter functions
+
+  /// This function replaces each pixel of an image with the mean of
+  /// the cols x rows window around it, using the given edge extension
+  /// mode to extend the source image as needed.  The window origin is
+  /// at <B>((cols-1)/2,(rows-1)/2)</B>.  The cost per pixel does not
+  /// depend on the window size.
+  template <class SrcT, class EdgeT>
+  BoxFilterView<SrcT, EdgeT>
+  inline box_filter( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return BoxFilterView<SrcT, EdgeT>( src.impl(), cols, rows, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::box_filter. It uses the default vw::ConstantEdgeExtension
+  /// mode.
+  template <class SrcT>
+  BoxFilterView<SrcT, ConstantEdgeExtension>
+  inline box_filter( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return BoxFilterView<SrcT, ConstantEdgeExtension>( src.impl(), cols, rows );
+  }
+
+  /// This function applies an approximate Gaussian smoothing filter
+  /// to an image, with standard deviations of x_sigma and y_sigma.
+  /// It uses Deriche's fourth-order recursive filter, whose cost per
+  /// pixel is independent of sigma, instead of convolving with a
+  /// sampled kernel as vw::gaussian_filter does.  It is the better
+  /// choice for large sigmas where a close approximation is enough.
+  /// \see vw::RecursiveGaussianView
+  template <class SrcT, class EdgeT>
+  RecursiveGaussianView<SrcT, EdgeT>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma, EdgeT edge ) {
+    return RecursiveGaussianView<SrcT, EdgeT>( src.impl(), x_sigma, y_sigma, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  RecursiveGaussianView<SrcT, ConstantEdgeExtension>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma ) {
+    return RecursiveGaussianView<SrcT, ConstantEdgeExtension>( src.impl(), x_sigma, y_sigma );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the same standard deviation
+  /// in both directions.
+  template <class SrcT, class EdgeT>
+  RecursiveGaussianView<SrcT, EdgeT>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double sigma, EdgeT edge ) {
+    return RecursiveGaussianView<SrcT, EdgeT>( src.impl(), sigma, sigma, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the same standard deviation
+  /// in both directions and the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  RecursiveGaussianView<SrcT, ConstantEdgeExtension>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double sigma ) {
+    return RecursiveGaussianView<SrcT, ConstantEdgeExtension>( src.impl(), sigma, sigma );
+  }
+
+
   // Image differentiation functions
 
   /// Applies a differentiation filter to an image.  This function
@@ -304,6 +368,107 @@ namespace vw {
   }
 
 
+  // Morphology and rank filter functions
+
+  /// This function replaces each channel of each pixel of an image
+  /// with its minimum over the cols x rows window around it (a
+  /// grayscale erosion with a rectangular structuring element),
+  /// using the given edge extension mode to extend the source image
+  /// as needed.  The window origin is at
+  /// <B>((cols-1)/2,(rows-1)/2)</B>.  The cost per pixel does not
+  /// depend on the window size.
+  template <class SrcT, class EdgeT>
+  MorphologyView<SrcT, EdgeT, false>
+  inline erode( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return MorphologyView<SrcT, EdgeT, false>( src.impl(), cols, rows, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::erode. It uses the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  MorphologyView<SrcT, ConstantEdgeExtension, false>
+  inline erode( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return MorphologyView<SrcT, ConstantEdgeExtension, false>( src.impl(), cols, rows );
+  }
+
+  /// This function replaces each channel of each pixel of an image
+  /// with its maximum over the cols x rows window around it (a
+  /// grayscale dilation with a rectangular structuring element).
+  /// \see vw::erode
+  template <class SrcT, class EdgeT>
+  MorphologyView<SrcT, EdgeT, true>
+  inline dilate( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return MorphologyView<SrcT, EdgeT, true>( src.impl(), cols, rows, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::dilate. It uses the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  MorphologyView<SrcT, ConstantEdgeExtension, true>
+  inline dilate( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return MorphologyView<SrcT, ConstantEdgeExtension, true>( src.impl(), cols, rows );
+  }
+
+  /// Morphological opening: an erosion followed by a dilation with
+  /// the same window, which removes bright features smaller than the
+  /// window.  The dilation's window origin is mirrored so the result
+  /// lines up with the source for even window sizes too.
+  template <class SrcT, class EdgeT>
+  MorphologyView<MorphologyView<SrcT, EdgeT, false>, EdgeT, true>
+  inline opening( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return MorphologyView<MorphologyView<SrcT, EdgeT, false>, EdgeT, true>
+      ( MorphologyView<SrcT, EdgeT, false>( src.impl(), cols, rows, edge ), cols, rows, cols/2, rows/2, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::opening. It uses the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  MorphologyView<MorphologyView<SrcT, ConstantEdgeExtension, false>, ConstantEdgeExtension, true>
+  inline opening( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return opening( src, cols, rows, ConstantEdgeExtension() );
+  }
+
+  /// Morphological closing: a dilation followed by an erosion with
+  /// the same window, which fills dark features smaller than the
+  /// window.
+  /// \see vw::opening
+  template <class SrcT, class EdgeT>
+  MorphologyView<MorphologyView<SrcT, EdgeT, true>, EdgeT, false>
+  inline closing( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return MorphologyView<MorphologyView<SrcT, EdgeT, true>, EdgeT, false>
+      ( MorphologyView<SrcT, EdgeT, true>( src.impl(), cols, rows, edge ), cols, rows, cols/2, rows/2, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::closing. It uses the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  MorphologyView<MorphologyView<SrcT, ConstantEdgeExtension, true>, ConstantEdgeExtension, false>
+  inline closing( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return closing( src, cols, rows, ConstantEdgeExtension() );
+  }
+
+  /// This function replaces each channel of each pixel of an image
+  /// with its median over the cols x rows window around it, using
+  /// the given edge extension mode to extend the source image as
+  /// needed.  The window origin is at
+  /// <B>((cols-1)/2,(rows-1)/2)</B>.  For 8-bit channels the cost per
+  /// pixel does not depend on the window size.
+  template <class SrcT, class EdgeT>
+  MedianFilterView<SrcT, EdgeT>
+  inline median_filter( ImageViewBase<SrcT> const& src, int32 cols, int32 rows, EdgeT edge ) {
+    return MedianFilterView<SrcT, EdgeT>( src.impl(), cols, rows, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::median_filter. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  MedianFilterView<SrcT, ConstantEdgeExtension>
+  inline median_filter( ImageViewBase<SrcT> const& src, int32 cols, int32 rows ) {
+    return MedianFilterView<SrcT, ConstantEdgeExtension>( src.impl(), cols, rows );
+  }
+
+
   // Per-pixel filter functions
 
   /// Filters an image by applying a user-supplied function to each
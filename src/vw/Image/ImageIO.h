@@ -13,13 +13,56 @@
 #ifndef __VW_IMAGE_IMAGEIO_H__
 #define __VW_IMAGE_IMAGEIO_H__
 
+#include <vw/Core/PerfCounters.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
 #include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/RasterizeFootprint.h>
+#include <vw/Image/SparseImageCheck.h>
+
+#include <map>
 
 namespace vw {
 
+  namespace detail {
+
+    // Every resource read and write in this file goes through these,
+    // so that they are counted in vw_perf_counters().
+    inline void counted_read( SrcImageResource const& src, ImageBuffer const& buf, BBox2i const& bbox ) {
+      static PerfCounter& bytes = vw_perf_counters().counter("image_resource.read_bytes");
+      static PerfHistogram& time = vw_perf_counters().histogram("image_resource.read_us");
+      {
+        PerfTimer timer( time );
+        src.read( buf, bbox );
+      }
+      bytes.add( buf.format.byte_size() );
+    }
+
+    inline void counted_write( DstImageResource& dst, ImageBuffer const& buf, BBox2i const& bbox ) {
+      static PerfCounter& bytes = vw_perf_counters().counter("image_resource.write_bytes");
+      static PerfHistogram& time = vw_perf_counters().histogram("image_resource.write_us");
+      {
+        PerfTimer timer( time );
+        dst.write( buf, bbox );
+      }
+      bytes.add( buf.format.byte_size() );
+    }
+
+    inline void counted_write_encoded( DstImageResource& dst, std::vector<uint8> const& data, BBox2i const& bbox ) {
+      static PerfCounter& bytes = vw_perf_counters().counter("image_resource.write_bytes");
+      static PerfHistogram& time = vw_perf_counters().histogram("image_resource.write_us");
+      {
+        PerfTimer timer( time );
+        dst.write_encoded_block( data, bbox );
+      }
+      bytes.add( data.size() );
+    }
+
+  } // namespace detail
+
   // *******************************************************************
   // Image view reading and writing functions.
   // *******************************************************************
@@ -34,7 +77,7 @@ namespace vw {
       planes = (std::max)( src.planes(), src.channels() );
     }
     dst.set_size( bbox.width(), bbox.height(), planes );
-    src.read( dst.buffer(), bbox );
+    detail::counted_read( src, dst.buffer(), bbox );
   }
 
   template <class PixelT>
@@ -44,7 +87,7 @@ namespace vw {
 
   template <class PixelT>
   inline void read_image( ImageView<PixelT> const& dst, SrcImageResource const& src, BBox2i const& bbox ) {
-    src.read( dst.buffer(), bbox );
+    detail::counted_read( src, dst.buffer(), bbox );
   }
 
   template <class PixelT>
@@ -66,7 +109,7 @@ namespace vw {
 
   template <class PixelT>
   inline void write_image( DstImageResource &dst, ImageView<PixelT> const& src, BBox2i const& bbox ) {
-    dst.write( src.buffer(), bbox );
+    detail::counted_write( dst, src.buffer(), bbox );
   }
 
   template <class PixelT>
@@ -131,6 +174,24 @@ namespace vw {
     }
   };
 
+  // Holds the blocks rasterized from the regions of an image that its
+  // SparseImageCheck finds empty, one for each block size, so that
+  // images whose empty regions are all alike (see
+  // SparseFillIsConstant) rasterize them only once.
+  template <class PixelT>
+  class EmptyBlockCache : private boost::noncopyable {
+    Mutex m_mutex;
+    std::map<std::pair<int32,int32>, ImageView<PixelT> > m_blocks;
+  public:
+    template <class ViewT>
+    ImageView<PixelT> get( ViewT const& image, BBox2i const& bbox ) {
+      Mutex::Lock lock(m_mutex);
+      ImageView<PixelT>& block = m_blocks[std::make_pair(bbox.width(), bbox.height())];
+      if ( !block.data() ) block = crop(image, bbox);
+      return block;
+    }
+  };
+
   // This task generator manages the rasterizing and writing of images to disk.
   //
   // Only one thread can be writing to the ImageResource at any given
@@ -160,7 +221,29 @@ namespace vw {
       virtual ~WriteBlockTask() {}
       virtual void operator() () {
         vw_out(DebugMessage, "image") << "Writing block " << m_idx << " at " << m_bbox << "\n";
-        m_resource.write( m_image_block.buffer(), m_bbox );
+        detail::counted_write( m_resource, m_image_block.buffer(), m_bbox );
+        m_write_finish_event.notify();
+      }
+    };
+
+    // -----------------------------
+
+    class WriteEncodedBlockTask : public Task {
+      DstImageResource& m_resource;
+      boost::shared_ptr<std::vector<uint8> > m_encoded;
+      BBox2i m_bbox;
+      int m_idx;
+      CountingSemaphore& m_write_finish_event;
+
+    public:
+      WriteEncodedBlockTask(DstImageResource& resource, boost::shared_ptr<std::vector<uint8> > const& encoded,
+                            BBox2i bbox, int idx, CountingSemaphore& write_finish_event) :
+      m_resource(resource), m_encoded(encoded), m_bbox(bbox), m_idx(idx), m_write_finish_event(write_finish_event) {}
+
+      virtual ~WriteEncodedBlockTask() {}
+      virtual void operator() () {
+        vw_out(DebugMessage, "image") << "Writing encoded block " << m_idx << " at " << m_bbox << "\n";
+        detail::counted_write_encoded( m_resource, *m_encoded, m_bbox );
         m_write_finish_event.notify();
       }
     };
@@ -177,15 +260,19 @@ namespace vw {
       int m_total_num_blocks;
       SubProgressCallback m_progress_callback;
       CountingSemaphore& m_write_finish_event;
+      boost::shared_ptr<EmptyBlockCache<typename ViewT::pixel_type> > m_empty_blocks;
 
     public:
       RasterizeBlockTask(ThreadedBlockWriter &parent, DstImageResource& resource,
                          ImageViewBase<ViewT> const& image, BBox2i const& bbox,
                          int index, int total_num_blocks,
                          CountingSemaphore& write_finish_event,
-                         const ProgressCallback &progress_callback = ProgressCallback::dummy_instance()) :
+                         const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                         boost::shared_ptr<EmptyBlockCache<typename ViewT::pixel_type> > const& empty_blocks
+                           = boost::shared_ptr<EmptyBlockCache<typename ViewT::pixel_type> >()) :
       m_parent(parent), m_resource(resource), m_image(image.impl()), m_bbox(bbox), m_index(index),
-        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)), m_write_finish_event(write_finish_event) {}
+        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)), m_write_finish_event(write_finish_event),
+        m_empty_blocks(empty_blocks) {}
 
       virtual ~RasterizeBlockTask() {}
       virtual void operator()() {
@@ -193,14 +280,29 @@ namespace vw {
         m_write_finish_event.wait(m_index);
 
         vw_out(DebugMessage, "image") << "Rasterizing block " << m_index << " at " << m_bbox << "\n";
-        // Rasterize the block
-        ImageView<typename ViewT::pixel_type> image_block( crop(m_image, m_bbox) );
+        // Rasterize the block, or reuse the one rasterized for an
+        // earlier empty block of the same size.
+        ImageView<typename ViewT::pixel_type> image_block;
+        if ( m_empty_blocks && !sparse_check(m_image, m_bbox) )
+          image_block = m_empty_blocks->get(m_image, m_bbox);
+        else
+          image_block = crop(m_image, m_bbox);
 
         // Report progress
         m_progress_callback.report_incremental_progress(1.0);
 
-        // With rasterization complete, we queue up a request to write this block to disk.
-        boost::shared_ptr<Task> write_task ( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, image_block, m_bbox, m_index, m_write_finish_event ) );
+        // With rasterization complete, we queue up a request to write
+        // this block to disk.  Resources that can encode blocks on
+        // their own get that done here, so that compression runs on
+        // all the rasterizing threads instead of the single writer.
+        boost::shared_ptr<Task> write_task;
+        if ( m_resource.has_block_encode() ) {
+          boost::shared_ptr<std::vector<uint8> > encoded( new std::vector<uint8>() );
+          m_resource.encode_block( image_block.buffer(), m_bbox, *encoded );
+          write_task.reset( new WriteEncodedBlockTask( m_resource, encoded, m_bbox, m_index, m_write_finish_event ) );
+        } else {
+          write_task.reset( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, image_block, m_bbox, m_index, m_write_finish_event ) );
+        }
 
         m_parent.add_write_task(write_task, m_index);
       }
@@ -212,18 +314,22 @@ namespace vw {
     void add_rasterize_task(boost::shared_ptr<Task> task) { m_rasterize_work_queue->add_task(task); }
 
   public:
-    ThreadedBlockWriter() : m_write_queue_limit(vw_settings().write_pool_size()) {
-      m_rasterize_work_queue = boost::shared_ptr<FifoWorkQueue>( new FifoWorkQueue() );
+    ThreadedBlockWriter( int num_threads = vw_settings().default_num_threads() ) : m_write_queue_limit(vw_settings().write_pool_size()) {
+      m_rasterize_work_queue = boost::shared_ptr<FifoWorkQueue>( new FifoWorkQueue(num_threads) );
       m_write_work_queue = boost::shared_ptr<OrderedWorkQueue>( new OrderedWorkQueue(1) );
     }
 
     // Add a block to be rasterized.  You can optionally supply an
     // index, which will indicate the order in which this block should
-    // be written to disk.
+    // be written to disk.  If an empty block cache is given, blocks
+    // that the image's SparseImageCheck finds empty are taken from it
+    // instead of being rasterized.
     template <class ViewT>
     void add_block(DstImageResource& resource, ImageViewBase<ViewT> const& image, BBox2i const& bbox, int index, int total_num_blocks,
-                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
-      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, total_num_blocks, m_write_queue_limit, progress_callback) );
+                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                   boost::shared_ptr<EmptyBlockCache<typename ViewT::pixel_type> > const& empty_blocks
+                     = boost::shared_ptr<EmptyBlockCache<typename ViewT::pixel_type> >() ) {
+      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, total_num_blocks, m_write_queue_limit, progress_callback, empty_blocks) );
       this->add_rasterize_task(task);
     }
 
@@ -234,8 +340,150 @@ namespace vw {
   };
 
 
+  /// How block_write_image() divides up the work.  Zero members keep
+  /// the defaults: the resource's block_write_size() (or the whole
+  /// image, for resources without block writes), default_num_threads()
+  /// rasterizing threads, and the system cache left at its current
+  /// size.  A non-zero cache_size is applied to the system cache for
+  /// the duration of the write.
+  struct BlockWriteConfig {
+    Vector2i block_size;
+    int32 num_threads;
+    size_t cache_size;
+    BlockWriteConfig() : block_size(0,0), num_threads(0), cache_size(0) {}
+  };
+
+  namespace detail {
+
+    // Sets the system cache size for as long as it is in scope.
+    class ScopedSystemCacheSize : private boost::noncopyable {
+      size_t m_old_size;
+      bool m_changed;
+    public:
+      ScopedSystemCacheSize( size_t size ) : m_old_size(vw_settings().system_cache_size()), m_changed(size != 0) {
+        if ( m_changed ) vw_settings().set_system_cache_size( size );
+      }
+      ~ScopedSystemCacheSize() {
+        if ( m_changed ) vw_settings().set_system_cache_size( m_old_size );
+      }
+    };
+
+    inline size_t count_blocks( Vector2i const& image_size, Vector2i const& block_size ) {
+      return size_t((image_size.y()-1)/block_size.y()+1) * size_t((image_size.x()-1)/block_size.x()+1);
+    }
+
+  } // namespace detail
+
+  /// Chooses a BlockWriteConfig for writing the image to the resource
+  /// in no more than memory_limit bytes.
+  ///
+  /// Each candidate block size (1, 2, 4 and 8 times the resource's own
+  /// block_write_size() in each direction) is timed by rasterizing two
+  /// probe blocks of that size on the calling thread, and its memory
+  /// per block is taken as the block itself plus the temporaries that
+  /// RasterizeFootprint expects rasterizing it to allocate.  The
+  /// thread count for each size is the largest, up to
+  /// default_num_threads(), for which the blocks being rasterized plus
+  /// the write_pool_size() blocks that may be waiting to be written
+  /// fit in the limit, and the pair with the shortest expected time is
+  /// chosen.  Whatever memory is left goes to the system cache.  The
+  /// choice is logged to the "image" log namespace.
+  ///
+  /// The probes warm the system cache, which can make later (larger)
+  /// candidates look slightly faster than they are, so the timing is
+  /// only a rough guide.  Resources without block writes are always
+  /// written as a single block, so only the cache size is chosen.
+  template <class ImageT>
+  BlockWriteConfig tune_block_write( DstImageResource const& resource, ImageViewBase<ImageT> const& image,
+                                     size_t memory_limit ) {
+    typedef typename ImageT::pixel_type pixel_type;
+    ImageT const& view = image.impl();
+    const int32 cols = view.cols(), rows = view.rows();
+    VW_ASSERT( cols != 0 && rows != 0 && view.planes() != 0,
+               ArgumentErr() << "tune_block_write: cannot write an empty image to a resource" );
+
+    BlockWriteConfig config;
+    const int32 max_threads = std::max<int32>( 1, vw_settings().default_num_threads() );
+    const size_t queue_limit = vw_settings().write_pool_size();
+
+    if ( !resource.has_block_write() ) {
+      BBox2i whole( 0, 0, cols, rows );
+      size_t needed = raster_bytes<pixel_type>( whole, view.planes() ) + estimate_rasterize_bytes( view, whole );
+      if ( needed < memory_limit ) config.cache_size = memory_limit - needed;
+      vw_out(InfoMessage, "image") << "tune_block_write: writing " << cols << "x" << rows
+                                   << " as one block, system cache " << config.cache_size << " bytes\n";
+      return config;
+    }
+
+    const Vector2i native = resource.block_write_size();
+    double best_seconds = 0;
+    size_t best_memory = 0;
+    bool best_fits = false;
+    Vector2i last_size;
+    for ( int32 scale = 1; scale <= 8; scale *= 2 ) {
+      Vector2i block_size( std::min( native.x()*scale, cols ), std::min( native.y()*scale, rows ) );
+      if ( block_size == last_size ) break;
+      last_size = block_size;
+
+      // Time probe blocks a third and two thirds of the way down the
+      // diagonal of the image, aligned to the block grid.
+      Stopwatch watch;
+      ImageView<pixel_type> probe;
+      for ( int k = 1; k <= 2; ++k ) {
+        int32 x = (int32(int64(cols) * k / 3) / block_size.x()) * block_size.x();
+        int32 y = (int32(int64(rows) * k / 3) / block_size.y()) * block_size.y();
+        BBox2i bbox( x, y, std::min( block_size.x(), cols-x ), std::min( block_size.y(), rows-y ) );
+        watch.start();
+        probe = crop( view, bbox );
+        watch.stop();
+      }
+      double block_seconds = watch.elapsed_seconds() / 2;
+
+      BBox2i block( 0, 0, block_size.x(), block_size.y() );
+      size_t block_bytes = raster_bytes<pixel_type>( block, view.planes() );
+      size_t work_bytes = block_bytes + estimate_rasterize_bytes( view, block );
+      size_t num_blocks = detail::count_blocks( Vector2i(cols,rows), block_size );
+      size_t queued_bytes = std::min( queue_limit, num_blocks ) * block_bytes;
+
+      int32 threads = int32( std::min<size_t>( num_blocks, max_threads ) );
+      while ( threads > 1 && threads * work_bytes + queued_bytes > memory_limit ) --threads;
+      size_t memory = threads * work_bytes + queued_bytes;
+      bool fits = memory <= memory_limit;
+
+      double seconds = double( (num_blocks + threads - 1) / threads ) * block_seconds;
+      vw_out(DebugMessage, "image") << "tune_block_write: " << block_size.x() << "x" << block_size.y()
+                                    << " blocks on " << threads << " threads: " << seconds << " s, "
+                                    << memory << " bytes\n";
+      // Sizes that fit beat those that don't, then the fastest wins,
+      // or failing that the smallest.
+      if ( config.num_threads == 0 || (fits && !best_fits) ||
+           (fits == best_fits && (fits ? seconds < best_seconds : memory < best_memory)) ) {
+        config.block_size = block_size;
+        config.num_threads = threads;
+        best_seconds = seconds;
+        best_memory = memory;
+        best_fits = fits;
+      }
+    }
+
+    if ( !best_fits )
+      vw_out(WarningMessage, "image") << "tune_block_write: even one " << config.block_size.x() << "x"
+                                      << config.block_size.y() << " block at a time needs " << best_memory
+                                      << " bytes, more than the limit of " << memory_limit << "\n";
+    else
+      config.cache_size = memory_limit - best_memory;
+
+    vw_out(InfoMessage, "image") << "tune_block_write: " << config.block_size.x() << "x" << config.block_size.y()
+                                 << " blocks on " << config.num_threads << " threads, system cache "
+                                 << config.cache_size << " bytes, about " << best_seconds << " s\n";
+    return config;
+  }
+
+  /// Writes the image to the resource in blocks, rasterizing them on
+  /// several threads at once and writing them in order.
   template <class ImageT>
   void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          BlockWriteConfig const& config,
                           const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
 
     VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
@@ -249,11 +497,15 @@ namespace vw {
     const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
     const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
 
+    detail::ScopedSystemCacheSize cache_size( config.cache_size );
+
     // Write the image to disk in blocks.  We may need to revisit
     // the order in which these blocks are rasterized, but for now
     // it rasterizes blocks from left to right, then top to bottom.
     Vector2i block_size(cols, rows);
-    if (resource.has_block_write())
+    if (config.block_size.x() > 0 && config.block_size.y() > 0)
+      block_size = config.block_size;
+    else if (resource.has_block_write())
       block_size = resource.block_write_size();
 
     size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
@@ -262,11 +514,18 @@ namespace vw {
     // Early out for easy case
     if (total_num_blocks == 1) {
       ImageView<typename ImageT::pixel_type> image_block = image.impl();
-      resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
+      detail::counted_write( resource, image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
     } else {
       // Set up the threaded block writer object, which will manage rasterizing
       // and writing images to disk one block (and one thread) at a time.
-      ThreadedBlockWriter block_writer;
+      ThreadedBlockWriter block_writer( config.num_threads > 0 ? config.num_threads
+                                                               : vw_settings().default_num_threads() );
+
+      // Images whose empty regions all look the same only need one
+      // of them rasterized per block size.
+      boost::shared_ptr<EmptyBlockCache<typename ImageT::pixel_type> > empty_blocks;
+      if ( SparseFillIsConstant<ImageT>::value )
+        empty_blocks.reset( new EmptyBlockCache<typename ImageT::pixel_type>() );
 
       for (int32 j = 0; j < rows; j+= block_size.y()) {
         for (int32 i = 0; i < cols; i+= block_size.x()) {
@@ -283,7 +542,7 @@ namespace vw {
           int j_block_index = int(j/block_size.y());
           int index = j_block_index*col_blocks+i_block_index;
 
-          block_writer.add_block(resource, image, current_bbox, index, total_num_blocks, progress_callback );
+          block_writer.add_block(resource, image, current_bbox, index, total_num_blocks, progress_callback, empty_blocks );
         }
       }
 
@@ -293,6 +552,14 @@ namespace vw {
     progress_callback.report_finished();
   }
 
+  /// Writes the image to the resource in blocks of the resource's own
+  /// block_write_size(), with the default number of threads.
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+    block_write_image( resource, image, BlockWriteConfig(), progress_callback );
+  }
+
   template <class ImageT>
   void write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
@@ -321,7 +588,7 @@ namespace vw {
     // Early out for easy case
     if (total_num_blocks == 1) {
       ImageView<typename ImageT::pixel_type> image_block = image.impl();
-      resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
+      detail::counted_write( resource, image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
     } else {
       for (int32 j = 0; j < rows; j+= block_size.y()) {
         for (int32 i = 0; i < cols; i+= block_size.x()) {
@@ -339,7 +606,7 @@ namespace vw {
           // Rasterize this image block
           ImageView<typename ImageT::pixel_type> image_block( crop(image.impl(), current_bbox) );
           ImageBuffer buf = image_block.buffer();
-          resource.write( buf, current_bbox );
+          detail::counted_write( resource, buf, current_bbox );
 
         }
       }
@@ -347,6 +614,45 @@ namespace vw {
     progress_callback.report_finished();
   }
 
+  /// Writes the image to a resource that has_scanline_write(),
+  /// rasterizing and writing lines rows at a time from the top down.
+  /// Only those rows, and whatever the view needs to compute them
+  /// (e.g. a convolution kernel's height more of its source), are in
+  /// memory at once, so a view chain of row-local operations is
+  /// streamed from its source files to the resource in memory that
+  /// does not grow with the image.  Unlike block_write_image(), this
+  /// rasterizes on the calling thread only.
+  template <class ImageT>
+  void stream_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image, int32 lines = 1,
+                           const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
+
+    VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
+               ArgumentErr() << "stream_write_image: cannot write an empty image to a resource" );
+    VW_ASSERT( resource.has_scanline_write(),
+               NoImplErr() << "stream_write_image: the resource does not accept scanline writes" );
+    VW_ASSERT( lines > 0, ArgumentErr() << "stream_write_image: lines must be positive" );
+
+    progress_callback.report_progress(0);
+    if (progress_callback.abort_requested())
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+
+    const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
+    const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
+
+    // The strip is only reallocated for a short last strip.
+    ImageView<typename ImageT::pixel_type> strip;
+    for (int32 j = 0; j < rows; j += lines) {
+      BBox2i current_bbox( 0, j, cols, (std::min)(lines, rows-j) );
+      progress_callback.report_progress( float(j) / float(rows) );
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+
+      strip = crop(image.impl(), current_bbox);
+      detail::counted_write( resource, strip.buffer(), current_bbox );
+    }
+    progress_callback.report_finished();
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGEIO_H__
@@ -53,6 +53,7 @@
 #include <vw/Core/Functors.h>
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/PixelMask.h>
+#include <vw/Image/ImageMathKernels.h>
 
 namespace vw {
 
@@ -0,0 +1,392 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Image/ImageMathKernels.h
+///
+/// Fast paths for the arithmetic operators of ImageMath.h.
+///
+/// Pixel-by-pixel rasterization of a per-pixel view goes through two
+/// layers of accessors per pixel, which keeps the compiler from
+/// vectorizing even the simplest image sums.  When both operands and
+/// the destination are ImageViews of the same unmasked pixel type
+/// with float or double channels, the views below instead run over
+/// each row as one flat array of channels.  With --enable-sse those
+/// loops use SSE (and SSE2 for double); otherwise they are plain
+/// loops that the optimizer is free to vectorize for the target.
+/// Everything else still takes the generic path.
+///
+/// Supported: image+image, image-image, image*image, image/image
+/// (single-channel pixels only, since safe division of a multi-channel
+/// pixel is decided per pixel rather than per channel), the same four
+/// with a scalar of the channel type on either side, and abs().
+///
+#ifndef __VW_IMAGE_IMAGEMATHKERNELS_H__
+#define __VW_IMAGE_IMAGEMATHKERNELS_H__
+
+#include <cmath>
+
+#include <boost/type_traits.hpp>
+#include <boost/mpl/bool.hpp>
+
+#include <vw/config.h>
+#include <vw/Core/Functors.h>
+#include <vw/Math/Functors.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelMath.h>
+#include <vw/Image/PixelMask.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+#include <xmmintrin.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#endif
+
+namespace vw {
+namespace detail {
+
+  // ----------------------------------------------------------------
+  // Element operations.  Each provides a scalar apply() and, where
+  // SSE is enabled, vector versions of it.
+  // ----------------------------------------------------------------
+
+  struct KernelAdd {
+    template <class T> static inline T apply( T a, T b ) { return a + b; }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    static inline __m128 apply( __m128 a, __m128 b ) { return _mm_add_ps(a,b); }
+#ifdef __SSE2__
+    static inline __m128d apply( __m128d a, __m128d b ) { return _mm_add_pd(a,b); }
+#endif
+#endif
+  };
+
+  struct KernelSub {
+    template <class T> static inline T apply( T a, T b ) { return a - b; }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    static inline __m128 apply( __m128 a, __m128 b ) { return _mm_sub_ps(a,b); }
+#ifdef __SSE2__
+    static inline __m128d apply( __m128d a, __m128d b ) { return _mm_sub_pd(a,b); }
+#endif
+#endif
+  };
+
+  struct KernelMul {
+    template <class T> static inline T apply( T a, T b ) { return a * b; }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    static inline __m128 apply( __m128 a, __m128 b ) { return _mm_mul_ps(a,b); }
+#ifdef __SSE2__
+    static inline __m128d apply( __m128d a, __m128d b ) { return _mm_mul_pd(a,b); }
+#endif
+#endif
+  };
+
+  // Matches ArgArgSafeQuotientFunctor: division by zero gives zero.
+  // The vector versions mask the quotient with b != 0, which clears
+  // the inf or nan produced by a zero divisor.
+  struct KernelSafeDiv {
+    template <class T> static inline T apply( T a, T b ) { return b == T() ? T() : a / b; }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    static inline __m128 apply( __m128 a, __m128 b ) {
+      return _mm_and_ps( _mm_div_ps(a,b), _mm_cmpneq_ps(b, _mm_setzero_ps()) );
+    }
+#ifdef __SSE2__
+    static inline __m128d apply( __m128d a, __m128d b ) {
+      return _mm_and_pd( _mm_div_pd(a,b), _mm_cmpneq_pd(b, _mm_setzero_pd()) );
+    }
+#endif
+#endif
+  };
+
+  struct KernelAbs {
+    template <class T> static inline T apply( T a ) { return std::fabs(a); }
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    static inline __m128 apply( __m128 a ) { return _mm_andnot_ps( _mm_set1_ps(-0.0f), a ); }
+#ifdef __SSE2__
+    static inline __m128d apply( __m128d a ) { return _mm_andnot_pd( _mm_set1_pd(-0.0), a ); }
+#endif
+#endif
+  };
+
+  // ----------------------------------------------------------------
+  // Array loops.  d may alias a or b exactly, but not partially.
+  // ----------------------------------------------------------------
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  // Vector register access for each channel type.  The primary
+  // template has no vector type, which turns the SIMD loops off.
+  template <class T> struct KernelSimd { static const size_t width = 0; };
+
+  template <> struct KernelSimd<float> {
+    typedef __m128 type;
+    static const size_t width = 4;
+    static inline type load( float const* p ) { return _mm_loadu_ps(p); }
+    static inline void store( float* p, type v ) { _mm_storeu_ps(p,v); }
+    static inline type set1( float v ) { return _mm_set1_ps(v); }
+  };
+
+#ifdef __SSE2__
+  template <> struct KernelSimd<double> {
+    typedef __m128d type;
+    static const size_t width = 2;
+    static inline type load( double const* p ) { return _mm_loadu_pd(p); }
+    static inline void store( double* p, type v ) { _mm_storeu_pd(p,v); }
+    static inline type set1( double v ) { return _mm_set1_pd(v); }
+  };
+#endif
+
+  // Returns how many leading elements were handled.
+  template <class OpT, class T>
+  inline size_t simd_kernel_vv( T const* a, T const* b, T* d, size_t n, boost::mpl::true_ ) {
+    typedef KernelSimd<T> S;
+    size_t i = 0;
+    for( ; i + S::width <= n; i += S::width )
+      S::store( d+i, OpT::apply( S::load(a+i), S::load(b+i) ) );
+    return i;
+  }
+  template <class OpT, class T>
+  inline size_t simd_kernel_vs( T const* a, T s, T* d, size_t n, boost::mpl::true_ ) {
+    typedef KernelSimd<T> S;
+    typename S::type sv = S::set1(s);
+    size_t i = 0;
+    for( ; i + S::width <= n; i += S::width )
+      S::store( d+i, OpT::apply( S::load(a+i), sv ) );
+    return i;
+  }
+  template <class OpT, class T>
+  inline size_t simd_kernel_sv( T s, T const* a, T* d, size_t n, boost::mpl::true_ ) {
+    typedef KernelSimd<T> S;
+    typename S::type sv = S::set1(s);
+    size_t i = 0;
+    for( ; i + S::width <= n; i += S::width )
+      S::store( d+i, OpT::apply( sv, S::load(a+i) ) );
+    return i;
+  }
+  template <class OpT, class T>
+  inline size_t simd_kernel_v( T const* a, T* d, size_t n, boost::mpl::true_ ) {
+    typedef KernelSimd<T> S;
+    size_t i = 0;
+    for( ; i + S::width <= n; i += S::width )
+      S::store( d+i, OpT::apply( S::load(a+i) ) );
+    return i;
+  }
+  template <class OpT, class T> inline size_t simd_kernel_vv( T const*, T const*, T*, size_t, boost::mpl::false_ ) { return 0; }
+  template <class OpT, class T> inline size_t simd_kernel_vs( T const*, T, T*, size_t, boost::mpl::false_ ) { return 0; }
+  template <class OpT, class T> inline size_t simd_kernel_sv( T, T const*, T*, size_t, boost::mpl::false_ ) { return 0; }
+  template <class OpT, class T> inline size_t simd_kernel_v( T const*, T*, size_t, boost::mpl::false_ ) { return 0; }
+
+#define VW_KERNEL_SIMD(T) boost::mpl::bool_<(KernelSimd<T>::width > 0)>()
+#endif
+
+  template <class OpT, class T>
+  inline void kernel_vv( T const* a, T const* b, T* d, size_t n ) {
+    size_t i = 0;
+#ifdef VW_KERNEL_SIMD
+    i = simd_kernel_vv<OpT>( a, b, d, n, VW_KERNEL_SIMD(T) );
+#endif
+    for( ; i < n; ++i ) d[i] = OpT::apply( a[i], b[i] );
+  }
+
+  template <class OpT, class T>
+  inline void kernel_vs( T const* a, T s, T* d, size_t n ) {
+    size_t i = 0;
+#ifdef VW_KERNEL_SIMD
+    i = simd_kernel_vs<OpT>( a, s, d, n, VW_KERNEL_SIMD(T) );
+#endif
+    for( ; i < n; ++i ) d[i] = OpT::apply( a[i], s );
+  }
+
+  template <class OpT, class T>
+  inline void kernel_sv( T s, T const* a, T* d, size_t n ) {
+    size_t i = 0;
+#ifdef VW_KERNEL_SIMD
+    i = simd_kernel_sv<OpT>( s, a, d, n, VW_KERNEL_SIMD(T) );
+#endif
+    for( ; i < n; ++i ) d[i] = OpT::apply( s, a[i] );
+  }
+
+  template <class OpT, class T>
+  inline void kernel_v( T const* a, T* d, size_t n ) {
+    size_t i = 0;
+#ifdef VW_KERNEL_SIMD
+    i = simd_kernel_v<OpT>( a, d, n, VW_KERNEL_SIMD(T) );
+#endif
+    for( ; i < n; ++i ) d[i] = OpT::apply( a[i] );
+  }
+
+#undef VW_KERNEL_SIMD
+
+  // ----------------------------------------------------------------
+  // Functor traits
+  // ----------------------------------------------------------------
+
+  // Pixel types whose channels can be processed as a flat array: bare
+  // channels and the per-channel pixel types of PixelTypes.h.  Masked
+  // pixels are left out, as their validity does not combine per
+  // channel.
+  template <class PixelT>
+  struct KernelPixel {
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    static const bool value =
+      ( boost::is_same<channel_type,float>::value || boost::is_same<channel_type,double>::value ) &&
+      ( boost::is_fundamental<PixelT>::value || boost::is_base_of<PixelMathBase<PixelT>,PixelT>::value ) &&
+      !IsMasked<PixelT>::value &&
+      sizeof(PixelT) == sizeof(channel_type) * CompoundNumChannels<PixelT>::value;
+  };
+
+  // What each functor does to the channels of PixelT.  op is void if
+  // the functor has no kernel.  For scalar functors, scalar_first
+  // says which side the value is on.
+  template <class FuncT, class PixelT> struct KernelFunctor { typedef void op; };
+
+  template <class PixelT> struct KernelFunctor<ArgArgSumFunctor,PixelT> { typedef KernelAdd op; };
+  template <class PixelT> struct KernelFunctor<ArgArgDifferenceFunctor,PixelT> { typedef KernelSub op; };
+  template <class PixelT> struct KernelFunctor<ArgArgProductFunctor,PixelT> { typedef KernelMul op; };
+  template <class PixelT> struct KernelFunctor<ArgArgSafeQuotientFunctor,PixelT> {
+    typedef typename boost::mpl::if_<boost::is_fundamental<PixelT>, KernelSafeDiv, void>::type op;
+  };
+
+  template <class ValT, class PixelT> struct KernelFunctor<ArgValSumFunctor<ValT>,PixelT>        { typedef KernelAdd op; static const bool scalar_first = false; };
+  template <class ValT, class PixelT> struct KernelFunctor<ValArgSumFunctor<ValT>,PixelT>        { typedef KernelAdd op; static const bool scalar_first = true; };
+  template <class ValT, class PixelT> struct KernelFunctor<ArgValDifferenceFunctor<ValT>,PixelT> { typedef KernelSub op; static const bool scalar_first = false; };
+  template <class ValT, class PixelT> struct KernelFunctor<ValArgDifferenceFunctor<ValT>,PixelT> { typedef KernelSub op; static const bool scalar_first = true; };
+  template <class ValT, class PixelT> struct KernelFunctor<ArgValProductFunctor<ValT>,PixelT>    { typedef KernelMul op; static const bool scalar_first = false; };
+  template <class ValT, class PixelT> struct KernelFunctor<ValArgProductFunctor<ValT>,PixelT>    { typedef KernelMul op; static const bool scalar_first = true; };
+  // A zero scalar zeroes the whole pixel, which per channel is the same thing.
+  template <class ValT, class PixelT> struct KernelFunctor<ArgValSafeQuotientFunctor<ValT>,PixelT> { typedef KernelSafeDiv op; static const bool scalar_first = false; };
+  template <class ValT, class PixelT> struct KernelFunctor<ValArgSafeQuotientFunctor<ValT>,PixelT> {
+    typedef typename boost::mpl::if_<boost::is_fundamental<PixelT>, KernelSafeDiv, void>::type op;
+    static const bool scalar_first = true;
+  };
+
+  template <class PixelT> struct KernelFunctor<math::ArgAbsFunctor,PixelT> {
+    typedef typename boost::mpl::if_<boost::is_fundamental<PixelT>, KernelAbs, void>::type op;
+  };
+
+  // The scalar a functor holds, if it holds one of the channel type.
+  template <class FuncT> struct KernelScalar { typedef void type; };
+  template <template <class> class FuncT, class ValT> struct KernelScalar<FuncT<ValT> > { typedef ValT type; };
+
+  // Rows of the source and destination, as channel arrays.
+  template <class PixelT>
+  inline typename CompoundChannelType<PixelT>::type const*
+  kernel_row( ImageView<PixelT> const& image, int32 col, int32 row, int32 plane ) {
+    return reinterpret_cast<typename CompoundChannelType<PixelT>::type const*>( &image(col,row,plane) );
+  }
+  template <class PixelT>
+  inline typename CompoundChannelType<PixelT>::type*
+  kernel_dest_row( ImageView<PixelT> const& image, int32 row, int32 plane ) {
+    return reinterpret_cast<typename CompoundChannelType<PixelT>::type*>( &image(0,row,plane) );
+  }
+
+  template <class PixelT>
+  inline void kernel_check_dims( ImageView<PixelT> const& src, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+    VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+               ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+  }
+
+  template <class KernelT, class PixelT>
+  inline void run_binary_kernel( ImageView<PixelT> const& a, ImageView<PixelT> const& b, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+    kernel_check_dims( a, dest, bbox );
+    size_t n = size_t(bbox.width()) * CompoundNumChannels<PixelT>::value;
+    for( int32 p = 0; p < a.planes(); ++p )
+      for( int32 r = 0; r < bbox.height(); ++r )
+        kernel_vv<KernelT>( kernel_row(a, bbox.min().x(), bbox.min().y()+r, p),
+                            kernel_row(b, bbox.min().x(), bbox.min().y()+r, p),
+                            kernel_dest_row(dest, r, p), n );
+  }
+
+  template <class KernelT, class PixelT, class ChannelT>
+  inline void run_scalar_kernel( ImageView<PixelT> const& a, ChannelT s, bool scalar_first, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+    kernel_check_dims( a, dest, bbox );
+    size_t n = size_t(bbox.width()) * CompoundNumChannels<PixelT>::value;
+    for( int32 p = 0; p < a.planes(); ++p )
+      for( int32 r = 0; r < bbox.height(); ++r ) {
+        ChannelT const* src = kernel_row(a, bbox.min().x(), bbox.min().y()+r, p);
+        if( scalar_first ) kernel_sv<KernelT>( s, src, kernel_dest_row(dest, r, p), n );
+        else               kernel_vs<KernelT>( src, s, kernel_dest_row(dest, r, p), n );
+      }
+  }
+
+  template <class KernelT, class PixelT>
+  inline void run_unary_kernel( ImageView<PixelT> const& a, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+    kernel_check_dims( a, dest, bbox );
+    size_t n = size_t(bbox.width()) * CompoundNumChannels<PixelT>::value;
+    for( int32 p = 0; p < a.planes(); ++p )
+      for( int32 r = 0; r < bbox.height(); ++r )
+        kernel_v<KernelT>( kernel_row(a, bbox.min().x(), bbox.min().y()+r, p), kernel_dest_row(dest, r, p), n );
+  }
+
+  // Dispatch helpers.  The bool says whether a kernel applies, so that
+  // the kernels are only instantiated for types they support.
+  template <class FuncT, class PixelT>
+  inline bool binary_kernel( ImageView<PixelT> const&, ImageView<PixelT> const&, FuncT const&, ImageView<PixelT> const&, BBox2i const&, boost::mpl::false_ ) { return false; }
+  template <class FuncT, class PixelT>
+  inline bool binary_kernel( ImageView<PixelT> const& a, ImageView<PixelT> const& b, FuncT const&, ImageView<PixelT> const& dest, BBox2i const& bbox, boost::mpl::true_ ) {
+    run_binary_kernel<typename KernelFunctor<FuncT,PixelT>::op>( a, b, dest, bbox );
+    return true;
+  }
+
+  template <class FuncT, class PixelT>
+  inline bool scalar_kernel( ImageView<PixelT> const&, FuncT const&, ImageView<PixelT> const&, BBox2i const&, boost::mpl::false_ ) { return false; }
+  template <class FuncT, class PixelT>
+  inline bool scalar_kernel( ImageView<PixelT> const& a, FuncT const& func, ImageView<PixelT> const& dest, BBox2i const& bbox, boost::mpl::true_ ) {
+    run_scalar_kernel<typename KernelFunctor<FuncT,PixelT>::op>( a, func.value(), KernelFunctor<FuncT,PixelT>::scalar_first, dest, bbox );
+    return true;
+  }
+
+  template <class FuncT, class PixelT>
+  inline bool unary_kernel( ImageView<PixelT> const&, FuncT const&, ImageView<PixelT> const&, BBox2i const&, boost::mpl::false_ ) { return false; }
+  template <class FuncT, class PixelT>
+  inline bool unary_kernel( ImageView<PixelT> const& a, FuncT const&, ImageView<PixelT> const& dest, BBox2i const& bbox, boost::mpl::true_ ) {
+    run_unary_kernel<typename KernelFunctor<FuncT,PixelT>::op>( a, dest, bbox );
+    return true;
+  }
+
+  // Whether FuncT maps ImageView<PixelT> back to PixelT with a kernel.
+  template <class FuncT, class PixelT, class ResultT>
+  struct HasKernel {
+    static const bool value = KernelPixel<PixelT>::value &&
+      !boost::is_same<typename KernelFunctor<FuncT,PixelT>::op, void>::value &&
+      boost::is_same<typename boost::remove_cv<typename boost::remove_reference<ResultT>::type>::type, PixelT>::value;
+  };
+
+} // namespace detail
+
+  /// \cond INTERNAL
+  template <class PixelT, class FuncT>
+  struct BinaryPerPixelKernel<ImageView<PixelT>, ImageView<PixelT>, FuncT, ImageView<PixelT> > {
+    typedef typename boost::result_of<FuncT(PixelT,PixelT)>::type result_type;
+    static inline bool apply( ImageView<PixelT> const& a, ImageView<PixelT> const& b, FuncT const& func,
+                              ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+      return detail::binary_kernel( a, b, func, dest, bbox,
+                                    boost::mpl::bool_<detail::HasKernel<FuncT,PixelT,result_type>::value>() );
+    }
+  };
+
+  template <class PixelT, class FuncT>
+  struct UnaryPerPixelKernel<ImageView<PixelT>, FuncT, ImageView<PixelT> > {
+    typedef typename boost::result_of<FuncT(PixelT)>::type result_type;
+    typedef typename detail::KernelScalar<FuncT>::type scalar_type;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+
+    static const bool has_kernel = detail::HasKernel<FuncT,PixelT,result_type>::value;
+    static const bool is_scalar = !boost::is_same<scalar_type,void>::value;
+
+    static inline bool apply( ImageView<PixelT> const& a, FuncT const& func,
+                              ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+      if( is_scalar )
+        return detail::scalar_kernel( a, func, dest, bbox,
+                                      boost::mpl::bool_<has_kernel && boost::is_same<scalar_type,channel_type>::value>() );
+      return detail::unary_kernel( a, func, dest, bbox, boost::mpl::bool_<has_kernel && !is_scalar>() );
+    }
+  };
+  /// \endcond
+
+} // namespace vw
+
+#endif // __VW_IMAGE_IMAGEMATHKERNELS_H__
@@ -0,0 +1,431 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ImagePyramid.h
+///
+/// Gaussian and Laplacian image pyramids.
+///
+/// The PyramidDownsampleView and PyramidUpsampleView classes are the
+/// REDUCE and EXPAND operations of Burt and Adelson, "The Laplacian
+/// Pyramid as a Compact Image Code" (1983), using the 5-tap binomial
+/// kernel [1 4 6 4 1]/16.  The ImagePyramidView class strings them
+/// together into a pyramid whose levels are computed lazily and kept
+/// block by block in the cache, so several consumers holding copies
+/// of the same pyramid share the work.
+///
+#ifndef __VW_IMAGE_IMAGEPYRAMID_H__
+#define __VW_IMAGE_IMAGEPYRAMID_H__
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/mpl/if.hpp>
+
+#include <vw/config.h>
+#include <vw/Core/Cache.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/BlockRasterize.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+#include <xmmintrin.h>
+#endif
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Pyramid arithmetic is done in single precision, except for
+    // double-precision images.
+    template <class PixelT>
+    struct PyramidAccumT {
+      typedef typename boost::mpl::if_< boost::is_same<typename PixelChannelType<PixelT>::type, double>, double, float >::type channel_type;
+      typedef typename CompoundChannelCast<PixelT, channel_type>::type type;
+    };
+
+    // dest[i] = (r0[i] + 4 r1[i] + 6 r2[i] + 4 r3[i] + r4[i]) * scale
+    template <class T>
+    inline void pyramid_taps5( T const* r0, T const* r1, T const* r2, T const* r3, T const* r4, T* dest, size_t n, T scale ) {
+      for( size_t i=0; i<n; ++i )
+        dest[i] = ( r0[i] + r4[i] + 4*(r1[i] + r3[i]) + 6*r2[i] ) * scale;
+    }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+    inline void pyramid_taps5( float const* r0, float const* r1, float const* r2, float const* r3, float const* r4, float* dest, size_t n, float scale ) {
+      const __m128 four = _mm_set1_ps(4.0f), six = _mm_set1_ps(6.0f), s = _mm_set1_ps(scale);
+      size_t i = 0;
+      for( ; i+4<=n; i+=4 ) {
+        __m128 outer = _mm_add_ps( _mm_loadu_ps(r0+i), _mm_loadu_ps(r4+i) );
+        __m128 inner = _mm_mul_ps( four, _mm_add_ps( _mm_loadu_ps(r1+i), _mm_loadu_ps(r3+i) ) );
+        __m128 center = _mm_mul_ps( six, _mm_loadu_ps(r2+i) );
+        _mm_storeu_ps( dest+i, _mm_mul_ps( _mm_add_ps( _mm_add_ps( outer, inner ), center ), s ) );
+      }
+      for( ; i<n; ++i )
+        dest[i] = ( r0[i] + r4[i] + 4*(r1[i] + r3[i]) + 6*r2[i] ) * scale;
+    }
+#endif
+
+    // Copies the pixels of an accumulator image into a destination
+    // view, rounding and clamping if the destination is integer.
+    template <class AccumT, class DestT>
+    void pyramid_write( ImageView<AccumT> const& src, DestT const& dest ) {
+      typedef typename DestT::pixel_accessor DestAccessT;
+      typedef typename CompoundChannelType<typename DestT::pixel_type>::type channel_type;
+      DestAccessT dplane = dest.origin();
+      for( int32 p=0; p<dest.planes(); ++p ) {
+        DestAccessT drow = dplane;
+        for( int32 y=0; y<dest.rows(); ++y ) {
+          DestAccessT dcol = drow;
+          for( int32 x=0; x<dest.cols(); ++x ) {
+            *dcol = channel_cast_round_and_clamp_if_int<channel_type>( src(x,y,p) );
+            dcol.next_col();
+          }
+          drow.next_row();
+        }
+        dplane.next_plane();
+      }
+    }
+
+  } // namespace detail
+  /// \endcond
+
+
+  // *******************************************************************
+  // The pyramid downsample view type
+  // *******************************************************************
+
+  /// One REDUCE step of a Gaussian pyramid.
+  ///
+  /// Smooths its child with the 5-tap binomial kernel along each axis
+  /// and keeps every other pixel, giving an image of (cols+1)/2 by
+  /// (rows+1)/2 whose pixel (x,y) is centered on child pixel
+  /// (2x,2y).  The horizontal pass decimates as it goes; the vertical
+  /// pass runs along whole rows of channel values, four at a time
+  /// with SSE when it is enabled.  Accessing individual pixels is
+  /// slow; rasterize instead.
+  template <class ImageT, class EdgeT>
+  class PyramidDownsampleView : public ImageViewBase<PyramidDownsampleView<ImageT,EdgeT> >
+  {
+  private:
+    ImageT m_image;
+    EdgeT m_edge;
+
+    typedef typename detail::PyramidAccumT<typename ImageT::pixel_type>::type accum_type;
+    typedef typename detail::PyramidAccumT<typename ImageT::pixel_type>::channel_type accum_channel_type;
+
+  public:
+    /// The pixel type of the view.
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+
+    /// The view's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<PyramidDownsampleView<ImageT, EdgeT> > pixel_accessor;
+
+    PyramidDownsampleView( ImageT const& image, EdgeT const& edge = EdgeT() ) : m_image(image), m_edge(edge) {}
+
+    /// Returns the number of columns in the image.
+    inline int32 cols() const { return (m_image.cols()+1)/2; }
+
+    /// Returns the number of rows in the image.
+    inline int32 rows() const { return (m_image.rows()+1)/2; }
+
+    /// Returns the number of planes in the image.
+    inline int32 planes() const { return m_image.planes(); }
+
+    /// Returns a pixel_accessor pointing to the top-left corner of the first plane.
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Returns the pixel at the given position in the given plane.
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<pixel_type> result( 1, 1, planes() );
+      rasterize( result, BBox2i(x,y,1,1) );
+      return result(0,0,p);
+    }
+
+    ImageT const& child() const { return m_image; }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), m_image.planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >(dest,BBox2i(-bbox.min().x(),-bbox.min().y(),
+                                                          cols(), rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i bbox ) const {
+      typedef typename CompoundChannelType<pixel_type>::type channel_type;
+      const int32 nc = CompoundNumChannels<pixel_type>::value;
+      BBox2i child_bbox( 2*bbox.min().x()-2, 2*bbox.min().y()-2, 2*bbox.width()+3, 2*bbox.height()+3 );
+      ImageView<pixel_type> src = edge_extend(m_image,child_bbox,m_edge);
+      VW_ASSERT( src.planes() == dest.planes(), ArgumentErr() << "PyramidDownsampleView: Images should have the same number of planes" );
+
+      // Both images are packed, so each row is a flat run of
+      // channel values.
+      const int32 width = bbox.width() * nc;
+      ImageView<accum_type> horiz( bbox.width(), src.rows() );
+      ImageView<accum_type> result( bbox.width(), bbox.height(), src.planes() );
+      for( int32 p=0; p<src.planes(); ++p ) {
+        for( int32 y=0; y<src.rows(); ++y ) {
+          channel_type const* s = (channel_type const*)&src(0,y,p);
+          accum_channel_type* h = (accum_channel_type*)&horiz(0,y);
+          for( int32 x=0; x<bbox.width(); ++x, s+=2*nc )
+            for( int32 c=0; c<nc; ++c )
+              *h++ = accum_channel_type(s[c]) + accum_channel_type(s[c+4*nc])
+                + 4*( accum_channel_type(s[c+nc]) + accum_channel_type(s[c+3*nc]) )
+                + 6*accum_channel_type(s[c+2*nc]);
+        }
+        for( int32 y=0; y<bbox.height(); ++y ) {
+          accum_channel_type const* h = (accum_channel_type const*)&horiz(0,2*y);
+          detail::pyramid_taps5( h, h+width, h+2*width, h+3*width, h+4*width,
+                                 (accum_channel_type*)&result(0,y,p), width, accum_channel_type(1.0/256) );
+        }
+      }
+      detail::pyramid_write( result, dest );
+    }
+    /// \endcond
+  };
+
+
+  // *******************************************************************
+  // The pyramid upsample view type
+  // *******************************************************************
+
+  /// One EXPAND step of a Laplacian pyramid.
+  ///
+  /// Interpolates its child up to the given size, which should be
+  /// twice the child's size or one less, as the transpose of a
+  /// PyramidDownsampleView: child pixel (x,y) lands on (2x,2y) and
+  /// the pixels between are filled in with the same binomial kernel.
+  /// The result uses the pyramid's accumulator pixel type, which is
+  /// floating point, since it usually goes into a Laplacian
+  /// difference.
+  template <class ImageT, class EdgeT>
+  class PyramidUpsampleView : public ImageViewBase<PyramidUpsampleView<ImageT,EdgeT> >
+  {
+  private:
+    ImageT m_image;
+    int32 m_cols, m_rows;
+    EdgeT m_edge;
+
+    typedef typename detail::PyramidAccumT<typename ImageT::pixel_type>::channel_type accum_channel_type;
+
+  public:
+    /// The pixel type of the view.
+    typedef typename detail::PyramidAccumT<typename ImageT::pixel_type>::type pixel_type;
+    typedef pixel_type result_type;
+
+    /// The view's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<PyramidUpsampleView<ImageT, EdgeT> > pixel_accessor;
+
+    PyramidUpsampleView( ImageT const& image, int32 cols, int32 rows, EdgeT const& edge = EdgeT() )
+      : m_image(image), m_cols(cols), m_rows(rows), m_edge(edge) {}
+
+    /// Returns the number of columns in the image.
+    inline int32 cols() const { return m_cols; }
+
+    /// Returns the number of rows in the image.
+    inline int32 rows() const { return m_rows; }
+
+    /// Returns the number of planes in the image.
+    inline int32 planes() const { return m_image.planes(); }
+
+    /// Returns a pixel_accessor pointing to the top-left corner of the first plane.
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Returns the pixel at the given position in the given plane.
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<pixel_type> result( 1, 1, planes() );
+      rasterize( result, BBox2i(x,y,1,1) );
+      return result(0,0,p);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >(dest,BBox2i(-bbox.min().x(),-bbox.min().y(),
+                                                          cols(), rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i bbox ) const {
+      typedef typename ImageT::pixel_type src_pixel_type;
+      typedef typename CompoundChannelType<src_pixel_type>::type channel_type;
+      const int32 nc = CompoundNumChannels<src_pixel_type>::value;
+      // Coarse pixels floor(x/2)-1 through floor(x/2)+1 can touch x.
+      Vector2i cmin( (bbox.min().x() >> 1) - 1, (bbox.min().y() >> 1) - 1 );
+      Vector2i cmax( ((bbox.max().x()-1) >> 1) + 2, ((bbox.max().y()-1) >> 1) + 2 );
+      ImageView<src_pixel_type> src = edge_extend(m_image,BBox2i(cmin,cmax),m_edge);
+      VW_ASSERT( src.planes() == dest.planes(), ArgumentErr() << "PyramidUpsampleView: Images should have the same number of planes" );
+
+      // Even outputs take weights (1,6,1)/8 about the coarse pixel
+      // under them, odd ones (4,4)/8 from their two neighbors.
+      ImageView<pixel_type> horiz( bbox.width(), src.rows() );
+      ImageView<pixel_type> result( bbox.width(), bbox.height(), src.planes() );
+      for( int32 p=0; p<src.planes(); ++p ) {
+        for( int32 y=0; y<src.rows(); ++y ) {
+          channel_type const* s = (channel_type const*)&src(0,y,p);
+          accum_channel_type* h = (accum_channel_type*)&horiz(0,y);
+          for( int32 x=bbox.min().x(); x<bbox.max().x(); ++x ) {
+            channel_type const* k = s + ((x >> 1) - cmin.x())*nc;
+            for( int32 c=0; c<nc; ++c )
+              *h++ = ( x & 1 )
+                ? ( accum_channel_type(k[c]) + accum_channel_type(k[c+nc]) ) / 2
+                : ( accum_channel_type(k[c-nc]) + 6*accum_channel_type(k[c]) + accum_channel_type(k[c+nc]) ) / 8;
+          }
+        }
+        const int32 width = bbox.width() * nc;
+        for( int32 y=bbox.min().y(); y<bbox.max().y(); ++y ) {
+          accum_channel_type const* k = (accum_channel_type const*)&horiz(0,(y >> 1) - cmin.y());
+          accum_channel_type* r = (accum_channel_type*)&result(0,y-bbox.min().y(),p);
+          if( y & 1 )
+            for( int32 i=0; i<width; ++i ) r[i] = ( k[i] + k[i+width] ) / 2;
+          else
+            for( int32 i=0; i<width; ++i ) r[i] = ( k[i-width] + 6*k[i] + k[i+width] ) / 8;
+        }
+      }
+      detail::pyramid_write( result, dest );
+    }
+    /// \endcond
+  };
+
+
+  /// Halves an image with the Gaussian pyramid REDUCE step, using the
+  /// given edge extension mode.
+  template <class ImageT, class EdgeT>
+  PyramidDownsampleView<ImageT, EdgeT>
+  inline pyramid_downsample( ImageViewBase<ImageT> const& image, EdgeT const& edge ) {
+    return PyramidDownsampleView<ImageT, EdgeT>( image.impl(), edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::pyramid_downsample. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class ImageT>
+  PyramidDownsampleView<ImageT, ConstantEdgeExtension>
+  inline pyramid_downsample( ImageViewBase<ImageT> const& image ) {
+    return PyramidDownsampleView<ImageT, ConstantEdgeExtension>( image.impl() );
+  }
+
+  /// Doubles an image to the given size with the Laplacian pyramid
+  /// EXPAND step, using the given edge extension mode.
+  template <class ImageT, class EdgeT>
+  PyramidUpsampleView<ImageT, EdgeT>
+  inline pyramid_upsample( ImageViewBase<ImageT> const& image, int32 cols, int32 rows, EdgeT const& edge ) {
+    return PyramidUpsampleView<ImageT, EdgeT>( image.impl(), cols, rows, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::pyramid_upsample. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class ImageT>
+  PyramidUpsampleView<ImageT, ConstantEdgeExtension>
+  inline pyramid_upsample( ImageViewBase<ImageT> const& image, int32 cols, int32 rows ) {
+    return PyramidUpsampleView<ImageT, ConstantEdgeExtension>( image.impl(), cols, rows );
+  }
+
+
+  // *******************************************************************
+  // The image pyramid
+  // *******************************************************************
+
+  /// A Gaussian image pyramid with lazily computed, shared levels.
+  ///
+  /// Level 0 is the source image and each level above it is the
+  /// pyramid_downsample() of the one below.  A level is computed a
+  /// block at a time as it is read and the blocks are kept in the
+  /// given cache, so reading a level also caches the blocks of the
+  /// levels below it that it needed.  Copies of an ImagePyramidView
+  /// share their levels, so callers that want the same pyramid of
+  /// the same image should pass one around rather than each build
+  /// their own.  Without a cache, levels are recomputed from the
+  /// source on every read.
+  ///
+  /// The Laplacian levels laplacian(i) are the difference between
+  /// level i and the pyramid_upsample() of level i+1, in floating
+  /// point; the top Laplacian level is the top Gaussian level.
+  template <class PixelT>
+  class ImagePyramidView {
+  public:
+    typedef PixelT pixel_type;
+    typedef ImageViewRef<PixelT> level_type;
+    typedef typename detail::PyramidAccumT<PixelT>::type laplacian_pixel_type;
+    typedef ImageViewRef<laplacian_pixel_type> laplacian_type;
+
+    /// Builds a pyramid of the given number of levels, including the
+    /// source.  A num_levels of zero halves the image until its
+    /// shorter side is one pixel.
+    template <class ImageT, class EdgeT>
+    ImagePyramidView( ImageViewBase<ImageT> const& image, int32 num_levels, EdgeT const& edge,
+                      Vector2i const& block_size = Vector2i(256,256), Cache* cache = &vw_system_cache() )
+      : m_levels( new std::vector<level_type>() ), m_laplacians( new std::vector<laplacian_type>() ) {
+      initialize( image.impl(), num_levels, edge, block_size, cache );
+    }
+
+    /// This is an overloaded constructor provided for convenience.
+    /// It uses the default vw::ConstantEdgeExtension mode.
+    template <class ImageT>
+    ImagePyramidView( ImageViewBase<ImageT> const& image, int32 num_levels = 0,
+                      Vector2i const& block_size = Vector2i(256,256), Cache* cache = &vw_system_cache() )
+      : m_levels( new std::vector<level_type>() ), m_laplacians( new std::vector<laplacian_type>() ) {
+      initialize( image.impl(), num_levels, ConstantEdgeExtension(), block_size, cache );
+    }
+
+    /// Returns the number of levels, including the source.
+    int32 num_levels() const { return int32(m_levels->size()); }
+
+    /// Returns the given Gaussian level.  Level 0 is the source.
+    level_type const& level( int32 i ) const {
+      VW_ASSERT( i >= 0 && i < num_levels(), ArgumentErr() << "ImagePyramidView: no level " << i );
+      return (*m_levels)[i];
+    }
+    level_type const& operator[]( int32 i ) const { return level(i); }
+
+    /// Returns the given Laplacian level.
+    laplacian_type const& laplacian( int32 i ) const {
+      VW_ASSERT( i >= 0 && i < num_levels(), ArgumentErr() << "ImagePyramidView: no level " << i );
+      return (*m_laplacians)[i];
+    }
+
+  private:
+    template <class ImageT, class EdgeT>
+    void initialize( ImageT const& image, int32 num_levels, EdgeT const& edge, Vector2i const& block_size, Cache* cache ) {
+      m_levels->push_back( image );
+      while( num_levels == 0 ? std::min( m_levels->back().cols(), m_levels->back().rows() ) > 1
+                             : int32(m_levels->size()) < num_levels ) {
+        // Each level rasterizes its blocks on the calling thread;
+        // callers can parallelize by block-rasterizing the level.
+        PyramidDownsampleView<level_type, EdgeT> reduced( m_levels->back(), edge );
+        if( cache ) m_levels->push_back( block_cache( reduced, block_size, 1, *cache ) );
+        else m_levels->push_back( reduced );
+      }
+
+      typedef typename detail::PyramidAccumT<PixelT>::channel_type accum_channel_type;
+      for( size_t i=0; i+1<m_levels->size(); ++i ) {
+        level_type const& fine = (*m_levels)[i];
+        m_laplacians->push_back( channel_cast<accum_channel_type>( fine )
+                                 - pyramid_upsample( (*m_levels)[i+1], fine.cols(), fine.rows(), edge ) );
+      }
+      m_laplacians->push_back( channel_cast<accum_channel_type>( m_levels->back() ) );
+    }
+
+    boost::shared_ptr<std::vector<level_type> > m_levels;
+    boost::shared_ptr<std::vector<laplacian_type> > m_laplacians;
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_IMAGEPYRAMID_H__
@@ -16,330 +16,363 @@
 #include <vector>
 #endif
 
-#include <map>
+#include <vw/config.h>
+
+#include <cstring>
 
 #include <boost/integer_traits.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
 
 #include <vw/Core/Debugging.h>
+#include <vw/Core/System.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageResource.h>
 
 #include <cmath>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace vw;
 
-typedef void (*channel_convert_func)(void* src, void* dest);
+namespace {
+
+  // Channel Convert:
+  //   Converts a single channel value.  Plain conversion is a cast.
+  //   When rescaling, integer channels map their range onto [0,1] in
+  //   floating point, floating point channels are clamped to [0,1]
+  //   and scaled to the integer range, and uint8 <-> uint16 scale by
+  //   257.  Every other combination is a plain cast either way.
+  template <class SrcT, class DstT, bool RescaleV,
+            bool IntToFloatV = boost::is_integral<SrcT>::value && boost::is_floating_point<DstT>::value,
+            bool FloatToIntV = boost::is_floating_point<SrcT>::value && boost::is_integral<DstT>::value>
+  struct ChannelConvert {
+    static inline DstT apply( SrcT src ) { return DstT(src); }
+  };
 
-template <class SrcT, class DestT>
-void channel_convert_cast( SrcT* src, DestT* dest ) {
-  *dest = DestT(*src);
-}
+  template <class SrcT, class DstT>
+  struct ChannelConvert<SrcT,DstT,true,true,false> {
+    static inline DstT apply( SrcT src ) {
+      return DstT(src) * (DstT(1.0)/boost::integer_traits<SrcT>::const_max);
+    }
+  };
 
-void channel_convert_uint16_to_uint8( uint16* src, uint8* dest ) {
-  *dest = uint8( *src / (65535/255) );
-}
+  template <class SrcT, class DstT>
+  struct ChannelConvert<SrcT,DstT,true,false,true> {
+    static inline DstT apply( SrcT src ) {
+      if( src > SrcT(1.0) ) return boost::integer_traits<DstT>::const_max;
+      else if( src < SrcT(0.0) ) return DstT(0);
+      else return DstT( src * boost::integer_traits<DstT>::const_max );
+    }
+  };
+
+  template <>
+  struct ChannelConvert<uint16,uint8,true,false,false> {
+    static inline uint8 apply( uint16 src ) { return uint8( src / (65535/255) ); }
+  };
+
+  template <>
+  struct ChannelConvert<uint8,uint16,true,false,false> {
+    static inline uint16 apply( uint8 src ) { return uint16( src ) * (65535/255); }
+  };
+
+  // Span Convert:
+  //   Converts a contiguous run of channel values.  This is the hot
+  //   path for conversions that only change the channel type, and the
+  //   plain loop is simple enough for the compiler to vectorize.  The
+  //   most common rescaling conversions get hand-written SSE2 versions
+  //   below, which produce exactly the same values as ChannelConvert.
+  template <class SrcT, class DstT, bool RescaleV>
+  struct SpanConvert {
+    static void apply( SrcT const* src, DstT* dst, size_t n ) {
+      for( size_t i=0; i<n; ++i )
+        dst[i] = ChannelConvert<SrcT,DstT,RescaleV>::apply( src[i] );
+    }
+  };
 
-void channel_convert_uint8_to_uint16( uint8* src, uint16* dest ) {
-  *dest = uint16( *src ) * (65535/255);
-}
+  template <class T, bool RescaleV>
+  struct SpanConvert<T,T,RescaleV> {
+    static void apply( T const* src, T* dst, size_t n ) {
+      std::memcpy( dst, src, n*sizeof(T) );
+    }
+  };
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+  template <>
+  struct SpanConvert<uint8,float,true> {
+    static void apply( uint8 const* src, float* dst, size_t n ) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128 scale = _mm_set1_ps( 1.0f/255 );
+      size_t i = 0;
+      for( ; i+16<=n; i+=16 ) {
+        __m128i v = _mm_loadu_si128( (__m128i const*)(src+i) );
+        __m128i lo = _mm_unpacklo_epi8( v, zero ), hi = _mm_unpackhi_epi8( v, zero );
+        _mm_storeu_ps( dst+i,    _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) ), scale ) );
+        _mm_storeu_ps( dst+i+4,  _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) ), scale ) );
+        _mm_storeu_ps( dst+i+8,  _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) ), scale ) );
+        _mm_storeu_ps( dst+i+12, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) ), scale ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<uint8,float,true>::apply( src[i] );
+    }
+  };
+
+  template <>
+  struct SpanConvert<uint16,float,true> {
+    static void apply( uint16 const* src, float* dst, size_t n ) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128 scale = _mm_set1_ps( 1.0f/65535 );
+      size_t i = 0;
+      for( ; i+8<=n; i+=8 ) {
+        __m128i v = _mm_loadu_si128( (__m128i const*)(src+i) );
+        _mm_storeu_ps( dst+i,   _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, zero ) ), scale ) );
+        _mm_storeu_ps( dst+i+4, _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( v, zero ) ), scale ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<uint16,float,true>::apply( src[i] );
+    }
+  };
 
-template <class SrcT, class DestT>
-void channel_convert_int_to_float( SrcT* src, DestT* dest ) {
-  *dest = DestT(*src) * (DestT(1.0)/boost::integer_traits<SrcT>::const_max);
-}
+  // Clamps four floats to [0,1], scales them and truncates to int32.
+  // Clamping with max/min also sends NaN to zero.
+  inline __m128i clamp_scale_truncate( float const* src, __m128 scale ) {
+    __m128 v = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src ), _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+    return _mm_cvttps_epi32( _mm_mul_ps( v, scale ) );
+  }
 
-template <class SrcT, class DestT>
-void channel_convert_float_to_int( SrcT* src, DestT* dest ) {
-  if( *src > SrcT(1.0) ) *dest = boost::integer_traits<DestT>::const_max;
-  else if( *src < SrcT(0.0) ) *dest = DestT(0);
-  else *dest = DestT( *src * boost::integer_traits<DestT>::const_max );
-}
+  template <>
+  struct SpanConvert<float,uint8,true> {
+    static void apply( float const* src, uint8* dst, size_t n ) {
+      const __m128 scale = _mm_set1_ps( 255.0f );
+      size_t i = 0;
+      for( ; i+16<=n; i+=16 ) {
+        __m128i a = _mm_packs_epi32( clamp_scale_truncate( src+i,   scale ), clamp_scale_truncate( src+i+4,  scale ) );
+        __m128i b = _mm_packs_epi32( clamp_scale_truncate( src+i+8, scale ), clamp_scale_truncate( src+i+12, scale ) );
+        _mm_storeu_si128( (__m128i*)(dst+i), _mm_packus_epi16( a, b ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<float,uint8,true>::apply( src[i] );
+    }
+  };
+
+  template <>
+  struct SpanConvert<float,uint16,true> {
+    static void apply( float const* src, uint16* dst, size_t n ) {
+      // SSE2 has no unsigned 32->16 bit pack, so we pack with a bias.
+      const __m128 scale = _mm_set1_ps( 65535.0f );
+      const __m128i bias32 = _mm_set1_epi32( 32768 );
+      const __m128i bias16 = _mm_set1_epi16( (short)0x8000 );
+      size_t i = 0;
+      for( ; i+8<=n; i+=8 ) {
+        __m128i a = _mm_sub_epi32( clamp_scale_truncate( src+i,   scale ), bias32 );
+        __m128i b = _mm_sub_epi32( clamp_scale_truncate( src+i+4, scale ), bias32 );
+        _mm_storeu_si128( (__m128i*)(dst+i), _mm_xor_si128( _mm_packs_epi32( a, b ), bias16 ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<float,uint16,true>::apply( src[i] );
+    }
+  };
+
+  template <>
+  struct SpanConvert<uint16,uint8,true> {
+    static void apply( uint16 const* src, uint8* dst, size_t n ) {
+      // x/257 == (x*0xFF01) >> 24 for every 16-bit x.
+      const __m128i magic = _mm_set1_epi16( (short)0xFF01 );
+      size_t i = 0;
+      for( ; i+16<=n; i+=16 ) {
+        __m128i a = _mm_srli_epi16( _mm_mulhi_epu16( _mm_loadu_si128( (__m128i const*)(src+i) ),   magic ), 8 );
+        __m128i b = _mm_srli_epi16( _mm_mulhi_epu16( _mm_loadu_si128( (__m128i const*)(src+i+8) ), magic ), 8 );
+        _mm_storeu_si128( (__m128i*)(dst+i), _mm_packus_epi16( a, b ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<uint16,uint8,true>::apply( src[i] );
+    }
+  };
+
+  template <>
+  struct SpanConvert<uint8,uint16,true> {
+    static void apply( uint8 const* src, uint16* dst, size_t n ) {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i scale = _mm_set1_epi16( 65535/255 );
+      size_t i = 0;
+      for( ; i+16<=n; i+=16 ) {
+        __m128i v = _mm_loadu_si128( (__m128i const*)(src+i) );
+        _mm_storeu_si128( (__m128i*)(dst+i),   _mm_mullo_epi16( _mm_unpacklo_epi8( v, zero ), scale ) );
+        _mm_storeu_si128( (__m128i*)(dst+i+8), _mm_mullo_epi16( _mm_unpackhi_epi8( v, zero ), scale ) );
+      }
+      for( ; i<n; ++i ) dst[i] = ChannelConvert<uint8,uint16,true>::apply( src[i] );
+    }
+  };
+#endif
 
-std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_func> *channel_convert_map = 0, *channel_convert_rescale_map = 0;
+  // Channel Max:
+  //   The value of a fully opaque alpha channel.
+  template <class T>
+  inline T channel_max( boost::true_type /*is_float*/ ) { return T(1.0); }
 
-class ChannelConvertMapEntry {
-  void initialize() {
-    if( !channel_convert_map )
-      channel_convert_map = new std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_func>();
-    if( !channel_convert_rescale_map )
-      channel_convert_rescale_map = new std::map<std::pair<ChannelTypeEnum,ChannelTypeEnum>,channel_convert_func>();
-  }
-public:
-  template <class SrcT, class DstT>
-  ChannelConvertMapEntry( void (*func)(SrcT*,DstT*) ) {
-    initialize();
-    ChannelTypeEnum src = ChannelTypeID<SrcT>::value;
-    ChannelTypeEnum dst = ChannelTypeID<DstT>::value;
-    channel_convert_map->operator[]( std::make_pair(src,dst) ) = (channel_convert_func)func;
-    channel_convert_rescale_map->operator[]( std::make_pair(src,dst) ) = (channel_convert_func)func;
-  }
-  template <class SrcT, class DstT>
-  ChannelConvertMapEntry( void (*func)(SrcT*,DstT*), void (*rescale_func)(SrcT*,DstT*) ) {
-    initialize();
-    ChannelTypeEnum src = ChannelTypeID<SrcT>::value;
-    ChannelTypeEnum dst = ChannelTypeID<DstT>::value;
-    channel_convert_map->operator[]( std::make_pair(src,dst) ) = (channel_convert_func)func;
-    channel_convert_rescale_map->operator[]( std::make_pair(src,dst) ) = (channel_convert_func)rescale_func;
-  }
-};
-
-ChannelConvertMapEntry _conv_i8i8  ( &channel_convert_cast<int8,int8>   );
-ChannelConvertMapEntry _conv_i8u8  ( &channel_convert_cast<int8,uint8>  );
-ChannelConvertMapEntry _conv_i8i16 ( &channel_convert_cast<int8,int16>  );
-ChannelConvertMapEntry _conv_i8u16 ( &channel_convert_cast<int8,uint16> );
-ChannelConvertMapEntry _conv_i8i32 ( &channel_convert_cast<int8,int32>  );
-ChannelConvertMapEntry _conv_i8u32 ( &channel_convert_cast<int8,uint32> );
-ChannelConvertMapEntry _conv_i8i64 ( &channel_convert_cast<int8,int64>  );
-ChannelConvertMapEntry _conv_i8u64 ( &channel_convert_cast<int8,uint64> );
-ChannelConvertMapEntry _conv_i8f32 ( &channel_convert_cast<int8,float>, &channel_convert_int_to_float<int8,float>  );
-ChannelConvertMapEntry _conv_i8f64 ( &channel_convert_cast<int8,double>, &channel_convert_int_to_float<int8,double> );
-ChannelConvertMapEntry _conv_u8i8  ( &channel_convert_cast<uint8,int8>   );
-ChannelConvertMapEntry _conv_u8u8  ( &channel_convert_cast<uint8,uint8>  );
-ChannelConvertMapEntry _conv_u8i16 ( &channel_convert_cast<uint8,int16>  );
-ChannelConvertMapEntry _conv_u8u16 ( &channel_convert_cast<uint8,uint16>, &channel_convert_uint8_to_uint16 );
-ChannelConvertMapEntry _conv_u8i32 ( &channel_convert_cast<uint8,int32>  );
-ChannelConvertMapEntry _conv_u8u32 ( &channel_convert_cast<uint8,uint32> );
-ChannelConvertMapEntry _conv_u8i64 ( &channel_convert_cast<uint8,int64>  );
-ChannelConvertMapEntry _conv_u8u64 ( &channel_convert_cast<uint8,uint64> );
-ChannelConvertMapEntry _conv_u8f32 ( &channel_convert_cast<uint8,float>, &channel_convert_int_to_float<uint8,float>  );
-ChannelConvertMapEntry _conv_u8f64 ( &channel_convert_cast<uint8,double>, &channel_convert_int_to_float<uint8,double> );
-ChannelConvertMapEntry _conv_i16i8 ( &channel_convert_cast<int16,int8>   );
-ChannelConvertMapEntry _conv_i16u8 ( &channel_convert_cast<int16,uint8>  );
-ChannelConvertMapEntry _conv_i16i16( &channel_convert_cast<int16,int16>  );
-ChannelConvertMapEntry _conv_i16u16( &channel_convert_cast<int16,uint16> );
-ChannelConvertMapEntry _conv_i16i32( &channel_convert_cast<int16,int32>  );
-ChannelConvertMapEntry _conv_i16u32( &channel_convert_cast<int16,uint32> );
-ChannelConvertMapEntry _conv_i16i64( &channel_convert_cast<int16,int64>  );
-ChannelConvertMapEntry _conv_i16u64( &channel_convert_cast<int16,uint64> );
-ChannelConvertMapEntry _conv_i16f32( &channel_convert_cast<int16,float>, &channel_convert_int_to_float<int16,float>  );
-ChannelConvertMapEntry _conv_i16f64( &channel_convert_cast<int16,double>, &channel_convert_int_to_float<int16,double> );
-ChannelConvertMapEntry _conv_u16i8 ( &channel_convert_cast<uint16,int8>   );
-ChannelConvertMapEntry _conv_u16u8 ( &channel_convert_cast<uint16,uint8>, &channel_convert_uint16_to_uint8 );
-ChannelConvertMapEntry _conv_u16i16( &channel_convert_cast<uint16,int16>  );
-ChannelConvertMapEntry _conv_u16u16( &channel_convert_cast<uint16,uint16> );
-ChannelConvertMapEntry _conv_u16i32( &channel_convert_cast<uint16,int32>  );
-ChannelConvertMapEntry _conv_u16u32( &channel_convert_cast<uint16,uint32> );
-ChannelConvertMapEntry _conv_u16i64( &channel_convert_cast<uint16,int64>  );
-ChannelConvertMapEntry _conv_u16u64( &channel_convert_cast<uint16,uint64> );
-ChannelConvertMapEntry _conv_u16f32( &channel_convert_cast<uint16,float>, &channel_convert_int_to_float<uint16,float>  );
-ChannelConvertMapEntry _conv_u16f64( &channel_convert_cast<uint16,double>, &channel_convert_int_to_float<uint16,double> );
-ChannelConvertMapEntry _conv_i32i8 ( &channel_convert_cast<int32,int8>   );
-ChannelConvertMapEntry _conv_i32u8 ( &channel_convert_cast<int32,uint8>  );
-ChannelConvertMapEntry _conv_i32i16( &channel_convert_cast<int32,int16>  );
-ChannelConvertMapEntry _conv_i32u16( &channel_convert_cast<int32,uint16> );
-ChannelConvertMapEntry _conv_i32i32( &channel_convert_cast<int32,int32>  );
-ChannelConvertMapEntry _conv_i32u32( &channel_convert_cast<int32,uint32> );
-ChannelConvertMapEntry _conv_i32i64( &channel_convert_cast<int32,int64>  );
-ChannelConvertMapEntry _conv_i32u64( &channel_convert_cast<int32,uint64> );
-ChannelConvertMapEntry _conv_i32f32( &channel_convert_cast<int32,float>, &channel_convert_int_to_float<int32,float>  );
-ChannelConvertMapEntry _conv_i32f64( &channel_convert_cast<int32,double>, &channel_convert_int_to_float<int32,double> );
-ChannelConvertMapEntry _conv_u32i8 ( &channel_convert_cast<uint32,int8>   );
-ChannelConvertMapEntry _conv_u32u8 ( &channel_convert_cast<uint32,uint8>  );
-ChannelConvertMapEntry _conv_u32i16( &channel_convert_cast<uint32,int16>  );
-ChannelConvertMapEntry _conv_u32u16( &channel_convert_cast<uint32,uint16> );
-ChannelConvertMapEntry _conv_u32i32( &channel_convert_cast<uint32,int32>  );
-ChannelConvertMapEntry _conv_u32u32( &channel_convert_cast<uint32,uint32> );
-ChannelConvertMapEntry _conv_u32i64( &channel_convert_cast<uint32,int64>  );
-ChannelConvertMapEntry _conv_u32u64( &channel_convert_cast<uint32,uint64> );
-ChannelConvertMapEntry _conv_u32f32( &channel_convert_cast<uint32,float>, &channel_convert_int_to_float<uint32,float>  );
-ChannelConvertMapEntry _conv_u32f64( &channel_convert_cast<uint32,double>, &channel_convert_int_to_float<uint32,double> );
-ChannelConvertMapEntry _conv_i64i8 ( &channel_convert_cast<int64,int8>   );
-ChannelConvertMapEntry _conv_i64u8 ( &channel_convert_cast<int64,uint8>  );
-ChannelConvertMapEntry _conv_i64i16( &channel_convert_cast<int64,int16>  );
-ChannelConvertMapEntry _conv_i64u16( &channel_convert_cast<int64,uint16> );
-ChannelConvertMapEntry _conv_i64i32( &channel_convert_cast<int64,int32>  );
-ChannelConvertMapEntry _conv_i64u32( &channel_convert_cast<int64,uint32> );
-ChannelConvertMapEntry _conv_i64i64( &channel_convert_cast<int64,int64>  );
-ChannelConvertMapEntry _conv_i64u64( &channel_convert_cast<int64,uint64> );
-ChannelConvertMapEntry _conv_i64f32( &channel_convert_cast<int64,float>, &channel_convert_int_to_float<int64,float>  );
-ChannelConvertMapEntry _conv_i64f64( &channel_convert_cast<int64,double>, &channel_convert_int_to_float<int64,double> );
-ChannelConvertMapEntry _conv_u64i8 ( &channel_convert_cast<uint64,int8>   );
-ChannelConvertMapEntry _conv_u64u8 ( &channel_convert_cast<uint64,uint8>  );
-ChannelConvertMapEntry _conv_u64i16( &channel_convert_cast<uint64,int16>  );
-ChannelConvertMapEntry _conv_u64u16( &channel_convert_cast<uint64,uint16> );
-ChannelConvertMapEntry _conv_u64i32( &channel_convert_cast<uint64,int32>  );
-ChannelConvertMapEntry _conv_u64u32( &channel_convert_cast<uint64,uint32> );
-ChannelConvertMapEntry _conv_u64i64( &channel_convert_cast<uint64,int64>  );
-ChannelConvertMapEntry _conv_u64u64( &channel_convert_cast<uint64,uint64> );
-ChannelConvertMapEntry _conv_u64f32( &channel_convert_cast<uint64,float>, &channel_convert_int_to_float<uint64,float>  );
-ChannelConvertMapEntry _conv_u64f64( &channel_convert_cast<uint64,double>, &channel_convert_int_to_float<uint64,double> );
-ChannelConvertMapEntry _conv_f32i8 ( &channel_convert_cast<float,int8>, &channel_convert_float_to_int<float,int8>   );
-ChannelConvertMapEntry _conv_f32u8 ( &channel_convert_cast<float,uint8>, &channel_convert_float_to_int<float,uint8>  );
-ChannelConvertMapEntry _conv_f32i16( &channel_convert_cast<float,int16>, &channel_convert_float_to_int<float,int16>  );
-ChannelConvertMapEntry _conv_f32u16( &channel_convert_cast<float,uint16>, &channel_convert_float_to_int<float,uint16> );
-ChannelConvertMapEntry _conv_f32i32( &channel_convert_cast<float,int32>, &channel_convert_float_to_int<float,int32>  );
-ChannelConvertMapEntry _conv_f32u32( &channel_convert_cast<float,uint32>, &channel_convert_float_to_int<float,uint32> );
-ChannelConvertMapEntry _conv_f32i64( &channel_convert_cast<float,int64>, &channel_convert_float_to_int<float,int64>  );
-ChannelConvertMapEntry _conv_f32u64( &channel_convert_cast<float,uint64>, &channel_convert_float_to_int<float,uint64> );
-ChannelConvertMapEntry _conv_f32f32( &channel_convert_cast<float,float>  );
-ChannelConvertMapEntry _conv_f32f64( &channel_convert_cast<float,double> );
-ChannelConvertMapEntry _conv_f64i8 ( &channel_convert_cast<double,int8>, &channel_convert_float_to_int<double,int8>   );
-ChannelConvertMapEntry _conv_f64u8 ( &channel_convert_cast<double,uint8>, &channel_convert_float_to_int<double,uint8>  );
-ChannelConvertMapEntry _conv_f64i16( &channel_convert_cast<double,int16>, &channel_convert_float_to_int<double,int16>  );
-ChannelConvertMapEntry _conv_f64u16( &channel_convert_cast<double,uint16>, &channel_convert_float_to_int<double,uint16> );
-ChannelConvertMapEntry _conv_f64i32( &channel_convert_cast<double,int32>, &channel_convert_float_to_int<double,int32>  );
-ChannelConvertMapEntry _conv_f64u32( &channel_convert_cast<double,uint32>, &channel_convert_float_to_int<double,uint32> );
-ChannelConvertMapEntry _conv_f64i64( &channel_convert_cast<double,int64>, &channel_convert_float_to_int<double,int64>  );
-ChannelConvertMapEntry _conv_f64u64( &channel_convert_cast<double,uint64>, &channel_convert_float_to_int<double,uint64> );
-ChannelConvertMapEntry _conv_f64f32( &channel_convert_cast<double,float>  );
-ChannelConvertMapEntry _conv_f64f64( &channel_convert_cast<double,double> );
-
-// Channel Set Max:
-//   Assigns a channel the maximum value
-typedef void (*channel_set_max_func)(void* dest);
-
-template <class DestT>
-void channel_set_max_int( DestT* dest ) {
-  *dest = boost::integer_traits<DestT>::const_max;
-}
+  template <class T>
+  inline T channel_max( boost::false_type /*is_float*/ ) { return boost::integer_traits<T>::const_max; }
 
-template <class DestT>
-void channel_set_max_float( DestT* dest ) {
-  *dest = DestT(1.0);
-}
+  // Channel Average:
+  //   Reduces a number of channels into one by averaging
+  template <class T>
+  inline T channel_average( T const* src, int32 len ) {
+    typename AccumulatorType<T>::type accum = typename AccumulatorType<T>::type();
+    for( int32 i=0; i<len; ++i ) accum += src[i];
+    return accum / len;
+  }
 
-std::map<ChannelTypeEnum,channel_set_max_func> *channel_set_max_map = 0;
+  // Channel Premultiply:
+  //   Applies the Alpha Channel to the rest of the channels:
+  template <class T>
+  inline void channel_premultiply( T const* src, T* dst, int32 len, boost::false_type /*is_float*/ ) {
+    double scale = src[len-1] / (double)(boost::integer_traits<T>::const_max);
+    for( int32 i=0; i<len-1; ++i ) dst[i] = T( round(src[i] * scale) );
+    dst[len-1] = src[len-1];
+  }
 
-class ChannelSetMaxMapEntry {
-public:
-  template <class DstT>
-  ChannelSetMaxMapEntry( void (*func)(DstT*) ) {
-    if( !channel_set_max_map )
-      channel_set_max_map = new std::map<ChannelTypeEnum,channel_set_max_func>();
-    ChannelTypeEnum dst = ChannelTypeID<DstT>::value;
-    channel_set_max_map->operator[]( dst ) = (channel_set_max_func)func;
+  template <class T>
+  inline void channel_premultiply( T const* src, T* dst, int32 len, boost::true_type /*is_float*/ ) {
+    double scale = (double)(src[len-1]);
+    for( int32 i=0; i<len-1; ++i ) dst[i] = T( src[i] * scale );
+    dst[len-1] = src[len-1];
   }
-};
-
-ChannelSetMaxMapEntry _setmax_i8 ( &channel_set_max_int<int8> );
-ChannelSetMaxMapEntry _setmax_u8 ( &channel_set_max_int<uint8> );
-ChannelSetMaxMapEntry _setmax_i16( &channel_set_max_int<int16> );
-ChannelSetMaxMapEntry _setmax_u16( &channel_set_max_int<uint16> );
-ChannelSetMaxMapEntry _setmax_i32( &channel_set_max_int<int32> );
-ChannelSetMaxMapEntry _setmax_u32( &channel_set_max_int<uint32> );
-ChannelSetMaxMapEntry _setmax_i64( &channel_set_max_int<int64> );
-ChannelSetMaxMapEntry _setmax_u64( &channel_set_max_int<uint64> );
-ChannelSetMaxMapEntry _setmax_f32( &channel_set_max_float<float> );
-ChannelSetMaxMapEntry _setmax_f64( &channel_set_max_float<double> );
-
-// Channel Average:
-//   Reduces a number of channels into one by averaging
-typedef void (*channel_average_func)(void* src, void* dest, int32 len);
-
-template <class T>
-void channel_average( T* src, T* dest, int32 len ) {
-  typename AccumulatorType<T>::type accum = typename AccumulatorType<T>::type();
-  for( int32 i=0; i<len; ++i ) accum += src[i];
-  *dest = accum / len;
-}
 
-std::map<ChannelTypeEnum,channel_average_func> *channel_average_map = 0;
+  // Channel Unpremultiply:
+  //   Removes the premultiply of alpha to other channels:
+  template <class T>
+  inline void channel_unpremultiply( T const* src, T* dst, int32 len, boost::false_type /*is_float*/ ) {
+    double scale = src[len-1] / (double)(boost::integer_traits<T>::const_max);
+    for( int32 i=0; i<len-1; ++i ) dst[i] = T( round(src[i] / scale) );
+    dst[len-1] = src[len-1];
+  }
 
-class ChannelAverageMapEntry {
-public:
   template <class T>
-  ChannelAverageMapEntry( void (*func)(T*,T*,int32) ) {
-    if( !channel_average_map )
-      channel_average_map = new std::map<ChannelTypeEnum,channel_average_func>();
-    ChannelTypeEnum ctid = ChannelTypeID<T>::value;
-    channel_average_map->operator[]( ctid ) = (channel_average_func)func;
+  inline void channel_unpremultiply( T const* src, T* dst, int32 len, boost::true_type /*is_float*/ ) {
+    double scale = (double)(src[len-1]);
+    for( int32 i=0; i<len-1; ++i ) dst[i] = T( src[i] / scale );
+    dst[len-1] = src[len-1];
   }
-};
-
-ChannelAverageMapEntry _average_i8 ( &channel_average<int8> );
-ChannelAverageMapEntry _average_u8 ( &channel_average<uint8> );
-ChannelAverageMapEntry _average_i16( &channel_average<int16> );
-ChannelAverageMapEntry _average_u16( &channel_average<uint16> );
-ChannelAverageMapEntry _average_i32( &channel_average<int32> );
-ChannelAverageMapEntry _average_u32( &channel_average<uint32> );
-ChannelAverageMapEntry _average_i64( &channel_average<int64> );
-ChannelAverageMapEntry _average_u64( &channel_average<uint64> );
-ChannelAverageMapEntry _average_f32( &channel_average<float> );
-ChannelAverageMapEntry _average_f64( &channel_average<double> );
-
-// Channel Premultiply:
-//   Applies the Alpha Channel to the rest of the channels:
-typedef void (*channel_premultiply_func)(void* src, void* dst, int32 len);
-
-template <class T>
-void channel_premultiply_int( T* src, T* dst, int32 len ) {
-  double scale = src[len-1] / (double)(boost::integer_traits<T>::const_max);
-  for( int32 i=0; i<len-1; ++i ) dst[i] = T( round(src[i] * scale) );
-  dst[len-1] = src[len-1];
-}
 
-template <class T>
-void channel_premultiply_float( T* src, T* dst, int32 len ) {
-  double scale = (double)(src[len-1]);
-  for( int32 i=0; i<len-1; ++i ) dst[i] = T( src[i] * scale );
-  dst[len-1] = src[len-1];
-}
+  // Everything about a conversion that is fixed for the whole call.
+  struct ConvertParams {
+    enum { MAX_CHANNELS = 8 };
+    uint32 cols;
+    ptrdiff_t src_cstride, dst_cstride;
+    int32 src_channels, dst_channels, copy_length;
+    bool contiguous;
+    bool unpremultiply_src, premultiply_src, premultiply_dst;
+    bool triplicate, average, add_alpha, copy_alpha;
+  };
+
+  typedef void (*convert_row_func)( ConvertParams const& p, uint8 const* src, uint8* dst );
+
+  // Converts one row of pixels.  One of these is instantiated for
+  // every pair of channel types, with and without rescaling, so all
+  // of the per-channel work is inlined and the only indirect call is
+  // the one per row.
+  template <class SrcT, class DstT, bool RescaleV>
+  void convert_row( ConvertParams const& p, uint8 const* src_row, uint8* dst_row ) {
+    typedef ChannelConvert<SrcT,DstT,RescaleV> Conv;
+    typedef typename boost::is_floating_point<SrcT>::type src_is_float;
+    typedef typename boost::is_floating_point<DstT>::type dst_is_float;
+
+    // Same channels, packed pixels and no alpha to fix up: the row is
+    // a single run of channel values.
+    if( p.contiguous ) {
+      SpanConvert<SrcT,DstT,RescaleV>::apply( (SrcT const*)src_row, (DstT*)dst_row, size_t(p.cols) * p.src_channels );
+      return;
+    }
 
-std::map<ChannelTypeEnum,channel_premultiply_func> *channel_premultiply_map = 0;
+    SrcT src_buf[ConvertParams::MAX_CHANNELS];
+    DstT avg_buf[3];
+    const int32 src_channels = p.src_channels, dst_channels = p.dst_channels;
 
-class ChannelPremultiplyMapEntry {
-public:
-  template <class T>
-  ChannelPremultiplyMapEntry( void (*func)(T*,T*,int32) ) {
-    if( !channel_premultiply_map )
-      channel_premultiply_map = new std::map<ChannelTypeEnum,channel_premultiply_func>();
-    ChannelTypeEnum ctid = ChannelTypeID<T>::value;
-    channel_premultiply_map->operator[]( ctid ) = (channel_premultiply_func)func;
-  }
-};
-
-ChannelPremultiplyMapEntry _premultiply_i8 ( &channel_premultiply_int<int8> );
-ChannelPremultiplyMapEntry _premultiply_u8 ( &channel_premultiply_int<uint8> );
-ChannelPremultiplyMapEntry _premultiply_i16( &channel_premultiply_int<int16> );
-ChannelPremultiplyMapEntry _premultiply_u16( &channel_premultiply_int<uint16> );
-ChannelPremultiplyMapEntry _premultiply_i32( &channel_premultiply_int<int32> );
-ChannelPremultiplyMapEntry _premultiply_u32( &channel_premultiply_int<uint32> );
-ChannelPremultiplyMapEntry _premultiply_i64( &channel_premultiply_int<int64> );
-ChannelPremultiplyMapEntry _premultiply_u64( &channel_premultiply_int<uint64> );
-ChannelPremultiplyMapEntry _premultiply_f32( &channel_premultiply_float<float> );
-ChannelPremultiplyMapEntry _premultiply_f64( &channel_premultiply_float<double> );
-
-// Channel Unpremultiply:
-//   Removes the premultiply of alpha to other channels:
-typedef void (*channel_unpremultiply_func)(void* src, void* dst, int32 len);
-
-template <class T>
-void channel_unpremultiply_int( T* src, T* dst, int32 len ) {
-  double scale = src[len-1] / (double)(boost::integer_traits<T>::const_max);
-  for( int32 i=0; i<len-1; ++i ) dst[i] = T( round(src[i] / scale) );
-  dst[len-1] = src[len-1];
-}
+    for( uint32 c=0; c<p.cols; ++c ) {
 
-template <class T>
-void channel_unpremultiply_float( T* src, T* dst, int32 len ) {
-  double scale = (double)(src[len-1]);
-  for( int32 i=0; i<len-1; ++i ) dst[i] = T( src[i] / scale );
-  dst[len-1] = src[len-1];
-}
+      // Setup the buffers, adjusting premultiplication if needed
+      SrcT const* src = (SrcT const*)src_row;
+      DstT* dst = (DstT*)dst_row;
+      if( p.unpremultiply_src ) {
+        channel_unpremultiply( src, src_buf, src_channels, src_is_float() );
+        src = src_buf;
+      }
+      else if( p.premultiply_src ) {
+        channel_premultiply( src, src_buf, src_channels, src_is_float() );
+        src = src_buf;
+      }
 
-std::map<ChannelTypeEnum,channel_unpremultiply_func> *channel_unpremultiply_map = 0;
+      // Copy/convert
+      for( int32 ch=0; ch<p.copy_length; ++ch )
+        dst[ch] = Conv::apply( src[ch] );
 
-class ChannelUnpremultiplyMapEntry {
-public:
-  template <class T>
-  ChannelUnpremultiplyMapEntry( void (*func)(T*,T*,int32) ) {
-    if( !channel_unpremultiply_map )
-      channel_unpremultiply_map = new std::map<ChannelTypeEnum,channel_unpremultiply_func>();
-    ChannelTypeEnum ctid = ChannelTypeID<T>::value;
-    channel_unpremultiply_map->operator[]( ctid ) = (channel_unpremultiply_func)func;
+      // Handle the special pixel format conversions
+      if( p.triplicate ) {
+        dst[1] = dst[2] = Conv::apply( src[0] );
+      }
+      else if( p.average ) {
+        for( int32 ch=0; ch<3; ++ch )
+          avg_buf[ch] = Conv::apply( src[ch] );
+        dst[0] = channel_average( avg_buf, 3 );
+      }
+      if( p.copy_alpha ) {
+        dst[dst_channels-1] = Conv::apply( src[src_channels-1] );
+      }
+      else if( p.add_alpha ) {
+        dst[dst_channels-1] = channel_max<DstT>( dst_is_float() );
+      }
+
+      // Finally, adjust destination premultiplication if needed
+      if( p.premultiply_dst )
+        channel_premultiply( dst, dst, dst_channels, dst_is_float() );
+
+      src_row += p.src_cstride;
+      dst_row += p.dst_cstride;
+    }
+  }
+
+  template <class SrcT>
+  convert_row_func select_row_kernel( ChannelTypeEnum dst, bool rescale ) {
+#define VW_ROW_KERNEL(type) return rescale ? &convert_row<SrcT,type,true> : &convert_row<SrcT,type,false>
+    switch( dst ) {
+    case VW_CHANNEL_INT8:    VW_ROW_KERNEL(int8);
+    case VW_CHANNEL_UINT8:   VW_ROW_KERNEL(uint8);
+    case VW_CHANNEL_INT16:   VW_ROW_KERNEL(int16);
+    case VW_CHANNEL_UINT16:  VW_ROW_KERNEL(uint16);
+    case VW_CHANNEL_INT32:   VW_ROW_KERNEL(int32);
+    case VW_CHANNEL_UINT32:  VW_ROW_KERNEL(uint32);
+    case VW_CHANNEL_INT64:   VW_ROW_KERNEL(int64);
+    case VW_CHANNEL_UINT64:  VW_ROW_KERNEL(uint64);
+    case VW_CHANNEL_FLOAT32: VW_ROW_KERNEL(float32);
+    case VW_CHANNEL_FLOAT64: VW_ROW_KERNEL(float64);
+    default: return 0;
+    }
+#undef VW_ROW_KERNEL
   }
-};
-
-ChannelUnpremultiplyMapEntry _unpremultiply_i8 ( &channel_unpremultiply_int<int8> );
-ChannelUnpremultiplyMapEntry _unpremultiply_u8 ( &channel_unpremultiply_int<uint8> );
-ChannelUnpremultiplyMapEntry _unpremultiply_i16( &channel_unpremultiply_int<int16> );
-ChannelUnpremultiplyMapEntry _unpremultiply_u16( &channel_unpremultiply_int<uint16> );
-ChannelUnpremultiplyMapEntry _unpremultiply_i32( &channel_unpremultiply_int<int32> );
-ChannelUnpremultiplyMapEntry _unpremultiply_u32( &channel_unpremultiply_int<uint32> );
-ChannelUnpremultiplyMapEntry _unpremultiply_i64( &channel_unpremultiply_int<int64> );
-ChannelUnpremultiplyMapEntry _unpremultiply_u64( &channel_unpremultiply_int<uint64> );
-ChannelUnpremultiplyMapEntry _unpremultiply_f32( &channel_unpremultiply_float<float> );
-ChannelUnpremultiplyMapEntry _unpremultiply_f64( &channel_unpremultiply_float<double> );
+
+  // Picks the row kernel for a pair of channel types, or returns 0
+  // if we don't support the combination.
+  convert_row_func select_row_kernel( ChannelTypeEnum src, ChannelTypeEnum dst, bool rescale ) {
+    switch( src ) {
+    case VW_CHANNEL_INT8:    return select_row_kernel<int8>( dst, rescale );
+    case VW_CHANNEL_UINT8:   return select_row_kernel<uint8>( dst, rescale );
+    case VW_CHANNEL_INT16:   return select_row_kernel<int16>( dst, rescale );
+    case VW_CHANNEL_UINT16:  return select_row_kernel<uint16>( dst, rescale );
+    case VW_CHANNEL_INT32:   return select_row_kernel<int32>( dst, rescale );
+    case VW_CHANNEL_UINT32:  return select_row_kernel<uint32>( dst, rescale );
+    case VW_CHANNEL_INT64:   return select_row_kernel<int64>( dst, rescale );
+    case VW_CHANNEL_UINT64:  return select_row_kernel<uint64>( dst, rescale );
+    case VW_CHANNEL_FLOAT32: return select_row_kernel<float32>( dst, rescale );
+    case VW_CHANNEL_FLOAT64: return select_row_kernel<float64>( dst, rescale );
+    default: return 0;
+    }
+  }
+
+} // anonymous namespace
+
+bool vw::convert_is_copy( ImageFormat const& dst, ImageFormat const& src ) {
+  if( dst.pixel_format != src.pixel_format || dst.channel_type != src.channel_type || dst.planes != src.planes )
+    return false;
+  bool alpha = ( src.pixel_format == VW_PIXEL_GRAYA || src.pixel_format == VW_PIXEL_RGBA );
+  return ! alpha || dst.premultiplied == src.premultiplied;
+}
 
 void vw::convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale ) {
   VW_ASSERT( dst.format.cols==src.format.cols && dst.format.rows==src.format.rows,
@@ -403,112 +436,56 @@ void vw::convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale )
   size_t dst_channels = num_channels( dst.format.pixel_format );
   size_t src_chstride = channel_size( src.format.channel_type );
   size_t dst_chstride = channel_size( dst.format.channel_type );
+  VW_ASSERT( src_channels <= ConvertParams::MAX_CHANNELS && dst_channels <= ConvertParams::MAX_CHANNELS,
+             NoImplErr() << "Too many channels in convert (" << src_channels << ", " << dst_channels << ")!" );
 
-  int32 copy_length = (src_channels==dst_channels) ? src_channels : (src_channels<3) ? 1 : (dst_channels>=3) ? 3 : 0;
+  ConvertParams p;
+  p.cols = src.format.cols;
+  p.src_cstride = src.cstride;
+  p.dst_cstride = dst.cstride;
+  p.src_channels = src_channels;
+  p.dst_channels = dst_channels;
+  p.copy_length = (src_channels==dst_channels) ? src_channels : (src_channels<3) ? 1 : (dst_channels>=3) ? 3 : 0;
 
-  bool unpremultiply_src = false, premultiply_src = false, premultiply_dst = false;
   {
     const ImageFormat& srcf = src.format, dstf = dst.format;
     bool src_alpha = (srcf.pixel_format == VW_PIXEL_GRAYA || dstf.pixel_format == VW_PIXEL_RGBA);
     bool dst_alpha = (dstf.pixel_format == VW_PIXEL_GRAYA || dstf.pixel_format == VW_PIXEL_RGBA);
-    unpremultiply_src = (src_alpha && srcf.premultiplied && !dstf.premultiplied);
-    premultiply_src   = (src_alpha && !dst_alpha && !srcf.premultiplied);
-    premultiply_dst   = (src_alpha && dst_alpha && !srcf.premultiplied && dstf.premultiplied);
+    p.unpremultiply_src = (src_alpha && srcf.premultiplied && !dstf.premultiplied);
+    p.premultiply_src   = (src_alpha && !dst_alpha && !srcf.premultiplied);
+    p.premultiply_dst   = (src_alpha && dst_alpha && !srcf.premultiplied && dstf.premultiplied);
   }
 
-  bool triplicate = src_channels<3 && dst_channels>=3;
-  bool average = src_channels >=3 && dst_channels<3;
-  bool add_alpha = src_channels%2==1 && dst_channels%2==0;
-  bool copy_alpha = src_channels!=dst_channels && src_channels%2==0 && dst_channels%2==0;
-
-  channel_convert_func conv_func = rescale
-    ? channel_convert_rescale_map->operator[](std::make_pair(src.format.channel_type,dst.format.channel_type))
-    : channel_convert_map->operator[](std::make_pair(src.format.channel_type,dst.format.channel_type));
-  channel_set_max_func max_func = channel_set_max_map->operator[](dst.format.channel_type);
-  channel_average_func avg_func = channel_average_map->operator[](dst.format.channel_type);
-  channel_unpremultiply_func unpremultiply_src_func = channel_unpremultiply_map->operator[](src.format.channel_type);
-  channel_premultiply_func premultiply_src_func = channel_premultiply_map->operator[](src.format.channel_type);
-  channel_premultiply_func premultiply_dst_func = channel_premultiply_map->operator[](dst.format.channel_type);
-  if( !conv_func || !max_func || !avg_func || !unpremultiply_src_func || !premultiply_dst_func || !premultiply_src_func )
-    vw_throw( NoImplErr() << "Unsupported channel type combination in convert (" << src.format.channel_type << ", " << dst.format.channel_type << ")!" );
+  p.triplicate = src_channels<3 && dst_channels>=3;
+  p.average = src_channels >=3 && dst_channels<3;
+  p.add_alpha = src_channels%2==1 && dst_channels%2==0;
+  p.copy_alpha = src_channels!=dst_channels && src_channels%2==0 && dst_channels%2==0;
 
-  int32 max_channels = std::max( src_channels, dst_channels );
+  p.contiguous = src_channels==dst_channels
+    && !p.unpremultiply_src && !p.premultiply_src && !p.premultiply_dst
+    && src.cstride == ptrdiff_t(src_channels*src_chstride)
+    && dst.cstride == ptrdiff_t(dst_channels*dst_chstride);
 
-  boost::scoped_array<uint8> src_buf(new uint8[max_channels*src_chstride]);
-  boost::scoped_array<uint8> dst_buf(new uint8[max_channels*dst_chstride]);
+  convert_row_func row_func = select_row_kernel( src.format.channel_type, dst.format.channel_type, rescale );
+  if( !row_func )
+    vw_throw( NoImplErr() << "Unsupported channel type combination in convert (" << src.format.channel_type << ", " << dst.format.channel_type << ")!" );
+
+  // If whole rows are packed back to back as well, we can convert
+  // each plane as one long row.
+  uint32 rows = src.format.rows;
+  if( p.contiguous && rows > 1
+      && src.rstride == ptrdiff_t(p.cols)*src.cstride && dst.rstride == ptrdiff_t(p.cols)*dst.cstride ) {
+    p.cols *= rows;
+    rows = 1;
+  }
 
-  uint8 *src_ptr_p = (uint8*)src.data;
+  uint8 const *src_ptr_p = (uint8 const*)src.data;
   uint8 *dst_ptr_p = (uint8*)dst.data;
-  for( uint32 p=0; p<src.format.planes; ++p ) {
-    uint8 *src_ptr_r = src_ptr_p;
+  for( uint32 pl=0; pl<src.format.planes; ++pl ) {
+    uint8 const *src_ptr_r = src_ptr_p;
     uint8 *dst_ptr_r = dst_ptr_p;
-    for( uint32 r=0; r<src.format.rows; ++r ) {
-      uint8 *src_ptr_c = src_ptr_r;
-      uint8 *dst_ptr_c = dst_ptr_r;
-      for( uint32 c=0; c<src.format.cols; ++c ) {
-
-        // Setup the buffers, adjusting premultiplication if needed
-        uint8 *src_ptr = src_ptr_c;
-        uint8 *dst_ptr = dst_ptr_c;
-        if( unpremultiply_src ) {
-          unpremultiply_src_func( src_ptr, src_buf.get(), src_channels );
-          src_ptr = src_buf.get();
-        }
-        else if( premultiply_src ) {
-          premultiply_src_func( src_ptr, src_buf.get(), src_channels );
-          src_ptr = src_buf.get();
-        }
-
-        // Copy/convert, unrolling the common multi-channel cases
-        if( copy_length==4 ) {
-          conv_func( src_ptr, dst_ptr );
-          conv_func( src_ptr+src_chstride, dst_ptr+dst_chstride );
-          conv_func( src_ptr+2*src_chstride, dst_ptr+2*dst_chstride );
-          conv_func( src_ptr+3*src_chstride, dst_ptr+3*dst_chstride );
-        }
-        else if( copy_length==3 ) {
-          conv_func( src_ptr, dst_ptr );
-          conv_func( src_ptr+src_chstride, dst_ptr+dst_chstride );
-          conv_func( src_ptr+2*src_chstride, dst_ptr+2*dst_chstride );
-        }
-        else if( copy_length==2) {
-          conv_func( src_ptr, dst_ptr );
-          conv_func( src_ptr+src_chstride, dst_ptr+dst_chstride );
-        }
-        else if( copy_length==1 ) {
-          conv_func( src_ptr, dst_ptr );
-        }
-        else {
-          for( int32 ch=0; ch<copy_length; ++ch ) {
-            conv_func( src_ptr+ch*src_chstride, dst_ptr+ch*dst_chstride );
-          }
-        }
-
-        // Handle the special pixel format conversions
-        if( triplicate ) {
-          conv_func( src_ptr, dst_ptr+dst_chstride );
-          conv_func( src_ptr, dst_ptr+2*dst_chstride );
-        }
-        else if( average ) {
-          for( int32 ch=0; ch<3; ++ch ) {
-            conv_func( src_ptr+ch*src_chstride, dst_buf.get()+ch*dst_chstride );
-          }
-          avg_func( dst_buf.get(), dst_ptr, 3 );
-        }
-        if( copy_alpha ) {
-          conv_func( src_ptr+(src_channels-1)*src_chstride, dst_ptr+(dst_channels-1)*dst_chstride );
-        }
-        else if( add_alpha ) {
-          max_func( dst_ptr+(dst_channels-1)*dst_chstride );
-        }
-
-        // Finally, adjust destination premultiplication if needed
-        if( premultiply_dst ) {
-          premultiply_dst_func( dst_ptr, dst_ptr, dst_channels );
-        }
-        src_ptr_c += src.cstride;
-        dst_ptr_c += dst.cstride;
-      }
+    for( uint32 r=0; r<rows; ++r ) {
+      row_func( p, src_ptr_r, dst_ptr_r );
       src_ptr_r += src.rstride;
       dst_ptr_r += dst.rstride;
     }
@@ -527,6 +504,23 @@ ImageFormat SrcImageResource::format() const {
   return fmt;
 }
 
+namespace {
+  // Reads a region of a resource into a buffer, for read_async().
+  struct ResourceReadTask {
+    SrcImageResource const* rsrc;
+    ImageBuffer buf;
+    BBox2i bbox;
+    ResourceReadTask( SrcImageResource const* rsrc, ImageBuffer const& buf, BBox2i const& bbox )
+      : rsrc(rsrc), buf(buf), bbox(bbox) {}
+    typedef void result_type;
+    void operator()() const { rsrc->read( buf, bbox ); }
+  };
+}
+
+Future<void> SrcImageResource::read_async( ImageBuffer const& buf, BBox2i const& bbox ) const {
+  return vw_io_queue().submit( ResourceReadTask( this, buf, bbox ) );
+}
+
 boost::shared_array<const uint8> SrcImageResource::native_ptr() const {
   boost::shared_array<const uint8> data(new uint8[native_size()]);
   this->read(ImageBuffer(format(), const_cast<uint8*>(data.get())), BBox2i(0,0,cols(),rows()));
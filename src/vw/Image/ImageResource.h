@@ -12,6 +12,9 @@
 #ifndef __VW_IMAGE_IMAGERESOURCE_H__
 #define __VW_IMAGE_IMAGERESOURCE_H__
 
+#include <vector>
+
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
 
@@ -27,6 +30,14 @@ namespace vw {
   /// buffer, converting the pixel format and channel type as required.
   void convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale=false );
 
+  struct ImageFormat;
+
+  /// True if convert() from pixels of format src to format dst only
+  /// copies them: the pixel format, channel type and plane count match
+  /// and, with alpha, so does premultiplication.  The sizes are not
+  /// compared.
+  bool convert_is_copy( ImageFormat const& dst, ImageFormat const& src );
+
 
   /// Describes the format of an image, i.e. its dimensions, pixel
   /// structure, and channel type.
@@ -98,6 +109,28 @@ namespace vw {
       /// Read the image resource at the given location into the given buffer.
       virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const = 0;
 
+      /// Starts reading the image at the given location into the given
+      /// buffer and returns a handle to wait on for it to finish, which
+      /// also rethrows any error.  The buffer and the resource must
+      /// outlive the read.  By default, read() is run on vw_io_queue().
+      /// Unless has_async_read() says otherwise, this is just read() on
+      /// another thread, so the caller must still see to it that no
+      /// other read of the resource overlaps it.
+      virtual Future<void> read_async( ImageBuffer const& buf, BBox2i const& bbox ) const;
+
+      /// Whether read() decodes the region bbox straight into buf, with
+      /// no scratch buffer and no convert().  That takes a buf holding
+      /// pixels just as the resource stores them (see convert_is_copy())
+      /// and, for some drivers, a suitably aligned bbox.  Drivers take
+      /// the direct path by themselves when they can; this lets callers
+      /// lay out their buffers to get it.
+      virtual bool has_direct_read( ImageBuffer const& /*buf*/, BBox2i const& /*bbox*/ ) const { return false; }
+
+      /// Whether read_async() is safe to call while other reads of this
+      /// resource are in progress, as it is for a resource that queues
+      /// its own I/O.
+      virtual bool has_async_read() const { return false; }
+
       /// Does this resource support block reads?
       // If you override this to true, you must implement the other block_read functions
       virtual bool has_block_read() const = 0;
@@ -114,6 +147,24 @@ namespace vw {
         vw_throw(NoImplErr() << "This ImageResource does not support nodata_read().");
       }
 
+      /// Returns the largest factor, no more than scale, by which this
+      /// resource can read itself reduced more cheaply than by reading
+      /// it whole, e.g. from an overview or by decoding at a lower
+      /// resolution.  The default, 1, means it cannot.
+      virtual int32 reduced_read_factor( int32 /*scale*/ ) const { return 1; }
+
+      /// Reads the region bbox of the image reduced by factor, which
+      /// must come from reduced_read_factor(), into buf.  The reduced
+      /// image is 1+(cols()-1)/factor by 1+(rows()-1)/factor, the
+      /// size subsample() makes, and bbox is in its coordinates.  Each
+      /// of its pixels summarizes the factor-by-factor square of the
+      /// full resolution image at its top left corner.
+      virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 factor ) const {
+        if( factor != 1 )
+          vw_throw(NoImplErr() << "This ImageResource does not support reduced reads.");
+        read( buf, bbox );
+      }
+
       /// Return a pointer to the data in the same format as format(). This
       /// might cause a copy, depending on implementation. The shared_ptr will
       /// handle cleanup.
@@ -143,6 +194,13 @@ namespace vw {
         vw_throw(NoImplErr() << "This ImageResource does not support block writes");
       }
 
+      // Does this resource accept full-width strips, of any height,
+      // written one after another from the top of the image down?
+      // Resources that can't take arbitrary blocks may still stream
+      // this way, which lets stream_write_image() write them a few
+      // rows at a time.
+      virtual bool has_scanline_write() const { return false; }
+
       // Does this resource have an output nodata value?
       // If you override this to true, you must implement the other nodata_write functions
       virtual bool has_nodata_write() const = 0;
@@ -154,6 +212,29 @@ namespace vw {
 
       /// Force any changes to be written to the resource.
       virtual void flush() = 0;
+
+      // Can this resource encode (e.g. compress) a block separately
+      // from writing it?  If so, block_write_image() encodes blocks on
+      // its rasterizing threads and only hands the encoded bytes to the
+      // writer.  If you override this to true, you must implement
+      // encode_block() and write_encoded_block().
+      virtual bool has_block_encode() const { return false; }
+
+      /// Encodes the block of the resource at bbox, whose pixels are in
+      /// buf, into the bytes the resource would store for it.  This
+      /// must be safe to call from several threads at once and while
+      /// other blocks are being written, so it may not touch the
+      /// underlying stream.  The bbox is aligned to block_write_size().
+      virtual void encode_block( ImageBuffer const& /*buf*/, BBox2i const& /*bbox*/,
+                                 std::vector<uint8>& /*encoded*/ ) const {
+        vw_throw(NoImplErr() << "This ImageResource does not support block encoding");
+      }
+
+      /// Stores a block produced by encode_block().  Blocks arrive one
+      /// at a time, in the order block_write_image() numbers them.
+      virtual void write_encoded_block( std::vector<uint8> const& /*encoded*/, BBox2i const& /*bbox*/ ) {
+        vw_throw(NoImplErr() << "This ImageResource does not support block encoding");
+      }
   };
 
   // A read-write image resource
@@ -12,17 +12,309 @@
 /// This class no longer caches blocks.  That functionality has been
 /// factored out to BlockRasterizeView.
 ///
+/// A view can optionally read ahead: after each rasterization it
+/// predicts the regions that a row-major walk over the resource's
+/// blocks will ask for next and reads them on a background I/O
+/// thread, so that the next read is already in memory when it is
+/// requested.  See set_read_ahead().  Regions can also be asked for
+/// ahead of time with prefetch(), which BlockRasterizeView does for
+/// the blocks it is about to rasterize.  Both read on vw_io_queue(),
+/// so the threads rasterizing the view aren't kept waiting on the
+/// disk.
+///
+/// Subsampling a view with subsample() reads the resource at a
+/// reduced resolution when it can (see
+/// SrcImageResource::reduced_read_factor()), e.g. from a GDAL
+/// overview or with libjpeg's DCT scaling, rather than reading it
+/// whole and keeping every Nth pixel.
+///
 #ifndef __VW_IMAGE_IMAGERESOURCEVIEW_H__
 #define __VW_IMAGE_IMAGERESOURCEVIEW_H__
 
 #include <vw/Core/Cache.h>
+#include <vw/Core/System.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
+  /// Counters reported by an ImageResourceView that reads ahead.
+  struct ReadAheadStats {
+    uint64 issued;  ///< Blocks read on the I/O thread.
+    uint64 hits;    ///< Requests served from a block that was read ahead.
+    uint64 misses;  ///< Requests that had to be read on demand.
+    uint64 wasted;  ///< Blocks read on the I/O thread and never used.
+    ReadAheadStats() : issued(0), hits(0), misses(0), wasted(0) {}
+  };
+
+  namespace detail {
+
+    // The read-ahead state of an ImageResourceView, shared by all of
+    // its copies.  Each predicted or prefetched block is read on
+    // vw_io_queue() into its own buffer, which comes from
+    // vw_buffer_pool() when that is enabled.
+    template <class PixelT>
+    class ResourceReadAhead : private boost::noncopyable {
+
+      // A block that has been queued for reading.  The I/O thread only
+      // reads it if it moves it from Queued to Reading first, so a
+      // block that is discarded before its turn costs nothing.  A
+      // resource with its own asynchronous reads is handed the block
+      // as soon as it is queued, so those start out Reading.
+      struct Block {
+        enum { Queued, Reading, Cancelled };
+        BBox2i bbox;
+        ImageView<PixelT> buffer;
+        Atomic<int32> state;
+        Future<void> done;
+        Block( BBox2i const& bbox ) : bbox(bbox), state(Queued) {}
+      };
+
+      class ReadTask {
+        boost::shared_ptr<Block> m_block;
+        boost::shared_ptr<SrcImageResource> m_rsrc;
+        boost::shared_ptr<Mutex> m_rsrc_mutex;
+        int32 m_planes;
+        boost::shared_ptr<Atomic<uint64> > m_issued;
+      public:
+        typedef void result_type;
+        ReadTask( boost::shared_ptr<Block> const& block, boost::shared_ptr<SrcImageResource> const& rsrc,
+                  boost::shared_ptr<Mutex> const& rsrc_mutex, int32 planes, boost::shared_ptr<Atomic<uint64> > const& issued )
+          : m_block(block), m_rsrc(rsrc), m_rsrc_mutex(rsrc_mutex), m_planes(planes), m_issued(issued) {}
+        void operator()() const {
+          if( ! m_block->state.compare_and_swap( Block::Queued, Block::Reading ) ) return;
+          ImageView<PixelT> buffer( m_block->bbox.width(), m_block->bbox.height(), m_planes );
+          {
+            Mutex::Lock lock( *m_rsrc_mutex );
+            read_image( buffer, *m_rsrc, m_block->bbox );
+          }
+          m_block->buffer = buffer;
+          ++(*m_issued);
+        }
+      };
+
+      typedef std::vector<boost::shared_ptr<Block> > block_list;
+
+      boost::shared_ptr<SrcImageResource> m_rsrc;
+      boost::shared_ptr<Mutex> m_rsrc_mutex;
+      int32 m_planes, m_depth;
+      size_t m_prefetch_limit;
+      Vector2i m_block_size;
+      Mutex m_mutex;
+      block_list m_pending, m_prefetched, m_draining;
+      Atomic<int32> m_outstanding;
+      boost::shared_ptr<Atomic<uint64> > m_issued;
+      Atomic<uint64> m_hits, m_misses, m_wasted;
+
+      // Starts reading a block.  Call with m_mutex held.
+      boost::shared_ptr<Block> start( BBox2i const& bbox ) {
+        boost::shared_ptr<Block> block( new Block( bbox ) );
+        if( m_rsrc->has_async_read() ) {
+          block->state.store( Block::Reading );
+          block->buffer.set_size( bbox.width(), bbox.height(), m_planes );
+          block->done = m_rsrc->read_async( block->buffer.buffer(), bbox );
+          ++(*m_issued);
+        }
+        else
+          block->done = vw_io_queue().submit( ReadTask( block, m_rsrc, m_rsrc_mutex, m_planes, m_issued ) );
+        return block;
+      }
+
+      // Drops a pending block.  If the read already started on it, the
+      // read was wasted, and a resource's own asynchronous read is
+      // still writing to the buffer, so that is kept until it is done.
+      // Call with m_mutex held.
+      void discard( boost::shared_ptr<Block> const& block ) {
+        if( block->state.compare_and_swap( Block::Queued, Block::Cancelled ) ) return;
+        ++m_wasted;
+        if( m_rsrc->has_async_read() && ! block->done.is_ready() )
+          m_draining.push_back( block );
+      }
+
+      // Takes the block holding bbox off a list.  Call with m_mutex held.
+      static boost::shared_ptr<Block> take( block_list& list, BBox2i const& bbox ) {
+        boost::shared_ptr<Block> block;
+        for( typename block_list::iterator i=list.begin(); i!=list.end(); ++i ) {
+          if( (*i)->bbox.contains( bbox ) ) {
+            block = *i;
+            list.erase( i );
+            break;
+          }
+        }
+        return block;
+      }
+
+      // Appends the blocks that follow bbox in a row-major walk over
+      // the resource's block grid.  If bbox is not a single block, the
+      // walk is over a grid of bbox-sized cells that contains it.
+      void predict( BBox2i const& bbox, std::vector<BBox2i>& result ) const {
+        BBox2i image( 0, 0, m_rsrc->cols(), m_rsrc->rows() );
+        Vector2i size = m_block_size, origin;
+        BBox2i block( (bbox.min().x()/size.x())*size.x(), (bbox.min().y()/size.y())*size.y(), size.x(), size.y() );
+        block.crop( image );
+        if( block != bbox ) {
+          size = bbox.size();
+          origin = Vector2i( bbox.min().x() % size.x(), bbox.min().y() % size.y() );
+          if( origin.x() > 0 ) origin.x() -= size.x();
+          if( origin.y() > 0 ) origin.y() -= size.y();
+        }
+        int32 cells_x = (image.width() - origin.x() + size.x() - 1) / size.x();
+        int32 cells_y = (image.height() - origin.y() + size.y() - 1) / size.y();
+        int32 index = ((bbox.min().y() - origin.y()) / size.y()) * cells_x + (bbox.min().x() - origin.x()) / size.x();
+        for( int32 i=index+1; i<=index+m_depth && i<cells_x*cells_y; ++i ) {
+          BBox2i cell( origin.x() + (i % cells_x)*size.x(), origin.y() + (i / cells_x)*size.y(), size.x(), size.y() );
+          cell.crop( image );
+          if( ! cell.empty() ) result.push_back( cell );
+        }
+      }
+
+    public:
+      ResourceReadAhead( boost::shared_ptr<SrcImageResource> const& rsrc, boost::shared_ptr<Mutex> const& rsrc_mutex,
+                         int32 planes, int32 depth )
+        : m_rsrc(rsrc), m_rsrc_mutex(rsrc_mutex), m_planes(planes), m_depth(depth),
+          m_prefetch_limit( (std::max)( 4u, 2*vw_settings().default_num_threads() ) ),
+          m_block_size(rsrc->block_read_size()), m_outstanding(0), m_issued(new Atomic<uint64>(0)) {
+        if( m_block_size.x() <= 0 || m_block_size.y() <= 0 )
+          m_block_size = Vector2i( rsrc->cols(), rsrc->rows() );
+      }
+
+      // The queued reads need nothing from here, so only those a
+      // resource is still making into our buffers are waited for.
+      ~ResourceReadAhead() {
+        Mutex::Lock lock( m_mutex );
+        for( size_t i=0; i<m_pending.size(); ++i ) discard( m_pending[i] );
+        for( size_t i=0; i<m_prefetched.size(); ++i ) discard( m_prefetched[i] );
+        for( size_t i=0; i<m_draining.size(); ++i ) m_draining[i]->done.wait();
+      }
+
+      // Serves bbox from a block that was read ahead, if there is one.
+      // Returns false if the caller has to read it itself.
+      template <class DestT>
+      bool read( DestT const& dest, BBox2i const& bbox ) {
+        if( m_outstanding.load() == 0 ) {
+          if( m_depth > 0 ) ++m_misses;
+          return false;
+        }
+        boost::shared_ptr<Block> block;
+        {
+          Mutex::Lock lock( m_mutex );
+          block = take( m_pending, bbox );
+          if( ! block ) block = take( m_prefetched, bbox );
+          m_outstanding.store( int32( m_pending.size() + m_prefetched.size() ) );
+        }
+        if( ! block ) {
+          ++m_misses;
+          return false;
+        }
+        // If the I/O thread has not got to it yet, read it here instead.
+        if( block->state.compare_and_swap( Block::Queued, Block::Cancelled ) ) {
+          ++m_misses;
+          return false;
+        }
+        block->done.get();
+        ++m_hits;
+        crop( block->buffer, bbox - block->bbox.min() ).rasterize( dest, BBox2i(0,0,bbox.width(),bbox.height()) );
+        return true;
+      }
+
+      // Queues the blocks predicted to follow bbox, keeping those
+      // already pending and dropping the rest.
+      void schedule( BBox2i const& bbox ) {
+        if( m_depth <= 0 ) return;
+        std::vector<BBox2i> predicted;
+        predict( bbox, predicted );
+        Mutex::Lock lock( m_mutex );
+        block_list pending;
+        for( size_t i=0; i<predicted.size(); ++i ) {
+          boost::shared_ptr<Block> block;
+          for( typename block_list::iterator j=m_pending.begin(); j!=m_pending.end(); ++j ) {
+            if( (*j)->bbox == predicted[i] ) {
+              block = *j;
+              m_pending.erase( j );
+              break;
+            }
+          }
+          if( ! block ) block = start( predicted[i] );
+          pending.push_back( block );
+        }
+        for( size_t i=0; i<m_pending.size(); ++i ) discard( m_pending[i] );
+        m_pending.swap( pending );
+        m_outstanding.store( int32( m_pending.size() + m_prefetched.size() ) );
+      }
+
+      // Queues bbox to be read, unless a pending block already holds
+      // it.  Prefetched blocks are kept until they are read, except
+      // that the oldest is dropped once there are too many.
+      void prefetch( BBox2i const& bbox ) {
+        Mutex::Lock lock( m_mutex );
+        for( size_t i=0; i<m_draining.size(); ) {
+          if( m_draining[i]->done.is_ready() ) m_draining.erase( m_draining.begin()+i );
+          else ++i;
+        }
+        for( size_t i=0; i<m_pending.size(); ++i )
+          if( m_pending[i]->bbox.contains( bbox ) ) return;
+        for( size_t i=0; i<m_prefetched.size(); ++i )
+          if( m_prefetched[i]->bbox.contains( bbox ) ) return;
+        if( m_prefetched.size() >= m_prefetch_limit ) {
+          discard( m_prefetched.front() );
+          m_prefetched.erase( m_prefetched.begin() );
+        }
+        m_prefetched.push_back( start( bbox ) );
+        m_outstanding.store( int32( m_pending.size() + m_prefetched.size() ) );
+      }
+
+      ReadAheadStats stats() const {
+        ReadAheadStats result;
+        result.issued = m_issued->load();
+        result.hits = m_hits.load();
+        result.misses = m_misses.load();
+        result.wasted = m_wasted.load();
+        return result;
+      }
+    };
+
+  } // namespace detail
+
+  /// A resource read at a reduced resolution, through another
+  /// resource's read_reduced().
+  class ReducedImageResource : public SrcImageResource {
+    boost::shared_ptr<SrcImageResource> m_rsrc;
+    int32 m_factor;
+  public:
+    ReducedImageResource( boost::shared_ptr<SrcImageResource> const& resource, int32 factor )
+      : m_rsrc(resource), m_factor(factor) {
+      VW_ASSERT( factor > 0 && resource->reduced_read_factor( factor ) == factor,
+                 ArgumentErr() << "ReducedImageResource: The resource cannot be read reduced by " << factor << "." );
+    }
+
+    virtual ImageFormat format() const {
+      ImageFormat fmt = m_rsrc->format();
+      fmt.cols = 1 + (fmt.cols-1)/m_factor;
+      fmt.rows = 1 + (fmt.rows-1)/m_factor;
+      return fmt;
+    }
+
+    virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+      m_rsrc->read_reduced( buf, bbox, m_factor );
+    }
+
+    virtual bool has_block_read() const { return m_rsrc->has_block_read(); }
+    virtual Vector2i block_read_size() const {
+      Vector2i size = m_rsrc->block_read_size();
+      return Vector2i( 1 + (size.x()-1)/m_factor, 1 + (size.y()-1)/m_factor );
+    }
+
+    virtual bool has_nodata_read() const { return m_rsrc->has_nodata_read(); }
+    virtual double nodata_read() const { return m_rsrc->nodata_read(); }
+
+    int32 factor() const { return m_factor; }
+  };
+
   /// A view of an image resource.
   template <class PixelT>
   class ImageResourceView : public ImageViewBase<ImageResourceView<PixelT> >
@@ -53,6 +345,15 @@ namespace vw {
 
     ~ImageResourceView() {}
 
+    /// Returns a view of the resource reduced by factor, which must
+    /// come from the resource's reduced_read_factor().  The two views
+    /// share the lock on the resource.
+    ImageResourceView reduced( int32 factor ) const {
+      if( factor == 1 ) return *this;
+      return ImageResourceView( boost::shared_ptr<SrcImageResource>( new ReducedImageResource( m_rsrc, factor ) ),
+                                m_rsrc_mutex );
+    }
+
     /// Returns the number of columns in the image.
     inline int32 cols() const { return m_rsrc->cols(); }
 
@@ -85,14 +386,50 @@ namespace vw {
       return CropView<ImageView<PixelT> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
-      Mutex::Lock lock(*m_rsrc_mutex);
 #if VW_DEBUG_LEVEL > 1
       vw_out(VerboseDebugMessage, "image") << "ImageResourceView rasterizing bbox " << bbox << std::endl;
 #endif
-      read_image( dest, *m_rsrc, bbox );
+      boost::shared_ptr<detail::ResourceReadAhead<PixelT> > read_ahead = m_read_ahead;
+      if( ! read_ahead->read( dest, bbox ) ) {
+        Mutex::Lock lock(*m_rsrc_mutex);
+        read_image( dest, *m_rsrc, bbox );
+      }
+      read_ahead->schedule( bbox );
+    }
+
+    /// Starts reading bbox on vw_io_queue(), so that a rasterization of
+    /// a region inside it soon after finds it in memory.  A handful of
+    /// prefetched regions that nobody rasterizes are kept, after which
+    /// the oldest are dropped.
+    void prefetch( BBox2i const& bbox ) const {
+      boost::shared_ptr<detail::ResourceReadAhead<PixelT> > read_ahead = m_read_ahead;
+      read_ahead->prefetch( bbox );
+    }
+
+    /// Reads up to depth blocks ahead of each rasterization on
+    /// vw_io_queue().  The blocks are those that follow the
+    /// rasterized region in row-major order over the resource's
+    /// block_read_size() grid, which is the order block_write_image()
+    /// and BlockRasterizeView walk it in.  A depth of zero turns read-
+    /// ahead off, which is the default.  Copies of the view made
+    /// afterwards share the read-ahead state.
+    void set_read_ahead( int32 depth ) {
+      m_read_ahead.reset( new detail::ResourceReadAhead<PixelT>( m_rsrc, m_rsrc_mutex, m_planes, (std::max)( depth, 0 ) ) );
+    }
+
+    /// Reports how well read-ahead and prefetch() are doing, including
+    /// how many of the blocks they read went unused.
+    ReadAheadStats read_ahead_stats() const {
+      return m_read_ahead->stats();
     }
 
   private:
+    ImageResourceView( boost::shared_ptr<SrcImageResource> resource, boost::shared_ptr<Mutex> const& rsrc_mutex )
+      : m_rsrc( resource ), m_planes( m_rsrc->planes() ), m_rsrc_mutex( rsrc_mutex )
+    {
+      initialize();
+    }
+
     void initialize() {
       // If the user has requested a multi-channel pixel type, but the
       // file is a multi-plane, scalar-pixel file, we force a single-plane
@@ -107,13 +444,58 @@ namespace vw {
       if (IsScalar<PixelT>::value  && m_rsrc->channels() >= 1 && m_rsrc->planes() == 1) {
         m_planes = m_rsrc->channels();
       }
+
+      set_read_ahead( 0 );
     }
 
     boost::shared_ptr<SrcImageResource> m_rsrc;
     int32 m_planes;
     boost::shared_ptr<Mutex> m_rsrc_mutex;
+    boost::shared_ptr<detail::ResourceReadAhead<PixelT> > m_read_ahead;
+  };
+
+  /// Counts the buffer prerasterize() reads the region into.
+  template <class PixelT>
+  class RasterizeFootprint<ImageResourceView<PixelT> > {
+  public:
+    RasterizeFootprint( ImageResourceView<PixelT> const& /*view*/ ) {}
+    size_t operator()( BBox2i const& bbox ) const { return raster_bytes<PixelT>( bbox, 1 ); }
+  };
+
+  /// Reads the region on vw_io_queue().
+  template <class PixelT>
+  class RasterizePrefetch<ImageResourceView<PixelT> > {
+    ImageResourceView<PixelT> const& m_view;
+  public:
+    RasterizePrefetch( ImageResourceView<PixelT> const& view ) : m_view(view) {}
+    void operator()( BBox2i const& bbox ) const { m_view.prefetch( bbox ); }
   };
 
+  namespace detail {
+    // The largest factor the resource can read itself reduced by that
+    // divides both subsampling factors.
+    inline int32 reduced_subsample_factor( SrcImageResource const& rsrc, int32 xfactor, int32 yfactor ) {
+      int32 factor = rsrc.reduced_read_factor( (std::min)( xfactor, yfactor ) );
+      while( factor > 1 && ( xfactor % factor || yfactor % factor ) )
+        factor = rsrc.reduced_read_factor( factor-1 );
+      return factor;
+    }
+  }
+
+  /// Subsamples a resource view, reading the resource at a reduced
+  /// resolution where it can.  Those pixels summarize the ones they
+  /// replace rather than being every Nth one.
+  template <class PixelT>
+  inline SubsampleView<ImageResourceView<PixelT> > subsample( ImageResourceView<PixelT> const& v, int32 xfactor, int32 yfactor ) {
+    int32 factor = detail::reduced_subsample_factor( *v.resource(), xfactor, yfactor );
+    return SubsampleView<ImageResourceView<PixelT> >( v.reduced( factor ), xfactor/factor, yfactor/factor );
+  }
+
+  template <class PixelT>
+  inline SubsampleView<ImageResourceView<PixelT> > subsample( ImageResourceView<PixelT> const& v, int32 subsampling_factor ) {
+    return subsample( v, subsampling_factor, subsampling_factor );
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGERESOURCEVIEW_H__
@@ -12,11 +12,16 @@
 #ifndef __VW_IMAGE_IMAGEVIEW_H__
 #define __VW_IMAGE_IMAGEVIEW_H__
 
+#include <algorithm>
 #include <cstring> // For memset()
+#include <memory>
 
 #include <boost/smart_ptr.hpp>
 #include <boost/type_traits.hpp>
 
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/CacheSpill.h>
+#include <vw/Core/System.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/PixelAccessors.h>
@@ -50,6 +55,30 @@ namespace vw {
     int32 m_cols, m_rows, m_planes;
     PixelT *m_origin;
     ssize_t m_cstride, m_rstride, m_pstride;
+    int32 m_row_alignment;
+
+    // Frees a row-aligned buffer, whose first pixel sits partway into
+    // the allocation.
+    class AlignedDeleter {
+      char* m_buffer;
+      size_t m_count, m_bytes;
+      BufferPool* m_pool;
+    public:
+      AlignedDeleter( char* buffer, size_t count, size_t bytes, BufferPool* pool )
+        : m_buffer(buffer), m_count(count), m_bytes(bytes), m_pool(pool) {}
+      void operator()( PixelT* pixels ) const {
+        for( size_t i=0; i<m_count; ++i ) pixels[i].~PixelT();
+        if( m_pool ) m_pool->deallocate( m_buffer, m_bytes );
+        else delete[] m_buffer;
+      }
+    };
+
+    // Returns how far into buffer the first address that is a
+    // multiple of alignment lies, or zero if alignment is zero.
+    static size_t aligned_offset( char const* buffer, size_t alignment ) {
+      if( alignment == 0 ) return 0;
+      return ( alignment - reinterpret_cast<size_t>( buffer ) % alignment ) % alignment;
+    }
 
   public:
     /// The base type of the image.
@@ -67,7 +96,7 @@ namespace vw {
     /// Constructs an empty image with zero size.
     ImageView()
       : m_cols(0), m_rows(0), m_planes(0), m_origin(0), m_cstride(0),
-        m_rstride(0), m_pstride(0) {}
+        m_rstride(0), m_pstride(0), m_row_alignment(0) {}
 
     /// Copy-constructs a view pointing to the same data.
     /// Provided explicitly to clarify its precedence over
@@ -77,27 +106,56 @@ namespace vw {
         m_data(other.m_data), m_cols(other.m_cols),
         m_rows(other.m_rows), m_planes(other.m_planes),
         m_origin(other.m_origin), m_cstride(other.m_cstride),
-        m_rstride(other.m_rstride), m_pstride(other.m_pstride) {}
+        m_rstride(other.m_rstride), m_pstride(other.m_pstride),
+        m_row_alignment(other.m_row_alignment) {}
 
     /// Constructs an empty image with the given dimensions.
     ImageView( int32 cols, int32 rows, int32 planes=1 )
       : m_cols(0), m_rows(0), m_planes(0), m_origin(0), m_cstride(0),
-        m_rstride(0), m_pstride(0) {
+        m_rstride(0), m_pstride(0), m_row_alignment(0) {
       set_size( cols, rows, planes );
     }
 
+    /// Constructs an empty image with the given dimensions whose rows
+    /// each start on a multiple of row_alignment bytes.
+    /// \see set_size
+    ImageView( int32 cols, int32 rows, int32 planes, int32 row_alignment )
+      : m_cols(0), m_rows(0), m_planes(0), m_origin(0), m_cstride(0),
+        m_rstride(0), m_pstride(0), m_row_alignment(0) {
+      set_size( cols, rows, planes, row_alignment );
+    }
+
+    /// Constructs a view of pixels that are already in memory, packed
+    /// the way set_size() lays them out.  The view shares data the
+    /// way a copy does, so the pixels are released by data's deleter
+    /// when the last view of them goes away.
+    ImageView( boost::shared_array<PixelT> const& data, int32 cols, int32 rows, int32 planes=1 )
+      : m_data(data), m_cols(cols), m_rows(rows), m_planes(planes), m_origin(data.get()),
+        m_cstride(1), m_rstride(cols), m_pstride(ssize_t(cols)*rows), m_row_alignment(0) {}
+
+    /// Constructs a view of pixels that are already in memory, starting
+    /// at origin with the given strides (in pixels), e.g. a matrix
+    /// from another library with padded rows.  The view shares data,
+    /// which must own the memory origin points into, as above.
+    ImageView( boost::shared_array<PixelT> const& data, PixelT* origin, int32 cols, int32 rows, int32 planes,
+               ssize_t cstride, ssize_t rstride, ssize_t pstride )
+      : m_data(data), m_cols(cols), m_rows(rows), m_planes(planes), m_origin(origin),
+        m_cstride(cstride), m_rstride(rstride), m_pstride(pstride), m_row_alignment(0) {}
+
     /// Constructs an image view and rasterizes the given view into it.
     template <class ViewT>
     ImageView( ViewT const& view )
       : m_cols(0), m_rows(0), m_planes(0), m_origin(0), m_cstride(0),
-        m_rstride(0), m_pstride(0) {
+        m_rstride(0), m_pstride(0), m_row_alignment(0) {
       set_size( view.cols(), view.rows(), view.planes() );
       view.rasterize( *this, BBox2i(0,0,view.cols(),view.rows()) );
     }
 
     /// Note that this is almost a copy of read_image in ImageIO, but actually
     /// including that is a circular dependency.
-    explicit ImageView( const SrcImageResource& src ) {
+    explicit ImageView( const SrcImageResource& src )
+      : m_cols(0), m_rows(0), m_planes(0), m_origin(0), m_cstride(0),
+        m_rstride(0), m_pstride(0), m_row_alignment(0) {
       int32 planes = 1;
       if( ! IsCompound<PixelT>::value ) {
         // The image has a fundamental pixel type
@@ -152,14 +210,30 @@ namespace vw {
       return *(m_origin + col*m_cstride + row*m_rstride + plane*m_pstride);
     }
 
-    /// Adjusts the size of the image, allocating a new buffer if the size has changed.
+    /// Adjusts the size of the image, allocating a new buffer if the
+    /// size has changed.  The image keeps the row alignment it was
+    /// last given.
     void set_size( int32 cols, int32 rows, int32 planes = 1 ) {
+      set_size( cols, rows, planes, m_row_alignment );
+    }
+
+    /// Adjusts the size of the image and the alignment of its rows,
+    /// allocating a new buffer if either has changed.  With a nonzero
+    /// row_alignment, which must be a power of two, every row starts
+    /// on a multiple of that many bytes and the row stride is padded
+    /// to match, which is what SIMD kernels and cache-line-sized row
+    /// access want.  A row_alignment of zero gives the default packed
+    /// layout, where the row stride equals the width.  The padding is
+    /// never part of the image: the pixel accessors, crop() and
+    /// select_plane() all follow the strides, and buffer() reports
+    /// them to the I/O layer.
+    void set_size( int32 cols, int32 rows, int32 planes, int32 row_alignment ) {
       // if none of cols, rows, or planes are larger than this, the
       // product of the three cannot overflow a 64-bit signed number
       // 2^26 * 2^26 * 2^10  = 2^62 < 2^63-1
       static const int32 MAX_PIXEL_SIZE  = 1<<26;
       static const int32 MAX_PLANE_COUNT = 1<<10;
-      if( cols==m_cols && rows==m_rows && planes==m_planes ) return;
+      if( cols==m_cols && rows==m_rows && planes==m_planes && row_alignment==m_row_alignment ) return;
 
       // This check can go away when the ImageViewBase classes handle these as unsigned
       VW_ASSERT(cols >= 0 && rows >= 0 && planes >= 0,
@@ -172,7 +246,20 @@ namespace vw {
       VW_ASSERT(planes < MAX_PLANE_COUNT,
           ArgumentErr() << "Refusing to allocate an image with more than " << MAX_PLANE_COUNT-1 << " planes on a side (you requested " << planes << ")");
 
-      uint64 size64 = uint64(cols) * uint64(rows) * uint64(planes);
+      VW_ASSERT(row_alignment >= 0 && (row_alignment & (row_alignment-1)) == 0,
+          ArgumentErr() << "Image row alignment must be zero or a power of two (you requested " << row_alignment << ")");
+
+      // Rows are padded to the smallest whole number of pixels that
+      // is also a multiple of the alignment.
+      ssize_t align_pixels = 1;
+      if( row_alignment > 0 ) {
+        size_t g = row_alignment;
+        for( size_t b = sizeof(PixelT); b != 0; ) { size_t t = g % b; g = b; b = t; }
+        align_pixels = row_alignment / g;
+      }
+      ssize_t rstride = ( (cols + align_pixels - 1) / align_pixels ) * align_pixels;
+
+      uint64 size64 = uint64(rstride) * uint64(rows) * uint64(planes);
 
       // This might trip on 32-bit platforms
       VW_ASSERT(size64 < std::numeric_limits<size_t>::max(),
@@ -180,10 +267,48 @@ namespace vw {
 
       size_t size = size64;
 
+      // An aligned image gets row_alignment bytes of slack, and its
+      // first pixel goes at the first aligned address in the buffer.
+      // The pixels can then start anywhere, not only at a multiple of
+      // sizeof(PixelT) from the start of the allocation, so the first
+      // row is aligned whatever alignment the allocator gives.
+      size_t slack = 0;
+      if( row_alignment > 0 )
+        slack = (std::max)( size_t(row_alignment), size_t(boost::alignment_of<PixelT>::value) );
+      size_t bytes = size*sizeof(PixelT) + slack;
+
+      // Large buffers of plain pixel types come from vw_buffer_pool()
+      // when it is enabled.  Those pixels are zero-initialized, so
+      // clearing the reused memory gives the same result as new[].
+      bool cleared = false;
       if( size==0 )
         m_data.reset();
       else {
-        boost::shared_array<PixelT> data( new (std::nothrow) PixelT[size] );
+        boost::shared_array<PixelT> data;
+        BufferPool& pool = vw_buffer_pool();
+        bool plain = boost::is_arithmetic<typename CompoundChannelType<PixelT>::type>::value &&
+                     boost::has_trivial_destructor<PixelT>::value;
+        if( plain && pool.pooled( bytes ) ) {
+          char* buffer = static_cast<char*>( pool.allocate( bytes ) );
+          if( buffer ) {
+            PixelT* pixels = reinterpret_cast<PixelT*>( buffer + aligned_offset( buffer, slack ) );
+            memset( pixels, 0, size*sizeof(PixelT) );
+            if( slack ) data.reset( pixels, AlignedDeleter( buffer, 0, bytes, &pool ) );
+            else        data.reset( pixels, BufferPool::Deleter( pool, bytes ) );
+            cleared = true;
+          }
+        }
+        else if( slack ) {
+          char* buffer = new (std::nothrow) char[bytes];
+          if( buffer ) {
+            PixelT* pixels = reinterpret_cast<PixelT*>( buffer + aligned_offset( buffer, slack ) );
+            std::uninitialized_fill( pixels, pixels+size, PixelT() );
+            data.reset( pixels, AlignedDeleter( buffer, size, bytes, 0 ) );
+            cleared = true;
+          }
+        }
+        else
+          data.reset( new (std::nothrow) PixelT[size] );
         if (!data) {
           // print it and throw it for the benefit of OSX, which doesn't print the exception what() on terminate()
           vw_out(ErrorMessage)   << "Cannot allocate enough memory for a " << cols << "x" << rows << "x" << planes << " image: too many bytes!" << std::endl;
@@ -197,8 +322,9 @@ namespace vw {
       m_planes = planes;
       m_origin = m_data.get();
       m_cstride = 1;
-      m_rstride = cols;
-      m_pstride = rows*cols;
+      m_rstride = rstride;
+      m_pstride = rows*rstride;
+      m_row_alignment = row_alignment;
 
       // Fundamental types might not be initialized.  Really this is
       // true of all POD types, but there's no good way to detect
@@ -208,8 +334,8 @@ namespace vw {
       // Note that this is a copy of the fill algorithm that resides
       // in ImageAlgorithms.h, however including ImageAlgorithms.h
       // directly causes an include file cycle.
-      if( boost::is_fundamental<pixel_type>::value ) {
-        memset( m_data.get(), 0, m_rows*m_cols*m_planes*sizeof(PixelT) );
+      if( boost::is_fundamental<pixel_type>::value && !cleared ) {
+        memset( m_data.get(), 0, size*sizeof(PixelT) );
       }
     }
 
@@ -227,11 +353,35 @@ namespace vw {
       m_cstride = m_rstride = m_pstride = 0;
     }
 
+    /// Returns the byte alignment of the image rows, or zero if the
+    /// image uses the packed layout.
+    int32 row_alignment() const { return m_row_alignment; }
+
+    /// Returns true if the pixels of every row and plane follow each
+    /// other in memory with no padding, so that data() addresses
+    /// cols()*rows()*planes() consecutive pixels.
+    bool contiguous() const {
+      return m_cstride == 1 && m_rstride == m_cols && m_pstride == m_rstride*m_rows;
+    }
+
     /// Returns a pointer to the origin of the image in memory.
     pixel_type *data() const {
       return m_origin;
     }
 
+    /// Returns a view of rows [row,row+rows) that shares this image's
+    /// memory, the way a copy does.  For single-plane images the band
+    /// has the layout of an image of that size, so it can stand in
+    /// for one as a rasterization destination.
+    ImageView row_band( int32 row, int32 rows ) const {
+      VW_ASSERT( row >= 0 && rows >= 0 && row + rows <= m_rows,
+                 ArgumentErr() << "ImageView::row_band: rows [" << row << "," << row+rows << ") are out of bounds." );
+      ImageView band( *this );
+      band.m_rows = rows;
+      band.m_origin = m_origin + row*m_rstride;
+      return band;
+    }
+
     /// A safe bool conversion intermediate type.
     typedef typename boost::shared_array<PixelT>::unspecified_bool_type unspecified_bool_type;
     /// Evaluates to true in a bool context if this ImageView points
@@ -254,8 +404,8 @@ namespace vw {
       buffer.data = data();
       buffer.format = base_type::format();
       buffer.cstride = sizeof(PixelT);
-      buffer.rstride = sizeof(PixelT)*cols();
-      buffer.pstride = sizeof(PixelT)*cols()*rows();
+      buffer.rstride = sizeof(PixelT)*m_rstride;
+      buffer.pstride = sizeof(PixelT)*m_pstride;
       return buffer;
     }
 
@@ -271,6 +421,13 @@ namespace vw {
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
       vw::rasterize( prerasterize(bbox), dest, bbox );
     }
+
+    /// Copies pixels [col_begin,col_end) of a row into dest.
+    /// \see HasRowSpan
+    inline void rasterize_row( PixelT* dest, int32 row, int32 col_begin, int32 col_end, int32 plane=0 ) const {
+      PixelT const* src = m_origin + col_begin*m_cstride + row*m_rstride + plane*m_pstride;
+      std::copy( src, src + (col_end - col_begin), dest );
+    }
   };
 
   // Image view traits
@@ -282,6 +439,41 @@ namespace vw {
   template <class PixelT>
   struct IsMultiplyAccessible<ImageView<PixelT> > : public true_type {};
 
+  /// Specifies that ImageView objects can copy out spans of a row.
+  template <class PixelT>
+  struct HasRowSpan<ImageView<PixelT> > : public true_type {};
+
+  /// Lets a cache with a spill tier write evicted ImageView blocks to
+  /// disk.  The pixels are stored as raw memory, so this is only
+  /// enabled for pixel types made of plain numeric channels.
+  template <class PixelT>
+  struct CacheSpillTraits<ImageView<PixelT> > {
+    static const bool value = boost::is_arithmetic<typename CompoundChannelType<PixelT>::type>::value;
+
+    static void write( std::ostream& os, ImageView<PixelT> const& image ) {
+      int32 dims[3] = { image.cols(), image.rows(), image.planes() };
+      os.write( reinterpret_cast<const char*>(dims), sizeof(dims) );
+      if( image.contiguous() )
+        os.write( reinterpret_cast<const char*>(image.data()),
+                  sizeof(PixelT) * size_t(dims[0]) * dims[1] * dims[2] );
+      else
+        for( int32 p=0; p<dims[2]; ++p )
+          for( int32 r=0; r<dims[1]; ++r )
+            os.write( reinterpret_cast<const char*>(&image(0,r,p)), sizeof(PixelT) * size_t(dims[0]) );
+    }
+
+    static boost::shared_ptr<ImageView<PixelT> > read( std::istream& is ) {
+      int32 dims[3];
+      if( ! is.read( reinterpret_cast<char*>(dims), sizeof(dims) ) )
+        return boost::shared_ptr<ImageView<PixelT> >();
+      boost::shared_ptr<ImageView<PixelT> > image( new ImageView<PixelT>( dims[0], dims[1], dims[2] ) );
+      if( ! is.read( reinterpret_cast<char*>(image->data()),
+                     sizeof(PixelT) * size_t(dims[0]) * dims[1] * dims[2] ) )
+        return boost::shared_ptr<ImageView<PixelT> >();
+      return image;
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGEVIEW_H__
@@ -116,6 +116,19 @@ namespace vw {
   template <class ImplT>
   struct IsMultiplyAccessible : public false_type {};
 
+  /// Indicates whether a view can rasterize a run of pixels from one
+  /// row straight into memory.  Such views provide
+  ///
+  ///   void rasterize_row( pixel_type* dest, int32 row,
+  ///                       int32 col_begin, int32 col_end, int32 plane=0 ) const;
+  ///
+  /// which writes pixels [col_begin,col_end) of the given row and
+  /// plane to dest, and must be usable without prerasterize().
+  /// Per-pixel views of such views use this to evaluate whole
+  /// expressions a span at a time instead of one pixel at a time.
+  template <class ImplT>
+  struct HasRowSpan : public false_type {};
+
 
   // *******************************************************************
   // Pixel iteration functions
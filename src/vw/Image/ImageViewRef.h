@@ -28,6 +28,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
@@ -45,6 +46,7 @@ namespace vw {
     virtual void prev_plane() = 0;
     virtual void advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) = 0;
     virtual PixelT operator*() const = 0;
+    virtual void read_span( PixelT* dest, ssize_t n ) const = 0;
   };
 
   template <class IterT>
@@ -71,12 +73,20 @@ namespace vw {
       m_iter.advance((iter_offset_type)di,(iter_offset_type)dj,dp);
     }
     virtual pixel_type operator*() const { return *m_iter; }
+    virtual void read_span( pixel_type* dest, ssize_t n ) const {
+      IterT iter = m_iter;
+      for( ssize_t i=0; i<n; ++i, iter.next_col() )
+        dest[i] = *iter;
+    }
   };
   /// \endcond
 
   /// A special virtualized accessor adaptor.
   ///
   /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
+  /// Each move and dereference is a virtual call, so code that reads
+  /// runs of pixels should use read_span(), which copies a whole row
+  /// segment with a single virtual call.
   template <class PixelT>
   class ImageViewRefAccessor {
   private:
@@ -90,7 +100,7 @@ namespace vw {
     ~ImageViewRefAccessor() {}
 
     ImageViewRefAccessor( ImageViewRefAccessor const& other ) : m_iter( other.m_iter->copy() ) {}
-    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { m_iter = other.m_iter->copy(); }
+    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { m_iter.reset( other.m_iter->copy() ); return *this; }
 
     inline ImageViewRefAccessor& next_col() { m_iter->next_col(); return *this; }
     inline ImageViewRefAccessor& prev_col() { m_iter->prev_col(); return *this; }
@@ -98,8 +108,12 @@ namespace vw {
     inline ImageViewRefAccessor& prev_row() { m_iter->prev_row(); return *this; }
     inline ImageViewRefAccessor& next_plane() { m_iter->next_plane(); return *this; }
     inline ImageViewRefAccessor& prev_plane() { m_iter->prev_plane(); return *this; }
-    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { m_iter->advance(di,dj,dp=0); return *this; }
+    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { m_iter->advance(di,dj,dp); return *this; }
     inline pixel_type operator*() const { return *(*m_iter); }
+
+    /// Copies the n pixels starting here and running along the row
+    /// into dest.  The accessor itself does not move.
+    inline void read_span( pixel_type* dest, ssize_t n ) const { m_iter->read_span(dest,n); }
   };
 
 
@@ -121,7 +135,9 @@ namespace vw {
     virtual pixel_accessor origin() const = 0;
 
     virtual bool sparse_check( BBox2i const& bbox ) const = 0;
+    virtual size_t rasterize_bytes( BBox2i const& bbox ) const = 0;
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i bbox ) const = 0;
+    virtual void rasterize( CropView<ImageView<pixel_type> > const& dest, BBox2i bbox ) const = 0;
   };
 
   // ImageViewRef class implementation
@@ -144,7 +160,9 @@ namespace vw {
     virtual pixel_accessor origin() const { return m_view.origin(); }
 
     virtual bool sparse_check( BBox2i const& bbox ) const { return vw::sparse_check( m_view, bbox ); }
+    virtual size_t rasterize_bytes( BBox2i const& bbox ) const { return RasterizeFootprint<ViewT>( m_view )( bbox ); }
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i bbox ) const { m_view.rasterize( dest, bbox ); }
+    virtual void rasterize( CropView<ImageView<pixel_type> > const& dest, BBox2i bbox ) const { m_view.rasterize( dest, bbox ); }
 
     ViewT const& child() const { return m_view; }
   };
@@ -161,6 +179,11 @@ namespace vw {
   /// function call per method invocation.  In many cases there
   /// are additional costs associated with not being able to
   /// perform template-based optimizations at compile time.
+  /// Rasterizing a region costs a single virtual call, which hands
+  /// the whole bounding box to the bound view's own rasterize;
+  /// this holds for ImageView destinations and for crops of them,
+  /// such as the blocks written by block_rasterize.  Reading pixel
+  /// by pixel through the accessor pays a virtual call per pixel.
   ///
   /// Like any C++ reference, you bind an ImageViewRef to a view
   /// using a constructor and future operations act on the bound
@@ -199,6 +222,13 @@ namespace vw {
 
     inline bool sparse_check( BBox2i const& bbox ) const { return m_view->sparse_check(bbox); }
 
+    /// The temporary memory prerasterizing bbox allocates; see
+    /// estimate_rasterize_bytes().
+    inline size_t rasterize_bytes( BBox2i const& bbox ) const {
+      if( dynamic_cast<ImageViewRefImpl<ImageView<PixelT> >*>( m_view.get() ) ) return 0;
+      return raster_bytes<PixelT>( bbox, planes() ) + m_view->rasterize_bytes(bbox);
+    }
+
     /// \cond INTERNAL
     typedef CropView<ImageView<PixelT> > prerasterize_type;
 
@@ -223,6 +253,12 @@ namespace vw {
     inline void rasterize( ImageView<PixelT> const& dest, BBox2i bbox ) const {
       m_view->rasterize( dest, bbox );
     }
+
+    // The same for a cropped ImageView, which is what block-wise
+    // rasterization hands each block.
+    inline void rasterize( CropView<ImageView<PixelT> > const& dest, BBox2i bbox ) const {
+      m_view->rasterize( dest, bbox );
+    }
     /// \endcond
   };
 
@@ -236,6 +272,16 @@ namespace vw {
     }
   };
 
+  template <class PixelT>
+  class RasterizeFootprint<ImageViewRef<PixelT> > {
+    ImageViewRef<PixelT> const& image;
+  public:
+    RasterizeFootprint(ImageViewRef<PixelT> const& image) : image(image) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return image.rasterize_bytes(bbox);
+    }
+  };
+
 
 } // namespace vw
 
@@ -18,6 +18,8 @@
 #ifndef __VW_IMAGE_INTERPOLATION_H__
 #define __VW_IMAGE_INTERPOLATION_H__
 
+#include <limits>
+
 #include <boost/type_traits.hpp>
 #include <boost/mpl/logical.hpp>
 #include <boost/utility/enable_if.hpp>
@@ -25,7 +27,9 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
 #include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
@@ -59,12 +63,153 @@ namespace vw {
     };
   };
 
+  namespace detail {
+
+    // Fixed-point interpolation of 8- and 16-bit integer images.
+    // Weights carry `bits' fractional bits and the sums fit in
+    // accum_type, so the result needs only one rounding shift.
+    template <class ChannelT> struct FixedPointInterpolationTraits {
+      static const bool value = false;
+      typedef int32 accum_type;
+      static const int32 bits = 0;
+    };
+    template <> struct FixedPointInterpolationTraits<uint8> {
+      static const bool value = true;
+      typedef int32 accum_type;
+      static const int32 bits = 10;
+    };
+    template <> struct FixedPointInterpolationTraits<uint16> {
+      static const bool value = true;
+      typedef int64 accum_type;
+      static const int32 bits = 20;
+    };
+
+    // Locates the memory behind a w x h block of pixels at (x,y),
+    // for views that are backed by an ImageView.  find() returns 0,
+    // and the caller takes the general path, if the block is not
+    // entirely in memory.
+    template <class ViewT>
+    struct InterpolationFootprint {
+      static const bool value = false;
+      static typename ViewT::pixel_type const* find( ViewT const&, int32, int32, int32, int32, int32, ssize_t& ) { return 0; }
+    };
+
+    template <class PixelT>
+    struct InterpolationFootprint<ImageView<PixelT> > {
+      static const bool value = true;
+      static PixelT const* find( ImageView<PixelT> const& view, int32 x, int32 y, int32 w, int32 h, int32 p, ssize_t& rstride ) {
+        if( x < 0 || y < 0 || x+w > view.cols() || y+h > view.rows() ) return 0;
+        rstride = &view(0,1) - &view(0,0);
+        return &view(x,y,p);
+      }
+    };
+
+    // Inside its child an edge extension is the identity.
+    template <class PixelT, class ExtensionT>
+    struct InterpolationFootprint<EdgeExtensionView<ImageView<PixelT>, ExtensionT> > {
+      static const bool value = true;
+      static PixelT const* find( EdgeExtensionView<ImageView<PixelT>, ExtensionT> const& view,
+                                 int32 x, int32 y, int32 w, int32 h, int32 p, ssize_t& rstride ) {
+        return InterpolationFootprint<ImageView<PixelT> >::find( view.child(), x+view.xoffset(), y+view.yoffset(), w, h, p, rstride );
+      }
+    };
+
+    // Samples integer images straight from memory when it can.  Each
+    // function returns false when the sample has to go through the
+    // general floating-point path instead.
+    template <class ViewT, class PixelT>
+    class FixedPointInterpolation {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      typedef FixedPointInterpolationTraits<channel_type> traits;
+      typedef typename traits::accum_type accum_type;
+      typedef InterpolationFootprint<ViewT> footprint;
+      static const size_t num_channels = CompoundNumChannels<PixelT>::value;
+      static const accum_type one = accum_type(1) << traits::bits;
+
+      static inline accum_type weight( double w ) { return math::impl::_floor( w*one + 0.5 ); }
+
+      // Rounds, clamps and stores a sum carrying 2*bits fractional bits.
+      static inline channel_type finish( accum_type v ) {
+        if( v <= 0 ) return 0;
+        v = ( v + (accum_type(1) << (2*traits::bits-1)) ) >> (2*traits::bits);
+        return ( v > accum_type(std::numeric_limits<channel_type>::max()) ) ? std::numeric_limits<channel_type>::max() : channel_type(v);
+      }
+
+      // The bicubic weights of the general path, divided by two so that
+      // each set sums to one, and made to sum to exactly one after
+      // rounding.
+      static inline void cubic_weights( double t, accum_type* w ) {
+        w[0] = weight( 0.5*((2-t)*t-1)*t );
+        w[2] = weight( 0.5*((4-3*t)*t+1)*t );
+        w[3] = weight( 0.5*(t-1)*t*t );
+        w[1] = one - w[0] - w[2] - w[3];
+      }
+
+      static bool bilinear( ViewT const& view, double i, double j, int32 p, PixelT& result, boost::mpl::true_ ) {
+        int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+        ssize_t rstride;
+        PixelT const* src = footprint::find( view, x, y, 2, 2, p, rstride );
+        if( ! src ) return false;
+        accum_type wx = weight( i-x ), wy = weight( j-y );
+        channel_type const* r0 = reinterpret_cast<channel_type const*>( src );
+        channel_type const* r1 = reinterpret_cast<channel_type const*>( src + rstride );
+        channel_type* out = reinterpret_cast<channel_type*>( &result );
+        for( size_t c=0; c<num_channels; ++c ) {
+          accum_type top = r0[c]*(one-wx) + r0[num_channels+c]*wx;
+          accum_type bot = r1[c]*(one-wx) + r1[num_channels+c]*wx;
+          out[c] = finish( top*(one-wy) + bot*wy );
+        }
+        return true;
+      }
+
+      static bool bicubic( ViewT const& view, double i, double j, int32 p, PixelT& result, boost::mpl::true_ ) {
+        int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+        ssize_t rstride;
+        PixelT const* src = footprint::find( view, x-1, y-1, 4, 4, p, rstride );
+        if( ! src ) return false;
+        accum_type s[4], t[4];
+        cubic_weights( i-x, s );
+        cubic_weights( j-y, t );
+        accum_type sum[num_channels];
+        for( size_t c=0; c<num_channels; ++c ) sum[c] = 0;
+        for( int32 r=0; r<4; ++r ) {
+          channel_type const* row = reinterpret_cast<channel_type const*>( src + r*rstride );
+          for( size_t c=0; c<num_channels; ++c )
+            sum[c] += t[r] * ( s[0]*row[c] + s[1]*row[num_channels+c] + s[2]*row[2*num_channels+c] + s[3]*row[3*num_channels+c] );
+        }
+        channel_type* out = reinterpret_cast<channel_type*>( &result );
+        for( size_t c=0; c<num_channels; ++c ) out[c] = finish( sum[c] );
+        return true;
+      }
+
+      static bool bilinear( ViewT const&, double, double, int32, PixelT&, boost::mpl::false_ ) { return false; }
+      static bool bicubic( ViewT const&, double, double, int32, PixelT&, boost::mpl::false_ ) { return false; }
+
+    public:
+      // Masked pixels are left out, as their validity does not
+      // interpolate like a channel.
+      typedef boost::mpl::bool_< footprint::value && traits::value && !IsMasked<PixelT>::value &&
+                                 boost::is_same<PixelT, typename ViewT::pixel_type>::value > enabled;
+
+      static inline bool bilinear( ViewT const& view, double i, double j, int32 p, PixelT& result ) {
+        return bilinear( view, i, j, p, result, enabled() );
+      }
+      static inline bool bicubic( ViewT const& view, double i, double j, int32 p, PixelT& result ) {
+        return bicubic( view, i, j, p, result, enabled() );
+      }
+    };
+
+  } // namespace detail
+
   // This is broken out so that the implementation can be overridden
   // by pixel type.  Optimized versions go at the bottom of the file
   // for clarity.
   template <class ViewT, class PixelT = typename ViewT::pixel_type>
   struct BilinearInterpolationImpl : InterpolationBase {
     PixelT operator()( const ViewT &view, double i, double j, int32 p ) const {
+      PixelT fixed;
+      if( detail::FixedPointInterpolation<ViewT,PixelT>::bilinear( view, i, j, p, fixed ) ) return fixed;
+
       typedef typename ViewT::pixel_type pixel_type;
       typedef typename CompoundChannelType<pixel_type>::type channel_type;
       typedef typename FloatType<channel_type>::type real_type;
@@ -117,6 +262,9 @@ namespace vw {
   template <class ViewT, class PixelT = typename ViewT::pixel_type>
   struct BicubicInterpolationImpl {
     PixelT operator()( const ViewT &view, double i, double j, int32 p ) const {
+      PixelT fixed;
+      if( detail::FixedPointInterpolation<ViewT,PixelT>::bicubic( view, i, j, p, fixed ) ) return fixed;
+
       typedef typename CompoundChannelType<PixelT>::type channel_type;
       typedef typename CompoundChannelCast<PixelT,double>::type result_type;
 
@@ -286,6 +434,25 @@ namespace vw {
     }
   };
 
+  // Children that cannot be read directly are rasterized into a
+  // padded buffer first.
+  template <class ImageT, class InterpT>
+  class RasterizeFootprint<InterpolationView<ImageT, InterpT> > {
+    InterpolationView<ImageT, InterpT> const& m_view;
+  public:
+    RasterizeFootprint(InterpolationView<ImageT, InterpT> const& view)
+      : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return 0;
+      BBox2i src_bbox = bbox;
+      src_bbox.expand( InterpT::pixel_buffer );
+      size_t bytes = RasterizeFootprint<ImageT>(m_view.child())( src_bbox );
+      if( ! IsMultiplyAccessible<ImageT>::value )
+        bytes += raster_bytes<typename ImageT::pixel_type>( src_bbox, m_view.planes() );
+      return bytes;
+    }
+  };
+
   // -------------------------------------------------------------------------------
   // Functional API
   // -------------------------------------------------------------------------------
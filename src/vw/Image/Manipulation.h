@@ -40,6 +40,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/PerPixelViews.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
@@ -84,6 +85,111 @@ namespace vw {
   }
 
 
+  // *******************************************************************
+  // Axis permutations
+  // *******************************************************************
+
+  namespace detail {
+
+    // Pixel (i,j) of a view that transposes, rotates or flips its
+    // child by multiples of 90 degrees is pixel (x0 + xi*i + xj*j,
+    // y0 + yi*i + yj*j) of the child.
+    struct AxisPermutation {
+      int32 x0, xi, xj, y0, yi, yj;
+
+      AxisPermutation( int32 x0, int32 xi, int32 xj, int32 y0, int32 yi, int32 yj )
+        : x0(x0), xi(xi), xj(xj), y0(y0), yi(yi), yj(yj) {}
+
+      inline int32 x( int32 i, int32 j ) const { return x0 + xi*i + xj*j; }
+      inline int32 y( int32 i, int32 j ) const { return y0 + yi*i + yj*j; }
+
+      BBox2i child_bbox( BBox2i const& bbox ) const {
+        int32 ax = x( bbox.min().x(), bbox.min().y() ), bx = x( bbox.max().x()-1, bbox.max().y()-1 );
+        int32 ay = y( bbox.min().x(), bbox.min().y() ), by = y( bbox.max().x()-1, bbox.max().y()-1 );
+        return BBox2i( Vector2i( std::min(ax,bx), std::min(ay,by) ),
+                       Vector2i( std::max(ax,bx)+1, std::max(ay,by)+1 ) );
+      }
+    };
+
+    // Copies a cols x rows block to dst, where each step along a row
+    // of dst steps src by src_col and each row of dst steps it by
+    // src_row.  The block is halved along its longer side until the
+    // pieces are small, so that whatever the cache sizes the reads
+    // and writes of some level of pieces fit in them.
+    template <class PixelT>
+    void permute_pixels( PixelT const* src, ssize_t src_col, ssize_t src_row,
+                         PixelT* dst, ssize_t dst_row, int32 cols, int32 rows ) {
+      while( cols > 16 || rows > 16 ) {
+        if( cols >= rows ) {
+          int32 half = cols / 2;
+          permute_pixels( src, src_col, src_row, dst, dst_row, half, rows );
+          src += half * src_col;
+          dst += half;
+          cols -= half;
+        } else {
+          int32 half = rows / 2;
+          permute_pixels( src, src_col, src_row, dst, dst_row, cols, half );
+          src += half * src_row;
+          dst += half * dst_row;
+          rows -= half;
+        }
+      }
+      for( int32 j=0; j<rows; ++j, src += src_row, dst += dst_row ) {
+        PixelT const* s = src;
+        for( int32 i=0; i<cols; ++i, s += src_col )
+          dst[i] = *s;
+      }
+    }
+
+    template <class PixelT>
+    inline ssize_t row_stride( ImageView<PixelT> const& image ) {
+      return image.rows() > 1 ? &image(0,1) - &image(0,0) : 0;
+    }
+
+    // Copies the pixels in bbox of a permuted ImageView into dest,
+    // starting at the given offset.
+    template <class PixelT>
+    void permute_image( ImageView<PixelT> const& child, AxisPermutation const& m, BBox2i const& bbox,
+                        ImageView<PixelT> const& dest, Vector2i const& offset ) {
+      if( bbox.empty() ) return;
+      ssize_t rs = row_stride( child );
+      for( int32 p=0; p<dest.planes(); ++p )
+        permute_pixels( &child( m.x(bbox.min().x(),bbox.min().y()), m.y(bbox.min().x(),bbox.min().y()), p ),
+                        m.xi + m.yi*rs, m.xj + m.yj*rs,
+                        &dest(offset.x(),offset.y(),p), row_stride(dest), bbox.width(), bbox.height() );
+    }
+
+    // Permuted ImageViews are copied straight out of memory.
+    template <class PixelT>
+    inline void rasterize_permuted( ImageView<PixelT> const& child, AxisPermutation const& m,
+                                    ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+      permute_image( child, m, bbox, dest, Vector2i() );
+    }
+
+    // Rasterizes a permuted view a tile at a time.  Each tile is read
+    // from the child in one piece, with the child's own rasterize(),
+    // so that tiled and disk-backed children are read along their
+    // rows, and then permuted into place.
+    template <class ChildT>
+    void rasterize_permuted( ChildT const& child, AxisPermutation const& m,
+                             ImageView<typename ChildT::pixel_type> const& dest, BBox2i const& bbox ) {
+      static const int32 tile_size = 256;
+      ImageView<typename ChildT::pixel_type> buf;
+      for( int32 y=bbox.min().y(); y<bbox.max().y(); y+=tile_size ) {
+        for( int32 x=bbox.min().x(); x<bbox.max().x(); x+=tile_size ) {
+          BBox2i tile( x, y, std::min(tile_size, bbox.max().x()-x), std::min(tile_size, bbox.max().y()-y) );
+          BBox2i child_bbox = m.child_bbox( tile );
+          buf.set_size( child_bbox.width(), child_bbox.height(), dest.planes() );
+          child.rasterize( buf, child_bbox );
+          AxisPermutation local( m.x0 - child_bbox.min().x(), m.xi, m.xj,
+                                 m.y0 - child_bbox.min().y(), m.yi, m.yj );
+          permute_image( buf, local, tile, dest, tile.min() - bbox.min() );
+        }
+      }
+    }
+
+  } // namespace detail
+
   // *******************************************************************
   // Transpose
   // *******************************************************************
@@ -156,6 +262,9 @@ namespace vw {
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      detail::rasterize_permuted( m_child, detail::AxisPermutation( 0, 0, 1, 0, 1, 0 ), dest, bbox );
+    }
     /// \endcond
   };
 
@@ -243,6 +352,9 @@ namespace vw {
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      detail::rasterize_permuted( m_child, detail::AxisPermutation( cols()-1, -1, 0, rows()-1, 0, -1 ), dest, bbox );
+    }
     /// \endcond
   };
 
@@ -330,6 +442,9 @@ namespace vw {
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      detail::rasterize_permuted( m_child, detail::AxisPermutation( 0, 0, 1, cols()-1, -1, 0 ), dest, bbox );
+    }
     /// \endcond
   };
 
@@ -417,6 +532,9 @@ namespace vw {
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      detail::rasterize_permuted( m_child, detail::AxisPermutation( rows()-1, 0, -1, 0, 1, 0 ), dest, bbox );
+    }
     /// \endcond
   };
 
@@ -504,6 +622,9 @@ namespace vw {
       return prerasterize_type( m_child.prerasterize(child_bbox) );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    inline void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const {
+      detail::rasterize_permuted( m_child, detail::AxisPermutation( 0, 1, 0, rows()-1, 0, -1 ), dest, bbox );
+    }
     /// \endcond
   };
 
@@ -619,6 +740,7 @@ namespace vw {
     ImageT m_child;
     offset_type m_ci, m_cj;
     int32 m_di, m_dj;
+    template <class> friend class RasterizeFootprint;
 
   public:
     typedef typename ImageT::pixel_type pixel_type;
@@ -678,6 +800,16 @@ namespace vw {
 
   template <class ImageT>
   struct IsMultiplyAccessible<CropView<ImageT> > : public IsMultiplyAccessible<ImageT> {};
+
+  template <class ImageT>
+  class RasterizeFootprint<CropView<ImageT> > {
+    CropView<ImageT> const& m_view;
+  public:
+    RasterizeFootprint( CropView<ImageT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return RasterizeFootprint<ImageT>( m_view.m_child )( bbox + Vector2i( int32(m_view.m_ci), int32(m_view.m_cj) ) );
+    }
+  };
   /// \endcond
 
   /// Crop an image.
@@ -747,7 +879,9 @@ namespace vw {
     /// \cond INTERNAL
     typedef SubsampleView<typename ImageT::prerasterize_type> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-      return prerasterize_type( m_child.prerasterize(BBox2i(m_xdelta*bbox.min().x(),m_ydelta*bbox.min().y(),m_xdelta*bbox.width(),m_ydelta*bbox.height())), m_xdelta, m_ydelta );
+      // Ask only for the child pixels that are sampled, so the last
+      // row and column don't reach past the edge of the child.
+      return prerasterize_type( m_child.prerasterize(BBox2i(m_xdelta*bbox.min().x(),m_ydelta*bbox.min().y(),m_xdelta*(bbox.width()-1)+1,m_ydelta*(bbox.height()-1)+1)), m_xdelta, m_ydelta );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
@@ -133,13 +133,15 @@ namespace vw {
   /// returns an image with pixels of type T where any pixel that was
   /// marked as "invalid" in the mask is replaced with the constant
   /// pixel value passed in as value.  The value is T() by default.
+  /// Pixels are returned by value, since views such as edge_mask()
+  /// return theirs by value and a reference to the child would dangle.
   ///
   template <class PixelT>
-  class ApplyPixelMask : public ReturnFixedType<PixelT const&> {
+  class ApplyPixelMask : public ReturnFixedType<PixelT> {
     PixelT m_nodata_value;
   public:
     ApplyPixelMask( PixelT const& nodata_value ) : m_nodata_value(nodata_value) {}
-    PixelT const& operator()( PixelMask<PixelT> const& value ) const {
+    PixelT operator()( PixelMask<PixelT> const& value ) const {
       return value.valid() ? value.child() : m_nodata_value;
     }
   };
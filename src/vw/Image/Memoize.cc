@@ -0,0 +1,84 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// Memoize.cc
+///
+/// The on-disk store behind memoize().
+///
+#include <vw/config.h>
+#include <vw/Image/Memoize.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Thread.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef VW_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace {
+  // Keeps the temporary names of concurrent writers apart.
+  vw::Atomic<vw::uint64> memo_tmp_counter;
+}
+
+// FNV-1a.
+vw::uint64 vw::memo_hash( std::string const& key ) {
+  uint64 hash = 14695981039346656037ULL;
+  for( size_t i=0; i<key.size(); ++i ) {
+    hash ^= uint8( key[i] );
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string vw::memo_file_identity( std::string const& filename ) {
+  struct stat info;
+  if( stat( filename.c_str(), &info ) != 0 )
+    vw_throw( IOErr() << "memo_file_identity: cannot stat " << filename );
+  std::ostringstream oss;
+  oss << filename << ":" << uint64(info.st_size) << ":" << int64(info.st_mtime);
+  return oss.str();
+}
+
+bool vw::memo_read( std::string const& directory, std::string const& name, std::string& bytes ) {
+  std::ifstream in( (directory + "/" + name).c_str(), std::ios::binary );
+  if( ! in ) return false;
+  in.seekg( 0, std::ios::end );
+  std::streamoff size = in.tellg();
+  if( size <= 0 ) return false;
+  in.seekg( 0, std::ios::beg );
+  bytes.resize( size_t(size) );
+  return in.read( &bytes[0], size ).good();
+}
+
+bool vw::memo_write( std::string const& directory, std::string const& name, std::string const& bytes ) {
+  // Write to a name of our own, then rename it into place.
+  long pid = 0;
+#ifdef VW_HAVE_UNISTD_H
+  pid = long(getpid());
+#endif
+  std::ostringstream tmp;
+  tmp << directory << "/." << name << "." << pid << "." << memo_tmp_counter.add(1) << ".tmp";
+  std::string filename = directory + "/" + name;
+  {
+    std::ofstream out( tmp.str().c_str(), std::ios::binary | std::ios::trunc );
+    out.write( bytes.data(), bytes.size() );
+    if( ! out ) {
+      out.close();
+      std::remove( tmp.str().c_str() );
+      return false;
+    }
+  }
+  if( std::rename( tmp.str().c_str(), filename.c_str() ) != 0 ) {
+    std::remove( tmp.str().c_str() );
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,161 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Memoize.h
+///
+/// Persists the rasterized blocks of an expensive view on disk, so
+/// that a later run which builds the same view from the same inputs
+/// reads them back instead of computing them again.
+///
+/// The library cannot tell whether two views compute the same thing,
+/// so the caller has to say so with a key.  The key should name
+/// every input and parameter that affects the result: typically
+/// memo_file_identity() of each input file, followed by a signature
+/// of the expression built on them, like
+///
+/// \code
+///   std::string key = memo_file_identity( filename ) + "|transform(H=" + H_str + ")|gauss(1.5)";
+///   ImageViewRef<float> result = memoize( expensive_view, key, "/scratch/vwmemo" );
+/// \endcode
+///
+/// Blocks are handed out through vw::Cache like those of block_cache(),
+/// so within a run they live in memory; on a cache miss the block is
+/// read from the store if it is there, and computed and written to
+/// the store otherwise.  Each stored block records its full key,
+/// pixel type and region, so a hash collision or a stale file is
+/// recomputed rather than returned.  Stale blocks are never deleted
+/// by this code; clear the directory to reclaim space.
+///
+#ifndef __VW_IMAGE_MEMOIZE_H__
+#define __VW_IMAGE_MEMOIZE_H__
+
+#include <string>
+#include <sstream>
+
+#include <boost/static_assert.hpp>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/CacheSpill.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <vw/Image/BlockRasterize.h>
+
+namespace vw {
+
+  /// A 64-bit hash of a memoization key.
+  uint64 memo_hash( std::string const& key );
+
+  /// Describes a file well enough to notice that it changed: its
+  /// name, size and modification time.  Throws IOErr if the file
+  /// cannot be examined.
+  std::string memo_file_identity( std::string const& filename );
+
+  /// Reads the entry stored under name in directory.  Returns false
+  /// if there is none.
+  bool memo_read( std::string const& directory, std::string const& name, std::string& bytes );
+
+  /// Stores an entry under name in directory, replacing any entry
+  /// already there.  The entry appears atomically, so concurrent
+  /// readers (in this process or another) see either the old entry
+  /// or the new one.  Returns false if it could not be written.
+  bool memo_write( std::string const& directory, std::string const& name, std::string const& bytes );
+
+  /// A view that reads each region it is asked to rasterize from an
+  /// on-disk store, computing it from its child and storing it the
+  /// first time.  Regions are stored by their exact bounding box, so
+  /// the view only pays off when it is rasterized on a fixed grid of
+  /// blocks; memoize() sets that up.
+  template <class ImageT>
+  class MemoizedView : public ImageViewBase<MemoizedView<ImageT> > {
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef typename ImageT::pixel_type result_type;
+    typedef ProceduralPixelAccessor<MemoizedView> pixel_accessor;
+
+  private:
+    typedef CacheSpillTraits<ImageView<pixel_type> > serialize_traits;
+    BOOST_STATIC_ASSERT( serialize_traits::value );
+
+    ImageT m_child;
+    std::string m_key, m_directory, m_prefix;
+
+    std::string header( BBox2i const& bbox ) const {
+      std::ostringstream oss;
+      oss << "VWMEMO1 " << PixelFormatID<pixel_type>::value << " "
+          << ChannelTypeID<typename PixelChannelType<pixel_type>::type>::value << " "
+          << sizeof(pixel_type) << " " << planes() << " " << bbox.min().x() << " " << bbox.min().y() << " "
+          << bbox.width() << " " << bbox.height() << " " << m_key.size() << " " << m_key << "\n";
+      return oss.str();
+    }
+
+  public:
+    MemoizedView( ImageT const& child, std::string const& key, std::string const& directory )
+      : m_child( child ), m_key( key ), m_directory( directory ) {
+      std::ostringstream oss;
+      oss << std::hex << memo_hash( key ) << "_";
+      m_prefix = oss.str();
+    }
+
+    inline int32 cols() const { return m_child.cols(); }
+    inline int32 rows() const { return m_child.rows(); }
+    inline int32 planes() const { return m_child.planes(); }
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0, 0 ); }
+
+    inline result_type operator()( int32 x, int32 y, int32 p = 0 ) const { return m_child(x,y,p); }
+
+    ImageT const& child() const { return m_child; }
+    std::string const& key() const { return m_key; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> buf( bbox.width(), bbox.height(), planes() );
+      rasterize( buf, bbox );
+      return CropView<ImageView<pixel_type> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      std::ostringstream name;
+      name << m_prefix << bbox.min().x() << "_" << bbox.min().y() << "_" << bbox.width() << "_" << bbox.height() << ".vwm";
+      std::string expected = header( bbox ), bytes;
+
+      if( memo_read( m_directory, name.str(), bytes ) && bytes.compare( 0, expected.size(), expected ) == 0 ) {
+        std::istringstream is( bytes.substr( expected.size() ) );
+        boost::shared_ptr<ImageView<pixel_type> > block = serialize_traits::read( is );
+        if( block && block->cols() == bbox.width() && block->rows() == bbox.height() && block->planes() == planes() ) {
+          block->rasterize( dest, BBox2i(0,0,bbox.width(),bbox.height()) );
+          return;
+        }
+      }
+
+      ImageView<pixel_type> block( bbox.width(), bbox.height(), planes() );
+      m_child.rasterize( block, bbox );
+      std::ostringstream os;
+      os << expected;
+      serialize_traits::write( os, block );
+      if( ! memo_write( m_directory, name.str(), os.str() ) )
+        vw_out(WarningMessage, "image") << "memoize: failed to store block " << bbox << " in " << m_directory << "\n";
+      block.rasterize( dest, BBox2i(0,0,bbox.width(),bbox.height()) );
+    }
+  };
+
+  /// Wraps a view so that its blocks persist on disk across runs,
+  /// under the given key, in the given directory.  Within a run the
+  /// blocks are held in the cache like those of block_cache().  A
+  /// block_size of zero uses 256x256 blocks; a num_threads of zero
+  /// uses the default_num_threads setting.
+  template <class ImageT>
+  inline BlockRasterizeView<MemoizedView<ImageT> >
+  memoize( ImageViewBase<ImageT> const& image, std::string const& key, std::string const& directory,
+           Vector2i block_size = Vector2i(), int num_threads = 0, Cache& cache = vw_system_cache() ) {
+    if( block_size.x() <= 0 || block_size.y() <= 0 ) block_size = Vector2i(256,256);
+    return BlockRasterizeView<MemoizedView<ImageT> >( MemoizedView<ImageT>( image.impl(), key, directory ),
+                                                      block_size, num_threads, &cache );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_MEMOIZE_H__
@@ -0,0 +1,402 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file Morphology.h
+///
+/// Rank filter view classes: grayscale erosion and dilation over a
+/// rectangular window, and the median filter.  These are used by the
+/// filtering functions in \ref Filter.h.
+///
+#ifndef __VW_IMAGE_MORPHOLOGY_H__
+#define __VW_IMAGE_MORPHOLOGY_H__
+
+#include <vector>
+#include <algorithm>
+
+#include <vw/config.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/EdgeExtension.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Channel-wise minimum or maximum of two pixels.
+    template <bool DilateV>
+    struct MorphologyOp {
+      template <class PixelT>
+      static inline PixelT apply( PixelT a, PixelT const& b ) {
+        typedef typename CompoundChannelType<PixelT>::type channel_type;
+        for( size_t c=0; c<CompoundNumChannels<PixelT>::value; ++c ) {
+          channel_type& ac = compound_select_channel<channel_type&>( a, c );
+          channel_type const& bc = compound_select_channel<channel_type const&>( b, c );
+          if( DilateV ? (bc > ac) : (bc < ac) ) ac = bc;
+        }
+        return a;
+      }
+    };
+
+    // The van Herk / Gil-Werman running extremum.  Writes the extremum
+    // of each window of k consecutive elements of src (n of them,
+    // spaced src_stride apart) to dest, n-k+1 results spaced
+    // dest_stride apart.  The input is cut into blocks of k; the
+    // extremum of a window is that of a suffix of one block and a
+    // prefix of the next, so prefix and suffix scans give every
+    // window for about three comparisons per element, whatever k.
+    template <bool DilateV, class PixelT>
+    void running_extremum( PixelT const* src, ssize_t src_stride, int32 n, int32 k,
+                           PixelT* dest, ssize_t dest_stride,
+                           std::vector<PixelT>& prefix, std::vector<PixelT>& suffix ) {
+      typedef MorphologyOp<DilateV> op;
+      if( k == 1 ) {
+        for( int32 i=0; i<n; ++i ) dest[i*dest_stride] = src[i*src_stride];
+        return;
+      }
+      prefix.resize( n );
+      suffix.resize( n );
+      for( int32 i=0; i<n; ++i ) {
+        PixelT const& v = src[i*src_stride];
+        prefix[i] = ( i % k == 0 ) ? v : op::apply( prefix[i-1], v );
+      }
+      for( int32 i=n-1; i>=0; --i ) {
+        PixelT const& v = src[i*src_stride];
+        suffix[i] = ( i == n-1 || (i+1) % k == 0 ) ? v : op::apply( suffix[i+1], v );
+      }
+      for( int32 i=0; i+k<=n; ++i )
+        dest[i*dest_stride] = op::apply( suffix[i], prefix[i+k-1] );
+    }
+
+  } // namespace detail
+  /// \endcond
+
+
+  // *******************************************************************
+  // The morphology view type
+  // *******************************************************************
+
+  /// Grayscale erosion or dilation with a rectangular structuring
+  /// element.
+  ///
+  /// Each pixel becomes the channel-wise minimum (erosion) or maximum
+  /// (dilation) of the cols x rows window around it, with the window
+  /// origin at the point (ci,cj) as for the convolution views.  The
+  /// window is separable, and each axis is processed with the van
+  /// Herk / Gil-Werman algorithm, so the cost per pixel does not
+  /// depend on the window size.  Accessing individual pixels is slow,
+  /// as each access filters a whole window; rasterize instead.
+  template <class ImageT, class EdgeT, bool DilateV>
+  class MorphologyView : public ImageViewBase<MorphologyView<ImageT,EdgeT,DilateV> >
+  {
+  private:
+    ImageT m_image;
+    int32 m_ni, m_nj, m_ci, m_cj;
+    EdgeT m_edge;
+
+  public:
+    /// The pixel type of the view.
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+
+    /// The view's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<MorphologyView<ImageT, EdgeT, DilateV> > pixel_accessor;
+
+    /// Constructs a MorphologyView with the given window size and with the origin of the window located at the point (ci,cj).
+    MorphologyView( ImageT const& image, int32 cols, int32 rows, int32 ci, int32 cj, EdgeT const& edge = EdgeT() ) :
+      m_image(image), m_ni(cols), m_nj(rows), m_ci(ci), m_cj(cj), m_edge(edge) {
+      VW_ASSERT( cols > 0 && rows > 0, ArgumentErr() << "MorphologyView: Window dimensions must be positive." );
+    }
+
+    /// Constructs a MorphologyView with the given window size and with the origin of the window located at the center.
+    MorphologyView( ImageT const& image, int32 cols, int32 rows, EdgeT const& edge = EdgeT() ) :
+      m_image(image), m_ni(cols), m_nj(rows), m_ci((cols-1)/2), m_cj((rows-1)/2), m_edge(edge) {
+      VW_ASSERT( cols > 0 && rows > 0, ArgumentErr() << "MorphologyView: Window dimensions must be positive." );
+    }
+
+    /// Returns the number of columns in the image.
+    inline int32 cols() const { return m_image.cols(); }
+
+    /// Returns the number of rows in the image.
+    inline int32 rows() const { return m_image.rows(); }
+
+    /// Returns the number of planes in the image.
+    inline int32 planes() const { return m_image.planes(); }
+
+    /// Returns a pixel_accessor pointing to the top-left corner of the first plane.
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Returns the pixel at the given position in the given plane.
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<pixel_type> result( 1, 1, planes() );
+      rasterize( result, BBox2i(x,y,1,1) );
+      return result(0,0,p);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), m_image.planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >(dest,BBox2i(-bbox.min().x(),-bbox.min().y(),
+                                                          m_image.cols(), m_image.rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i bbox ) const {
+      typedef typename DestT::pixel_accessor DestAccessT;
+      BBox2i child_bbox = bbox;
+      child_bbox.min() -= Vector2i( m_ci, m_cj );
+      child_bbox.max() += Vector2i( m_ni-1-m_ci, m_nj-1-m_cj );
+      ImageView<pixel_type> src = edge_extend(m_image,child_bbox,m_edge);
+      VW_ASSERT( src.planes() == dest.planes(), ArgumentErr() << "MorphologyView: Images should have the same number of planes" );
+
+      // Rows first, into an image that is already the output width,
+      // then columns.  Both images are packed, so the row stride is
+      // the width.
+      ImageView<pixel_type> horiz( bbox.width(), src.rows(), src.planes() );
+      std::vector<pixel_type> prefix, suffix;
+      for( int32 p=0; p<src.planes(); ++p ) {
+        for( int32 y=0; y<src.rows(); ++y )
+          detail::running_extremum<DilateV>( &src(0,y,p), 1, src.cols(), m_ni,
+                                             &horiz(0,y,p), 1, prefix, suffix );
+        for( int32 x=0; x<bbox.width(); ++x )
+          detail::running_extremum<DilateV>( &horiz(x,0,p), horiz.cols(), horiz.rows(), m_nj,
+                                             &horiz(x,0,p), horiz.cols(), prefix, suffix );
+      }
+
+      DestAccessT dplane = dest.origin();
+      for( int32 p=0; p<dest.planes(); ++p ) {
+        DestAccessT drow = dplane;
+        for( int32 y=0; y<bbox.height(); ++y ) {
+          DestAccessT dcol = drow;
+          for( int32 x=0; x<bbox.width(); ++x ) {
+            *dcol = horiz(x,y,p);
+            dcol.next_col();
+          }
+          drow.next_row();
+        }
+        dplane.next_plane();
+      }
+    }
+    /// \endcond
+  };
+
+
+  // *******************************************************************
+  // The median filter view type
+  // *******************************************************************
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Finds the median of each cols x rows window of one channel
+    // of src.  The generic version selects from a copy of each
+    // window, at O(cols*rows) per pixel.
+    template <class ChannelT>
+    void median_filter_channel( ChannelT const* src, ssize_t cstride, ssize_t rstride, int32 /*src_cols*/,
+                                int32 ni, int32 nj, ChannelT* dest, ssize_t dcstride, ssize_t drstride, int32 cols, int32 rows ) {
+      std::vector<ChannelT> window( ni*nj );
+      size_t rank = window.size() / 2;
+      for( int32 y=0; y<rows; ++y ) {
+        for( int32 x=0; x<cols; ++x ) {
+          size_t n = 0;
+          for( int32 j=0; j<nj; ++j )
+            for( int32 i=0; i<ni; ++i )
+              window[n++] = src[(x+i)*cstride + (y+j)*rstride];
+          std::nth_element( window.begin(), window.begin()+rank, window.end() );
+          dest[x*dcstride + y*drstride] = window[rank];
+        }
+      }
+    }
+
+    // Adds the histogram a and subtracts r from k, over n bins.
+    inline void median_histogram_update( uint16* k, uint16 const* a, uint16 const* r, int32 n ) {
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+      for( int32 b=0; b+8<=n; b+=8 ) {
+        __m128i kv = _mm_loadu_si128( (__m128i const*)(k+b) );
+        kv = _mm_add_epi16( kv, _mm_loadu_si128( (__m128i const*)(a+b) ) );
+        kv = _mm_sub_epi16( kv, _mm_loadu_si128( (__m128i const*)(r+b) ) );
+        _mm_storeu_si128( (__m128i*)(k+b), kv );
+      }
+      for( int32 b=n&~7; b<n; ++b ) k[b] = uint16( k[b] + a[b] - r[b] );
+#else
+      for( int32 b=0; b<n; ++b ) k[b] = uint16( k[b] + a[b] - r[b] );
+#endif
+    }
+
+    // The 8-bit version is the constant-time median filter of
+    // Perreault and Hebert (IEEE TIP 16(9), 2007).  Each column keeps
+    // a histogram of its nj rows, which is slid down one row per
+    // output row; the window histogram is slid across the row by
+    // adding the entering column and subtracting the leaving one.
+    // Both updates are fixed-size histogram additions, done 8 bins at
+    // a time with SSE2 where it is enabled.  A 16-bin coarse histogram
+    // alongside the 256-bin fine one narrows the median search.
+    inline void median_filter_channel( uint8 const* src, ssize_t cstride, ssize_t rstride, int32 src_cols,
+                                       int32 ni, int32 nj, uint8* dest, ssize_t dcstride, ssize_t drstride, int32 cols, int32 rows ) {
+      if( ni*nj > 65535 ) {
+        // Counts would overflow the 16-bit bins.
+        median_filter_channel<uint8>( src, cstride, rstride, src_cols, ni, nj, dest, dcstride, drstride, cols, rows );
+        return;
+      }
+      const int32 bins = 256 + 16;
+      std::vector<uint16> columns( size_t(src_cols) * bins, 0 );
+      std::vector<uint16> kernel( bins );
+      const uint32 rank = uint32(ni*nj) / 2;
+
+      for( int32 x=0; x<src_cols; ++x ) {
+        uint16* h = &columns[x*bins];
+        for( int32 j=0; j<nj; ++j ) {
+          uint8 v = src[x*cstride + j*rstride];
+          ++h[v]; ++h[256 + (v>>4)];
+        }
+      }
+
+      for( int32 y=0; y<rows; ++y ) {
+        if( y > 0 ) {
+          for( int32 x=0; x<src_cols; ++x ) {
+            uint16* h = &columns[x*bins];
+            uint8 out = src[x*cstride + (y-1)*rstride];
+            uint8 in = src[x*cstride + (y+nj-1)*rstride];
+            --h[out]; --h[256 + (out>>4)];
+            ++h[in]; ++h[256 + (in>>4)];
+          }
+        }
+        std::fill( kernel.begin(), kernel.end(), 0 );
+        for( int32 i=0; i<ni; ++i ) {
+          uint16 const* h = &columns[i*bins];
+          for( int32 b=0; b<bins; ++b ) kernel[b] = uint16( kernel[b] + h[b] );
+        }
+        for( int32 x=0; x<cols; ++x ) {
+          if( x > 0 )
+            median_histogram_update( &kernel[0], &columns[(x+ni-1)*bins], &columns[(x-1)*bins], bins );
+          uint32 sum = 0;
+          int32 c = 0;
+          while( sum + kernel[256+c] <= rank ) sum += kernel[256 + c++];
+          int32 b = c*16;
+          while( sum + kernel[b] <= rank ) sum += kernel[b++];
+          dest[x*dcstride + y*drstride] = uint8(b);
+        }
+      }
+    }
+
+  } // namespace detail
+  /// \endcond
+
+  /// A median filter view.
+  ///
+  /// Each channel of each pixel becomes the median of that channel
+  /// over the cols x rows window around it, with the window origin
+  /// at the point (ci,cj) as for the convolution views.  For an even
+  /// number of window pixels the upper median is used.  For 8-bit
+  /// channels this uses sliding histograms, at a cost per pixel that
+  /// does not depend on the window size; other channel types select
+  /// the median from each window in turn, which is much slower for
+  /// large windows.  Accessing individual pixels is slow, as each
+  /// access filters a whole window; rasterize instead.
+  template <class ImageT, class EdgeT>
+  class MedianFilterView : public ImageViewBase<MedianFilterView<ImageT,EdgeT> >
+  {
+  private:
+    ImageT m_image;
+    int32 m_ni, m_nj, m_ci, m_cj;
+    EdgeT m_edge;
+
+  public:
+    /// The pixel type of the view.
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+
+    /// The view's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<MedianFilterView<ImageT, EdgeT> > pixel_accessor;
+
+    /// Constructs a MedianFilterView with the given window size and with the origin of the window located at the point (ci,cj).
+    MedianFilterView( ImageT const& image, int32 cols, int32 rows, int32 ci, int32 cj, EdgeT const& edge = EdgeT() ) :
+      m_image(image), m_ni(cols), m_nj(rows), m_ci(ci), m_cj(cj), m_edge(edge) {
+      VW_ASSERT( cols > 0 && rows > 0, ArgumentErr() << "MedianFilterView: Window dimensions must be positive." );
+    }
+
+    /// Constructs a MedianFilterView with the given window size and with the origin of the window located at the center.
+    MedianFilterView( ImageT const& image, int32 cols, int32 rows, EdgeT const& edge = EdgeT() ) :
+      m_image(image), m_ni(cols), m_nj(rows), m_ci((cols-1)/2), m_cj((rows-1)/2), m_edge(edge) {
+      VW_ASSERT( cols > 0 && rows > 0, ArgumentErr() << "MedianFilterView: Window dimensions must be positive." );
+    }
+
+    /// Returns the number of columns in the image.
+    inline int32 cols() const { return m_image.cols(); }
+
+    /// Returns the number of rows in the image.
+    inline int32 rows() const { return m_image.rows(); }
+
+    /// Returns the number of planes in the image.
+    inline int32 planes() const { return m_image.planes(); }
+
+    /// Returns a pixel_accessor pointing to the top-left corner of the first plane.
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Returns the pixel at the given position in the given plane.
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<pixel_type> result( 1, 1, planes() );
+      rasterize( result, BBox2i(x,y,1,1) );
+      return result(0,0,p);
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), m_image.planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >(dest,BBox2i(-bbox.min().x(),-bbox.min().y(),
+                                                          m_image.cols(), m_image.rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i bbox ) const {
+      typedef typename DestT::pixel_accessor DestAccessT;
+      typedef typename CompoundChannelType<pixel_type>::type channel_type;
+      const ssize_t num_channels = CompoundNumChannels<pixel_type>::value;
+      BBox2i child_bbox = bbox;
+      child_bbox.min() -= Vector2i( m_ci, m_cj );
+      child_bbox.max() += Vector2i( m_ni-1-m_ci, m_nj-1-m_cj );
+      ImageView<pixel_type> src = edge_extend(m_image,child_bbox,m_edge);
+      VW_ASSERT( src.planes() == dest.planes(), ArgumentErr() << "MedianFilterView: Images should have the same number of planes" );
+
+      // The channels of a pixel are stored contiguously and both
+      // images are packed, so each channel is filtered through
+      // strided pointers.
+      ImageView<pixel_type> result( bbox.width(), bbox.height(), src.planes() );
+      for( int32 p=0; p<src.planes(); ++p )
+        for( ssize_t c=0; c<num_channels; ++c )
+          detail::median_filter_channel( (channel_type const*)&src(0,0,p) + c, num_channels, src.cols()*num_channels,
+                                         src.cols(), m_ni, m_nj, (channel_type*)&result(0,0,p) + c, num_channels,
+                                         result.cols()*num_channels, bbox.width(), bbox.height() );
+
+      DestAccessT dplane = dest.origin();
+      for( int32 p=0; p<dest.planes(); ++p ) {
+        DestAccessT drow = dplane;
+        for( int32 y=0; y<bbox.height(); ++y ) {
+          DestAccessT dcol = drow;
+          for( int32 x=0; x<bbox.width(); ++x ) {
+            *dcol = result(x,y,p);
+            dcol.next_col();
+          }
+          drow.next_row();
+        }
+        dplane.next_plane();
+      }
+    }
+    /// \endcond
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_MORPHOLOGY_H__
@@ -0,0 +1,122 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file OpenCV.h
+///
+/// Adapters that share pixels between ImageViews and OpenCV matrices
+/// without copying them, for pipelines that mix Vision Workbench and
+/// OpenCV operations.  (ImageResourceOpenCV, by contrast, converts
+/// the pixels on every read and write.)
+///
+///   cv::Mat input = ...;
+///   ImageView<PixelRGB<uint8> > image = opencv_view<PixelRGB<uint8> >( input );
+///
+///   ImageView<float> result = ...;
+///   ImageViewMat<float> mat( result );
+///   cv::GaussianBlur( mat, mat, cv::Size(5,5), 1.0 );  // Blurs result in place
+///
+/// The pixel type must match the matrix type exactly, channel type
+/// and number of channels.  Note that OpenCV usually orders color
+/// channels BGR; neither adapter reorders them.
+///
+#ifndef __VW_IMAGE_OPENCV_H__
+#define __VW_IMAGE_OPENCV_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+#include <opencv/cxcore.h>
+
+namespace vw {
+
+  namespace detail {
+
+    template <class ChannelT> struct OpenCVDepth { static const int value = -1; };
+    template <> struct OpenCVDepth<uint8>   { static const int value = CV_8U; };
+    template <> struct OpenCVDepth<int8>    { static const int value = CV_8S; };
+    template <> struct OpenCVDepth<uint16>  { static const int value = CV_16U; };
+    template <> struct OpenCVDepth<int16>   { static const int value = CV_16S; };
+    template <> struct OpenCVDepth<int32>   { static const int value = CV_32S; };
+    template <> struct OpenCVDepth<float32> { static const int value = CV_32F; };
+    template <> struct OpenCVDepth<float64> { static const int value = CV_64F; };
+
+    // The deleter of an ImageView of a matrix's pixels.  It holds a
+    // reference to the matrix data for as long as the view does.
+    class OpenCVMatReference {
+      cv::Mat m_matrix;
+    public:
+      OpenCVMatReference( cv::Mat const& matrix ) : m_matrix(matrix) {}
+      template <class PixelT> void operator()( PixelT* ) const {}
+    };
+
+  } // namespace detail
+
+  /// Returns the OpenCV matrix type (e.g. CV_8UC3 for PixelRGB<uint8>)
+  /// whose elements are laid out like PixelT.
+  template <class PixelT>
+  int opencv_type() {
+    const int depth = detail::OpenCVDepth<typename CompoundChannelType<PixelT>::type>::value;
+    const int channels = int( CompoundNumChannels<PixelT>::value );
+    VW_ASSERT( depth >= 0, ArgumentErr() << "opencv_type: OpenCV has no matrices of this channel type." );
+    VW_ASSERT( channels <= CV_CN_MAX, ArgumentErr() << "opencv_type: OpenCV has no matrices of " << channels << " channels." );
+    return CV_MAKETYPE( depth, channels );
+  }
+
+  /// Returns a view of the pixels of a two-dimensional matrix, without
+  /// copying them; writes through the view change the matrix.  The
+  /// view keeps a reference to matrices that allocated their own
+  /// data, so the pixels live as long as either does.  A matrix over
+  /// user data has no reference to keep, so that data must outlive
+  /// the view.  Regions of interest work: the view follows the
+  /// matrix's row step.
+  template <class PixelT>
+  ImageView<PixelT> opencv_view( cv::Mat const& matrix ) {
+    if ( matrix.empty() ) return ImageView<PixelT>();
+    VW_ASSERT( matrix.dims == 2, ArgumentErr() << "opencv_view: The matrix must be two-dimensional." );
+    VW_ASSERT( matrix.type() == opencv_type<PixelT>() && matrix.elemSize() == sizeof(PixelT),
+               ArgumentErr() << "opencv_view: The matrix type does not match the pixel type." );
+    VW_ASSERT( matrix.step[0] % sizeof(PixelT) == 0,
+               ArgumentErr() << "opencv_view: The matrix row step is not a whole number of pixels." );
+
+    PixelT* origin = reinterpret_cast<PixelT*>( matrix.data );
+    ssize_t rstride = ssize_t( matrix.step[0] / sizeof(PixelT) );
+    boost::shared_array<PixelT> data( origin, detail::OpenCVMatReference( matrix ) );
+    return ImageView<PixelT>( data, origin, matrix.cols, matrix.rows, 1, 1, rstride, rstride * matrix.rows );
+  }
+
+  /// An OpenCV matrix over the pixels of a single-plane ImageView,
+  /// without copying them.  It holds a copy of the view, so the
+  /// pixels live at least as long as it does.  OpenCV functions that
+  /// write to it in place write to the image, unless they reallocate
+  /// the matrix for an output of another size or type.  Plain cv::Mat
+  /// copies of it share the pixels but do not hold the view, so keep
+  /// the ImageViewMat around for as long as they are used.
+  template <class PixelT>
+  class ImageViewMat : public cv::Mat {
+    ImageView<PixelT> m_image;
+
+    static size_t row_step( ImageView<PixelT> const& image ) {
+      ImageBuffer buffer = image.buffer();
+      VW_ASSERT( image.planes() <= 1, ArgumentErr() << "ImageViewMat: OpenCV matrices have a single plane." );
+      VW_ASSERT( buffer.cstride == ssize_t(sizeof(PixelT)) && buffer.rstride >= 0,
+                 ArgumentErr() << "ImageViewMat: The image's pixels must be consecutive in each row, rows top to bottom." );
+      return size_t( buffer.rstride );
+    }
+
+  public:
+    explicit ImageViewMat( ImageView<PixelT> const& image )
+      : cv::Mat( image.rows(), image.cols(), opencv_type<PixelT>(), image.data(), row_step( image ) ),
+        m_image(image) {}
+
+    /// The image whose pixels the matrix addresses.
+    ImageView<PixelT> const& image() const { return m_image; }
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_OPENCV_H__
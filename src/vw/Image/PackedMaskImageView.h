@@ -0,0 +1,502 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PackedMaskImageView.h
+///
+/// Defines an in-memory image of PixelMask pixels that stores the
+/// validity of each pixel as a single bit.
+///
+/// A PixelMask<T> carries its validity in a whole extra channel of
+/// type T, so an ImageView<PixelMask<float> > spends eight bytes on
+/// each four-byte value, and an ImageView<PixelMask<Vector2f> > spends
+/// twelve on each eight.  A PackedMaskImageView<T> holds the values in
+/// an ImageView<T> and the validity in a separate plane of 64-bit
+/// words, one bit per pixel.  It behaves like any other view of
+/// PixelMask<T> pixels.
+///
+/// The overloads of apply_mask(), copy_mask() and count_valid() below
+/// work on the mask a word at a time, so runs of 64 valid or invalid
+/// pixels cost a single test.  Converting to and from an
+/// ImageView<PixelMask<T> > does the same.
+///
+#ifndef __VW_IMAGE_PACKEDMASKIMAGEVIEW_H__
+#define __VW_IMAGE_PACKEDMASKIMAGEVIEW_H__
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/mpl/if.hpp>
+#include <boost/shared_array.hpp>
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/MaskViews.h>
+
+namespace vw {
+
+  namespace detail {
+
+    // Returns the n <= 64 mask bits of a row starting at column col,
+    // with column col in the lowest bit.
+    inline uint64 packed_mask_bits( uint64 const* row, int32 words, int32 col, int32 n ) {
+      int32 w = col >> 6, s = col & 63;
+      uint64 bits = row[w] >> s;
+      if( s && w+1 < words ) bits |= row[w+1] << (64-s);
+      return n < 64 ? bits & ((uint64(1) << n) - 1) : bits;
+    }
+
+    inline int32 packed_mask_popcount( uint64 x ) {
+      x = x - ((x >> 1) & 0x5555555555555555ULL);
+      x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+      x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+      return int32( (x * 0x0101010101010101ULL) >> 56 );
+    }
+
+  } // namespace detail
+
+  /// A reference to a pixel of a PackedMaskImageView, which reads and
+  /// writes the value and the mask bit in their separate planes.  The
+  /// mask bit is updated atomically, since neighboring pixels share a
+  /// word and may be written by different threads.
+  template <class ChildT>
+  class PackedMaskPixelReference {
+  public:
+    PackedMaskPixelReference( ChildT* value, uint64* word, uint64 bit )
+      : m_value(value), m_word(word), m_bit(bit) {}
+
+    bool valid() const { return (*m_word & m_bit) != 0; }
+
+    operator PixelMask<ChildT>() const {
+      PixelMask<ChildT> pixel( *m_value );
+      if( !valid() ) pixel.invalidate();
+      return pixel;
+    }
+
+    PackedMaskPixelReference const& operator=( PixelMask<ChildT> const& pixel ) const {
+      *m_value = pixel.child();
+      if( pixel.valid() ) __sync_fetch_and_or( m_word, m_bit );
+      else __sync_fetch_and_and( m_word, ~m_bit );
+      return *this;
+    }
+
+    PackedMaskPixelReference const& operator=( PackedMaskPixelReference const& other ) const {
+      return *this = PixelMask<ChildT>(other);
+    }
+
+  private:
+    ChildT* m_value;
+    uint64* m_word;
+    uint64 m_bit;
+  };
+
+  template <class ChildT>
+  bool is_valid( PackedMaskPixelReference<ChildT> const& pixel ) { return pixel.valid(); }
+
+  template <class ChildT>
+  bool is_transparent( PackedMaskPixelReference<ChildT> const& pixel ) { return !pixel.valid(); }
+
+  /// The pixel accessor for packed-mask images.  The writable flavor
+  /// returns a PackedMaskPixelReference while the read-only flavor
+  /// returns pixels by value.
+  template <class ChildT, bool WritableV>
+  class PackedMaskPixelAccessor {
+  public:
+    typedef PixelMask<ChildT> pixel_type;
+    typedef typename boost::mpl::if_c<WritableV, PackedMaskPixelReference<ChildT>, PixelMask<ChildT> >::type result_type;
+    typedef ssize_t offset_type;
+
+    PackedMaskPixelAccessor( ChildT* value, ssize_t rstride, uint64* words, int32 words_per_row )
+      : m_value(value), m_rstride(rstride), m_words(words), m_words_per_row(words_per_row), m_col(0) {}
+
+    inline PackedMaskPixelAccessor& next_col() { ++m_value; ++m_col; return *this; }
+    inline PackedMaskPixelAccessor& prev_col() { --m_value; --m_col; return *this; }
+    inline PackedMaskPixelAccessor& next_row() { m_value += m_rstride; m_words += m_words_per_row; return *this; }
+    inline PackedMaskPixelAccessor& prev_row() { m_value -= m_rstride; m_words -= m_words_per_row; return *this; }
+    // Packed-mask images have a single image plane.
+    inline PackedMaskPixelAccessor& next_plane() { return *this; }
+    inline PackedMaskPixelAccessor& prev_plane() { return *this; }
+    inline PackedMaskPixelAccessor& advance( offset_type di, offset_type dj, ssize_t /*dp*/=0 ) {
+      m_value += di + dj*m_rstride;
+      m_words += dj*m_words_per_row;
+      m_col += di;
+      return *this;
+    }
+
+    inline result_type operator*() const {
+      return PackedMaskPixelReference<ChildT>( m_value, m_words + (m_col >> 6), uint64(1) << (m_col & 63) );
+    }
+
+  private:
+    ChildT* m_value;
+    ssize_t m_rstride;
+    uint64* m_words;
+    int32 m_words_per_row;
+    ssize_t m_col;
+  };
+
+  /// A read-only view of a packed-mask image.  This is what a
+  /// PackedMaskImageView prerasterizes to, so that views built on top
+  /// of one see plain PixelMask values.
+  template <class ChildT>
+  class PackedMaskImageReadView : public ImageViewBase<PackedMaskImageReadView<ChildT> > {
+  public:
+    typedef PixelMask<ChildT> pixel_type;
+    typedef PixelMask<ChildT> result_type;
+    typedef PackedMaskPixelAccessor<ChildT,false> pixel_accessor;
+
+    PackedMaskImageReadView( ImageView<ChildT> const& values, boost::shared_array<uint64> const& bits, int32 words_per_row )
+      : m_values(values), m_bits(bits), m_words_per_row(words_per_row) {}
+
+    inline int32 cols() const { return m_values.cols(); }
+    inline int32 rows() const { return m_values.rows(); }
+    inline int32 planes() const { return m_values.planes(); }
+
+    inline pixel_accessor origin() const {
+      return pixel_accessor( m_values.data(), m_values.rows() > 1 ? &m_values(0,1) - &m_values(0,0) : 0,
+                             m_bits.get(), m_words_per_row );
+    }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      result_type pixel( m_values(i,j) );
+      if( !( m_bits[j*m_words_per_row + (i >> 6)] & (uint64(1) << (i & 63)) ) ) pixel.invalidate();
+      return pixel;
+    }
+
+    typedef PackedMaskImageReadView prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+
+  private:
+    ImageView<ChildT> m_values;
+    boost::shared_array<uint64> m_bits;
+    int32 m_words_per_row;
+  };
+
+  template <class ChildT>
+  struct IsMultiplyAccessible<PackedMaskImageReadView<ChildT> > : public true_type {};
+
+  /// An in-memory image of PixelMask<ChildT> pixels that stores the
+  /// values in an ImageView<ChildT> and the validity in a plane of
+  /// bits.  Like an ImageView, copying it is shallow.  Packed-mask
+  /// images always have a single plane.  New images are entirely
+  /// invalid, like a new ImageView<PixelMask<ChildT> >.
+  template <class ChildT>
+  class PackedMaskImageView : public ImageViewBase<PackedMaskImageView<ChildT> > {
+  public:
+    /// The pixel type of the image.
+    typedef PixelMask<ChildT> pixel_type;
+
+    /// Pixels are assembled from the two planes, so they are returned
+    /// by value.  Write through the pixel accessor, through
+    /// rasterization, or through set_valid() and values().
+    typedef PixelMask<ChildT> result_type;
+
+    /// The image's %pixel_accessor type.
+    typedef PackedMaskPixelAccessor<ChildT,true> pixel_accessor;
+
+    /// Constructs an empty image with zero size.
+    PackedMaskImageView() : m_words_per_row(0) {}
+
+    /// Constructs an entirely invalid image with the given dimensions.
+    PackedMaskImageView( int32 cols, int32 rows, int32 planes=1 ) : m_words_per_row(0) {
+      set_size( cols, rows, planes );
+    }
+
+    /// Constructs a packed-mask image and rasterizes the given view into it.
+    template <class ViewT>
+    PackedMaskImageView( ImageViewBase<ViewT> const& view ) : m_words_per_row(0) {
+      *this = view.impl();
+    }
+
+    /// Rasterizes the given view into the image, adjusting the size
+    /// if needed.
+    template <class ViewT>
+    PackedMaskImageView& operator=( ImageViewBase<ViewT> const& view ) {
+      set_size( view.impl().cols(), view.impl().rows(), view.impl().planes() );
+      *const_cast<PackedMaskImageView const*>(this) = view.impl();
+      return *this;
+    }
+
+    /// Rasterizes the given view into the image.  An
+    /// ImageView<PixelMask<ChildT> > is packed directly; other views
+    /// are rasterized a strip of rows at a time and then packed.
+    template <class ViewT>
+    PackedMaskImageView const& operator=( ImageViewBase<ViewT> const& view ) const {
+      VW_ASSERT( view.impl().cols()==cols() && view.impl().rows()==rows() && view.impl().planes()==planes(),
+                 ArgumentErr() << "PackedMaskImageView: Source and destination must have same dimensions." );
+      assign( view.impl() );
+      return *this;
+    }
+
+    inline int32 cols() const { return m_values.cols(); }
+    inline int32 rows() const { return m_values.rows(); }
+    inline int32 planes() const { return m_values.planes(); }
+
+    inline pixel_accessor origin() const {
+      return pixel_accessor( m_values.data(), value_rstride(), m_bits.get(), m_words_per_row );
+    }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      result_type pixel( m_values(i,j) );
+      if( !is_valid(i,j) ) pixel.invalidate();
+      return pixel;
+    }
+
+    /// Returns true if the pixel at the given position is valid.
+    inline bool is_valid( int32 i, int32 j ) const {
+      return ( m_bits[j*m_words_per_row + (i >> 6)] & (uint64(1) << (i & 63)) ) != 0;
+    }
+
+    /// Marks the pixel at the given position valid or invalid.  Like
+    /// writes through the pixel accessor this is safe to do from
+    /// several threads at once.
+    inline void set_valid( int32 i, int32 j, bool valid ) const {
+      uint64 bit = uint64(1) << (i & 63);
+      uint64* word = &m_bits[j*m_words_per_row + (i >> 6)];
+      if( valid ) __sync_fetch_and_or( word, bit );
+      else __sync_fetch_and_and( word, ~bit );
+    }
+
+    /// Returns the image holding the pixel values.  It shares memory
+    /// with this image.
+    ImageView<ChildT> const& values() const { return m_values; }
+
+    /// Returns the mask words of a row.  Bit i%64 of word i/64 is set
+    /// if pixel i is valid, and bits past the last column are zero.
+    uint64* mask_row( int32 row ) const { return m_bits.get() + row*m_words_per_row; }
+
+    /// Returns the number of mask words in each row.
+    int32 mask_words_per_row() const { return m_words_per_row; }
+
+    /// Adjusts the size of the image, allocating new planes if the
+    /// size has changed.  A reallocated image is entirely invalid.
+    void set_size( int32 cols, int32 rows, int32 planes = 1 ) {
+      VW_ASSERT( planes <= 1, ArgumentErr() << "PackedMaskImageView: Packed-mask images have a single plane." );
+      if( cols==this->cols() && rows==this->rows() && planes==this->planes() ) return;
+      m_values.set_size( cols, rows, planes );
+      m_words_per_row = (cols + 63) / 64;
+      size_t words = size_t(m_words_per_row) * rows * planes;
+      if( words == 0 ) m_bits.reset();
+      else {
+        m_bits.reset( new uint64[words] );
+        std::memset( m_bits.get(), 0, words*sizeof(uint64) );
+      }
+    }
+
+    /// Resets to an empty image with zero size.
+    void reset() {
+      m_values.reset();
+      m_bits.reset();
+      m_words_per_row = 0;
+    }
+
+    /// \cond INTERNAL
+    typedef PackedMaskImageReadView<ChildT> prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const {
+      return prerasterize_type( m_values, m_bits, m_words_per_row );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    inline void rasterize( ImageView<PixelMask<ChildT> > const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols()==bbox.width() && dest.rows()==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      for( int32 r=0; r<bbox.height(); ++r ) {
+        uint64 const* mask = mask_row( bbox.min().y()+r );
+        ChildT const* src = &m_values( bbox.min().x(), bbox.min().y()+r );
+        PixelMask<ChildT>* dst = &dest(0,r);
+        for( int32 c=0; c<bbox.width(); c+=64 ) {
+          int32 n = std::min( 64, bbox.width()-c );
+          uint64 bits = detail::packed_mask_bits( mask, m_words_per_row, bbox.min().x()+c, n );
+          for( int32 i=0; i<n; ++i ) {
+            dst[c+i] = src[c+i];
+            if( !(bits & (uint64(1) << i)) ) dst[c+i].invalidate();
+          }
+        }
+      }
+    }
+    /// \endcond
+
+  private:
+    ssize_t value_rstride() const {
+      return m_values.rows() > 1 ? &m_values(0,1) - &m_values(0,0) : 0;
+    }
+
+    // Packs rows [row, row+n) of an ImageView of masked pixels.  Only
+    // whole rows are written, so nothing else shares their words.
+    void pack_rows( ImageView<PixelMask<ChildT> > const& src, int32 row ) const {
+      for( int32 r=0; r<src.rows(); ++r ) {
+        PixelMask<ChildT> const* s = &src(0,r);
+        ChildT* d = &m_values(0,row+r);
+        uint64* mask = mask_row( row+r );
+        for( int32 w=0; w<m_words_per_row; ++w ) {
+          int32 c0 = w*64, n = std::min( 64, cols()-c0 );
+          uint64 bits = 0;
+          for( int32 i=0; i<n; ++i ) {
+            d[c0+i] = s[c0+i].child();
+            if( s[c0+i].valid() ) bits |= uint64(1) << i;
+          }
+          mask[w] = bits;
+        }
+      }
+    }
+
+    void assign( ImageView<PixelMask<ChildT> > const& view ) const {
+      pack_rows( view, 0 );
+    }
+
+    void assign( PackedMaskImageView const& view ) const {
+      if( view.m_values.data() != m_values.data() )
+        m_values = view.m_values;
+      if( view.m_bits != m_bits )
+        std::copy( view.m_bits.get(), view.m_bits.get() + size_t(m_words_per_row)*rows(), m_bits.get() );
+    }
+
+    template <class ViewT>
+    void assign( ViewT const& view ) const {
+      // Roughly a megapixel at a time, so that views which rasterize
+      // in blocks still get to do so.
+      int32 strip = std::max( 1, (1 << 20) / std::max( 1, cols() ) );
+      ImageView<PixelMask<ChildT> > buf;
+      for( int32 row=0; row<rows(); row+=strip ) {
+        int32 n = std::min( strip, rows()-row );
+        buf.set_size( cols(), n );
+        view.rasterize( buf, BBox2i(0,row,cols(),n) );
+        pack_rows( buf, row );
+      }
+    }
+
+    ImageView<ChildT> m_values;
+    boost::shared_array<uint64> m_bits;
+    int32 m_words_per_row;
+
+    template <class T, class MaskT>
+    friend PackedMaskImageView<T> copy_mask( ImageView<T> const& view, PackedMaskImageView<MaskT> const& mask );
+  };
+
+  /// Specifies that PackedMaskImageView objects are resizable.
+  template <class ChildT>
+  struct IsResizable<PackedMaskImageView<ChildT> > : public true_type {};
+
+  /// Specifies that PackedMaskImageView objects are fast to access.
+  template <class ChildT>
+  struct IsMultiplyAccessible<PackedMaskImageView<ChildT> > : public true_type {};
+
+  // *******************************************************************
+  /// count_valid(view)
+  ///
+  /// Returns the number of valid pixels in a packed-mask image,
+  /// counting a whole word of mask bits at a time.
+  ///
+  template <class ChildT>
+  size_t count_valid( PackedMaskImageView<ChildT> const& view ) {
+    size_t count = 0;
+    for( int32 r=0; r<view.rows(); ++r ) {
+      uint64 const* mask = view.mask_row(r);
+      for( int32 w=0; w<view.mask_words_per_row(); ++w )
+        count += detail::packed_mask_popcount( mask[w] );
+    }
+    return count;
+  }
+
+  // *******************************************************************
+  /// apply_mask( packed_view, value )
+  ///
+  /// The packed-mask flavor of apply_mask().  It returns the same
+  /// pixels, but rasterizing it into an ImageView copies runs of 64
+  /// valid pixels and fills runs of 64 invalid ones directly.
+  ///
+  template <class ChildT>
+  class PackedApplyMaskView : public ImageViewBase<PackedApplyMaskView<ChildT> > {
+    PackedMaskImageView<ChildT> m_view;
+    ChildT m_nodata_value;
+  public:
+    typedef ChildT pixel_type;
+    typedef ChildT result_type;
+    typedef ProceduralPixelAccessor<PackedApplyMaskView> pixel_accessor;
+
+    PackedApplyMaskView( PackedMaskImageView<ChildT> const& view, ChildT const& nodata_value )
+      : m_view(view), m_nodata_value(nodata_value) {}
+
+    inline int32 cols() const { return m_view.cols(); }
+    inline int32 rows() const { return m_view.rows(); }
+    inline int32 planes() const { return m_view.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      return m_view.is_valid(i,j) ? m_view.values()(i,j) : m_nodata_value;
+    }
+
+    /// \cond INTERNAL
+    typedef PackedApplyMaskView prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    inline void rasterize( ImageView<ChildT> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols()==bbox.width() && dest.rows()==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      for( int32 r=0; r<bbox.height(); ++r ) {
+        uint64 const* mask = m_view.mask_row( bbox.min().y()+r );
+        ChildT const* src = &m_view.values()( bbox.min().x(), bbox.min().y()+r );
+        ChildT* dst = &dest(0,r);
+        for( int32 c=0; c<bbox.width(); c+=64 ) {
+          int32 n = std::min( 64, bbox.width()-c );
+          uint64 bits = detail::packed_mask_bits( mask, m_view.mask_words_per_row(), bbox.min().x()+c, n );
+          uint64 all = n < 64 ? (uint64(1) << n) - 1 : ~uint64(0);
+          if( bits == all )
+            std::copy( src+c, src+c+n, dst+c );
+          else if( bits == 0 )
+            std::fill( dst+c, dst+c+n, m_nodata_value );
+          else
+            for( int32 i=0; i<n; ++i )
+              dst[c+i] = ( bits & (uint64(1) << i) ) ? src[c+i] : m_nodata_value;
+        }
+      }
+    }
+    /// \endcond
+  };
+
+  template <class ChildT>
+  struct IsMultiplyAccessible<PackedApplyMaskView<ChildT> > : public true_type {};
+
+  template <class ChildT>
+  PackedApplyMaskView<ChildT> apply_mask( PackedMaskImageView<ChildT> const& view, ChildT const& value ) {
+    return PackedApplyMaskView<ChildT>( view, value );
+  }
+
+  template <class ChildT>
+  PackedApplyMaskView<ChildT> apply_mask( PackedMaskImageView<ChildT> const& view ) {
+    return PackedApplyMaskView<ChildT>( view, ChildT() );
+  }
+
+  // *******************************************************************
+  /// copy_mask( image, packed_mask )
+  ///
+  /// The packed-mask flavor of copy_mask() for images already in
+  /// memory.  The result shares both the values of the image and the
+  /// mask bits of packed_mask, so no pixel is touched at all.
+  ///
+  template <class ChildT, class MaskChildT>
+  PackedMaskImageView<ChildT> copy_mask( ImageView<ChildT> const& view,
+                                         PackedMaskImageView<MaskChildT> const& mask ) {
+    VW_ASSERT( view.cols()==mask.cols() && view.rows()==mask.rows() && view.planes()==mask.planes(),
+               ArgumentErr() << "copy_mask: Image and mask must have same dimensions." );
+    PackedMaskImageView<ChildT> result;
+    result.m_values = view;
+    result.m_bits = mask.m_bits;
+    result.m_words_per_row = mask.m_words_per_row;
+    return result;
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_PACKEDMASKIMAGEVIEW_H__
@@ -12,13 +12,17 @@
 #ifndef __VW_IMAGE_PERPIXELVIEWS_H__
 #define __VW_IMAGE_PERPIXELVIEWS_H__
 
+#include <algorithm>
+
 #include <boost/type_traits.hpp>
+#include <boost/mpl/bool.hpp>
 #include <boost/mpl/logical.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/utility/result_of.hpp>
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/RasterizeFootprint.h>
 
 namespace vw {
 
@@ -61,6 +65,86 @@ namespace vw {
   template <class FuncT>
   struct IsFloatingPointIndexable<PerPixelIndexView<FuncT> > : public true_type {};
 
+  /// \cond INTERNAL
+  // Hooks that let per-pixel views of particular images and functors
+  // rasterize through hand-optimized kernels.  apply() returns false
+  // to decline, in which case the view is rasterized pixel by pixel.
+  // See ImageMathKernels.h for the specializations.
+  template <class ImageT, class FuncT, class DestT>
+  struct UnaryPerPixelKernel {
+    static inline bool apply( ImageT const&, FuncT const&, DestT const&, BBox2i const& ) { return false; }
+  };
+
+  template <class Image1T, class Image2T, class FuncT, class DestT>
+  struct BinaryPerPixelKernel {
+    static inline bool apply( Image1T const&, Image2T const&, FuncT const&, DestT const&, BBox2i const& ) { return false; }
+  };
+  /// \endcond
+
+  template <class PixelT> class ImageView;
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Per-pixel views over HasRowSpan views evaluate a row in chunks of
+    // this many pixels, so that the intermediate results of a nested
+    // expression stay in small buffers on the stack.
+    static const int32 row_span_chunk = 64;
+
+    // Reads spans of a HasRowSpan view.  Other views are rasterized into
+    // a buffer; ImageViews are read in place.
+    template <class ViewT>
+    class RowSpanReader {
+      ViewT const& m_view;
+      typename ViewT::pixel_type m_buffer[row_span_chunk];
+    public:
+      RowSpanReader( ViewT const& view ) : m_view(view) {}
+      inline typename ViewT::pixel_type const* operator()( int32 row, int32 col_begin, int32 col_end, int32 plane ) {
+        m_view.rasterize_row( m_buffer, row, col_begin, col_end, plane );
+        return m_buffer;
+      }
+    };
+
+    template <class PixelT>
+    class RowSpanReader<ImageView<PixelT> > {
+      ImageView<PixelT> const& m_view;
+    public:
+      RowSpanReader( ImageView<PixelT> const& view ) : m_view(view) {}
+      inline PixelT const* operator()( int32 row, int32 col_begin, int32 /*col_end*/, int32 plane ) {
+        return &m_view( col_begin, row, plane );
+      }
+    };
+
+    // Rasterizes a HasRowSpan view into an ImageView of the same pixel
+    // type one row at a time.  Returns false for any other combination.
+    template <class SrcT, class DestT>
+    inline bool rasterize_row_spans( SrcT const&, DestT const&, BBox2i const&, boost::mpl::false_ ) { return false; }
+
+    template <class SrcT, class PixelT>
+    inline bool rasterize_row_spans( SrcT const& src, ImageView<PixelT> const& dest, BBox2i const& bbox, boost::mpl::true_ ) {
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      for( int32 p = 0; p < src.planes(); ++p )
+        for( int32 r = 0; r < bbox.height(); ++r )
+          src.rasterize_row( &dest(0,r,p), bbox.min().y()+r, bbox.min().x(), bbox.max().x(), p );
+      return true;
+    }
+
+    template <class SrcT, class DestT>
+    inline bool rasterize_row_spans( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+      return rasterize_row_spans( src, dest, bbox, boost::mpl::false_() );
+    }
+
+    template <class SrcT, class PixelT>
+    inline bool rasterize_row_spans( SrcT const& src, ImageView<PixelT> const& dest, BBox2i const& bbox ) {
+      return rasterize_row_spans( src, dest, bbox,
+                                  boost::mpl::bool_<HasRowSpan<SrcT>::value &&
+                                                    boost::is_same<typename SrcT::pixel_type,PixelT>::value>() );
+    }
+
+  } // namespace detail
+  /// \endcond
+
   // *******************************************************************
   // UnaryPerPixelView
   // *******************************************************************
@@ -91,6 +175,7 @@ namespace vw {
   class UnaryPerPixelView : public ImageViewBase<UnaryPerPixelView<ImageT,FuncT> > {
     ImageT m_image;
     FuncT m_func;
+    template <class> friend class RasterizeFootprint;
   public:
     typedef typename boost::result_of<FuncT(typename ImageT::pixel_type)>::type result_type;
     typedef typename boost::remove_cv<typename boost::remove_reference<result_type>::type>::type pixel_type;
@@ -115,7 +200,20 @@ namespace vw {
     /// \cond INTERNAL
     typedef UnaryPerPixelView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const { return prerasterize_type( m_image.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
+      if( UnaryPerPixelKernel<ImageT,FuncT,DestT>::apply( m_image, m_func, dest, bbox ) ) return;
+      if( detail::rasterize_row_spans( *this, dest, bbox ) ) return;
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+
+    inline void rasterize_row( pixel_type* dest, int32 row, int32 col_begin, int32 col_end, int32 plane=0 ) const {
+      detail::RowSpanReader<ImageT> read( m_image );
+      for( int32 col = col_begin; col < col_end; col += detail::row_span_chunk ) {
+        int32 n = (std::min)( col_end - col, detail::row_span_chunk );
+        typename ImageT::pixel_type const* src = read( row, col, col+n, plane );
+        for( int32 i = 0; i < n; ++i ) *dest++ = m_func( src[i] );
+      }
+    }
     /// \endcond
   };
 
@@ -124,6 +222,21 @@ namespace vw {
   // be correct in all cases.  Perhaps it should be specialized there instead?
   template <class ImageT, class FuncT>
   struct IsMultiplyAccessible<UnaryPerPixelView<ImageT,FuncT> > : boost::is_reference<typename UnaryPerPixelView<ImageT,FuncT>::result_type>::type {};
+
+  // Functors that return a reference into the source pixel, such as
+  // select_channel() of a writeable view, cannot read from row spans.
+  template <class ImageT, class FuncT>
+  struct HasRowSpan<UnaryPerPixelView<ImageT,FuncT> >
+    : public boost::mpl::and_<HasRowSpan<ImageT>,
+                              boost::mpl::not_<boost::is_reference<typename UnaryPerPixelView<ImageT,FuncT>::result_type> > >::type {};
+
+  template <class ImageT, class FuncT>
+  class RasterizeFootprint<UnaryPerPixelView<ImageT,FuncT> > {
+    UnaryPerPixelView<ImageT,FuncT> const& m_view;
+  public:
+    RasterizeFootprint( UnaryPerPixelView<ImageT,FuncT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const { return RasterizeFootprint<ImageT>( m_view.m_image )( bbox ); }
+  };
   /// \endcond
 
 
@@ -163,6 +276,7 @@ namespace vw {
     Image1T m_image1;
     Image2T m_image2;
     FuncT m_func;
+    template <class> friend class RasterizeFootprint;
   public:
     typedef typename boost::result_of<FuncT(typename Image1T::pixel_type, typename Image2T::pixel_type)>::type result_type;
     typedef typename boost::remove_cv<typename boost::remove_reference<result_type>::type>::type pixel_type;
@@ -199,10 +313,41 @@ namespace vw {
     /// \cond INTERNAL
     typedef BinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
+      if( BinaryPerPixelKernel<Image1T,Image2T,FuncT,DestT>::apply( m_image1, m_image2, m_func, dest, bbox ) ) return;
+      if( detail::rasterize_row_spans( *this, dest, bbox ) ) return;
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+
+    inline void rasterize_row( pixel_type* dest, int32 row, int32 col_begin, int32 col_end, int32 plane=0 ) const {
+      detail::RowSpanReader<Image1T> read1( m_image1 );
+      detail::RowSpanReader<Image2T> read2( m_image2 );
+      for( int32 col = col_begin; col < col_end; col += detail::row_span_chunk ) {
+        int32 n = (std::min)( col_end - col, detail::row_span_chunk );
+        typename Image1T::pixel_type const* src1 = read1( row, col, col+n, plane );
+        typename Image2T::pixel_type const* src2 = read2( row, col, col+n, plane );
+        for( int32 i = 0; i < n; ++i ) *dest++ = m_func( src1[i], src2[i] );
+      }
+    }
     /// \endcond
   };
 
+  /// \cond INTERNAL
+  template <class Image1T, class Image2T, class FuncT>
+  struct HasRowSpan<BinaryPerPixelView<Image1T,Image2T,FuncT> >
+    : public boost::mpl::and_<HasRowSpan<Image1T>, HasRowSpan<Image2T> >::type {};
+
+  template <class Image1T, class Image2T, class FuncT>
+  class RasterizeFootprint<BinaryPerPixelView<Image1T,Image2T,FuncT> > {
+    BinaryPerPixelView<Image1T,Image2T,FuncT> const& m_view;
+  public:
+    RasterizeFootprint( BinaryPerPixelView<Image1T,Image2T,FuncT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return RasterizeFootprint<Image1T>( m_view.m_image1 )( bbox ) + RasterizeFootprint<Image2T>( m_view.m_image2 )( bbox );
+    }
+  };
+  /// \endcond
+
   // *******************************************************************
   // TrinaryPerPixelView
   // *******************************************************************
@@ -242,6 +387,7 @@ namespace vw {
     Image2T m_image2;
     Image3T m_image3;
     FuncT m_func;
+    template <class> friend class RasterizeFootprint;
   public:
     typedef typename boost::result_of<FuncT(typename Image1T::pixel_type, typename Image2T::pixel_type, typename Image3T::pixel_type)>::type result_type;
     typedef typename boost::remove_cv<typename boost::remove_reference<result_type>::type>::type pixel_type;
@@ -289,6 +435,19 @@ namespace vw {
     /// \endcond
   };
 
+  /// \cond INTERNAL
+  template <class Image1T, class Image2T, class Image3T, class FuncT>
+  class RasterizeFootprint<TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> > {
+    TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> const& m_view;
+  public:
+    RasterizeFootprint( TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return RasterizeFootprint<Image1T>( m_view.m_image1 )( bbox ) + RasterizeFootprint<Image2T>( m_view.m_image2 )( bbox )
+        + RasterizeFootprint<Image3T>( m_view.m_image3 )( bbox );
+    }
+  };
+  /// \endcond
+
 };
 
 #endif // __VW_IMAGE_PERPIXELVIEWS_H__
@@ -0,0 +1,314 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PlanarImageView.h
+///
+/// Defines an in-memory image type that stores each channel of a
+/// multi-channel pixel type in an image of its own.
+///
+/// An ImageView<PixelRGBA<float> > keeps its pixels interleaved, so
+/// an algorithm that only looks at one channel still pulls all four
+/// through the cache.  A PlanarImageView<PixelRGBA<float> > holds
+/// the same image as four single-channel ImageViews instead.  It
+/// behaves like any other view of PixelRGBA<float> pixels, and
+/// channel() hands out the per-channel images themselves, so
+/// channel-wise filtering and statistics touch only the data they
+/// need.
+///
+/// Assigning an ImageView of the same pixel type to a
+/// PlanarImageView, or a PlanarImageView to an ImageView, converts
+/// between the two layouts with a direct row-by-row loop.
+///
+#ifndef __VW_IMAGE_PLANARIMAGEVIEW_H__
+#define __VW_IMAGE_PLANARIMAGEVIEW_H__
+
+#include <boost/mpl/if.hpp>
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+namespace vw {
+
+  /// A reference to a pixel of a PlanarImageView, which reads and
+  /// writes its channels in their separate images.
+  template <class PixelT>
+  class PlanarPixelReference {
+  public:
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    static const size_t num_channels = CompoundNumChannels<PixelT>::value;
+
+    explicit PlanarPixelReference( channel_type* const* ptrs ) {
+      for( size_t c=0; c<num_channels; ++c ) m_ptr[c] = ptrs[c];
+    }
+
+    operator PixelT() const {
+      PixelT pixel;
+      for( size_t c=0; c<num_channels; ++c )
+        compound_select_channel<channel_type&>(pixel,c) = *m_ptr[c];
+      return pixel;
+    }
+
+    PlanarPixelReference const& operator=( PixelT const& pixel ) const {
+      for( size_t c=0; c<num_channels; ++c )
+        *m_ptr[c] = compound_select_channel<channel_type const&>(pixel,c);
+      return *this;
+    }
+
+    PlanarPixelReference const& operator=( PlanarPixelReference const& other ) const {
+      return *this = PixelT(other);
+    }
+
+  private:
+    channel_type* m_ptr[num_channels];
+  };
+
+  /// The pixel accessor for planar images.  It keeps one pointer per
+  /// channel and moves them together; the writable flavor returns a
+  /// PlanarPixelReference while the read-only flavor returns pixels
+  /// by value.
+  template <class PixelT, bool WritableV>
+  class PlanarPixelAccessor {
+  public:
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    static const size_t num_channels = CompoundNumChannels<PixelT>::value;
+
+    typedef PixelT pixel_type;
+    typedef typename boost::mpl::if_c<WritableV, PlanarPixelReference<PixelT>, PixelT>::type result_type;
+    typedef ssize_t offset_type;
+
+    PlanarPixelAccessor( ImageView<channel_type> const* channels )
+      : m_rstride(0) {
+      for( size_t c=0; c<num_channels; ++c ) m_ptr[c] = channels[c].data();
+      if( channels[0].rows() > 1 )
+        m_rstride = &channels[0](0,1) - &channels[0](0,0);
+    }
+
+    inline PlanarPixelAccessor& next_col() { for( size_t c=0; c<num_channels; ++c ) ++m_ptr[c]; return *this; }
+    inline PlanarPixelAccessor& prev_col() { for( size_t c=0; c<num_channels; ++c ) --m_ptr[c]; return *this; }
+    inline PlanarPixelAccessor& next_row() { for( size_t c=0; c<num_channels; ++c ) m_ptr[c] += m_rstride; return *this; }
+    inline PlanarPixelAccessor& prev_row() { for( size_t c=0; c<num_channels; ++c ) m_ptr[c] -= m_rstride; return *this; }
+    // Planar images have a single image plane.
+    inline PlanarPixelAccessor& next_plane() { return *this; }
+    inline PlanarPixelAccessor& prev_plane() { return *this; }
+    inline PlanarPixelAccessor& advance( offset_type di, offset_type dj, ssize_t /*dp*/=0 ) {
+      for( size_t c=0; c<num_channels; ++c ) m_ptr[c] += di + dj*m_rstride;
+      return *this;
+    }
+
+    inline result_type operator*() const { return read( boost::mpl::bool_<WritableV>() ); }
+
+  private:
+    inline result_type read( boost::mpl::true_ ) const { return PlanarPixelReference<PixelT>( m_ptr ); }
+    inline result_type read( boost::mpl::false_ ) const { return PixelT( PlanarPixelReference<PixelT>( m_ptr ) ); }
+
+    channel_type* m_ptr[num_channels];
+    ssize_t m_rstride;
+  };
+
+  namespace detail {
+
+    // Copies the rows of an interleaved image into the channel images
+    // of a planar one, and back.
+    template <class PixelT>
+    void deinterleave( ImageView<PixelT> const& src, BBox2i const& bbox,
+                       ImageView<typename CompoundChannelType<PixelT>::type> const* channels ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      const size_t n = CompoundNumChannels<PixelT>::value;
+      for( int32 r=0; r<bbox.height(); ++r ) {
+        channel_type const* s = reinterpret_cast<channel_type const*>( &src(bbox.min().x(), bbox.min().y()+r) );
+        for( size_t c=0; c<n; ++c ) {
+          channel_type* d = &channels[c](0,r);
+          for( int32 i=0; i<bbox.width(); ++i )
+            d[i] = s[i*n+c];
+        }
+      }
+    }
+
+    template <class PixelT>
+    void interleave( ImageView<typename CompoundChannelType<PixelT>::type> const* channels, BBox2i const& bbox,
+                     ImageView<PixelT> const& dest ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      const size_t n = CompoundNumChannels<PixelT>::value;
+      for( int32 r=0; r<bbox.height(); ++r ) {
+        channel_type* d = reinterpret_cast<channel_type*>( &dest(0,r) );
+        for( size_t c=0; c<n; ++c ) {
+          channel_type const* s = &channels[c](bbox.min().x(), bbox.min().y()+r);
+          for( int32 i=0; i<bbox.width(); ++i )
+            d[i*n+c] = s[i];
+        }
+      }
+    }
+
+  } // namespace detail
+
+  /// A read-only view of a planar image.  This is what a
+  /// PlanarImageView prerasterizes to, so that views built on top of
+  /// one see plain pixel values.
+  template <class PixelT>
+  class PlanarImageReadView : public ImageViewBase<PlanarImageReadView<PixelT> > {
+  public:
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    static const size_t num_channels = CompoundNumChannels<PixelT>::value;
+
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef PlanarPixelAccessor<PixelT,false> pixel_accessor;
+
+    PlanarImageReadView( ImageView<channel_type> const* channels ) {
+      for( size_t c=0; c<num_channels; ++c ) m_channels[c] = channels[c];
+    }
+
+    inline int32 cols() const { return m_channels[0].cols(); }
+    inline int32 rows() const { return m_channels[0].rows(); }
+    inline int32 planes() const { return m_channels[0].planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( m_channels ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      PixelT pixel;
+      for( size_t c=0; c<num_channels; ++c )
+        compound_select_channel<channel_type&>(pixel,c) = m_channels[c](i,j);
+      return pixel;
+    }
+
+    typedef PlanarImageReadView prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+
+  private:
+    ImageView<channel_type> m_channels[num_channels];
+  };
+
+  template <class PixelT>
+  struct IsMultiplyAccessible<PlanarImageReadView<PixelT> > : public true_type {};
+
+  /// An in-memory image that stores each channel of its pixels in a
+  /// separate single-channel ImageView.  Like an ImageView, copying
+  /// it is shallow.  Planar images always have a single plane.
+  template <class PixelT>
+  class PlanarImageView : public ImageViewBase<PlanarImageView<PixelT> > {
+  public:
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    static const size_t num_channels = CompoundNumChannels<PixelT>::value;
+
+    /// The pixel type of the image.
+    typedef PixelT pixel_type;
+
+    /// Pixels are assembled from their channels, so they are
+    /// returned by value.  Write through the pixel accessor, through
+    /// rasterization, or through channel().
+    typedef PixelT result_type;
+
+    /// The image's %pixel_accessor type.
+    typedef PlanarPixelAccessor<PixelT,true> pixel_accessor;
+
+    /// Constructs an empty image with zero size.
+    PlanarImageView() {}
+
+    /// Constructs an empty image with the given dimensions.
+    PlanarImageView( int32 cols, int32 rows, int32 planes=1 ) {
+      set_size( cols, rows, planes );
+    }
+
+    /// Constructs a planar image and rasterizes the given view into it.
+    template <class ViewT>
+    PlanarImageView( ImageViewBase<ViewT> const& view ) {
+      *this = view.impl();
+    }
+
+    /// Rasterizes the given view into the image, adjusting the size
+    /// if needed.  An ImageView of the same pixel type is split into
+    /// channels directly.
+    template <class ViewT>
+    PlanarImageView& operator=( ImageViewBase<ViewT> const& view ) {
+      set_size( view.impl().cols(), view.impl().rows(), view.impl().planes() );
+      *const_cast<PlanarImageView const*>(this) = view.impl();
+      return *this;
+    }
+
+    /// Rasterizes the given view into the image.
+    template <class ViewT>
+    PlanarImageView const& operator=( ImageViewBase<ViewT> const& view ) const {
+      assign( view.impl(), BBox2i(0,0,view.impl().cols(),view.impl().rows()) );
+      return *this;
+    }
+
+    inline int32 cols() const { return m_channels[0].cols(); }
+    inline int32 rows() const { return m_channels[0].rows(); }
+    inline int32 planes() const { return m_channels[0].planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( m_channels ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      PixelT pixel;
+      for( size_t c=0; c<num_channels; ++c )
+        compound_select_channel<channel_type&>(pixel,c) = m_channels[c](i,j);
+      return pixel;
+    }
+
+    /// Returns the image holding one channel.  It shares memory with
+    /// this image.
+    ImageView<channel_type> const& channel( int32 c ) const {
+      VW_ASSERT( c >= 0 && size_t(c) < num_channels,
+                 ArgumentErr() << "PlanarImageView::channel: There is no channel " << c << "." );
+      return m_channels[c];
+    }
+
+    /// Adjusts the size of the image, allocating new channel images
+    /// if the size has changed.
+    void set_size( int32 cols, int32 rows, int32 planes = 1 ) {
+      VW_ASSERT( planes <= 1, ArgumentErr() << "PlanarImageView: Planar images have a single plane." );
+      for( size_t c=0; c<num_channels; ++c )
+        m_channels[c].set_size( cols, rows, planes );
+    }
+
+    /// Resets to an empty image with zero size.
+    void reset() {
+      for( size_t c=0; c<num_channels; ++c ) m_channels[c].reset();
+    }
+
+    /// \cond INTERNAL
+    typedef PlanarImageReadView<PixelT> prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return prerasterize_type( m_channels ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    inline void rasterize( ImageView<PixelT> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols()==bbox.width() && dest.rows()==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      detail::interleave( m_channels, bbox, dest );
+    }
+    /// \endcond
+
+  private:
+    template <class ViewT>
+    void assign( ViewT const& view, BBox2i const& bbox ) const {
+      view.rasterize( *this, bbox );
+    }
+    void assign( ImageView<PixelT> const& view, BBox2i const& bbox ) const {
+      VW_ASSERT( cols()==bbox.width() && rows()==bbox.height() && view.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      detail::deinterleave( view, bbox, m_channels );
+    }
+
+    ImageView<channel_type> m_channels[num_channels];
+  };
+
+  /// Specifies that PlanarImageView objects are resizable.
+  template <class PixelT>
+  struct IsResizable<PlanarImageView<PixelT> > : public true_type {};
+
+  /// Specifies that PlanarImageView objects are fast to access.
+  template <class PixelT>
+  struct IsMultiplyAccessible<PlanarImageView<PixelT> > : public true_type {};
+
+} // namespace vw
+
+#endif // __VW_IMAGE_PLANARIMAGEVIEW_H__
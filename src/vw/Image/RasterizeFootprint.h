@@ -0,0 +1,75 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file RasterizeFootprint.h
+///
+/// Estimates how much temporary memory rasterizing a region of a
+/// view will allocate, by walking the view tree the same way
+/// prerasterize() does: each view works out the region it will ask
+/// of its children, adds the buffers it allocates itself, and asks
+/// its children in turn.
+///
+/// The estimate does not count the destination.  It does count the
+/// buffer a view like a convolution returns from prerasterize(),
+/// even at the top of the tree where rasterize() may write straight
+/// into the destination, and the buffers of sibling subtrees are
+/// added together even when they are not alive at the same time, so
+/// it is an upper bound for the views that are modelled.  Views are
+/// modelled by specializing RasterizeFootprint in the header that
+/// defines them, as is done for SparseImageCheck.
+/// The default assumes a view allocates nothing and has no children,
+/// which is right for ImageView and the procedural views but will
+/// miss the subtree of any other view that has no specialization.
+///
+#ifndef __VW_IMAGE_RASTERIZE_FOOTPRINT_H__
+#define __VW_IMAGE_RASTERIZE_FOOTPRINT_H__
+
+#include <cstddef>
+#include <algorithm>
+
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageViewBase.h>
+
+namespace vw {
+
+  /// The default, for views that allocate nothing while rasterizing.
+  template <class ViewT>
+  class RasterizeFootprint {
+  public:
+    RasterizeFootprint( ViewT const& /*view*/ ) {}
+    size_t operator()( BBox2i const& /*bbox*/ ) const { return 0; }
+  };
+
+  /// The size of an image buffer covering bbox.
+  template <class PixelT>
+  inline size_t raster_bytes( BBox2i const& bbox, int32 planes ) {
+    if( bbox.empty() ) return 0;
+    return size_t(bbox.width()) * size_t(bbox.height()) * size_t(planes) * sizeof(PixelT);
+  }
+
+  /// Returns the temporary memory, in bytes, that rasterizing the
+  /// region bbox of the view is expected to allocate, not counting
+  /// the destination.
+  template <class ViewT>
+  inline size_t estimate_rasterize_bytes( ImageViewBase<ViewT> const& view, BBox2i const& bbox ) {
+    return RasterizeFootprint<ViewT>( view.impl() )( bbox );
+  }
+
+  /// Returns the temporary memory, in bytes, that rasterizing the
+  /// view in blocks of block_size on num_threads threads at once is
+  /// expected to need at its peak.  This is what a scheduler should
+  /// compare against the memory it has when choosing a block size or
+  /// a thread count.
+  template <class ViewT>
+  inline size_t estimate_block_rasterize_bytes( ImageViewBase<ViewT> const& view, Vector2i const& block_size, int num_threads ) {
+    BBox2i block( 0, 0, std::min( block_size.x(), view.impl().cols() ), std::min( block_size.y(), view.impl().rows() ) );
+    return size_t( std::max( num_threads, 1 ) ) * estimate_rasterize_bytes( view, block );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_RASTERIZE_FOOTPRINT_H__
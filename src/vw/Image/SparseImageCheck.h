@@ -12,6 +12,7 @@
 #define __VW_IMAGE_SPARSE_IMAGE_CHECK_H__
 
 #include <vw/Math/BBox.h>
+#include <vw/Core/FundamentalTypes.h>
 
 namespace vw {
 
@@ -32,6 +33,13 @@ namespace vw {
     return SparseImageCheck<ImageT>(image)(bbox);
   }
 
+  // Views whose regions without data all rasterize to the same
+  // pixels, such as a SparseImageView's fill, specialize this to
+  // true_type.  block_write_image() then rasterizes one empty block
+  // and writes it wherever the SparseImageCheck finds no data.
+  template <class ImageT>
+  struct SparseFillIsConstant : public false_type {};
+
 } // namespace vw
 
 #endif // __VW_IMAGE_SPARSE_IMAGE_CHECK_H__
@@ -0,0 +1,361 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SparseImageView.h
+///
+/// Defines an in-memory image that only stores the blocks that hold
+/// data.
+///
+/// Map-projected strips and similar products are mostly nodata, yet
+/// an ImageView allocates their whole bounding rectangle.  A
+/// SparseImageView divides the image into a grid of blocks and only
+/// allocates the blocks that something other than the fill value is
+/// written to.  Every other block reads as the fill value.
+///
+/// Rasterizing a SparseImageView fills the absent blocks and copies
+/// the stored ones a row at a time, crop() of one is another
+/// SparseImageView sharing the same blocks, and its SparseImageCheck
+/// only reports the stored blocks, so BlockProcessor and friends skip
+/// the rest.  Assigning a view to a SparseImageView skips the blocks
+/// that the view's own SparseImageCheck proves empty, and drops the
+/// blocks that come out as nothing but fill.
+///
+#ifndef __VW_IMAGE_SPARSEIMAGEVIEW_H__
+#define __VW_IMAGE_SPARSEIMAGEVIEW_H__
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Thread.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelAccessors.h>
+#include <vw/Image/SparseImageCheck.h>
+
+namespace vw {
+
+  /// An in-memory image that stores only its non-empty blocks.  Like
+  /// an ImageView, copying it is shallow, and so is crop(), which
+  /// returns a SparseImageView of part of the same blocks.  Sparse
+  /// images always have a single plane.
+  ///
+  /// Several threads may write to different pixels of the image at
+  /// once, as block_rasterize() does, but reading the image while
+  /// another thread writes to it is not supported.
+  template <class PixelT>
+  class SparseImageView : public ImageViewBase<SparseImageView<PixelT> > {
+
+    // The blocks are shared by all the views of an image, each of
+    // which looks at a window onto them.  An empty ImageView stands
+    // for an absent block.
+    struct Storage {
+      int32 cols, rows;
+      Vector2i block_size;
+      int32 blocks_x, blocks_y;
+      PixelT fill;
+      std::vector<ImageView<PixelT> > blocks;
+      Mutex mutex;
+
+      Storage( int32 cols, int32 rows, Vector2i const& block_size, PixelT const& fill )
+        : cols(cols), rows(rows), block_size(block_size),
+          blocks_x( (cols + block_size.x() - 1) / block_size.x() ),
+          blocks_y( (rows + block_size.y() - 1) / block_size.y() ),
+          fill(fill), blocks( size_t(blocks_x) * blocks_y ) {}
+
+      BBox2i block_bbox( int32 bx, int32 by ) const {
+        BBox2i bbox( bx*block_size.x(), by*block_size.y(), block_size.x(), block_size.y() );
+        bbox.crop( BBox2i(0,0,cols,rows) );
+        return bbox;
+      }
+    };
+
+    boost::shared_ptr<Storage> m_storage;
+    Vector2i m_offset;
+    int32 m_cols, m_rows;
+
+  public:
+    /// The pixel type of the image.
+    typedef PixelT pixel_type;
+
+    /// Absent blocks have no pixels to refer to, so pixels are
+    /// returned by value.  Write through assignment or set().
+    typedef PixelT result_type;
+
+    /// The image's %pixel_accessor type.
+    typedef ProceduralPixelAccessor<SparseImageView<PixelT> > pixel_accessor;
+
+    /// Constructs an empty image with zero size.
+    SparseImageView() : m_cols(0), m_rows(0) {}
+
+    /// Constructs an image of the given size that holds nothing but
+    /// the fill value.  Blocks are allocated as they are written.
+    SparseImageView( int32 cols, int32 rows, PixelT const& fill = PixelT(),
+                     Vector2i const& block_size = Vector2i(256,256) )
+      : m_cols(0), m_rows(0) {
+      reset( cols, rows, fill, block_size );
+    }
+
+    /// Constructs a sparse image and rasterizes the given view into it.
+    template <class ViewT>
+    SparseImageView( ImageViewBase<ViewT> const& view, PixelT const& fill = PixelT(),
+                     Vector2i const& block_size = Vector2i(256,256) )
+      : m_cols(0), m_rows(0) {
+      reset( view.impl().cols(), view.impl().rows(), fill, block_size );
+      *const_cast<SparseImageView const*>(this) = view.impl();
+    }
+
+    /// Rasterizes the given view into the image, adjusting the size
+    /// if needed.
+    template <class ViewT>
+    SparseImageView& operator=( ImageViewBase<ViewT> const& view ) {
+      set_size( view.impl().cols(), view.impl().rows(), view.impl().planes() );
+      *const_cast<SparseImageView const*>(this) = view.impl();
+      return *this;
+    }
+
+    /// Rasterizes the given view into the image.
+    template <class ViewT>
+    SparseImageView const& operator=( ImageViewBase<ViewT> const& view ) const {
+      VW_ASSERT( view.impl().cols()==cols() && view.impl().rows()==rows() && view.impl().planes()==planes(),
+                 ArgumentErr() << "SparseImageView: Source and destination must have same dimensions." );
+      assign( view.impl() );
+      return *this;
+    }
+
+    inline int32 cols() const { return m_cols; }
+    inline int32 rows() const { return m_rows; }
+    inline int32 planes() const { return m_storage ? 1 : 0; }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      int32 x = i + m_offset.x(), y = j + m_offset.y();
+      int32 bx = x / m_storage->block_size.x(), by = y / m_storage->block_size.y();
+      ImageView<PixelT> const& block = m_storage->blocks[by*m_storage->blocks_x + bx];
+      if( !block.data() ) return m_storage->fill;
+      return block( x - bx*m_storage->block_size.x(), y - by*m_storage->block_size.y() );
+    }
+
+    /// Sets a single pixel, allocating its block if needed.
+    void set( int32 i, int32 j, PixelT const& value ) const {
+      int32 x = i + m_offset.x(), y = j + m_offset.y();
+      int32 bx = x / m_storage->block_size.x(), by = y / m_storage->block_size.y();
+      ImageView<PixelT>* block = &m_storage->blocks[by*m_storage->blocks_x + bx];
+      if( !block->data() ) {
+        if( value == m_storage->fill ) return;
+        block = &allocate_block( bx, by );
+      }
+      (*block)( x - bx*m_storage->block_size.x(), y - by*m_storage->block_size.y() ) = value;
+    }
+
+    /// Returns the value of the pixels that are not stored.
+    PixelT const& fill_value() const { return m_storage->fill; }
+
+    /// Returns the size of the blocks the image is stored in.
+    Vector2i const& block_size() const { return m_storage->block_size; }
+
+    /// Returns true if any stored block overlaps the given region.
+    /// Where this is false the region is entirely fill.
+    bool has_data( BBox2i const& bbox ) const {
+      if( !m_storage ) return false;
+      BBox2i region = bbox + m_offset;
+      region.crop( BBox2i( m_offset.x(), m_offset.y(), m_cols, m_rows ) );
+      if( region.empty() ) return false;
+      Vector2i const& bs = m_storage->block_size;
+      for( int32 by = region.min().y()/bs.y(); by <= (region.max().y()-1)/bs.y(); ++by )
+        for( int32 bx = region.min().x()/bs.x(); bx <= (region.max().x()-1)/bs.x(); ++bx )
+          if( m_storage->blocks[by*m_storage->blocks_x + bx].data() ) return true;
+      return false;
+    }
+
+    /// Returns the number of blocks holding data, over the whole image
+    /// and not just this view's part of it.
+    size_t stored_blocks() const {
+      if( !m_storage ) return 0;
+      size_t count = 0;
+      for( size_t i=0; i<m_storage->blocks.size(); ++i )
+        if( m_storage->blocks[i].data() ) ++count;
+      return count;
+    }
+
+    /// Adjusts the size of the image.  If the size has changed the
+    /// image is emptied, keeping its fill value and block size.
+    void set_size( int32 cols, int32 rows, int32 planes = 1 ) {
+      VW_ASSERT( planes <= 1, ArgumentErr() << "SparseImageView: Sparse images have a single plane." );
+      if( m_storage && cols==m_cols && rows==m_rows && planes==this->planes() ) return;
+      if( m_storage ) reset( cols, rows, m_storage->fill, m_storage->block_size );
+      else reset( cols, rows, PixelT(), Vector2i(256,256) );
+    }
+
+    /// Empties the image and gives it a new size, fill value and block size.
+    void reset( int32 cols, int32 rows, PixelT const& fill, Vector2i const& block_size ) {
+      VW_ASSERT( cols >= 0 && rows >= 0, ArgumentErr() << "SparseImageView: Cannot have a negative size." );
+      VW_ASSERT( block_size.x() > 0 && block_size.y() > 0,
+                 ArgumentErr() << "SparseImageView: The block size must be positive." );
+      m_storage.reset( new Storage( cols, rows, block_size, fill ) );
+      m_offset = Vector2i();
+      m_cols = cols;
+      m_rows = rows;
+    }
+
+    /// Returns a view of part of the image, which shares its blocks.
+    SparseImageView window( BBox2i const& bbox ) const {
+      VW_ASSERT( BBox2i(0,0,m_cols,m_rows).contains( bbox ),
+                 ArgumentErr() << "SparseImageView: Cannot crop " << bbox << " from a "
+                 << m_cols << "x" << m_rows << " image." );
+      SparseImageView result( *this );
+      result.m_offset = m_offset + bbox.min();
+      result.m_cols = bbox.width();
+      result.m_rows = bbox.height();
+      return result;
+    }
+
+    /// \cond INTERNAL
+    typedef SparseImageView prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    inline void rasterize( ImageView<PixelT> const& dest, BBox2i const& bbox ) const {
+      VW_ASSERT( dest.cols()==bbox.width() && dest.rows()==bbox.height() && dest.planes()==planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      for( int32 r=0; r<bbox.height(); ++r )
+        rasterize_row( &dest(0,r), bbox.min().y()+r, bbox.min().x(), bbox.max().x() );
+    }
+
+    /// Copies pixels [col_begin,col_end) of a row into dest, filling
+    /// the parts that fall in absent blocks.
+    /// \see HasRowSpan
+    inline void rasterize_row( PixelT* dest, int32 row, int32 col_begin, int32 col_end, int32 /*plane*/=0 ) const {
+      Vector2i const& bs = m_storage->block_size;
+      int32 y = row + m_offset.y(), by = y / bs.y();
+      for( int32 x = col_begin + m_offset.x(), end = col_end + m_offset.x(); x < end; ) {
+        int32 bx = x / bs.x();
+        int32 stop = std::min( end, (bx+1)*bs.x() );
+        ImageView<PixelT> const& block = m_storage->blocks[by*m_storage->blocks_x + bx];
+        if( block.data() ) {
+          PixelT const* src = &block( x - bx*bs.x(), y - by*bs.y() );
+          dest = std::copy( src, src + (stop - x), dest );
+        }
+        else
+          dest = std::fill_n( dest, stop - x, m_storage->fill );
+        x = stop;
+      }
+    }
+    /// \endcond
+
+  private:
+    ImageView<PixelT>& allocate_block( int32 bx, int32 by ) const {
+      Mutex::Lock lock( m_storage->mutex );
+      ImageView<PixelT>& block = m_storage->blocks[by*m_storage->blocks_x + bx];
+      if( !block.data() ) {
+        BBox2i bbox = m_storage->block_bbox( bx, by );
+        ImageView<PixelT> data( bbox.width(), bbox.height() );
+        std::fill( data.data(), data.data() + size_t(bbox.width())*bbox.height(), m_storage->fill );
+        block = data;
+      }
+      return block;
+    }
+
+    // Sets a region of a block, in storage coordinates, to the fill
+    // value, dropping the block if the region covers all of it.
+    void clear_region( int32 bx, int32 by, BBox2i const& region ) const {
+      ImageView<PixelT>& block = m_storage->blocks[by*m_storage->blocks_x + bx];
+      if( !block.data() ) return;
+      BBox2i bbox = m_storage->block_bbox( bx, by );
+      if( region == bbox ) {
+        Mutex::Lock lock( m_storage->mutex );
+        block.reset();
+        return;
+      }
+      for( int32 y = region.min().y(); y < region.max().y(); ++y )
+        std::fill_n( &block( region.min().x() - bbox.min().x(), y - bbox.min().y() ), region.width(), m_storage->fill );
+    }
+
+    template <class ViewT>
+    void assign( ViewT const& view ) const {
+      if( m_cols == 0 || m_rows == 0 ) return;
+      SparseImageCheck<ViewT> check( view );
+      BBox2i window( m_offset.x(), m_offset.y(), m_cols, m_rows );
+      Vector2i const& bs = m_storage->block_size;
+      ImageView<PixelT> buf;
+      for( int32 by = window.min().y()/bs.y(); by <= (window.max().y()-1)/bs.y(); ++by ) {
+        for( int32 bx = window.min().x()/bs.x(); bx <= (window.max().x()-1)/bs.x(); ++bx ) {
+          BBox2i bbox = m_storage->block_bbox( bx, by );
+          BBox2i region = bbox;
+          region.crop( window );
+          BBox2i src_region = region - m_offset;
+          if( !check( src_region ) ) {
+            clear_region( bx, by, region );
+            continue;
+          }
+          buf.set_size( region.width(), region.height() );
+          view.rasterize( buf, src_region );
+          size_t n = size_t(region.width()) * region.height();
+          PixelT const* pixels = buf.data();
+          size_t i = 0;
+          while( i < n && pixels[i] == m_storage->fill ) ++i;
+          if( i == n ) {
+            clear_region( bx, by, region );
+            continue;
+          }
+          ImageView<PixelT>& block = allocate_block( bx, by );
+          for( int32 r=0; r<region.height(); ++r )
+            std::copy( &buf(0,r), &buf(0,r) + region.width(),
+                       &block( region.min().x() - bbox.min().x(), region.min().y() - bbox.min().y() + r ) );
+        }
+      }
+    }
+  };
+
+  /// Specifies that SparseImageView objects are resizable.
+  template <class PixelT>
+  struct IsResizable<SparseImageView<PixelT> > : public true_type {};
+
+  /// Specifies that SparseImageView objects are fast to access.
+  template <class PixelT>
+  struct IsMultiplyAccessible<SparseImageView<PixelT> > : public true_type {};
+
+  /// Specifies that SparseImageView objects can copy out spans of a row.
+  template <class PixelT>
+  struct HasRowSpan<SparseImageView<PixelT> > : public true_type {};
+
+  /// Only the stored blocks of a SparseImageView hold data.
+  template <class PixelT>
+  class SparseImageCheck<SparseImageView<PixelT> > {
+    SparseImageView<PixelT> m_view;
+  public:
+    SparseImageCheck( SparseImageView<PixelT> const& view ) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const { return m_view.has_data( bbox ); }
+  };
+
+  /// The regions of a SparseImageView without data are all fill.
+  template <class PixelT>
+  struct SparseFillIsConstant<SparseImageView<PixelT> > : public true_type {};
+
+  /// Crop a sparse image.  The result is a SparseImageView sharing
+  /// the blocks of the original, so rasterizing it still skips the
+  /// absent ones.
+  template <class PixelT>
+  inline SparseImageView<PixelT> crop( SparseImageView<PixelT> const& v, int32 upper_left_x, int32 upper_left_y, int32 width, int32 height ) {
+    return v.window( BBox2i( upper_left_x, upper_left_y, width, height ) );
+  }
+
+  /// Crop a sparse image.
+  template <class PixelT, class BBoxRealT>
+  inline SparseImageView<PixelT> crop( SparseImageView<PixelT> const& v, BBox<BBoxRealT,2> const& bbox ) {
+    return v.window( BBox2i( int32(bbox.min()[0]), int32(bbox.min()[1]),
+                             int32(.5+bbox.width()), int32(.5+bbox.height()) ) );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_SPARSEIMAGEVIEW_H__
@@ -18,6 +18,8 @@
 /// - mean_channel_value
 /// - stddev_channel_value
 /// - median_channel_value
+/// - quantile_channel_value
+/// - quantile_channel_values
 /// - weighted_mean_channel_value
 ///
 /// - min_pixel_value
@@ -28,14 +30,23 @@
 /// - stddev_pixel_value
 /// - median_pixel_value
 /// - weighted_mean_pixel_value
+///
+/// The channel statistics other than the median also come in
+/// parallel_ versions, which split the image into blocks, accumulate
+/// each block on its own thread, and merge the partial results.
+/// These are built on parallel_for_each_pixel(), which works with any
+/// accumulator that provides a merge() member.
 
 #ifndef __VW_IMAGE_STATISTICS_H__
 #define __VW_IMAGE_STATISTICS_H__
 
+#include <vector>
 #include <boost/type_traits.hpp>
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelMask.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/BlockProcessor.h>
 
 namespace vw {
 
@@ -151,6 +162,189 @@ namespace vw {
     return accumulator.value();
   }
 
+  namespace detail {
+    // Integer channels of up to 16 bits are cheap to histogram
+    // exactly; everything else goes through a quantile sketch.
+    template <class ChannelT> struct ChannelQuantileAccumulator { typedef QuantileAccumulator<ChannelT> type; };
+    template <> struct ChannelQuantileAccumulator<vw::int8>   { typedef HistogramAccumulator<vw::int8> type; };
+    template <> struct ChannelQuantileAccumulator<vw::uint8>  { typedef HistogramAccumulator<vw::uint8> type; };
+    template <> struct ChannelQuantileAccumulator<vw::int16>  { typedef HistogramAccumulator<vw::int16> type; };
+    template <> struct ChannelQuantileAccumulator<vw::uint16> { typedef HistogramAccumulator<vw::uint16> type; };
+  }
+
+  /// Computes a quantile of the values of all the channels of all of
+  /// the valid pixels of an image, in fixed memory.  For 8- and
+  /// 16-bit integer channels the result is exact, computed from a
+  /// HistogramAccumulator; for other channel types it is approximate,
+  /// computed from a QuantileAccumulator sketch.  Either accumulator
+  /// can also be used with parallel_for_each_pixel().
+  template <class ViewT>
+  typename PixelChannelType<typename ViewT::pixel_type>::type
+  quantile_channel_value( const ImageViewBase<ViewT> &view, double quantile ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+    ChannelAccumulator<typename detail::ChannelQuantileAccumulator<channel_type>::type> accumulator;
+    for_each_pixel( view, accumulator );
+    return accumulator.quantile( quantile );
+  }
+
+  /// Computes several quantiles of the channel values of an image in
+  /// a single pass, for example the low and high percentiles used to
+  /// stretch an image for display.
+  /// \see quantile_channel_value
+  template <class ViewT>
+  std::vector<typename PixelChannelType<typename ViewT::pixel_type>::type>
+  quantile_channel_values( const ImageViewBase<ViewT> &view, std::vector<double> const& quantiles ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+    ChannelAccumulator<typename detail::ChannelQuantileAccumulator<channel_type>::type> accumulator;
+    for_each_pixel( view, accumulator );
+    std::vector<channel_type> result( quantiles.size() );
+    for ( size_t i = 0; i < quantiles.size(); ++i )
+      result[i] = accumulator.quantile( quantiles[i] );
+    return result;
+  }
+
+  // PARALLEL reductions
+  //////////////////////////////////////////////////
+
+  namespace detail {
+
+    // Accumulates one block of a parallel_for_each_pixel() call into
+    // that block's own accumulator.
+    template <class ViewT, class AccumT>
+    class BlockAccumulateFunctor {
+      ViewT const& m_view;
+      std::vector<AccumT>& m_results;
+      Vector2i m_block_size;
+      int32 m_table_width;
+    public:
+      BlockAccumulateFunctor( ViewT const& view, std::vector<AccumT>& results, Vector2i const& block_size, int32 table_width )
+        : m_view(view), m_results(results), m_block_size(block_size), m_table_width(table_width) {}
+      void operator()( BBox2i const& bbox ) const {
+        AccumT& accum = m_results[ bbox.min().x()/m_block_size.x() + (bbox.min().y()/m_block_size.y())*m_table_width ];
+        for_each_pixel( crop( m_view.prerasterize(bbox), bbox ), accum );
+      }
+    };
+
+  } // namespace detail
+
+  /// Applies an accumulator to every pixel of an image, in parallel.
+  /// The image is split into blocks, each block is prerasterized and
+  /// accumulated by its own copy of accum, and the partial results
+  /// are merged pairwise in a fixed order, so the result does not
+  /// depend on thread scheduling.  The accumulator must provide
+  ///
+  ///   void merge( AccumT const& other );
+  ///
+  /// which folds other's samples into this one.  Each block starts
+  /// from a copy of accum as passed in, so it should hold no samples
+  /// yet; the merged result is assigned back to it.  The default
+  /// block size is a band of full rows holding about two megabytes
+  /// of pixels, and a num_threads of zero uses the
+  /// default_num_threads setting.
+  template <class ViewT, class AccumT>
+  void parallel_for_each_pixel( ImageViewBase<ViewT> const& view_, AccumT& accum,
+                                Vector2i block_size = Vector2i(), int num_threads = 0 ) {
+    ViewT const& view = view_.impl();
+    if( view.cols() <= 0 || view.rows() <= 0 ) return;
+    if( block_size.x() <= 0 || block_size.y() <= 0 ) {
+      const int32 default_blocksize = 2*1024*1024; // 2 megabytes
+      int32 block_rows = default_blocksize / (view.planes()*view.cols()*int32(sizeof(typename ViewT::pixel_type)));
+      if( block_rows < 1 ) block_rows = 1;
+      else if( block_rows > view.rows() ) block_rows = view.rows();
+      block_size = Vector2i( view.cols(), block_rows );
+    }
+    int32 table_width = (view.cols()-1) / block_size.x() + 1;
+    int32 table_height = (view.rows()-1) / block_size.y() + 1;
+    std::vector<AccumT> results( table_width*table_height, accum );
+
+    typedef detail::BlockAccumulateFunctor<ViewT,AccumT> func_type;
+    func_type func( view, results, block_size, table_width );
+    BlockProcessor<func_type> process( func, block_size, num_threads );
+    process( BBox2i(0,0,view.cols(),view.rows()) );
+
+    // A tree reduction keeps the partial sums balanced.
+    for( size_t stride=1; stride<results.size(); stride*=2 )
+      for( size_t i=0; i+stride<results.size(); i+=2*stride )
+        results[i].merge( results[i+stride] );
+    accum = results[0];
+  }
+
+  /// Compute the minimum value stored in all of the channels of all
+  /// of the planes of the image, in parallel.
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  typename PixelChannelType<typename ViewT::pixel_type>::type
+  parallel_min_channel_value( const ImageViewBase<ViewT>& view, Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
+    ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    return accumulator.minimum();
+  }
+
+  /// Compute the maximum value stored in all of the channels of all
+  /// of the planes of the image, in parallel.
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  typename PixelChannelType<typename ViewT::pixel_type>::type
+  parallel_max_channel_value( const ImageViewBase<ViewT>& view, Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
+    ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    return accumulator.maximum();
+  }
+
+  /// Simultaneously compute the min and max value in all of the
+  /// channels of all of the planes of the image, in parallel.
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  void parallel_min_max_channel_values( const ImageViewBase<ViewT> &view,
+                                        typename PixelChannelType<typename ViewT::pixel_type>::type &min,
+                                        typename PixelChannelType<typename ViewT::pixel_type>::type &max,
+                                        Vector2i const& block_size = Vector2i(), int num_threads = 0 )
+  {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
+    ChannelAccumulator<MinMaxAccumulator<accum_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    min = accumulator.minimum();
+    max = accumulator.maximum();
+  }
+
+  /// Compute the sum of all the channels of all the valid pixels of
+  /// the image, in parallel.
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type
+  parallel_sum_of_channel_values( const ImageViewBase<ViewT>& view, Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    typedef typename AccumulatorType<typename PixelChannelType<typename ViewT::pixel_type>::type>::type accum_type;
+    ChannelAccumulator<Accumulator<accum_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    return accumulator.value();
+  }
+
+  /// Computes the mean of the values of the channels of all of the
+  /// valid pixels of an image, in parallel.
+  /// \see mean_channel_value
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  double parallel_mean_channel_value( const ImageViewBase<ViewT> &view, Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type accum_type;
+    ChannelAccumulator<MeanAccumulator<accum_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    return accumulator.value();
+  }
+
+  /// Computes the standard deviation of the values of all the
+  /// channels of all of the planes of an image, in parallel.
+  /// \see stddev_channel_value
+  /// \see parallel_for_each_pixel
+  template <class ViewT>
+  double parallel_stddev_channel_value( const ImageViewBase<ViewT> &view, Vector2i const& block_size = Vector2i(), int num_threads = 0 ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+    ChannelAccumulator<StdDevAccumulator<channel_type> > accumulator;
+    parallel_for_each_pixel( view, accumulator, block_size, num_threads );
+    return accumulator.value();
+  }
+
   // PIXEL operations
   //////////////////////////////////
 
@@ -183,6 +377,15 @@ namespace vw {
       VW_ASSERT(m_valid, ArgumentErr() << "EWMinMaxAccumulator: no valid samples" );
       return m_max;
     }
+
+    void merge( EWMinMaxAccumulator const& other ) {
+      if ( !other.m_valid ) return;
+      if ( !m_valid ) { *this = other; return; }
+      for ( size_t i = 0; i < CompoundNumChannels<ValT>::value; i++ ) {
+        if ( other.m_min[i] < m_min[i] ) m_min[i] = other.m_min[i];
+        if ( other.m_max[i] > m_max[i] ) m_max[i] = other.m_max[i];
+      }
+    }
   };
 
   template <class ValT>
@@ -214,6 +417,14 @@ namespace vw {
         result[i] = sqrt(m_sum_2[i]/num_samples - (m_sum[i]/num_samples)*(m_sum[i]/num_samples));
       return result;
     }
+
+    void merge( EWStdDevAccumulator const& other ) {
+      num_samples += other.num_samples;
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ ) {
+        m_sum[i] += other.m_sum[i];
+        m_sum_2[i] += other.m_sum_2[i];
+      }
+    }
   };
 
   template <class ValT>
@@ -239,14 +450,27 @@ namespace vw {
       }
       return result;
     }
+
+    void merge( EWMedianAccumulator const& other ) {
+      for ( vw::int32 i = 0; i < CompoundNumChannels<ValT>::value; i++ )
+        m_values[i].insert( m_values[i].end(), other.m_values[i].begin(), other.m_values[i].end() );
+    }
   };
 
+  namespace detail {
+    // The is_valid() member of the accumulators would hide the free
+    // function, and qualifying it would keep argument dependent lookup
+    // from finding the overloads of pixel types declared later.
+    template <class PixelT>
+    inline bool accumulator_is_valid( PixelT const& pix ) { return is_valid(pix); }
+  }
+
   template <class AccumT>
   class PixelAccumulator : public AccumT {
   public:
     template <class ArgT>
     void operator()( ArgT const& pix ) {
-      if ( ::vw::is_valid(pix) )
+      if ( detail::accumulator_is_valid(pix) )
         AccumT::operator()( remove_mask( pix ) );
     }
   };
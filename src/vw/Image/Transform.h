@@ -14,6 +14,9 @@
 #ifndef __VW_IMAGE_TRANSFORM_H__
 #define __VW_IMAGE_TRANSFORM_H__
 
+#include <vector>
+#include <algorithm>
+
 // Vision Workbench
 #include <vw/Core/Features.h>
 #include <vw/Core/Log.h>
@@ -505,87 +508,177 @@ namespace vw {
 
   /// ApproximateTransform image transform functor template.
   ///
-  /// Mimics the behavior of a given transform functor, but attempts to
-  /// build a lookup table to linearly interpolate approimate results
-  /// to the reverse() function for arguments within the given bounding
-  /// box, to within the original transform functor's tolerance.
+  /// Mimics the behavior of a given transform functor, but answers
+  /// reverse() for arguments within the given bounding box by
+  /// bilinear interpolation of the exact reverse() on a grid of
+  /// cells, to within the original transform functor's tolerance.
+  ///
+  /// The grid starts out with cells of initial_cell pixels.  Each
+  /// cell is checked against the exact transform at its center and
+  /// edge midpoints, and is split into four if any of them is off by
+  /// more than the tolerance.  Cells that still fail once they are no
+  /// larger than min_cell pixels use the exact transform.  So smooth
+  /// regions cost a handful of exact evaluations, and only the badly
+  /// behaved parts of the box pay for more.
   template <class TransformT>
   class ApproximateTransform : public TransformT {
+  public:
+    static const int32 initial_cell = 32;
+    static const int32 min_cell = 4;
+
+  private:
+    // A leaf of the subdivision: the bilinear patch through the exact
+    // values at its corners, or a marker to use the exact transform.
+    struct Cell {
+      Vector2 origin, inv_size;
+      Vector2 c00, c10, c01, c11;
+      bool exact;
+    };
+
     BBox2i m_bbox;
-    ImageView<Vector2> m_table;
+    std::vector<Cell> m_cells;
+    // The cell covering each min_cell x min_cell square of the box.
+    std::vector<int32> m_index;
+    int32 m_index_cols, m_index_rows;
+
+    static inline Vector2 interpolate( Cell const& c, Vector2 const& p ) {
+      double u = (p.x() - c.origin.x()) * c.inv_size.x();
+      double v = (p.y() - c.origin.y()) * c.inv_size.y();
+      return (c.c00*(1-u) + c.c10*u)*(1-v) + (c.c01*(1-u) + c.c11*u)*v;
+    }
+
+    // Where to split a cell side of the given length so that cell
+    // origins stay on the min_cell grid, or 0 if it cannot be split.
+    static inline int32 split_point( int32 size ) {
+      if( size <= min_cell ) return 0;
+      int32 half = (size/2/min_cell)*min_cell;
+      return (half > 0) ? half : min_cell;
+    }
+
+    void add_cell( int32 x0, int32 y0, int32 sx, int32 sy, bool exact,
+                   Vector2 const& c00, Vector2 const& c10, Vector2 const& c01, Vector2 const& c11 ) {
+      Cell cell;
+      cell.origin = Vector2(x0,y0);
+      cell.inv_size = Vector2(1.0/sx,1.0/sy);
+      cell.c00 = c00; cell.c10 = c10; cell.c01 = c01; cell.c11 = c11;
+      cell.exact = exact;
+      int32 id = int32(m_cells.size());
+      m_cells.push_back( cell );
+      int32 ix0 = (x0 - m_bbox.min().x()) / min_cell, iy0 = (y0 - m_bbox.min().y()) / min_cell;
+      int32 ix1 = (x0 + sx - m_bbox.min().x() + min_cell - 1) / min_cell;
+      int32 iy1 = (y0 + sy - m_bbox.min().y() + min_cell - 1) / min_cell;
+      for( int32 iy=iy0; iy<iy1 && iy<m_index_rows; ++iy )
+        for( int32 ix=ix0; ix<ix1 && ix<m_index_cols; ++ix )
+          m_index[iy*m_index_cols+ix] = id;
+    }
+
+    void subdivide( int32 x0, int32 y0, int32 sx, int32 sy, double tol_sqr,
+                    Vector2 const& c00, Vector2 const& c10, Vector2 const& c01, Vector2 const& c11 ) {
+      int32 hx = split_point(sx), hy = split_point(sy);
+      if( hx == 0 && hy == 0 ) {
+        // Too small to check any further.  Take the bilinear patch
+        // only if its center is good enough.
+        Cell test;
+        test.origin = Vector2(x0,y0); test.inv_size = Vector2(1.0/sx,1.0/sy);
+        test.c00 = c00; test.c10 = c10; test.c01 = c01; test.c11 = c11;
+        Vector2 center( x0+0.5*sx, y0+0.5*sy );
+        bool exact = norm_2_sqr( TransformT::reverse(center) - interpolate(test,center) ) > tol_sqr;
+        add_cell( x0, y0, sx, sy, exact, c00, c10, c01, c11 );
+        return;
+      }
+      if( hx == 0 ) hx = sx;
+      if( hy == 0 ) hy = sy;
+      int32 xm = x0 + hx, ym = y0 + hy, x1 = x0 + sx, y1 = y0 + sy;
+
+      Vector2 top    = (hx<sx) ? TransformT::reverse(Vector2(xm,y0)) : c10;
+      Vector2 bottom = (hx<sx) ? TransformT::reverse(Vector2(xm,y1)) : c11;
+      Vector2 left   = (hy<sy) ? TransformT::reverse(Vector2(x0,ym)) : c01;
+      Vector2 right  = (hy<sy) ? TransformT::reverse(Vector2(x1,ym)) : c11;
+      Vector2 center = (hx<sx && hy<sy) ? TransformT::reverse(Vector2(xm,ym)) : Vector2();
+
+      Cell test;
+      test.origin = Vector2(x0,y0); test.inv_size = Vector2(1.0/sx,1.0/sy);
+      test.c00 = c00; test.c10 = c10; test.c01 = c01; test.c11 = c11;
+      double err = 0;
+      if( hx<sx ) {
+        err = std::max( err, norm_2_sqr( top - interpolate(test,Vector2(xm,y0)) ) );
+        err = std::max( err, norm_2_sqr( bottom - interpolate(test,Vector2(xm,y1)) ) );
+      }
+      if( hy<sy ) {
+        err = std::max( err, norm_2_sqr( left - interpolate(test,Vector2(x0,ym)) ) );
+        err = std::max( err, norm_2_sqr( right - interpolate(test,Vector2(x1,ym)) ) );
+      }
+      if( hx<sx && hy<sy )
+        err = std::max( err, norm_2_sqr( center - interpolate(test,Vector2(xm,ym)) ) );
+
+      if( err <= tol_sqr ) {
+        add_cell( x0, y0, sx, sy, false, c00, c10, c01, c11 );
+      }
+      else if( hx<sx && hy<sy ) {
+        subdivide( x0, y0, hx,    hy,    tol_sqr, c00,  top,    left,   center );
+        subdivide( xm, y0, sx-hx, hy,    tol_sqr, top,  c10,    center, right );
+        subdivide( x0, ym, hx,    sy-hy, tol_sqr, left, center, c01,    bottom );
+        subdivide( xm, ym, sx-hx, sy-hy, tol_sqr, center, right, bottom, c11 );
+      }
+      else if( hx<sx ) {
+        subdivide( x0, y0, hx,    sy, tol_sqr, c00, top, c01,    bottom );
+        subdivide( xm, y0, sx-hx, sy, tol_sqr, top, c10, bottom, c11 );
+      }
+      else {
+        subdivide( x0, y0, sx, hy,    tol_sqr, c00,  c10,   left, right );
+        subdivide( x0, ym, sx, sy-hy, tol_sqr, left, right, c01,  c11 );
+      }
+    }
+
   public:
     ApproximateTransform( TransformT const& transform, BBox2i const& bbox )
-      : TransformT( transform ), m_bbox( bbox ), m_table(2,2)
+      : TransformT( transform ), m_bbox( bbox ), m_index_cols(0), m_index_rows(0)
     {
-      // Initialize with a simple 2x2 lookup table
-      int32 n=2;
-      m_table(0,0) = TransformT::reverse(bbox.min());
-      m_table(1,0) = TransformT::reverse(Vector2(bbox.max().x(),bbox.min().y()));
-      m_table(0,1) = TransformT::reverse(Vector2(bbox.min().x(),bbox.max().y()));
-      m_table(1,1) = TransformT::reverse(bbox.max());
-
-      // Double the grid density until the worst (squared) approximation error
-      // is less than the allowed (squared) tolerance.
-      double max_sqr_err = 0;
+      if( bbox.empty() ) return;
+      m_index_cols = (bbox.width() + min_cell - 1) / min_cell;
+      m_index_rows = (bbox.height() + min_cell - 1) / min_cell;
+      m_index.resize( size_t(m_index_cols) * m_index_rows );
       double tol_sqr = TransformT::tolerance() * TransformT::tolerance();
-      Vector2 origin = bbox.min(), diag = bbox.size();
-      do {
-        n = 2*n-1;
-        // Fall back for unapproximatably crazy transform functions.
-        if( n>=bbox.width()|| n>=bbox.height() ) {
-          m_table.reset();
-          return;
-        }
-        ImageView<Vector2> prev = m_table;
-        m_table.set_size(n,n);
-        max_sqr_err = 0;
-        for( int y=0; y<n; ++y ) {
-          for( int x=0; x<n; ++x ) {
-            if( (y%2)==0 && (x%2==0) ) {
-              m_table(x,y) = prev(x/2,y/2);
-            }
-            else {
-              Vector2 pos = Vector2(x,y)/(n-1);
-              m_table(x,y) = TransformT::reverse(origin+elem_prod(pos,diag));
-              Vector2 interp;
-              if( (y%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2+1,y/2)) / 2.0;
-              else if( (x%2)==0 ) interp = (prev(x/2,y/2) + prev(x/2,y/2+1)) / 2.0;
-              else interp = (prev(x/2,y/2) + prev(x/2,y/2+1) + prev(x/2+1,y/2) + prev(x/2+1,y/2+1)) / 4.0;
-              double sqr_err = norm_2_sqr( m_table(x,y) - interp );
-              if( sqr_err > max_sqr_err ) max_sqr_err = sqr_err;
-            }
-          }
+
+      // The exact values at the corners of the initial grid, which has
+      // a final row and column of partial cells if the box is not a
+      // multiple of the cell size.
+      int32 gx = (bbox.width() + initial_cell - 1) / initial_cell;
+      int32 gy = (bbox.height() + initial_cell - 1) / initial_cell;
+      std::vector<Vector2> corners( size_t(gx+1)*(gy+1) );
+      for( int32 j=0; j<=gy; ++j )
+        for( int32 i=0; i<=gx; ++i )
+          corners[j*(gx+1)+i] = TransformT::reverse( Vector2( std::min(bbox.min().x()+i*initial_cell, bbox.max().x()),
+                                                              std::min(bbox.min().y()+j*initial_cell, bbox.max().y()) ) );
+      for( int32 j=0; j<gy; ++j )
+        for( int32 i=0; i<gx; ++i ) {
+          int32 x0 = bbox.min().x()+i*initial_cell, y0 = bbox.min().y()+j*initial_cell;
+          subdivide( x0, y0, std::min(initial_cell, bbox.max().x()-x0), std::min(initial_cell, bbox.max().y()-y0), tol_sqr,
+                     corners[j*(gx+1)+i], corners[j*(gx+1)+i+1], corners[(j+1)*(gx+1)+i], corners[(j+1)*(gx+1)+i+1] );
         }
-      } while( max_sqr_err > tol_sqr );
     }
 
     inline Vector2 reverse( Vector2 const& p ) const {
-      // Fall back if the function was not approximatable.
-      if( ! m_table ) return TransformT::reverse( p );
-
-      // We re-implement bilinear interpolation by hand here because for
-      // some reason the BilinearInterpolation object is exceptionally
-      // slow for Vector data still.
-      int n = m_table.cols() - 1;
-      double px = n * (p.x() - m_bbox.min().x()) / (m_bbox.max().x() - m_bbox.min().x());
-      double py = n * (p.y() - m_bbox.min().y()) / (m_bbox.max().y() - m_bbox.min().y());
-      int32 ix = math::impl::_floor(px);
+      if( m_cells.empty() ) return TransformT::reverse( p );
+      // Points outside the box extrapolate from the nearest cell.
+      int32 ix = math::impl::_floor( (p.x() - m_bbox.min().x()) / min_cell );
+      int32 iy = math::impl::_floor( (p.y() - m_bbox.min().y()) / min_cell );
       if( ix < 0 ) ix = 0;
-      if( ix >= n ) ix = n-1;
-      int32 iy = math::impl::_floor(py);
+      if( ix >= m_index_cols ) ix = m_index_cols-1;
       if( iy < 0 ) iy = 0;
-      if( iy >= n ) iy = n-1;
-      double normx = px-ix, normy = py-iy;
-
-      Vector2 const& m00 = m_table(ix,  iy);
-      Vector2 const& m10 = m_table(ix+1,iy);
-      Vector2 const& m01 = m_table(ix,  iy+1);
-      Vector2 const& m11 = m_table(ix+1,iy+1);
-
-      return Vector2( (m00.x()*(1-normy)+m01.x()*normy)*(1-normx) +
-                      (m10.x()*(1-normy)+m11.x()*normy)*normx,
-                      (m00.y()*(1-normy)+m01.y()*normy)*(1-normx) +
-                      (m10.y()*(1-normy)+m11.y()*normy)*normx );
+      if( iy >= m_index_rows ) iy = m_index_rows-1;
+      Cell const& cell = m_cells[ m_index[iy*m_index_cols+ix] ];
+      if( cell.exact ) return TransformT::reverse( p );
+      return interpolate( cell, p );
+    }
+
+    /// The number of cells in the subdivision, and how many of them
+    /// fell back to the exact transform.
+    size_t num_cells() const { return m_cells.size(); }
+    size_t num_exact_cells() const {
+      size_t n = 0;
+      for( size_t i=0; i<m_cells.size(); ++i ) n += m_cells[i].exact;
+      return n;
     }
 
     // Never re-approximate the approximation.
@@ -593,6 +686,10 @@ namespace vw {
 
   };
 
+  // std::min() takes these by reference, so they need definitions.
+  template <class TransformT> const int32 ApproximateTransform<TransformT>::initial_cell;
+  template <class TransformT> const int32 ApproximateTransform<TransformT>::min_cell;
+
 
   /// TransformRef virtualized image transform functor adaptor
   class TransformRef : public TransformBase<TransformRef> {
@@ -676,6 +773,16 @@ namespace vw {
   // Type Traits
   template <class ImplT, class TransformT>
   struct IsFloatingPointIndexable<TransformView<ImplT, TransformT> > : public true_type {};
+
+  template <class ImageT, class TransformT>
+  class RasterizeFootprint<TransformView<ImageT, TransformT> > {
+    TransformView<ImageT, TransformT> const& m_view;
+  public:
+    RasterizeFootprint( TransformView<ImageT, TransformT> const& view ) : m_view(view) {}
+    size_t operator()( BBox2i const& bbox ) const {
+      return RasterizeFootprint<ImageT>( m_view.child() )( m_view.transform().reverse_bbox( bbox ) );
+    }
+  };
   /// \endcond
 
 
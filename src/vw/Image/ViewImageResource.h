@@ -33,6 +33,8 @@ namespace vw {
   // direct access.
   template<class PixelT> struct ViewDataAccessor<ImageView<PixelT> > {
     static boost::shared_array<const uint8> data(ImageView<PixelT> const& view) {
+      if( ! view.contiguous() )
+        vw_throw(NoImplErr() << "ViewDataAccessor native_ptr() failed. This view has padded rows.");
       return boost::shared_array<const uint8>(reinterpret_cast<const uint8*>(view.data()), NOP());
     }
   };
@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
 #include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageMath.h>
 
 using namespace vw;
 using namespace std;
@@ -34,3 +35,114 @@ TEST(BlockRasterize, Basic) {
   img2 = b4;
   EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
 }
+
+TEST(BlockRasterize, Parallel) {
+  ImageView<float> src(37,53,2);
+  for( int32 p=0; p<src.planes(); ++p )
+    for( int32 y=0; y<src.rows(); ++y )
+      for( int32 x=0; x<src.cols(); ++x )
+        src(x,y,p) = float(x + 100*y + 10000*p);
+
+  ImageView<float> dest;
+  parallel_rasterize( src, dest, Vector2i(), 4 );
+  ASSERT_EQ( src.cols(), dest.cols() );
+  ASSERT_EQ( src.rows(), dest.rows() );
+  ASSERT_EQ( src.planes(), dest.planes() );
+  EXPECT_RANGE_EQ( src.begin(), src.end(), dest.begin(), dest.end() );
+
+  // Single-plane destinations are rasterized through row bands.
+  ImageView<float> plane = select_plane( src, 1 ), band;
+  parallel_rasterize( plane + 1.0f, band, Vector2i(), 3 );
+  for( int32 y=0; y<band.rows(); ++y )
+    for( int32 x=0; x<band.cols(); ++x )
+      EXPECT_EQ( plane(x,y) + 1, band(x,y) );
+
+  // A region that does not start on a block boundary, split into tiles.
+  BBox2i bbox(5,7,20,30);
+  ImageView<float> region(bbox.width(), bbox.height());
+  parallel_rasterize( plane, region, bbox, Vector2i(8,8), 4 );
+  for( int32 y=0; y<region.rows(); ++y )
+    for( int32 x=0; x<region.cols(); ++x )
+      EXPECT_EQ( plane(x+5,y+7), region(x,y) );
+
+  // Rasterizing into part of a larger image.
+  ImageView<float> big(40,40);
+  parallel_rasterize( plane, crop( big, 2, 3, 20, 30 ), bbox, Vector2i(), 2 );
+  for( int32 y=0; y<30; ++y )
+    for( int32 x=0; x<20; ++x )
+      EXPECT_EQ( plane(x+5,y+7), big(x+2,y+3) );
+  EXPECT_EQ( 0, big(0,0) );
+}
+
+namespace {
+  // Records every block it is called on.
+  struct RecordBlocks {
+    Mutex* mutex;
+    std::vector<BBox2i>* blocks;
+    RecordBlocks( Mutex& mutex, std::vector<BBox2i>& blocks ) : mutex(&mutex), blocks(&blocks) {}
+    void operator()( BBox2i const& bbox ) const {
+      Mutex::Lock lock( *mutex );
+      blocks->push_back( bbox );
+    }
+  };
+
+  double block_row_cost( BBox2i const& bbox ) { return bbox.min().y(); }
+  bool skip_left_half( BBox2i const& bbox ) { return bbox.min().x() >= 16; }
+}
+
+TEST(BlockRasterize, BlockProcessorSchedule) {
+  BBox2i bbox(-3,5,37,29);
+  for( int schedule=0; schedule<2; ++schedule ) {
+    for( int32 chunk=1; chunk<=5; chunk+=2 ) {
+      Mutex mutex;
+      std::vector<BBox2i> blocks;
+      BlockProcessor<RecordBlocks> process( RecordBlocks(mutex,blocks), Vector2i(8,8), 3 );
+      process.set_schedule( BlockSchedule(schedule), chunk );
+      process( bbox );
+
+      // Every pixel is covered exactly once, by blocks on the grid.
+      ImageView<int32> count(bbox.width(), bbox.height());
+      for( size_t i=0; i<blocks.size(); ++i ) {
+        EXPECT_TRUE( bbox.contains( blocks[i] ) );
+        EXPECT_EQ( 0, ((blocks[i].max().x()-1) >> 3) - (blocks[i].min().x() >> 3) );
+        EXPECT_EQ( 0, ((blocks[i].max().y()-1) >> 3) - (blocks[i].min().y() >> 3) );
+        for( int32 y=blocks[i].min().y(); y<blocks[i].max().y(); ++y )
+          for( int32 x=blocks[i].min().x(); x<blocks[i].max().x(); ++x )
+            count(x-bbox.min().x(),y-bbox.min().y()) += 1;
+      }
+      EXPECT_EQ( 30u, blocks.size() );
+      for( int32 y=0; y<count.rows(); ++y )
+        for( int32 x=0; x<count.cols(); ++x )
+          EXPECT_EQ( 1, count(x,y) );
+    }
+  }
+}
+
+TEST(BlockRasterize, BlockProcessorHints) {
+  Mutex mutex;
+  std::vector<BBox2i> blocks;
+  BlockProcessor<RecordBlocks> process( RecordBlocks(mutex,blocks), Vector2i(8,8), 1 );
+
+  // Most expensive first, row order among equals.
+  process.set_cost_hint( &block_row_cost );
+  process( BBox2i(0,0,16,24) );
+  ASSERT_EQ( 6u, blocks.size() );
+  EXPECT_EQ( BBox2i(0,16,8,8), blocks[0] );
+  EXPECT_EQ( BBox2i(8,16,8,8), blocks[1] );
+  EXPECT_EQ( BBox2i(8,0,8,8), blocks[5] );
+
+  // Blocks that fail the check are never processed.
+  blocks.clear();
+  process.set_cost_hint( BlockProcessor<RecordBlocks>::block_cost_type() );
+  process.set_block_check( &skip_left_half );
+  process( BBox2i(0,0,32,8) );
+  ASSERT_EQ( 2u, blocks.size() );
+  EXPECT_EQ( BBox2i(16,0,8,8), blocks[0] );
+
+  // Blocks that miss a sparse image are skipped.
+  blocks.clear();
+  ImageView<uint8> image(10,10);
+  process.set_sparse_check( image );
+  process( BBox2i(0,0,32,32) );
+  EXPECT_EQ( 4u, blocks.size() );
+}
@@ -0,0 +1,56 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Image/BoxReduce.h>
+
+#include <cstdlib>
+
+using namespace vw;
+
+template <class PixelT>
+class BoxReduceTest : public ::testing::Test {};
+
+typedef ::testing::Types<PixelRGBA<uint8>, PixelRGBA<uint16>, PixelRGBA<float32>, PixelRGB<uint8> > PixelTypes;
+TYPED_TEST_CASE(BoxReduceTest, PixelTypes);
+
+TYPED_TEST(BoxReduceTest, MatchesMean) {
+  typedef TypeParam Px;
+  typedef typename CompoundChannelType<Px>::type channel_type;
+  const size_t channels = CompoundNumChannels<Px>::value;
+  srand(7);
+  // Odd sizes exercise the scalar tail and the dropped last row.
+  ImageView<Px> src(23, 11);
+  for (int32 j = 0; j < src.rows(); ++j)
+    for (int32 i = 0; i < src.cols(); ++i)
+      for (size_t c = 0; c < channels; ++c)
+        compound_select_channel<channel_type&>(src(i,j), c) =
+          channel_type(boost::is_integral<channel_type>::value ? rand() % (int(ChannelRange<channel_type>::max())+1)
+                                                               : rand() / double(RAND_MAX));
+
+  ImageView<Px> dest(16, 9);
+  box_reduce(src, dest, 3, 2);
+  for (int32 j = 0; j < 5; ++j) {
+    for (int32 i = 0; i < 11; ++i) {
+      for (size_t c = 0; c < channels; ++c) {
+        double sum = 0;
+        for (int32 v = 0; v < 2; ++v)
+          for (int32 u = 0; u < 2; ++u)
+            sum += compound_select_channel<channel_type const&>(src(2*i+u, 2*j+v), c);
+        double result = compound_select_channel<channel_type const&>(dest(i+3, j+2), c);
+        if (boost::is_integral<channel_type>::value)
+          EXPECT_EQ(floor(sum/4 + 0.5), result) << "at (" << i << "," << j << ")";
+        else
+          EXPECT_NEAR(sum/4, result, 1e-6) << "at (" << i << "," << j << ")";
+      }
+    }
+  }
+  // Nothing outside the target block is touched.
+  EXPECT_EQ(Px(), dest(2, 2));
+  EXPECT_EQ(Px(), dest(14, 2));
+  EXPECT_EQ(Px(), dest(3, 7));
+}
@@ -192,6 +192,29 @@ TEST( Convolution, SeparableView_Compound ) {
   ASSERT_TRUE( is_of_type<PixelGray<float32> >( cnv(0,0) ) );
 }
 
+// The separable view rasterizes through a ring of row buffers; check
+// it against the direct 2D evaluation in operator() on a region that
+// wraps the ring several times, on both planes, and off-center.
+TEST( Convolution, SeparableView_Rows ) {
+  ImageView<double> src(40,30,2);
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<src.rows(); ++j )
+      for( int32 i=0; i<src.cols(); ++i )
+        src(i,j,p) = (i*7 + j*13 + p*5) % 11 - 5;
+  std::vector<double> krnx, krny;
+  krnx.push_back(0.5); krnx.push_back(-1); krnx.push_back(2);
+  krny.push_back(1); krny.push_back(0.25); krny.push_back(-0.5); krny.push_back(3); krny.push_back(1.5);
+  SeparableConvolutionView<ImageView<double>,double,ReflectEdgeExtension> cnv( src, krnx, krny, 0, 3 );
+
+  BBox2i bbox(3,2,30,25);
+  ImageView<double> dest(bbox.width(),bbox.height(),2);
+  cnv.rasterize( dest, bbox );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<dest.rows(); ++j )
+      for( int32 i=0; i<dest.cols(); ++i )
+        EXPECT_NEAR( cnv(i+bbox.min().x(),j+bbox.min().y(),p), dest(i,j,p), 1e-12 );
+}
+
 // This unit test catches a bug in the separable convolution code
 // that was causing the shift due to a crop operation to be applied
 // twice to image view operations that included two layers of edge
@@ -0,0 +1,73 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Image/DistanceTransform.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Algorithms.h>
+
+#include <cstdlib>
+
+using namespace vw;
+
+// Sparse zeros in a 37x29 image, so that distances run well past
+// the edges of small blocks.
+static ImageView<uint8> test_image() {
+  srand(11);
+  ImageView<uint8> image(37, 29);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      image(i,j) = (rand() % 60 == 0) ? 0 : 1;
+  return image;
+}
+
+// The distance to the nearest zero pixel, or to the zero border.
+static double brute_distance(ImageView<uint8> const& image, int32 x, int32 y) {
+  double best = 1e30;
+  for (int32 j = -1; j <= image.rows(); ++j)
+    for (int32 i = -1; i <= image.cols(); ++i) {
+      bool zero = i < 0 || j < 0 || i >= image.cols() || j >= image.rows() || image(i,j) == 0;
+      if (zero) best = std::min(best, double((i-x)*(i-x) + (j-y)*(j-y)));
+    }
+  return sqrt(best);
+}
+
+TEST(DistanceTransform, MatchesBruteForce) {
+  ImageView<uint8> image = test_image();
+  ImageView<float32> dist = euclidean_distance(image);
+  ASSERT_EQ(image.cols(), dist.cols());
+  ASSERT_EQ(image.rows(), dist.rows());
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_NEAR(brute_distance(image, i, j), dist(i,j), 1e-5) << i << "," << j;
+
+  EXPECT_EQ(1, dist(0,5));
+  ImageView<int32> grass = grassfire(image);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_LE(dist(i,j), grass(i,j) + 1e-5);
+}
+
+TEST(DistanceTransform, CappedBlocks) {
+  ImageView<uint8> image = test_image();
+  ImageView<float32> full = euclidean_distance(image);
+  const float32 cap = 3.5f;
+  ImageView<float32> capped = block_rasterize(capped_euclidean_distance(image, cap), Vector2i(8, 6));
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_NEAR(std::min(full(i,j), cap), capped(i,j), 1e-5) << i << "," << j;
+
+  EXPECT_NEAR(std::min(full(20,13), cap), capped_euclidean_distance(image, cap)(20,13), 1e-5);
+}
+
+TEST(DistanceTransform, AllZero) {
+  ImageView<uint8> image(5, 4);
+  ImageView<float32> dist = euclidean_distance(image);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_EQ(0, dist(i,j));
+}
@@ -446,3 +446,38 @@ template <class PixelT>
 FloatingView<PixelT> floating_view( PixelT const& /*value*/, int32 cols, int32 rows, int32 planes=1 ) {
   return FloatingView<PixelT>( cols, rows, planes );
 }
+
+// Rasterizing any region must give the same pixels as reading them
+// one at a time through the edge extension functor.
+template <class ExtensionT>
+static void check_rasterize( ExtensionT const& ext ) {
+  ImageView<float> im(7,5,2);
+  for( int32 p=0; p<im.planes(); ++p )
+    for( int32 j=0; j<im.rows(); ++j )
+      for( int32 i=0; i<im.cols(); ++i )
+        im(i,j,p) = float( i + 10*j + 100*p );
+  EdgeExtensionView<ImageView<float>, ExtensionT> view = edge_extend( im, -2, -3, 12, 10, ext );
+
+  BBox2i boxes[5] = { BBox2i(3,4,4,3),    // inside the child
+                      BBox2i(0,0,12,10),  // all of it
+                      BBox2i(1,5,8,5),    // crossing two edges
+                      BBox2i(0,0,2,10),   // entirely outside
+                      BBox2i(5,2,7,2) };  // crossing one edge
+  for( int b=0; b<5; ++b ) {
+    ImageView<float> dest( boxes[b].width(), boxes[b].height(), 2 );
+    view.rasterize( dest, boxes[b] );
+    for( int32 p=0; p<dest.planes(); ++p )
+      for( int32 j=0; j<dest.rows(); ++j )
+        for( int32 i=0; i<dest.cols(); ++i )
+          EXPECT_EQ( view(i+boxes[b].min().x(), j+boxes[b].min().y(), p), dest(i,j,p) );
+  }
+}
+
+TEST( EdgeExtension, Rasterize ) {
+  check_rasterize( ZeroEdgeExtension() );
+  check_rasterize( ConstantEdgeExtension() );
+  check_rasterize( PeriodicEdgeExtension() );
+  check_rasterize( CylindricalEdgeExtension() );
+  check_rasterize( ReflectEdgeExtension() );
+  check_rasterize( LinearEdgeExtension() );
+}
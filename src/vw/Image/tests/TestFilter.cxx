@@ -11,8 +11,10 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelTypes.h>
+#include <vw/Image/Algorithms.h>
 
 #include <vector>
+#include <algorithm>
 
 using namespace vw;
 
@@ -118,6 +120,138 @@ TEST( Filter, Gaussian ) {
   EXPECT_NEAR( dst(1,1), 0.3877403988*4+0.2447702197*3, 1e-7 );
 }
 
+TEST( Filter, Box ) {
+  ImageView<double> src(9,7);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = (i*5 + j*3) % 7;
+  ImageView<double> dst = box_filter( src, 3, 5, ZeroEdgeExtension() );
+  ImageView<double> padded = edge_extend( src, -1, -2, 11, 11, ZeroEdgeExtension() );
+  for( int32 j=0; j<dst.rows(); ++j )
+    for( int32 i=0; i<dst.cols(); ++i ) {
+      double sum = 0;
+      for( int32 y=0; y<5; ++y )
+        for( int32 x=0; x<3; ++x )
+          sum += padded(i+x,j+y);
+      EXPECT_NEAR( dst(i,j), sum/15, 1e-12 );
+    }
+  EXPECT_NEAR( box_filter( src, 3, 5, ZeroEdgeExtension() )(4,2), dst(4,2), 1e-12 );
+
+  ImageView<PixelRGB<uint8> > rgb(4,4);
+  fill( rgb, PixelRGB<uint8>(10,20,30) );
+  ImageView<PixelRGB<uint8> > rgb_dst = box_filter( rgb, 3, 3 );
+  EXPECT_EQ( rgb_dst(2,1), PixelRGB<uint8>(10,20,30) );
+}
+
+TEST( Filter, RecursiveGaussian ) {
+  ImageView<float> src(64,48);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = ((i/8 + j/8) % 2) ? 1.0f : 0.0f;
+
+  for( double sigma = 1.0; sigma < 9; sigma *= 2 ) {
+    ImageView<float> exact = gaussian_filter( src, sigma, ReflectEdgeExtension() );
+    ImageView<float> approx = recursive_gaussian_filter( src, sigma, ReflectEdgeExtension() );
+    for( int32 j=0; j<src.rows(); ++j )
+      for( int32 i=0; i<src.cols(); ++i )
+        EXPECT_NEAR( exact(i,j), approx(i,j), 0.02 );
+  }
+
+  // A zero sigma leaves that axis alone.
+  ImageView<float> rows_only = recursive_gaussian_filter( src, 0, 2.0 );
+  ImageView<float> rows_exact = gaussian_filter( src, 0, 2.0 );
+  EXPECT_NEAR( rows_only(20,20), rows_exact(20,20), 0.02 );
+  EXPECT_EQ( rows_only(3,20), rows_only(4,20) );
+}
+
+// Brute-force rank of each window of a padded image, for checking
+// the rank filters.
+template <class PixelT>
+static PixelT window_rank( ImageView<PixelT> const& padded, int32 i, int32 j, int32 cols, int32 rows, size_t rank ) {
+  std::vector<PixelT> window;
+  for( int32 y=0; y<rows; ++y )
+    for( int32 x=0; x<cols; ++x )
+      window.push_back( padded(i+x,j+y) );
+  std::sort( window.begin(), window.end() );
+  return window[rank];
+}
+
+TEST( Filter, Morphology ) {
+  ImageView<float> src(23,17);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = float( (i*37 + j*11) % 19 );
+
+  // Odd and even window sizes
+  int32 sizes[3][2] = { {5,3}, {4,6}, {1,9} };
+  for( int s=0; s<3; ++s ) {
+    int32 cols = sizes[s][0], rows = sizes[s][1];
+    ImageView<float> eroded = erode( src, cols, rows );
+    ImageView<float> dilated = dilate( src, cols, rows );
+    ImageView<float> padded = edge_extend( src, -(cols-1)/2, -(rows-1)/2, src.cols()+cols-1, src.rows()+rows-1 );
+    for( int32 j=0; j<src.rows(); ++j )
+      for( int32 i=0; i<src.cols(); ++i ) {
+        EXPECT_EQ( window_rank( padded, i, j, cols, rows, 0 ), eroded(i,j) );
+        EXPECT_EQ( window_rank( padded, i, j, cols, rows, cols*rows-1 ), dilated(i,j) );
+      }
+    EXPECT_EQ( eroded(3,4), erode( src, cols, rows )(3,4) );
+  }
+
+  // Opening and closing bracket the source and are idempotent
+  ImageView<float> opened = opening( src, 3, 3 );
+  ImageView<float> closed = closing( src, 3, 3 );
+  ImageView<float> opened2 = opening( opened, 3, 3 );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i ) {
+      EXPECT_LE( opened(i,j), src(i,j) );
+      EXPECT_GE( closed(i,j), src(i,j) );
+      EXPECT_EQ( opened(i,j), opened2(i,j) );
+    }
+
+  // Channels are filtered independently
+  ImageView<PixelRGB<uint8> > rgb(5,5);
+  fill( rgb, PixelRGB<uint8>(10,20,30) );
+  rgb(2,2) = PixelRGB<uint8>(50,0,30);
+  ImageView<PixelRGB<uint8> > rgb_dst = dilate( rgb, 3, 3 );
+  EXPECT_EQ( rgb_dst(1,1), PixelRGB<uint8>(50,20,30) );
+  EXPECT_EQ( rgb_dst(0,0), PixelRGB<uint8>(10,20,30) );
+}
+
+TEST( Filter, Median ) {
+  ImageView<uint8> src(40,30);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = uint8( (i*97 + j*53 + i*j) % 251 );
+  ImageView<float> fsrc = channel_cast<float>( src );
+
+  int32 sizes[3][2] = { {3,3}, {7,5}, {4,4} };
+  for( int s=0; s<3; ++s ) {
+    int32 cols = sizes[s][0], rows = sizes[s][1];
+    ImageView<uint8> dst = median_filter( src, cols, rows, ReflectEdgeExtension() );
+    ImageView<float> fdst = median_filter( fsrc, cols, rows, ReflectEdgeExtension() );
+    ImageView<uint8> padded = edge_extend( src, -(cols-1)/2, -(rows-1)/2, src.cols()+cols-1, src.rows()+rows-1, ReflectEdgeExtension() );
+    for( int32 j=0; j<src.rows(); ++j )
+      for( int32 i=0; i<src.cols(); ++i ) {
+        uint8 expected = window_rank( padded, i, j, cols, rows, (cols*rows)/2 );
+        EXPECT_EQ( expected, dst(i,j) );
+        EXPECT_EQ( float(expected), fdst(i,j) );
+      }
+  }
+
+  // The view composes with cropping and partial rasterization
+  ImageView<uint8> full = median_filter( src, 5, 5 );
+  ImageView<uint8> part = crop( median_filter( src, 5, 5 ), 10, 7, 13, 11 );
+  for( int32 j=0; j<part.rows(); ++j )
+    for( int32 i=0; i<part.cols(); ++i )
+      EXPECT_EQ( full(i+10,j+7), part(i,j) );
+
+  ImageView<PixelRGB<uint8> > rgb(5,5);
+  fill( rgb, PixelRGB<uint8>(10,20,30) );
+  rgb(2,2) = PixelRGB<uint8>(200,0,30);
+  ImageView<PixelRGB<uint8> > rgb_dst = median_filter( rgb, 3, 3 );
+  EXPECT_EQ( rgb_dst(2,2), PixelRGB<uint8>(10,20,30) );
+}
+
 TEST( Filter, Laplacian ) {
   ImageView<double> src(2,2); src(0,0)=1; src(1,0)=2; src(0,1)=3; src(1,1)=4;
   ImageView<double> dst = laplacian_filter( src, ZeroEdgeExtension() );
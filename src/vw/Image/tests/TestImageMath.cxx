@@ -387,3 +387,55 @@ TEST( ImageMath, COPYSIGN ) { TEST_BINARY_MATH_FUNCTION(copysign,3.0,-2.0,-3.0);
 TEST( ImageMath, FDIM ) { TEST_BINARY_MATH_FUNCTION(fdim,3.0,2.0,1.0);
   TEST_BINARY_MATH_FUNCTION(fdim,2.0,3.0,0.0); }
 #endif
+
+// The kernels in ImageMathKernels.h must match pixel-by-pixel
+// rasterization, which vw::rasterize() always uses.
+template <class ViewT>
+static void expect_kernel_matches( ImageViewBase<ViewT> const& view ) {
+  typedef typename ViewT::pixel_type pixel_type;
+  ImageView<pixel_type> fast = view.impl();
+  ImageView<pixel_type> slow;
+  vw::rasterize( view.impl(), slow );
+  ASSERT_EQ( slow.cols(), fast.cols() );
+  ASSERT_EQ( slow.rows(), fast.rows() );
+  for ( int32 j = 0; j < fast.rows(); ++j )
+    for ( int32 i = 0; i < fast.cols(); ++i )
+      EXPECT_EQ( slow(i,j), fast(i,j) ) << "at " << i << "," << j;
+
+  // A sub-region goes through the kernels too.
+  ImageView<pixel_type> part = crop( view.impl(), 3, 1, fast.cols()-5, fast.rows()-2 );
+  for ( int32 j = 0; j < part.rows(); ++j )
+    for ( int32 i = 0; i < part.cols(); ++i )
+      EXPECT_EQ( fast(i+3,j+1), part(i,j) );
+}
+
+TEST( ImageMath, Kernels ) {
+  ImageView<float> a(37,5), b(37,5);
+  ImageView<PixelRGB<double> > c(37,5), d(37,5);
+  for ( int32 j = 0; j < a.rows(); ++j )
+    for ( int32 i = 0; i < a.cols(); ++i ) {
+      a(i,j) = float(i) - 2.5f*float(j);
+      b(i,j) = (i % 4 == 0) ? 0.0f : float(j) + 0.25f*float(i);
+      c(i,j) = PixelRGB<double>( i, -j, 0.5*i );
+      d(i,j) = PixelRGB<double>( j+1, 2, -0.25*i-1 );
+    }
+
+  expect_kernel_matches( a + b );
+  expect_kernel_matches( a - b );
+  expect_kernel_matches( a * b );
+  expect_kernel_matches( a / b );
+  expect_kernel_matches( a + 1.5f );
+  expect_kernel_matches( 1.5f - a );
+  expect_kernel_matches( a * 3.0f );
+  expect_kernel_matches( a / 4.0f );
+  expect_kernel_matches( a / 0.0f );
+  expect_kernel_matches( 2.0f / b );
+  expect_kernel_matches( abs(a) );
+
+  expect_kernel_matches( c + d );
+  expect_kernel_matches( c - d );
+  expect_kernel_matches( c * d );
+  expect_kernel_matches( c * 0.5 );
+  expect_kernel_matches( 0.5 - c );
+  expect_kernel_matches( c / 2.0 );
+}
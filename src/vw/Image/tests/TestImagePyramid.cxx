@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestImagePyramid.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/ImagePyramid.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/Algorithms.h>
+
+using namespace vw;
+
+static const float kernel5[5] = { 1/16.f, 4/16.f, 6/16.f, 4/16.f, 1/16.f };
+
+TEST( ImagePyramid, Downsample ) {
+  ImageView<float> src(13,10);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = float( (i*7 + j*5) % 11 );
+  ImageView<float> dst = pyramid_downsample( src, ReflectEdgeExtension() );
+  ASSERT_EQ( dst.cols(), 7 );
+  ASSERT_EQ( dst.rows(), 5 );
+
+  EdgeExtensionView<ImageView<float>, ReflectEdgeExtension> ext = edge_extend( src, ReflectEdgeExtension() );
+  for( int32 y=0; y<dst.rows(); ++y )
+    for( int32 x=0; x<dst.cols(); ++x ) {
+      float sum = 0;
+      for( int32 j=0; j<5; ++j )
+        for( int32 i=0; i<5; ++i )
+          sum += kernel5[i] * kernel5[j] * ext(2*x+i-2, 2*y+j-2);
+      EXPECT_NEAR( dst(x,y), sum, 1e-4 );
+    }
+
+  // Partial rasterization agrees
+  ImageView<float> part = crop( pyramid_downsample( src, ReflectEdgeExtension() ), 2, 1, 4, 3 );
+  for( int32 y=0; y<part.rows(); ++y )
+    for( int32 x=0; x<part.cols(); ++x )
+      EXPECT_FLOAT_EQ( dst(x+2,y+1), part(x,y) );
+
+  // A constant image stays constant, with integer rounding
+  ImageView<PixelRGB<uint8> > rgb(9,6);
+  fill( rgb, PixelRGB<uint8>(10,200,255) );
+  ImageView<PixelRGB<uint8> > rgb_dst = pyramid_downsample( rgb );
+  EXPECT_EQ( rgb_dst.cols(), 5 );
+  EXPECT_EQ( rgb_dst(2,1), PixelRGB<uint8>(10,200,255) );
+  EXPECT_EQ( rgb_dst(4,2), PixelRGB<uint8>(10,200,255) );
+}
+
+TEST( ImagePyramid, Upsample ) {
+  ImageView<float> src(4,3);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = float( i + 4*j );
+  ImageView<float> dst = pyramid_upsample( src, 8, 6 );
+  ASSERT_EQ( dst.cols(), 8 );
+  ASSERT_EQ( dst.rows(), 6 );
+  // A linear ramp is reproduced away from the edges
+  for( int32 y=1; y<4; ++y )
+    for( int32 x=1; x<6; ++x )
+      EXPECT_NEAR( dst(x,y), x/2.0 + 4*(y/2.0), 1e-5 );
+
+  ImageView<float> part = crop( pyramid_upsample( src, 8, 6 ), 3, 1, 4, 4 );
+  for( int32 y=0; y<part.rows(); ++y )
+    for( int32 x=0; x<part.cols(); ++x )
+      EXPECT_FLOAT_EQ( dst(x+3,y+1), part(x,y) );
+}
+
+TEST( ImagePyramid, Levels ) {
+  ImageView<uint8> src(100,37);
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      src(i,j) = uint8( (i*13 + j*29) % 256 );
+
+  ImagePyramidView<uint8> pyramid( src, 0, Vector2i(16,16) );
+  ASSERT_EQ( pyramid.num_levels(), 7 );
+  EXPECT_EQ( pyramid[1].cols(), 50 );
+  EXPECT_EQ( pyramid[1].rows(), 19 );
+  EXPECT_EQ( pyramid[6].cols(), 2 );
+  EXPECT_EQ( pyramid[6].rows(), 1 );
+
+  // Cached levels match a direct computation, and copies share them.
+  ImageView<uint8> level2 = pyramid_downsample( pyramid_downsample( src ) );
+  ImagePyramidView<uint8> copy = pyramid;
+  ImageView<uint8> cached = copy.level(2);
+  ASSERT_EQ( cached.cols(), level2.cols() );
+  for( int32 j=0; j<level2.rows(); ++j )
+    for( int32 i=0; i<level2.cols(); ++i )
+      EXPECT_EQ( level2(i,j), cached(i,j) );
+
+  // The Laplacian levels reconstruct the source
+  ImagePyramidView<float> fpyramid( channel_cast<float>(src), 3 );
+  ASSERT_EQ( fpyramid.num_levels(), 3 );
+  ImageView<float> top = fpyramid.laplacian(2);
+  ImageView<float> rebuilt = fpyramid.laplacian(1) + pyramid_upsample( top, fpyramid[1].cols(), fpyramid[1].rows() );
+  ImageView<float> base = fpyramid.laplacian(0) + pyramid_upsample( rebuilt, src.cols(), src.rows() );
+  for( int32 j=0; j<src.rows(); ++j )
+    for( int32 i=0; i<src.cols(); ++i )
+      EXPECT_NEAR( base(i,j), src(i,j), 1e-3 );
+
+  ASSERT_THROW( pyramid.level(7), ArgumentErr );
+}
@@ -9,6 +9,9 @@
 
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageResourceImpl.h>
+#include <vw/Image/ImageResourceView.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/ViewImageResource.h>
 #include <vw/Image/PixelTypeInfo.h>
 #include <vw/Image/PixelTypes.h>
 
@@ -63,6 +66,95 @@ TEST( ImageResource, PreMultiply ) {
   EXPECT_RANGE_EQ(buf3_data+0, buf3_data+4, buf1_data+0, buf1_data+4);
 }
 
+// The packed fast path and the per-pixel path of convert() must agree
+// on every value, including the ends of rows that don't fill a full
+// vector.
+TEST( ImageResource, ConvertRescale ) {
+  const int32 cols = 37, rows = 3;
+  ImageFormat fmt;
+  fmt.cols = cols;
+  fmt.rows = rows;
+  fmt.planes = 1;
+  fmt.pixel_format = VW_PIXEL_GRAY;
+
+  std::vector<uint8> u8( cols*rows );
+  std::vector<uint16> u16( cols*rows );
+  std::vector<float> f32( cols*rows );
+  for( size_t i=0; i<u8.size(); ++i ) {
+    u8[i] = uint8( i*7 );
+    u16[i] = uint16( i*1777 );
+    f32[i] = float( int32(i) - 10 ) / 80;
+  }
+
+  ImageFormat u8_fmt = fmt, u16_fmt = fmt, f32_fmt = fmt;
+  u8_fmt.channel_type = VW_CHANNEL_UINT8;
+  u16_fmt.channel_type = VW_CHANNEL_UINT16;
+  f32_fmt.channel_type = VW_CHANNEL_FLOAT32;
+
+  std::vector<float> f32_out( cols*rows );
+  convert( ImageBuffer( f32_fmt, &f32_out[0] ), ImageBuffer( u8_fmt, &u8[0] ), true );
+  for( size_t i=0; i<u8.size(); ++i )
+    EXPECT_EQ( float(u8[i]) * (1.0f/255), f32_out[i] );
+
+  std::vector<uint8> u8_out( cols*rows );
+  convert( ImageBuffer( u8_fmt, &u8_out[0] ), ImageBuffer( f32_fmt, &f32[0] ), true );
+  for( size_t i=0; i<f32.size(); ++i )
+    EXPECT_EQ( f32[i] > 1 ? 255 : f32[i] < 0 ? 0 : uint8(f32[i]*255), u8_out[i] );
+
+  convert( ImageBuffer( u8_fmt, &u8_out[0] ), ImageBuffer( u16_fmt, &u16[0] ), true );
+  for( size_t i=0; i<u16.size(); ++i )
+    EXPECT_EQ( u16[i] / 257, u8_out[i] );
+
+  // Without rescaling the values are just cast.
+  convert( ImageBuffer( f32_fmt, &f32_out[0] ), ImageBuffer( u16_fmt, &u16[0] ) );
+  for( size_t i=0; i<u16.size(); ++i )
+    EXPECT_EQ( float(u16[i]), f32_out[i] );
+
+  // Every other column only, which can't take the packed path.
+  ImageFormat half_fmt = u8_fmt;
+  half_fmt.cols = (cols+1)/2;
+  ImageBuffer src( half_fmt, &u8[0] );
+  src.cstride *= 2;
+  src.rstride = cols;
+  half_fmt.channel_type = VW_CHANNEL_FLOAT32;
+  std::vector<float> half_out( half_fmt.cols*rows );
+  convert( ImageBuffer( half_fmt, &half_out[0] ), src, true );
+  for( int32 r=0; r<rows; ++r )
+    for( uint32 c=0; c<half_fmt.cols; ++c )
+      EXPECT_EQ( float(u8[r*cols+2*c]) * (1.0f/255), half_out[r*half_fmt.cols+c] );
+}
+
+// Conversions that change the pixel format go through the per-pixel
+// path.
+TEST( ImageResource, ConvertPixelFormat ) {
+  PixelRGB<uint8> rgb_data[3] = { PixelRGB<uint8>(30,60,90), PixelRGB<uint8>(255,0,0), PixelRGB<uint8>(1,2,3) };
+  PixelGrayA<float> graya_data[3];
+  PixelRGBA<uint16> rgba_data[3];
+
+  ImageFormat fmt;
+  fmt.cols = 3;
+  fmt.rows = 1;
+  fmt.planes = 1;
+  fmt.pixel_format = VW_PIXEL_RGB;
+  fmt.channel_type = VW_CHANNEL_UINT8;
+  ImageBuffer rgb( fmt, rgb_data );
+  fmt.pixel_format = VW_PIXEL_GRAYA;
+  fmt.channel_type = VW_CHANNEL_FLOAT32;
+  ImageBuffer graya( fmt, graya_data );
+  fmt.pixel_format = VW_PIXEL_RGBA;
+  fmt.channel_type = VW_CHANNEL_UINT16;
+  ImageBuffer rgba( fmt, rgba_data );
+
+  convert( graya, rgb, true );
+  EXPECT_FLOAT_EQ( 60.0f/255, graya_data[0].v() );
+  EXPECT_FLOAT_EQ( 85.0f/255, graya_data[1].v() );
+  EXPECT_FLOAT_EQ( 1, graya_data[0].a() );
+
+  convert( rgba, rgb, true );
+  EXPECT_EQ( PixelRGBA<uint16>(30*257,60*257,90*257,65535), rgba_data[0] );
+  EXPECT_EQ( PixelRGBA<uint16>(257,514,771,65535), rgba_data[2] );
+}
+
 class SrcNoopResource : public SrcImageResource {
   private:
     const ImageFormat& m_fmt;
@@ -82,6 +174,33 @@ class SrcNoopResource : public SrcImageResource {
     }
 };
 
+TEST( ImageResource, ConvertIsCopy ) {
+  ImageFormat a, b;
+  a.cols = a.rows = 4;
+  a.planes = 1;
+  a.pixel_format = VW_PIXEL_RGB;
+  a.channel_type = VW_CHANNEL_UINT8;
+  b = a;
+  b.cols = 2;
+  EXPECT_TRUE( convert_is_copy( a, b ) );
+
+  b.channel_type = VW_CHANNEL_UINT16;
+  EXPECT_FALSE( convert_is_copy( a, b ) );
+  b.channel_type = VW_CHANNEL_UINT8;
+  b.pixel_format = VW_PIXEL_RGBA;
+  EXPECT_FALSE( convert_is_copy( a, b ) );
+  b.pixel_format = VW_PIXEL_RGB;
+  b.planes = 3;
+  EXPECT_FALSE( convert_is_copy( a, b ) );
+  b.planes = 1;
+
+  // Premultiplication only matters with alpha.
+  b.premultiplied = ! a.premultiplied;
+  EXPECT_TRUE( convert_is_copy( a, b ) );
+  a.pixel_format = b.pixel_format = VW_PIXEL_RGBA;
+  EXPECT_FALSE( convert_is_copy( a, b ) );
+}
+
 TEST( ImageResource, NativePtr ) {
   ImageFormat fmt;
   fmt.cols = fmt.rows = 2;
@@ -454,3 +573,276 @@ TEST_F(ImageResourceOpenCVTest, OpenCv_Write_Discont) {
 }
 
 #endif
+
+TEST( ImageResource, ReadAhead ) {
+  ImageView<float> image(30,20);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = float( x + 100*y );
+
+  ImageResourceView<float> view( new ViewImageResource( image, Vector2i(8,8) ) );
+  view.set_read_ahead( 2 );
+
+  // Walk the blocks the way block_write_image does.
+  int32 requests = 0;
+  for( int32 y=0; y<image.rows(); y+=8 )
+    for( int32 x=0; x<image.cols(); x+=8 ) {
+      BBox2i bbox( x, y, 8, 8 );
+      bbox.crop( BBox2i(0,0,image.cols(),image.rows()) );
+      ImageView<float> block = crop( view, bbox );
+      ++requests;
+      for( int32 j=0; j<block.rows(); ++j )
+        for( int32 i=0; i<block.cols(); ++i )
+          EXPECT_EQ( image(x+i,y+j), block(i,j) );
+    }
+
+  ReadAheadStats stats = view.read_ahead_stats();
+  EXPECT_EQ( uint64(requests), stats.hits + stats.misses );
+  EXPECT_GE( stats.issued, stats.hits );
+
+  // A sub-block request and an unrelated jump are still served correctly.
+  ImageView<float> part = crop( view, BBox2i(9,1,4,5) );
+  EXPECT_EQ( image(9,1), part(0,0) );
+  EXPECT_EQ( image(12,5), part(3,4) );
+  part = crop( view, BBox2i(3,12,10,3) );
+  EXPECT_EQ( image(3,12), part(0,0) );
+  EXPECT_EQ( image(12,14), part(9,2) );
+
+  view.set_read_ahead( 0 );
+  EXPECT_EQ( 0u, view.read_ahead_stats().hits );
+}
+
+TEST( ImageResource, ReadAsync ) {
+  ImageView<float> image(30,20);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = float( x + 100*y );
+  ViewImageResource rsrc( image, Vector2i(8,8) );
+
+  ImageView<float> part(10,5);
+  Future<void> done = rsrc.read_async( part.buffer(), BBox2i(12,3,10,5) );
+  done.get();
+  EXPECT_TRUE( done.is_ready() );
+  for( int32 y=0; y<part.rows(); ++y )
+    for( int32 x=0; x<part.cols(); ++x )
+      EXPECT_EQ( image(12+x,3+y), part(x,y) );
+
+  // Errors come back through the handle.
+  EXPECT_THROW( rsrc.read_async( part.buffer(), BBox2i(12,3,9,5) ).get(), Exception );
+}
+
+TEST( ImageResource, Prefetch ) {
+  ImageView<float> image(30,20);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = float( x + 100*y );
+
+  ImageResourceView<float> view( new ViewImageResource( image, Vector2i(8,8) ) );
+  view.prefetch( BBox2i(8,8,8,8) );
+  ImageView<float> part = crop( view, BBox2i(9,10,4,5) );
+  EXPECT_EQ( image(9,10), part(0,0) );
+  EXPECT_EQ( image(12,14), part(3,4) );
+  ReadAheadStats stats = view.read_ahead_stats();
+  EXPECT_EQ( 1u, stats.hits + stats.misses );
+
+  // Rasterizing in blocks prefetches the blocks further on, with or
+  // without a cache.
+  Cache cache( 1024*1024 );
+  for( int pass=0; pass<2; ++pass ) {
+    ImageResourceView<float> child( new ViewImageResource( image, Vector2i(8,8) ) );
+    BlockRasterizeView<ImageResourceView<float> > blocks( child, Vector2i(8,8), 2, pass ? &cache : 0 );
+    ImageView<float> result = blocks;
+    ASSERT_EQ( image.cols(), result.cols() );
+    for( int32 y=0; y<image.rows(); ++y )
+      for( int32 x=0; x<image.cols(); ++x )
+        EXPECT_EQ( image(x,y), result(x,y) );
+    stats = child.read_ahead_stats();
+    EXPECT_GE( stats.issued, stats.hits );
+    EXPECT_GT( stats.issued + stats.misses, 0u );
+  }
+}
+
+// Stores each block as its pixels plus one, "encoded" off the writer.
+class EncodingDstResource : public DstImageResource {
+  public:
+    ImageView<uint8> image;
+    std::vector<BBox2i> order;
+    int raw_writes;
+
+    EncodingDstResource( int32 cols, int32 rows ) : image(cols,rows), raw_writes(0) {}
+
+    virtual void write( ImageBuffer const& /*buf*/, BBox2i const& /*bbox*/ ) { ++raw_writes; }
+    virtual bool has_block_write() const  {return true;}
+    virtual Vector2i block_write_size() const {return Vector2i(8,4);}
+    virtual bool has_nodata_write() const {return false;}
+    virtual void flush() {}
+
+    virtual bool has_block_encode() const {return true;}
+    virtual void encode_block( ImageBuffer const& buf, BBox2i const& bbox, std::vector<uint8>& encoded ) const {
+      ImageView<uint8> block( bbox.width(), bbox.height() );
+      convert( block.buffer(), buf );
+      for( ImageView<uint8>::iterator i = block.begin(); i != block.end(); ++i )
+        encoded.push_back( uint8(*i + 1) );
+    }
+    virtual void write_encoded_block( std::vector<uint8> const& encoded, BBox2i const& bbox ) {
+      order.push_back( bbox );
+      size_t k = 0;
+      for( int32 y=bbox.min().y(); y<bbox.max().y(); ++y )
+        for( int32 x=bbox.min().x(); x<bbox.max().x(); ++x )
+          image(x,y) = uint8( encoded.at(k++) - 1 );
+    }
+};
+
+TEST( ImageResource, BlockEncode ) {
+  ImageView<uint8> image(20,10);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = uint8( x + 20*y );
+
+  EncodingDstResource resource( image.cols(), image.rows() );
+  block_write_image( resource, image );
+
+  EXPECT_EQ( 0, resource.raw_writes );
+  ASSERT_EQ( 9u, resource.order.size() );
+  for( size_t i=1; i<resource.order.size(); ++i ) {
+    BBox2i const& prev = resource.order[i-1];
+    BBox2i const& next = resource.order[i];
+    EXPECT_TRUE( prev.min().y() < next.min().y() ||
+                 (prev.min().y() == next.min().y() && prev.min().x() < next.min().x()) );
+  }
+  EXPECT_RANGE_EQ( image.begin(), image.end(), resource.image.begin(), resource.image.end() );
+}
+
+// Takes full-width strips from the top down, as scanline formats do.
+class ScanlineDstResource : public DstImageResource {
+  public:
+    ImageView<uint8> image;
+    std::vector<BBox2i> order;
+
+    ScanlineDstResource( int32 cols, int32 rows ) : image(cols,rows) {}
+
+    virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+      int32 next_row = order.empty() ? 0 : order.back().max().y();
+      ASSERT_EQ( next_row, bbox.min().y() );
+      ASSERT_EQ( image.cols(), bbox.width() );
+      order.push_back( bbox );
+      ImageView<uint8> strip( bbox.width(), bbox.height() );
+      convert( strip.buffer(), buf );
+      crop( image, bbox ) = strip;
+    }
+    virtual bool has_block_write() const  {return false;}
+    virtual bool has_scanline_write() const {return true;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual void flush() {}
+};
+
+TEST( ImageResource, StreamWrite ) {
+  ImageView<uint8> image(20,10);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = uint8( x + 20*y );
+
+  ScanlineDstResource resource( image.cols(), image.rows() );
+  stream_write_image( resource, image, 3 );
+
+  ASSERT_EQ( 4u, resource.order.size() );
+  EXPECT_EQ( 3, resource.order[0].height() );
+  EXPECT_EQ( 1, resource.order[3].height() );
+  EXPECT_RANGE_EQ( image.begin(), image.end(), resource.image.begin(), resource.image.end() );
+
+  EncodingDstResource blocks( image.cols(), image.rows() );
+  EXPECT_THROW( stream_write_image( blocks, image ), NoImplErr );
+}
+
+TEST( ImageResource, TuneBlockWrite ) {
+  ImageView<uint8> image(64,40);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = uint8( x + 64*y );
+
+  size_t cache_size = vw_settings().system_cache_size();
+
+  // With plenty of memory, some multiple of the resource's block size
+  // is chosen and the rest of the memory goes to the cache.
+  EncodingDstResource resource( image.cols(), image.rows() );
+  BlockWriteConfig config = tune_block_write( resource, image, 1024*1024*1024 );
+  EXPECT_EQ( 0, config.block_size.x() % 8 );
+  EXPECT_EQ( 0, config.block_size.y() % 4 );
+  EXPECT_LE( config.block_size.x(), 64 );
+  EXPECT_LE( config.block_size.y(), 32 );
+  EXPECT_GE( config.num_threads, 1 );
+  EXPECT_LE( config.num_threads, int32(vw_settings().default_num_threads()) );
+  EXPECT_GT( config.cache_size, 0u );
+
+  block_write_image( resource, image, config );
+  EXPECT_RANGE_EQ( image.begin(), image.end(), resource.image.begin(), resource.image.end() );
+  EXPECT_EQ( config.block_size, resource.order[0].size() );
+  EXPECT_EQ( cache_size, vw_settings().system_cache_size() );
+
+  // Without enough memory for even one block, the smallest blocks on
+  // one thread are chosen and the cache is left alone.
+  config = tune_block_write( resource, image, 16 );
+  EXPECT_EQ( Vector2i(8,4), config.block_size );
+  EXPECT_EQ( 1, config.num_threads );
+  EXPECT_EQ( 0u, config.cache_size );
+
+  // Resources without block writes only get a cache size.
+  ScanlineDstResource scanlines( image.cols(), image.rows() );
+  config = tune_block_write( scanlines, image, 1024*1024 );
+  EXPECT_EQ( Vector2i(), config.block_size );
+  EXPECT_EQ( 1024*1024 - image.cols()*image.rows(), int32(config.cache_size) );
+}
+
+// Reads itself reduced by 2 as the top left pixel of each square plus
+// 100, so reduced reads can be told from full ones.
+class ReducingSrcResource : public SrcImageResource {
+  public:
+    ImageView<uint8> image;
+    mutable int reduced_reads;
+
+    ReducingSrcResource( ImageView<uint8> const& image ) : image(image), reduced_reads(0) {}
+
+    virtual ImageFormat format() const { return image.format(); }
+    virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+      ImageView<uint8> block = crop( image, bbox );
+      convert( buf, block.buffer() );
+    }
+    virtual bool has_block_read() const  {return false;}
+    virtual bool has_nodata_read() const {return false;}
+
+    virtual int32 reduced_read_factor( int32 scale ) const { return scale >= 2 ? 2 : 1; }
+    virtual void read_reduced( ImageBuffer const& buf, BBox2i const& bbox, int32 factor ) const {
+      ASSERT_EQ( 2, factor );
+      ++reduced_reads;
+      ImageView<uint8> reduced( bbox.width(), bbox.height() );
+      for( int32 y=0; y<bbox.height(); ++y )
+        for( int32 x=0; x<bbox.width(); ++x )
+          reduced(x,y) = uint8( image( 2*(bbox.min().x()+x), 2*(bbox.min().y()+y) ) + 100 );
+      convert( buf, reduced.buffer() );
+    }
+};
+
+TEST( ImageResource, ReducedRead ) {
+  ImageView<uint8> image(13,9);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = uint8( x + 13*y );
+
+  ReducingSrcResource *resource = new ReducingSrcResource( image );
+  ImageResourceView<uint8> view( resource );
+
+  ImageView<uint8> result = subsample( view, 4 );
+  ImageView<uint8> expected = subsample( image, 4 );
+  EXPECT_EQ( 1, resource->reduced_reads );
+  ASSERT_EQ( expected.cols(), result.cols() );
+  ASSERT_EQ( expected.rows(), result.rows() );
+  for( int32 y=0; y<result.rows(); ++y )
+    for( int32 x=0; x<result.cols(); ++x )
+      EXPECT_EQ( expected(x,y) + 100, result(x,y) );
+
+  // An odd factor can't use the reduced read.
+  result = subsample( view, 3, 4 );
+  expected = subsample( image, 3, 4 );
+  EXPECT_EQ( 1, resource->reduced_reads );
+  EXPECT_RANGE_EQ( expected.begin(), expected.end(), result.begin(), result.end() );
+}
@@ -5,13 +5,16 @@
 // __END_LICENSE__
 
 
+#include <sstream>
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ViewImageResource.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Core/Settings.h>
 
 using namespace vw;
 
@@ -333,3 +336,156 @@ TEST(ImageView, Equality) {
   EXPECT_NE(b,d);
   EXPECT_NE(c,d);
 }
+
+TEST(ImageView, CacheSpill) {
+  typedef CacheSpillTraits<ImageView<PixelRGB<float> > > traits;
+  ASSERT_TRUE(traits::value);
+
+  ImageView<PixelRGB<float> > image(3,2);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      image(i,j) = PixelRGB<float>(float(i), float(j), 0.5f);
+
+  std::stringstream stream;
+  traits::write(stream, image);
+  boost::shared_ptr<ImageView<PixelRGB<float> > > copy = traits::read(stream);
+  ASSERT_TRUE(bool(copy));
+  EXPECT_EQ(image.cols(), copy->cols());
+  EXPECT_EQ(image.rows(), copy->rows());
+  EXPECT_EQ(image.planes(), copy->planes());
+  EXPECT_RANGE_EQ(image.begin(), image.end(), copy->begin(), copy->end());
+
+  std::stringstream truncated(stream.str().substr(0, 4));
+  EXPECT_FALSE(bool(traits::read(truncated)));
+}
+
+TEST(ImageView, BufferPool) {
+  vw_settings().set_buffer_pool_size(16*1024*1024);
+  BufferPool& pool = vw_buffer_pool();
+  uint64 hits = pool.hits();
+
+  const float* first;
+  {
+    ImageView<PixelRGB<float> > image(512,512);
+    first = &image(0,0)[0];
+    image(0,0) = image(511,511) = PixelRGB<float>(1,2,3);
+  }
+  {
+    // The recycled buffer must still come back zeroed.
+    ImageView<PixelRGB<float> > image(512,512);
+    EXPECT_EQ(first, &image(0,0)[0]);
+    EXPECT_EQ(hits+1, pool.hits());
+    EXPECT_EQ(PixelRGB<float>(), image(0,0));
+    EXPECT_EQ(PixelRGB<float>(), image(511,511));
+  }
+
+  vw_settings().set_buffer_pool_size(0);
+  pool.clear();
+}
+
+TEST(ImageView, RowAlignment) {
+  typedef PixelRGB<uint8> Px;
+  ImageView<Px> image(13,5,2,32);
+  EXPECT_EQ(32, image.row_alignment());
+  EXPECT_FALSE(image.contiguous());
+  for (int32 p = 0; p < image.planes(); ++p)
+    for (int32 j = 0; j < image.rows(); ++j) {
+      EXPECT_EQ(0u, reinterpret_cast<size_t>(&image(0,j,p)) % 32);
+      for (int32 i = 0; i < image.cols(); ++i) {
+        EXPECT_EQ(Px(), image(i,j,p));
+        image(i,j,p) = Px(uint8(i), uint8(j), uint8(p));
+      }
+    }
+
+  ImageBuffer buf = image.buffer();
+  EXPECT_EQ(0, buf.rstride % 32);
+  EXPECT_EQ(buf.rstride * image.rows(), buf.pstride);
+
+  // Views onto the padded image follow its strides.
+  ImageView<Px> cropped = crop(image, 3, 1, 7, 3);
+  EXPECT_EQ(Px(3,1,0), cropped(0,0));
+  EXPECT_EQ(Px(9,3,0), cropped(6,2));
+  ImageView<Px> plane = select_plane(image, 1);
+  EXPECT_EQ(Px(12,4,1), plane(12,4));
+
+  // Rasterizing between padded and packed images.
+  BBox2i bbox(0,0,13,5);
+  ImageView<Px> packed(13,5,2);
+  EXPECT_TRUE(packed.contiguous());
+  image.rasterize(packed, bbox);
+  EXPECT_RANGE_EQ(image.begin(), image.end(), packed.begin(), packed.end());
+  ImageView<Px> padded(13,5,2,64);
+  packed.rasterize(padded, bbox);
+  EXPECT_RANGE_EQ(image.begin(), image.end(), padded.begin(), padded.end());
+  packed = padded;
+  EXPECT_EQ(64, packed.row_alignment());
+  EXPECT_EQ(0u, reinterpret_cast<size_t>(&packed(0,3,1)) % 64);
+  EXPECT_RANGE_EQ(image.begin(), image.end(), packed.begin(), packed.end());
+
+  // Resizing keeps the alignment.
+  packed.set_size(4,4);
+  EXPECT_EQ(64, packed.row_alignment());
+  EXPECT_EQ(0u, reinterpret_cast<size_t>(&packed(0,1)) % 64);
+
+  std::stringstream stream;
+  CacheSpillTraits<ImageView<Px> >::write(stream, image);
+  boost::shared_ptr<ImageView<Px> > copy = CacheSpillTraits<ImageView<Px> >::read(stream);
+  ASSERT_TRUE(bool(copy));
+  EXPECT_RANGE_EQ(image.begin(), image.end(), copy->begin(), copy->end());
+
+  EXPECT_THROW(ImageView<Px>(4,4,1,24), ArgumentErr);
+}
+
+TEST(ImageView, RowAlignmentWidePixels) {
+  // A pixel that is a multiple of the allocator's alignment cannot
+  // reach a wider alignment by whole-pixel steps.
+  typedef PixelRGBA<double> Px;
+  for (int32 n = 1; n < 8; ++n) {
+    ImageView<Px> image(n,3,2,64);
+    for (int32 p = 0; p < image.planes(); ++p)
+      for (int32 j = 0; j < image.rows(); ++j) {
+        EXPECT_EQ(0u, reinterpret_cast<size_t>(&image(0,j,p)) % 64);
+        EXPECT_EQ(Px(), image(n-1,j,p));
+      }
+  }
+
+  // An alignment below the pixel's own keeps the pixels aligned.
+  ImageView<PixelRGB<float> > narrow(5,3,1,2);
+  EXPECT_EQ(0u, reinterpret_cast<size_t>(&narrow(0,0)) % boost::alignment_of<PixelRGB<float> >::value);
+}
+
+namespace {
+  struct CountingDeleter {
+    int* count;
+    CountingDeleter( int* count ) : count(count) {}
+    void operator()( float* data ) const { ++*count; delete[] data; }
+  };
+}
+
+TEST(ImageView, ExternalStrides) {
+  // A 3x2 image in the top left of a 5x4 buffer, as another library
+  // might hand over a region of interest with padded rows.
+  int deleted = 0;
+  float* memory = new float[20];
+  for (int i = 0; i < 20; ++i) memory[i] = float(i);
+  {
+    boost::shared_array<float> data( memory, CountingDeleter(&deleted) );
+    ImageView<float> image( data, memory + 6, 3, 2, 1, 1, 5, 10 );
+    data.reset();
+    EXPECT_EQ(3, image.cols());
+    EXPECT_EQ(2, image.rows());
+    EXPECT_FALSE(image.contiguous());
+    EXPECT_EQ(6, image(0,0));
+    EXPECT_EQ(13, image(2,1));
+
+    // Writes go to the shared memory, and copies keep it alive.
+    image(1,1) = -1;
+    EXPECT_EQ(-1, memory[12]);
+    ImageView<float> copy = image;
+    image.reset();
+    EXPECT_EQ(0, deleted);
+    ImageView<float> packed = crop(copy, 0, 0, 3, 2);
+    EXPECT_EQ(-1, packed(1,1));
+  }
+  EXPECT_EQ(1, deleted);
+}
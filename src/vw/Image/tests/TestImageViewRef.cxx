@@ -63,3 +63,31 @@ TEST( ImageViewRef, Construct ) {
     EXPECT_EQ( *i, (float)(val) );
 }
 
+
+TEST( ImageViewRef, BlockRasterize ) {
+  ImageView<float> image(7,5);
+  for( int r=0; r<image.rows(); ++r )
+    for( int c=0; c<image.cols(); ++c )
+      image(c,r) = (float)(r*image.cols()+c);
+  ImageViewRef<float> ref = crop( image, 1, 1, 5, 4 );
+
+  // A cropped destination is handed to the bound view directly.
+  ImageView<float> dest(5,4);
+  ref.rasterize( crop( dest, 1, 0, 3, 4 ), BBox2i(1,0,3,4) );
+  for( int r=0; r<4; ++r )
+    for( int c=1; c<4; ++c )
+      EXPECT_EQ( dest(c,r), image(c+1,r+1) );
+
+  // Reading a row segment through the accessor
+  float span[4];
+  ImageViewRef<float>::pixel_accessor acc = ref.origin();
+  acc.advance( 1, 2 );
+  acc.read_span( span, 4 );
+  for( int c=0; c<4; ++c )
+    EXPECT_EQ( span[c], ref(c+1,2) );
+  EXPECT_EQ( *acc, ref(1,2) );
+
+  ImageViewRef<float>::pixel_accessor acc2 = ref.origin();
+  acc2 = acc;
+  EXPECT_EQ( *acc2, ref(1,2) );
+}
@@ -9,7 +9,10 @@
 #include <gtest/gtest.h>
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/PixelMask.h>
 
 using namespace vw;
 
@@ -79,6 +82,62 @@ TEST( Interpolation, Nearest ) {
   ASSERT_FALSE( bool_trait<IsMultiplyAccessible>( interpolate(im, NearestPixelInterpolation()) ) );
 }
 
+// Integer images are sampled in fixed point; they must agree with the
+// floating-point path to within one level.
+template <class ChannelT, class InterpT>
+static void check_fixed_point( InterpT const& interp, double scale ) {
+  typedef PixelRGB<ChannelT> Px;
+  ImageView<Px> im(9,7);
+  ImageView<PixelRGB<float> > ref(9,7);
+  for ( int32 j=0; j<im.rows(); ++j )
+    for ( int32 i=0; i<im.cols(); ++i ) {
+      im(i,j) = Px( ChannelT(scale*((i*37+j*11)%16)), ChannelT(scale*((i*i+3*j)%16)), ChannelT(scale*(j%2 ? 15 : 0)) );
+      ref(i,j) = PixelRGB<float>( im(i,j) );
+    }
+  InterpolationView<EdgeExtensionView<ImageView<Px>, ConstantEdgeExtension>, InterpT> fixed = interpolate(im, interp);
+  InterpolationView<EdgeExtensionView<ImageView<PixelRGB<float> >, ConstantEdgeExtension>, InterpT> real = interpolate(ref, interp);
+  for ( double y=-1.5; y<im.rows()+1; y+=0.37 )
+    for ( double x=-1.5; x<im.cols()+1; x+=0.29 ) {
+      Px a = fixed(x,y);
+      PixelRGB<float> b = real(x,y);
+      for ( int32 c=0; c<3; ++c ) {
+        float expected = std::min( std::max( b[c], 0.0f ), float(std::numeric_limits<ChannelT>::max()) );
+        EXPECT_NEAR( expected, float(a[c]), 1.0 ) << x << "," << y;
+      }
+    }
+}
+
+TEST( Interpolation, FixedPoint ) {
+  check_fixed_point<uint8>( BilinearInterpolation(), 17 );
+  check_fixed_point<uint16>( BilinearInterpolation(), 4369 );
+  check_fixed_point<uint8>( BicubicInterpolation(), 17 );
+  check_fixed_point<uint16>( BicubicInterpolation(), 4369 );
+
+  // Exact at the pixel centers.
+  ImageView<uint8> im(4,4);
+  im(1,1) = 200; im(2,1) = 100;
+  EXPECT_EQ( 200, interpolate(im, BilinearInterpolation())(1,1) );
+  EXPECT_EQ( 150, interpolate(im, BilinearInterpolation())(1.5,1) );
+  EXPECT_EQ( 100, interpolate(im, BicubicInterpolation())(2,1) );
+}
+
+TEST( Interpolation, FixedPointMasked ) {
+  // Masked pixels take the generic path, so a footprint that touches
+  // an invalid pixel gives an invalid result.
+  ImageView<PixelMask<uint8> > im(8,8);
+  fill( im, PixelMask<uint8>(100) );
+  for ( int32 row = 0; row < im.rows(); ++row )
+    im(5,row).invalidate();
+
+  EXPECT_TRUE ( is_valid( interpolate(im, BilinearInterpolation())(3.5,2.5) ) );
+  EXPECT_EQ   ( 100, interpolate(im, BilinearInterpolation())(3.5,2.5).child() );
+  EXPECT_FALSE( is_valid( interpolate(im, BilinearInterpolation())(4.5,2.5) ) );
+
+  EXPECT_TRUE ( is_valid( interpolate(im, BicubicInterpolation())(2.5,2.5) ) );
+  EXPECT_EQ   ( 100, interpolate(im, BicubicInterpolation())(2.5,2.5).child() );
+  EXPECT_FALSE( is_valid( interpolate(im, BicubicInterpolation())(3.5,2.5) ) );
+}
+
 template <class PixelT>
 class FloatingView : public ImageViewBase<FloatingView<PixelT> > {
   int32 m_cols, m_rows, m_planes;
@@ -740,7 +740,7 @@ TEST( Manipulation, SubsampleView ) {
   PrerasterizationTestView ptv(4,4);
   SubsampleView<PrerasterizationTestView> rtv(ptv,2,2);
   ASSERT_NO_THROW( rtv.prerasterize(BBox2i(1,0,1,2)) );
-  EXPECT_EQ( ptv.bbox(), BBox2i(2,0,2,4) );
+  EXPECT_EQ( ptv.bbox(), BBox2i(2,0,1,3) );
 
   // Test the accessor / generic rasterization
   ImageView<double> im4(ssv.cols(),ssv.rows());
@@ -1056,3 +1056,49 @@ TEST(Manipulation, Equality) {
   EXPECT_NE(c,e);
   EXPECT_NE(d,e);
 }
+
+// Checks every pixel of a view rasterized into an ImageView, whole
+// and in part, against the view's own operator().
+template <class ViewT>
+static void check_permuted( ViewT const& view ) {
+  ImageView<int32> result = view;
+  ASSERT_EQ( view.cols(), result.cols() );
+  ASSERT_EQ( view.rows(), result.rows() );
+  ASSERT_EQ( view.planes(), result.planes() );
+  for( int32 p=0; p<view.planes(); ++p )
+    for( int32 j=0; j<view.rows(); ++j )
+      for( int32 i=0; i<view.cols(); ++i )
+        ASSERT_EQ( view(i,j,p), result(i,j,p) ) << i << " " << j << " " << p;
+
+  BBox2i bbox( 7, 250, 280, 40 );
+  ImageView<int32> part( bbox.width(), bbox.height(), view.planes() );
+  view.rasterize( part, bbox );
+  for( int32 p=0; p<view.planes(); ++p )
+    for( int32 j=0; j<bbox.height(); ++j )
+      for( int32 i=0; i<bbox.width(); ++i )
+        ASSERT_EQ( view(bbox.min().x()+i,bbox.min().y()+j,p), part(i,j,p) ) << i << " " << j << " " << p;
+}
+
+TEST( Manipulation, PermutedRasterize ) {
+  // Big enough to span several tiles, and two planes.
+  ImageView<int32> im(517,300,2);
+  for( int32 p=0; p<im.planes(); ++p )
+    for( int32 j=0; j<im.rows(); ++j )
+      for( int32 i=0; i<im.cols(); ++i )
+        im(i,j,p) = i + 1000*j + 1000000*p;
+
+  // Straight from memory.
+  check_permuted( transpose(im) );
+  check_permuted( rotate_180(im) );
+  check_permuted( rotate_90_cw(im) );
+  check_permuted( rotate_90_ccw(im) );
+  check_permuted( flip_vertical(im) );
+
+  // A tile at a time through the child's rasterize().
+  CopyView<ImageView<int32> > c = copy(im);
+  check_permuted( transpose(c) );
+  check_permuted( rotate_180(c) );
+  check_permuted( rotate_90_cw(c) );
+  check_permuted( rotate_90_ccw(c) );
+  check_permuted( flip_vertical(c) );
+}
@@ -0,0 +1,102 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Image/Memoize.h>
+#include <vw/Image/ImageView.h>
+
+#include <fstream>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+using namespace vw;
+using namespace vw::test;
+
+// Passes an image through, counting the regions it rasterizes.
+class CountingView : public ImageViewBase<CountingView> {
+  ImageView<float> m_image;
+  Atomic<int32>* m_count;
+public:
+  typedef float pixel_type;
+  typedef float result_type;
+  typedef ProceduralPixelAccessor<CountingView> pixel_accessor;
+
+  CountingView( ImageView<float> const& image, Atomic<int32>& count ) : m_image(image), m_count(&count) {}
+  int32 cols() const { return m_image.cols(); }
+  int32 rows() const { return m_image.rows(); }
+  int32 planes() const { return 1; }
+  pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+  float operator()( int32 x, int32 y, int32 p=0 ) const { return m_image(x,y,p); }
+
+  typedef CountingView prerasterize_type;
+  prerasterize_type prerasterize( BBox2i const& ) const { return *this; }
+  template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    ++(*m_count);
+    m_image.rasterize( dest, bbox );
+  }
+};
+
+TEST( Memoize, Persist ) {
+  UnlinkName dir("memoize-store");
+  fs::create_directory( dir );
+
+  ImageView<float> image(50,40);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = float( x*3 + y*7 );
+
+  // First run: every block is computed and stored.
+  Atomic<int32> count;
+  {
+    Cache cache( 1024*1024 );
+    ImageView<float> result = memoize( CountingView(image,count), "test|counting", dir, Vector2i(16,16), 1, cache );
+    EXPECT_EQ( 12, count.load() );
+    EXPECT_RANGE_EQ( image.begin(), image.end(), result.begin(), result.end() );
+  }
+
+  // A later run with a fresh cache reads every block back.
+  {
+    Cache cache( 1024*1024 );
+    ImageView<float> result = memoize( CountingView(image,count), "test|counting", dir, Vector2i(16,16), 2, cache );
+    EXPECT_EQ( 12, count.load() );
+    EXPECT_RANGE_EQ( image.begin(), image.end(), result.begin(), result.end() );
+  }
+
+  // A different key recomputes.
+  {
+    Cache cache( 1024*1024 );
+    ImageView<float> result = memoize( CountingView(image,count), "test|other", dir, Vector2i(16,16), 1, cache );
+    EXPECT_EQ( 24, count.load() );
+  }
+
+  // A damaged block is recomputed rather than returned.
+  {
+    std::ostringstream name;
+    name << std::hex << memo_hash( "test|counting" ) << "_" << std::dec << "16_16_16_16.vwm";
+    std::string filename = std::string(dir) + "/" + name.str();
+    ASSERT_TRUE( fs::exists( filename ) );
+    std::ofstream( filename.c_str(), std::ios::binary | std::ios::trunc ) << "garbage";
+    Cache cache( 1024*1024 );
+    ImageView<float> result = memoize( CountingView(image,count), "test|counting", dir, Vector2i(16,16), 1, cache );
+    EXPECT_EQ( 25, count.load() );
+    EXPECT_RANGE_EQ( image.begin(), image.end(), result.begin(), result.end() );
+  }
+}
+
+TEST( Memoize, Store ) {
+  UnlinkName dir("memoize-raw");
+  fs::create_directory( dir );
+  std::string bytes;
+  EXPECT_FALSE( memo_read( dir, "entry", bytes ) );
+  ASSERT_TRUE( memo_write( dir, "entry", std::string("abc\0def",7) ) );
+  ASSERT_TRUE( memo_read( dir, "entry", bytes ) );
+  EXPECT_EQ( std::string("abc\0def",7), bytes );
+  EXPECT_NE( memo_hash("a"), memo_hash("b") );
+  EXPECT_THROW( memo_file_identity( std::string(dir) + "/missing" ), IOErr );
+  EXPECT_NE( std::string::npos, memo_file_identity( std::string(dir) + "/entry" ).find( ":7:" ) );
+}
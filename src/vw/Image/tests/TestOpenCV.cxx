@@ -0,0 +1,82 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/config.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+
+#if defined(VW_HAVE_PKG_OPENCV) && (VW_HAVE_PKG_OPENCV==1)
+#include <vw/Image/OpenCV.h>
+
+using namespace vw;
+
+TEST(OpenCV, ViewOfMatrix) {
+  cv::Mat matrix( 4, 6, CV_32FC1 );
+  for (int j = 0; j < matrix.rows; ++j)
+    for (int i = 0; i < matrix.cols; ++i)
+      matrix.at<float>(j,i) = float(10*j + i);
+
+  ImageView<float> image = opencv_view<float>( matrix );
+  EXPECT_EQ(6, image.cols());
+  EXPECT_EQ(4, image.rows());
+  EXPECT_EQ(reinterpret_cast<float*>(matrix.data), image.data());
+  EXPECT_EQ(32, image(2,3));
+
+  // Writes go to the matrix, and the view keeps its data alive.
+  image(1,2) = -1;
+  EXPECT_EQ(-1, matrix.at<float>(2,1));
+  matrix.release();
+  EXPECT_EQ(-1, image(1,2));
+  EXPECT_EQ(35, image(5,3));
+}
+
+TEST(OpenCV, ViewOfRegion) {
+  cv::Mat matrix( 5, 7, CV_8UC3, cv::Scalar(0,0,0) );
+  cv::Mat roi = matrix( cv::Rect(2,1,3,2) );
+  roi.at<cv::Vec3b>(1,2) = cv::Vec3b(1,2,3);
+
+  ImageView<PixelRGB<uint8> > image = opencv_view<PixelRGB<uint8> >( roi );
+  EXPECT_EQ(3, image.cols());
+  EXPECT_EQ(2, image.rows());
+  EXPECT_FALSE(image.contiguous());
+  EXPECT_EQ(PixelRGB<uint8>(1,2,3), image(2,1));
+  EXPECT_EQ(PixelRGB<uint8>(), image(0,0));
+
+  EXPECT_THROW(opencv_view<float>( roi ), ArgumentErr);
+  EXPECT_THROW(opencv_view<PixelRGB<uint16> >( roi ), ArgumentErr);
+}
+
+TEST(OpenCV, MatrixOfView) {
+  ImageView<float> image(5,3);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      image(i,j) = float(i*j);
+
+  ImageViewMat<float> matrix( image );
+  EXPECT_EQ(CV_32FC1, matrix.type());
+  EXPECT_EQ(5, matrix.cols);
+  EXPECT_EQ(3, matrix.rows);
+  EXPECT_EQ(reinterpret_cast<uchar*>(image.data()), matrix.data);
+  EXPECT_EQ(8, matrix.at<float>(2,4));
+
+  // OpenCV operations in place change the image.
+  matrix += cv::Scalar(1);
+  EXPECT_EQ(9, image(4,2));
+
+  // And back again, still without a copy.
+  ImageView<float> view = opencv_view<float>( matrix );
+  EXPECT_EQ(image.data(), view.data());
+
+  // Multi-plane images have no matrix to share.
+  ImageView<float> planes(2,2,2);
+  EXPECT_THROW(ImageViewMat<float> bad( planes ), ArgumentErr);
+}
+
+#endif
@@ -0,0 +1,139 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/PackedMaskImageView.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Image/PixelTypes.h>
+
+using namespace vw;
+
+typedef PixelMask<float> Px;
+
+// Wide enough that rows span several mask words and end part way
+// through one.
+static ImageView<Px> test_image() {
+  ImageView<Px> image(150,5);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i) {
+      image(i,j) = Px(float(i + 1000*j));
+      // Some whole words valid, some invalid, some mixed.
+      if ((i < 64 && j % 2) || (i >= 64 && i < 128 && i % 3 == 0))
+        image(i,j).invalidate();
+    }
+  return image;
+}
+
+TEST(PackedMaskImageView, Basic) {
+  PackedMaskImageView<float> packed(70,3);
+  EXPECT_EQ(70, packed.cols());
+  EXPECT_EQ(3, packed.rows());
+  EXPECT_EQ(1, packed.planes());
+  EXPECT_EQ(2, packed.mask_words_per_row());
+  EXPECT_FALSE(is_valid(packed(69,2)));
+  EXPECT_EQ(0u, count_valid(packed));
+  EXPECT_THROW(packed.set_size(7,5,2), ArgumentErr);
+
+  // Writes through the accessor land in both planes, and are shared.
+  PackedMaskImageView<float> copy = packed;
+  *packed.origin().advance(65,1) = Px(4);
+  EXPECT_TRUE(is_valid(copy(65,1)));
+  EXPECT_EQ(4, copy(65,1).child());
+  EXPECT_EQ(4, copy.values()(65,1));
+  EXPECT_EQ(1u, count_valid(copy));
+
+  packed.set_valid(65,1,false);
+  EXPECT_FALSE(copy.is_valid(65,1));
+  EXPECT_EQ(0u, count_valid(copy));
+}
+
+TEST(PackedMaskImageView, Conversion) {
+  ImageView<Px> image = test_image();
+
+  PackedMaskImageView<float> packed = image;
+  ASSERT_EQ(image.cols(), packed.cols());
+  ASSERT_EQ(image.rows(), packed.rows());
+  size_t valid = 0;
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i) {
+      EXPECT_EQ(is_valid(image(i,j)), is_valid(packed(i,j)));
+      EXPECT_EQ(image(i,j).child(), packed(i,j).child());
+      if (is_valid(image(i,j))) ++valid;
+    }
+  EXPECT_EQ(valid, count_valid(packed));
+
+  // Back to an interleaved image, in whole and from an offset that
+  // doesn't line up with the mask words.
+  ImageView<Px> back = packed;
+  ImageView<Px> cropped = crop(packed, 37, 1, 100, 3);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i) {
+      EXPECT_EQ(is_valid(image(i,j)), is_valid(back(i,j)));
+      EXPECT_EQ(image(i,j).child(), back(i,j).child());
+    }
+  for (int32 j = 0; j < cropped.rows(); ++j)
+    for (int32 i = 0; i < cropped.cols(); ++i) {
+      EXPECT_EQ(is_valid(image(i+37,j+1)), is_valid(cropped(i,j)));
+      EXPECT_EQ(image(i+37,j+1).child(), cropped(i,j).child());
+    }
+
+  // Any other view goes through the generic path.
+  PackedMaskImageView<float> from_view = copy_mask(pixel_cast<float>(apply_mask(image)), image);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_EQ(is_valid(image(i,j)), is_valid(from_view(i,j)));
+
+  // And writing a view into part of the image.
+  PackedMaskImageView<float> part(image.cols(), image.rows());
+  crop(part, 10, 1, 80, 2) = crop(image, 10, 1, 80, 2);
+  EXPECT_FALSE(is_valid(part(9,1)));
+  EXPECT_EQ(is_valid(image(70,2)), is_valid(part(70,2)));
+  EXPECT_EQ(image(70,2).child(), part(70,2).child());
+}
+
+TEST(PackedMaskImageView, ApplyMask) {
+  ImageView<Px> image = test_image();
+  PackedMaskImageView<float> packed = image;
+
+  ImageView<float> expected = apply_mask(image, -1.0f);
+  ImageView<float> result = apply_mask(packed, -1.0f);
+  ImageView<float> cropped = crop(apply_mask(packed, -1.0f), 37, 1, 100, 3);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      EXPECT_EQ(expected(i,j), result(i,j));
+  for (int32 j = 0; j < cropped.rows(); ++j)
+    for (int32 i = 0; i < cropped.cols(); ++i)
+      EXPECT_EQ(expected(i+37,j+1), cropped(i,j));
+
+  ImageView<float> zeroed = apply_mask(packed);
+  EXPECT_EQ(0, zeroed(0,1));
+  EXPECT_EQ(2000, zeroed(0,2));
+}
+
+TEST(PackedMaskImageView, CopyMask) {
+  ImageView<Px> image = test_image();
+  PackedMaskImageView<float> packed = image;
+
+  ImageView<float> values(image.cols(), image.rows());
+  fill(values, 3.0f);
+  PackedMaskImageView<float> result = copy_mask(values, packed);
+  EXPECT_EQ(count_valid(packed), count_valid(result));
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i) {
+      EXPECT_EQ(is_valid(image(i,j)), is_valid(result(i,j)));
+      EXPECT_EQ(3, result(i,j).child());
+    }
+
+  // The result shares the mask of its source.
+  packed.set_valid(0,0,false);
+  EXPECT_FALSE(result.is_valid(0,0));
+}
@@ -259,3 +259,45 @@ TEST( PerPixelView, Binary2 ) {
   ASSERT_FALSE( bool_trait<IsMultiplyAccessible>(ppv) );
   ASSERT_TRUE( bool_trait<IsImageView>(ppv) );
 }
+
+TEST( PerPixelView, RowSpan ) {
+  // Wide enough that each row is evaluated in several chunks.
+  ImageView<float> a(150,3,2), b(150,3,2), c(150,3,2);
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<3; ++j )
+      for( int32 i=0; i<150; ++i ) {
+        a(i,j,p) = float(i) + 0.5f*j;
+        b(i,j,p) = float(j+1) - 0.25f*p;
+        c(i,j,p) = float(i%7);
+      }
+
+  typedef BinaryPerPixelView<ImageView<float>, ImageView<float>, ArgArgProductFunctor> product_type;
+  typedef BinaryPerPixelView<product_type, ImageView<float>, ArgArgSumFunctor> sum_type;
+  typedef UnaryPerPixelView<sum_type, float(*)(float)> view_type;
+  view_type ppv( sum_type( product_type(a,b), c ), square );
+
+  EXPECT_TRUE( bool_trait<HasRowSpan>(a) );
+  EXPECT_TRUE( bool_trait<HasRowSpan>(ppv) );
+
+  // The row span path must agree with pixel-by-pixel rasterization,
+  // both for whole images and for partial ones.
+  ImageView<float> expected(150,3,2), result(150,3,2);
+  vw::rasterize( ppv, expected, BBox2i(0,0,150,3) );
+  ppv.rasterize( result, BBox2i(0,0,150,3) );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<3; ++j )
+      for( int32 i=0; i<150; ++i )
+        EXPECT_EQ( expected(i,j,p), result(i,j,p) );
+
+  ImageView<float> part(100,2,2);
+  ppv.rasterize( part, BBox2i(37,1,100,2) );
+  for( int32 p=0; p<2; ++p )
+    for( int32 j=0; j<2; ++j )
+      for( int32 i=0; i<100; ++i )
+        EXPECT_EQ( expected(i+37,j+1,p), part(i,j,p) );
+
+  float row[10];
+  ppv.rasterize_row( row, 2, 140, 150, 1 );
+  for( int32 i=0; i<10; ++i )
+    EXPECT_EQ( expected(140+i,2,1), row[i] );
+}
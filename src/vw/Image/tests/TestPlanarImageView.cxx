@@ -0,0 +1,92 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/PlanarImageView.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Statistics.h>
+#include <vw/Image/PixelTypes.h>
+
+using namespace vw;
+
+typedef PixelRGBA<float> Px;
+
+static ImageView<Px> test_image() {
+  ImageView<Px> image(7,5);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      image(i,j) = Px(float(i), float(j), float(i*j), float(i+j));
+  return image;
+}
+
+TEST(PlanarImageView, Basic) {
+  PlanarImageView<Px> planar(7,5);
+  EXPECT_EQ(7, planar.cols());
+  EXPECT_EQ(5, planar.rows());
+  EXPECT_EQ(1, planar.planes());
+  EXPECT_EQ(Px(), planar(6,4));
+  for (int32 c = 0; c < 4; ++c) {
+    EXPECT_EQ(7, planar.channel(c).cols());
+    EXPECT_EQ(5, planar.channel(c).rows());
+  }
+  EXPECT_THROW(planar.channel(4), ArgumentErr);
+  EXPECT_THROW(planar.set_size(7,5,2), ArgumentErr);
+
+  // The channels are writable and shared.
+  PlanarImageView<Px> copy = planar;
+  planar.channel(2)(3,1) = 5;
+  EXPECT_EQ(Px(0,0,5,0), copy(3,1));
+  *planar.origin().advance(3,1) = Px(1,2,3,4);
+  EXPECT_EQ(Px(1,2,3,4), copy(3,1));
+}
+
+TEST(PlanarImageView, Conversion) {
+  ImageView<Px> image = test_image();
+
+  PlanarImageView<Px> planar = image;
+  ASSERT_EQ(image.cols(), planar.cols());
+  ASSERT_EQ(image.rows(), planar.rows());
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i) {
+      EXPECT_EQ(image(i,j), planar(i,j));
+      EXPECT_EQ(image(i,j)[2], planar.channel(2)(i,j));
+    }
+
+  ImageView<Px> back = planar;
+  EXPECT_RANGE_EQ(image.begin(), image.end(), back.begin(), back.end());
+
+  // A region, through both the direct and the generic paths.
+  ImageView<Px> region = crop(planar, 2, 1, 4, 3);
+  for (int32 j = 0; j < 3; ++j)
+    for (int32 i = 0; i < 4; ++i)
+      EXPECT_EQ(image(i+2,j+1), region(i,j));
+  ImageView<PixelRGBA<double> > wide = planar;
+  EXPECT_EQ(PixelRGBA<double>(6,4,24,10), wide(6,4));
+
+  // Arbitrary views rasterize into planar images, and planar images
+  // compose with other views.
+  planar = image * 2.0f;
+  EXPECT_EQ(Px(12,8,48,20), planar(6,4));
+  ImageView<Px> sum = planar + image;
+  EXPECT_EQ(Px(18,12,72,30), sum(6,4));
+  ImageView<PixelRGB<float> > rgb = pixel_cast<PixelRGB<float> >(planar);
+  EXPECT_EQ(PixelRGB<float>(12,8,48), rgb(6,4));
+}
+
+TEST(PlanarImageView, Channels) {
+  ImageView<Px> image = test_image();
+  PlanarImageView<Px> planar = image;
+  EXPECT_EQ(24, max_pixel_value(planar.channel(2)));
+  EXPECT_NEAR(5.0, mean_pixel_value(planar.channel(3)), 1e-6);
+
+  PlanarImageView<float> scalar = planar.channel(1);
+  EXPECT_EQ(4, scalar(2,4));
+  EXPECT_EQ(4, scalar.channel(0)(2,4));
+}
@@ -0,0 +1,60 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestRasterizeFootprint.h
+#include <gtest/gtest.h>
+
+#include <vw/Image/RasterizeFootprint.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/BlockRasterize.h>
+
+using namespace vw;
+
+TEST( RasterizeFootprint, Views ) {
+  ImageView<float> src(100,80);
+  BBox2i bbox(20,30,10,10);
+  EXPECT_EQ( estimate_rasterize_bytes( src, bbox ), 0u );
+  EXPECT_EQ( estimate_rasterize_bytes( src + src, bbox ), 0u );
+
+  // A 5x5 separable kernel: the 10x10 result, the 14x14 edge-extended
+  // source, one accumulator row and a ring of five rows.
+  std::vector<float> kernel(5, 0.2f);
+  size_t conv = 4*(10*10 + 14*14 + 10 + 5*10);
+  EXPECT_EQ( estimate_rasterize_bytes( separable_convolution_filter( src, kernel, kernel ), bbox ), conv );
+
+  // Siblings add up, and crops shift the region without changing it.
+  EXPECT_EQ( estimate_rasterize_bytes( separable_convolution_filter( src, kernel, kernel ) + src, bbox ), conv );
+  EXPECT_EQ( estimate_rasterize_bytes( separable_convolution_filter( src, kernel, kernel ) +
+                                       separable_convolution_filter( src, kernel, kernel ), bbox ), 2*conv );
+  EXPECT_EQ( estimate_rasterize_bytes( crop( separable_convolution_filter( src, kernel, kernel ), 5, 5, 50, 50 ), bbox ), conv );
+
+  // ImageViewRef hides the type but not the footprint.
+  ImageViewRef<float> ref = separable_convolution_filter( src, kernel, kernel );
+  EXPECT_EQ( estimate_rasterize_bytes( ref, bbox ), 4*10*10 + conv );
+  ImageViewRef<float> image_ref = src;
+  EXPECT_EQ( estimate_rasterize_bytes( image_ref, bbox ), 0u );
+}
+
+TEST( RasterizeFootprint, Blocks ) {
+  ImageView<float> src(100,80);
+  std::vector<float> kernel(5, 0.2f);
+  size_t conv = 4*(10*10 + 14*14 + 10 + 5*10);
+
+  // Sixteen blocks, four of which can be in flight at once.
+  BBox2i bbox(0,0,40,40);
+  EXPECT_EQ( estimate_rasterize_bytes( block_rasterize( separable_convolution_filter( src, kernel, kernel ), Vector2i(10,10), 4 ), bbox ),
+             4*40*40 + 4*conv );
+  // A single block bounds the thread count.
+  EXPECT_EQ( estimate_rasterize_bytes( block_rasterize( separable_convolution_filter( src, kernel, kernel ), Vector2i(10,10), 4 ), BBox2i(0,0,10,10) ),
+             4*10*10 + conv );
+
+  EXPECT_EQ( estimate_block_rasterize_bytes( separable_convolution_filter( src, kernel, kernel ), Vector2i(10,10), 3 ), 3*conv );
+  EXPECT_EQ( estimate_block_rasterize_bytes( separable_convolution_filter( src, kernel, kernel ), Vector2i(10,10), 1 ), conv );
+}
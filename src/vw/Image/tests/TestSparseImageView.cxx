@@ -0,0 +1,161 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/SparseImageView.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/UtilityViews.h>
+
+using namespace vw;
+
+// A 100x50 image of -1 with data in two small patches, one of them
+// straddling a block boundary.
+static ImageView<float> test_image() {
+  ImageView<float> image(100,50);
+  for (int32 j = 0; j < image.rows(); ++j)
+    for (int32 i = 0; i < image.cols(); ++i)
+      image(i,j) = -1;
+  for (int32 j = 2; j < 5; ++j)
+    for (int32 i = 3; i < 7; ++i)
+      image(i,j) = float(i + 100*j);
+  for (int32 j = 30; j < 34; ++j)
+    for (int32 i = 60; i < 68; ++i)
+      image(i,j) = float(i + 100*j);
+  return image;
+}
+
+TEST(SparseImageView, Basic) {
+  SparseImageView<float> sparse(100,50,-1,Vector2i(16,16));
+  EXPECT_EQ(100, sparse.cols());
+  EXPECT_EQ(50, sparse.rows());
+  EXPECT_EQ(1, sparse.planes());
+  EXPECT_EQ(0u, sparse.stored_blocks());
+  EXPECT_EQ(-1, sparse(99,49));
+  EXPECT_EQ(-1, *sparse.origin().advance(50,20));
+  EXPECT_FALSE(sparse.has_data(BBox2i(0,0,100,50)));
+
+  // Writing the fill value stores nothing.
+  sparse.set(40,20,-1);
+  EXPECT_EQ(0u, sparse.stored_blocks());
+
+  // Other values allocate their block, shared by copies.
+  SparseImageView<float> copy = sparse;
+  sparse.set(40,20,7);
+  EXPECT_EQ(1u, copy.stored_blocks());
+  EXPECT_EQ(7, copy(40,20));
+  EXPECT_EQ(-1, copy(41,20));
+  EXPECT_TRUE(copy.has_data(BBox2i(32,16,16,16)));
+  EXPECT_FALSE(copy.has_data(BBox2i(0,0,32,50)));
+
+  EXPECT_THROW(sparse.set_size(10,10,2), ArgumentErr);
+}
+
+TEST(SparseImageView, Assign) {
+  ImageView<float> image = test_image();
+  SparseImageView<float> sparse(1,1,-1,Vector2i(16,16));
+  sparse = image;
+  ASSERT_EQ(image.cols(), sparse.cols());
+  ASSERT_EQ(image.rows(), sparse.rows());
+  EXPECT_EQ(-1, sparse.fill_value());
+
+  // The first patch lies in one block, the second in four.
+  EXPECT_EQ(5u, sparse.stored_blocks());
+
+  ImageView<float> result = sparse;
+  EXPECT_SEQ_EQ(image, result);
+
+  // Assigning the fill drops the blocks it covers entirely, and
+  // clears the rest.
+  crop(sparse,0,0,64,50) = constant_view(-1.0f,64,50);
+  EXPECT_EQ(2u, sparse.stored_blocks());
+  EXPECT_EQ(-1, sparse(4,3));
+  EXPECT_EQ(-1, sparse(60,30));
+  EXPECT_EQ(float(64 + 100*32), sparse(64,32));
+}
+
+TEST(SparseImageView, Crop) {
+  ImageView<float> image = test_image();
+  SparseImageView<float> sparse(image, -1, Vector2i(16,16));
+
+  // crop() of a sparse image is a window onto the same blocks.
+  SparseImageView<float> window = crop(sparse, BBox2i(50,20,50,30));
+  EXPECT_EQ(50, window.cols());
+  EXPECT_EQ(30, window.rows());
+  EXPECT_EQ(float(61 + 100*31), window(11,11));
+  EXPECT_TRUE(window.has_data(BBox2i(10,10,2,2)));
+  EXPECT_FALSE(window.has_data(BBox2i(35,0,5,5)));
+  EXPECT_TRUE(sparse_check(window, BBox2i(10,10,2,2)));
+  EXPECT_FALSE(sparse_check(window, BBox2i(35,0,5,5)));
+
+  ImageView<float> result = window;
+  ImageView<float> expected = crop(image, BBox2i(50,20,50,30));
+  EXPECT_SEQ_EQ(expected, result);
+
+  // Generic rasterization, through a view without a fast path.
+  ImageView<float> doubled = 2 * window;
+  EXPECT_EQ(2*expected(11,11), doubled(11,11));
+  EXPECT_EQ(-2, doubled(0,0));
+
+  // Block rasterization of another view sees the same pixels.
+  ImageView<float> blocked = block_rasterize(sparse, Vector2i(32,32), 2);
+  EXPECT_SEQ_EQ(image, blocked);
+
+  EXPECT_THROW(crop(sparse, BBox2i(90,0,20,10)), ArgumentErr);
+}
+
+TEST(SparseImageView, AssignSparse) {
+  // Sparse sources only have the blocks they store rasterized.
+  ImageView<float> image = test_image();
+  SparseImageView<float> source(image, -1, Vector2i(16,16));
+  SparseImageView<float> dest(100,50,-1,Vector2i(32,32));
+  dest = source;
+  EXPECT_EQ(5u, dest.stored_blocks());
+  ImageView<float> result = dest;
+  EXPECT_SEQ_EQ(image, result);
+}
+
+// Records the writes block_write_image() makes.
+class RecordingDstResource : public DstImageResource {
+  public:
+    ImageView<float> image;
+    std::vector<BBox2i> order;
+
+    RecordingDstResource( int32 cols, int32 rows ) : image(cols,rows) {}
+
+    virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+      order.push_back( bbox );
+      ImageView<float> block( bbox.width(), bbox.height() );
+      convert( block.buffer(), buf );
+      crop( image, bbox ) = block;
+    }
+    virtual bool has_block_write() const  {return true;}
+    virtual Vector2i block_write_size() const {return Vector2i(16,16);}
+    virtual bool has_nodata_write() const {return false;}
+    virtual void flush() {}
+};
+
+TEST(SparseImageView, BlockWrite) {
+  ImageView<float> image = test_image();
+  SparseImageView<float> sparse(image, -1, Vector2i(16,16));
+
+  RecordingDstResource resource( image.cols(), image.rows() );
+  block_write_image( resource, sparse );
+
+  ASSERT_EQ( 28u, resource.order.size() );
+  for( size_t i=1; i<resource.order.size(); ++i ) {
+    BBox2i const& prev = resource.order[i-1];
+    BBox2i const& next = resource.order[i];
+    EXPECT_TRUE( prev.min().y() < next.min().y() ||
+                 (prev.min().y() == next.min().y() && prev.min().x() < next.min().x()) );
+  }
+  EXPECT_SEQ_EQ( image, resource.image );
+}
@@ -491,3 +491,70 @@ TEST( Statistics, MedianChannel ) {
   EXPECT_EQ( median_channel_value(image2), 6 );
   ASSERT_TRUE( is_of_type<vw::uint8>( median_channel_value(image2) ) );
 }
+
+TEST( Statistics, Parallel ) {
+  ImageView<PixelMask<float> > image(97,53);
+  for ( int32 j = 0; j < image.rows(); ++j )
+    for ( int32 i = 0; i < image.cols(); ++i ) {
+      image(i,j) = PixelMask<float>( float((i*31 + j*17) % 101) - 20.5f );
+      if ( (i+j) % 7 == 0 ) image(i,j).invalidate();
+    }
+
+  // Odd block sizes leave ragged edges and some blocks with no
+  // valid pixels in a row.
+  Vector2i block(10,7);
+  float min, max, pmin, pmax;
+  min_max_channel_values( image, min, max );
+  parallel_min_max_channel_values( image, pmin, pmax, block, 4 );
+  EXPECT_EQ( min, pmin );
+  EXPECT_EQ( max, pmax );
+  EXPECT_EQ( min, parallel_min_channel_value( image, block, 4 ) );
+  EXPECT_EQ( max, parallel_max_channel_value( image, block, 4 ) );
+  EXPECT_NEAR( sum_of_channel_values(image), parallel_sum_of_channel_values( image, block, 4 ), 1e-6 );
+  EXPECT_NEAR( mean_channel_value(image), parallel_mean_channel_value( image, block, 4 ), 1e-9 );
+  EXPECT_NEAR( stddev_channel_value(image), parallel_stddev_channel_value( image, block, 4 ), 1e-9 );
+
+  // Default block size and thread count
+  EXPECT_NEAR( mean_channel_value(image), parallel_mean_channel_value(image), 1e-9 );
+
+  // Any accumulator with a merge() works, including the
+  // element-wise ones.
+  ImageView<PixelRGB<float> > rgb(31,29);
+  for ( int32 j = 0; j < rgb.rows(); ++j )
+    for ( int32 i = 0; i < rgb.cols(); ++i )
+      rgb(i,j) = PixelRGB<float>( float(i), float(j), float(i*j % 13) );
+  EWMinMaxAccumulator<PixelRGB<float> > serial, parallel;
+  for_each_pixel( rgb, serial );
+  parallel_for_each_pixel( rgb, parallel, Vector2i(8,8), 3 );
+  EXPECT_PIXEL_EQ( serial.minimum(), parallel.minimum() );
+  EXPECT_PIXEL_EQ( serial.maximum(), parallel.maximum() );
+}
+
+TEST( Statistics, QuantileChannel ) {
+  ImageView<PixelMask<vw::uint16> > image(100,50);
+  for ( int32 j = 0; j < image.rows(); ++j )
+    for ( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = PixelMask<vw::uint16>( i + 100*j );
+  image(0,0).invalidate();
+  // Integer channels are exact
+  EXPECT_EQ( quantile_channel_value(image, 0.0), 1 );
+  EXPECT_EQ( quantile_channel_value(image, 1.0), 4999 );
+  std::vector<double> q(2);
+  q[0] = 0.02; q[1] = 0.98;
+  std::vector<vw::uint16> r = quantile_channel_values(image, q);
+  ASSERT_EQ( r.size(), 2u );
+  EXPECT_EQ( r[0], 100 );
+  EXPECT_EQ( r[1], 4900 );
+
+  // Floating point channels are approximate
+  ImageView<float> fimage(200,100);
+  for ( int32 j = 0; j < fimage.rows(); ++j )
+    for ( int32 i = 0; i < fimage.cols(); ++i )
+      fimage(i,j) = float(i + 200*j);
+  EXPECT_NEAR( quantile_channel_value(fimage, 0.5), 10000, 200 );
+  EXPECT_EQ( quantile_channel_value(fimage, 0.0), 0 );
+
+  QuantileAccumulator<float> sketch;
+  parallel_for_each_pixel( fimage, sketch, Vector2i(50,50), 4 );
+  EXPECT_NEAR( sketch.quantile(0.25), 5000, 200 );
+}
@@ -148,3 +148,44 @@ TEST( Transform, Compose ) {
   }
 
 }
+
+namespace {
+  // Smooth everywhere but increasingly curved to the right, with a
+  // jump at x=150.
+  class WarpTransform : public TransformHelper<WarpTransform,ContinuousFunction,ContinuousFunction> {
+  public:
+    Vector2 reverse( Vector2 const& p ) const {
+      Vector2 r( p.x() + 1e-4*p.x()*p.x()*p.x()/100, p.y() + 0.002*p.x()*p.y() );
+      if( p.x() >= 150 ) r.x() += 10;
+      return r;
+    }
+  };
+}
+
+TEST( Transform, Approximate ) {
+  BBox2i bbox(10,20,200,100);
+
+  { // An affine map is reproduced exactly by the initial cells.
+    AffineTransform affine( Matrix2x2(1.2,0.3,-0.2,0.9), Vector2(5,-3) );
+    affine.set_tolerance( 0.1 );
+    ApproximateTransform<AffineTransform> approx( affine, bbox );
+    EXPECT_EQ( approx.num_cells(), 7u*4u );
+    EXPECT_EQ( approx.num_exact_cells(), 0u );
+    for( int32 y=bbox.min().y(); y<bbox.max().y(); y+=7 )
+      for( int32 x=bbox.min().x(); x<bbox.max().x(); x+=7 )
+        EXPECT_VECTOR_NEAR( affine.reverse(Vector2(x,y)), approx.reverse(Vector2(x,y)), 1e-9 );
+  }
+
+  { // Cells are refined where the map curves, and fall back to the
+    // exact map around the jump.
+    WarpTransform warp;
+    warp.set_tolerance( 0.1 );
+    ApproximateTransform<WarpTransform> approx( warp, bbox );
+    EXPECT_GT( approx.num_cells(), 7u*4u );
+    EXPECT_GT( approx.num_exact_cells(), 0u );
+    EXPECT_LT( approx.num_exact_cells(), approx.num_cells() / 2 );
+    for( int32 y=bbox.min().y(); y<bbox.max().y(); ++y )
+      for( int32 x=bbox.min().x(); x<bbox.max().x(); ++x )
+        EXPECT_VECTOR_NEAR( warp.reverse(Vector2(x,y)), approx.reverse(Vector2(x,y)), 0.2 );
+  }
+}
@@ -14,6 +14,8 @@
 
 // Data Types
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/CompactInterestData.h>
+#include <vw/InterestPoint/InterestPointCache.h>
 #include <vw/InterestPoint/InterestTraits.h>
 #include <vw/InterestPoint/ImageOctave.h>
 #include <vw/InterestPoint/ImageOctaveHistory.h>
@@ -15,10 +15,12 @@
 #define __VW_INTERESTPOINT_BOX_FILTER_H__
 
 #include <vector>
+#include <algorithm>
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
+#include <vw/InterestPoint/IntegralImage.h>
 
 namespace vw {
 namespace ip {
@@ -108,8 +110,41 @@ namespace ip {
       return prerasterize_type( m_integral.prerasterize(bbox), m_filter );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i bbox ) const {
+      rasterize_rows( m_integral, dest, bbox );
+    }
+
+  private:
+    template <class ViewT, class DestT>
+    inline void rasterize_rows( ViewT const& /*integral*/, DestT const& dest, BBox2i bbox ) const {
       vw::rasterize( prerasterize(bbox), dest, bbox);
     }
+
+    // An integral image in memory is filtered a row at a time, each
+    // box adding its weighted sums from four contiguous stretches of
+    // the integral image, rather than a pixel at a time.
+    template <class PixelT, class DestT>
+    void rasterize_rows( ImageView<PixelT> const& integral, DestT const& dest, BBox2i bbox ) const {
+      std::vector<PixelT> row( bbox.width() );
+      int32 x0 = std::max( bbox.min().x(), m_pixel_buffer );
+      int32 x1 = std::min( bbox.max().x(), integral.cols()-m_pixel_buffer-1 );
+      for ( int32 y = bbox.min().y(); y < bbox.max().y(); y++ ) {
+        std::fill( row.begin(), row.end(), PixelT() );
+        if ( x0 < x1 && y >= m_pixel_buffer && y < integral.rows()-m_pixel_buffer-1 ) {
+          for ( size_t b = 0; b < m_filter.size(); b++ ) {
+            SumBox const& box = m_filter[b];
+            int32 left = x0 + box.start[0], top = y + box.start[1];
+            detail::add_integral_block_row( integral, left, top,
+                                            left + box.size[0], top + box.size[1],
+                                            PixelT(box.weight), &row[x0-bbox.min().x()], x1-x0 );
+          }
+        }
+        typename DestT::pixel_accessor dest_col = dest.origin().advance( 0, y-bbox.min().y() );
+        for ( int32 i = 0; i < bbox.width(); i++ ) {
+          *dest_col = row[i];
+          dest_col.next_col();
+        }
+      }
+    }
   };
 
   // Convenience Wrappers
@@ -0,0 +1,245 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactInterestData.cc
+///
+/// Reading and writing of .vwip2 interest point files.
+///
+#include <fstream>
+#include <cstring>
+
+#include <boost/static_assert.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/FileIO/MappedFile.h>
+#include <vw/InterestPoint/CompactInterestData.h>
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  const char compact_ip_magic[8] = { 'V', 'W', 'I', 'P', '2', 0, 0, 0 };
+  const uint32 compact_ip_version = 1;
+  const uint64 compact_ip_alignment = 64;
+
+  struct CompactIPHeader {
+    char magic[8];
+    uint32 version;
+    uint32 record_size;
+    uint64 count;
+    uint32 descriptor_kind;
+    uint32 descriptor_length;
+    uint64 records_offset;
+    uint64 descriptors_offset;
+    uint8 reserved[16];
+  };
+
+  BOOST_STATIC_ASSERT( sizeof(InterestPointRecord) == 40 );
+  BOOST_STATIC_ASSERT( sizeof(CompactIPHeader) == 64 );
+
+  uint64 align( uint64 offset ) {
+    return (offset + compact_ip_alignment - 1) / compact_ip_alignment * compact_ip_alignment;
+  }
+
+  InterestPointRecord make_record( InterestPoint const& ip ) {
+    InterestPointRecord record;
+    std::memset( &record, 0, sizeof(record) );
+    record.x = ip.x;
+    record.y = ip.y;
+    record.ix = ip.ix;
+    record.iy = ip.iy;
+    record.orientation = ip.orientation;
+    record.scale = ip.scale;
+    record.interest = ip.interest;
+    record.octave = ip.octave;
+    record.scale_lvl = ip.scale_lvl;
+    record.polarity = ip.polarity ? 1 : 0;
+    return record;
+  }
+
+  void write_padding( std::ofstream& f, uint64 from, uint64 to ) {
+    static const char zeros[compact_ip_alignment] = { 0 };
+    f.write( zeros, std::streamsize(to - from) );
+  }
+
+  template <class IterT>
+  void write_compact_ip_file_impl( std::string const& ip_file, IterT begin, IterT end ) {
+    CompactIPHeader header;
+    std::memset( &header, 0, sizeof(header) );
+    std::memcpy( header.magic, compact_ip_magic, sizeof(header.magic) );
+    header.version = compact_ip_version;
+    header.record_size = sizeof(InterestPointRecord);
+
+    // The first point decides the kind and length of the descriptors.
+    uint64 count = 0;
+    uint32 kind = CompactInterestPointFile::NO_DESCRIPTOR, length = 0;
+    for ( IterT it = begin; it != end; ++it, ++count ) {
+      uint32 it_kind = CompactInterestPointFile::NO_DESCRIPTOR, it_length = 0;
+      if ( it->descriptor.size() > 0 ) {
+        it_kind = CompactInterestPointFile::FLOAT_DESCRIPTOR;
+        it_length = uint32(it->descriptor.size());
+      } else if ( !it->binary_descriptor.empty() ) {
+        it_kind = CompactInterestPointFile::BINARY_DESCRIPTOR;
+        it_length = uint32(it->binary_descriptor.size());
+      }
+      if ( count == 0 ) {
+        kind = it_kind;
+        length = it_length;
+      } else if ( it_kind != kind || it_length != length ) {
+        vw_throw( ArgumentErr() << "write_compact_ip_file: interest point descriptors differ in kind or length." );
+      }
+    }
+    header.count = count;
+    header.descriptor_kind = kind;
+    header.descriptor_length = length;
+    header.records_offset = align( sizeof(header) );
+    header.descriptors_offset = align( header.records_offset + count * sizeof(InterestPointRecord) );
+
+    std::ofstream f( ip_file.c_str(), std::ios::binary | std::ios::out );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" for writing as VWIP2 file." );
+
+    f.write( (char const*)&header, sizeof(header) );
+    write_padding( f, sizeof(header), header.records_offset );
+    for ( IterT it = begin; it != end; ++it ) {
+      InterestPointRecord record = make_record( *it );
+      f.write( (char const*)&record, sizeof(record) );
+    }
+    write_padding( f, header.records_offset + count * sizeof(InterestPointRecord), header.descriptors_offset );
+
+    if ( kind == CompactInterestPointFile::FLOAT_DESCRIPTOR ) {
+      std::vector<float32> row( length );
+      for ( IterT it = begin; it != end; ++it ) {
+        std::copy( it->descriptor.begin(), it->descriptor.end(), row.begin() );
+        f.write( (char const*)&row[0], sizeof(float32) * length );
+      }
+    } else if ( kind == CompactInterestPointFile::BINARY_DESCRIPTOR ) {
+      for ( IterT it = begin; it != end; ++it )
+        f.write( (char const*)&it->binary_descriptor[0], sizeof(uint64) * length );
+    }
+
+    if ( !f )
+      vw_throw( IOErr() << "Failed to write VWIP2 file \"" << ip_file << "\"." );
+  }
+
+} // anonymous namespace
+
+  CompactInterestPointFile::CompactInterestPointFile( std::string const& filename )
+    : m_data(0), m_count(0), m_descriptor_length(0), m_kind(NO_DESCRIPTOR),
+      m_records(0), m_descriptors(0) {
+    size_t size;
+    if ( MappedFile::supported() ) {
+      m_file.reset( new MappedFile( filename ) );
+      m_data = m_file->data();
+      size = m_file->size();
+    } else {
+      std::ifstream f( filename.c_str(), std::ios::binary | std::ios::in );
+      if ( !f.is_open() )
+        vw_throw( IOErr() << "Failed to open \"" << filename << "\" as VWIP2 file." );
+      f.seekg( 0, std::ios::end );
+      m_buffer.resize( size_t(f.tellg()) );
+      f.seekg( 0, std::ios::beg );
+      if ( !m_buffer.empty() )
+        f.read( (char*)&m_buffer[0], m_buffer.size() );
+      m_data = m_buffer.empty() ? 0 : &m_buffer[0];
+      size = m_buffer.size();
+    }
+
+    if ( size < sizeof(CompactIPHeader) ||
+         std::memcmp( m_data, compact_ip_magic, sizeof(compact_ip_magic) ) != 0 )
+      vw_throw( IOErr() << "\"" << filename << "\" is not a VWIP2 file." );
+    CompactIPHeader header;
+    std::memcpy( &header, m_data, sizeof(header) );
+    if ( header.version != compact_ip_version )
+      vw_throw( IOErr() << "\"" << filename << "\" is a VWIP2 file of unknown version " << header.version << "." );
+    if ( header.record_size != sizeof(InterestPointRecord) ||
+         header.descriptor_kind > BINARY_DESCRIPTOR ||
+         header.records_offset % compact_ip_alignment != 0 ||
+         header.descriptors_offset % compact_ip_alignment != 0 )
+      vw_throw( IOErr() << "\"" << filename << "\" has a corrupt VWIP2 header." );
+
+    uint64 element_size = header.descriptor_kind == BINARY_DESCRIPTOR ? sizeof(uint64) : sizeof(float32);
+    if ( header.descriptor_kind == NO_DESCRIPTOR )
+      header.descriptor_length = 0;
+    if ( header.records_offset + header.count * sizeof(InterestPointRecord) > header.descriptors_offset ||
+         header.descriptors_offset + header.count * header.descriptor_length * element_size > size )
+      vw_throw( IOErr() << "VWIP2 file \"" << filename << "\" is truncated." );
+
+    m_count = size_t(header.count);
+    m_kind = DescriptorKind(header.descriptor_kind);
+    m_descriptor_length = header.descriptor_length;
+    m_records = reinterpret_cast<InterestPointRecord const*>( m_data + header.records_offset );
+    m_descriptors = m_data + header.descriptors_offset;
+  }
+
+  CompactInterestPointFile::~CompactInterestPointFile() {}
+
+  float32 const* CompactInterestPointFile::descriptors() const {
+    if ( m_kind != FLOAT_DESCRIPTOR )
+      return 0;
+    return reinterpret_cast<float32 const*>( m_descriptors );
+  }
+
+  uint64 const* CompactInterestPointFile::binary_descriptors() const {
+    if ( m_kind != BINARY_DESCRIPTOR )
+      return 0;
+    return reinterpret_cast<uint64 const*>( m_descriptors );
+  }
+
+  InterestPoint CompactInterestPointFile::operator[]( size_t i ) const {
+    InterestPointRecord const& r = m_records[i];
+    InterestPoint ip;
+    ip.x = r.x;
+    ip.y = r.y;
+    ip.ix = r.ix;
+    ip.iy = r.iy;
+    ip.orientation = r.orientation;
+    ip.scale = r.scale;
+    ip.interest = r.interest;
+    ip.polarity = r.polarity != 0;
+    ip.octave = r.octave;
+    ip.scale_lvl = r.scale_lvl;
+    if ( m_kind == FLOAT_DESCRIPTOR ) {
+      ip.descriptor.set_size( m_descriptor_length );
+      std::copy( descriptor(i), descriptor(i) + m_descriptor_length, ip.descriptor.begin() );
+    } else if ( m_kind == BINARY_DESCRIPTOR ) {
+      ip.binary_descriptor.assign( binary_descriptor(i), binary_descriptor(i) + m_descriptor_length );
+    }
+    return ip;
+  }
+
+  std::vector<InterestPoint> CompactInterestPointFile::points() const {
+    std::vector<InterestPoint> result;
+    result.reserve( m_count );
+    for ( size_t i = 0; i < m_count; i++ )
+      result.push_back( (*this)[i] );
+    return result;
+  }
+
+  void write_compact_ip_file( std::string const& ip_file, InterestPointList const& ip ) {
+    write_compact_ip_file_impl( ip_file, ip.begin(), ip.end() );
+  }
+
+  void write_compact_ip_file( std::string const& ip_file, std::vector<InterestPoint> const& ip ) {
+    write_compact_ip_file_impl( ip_file, ip.begin(), ip.end() );
+  }
+
+  std::vector<InterestPoint> read_compact_ip_file( std::string const& ip_file ) {
+    CompactInterestPointFile file( ip_file );
+    return file.points();
+  }
+
+  bool is_compact_ip_file( std::string const& ip_file ) {
+    std::ifstream f( ip_file.c_str(), std::ios::binary | std::ios::in );
+    char magic[sizeof(compact_ip_magic)];
+    if ( !f.read( magic, sizeof(magic) ) )
+      return false;
+    return std::memcmp( magic, compact_ip_magic, sizeof(magic) ) == 0;
+  }
+
+}} // namespace vw::ip
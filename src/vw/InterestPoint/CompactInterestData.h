@@ -0,0 +1,111 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactInterestData.h
+///
+/// A columnar interest point file format, .vwip2, that can be read
+/// in place through a memory mapping.
+///
+/// The file is a 64 byte header, then one fixed size
+/// InterestPointRecord per point, then the descriptors of all the
+/// points as one row-major matrix: count rows of descriptor_length
+/// floats, or of descriptor_length 64 bit words for binary
+/// descriptors.  Every point must have a descriptor of the same
+/// kind and length.  The records and the matrix start on 64 byte
+/// boundaries.  Values are in the byte order of the machine that
+/// wrote the file, as in the .vwip format.
+///
+/// Opening a CompactInterestPointFile maps the file and checks its
+/// header, and costs the same for any number of points; the pages of
+/// a record or a descriptor are only read when it is first touched.
+///
+#ifndef __VW_INTERESTPOINT_COMPACTINTERESTDATA_H__
+#define __VW_INTERESTPOINT_COMPACTINTERESTDATA_H__
+
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/InterestPoint/InterestData.h>
+
+namespace vw {
+
+  class MappedFile;
+
+namespace ip {
+
+  /// The fields of an interest point, as they are stored in a .vwip2
+  /// file.
+  struct InterestPointRecord {
+    float32 x, y;
+    int32 ix, iy;
+    float32 orientation, scale, interest;
+    uint32 octave, scale_lvl;
+    uint8 polarity;
+    uint8 reserved[3];
+  };
+
+  /// A .vwip2 file opened for reading in place.
+  class CompactInterestPointFile : private boost::noncopyable {
+  public:
+    enum DescriptorKind { NO_DESCRIPTOR = 0, FLOAT_DESCRIPTOR = 1, BINARY_DESCRIPTOR = 2 };
+
+    /// Maps the file, or reads it whole where files can't be mapped.
+    /// Throws IOErr if it isn't a .vwip2 file of a known version.
+    explicit CompactInterestPointFile( std::string const& filename );
+    ~CompactInterestPointFile();
+
+    size_t size() const { return m_count; }
+    DescriptorKind descriptor_kind() const { return m_kind; }
+    /// The elements, or for binary descriptors the words, of each
+    /// descriptor.
+    size_t descriptor_length() const { return m_descriptor_length; }
+
+    InterestPointRecord const& record( size_t i ) const { return m_records[i]; }
+
+    /// The float descriptors as a size() by descriptor_length()
+    /// matrix, or null if they are binary or absent.
+    float32 const* descriptors() const;
+    float32 const* descriptor( size_t i ) const { return descriptors() + i*m_descriptor_length; }
+
+    /// Likewise for binary descriptors.
+    uint64 const* binary_descriptors() const;
+    uint64 const* binary_descriptor( size_t i ) const { return binary_descriptors() + i*m_descriptor_length; }
+
+    /// Copies point i out into an InterestPoint.
+    InterestPoint operator[]( size_t i ) const;
+
+    /// Copies out all of the points.
+    std::vector<InterestPoint> points() const;
+
+  private:
+    boost::scoped_ptr<MappedFile> m_file;
+    std::vector<uint8> m_buffer;
+    uint8 const* m_data;
+    size_t m_count, m_descriptor_length;
+    DescriptorKind m_kind;
+    InterestPointRecord const* m_records;
+    uint8 const* m_descriptors;
+  };
+
+  /// Writes a .vwip2 file.  Throws ArgumentErr if the points'
+  /// descriptors differ in kind or length.
+  void write_compact_ip_file( std::string const& ip_file, InterestPointList const& ip );
+  void write_compact_ip_file( std::string const& ip_file, std::vector<InterestPoint> const& ip );
+
+  /// Reads all of the points of a .vwip2 file.
+  std::vector<InterestPoint> read_compact_ip_file( std::string const& ip_file );
+
+  /// Returns true if the named file starts as a .vwip2 file does.
+  bool is_compact_ip_file( std::string const& ip_file );
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_COMPACTINTERESTDATA_H__
@@ -11,6 +11,10 @@
 ///
 #include <vw/InterestPoint/Descriptor.h>
 
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
 namespace vw {
 namespace ip {
 
@@ -18,4 +22,29 @@ namespace ip {
   const uint32 SGradDescriptorGenerator::box_size[5] = {2,4,8,10,14};
   const uint32 SGradDescriptorGenerator::box_half[5] = {1,2,4,5,7};
 
+  BRIEFDescriptorGenerator::BRIEFDescriptorGenerator( int bits ) {
+    VW_ASSERT( bits > 0, ArgumentErr() << "BRIEFDescriptorGenerator: the number of bits must be positive." );
+
+    // Locations from an isotropic Gaussian of variance S^2/25, for
+    // a support region of S pixels on a side, as in the BRIEF
+    // paper.  They are clipped so that each 5x5 window lies in the
+    // region, and pairs of a window with itself are drawn again.
+    // The generator is seeded the same way every time.
+    int32 limit = support_size() / 2 - 2;
+    boost::rand48 gen( 1759 );
+    boost::normal_distribution<double> normal( 0, double(support_size()) / 5 );
+    boost::variate_generator<boost::rand48&, boost::normal_distribution<double> > sample( gen, normal );
+
+    m_pattern.reserve( bits );
+    while ( int(m_pattern.size()) < bits ) {
+      int32 coords[4];
+      for ( int i = 0; i < 4; i++ )
+        coords[i] = std::max( -limit, std::min( limit, int32(round( sample() )) ) );
+      if ( coords[0] == coords[2] && coords[1] == coords[3] )
+        continue;
+      TestPair pair = { int16(coords[0]), int16(coords[1]), int16(coords[2]), int16(coords[3]) };
+      m_pattern.push_back( pair );
+    }
+  }
+
 }} // namespace vw::ip
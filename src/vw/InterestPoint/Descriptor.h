@@ -13,17 +13,133 @@
 #define __VW_INTERESTPOINT_DESCRIPTOR_H__
 
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Transform.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/InterestPoint/InterestData.h>
 #include <vw/InterestPoint/MatrixIO.h>
 #include <vw/InterestPoint/VectorIO.h>
 #include <vw/InterestPoint/IntegralImage.h>
 
+#include <vector>
+#include <cmath>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 namespace vw {
 namespace ip {
 
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The affine map from a support region of size pixels on a side
+    // to the image, as DescriptorGeneratorBase::get_support() builds
+    // it.
+    inline AffineTransform support_transform( InterestPoint const& pt, int32 size ) {
+      float half_size = ((float)(size - 1)) / 2.0f;
+      float scaling = 1.0f / pt.scale;
+      double c=cos(-pt.orientation), s=sin(-pt.orientation);
+      return AffineTransform( Matrix2x2(scaling*c, -scaling*s,
+                                        scaling*s, scaling*c),
+                              Vector2(scaling*(s*pt.y-c*pt.x)+half_size,
+                                      -scaling*(s*pt.x+c*pt.y)+half_size) );
+    }
+
+    // The pixels of the image that bilinear sampling of the support
+    // region reads.
+    inline BBox2i support_window( AffineTransform const& txform, int32 size ) {
+      BBox2 corners;
+      corners.grow( txform.reverse( Vector2(0, 0) ) );
+      corners.grow( txform.reverse( Vector2(size-1, 0) ) );
+      corners.grow( txform.reverse( Vector2(0, size-1) ) );
+      corners.grow( txform.reverse( Vector2(size-1, size-1) ) );
+      return BBox2i( Vector2i( int32(std::floor(corners.min().x())), int32(std::floor(corners.min().y())) ),
+                     Vector2i( int32(std::floor(corners.max().x())) + 2, int32(std::floor(corners.max().y())) + 2 ) );
+    }
+
+    // Samples the support region from a window of the image whose
+    // pixel (0,0) is at origin and whose rows are stride pixels
+    // apart.  The arithmetic is that of BilinearInterpolation over
+    // the whole image, so the pixels match those of get_support().
+    inline void sample_support( float const* window, int32 stride, Vector2i const& origin,
+                                AffineTransform const& txform, ImageView<PixelGray<float> >& support ) {
+      for ( int32 j = 0; j < support.rows(); ++j ) {
+        PixelGray<float>* out = &support(0, j);
+        for ( int32 i = 0; i < support.cols(); ++i ) {
+          Vector2 p = txform.reverse( Vector2(i, j) );
+          int32 x = math::impl::_floor(p[0]), y = math::impl::_floor(p[1]);
+          float normx = float(p[0])-float(x), normy = float(p[1])-float(y), norm1mx = 1-normx, norm1my = 1-normy;
+          float const* row = window + int64(y - origin.y())*stride + (x - origin.x());
+          float result = row[0] * norm1mx;
+          result += row[1] * normx;
+          result *= norm1my;
+          float next = row[stride] * norm1mx;
+          next += row[stride+1] * normx;
+          result += next * normy;
+          out[i] = result;
+        }
+      }
+    }
+
+    // out[k] += weight * row[k], for k in [0,n).
+    inline void add_scaled_row( float const* row, float weight, float* out, size_t n ) {
+      size_t k = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE__)
+      __m128 w = _mm_set1_ps( weight );
+      for ( ; k + 4 <= n; k += 4 )
+        _mm_storeu_ps( out + k, _mm_add_ps( _mm_loadu_ps( out + k ),
+                                            _mm_mul_ps( w, _mm_loadu_ps( row + k ) ) ) );
+#endif
+      for ( ; k < n; ++k )
+        out[k] += weight * row[k];
+    }
+
+    // Computes the descriptors of a range of points.  The support
+    // region and the window of the image under it are kept from one
+    // point to the next, and only grow.
+    template <class GeneratorT, class ViewT>
+    class DescriptorTask : public Task, private boost::noncopyable {
+      GeneratorT& m_generator;
+      ViewT const& m_source;
+      std::vector<InterestPoint*> const& m_points;
+      size_t m_begin, m_end;
+
+    public:
+      DescriptorTask( GeneratorT& generator, ViewT const& source,
+                      std::vector<InterestPoint*> const& points, size_t begin, size_t end )
+        : m_generator(generator), m_source(source), m_points(points), m_begin(begin), m_end(end) {}
+
+      void operator()() {
+        int32 size = m_generator.support_size();
+        ImageView<PixelGray<float> > support( size, size ), buffer;
+        for ( size_t i = m_begin; i < m_end; ++i ) {
+          InterestPoint& pt = *m_points[i];
+          AffineTransform txform = support_transform( pt, size );
+          BBox2i window = support_window( txform, size );
+          if ( window.width() > buffer.cols() || window.height() > buffer.rows() )
+            buffer.set_size( std::max( window.width(), buffer.cols() ),
+                             std::max( window.height(), buffer.rows() ) );
+          crop( buffer, 0, 0, window.width(), window.height() ) =
+            crop( edge_extend( m_source, ZeroEdgeExtension() ), window );
+          sample_support( &buffer(0,0).v(), int32(&buffer(0,1).v() - &buffer(0,0).v()),
+                          window.min(), txform, support );
+
+          pt.descriptor.set_size( m_generator.descriptor_size() );
+          m_generator.compute_descriptor( support, pt.begin(), pt.end() );
+        }
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
   template <class ImplT>
   class DescriptorGeneratorBase {
 
@@ -38,6 +154,11 @@ namespace ip {
     // Given an image and a list of interest points, set the
     // descriptor field of the interest points using the
     // compute_descriptor() method provided by the subclass.
+    //
+    // The points are processed in batches on the default number of
+    // threads, each of which reads only the window of the image
+    // under a point's support region, and samples the region as
+    // get_support() does into a buffer it keeps for the batch.
     template <class ViewT>
     void operator() ( ImageViewBase<ViewT> const& image,
                       InterestPointList& points ) {
@@ -45,18 +166,28 @@ namespace ip {
       // Timing
       Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
 
-      for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i) {
-
-        // First we compute the support region based on the interest point
-        ImageView<PixelGray<float> > support = get_support(*i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
+      describe( pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())), points );
+    }
 
-        // Next, we pass the support region and the interest point to
-        // the descriptor generator ( compute_descriptor() ) supplied
-        // by the subclass.
-        i->descriptor.set_size( impl().descriptor_size() );
-        impl().compute_descriptor( support, i->begin(), i->end() );
+    /// \cond INTERNAL
+    template <class SourceT>
+    void describe( SourceT const& source, InterestPointList& points ) {
+      std::vector<InterestPoint*> list;
+      list.reserve( points.size() );
+      for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i)
+        list.push_back( &(*i) );
+
+      typedef detail::DescriptorTask<ImplT, SourceT> task_type;
+      const size_t batch_size = 64;
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for ( size_t begin = 0; begin < list.size(); begin += batch_size ) {
+        boost::shared_ptr<task_type> task( new task_type( impl(), source, list, begin,
+                                                          std::min( begin + batch_size, list.size() ) ) );
+        queue.add_task( task );
       }
+      queue.join_all();
     }
+    /// \endcond
 
     // Default suport size ( i.e. descriptor window)
     int support_size() { return 41; }
@@ -71,15 +202,8 @@ namespace ip {
     get_support( InterestPoint const& pt,
                  ImageViewBase<ViewT> const& source) {
 
-      float half_size = ((float)(impl().support_size() - 1)) / 2.0f;
-      float scaling = 1.0f / pt.scale;
-      double c=cos(-pt.orientation), s=sin(-pt.orientation);
-
       return transform(source.impl(),
-                       AffineTransform( Matrix2x2(scaling*c, -scaling*s,
-                                                  scaling*s, scaling*c),
-                                        Vector2(scaling*(s*pt.y-c*pt.x)+half_size,
-                                                -scaling*(s*pt.x+c*pt.y)+half_size) ),
+                       detail::support_transform( pt, impl().support_size() ),
                        impl().support_size(), impl().support_size() );
     }
 
@@ -131,12 +255,23 @@ namespace ip {
     }
 
 
+    /// A generator with a basis and average already loaded.
+    PCASIFTDescriptorGenerator(Matrix<float> const& basis, Vector<float> const& avg)
+      : pca_basis(basis), pca_avg(avg) {}
+
+    /// The descriptor is the projection of the normalized support
+    /// region, less the average, onto the basis.  The iterators must
+    /// span contiguous floats, as those of InterestPoint do.
     template <class ViewT, class IterT>
     void compute_descriptor( ImageViewBase<ViewT> const& support,
                              IterT first, IterT last) const {
 
       for ( IterT fill = first; fill != last; fill++ )
         *fill = 0;
+      VW_ASSERT( size_t(last - first) == pca_basis.cols(),
+                 ArgumentErr() << "PCASIFTDescriptorGenerator: descriptor does not match the basis." );
+      if ( first == last )
+        return;
 
       // compute normalization constant (sum squares)
       double norm_const = 0;
@@ -147,18 +282,15 @@ namespace ip {
       }
       norm_const = sqrt(norm_const);
 
-      double norm_pixel = 0;
-      // project image patch onto PCA basis to get descriptor
+      // project image patch onto PCA basis to get descriptor, adding
+      // the basis row of each pixel in turn
+      float* result = &(*first);
+      size_t components = pca_basis.cols();
       unsigned int index = 0;
       for (int j = 0; j < support.impl().rows(); j++) {
         for (int i = 0; i < support.impl().cols(); i++) {
-          norm_pixel = support.impl()(i,j).v()/norm_const - pca_avg(index);
-
-          IterT fill = first;
-          for (unsigned k = 0; k < pca_basis.cols(); k++) {
-            *fill += norm_pixel * pca_basis(index,k);
-            fill++;
-          }
+          float norm_pixel = float(support.impl()(i,j).v()/norm_const - pca_avg(index));
+          detail::add_scaled_row( &pca_basis(index,0), norm_pixel, result, components );
           ++index;
         }
       }
@@ -246,6 +378,67 @@ namespace ip {
     int descriptor_size() { return 180; }
   };
 
+  /// A binary descriptor in the manner of BRIEF, steered by the
+  /// interest point's orientation as in ORB.  Each bit compares the
+  /// mean of two 5x5 windows of the rotated and scaled support
+  /// region, at a pair of locations drawn once from an isotropic
+  /// Gaussian about its center.  The bits are packed into the
+  /// binary_descriptor of each point, to be matched with the
+  /// HammingMetric, and the float descriptor is left empty.
+  struct BRIEFDescriptorGenerator : public DescriptorGeneratorBase<BRIEFDescriptorGenerator> {
+
+    /// The locations, relative to the center of the support region,
+    /// of the two windows compared by each bit.
+    struct TestPair {
+      int16 x0, y0, x1, y1;
+    };
+
+    /// A generator of descriptors with the given number of bits.  The
+    /// pattern depends only on bits, so descriptors from any two
+    /// generators of the same length can be compared.
+    BRIEFDescriptorGenerator( int bits = 256 );
+
+    template <class ViewT>
+    void operator() ( ImageViewBase<ViewT> const& image,
+                      InterestPointList& points ) {
+      Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+
+      for (InterestPointList::iterator i = points.begin(); i != points.end(); ++i) {
+        ImageView<float> support = pixel_cast<float>(get_support(*i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl()))));
+        i->descriptor.set_size( 0 );
+        compute_binary_descriptor( support, i->binary_descriptor );
+      }
+    }
+
+    /// Sets the bits of descriptor from a support region of
+    /// support_size() pixels on a side.
+    void compute_binary_descriptor( ImageView<float> const& support,
+                                    InterestPoint::binary_descriptor_type& descriptor ) const {
+      ImageView<float> iimage = IntegralImage( support, 1 );
+      int32 center = support_size() / 2;
+      descriptor.assign( ( m_pattern.size() + 63 ) / 64, 0 );
+      for ( size_t b = 0; b < m_pattern.size(); b++ ) {
+        TestPair const& pair = m_pattern[b];
+        // Window sums, from the integral image's corners.
+        int32 x0 = center + pair.x0 - 2, y0 = center + pair.y0 - 2;
+        int32 x1 = center + pair.x1 - 2, y1 = center + pair.y1 - 2;
+        float first = IntegralBlock( iimage, Vector2i(x0,y0), Vector2i(x0+5,y0+5) );
+        float second = IntegralBlock( iimage, Vector2i(x1,y1), Vector2i(x1+5,y1+5) );
+        if ( first < second )
+          descriptor[b / 64] |= uint64(1) << (b % 64);
+      }
+    }
+
+    std::vector<TestPair> const& pattern() const { return m_pattern; }
+
+    int support_size() const { return 41; }
+    int descriptor_size() const { return 0; }
+    int binary_descriptor_bits() const { return m_pattern.size(); }
+
+  private:
+    std::vector<TestPair> m_pattern;
+  };
+
 }} // namespace vw::ip
 
 
@@ -13,10 +13,14 @@
 #ifndef __VW_INTERESTPOINT_INTEGRAL_DETECTOR_H__
 #define __VW_INTERESTPOINT_INTEGRAL_DETECTOR_H__
 
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/InterestPoint/Detector.h>
 #include <vw/InterestPoint/IntegralImage.h>
 #include <deque>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 namespace vw {
 namespace ip {
@@ -113,6 +117,16 @@ namespace ip {
     /// Detect Interest Points in the source image.
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image ) const {
+      return process_image( image, bounding_box(image.impl()) );
+    }
+
+    /// Detect Interest Points in the source image, keeping only those
+    /// that lie in region. The rest of the image is only read as
+    /// support for the filters, so a tile grown by margin() on each
+    /// side finds the same points in the tile as the whole image does.
+    template <class ViewT>
+    InterestPointList process_image(ImageViewBase<ViewT> const& image,
+                                    BBox2i const& region ) const {
       typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
       typedef ImageInterestData<ImageT,InterestT> DataT;
 
@@ -158,22 +172,27 @@ namespace ip {
 
         InterestPointList scale_points;
 
-        // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
+        // Detecting interest points in middle. A point is reported
+        // one pixel down and right of its extremum.
+        int32 col_begin = std::max( 1, region.min().x() - 1 );
+        int32 row_begin = std::max( 1, region.min().y() - 1 );
+        int32 cols = std::min( original_image.cols() - 1, region.max().x() - 1 ) - col_begin;
+        int32 rows = std::min( original_image.rows() - 1, region.max().y() - 1 ) - row_begin;
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
         AccessT m_row = interest_data[1].interest().origin();
         AccessT h_row = interest_data[2].interest().origin();
-        l_row.advance(1,1); m_row.advance(1,1); h_row.advance(1,1);
+        l_row.advance(col_begin,row_begin);
+        m_row.advance(col_begin,row_begin);
+        h_row.advance(col_begin,row_begin);
         for ( int32 r=0; r < rows; r++ ) {
           AccessT l_col = l_row;
           AccessT m_col = m_row;
           AccessT h_col = h_row;
           for ( int32 c=0; c < cols; c++ ) {
             if ( is_extrema( l_col, m_col, h_col ) )
-              scale_points.push_back(InterestPoint(c+2,r+2,
+              scale_points.push_back(InterestPoint(c+col_begin+1,r+row_begin+1,
                                                    m_interest.float_scale(scale-1),
                                                    *m_col) );
             l_col.next_col();
@@ -217,6 +236,13 @@ namespace ip {
       return new_points;
     }
 
+    /// The number of pixels around a region that are read to find
+    /// the interest points in it: the support of the largest scale's
+    /// filter, of the threshold and of the orientation.
+    int32 margin() const {
+      return int32( std::ceil( 8 * m_interest.float_scale( std::max(m_scales-1, 0) ) ) ) + 2;
+    }
+
   protected:
 
     InterestT m_interest;
@@ -269,6 +295,79 @@ namespace ip {
   };
 
 
+  /// \cond INTERNAL
+  template <class ViewT, class InterestT>
+  class IntegralInterestPointDetectionTask : public Task, private boost::noncopyable {
+    ViewT m_view;
+    IntegralInterestPointDetector<InterestT> const& m_detector;
+    BBox2i m_bbox;
+    InterestPointList& m_interest_point_list;
+    int m_id, m_max_id;
+
+  public:
+    IntegralInterestPointDetectionTask( ViewT const& view,
+                                        IntegralInterestPointDetector<InterestT> const& detector,
+                                        BBox2i bbox, InterestPointList& ip_list,
+                                        int id, int max_id ) :
+      m_view(view), m_detector(detector), m_bbox(bbox),
+      m_interest_point_list(ip_list), m_id(id), m_max_id(max_id) {}
+
+    void operator()() {
+      vw_out(InfoMessage, "interest_point") << "Locating interest points in block " << m_id << "/" << m_max_id << "   [ " << m_bbox << " ]\n";
+      BBox2i support = m_bbox;
+      support.expand( m_detector.margin() );
+      support.crop( bounding_box( m_view ) );
+      m_interest_point_list =
+        m_detector.process_image( crop(pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(m_view)), support),
+                                  m_bbox - support.min() );
+      for (InterestPointList::iterator pt = m_interest_point_list.begin(); pt != m_interest_point_list.end(); ++pt) {
+        (*pt).x +=  support.min().x();
+        (*pt).ix += support.min().x();
+        (*pt).y +=  support.min().y();
+        (*pt).iy += support.min().y();
+      }
+    }
+  };
+  /// \endcond
+
+  /// Multithreaded detection for the integral detector.  The image is
+  /// split into tiles as by the generic detect_interest_points(), but
+  /// each tile is processed with a margin of the image around it, and
+  /// keeps only the points whose location falls in the tile.  Points
+  /// near the seams are so found as in the whole image, and found
+  /// once.  Culling to the detector's max points is still per tile.
+  template <class ViewT, class InterestT>
+  InterestPointList detect_interest_points( ViewT const& view,
+                                            IntegralInterestPointDetector<InterestT>& detector ) {
+    typedef IntegralInterestPointDetectionTask<ViewT, InterestT> task_type;
+
+    vw_out(DebugMessage, "interest_point") << "Running MT interest point detector.  Input image: [ " << view.impl().cols() << " x " << view.impl().rows() << " ]\n";
+
+    int tile_size = vw_settings().default_tile_size();
+    if (tile_size < 1024) tile_size = 1024;
+    std::vector<BBox2i> bboxes = image_blocks(view.impl(), tile_size, tile_size);
+
+    // Each tile fills its own list, and they are merged in tile order
+    // so the result doesn't depend on thread timing.
+    std::vector<InterestPointList> tile_lists( bboxes.size() );
+    {
+      FifoWorkQueue queue(vw_settings().default_num_threads());
+      for (unsigned i = 0; i < bboxes.size(); ++i) {
+        boost::shared_ptr<task_type> task( new task_type(view.impl(), detector, bboxes[i], tile_lists[i], i+1, bboxes.size()) );
+        queue.add_task(task);
+      }
+      vw_out(DebugMessage, "interest_point") << "Waiting for threads to terminate.\n";
+      queue.join_all();
+    }
+
+    InterestPointList ip_list;
+    for (unsigned i = 0; i < tile_lists.size(); ++i)
+      ip_list.splice(ip_list.end(), tile_lists[i]);
+
+    vw_out(DebugMessage, "interest_point") << "MT interest point detection complete.  " << ip_list.size() << " interest point detected.\n";
+    return ip_list;
+  }
+
 }} // end vw::ip
 
 #endif//__VW_INTERESTPOINT_INTEGRAL_DETECTOR_H__
@@ -12,66 +12,200 @@
 #ifndef __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 #define __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 
+#include <algorithm>
+#include <vector>
 #include <boost/utility/enable_if.hpp>
+#include <vw/config.h>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/BlockProcessor.h>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace vw {
 namespace ip {
 
-  /// Creates Integral Image
-  template <class ViewT>
-  inline ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type>
-  IntegralImage( ImageViewBase<ViewT> const& source ) {
+  /// \cond INTERNAL
+  namespace detail {
 
-    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+    // Takes the gray value of a pixel, as the integral image sums it.
+    template <class ChannelT>
+    struct IntegralGrayFunctor : ReturnFixedType<ChannelT> {
+      template <class PixelT>
+      ChannelT operator()( PixelT const& pixel ) const {
+        return pixel_cast<PixelGray<ChannelT> >( pixel ).v();
+      }
+    };
+
+    // Returns the gray values of an image as a plain ImageView,
+    // without a copy if it already is one.
+    template <class ChannelT, class ViewT>
+    inline ImageView<ChannelT> integral_source( ImageViewBase<ViewT> const& source ) {
+      ImageView<ChannelT> result = UnaryPerPixelView<ViewT, IntegralGrayFunctor<ChannelT> >( source.impl(), IntegralGrayFunctor<ChannelT>() );
+      return result;
+    }
+    template <class ChannelT>
+    inline ImageView<ChannelT> integral_source( ImageView<ChannelT> const& source ) {
+      return source;
+    }
 
-    // Allocating space
-    ImageView<channel_type> integral( source.impl().cols()+1, source.impl().rows()+1 );
+    // cur[i] += prev[i]
+    template <class T>
+    inline void integral_add_row( T const* prev, T* cur, int32 n ) {
+      for( int32 i=0; i<n; ++i )
+        cur[i] += prev[i];
+    }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+    inline void integral_add_row( float const* prev, float* cur, int32 n ) {
+      int32 i = 0;
+      for( ; i+4<=n; i+=4 )
+        _mm_storeu_ps( cur+i, _mm_add_ps( _mm_loadu_ps(cur+i), _mm_loadu_ps(prev+i) ) );
+      for( ; i<n; ++i )
+        cur[i] += prev[i];
+    }
+    inline void integral_add_row( double const* prev, double* cur, int32 n ) {
+      int32 i = 0;
+      for( ; i+2<=n; i+=2 )
+        _mm_storeu_pd( cur+i, _mm_add_pd( _mm_loadu_pd(cur+i), _mm_loadu_pd(prev+i) ) );
+      for( ; i<n; ++i )
+        cur[i] += prev[i];
+    }
+#endif
 
-    typedef typename ImageView<channel_type>::pixel_accessor dst_accessor;
-    typedef typename ViewT::pixel_accessor src_accessor;
+    // out[i] += weight * ( p0[i] - p1[i] - p2[i] + p3[i] ), the
+    // weighted sums of a row of boxes whose corners lie on the rows
+    // p0..p3 of an integral image.  Summed in this order, a box
+    // comes out as from apply_box_filter_at_point().
+    template <class T>
+    inline void add_box_sum_row( T const* p0, T const* p1, T const* p2, T const* p3,
+                                 T weight, T* out, int32 n ) {
+      for( int32 i=0; i<n; ++i )
+        out[i] += weight * ( ( ( p0[i] - p1[i] ) - p2[i] ) + p3[i] );
+    }
 
-    // Zero-ing the first row and col
-    dst_accessor dest_row = integral.origin();
-    *dest_row = 0;
-    for ( int i = 1; i < integral.cols(); i++ ) {
-      dest_row.next_col();
-      *dest_row = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+    inline void add_box_sum_row( float const* p0, float const* p1, float const* p2, float const* p3,
+                                 float weight, float* out, int32 n ) {
+      __m128 w = _mm_set1_ps( weight );
+      int32 i = 0;
+      for( ; i+4<=n; i+=4 ) {
+        __m128 sum = _mm_sub_ps( _mm_loadu_ps(p0+i), _mm_loadu_ps(p1+i) );
+        sum = _mm_sub_ps( sum, _mm_loadu_ps(p2+i) );
+        sum = _mm_add_ps( sum, _mm_loadu_ps(p3+i) );
+        _mm_storeu_ps( out+i, _mm_add_ps( _mm_loadu_ps(out+i), _mm_mul_ps( w, sum ) ) );
+      }
+      for( ; i<n; ++i )
+        out[i] += weight * ( ( ( p0[i] - p1[i] ) - p2[i] ) + p3[i] );
     }
-    dest_row = integral.origin();
-    for ( int i = 1; i < integral.rows(); i++ ) {
-      dest_row.next_row();
-      *dest_row = 0;
+#endif
+
+    // Adds weight times the sums of the n blocks from (x0+i,y0) to
+    // (x1+i,y1), as IntegralBlock() describes them, to out.
+    template <class PixelT>
+    inline void add_integral_block_row( ImageView<PixelT> const& integral,
+                                        int32 x0, int32 y0, int32 x1, int32 y1,
+                                        PixelT weight, PixelT* out, int32 n ) {
+      VW_DEBUG_ASSERT( x0 >= 0 && y0 >= 0 && x1+n <= integral.cols() && y1 < integral.rows(),
+                       vw::ArgumentErr() << "Integral block row out of bounds. "
+                       << Vector2i(x0,y0) << Vector2i(x1+n-1,y1) << "\n" );
+      add_box_sum_row( &integral(x0,y0), &integral(x1,y0), &integral(x0,y1), &integral(x1,y1),
+                       weight, out, n );
     }
 
-    // Pointer and pointer offset
-    int offset = integral.cols();
-    channel_type* p;
-
-    // Now filling in integral image
-    dest_row = integral.origin();
-    dest_row.advance(1,1);
-    src_accessor src_row = source.impl().origin();
-    for ( int iy = 0; iy < source.impl().rows(); iy++ ) {
-      dst_accessor dest_col = dest_row;
-      src_accessor src_col = src_row;
-      for ( int ix = 0; ix < source.impl().cols(); ix++ ) {
-        p = &(*dest_col);
-
-        // Summing
-        *dest_col = pixel_cast<PixelGray<channel_type> >(*src_col).v() + *(p-1) + *(p-offset) - *(p-offset-1);
-
-        dest_col.next_col();
-      src_col.next_col();
+    // First pass: the running sum along each row of a band of rows.
+    template <class ChannelT, class AccumT>
+    class IntegralRowFunctor {
+      ImageView<ChannelT> const& m_source;
+      ImageView<AccumT> const& m_integral;
+    public:
+      IntegralRowFunctor( ImageView<ChannelT> const& source, ImageView<AccumT> const& integral )
+        : m_source(source), m_integral(integral) {}
+      void operator()( BBox2i const& bbox ) const {
+        for( int32 y=bbox.min().y(); y<bbox.max().y(); ++y ) {
+          ChannelT const* src = &m_source(0,y);
+          AccumT* dst = &m_integral(0,y+1);
+          AccumT sum = AccumT();
+          dst[0] = sum;
+          for( int32 x=0; x<m_source.cols(); ++x ) {
+            sum += AccumT( src[x] );
+            dst[x+1] = sum;
+          }
+        }
       }
-      dest_row.next_row();
-      src_row.next_row();
+    };
+
+    // Second pass: the running sum down each column of a strip of
+    // columns.  Each row of the strip is one contiguous add.
+    template <class AccumT>
+    class IntegralColumnFunctor {
+      ImageView<AccumT> const& m_integral;
+    public:
+      IntegralColumnFunctor( ImageView<AccumT> const& integral ) : m_integral(integral) {}
+      void operator()( BBox2i const& bbox ) const {
+        for( int32 y=2; y<m_integral.rows(); ++y )
+          integral_add_row( &m_integral(bbox.min().x(),y-1), &m_integral(bbox.min().x(),y), bbox.width() );
+      }
+    };
+
+  } // namespace detail
+  /// \endcond
+
+  /// Creates Integral Image
+  ///
+  /// The result has one more row and column than the source, with
+  /// zeros along the top and left, and holds the sums of the gray
+  /// values in AccumT.  Choosing float (or int64 for integer images)
+  /// instead of double halves the memory of the table; float loses
+  /// precision on large images.
+  ///
+  /// It is built in two passes, row sums over bands of rows and then
+  /// column sums over strips of columns, each spread over num_threads
+  /// threads (zero means the default_num_threads setting for large
+  /// images, and a single thread for small ones).
+  template <class AccumT, class ViewT>
+  inline ImageView<AccumT>
+  IntegralImage( ImageViewBase<ViewT> const& source, int num_threads = 0 ) {
+    typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
+
+    ImageView<channel_type> gray = detail::integral_source<channel_type>( source.impl() );
+    ImageView<AccumT> integral( gray.cols()+1, gray.rows()+1 );
+    std::fill( &integral(0,0), &integral(0,0) + integral.cols(), AccumT() );
+    if( gray.cols() == 0 || gray.rows() == 0 ) {
+      for( int32 y=1; y<integral.rows(); ++y ) integral(0,y) = AccumT();
+      return integral;
     }
 
+    if( num_threads <= 0 )
+      num_threads = ( int64(gray.cols()) * gray.rows() < 512*512 ) ? 1 : vw_settings().default_num_threads();
+
+    int32 band_rows = std::max( 1, (gray.rows() + 4*num_threads - 1) / (4*num_threads) );
+    detail::IntegralRowFunctor<channel_type, AccumT> rows_func( gray, integral );
+    BlockProcessor<detail::IntegralRowFunctor<channel_type, AccumT> > rows( rows_func, Vector2i( gray.cols(), band_rows ), num_threads );
+    rows( BBox2i( 0, 0, gray.cols(), gray.rows() ) );
+
+    // Strips of columns narrow enough that two rows of one stay in
+    // cache, so each thread streams down its strip.
+    const int32 strip = 1024;
+    detail::IntegralColumnFunctor<AccumT> cols_func( integral );
+    BlockProcessor<detail::IntegralColumnFunctor<AccumT> > cols( cols_func, Vector2i( strip, 1 ), num_threads );
+    cols( BBox2i( 0, 0, integral.cols(), 1 ) );
+
     return integral;
   }
 
+  /// Creates Integral Image, accumulating in the channel type of the
+  /// source.
+  template <class ViewT>
+  inline ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type>
+  IntegralImage( ImageViewBase<ViewT> const& source, int num_threads = 0 ) {
+    return IntegralImage<typename PixelChannelType<typename ViewT::pixel_type>::type>( source, num_threads );
+  }
+
   /// Integral Block Evaluation
   ///
   /// This is for summing an area of pixels described by integral
@@ -229,6 +363,88 @@ namespace ip {
     return derivative;
   }
 
+  /// Row versions of the derivatives above
+  ///
+  /// These evaluate a derivative at the n locations (x,y) to
+  /// (x+n-1,y) into out, reading each corner of a lobe from one
+  /// contiguous stretch of an integral image row rather than looking
+  /// up every pixel's corners apart.  The lobes are summed in the
+  /// order of apply_box_filter_at_point(), so the results may differ
+  /// from the single location versions in the last bits.
+  template <class PixelT>
+  inline void
+  XSecondDerivativeRow( ImageView<PixelT> const& integral,
+                        int32 x, int32 y, unsigned filter_size,
+                        int32 n, PixelT* out ) {
+    int32 lobe = filter_size / 3;
+    int32 half_lobe = lobe / 2;
+    std::fill( out, out + n, PixelT() );
+    detail::add_integral_block_row( integral, x - lobe - half_lobe, y - lobe + 1,
+                                    x - half_lobe, y + lobe, PixelT(1), out, n );
+    detail::add_integral_block_row( integral, x - half_lobe, y - lobe + 1,
+                                    x + half_lobe + 1, y + lobe, PixelT(-2), out, n );
+    detail::add_integral_block_row( integral, x + half_lobe + 1, y - lobe + 1,
+                                    x + half_lobe + lobe + 1, y + lobe, PixelT(1), out, n );
+    PixelT area = PixelT( filter_size*filter_size );
+    for ( int32 i = 0; i < n; i++ )
+      out[i] /= area;
+  }
+
+  template <class PixelT>
+  inline void
+  YSecondDerivativeRow( ImageView<PixelT> const& integral,
+                        int32 x, int32 y, unsigned filter_size,
+                        int32 n, PixelT* out ) {
+    int32 lobe = filter_size / 3;
+    int32 half_lobe = lobe / 2;
+    std::fill( out, out + n, PixelT() );
+    detail::add_integral_block_row( integral, x - lobe + 1, y - lobe - half_lobe,
+                                    x + lobe, y - half_lobe, PixelT(1), out, n );
+    detail::add_integral_block_row( integral, x - lobe + 1, y - half_lobe,
+                                    x + lobe, y + half_lobe + 1, PixelT(-2), out, n );
+    detail::add_integral_block_row( integral, x - lobe + 1, y + half_lobe + 1,
+                                    x + lobe, y + half_lobe + lobe + 1, PixelT(1), out, n );
+    PixelT area = PixelT( filter_size*filter_size );
+    for ( int32 i = 0; i < n; i++ )
+      out[i] /= area;
+  }
+
+  template <class PixelT>
+  inline void
+  XYDerivativeRow( ImageView<PixelT> const& integral,
+                   int32 x, int32 y, unsigned filter_size,
+                   int32 n, PixelT* out ) {
+    int32 lobe = filter_size / 3;
+    std::fill( out, out + n, PixelT() );
+    detail::add_integral_block_row( integral, x - lobe, y - lobe, x, y, PixelT(1), out, n );
+    detail::add_integral_block_row( integral, x + 1, y - lobe, x + lobe + 1, y, PixelT(-1), out, n );
+    detail::add_integral_block_row( integral, x - lobe, y + 1, x, y + lobe + 1, PixelT(-1), out, n );
+    detail::add_integral_block_row( integral, x + 1, y + 1, x + 1 + lobe, y + 1 + lobe, PixelT(1), out, n );
+    PixelT area = PixelT( filter_size*filter_size );
+    for ( int32 i = 0; i < n; i++ )
+      out[i] /= area;
+  }
+
+  /// Determinant of the Hessian, as approximated by SURF, at the n
+  /// locations (x,y) to (x+n-1,y):
+  ///   Dxx * Dyy - ( 0.9 * Dxy )^2
+  template <class PixelT>
+  inline void
+  HessianDeterminantRow( ImageView<PixelT> const& integral,
+                         int32 x, int32 y, unsigned filter_size,
+                         int32 n, PixelT* out ) {
+    if ( n <= 0 )
+      return;
+    std::vector<PixelT> dxx( n ), dyy( n );
+    XSecondDerivativeRow( integral, x, y, filter_size, n, &dxx[0] );
+    YSecondDerivativeRow( integral, x, y, filter_size, n, &dyy[0] );
+    XYDerivativeRow( integral, x, y, filter_size, n, out );
+    for ( int32 i = 0; i < n; i++ ) {
+      PixelT dxy = PixelT(0.9) * out[i];
+      out[i] = dxx[i] * dyy[i] - dxy * dxy;
+    }
+  }
+
   // Horizontal Wavelet
   // - integral  = Integral used for calculations
   // - x         = x location to evaluate at
@@ -14,6 +14,7 @@
 
 // STL
 #include <vector>
+#include <cmath>
 
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Filter.h>
@@ -96,8 +97,13 @@ namespace ip {
         bfilter.push_back(instance);
       }
 
-      // 2.) Apply Filter ( DataT performs actual render )
-      data.set_interest(ImageViewRef<typename DataT::integral_type::pixel_type>( abs(box_filter(data.integral(), bfilter))));
+      // 2.) Apply Filter, a row at a time, and take its magnitude
+      typedef typename DataT::integral_type::pixel_type pixel_type;
+      ImageView<pixel_type> interest = box_filter(data.integral(), bfilter);
+      pixel_type* response = interest.data();
+      for ( pixel_type* end = response + interest.cols()*interest.rows(); response != end; ++response )
+        *response = std::abs( *response );
+      data.set_interest( interest );
     }
 
     // Threshold will reassign the interest with the harris corner detector
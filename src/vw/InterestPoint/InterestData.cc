@@ -11,6 +11,7 @@
 ///
 #include <fstream>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/CompactInterestData.h>
 
 namespace vw {
 namespace ip {
@@ -40,6 +41,11 @@ namespace ip {
     fclose(out);
   }
 
+  // A record holds the float descriptor's length and elements, or
+  // for a binary descriptor its length in words with this bit set
+  // and then the words.
+  static const uint64 binary_descriptor_flag = uint64(1) << 63;
+
   inline void write_ip_record(std::ofstream &f, InterestPoint const& p) {
     f.write((char*)&(p.x), sizeof(p.x));
     f.write((char*)&(p.y), sizeof(p.y));
@@ -51,6 +57,12 @@ namespace ip {
     f.write((char*)&(p.polarity), sizeof(p.polarity));
     f.write((char*)&(p.octave), sizeof(p.octave));
     f.write((char*)&(p.scale_lvl), sizeof(p.scale_lvl));
+    if ( p.descriptor.size() == 0 && !p.binary_descriptor.empty() ) {
+      uint64 size = binary_descriptor_flag | uint64(p.binary_descriptor.size());
+      f.write((char*)(&size), sizeof(uint64));
+      f.write((char*)&(p.binary_descriptor[0]), sizeof(uint64)*p.binary_descriptor.size());
+      return;
+    }
     uint64 size = p.size();
     f.write((char*)(&size), sizeof(uint64));
     for (size_t i = 0; i < p.descriptor.size(); ++i)
@@ -72,6 +84,12 @@ namespace ip {
 
     uint64 size;
     f.read((char*)&(size), sizeof(uint64));
+    if ( size & binary_descriptor_flag ) {
+      ip.binary_descriptor.resize( size & ~binary_descriptor_flag );
+      if ( !ip.binary_descriptor.empty() )
+        f.read((char*)&(ip.binary_descriptor[0]), sizeof(uint64)*ip.binary_descriptor.size());
+      return ip;
+    }
     ip.descriptor = Vector<double>(size);
     for (size_t i = 0; i < size; ++i)
       f.read((char*)&(ip.descriptor[i]), sizeof(ip.descriptor[i]));
@@ -90,6 +108,9 @@ namespace ip {
   }
 
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file) {
+    if ( is_compact_ip_file(ip_file) )
+      return read_compact_ip_file(ip_file);
+
     std::vector<InterestPoint> result;
 
     std::ifstream f;
@@ -167,6 +188,9 @@ namespace ip {
   }
 
   /// Helpful functors
-  void remove_descriptor( InterestPoint & ip ) { ip.descriptor.set_size(0); }
+  void remove_descriptor( InterestPoint & ip ) {
+    ip.descriptor.set_size(0);
+    ip.binary_descriptor.clear();
+  }
 
 }} // namespace vw::ip
@@ -12,6 +12,7 @@
 #ifndef __INTEREST_DATA_H__
 #define __INTEREST_DATA_H__
 
+#include <vw/Core/FundamentalTypes.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Functors.h>
 #include <vw/Image/ImageViewBase.h>
@@ -29,6 +30,9 @@ namespace ip {
     typedef vw::Vector<float> descriptor_type;
     typedef descriptor_type::iterator iterator;
     typedef descriptor_type::const_iterator const_iterator;
+    /// Binary descriptors are packed 64 bits to a word, bit i of the
+    /// descriptor in bit i%64 of word i/64.
+    typedef std::vector<uint64> binary_descriptor_type;
 
     InterestPoint() {}
 
@@ -72,6 +76,11 @@ namespace ip {
     /// PCA descriptors would have a vector of floats or doubles...
     descriptor_type descriptor;
 
+    /// The descriptor of binary descriptor generators such as BRIEF,
+    /// compared by the HammingMetric.  It is left empty by the float
+    /// descriptor generators, and those leave descriptor empty.
+    binary_descriptor_type binary_descriptor;
+
     const_iterator begin() const { return descriptor.begin(); }
     iterator begin() { return descriptor.begin(); }
     const_iterator end() const { return descriptor.end(); }
@@ -97,7 +106,9 @@ namespace ip {
   std::vector<Vector3> iplist_to_vectorlist(std::vector<InterestPoint> const& iplist);
   std::vector<InterestPoint> vectorlist_to_iplist(std::vector<Vector3> const& veclist);
 
-  // Routines for reading & writing interest point data files
+  // Routines for reading & writing interest point data files.
+  // read_binary_ip_file() also reads the .vwip2 files of
+  // CompactInterestData.h.
   void write_lowe_ascii_ip_file(std::string ip_file, InterestPointList ip);
   void write_binary_ip_file(std::string ip_file, InterestPointList ip);
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file);
@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file InterestPointCache.cc
+///
+/// The cache of found interest points.
+///
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/InterestPoint/CompactInterestData.h>
+#include <vw/InterestPoint/InterestPointCache.h>
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  const uint64 fnv_offset = 14695981039346656037ULL;
+  const uint64 fnv_prime = 1099511628211ULL;
+
+  uint64 fnv1a( uint64 hash, char const* data, size_t size ) {
+    for ( size_t i = 0; i < size; i++ ) {
+      hash ^= uint8(data[i]);
+      hash *= fnv_prime;
+    }
+    return hash;
+  }
+
+} // anonymous namespace
+
+  uint64 hash_file( std::string const& filename ) {
+    std::ifstream f( filename.c_str(), std::ios::binary | std::ios::in );
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << filename << "\" for hashing." );
+    std::vector<char> buffer( 1 << 20 );
+    uint64 hash = fnv_offset;
+    while ( f ) {
+      f.read( &buffer[0], buffer.size() );
+      hash = fnv1a( hash, &buffer[0], size_t(f.gcount()) );
+    }
+    if ( f.bad() )
+      vw_throw( IOErr() << "Failed to read \"" << filename << "\" for hashing." );
+    return hash;
+  }
+
+  std::string InterestPointCache::cache_file( std::string const& image_file,
+                                              std::string const& settings ) const {
+    // The settings are hashed after the contents, separated by a
+    // byte that can't end a hash state by accident.
+    uint64 key = hash_file( image_file );
+    key = fnv1a( key, "\0", 1 );
+    key = fnv1a( key, settings.data(), settings.size() );
+
+    std::string name = image_file;
+    if ( !m_directory.empty() ) {
+      size_t slash = image_file.find_last_of( '/' );
+      name = m_directory + "/" +
+        ( slash == std::string::npos ? image_file : image_file.substr( slash + 1 ) );
+    }
+    std::ostringstream ostr;
+    ostr << name << "." << std::hex << std::setw(16) << std::setfill('0') << key << ".vwip2";
+    return ostr.str();
+  }
+
+  bool InterestPointCache::load( std::string const& filename, InterestPointList& ip ) const {
+    if ( !is_compact_ip_file( filename ) )
+      return false;
+    try {
+      std::vector<InterestPoint> points = read_compact_ip_file( filename );
+      ip.assign( points.begin(), points.end() );
+    } catch ( IOErr const& e ) {
+      vw_out(WarningMessage, "interest_point") << "Ignoring unreadable interest point cache \""
+                                               << filename << "\": " << e.what() << "\n";
+      return false;
+    }
+    vw_out(DebugMessage, "interest_point") << "Read cached interest points from \""
+                                           << filename << "\".\n";
+    return true;
+  }
+
+  void InterestPointCache::store( std::string const& filename, InterestPointList const& ip ) const {
+    std::string temporary = filename + ".tmp";
+    write_compact_ip_file( temporary, ip );
+    if ( std::rename( temporary.c_str(), filename.c_str() ) != 0 ) {
+      std::remove( temporary.c_str() );
+      vw_throw( IOErr() << "Failed to move interest point cache into place as \"" << filename << "\"." );
+    }
+  }
+
+}} // namespace vw::ip
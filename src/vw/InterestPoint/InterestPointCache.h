@@ -0,0 +1,62 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file InterestPointCache.h
+///
+/// A cache of the interest points found in image files, so that
+/// finding them again in an unchanged image with unchanged settings
+/// only costs reading a .vwip2 file.
+///
+/// A cached result is kept in "<image>.<key>.vwip2", next to the
+/// image or in a cache directory, where the key is a hash of the
+/// contents of the image file and of a string that describes the
+/// detector and descriptor settings.  Changing either the image or
+/// the settings changes the key, so a cache file that exists is
+/// always valid; stale ones are simply never read again.
+///
+#ifndef __VW_INTERESTPOINT_INTERESTPOINTCACHE_H__
+#define __VW_INTERESTPOINT_INTERESTPOINTCACHE_H__
+
+#include <string>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/InterestPoint/InterestData.h>
+
+namespace vw {
+namespace ip {
+
+  /// A 64 bit FNV-1a hash of the contents of a file.  Throws IOErr
+  /// if the file can't be read.
+  uint64 hash_file( std::string const& filename );
+
+  class InterestPointCache {
+    std::string m_directory;
+  public:
+    /// Cache files go in directory, or next to each image if it is
+    /// empty.
+    explicit InterestPointCache( std::string const& directory = "" ) : m_directory( directory ) {}
+
+    std::string const& directory() const { return m_directory; }
+
+    /// The cache file for an image and settings.  This reads the
+    /// whole image file to hash it.
+    std::string cache_file( std::string const& image_file, std::string const& settings ) const;
+
+    /// Reads the points cached in a file given by cache_file() into
+    /// ip.  Returns false, leaving ip alone, if there is no such file
+    /// or it can't be read.
+    bool load( std::string const& cache_file, InterestPointList& ip ) const;
+
+    /// Caches points in a file given by cache_file().  The file is
+    /// written under a temporary name and then renamed, so a reader
+    /// never sees it half written.
+    void store( std::string const& cache_file, InterestPointList const& ip ) const;
+  };
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTERESTPOINTCACHE_H__
@@ -10,6 +10,9 @@
 ///
 #include <vw/InterestPoint/Matcher.h>
 
+#include <map>
+#include <cmath>
+
 namespace vw {
 namespace ip {
 
@@ -36,6 +39,19 @@ namespace ip {
     return dist;
   }
 
+  float
+  HammingMetric::operator()( InterestPoint const& ip1, InterestPoint const& ip2,
+                             float maxdist ) const {
+    VW_ASSERT( ip1.binary_descriptor.size() == ip2.binary_descriptor.size(),
+               ArgumentErr() << "HammingMetric: binary descriptors differ in length." );
+    int32 dist = 0;
+    for (size_t i = 0; i < ip1.binary_descriptor.size(); i++) {
+      dist += detail::popcount( ip1.binary_descriptor[i] ^ ip2.binary_descriptor[i] );
+      if (dist > maxdist) break;  // abort calculation if distance exceeds upper bound
+    }
+    return float(dist);
+  }
+
   bool ScaleOrientationConstraint::operator()( InterestPoint const& baseline_ip,
                                                InterestPoint const& test_ip ) const {
     double sr = test_ip.scale / baseline_ip.scale;
@@ -65,30 +81,115 @@ namespace ip {
     return false;
   }
 
+  namespace {
+    // A location, and the pair it belongs to.
+    struct LocationEntry {
+      float x, y;
+      size_t index;
+      bool operator<( LocationEntry const& other ) const {
+        if ( x != other.x ) return x < other.x;
+        if ( y != other.y ) return y < other.y;
+        return index < other.index;
+      }
+    };
+
+    // Marks in last_of the pairs whose location in ip is not repeated
+    // by a later pair.
+    void mark_last_locations( std::vector<InterestPoint> const& ip,
+                              std::vector<bool>& last_of ) {
+      std::vector<LocationEntry> entries;
+      entries.reserve( ip.size() );
+      for ( size_t i = 0; i < ip.size(); ++i ) {
+        // NaN never equals anything, so such points are never
+        // duplicates, and they would upset the sort.
+        if ( ip[i].x != ip[i].x || ip[i].y != ip[i].y ) {
+          last_of[i] = true;
+          continue;
+        }
+        LocationEntry entry = { ip[i].x, ip[i].y, i };
+        entries.push_back( entry );
+      }
+      std::sort( entries.begin(), entries.end() );
+      for ( size_t k = 0; k < entries.size(); ++k )
+        last_of[entries[k].index] = k + 1 == entries.size() ||
+          entries[k+1].x != entries[k].x || entries[k+1].y != entries[k].y;
+    }
+
+    // The pairs kept so far in each cell of a grid over one image.
+    class LocationGrid {
+      typedef std::map<std::pair<int64, int64>, std::vector<size_t> > map_type;
+      std::vector<InterestPoint> const& m_ip;
+      double m_radius;
+      map_type m_cells;
+
+      std::pair<int64, int64> cell( double x, double y ) const {
+        return std::make_pair( int64( std::floor( x / m_radius ) ),
+                               int64( std::floor( y / m_radius ) ) );
+      }
+    public:
+      LocationGrid( std::vector<InterestPoint> const& ip, double radius )
+        : m_ip(ip), m_radius(radius) {}
+
+      bool near_kept( size_t i ) const {
+        std::pair<int64, int64> c = cell( m_ip[i].x, m_ip[i].y );
+        for ( int64 cx = c.first - 1; cx <= c.first + 1; ++cx )
+          for ( int64 cy = c.second - 1; cy <= c.second + 1; ++cy ) {
+            map_type::const_iterator it = m_cells.find( std::make_pair( cx, cy ) );
+            if ( it == m_cells.end() )
+              continue;
+            for ( size_t k = 0; k < it->second.size(); ++k ) {
+              double dx = m_ip[it->second[k]].x - m_ip[i].x;
+              double dy = m_ip[it->second[k]].y - m_ip[i].y;
+              if ( dx*dx + dy*dy <= m_radius*m_radius )
+                return true;
+            }
+          }
+        return false;
+      }
+
+      void keep( size_t i ) {
+        m_cells[cell( m_ip[i].x, m_ip[i].y )].push_back( i );
+      }
+    };
+  }
+
   void remove_duplicates(std::vector<InterestPoint>& ip1,
-                         std::vector<InterestPoint>& ip2) {
+                         std::vector<InterestPoint>& ip2,
+                         double radius) {
     VW_ASSERT( ip1.size() == ip2.size(),
                ArgumentErr() << "Input vectors are not the same size.");
+    VW_ASSERT( radius >= 0,
+               ArgumentErr() << "remove_duplicates: radius must not be negative.");
+
+    std::vector<bool> keep( ip1.size(), false );
+    if ( radius == 0 ) {
+      std::vector<bool> last1( ip1.size() ), last2( ip2.size() );
+      mark_last_locations( ip1, last1 );
+      mark_last_locations( ip2, last2 );
+      for ( size_t i = 0; i < ip1.size(); ++i )
+        keep[i] = last1[i] && last2[i];
+    } else {
+      LocationGrid grid1( ip1, radius ), grid2( ip2, radius );
+      for ( size_t i = ip1.size(); i-- > 0; ) {
+        if ( grid1.near_kept( i ) || grid2.near_kept( i ) )
+          continue;
+        keep[i] = true;
+        grid1.keep( i );
+        grid2.keep( i );
+      }
+    }
+
     std::vector<InterestPoint> ip1_fltr, ip2_fltr;
     ip1_fltr.reserve( ip1.size() );
     ip2_fltr.reserve( ip2.size() );
-
     for ( size_t i = 0; i < ip1.size(); ++i ) {
-      bool bad_entry = false;
-      for ( size_t j = i + 1; j < ip1.size(); ++j ) {
-        if ( (ip1[i].x == ip1[j].x && ip1[i].y == ip1[j].y) ||
-             (ip2[i].x == ip2[j].x && ip2[i].y == ip2[j].y) ) {
-          bad_entry = true;
-          break;
-        }
-      }
-      if (!bad_entry) {
+      if ( keep[i] ) {
         ip1_fltr.push_back( ip1[i] );
         ip2_fltr.push_back( ip2[i] );
       }
     }
-    ip1 = ip1_fltr;
-    ip2 = ip2_fltr;
+    ip1.swap( ip1_fltr );
+    ip2.swap( ip2_fltr );
   }
 
 }} // namespace vw::ip
@@ -13,16 +13,20 @@
 #define _INTERESTPOINT_MATCHER_H_
 
 #include <algorithm>
+#include <limits>
 
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/FlatKDTree.h>
 #include <vw/InterestPoint/Descriptor.h>
 #include <vector>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 
 #if VW_HAVE_PKG_FLANN
 #include <vw/Math/FLANNTree.h>
-#else
-#include <vw/Math/KDTree.h>
 #endif
 
 namespace vw {
@@ -49,6 +53,36 @@ namespace ip {
                       float maxdist = std::numeric_limits<float>::max()) const;
   };
 
+  /// \cond INTERNAL
+  namespace detail {
+    inline int32 popcount( uint64 word ) {
+#if defined(__GNUC__)
+      return __builtin_popcountll( word );
+#else
+      word = word - ((word >> 1) & 0x5555555555555555ULL);
+      word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+      word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+      return int32( (word * 0x0101010101010101ULL) >> 56 );
+#endif
+    }
+
+    inline int32 hamming_distance( uint64 const* a, uint64 const* b, size_t words ) {
+      int32 dist = 0;
+      for ( size_t i = 0; i < words; i++ )
+        dist += popcount( a[i] ^ b[i] );
+      return dist;
+    }
+  }
+  /// \endcond
+
+  /// Hamming distance: the number of bits that differ between the
+  /// binary descriptors of a pair of interest points, such as those
+  /// of the BRIEFDescriptorGenerator.
+  struct HammingMetric {
+    float operator() (InterestPoint const& ip1, InterestPoint const& ip2,
+                      float maxdist = std::numeric_limits<float>::max()) const;
+  };
+
   /// Interest Point Match contraints functors to return a list of
   /// allowed match candidates to an interest point.
   ///
@@ -114,6 +148,37 @@ namespace ip {
     }
   };
 
+  /// A kd-tree over the descriptors of a list of interest points,
+  /// built once so that many lists can be matched against it.  The
+  /// index keeps its own copy of the points.
+  class InterestPointIndex {
+    std::vector<InterestPoint> m_points;
+    boost::shared_ptr<math::FlatKDTree<float> > m_tree;
+
+  public:
+    template <class ListT>
+    explicit InterestPointIndex( ListT const& ip ) : m_points( ip.begin(), ip.end() ) {
+      if ( m_points.empty() )
+        return;
+      size_t dims = m_points[0].descriptor.size();
+      VW_ASSERT( dims > 0, ArgumentErr() << "InterestPointIndex: interest points have no descriptors." );
+      std::vector<float> descriptors;
+      descriptors.reserve( m_points.size() * dims );
+      for ( size_t i = 0; i < m_points.size(); i++ ) {
+        VW_ASSERT( m_points[i].descriptor.size() == dims,
+                   ArgumentErr() << "InterestPointIndex: descriptors differ in length." );
+        descriptors.insert( descriptors.end(), m_points[i].descriptor.begin(), m_points[i].descriptor.end() );
+      }
+      m_tree.reset( new math::FlatKDTree<float>( &descriptors[0], m_points.size(), dims ) );
+    }
+
+    size_t size() const { return m_points.size(); }
+    bool empty() const { return m_points.empty(); }
+    size_t dims() const { return m_tree ? m_tree->dims() : 0; }
+    InterestPoint const& operator[]( size_t i ) const { return m_points[i]; }
+    math::FlatKDTree<float> const& tree() const { return *m_tree; }
+  };
+
   // ---------------------------------------------------------------------------
   //                         Interest Point Matcher
   // ---------------------------------------------------------------------------
@@ -164,8 +229,21 @@ namespace ip {
       Vector<int> indices(2);
       Vector<float> distances(2);
 #else
-      math::KDTree<ListT> kd(ip2.begin()->size(), ip2);
-      vw_out(InfoMessage,"interest_point") << "KD-Tree created with " << kd.size() << " nodes and depth ranging from " << kd.min_depth() << " to " << kd.max_depth() << ".  Searching...\n";
+      // The two nearest of every point are found at once, in
+      // parallel, and then checked against the constraint in order.
+      InterestPointIndex kd( ip2 );
+      vw_out(InfoMessage,"interest_point") << "KD-Tree created over " << kd.size() << " points.  Searching...\n";
+      std::vector<float> queries;
+      queries.reserve( size * kd.dims() );
+      for ( IterT it = ip1.begin(); it != ip1.end(); ++it ) {
+        VW_ASSERT( it->descriptor.size() == kd.dims(),
+                   ArgumentErr() << "InterestPointMatcher: descriptors differ in length." );
+        queries.insert( queries.end(), it->descriptor.begin(), it->descriptor.end() );
+      }
+      std::vector<int32> indices( 2*size );
+      std::vector<float> distances( 2*size );
+      kd.tree().knn_search( &queries[0], size, 2, &indices[0], &distances[0] );
+      size_t query = 0;
 #endif
       progress_callback.report_progress(0);
 
@@ -180,9 +258,11 @@ namespace ip {
         nearest_records[0] = ip2[indices[0]];
         nearest_records[1] = ip2[indices[1]];
 #else
-        int num_records = kd.m_nearest_neighbors(ip, nearest_records, 2);
-        if (num_records != 2)
+        size_t q = query++;
+        if (indices[2*q+1] < 0)
           continue; // Ignore if there are no matches
+        nearest_records[0] = kd[indices[2*q]];
+        nearest_records[1] = kd[indices[2*q+1]];
 #endif
 
         bool constraint_satisfied = false;
@@ -210,85 +290,221 @@ namespace ip {
     }
   };
 
-  // Specialization to capture more speed.
+  /// \cond INTERNAL
+  namespace detail {
+    // Finds the match, if any, of each of a range of queries: the
+    // index of its nearest point when that is nearer than threshold
+    // times the second nearest, and -1 otherwise.
+    class InterestPointIndexTask : public Task, private boost::noncopyable {
+      InterestPointIndex const& m_index;
+      std::vector<InterestPoint const*> const& m_queries;
+      size_t m_begin, m_end, m_checks;
+      double m_threshold;
+      std::vector<int32>& m_matches;
+      ProgressCallback const& m_progress;
+
+    public:
+      InterestPointIndexTask( InterestPointIndex const& index,
+                              std::vector<InterestPoint const*> const& queries,
+                              size_t begin, size_t end, size_t checks, double threshold,
+                              std::vector<int32>& matches, ProgressCallback const& progress )
+        : m_index(index), m_queries(queries), m_begin(begin), m_end(end), m_checks(checks),
+          m_threshold(threshold), m_matches(matches), m_progress(progress) {}
+
+      void operator()() {
+        int32 indices[2];
+        float distances[2];
+        for ( size_t i = m_begin; i < m_end; i++ ) {
+          m_matches[i] = -1;
+          if ( m_progress.abort_requested() )
+            return;
+          size_t found = m_index.tree().knn_search( &m_queries[i]->descriptor[0], 2, indices, distances, m_checks );
+          if ( found == 2 && distances[0] < m_threshold * distances[1] )
+            m_matches[i] = indices[0];
+        }
+      }
+    };
+  }
+  /// \endcond
+
+  // Specialization to capture more speed.  The descriptors are
+  // indexed by a FlatKDTree, and the queries are answered in batches
+  // on the default number of threads.  With checks of zero the
+  // search is exact; otherwise it looks at about that many
+  // descriptors per query, trading some matches for speed.
   template <>
   class InterestPointMatcher<L2NormMetric, NullConstraint> {
     double m_threshold;
     L2NormMetric m_metric;
+    size_t m_checks;
 
   public:
 
-    InterestPointMatcher(double threshold = 0.5, L2NormMetric metric = L2NormMetric(), NullConstraint /*constraint*/ = NullConstraint())
-      : m_threshold(threshold), m_metric(metric) { }
+    InterestPointMatcher(double threshold = 0.5, L2NormMetric metric = L2NormMetric(), NullConstraint /*constraint*/ = NullConstraint(),
+                         size_t checks = 0)
+      : m_threshold(threshold), m_metric(metric), m_checks(checks) { }
+
+    size_t checks() const { return m_checks; }
+    void set_checks( size_t checks ) { m_checks = checks; }
 
     /// Given two lists of interest points, this routine returns the two lists
     /// of matching interest points based on the Metric and Constraints
     /// provided by the user.
     template <class ListT, class MatchListT>
     void operator()( ListT const& ip1, ListT const& ip2,
+                     MatchListT& matched_ip1, MatchListT& matched_ip2,
+                     bool bidirectional = false,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
+      matched_ip1.clear(); matched_ip2.clear();
+      if (!ip1.size() || !ip2.size()) {
+        vw_out(InfoMessage,"interest_point") << "KD-Tree: no points to match, exiting\n";
+        progress_callback.report_finished();
+        return;
+      }
+      InterestPointIndex index( ip2 );
+      vw_out(InfoMessage,"interest_point") << "KD-Tree created over " << index.size() << " points.  Searching...\n";
+      (*this)( ip1, index, matched_ip1, matched_ip2, bidirectional, progress_callback );
+    }
+
+    /// Matches a list of interest points against an index built
+    /// earlier, which may be shared by many calls.
+    template <class ListT, class MatchListT>
+    void operator()( ListT const& ip1, InterestPointIndex const& ip2,
                      MatchListT& matched_ip1, MatchListT& matched_ip2,
                      bool /*bidirectional*/ = false,
                      const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
       typedef typename ListT::const_iterator IterT;
 
-      Timer *total = new Timer("Total elapsed time", DebugMessage, "interest_point");
+      Timer total("Total elapsed time", DebugMessage, "interest_point");
 
       matched_ip1.clear(); matched_ip2.clear();
-      if (!ip1.size() || !ip2.size()) {
+      if (!ip1.size() || ip2.empty()) {
         vw_out(InfoMessage,"interest_point") << "KD-Tree: no points to match, exiting\n";
         progress_callback.report_finished();
         return;
       }
+      progress_callback.report_progress(0);
 
-      size_t size = ip1.size();
-      float inc_amt = 1.0f/float(size);
+      std::vector<InterestPoint const*> queries;
+      queries.reserve( ip1.size() );
+      for ( IterT it = ip1.begin(); it != ip1.end(); ++it ) {
+        VW_ASSERT( it->descriptor.size() == ip2.dims(),
+                   ArgumentErr() << "InterestPointMatcher: descriptors differ in length." );
+        queries.push_back( &(*it) );
+      }
 
-#if VW_HAVE_PKG_FLANN
-      Matrix<float> ip2_matrix( ip2.size(), ip2.begin()->size() );
-      Matrix<float>::iterator ip2_matrix_it = ip2_matrix.begin();
-      BOOST_FOREACH( InterestPoint const& ip, ip2 )
-        ip2_matrix_it = std::copy( ip.begin(), ip.end(), ip2_matrix_it );
+      // Each batch writes its own part of matches, which are then
+      // gathered in order, so the result doesn't depend on threads.
+      const size_t batch_size = 256;
+      std::vector<int32> matches( queries.size(), -1 );
+      {
+        FifoWorkQueue queue(vw_settings().default_num_threads());
+        for ( size_t begin = 0; begin < queries.size(); begin += batch_size ) {
+          boost::shared_ptr<detail::InterestPointIndexTask> task(
+            new detail::InterestPointIndexTask( ip2, queries, begin, std::min( begin + batch_size, queries.size() ),
+                                                m_checks, m_threshold, matches, progress_callback ) );
+          queue.add_task( task );
+        }
+        queue.join_all();
+      }
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+
+      for ( size_t i = 0; i < queries.size(); i++ ) {
+        if ( matches[i] < 0 )
+          continue;
+        matched_ip1.push_back( *queries[i] );
+        matched_ip2.push_back( ip2[matches[i]] );
+      }
 
-      math::FLANNTree<flann::L2<float> > kd( ip2_matrix );
-      vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+      progress_callback.report_finished();
+    }
+  };
 
-      Vector<int> indices(2);
-      Vector<float> distances(2);
-#else
-      math::KDTree<ListT> kd(ip2.begin()->size(), ip2);
-      vw_out(InfoMessage,"interest_point") << "KD-Tree created with " << kd.size() << " nodes and depth ranging from " << kd.min_depth() << " to " << kd.max_depth() << ".  Searching...\n";
-#endif
+  // Binary descriptors are matched by brute force, as a tree over
+  // their bits would gain little, but the descriptors of the second
+  // list are packed together first and compared a word at a time.
+  template <class ConstraintT>
+  class InterestPointMatcher<HammingMetric, ConstraintT> {
+    ConstraintT m_constraint;
+    double m_threshold;
+
+  public:
+
+    InterestPointMatcher(double threshold = 0.5, HammingMetric /*metric*/ = HammingMetric(), ConstraintT constraint = ConstraintT())
+      : m_constraint(constraint), m_threshold(threshold) { }
+
+    /// Given two lists of interest points, this routine returns the two lists
+    /// of matching interest points based on the Metric and Constraints
+    /// provided by the user.
+    template <class ListT, class MatchListT>
+    void operator()( ListT const& ip1, ListT const& ip2,
+                     MatchListT& matched_ip1, MatchListT& matched_ip2,
+                     bool bidirectional = false,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const {
+      typedef typename ListT::const_iterator IterT;
+
+      Timer total("Total elapsed time", DebugMessage, "interest_point");
+
+      matched_ip1.clear(); matched_ip2.clear();
+      if (ip1.size() < 1 || ip2.size() < 2) {
+        vw_out(InfoMessage,"interest_point") << "Hamming matcher: not enough points to match, exiting\n";
+        progress_callback.report_finished();
+        return;
+      }
+
+      size_t words = ip2.begin()->binary_descriptor.size();
+      std::vector<InterestPoint const*> candidates;
+      std::vector<uint64> packed;
+      candidates.reserve( ip2.size() );
+      packed.reserve( ip2.size() * words );
+      for ( IterT it = ip2.begin(); it != ip2.end(); ++it ) {
+        VW_ASSERT( it->binary_descriptor.size() == words,
+                   ArgumentErr() << "Hamming matcher: binary descriptors differ in length." );
+        candidates.push_back( &(*it) );
+        packed.insert( packed.end(), it->binary_descriptor.begin(), it->binary_descriptor.end() );
+      }
+      if ( words == 0 )
+        vw_throw( ArgumentErr() << "Hamming matcher: interest points have no binary descriptors." );
+
+      float inc_amt = 1.0f/float(ip1.size());
       progress_callback.report_progress(0);
 
-      BOOST_FOREACH( InterestPoint ip, ip1 ) {
+      for ( IterT it = ip1.begin(); it != ip1.end(); ++it ) {
         if (progress_callback.abort_requested())
           vw_throw( Aborted() << "Aborted by ProgressCallback" );
         progress_callback.report_incremental_progress(inc_amt);
 
-
-#if VW_HAVE_PKG_FLANN
-        kd.knn_search( ip.descriptor, indices, distances, 2 );
-        if ( distances[0] < m_threshold * distances[1] ) {
-          matched_ip1.push_back(ip);
-          matched_ip2.push_back(ip2[indices[0]]);
+        InterestPoint const& ip = *it;
+        VW_ASSERT( ip.binary_descriptor.size() == words,
+                   ArgumentErr() << "Hamming matcher: binary descriptors differ in length." );
+        uint64 const* query = &ip.binary_descriptor[0];
+
+        // The nearest two, the first found winning ties.
+        int32 first_dist = std::numeric_limits<int32>::max(), second_dist = first_dist;
+        size_t first = 0;
+        for ( size_t j = 0; j < candidates.size(); j++ ) {
+          int32 dist = detail::hamming_distance( query, &packed[j*words], words );
+          if ( dist < first_dist ) {
+            second_dist = first_dist;
+            first_dist = dist;
+            first = j;
+          } else if ( dist < second_dist ) {
+            second_dist = dist;
+          }
         }
-#else
-        std::vector<InterestPoint> nearest_records(2);
-        int num_records = kd.m_nearest_neighbors(ip, nearest_records, 2);
-        if (num_records != 2)
-          continue; // Ignore if there are no matches
-        double dist0 = m_metric(nearest_records[0], ip);
-        double dist1 = m_metric(nearest_records[1], ip);
 
-        if (dist0 < m_threshold * dist1) {
+        InterestPoint const& nearest = *candidates[first];
+        bool constraint_satisfied = m_constraint(nearest, ip);
+        if (bidirectional)
+          constraint_satisfied = constraint_satisfied && m_constraint(ip, nearest);
+        if ( constraint_satisfied && first_dist < m_threshold * second_dist ) {
           matched_ip1.push_back(ip);
-          matched_ip2.push_back(nearest_records[0]);
+          matched_ip2.push_back(nearest);
         }
-#endif
       }
 
       progress_callback.report_finished();
-      delete total;
     }
   };
 
@@ -376,12 +592,20 @@ namespace ip {
   // Convenience Typedefs
   typedef InterestPointMatcher< L2NormMetric, NullConstraint > DefaultMatcher;
   typedef InterestPointMatcher< L2NormMetric, ScaleOrientationConstraint > ConstraintedMatcher;
+  typedef InterestPointMatcher< HammingMetric, NullConstraint > BinaryMatcher;
 
   // Matching doesn't constraint a point to being matched to only one
   // other point. Here's a way to remove duplicates and have only
-  // pairwise points.
+  // pairwise points.  A pair is dropped when a later pair has the
+  // same location in either image.
+  //
+  // With a radius, pairs are instead taken from last to first, and a
+  // pair is dropped when one already kept lies within radius of it in
+  // either image, so that dense matches are thinned to about one per
+  // radius.
   void remove_duplicates(std::vector<InterestPoint>& ip1,
-                         std::vector<InterestPoint>& ip2);
+                         std::vector<InterestPoint>& ip2,
+                         double radius = 0);
 
 }} // namespace vw::ip
 
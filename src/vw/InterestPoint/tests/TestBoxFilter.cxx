@@ -78,3 +78,38 @@ TEST( BoxFilter, FilterView ) {
   EXPECT_NEAR( 0, applied(0,0), 1e-5 );
   EXPECT_NEAR( 0, applied(3,3), 1e-5 );
 }
+
+TEST( BoxFilter, Rows ) {
+  ImageView<float> image( 41, 30 );
+  for ( int32 j = 0; j < image.rows(); j++ )
+    for ( int32 i = 0; i < image.cols(); i++ )
+      image(i,j) = float( (i*13 + j*7 + i*j) % 17 ) / 17;
+  ImageView<float> integral = IntegralImage( image );
+
+  // A lopsided filter, like those of OBALoG.
+  BoxFilter filter(3);
+  filter[0].start = Vector2i(-5,-3); filter[0].size = Vector2i(11,7); filter[0].weight = 0.25;
+  filter[1].start = Vector2i(-1,-4); filter[1].size = Vector2i(3,9);  filter[1].weight = -1.5;
+  filter[2].start = Vector2i(-2,-2); filter[2].size = Vector2i(5,5);  filter[2].weight = 0.75;
+
+  // Each row is summed as apply_box_filter_at_point() sums a pixel,
+  // with the filter's border left at zero.
+  BoxFilterView<ImageView<float> > view = box_filter( integral, filter );
+  ImageView<float> applied = view;
+  ASSERT_EQ( image.cols(), applied.cols() );
+  ASSERT_EQ( image.rows(), applied.rows() );
+  for ( int32 j = 0; j < applied.rows(); j++ )
+    for ( int32 i = 0; i < applied.cols(); i++ ) {
+      if ( i < 5 || j < 5 || i >= image.cols()-5 || j >= image.rows()-5 )
+        EXPECT_EQ( 0, applied(i,j) );
+      else
+        EXPECT_EQ( apply_box_filter_at_point( integral.origin().advance(i,j), filter ), applied(i,j) );
+      EXPECT_EQ( view(i,j), applied(i,j) );
+    }
+
+  // Part of the view, reaching into the border.
+  ImageView<float> part = crop( view, BBox2i(3, 20, 30, 10) );
+  for ( int32 j = 0; j < part.rows(); j++ )
+    for ( int32 i = 0; i < part.cols(); i++ )
+      EXPECT_EQ( applied(i+3, j+20), part(i,j) );
+}
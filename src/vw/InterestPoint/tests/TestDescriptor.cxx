@@ -0,0 +1,123 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestDescriptor.cxx
+#include <gtest/gtest.h>
+
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/InterestPoint/Descriptor.h>
+
+#include <boost/random/linear_congruential.hpp>
+
+using namespace vw;
+using namespace vw::ip;
+
+static ImageView<PixelGray<float> > test_image() {
+  boost::rand48 gen(3);
+  return gaussian_filter( uniform_noise_view( gen, 200, 150 ), 1.5 );
+}
+
+// Points all over the image, some near or past its edges so that
+// their support regions fall off it.
+static InterestPointList test_points() {
+  boost::rand48 gen(8);
+  InterestPointList points;
+  for ( int32 i = 0; i < 150; i++ ) {
+    float x = float(gen() % 2300) / 10 - 15, y = float(gen() % 1800) / 10 - 15;
+    float scale = 0.5f + float(gen() % 300) / 100;
+    float orientation = float(gen() % 628) / 100 - 3.14f;
+    points.push_back( InterestPoint( x, y, scale, 1.0f, orientation ) );
+  }
+  return points;
+}
+
+// The descriptors of points one at a time from get_support(), as the
+// generators used to compute them.
+template <class GeneratorT, class ViewT>
+static std::vector<Vector<float> > reference( GeneratorT& generator, ViewT const& image,
+                                              InterestPointList points ) {
+  std::vector<Vector<float> > result;
+  for ( InterestPointList::iterator i = points.begin(); i != points.end(); ++i ) {
+    ImageView<PixelGray<float> > support = generator.get_support( *i, image );
+    i->descriptor.set_size( generator.descriptor_size() );
+    generator.compute_descriptor( support, i->begin(), i->end() );
+    result.push_back( i->descriptor );
+  }
+  return result;
+}
+
+template <class GeneratorT>
+static void expect_batched_matches( GeneratorT& generator ) {
+  ImageView<PixelGray<float> > image = test_image();
+  std::vector<Vector<float> > expected = reference( generator, image, test_points() );
+
+  // The same from an image view, from a view that isn't one, and
+  // with any number of threads.
+  int threads = vw_settings().default_num_threads();
+  for ( int32 pass = 0; pass < 3; pass++ ) {
+    vw_settings().set_default_num_threads( pass == 2 ? 1 : 4 );
+    InterestPointList points = test_points();
+    if ( pass == 0 )
+      generator( image, points );
+    else
+      generator( ImageViewRef<PixelGray<float> >( image ), points );
+    ASSERT_EQ( expected.size(), points.size() );
+    size_t k = 0;
+    for ( InterestPointList::iterator i = points.begin(); i != points.end(); ++i, ++k ) {
+      ASSERT_EQ( expected[k].size(), i->descriptor.size() );
+      for ( size_t d = 0; d < expected[k].size(); d++ )
+        EXPECT_NEAR( expected[k][d], i->descriptor[d], 1e-6 ) << "point " << k << " element " << d;
+    }
+  }
+  vw_settings().set_default_num_threads( threads );
+}
+
+TEST( Descriptor, PatchBatched ) {
+  PatchDescriptorGenerator generator;
+  expect_batched_matches( generator );
+}
+
+TEST( Descriptor, SGradBatched ) {
+  SGradDescriptorGenerator generator;
+  expect_batched_matches( generator );
+}
+
+TEST( Descriptor, PCASIFT ) {
+  boost::rand48 gen(5);
+  Matrix<float> basis( 41*41, 22 );
+  Vector<float> avg( 41*41 );
+  for ( size_t r = 0; r < basis.rows(); r++ ) {
+    avg[r] = float(gen() % 1000) / 40000;
+    for ( size_t c = 0; c < basis.cols(); c++ )
+      basis(r,c) = float(gen() % 2000) / 1000 - 1;
+  }
+  PCASIFTDescriptorGenerator generator( basis, avg );
+  expect_batched_matches( generator );
+
+  // The projection, in double precision.
+  ImageView<PixelGray<float> > image = test_image();
+  InterestPointList points = test_points();
+  generator( image, points );
+  InterestPoint const& pt = *boost::next( points.begin(), 17 );
+  ImageView<PixelGray<float> > support = generator.get_support( pt, image );
+  double norm = 0;
+  for ( int32 j = 0; j < 41; j++ )
+    for ( int32 i = 0; i < 41; i++ )
+      norm += support(i,j).v() * support(i,j).v();
+  norm = std::sqrt( norm );
+  for ( size_t c = 0; c < basis.cols(); c++ ) {
+    double expected = 0;
+    for ( int32 j = 0; j < 41; j++ )
+      for ( int32 i = 0; i < 41; i++ )
+        expected += ( support(i,j).v() / norm - avg[j*41+i] ) * basis(j*41+i, c);
+    EXPECT_NEAR( expected, pt.descriptor[c], 1e-4 );
+  }
+}
@@ -11,6 +11,7 @@
 #include <vw/InterestPoint/IntegralImage.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/FileIO/DiskImageResource.h>
 
 using namespace vw;
@@ -236,3 +237,73 @@ TEST( Integral, InterpolationProof ) {
                              10.5, 10.0, 10 ),
                1e-4 );
 }
+
+TEST( Integral, Accumulators ) {
+  ImageView<uint8> image(1100,37);
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = uint8( (x*31 + y*17) % 251 );
+
+  // Exact reference, summed the slow way.
+  ImageView<int64> expected(image.cols()+1, image.rows()+1);
+  for( int32 y=0; y<expected.rows(); ++y )
+    for( int32 x=0; x<expected.cols(); ++x )
+      expected(x,y) = ( x == 0 || y == 0 ) ? 0 :
+        image(x-1,y-1) + expected(x-1,y) + expected(x,y-1) - expected(x-1,y-1);
+
+  for( int threads=1; threads<=4; threads+=3 ) {
+    ImageView<int64> exact = IntegralImage<int64>( image, threads );
+    ImageView<double> wide = IntegralImage<double>( channel_cast<double>(image), threads );
+    ImageView<float> narrow = IntegralImage<float>( image, threads );
+    ASSERT_EQ( expected.cols(), exact.cols() );
+    ASSERT_EQ( expected.rows(), exact.rows() );
+    for( int32 y=0; y<expected.rows(); ++y )
+      for( int32 x=0; x<expected.cols(); ++x ) {
+        ASSERT_EQ( expected(x,y), exact(x,y) );
+        ASSERT_EQ( double(expected(x,y)), wide(x,y) );
+        ASSERT_NEAR( double(expected(x,y)), narrow(x,y), 1e-6*expected(x,y) );
+      }
+  }
+
+  // The default accumulates in the source's channel type.
+  ImageView<PixelGray<float> > gray(3,2);
+  gray(0,0) = 1; gray(1,0) = 2; gray(2,0) = 3;
+  gray(0,1) = 4; gray(1,1) = 5; gray(2,1) = 6;
+  ImageView<float> integral = IntegralImage( gray );
+  EXPECT_EQ( 0, integral(0,0) );
+  EXPECT_EQ( 0, integral(3,0) );
+  EXPECT_EQ( 0, integral(0,2) );
+  EXPECT_EQ( 6, integral(3,1) );
+  EXPECT_EQ( 21, integral(3,2) );
+  EXPECT_EQ( 12, integral(2,2) );
+}
+
+TEST( Integral, DerivativeRows ) {
+  ImageView<float> image( 60, 50 );
+  for( int32 y=0; y<image.rows(); ++y )
+    for( int32 x=0; x<image.cols(); ++x )
+      image(x,y) = float( (x*37 + y*101 + x*y) % 29 ) / 29;
+  ImageView<float> integral = IntegralImage( image );
+
+  // Row segments that start and end at odd places, so that the
+  // vector loops have short tails.
+  const int32 n = 23;
+  for( unsigned size=9; size<=21; size+=6 )
+    for( int32 y=size; y<int32(image.rows()-size); y+=5 ) {
+      int32 x = size + (y % 4);
+      float dxx[n], dyy[n], dxy[n], hessian[n];
+      XSecondDerivativeRow( integral, x, y, size, n, dxx );
+      YSecondDerivativeRow( integral, x, y, size, n, dyy );
+      XYDerivativeRow( integral, x, y, size, n, dxy );
+      HessianDeterminantRow( integral, x, y, size, n, hessian );
+      for( int32 i=0; i<n; ++i ) {
+        float exx = XSecondDerivative( integral, x+i, y, size );
+        float eyy = YSecondDerivative( integral, x+i, y, size );
+        float exy = XYDerivative( integral, x+i, y, size );
+        EXPECT_NEAR( exx, dxx[i], 1e-5 );
+        EXPECT_NEAR( eyy, dyy[i], 1e-5 );
+        EXPECT_NEAR( exy, dxy[i], 1e-5 );
+        EXPECT_NEAR( exx*eyy - 0.81*exy*exy, hessian[i], 1e-5 );
+      }
+    }
+}
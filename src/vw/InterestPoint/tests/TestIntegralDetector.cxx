@@ -0,0 +1,92 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// TestIntegralDetector.cxx
+#include <gtest/gtest.h>
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/InterestPoint/IntegralDetector.h>
+#include <vw/InterestPoint/IntegralInterestOperator.h>
+
+#include <boost/random/linear_congruential.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+using namespace vw::ip;
+
+typedef IntegralInterestPointDetector<OBALoGInterestOperator> DetectorT;
+
+// Blurred noise, stretched and rounded to multiples of 1/64 that sum
+// to under 2^18, so that the float integral images of the whole image
+// and of a tile are both exact.
+static ImageView<PixelGray<float> > blobs( int32 cols, int32 rows ) {
+  boost::rand48 gen(7);
+  ImageView<PixelGray<float> > image = gaussian_filter( uniform_noise_view( gen, cols, rows ), 2.0 );
+  for ( int32 j = 0; j < rows; j++ )
+    for ( int32 i = 0; i < cols; i++ ) {
+      float v = std::min( std::max( 0.5f + (image(i,j).v() - 0.5f) * 8, 0.0f ), 1.0f );
+      image(i,j) = std::floor( v * 0.2f * 64 + 0.5f ) / 64;
+    }
+  return image;
+}
+
+// Points may be found at one location in more than one scale.
+typedef std::pair<std::pair<int32, int32>, float> Location;
+
+static std::vector<Location> locations( InterestPointList const& points ) {
+  std::vector<Location> result;
+  for ( InterestPointList::const_iterator pt = points.begin(); pt != points.end(); ++pt )
+    result.push_back( Location( std::make_pair( pt->ix, pt->iy ), pt->scale ) );
+  std::sort( result.begin(), result.end() );
+  return result;
+}
+
+TEST( IntegralDetector, Region ) {
+  ImageView<PixelGray<float> > image = blobs( 400, 300 );
+  DetectorT detector( OBALoGInterestOperator(0.0005), 0 );
+  InterestPointList whole = detector.process_image( image );
+  ASSERT_GT( whole.size(), 50u );
+
+  // A region and its margin find the points of the whole image that
+  // lie in the region.
+  BBox2i region( 130, 90, 120, 100 );
+  BBox2i support = region;
+  support.expand( detector.margin() );
+  InterestPointList found =
+    detector.process_image( crop( image, support ), region - support.min() );
+  for ( InterestPointList::iterator pt = found.begin(); pt != found.end(); ++pt ) {
+    pt->ix += support.min().x();
+    pt->iy += support.min().y();
+  }
+
+  InterestPointList expected;
+  for ( InterestPointList::const_iterator pt = whole.begin(); pt != whole.end(); ++pt )
+    if ( region.contains( Vector2i( pt->ix, pt->iy ) ) )
+      expected.push_back( *pt );
+  ASSERT_GT( expected.size(), 0u );
+
+  std::vector<Location> a = locations( expected ), b = locations( found );
+  ASSERT_EQ( a.size(), b.size() );
+  EXPECT_TRUE( a == b );
+}
+
+TEST( IntegralDetector, Tiles ) {
+  // Several tiles of the smallest size the detector takes.
+  ImageView<PixelGray<float> > image = blobs( 1500, 1100 );
+  DetectorT detector( OBALoGInterestOperator(0.0005), 0 );
+  std::vector<Location> whole = locations( detector.process_image( image ) );
+  std::vector<Location> tiled = locations( detect_interest_points( image, detector ) );
+
+  // Nothing is lost or found twice along the seams.
+  ASSERT_GT( whole.size(), 1000u );
+  ASSERT_EQ( whole.size(), tiled.size() );
+  EXPECT_TRUE( whole == tiled );
+}
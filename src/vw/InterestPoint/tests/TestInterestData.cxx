@@ -8,6 +8,12 @@
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/CompactInterestData.h>
+#include <vw/InterestPoint/InterestPointCache.h>
+
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
 
 using namespace vw;
 using namespace vw::ip;
@@ -97,3 +103,175 @@ TEST( InterestData, MATCH_IO_Loop ) {
     ip1iter++; ip2iter++;
   }
 }
+
+TEST( InterestData, VWIP_IO_Binary ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 3; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -i, i, true, 5 ) );
+    ip.back().binary_descriptor.push_back( 0x8000000000000001ULL * (i+1) );
+    ip.back().binary_descriptor.push_back( uint64(i) << 40 );
+  }
+
+  UnlinkName vwip_file( "monkey_binary.vwip" );
+  write_binary_ip_file( vwip_file, ip );
+  std::vector<InterestPoint> result = read_binary_ip_file( vwip_file );
+
+  InterestPointList::iterator ipiter = ip.begin();
+  ASSERT_EQ( 3u, result.size() );
+  for ( uint32 i = 0; i < 3; i++ ) {
+    EXPECT_EQ( ipiter->x, result[i].x );
+    EXPECT_EQ( ipiter->scale_lvl, result[i].scale_lvl );
+    EXPECT_EQ( 0u, result[i].size() );
+    EXPECT_TRUE( ipiter->binary_descriptor == result[i].binary_descriptor );
+    ipiter++;
+  }
+}
+
+TEST( InterestData, VWIP2_IO_Loop ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i+0.5, 2*i+5, 1.0, -float(i), i, i % 2 == 0, 5, i ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+
+  UnlinkName vwip_file( "monkey.vwip2" );
+  write_compact_ip_file( vwip_file, ip );
+  EXPECT_TRUE( is_compact_ip_file( vwip_file ) );
+
+  // The file is read in place, and read_binary_ip_file also takes it.
+  CompactInterestPointFile file( vwip_file );
+  ASSERT_EQ( 5u, file.size() );
+  EXPECT_EQ( CompactInterestPointFile::FLOAT_DESCRIPTOR, file.descriptor_kind() );
+  EXPECT_EQ( 3u, file.descriptor_length() );
+  EXPECT_TRUE( file.binary_descriptors() == 0 );
+  EXPECT_EQ( 0u, size_t(file.descriptors()) % 16 );
+  EXPECT_EQ( 2, file.descriptor(2)[2] );
+  EXPECT_EQ( 6.5, file.record(3).x );
+  EXPECT_EQ( 3u, file.record(3).scale_lvl );
+
+  std::vector<InterestPoint> result = read_binary_ip_file( vwip_file );
+  InterestPointList::iterator ipiter = ip.begin();
+  ASSERT_EQ( 5u, result.size() );
+  for ( uint32 i = 0; i < 5; i++ ) {
+    EXPECT_EQ( ipiter->x, result[i].x );
+    EXPECT_EQ( ipiter->y, result[i].y );
+    EXPECT_EQ( ipiter->scale, result[i].scale );
+    EXPECT_EQ( ipiter->ix, result[i].ix );
+    EXPECT_EQ( ipiter->iy, result[i].iy );
+    EXPECT_EQ( ipiter->orientation, result[i].orientation );
+    EXPECT_EQ( ipiter->interest, result[i].interest );
+    EXPECT_EQ( ipiter->polarity, result[i].polarity );
+    EXPECT_EQ( ipiter->octave, result[i].octave );
+    EXPECT_EQ( ipiter->scale_lvl, result[i].scale_lvl );
+
+    ASSERT_EQ( ipiter->size(), result[i].size() );
+    EXPECT_VECTOR_FLOAT_EQ( ipiter->descriptor, result[i].descriptor );
+    EXPECT_TRUE( result[i].binary_descriptor.empty() );
+
+    ipiter++;
+  }
+}
+
+TEST( InterestData, VWIP2_IO_Binary ) {
+  std::vector<InterestPoint> ip;
+  for ( uint32 i = 0; i < 4; i++ ) {
+    ip.push_back( InterestPoint( i, 2*i ) );
+    ip.back().binary_descriptor.push_back( uint64(i) << 40 | 7 );
+    ip.back().binary_descriptor.push_back( ~uint64(i) );
+  }
+
+  UnlinkName vwip_file( "monkey_binary.vwip2" );
+  write_compact_ip_file( vwip_file, ip );
+  CompactInterestPointFile file( vwip_file );
+  ASSERT_EQ( 4u, file.size() );
+  EXPECT_EQ( CompactInterestPointFile::BINARY_DESCRIPTOR, file.descriptor_kind() );
+  EXPECT_EQ( 2u, file.descriptor_length() );
+  EXPECT_TRUE( file.descriptors() == 0 );
+
+  std::vector<InterestPoint> result = file.points();
+  ASSERT_EQ( 4u, result.size() );
+  for ( uint32 i = 0; i < 4; i++ ) {
+    EXPECT_EQ( 0u, result[i].descriptor.size() );
+    EXPECT_TRUE( ip[i].binary_descriptor == result[i].binary_descriptor );
+  }
+
+  // Descriptors must all be alike.
+  ip[2].binary_descriptor.pop_back();
+  EXPECT_THROW( write_compact_ip_file( vwip_file, ip ), ArgumentErr );
+}
+
+TEST( InterestData, VWIP2_Invalid ) {
+  UnlinkName empty_file( "monkey_empty.vwip2" );
+  write_compact_ip_file( empty_file, std::vector<InterestPoint>() );
+  CompactInterestPointFile empty( empty_file );
+  EXPECT_EQ( 0u, empty.size() );
+  EXPECT_EQ( CompactInterestPointFile::NO_DESCRIPTOR, empty.descriptor_kind() );
+
+  // Neither an old file nor a truncated one is taken.
+  UnlinkName vwip_file( "monkey_old.vwip" );
+  InterestPointList ip;
+  ip.push_back( InterestPoint( 1, 2 ) );
+  ip.back().descriptor = Vector3(5,6,7);
+  write_binary_ip_file( vwip_file, ip );
+  EXPECT_FALSE( is_compact_ip_file( vwip_file ) );
+  EXPECT_THROW( CompactInterestPointFile file( vwip_file ), IOErr );
+
+  UnlinkName truncated_file( "monkey_truncated.vwip2" );
+  write_compact_ip_file( truncated_file, ip );
+  std::vector<char> contents;
+  {
+    std::ifstream in( truncated_file.c_str(), std::ios::binary );
+    contents.assign( std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() );
+  }
+  {
+    std::ofstream out( truncated_file.c_str(), std::ios::binary );
+    out.write( &contents[0], contents.size() - 4 );
+  }
+  EXPECT_THROW( CompactInterestPointFile file( truncated_file ), IOErr );
+}
+
+TEST( InterestData, Cache ) {
+  UnlinkName directory( "monkey_cache" );
+  boost::filesystem::create_directory( directory );
+  std::string image_file = directory + "/monkey.tif";
+  {
+    std::ofstream out( image_file.c_str(), std::ios::binary );
+    out << "not really an image";
+  }
+
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -i, i, true, 5 ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+
+  InterestPointCache cache;
+  InterestPointList result;
+  EXPECT_FALSE( cache.load( cache.cache_file( image_file, "sgrad" ), result ) );
+  cache.store( cache.cache_file( image_file, "sgrad" ), ip );
+  EXPECT_EQ( 0u, cache.cache_file( image_file, "sgrad" ).find( image_file + "." ) );
+  ASSERT_TRUE( cache.load( cache.cache_file( image_file, "sgrad" ), result ) );
+  ASSERT_EQ( ip.size(), result.size() );
+  for ( InterestPointList::iterator a = ip.begin(), b = result.begin(); a != ip.end(); ++a, ++b ) {
+    EXPECT_EQ( a->x, b->x );
+    EXPECT_EQ( a->y, b->y );
+    EXPECT_VECTOR_FLOAT_EQ( a->descriptor, b->descriptor );
+  }
+
+  // Other settings, or a changed image, miss.
+  EXPECT_FALSE( cache.load( cache.cache_file( image_file, "patch" ), result ) );
+  {
+    std::ofstream out( image_file.c_str(), std::ios::binary | std::ios::app );
+    out << "!";
+  }
+  EXPECT_FALSE( cache.load( cache.cache_file( image_file, "sgrad" ), result ) );
+
+  // A cache directory holds files named after the image.
+  std::string cache_directory = directory + "/cache";
+  boost::filesystem::create_directory( cache_directory );
+  InterestPointCache elsewhere( cache_directory );
+  elsewhere.store( elsewhere.cache_file( image_file, "sgrad" ), ip );
+  EXPECT_EQ( 0u, elsewhere.cache_file( image_file, "sgrad" ).find( cache_directory + "/monkey.tif." ) );
+  EXPECT_TRUE( elsewhere.load( elsewhere.cache_file( image_file, "sgrad" ), result ) );
+  EXPECT_FALSE( cache.load( cache.cache_file( image_file, "sgrad" ), result ) );
+}
@@ -10,8 +10,14 @@
 
 #include <vw/InterestPoint/Matcher.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/UtilityViews.h>
 #include <test/Helpers.h>
 
+#include <boost/random/linear_congruential.hpp>
+#include <boost/next_prior.hpp>
+
 #include <algorithm>
 
 using namespace vw;
@@ -104,3 +110,252 @@ TEST( Matcher, Matcher ) {
 }
 
 
+namespace {
+  // Points with random descriptors, and noisy copies of some of them.
+  void random_descriptors( size_t count, size_t dims, int seed,
+                           std::vector<InterestPoint>& points,
+                           std::vector<InterestPoint>& copies ) {
+    boost::rand48 gen( seed );
+    for ( size_t i = 0; i < count; i++ ) {
+      InterestPoint ip( float(i), 0 ), copy( float(i), 1 );
+      ip.descriptor.set_size( dims );
+      copy.descriptor.set_size( dims );
+      for ( size_t d = 0; d < dims; d++ ) {
+        ip.descriptor[d] = float( gen() % 1000 ) / 1000;
+        copy.descriptor[d] = ip.descriptor[d] + float( gen() % 100 ) / 2000 - 0.025f;
+      }
+      points.push_back( ip );
+      if ( i % 3 == 0 )
+        copies.push_back( copy );
+      else if ( i % 3 == 1 ) {
+        for ( size_t d = 0; d < dims; d++ )
+          copy.descriptor[d] = float( gen() % 1000 ) / 1000;
+        copies.push_back( copy );
+      }
+    }
+  }
+}
+
+TEST( Matcher, Index ) {
+  std::vector<InterestPoint> points, copies;
+  random_descriptors( 1500, 16, 3, points, copies );
+
+  std::vector<InterestPoint> expected1, expected2;
+  InterestPointMatcherSimple<L2NormMetric,NullConstraint> simple( 0.5 );
+  simple( copies, points, expected1, expected2 );
+  ASSERT_GT( expected1.size(), 400u );
+
+  // The exact search of the tree finds the same matches in the same
+  // order, from its own index or one built beforehand.
+  std::vector<InterestPoint> matched1, matched2;
+  InterestPointMatcher<L2NormMetric,NullConstraint> matcher( 0.5 );
+  matcher( copies, points, matched1, matched2 );
+  ASSERT_EQ( expected1.size(), matched1.size() );
+  for ( size_t i = 0; i < matched1.size(); i++ ) {
+    EXPECT_EQ( expected1[i].x, matched1[i].x );
+    EXPECT_EQ( expected2[i].x, matched2[i].x );
+  }
+
+  InterestPointIndex index( points );
+  EXPECT_EQ( points.size(), index.size() );
+  std::vector<InterestPoint> indexed1, indexed2;
+  matcher( copies, index, indexed1, indexed2 );
+  ASSERT_EQ( matched1.size(), indexed1.size() );
+  for ( size_t i = 0; i < indexed1.size(); i++ ) {
+    EXPECT_EQ( matched1[i].x, indexed1[i].x );
+    EXPECT_EQ( matched2[i].x, indexed2[i].x );
+  }
+
+  // A bounded search still finds most of the copies.
+  size_t copies_found = 0;
+  for ( size_t i = 0; i < expected1.size(); i++ )
+    if ( expected1[i].x == expected2[i].x )
+      copies_found++;
+  InterestPointMatcher<L2NormMetric,NullConstraint> approximate( 0.5, L2NormMetric(), NullConstraint(), 128 );
+  approximate( copies, index, indexed1, indexed2 );
+  size_t approximate_found = 0;
+  for ( size_t i = 0; i < indexed1.size(); i++ )
+    if ( indexed1[i].x == indexed2[i].x )
+      approximate_found++;
+  EXPECT_GT( approximate_found, copies_found * 8 / 10 );
+}
+
+TEST( Matcher, Constrained ) {
+  std::vector<InterestPoint> points, copies;
+  random_descriptors( 1500, 16, 4, points, copies );
+
+  // Only points that lie near the copies may match them.  The nearest
+  // two are found by brute force, and the nearest must pass the
+  // constraint and the ratio test.
+  PositionConstraint constraint( -1000, 0, -1.5, 1.5 );
+  L2NormMetric metric;
+  std::vector<InterestPoint> expected1, expected2;
+  for ( size_t i = 0; i < copies.size(); i++ ) {
+    size_t best = 0;
+    double first = 1e100, second = 1e100;
+    for ( size_t j = 0; j < points.size(); j++ ) {
+      double d = metric( points[j], copies[i] );
+      if ( d < first ) {
+        second = first;
+        first = d;
+        best = j;
+      } else if ( d < second ) {
+        second = d;
+      }
+    }
+    if ( constraint( points[best], copies[i] ) && first < 0.8 * second ) {
+      expected1.push_back( copies[i] );
+      expected2.push_back( points[best] );
+    }
+  }
+  ASSERT_GT( expected1.size(), 100u );
+
+  std::vector<InterestPoint> matched1, matched2;
+  InterestPointMatcher<L2NormMetric,PositionConstraint> matcher( 0.8, metric, constraint );
+  matcher( copies, points, matched1, matched2 );
+  ASSERT_EQ( expected1.size(), matched1.size() );
+  for ( size_t i = 0; i < matched1.size(); i++ ) {
+    EXPECT_EQ( expected1[i].x, matched1[i].x );
+    EXPECT_EQ( expected2[i].x, matched2[i].x );
+  }
+}
+
+TEST( Matcher, HammingMetric ) {
+  InterestPoint ip1(0,0), ip2(5,0);
+  ip1.binary_descriptor.push_back( 0xF0F0ULL );
+  ip1.binary_descriptor.push_back( 0x1ULL );
+  ip2.binary_descriptor.push_back( 0xF00FULL );
+  ip2.binary_descriptor.push_back( 0x8000000000000001ULL );
+
+  HammingMetric metric;
+  EXPECT_EQ( 9, metric(ip1, ip2) );
+  EXPECT_EQ( 0, metric(ip1, ip1) );
+}
+
+TEST( Matcher, BinaryMatcher ) {
+  // Each point of the second list differs from the query in
+  // {12, 3, 20} bits, and from the other query in more.
+  std::vector<InterestPoint> ip1_list(2), ip2_list(3), matched_ip1, matched_ip2;
+  uint64 query[2] = { 0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL };
+  ip1_list[0].binary_descriptor.assign( query, query+2 );
+  ip1_list[1].binary_descriptor.assign( 2, 0x5555555555555555ULL );
+  uint64 flips[3] = { 0xFFFULL, 0x7ULL, 0xFFFFFULL };
+  for ( int i = 0; i < 3; i++ ) {
+    ip2_list[i] = InterestPoint( i, 0 );
+    ip2_list[i].binary_descriptor.assign( query, query+2 );
+    ip2_list[i].binary_descriptor[1] ^= flips[i];
+  }
+  HammingMetric metric;
+  EXPECT_EQ( 3, metric( ip1_list[0], ip2_list[1] ) );
+
+  BinaryMatcher matcher( 0.5 );
+  matcher( ip1_list, ip2_list, matched_ip1, matched_ip2 );
+  ASSERT_EQ( 1u, matched_ip1.size() );
+  ASSERT_EQ( 1u, matched_ip2.size() );
+  EXPECT_TRUE( matched_ip1[0].binary_descriptor == ip1_list[0].binary_descriptor );
+  EXPECT_EQ( 1, matched_ip2[0].x );
+
+  // The second best is too close for a stricter threshold.
+  BinaryMatcher strict( 0.2 );
+  strict( ip1_list, ip2_list, matched_ip1, matched_ip2 );
+  EXPECT_EQ( 0u, matched_ip1.size() );
+}
+
+TEST( Matcher, BRIEF ) {
+  boost::rand48 gen(3);
+  ImageView<float> image = gaussian_filter( uniform_noise_view( gen, 200, 200 ), 1.5 );
+
+  BRIEFDescriptorGenerator generator;
+  EXPECT_EQ( 256, generator.binary_descriptor_bits() );
+  for ( size_t i = 0; i < generator.pattern().size(); i++ ) {
+    BRIEFDescriptorGenerator::TestPair const& pair = generator.pattern()[i];
+    EXPECT_LE( abs(pair.x0), 18 ); EXPECT_LE( abs(pair.y0), 18 );
+    EXPECT_LE( abs(pair.x1), 18 ); EXPECT_LE( abs(pair.y1), 18 );
+  }
+
+  // The same points in the image and in a copy rotated by a right
+  // angle, with their orientations turned to match, get close
+  // descriptors; the descriptors of different points are far apart.
+  ImageView<float> rotated = rotate_180( image );
+  InterestPointList points, rotated_points;
+  for ( int32 j = 50; j <= 150; j += 25 )
+    for ( int32 i = 50; i <= 150; i += 25 ) {
+      points.push_back( InterestPoint( i, j, 1.0, 1.0, 0.3 ) );
+      rotated_points.push_back( InterestPoint( 199-i, 199-j, 1.0, 1.0, 0.3+M_PI ) );
+    }
+  generator( image, points );
+  generator( rotated, rotated_points );
+
+  HammingMetric metric;
+  InterestPointList::iterator a = points.begin(), b = rotated_points.begin();
+  for ( ; a != points.end(); ++a, ++b ) {
+    EXPECT_EQ( 0u, a->size() );
+    ASSERT_EQ( 4u, a->binary_descriptor.size() );
+    EXPECT_LT( metric( *a, *b ), 40 );
+    InterestPointList::iterator other = boost::next(a) == points.end() ? points.begin() : boost::next(a);
+    EXPECT_GT( metric( *a, *other ), 80 );
+  }
+
+  std::vector<InterestPoint> ip1( points.begin(), points.end() ),
+    ip2( rotated_points.begin(), rotated_points.end() ), matched_ip1, matched_ip2;
+  BinaryMatcher matcher( 0.8 );
+  matcher( ip1, ip2, matched_ip1, matched_ip2 );
+  ASSERT_EQ( ip1.size(), matched_ip1.size() );
+  for ( size_t i = 0; i < matched_ip1.size(); i++ ) {
+    EXPECT_EQ( 199 - matched_ip1[i].x, matched_ip2[i].x );
+    EXPECT_EQ( 199 - matched_ip1[i].y, matched_ip2[i].y );
+  }
+}
+
+TEST( Matcher, RemoveDuplicates ) {
+  // Locations on a small grid, so that many repeat.
+  boost::rand48 gen( 9 );
+  std::vector<InterestPoint> ip1, ip2;
+  for ( size_t i = 0; i < 400; i++ ) {
+    ip1.push_back( InterestPoint( float(gen() % 30), float(gen() % 30) ) );
+    ip2.push_back( InterestPoint( float(gen() % 40) / 2, float(gen() % 40) ) );
+    ip1.back().interest = ip2.back().interest = float(i);
+  }
+
+  // The pairs whose locations no later pair repeats.
+  std::vector<float> expected;
+  for ( size_t i = 0; i < ip1.size(); i++ ) {
+    bool duplicate = false;
+    for ( size_t j = i + 1; j < ip1.size(); j++ )
+      if ( (ip1[i].x == ip1[j].x && ip1[i].y == ip1[j].y) ||
+           (ip2[i].x == ip2[j].x && ip2[i].y == ip2[j].y) )
+        duplicate = true;
+    if ( !duplicate )
+      expected.push_back( ip1[i].interest );
+  }
+  ASSERT_GT( expected.size(), 50u );
+  ASSERT_LT( expected.size(), 350u );
+
+  std::vector<InterestPoint> exact1 = ip1, exact2 = ip2;
+  remove_duplicates( exact1, exact2 );
+  ASSERT_EQ( expected.size(), exact1.size() );
+  ASSERT_EQ( expected.size(), exact2.size() );
+  for ( size_t i = 0; i < expected.size(); i++ ) {
+    EXPECT_EQ( expected[i], exact1[i].interest );
+    EXPECT_EQ( expected[i], exact2[i].interest );
+  }
+
+  // With a radius, no two pairs kept are that close in either image,
+  // and every pair dropped is near one kept.
+  const double radius = 3;
+  std::vector<InterestPoint> near1 = ip1, near2 = ip2;
+  remove_duplicates( near1, near2, radius );
+  ASSERT_GT( near1.size(), 10u );
+  for ( size_t i = 0; i < near1.size(); i++ )
+    for ( size_t j = i + 1; j < near1.size(); j++ ) {
+      EXPECT_GT( hypot( near1[i].x - near1[j].x, near1[i].y - near1[j].y ), radius );
+      EXPECT_GT( hypot( near2[i].x - near2[j].x, near2[i].y - near2[j].y ), radius );
+    }
+  for ( size_t i = 0; i < ip1.size(); i++ ) {
+    bool covered = false;
+    for ( size_t j = 0; j < near1.size() && !covered; j++ )
+      covered = hypot( ip1[i].x - near1[j].x, ip1[i].y - near1[j].y ) <= radius ||
+        hypot( ip2[i].x - near2[j].x, ip2[i].y - near2[j].y ) <= radius;
+    EXPECT_TRUE( covered );
+  }
+}
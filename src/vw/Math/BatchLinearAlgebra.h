@@ -0,0 +1,342 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file BatchLinearAlgebra.h
+///
+/// Solves, inverses and singular value decompositions of small
+/// fixed-size matrices, one at a time or in batches.  These work in
+/// place on Matrix<T,N,N> and friends, without allocating memory or
+/// transposing into LAPACK's column-major layout, which for a 3x3
+/// system costs far more than the arithmetic.  They're meant for the
+/// many tiny systems of bundle adjustment and pose estimation; for
+/// anything larger, use the LAPACK routines in LinearAlgebra.h.
+///
+/// The batch functions take a parallel flag that splits the batch
+/// among vw_settings().default_num_threads() threads.  Each matrix is
+/// handled on its own, so the results don't depend on the number of
+/// threads.
+///
+#ifndef __VW_MATH_BATCH_LINEAR_ALGEBRA_H__
+#define __VW_MATH_BATCH_LINEAR_ALGEBRA_H__
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/static_assert.hpp>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+namespace vw {
+namespace math {
+
+  /// Solves A*x = b by LU decomposition with partial pivoting,
+  /// leaving x in b and destroying A.  Returns false, with b
+  /// unchanged, if A is singular.
+  template <class T, size_t N>
+  bool solve_in_place( Matrix<T,N,N>& A, Vector<T,N>& b ) {
+    Vector<T,N> x = b;
+    for ( size_t i = 0; i < N; i++ ) {
+      size_t p = i;
+      for ( size_t r = i+1; r < N; r++ )
+        if ( std::fabs( A(r,i) ) > std::fabs( A(p,i) ) )
+          p = r;
+      if ( A(p,i) == T() )
+        return false;
+      if ( p != i ) {
+        for ( size_t c = i; c < N; c++ )
+          std::swap( A(i,c), A(p,c) );
+        std::swap( x(i), x(p) );
+      }
+      for ( size_t r = i+1; r < N; r++ ) {
+        T f = A(r,i) / A(i,i);
+        for ( size_t c = i+1; c < N; c++ )
+          A(r,c) -= f * A(i,c);
+        x(r) -= f * x(i);
+      }
+    }
+    for ( size_t i = N; i-- > 0; ) {
+      T sum = x(i);
+      for ( size_t c = i+1; c < N; c++ )
+        sum -= A(i,c) * x(c);
+      x(i) = sum / A(i,i);
+    }
+    b = x;
+    return true;
+  }
+
+  /// Inverts A by Gauss-Jordan elimination with partial pivoting.
+  /// Returns false, with A unchanged, if A is singular.
+  template <class T, size_t N>
+  bool inverse_in_place( Matrix<T,N,N>& A ) {
+    Matrix<T,N,N> buf = A;
+    size_t pm[N];
+    for ( size_t i = 0; i < N; i++ )
+      pm[i] = i;
+    for ( size_t i = 0; i < N; i++ ) {
+      size_t p = i;
+      for ( size_t r = i+1; r < N; r++ )
+        if ( std::fabs( buf(r,i) ) > std::fabs( buf(p,i) ) )
+          p = r;
+      if ( buf(p,i) == T() )
+        return false;
+      if ( p != i ) {
+        for ( size_t c = 0; c < N; c++ )
+          std::swap( buf(i,c), buf(p,c) );
+        std::swap( pm[i], pm[p] );
+      }
+      // The inverse is built in place of the eliminated columns.
+      T d = T(1) / buf(i,i);
+      buf(i,i) = T(1);
+      for ( size_t c = 0; c < N; c++ )
+        buf(i,c) *= d;
+      for ( size_t r = 0; r < N; r++ ) {
+        if ( r == i )
+          continue;
+        T f = buf(r,i);
+        buf(r,i) = T();
+        for ( size_t c = 0; c < N; c++ )
+          buf(r,c) -= f * buf(i,c);
+      }
+    }
+    // Undo the row swaps as column swaps of the inverse.
+    for ( size_t c = 0; c < N; c++ )
+      for ( size_t r = 0; r < N; r++ )
+        A(r,pm[c]) = buf(r,c);
+    return true;
+  }
+
+  /// Inverts a symmetric positive definite A by Cholesky
+  /// decomposition.  Only the lower triangle of A is read.  Returns
+  /// false, with A unchanged, if A isn't positive definite.
+  template <class T, size_t N>
+  bool symmetric_inverse_in_place( Matrix<T,N,N>& A ) {
+    // L, then inverse(L), in the lower triangle of L.
+    Matrix<T,N,N> L;
+    for ( size_t i = 0; i < N; i++ )
+      for ( size_t j = 0; j <= i; j++ ) {
+        T sum = A(i,j);
+        for ( size_t k = 0; k < j; k++ )
+          sum -= L(i,k) * L(j,k);
+        if ( i == j ) {
+          if ( !( sum > T() ) )
+            return false;
+          L(i,i) = std::sqrt( sum );
+        } else {
+          L(i,j) = sum / L(j,j);
+        }
+      }
+    for ( size_t i = 0; i < N; i++ ) {
+      L(i,i) = T(1) / L(i,i);
+      for ( size_t j = 0; j < i; j++ ) {
+        T sum = T();
+        for ( size_t k = j; k < i; k++ )
+          sum -= L(i,k) * L(k,j);
+        L(i,j) = sum * L(i,i);
+      }
+    }
+    // inverse(A) = transpose(inverse(L))*inverse(L)
+    for ( size_t i = 0; i < N; i++ )
+      for ( size_t j = 0; j <= i; j++ ) {
+        T sum = T();
+        for ( size_t k = i; k < N; k++ )
+          sum += L(k,i) * L(k,j);
+        A(i,j) = A(j,i) = sum;
+      }
+    return true;
+  }
+
+  /// The singular value decomposition A = U*diagonal(s)*VT of an MxN
+  /// matrix with M >= N, by one-sided Jacobi rotations, leaving U in
+  /// A.  The singular values are in decreasing order, and the columns
+  /// of U for zero singular values are zero.
+  template <class T, size_t M, size_t N>
+  void svd_in_place( Matrix<T,M,N>& A, Vector<T,N>& s, Matrix<T,N,N>& VT ) {
+    BOOST_STATIC_ASSERT( M >= N );
+    Matrix<T,N,N> V;
+    V.set_identity();
+    const T eps = std::numeric_limits<T>::epsilon();
+    for ( int sweep = 0; sweep < 60; sweep++ ) {
+      bool rotated = false;
+      for ( size_t p = 0; p < N; p++ )
+        for ( size_t q = p+1; q < N; q++ ) {
+          T alpha = T(), beta = T(), gamma = T();
+          for ( size_t i = 0; i < M; i++ ) {
+            alpha += A(i,p) * A(i,p);
+            beta += A(i,q) * A(i,q);
+            gamma += A(i,p) * A(i,q);
+          }
+          if ( std::fabs( gamma ) <= eps * std::sqrt( alpha * beta ) )
+            continue;
+          rotated = true;
+          T zeta = ( beta - alpha ) / ( 2 * gamma );
+          T t = ( zeta < T() ? T(-1) : T(1) ) / ( std::fabs( zeta ) + std::sqrt( 1 + zeta * zeta ) );
+          T c = T(1) / std::sqrt( 1 + t * t ), sn = c * t;
+          for ( size_t i = 0; i < M; i++ ) {
+            T ap = A(i,p), aq = A(i,q);
+            A(i,p) = c * ap - sn * aq;
+            A(i,q) = sn * ap + c * aq;
+          }
+          for ( size_t i = 0; i < N; i++ ) {
+            T vp = V(i,p), vq = V(i,q);
+            V(i,p) = c * vp - sn * vq;
+            V(i,q) = sn * vp + c * vq;
+          }
+        }
+      if ( !rotated )
+        break;
+    }
+
+    for ( size_t j = 0; j < N; j++ ) {
+      T norm = T();
+      for ( size_t i = 0; i < M; i++ )
+        norm += A(i,j) * A(i,j);
+      s(j) = std::sqrt( norm );
+    }
+    // Sort by selection, swapping the columns of U and V along.
+    for ( size_t j = 0; j < N; j++ ) {
+      size_t k = j;
+      for ( size_t l = j+1; l < N; l++ )
+        if ( s(l) > s(k) )
+          k = l;
+      if ( k != j ) {
+        std::swap( s(j), s(k) );
+        for ( size_t i = 0; i < M; i++ )
+          std::swap( A(i,j), A(i,k) );
+        for ( size_t i = 0; i < N; i++ )
+          std::swap( V(i,j), V(i,k) );
+      }
+      for ( size_t i = 0; i < M; i++ )
+        A(i,j) = s(j) > T() ? A(i,j) / s(j) : T();
+    }
+    for ( size_t i = 0; i < N; i++ )
+      for ( size_t j = 0; j < N; j++ )
+        VT(i,j) = V(j,i);
+  }
+
+  /// \cond INTERNAL
+  namespace detail {
+    // Runs func(i) for i in [begin,end), counting the calls that
+    // return false.
+    template <class FuncT>
+    class BatchTask {
+      FuncT const& m_func;
+      size_t m_begin, m_end;
+      size_t& m_failed;
+    public:
+      typedef void result_type;
+      BatchTask( FuncT const& func, size_t begin, size_t end, size_t& failed )
+        : m_func(func), m_begin(begin), m_end(end), m_failed(failed) {}
+      void operator()() const {
+        size_t failed = 0;
+        for ( size_t i = m_begin; i < m_end; i++ )
+          if ( !m_func( i ) )
+            failed++;
+        m_failed = failed;
+      }
+    };
+
+    // Runs func over [0,count), in ranges spread over the threads when
+    // parallel is set, and returns how many calls failed.
+    template <class FuncT>
+    size_t run_batch( FuncT const& func, size_t count, bool parallel ) {
+      const size_t range_size = 1024;
+      uint32 num_threads = vw_settings().default_num_threads();
+      if ( !parallel || num_threads < 2 || count <= range_size ) {
+        size_t failed = 0;
+        BatchTask<FuncT>( func, 0, count, failed )();
+        return failed;
+      }
+      size_t num_ranges = ( count + range_size - 1 ) / range_size;
+      std::vector<size_t> failed( num_ranges );
+      FifoWorkQueue queue( num_threads );
+      std::vector<Future<void> > futures;
+      for ( size_t r = 0; r < num_ranges; r++ )
+        futures.push_back( queue.submit( BatchTask<FuncT>( func, r*range_size,
+                                                           std::min( (r+1)*range_size, count ), failed[r] ) ) );
+      when_all( futures );
+      size_t total = 0;
+      for ( size_t r = 0; r < num_ranges; r++ )
+        total += failed[r];
+      return total;
+    }
+
+    template <class T, size_t N>
+    struct BatchSolve {
+      std::vector<Matrix<T,N,N> >& A;
+      std::vector<Vector<T,N> >& b;
+      BatchSolve( std::vector<Matrix<T,N,N> >& A, std::vector<Vector<T,N> >& b ) : A(A), b(b) {}
+      bool operator()( size_t i ) const { return solve_in_place( A[i], b[i] ); }
+    };
+
+    template <class T, size_t N>
+    struct BatchInverse {
+      std::vector<Matrix<T,N,N> >& A;
+      BatchInverse( std::vector<Matrix<T,N,N> >& A ) : A(A) {}
+      bool operator()( size_t i ) const { return inverse_in_place( A[i] ); }
+    };
+
+    template <class T, size_t N>
+    struct BatchSymmetricInverse {
+      std::vector<Matrix<T,N,N> >& A;
+      BatchSymmetricInverse( std::vector<Matrix<T,N,N> >& A ) : A(A) {}
+      bool operator()( size_t i ) const { return symmetric_inverse_in_place( A[i] ); }
+    };
+
+    template <class T, size_t M, size_t N>
+    struct BatchSVD {
+      std::vector<Matrix<T,M,N> >& A;
+      std::vector<Vector<T,N> >& s;
+      std::vector<Matrix<T,N,N> >& VT;
+      BatchSVD( std::vector<Matrix<T,M,N> >& A, std::vector<Vector<T,N> >& s,
+                std::vector<Matrix<T,N,N> >& VT ) : A(A), s(s), VT(VT) {}
+      bool operator()( size_t i ) const { svd_in_place( A[i], s[i], VT[i] ); return true; }
+    };
+  }
+  /// \endcond
+
+  /// Solves A[i]*x = b[i] for each i with solve_in_place(), leaving
+  /// each x in b[i].  Returns the number of singular A[i], whose b[i]
+  /// are left unchanged.
+  template <class T, size_t N>
+  size_t batch_solve( std::vector<Matrix<T,N,N> >& A, std::vector<Vector<T,N> >& b, bool parallel = false ) {
+    VW_ASSERT( A.size() == b.size(), ArgumentErr() << "batch_solve: there must be as many vectors as matrices." );
+    return detail::run_batch( detail::BatchSolve<T,N>( A, b ), A.size(), parallel );
+  }
+
+  /// Inverts each matrix in place with inverse_in_place().  Returns
+  /// the number of singular matrices, which are left unchanged.
+  template <class T, size_t N>
+  size_t batch_inverse( std::vector<Matrix<T,N,N> >& A, bool parallel = false ) {
+    return detail::run_batch( detail::BatchInverse<T,N>( A ), A.size(), parallel );
+  }
+
+  /// Inverts each symmetric positive definite matrix in place with
+  /// symmetric_inverse_in_place().  Returns the number that aren't
+  /// positive definite, which are left unchanged.
+  template <class T, size_t N>
+  size_t batch_symmetric_inverse( std::vector<Matrix<T,N,N> >& A, bool parallel = false ) {
+    return detail::run_batch( detail::BatchSymmetricInverse<T,N>( A ), A.size(), parallel );
+  }
+
+  /// Decomposes each A[i] with svd_in_place(), leaving U in A[i].
+  /// s and VT are resized to match A.
+  template <class T, size_t M, size_t N>
+  void batch_svd( std::vector<Matrix<T,M,N> >& A, std::vector<Vector<T,N> >& s,
+                  std::vector<Matrix<T,N,N> >& VT, bool parallel = false ) {
+    s.resize( A.size() );
+    VT.resize( A.size() );
+    detail::run_batch( detail::BatchSVD<T,M,N>( A, s, VT ), A.size(), parallel );
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_BATCH_LINEAR_ALGEBRA_H__
@@ -0,0 +1,424 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file FlatKDTree.h
+///
+/// A kd-tree over a fixed set of points, for nearest neighbor
+/// searches in many dimensions such as those of interest point
+/// descriptors.
+///
+/// Unlike KDTree, the tree is built once and can't be changed.  The
+/// points are copied into one array in the order of the tree's
+/// leaves, and the nodes into another, so a search reads memory in
+/// long runs.  Searches don't change the tree, so any number of
+/// threads may search one tree at once.
+///
+/// Searches are exact, or approximate in the manner of FLANN's
+/// kd-trees: the leaves are visited best bin first, and the search
+/// stops after a given number of points have been checked.
+///
+/// Large trees are built, and large batches of queries answered, on
+/// vw_settings().default_num_threads() threads.  The tree and the
+/// results are the same for any number of threads.
+///
+#ifndef __VW_MATH_FLATKDTREE_H__
+#define __VW_MATH_FLATKDTREE_H__
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+namespace vw {
+namespace math {
+
+  template <class ElemT = float>
+  class FlatKDTree {
+  public:
+    typedef ElemT element_type;
+    typedef ElemT distance_type;
+
+    /// Builds the tree over count points of dims elements each,
+    /// stored one after another starting at data.  The points are
+    /// copied.  A leaf holds at most leaf_size points.
+    FlatKDTree( ElemT const* data, size_t count, size_t dims, size_t leaf_size = 16 )
+      : m_dims(dims), m_leaf_size(std::max(leaf_size, size_t(1))) {
+      VW_ASSERT( dims > 0, ArgumentErr() << "FlatKDTree: points must have at least one dimension." );
+      std::vector<int32> order( count );
+      for ( size_t i = 0; i < count; i++ )
+        order[i] = int32(i);
+      if ( count > 0 )
+        build_tree( data, order );
+
+      // Points are stored in the order of the leaves.
+      m_points.resize( count * dims );
+      m_index.swap( order );
+      for ( size_t i = 0; i < count; i++ )
+        std::copy( data + size_t(m_index[i])*dims, data + (size_t(m_index[i])+1)*dims, &m_points[i*dims] );
+    }
+
+    size_t size() const { return m_index.size(); }
+    size_t dims() const { return m_dims; }
+
+    /// Finds the (up to) knn points nearest the query by squared L2
+    /// distance, nearest first.  Their indices in the original data
+    /// and their squared distances are written to indices and dists,
+    /// which must have room for knn elements, and the number found is
+    /// returned.  A checks of zero searches exactly; otherwise about
+    /// that many points are compared before the search stops.
+    size_t knn_search( ElemT const* query, size_t knn, int32* indices, ElemT* dists,
+                       size_t checks = 0 ) const {
+      if ( knn == 0 || m_index.empty() )
+        return 0;
+      Results results( knn, indices, dists );
+      if ( checks == 0 ) {
+        std::vector<ElemT> offsets( m_dims, ElemT(0) );
+        search_exact( 0, query, ElemT(0), offsets, results );
+      } else {
+        search_approximate( query, checks, results );
+      }
+      return results.count;
+    }
+
+    /// Searches for the knn nearest points of each of count queries,
+    /// stored one after another starting at queries, as above.  The
+    /// results of query q go to indices and dists starting at q*knn;
+    /// when fewer than knn points are found the rest are filled with
+    /// an index of -1 and the largest distance.
+    void knn_search( ElemT const* queries, size_t count, size_t knn,
+                     int32* indices, ElemT* dists, size_t checks = 0 ) const {
+      const size_t batch_size = 256;
+      uint32 num_threads = vw_settings().default_num_threads();
+      if ( num_threads < 2 || count <= batch_size ) {
+        SearchTask( *this, queries, 0, count, knn, indices, dists, checks )();
+        return;
+      }
+      FifoWorkQueue queue( num_threads );
+      std::vector<Future<void> > futures;
+      for ( size_t begin = 0; begin < count; begin += batch_size )
+        futures.push_back( queue.submit( SearchTask( *this, queries, begin, std::min( begin + batch_size, count ),
+                                                     knn, indices, dists, checks ) ) );
+      when_all( futures );
+    }
+
+    /// Finds every point within a squared L2 distance of radius_sq
+    /// of the query, searching exactly.  Their indices in the original
+    /// data are appended to indices, in no particular order, and the
+    /// number found is returned.
+    size_t radius_search( ElemT const* query, ElemT radius_sq, std::vector<int32>& indices ) const {
+      size_t start = indices.size();
+      if ( !m_index.empty() ) {
+        std::vector<ElemT> offsets( m_dims, ElemT(0) );
+        search_radius( 0, query, ElemT(0), radius_sq, offsets, indices );
+      }
+      return indices.size() - start;
+    }
+
+  private:
+    // An inner node splits on one dimension; a leaf holds the points
+    // [begin,end) of m_points.
+    struct Node {
+      int32 dim;             // -1 for a leaf
+      ElemT split;
+      int32 low, high;       // children, or begin and end of a leaf
+    };
+
+    // The knn best so far, kept sorted.
+    struct Results {
+      size_t knn, count;
+      int32* indices;
+      ElemT* dists;
+      Results( size_t k, int32* i, ElemT* d ) : knn(k), count(0), indices(i), dists(d) {}
+      ElemT worst() const {
+        return count < knn ? std::numeric_limits<ElemT>::max() : dists[knn-1];
+      }
+      void add( int32 index, ElemT dist ) {
+        if ( dist >= worst() )
+          return;
+        size_t pos = count < knn ? count++ : knn-1;
+        while ( pos > 0 && dists[pos-1] > dist ) {
+          dists[pos] = dists[pos-1];
+          indices[pos] = indices[pos-1];
+          pos--;
+        }
+        dists[pos] = dist;
+        indices[pos] = index;
+      }
+    };
+
+    // A branch not taken, and the bound on its distance.
+    struct Branch {
+      ElemT bound;
+      int32 node;
+      Branch( ElemT b, int32 n ) : bound(b), node(n) {}
+      bool operator<( Branch const& other ) const { return bound > other.bound; }
+    };
+
+    // A range of knn_search's batch of queries.
+    struct SearchTask {
+      typedef void result_type;
+      FlatKDTree const& tree;
+      ElemT const* queries;
+      size_t begin, end, knn;
+      int32* indices;
+      ElemT* dists;
+      size_t checks;
+      SearchTask( FlatKDTree const& tree, ElemT const* queries, size_t begin, size_t end, size_t knn,
+                  int32* indices, ElemT* dists, size_t checks )
+        : tree(tree), queries(queries), begin(begin), end(end), knn(knn),
+          indices(indices), dists(dists), checks(checks) {}
+      void operator()() const {
+        for ( size_t q = begin; q < end; q++ ) {
+          size_t found = tree.knn_search( queries + q*tree.dims(), knn, indices + q*knn, dists + q*knn, checks );
+          for ( size_t k = found; k < knn; k++ ) {
+            indices[q*knn+k] = -1;
+            dists[q*knn+k] = std::numeric_limits<ElemT>::max();
+          }
+        }
+      }
+    };
+
+    // One of the subtrees build_tree() leaves to a thread, with its
+    // nodes numbered from its root.
+    struct Subtree {
+      size_t begin, end;
+      int32 placeholder;
+      std::vector<Node> nodes;
+    };
+
+    struct BuildTask {
+      typedef void result_type;
+      FlatKDTree const& tree;
+      ElemT const* data;
+      std::vector<int32>& order;
+      Subtree& subtree;
+      BuildTask( FlatKDTree const& tree, ElemT const* data, std::vector<int32>& order, Subtree& subtree )
+        : tree(tree), data(data), order(order), subtree(subtree) {}
+      void operator()() const {
+        tree.build( data, order, subtree.begin, subtree.end, subtree.nodes, size_t(-1), 0 );
+      }
+    };
+
+    size_t m_dims, m_leaf_size;
+    std::vector<Node> m_nodes;
+    std::vector<ElemT> m_points;
+    std::vector<int32> m_index;
+
+    // Builds the top of the tree here, down to about four subtrees
+    // per thread, and then the subtrees in parallel.  Each sorts its
+    // own part of order, so they don't overlap.  Their nodes are
+    // then appended, their roots taking their placeholders' places.
+    void build_tree( ElemT const* data, std::vector<int32>& order ) {
+      uint32 num_threads = vw_settings().default_num_threads();
+      const size_t min_parallel = 20000;
+      if ( num_threads < 2 || order.size() < min_parallel ) {
+        build( data, order, 0, order.size(), m_nodes, size_t(-1), 0 );
+        return;
+      }
+      size_t split_depth = 0;
+      while ( (size_t(1) << split_depth) < 4 * size_t(num_threads) )
+        split_depth++;
+      std::vector<Subtree> subtrees;
+      build( data, order, 0, order.size(), m_nodes, split_depth, &subtrees );
+
+      {
+        FifoWorkQueue queue( num_threads );
+        std::vector<Future<void> > futures;
+        for ( size_t i = 0; i < subtrees.size(); i++ )
+          futures.push_back( queue.submit( BuildTask( *this, data, order, subtrees[i] ) ) );
+        when_all( futures );
+      }
+
+      for ( size_t i = 0; i < subtrees.size(); i++ ) {
+        std::vector<Node> const& nodes = subtrees[i].nodes;
+        int32 offset = int32(m_nodes.size()) - 1;
+        for ( size_t k = 0; k < nodes.size(); k++ ) {
+          Node node = nodes[k];
+          if ( node.dim >= 0 ) {
+            node.low += offset;
+            node.high += offset;
+          }
+          if ( k == 0 )
+            m_nodes[subtrees[i].placeholder] = node;
+          else
+            m_nodes.push_back( node );
+        }
+      }
+    }
+
+    // Splits order[begin,end) at the median of its dimension of
+    // greatest variance, recursively, appending the nodes to nodes
+    // and returning the first.  Below split_depth levels, the ranges
+    // that still need splitting are left to subtrees instead, each
+    // behind a placeholder node.
+    int32 build( ElemT const* data, std::vector<int32>& order, size_t begin, size_t end,
+                 std::vector<Node>& nodes, size_t split_depth, std::vector<Subtree>* subtrees ) const {
+      int32 id = int32(nodes.size());
+      nodes.push_back( Node() );
+      if ( end - begin <= m_leaf_size ) {
+        nodes[id].dim = -1;
+        nodes[id].low = int32(begin);
+        nodes[id].high = int32(end);
+        return id;
+      }
+      if ( split_depth == 0 ) {
+        Subtree subtree;
+        subtree.begin = begin;
+        subtree.end = end;
+        subtree.placeholder = id;
+        subtrees->push_back( subtree );
+        return id;
+      }
+
+      // Variance from at most 100 of the points, as FLANN does.
+      size_t step = std::max( size_t(1), (end - begin) / 100 );
+      std::vector<double> sum( m_dims, 0.0 ), sum_sq( m_dims, 0.0 );
+      size_t samples = 0;
+      for ( size_t i = begin; i < end; i += step, samples++ ) {
+        ElemT const* pt = data + size_t(order[i])*m_dims;
+        for ( size_t d = 0; d < m_dims; d++ ) {
+          sum[d] += pt[d];
+          sum_sq[d] += double(pt[d])*pt[d];
+        }
+      }
+      size_t dim = 0;
+      double best = -1;
+      for ( size_t d = 0; d < m_dims; d++ ) {
+        double var = sum_sq[d] - sum[d]*sum[d]/double(samples);
+        if ( var > best ) {
+          best = var;
+          dim = d;
+        }
+      }
+
+      size_t mid = begin + (end - begin) / 2;
+      std::nth_element( order.begin() + begin, order.begin() + mid, order.begin() + end,
+                        DimCompare( data, m_dims, dim ) );
+      nodes[id].dim = int32(dim);
+      nodes[id].split = data[size_t(order[mid])*m_dims + dim];
+      int32 low = build( data, order, begin, mid, nodes, split_depth - 1, subtrees );
+      int32 high = build( data, order, mid, end, nodes, split_depth - 1, subtrees );
+      nodes[id].low = low;
+      nodes[id].high = high;
+      return id;
+    }
+
+    struct DimCompare {
+      ElemT const* data;
+      size_t dims, dim;
+      DimCompare( ElemT const* d, size_t n, size_t k ) : data(d), dims(n), dim(k) {}
+      bool operator()( int32 a, int32 b ) const {
+        return data[size_t(a)*dims + dim] < data[size_t(b)*dims + dim];
+      }
+    };
+
+    void check_leaf( Node const& node, ElemT const* query, Results& results ) const {
+      for ( int32 i = node.low; i < node.high; i++ ) {
+        ElemT const* pt = &m_points[size_t(i)*m_dims];
+        ElemT limit = results.worst();
+        ElemT dist = 0;
+        // Stop early once the distance can't place.
+        for ( size_t d = 0; d < m_dims && dist < limit; d++ ) {
+          ElemT diff = pt[d] - query[d];
+          dist += diff*diff;
+        }
+        results.add( m_index[i], dist );
+      }
+    }
+
+    // Descends nearer branch first, with the distance from the query
+    // to each branch's cell kept exactly through offsets, the
+    // query's distance from the cell along each dimension.
+    void search_exact( int32 id, ElemT const* query, ElemT bound,
+                       std::vector<ElemT>& offsets, Results& results ) const {
+      Node const& node = m_nodes[id];
+      if ( node.dim < 0 ) {
+        check_leaf( node, query, results );
+        return;
+      }
+      ElemT diff = query[node.dim] - node.split;
+      int32 nearer = diff < 0 ? node.low : node.high;
+      int32 further = diff < 0 ? node.high : node.low;
+      search_exact( nearer, query, bound, offsets, results );
+
+      ElemT old_offset = offsets[node.dim];
+      ElemT further_bound = bound - old_offset*old_offset + diff*diff;
+      if ( further_bound < results.worst() ) {
+        offsets[node.dim] = diff;
+        search_exact( further, query, further_bound, offsets, results );
+        offsets[node.dim] = old_offset;
+      }
+    }
+
+    // Like search_exact(), but keeps every point within the radius
+    // and skips only the cells wholly outside it.
+    void search_radius( int32 id, ElemT const* query, ElemT bound, ElemT radius_sq,
+                        std::vector<ElemT>& offsets, std::vector<int32>& indices ) const {
+      Node const& node = m_nodes[id];
+      if ( node.dim < 0 ) {
+        for ( int32 i = node.low; i < node.high; i++ ) {
+          ElemT const* pt = &m_points[size_t(i)*m_dims];
+          ElemT dist = 0;
+          for ( size_t d = 0; d < m_dims && dist <= radius_sq; d++ ) {
+            ElemT diff = pt[d] - query[d];
+            dist += diff*diff;
+          }
+          if ( dist <= radius_sq )
+            indices.push_back( m_index[i] );
+        }
+        return;
+      }
+      ElemT diff = query[node.dim] - node.split;
+      int32 nearer = diff < 0 ? node.low : node.high;
+      int32 further = diff < 0 ? node.high : node.low;
+      search_radius( nearer, query, bound, radius_sq, offsets, indices );
+
+      ElemT old_offset = offsets[node.dim];
+      ElemT further_bound = bound - old_offset*old_offset + diff*diff;
+      if ( further_bound <= radius_sq ) {
+        offsets[node.dim] = diff;
+        search_radius( further, query, further_bound, radius_sq, offsets, indices );
+        offsets[node.dim] = old_offset;
+      }
+    }
+
+    // Best bin first: descends to a leaf, queueing the branches not
+    // taken by the distance to their split, until checks points have
+    // been compared.
+    void search_approximate( ElemT const* query, size_t checks, Results& results ) const {
+      std::priority_queue<Branch> branches;
+      branches.push( Branch( ElemT(0), 0 ) );
+      size_t checked = 0;
+      while ( !branches.empty() && checked < checks ) {
+        Branch branch = branches.top();
+        branches.pop();
+        if ( results.count == results.knn && branch.bound >= results.worst() )
+          break;
+        int32 id = branch.node;
+        ElemT bound = branch.bound;
+        while ( m_nodes[id].dim >= 0 ) {
+          Node const& node = m_nodes[id];
+          ElemT diff = query[node.dim] - node.split;
+          branches.push( Branch( bound + diff*diff, diff < 0 ? node.high : node.low ) );
+          id = diff < 0 ? node.low : node.high;
+        }
+        check_leaf( m_nodes[id], query, results );
+        checked += m_nodes[id].high - m_nodes[id].low;
+      }
+    }
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_FLATKDTREE_H__
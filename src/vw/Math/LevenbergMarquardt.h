@@ -13,15 +13,26 @@
 /// The goal is to provide some sufficiently general support to that
 /// anything from Levenberg-Marquardt for ICP to Kalman filters for
 /// navigation can use the same toolbox.
+///
+/// Models with many parameters, each of which affects only a few of
+/// the outputs, can declare the pattern of their Jacobian and be
+/// solved with sparse_levenberg_marquardt() instead.  Its Jacobian is
+/// never dense, and the normal equations are solved by a sparse
+/// Cholesky factorization.
 
 #ifndef __VW_MATH_OPTIMIZATION_H__
 #define __VW_MATH_OPTIMIZATION_H__
 
+#include <vector>
+#include <limits>
+#include <algorithm>
+
 // Vision Workbench
 #include <vw/Core/Log.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/LinearAlgebra.h>
+#include <vw/Math/SparseCholesky.h>
 
 // Boost
 #include <boost/concept_check.hpp>
@@ -29,6 +40,191 @@
 namespace vw {
 namespace math {
 
+  /// The pattern of nonzeros of a Jacobian, as the outputs (rows)
+  /// each parameter (column) can change.
+  class JacobianSparsity {
+    size_t m_rows;
+    std::vector<std::vector<size_t> > m_columns;
+
+  public:
+    JacobianSparsity( size_t rows, size_t cols ) : m_rows(rows), m_columns(cols) {}
+
+    size_t rows() const { return m_rows; }
+    size_t cols() const { return m_columns.size(); }
+
+    /// Marks element (row,col) as nonzero.
+    void add( size_t row, size_t col ) {
+      VW_ASSERT( row < m_rows && col < cols(),
+                 ArgumentErr() << "JacobianSparsity: (" << row << "," << col << ") is outside the Jacobian." );
+      std::vector<size_t>& column = m_columns[col];
+      std::vector<size_t>::iterator pos = std::lower_bound( column.begin(), column.end(), row );
+      if ( pos == column.end() || *pos != row )
+        column.insert( pos, row );
+    }
+
+    /// The nonzero rows of a column, in increasing order.
+    std::vector<size_t> const& column( size_t col ) const { return m_columns[col]; }
+
+    size_t nonzeros() const {
+      size_t count = 0;
+      for ( size_t j = 0; j < cols(); j++ )
+        count += m_columns[j].size();
+      return count;
+    }
+
+    /// Splits the columns into groups of structurally orthogonal
+    /// columns, no two of which share a row, so that one evaluation
+    /// of the model can difference a whole group.  Columns are taken
+    /// in order and each goes to the first group it fits.
+    std::vector<std::vector<size_t> > column_groups() const {
+      std::vector<std::vector<size_t> > row_columns( m_rows );
+      std::vector<size_t> group( cols() );
+      std::vector<std::vector<size_t> > groups;
+      std::vector<size_t> taken;  // taken[g] == j+1 when a neighbor of j is in g
+      for ( size_t j = 0; j < cols(); j++ ) {
+        std::vector<size_t> const& rows = m_columns[j];
+        for ( size_t r = 0; r < rows.size(); r++ )
+          for ( size_t k = 0; k < row_columns[rows[r]].size(); k++ )
+            taken[group[row_columns[rows[r]][k]]] = j+1;
+        size_t g = 0;
+        while ( g < groups.size() && taken[g] == j+1 )
+          g++;
+        if ( g == groups.size() ) {
+          groups.push_back( std::vector<size_t>() );
+          taken.push_back( 0 );
+        }
+        groups[g].push_back( j );
+        group[j] = g;
+        for ( size_t r = 0; r < rows.size(); r++ )
+          row_columns[rows[r]].push_back( j );
+      }
+      return groups;
+    }
+  };
+
+  /// A Jacobian with a JacobianSparsity, which it refers to but
+  /// doesn't copy.  The values of each column are stored in the order
+  /// of its nonzero rows.
+  class SparseJacobian {
+    JacobianSparsity const* m_sparsity;
+    std::vector<std::vector<double> > m_values;
+
+  public:
+    explicit SparseJacobian( JacobianSparsity const& sparsity )
+      : m_sparsity(&sparsity), m_values(sparsity.cols()) {
+      for ( size_t j = 0; j < sparsity.cols(); j++ )
+        m_values[j].resize( sparsity.column(j).size() );
+    }
+
+    JacobianSparsity const& sparsity() const { return *m_sparsity; }
+    size_t rows() const { return m_sparsity->rows(); }
+    size_t cols() const { return m_sparsity->cols(); }
+
+    /// The values of column j, one for each of sparsity().column(j).
+    std::vector<double>& column( size_t j ) { return m_values[j]; }
+    std::vector<double> const& column( size_t j ) const { return m_values[j]; }
+
+    /// Element (row,col), which is zero outside the pattern.
+    double operator()( size_t row, size_t col ) const {
+      std::vector<size_t> const& rows = m_sparsity->column(col);
+      std::vector<size_t>::const_iterator pos = std::lower_bound( rows.begin(), rows.end(), row );
+      if ( pos == rows.end() || *pos != row )
+        return 0;
+      return m_values[col][pos - rows.begin()];
+    }
+
+    /// transpose(J)*v
+    template <class VectorT>
+    Vector<double> transpose_product( VectorBase<VectorT> const& v ) const {
+      Vector<double> result( cols() );
+      for ( size_t j = 0; j < cols(); j++ ) {
+        std::vector<size_t> const& rows = m_sparsity->column(j);
+        double sum = 0;
+        for ( size_t k = 0; k < rows.size(); k++ )
+          sum += m_values[j][k] * v.impl()(rows[k]);
+        result(j) = sum;
+      }
+      return result;
+    }
+  };
+
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The lower triangle of transpose(J)*J for a JacobianSparsity,
+    // with the nonzeros of each column kept in increasing row order.
+    // It is read as a symmetric matrix by SparseCholesky.
+    class SparseNormalMatrix : public MatrixBase<SparseNormalMatrix> {
+      std::vector<std::vector<size_t> > m_rows;      // rows i >= j of column j
+      std::vector<std::vector<double> > m_values;
+      std::vector<std::vector<std::pair<size_t, size_t> > > m_products; // by row of J: (column, index)
+
+    public:
+      explicit SparseNormalMatrix( JacobianSparsity const& sparsity )
+        : m_rows(sparsity.cols()), m_values(sparsity.cols()), m_products(sparsity.rows()) {
+        for ( size_t j = 0; j < sparsity.cols(); j++ )
+          for ( size_t k = 0; k < sparsity.column(j).size(); k++ )
+            m_products[sparsity.column(j)[k]].push_back( std::make_pair( j, k ) );
+        for ( size_t r = 0; r < m_products.size(); r++ )
+          for ( size_t a = 0; a < m_products[r].size(); a++ )
+            for ( size_t b = 0; b <= a; b++ )
+              m_rows[m_products[r][b].first].push_back( m_products[r][a].first );
+        for ( size_t j = 0; j < m_rows.size(); j++ ) {
+          m_rows[j].push_back( j );
+          std::sort( m_rows[j].begin(), m_rows[j].end() );
+          m_rows[j].erase( std::unique( m_rows[j].begin(), m_rows[j].end() ), m_rows[j].end() );
+          m_values[j].resize( m_rows[j].size() );
+        }
+      }
+
+      size_t rows() const { return m_rows.size(); }
+      size_t cols() const { return m_rows.size(); }
+
+      // The pairs (i,j), i > j, that may be nonzero.
+      std::vector<std::pair<size_t, size_t> > structure() const {
+        std::vector<std::pair<size_t, size_t> > blocks;
+        for ( size_t j = 0; j < m_rows.size(); j++ )
+          for ( size_t k = 1; k < m_rows[j].size(); k++ )
+            blocks.push_back( std::make_pair( m_rows[j][k], j ) );
+        return blocks;
+      }
+
+      double& element( size_t i, size_t j ) {
+        return m_values[j][std::lower_bound( m_rows[j].begin(), m_rows[j].end(), i ) - m_rows[j].begin()];
+      }
+
+      double operator()( size_t i, size_t j ) const {
+        if ( i < j )
+          std::swap( i, j );
+        std::vector<size_t> const& rows = m_rows[j];
+        std::vector<size_t>::const_iterator pos = std::lower_bound( rows.begin(), rows.end(), i );
+        if ( pos == rows.end() || *pos != i )
+          return 0;
+        return m_values[j][pos - rows.begin()];
+      }
+
+      // Sets the matrix to scale*transpose(J)*J.  The diagonal is
+      // always first in its column.
+      void set_product( SparseJacobian const& J, double scale ) {
+        for ( size_t j = 0; j < m_values.size(); j++ )
+          std::fill( m_values[j].begin(), m_values[j].end(), 0.0 );
+        for ( size_t r = 0; r < m_products.size(); r++ ) {
+          std::vector<std::pair<size_t, size_t> > const& p = m_products[r];
+          for ( size_t a = 0; a < p.size(); a++ ) {
+            double v = scale * J.column(p[a].first)[p[a].second];
+            for ( size_t b = 0; b <= a; b++ )
+              element( p[a].first, p[b].first ) += v * J.column(p[b].first)[p[b].second];
+          }
+        }
+      }
+
+      double diagonal( size_t j ) const { return m_values[j][0]; }
+      double& diagonal( size_t j ) { return m_values[j][0]; }
+    };
+
+  } // namespace detail
+  /// \endcond
+
   /// First thing we need is a generic idea of a measurement function
   /// or model function.  The model function needs to provide a way to
   /// evaluate h(x) as well as a way to differentiate h() to get its
@@ -73,6 +269,16 @@ namespace math {
   ///   given point.  This will override the default implementation in this base
   ///   class which computes the derivatives numerically.
   ///
+  /// To use sparse_levenberg_marquardt(), you will need:
+  ///
+  /// * Defines a method: JacobianSparsity jacobian_sparsity() const;
+  ///   that gives the elements of the Jacobian that may be nonzero.
+  ///
+  /// and may also define:
+  ///
+  /// * Defines a method: SparseJacobian sparse_jacobian( domain_type const& x, JacobianSparsity const& s ) const;
+  ///   that evaluates the nonzeros of the Jacobian, in place of the numerical default.
+  ///
 
   template <class ImplT>
   struct LeastSquaresModelBase {
@@ -116,6 +322,44 @@ namespace math {
       return H;
     }
 
+    /// This default implementation evaluates the nonzeros of the
+    /// Jacobian by finite differences, as jacobian() does, but steps
+    /// all the parameters of a group of structurally orthogonal
+    /// columns at once.  A banded Jacobian takes one evaluation of
+    /// the model per column of its band rather than one per
+    /// parameter.
+    template <class DomainT>
+    inline SparseJacobian sparse_jacobian( DomainT const& x, JacobianSparsity const& sparsity ) const {
+      Vector<double> h0 = impl().operator()(x);
+      VW_ASSERT( h0.size() == sparsity.rows() && x.size() == sparsity.cols(),
+                 ArgumentErr() << "sparse_jacobian: the sparsity pattern doesn't match the model." );
+
+      SparseJacobian J( sparsity );
+      std::vector<std::vector<size_t> > groups = sparsity.column_groups();
+      std::vector<double> epsilon( x.size() );
+      for ( unsigned g=0; g<groups.size(); ++g ) {
+        DomainT xg = x;
+        for ( unsigned k=0; k<groups[g].size(); ++k ) {
+          size_t i = groups[g][k];
+          // Variable step size, depending on parameter value
+          epsilon[i] = 1e-7 + fabs(xg(i)*1e-7);
+          xg(i) += epsilon[i];
+        }
+
+        // The group's columns share no rows, so each row of the
+        // difference belongs to at most one of them.
+        Vector<double> dh = this->difference(impl().operator()(xg),h0);
+        for ( unsigned k=0; k<groups[g].size(); ++k ) {
+          size_t i = groups[g][k];
+          std::vector<size_t> const& rows = sparsity.column(i);
+          std::vector<double>& column = J.column(i);
+          for ( unsigned r=0; r<rows.size(); ++r )
+            column[r] = dh(rows[r])/epsilon[i];
+        }
+      }
+      return J;
+    }
+
     /// The utility of a differencing function is that it allows
     /// looping topologies like angles to be handled without putting
     /// the logic in the L-M implementation.  You probably won't need
@@ -134,163 +378,258 @@ namespace math {
                            eConvergedRelTolerance = 2 };
   }
 
-  /// Levenberg-Marquardt is an algorithm for solving problems of the
-  /// form
-  ///
-  /// J(p) = sum_i ( z_i - h(x_i) )^2
-  ///
-  /// That is, a least squares problem where the objective is to find a
-  /// parameter vector x such that the model function h(x), evaluates
-  /// as closely as possible to the observations z in a least squares
-  /// sense.
-  ///
-  /// Requires:
-  /// - a seed parameter vector x
-  /// - an observation vector z
-  /// - a data model derived from LeastSquaresModelBase, which includes
-  ///     - the model function,
-  ///     - its Jacobian
-  ///
-  /// The cost function in L-M is always the inner product of the
-  /// difference between an observation and the expected observation
-  /// given the model parameters.  This means we can compute the cost
-  /// function and its derivatives if we know the measurement function
-  /// and its derivatives.
-  ///
-
 #define VW_MATH_LM_ABS_TOL (1e-16)
 #define VW_MATH_LM_REL_TOL (1e-16)
 #define VW_MATH_LM_MAX_ITER (100)
 
-  template <class ImplT>
-  typename ImplT::domain_type levenberg_marquardt( LeastSquaresModelBase<ImplT> const& least_squares_model,
-                                                   typename ImplT::domain_type const& seed,
-                                                   typename ImplT::result_type const& observation,
-                                                   int &status,
-                                                   double abs_tolerance = VW_MATH_LM_ABS_TOL,
-                                                   double rel_tolerance = VW_MATH_LM_REL_TOL,
-                                                   double max_iterations = VW_MATH_LM_MAX_ITER) {
+  /// \cond INTERNAL
+  namespace detail {
 
-    status = optimization::eDidNotConverge;
+    // The Gauss-Newton normal equations at a point, with a dense
+    // Jacobian, solved by least squares.
+    struct DenseNormalEquations {
+      Vector<double> del_J;
+      Matrix<double> hessian;
 
-    const ImplT& model = least_squares_model.impl();
-    bool done = false;
-    double Rinv = 10;
-    double lambda = 0.1;
+      template <class ImplT, class DomainT, class ErrorT>
+      void linearize( ImplT const& model, DomainT const& x, ErrorT const& error, double Rinv ) {
+        // Measurement Jacobian
+        typename ImplT::jacobian_type J = model.jacobian(x);
 
-    typename ImplT::domain_type x_try, x = seed;
-    typename ImplT::result_type h = model(x);
-    typename ImplT::result_type error = model.difference(observation, h);
-    double norm_start = norm_2(error);
+        del_J = -1.0 * Rinv * (transpose(J) * error);
 
-    vw_out(DebugMessage, "math") << "LM: initial guess for the model is " << seed << std::endl;
-    vw_out(VerboseDebugMessage, "math") << "LM: starting error " << error << std::endl;
-    vw_out(DebugMessage, "math") << "LM: starting norm is: " << norm_start << std::endl;
+        // Hessian of cost function (using Gauss-Newton approximation)
+        hessian = Rinv * (transpose(J) * J);
+      }
 
-    // Solution may already be good enough
-    if (norm_start < abs_tolerance)
-      done = true;
+      template <class DomainT>
+      bool solve( double lambda, DomainT& delta_x ) const {
+        // Increase diagonal elements to dynamically mix gradient
+        // descent and Gauss-Newton.
+        Matrix<double> hessian_lm = hessian;
+        for ( unsigned i=0; i < hessian_lm.rows(); ++i ){
+          hessian_lm(i,i) += hessian_lm(i,i)*lambda + lambda;
+        }
 
-    int outer_iter = 0;
-    while (!done){
+        // Solve for update
+        delta_x = least_squares(hessian_lm, del_J);
+        return true;
+      }
+    };
+
+    // The same with a sparse Jacobian, solved by sparse Cholesky.  The
+    // symbolic factorization is done once, for the model's pattern.
+    struct SparseNormalEquations {
+      JacobianSparsity sparsity;
+      Vector<double> del_J;
+      SparseNormalMatrix hessian;
+      mutable SparseNormalMatrix hessian_lm;
+      mutable SparseCholesky<double> cholesky;
+
+      explicit SparseNormalEquations( JacobianSparsity const& sparsity )
+        : sparsity(sparsity), hessian(sparsity), hessian_lm(sparsity),
+          cholesky(sparsity.cols(), 1, hessian.structure()) {}
+
+      template <class ImplT, class DomainT, class ErrorT>
+      void linearize( ImplT const& model, DomainT const& x, ErrorT const& error, double Rinv ) {
+        SparseJacobian J = model.sparse_jacobian(x, sparsity);
+        del_J = -1.0 * Rinv * J.transpose_product(error);
+        hessian.set_product(J, Rinv);
+      }
 
-      bool shortCircuit = false;
-      vw_out(DebugMessage, "math") << "LM: outer iteration " << ++outer_iter << "   x = " << x << std::endl;
+      // Fails if the damped hessian isn't positive definite, which
+      // only happens when lambda is too small to make up for rounding.
+      template <class DomainT>
+      bool solve( double lambda, DomainT& delta_x ) const {
+        hessian_lm = hessian;
+        for ( unsigned i=0; i < hessian_lm.rows(); ++i )
+          hessian_lm.diagonal(i) += hessian.diagonal(i)*lambda + lambda;
+        try {
+          cholesky.factor(hessian_lm);
+        } catch ( MathErr const& ) {
+          return false;
+        }
+        delta_x = cholesky.solve(del_J);
+        return true;
+      }
+    };
+
+    template <class ImplT, class NormalT>
+    typename ImplT::domain_type levenberg_marquardt( ImplT const& model, NormalT& normal,
+                                                     typename ImplT::domain_type const& seed,
+                                                     typename ImplT::result_type const& observation,
+                                                     int &status, double abs_tolerance,
+                                                     double rel_tolerance, double max_iterations ) {
+      status = optimization::eDidNotConverge;
+
+      bool done = false;
+      double Rinv = 10;
+      double lambda = 0.1;
+
+      typename ImplT::domain_type x_try, x = seed;
+      typename ImplT::result_type h = model(x);
+      typename ImplT::result_type error = model.difference(observation, h);
+      double norm_start = norm_2(error);
+
+      vw_out(DebugMessage, "math") << "LM: initial guess for the model is " << seed << std::endl;
+      vw_out(VerboseDebugMessage, "math") << "LM: starting error " << error << std::endl;
+      vw_out(DebugMessage, "math") << "LM: starting norm is: " << norm_start << std::endl;
+
+      // Solution may already be good enough
+      if (norm_start < abs_tolerance)
+        done = true;
 
-      // Compute the value, derivative, and hessian of the cost function
-      // at the current point.  These remain valid until the parameter
-      // vector changes.
+      int outer_iter = 0;
+      while (!done){
 
-      // expected measurement with new x
-      h = model(x);
+        bool shortCircuit = false;
+        vw_out(DebugMessage, "math") << "LM: outer iteration " << ++outer_iter << "   x = " << x << std::endl;
 
-      // Difference between observed and predicted and error (2-norm of difference)
-      error = model.difference(observation, h);
-      norm_start = norm_2(error);
-      //vw_out(DebugMessage, "math") << "LM: outer iteration starting robust norm: " << norm_start << std::endl;
+        // Compute the value, derivative, and hessian of the cost function
+        // at the current point.  These remain valid until the parameter
+        // vector changes.
 
-      // Measurement Jacobian
-      typename ImplT::jacobian_type J = model.jacobian(x);
+        // expected measurement with new x
+        h = model(x);
 
-      Vector<double> del_J = -1.0 * Rinv * (transpose(J) * error);
+        // Difference between observed and predicted and error (2-norm of difference)
+        error = model.difference(observation, h);
+        norm_start = norm_2(error);
+        //vw_out(DebugMessage, "math") << "LM: outer iteration starting robust norm: " << norm_start << std::endl;
 
-      // Hessian of cost function (using Gauss-Newton approximation)
-      Matrix<double> hessian = Rinv * (transpose(J) * J);
+        // Jacobian and hessian of the cost function
+        normal.linearize(model, x, error, Rinv);
 
-      int iterations = 0;
-      double norm_try = norm_start+1.0;
-      while (norm_try > norm_start){
+        int iterations = 0;
+        double norm_try = norm_start+1.0;
+        while (norm_try > norm_start){
 
-        // Increase diagonal elements to dynamically mix gradient
-        // descent and Gauss-Newton.
-        Matrix<double> hessian_lm = hessian;
-        for ( unsigned i=0; i < hessian_lm.rows(); ++i ){
-          hessian_lm(i,i) += hessian_lm(i,i)*lambda + lambda;
-        }
+          // Solve for update
+          typename ImplT::domain_type delta_x;
+          if (normal.solve(lambda, delta_x)) {
+            // update parameter vector
+            x_try = x - delta_x;
 
-        // Solve for update
-        typename ImplT::domain_type delta_x = least_squares(hessian_lm, del_J);
+            typename ImplT::result_type h_try = model(x_try);
 
-        // update parameter vector
-        x_try = x - delta_x;
+            typename ImplT::result_type error_try = model.difference(observation, h_try);
+            norm_try = norm_2(error_try);
+          } else {
+            norm_try = std::numeric_limits<double>::max();
+          }
 
-        typename ImplT::result_type h_try = model(x_try);
+          //vw_out(VerboseDebugMessage, "math") << "LM: inner iteration " << iterations << " error is " << error_try << std::endl;
+          //vw_out(DebugMessage, "math") << "\tLM: inner iteration " << iterations << " norm is " << norm_try << std::endl;
 
-        typename ImplT::result_type error_try = model.difference(observation, h_try);
-        norm_try = norm_2(error_try);
+          if (norm_try > norm_start)
+            // Increase lambda and try again
+            lambda *= 10;
 
-        //vw_out(VerboseDebugMessage, "math") << "LM: inner iteration " << iterations << " error is " << error_try << std::endl;
-        //vw_out(DebugMessage, "math") << "\tLM: inner iteration " << iterations << " norm is " << norm_try << std::endl;
+          ++iterations; // Sanity check on iterations in this loop
+          if (iterations > 5) {
+            //vw_out(DebugMessage, "math") << "\n****LM: too many inner iterations - short circuiting\n" << std::endl;
+            shortCircuit = true;
+            norm_try = norm_start;
+          }
+          //vw_out(DebugMessage, "math") << "\tlambda = " << lambda << std::endl;
+        }
 
-        if (norm_try > norm_start)
-          // Increase lambda and try again
-          lambda *= 10;
+        // Percentage change convergence criterion
+        if (((norm_start-norm_try)/norm_start) < rel_tolerance) {
+          status = optimization::eConvergedRelTolerance;
+          vw_out(DebugMessage, "math") << "CONVERGED TO RELATIVE TOLERANCE\n";
+          done = true;
+        }
 
-        ++iterations; // Sanity check on iterations in this loop
-        if (iterations > 5) {
-          //vw_out(DebugMessage, "math") << "\n****LM: too many inner iterations - short circuiting\n" << std::endl;
-          shortCircuit = true;
-          norm_try = norm_start;
+        // Absolute error convergence criterion
+        if (norm_try < abs_tolerance) {
+          status = optimization::eConvergedAbsTolerance;
+          vw_out(DebugMessage, "math") << "CONVERGED TO ABSOLUTE TOLERANCE\n";
+          done = true;
         }
-        //vw_out(DebugMessage, "math") << "\tlambda = " << lambda << std::endl;
-      }
 
-      // Percentage change convergence criterion
-      if (((norm_start-norm_try)/norm_start) < rel_tolerance) {
-        status = optimization::eConvergedRelTolerance;
-        vw_out(DebugMessage, "math") << "CONVERGED TO RELATIVE TOLERANCE\n";
-        done = true;
-      }
+        // Max iterations convergence criterion
+        if (outer_iter >= max_iterations) {
+          vw_out(DebugMessage, "math") << "REACHED MAX ITERATIONS!";
+          done = true;
+        }
 
-      // Absolute error convergence criterion
-      if (norm_try < abs_tolerance) {
-        status = optimization::eConvergedAbsTolerance;
-        vw_out(DebugMessage, "math") << "CONVERGED TO ABSOLUTE TOLERANCE\n";
-        done = true;
-      }
+        // Take trial parameters as new parameters
+        // If we short-circuited the inner loop, then we didn't actually find a
+        // better p, so don't update it.
+        if (!shortCircuit)
+          x = x_try;
 
-      // Max iterations convergence criterion
-      if (outer_iter >= max_iterations) {
-        vw_out(DebugMessage, "math") << "REACHED MAX ITERATIONS!";
-        done = true;
+        // Take trial error as new error
+        norm_start = norm_try;
+
+        // Decrease lambda
+        lambda /= 10;
+        //vw_out(DebugMessage, "math") << "lambda = " << lambda << std::endl;
+        //vw_out(DebugMessage, "math") << "LM: end of outer iteration " << outer_iter << " with error " << norm_try << std::endl;
       }
+      vw_out(DebugMessage, "math") << "LM: finished with: " << outer_iter << "\n";
+      return x;
+    }
 
-      // Take trial parameters as new parameters
-      // If we short-circuited the inner loop, then we didn't actually find a
-      // better p, so don't update it.
-      if (!shortCircuit)
-        x = x_try;
+  } // namespace detail
+  /// \endcond
 
-      // Take trial error as new error
-      norm_start = norm_try;
+  /// Levenberg-Marquardt is an algorithm for solving problems of the
+  /// form
+  ///
+  /// J(p) = sum_i ( z_i - h(x_i) )^2
+  ///
+  /// That is, a least squares problem where the objective is to find a
+  /// parameter vector x such that the model function h(x), evaluates
+  /// as closely as possible to the observations z in a least squares
+  /// sense.
+  ///
+  /// Requires:
+  /// - a seed parameter vector x
+  /// - an observation vector z
+  /// - a data model derived from LeastSquaresModelBase, which includes
+  ///     - the model function,
+  ///     - its Jacobian
+  ///
+  /// The cost function in L-M is always the inner product of the
+  /// difference between an observation and the expected observation
+  /// given the model parameters.  This means we can compute the cost
+  /// function and its derivatives if we know the measurement function
+  /// and its derivatives.
+  ///
+  template <class ImplT>
+  typename ImplT::domain_type levenberg_marquardt( LeastSquaresModelBase<ImplT> const& least_squares_model,
+                                                   typename ImplT::domain_type const& seed,
+                                                   typename ImplT::result_type const& observation,
+                                                   int &status,
+                                                   double abs_tolerance = VW_MATH_LM_ABS_TOL,
+                                                   double rel_tolerance = VW_MATH_LM_REL_TOL,
+                                                   double max_iterations = VW_MATH_LM_MAX_ITER) {
+    detail::DenseNormalEquations normal;
+    return detail::levenberg_marquardt( least_squares_model.impl(), normal, seed, observation, status,
+                                        abs_tolerance, rel_tolerance, max_iterations );
+  }
 
-      // Decrease lambda
-      lambda /= 10;
-      //vw_out(DebugMessage, "math") << "lambda = " << lambda << std::endl;
-      //vw_out(DebugMessage, "math") << "LM: end of outer iteration " << outer_iter << " with error " << norm_try << std::endl;
-    }
-    vw_out(DebugMessage, "math") << "LM: finished with: " << outer_iter << "\n";
-    return x;
+  /// Levenberg-Marquardt for a model with a sparse Jacobian, whose
+  /// pattern is given by the model's jacobian_sparsity().  The steps
+  /// are the same as levenberg_marquardt() would take, but only the
+  /// nonzeros of the Jacobian and of the normal equations are ever
+  /// stored, so that problems with thousands of parameters are
+  /// practical.  The result_type and domain_type must be Vector<double>.
+  template <class ImplT>
+  typename ImplT::domain_type sparse_levenberg_marquardt( LeastSquaresModelBase<ImplT> const& least_squares_model,
+                                                          typename ImplT::domain_type const& seed,
+                                                          typename ImplT::result_type const& observation,
+                                                          int &status,
+                                                          double abs_tolerance = VW_MATH_LM_ABS_TOL,
+                                                          double rel_tolerance = VW_MATH_LM_REL_TOL,
+                                                          double max_iterations = VW_MATH_LM_MAX_ITER) {
+    detail::SparseNormalEquations normal( least_squares_model.impl().jacobian_sparsity() );
+    VW_ASSERT( normal.sparsity.rows() == observation.size() && normal.sparsity.cols() == seed.size(),
+               ArgumentErr() << "sparse_levenberg_marquardt: the sparsity pattern doesn't match the problem." );
+    return detail::levenberg_marquardt( least_squares_model.impl(), normal, seed, observation, status,
+                                        abs_tolerance, rel_tolerance, max_iterations );
   }
 
 }} // namespace vw::math
@@ -174,6 +174,16 @@ namespace math {
     return MatrixNoTmp<MatrixT>( val.impl() );
   }
 
+  /// This helper class allows overriding the basic assignment of
+  /// matrix expressions to fixed-size matrices in specific cases for
+  /// efficiency, using template specialization.
+  template <class DstMatrixT, class SrcMatrixT>
+  struct MatrixAssignImpl {
+    static void assign( DstMatrixT& dst, SrcMatrixT const& src ) {
+      std::copy( src.begin(), src.end(), dst.begin() );
+    }
+  };
+
 
   // *******************************************************************
   // class IndexingMatrixIterator<MatrixT>
@@ -335,7 +345,7 @@ namespace math {
     template <class T>
     Matrix( MatrixBase<T> const& m ) {
       VW_ASSERT( m.impl().rows()==RowsN && m.impl().cols()==ColsN, ArgumentErr() << "Matrix must have dimensions " << RowsN << "x" << ColsN << "." );
-      std::copy( m.impl().begin(), m.impl().end(), begin() );
+      MatrixAssignImpl<Matrix,T>::assign( *this, m.impl() );
     }
 
     /// Standard copy assignment operator.
@@ -1918,6 +1928,116 @@ namespace math {
   }
 
 
+  // *******************************************************************
+  // Kernels for small fixed-size matrix products.
+  // *******************************************************************
+
+  // The products of fixed-size floating point matrices and vectors of
+  // two to four elements on a side, like the norms and dot products
+  // in Vector.h, are computed straight from the elements: one element
+  // at a time when a product is part of a larger expression, and all
+  // at once when it is assigned to a fixed-size matrix or vector.
+  namespace detail {
+
+    template <class ElemT, size_t RowsN, size_t ColsN>
+    struct IsSmallMatrix {
+      const static bool value = IsSmallVector<ElemT,RowsN>::value && IsSmallVector<ElemT,ColsN>::value;
+    };
+
+    template <class ElemT, size_t RowsN, size_t ColsN, class ResultT>
+    struct EnableIfSmallMatrix
+      : boost::enable_if_c<IsSmallMatrix<ElemT,RowsN,ColsN>::value, ResultT> {};
+
+    /// r = m*v for a row-major RowsN x ColsN matrix.
+    template <size_t RowsN, size_t ColsN, class ElemT>
+    inline void small_mat_vec( ElemT const* m, ElemT const* v, ElemT* r ) {
+      for ( size_t i = 0; i < RowsN; ++i )
+        r[i] = small_dot<ColsN>( m + i*ColsN, v );
+    }
+
+    /// r = a*b for row-major RowsN x InnerN and InnerN x ColsN matrices.
+    template <size_t RowsN, size_t InnerN, size_t ColsN, class ElemT>
+    inline void small_mat_mat( ElemT const* a, ElemT const* b, ElemT* r ) {
+      for ( size_t i = 0; i < RowsN; ++i )
+        for ( size_t j = 0; j < ColsN; ++j )
+          r[i*ColsN+j] = small_dot<InnerN>( a + i*InnerN, b + j, ColsN );
+    }
+
+    /// Element i of m*v, or of transpose(m)*v.
+    template <bool TransposeN, class MatrixT, class VectorT>
+    typename ProductType<typename MatrixT::value_type, typename VectorT::value_type>::type
+    inline mat_vec_element( MatrixT const& m, VectorT const& v, size_t i ) {
+      if( TransposeN ) return dot_prod( select_col(m,i), v );
+      else return dot_prod( select_row(m,i), v );
+    }
+
+    template <bool TransposeN, class ElemT, size_t RowsN, size_t ColsN>
+    typename EnableIfSmallMatrix<ElemT, RowsN, ColsN, ElemT>::type
+    inline mat_vec_element( Matrix<ElemT,RowsN,ColsN> const& m,
+                            Vector<ElemT,(TransposeN?RowsN:ColsN)> const& v, size_t i ) {
+      if( TransposeN ) return small_dot<RowsN>( &v[0], m.data() + i, ColsN );
+      else return small_dot<ColsN>( m.data() + i*ColsN, &v[0] );
+    }
+
+    /// Element (i,j) of m1*m2.
+    template <bool Transpose1N, bool Transpose2N, class Matrix1T, class Matrix2T>
+    typename ProductType<typename Matrix1T::value_type, typename Matrix2T::value_type>::type
+    inline mat_mat_element( Matrix1T const& m1, Matrix2T const& m2, size_t i, size_t j ) {
+      if     ( (!Transpose1N)&&(!Transpose2N) ) return dot_prod( select_row(m1,i), select_col(m2,j) );
+      else if( (!Transpose1N)&&( Transpose2N) ) return dot_prod( select_row(m1,i), select_row(m2,j) );
+      else if( ( Transpose1N)&&(!Transpose2N) ) return dot_prod( select_col(m1,i), select_col(m2,j) );
+      else                                      return dot_prod( select_col(m1,i), select_row(m2,j) );
+    }
+
+    template <bool Transpose1N, bool Transpose2N, class ElemT, size_t RowsN, size_t InnerN, size_t ColsN>
+    typename boost::enable_if_c<!Transpose1N && !Transpose2N,
+      typename EnableIfSmallMatrix<ElemT, RowsN, ColsN,
+        typename EnableIfSmallVector<ElemT, InnerN, ElemT>::type >::type >::type
+    inline mat_mat_element( Matrix<ElemT,RowsN,InnerN> const& m1, Matrix<ElemT,InnerN,ColsN> const& m2,
+                            size_t i, size_t j ) {
+      return small_dot<InnerN>( m1.data() + i*InnerN, m2.data() + j, ColsN );
+    }
+
+    /// Assigns a small matrix-vector product all at once.
+    template <class ElemT, size_t RowsN, size_t ColsN,
+              bool SmallN = IsSmallMatrix<ElemT, RowsN, ColsN>::value>
+    struct SmallMatVecAssign {
+      template <class SrcVecT>
+      static void assign( Vector<ElemT,RowsN>& dst, SrcVecT const& src ) {
+        for ( size_t i = 0; i < RowsN; ++i )
+          dst(i) = src(i);
+      }
+    };
+
+    template <class ElemT, size_t RowsN, size_t ColsN>
+    struct SmallMatVecAssign<ElemT, RowsN, ColsN, true> {
+      template <class SrcVecT>
+      static void assign( Vector<ElemT,RowsN>& dst, SrcVecT const& src ) {
+        small_mat_vec<RowsN,ColsN>( src.matrix().data(), &src.vector()[0], &dst[0] );
+      }
+    };
+
+    /// Assigns a small matrix product all at once.
+    template <class ElemT, size_t RowsN, size_t InnerN, size_t ColsN,
+              bool SmallN = IsSmallMatrix<ElemT, RowsN, ColsN>::value && IsSmallVector<ElemT, InnerN>::value>
+    struct SmallMatMatAssign {
+      template <class SrcMatrixT>
+      static void assign( Matrix<ElemT,RowsN,ColsN>& dst, SrcMatrixT const& src ) {
+        std::copy( src.begin(), src.end(), dst.begin() );
+      }
+    };
+
+    template <class ElemT, size_t RowsN, size_t InnerN, size_t ColsN>
+    struct SmallMatMatAssign<ElemT, RowsN, InnerN, ColsN, true> {
+      template <class SrcMatrixT>
+      static void assign( Matrix<ElemT,RowsN,ColsN>& dst, SrcMatrixT const& src ) {
+        small_mat_mat<RowsN,InnerN,ColsN>( src.matrix1().data(), src.matrix2().data(), dst.data() );
+      }
+    };
+
+  } // namespace detail
+
+
   // *******************************************************************
   // Matrix vector product.
   // *******************************************************************
@@ -1948,13 +2068,15 @@ namespace math {
 
     MatrixVectorProduct( MatrixT const& m, VectorT const& v ) : m_matrix(m), m_vector(v) {}
 
+    typename MatrixClosure<MatrixT>::type matrix() const { return m_matrix; }
+    typename VectorClosure<VectorT>::type vector() const { return m_vector; }
+
     size_t size() const {
       return (TransposeN)?(m_matrix.cols()):(m_matrix.rows());
     }
 
     reference_type operator()( size_t i ) const {
-      if( TransposeN ) return dot_prod( select_col(m_matrix,i), m_vector );
-      else return dot_prod( select_row(m_matrix,i), m_vector );
+      return detail::mat_vec_element<TransposeN>( m_matrix, m_vector, i );
     }
 
     class iterator : public boost::iterator_facade<iterator, value_type, boost::random_access_traversal_tag, value_type> {
@@ -2000,6 +2122,18 @@ namespace math {
     return transpose(MatrixVectorProduct<MatrixT,VectorT,true>( m.impl(), v.child() ));
   }
 
+  template <class ElemT, size_t ColsN>
+  struct VectorAssignImpl<Vector<ElemT,2>, MatrixVectorProduct<Matrix<ElemT,2,ColsN>,Vector<ElemT,ColsN>,false> >
+    : detail::SmallMatVecAssign<ElemT,2,ColsN> {};
+
+  template <class ElemT, size_t ColsN>
+  struct VectorAssignImpl<Vector<ElemT,3>, MatrixVectorProduct<Matrix<ElemT,3,ColsN>,Vector<ElemT,ColsN>,false> >
+    : detail::SmallMatVecAssign<ElemT,3,ColsN> {};
+
+  template <class ElemT, size_t ColsN>
+  struct VectorAssignImpl<Vector<ElemT,4>, MatrixVectorProduct<Matrix<ElemT,4,ColsN>,Vector<ElemT,ColsN>,false> >
+    : detail::SmallMatVecAssign<ElemT,4,ColsN> {};
+
 
   // *******************************************************************
   // Matrix matrix product.
@@ -2025,6 +2159,9 @@ namespace math {
 
     MatrixMatrixProduct( Matrix1T const& m1, Matrix2T const& m2 ) : m_matrix1(m1), m_matrix2(m2) {}
 
+    typename MatrixClosure<Matrix1T>::type matrix1() const { return m_matrix1; }
+    typename MatrixClosure<Matrix2T>::type matrix2() const { return m_matrix2; }
+
     size_t rows() const {
       return (Transpose1N)?(m_matrix1.cols()):(m_matrix1.rows());
     }
@@ -2034,10 +2171,7 @@ namespace math {
     }
 
     reference_type operator()( size_t i, size_t j ) const {
-      if     ( (!Transpose1N)&&(!Transpose2N) ) return dot_prod( select_row(m_matrix1,i), select_col(m_matrix2,j) );
-      else if( (!Transpose1N)&&( Transpose2N) ) return dot_prod( select_row(m_matrix1,i), select_row(m_matrix2,j) );
-      else if( ( Transpose1N)&&(!Transpose2N) ) return dot_prod( select_col(m_matrix1,i), select_col(m_matrix2,j) );
-      else                                      return dot_prod( select_col(m_matrix1,i), select_row(m_matrix2,j) );
+      return detail::mat_mat_element<Transpose1N,Transpose2N>( m_matrix1, m_matrix2, i, j );
     }
 
     typedef IndexingMatrixIterator<const MatrixMatrixProduct> iterator;
@@ -2054,6 +2188,11 @@ namespace math {
     return MatrixMatrixProduct<Matrix1T,Matrix2T,false,false>( m1.impl(), m2.impl() );
   }
 
+  template <class ElemT, size_t RowsN, size_t InnerN, size_t ColsN>
+  struct MatrixAssignImpl<Matrix<ElemT,RowsN,ColsN>,
+                          MatrixMatrixProduct<Matrix<ElemT,RowsN,InnerN>,Matrix<ElemT,InnerN,ColsN>,false,false> >
+    : detail::SmallMatMatAssign<ElemT,RowsN,InnerN,ColsN> {};
+
 
   // *******************************************************************
   // Convenience functions for returning a pre-made identity matrix in
@@ -12,14 +12,21 @@
 /// Based on Chapter 13, Section 13.1 of "The Nature of Mathematical
 /// Modelling" by Neal Gershenfeld with some inspiration from
 /// Numerical Recipes.
+///
+/// With parallel set, the vertices of a new simplex and of a simplex
+/// shrinking towards its best point are evaluated together on the
+/// thread pool, so the cost function must be safe to call from
+/// several threads.  The search itself is the same either way.
 
 #ifndef __VW_MATH_NELDER_MEAD_H__
 #define __VW_MATH_NELDER_MEAD_H__
 
 #include <list>
+#include <vector>
 
 // Vision workbench
 #include <vw/Math/Vector.h>
+#include <vw/Math/ParallelEvaluation.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
 
@@ -39,6 +46,7 @@ namespace math {
     typedef typename std::list<vertex_type>::iterator vertex_iterator;
 
     FuncT m_func;
+    bool m_parallel;
     std::list<vertex_type> m_vertices;
 
     // Insert a new vertex into the list while maintaining the
@@ -63,6 +71,18 @@ namespace math {
       return vertex;
     }
 
+    // Evaluate the cost function at each of the locations, at once if
+    // the simplex is parallel.
+    void evaluate(std::vector<DomainT> const& locations, std::vector<double>& values) const {
+      if (m_parallel) {
+        evaluate_in_parallel(m_func, locations, values);
+        return;
+      }
+      values.resize(locations.size());
+      for (unsigned i=0; i < locations.size(); ++i)
+        values[i] = m_func(locations[i]);
+    }
+
     DomainT mean_vertex_location() {
       vertex_iterator iter = m_vertices.begin();
       DomainT mean_location = (*iter).first;
@@ -75,7 +95,8 @@ namespace math {
 
   public:
     template <class ScaleT>
-    Simplex(FuncT const& func, DomainT const seed, ScaleT const& scales) : m_func(func) {
+    Simplex(FuncT const& func, DomainT const seed, ScaleT const& scales, bool parallel = false)
+      : m_func(func), m_parallel(parallel) {
 
       VW_ASSERT(scales.size() == seed.size(),
                 ArgumentErr() << "NelderMeadMinimizer: the number of scales does not match the dimensionality of the data in the seed vector.");
@@ -84,13 +105,15 @@ namespace math {
       // other vertices are chosen by picking points in each of the
       // standard unit vector directions.  The distance in each
       // direction is determined by the scale variable.
-      m_vertices.push_front( vertex_type(seed, m_func(seed)) );
-
-      for (unsigned i=0; i < seed.size(); ++i) {
-        DomainT vertex = seed;
-        vertex[i] += scales[i];
-        insert_vertex( vertex_type(vertex, m_func(vertex)) );
-      }
+      std::vector<DomainT> locations(seed.size()+1, seed);
+      for (unsigned i=0; i < seed.size(); ++i)
+        locations[i+1][i] += scales[i];
+      std::vector<double> values;
+      evaluate(locations, values);
+
+      m_vertices.push_front( vertex_type(locations[0], values[0]) );
+      for (unsigned i=1; i < locations.size(); ++i)
+        insert_vertex( vertex_type(locations[i], values[i]) );
     }
 
     // Print out the current set of simplex vertices along with the
@@ -154,17 +177,20 @@ namespace math {
       // place). (shrink all)
       if (new_val > highest_vertex().second) {
         new_loc = 0.5 * (highest_vtx.first + lowest_vtx.first);
-        new_val = m_func(new_loc);
 
-        vertex_iterator iter = m_vertices.begin();
-        while(iter != m_vertices.end()) {
-          // Omit the last position
-          vertex_iterator next_iter = iter;
-          if (++next_iter != m_vertices.end()) {
-            (*iter).first = 0.5 * ((*iter).first + lowest_vtx.first);
-            (*iter).second = m_func((*iter).first);
-          }
-          ++iter;
+        // Omit the last position
+        std::vector<DomainT> locations(1, new_loc);
+        vertex_iterator last = --m_vertices.end();
+        for (vertex_iterator iter = m_vertices.begin(); iter != last; ++iter)
+          locations.push_back( 0.5 * ((*iter).first + lowest_vtx.first) );
+        std::vector<double> values;
+        evaluate(locations, values);
+
+        new_val = values[0];
+        unsigned i = 1;
+        for (vertex_iterator iter = m_vertices.begin(); iter != last; ++iter, ++i) {
+          (*iter).first = locations[i];
+          (*iter).second = values[i];
         }
       }
 
@@ -179,7 +205,8 @@ namespace math {
   template <class FuncT, class DomainT, class ScaleT>
   DomainT nelder_mead( FuncT const& func, DomainT const& seed, ScaleT const& scale,
                        int &status, bool verbose = false, int restarts = 1,
-                       double tolerance = 1e-16, int max_iterations = 1000) {
+                       double tolerance = 1e-16, int max_iterations = 1000,
+                       bool parallel = false) {
     DomainT result = seed;
     status = optimization::eNelderMeadConvergedRelTolerance;
 
@@ -194,7 +221,7 @@ namespace math {
     int iterations = 0;
     for (int i=0; i < restarts; ++i) {
       iterations = 0;
-      Simplex<FuncT, DomainT> simplex(func, result, scale);
+      Simplex<FuncT, DomainT> simplex(func, result, scale, parallel);
 
       // Perform simplex updates until tolerance in reached or
       // max_iterations is reached
@@ -221,10 +248,11 @@ namespace math {
 
   template <class FuncT, class DomainT>
     DomainT nelder_mead( FuncT const& func, DomainT const& seed, int &status, bool verbose = false,
-                       int restarts = 1, double tolerance = 1e-16, int max_iterations = 1000) {
+                       int restarts = 1, double tolerance = 1e-16, int max_iterations = 1000,
+                       bool parallel = false) {
     vw::Vector<double> scale(seed.size());
     fill(scale,1.0);
-    return nelder_mead(func, seed, scale, status, verbose, restarts, tolerance, max_iterations);
+    return nelder_mead(func, seed, scale, status, verbose, restarts, tolerance, max_iterations, parallel);
   }
 
 }} // namespace vw::math
@@ -0,0 +1,73 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file ParallelEvaluation.h
+///
+/// Evaluates an objective at a batch of points on the thread pool,
+/// for optimizers that need many independent costs at once, such as
+/// the particles of a swarm or the vertices of a shrinking simplex.
+/// The objective's operator() must be const and safe to call from
+/// several threads at a time.  Each value depends only on its point,
+/// so the results don't depend on the number of threads.
+///
+#ifndef __VW_MATH_PARALLEL_EVALUATION_H__
+#define __VW_MATH_PARALLEL_EVALUATION_H__
+
+#include <vector>
+#include <algorithm>
+
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+namespace vw {
+namespace math {
+
+  /// \cond INTERNAL
+  namespace detail {
+    // Evaluates the points [begin,end).
+    template <class FuncT, class DomainT>
+    struct EvaluationTask {
+      typedef void result_type;
+      FuncT const& func;
+      std::vector<DomainT> const& points;
+      std::vector<double>& values;
+      size_t begin, end;
+      EvaluationTask( FuncT const& func, std::vector<DomainT> const& points,
+                      std::vector<double>& values, size_t begin, size_t end )
+        : func(func), points(points), values(values), begin(begin), end(end) {}
+      void operator()() const {
+        for ( size_t i = begin; i < end; i++ )
+          values[i] = func( points[i] );
+      }
+    };
+  }
+  /// \endcond
+
+  /// Sets values[i] to func(points[i]) for every point.  With more
+  /// than one thread the points are split into a few ranges per
+  /// thread.  An exception thrown by func is rethrown here.
+  template <class FuncT, class DomainT>
+  void evaluate_in_parallel( FuncT const& func, std::vector<DomainT> const& points,
+                             std::vector<double>& values ) {
+    values.resize( points.size() );
+    uint32 num_threads = vw_settings().default_num_threads();
+    if ( num_threads < 2 || points.size() < 2 ) {
+      detail::EvaluationTask<FuncT, DomainT>( func, points, values, 0, points.size() )();
+      return;
+    }
+    size_t range = std::max( points.size() / ( 4 * size_t(num_threads) ), size_t(1) );
+    FifoWorkQueue queue( num_threads );
+    std::vector<Future<void> > futures;
+    for ( size_t begin = 0; begin < points.size(); begin += range )
+      futures.push_back( queue.submit( detail::EvaluationTask<FuncT, DomainT>
+                                       ( func, points, values, begin, std::min( begin + range, points.size() ) ) ) );
+    when_all( futures );
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_PARALLEL_EVALUATION_H__
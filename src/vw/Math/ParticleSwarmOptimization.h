@@ -23,29 +23,70 @@
 ///
 /// A number of arithmetic and other operations have to be defined on DomainT,
 /// thus using vectors vw::Vector<double, n> or vw::Vector<double> is recommended.
+///
+/// With parallel set, each iteration moves the whole swarm and then
+/// evaluates it on the thread pool, so func must be safe to call from
+/// several threads.  The particles then only learn of a new global
+/// minimum at the next iteration.  A nonzero seed makes a run
+/// repeatable, with any number of threads.
 
 #ifndef __VW_MATH_PARTICLE_SWARM_OPTIMIZATION_H__
 #define __VW_MATH_PARTICLE_SWARM_OPTIMIZATION_H__
 
+#include <ctime>
+#include <vector>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_01.hpp>
+
 // Vision Workbench
 #include <vw/Math/Functions.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/ParallelEvaluation.h>
 #include <vw/Core/Log.h>
 
 namespace vw {
 namespace math {
+  /// \cond INTERNAL
+  namespace detail {
+  // Records a particle's new cost at x as its local minimum, and as the
+  // global one, where it improves on them.
+  template <class DomainT>
+  void update_particle_swarm_minima( DomainT const& x, double x_val, DomainT& x_hat, double& x_hat_val,
+                                     DomainT& g_hat, double& g_hat_val, bool verbose,
+                                     int start, int restarts, unsigned int iter, unsigned int n_iter ) {
+    // update local maximum
+    if (x_val < x_hat_val) {
+      if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new local minimum " << x_val << std::endl;
+      x_hat = x;
+      x_hat_val = x_val;
+    }
+
+    // update global maximum
+    if (x_val < g_hat_val) {
+      if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new global minimum " << x_val << std::endl;
+      g_hat = x;
+      g_hat_val = x_val;
+    }
+  }
+  }
+  /// \endcond
+
   template <class FuncT, class DomainT>
   DomainT particle_swarm_optimization( FuncT const& func, DomainT const& min, DomainT const& max,
                                        bool verbose = false, int restarts = 1,
                                        unsigned int n_particles = 100,  unsigned int n_iter = 1000,
-                                       double w = 0.9, double c1 = 2, double c2 = 2, double v_max = 4.0)
+                                       double w = 0.9, double c1 = 2, double c2 = 2, double v_max = 4.0,
+                                       bool parallel = false, unsigned int seed = 0)
   {
     std::vector<DomainT> x;        x.resize(n_particles);         // particles
     std::vector<DomainT> x_hat;    x_hat.resize(n_particles);     // local maxima
     std::vector<double> x_hat_val; x_hat_val.resize(n_particles); // local maxima values
     std::vector<DomainT> v;        v.resize(n_particles);         // velocities
 
-    std::srand(std::time(0)); // seed random number generator
+    // seed random number generator
+    boost::rand48 gen( seed ? seed : static_cast<unsigned int>(std::time(0)) );
+    boost::uniform_01<boost::rand48> uniform( gen );
 
     DomainT g_hat = min; // global minimum
     double g_hat_val = func(min);
@@ -62,20 +103,23 @@ namespace math {
         v[i].set_size(min.size());
 
         for (unsigned int j = 0; j < min.size(); j++) {
-            x[i](j) = static_cast<double>(rand())/RAND_MAX*(max(j) - min(j)) + min(j);
+            x[i](j) = uniform()*(max(j) - min(j)) + min(j);
             x_hat[i](j) = x[i](j);
             v[i](j) = 0;
         }
 
-        x_hat_val[i] = func(x_hat[i]);
+        if (!parallel)
+          x_hat_val[i] = func(x_hat[i]);
       }
+      if (parallel)
+        evaluate_in_parallel(func, x_hat, x_hat_val);
 
       if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " initialized particles" << std::endl;
 
       // search globally minimum particle
       for (unsigned int i = 0; i < x.size(); i++) {
-        if (double d = func(x[i]) < g_hat_val) {
-          g_hat_val = d;
+        if (x_hat_val[i] < g_hat_val) {
+          g_hat_val = x_hat_val[i];
           g_hat = x[i];
         }
       }
@@ -86,6 +130,7 @@ namespace math {
       DomainT r1, r2;
       r1.set_size(min.size());
       r2.set_size(min.size());
+      std::vector<double> x_val(parallel ? x.size() : 0);
 
       // iterate
       for (unsigned int iter = 0; iter < n_iter; iter++) {
@@ -95,8 +140,8 @@ namespace math {
         for (unsigned int i = 0; i < x.size(); i++) {
           // initialize random vectors
           for (unsigned int j = 0; j < r1.size(); j++) {
-            r1(j) = static_cast<double>(rand())/RAND_MAX;
-            r2(j) = static_cast<double>(rand())/RAND_MAX;
+            r1(j) = uniform();
+            r2(j) = uniform();
           }
 
           // particle position and velocity update
@@ -110,20 +155,19 @@ namespace math {
 
           if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO x = " << x[i] << " with velocity v = " << v[i] << std::endl;
 
-          // update local maximum
+          if (parallel)
+            continue;
           double x_i_val = func(x[i]);
-          if (x_i_val < x_hat_val[i]) {
-            if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new local minimum " << x_i_val << std::endl;
-            x_hat[i] = x[i];
-            x_hat_val[i] = x_i_val;
-          }
+          detail::update_particle_swarm_minima(x[i], x_i_val, x_hat[i], x_hat_val[i], g_hat, g_hat_val,
+                                               verbose, start, restarts, iter, n_iter);
+        }
 
-          // update global maximum
-          if (x_i_val < g_hat_val) {
-            if (verbose) vw::vw_out(vw::VerboseDebugMessage, "math") << "PSO run " << start+1 << "/" << restarts << " iteration " << iter << "/" << n_iter << " new global minimum " << x_i_val << std::endl;
-            g_hat = x[i];
-            g_hat_val = x_i_val;
-          }
+        // evaluate the moved swarm all at once
+        if (parallel) {
+          evaluate_in_parallel(func, x, x_val);
+          for (unsigned int i = 0; i < x.size(); i++)
+            detail::update_particle_swarm_minima(x[i], x_val[i], x_hat[i], x_hat_val[i], g_hat, g_hat_val,
+                                                 verbose, start, restarts, iter, n_iter);
         }
       }
     }
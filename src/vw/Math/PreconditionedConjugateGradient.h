@@ -0,0 +1,195 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PreconditionedConjugateGradient.h
+///
+/// The preconditioned conjugate gradient method for solving A*x = b
+/// with A symmetric positive definite.  Unlike the optimizers in
+/// ConjugateGradient.h, this is a linear solver, and A is never
+/// formed; it is given as an operator that multiplies vectors by A,
+/// so it may be a product of sparse factors such as J^T*J or the
+/// reduced camera matrix of bundle adjustment.
+///
+/// An operator is a functor with a method
+///   void operator()( Vector<double> const& x, Vector<double>& y ) const;
+/// that sets y, which already has the right size, to A*x.  A
+/// preconditioner is one that sets y to an approximation of
+/// inverse(A)*x; it should itself be symmetric positive definite.
+///
+#ifndef __VW_MATH_PRECONDITIONEDCONJUGATEGRADIENT_H__
+#define __VW_MATH_PRECONDITIONEDCONJUGATEGRADIENT_H__
+
+#include <vector>
+#include <cmath>
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+namespace vw {
+namespace math {
+
+  /// No preconditioning.
+  struct IdentityPreconditioner {
+    void operator()( Vector<double> const& x, Vector<double>& y ) const { y = x; }
+  };
+
+  /// Preconditions with the inverse of a block diagonal of A, made of
+  /// square blocks of block_size elements.
+  class BlockJacobiPreconditioner {
+    size_t m_block_size;
+    std::vector<double> m_inverse;
+
+  public:
+    BlockJacobiPreconditioner( size_t num_blocks, size_t block_size )
+      : m_block_size(block_size), m_inverse(num_blocks*block_size*block_size, 0.0) {
+      for ( size_t k = 0; k < num_blocks; k++ )
+        for ( size_t i = 0; i < block_size; i++ )
+          m_inverse[(k*block_size + i)*block_size + i] = 1.0;
+    }
+
+    size_t num_blocks() const { return m_inverse.size() / (m_block_size*m_block_size); }
+    size_t block_size() const { return m_block_size; }
+
+    /// Sets block k of the diagonal.  A block that isn't positive
+    /// definite is replaced by its diagonal, with any element that
+    /// isn't positive taken to be one.
+    template <class MatrixT>
+    void set_block( size_t k, MatrixBase<MatrixT> const& block ) {
+      size_t n = m_block_size;
+      VW_ASSERT( k < num_blocks(), ArgumentErr() << "BlockJacobiPreconditioner: no block " << k << "." );
+      VW_ASSERT( block.impl().rows() == n && block.impl().cols() == n,
+                 ArgumentErr() << "BlockJacobiPreconditioner: blocks must be " << n << "x" << n << "." );
+
+      // Cholesky, L in the lower triangle of inv.
+      double* inv = &m_inverse[k*n*n];
+      bool definite = true;
+      for ( size_t i = 0; i < n && definite; i++ )
+        for ( size_t j = 0; j <= i; j++ ) {
+          double sum = block.impl()(i,j);
+          for ( size_t l = 0; l < j; l++ )
+            sum -= inv[i*n+l] * inv[j*n+l];
+          if ( i == j ) {
+            if ( !( sum > 0 ) ) {
+              definite = false;
+              break;
+            }
+            inv[i*n+i] = std::sqrt( sum );
+          } else {
+            inv[i*n+j] = sum / inv[j*n+j];
+          }
+        }
+      if ( !definite ) {
+        for ( size_t i = 0; i < n; i++ )
+          for ( size_t j = 0; j < n; j++ ) {
+            double d = block.impl()(i,i);
+            inv[i*n+j] = i != j ? 0.0 : ( d > 0 ? 1.0 / d : 1.0 );
+          }
+        return;
+      }
+
+      // inverse(L), in place, then inverse(L)^T*inverse(L).
+      for ( size_t i = 0; i < n; i++ ) {
+        inv[i*n+i] = 1.0 / inv[i*n+i];
+        for ( size_t j = 0; j < i; j++ ) {
+          double sum = 0;
+          for ( size_t l = j; l < i; l++ )
+            sum -= inv[i*n+l] * inv[l*n+j];
+          inv[i*n+j] = sum * inv[i*n+i];
+        }
+      }
+      std::vector<double> product( n*n );
+      for ( size_t i = 0; i < n; i++ )
+        for ( size_t j = 0; j <= i; j++ ) {
+          double sum = 0;
+          for ( size_t l = i; l < n; l++ )
+            sum += inv[l*n+i] * inv[l*n+j];
+          product[i*n+j] = product[j*n+i] = sum;
+        }
+      std::copy( product.begin(), product.end(), inv );
+    }
+
+    void operator()( Vector<double> const& x, Vector<double>& y ) const {
+      size_t n = m_block_size;
+      for ( size_t k = 0; k < num_blocks(); k++ ) {
+        double const* inv = &m_inverse[k*n*n];
+        for ( size_t i = 0; i < n; i++ ) {
+          double sum = 0;
+          for ( size_t j = 0; j < n; j++ )
+            sum += inv[i*n+j] * x[k*n+j];
+          y[k*n+i] = sum;
+        }
+      }
+    }
+  };
+
+  /// How a solve went.
+  struct ConjugateGradientResult {
+    size_t iterations;
+    double residual;          // norm_2(b - A*x) / norm_2(b)
+    bool converged;
+  };
+
+  /// Solves A*x = b by the preconditioned conjugate gradient method,
+  /// starting from x, until the residual falls to tolerance times
+  /// norm_2(b) or max_iterations have been run.  A max_iterations of
+  /// zero allows as many iterations as there are unknowns.
+  template <class OperatorT, class PreconditionerT>
+  ConjugateGradientResult
+  preconditioned_conjugate_gradient( OperatorT const& A, PreconditionerT const& M,
+                                     Vector<double> const& b, Vector<double>& x,
+                                     double tolerance = 1e-10, size_t max_iterations = 0 ) {
+    size_t n = b.size();
+    VW_ASSERT( x.size() == n, ArgumentErr() << "preconditioned_conjugate_gradient: x and b differ in size." );
+    if ( max_iterations == 0 )
+      max_iterations = n;
+
+    ConjugateGradientResult result;
+    result.iterations = 0;
+    result.residual = 0;
+    result.converged = true;
+    double b_norm = norm_2( b );
+    if ( b_norm == 0 ) {
+      fill( x, 0.0 );
+      return result;
+    }
+
+    Vector<double> r( n ), z( n ), p( n ), q( n );
+    A( x, q );
+    r = b - q;
+    M( r, z );
+    p = z;
+    double rz = dot_prod( r, z );
+    double threshold = tolerance * b_norm;
+    result.residual = norm_2( r ) / b_norm;
+    while ( norm_2( r ) > threshold ) {
+      if ( result.iterations == max_iterations || !( rz > 0 ) ) {
+        result.converged = false;
+        break;
+      }
+      A( p, q );
+      double pq = dot_prod( p, q );
+      if ( !( pq > 0 ) ) {
+        result.converged = false;
+        break;
+      }
+      double alpha = rz / pq;
+      x += alpha * p;
+      r -= alpha * q;
+      M( r, z );
+      double rz_next = dot_prod( r, z );
+      p = z + ( rz_next / rz ) * p;
+      rz = rz_next;
+      result.iterations++;
+      result.residual = norm_2( r ) / b_norm;
+    }
+    return result;
+  }
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_PRECONDITIONEDCONJUGATEGRADIENT_H__
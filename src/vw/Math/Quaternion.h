@@ -18,6 +18,8 @@
 //   Construction from a rotation matrix
 //   Conversion to matrix via rotation_matrix() and rotation_matrix_4()
 //   Rotation of individual 3-vectors via rotate()
+//   Rotation of arrays of points via rotate() and rotate_points()
+//   Composition with arrays of quaternions via compose()
 //   Conjugation and inverse via conj() and inverse()
 //   exp, sin, cos, tan, sinh, cosh, tanh, and pow with integer powers
 //   Norms via norm_1(), norm_2(), and norm_inf()
@@ -183,6 +185,42 @@ namespace math {
   };
 
 
+  /// Rotates count points by a rotation matrix, from points to
+  /// result, which may be the same array.  The loop works on the raw
+  /// elements, without temporaries, so that the compiler can
+  /// vectorize it.
+  template <class ElemT>
+  inline void rotate_points( Matrix<ElemT,3,3> const& rot, Vector<ElemT,3> const* points,
+                             Vector<ElemT,3>* result, size_t count ) {
+    ElemT const r00 = rot(0,0), r01 = rot(0,1), r02 = rot(0,2);
+    ElemT const r10 = rot(1,0), r11 = rot(1,1), r12 = rot(1,2);
+    ElemT const r20 = rot(2,0), r21 = rot(2,1), r22 = rot(2,2);
+    for ( size_t i = 0; i < count; ++i ) {
+      ElemT const x = points[i][0], y = points[i][1], z = points[i][2];
+      result[i][0] = r00*x + r01*y + r02*z;
+      result[i][1] = r10*x + r11*y + r12*z;
+      result[i][2] = r20*x + r21*y + r22*z;
+    }
+  }
+
+  /// The same for points stored as separate arrays of their x, y and
+  /// z coordinates, which vectorizes best.  The results may overwrite
+  /// the inputs.
+  template <class ElemT>
+  inline void rotate_points( Matrix<ElemT,3,3> const& rot,
+                             ElemT const* x, ElemT const* y, ElemT const* z,
+                             ElemT* rx, ElemT* ry, ElemT* rz, size_t count ) {
+    ElemT const r00 = rot(0,0), r01 = rot(0,1), r02 = rot(0,2);
+    ElemT const r10 = rot(1,0), r11 = rot(1,1), r12 = rot(1,2);
+    ElemT const r20 = rot(2,0), r21 = rot(2,1), r22 = rot(2,2);
+    for ( size_t i = 0; i < count; ++i ) {
+      ElemT const xi = x[i], yi = y[i], zi = z[i];
+      rx[i] = r00*xi + r01*yi + r02*zi;
+      ry[i] = r10*xi + r11*yi + r12*zi;
+      rz[i] = r20*xi + r21*yi + r22*zi;
+    }
+  }
+
   template <class ElemT>
   class Quaternion : public QuaternionBase<Quaternion<ElemT> >
   {
@@ -335,6 +373,37 @@ namespace math {
       VectorT const& v = v_.impl();
       return imag( *this * Quaternion(0,v[0],v[1],v[2]) / *this );
     }
+
+    /// Rotates count points as rotate() does, from points to result,
+    /// which may be the same array.  The rotation matrix is worked out
+    /// once for the whole batch, scaled so that the quaternion needn't
+    /// be normalized.
+    void rotate( Vector<ElemT,3> const* points, Vector<ElemT,3>* result, size_t count ) const {
+      rotate_points( unit_rotation_matrix(), points, result, count );
+    }
+
+    /// The same for points stored as separate coordinate arrays.
+    void rotate( ElemT const* x, ElemT const* y, ElemT const* z,
+                 ElemT* rx, ElemT* ry, ElemT* rz, size_t count ) const {
+      rotate_points( unit_rotation_matrix(), x, y, z, rx, ry, rz, count );
+    }
+
+    /// Sets result[i] to this quaternion times quaternions[i], the
+    /// rotation quaternions[i] followed by this one.
+    void compose( Quaternion const* quaternions, Quaternion* result, size_t count ) const {
+      for ( size_t i = 0; i < count; ++i )
+        result[i].m_core = m_core * quaternions[i].m_core;
+    }
+
+  private:
+    Matrix<ElemT,3,3> unit_rotation_matrix() const {
+      Matrix<ElemT,3,3> rot;
+      rotation_matrix( rot );
+      ElemT n = w()*w() + x()*x() + y()*y() + z()*z();
+      if ( n != ElemT(1) )
+        rot /= n;
+      return rot;
+    }
   };
 
 
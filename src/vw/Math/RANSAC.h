@@ -39,12 +39,37 @@
 ///    set of points, this routine could compute the 2-norm of the
 ///    error: || p2 - H * p1 ||
 ///
+/// Hypotheses are fit and scored in rounds spread over the default
+/// number of threads.  Rather than a fixed number of iterations, the
+/// search stops once the best fit so far would have been found with
+/// the requested confidence, as in:
+///
+/// Matas, J. and Chum, O. "Randomized RANSAC with T(d,d) test"
+/// (2004)
+///
+/// whose T(d,d) test is also used: each hypothesis is first checked
+/// against d random points, and is only scored against the whole set
+/// if all of them are inliers.  Scoring stops early once a hypothesis
+/// can no longer beat the best one.
+///
 
 #ifndef __VW_MATH_RANSAC_H__
 #define __VW_MATH_RANSAC_H__
 
 #include <vw/Math/Vector.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 namespace vw {
 namespace math {
@@ -101,6 +126,10 @@ namespace math {
     const FittingFuncT& m_fitting_func;
     const ErrorFuncT& m_error_func;
     double m_inlier_threshold;
+    double m_confidence;
+    int32 m_pretest_size;
+    uint32 m_seed;
+    bool m_seeded;
 
     // Returns the number of inliers for a given threshold.
     template <class ContainerT1, class ContainerT2>
@@ -116,14 +145,14 @@ namespace math {
     }
 
     /// \cond INTERNAL
-    // Utility Function: Pick N UNIQUE, random integers in the range [0, size]
-    inline void _vw_get_n_unique_integers(size_t size, size_t n, int* samples) const {
+    // Utility Function: Pick N UNIQUE, random integers in the range [0, size)
+    static void _vw_get_n_unique_integers(boost::rand48& gen, size_t size, size_t n, int32* samples) {
       VW_ASSERT(size >= n, ArgumentErr() << "Not enough samples (" << n << " / " << size << ")\n");
 
       for (size_t i=0; i<n; ++i) {
         bool done = false;
         while (!done) {
-          samples[i] = int( (double(std::rand()) / double(RAND_MAX)) * size );
+          samples[i] = int32( uint32(gen()) % size );
           done = true;
           for (size_t j = 0; j < i; j++)
             if (samples[i] == samples[j])
@@ -131,6 +160,97 @@ namespace math {
         }
       }
     }
+
+    // The best of a batch of hypotheses.
+    struct Hypothesis {
+      uint32 inliers;
+      uint32 verified;   // hypotheses that passed the T(d,d) test
+      typename FittingFuncT::result_type H;
+      Hypothesis() : inliers(0), verified(0) {}
+    };
+
+    // Fits and scores count hypotheses from samples drawn with its
+    // own generator.  Only hypotheses with more inliers than best are
+    // kept, so scoring stops when that is out of reach.
+    template <class ContainerT1, class ContainerT2>
+    class Batch {
+      RandomSampleConsensus const& m_ransac;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+      uint32 m_seed, m_count, m_best;
+    public:
+      typedef Hypothesis result_type;
+
+      Batch( RandomSampleConsensus const& ransac,
+             std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2,
+             uint32 seed, uint32 count, uint32 best )
+        : m_ransac(ransac), m_p1(p1), m_p2(p2), m_seed(seed), m_count(count), m_best(best) {}
+
+      Hypothesis operator()() const {
+        boost::rand48 gen( m_seed );
+        size_t size = m_p1.size();
+        size_t n = m_ransac.m_fitting_func.min_elements_needed_for_fit(m_p1[0]);
+        std::vector<ContainerT1> try1(n);
+        std::vector<ContainerT2> try2(n);
+        boost::scoped_array<int32> random_indices(new int32[n]);
+
+        Hypothesis result;
+        uint32 best = m_best;
+        for (uint32 iteration = 0; iteration < m_count; ++iteration) {
+          // Get n points at random, taking care not to select the
+          // same point twice.
+          _vw_get_n_unique_integers(gen, size, n, random_indices.get());
+          for (size_t i=0; i < n; ++i) {
+            try1[i] = m_p1[random_indices[i]];
+            try2[i] = m_p2[random_indices[i]];
+          }
+
+          // Compute the fit using these samples
+          typename FittingFuncT::result_type H = m_ransac.m_fitting_func(try1, try2);
+
+          // The T(d,d) test
+          bool passed = true;
+          for (int32 i = 0; i < m_ransac.m_pretest_size && passed; ++i) {
+            size_t k = uint32(gen()) % size;
+            passed = m_ransac.m_error_func(H, m_p1[k], m_p2[k]) < m_ransac.m_inlier_threshold;
+          }
+          if (!passed)
+            continue;
+          result.verified++;
+
+          // Compute consensus, stopping once the best can't be beaten.
+          uint32 n_inliers = 0;
+          for (size_t i = 0; i < size; ++i) {
+            if (m_ransac.m_error_func(H, m_p1[i], m_p2[i]) < m_ransac.m_inlier_threshold)
+              ++n_inliers;
+            else if (n_inliers + (size - i - 1) <= best)
+              break;
+          }
+
+          // Keep best consensus
+          if (n_inliers > best) {
+            best = n_inliers;
+            result.inliers = n_inliers;
+            result.H = H;
+          }
+        }
+        return result;
+      }
+    };
+
+    // The number of hypotheses after which a fit with this fraction
+    // of inliers would have been found with the requested confidence.
+    double needed_hypotheses( double inlier_fraction, size_t n ) const {
+      double p_good = std::pow( inlier_fraction, double(n + m_pretest_size) );
+      if ( p_good >= 1.0 )
+        return 1.0;
+      if ( p_good <= 0.0 )
+        return std::numeric_limits<double>::max();
+      double denominator = std::log( 1.0 - p_good );
+      if ( denominator == 0.0 )
+        return std::numeric_limits<double>::max();
+      return std::ceil( std::log( 1.0 - m_confidence ) / denominator );
+    }
     /// \endcond
 
   public:
@@ -163,9 +283,24 @@ namespace math {
       return result;
     }
 
-    RandomSampleConsensus(FittingFuncT const& fitting_func, ErrorFuncT const& error_func, double inlier_threshold)
-      : m_fitting_func(fitting_func), m_error_func(error_func), m_inlier_threshold(inlier_threshold) {}
-
+    /// The search stops once the best fit would have been found with
+    /// probability confidence.  A pretest_size of zero turns off the
+    /// T(d,d) test.
+    RandomSampleConsensus(FittingFuncT const& fitting_func, ErrorFuncT const& error_func, double inlier_threshold,
+                          double confidence = 0.99, int32 pretest_size = 1)
+      : m_fitting_func(fitting_func), m_error_func(error_func), m_inlier_threshold(inlier_threshold),
+        m_confidence(confidence), m_pretest_size(std::max(pretest_size, int32(0))), m_seed(0), m_seeded(false) {}
+
+    /// Seeds the generator of the samples, which is otherwise seeded
+    /// from the clock on each call.  For a given seed the result
+    /// doesn't depend on the number of threads.
+    void set_seed( uint32 seed ) { m_seed = seed; m_seeded = true; }
+
+    /// Fits the data.  Hypotheses are drawn in rounds of 128, and
+    /// rounds stop once ransac_iterations hypotheses (twice the
+    /// number of points for zero) have been scored against the whole
+    /// of it, ten times as many have been drawn, or the confidence
+    /// has been reached.
     template <class ContainerT1, class ContainerT2>
     typename FittingFuncT::result_type operator()(std::vector<ContainerT1> const& p1,
                                                   std::vector<ContainerT2> const& p2,
@@ -188,47 +323,63 @@ namespace math {
       //   2. find a fit for those N points
       //   3. check for consensus
       //   4. keep fit with best consensus so far
+      //   5. stop once that fit is likely enough to be the best
       /////////////////////////////////////////
 
-      // Seed random number generator
-      srandom((uint32) clock());
+      uint32 seed = m_seeded ? m_seed : uint32(std::clock());
 
       // This is a rough value, but it seems to produce reasonably good results.
       if (ransac_iterations == 0)
-        ransac_iterations = p1.size() * 2;
+        ransac_iterations = int32(p1.size() * 2);
 
       size_t n = m_fitting_func.min_elements_needed_for_fit(p1[0]);
-      std::vector<ContainerT1> try1(n);
-      std::vector<ContainerT2> try2(n);
-      boost::scoped_array<int32> random_indices(new int32[n]);
-
-      for (int32 iteration=0; iteration < ransac_iterations; ++iteration) {
-        // Get four points at random, taking care not
-        // to select the same point twice.
-        _vw_get_n_unique_integers(p1.size(), n, random_indices.get());
-
-        for (size_t i=0; i < n; ++i) {
-          try1[i] = p1[random_indices[i]];
-          try2[i] = p2[random_indices[i]];
+      double max_drawn = 10.0 * ransac_iterations;
+
+      // Each round is the same number of batches whatever the number
+      // of threads, and the batches are merged in order.
+      typedef Batch<ContainerT1, ContainerT2> batch_type;
+      const uint32 batch_size = 16, batches_per_round = 8;
+      int num_threads = vw_settings().default_num_threads();
+      boost::scoped_ptr<FifoWorkQueue> queue;
+      if (num_threads > 1)
+        queue.reset( new FifoWorkQueue(num_threads) );
+
+      uint32 round = 0;
+      double drawn = 0, verified = 0, needed = std::numeric_limits<double>::max();
+      while ( verified < ransac_iterations && drawn < max_drawn && drawn < needed ) {
+        std::vector<Hypothesis> results;
+        if (queue) {
+          std::vector<Future<Hypothesis> > futures;
+          for (uint32 b = 0; b < batches_per_round; ++b)
+            futures.push_back( queue->submit( batch_type( *this, p1, p2, seed + round*batches_per_round + b,
+                                                          batch_size, inliers_max ) ) );
+          results = when_all( futures );
+        } else {
+          for (uint32 b = 0; b < batches_per_round; ++b)
+            results.push_back( batch_type( *this, p1, p2, seed + round*batches_per_round + b,
+                                           batch_size, inliers_max )() );
         }
-
-        // Compute the fit using these samples
-        H = m_fitting_func(try1, try2);
-
-        // Compute consensuss
-        unsigned n_inliers = num_inliers(H, p1, p2);
-
-        // Keep best consensus
-        if (n_inliers > inliers_max) {
-          inliers_max = n_inliers;
-          H_max = H;
+        for (uint32 b = 0; b < batches_per_round; ++b) {
+          verified += results[b].verified;
+          if (results[b].inliers > inliers_max) {
+            inliers_max = results[b].inliers;
+            H_max = results[b].H;
+          }
         }
+        drawn += batch_size * batches_per_round;
+        round++;
+        if (inliers_max > 0)
+          needed = needed_hypotheses( double(inliers_max) / double(p1.size()), n );
       }
+      vw_out(DebugMessage, "interest_point") << "RANSAC drew " << drawn << " hypotheses and scored " << verified << ".\n";
 
       if (inliers_max < m_fitting_func.min_elements_needed_for_fit(p1[0])) {
         vw_throw( RANSACErr() << "RANSAC was unable to find a fit that matched the supplied data." );
       }
 
+      std::vector<ContainerT1> try1;
+      std::vector<ContainerT2> try2;
+
       ////////////////////////////////////
       // Second part:
       //    1. find all inliers the best fit
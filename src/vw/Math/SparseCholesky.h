@@ -0,0 +1,558 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SparseCholesky.h
+///
+/// A supernodal, multifrontal Cholesky factorization of sparse
+/// symmetric positive definite matrices, such as the reduced camera
+/// matrix of sparse bundle adjustment.
+///
+/// The matrix is taken to be made of square blocks (one per camera
+/// in bundle adjustment), and all of the symbolic work is done on the
+/// blocks.  The blocks are ordered by minimum degree to limit fill,
+/// the columns of the factor that share a structure are grouped into
+/// supernodes, and each supernode is factored as one dense frontal
+/// matrix.  Supernodes in independent subtrees of the elimination
+/// tree are factored at the same time on different threads.  Near
+/// the root, where there are too few of them to go around, the dense
+/// update of each front is split among the threads instead.  The
+/// result doesn't depend on the number of threads.
+///
+#ifndef __VW_MATH_SPARSECHOLESKY_H__
+#define __VW_MATH_SPARSECHOLESKY_H__
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+namespace vw {
+namespace math {
+
+  /// Orders the nodes of an undirected graph for elimination by
+  /// minimum degree, with ties going to the lower numbered node.
+  /// adjacency[i] lists the neighbors of node i, and must be
+  /// symmetric.  If structure is given, (*structure)[i] is set to the
+  /// neighbors node i had when it was eliminated, which is the
+  /// structure of its column of the Cholesky factor.
+  inline std::vector<size_t>
+  minimum_degree_ordering( std::vector<std::vector<size_t> > adjacency,
+                           std::vector<std::vector<size_t> >* structure = 0 ) {
+    size_t n = adjacency.size();
+    typedef std::set<std::pair<size_t, size_t> > queue_type;
+    queue_type queue;
+    for ( size_t i = 0; i < n; i++ ) {
+      std::vector<size_t>& adj = adjacency[i];
+      std::sort( adj.begin(), adj.end() );
+      adj.erase( std::unique( adj.begin(), adj.end() ), adj.end() );
+      adj.erase( std::remove( adj.begin(), adj.end(), i ), adj.end() );
+      queue.insert( std::make_pair( adj.size(), i ) );
+    }
+    if ( structure )
+      structure->assign( n, std::vector<size_t>() );
+
+    // The graph is kept as the elimination graph: eliminating a node
+    // joins its neighbors into a clique and removes it.
+    std::vector<size_t> order, merged;
+    order.reserve( n );
+    while ( !queue.empty() ) {
+      size_t v = queue.begin()->second;
+      queue.erase( queue.begin() );
+      order.push_back( v );
+      std::vector<size_t>& nv = adjacency[v];
+      for ( size_t k = 0; k < nv.size(); k++ ) {
+        size_t u = nv[k];
+        std::vector<size_t>& nu = adjacency[u];
+        queue.erase( std::make_pair( nu.size(), u ) );
+        merged.clear();
+        std::set_union( nu.begin(), nu.end(), nv.begin(), nv.end(), std::back_inserter( merged ) );
+        nu.clear();
+        for ( size_t i = 0; i < merged.size(); i++ )
+          if ( merged[i] != u && merged[i] != v )
+            nu.push_back( merged[i] );
+        queue.insert( std::make_pair( nu.size(), u ) );
+      }
+      if ( structure )
+        (*structure)[v].swap( nv );
+      std::vector<size_t>().swap( nv );
+    }
+    return order;
+  }
+
+  /// The Cholesky factorization A = L*L^T of a sparse symmetric
+  /// positive definite matrix, made of num_blocks by num_blocks
+  /// square blocks of block_size elements.  The structure is worked
+  /// out once, on construction, and then any number of matrices with
+  /// that structure can be factored and solved.
+  template <class ElemT = double>
+  class SparseCholesky {
+  public:
+    typedef ElemT value_type;
+
+    /// Works out the ordering and the structure of the factor for
+    /// matrices whose blocks off the diagonal are zero except for
+    /// those listed in blocks, as (row,col) pairs of block indices.
+    /// Only one of (i,j) and (j,i) need be listed.  The diagonal
+    /// blocks are always taken to be nonzero.
+    SparseCholesky( size_t num_blocks, size_t block_size,
+                    std::vector<std::pair<size_t, size_t> > const& blocks )
+      : m_num_blocks(num_blocks), m_block_size(block_size), m_factored(false) {
+      VW_ASSERT( block_size > 0, ArgumentErr() << "SparseCholesky: block size must be positive." );
+      m_adjacency.resize( num_blocks );
+      for ( size_t i = 0; i < blocks.size(); i++ ) {
+        size_t r = blocks[i].first, c = blocks[i].second;
+        VW_ASSERT( r < num_blocks && c < num_blocks,
+                   ArgumentErr() << "SparseCholesky: block (" << r << "," << c << ") is outside the matrix." );
+        if ( r == c )
+          continue;
+        m_adjacency[r].push_back( c );
+        m_adjacency[c].push_back( r );
+      }
+      for ( size_t i = 0; i < num_blocks; i++ ) {
+        std::sort( m_adjacency[i].begin(), m_adjacency[i].end() );
+        m_adjacency[i].erase( std::unique( m_adjacency[i].begin(), m_adjacency[i].end() ),
+                              m_adjacency[i].end() );
+      }
+      analyze();
+    }
+
+    size_t rows() const { return m_num_blocks * m_block_size; }
+    size_t cols() const { return m_num_blocks * m_block_size; }
+    size_t num_blocks() const { return m_num_blocks; }
+    size_t block_size() const { return m_block_size; }
+
+    /// The blocks, in the order they are eliminated.
+    std::vector<size_t> const& ordering() const { return m_order; }
+
+    size_t num_supernodes() const { return m_supernodes.size(); }
+
+    /// The number of elements of L on and below its diagonal that
+    /// are stored.
+    size_t factor_size() const {
+      size_t size = 0;
+      for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+        size_t p = m_supernodes[s].width() * m_block_size, m = m_supernodes[s].index.size();
+        size += p*(p+1)/2 + (m-p)*p;
+      }
+      return size;
+    }
+
+    /// Factors A, which must have the structure given on
+    /// construction.  Only the elements A(i,j), i >= j, of the
+    /// diagonal and listed blocks are read.  Throws MathErr if A
+    /// isn't positive definite.  Uses vw_settings().default_num_threads()
+    /// threads.
+    template <class MatrixT>
+    void factor( MatrixBase<MatrixT> const& A ) {
+      VW_ASSERT( A.impl().rows() == rows() && A.impl().cols() == cols(),
+                 ArgumentErr() << "SparseCholesky: matrix must be " << rows() << "x" << cols() << "." );
+      m_factored = false;
+      for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+        m_supernodes[s].failed = false;
+        std::vector<ElemT>().swap( m_supernodes[s].update );
+      }
+
+      size_t num_threads = vw_settings().default_num_threads();
+      boost::scoped_ptr<FifoWorkQueue> queue;
+      if ( num_threads > 1 )
+        queue.reset( new FifoWorkQueue( int(num_threads) ) );
+
+      // A level is only started once every front below it is done.
+      // Levels with enough supernodes to go around are factored a
+      // supernode to a thread, and the others a supernode at a time
+      // with the threads sharing its dense update.
+      for ( size_t l = 0; l < m_levels.size(); l++ ) {
+        std::vector<size_t> const& level = m_levels[l];
+        if ( queue && level.size() >= num_threads ) {
+          std::vector<Future<void> > futures;
+          for ( size_t i = 0; i < level.size(); i++ )
+            futures.push_back( queue->submit( FactorTask<MatrixT>( *this, A.impl(), level[i] ) ) );
+          when_all( futures );
+        } else {
+          for ( size_t i = 0; i < level.size(); i++ )
+            factor_supernode( A.impl(), level[i], queue.get(), num_threads );
+        }
+        for ( size_t i = 0; i < level.size(); i++ )
+          if ( m_supernodes[level[i]].failed )
+            vw_throw( MathErr() << "SparseCholesky: matrix is not positive definite." );
+      }
+      m_factored = true;
+    }
+
+    /// Solves A*x = b with the last factorization.
+    template <class VectorT>
+    Vector<ElemT> solve( VectorBase<VectorT> const& b ) const {
+      VW_ASSERT( m_factored, LogicErr() << "SparseCholesky: solve called before factor." );
+      VW_ASSERT( b.impl().size() == rows(),
+                 ArgumentErr() << "SparseCholesky: vector must have " << rows() << " elements." );
+      size_t bs = m_block_size;
+      std::vector<ElemT> y( rows() );
+      for ( size_t k = 0; k < m_num_blocks; k++ )
+        for ( size_t e = 0; e < bs; e++ )
+          y[k*bs+e] = b.impl()( m_order[k]*bs + e );
+      solve_in_place( y );
+      Vector<ElemT> x( rows() );
+      for ( size_t k = 0; k < m_num_blocks; k++ )
+        for ( size_t e = 0; e < bs; e++ )
+          x( m_order[k]*bs + e ) = y[k*bs+e];
+      return x;
+    }
+
+    /// Solves A*X = B with the last factorization, a column at a time.
+    template <class MatrixT>
+    Matrix<ElemT> solve( MatrixBase<MatrixT> const& B ) const {
+      VW_ASSERT( B.impl().rows() == rows(),
+                 ArgumentErr() << "SparseCholesky: matrix must have " << rows() << " rows." );
+      Matrix<ElemT> X( B.impl().rows(), B.impl().cols() );
+      for ( size_t j = 0; j < X.cols(); j++ )
+        select_col( X, j ) = solve( select_col( B.impl(), j ) );
+      return X;
+    }
+
+  private:
+    // A run of columns of L with the same structure below them.
+    // Every index below is in elimination order.
+    struct Supernode {
+      size_t first, last;               // its block columns, [first,last)
+      std::vector<size_t> rows;         // the blocks of L below them
+      size_t parent;                    // or npos for a root
+      std::vector<size_t> children;
+      std::vector<size_t> index;        // the element row of each row of its front
+
+      // After factoring: its columns of L, row-major, index.size() by
+      // width()*block_size; and the update its front passes to the
+      // parent, the lower triangle of a row-major square of the rows
+      // below them.
+      std::vector<ElemT> L, update;
+      bool failed;
+
+      size_t width() const { return last - first; }
+    };
+
+    static size_t npos() { return size_t(-1); }
+
+    size_t m_num_blocks, m_block_size;
+    std::vector<std::vector<size_t> > m_adjacency;
+    std::vector<size_t> m_order, m_position;
+    std::vector<Supernode> m_supernodes;
+    std::vector<std::vector<size_t> > m_levels;
+    bool m_factored;
+
+    template <class MatrixT>
+    struct FactorTask {
+      typedef void result_type;
+      SparseCholesky& self;
+      MatrixT const& A;
+      size_t s;
+      FactorTask( SparseCholesky& self, MatrixT const& A, size_t s ) : self(self), A(A), s(s) {}
+      void operator()() const { self.factor_supernode( A, s, 0, 1 ); }
+    };
+
+    // Rows [begin,end) of one of the two parallel steps of
+    // partial_factor().
+    struct RowsTask {
+      typedef void result_type;
+      ElemT* F;
+      size_t m, p, begin, end;
+      bool schur;
+      RowsTask( ElemT* F, size_t m, size_t p, size_t begin, size_t end, bool schur )
+        : F(F), m(m), p(p), begin(begin), end(end), schur(schur) {}
+      void operator()() const {
+        if ( schur )
+          schur_rows( F, m, p, begin, end );
+        else
+          panel_rows( F, m, p, begin, end );
+      }
+    };
+
+    static ElemT dot( ElemT const* a, ElemT const* b, size_t n ) {
+      ElemT sum = ElemT();
+      for ( size_t k = 0; k < n; k++ )
+        sum += a[k] * b[k];
+      return sum;
+    }
+
+    // Rows [begin,end) of L21 = F21*inverse(L11)^T, in place.
+    static void panel_rows( ElemT* F, size_t m, size_t p, size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        ElemT* fi = F + i*m;
+        for ( size_t j = 0; j < p; j++ )
+          fi[j] = ( fi[j] - dot( fi, F + j*m, j ) ) / F[j*m+j];
+      }
+    }
+
+    // Rows [begin,end) of the Schur complement F22 - L21*L21^T, in
+    // place, lower triangle.
+    static void schur_rows( ElemT* F, size_t m, size_t p, size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        ElemT* fi = F + i*m;
+        for ( size_t j = p; j <= i; j++ )
+          fi[j] -= dot( fi, F + j*m, p );
+      }
+    }
+
+    // Factors the leading p columns of the m by m front F, leaving
+    // L in them and the Schur complement in the rest.  Returns false
+    // if a pivot isn't positive.
+    static bool partial_factor( ElemT* F, size_t m, size_t p, FifoWorkQueue* queue, size_t num_threads ) {
+      for ( size_t i = 0; i < p; i++ ) {
+        ElemT* fi = F + i*m;
+        for ( size_t j = 0; j < i; j++ )
+          fi[j] = ( fi[j] - dot( fi, F + j*m, j ) ) / F[j*m+j];
+        ElemT d = fi[i] - dot( fi, fi, i );
+        if ( !( d > 0 ) )
+          return false;
+        fi[i] = std::sqrt( d );
+      }
+
+      // Fronts too small to be worth sharing are done in place.
+      size_t n = m - p;
+      if ( !queue || num_threads < 2 || n * n * p < (size_t(1) << 18) ) {
+        panel_rows( F, m, p, p, m );
+        schur_rows( F, m, p, p, m );
+        return true;
+      }
+
+      // The panel rows all cost the same; the Schur rows grow
+      // longer, so they're split into chunks of equal area.
+      size_t chunks = 4 * num_threads;
+      std::vector<Future<void> > futures;
+      for ( size_t c = 0; c < chunks; c++ )
+        futures.push_back( queue->submit( RowsTask( F, m, p, p + n*c/chunks, p + n*(c+1)/chunks, false ) ) );
+      when_all( futures );
+      futures.clear();
+      size_t begin = p;
+      for ( size_t c = 1; c <= chunks; c++ ) {
+        size_t end = c == chunks ? m : p + size_t( double(n) * std::sqrt( double(c) / double(chunks) ) );
+        if ( end > begin )
+          futures.push_back( queue->submit( RowsTask( F, m, p, begin, end, true ) ) );
+        begin = std::max( begin, end );
+      }
+      when_all( futures );
+      return true;
+    }
+
+    // The row of the front of supernode s that holds block k.
+    size_t front_block( Supernode const& sn, size_t k ) const {
+      if ( k < sn.last )
+        return k - sn.first;
+      return sn.width() + size_t( std::lower_bound( sn.rows.begin(), sn.rows.end(), k ) - sn.rows.begin() );
+    }
+
+    template <class MatrixT>
+    void factor_supernode( MatrixT const& A, size_t s, FifoWorkQueue* queue, size_t num_threads ) {
+      Supernode& sn = m_supernodes[s];
+      size_t bs = m_block_size, m = sn.index.size(), p = sn.width() * bs;
+      std::vector<ElemT> F( m * m, ElemT() );
+
+      // The elements of A in the front's columns.
+      for ( size_t c = sn.first; c < sn.last; c++ ) {
+        size_t J = m_order[c], fc = (c - sn.first) * bs;
+        for ( size_t jj = 0; jj < bs; jj++ )
+          for ( size_t ii = jj; ii < bs; ii++ )
+            F[(fc+ii)*m + fc+jj] = A( J*bs+ii, J*bs+jj );
+        std::vector<size_t> const& adj = m_adjacency[J];
+        for ( size_t a = 0; a < adj.size(); a++ ) {
+          size_t k = m_position[adj[a]];
+          if ( k < c )
+            continue;
+          size_t I = adj[a], fr = front_block( sn, k ) * bs;
+          for ( size_t ii = 0; ii < bs; ii++ )
+            for ( size_t jj = 0; jj < bs; jj++ )
+              F[(fr+ii)*m + fc+jj] = A( I*bs+ii, J*bs+jj );
+        }
+      }
+
+      // The children's updates, whose rows all lie in this front.
+      for ( size_t ci = 0; ci < sn.children.size(); ci++ ) {
+        Supernode& child = m_supernodes[sn.children[ci]];
+        size_t n = child.rows.size() * bs;
+        std::vector<size_t> rel( n );
+        for ( size_t r = 0; r < child.rows.size(); r++ ) {
+          size_t fr = front_block( sn, child.rows[r] ) * bs;
+          for ( size_t e = 0; e < bs; e++ )
+            rel[r*bs+e] = fr + e;
+        }
+        ElemT const* U = child.update.empty() ? 0 : &child.update[0];
+        for ( size_t i = 0; i < n; i++ )
+          for ( size_t j = 0; j <= i; j++ )
+            F[rel[i]*m + rel[j]] += U[i*n+j];
+        std::vector<ElemT>().swap( child.update );
+      }
+
+      if ( !partial_factor( &F[0], m, p, queue, num_threads ) ) {
+        sn.failed = true;
+        return;
+      }
+
+      sn.L.resize( m * p );
+      for ( size_t i = 0; i < m; i++ )
+        std::copy( &F[i*m], &F[i*m] + p, &sn.L[i*p] );
+      size_t n = m - p;
+      if ( sn.parent != npos() ) {
+        sn.update.resize( n * n );
+        for ( size_t i = 0; i < n; i++ )
+          std::copy( &F[(p+i)*m + p], &F[(p+i)*m + p] + i + 1, &sn.update[i*n] );
+      }
+    }
+
+    // Solves L*L^T*x = y in elimination order, in place.
+    void solve_in_place( std::vector<ElemT>& y ) const {
+      std::vector<ElemT> x;
+      for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+        Supernode const& sn = m_supernodes[s];
+        size_t m = sn.index.size(), p = sn.width() * m_block_size;
+        x.resize( p );
+        for ( size_t i = 0; i < p; i++ ) {
+          ElemT const* li = &sn.L[i*p];
+          x[i] = ( y[sn.index[i]] - dot( li, &x[0], i ) ) / li[i];
+          y[sn.index[i]] = x[i];
+        }
+        for ( size_t i = p; i < m; i++ )
+          y[sn.index[i]] -= dot( &sn.L[i*p], &x[0], p );
+      }
+      for ( size_t s = m_supernodes.size(); s-- > 0; ) {
+        Supernode const& sn = m_supernodes[s];
+        size_t m = sn.index.size(), p = sn.width() * m_block_size;
+        x.assign( p, ElemT() );
+        for ( size_t i = p; i < m; i++ ) {
+          ElemT const* li = &sn.L[i*p];
+          ElemT yi = y[sn.index[i]];
+          for ( size_t j = 0; j < p; j++ )
+            x[j] += li[j] * yi;
+        }
+        for ( size_t j = p; j-- > 0; ) {
+          ElemT const* lj = &sn.L[j*p];
+          ElemT v = ( y[sn.index[j]] - x[j] ) / lj[j];
+          y[sn.index[j]] = v;
+          for ( size_t k = 0; k < j; k++ )
+            x[k] += lj[k] * v;
+        }
+      }
+    }
+
+    void analyze() {
+      size_t nb = m_num_blocks;
+      std::vector<std::vector<size_t> > structure;
+      std::vector<size_t> order = minimum_degree_ordering( m_adjacency, &structure );
+
+      // The elimination tree, in the minimum degree order.
+      std::vector<size_t> position( nb ), parent( nb, npos() );
+      for ( size_t k = 0; k < nb; k++ )
+        position[order[k]] = k;
+      for ( size_t k = 0; k < nb; k++ ) {
+        std::vector<size_t>& st = structure[order[k]];
+        for ( size_t i = 0; i < st.size(); i++ )
+          st[i] = position[st[i]];
+        std::sort( st.begin(), st.end() );
+        if ( !st.empty() )
+          parent[k] = st[0];
+      }
+
+      // Renumbering the columns in a postorder of the tree keeps the
+      // fill and makes each supernode a run of columns.
+      std::vector<std::vector<size_t> > kids( nb );
+      std::vector<size_t> roots;
+      for ( size_t k = 0; k < nb; k++ ) {
+        if ( parent[k] == npos() )
+          roots.push_back( k );
+        else
+          kids[parent[k]].push_back( k );
+      }
+      std::vector<size_t> post( nb ), stack;
+      size_t next = 0;
+      for ( size_t r = roots.size(); r-- > 0; ) {
+        stack.push_back( roots[r] );
+        std::vector<size_t> visit;
+        while ( !stack.empty() ) {
+          size_t k = stack.back();
+          stack.pop_back();
+          visit.push_back( k );
+          for ( size_t c = 0; c < kids[k].size(); c++ )
+            stack.push_back( kids[k][c] );
+        }
+        // visit is a preorder with the children in reverse, so
+        // backwards it's a postorder.
+        for ( size_t v = visit.size(); v-- > 0; )
+          post[visit[v]] = next++;
+      }
+
+      m_order.resize( nb );
+      m_position.resize( nb );
+      std::vector<std::vector<size_t> > col_structure( nb );
+      std::vector<size_t> col_parent( nb, npos() ), num_kids( nb, 0 );
+      for ( size_t k = 0; k < nb; k++ ) {
+        size_t c = post[k];
+        m_order[c] = order[k];
+        m_position[order[k]] = c;
+        std::vector<size_t>& st = col_structure[c];
+        st.swap( structure[order[k]] );
+        for ( size_t i = 0; i < st.size(); i++ )
+          st[i] = post[st[i]];
+        std::sort( st.begin(), st.end() );
+        if ( parent[k] != npos() ) {
+          col_parent[c] = post[parent[k]];
+          num_kids[col_parent[c]]++;
+        }
+      }
+
+      // Fundamental supernodes: a column joins the one before it if
+      // it is that column's parent and only child, and its structure
+      // is that column's less itself.
+      m_supernodes.clear();
+      std::vector<size_t> supernode_of( nb );
+      for ( size_t c = 0; c < nb; c++ ) {
+        if ( c > 0 && col_parent[c-1] == c && num_kids[c] == 1 &&
+             col_structure[c-1].size() == col_structure[c].size() + 1 ) {
+          m_supernodes.back().last = c + 1;
+        } else {
+          m_supernodes.push_back( Supernode() );
+          m_supernodes.back().first = c;
+          m_supernodes.back().last = c + 1;
+        }
+        supernode_of[c] = m_supernodes.size() - 1;
+      }
+
+      size_t bs = m_block_size;
+      std::vector<size_t> height( m_supernodes.size(), 0 );
+      size_t max_height = 0;
+      for ( size_t s = 0; s < m_supernodes.size(); s++ ) {
+        Supernode& sn = m_supernodes[s];
+        sn.rows = col_structure[sn.last-1];
+        sn.parent = sn.rows.empty() ? npos() : supernode_of[sn.rows[0]];
+        sn.failed = false;
+        for ( size_t c = sn.first; c < sn.last; c++ )
+          for ( size_t e = 0; e < bs; e++ )
+            sn.index.push_back( c*bs + e );
+        for ( size_t r = 0; r < sn.rows.size(); r++ )
+          for ( size_t e = 0; e < bs; e++ )
+            sn.index.push_back( sn.rows[r]*bs + e );
+        // Children come before their parent in postorder.
+        if ( sn.parent != npos() ) {
+          m_supernodes[sn.parent].children.push_back( s );
+          height[sn.parent] = std::max( height[sn.parent], height[s] + 1 );
+        }
+        max_height = std::max( max_height, height[s] );
+      }
+      m_levels.assign( m_supernodes.empty() ? 0 : max_height + 1, std::vector<size_t>() );
+      for ( size_t s = 0; s < m_supernodes.size(); s++ )
+        m_levels[height[s]].push_back( s );
+    }
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_SPARSECHOLESKY_H__
@@ -1478,6 +1478,44 @@ namespace math {
   }
 
 
+  // *******************************************************************
+  // Kernels for small fixed-size vectors.
+  // *******************************************************************
+
+  // Vectors and matrices of two to four floating point elements on a
+  // side are the inner loops of cameras, transforms and bundle
+  // adjustment.  Their products, norms and the like are overloaded
+  // below to be computed directly from the elements, rather than
+  // through the expression templates.  Sums are taken in the same
+  // order as in the general code, so results don't depend on which
+  // path computed them.
+  namespace detail {
+
+    template <class ElemT, size_t SizeN>
+    struct IsSmallVector {
+      const static bool value = boost::is_floating_point<ElemT>::value && (SizeN >= 2) && (SizeN <= 4);
+    };
+
+    template <class ElemT, size_t SizeN, class ResultT>
+    struct EnableIfSmallVector
+      : boost::enable_if_c<IsSmallVector<ElemT,SizeN>::value, ResultT> {};
+
+    /// The dot product of SizeN (two to four) elements of a and of
+    /// b, the latter taken stride elements apart.
+    template <size_t SizeN, class ElemT>
+    inline ElemT small_dot( ElemT const* a, ElemT const* b, size_t stride = 1 ) {
+      BOOST_STATIC_ASSERT( SizeN >= 2 && SizeN <= 4 );
+      ElemT result = ElemT();
+      result += a[0] * b[0];
+      result += a[1] * b[stride];
+      if ( SizeN > 2 ) result += a[2] * b[2*stride];
+      if ( SizeN > 3 ) result += a[3] * b[3*stride];
+      return result;
+    }
+
+  } // namespace detail
+
+
   // *******************************************************************
   // Vector norms and similar functions.
   // *******************************************************************
@@ -1500,10 +1538,17 @@ namespace math {
     return static_cast<typename VectorT::value_type>(result);
   }
 
+  /// Square of vector 2-norm, for small fixed-size vectors.
+  template <size_t SizeN>
+  typename detail::EnableIfSmallVector<double, SizeN, double>::type
+  inline norm_2_sqr( Vector<double,SizeN> const& v ) {
+    return detail::small_dot<SizeN>( &v[0], &v[0] );
+  }
+
   /// Vector 2-norm
   template <class VectorT>
   inline double norm_2( VectorBase<VectorT> const& v ) {
-    return sqrt( norm_2_sqr(v) );
+    return sqrt( norm_2_sqr(v.impl()) );
   }
 
   /// Vector infinity-norm
@@ -1628,6 +1673,13 @@ namespace math {
     return result;
   }
 
+  /// Vector dot product, for small fixed-size vectors.
+  template <class ElemT, size_t SizeN>
+  typename detail::EnableIfSmallVector<ElemT, SizeN, ElemT>::type
+  inline dot_prod( Vector<ElemT,SizeN> const& v1, Vector<ElemT,SizeN> const& v2 ) {
+    return detail::small_dot<SizeN>( &v1[0], &v2[0] );
+  }
+
   /// Vector inner product via transpose
   template <class Vector1T, class Vector2T>
   typename ProductType<typename Vector1T::value_type, typename Vector2T::value_type>::type
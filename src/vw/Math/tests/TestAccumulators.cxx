@@ -87,3 +87,60 @@ TEST(Accumulators, Median) {
 
   EXPECT_NEAR( median.value(), 35.0, 1.5 );
 }
+
+TEST(Accumulators, Quantile) {
+  boost::mt19937 random_gen(42);
+  boost::uniform_real<double> uniform(0,1000);
+  boost::variate_generator<boost::mt19937&,
+    boost::uniform_real<double> > generator(random_gen, uniform);
+
+  // Feed the same stream to one sketch and, in pieces, to several
+  // that get merged.
+  QuantileAccumulator<double> whole;
+  std::vector<QuantileAccumulator<double> > parts(7);
+  for ( uint32 i = 0; i < 200000; i++ ) {
+    double v = generator();
+    whole( v );
+    parts[i%7]( v );
+  }
+  for ( size_t i = 1; i < parts.size(); i++ )
+    parts[0].merge( parts[i] );
+
+  EXPECT_EQ( whole.num_samples(), 200000u );
+  EXPECT_EQ( parts[0].num_samples(), 200000u );
+  for ( double q = 0.05; q < 1; q += 0.1 ) {
+    EXPECT_NEAR( whole.quantile(q), 1000*q, 10 );
+    EXPECT_NEAR( parts[0].quantile(q), 1000*q, 10 );
+  }
+  EXPECT_NEAR( whole.median(), 500, 10 );
+  EXPECT_GE( whole.quantile(0), 0 );
+  EXPECT_LE( whole.quantile(1), 1000 );
+
+  QuantileAccumulator<double> empty;
+  ASSERT_THROW( empty.quantile(0.5), ArgumentErr );
+}
+
+TEST(Accumulators, Histogram) {
+  HistogramAccumulator<uint8> hist, other;
+  for ( uint32 i = 0; i < 100; i++ )
+    hist( uint8(i) );
+  for ( uint32 i = 100; i < 200; i++ )
+    other( uint8(i) );
+  EXPECT_EQ( hist.quantile(0.5), 49 );
+  hist.merge( other );
+  EXPECT_EQ( hist.num_samples(), 200u );
+  EXPECT_EQ( hist.count(150), 1u );
+  EXPECT_EQ( hist.quantile(0), 0 );
+  EXPECT_EQ( hist.quantile(0.5), 99 );
+  EXPECT_EQ( hist.quantile(1), 199 );
+
+  // Values outside the range go in the end bins
+  HistogramAccumulator<int16> clamped(-10,10);
+  clamped( -100 );
+  clamped( 0 );
+  clamped( 100 );
+  EXPECT_EQ( clamped.count(-10), 1u );
+  EXPECT_EQ( clamped.count(10), 1u );
+  EXPECT_EQ( clamped.bins().size(), 21u );
+  ASSERT_THROW( hist.merge( HistogramAccumulator<uint8>(0,100) ), ArgumentErr );
+}
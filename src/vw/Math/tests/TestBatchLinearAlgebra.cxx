@@ -0,0 +1,140 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/BatchLinearAlgebra.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_01.hpp>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+  template <size_t M, size_t N>
+  Matrix<double,M,N> random_matrix( boost::uniform_01<boost::rand48>& uniform ) {
+    Matrix<double,M,N> A;
+    for ( size_t i = 0; i < M; i++ )
+      for ( size_t j = 0; j < N; j++ )
+        A(i,j) = uniform() - 0.5;
+    return A;
+  }
+}
+
+TEST(BatchLinearAlgebra, Solve) {
+  boost::rand48 gen( 1 );
+  boost::uniform_01<boost::rand48> uniform( gen );
+  Matrix3x3 A = random_matrix<3,3>( uniform );
+  Vector3 x( 1, -2, 3 ), b = A*x;
+  Matrix3x3 LU = A;
+  ASSERT_TRUE( solve_in_place( LU, b ) );
+  EXPECT_VECTOR_NEAR( x, b, 1e-12 );
+
+  Matrix3x3 inv = A;
+  ASSERT_TRUE( inverse_in_place( inv ) );
+  EXPECT_MATRIX_NEAR( inverse( A ), inv, 1e-12 );
+
+  // Singular systems are left alone.
+  Matrix3x3 S( 1, 2, 3, 2, 4, 6, 0, 1, 1 ), T = S;
+  Vector3 c( 1, 1, 1 );
+  EXPECT_FALSE( solve_in_place( T, c ) );
+  EXPECT_VECTOR_EQ( Vector3( 1, 1, 1 ), c );
+  T = S;
+  EXPECT_FALSE( inverse_in_place( T ) );
+  EXPECT_MATRIX_EQ( S, T );
+}
+
+TEST(BatchLinearAlgebra, SymmetricInverse) {
+  boost::rand48 gen( 2 );
+  boost::uniform_01<boost::rand48> uniform( gen );
+  Matrix<double,4,4> B = random_matrix<4,4>( uniform );
+  Matrix<double,4,4> A = B * transpose( B ), inv = A;
+  for ( size_t i = 0; i < 4; i++ )
+    A(i,i) += 1;
+  inv = A;
+  ASSERT_TRUE( symmetric_inverse_in_place( inv ) );
+  EXPECT_MATRIX_NEAR( inverse( A ), inv, 1e-12 );
+
+  Matrix2x2 indefinite( 1, 2, 2, 1 ), copy = indefinite;
+  EXPECT_FALSE( symmetric_inverse_in_place( copy ) );
+  EXPECT_MATRIX_EQ( indefinite, copy );
+}
+
+TEST(BatchLinearAlgebra, SVD) {
+  boost::rand48 gen( 3 );
+  boost::uniform_01<boost::rand48> uniform( gen );
+  Matrix<double,4,3> A = random_matrix<4,3>( uniform ), U = A;
+  Vector3 s;
+  Matrix3x3 VT;
+  svd_in_place( U, s, VT );
+
+  EXPECT_GE( s(0), s(1) );
+  EXPECT_GE( s(1), s(2) );
+  Matrix<double,4,3> US = U;
+  for ( size_t j = 0; j < 3; j++ )
+    select_col( US, j ) *= s(j);
+  EXPECT_MATRIX_NEAR( A, US * VT, 1e-12 );
+  EXPECT_MATRIX_NEAR( identity_matrix<3>(), transpose(U) * U, 1e-12 );
+  EXPECT_MATRIX_NEAR( identity_matrix<3>(), VT * transpose(VT), 1e-12 );
+
+  // A rank deficient matrix has zero singular values.
+  Matrix3x3 R( 1, 2, 3, 2, 4, 6, 3, 6, 9 );
+  svd_in_place( R, s, VT );
+  EXPECT_NEAR( 14, s(0), 1e-12 );
+  EXPECT_NEAR( 0, s(1), 1e-12 );
+  EXPECT_NEAR( 0, s(2), 1e-12 );
+}
+
+TEST(BatchLinearAlgebra, Batch) {
+  boost::rand48 gen( 4 );
+  boost::uniform_01<boost::rand48> uniform( gen );
+  std::vector<Matrix3x3> A( 5000 );
+  std::vector<Vector3> b( A.size() );
+  for ( size_t i = 0; i < A.size(); i++ ) {
+    A[i] = random_matrix<3,3>( uniform );
+    b[i] = Vector3( uniform(), uniform(), uniform() );
+  }
+  A[17] = Matrix3x3();
+
+  // Running in parallel gives the same results.
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 4 );
+  std::vector<Matrix3x3> serial = A, parallel = A;
+  EXPECT_EQ( 1u, batch_inverse( serial ) );
+  EXPECT_EQ( 1u, batch_inverse( parallel, true ) );
+  for ( size_t i = 0; i < A.size(); i++ )
+    EXPECT_MATRIX_EQ( serial[i], parallel[i] );
+
+  std::vector<Matrix3x3> LU = A;
+  std::vector<Vector3> x = b;
+  EXPECT_EQ( 1u, batch_solve( LU, x, true ) );
+  for ( size_t i = 0; i < A.size(); i++ ) {
+    if ( i != 17 ) {
+      EXPECT_VECTOR_NEAR( b[i], A[i] * x[i], 1e-9 );
+    }
+  }
+
+  std::vector<Matrix3x3> U = A, VT;
+  std::vector<Vector3> s;
+  batch_svd( U, s, VT, true );
+  vw_settings().set_default_num_threads( threads );
+  ASSERT_EQ( A.size(), s.size() );
+  for ( size_t i = 0; i < A.size(); i += 100 ) {
+    Matrix3x3 US = U[i];
+    for ( size_t j = 0; j < 3; j++ )
+      select_col( US, j ) *= s[i](j);
+    EXPECT_MATRIX_NEAR( A[i], US * VT[i], 1e-12 );
+  }
+
+  std::vector<Matrix3x3> spd( 3 );
+  for ( size_t i = 0; i < spd.size(); i++ )
+    spd[i] = A[i] * transpose( A[i] ) + identity_matrix<3>();
+  spd[1](0,0) = -1;
+  EXPECT_EQ( 1u, batch_symmetric_inverse( spd ) );
+}
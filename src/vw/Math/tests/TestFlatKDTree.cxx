@@ -0,0 +1,194 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <gtest/gtest.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/FlatKDTree.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_01.hpp>
+
+using std::vector;
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+  vector<float> random_points( size_t count, size_t dims, int seed ) {
+    boost::rand48 gen( seed );
+    boost::uniform_01<boost::rand48> uniform( gen );
+    vector<float> points( count*dims );
+    for ( size_t i = 0; i < points.size(); i++ )
+      points[i] = float( uniform() );
+    return points;
+  }
+
+  // The squared distances of the nearest knn points, by brute force.
+  vector<float> nearest( vector<float> const& points, size_t dims,
+                         float const* query, size_t knn ) {
+    vector<float> dists;
+    for ( size_t i = 0; i < points.size() / dims; i++ ) {
+      float dist = 0;
+      for ( size_t d = 0; d < dims; d++ )
+        dist += (points[i*dims+d] - query[d])*(points[i*dims+d] - query[d]);
+      dists.push_back( dist );
+    }
+    std::sort( dists.begin(), dists.end() );
+    dists.resize( std::min( knn, dists.size() ) );
+    return dists;
+  }
+}
+
+TEST(FlatKDTree, Exact) {
+  const size_t dims = 8, count = 2000, knn = 3;
+  vector<float> points = random_points( count, dims, 4 );
+  vector<float> queries = random_points( 50, dims, 5 );
+  FlatKDTree<float> tree( &points[0], count, dims, 7 );
+  EXPECT_EQ( count, tree.size() );
+  EXPECT_EQ( dims, tree.dims() );
+
+  for ( size_t q = 0; q < 50; q++ ) {
+    float const* query = &queries[q*dims];
+    int32 indices[knn];
+    float dists[knn];
+    ASSERT_EQ( knn, tree.knn_search( query, knn, indices, dists ) );
+    vector<float> expected = nearest( points, dims, query, knn );
+    for ( size_t k = 0; k < knn; k++ ) {
+      EXPECT_FLOAT_EQ( expected[k], dists[k] );
+      float dist = 0;
+      for ( size_t d = 0; d < dims; d++ )
+        dist += (points[indices[k]*dims+d] - query[d])*(points[indices[k]*dims+d] - query[d]);
+      EXPECT_FLOAT_EQ( dist, dists[k] );
+    }
+  }
+
+  // A point of the tree finds itself.
+  int32 index;
+  float dist;
+  ASSERT_EQ( 1u, tree.knn_search( &points[123*dims], 1, &index, &dist ) );
+  EXPECT_EQ( 123, index );
+  EXPECT_EQ( 0, dist );
+}
+
+TEST(FlatKDTree, Approximate) {
+  const size_t dims = 32, count = 3000;
+  vector<float> points = random_points( count, dims, 6 );
+  FlatKDTree<float> tree( &points[0], count, dims );
+
+  // Slightly moved copies of the points are found again from a few
+  // checks, and with enough checks the search is exact.
+  size_t found = 0;
+  for ( size_t q = 0; q < 100; q++ ) {
+    vector<float> query( &points[q*30*dims], &points[q*30*dims] + dims );
+    for ( size_t d = 0; d < dims; d++ )
+      query[d] += (d % 2 ? 0.01f : -0.01f);
+    int32 indices[2];
+    float dists[2];
+    ASSERT_EQ( 2u, tree.knn_search( &query[0], 2, indices, dists, 64 ) );
+    EXPECT_LE( dists[0], dists[1] );
+    if ( indices[0] == int32(q*30) )
+      found++;
+
+    ASSERT_EQ( 2u, tree.knn_search( &query[0], 2, indices, dists, count ) );
+    vector<float> expected = nearest( points, dims, &query[0], 2 );
+    EXPECT_FLOAT_EQ( expected[0], dists[0] );
+    EXPECT_FLOAT_EQ( expected[1], dists[1] );
+  }
+  EXPECT_GT( found, 90u );
+}
+
+TEST(FlatKDTree, Small) {
+  float points[] = { 0, 0,  1, 0,  0, 2 };
+  FlatKDTree<float> tree( points, 3, 2 );
+  int32 indices[5];
+  float dists[5];
+  float query[] = { 0.9f, 0.1f };
+  ASSERT_EQ( 3u, tree.knn_search( query, 5, indices, dists ) );
+  EXPECT_EQ( 1, indices[0] );
+  EXPECT_EQ( 0, indices[1] );
+  EXPECT_EQ( 2, indices[2] );
+
+  FlatKDTree<float> empty( points, 0, 2 );
+  EXPECT_EQ( 0u, empty.knn_search( query, 2, indices, dists ) );
+}
+
+TEST(FlatKDTree, Batch) {
+  const size_t dims = 4, count = 50000, queries = 1000, knn = 3;
+  vector<float> points = random_points( count, dims, 8 );
+  vector<float> query = random_points( queries, dims, 9 );
+
+  // Trees built on one thread and on several answer the same, one
+  // query at a time or in a batch.
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 1 );
+  FlatKDTree<float> serial( &points[0], count, dims );
+  vw_settings().set_default_num_threads( 4 );
+  FlatKDTree<float> parallel( &points[0], count, dims );
+  vector<int32> indices( queries*knn );
+  vector<float> dists( queries*knn );
+  parallel.knn_search( &query[0], queries, knn, &indices[0], &dists[0] );
+  vector<int32> approximate( queries*knn );
+  vector<float> approximate_dists( queries*knn );
+  parallel.knn_search( &query[0], queries, knn, &approximate[0], &approximate_dists[0], 32 );
+  vw_settings().set_default_num_threads( threads );
+
+  for ( size_t q = 0; q < queries; q++ ) {
+    int32 expected[knn];
+    float expected_dists[knn];
+    ASSERT_EQ( knn, serial.knn_search( &query[q*dims], knn, expected, expected_dists ) );
+    for ( size_t k = 0; k < knn; k++ ) {
+      EXPECT_EQ( expected[k], indices[q*knn+k] );
+      EXPECT_EQ( expected_dists[k], dists[q*knn+k] );
+    }
+    ASSERT_EQ( knn, serial.knn_search( &query[q*dims], knn, expected, expected_dists, 32 ) );
+    for ( size_t k = 0; k < knn; k++ )
+      EXPECT_EQ( expected[k], approximate[q*knn+k] );
+  }
+
+  // Places beyond the points found are filled in.
+  float small[] = { 0, 0,  1, 1 };
+  FlatKDTree<float> tree( small, 2, 2 );
+  int32 small_indices[6];
+  float small_dists[6];
+  tree.knn_search( small, 2, 3, small_indices, small_dists );
+  EXPECT_EQ( 0, small_indices[0] );
+  EXPECT_EQ( 1, small_indices[1] );
+  EXPECT_EQ( -1, small_indices[2] );
+  EXPECT_EQ( std::numeric_limits<float>::max(), small_dists[2] );
+  EXPECT_EQ( 1, small_indices[3] );
+}
+
+TEST(FlatKDTree, Radius) {
+  const size_t dims = 3, count = 3000;
+  vector<float> points = random_points( count, dims, 8 );
+  vector<float> queries = random_points( 40, dims, 9 );
+  FlatKDTree<float> tree( &points[0], count, dims, 5 );
+
+  for ( size_t q = 0; q < 40; q++ ) {
+    float const* query = &queries[q*dims];
+    vector<int32> expected;
+    for ( size_t i = 0; i < count; i++ ) {
+      float dist = 0;
+      for ( size_t d = 0; d < dims; d++ )
+        dist += (points[i*dims+d] - query[d])*(points[i*dims+d] - query[d]);
+      if ( dist <= 0.01f )
+        expected.push_back( int32(i) );
+    }
+    vector<int32> found( 1, -1 );
+    EXPECT_EQ( expected.size(), tree.radius_search( query, 0.01f, found ) );
+    ASSERT_EQ( expected.size() + 1, found.size() );
+    EXPECT_EQ( -1, found[0] );
+    found.erase( found.begin() );
+    std::sort( found.begin(), found.end() );
+    EXPECT_EQ( expected, found );
+  }
+
+  vector<int32> none;
+  EXPECT_EQ( 0u, FlatKDTree<float>( 0, 0, dims ).radius_search( &queries[0], 1.0f, none ) );
+}
@@ -86,3 +86,90 @@ TEST(LevenbergMarquardt, levenberg_marquardt) {
   EXPECT_EQ(vw::math::optimization::eConvergedRelTolerance, status);
   EXPECT_VECTOR_NEAR( expected_best, best, 1e-5 );
 }
+
+// A chain in which each output depends on a parameter and its
+// neighbors, so the Jacobian is tridiagonal.
+struct BandedLeastSquaresModel : public LeastSquaresModelBase<BandedLeastSquaresModel> {
+
+  typedef Vector<double> result_type;
+  typedef Vector<double> domain_type;
+  typedef Matrix<double> jacobian_type;
+
+  size_t m_size;
+  BandedLeastSquaresModel( size_t size ) : m_size(size) {}
+
+  inline result_type operator()( domain_type const& x ) const {
+    Vector<double> h(m_size);
+    for ( size_t i = 0; i < m_size; i++ ) {
+      h(i) = x(i) * x(i) + sin(x(i));
+      if ( i > 0 )
+        h(i) += 0.5 * x(i-1);
+      if ( i + 1 < m_size )
+        h(i) -= 0.3 * x(i+1) * x(i);
+    }
+    return h;
+  }
+
+  JacobianSparsity jacobian_sparsity() const {
+    JacobianSparsity sparsity(m_size, m_size);
+    for ( size_t i = 0; i < m_size; i++ )
+      for ( size_t j = i > 0 ? i-1 : 0; j <= i+1 && j < m_size; j++ )
+        sparsity.add(i, j);
+    return sparsity;
+  }
+};
+
+TEST(LevenbergMarquardt, sparse_jacobian) {
+  BandedLeastSquaresModel model(30);
+  JacobianSparsity sparsity = model.jacobian_sparsity();
+  EXPECT_EQ( 30u*3 - 2, sparsity.nonzeros() );
+
+  // Columns three apart share no rows.
+  std::vector<std::vector<size_t> > groups = sparsity.column_groups();
+  ASSERT_EQ( 3u, groups.size() );
+  for ( size_t g = 0; g < groups.size(); g++ )
+    for ( size_t k = 0; k < groups[g].size(); k++ )
+      EXPECT_EQ( g, groups[g][k] % 3 );
+
+  Vector<double> x(30);
+  for ( size_t i = 0; i < x.size(); i++ )
+    x(i) = 0.1 * double(i) - 1;
+  Matrix<double> dense = model.jacobian(x);
+  SparseJacobian sparse = model.sparse_jacobian(x, sparsity);
+  for ( size_t i = 0; i < dense.rows(); i++ )
+    for ( size_t j = 0; j < dense.cols(); j++ )
+      EXPECT_EQ( dense(i,j), sparse(i,j) );
+
+  Vector<double> v = model(x);
+  EXPECT_VECTOR_NEAR( transpose(dense) * v, sparse.transpose_product(v), 1e-12 );
+}
+
+TEST(LevenbergMarquardt, sparse_levenberg_marquardt) {
+  // The sparse solver takes the same steps as the dense one.
+  BandedLeastSquaresModel small(30);
+  Vector<double> truth(30), seed(30);
+  for ( size_t i = 0; i < truth.size(); i++ ) {
+    truth(i) = 0.5 + 0.01 * double(i);
+    seed(i) = 1;
+  }
+  Vector<double> target = small(truth);
+  int dense_status, sparse_status;
+  Vector<double> dense = levenberg_marquardt( small, seed, target, dense_status );
+  Vector<double> sparse = sparse_levenberg_marquardt( small, seed, target, sparse_status );
+  EXPECT_EQ( dense_status, sparse_status );
+  EXPECT_VECTOR_NEAR( dense, sparse, 1e-8 );
+  EXPECT_VECTOR_NEAR( truth, sparse, 1e-6 );
+
+  // Large problems are no harder.
+  BandedLeastSquaresModel large(3000);
+  truth.set_size(3000);
+  seed.set_size(3000);
+  for ( size_t i = 0; i < truth.size(); i++ ) {
+    truth(i) = 0.5 + 0.5 * sin(double(i));
+    seed(i) = 1;
+  }
+  target = large(truth);
+  sparse = sparse_levenberg_marquardt( large, seed, target, sparse_status );
+  EXPECT_NE( optimization::eDidNotConverge, sparse_status );
+  EXPECT_VECTOR_NEAR( truth, sparse, 1e-6 );
+}
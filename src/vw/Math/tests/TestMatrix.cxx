@@ -9,6 +9,8 @@
 #include <gtest/gtest.h>
 #include <vw/Math/Matrix.h>
 
+#include <cmath>
+
 using namespace vw;
 
 TEST(Matrix, Static) {
@@ -480,3 +482,68 @@ TEST(Matrix, IndexingIterator) {
   EXPECT_NE(&j, &k);
   EXPECT_TRUE(j == k);
 }
+
+template <size_t RowsN, size_t InnerN, size_t ColsN>
+static void check_small_products() {
+  // The fixed-size products sum in the same order as the general
+  // ones, so they agree exactly.
+  Matrix<double,RowsN,InnerN> a;
+  Matrix<double,InnerN,ColsN> b;
+  Vector<double,InnerN> v;
+  for ( size_t i = 0; i < RowsN*InnerN; ++i ) a.data()[i] = std::sin( 1.0 + i );
+  for ( size_t i = 0; i < InnerN*ColsN; ++i ) b.data()[i] = std::cos( 2.0 + 3*i );
+  for ( size_t i = 0; i < InnerN; ++i ) v[i] = std::sin( 0.5 + 7*i );
+  Matrix<double> da = a, db = b;
+  Vector<double> dv = v;
+
+  Vector<double,RowsN> mv = a*v;
+  Vector<double> dmv = da*dv;
+  for ( size_t i = 0; i < RowsN; ++i )
+    EXPECT_EQ( dmv[i], mv[i] );
+
+  // Products inside larger expressions are taken an element at a
+  // time.
+  Vector<double,RowsN> w = a*v + a*v;
+  Vector<double> dw = da*dv + da*dv;
+  for ( size_t i = 0; i < RowsN; ++i )
+    EXPECT_EQ( dw[i], w[i] );
+  Vector<double,InnerN> tw = transpose(a)*w;
+  Vector<double> dtw = transpose(da)*dw;
+  for ( size_t i = 0; i < InnerN; ++i )
+    EXPECT_EQ( dtw[i], tw[i] );
+
+  Matrix<double,RowsN,ColsN> mm = a*b;
+  Matrix<double> dmm = da*db;
+  for ( size_t i = 0; i < RowsN; ++i )
+    for ( size_t j = 0; j < ColsN; ++j )
+      EXPECT_EQ( dmm(i,j), mm(i,j) );
+  Matrix<double,RowsN,ColsN> mm2 = a*b - a*b;
+  for ( size_t i = 0; i < RowsN; ++i )
+    for ( size_t j = 0; j < ColsN; ++j )
+      EXPECT_EQ( 0, mm2(i,j) );
+
+  Matrix<float,RowsN,InnerN> fa = a;
+  Vector<float,InnerN> fv = v;
+  Vector<float,RowsN> fmv = fa*fv;
+  Vector<float> dfmv = Matrix<float>(fa) * Vector<float>(fv);
+  for ( size_t i = 0; i < RowsN; ++i )
+    EXPECT_EQ( dfmv[i], fmv[i] );
+}
+
+TEST(Matrix, SmallFixedProducts) {
+  check_small_products<2,2,2>();
+  check_small_products<3,3,3>();
+  check_small_products<4,4,4>();
+  check_small_products<3,4,4>();
+  check_small_products<4,3,2>();
+  check_small_products<2,3,4>();
+
+  // The product is evaluated before it's assigned, so a vector can
+  // be transformed in place.
+  Matrix3x3 rot( 0, -1, 0, 1, 0, 0, 0, 0, 1 );
+  Vector3 v( 1, 2, 3 );
+  v = rot*v;
+  EXPECT_EQ( -2, v[0] );
+  EXPECT_EQ( 1, v[1] );
+  EXPECT_EQ( 3, v[2] );
+}
@@ -6,6 +6,7 @@
 
 
 #include <gtest/gtest.h>
+#include <vw/Core/Settings.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/NelderMead.h>
 
@@ -54,3 +55,21 @@ TEST(NelderMead, CCostFunction) {
   EXPECT_NEAR( 0.1962, result[0], DELTA );
   EXPECT_NEAR( 0.4846, result[1], DELTA );
 }
+
+TEST(NelderMead, Parallel) {
+  // Evaluating the vertices together doesn't change the search.
+  Vector2 initial_guess(2,2);
+  int status, parallel_status;
+  Vector2 serial = nelder_mead( QuadraticFunction(), initial_guess, status );
+
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 4 );
+  Vector2 parallel = nelder_mead( QuadraticFunction(), initial_guess, parallel_status,
+                                  false, 1, 1e-16, 1000, true );
+  vw_settings().set_default_num_threads( threads );
+
+  EXPECT_EQ( status, parallel_status );
+  EXPECT_EQ( serial, parallel );
+  EXPECT_NEAR( 0.1962, parallel[0], DELTA );
+  EXPECT_NEAR( 0.4846, parallel[1], DELTA );
+}
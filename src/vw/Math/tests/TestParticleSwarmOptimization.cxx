@@ -7,6 +7,7 @@
 
 #include <gtest/gtest.h>
 #include <test/Helpers.h>
+#include <vw/Core/Settings.h>
 #include <vw/Math/ParticleSwarmOptimization.h>
 
 using namespace vw;
@@ -85,3 +86,33 @@ TEST(ParticleSwarmOptimization, sinus_function) {
   EXPECT_NEAR( pi2, std::fabs(modulo(result(2), M_PI)), 1e-1 );
   EXPECT_NEAR( pi2, std::fabs(modulo(result(3), M_PI)), 1e-1 );
 }
+
+TEST(ParticleSwarmOptimization, seeded) {
+  Vector2 min(-2, -2);
+  Vector2 max(2, 2);
+
+  // A seed repeats a run exactly.
+  Vector2 first = particle_swarm_optimization( QuadraticFunction(), min, max, false, 1, 50, 200,
+                                               0.9, 2, 2, 4.0, false, 7 );
+  Vector2 second = particle_swarm_optimization( QuadraticFunction(), min, max, false, 1, 50, 200,
+                                                0.9, 2, 2, 4.0, false, 7 );
+  EXPECT_EQ( first, second );
+}
+
+TEST(ParticleSwarmOptimization, parallel) {
+  Vector2 min(-2, -2);
+  Vector2 max(2, 2);
+
+  // The parallel swarm finds the same minimum with any number of threads.
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 1 );
+  Vector2 serial = particle_swarm_optimization( QuadraticFunction(), min, max, false, 1, 100, 1000,
+                                                0.9, 2, 2, 4.0, true, 11 );
+  vw_settings().set_default_num_threads( 4 );
+  Vector2 parallel = particle_swarm_optimization( QuadraticFunction(), min, max, false, 1, 100, 1000,
+                                                  0.9, 2, 2, 4.0, true, 11 );
+  vw_settings().set_default_num_threads( threads );
+
+  EXPECT_EQ( serial, parallel );
+  EXPECT_VECTOR_NEAR( Vector2(0.1962, 0.4846), parallel, 1e-2 );
+}
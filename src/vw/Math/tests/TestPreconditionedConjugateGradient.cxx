@@ -0,0 +1,128 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Math/PreconditionedConjugateGradient.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_01.hpp>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+  // Multiplies by a dense matrix, as an implicit operator would.
+  struct DenseOperator {
+    Matrix<double> const& A;
+    DenseOperator( Matrix<double> const& A ) : A(A) {}
+    void operator()( Vector<double> const& x, Vector<double>& y ) const { y = A*x; }
+  };
+
+  // A symmetric positive definite matrix with strongly coupled
+  // blocks of bs elements, and weaker coupling between the blocks.
+  Matrix<double> random_spd( size_t num_blocks, size_t bs, int seed ) {
+    boost::rand48 gen( seed );
+    boost::uniform_01<boost::rand48> uniform( gen );
+    size_t n = num_blocks * bs;
+    Matrix<double> B( n, n );
+    for ( size_t i = 0; i < n; i++ )
+      for ( size_t j = 0; j < n; j++ )
+        B(i,j) = ( uniform() - 0.5 ) * ( i/bs == j/bs ? 10.0 : 0.2 );
+    Matrix<double> A = B * transpose(B);
+    for ( size_t i = 0; i < n; i++ )
+      A(i,i) += 1;
+    return A;
+  }
+
+  Vector<double> random_vector( size_t size, int seed ) {
+    boost::rand48 gen( seed );
+    boost::uniform_01<boost::rand48> uniform( gen );
+    Vector<double> v( size );
+    for ( size_t i = 0; i < size; i++ )
+      v[i] = uniform() - 0.5;
+    return v;
+  }
+
+  BlockJacobiPreconditioner block_jacobi( Matrix<double> const& A, size_t bs ) {
+    BlockJacobiPreconditioner M( A.rows() / bs, bs );
+    for ( size_t k = 0; k < M.num_blocks(); k++ )
+      M.set_block( k, submatrix( A, k*bs, k*bs, bs, bs ) );
+    return M;
+  }
+}
+
+TEST(PreconditionedConjugateGradient, Solve) {
+  Matrix<double> A = random_spd( 10, 4, 1 );
+  Vector<double> x = random_vector( A.rows(), 2 ), b = A*x;
+
+  Vector<double> plain( A.rows() );
+  ConjugateGradientResult r1 =
+    preconditioned_conjugate_gradient( DenseOperator(A), IdentityPreconditioner(), b, plain, 1e-12, 1000 );
+  EXPECT_TRUE( r1.converged );
+  EXPECT_LT( r1.residual, 1e-12 );
+  for ( size_t i = 0; i < x.size(); i++ )
+    EXPECT_NEAR( x[i], plain[i], 1e-8 );
+
+  // The blocks carry most of A, so inverting them saves iterations.
+  Vector<double> preconditioned( A.rows() );
+  ConjugateGradientResult r2 =
+    preconditioned_conjugate_gradient( DenseOperator(A), block_jacobi( A, 4 ), b, preconditioned, 1e-12, 1000 );
+  EXPECT_TRUE( r2.converged );
+  EXPECT_LT( r2.iterations, r1.iterations );
+  for ( size_t i = 0; i < x.size(); i++ )
+    EXPECT_NEAR( x[i], preconditioned[i], 1e-8 );
+}
+
+TEST(PreconditionedConjugateGradient, BlockJacobi) {
+  // On a block diagonal matrix the preconditioner is the inverse.
+  Matrix<double> A = random_spd( 3, 5, 3 );
+  for ( size_t i = 0; i < A.rows(); i++ )
+    for ( size_t j = 0; j < A.cols(); j++ )
+      if ( i/5 != j/5 )
+        A(i,j) = 0;
+  Vector<double> x = random_vector( A.rows(), 4 ), y( A.rows() );
+  block_jacobi( A, 5 )( A*x, y );
+  for ( size_t i = 0; i < x.size(); i++ )
+    EXPECT_NEAR( x[i], y[i], 1e-10 );
+
+  Vector<double> z( A.rows() );
+  ConjugateGradientResult r =
+    preconditioned_conjugate_gradient( DenseOperator(A), block_jacobi( A, 5 ), A*x, z );
+  EXPECT_TRUE( r.converged );
+  EXPECT_EQ( 1u, r.iterations );
+
+  // A block that isn't positive definite falls back to its diagonal.
+  BlockJacobiPreconditioner M( 1, 2 );
+  Matrix2x2 indefinite( 2, 3, 3, 4 );
+  M.set_block( 0, indefinite );
+  Vector<double> v( 2 ), w( 2 );
+  v[0] = 1; v[1] = 1;
+  M( v, w );
+  EXPECT_NEAR( 0.5, w[0], 1e-15 );
+  EXPECT_NEAR( 0.25, w[1], 1e-15 );
+}
+
+TEST(PreconditionedConjugateGradient, Stopping) {
+  Matrix<double> A = random_spd( 10, 4, 5 );
+  Vector<double> b = random_vector( A.rows(), 6 ), x( A.rows() );
+  ConjugateGradientResult r =
+    preconditioned_conjugate_gradient( DenseOperator(A), IdentityPreconditioner(), b, x, 1e-12, 3 );
+  EXPECT_FALSE( r.converged );
+  EXPECT_EQ( 3u, r.iterations );
+  EXPECT_GT( r.residual, 1e-12 );
+
+  // Starting from an answer takes no iterations.
+  x = random_vector( A.rows(), 7 );
+  Vector<double> start = x;
+  r = preconditioned_conjugate_gradient( DenseOperator(A), IdentityPreconditioner(), A*x, x, 1e-6 );
+  EXPECT_EQ( 0u, r.iterations );
+  EXPECT_TRUE( r.converged );
+
+  Vector<double> zero( A.rows() );
+  r = preconditioned_conjugate_gradient( DenseOperator(A), IdentityPreconditioner(), zero, x );
+  EXPECT_EQ( 0.0, norm_2( x ) );
+}
@@ -8,6 +8,7 @@
 #include <cmath>
 #include <ctime>
 #include <cstdlib>
+#include <vector>
 #include <vw/Math/Quaternion.h>
 #include <gtest/gtest.h>
 
@@ -399,3 +400,42 @@ TEST(Quaternion, AxisAngleQuaternionMatrixRandom) {
     EXPECT_NEAR( test.z(), null_op.z() , DELTA );
   }
 }
+
+TEST(Quaternion, BatchRotation) {
+  // Not a unit quaternion, which rotate() doesn't mind either.
+  Quat quat( 0.9, -0.3, 0.5, 1.2 );
+  std::vector<Vector3> points( 100 ), rotated( points.size() );
+  std::vector<double> x( points.size() ), y( points.size() ), z( points.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    points[i] = Vector3( 0.1 * double(i), 1 - 0.02 * double(i), 3 );
+    x[i] = points[i][0];
+    y[i] = points[i][1];
+    z[i] = points[i][2];
+  }
+  quat.rotate( &points[0], &rotated[0], points.size() );
+  quat.rotate( &x[0], &y[0], &z[0], &x[0], &y[0], &z[0], points.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    Vector3 expected = quat.rotate( points[i] );
+    EXPECT_NEAR( expected[0], rotated[i][0], DELTA );
+    EXPECT_NEAR( expected[1], rotated[i][1], DELTA );
+    EXPECT_NEAR( expected[2], rotated[i][2], DELTA );
+    EXPECT_NEAR( expected[0], x[i], DELTA );
+    EXPECT_NEAR( expected[1], y[i], DELTA );
+    EXPECT_NEAR( expected[2], z[i], DELTA );
+  }
+
+  // In place, by a matrix.
+  Matrix3x3 rotation = normalize( quat ).rotation_matrix();
+  math::rotate_points( rotation, &points[0], &points[0], points.size() );
+  for ( size_t i = 0; i < points.size(); i++ ) {
+    EXPECT_NEAR( rotated[i][0], points[i][0], DELTA );
+    EXPECT_NEAR( rotated[i][1], points[i][1], DELTA );
+    EXPECT_NEAR( rotated[i][2], points[i][2], DELTA );
+  }
+
+  std::vector<Quat> quats( 3, Quat( 0, 1, 0, 0 ) ), composed( 3 );
+  quats[1] = Quat( 0.5, 0.5, 0.5, 0.5 );
+  quat.compose( &quats[0], &composed[0], quats.size() );
+  for ( size_t i = 0; i < quats.size(); i++ )
+    EXPECT_QUAT_EQ( quat * quats[i], composed[i] );
+}
@@ -0,0 +1,95 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/Geometry.h>
+#include <vw/Math/RANSAC.h>
+
+#include <boost/random/linear_congruential.hpp>
+
+using namespace vw;
+using namespace vw::math;
+
+typedef RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> RansacT;
+
+// Points related by a similarity, with one in three of them moved
+// elsewhere.
+static void similar_points( size_t count, std::vector<Vector3>& p1, std::vector<Vector3>& p2,
+                            Matrix3x3& H ) {
+  H = Matrix3x3( 0.8*std::cos(0.3), -0.8*std::sin(0.3), 40,
+                 0.8*std::sin(0.3),  0.8*std::cos(0.3), -25,
+                 0, 0, 1 );
+  boost::rand48 gen( 11 );
+  for ( size_t i = 0; i < count; i++ ) {
+    Vector3 p( double(gen() % 10000) / 10, double(gen() % 10000) / 10, 1 );
+    p1.push_back( p );
+    if ( i % 3 == 2 )
+      p2.push_back( Vector3( double(gen() % 10000) / 10, double(gen() % 10000) / 10, 1 ) );
+    else
+      p2.push_back( H * p );
+  }
+}
+
+TEST(RANSAC, Similarity) {
+  std::vector<Vector3> p1, p2;
+  Matrix3x3 expected;
+  similar_points( 300, p1, p2, expected );
+
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RansacT ransac( fit, error, 1.0 );
+  Matrix<double> H = ransac( p1, p2 );
+  EXPECT_MATRIX_NEAR( expected, H, 1e-6 );
+
+  std::vector<size_t> inliers = ransac.inlier_indices( H, p1, p2 );
+  ASSERT_EQ( 200u, inliers.size() );
+  for ( size_t i = 0; i < inliers.size(); i++ )
+    EXPECT_NE( 2u, inliers[i] % 3 );
+
+  // Without the T(d,d) test, and with too few iterations to stop on
+  // confidence.
+  RansacT plain( fit, error, 1.0, 0.99, 0 );
+  EXPECT_MATRIX_NEAR( expected, plain( p1, p2, 20 ), 1e-6 );
+}
+
+TEST(RANSAC, Threads) {
+  std::vector<Vector3> p1, p2;
+  Matrix3x3 expected;
+  similar_points( 200, p1, p2, expected );
+
+  // With a given seed, the fit doesn't depend on the threads.
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RansacT ransac( fit, error, 1.0 );
+  ransac.set_seed( 5 );
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 1 );
+  Matrix<double> serial = ransac( p1, p2 );
+  vw_settings().set_default_num_threads( 4 );
+  Matrix<double> parallel = ransac( p1, p2 );
+  vw_settings().set_default_num_threads( threads );
+  EXPECT_MATRIX_EQ( serial, parallel );
+  EXPECT_MATRIX_NEAR( expected, parallel, 1e-6 );
+}
+
+TEST(RANSAC, NoFit) {
+  // Points with nothing in common.
+  std::vector<Vector3> p1, p2;
+  boost::rand48 gen( 3 );
+  for ( size_t i = 0; i < 50; i++ ) {
+    p1.push_back( Vector3( double(gen() % 10000), double(gen() % 10000), 1 ) );
+    p2.push_back( Vector3( double(gen() % 10000), double(gen() % 10000), 1 ) );
+  }
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+  RansacT ransac( fit, error, 0.01 );
+  EXPECT_THROW( ransac( p1, p2 ), RANSACErr );
+}
@@ -0,0 +1,144 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vector>
+#include <gtest/gtest.h>
+#include <vw/Core/Settings.h>
+#include <vw/Math/SparseCholesky.h>
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/uniform_01.hpp>
+
+using std::vector;
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+  typedef vector<std::pair<size_t, size_t> > BlockList;
+
+  // A symmetric, diagonally dominant matrix of num_blocks blocks of
+  // bs elements, with roughly a density of the blocks below the
+  // diagonal nonzero, which are listed in blocks.
+  Matrix<double> random_matrix( size_t num_blocks, size_t bs, double density,
+                                BlockList& blocks, int seed ) {
+    boost::rand48 gen( seed );
+    boost::uniform_01<boost::rand48> uniform( gen );
+    Matrix<double> A( num_blocks*bs, num_blocks*bs );
+    for ( size_t i = 0; i < num_blocks; i++ ) {
+      for ( size_t j = 0; j <= i; j++ ) {
+        if ( i != j && uniform() > density )
+          continue;
+        if ( i != j )
+          blocks.push_back( std::make_pair( i, j ) );
+        for ( size_t ii = 0; ii < bs; ii++ )
+          for ( size_t jj = 0; jj < bs; jj++ ) {
+            double v = uniform() - 0.5;
+            A( i*bs+ii, j*bs+jj ) += v;
+            A( j*bs+jj, i*bs+ii ) += v;
+          }
+      }
+    }
+    for ( size_t i = 0; i < A.rows(); i++ )
+      A( i, i ) += double(A.rows());
+    return A;
+  }
+
+  Vector<double> random_vector( size_t size, int seed ) {
+    boost::rand48 gen( seed );
+    boost::uniform_01<boost::rand48> uniform( gen );
+    Vector<double> v( size );
+    for ( size_t i = 0; i < size; i++ )
+      v[i] = uniform() - 0.5;
+    return v;
+  }
+}
+
+TEST(SparseCholesky, Solve) {
+  BlockList blocks;
+  Matrix<double> A = random_matrix( 40, 3, 0.08, blocks, 1 );
+  SparseCholesky<double> chol( 40, 3, blocks );
+  EXPECT_EQ( 40u, chol.ordering().size() );
+  EXPECT_GT( chol.num_supernodes(), 1u );
+  EXPECT_LE( chol.factor_size(), A.rows()*(A.rows()+1)/2 );
+
+  // The same structure factors any number of matrices.
+  for ( int pass = 0; pass < 2; pass++ ) {
+    if ( pass > 0 )
+      A *= 2;
+    Vector<double> x = random_vector( A.rows(), 2 + pass );
+    chol.factor( A );
+    Vector<double> y = chol.solve( A*x );
+    ASSERT_EQ( x.size(), y.size() );
+    for ( size_t i = 0; i < x.size(); i++ )
+      EXPECT_NEAR( x[i], y[i], 1e-10 );
+  }
+
+  Matrix<double> X( A.rows(), 3 );
+  for ( size_t j = 0; j < 3; j++ )
+    select_col( X, j ) = random_vector( A.rows(), 10 + int(j) );
+  Matrix<double> Y = chol.solve( A*X );
+  for ( size_t i = 0; i < X.rows(); i++ )
+    for ( size_t j = 0; j < X.cols(); j++ )
+      EXPECT_NEAR( X(i,j), Y(i,j), 1e-10 );
+}
+
+TEST(SparseCholesky, NoFill) {
+  // A star, with the center numbered first.  Eliminating all but one
+  // of the leaves before it leaves no fill.
+  BlockList blocks;
+  for ( size_t i = 1; i < 20; i++ )
+    blocks.push_back( std::make_pair( i, size_t(0) ) );
+  SparseCholesky<double> chol( 20, 2, blocks );
+  EXPECT_EQ( 0u, chol.ordering()[18] );
+  EXPECT_EQ( 20u*3 + 19u*4, chol.factor_size() );
+
+  // Unconnected blocks are fine too.
+  SparseCholesky<double> diagonal( 5, 2, BlockList() );
+  Matrix<double> D( 10, 10 );
+  D.set_identity();
+  diagonal.factor( 4 * D );
+  Vector<double> x = random_vector( 10, 3 );
+  Vector<double> y = diagonal.solve( x );
+  for ( size_t i = 0; i < 10; i++ )
+    EXPECT_NEAR( x[i] / 4, y[i], 1e-15 );
+}
+
+TEST(SparseCholesky, Threads) {
+  // Dense enough that the fronts near the root are shared among the
+  // threads.  Any number of threads gives the same factor.
+  BlockList blocks;
+  Matrix<double> A = random_matrix( 120, 6, 0.1, blocks, 4 );
+  Vector<double> b = random_vector( A.rows(), 5 );
+  SparseCholesky<double> chol( 120, 6, blocks );
+
+  int threads = vw_settings().default_num_threads();
+  vw_settings().set_default_num_threads( 1 );
+  chol.factor( A );
+  Vector<double> expected = chol.solve( b );
+  vw_settings().set_default_num_threads( 4 );
+  chol.factor( A );
+  Vector<double> x = chol.solve( b );
+  vw_settings().set_default_num_threads( threads );
+
+  for ( size_t i = 0; i < x.size(); i++ )
+    EXPECT_EQ( expected[i], x[i] );
+  Vector<double> r = A*x - b;
+  for ( size_t i = 0; i < r.size(); i++ )
+    EXPECT_NEAR( 0, r[i], 1e-10 );
+}
+
+TEST(SparseCholesky, NotPositiveDefinite) {
+  BlockList blocks;
+  Matrix<double> A = random_matrix( 10, 2, 0.3, blocks, 6 );
+  A( 7, 7 ) = -1;
+  SparseCholesky<double> chol( 10, 2, blocks );
+  EXPECT_THROW( chol.factor( A ), MathErr );
+  EXPECT_THROW( chol.solve( Vector<double>( 20 ) ), LogicErr );
+
+  EXPECT_THROW( SparseCholesky<double>( 10, 2, BlockList( 1, std::make_pair( size_t(10), size_t(0) ) ) ),
+                ArgumentErr );
+}
@@ -348,3 +348,20 @@ TEST(Vector, SmallIntArithmetic) {
     EXPECT_VECTOR_NEAR( Vector3(.01,.01,.02), fresult, 1e-6 );
   }
 }
+
+TEST(Vector, SmallFixed) {
+  Vector4 a( 0.3, -1.7, 2.9, 0.1 ), b( 1.1, 0.4, -0.6, 5.3 );
+  Vector<double> da = a, db = b;
+  EXPECT_EQ( dot_prod( da, db ), dot_prod( a, b ) );
+  EXPECT_EQ( norm_2( da ), norm_2( a ) );
+  EXPECT_EQ( norm_2_sqr( da ), norm_2_sqr( a ) );
+  EXPECT_EQ( dot_prod( subvector(da,0,2), subvector(db,0,2) ), dot_prod( Vector2(a[0],a[1]), Vector2(b[0],b[1]) ) );
+
+  Vector3 c( 0.3, -1.7, 2.9 ), d( 1.1, 0.4, -0.6 );
+  Vector3 cross = cross_prod( c, d );
+  EXPECT_EQ( c[1]*d[2]-c[2]*d[1], cross[0] );
+  EXPECT_EQ( c[2]*d[0]-c[0]*d[2], cross[1] );
+  EXPECT_EQ( c[0]*d[1]-c[1]*d[0], cross[2] );
+  EXPECT_VECTOR_EQ( cross, cross_prod( Vector<double>(c), Vector<double>(d) ) );
+  EXPECT_NEAR( 0, dot_prod( cross, c ), 1e-12 );
+}
@@ -27,6 +27,7 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/Mosaic/RTree.h>
 
 namespace vw {
 namespace mosaic {
@@ -120,10 +121,51 @@ namespace mosaic {
   };
 
 
+  // *******************************************************************
+  // capped_grassfire()
+  // *******************************************************************
+
+  // Computes the grassfire image of a window onto a source image, as
+  // grassfire() would for the whole source but capped at the given
+  // depth.  Pixels beyond the source bbox count as zero and those
+  // inside it but beyond the window as the cap, so the result is
+  // exact wherever the window extends the cap past the pixel.
+  template <class AlphaT>
+  void capped_grassfire( ImageViewBase<AlphaT> const& alpha_, BBox2i const& window, BBox2i const& source_bbox,
+                         int32 cap, ImageView<int32>& dst ) {
+    AlphaT const& alpha = alpha_.impl();
+    int32 cols = window.width(), rows = window.height();
+    dst.set_size( cols, rows );
+    int32 left   = ( window.min().x() > source_bbox.min().x() ) ? cap : 0;
+    int32 top    = ( window.min().y() > source_bbox.min().y() ) ? cap : 0;
+    int32 right  = ( window.max().x() < source_bbox.max().x() ) ? cap : 0;
+    int32 bottom = ( window.max().y() < source_bbox.max().y() ) ? cap : 0;
+    const typename AlphaT::pixel_type zero = typename AlphaT::pixel_type();
+    for( int32 j=0; j<rows; ++j ) {
+      for( int32 i=0; i<cols; ++i ) {
+        if( alpha(i,j) == zero ) dst(i,j) = 0;
+        else dst(i,j) = std::min( cap, 1 + std::min( i ? dst(i-1,j) : left, j ? dst(i,j-1) : top ) );
+      }
+    }
+    for( int32 j=rows-1; j>=0; --j ) {
+      for( int32 i=cols-1; i>=0; --i ) {
+        if( dst(i,j) == 0 ) continue;
+        int32 m = std::min( (i<cols-1) ? dst(i+1,j) : right, (j<rows-1) ? dst(i,j+1) : bottom );
+        if( m < dst(i,j) ) dst(i,j) = m + 1;
+      }
+    }
+  }
+
+
   // *******************************************************************
   // ImageComposite
   // *******************************************************************
 
+  /// A mosaic of positioned source images, either overlaid in draft
+  /// mode or multi-band blended.  Each blended patch is computed from
+  /// padded crops of just the sources that overlap it, found through
+  /// an R-tree, so memory follows the patch size rather than the
+  /// sizes or number of the sources.
   template <class PixelT>
   class ImageComposite : public ImageViewBase<ImageComposite<PixelT> > {
   public:
@@ -131,83 +173,13 @@ namespace mosaic {
     typedef typename PixelChannelType<PixelT>::type channel_type;
 
   private:
-    struct Pyramid {
-      std::vector<PositionedImage<pixel_type> > images;
-      std::vector<PositionedImage<channel_type> > masks;
-    };
-
-    class SourceGenerator {
-      ImageViewRef<pixel_type> m_source;
-    public:
-      typedef ImageView<pixel_type> value_type;
-      SourceGenerator( ImageViewRef<pixel_type> const& source ) : m_source(source) {}
-      size_t size() const {
-        return m_source.cols() * m_source.rows() * sizeof(pixel_type);
-      }
-      boost::shared_ptr<value_type> generate() const {
-        return boost::shared_ptr<value_type>( new value_type(m_source) );
-      }
-    };
-
-    class GrassfireGenerator {
-      ImageViewRef<pixel_type> m_source;
-    public:
-      typedef ImageView<float32> value_type;
-      GrassfireGenerator( ImageViewRef<pixel_type> const& source ) : m_source(source) {}
-      size_t size() const {
-        return m_source.cols() * m_source.rows() * sizeof(float32);
-      }
-      boost::shared_ptr<value_type> generate() const {
-        ImageView<float32> alpha = channel_cast<float32>( select_alpha_channel( copy( m_source ) ) );
-        return boost::shared_ptr<value_type>( new value_type( grassfire( alpha ) ) );
-      }
-    };
-
-    class AlphaGenerator {
-    public:
-      ImageComposite& m_composite;
-      size_t m_index;
-    public:
-      typedef ImageView<channel_type> value_type;
-      AlphaGenerator( ImageComposite& composite, size_t index ) : m_composite(composite), m_index(index) {}
-      size_t size() const {
-        return m_composite.sources[m_index].size() / PixelNumChannels<pixel_type>::value;
-      }
-      boost::shared_ptr<value_type> generate() const {
-        ImageView<pixel_type> source = *m_composite.sources[m_index];
-        m_composite.sources[m_index].deprioritize();
-        return boost::shared_ptr<value_type>( new value_type( select_alpha_channel( source ) ) );
-      }
-    };
-
-    class PyramidGenerator {
-    public:
-      ImageComposite& m_composite;
-      size_t m_index;
-    public:
-      typedef Pyramid value_type;
-      PyramidGenerator( ImageComposite& composite, size_t index ) : m_composite(composite), m_index(index) {}
-      size_t size() const {
-        return size_t( double(m_composite.sources[m_index].size()) * 1.66 ); // 1.66 = (5/4)*(4/3)
-      }
-      boost::shared_ptr<value_type> generate() const;
-    };
-
-    friend class PyramidGenerator;
-
     std::vector<BBox2i > bboxes;
     BBox2i view_bbox, data_bbox;
-    int mindim, levels;
+    int mindim, levels, m_max_levels;
     bool m_draft_mode;
     bool m_fill_holes;
-    bool m_reuse_masks;
-    Cache& m_cache;
     std::vector<ImageViewRef<pixel_type> > sourcerefs;
-    std::vector<Cache::Handle<SourceGenerator> > sources;
-    std::vector<Cache::Handle<AlphaGenerator> > alphas;
-    std::vector<Cache::Handle<PyramidGenerator> > pyramids;
-
-    void generate_masks( ProgressCallback const& progress_callback ) const;
+    RTree m_index;
 
     ImageView<pixel_type> blend_patch( BBox2i const& patch_bbox ) const;
     ImageView<pixel_type> draft_patch( BBox2i const& patch_bbox ) const;
@@ -215,7 +187,7 @@ namespace mosaic {
   public:
     typedef pixel_type result_type;
 
-    ImageComposite() : m_draft_mode(false), m_fill_holes(false), m_reuse_masks(false), m_cache(vw_system_cache()) {}
+    ImageComposite() : m_max_levels(6), m_draft_mode(false), m_fill_holes(false) {}
 
     void insert( ImageViewRef<pixel_type> const& image, int x, int y );
 
@@ -231,7 +203,10 @@ namespace mosaic {
 
     void set_fill_holes( bool fill_holes ) { m_fill_holes = fill_holes; }
 
-    void set_reuse_masks( bool reuse_masks ) { m_reuse_masks = reuse_masks; }
+    /// Limits the depth of the blending pyramid, and with it the
+    /// padding each output patch needs: about 3*2^levels pixels on
+    /// every side.  Set this before calling prepare().
+    void set_max_levels( int max_levels ) { m_max_levels = max_levels; }
 
     int32 cols() const {
       return view_bbox.width();
@@ -309,92 +284,9 @@ namespace mosaic {
 } // namespace vw
 
 
-template <class PixelT>
-void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback const& progress_callback ) const {
-  vw_out(DebugMessage, "mosaic") << "Generating masks..." << std::endl;
-  std::vector<Cache::Handle<GrassfireGenerator> > grassfires;
-  for( unsigned i=0; i<sources.size(); ++i )
-    grassfires.push_back( m_cache.insert( GrassfireGenerator( sourcerefs[i] ) ) );
-  for( unsigned p1=0; p1<sources.size(); ++p1 ) {
-    ImageView<float> mask = copy( *(grassfires[p1]) );
-    for( unsigned p2=0; p2<sources.size(); ++p2 ) {
-      if( p1 == p2 ) continue;
-      int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
-      int oy = bboxes[p2].min().y() - bboxes[p1].min().y();
-      if( ! ( ox >= bboxes[p1].width() ||
-              oy >= bboxes[p1].height() ||
-              -ox >= bboxes[p2].width() ||
-              -oy >= bboxes[p2].height() ) )
-      {
-        ImageView<float> other = *grassfires[p2];
-        int left = std::max( ox, 0 );
-        int top = std::max( oy, 0 );
-        int right = std::min( bboxes[p2].width()+ox, bboxes[p1].width() );
-        int bottom = std::min( bboxes[p2].height()+oy, bboxes[p1].height() );
-        for( int j=top; j<bottom; ++j ) {
-          for( int i=left; i<right; ++i ) {
-            if( ( other(i-ox,j-oy) > mask(i,j) ) ||
-                ( other(i-ox,j-oy) == mask(i,j) && p2 > p1 ) )
-              mask(i,j) = 0;
-          }
-        }
-      }
-      progress_callback.report_fractional_progress( double(p1*(sources.size()+1)+p2+1), double((sources.size()+1)*sources.size()) );
-    }
-    mask = threshold( mask );
-    std::ostringstream filename;
-    filename << "mask." << p1 << ".png";
-    write_image( filename.str(), mask );
-    progress_callback.report_fractional_progress( double((p1+1)*(sources.size()+1)), double((sources.size()+1)*sources.size()) );
-  }
-  // report_finished() called by prepare(), so don't call it here
-}
-
-
-template <class PixelT>
-boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::PyramidGenerator::generate() const {
-  vw_out(DebugMessage, "mosaic") << "ImageComposite generating pyramid " << m_index << std::endl;
-  boost::shared_ptr<Pyramid> ptr( new Pyramid );
-  ImageView<pixel_type> source = copy(*m_composite.sources[m_index]);
-  m_composite.sources[m_index].deprioritize();
-
-  // This is sort of a kluge: the hole-filling algorithm currently
-  // doesn't cope well with partially-transparent source pixels.
-  if( m_composite.m_fill_holes ) source /= select_alpha_channel(source);
-
-  PositionedImage<pixel_type> image_high( m_composite.view_bbox.width(), m_composite.view_bbox.height(), source, m_composite.bboxes[m_index] );
-  PositionedImage<pixel_type> image_low = image_high.reduce();
-  ImageView<channel_type> mask_image;
-
-  std::ostringstream mask_filename;
-  mask_filename << "mask." << m_index << ".png";
-  read_image( mask_image, mask_filename.str() );
-  PositionedImage<channel_type> mask( m_composite.view_bbox.width(), m_composite.view_bbox.height(), mask_image, m_composite.bboxes[m_index] );
-
-  for( int l=0; l<m_composite.levels; ++l ) {
-    PositionedImage<pixel_type> diff = image_high;
-    if( l > 0 ) mask = mask.reduce();
-    if( l < m_composite.levels-1 ) {
-      PositionedImage<pixel_type> next_image_low = image_low.reduce();
-      image_low.unpremultiply();
-      diff.subtract_expanded( image_low );
-      image_high = image_low;
-      image_low = next_image_low;
-    }
-    diff *= mask;
-    ptr->images.push_back( diff );
-    ptr->masks.push_back( mask );
-  }
-  return ptr;
-}
-
-
 template <class PixelT>
 void vw::mosaic::ImageComposite<PixelT>::insert( ImageViewRef<pixel_type> const& image, int x, int y ) {
   sourcerefs.push_back( image );
-  sources.push_back( m_cache.insert( SourceGenerator( image ) ) );
-  alphas.push_back( m_cache.insert( AlphaGenerator( *this, pyramids.size() ) ) );
-  pyramids.push_back( m_cache.insert( PyramidGenerator( *this, pyramids.size() ) ) );
 
   int cols = image.cols(), rows = image.rows();
   BBox2i image_bbox( Vector2i(x, y), Vector2i(x+cols, y+rows) );
@@ -415,16 +307,15 @@ void vw::mosaic::ImageComposite<PixelT>::insert( ImageViewRef<pixel_type> const&
 template <class PixelT>
 void vw::mosaic::ImageComposite<PixelT>::prepare( vw::ProgressCallback const& progress_callback ) {
   // Translate bboxes to origin
-  for( unsigned i=0; i<sources.size(); ++i )
+  for( unsigned i=0; i<bboxes.size(); ++i )
     bboxes[i] -= view_bbox.min();
   data_bbox -= view_bbox.min();
 
   levels = (int) floorf( logf( float(mindim)/2.0f ) / logf(2.0f) ) - 1;
+  if( levels > m_max_levels ) levels = m_max_levels;
   if( levels < 1 ) levels = 1;
 
-  if( !m_draft_mode && !m_reuse_masks ) {
-    generate_masks( progress_callback );
-  }
+  m_index.build( bboxes );
   progress_callback.report_finished();
 }
 
@@ -480,23 +371,82 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
     padded_bbox.max().y() = 2*padded_bbox.max().y();
   }
 
-  // Make a list of the images whose bounding boxes permit them to
-  // impact the patch, prioritizing ones that are already in memory.
-  std::list<unsigned> image_list;
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! padded_bbox.intersects( bboxes[p] ) ) continue;
-    if( ! pyramids[p].valid() ) image_list.push_back( p );
-    else image_list.push_front( p );
+  // Source pixels farther than the pyramid's reach from the padded
+  // bbox are cropped away.  Their absence only disturbs the reduced
+  // images near the crop edges, a few pixels per level, and never
+  // reaches the padded bbox.
+  BBox2i pyramid_bbox = padded_bbox;
+  pyramid_bbox.expand( 3 << levels );
+
+  // The masks assign each pixel to the source it lies deepest inside.
+  // Depths are capped, so they can be computed exactly over the
+  // pyramid bbox from a window only the cap larger.
+  const int32 cap = 1 << levels;
+  BBox2i mask_bbox = pyramid_bbox;
+  mask_bbox.expand( cap );
+  std::vector<size_t> candidates;
+  m_index.intersect( mask_bbox, candidates );
+
+  std::vector<ImageView<pixel_type> > windows( candidates.size() );
+  std::vector<BBox2i> window_bboxes( candidates.size() );
+  ImageView<int32> best_depth( pyramid_bbox.width(), pyramid_bbox.height() );
+  ImageView<int32> best_source( pyramid_bbox.width(), pyramid_bbox.height() );
+  fill( best_source, -1 );
+  for( size_t k=0; k<candidates.size(); ++k ) {
+    size_t p = candidates[k];
+    window_bboxes[k] = mask_bbox;
+    window_bboxes[k].crop( bboxes[p] );
+    windows[k] = crop( sourcerefs[p], window_bboxes[k] - bboxes[p].min() );
+
+    ImageView<int32> depth;
+    capped_grassfire( select_alpha_channel( windows[k] ), window_bboxes[k], bboxes[p], cap, depth );
+    BBox2i overlap = pyramid_bbox;
+    overlap.crop( bboxes[p] );
+    for( int32 j=overlap.min().y(); j<overlap.max().y(); ++j ) {
+      for( int32 i=overlap.min().x(); i<overlap.max().x(); ++i ) {
+        int32 d = depth( i-window_bboxes[k].min().x(), j-window_bboxes[k].min().y() );
+        int32& best = best_depth( i-pyramid_bbox.min().x(), j-pyramid_bbox.min().y() );
+        if( d > 0 && d >= best ) {
+          best = d;
+          best_source( i-pyramid_bbox.min().x(), j-pyramid_bbox.min().y() ) = int32(k);
+        }
+      }
+    }
   }
 
   // Add each source image pyramid to the blend pyramid.
-  std::list<unsigned>::iterator ili=image_list.begin(), ilend=image_list.end();
-  for( ; ili!=ilend; ++ili ) {
-    unsigned p = *ili;
-    boost::shared_ptr<Pyramid> pyr = pyramids[p];
+  for( size_t k=0; k<candidates.size(); ++k ) {
+    BBox2i source_bbox = pyramid_bbox;
+    source_bbox.crop( window_bboxes[k] );
+    if( source_bbox.empty() ) continue;
+    ImageView<pixel_type> source = crop( windows[k], source_bbox - window_bboxes[k].min() );
+
+    // This is sort of a kluge: the hole-filling algorithm currently
+    // doesn't cope well with partially-transparent source pixels.
+    if( m_fill_holes ) source /= select_alpha_channel(source);
+
+    ImageView<channel_type> mask_image( source_bbox.width(), source_bbox.height() );
+    for( int32 j=0; j<source_bbox.height(); ++j )
+      for( int32 i=0; i<source_bbox.width(); ++i )
+        if( best_source( source_bbox.min().x()-pyramid_bbox.min().x()+i, source_bbox.min().y()-pyramid_bbox.min().y()+j ) == int32(k) )
+          mask_image(i,j) = ChannelRange<channel_type>::max();
+
+    PositionedImage<pixel_type> image_high( view_bbox.width(), view_bbox.height(), source, source_bbox );
+    PositionedImage<pixel_type> image_low = image_high.reduce();
+    PositionedImage<channel_type> mask( view_bbox.width(), view_bbox.height(), mask_image, source_bbox );
     for( int l=0; l<levels; ++l ) {
-      pyr->images[l].addto( sum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
-      pyr->masks[l].addto( msum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
+      PositionedImage<pixel_type> diff = image_high;
+      if( l > 0 ) mask = mask.reduce();
+      if( l < levels-1 ) {
+        PositionedImage<pixel_type> next_image_low = image_low.reduce();
+        image_low.unpremultiply();
+        diff.subtract_expanded( image_low );
+        image_high = image_low;
+        image_low = next_image_low;
+      }
+      diff *= mask;
+      diff.addto( sum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
+      mask.addto( msum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
     }
   }
 
@@ -519,22 +469,17 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
   }
   else {
 
-    // Trim to the maximal source alpha, reloading images if needed
+    // Trim to the maximal source alpha
     ImageView<channel_type> alpha( patch_bbox.width(), patch_bbox.height() );
-    for( unsigned p=0; p<sources.size(); ++p ) {
-      if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
-
-      ImageView<channel_type> source_alpha = *alphas[p];
-
+    for( size_t k=0; k<candidates.size(); ++k ) {
       BBox2i overlap = patch_bbox;
-      overlap.crop( bboxes[p] );
+      overlap.crop( window_bboxes[k] );
+      if( overlap.empty() ) continue;
       for( int j=0; j<overlap.height(); ++j ) {
         for( int i=0; i<overlap.width(); ++i ) {
-          if( source_alpha( overlap.min().x()+i-bboxes[p].min().x(), overlap.min().y()+j-bboxes[p].min().y() ) >
-              alpha( overlap.min().x()+i-patch_bbox.min().x(), overlap.min().y()+j-patch_bbox.min().y() ) ) {
-            alpha( overlap.min().x()+i-patch_bbox.min().x(), overlap.min().y()+j-patch_bbox.min().y() ) =
-              source_alpha( overlap.min().x()+i-bboxes[p].min().x(), overlap.min().y()+j-bboxes[p].min().y() );
-          }
+          channel_type source_alpha = alpha_channel( windows[k]( overlap.min().x()+i-window_bboxes[k].min().x(), overlap.min().y()+j-window_bboxes[k].min().y() ) );
+          channel_type& a = alpha( overlap.min().x()+i-patch_bbox.min().x(), overlap.min().y()+j-patch_bbox.min().y() );
+          if( source_alpha > a ) a = source_alpha;
         }
       }
     }
@@ -556,7 +501,7 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::draft_patch( BBox2i co
   ImageView<pixel_type> composite(patch_bbox.width(),patch_bbox.height());
 
   // Add each image to the composite.
-  for( unsigned p=0; p<sources.size(); ++p ) {
+  for( unsigned p=0; p<sourcerefs.size(); ++p ) {
     if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
     BBox2i bbox = patch_bbox;
     bbox.crop( bboxes[p] );
@@ -143,6 +143,7 @@ namespace mosaic {
 
   void KMLQuadTreeConfig::configure( QuadTreeGenerator& qtree ) const {
     qtree.set_cull_images( true );
+    qtree.set_link_duplicates( true );
     qtree.set_file_type( "auto" );
     qtree.set_image_path_func( QuadTreeGenerator::named_tiered_image_path() );
     qtree.set_metadata_func( boost::bind(&KMLQuadTreeConfigData::metadata_func,m_data,_1,_2) );
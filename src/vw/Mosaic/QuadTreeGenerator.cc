@@ -9,8 +9,14 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
 #include <vw/FileIO/DiskImageResource.h>
 
 namespace vw {
@@ -67,6 +73,98 @@ namespace mosaic {
     return boost::shared_ptr<DstImageResource>( DiskImageResource::create( info.filepath+info.filetype, format ) );
   }
 
+  void QuadTreeGenerator::TileWriter::write( boost::function<void()> const& func ) {
+    Future<void> done = m_queue.submit( func );
+    Mutex::Lock lock( m_mutex );
+    m_pending.push_back( done );
+    while( ! m_pending.empty() && ( m_pending.size() > m_max_pending || m_pending.front().is_ready() ) ) {
+      Future<void> oldest = m_pending.front();
+      m_pending.pop_front();
+      oldest.get();
+    }
+  }
+
+  void QuadTreeGenerator::TileWriter::finish() {
+    Mutex::Lock lock( m_mutex );
+    while( ! m_pending.empty() ) {
+      Future<void> oldest = m_pending.front();
+      m_pending.pop_front();
+      oldest.get();
+    }
+  }
+
+  // The tile's content key joins its file type and size with two
+  // independent 64-bit hashes of its pixel data, which make a false
+  // match vanishingly unlikely.
+  bool QuadTreeGenerator::reuse_tile( TileInfo const& info, Vector2i const& size, uint8 const* data, size_t bytes ) const {
+    if( ! m_link_duplicates && m_manifest_file.empty() ) return false;
+    uint64 a = 14695981039346656037ULL, b = bytes;
+    for( size_t i=0; i<bytes; i+=8 ) {
+      uint64 word = 0;
+      memcpy( &word, data+i, (std::min)( bytes-i, size_t(8) ) );
+      a = ( a ^ word ) * 1099511628211ULL;
+      b = ( b + word ) * 0x9e3779b97f4a7c15ULL;
+      b ^= b >> 29;
+    }
+    std::ostringstream key;
+    key << info.filetype << ' ' << size.x() << 'x' << size.y() << ' ' << std::hex << a << b;
+
+    std::string filename = info.filepath + info.filetype;
+    fs::path path( filename, fs::native );
+    if( ! m_manifest_file.empty() ) {
+      std::string& entry = m_manifest[filename];
+      bool unchanged = ( entry == key.str() ) && fs::exists( path );
+      entry = key.str();
+      if( unchanged ) {
+        if( m_link_duplicates ) m_tile_files.insert( std::make_pair( key.str(), filename ) );
+        return true;
+      }
+    }
+    if( ! m_link_duplicates ) return false;
+
+    std::map<std::string, std::string>::iterator first = m_tile_files.find( key.str() );
+    try {
+      // The old file may be linked to others, which must not change
+      // with it, so it is replaced rather than overwritten.
+      if( fs::exists( path ) ) fs::remove( path );
+      if( first == m_tile_files.end() ) {
+        m_tile_files[key.str()] = filename;
+        return false;
+      }
+      create_directories( path.branch_path() );
+      fs::create_hard_link( fs::path( first->second, fs::native ), path );
+    }
+    catch( fs::filesystem_error const& ) {
+      return false;
+    }
+    return true;
+  }
+
+  void QuadTreeGenerator::remove_stale_tiles( TileInfo const& info, bool written ) const {
+    std::string types[] = { "." + m_file_type, ".png", ".jpg" };
+    for( int i=0; i<3; ++i ) {
+      std::string filename = info.filepath + types[i];
+      if( written && types[i] == info.filetype ) continue;
+      // Without a manifest, any file there in the dirty region must
+      // be from an earlier run.
+      if( m_manifest.erase( filename ) || m_manifest_file.empty() ) fs::remove( fs::path( filename, fs::native ) );
+    }
+  }
+
+  boost::shared_ptr<SrcImageResource> QuadTreeGenerator::existing_tile( TileInfo const& info ) const {
+    std::vector<std::string> types;
+    if( m_file_type == "auto" ) {
+      types.push_back( ".png" );
+      types.push_back( ".jpg" );
+    }
+    else types.push_back( "." + m_file_type );
+    for( size_t i=0; i<types.size(); ++i ) {
+      if( fs::exists( fs::path( info.filepath + types[i], fs::native ) ) )
+        return boost::shared_ptr<SrcImageResource>( DiskImageResource::open( info.filepath + types[i] ) );
+    }
+    return boost::shared_ptr<SrcImageResource>();
+  }
+
   void QuadTreeGenerator::generate( const ProgressCallback &progress_callback ) {
     ScopedWatch sw("QuadTreeGenerator::generate");
     int32 tree_levels = get_tree_levels();
@@ -74,9 +172,40 @@ namespace mosaic {
     vw_out(DebugMessage, "mosaic") << "Using tile size: " << m_tile_size << " pixels" << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating tile files of type: " << m_file_type << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating quadtree with " << tree_levels << " levels." << std::endl;
+    VW_ASSERT( m_dirty_bbox.empty() || ! m_crop_images,
+               LogicErr() << "QuadTreeGenerator: Cropped tiles cannot be regenerated incrementally." );
+
+    // Each manifest line holds a tile's file name and content key.
+    m_manifest.clear();
+    if( ! m_manifest_file.empty() ) {
+      std::ifstream manifest( m_manifest_file.c_str() );
+      std::string line;
+      while( std::getline( manifest, line ) ) {
+        size_t tab = line.find( '\t' );
+        if( tab != std::string::npos ) m_manifest[line.substr( 0, tab )] = line.substr( tab+1 );
+      }
+    }
 
     BBox2i region_bbox = BBox2i(0,0,m_tile_size,m_tile_size) * (1<<(tree_levels-1));
-    m_processor->generate( region_bbox, progress_callback );
+    m_tile_files.clear();
+    if( m_num_threads > 1 ) m_writer.reset( new TileWriter( 4*m_num_threads ) );
+    try {
+      m_processor->generate( region_bbox, progress_callback );
+      if( m_writer ) m_writer->finish();
+    }
+    catch( ... ) {
+      m_writer.reset();
+      throw;
+    }
+    m_writer.reset();
+
+    if( ! m_manifest_file.empty() ) {
+      std::ofstream manifest( m_manifest_file.c_str() );
+      for( std::map<std::string, std::string>::const_iterator it = m_manifest.begin(); it != m_manifest.end(); ++it )
+        manifest << it->first << '\t' << it->second << '\n';
+      if( ! manifest )
+        vw_throw( IOErr() << "QuadTreeGenerator: Could not write the manifest " << m_manifest_file );
+    }
 
     progress_callback.report_finished();
   }
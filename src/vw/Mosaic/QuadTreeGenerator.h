@@ -14,19 +14,25 @@
 
 #include <vector>
 #include <map>
+#include <list>
 #include <string>
 #include <fstream>
 
 #include <boost/function.hpp>
+#include <boost/bind.hpp>
 
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageIO.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Filter.h>
+#include <vw/Image/BoxReduce.h>
 
 
 namespace vw {
@@ -36,6 +42,11 @@ namespace mosaic {
   // moved somewhere into the Image module.
   template <class PixelT>
   ImageView<PixelT> box_subsample( ImageView<PixelT> const& image, Vector2i const& scale ) {
+    if( scale == Vector2i(2,2) ) {
+      ImageView<PixelT> result( image.cols()/2, image.rows()/2, image.planes() );
+      box_reduce( image, result );
+      return result;
+    }
     std::vector<double> xkernel(scale.x()), ykernel(scale.y());
     for( int x=0; x<scale.x(); ++x ) xkernel[x] = 1.0 / scale.x();
     for( int y=0; y<scale.y(); ++y ) ykernel[y] = 1.0 / scale.y();
@@ -71,9 +82,11 @@ namespace mosaic {
       : m_tree_name( tree_name ),
         m_tile_size( 256 ),
         m_file_type( "png" ),
+        m_num_threads( 1 ),
         m_crop_bbox(),
         m_crop_images( false ),
         m_cull_images( false ),
+        m_link_duplicates( false ),
         m_dimensions( image.impl().cols(), image.impl().rows() ),
         m_processor( new Processor<typename ImageT::pixel_type>( this, image.impl() ) ),
         m_image_path_func( simple_image_path() ),
@@ -125,6 +138,19 @@ namespace mosaic {
       m_tile_size = size;
     }
 
+    int32 get_num_threads() const {
+      return m_num_threads;
+    }
+
+    /// With more than one thread, subtrees are generated concurrently
+    /// and the branch, image path and sparse image check functions
+    /// must be safe to call from several threads at once.  Tiles are
+    /// then written, and their metadata generated, on a thread of
+    /// their own, each after all of its children.
+    void set_num_threads( int32 threads ) {
+      m_num_threads = threads;
+    }
+
     int32 get_tree_levels() const {
       int32 maxdim = (std::max)( m_dimensions.x(), m_dimensions.y() );
       int32 tree_levels = 1 + int32( ceil( log( maxdim/(double)(m_tile_size) ) / log(2.0) ) );
@@ -152,6 +178,44 @@ namespace mosaic {
       m_cull_images = cull;
     }
 
+    bool get_link_duplicates() const {
+      return m_link_duplicates;
+    }
+
+    /// Write each tile whose pixels match those of a tile already
+    /// written with the same file type as a hard link to that tile's
+    /// file, falling back to writing it out where the link fails.
+    /// This assumes the tile resource function writes each tile to
+    /// its filepath plus filetype, as the standard ones do.
+    void set_link_duplicates( bool link ) {
+      m_link_duplicates = link;
+    }
+
+    BBox2i const& get_dirty_bbox() const {
+      return m_dirty_bbox;
+    }
+
+    /// Regenerate only the tiles covering the given region of the
+    /// source, which must already have been generated once, reading
+    /// the other tiles their parents need back from their files.  An
+    /// empty region, the default, regenerates every tile.  Cropped
+    /// tiles cannot be read back in place, so this does not work with
+    /// set_crop_images().
+    void set_dirty_bbox( BBox2i const& bbox ) {
+      m_dirty_bbox = bbox;
+    }
+
+    std::string const& get_manifest_file() const {
+      return m_manifest_file;
+    }
+
+    /// Keep a hash of each tile written in the given file, and leave
+    /// alone any tile file whose contents would not change.  Empty,
+    /// the default, keeps no manifest.
+    void set_manifest_file( std::string const& filename ) {
+      m_manifest_file = filename;
+    }
+
     void set_image_path_func( image_path_func_type image_path_func ) {
       m_image_path_func = image_path_func;
     }
@@ -220,10 +284,62 @@ namespace mosaic {
     };
 
   protected:
+    // Writes tiles in the order they are queued, on a thread of its
+    // own, with a bounded number of them waiting.
+    class TileWriter {
+      FifoWorkQueue m_queue;
+      Mutex m_mutex;
+      std::list<Future<void> > m_pending;
+      size_t m_max_pending;
+    public:
+      TileWriter( size_t max_pending ) : m_queue( 1 ), m_max_pending( max_pending ) {}
+      // Queues a write, first waiting for the oldest if too many are
+      // pending, and rethrows the error of any that failed.
+      void write( boost::function<void()> const& func );
+      // Waits for every queued write.
+      void finish();
+    };
+
+    // Decides whether a tile need not be written, because the
+    // manifest shows its file is already up to date or because it
+    // could be linked to the file of an earlier tile with the same
+    // file type and pixel data.  Otherwise remembers the tile for
+    // later ones.  Tiles are written one at a time, so this needs no
+    // locking.
+    bool reuse_tile( TileInfo const& info, Vector2i const& size, uint8 const* data, size_t bytes ) const;
+
+    // Removes the tile's files from earlier runs other than the one
+    // just written, if any, such as one left when it became empty.
+    void remove_stale_tiles( TileInfo const& info, bool written ) const;
+
+    // Opens the tile's file from an earlier run, if there is one.
+    boost::shared_ptr<SrcImageResource> existing_tile( TileInfo const& info ) const;
+
+    template <class PixelT>
+    static void write_tile( QuadTreeGenerator const* qtree, TileInfo const& info, ImageView<PixelT> const& image ) {
+      if( image ) {
+        ScopedWatch sw("QuadTreeGenerator::write_tile");
+        size_t bytes = size_t(image.cols()) * image.rows() * image.planes() * sizeof(PixelT);
+        if( ! qtree->reuse_tile( info, Vector2i( image.cols(), image.rows() ), (uint8 const*)image.data(), bytes ) ) {
+          boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, image.format() );
+          write_image( *r, image );
+        }
+      }
+      if( ! qtree->m_manifest_file.empty() || ! qtree->m_dirty_bbox.empty() ) qtree->remove_stale_tiles( info, bool(image) );
+      if( qtree->m_metadata_func ) qtree->m_metadata_func( *qtree, info );
+    }
+
     template <class PixelT>
     class Processor : public ProcessorBase {
       ImageViewRef<PixelT> m_source;
 
+      // The subtrees being generated in parallel, by root name.
+      typedef std::map<std::string, Future<ImageView<PixelT> > > subtree_map;
+
+      ImageView<PixelT> generate_subtree( std::string const& name, BBox2i const& region_bbox ) {
+        return generate_branch( name, region_bbox, ProgressCallback::dummy_instance(), 0 );
+      }
+
     public:
       template <class ImageT>
       Processor( QuadTreeGenerator *qtree, ImageT const& source )
@@ -231,13 +347,51 @@ namespace mosaic {
       {}
 
       void generate( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
-        generate_branch( "", region_bbox, progress_callback );
+        int32 threads = qtree->m_num_threads;
+        if( threads <= 1 ) {
+          generate_branch( "", region_bbox, progress_callback, 0 );
+          return;
+        }
+
+        // Split the tree at the shallowest level with a few subtrees
+        // per thread, and generate those concurrently.  Each worker
+        // holds one tile per level of its subtree.  The levels above
+        // are then assembled here as the subtrees finish.
+        std::vector<std::pair<std::string,BBox2i> > roots( 1, std::make_pair( std::string(), region_bbox ) );
+        while( roots.size() < 4*size_t(threads) ) {
+          std::vector<std::pair<std::string,BBox2i> > next;
+          bool deeper = false;
+          for( unsigned i=0; i<roots.size(); ++i ) {
+            std::vector<std::pair<std::string,BBox2i> > children = qtree->m_branch_func( *qtree, roots[i].first, roots[i].second );
+            if( children.empty() ) next.push_back( roots[i] );
+            else next.insert( next.end(), children.begin(), children.end() );
+            deeper = deeper || ! children.empty();
+          }
+          if( ! deeper ) break;
+          roots.swap( next );
+        }
+
+        FifoWorkQueue queue( threads );
+        subtree_map subtrees;
+        for( unsigned i=0; i<roots.size(); ++i )
+          subtrees[roots[i].first] = queue.submit( boost::bind( &Processor::generate_subtree, this, roots[i].first, roots[i].second ) );
+        generate_branch( "", region_bbox, progress_callback, &subtrees );
       }
 
-      ImageView<PixelT> generate_branch( std::string const& name, BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+      ImageView<PixelT> generate_branch( std::string const& name, BBox2i const& region_bbox, const ProgressCallback &progress_callback, subtree_map *subtrees ) {
         progress_callback.report_progress(0);
         progress_callback.abort_if_requested();
 
+        if( subtrees ) {
+          typename subtree_map::iterator subtree = subtrees->find( name );
+          if( subtree != subtrees->end() ) {
+            ImageView<PixelT> image = subtree->second.get();
+            subtrees->erase( subtree );
+            progress_callback.report_progress(1);
+            return image;
+          }
+        }
+
         ImageView<PixelT> image;
         TileInfo info;
         info.name = name;
@@ -256,6 +410,15 @@ namespace mosaic {
 
         if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) return image;
 
+        // Outside the dirty region the tiles from the last run stand.
+        if( ! qtree->m_dirty_bbox.empty() && ! qtree->m_dirty_bbox.intersects( info.region_bbox ) ) {
+          info.filepath = qtree->m_image_path_func( *qtree, info.name );
+          boost::shared_ptr<SrcImageResource> r = qtree->existing_tile( info );
+          if( r ) read_image( image, *r );
+          progress_callback.report_progress(1);
+          return image;
+        }
+
         Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
 
         std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree,info.name,info.region_bbox);
@@ -278,10 +441,12 @@ namespace mosaic {
             double child_area = (double) image_bbox.width() * image_bbox.height();
             double progress = progress_callback.progress();
             SubProgressCallback spc( progress_callback, progress, progress + child_area/total_area );
-            ImageView<PixelT> child = generate_branch(children[i].first, children[i].second, spc);
+            ImageView<PixelT> child = generate_branch(children[i].first, children[i].second, spc, subtrees);
             if( ! child ) continue;
             BBox2i dst_bbox = elem_quot( children[i].second - info.region_bbox.min(), scale );
-            crop(image,dst_bbox) = box_subsample( child, elem_quot(qtree->m_tile_size,dst_bbox.size()) );
+            Vector2i child_scale = elem_quot( qtree->m_tile_size, dst_bbox.size() );
+            if( child_scale == Vector2i(2,2) ) box_reduce( child, image, dst_bbox.min().x(), dst_bbox.min().y() );
+            else crop(image,dst_bbox) = box_subsample( child, child_scale );
           }
         }
 
@@ -291,7 +456,12 @@ namespace mosaic {
           if( PixelHasAlpha<PixelT>::value )
             data_bbox.crop( nonzero_data_bounding_box( image ) );
           if( data_bbox.width() != qtree->m_tile_size || data_bbox.height() != qtree->m_tile_size ) {
-            if( data_bbox.empty() ) cropped_image.reset();
+            if( data_bbox.empty() ) {
+              // An empty tile is neither written nor reduced into its
+              // parent.
+              cropped_image.reset();
+              image.reset();
+            }
             else if( qtree->m_crop_images ) {
               cropped_image = crop( image, data_bbox );
             }
@@ -308,12 +478,10 @@ namespace mosaic {
         }
 
         info.filepath = qtree->m_image_path_func( *qtree, info.name );
-        if( cropped_image ) {
-          ScopedWatch sw("QuadTreeGenerator::write_tile");
-          boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, cropped_image.format() );
-          write_image( *r, cropped_image );
-        }
-        if( qtree->m_metadata_func ) qtree->m_metadata_func( *qtree, info );
+        if( qtree->m_writer )
+          qtree->m_writer->write( boost::bind( &QuadTreeGenerator::write_tile<PixelT>, qtree, info, cropped_image ) );
+        else
+          write_tile( qtree, info, cropped_image );
 
         progress_callback.report_progress(1);
         return image;
@@ -325,11 +493,20 @@ namespace mosaic {
     std::string m_tree_name;
     int32 m_tile_size;
     std::string m_file_type;
+    int32 m_num_threads;
     BBox2i m_crop_bbox;
     bool m_crop_images;
     bool m_cull_images;
+    bool m_link_duplicates;
+    BBox2i m_dirty_bbox;
+    std::string m_manifest_file;
     Vector2i m_dimensions;
     boost::shared_ptr<ProcessorBase> m_processor;
+    boost::shared_ptr<TileWriter> m_writer;
+    // The file of the first tile written with each content key.
+    mutable std::map<std::string, std::string> m_tile_files;
+    // The content key of each tile file in the manifest.
+    mutable std::map<std::string, std::string> m_manifest;
 
     image_path_func_type m_image_path_func;
     branch_func_type m_branch_func;
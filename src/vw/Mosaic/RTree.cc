@@ -0,0 +1,103 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/RTree.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+  // Orders boxes by their center along one axis.
+  struct CenterLess {
+    std::vector<vw::BBox2i> const& boxes;
+    int axis;
+    CenterLess( std::vector<vw::BBox2i> const& boxes, int axis ) : boxes(boxes), axis(axis) {}
+    bool operator()( size_t a, size_t b ) const {
+      return boxes[a].min()[axis] + boxes[a].max()[axis] < boxes[b].min()[axis] + boxes[b].max()[axis];
+    }
+  };
+
+  // The sort-tile-recursive order of the boxes: sorted by x into
+  // vertical slices of about sqrt(n/capacity) nodes each, and each
+  // slice sorted by y.  Consecutive runs of the result are packed
+  // into nodes.
+  std::vector<size_t> str_order( std::vector<vw::BBox2i> const& boxes, size_t capacity ) {
+    std::vector<size_t> order( boxes.size() );
+    for( size_t i=0; i<order.size(); ++i ) order[i] = i;
+    size_t num_nodes = (boxes.size() + capacity - 1) / capacity;
+    size_t slice_size = size_t( ceil( sqrt( double(num_nodes) ) ) ) * capacity;
+    std::stable_sort( order.begin(), order.end(), CenterLess( boxes, 0 ) );
+    for( size_t s=0; s<order.size(); s+=slice_size )
+      std::stable_sort( order.begin()+s, order.begin()+std::min( s+slice_size, order.size() ), CenterLess( boxes, 1 ) );
+    return order;
+  }
+
+}
+
+const size_t vw::mosaic::RTree::node_capacity;
+
+void vw::mosaic::RTree::build( std::vector<BBox2i> const& boxes ) {
+  m_nodes.clear();
+  m_items.clear();
+  m_boxes.clear();
+  if( boxes.empty() ) return;
+
+  // The leaves.
+  m_items = str_order( boxes, node_capacity );
+  m_boxes.resize( m_items.size() );
+  for( size_t i=0; i<m_items.size(); ++i ) m_boxes[i] = boxes[m_items[i]];
+  for( size_t s=0; s<m_items.size(); s+=node_capacity ) {
+    Node node;
+    node.first = s;
+    node.count = std::min( node_capacity, m_items.size()-s );
+    node.leaf = true;
+    for( size_t i=0; i<node.count; ++i )
+      node.bbox.grow( m_boxes[s+i] );
+    m_nodes.push_back( node );
+  }
+
+  // Each level of interior nodes packs the one below it, which is
+  // first put in order so that every node's children are contiguous.
+  size_t begin = 0, end = m_nodes.size();
+  while( end - begin > 1 ) {
+    std::vector<BBox2i> level_boxes( end - begin );
+    for( size_t i=begin; i<end; ++i ) level_boxes[i-begin] = m_nodes[i].bbox;
+    std::vector<size_t> order = str_order( level_boxes, node_capacity );
+    std::vector<Node> level( end - begin );
+    for( size_t i=0; i<order.size(); ++i ) level[i] = m_nodes[begin+order[i]];
+    std::copy( level.begin(), level.end(), m_nodes.begin()+begin );
+
+    for( size_t s=begin; s<end; s+=node_capacity ) {
+      Node node;
+      node.first = s;
+      node.count = std::min( node_capacity, end-s );
+      node.leaf = false;
+      for( size_t i=0; i<node.count; ++i )
+        node.bbox.grow( m_nodes[s+i].bbox );
+      m_nodes.push_back( node );
+    }
+    begin = end;
+    end = m_nodes.size();
+  }
+}
+
+void vw::mosaic::RTree::intersect( BBox2i const& bbox, std::vector<size_t>& result ) const {
+  if( m_nodes.empty() ) return;
+  size_t start = result.size();
+  std::vector<size_t> stack( 1, m_nodes.size()-1 );
+  while( ! stack.empty() ) {
+    Node const& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if( ! node.bbox.intersects( bbox ) ) continue;
+    for( size_t i=node.first; i<node.first+node.count; ++i ) {
+      if( ! node.leaf ) stack.push_back( i );
+      else if( m_boxes[i].intersects( bbox ) ) result.push_back( m_items[i] );
+    }
+  }
+  std::sort( result.begin()+start, result.end() );
+}
@@ -0,0 +1,56 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file RTree.h
+///
+/// A static spatial index over a set of bounding boxes.
+///
+#ifndef __VW_MOSAIC_RTREE_H__
+#define __VW_MOSAIC_RTREE_H__
+
+#include <vector>
+
+#include <vw/Math/BBox.h>
+
+namespace vw {
+namespace mosaic {
+
+  /// An R-tree over a fixed set of integer bounding boxes, bulk-loaded
+  /// by sort-tile-recursive packing.  It answers which of the boxes
+  /// intersect a query box in time logarithmic in the number of boxes
+  /// plus the number of results.  Rebuild it when the boxes change.
+  class RTree {
+  public:
+    static const size_t node_capacity = 8;
+
+  private:
+    struct Node {
+      BBox2i bbox;
+      size_t first, count;  // Children, or entries of m_items for a leaf
+      bool leaf;
+    };
+    std::vector<Node> m_nodes;   // Level by level from the leaves; the root is last
+    std::vector<size_t> m_items;
+    std::vector<BBox2i> m_boxes; // The box of each entry of m_items
+
+  public:
+    RTree() {}
+    explicit RTree( std::vector<BBox2i> const& boxes ) { build( boxes ); }
+
+    /// Index the given boxes, replacing any previous contents.
+    void build( std::vector<BBox2i> const& boxes );
+
+    /// Append the indices of the boxes that intersect the query box to
+    /// the result, in increasing order.
+    void intersect( BBox2i const& bbox, std::vector<size_t>& result ) const;
+
+    size_t size() const { return m_items.size(); }
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_RTREE_H__
@@ -36,6 +36,7 @@ namespace mosaic {
   void TMSQuadTreeConfig::configure( QuadTreeGenerator& qtree ) const {
     qtree.set_image_path_func( &image_path );
     qtree.set_cull_images( true );
+    qtree.set_link_duplicates( true );
   }
 
   cartography::GeoReference TMSQuadTreeConfig::output_georef(uint32 xresolution, uint32 yresolution) {
@@ -39,3 +39,63 @@ TEST(TestImageComposite, Basic) {
       EXPECT_EQ(2, c(col, row)) << "at (" << col << "," << row << ")";
   }
 }
+
+ImageView<PixelRGBA<float> > make_ramp(int32 cols, int32 rows, float slope) {
+  ImageView<PixelRGBA<float> > img(cols,rows);
+  for (int32 row = 0; row < rows; ++row)
+    for (int32 col = 0; col < cols; ++col)
+      img(col,row) = PixelRGBA<float>(slope*col/cols, 1-slope*row/rows, 0.5f, 1);
+  // A transparent hole
+  for (int32 row = rows/3; row < rows/2; ++row)
+    for (int32 col = cols/3; col < cols/2; ++col)
+      img(col,row) = PixelRGBA<float>();
+  return img;
+}
+
+TEST(TestImageComposite, BlendTilesMatch) {
+  ImageComposite<PixelRGBA<float> > c;
+  c.insert(make_ramp(50,45,1), 0, 0);
+  c.insert(make_ramp(60,40,2), 30, 20);
+  c.insert(make_ramp(45,55,3), 10, 35);
+  c.insert(make_ramp(40,40,4), 70, 5);
+  c.prepare();
+
+  // Each patch is blended from its own padded crops of the sources,
+  // and must agree with a single patch covering everything.
+  ImageView<PixelRGBA<float> > whole = c.generate_patch(BBox2i(0,0,c.cols(),c.rows()));
+  for (int32 y = 0; y < c.rows(); y += 16) {
+    for (int32 x = 0; x < c.cols(); x += 16) {
+      BBox2i bbox(x, y, std::min(16, c.cols()-x), std::min(16, c.rows()-y));
+      ImageView<PixelRGBA<float> > patch = c.generate_patch(bbox);
+      for (int32 row = 0; row < bbox.height(); ++row)
+        for (int32 col = 0; col < bbox.width(); ++col)
+          for (int32 ch = 0; ch < 4; ++ch)
+            EXPECT_NEAR(whole(x+col,y+row)[ch], patch(col,row)[ch], 1e-5)
+              << "at (" << x+col << "," << y+row << ")";
+    }
+  }
+}
+
+TEST(TestImageComposite, BlendNoSeams) {
+  ImageView<PixelRGBA<float> > img(40,40);
+  fill(img, PixelRGBA<float>(0.25f, 0.5f, 0.75f, 1));
+  ImageComposite<PixelRGBA<float> > c;
+  c.insert(img, 0, 0);
+  c.insert(img, 25, 10);
+  c.insert(img, 10, 30);
+  c.prepare();
+
+  for (int32 y = 0; y < c.rows(); y += 16) {
+    for (int32 x = 0; x < c.cols(); x += 16) {
+      BBox2i bbox(x, y, std::min(16, c.cols()-x), std::min(16, c.rows()-y));
+      ImageView<PixelRGBA<float> > patch = c.generate_patch(bbox);
+      for (int32 row = 0; row < bbox.height(); ++row) {
+        for (int32 col = 0; col < bbox.width(); ++col) {
+          if (patch(col,row).a() == 0) continue;
+          EXPECT_NEAR(0.25, patch(col,row).r(), 1e-5) << "at (" << x+col << "," << y+row << ")";
+          EXPECT_NEAR(0.75, patch(col,row).b(), 1e-5) << "at (" << x+col << "," << y+row << ")";
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,213 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+#include <vw/Image/ImageResource.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+#include <fstream>
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+using namespace std;
+using namespace vw;
+using namespace vw::mosaic;
+
+// Records the tiles written and the order of the metadata calls.
+struct TileRecord {
+  Mutex mutex;
+  map<string, ImageView<PixelRGBA<uint8> > > tiles;
+  vector<string> metadata;
+};
+
+class RecordingResource : public DstImageResource {
+  TileRecord& m_record;
+  string m_name, m_path;
+public:
+  RecordingResource( TileRecord& record, string const& name, string const& path = string() )
+    : m_record(record), m_name(name), m_path(path) {}
+  void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+    ImageView<PixelRGBA<uint8> > tile( bbox.width(), bbox.height() );
+    convert( tile.buffer(), buf );
+    Mutex::Lock lock( m_record.mutex );
+    m_record.tiles[m_name] = tile;
+    if( ! m_path.empty() ) {
+      fs::create_directories( fs::path( m_path ).parent_path() );
+      std::ofstream( m_path.c_str() ) << m_name;
+    }
+  }
+  bool has_block_write() const { return false; }
+  bool has_nodata_write() const { return false; }
+  void flush() {}
+};
+
+static boost::shared_ptr<DstImageResource> record_tile( TileRecord* record, QuadTreeGenerator const&,
+                                                        QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) {
+  return boost::shared_ptr<DstImageResource>( new RecordingResource( *record, info.name ) );
+}
+
+// Also writes the tile's name to its file.
+static boost::shared_ptr<DstImageResource> record_tile_file( TileRecord* record, QuadTreeGenerator const&,
+                                                             QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) {
+  return boost::shared_ptr<DstImageResource>( new RecordingResource( *record, info.name, info.filepath + info.filetype ) );
+}
+
+static void record_metadata( TileRecord* record, QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+  Mutex::Lock lock( record->mutex );
+  record->metadata.push_back( info.name );
+}
+
+static void generate( ImageView<PixelRGBA<uint8> > const& image, int32 threads, TileRecord& record ) {
+  QuadTreeGenerator qtree( image );
+  qtree.set_tile_size( 16 );
+  qtree.set_num_threads( threads );
+  qtree.set_tile_resource_func( boost::bind( &record_tile, &record, _1, _2, _3 ) );
+  qtree.set_metadata_func( boost::bind( &record_metadata, &record, _1, _2 ) );
+  qtree.generate();
+}
+
+TEST(TestQuadTreeGenerator, ParallelMatchesSerial) {
+  ImageView<PixelRGBA<uint8> > image( 150, 100 );
+  for( int32 row = 0; row < image.rows(); ++row )
+    for( int32 col = 0; col < image.cols(); ++col )
+      image(col,row) = PixelRGBA<uint8>( col, row, (col*row)%256, 255 );
+
+  TileRecord serial, parallel;
+  generate( image, 1, serial );
+  generate( image, 4, parallel );
+
+  EXPECT_LT( 20u, serial.tiles.size() );
+  ASSERT_EQ( serial.tiles.size(), parallel.tiles.size() );
+  EXPECT_EQ( serial.metadata.size(), parallel.metadata.size() );
+  for( map<string, ImageView<PixelRGBA<uint8> > >::iterator it = serial.tiles.begin(); it != serial.tiles.end(); ++it ) {
+    ASSERT_EQ( 1u, parallel.tiles.count( it->first ) ) << "tile " << it->first;
+    ImageView<PixelRGBA<uint8> > const& a = it->second, & b = parallel.tiles[it->first];
+    ASSERT_EQ( a.cols(), b.cols() );
+    ASSERT_EQ( a.rows(), b.rows() );
+    for( int32 row = 0; row < a.rows(); ++row )
+      for( int32 col = 0; col < a.cols(); ++col )
+        EXPECT_EQ( a(col,row), b(col,row) ) << "tile " << it->first;
+  }
+
+  // Every tile's metadata comes after that of all its children.
+  map<string, size_t> order;
+  for( size_t i = 0; i < parallel.metadata.size(); ++i ) order[parallel.metadata[i]] = i;
+  for( map<string, size_t>::iterator it = order.begin(); it != order.end(); ++it ) {
+    if( it->first.empty() ) continue;
+    string parent = it->first.substr( 0, it->first.size()-1 );
+    ASSERT_EQ( 1u, order.count( parent ) );
+    EXPECT_LT( it->second, order[parent] ) << it->first << " after its parent";
+  }
+}
+
+TEST(TestQuadTreeGenerator, CullEmptyAndLinkDuplicates) {
+  // Opaque red on the left, empty on the right.
+  ImageView<PixelRGBA<uint8> > image( 64, 64 );
+  for( int32 row = 0; row < image.rows(); ++row )
+    for( int32 col = 0; col < 32; ++col )
+      image(col,row) = PixelRGBA<uint8>( 255, 0, 0, 255 );
+
+  for( int32 threads = 1; threads <= 4; threads += 3 ) {
+    fs::remove_all( "qtree_link_test" );
+    TileRecord record;
+    QuadTreeGenerator qtree( image, "qtree_link_test" );
+    qtree.set_tile_size( 16 );
+    qtree.set_num_threads( threads );
+    qtree.set_cull_images( true );
+    qtree.set_link_duplicates( true );
+    qtree.set_tile_resource_func( boost::bind( &record_tile_file, &record, _1, _2, _3 ) );
+    qtree.set_metadata_func( boost::bind( &record_metadata, &record, _1, _2 ) );
+    qtree.generate();
+
+    // One red tile and the half empty root are written; the other
+    // red tiles link to the first, and the empty ones are culled.
+    EXPECT_EQ( 2u, record.tiles.size() );
+    EXPECT_EQ( 1u, record.tiles.count( "" ) );
+    const char* red[] = { "0", "2", "00", "01", "02", "03", "20", "21", "22", "23" };
+    const char* empty[] = { "1", "3", "10", "13", "31", "33" };
+    string first;
+    for( int i = 0; i < 10; ++i ) {
+      std::ifstream file( ( "qtree_link_test/r" + string( red[i] ) + ".png" ).c_str() );
+      ASSERT_TRUE( file.good() ) << red[i];
+      string name;
+      file >> name;
+      if( first.empty() ) first = name;
+      EXPECT_EQ( first, name ) << red[i];
+      EXPECT_EQ( 1u, record.tiles.count( name ) );
+    }
+    for( int i = 0; i < 6; ++i )
+      EXPECT_FALSE( fs::exists( "qtree_link_test/r" + string( empty[i] ) + ".png" ) ) << empty[i];
+    EXPECT_EQ( 21u, record.metadata.size() );
+  }
+  fs::remove_all( "qtree_link_test" );
+}
+
+// Writes tiles to disk as usual, recording their names.
+static boost::shared_ptr<DstImageResource> record_disk_tile( vector<string>* names, QuadTreeGenerator const& qtree,
+                                                             QuadTreeGenerator::TileInfo const& info, ImageFormat const& format ) {
+  names->push_back( info.name );
+  return QuadTreeGenerator::default_tile_resource_func()( qtree, info, format );
+}
+
+static vector<string> generate_files( ImageView<PixelRGB<uint8> > const& image, string const& name,
+                                      BBox2i const& dirty = BBox2i(), string const& manifest = string() ) {
+  vector<string> names;
+  QuadTreeGenerator qtree( image, name );
+  qtree.set_tile_size( 16 );
+  qtree.set_file_type( "ppm" );
+  qtree.set_dirty_bbox( dirty );
+  qtree.set_manifest_file( manifest );
+  qtree.set_tile_resource_func( boost::bind( &record_disk_tile, &names, _1, _2, _3 ) );
+  qtree.generate();
+  sort( names.begin(), names.end() );
+  return names;
+}
+
+TEST(TestQuadTreeGenerator, DirtyRegionAndManifest) {
+  ImageView<PixelRGB<uint8> > image( 64, 64 );
+  for( int32 row = 0; row < image.rows(); ++row )
+    for( int32 col = 0; col < image.cols(); ++col )
+      image(col,row) = PixelRGB<uint8>( col*4, row*4, (col*row)%256 );
+
+  fs::remove_all( "qtree_dirty_test" );
+  fs::remove_all( "qtree_clean_test" );
+  fs::remove( "qtree_dirty_test.manifest" );
+  EXPECT_EQ( 21u, generate_files( image, "qtree_dirty_test", BBox2i(), "qtree_dirty_test.manifest" ).size() );
+
+  // Nothing has changed, so nothing is written.
+  EXPECT_EQ( 0u, generate_files( image, "qtree_dirty_test", BBox2i(), "qtree_dirty_test.manifest" ).size() );
+
+  // Change a region within one leaf tile and regenerate only it.
+  for( int32 row = 8; row < 12; ++row )
+    for( int32 col = 40; col < 46; ++col )
+      image(col,row) = PixelRGB<uint8>( 255, 0, 255 );
+  vector<string> written = generate_files( image, "qtree_dirty_test", BBox2i(40,8,6,4), "qtree_dirty_test.manifest" );
+  ASSERT_EQ( 3u, written.size() );
+  EXPECT_EQ( "", written[0] );
+  EXPECT_EQ( "1", written[1] );
+  EXPECT_EQ( "10", written[2] );
+
+  // The tree matches one generated from scratch.
+  EXPECT_EQ( 21u, generate_files( image, "qtree_clean_test" ).size() );
+  for( fs::directory_iterator it( "qtree_clean_test" ), end; it != end; ++it ) {
+    string file = it->path().filename().string();
+    ImageView<PixelRGB<uint8> > clean, dirty;
+    read_image( clean, "qtree_clean_test/" + file );
+    read_image( dirty, "qtree_dirty_test/" + file );
+    ASSERT_EQ( clean.cols(), dirty.cols() ) << file;
+    ASSERT_EQ( clean.rows(), dirty.rows() ) << file;
+    for( int32 row = 0; row < clean.rows(); ++row )
+      for( int32 col = 0; col < clean.cols(); ++col )
+        EXPECT_EQ( clean(col,row), dirty(col,row) ) << file;
+  }
+
+  fs::remove_all( "qtree_dirty_test" );
+  fs::remove_all( "qtree_clean_test" );
+  fs::remove( "qtree_dirty_test.manifest" );
+}
@@ -0,0 +1,46 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <vw/Mosaic/RTree.h>
+
+#include <cstdlib>
+
+using namespace std;
+using namespace vw;
+using namespace vw::mosaic;
+
+static BBox2i random_box( int32 extent, int32 size ) {
+  int32 x = rand() % extent, y = rand() % extent;
+  return BBox2i( x, y, 1 + rand() % size, 1 + rand() % size );
+}
+
+TEST(TestRTree, Empty) {
+  RTree tree;
+  vector<size_t> result;
+  tree.intersect( BBox2i(0,0,10,10), result );
+  EXPECT_TRUE( result.empty() );
+  EXPECT_EQ( 0u, tree.size() );
+}
+
+TEST(TestRTree, MatchesBruteForce) {
+  srand(42);
+  for( size_t n = 1; n < 700; n = n*3 + 1 ) {
+    vector<BBox2i> boxes;
+    for( size_t i=0; i<n; ++i ) boxes.push_back( random_box( 1000, 100 ) );
+    RTree tree( boxes );
+    EXPECT_EQ( n, tree.size() );
+    for( int q=0; q<50; ++q ) {
+      BBox2i query = random_box( 1000, 200 );
+      vector<size_t> expected, result;
+      for( size_t i=0; i<n; ++i )
+        if( boxes[i].intersects( query ) ) expected.push_back( i );
+      tree.intersect( query, result );
+      EXPECT_EQ( expected, result ) << "with " << n << " boxes";
+    }
+  }
+}
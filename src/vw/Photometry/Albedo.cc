@@ -7,6 +7,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem/operations.hpp>
 
 #include <vw/Core.h>
 #include <vw/Image.h>
@@ -18,6 +21,7 @@ using namespace vw;
 using namespace vw::cartography;
 
 #include <vw/Photometry/Albedo.h>
+#include <vw/Photometry/Index.h>
 #include <vw/Photometry/Reconstruct.h>
 #include <vw/Photometry/ReconstructError.h>
 #include <vw/Photometry/Reflectance.h>
@@ -532,199 +536,424 @@ void vw::photometry::UpdateImageMosaic(ModelParams input_img_params,
 //Below are the functions for albedo reconstruction
 //-------------------------------------------------------------------------------
 
-//initializes the albedo mosaic
-//TO DO: build the version that does the blockwise processing to deal with large scale images
-void
-vw::photometry::InitAlbedoMosaic(ModelParams input_img_params,
-                                 std::vector<ModelParams> overlap_img_params,
-                                 GlobalParams globalParams) {
-    int horBlockSize = 500;
-    int verBlockSize = 500;
-    
-    int i, l, k;
-    std::string input_img_file = input_img_params.inputFilename;
-    std::string reflectance_file = input_img_params.reliefFilename;
-    std::string shadow_file = input_img_params.shadowFilename;
-    std::string output_img_file = input_img_params.outputFilename;
-
-
-    DiskImageView<PixelMask<PixelGray<uint8> > >  input_img(input_img_file);
-    GeoReference input_img_geo;
-    read_georeference(input_img_geo, input_img_file);
-
-    DiskImageView<PixelMask<PixelGray<uint8> > >  shadowImage(shadow_file);
-
-    ImageView<PixelMask<PixelGray<float> > > output_img (input_img.cols(), input_img.rows());
-    ImageView<PixelGray<int> > numSamples(input_img.cols(), input_img.rows());
-    ImageView<PixelGray<float> > norm(input_img.cols(), input_img.rows());
-
- 
-    DiskImageView<PixelMask<PixelGray<float> > > reflectance_image(reflectance_file);
-    GeoReference reflectance_geo;
-    read_georeference(reflectance_geo, reflectance_file);
-
-    ImageViewRef<PixelMask<PixelGray<float> > >  interp_reflectance_image = interpolate(edge_extend(reflectance_image.impl(),
-											ConstantEdgeExtension()),
-									    BilinearInterpolation());
-
-
-    int numHorBlocks = input_img.cols()/horBlockSize + 1;
-    int numVerBlocks = input_img.rows()/verBlockSize + 1;
-
-    int x,y;
-    //initialize  output_img, and numSamples
-    for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-           numSamples(l, k) = 0;
-           Vector2 input_image_pix(l,k);
+namespace {
+
+  // How far (in pixels) the per-block approximation of the mapping
+  // between two georeferenced images may stray from the exact one.
+  const double mapping_tolerance = 0.05;
+
+  // The mapping from a block of one image's pixels to another image's,
+  // approximated over the block, and the part of the other image that
+  // the block lands on (with room for bilinear interpolation).
+  class BlockMapping {
+    ApproximateTransform<GeoTransform> m_tx;
+    BBox2i m_src_bbox;
+  public:
+    BlockMapping(GeoTransform const& tx, BBox2i const& bbox, BBox2i const& src_bounds)
+      : m_tx(tx, bbox), m_src_bbox(tx.reverse_bbox(bbox)) {
+      m_src_bbox.expand(2);
+      m_src_bbox.crop(src_bounds);
+    }
 
-           if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0)) { //valid image point
+    Vector2 operator()(Vector2 const& pix) const { return m_tx.reverse(pix); }
+    BBox2i const& source_bbox() const { return m_src_bbox; }
 
-              //compute the local reflectance
-            
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_image_pix);
-              Vector2 reflectance_pix = reflectance_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_image_pix));
-
-              float x = reflectance_pix[0];
-              float y = reflectance_pix[1];
-             
-              //check for valid reflectance coordinates
-              if ((x>=0) && (x < reflectance_image.cols()) && (y>=0) && (y< reflectance_image.rows())){ //valid reflectance point  
-               
-		if (is_valid(interp_reflectance_image(x,y))){
-                 
-                  float input_img_reflectance = interp_reflectance_image(x,y);
-                  if (input_img_reflectance != 0.0){
-                      if (globalParams.useWeights == 0){
-                          output_img(l, k) = (float)input_img(l,k)/(input_img_params.exposureTime*input_img_reflectance);
-                          numSamples(l, k) = 1;
-                      }
-                      else{
-                         float weight = ComputeLineWeights(input_image_pix, input_img_params.centerLine, input_img_params.maxDistArray);
-                         output_img(l, k) = ((float)input_img(l,k)*weight)/(input_img_params.exposureTime*input_img_reflectance);
-                         norm(l, k) = weight;
-                         numSamples(l, k) = 1;
-                      }
-                  }
-                }
-             }
-          }
-       }
+    // True if src_pix lies on the part of the other image we read.
+    bool contains(Vector2 const& src_pix) const {
+      return src_pix[0] >= m_src_bbox.min().x() && src_pix[0] < m_src_bbox.max().x() &&
+             src_pix[1] >= m_src_bbox.min().y() && src_pix[1] < m_src_bbox.max().y();
     }
-
-    for (i = 0; i < (int)overlap_img_params.size(); i++){
-      
+  };
+
+  // A region of an image read into memory, and bilinearly interpolated
+  // there in the whole image's pixel coordinates.
+  template <class PixelT>
+  class SourceBlock {
+    typedef InterpolationView<EdgeExtensionView<ImageView<PixelT>, ConstantEdgeExtension>, BilinearInterpolation> interp_type;
+    BBox2i m_bbox;
+    ImageView<PixelT> m_image;
+    interp_type m_interp;
+
+    static BBox2i cropped(BBox2i bbox, BBox2i const& bounds) {
+      bbox.crop(bounds);
+      return bbox;
+    }
+  public:
+    template <class ImageT>
+    SourceBlock(ImageViewBase<ImageT> const& image, BBox2i const& bbox)
+      : m_bbox(cropped(bbox, bounding_box(image.impl()))),
+        m_image(m_bbox.empty() ? ImageView<PixelT>() : ImageView<PixelT>(crop(image.impl(), m_bbox))),
+        m_interp(interpolate(m_image, BilinearInterpolation())) {}
+
+    typename interp_type::pixel_type operator()(double x, double y) const {
+      return m_interp(x - m_bbox.min().x(), y - m_bbox.min().y());
+    }
+  };
+
+  // An image that overlaps the one being mosaicked, with its shadow
+  // mask, the mapping to it from the mosaicked image's pixels and the
+  // region of the mosaicked image it covers.
+  struct OverlapImage {
+    ModelParams params;
+    DiskImageView<PixelMask<PixelGray<uint8> > > image, shadow;
+    GeoTransform tx;
+    BBox2i region;
+
+    OverlapImage(ModelParams const& params, std::string const& dst_file, GeoReference const& dst_geo)
+      : params(params), image(params.inputFilename), shadow(params.shadowFilename),
+        tx(OverlapIndex::instance().georef(params.inputFilename), dst_geo),
+        region(OverlapIndex::instance().overlap(dst_file, params.inputFilename)) {
+      tx.set_tolerance(mapping_tolerance);
+    }
+  };
+
+  // Opens the overlap images that actually overlap dst_file.
+  std::vector<boost::shared_ptr<OverlapImage> >
+  open_overlaps(std::vector<ModelParams> const& overlap_img_params,
+                std::string const& dst_file, GeoReference const& dst_geo) {
+    std::vector<boost::shared_ptr<OverlapImage> > overlaps;
+    for (size_t i = 0; i < overlap_img_params.size(); ++i) {
       printf("overlap_img = %s\n", overlap_img_params[i].inputFilename.c_str());
+      if (OverlapIndex::instance().overlap(dst_file, overlap_img_params[i].inputFilename).empty())
+        continue;
+      overlaps.push_back(boost::shared_ptr<OverlapImage>(new OverlapImage(overlap_img_params[i], dst_file, dst_geo)));
+    }
+    return overlaps;
+  }
 
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlap_img(overlap_img_params[i].inputFilename);
-      GeoReference overlap_geo;
-      read_georeference(overlap_geo, overlap_img_params[i].inputFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interp_overlap_img = interpolate(edge_extend(overlap_img.impl(),
-                                                                                    ConstantEdgeExtension()),
-                                                                                    BilinearInterpolation());
-
-
-      
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlapShadowImage(overlap_img_params[i].shadowFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interpOverlapShadowImage = interpolate(edge_extend(overlapShadowImage.impl(),
-												      ConstantEdgeExtension()),
-											  BilinearInterpolation());
-      
-      for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-          Vector2 input_img_pix(l,k);
-
-          if ( is_valid(input_img(l,k)) ) {
-
-              //get the corresponding reflectance value
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_img_pix);
-	     
-              Vector2 reflectance_pix = reflectance_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-              float x = reflectance_pix[0];
-              float y = reflectance_pix[1];
-
-              //check for valid reflectance_image coordinates
-              if ((x>=0) && (x < reflectance_image.cols()) && (y>=0) && (y< reflectance_image.rows())){
-	
-                if (is_valid(interp_reflectance_image(x,y))){
-                 
-                  //check for overlap between the output image and the input DEM image
-                  Vector2 overlap_pix = overlap_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-                  float overlap_x = overlap_pix[0];
-                  float overlap_y = overlap_pix[1];
-
-                  //image dependent part of the code  - START
-                  PixelMask<PixelGray<uint8> > overlap_img_pixel = interp_overlap_img(overlap_x, overlap_y);
-
-                  //check for valid overlap_img coordinates
-                  //TO DO: remove shadow pixels in the overlap_img.
-                  if ((overlap_x>=0) && (overlap_x < overlap_img.cols()) && (overlap_y >= 0) && (overlap_y< overlap_img.rows()) && (interpOverlapShadowImage(x, y) == 0)){
+  // The initial albedo of each pixel of the input image: the mean (or
+  // line-weighted mean) of intensity/(exposure*reflectance) over the
+  // input image and the overlapping ones.  Computed a block at a time,
+  // with each overlap image's mapping approximated over the block.
+  class InitAlbedoView : public ImageViewBase<InitAlbedoView> {
+    ModelParams m_params;
+    GlobalParams m_global;
+    DiskImageView<PixelMask<PixelGray<uint8> > > m_input, m_shadow;
+    DiskImageView<PixelMask<PixelGray<float> > > m_reflectance;
+    GeoReference m_input_geo;
+    GeoTransform m_reflectance_tx;
+    std::vector<boost::shared_ptr<OverlapImage> > m_overlaps;
+
+  public:
+    typedef PixelMask<PixelGray<float> > pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<InitAlbedoView> pixel_accessor;
+
+    InitAlbedoView(ModelParams const& input_img_params,
+                   std::vector<ModelParams> const& overlap_img_params,
+                   GlobalParams const& globalParams)
+      : m_params(input_img_params), m_global(globalParams),
+        m_input(input_img_params.inputFilename), m_shadow(input_img_params.shadowFilename),
+        m_reflectance(input_img_params.reliefFilename),
+        m_input_geo(OverlapIndex::instance().georef(input_img_params.inputFilename)),
+        m_reflectance_tx(OverlapIndex::instance().georef(input_img_params.reliefFilename), m_input_geo),
+        m_overlaps(open_overlaps(overlap_img_params, input_img_params.inputFilename, m_input_geo)) {
+      m_reflectance_tx.set_tolerance(mapping_tolerance);
+    }
 
-                    if ( is_valid(overlap_img_pixel) ) { //common area between input_img and overlap_img
+    inline int32 cols() const { return m_input.cols(); }
+    inline int32 rows() const { return m_input.rows(); }
+    inline int32 planes() const { return 1; }
 
-                      float overlap_img_reflectance = interp_reflectance_image(x,y);
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
 
-                      if (overlap_img_reflectance != 0.0){
-                          if (globalParams.useWeights == 0){
-                              output_img(l, k) = (float)output_img(l, k) + (float)overlap_img_pixel/(overlap_img_params[i].exposureTime*overlap_img_reflectance);
-                              numSamples(l, k) = numSamples(l,k) + 1;
-                          }
-                          else{
-                             float weight = ComputeLineWeights(overlap_pix, overlap_img_params[i].centerLine, overlap_img_params[i].maxDistArray);
-                             output_img(l, k) = (float)output_img(l, k) + ((float)overlap_img_pixel*weight)/(overlap_img_params[i].exposureTime*overlap_img_reflectance);
-                             numSamples(l, k) = numSamples(l,k) + 1;
-                             norm(l,k) = norm(l,k) + weight;
-                          }
-                      }
+    // Maps a whole block per pixel: rasterize instead.
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
 
-                    }//if
-                  }//if
+    GeoReference const& georeference() const { return m_input_geo; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(BBox2i const& bbox) const {
+      const int32 w = bbox.width(), h = bbox.height();
+      ImageView<PixelMask<PixelGray<uint8> > > input = crop(m_input, bbox);
+      ImageView<PixelMask<PixelGray<uint8> > > shadow = crop(m_shadow, bbox);
+
+      // The reflectance under each pixel, or 0 where there is none;
+      // the overlap images only add to pixels that have one.
+      ImageView<float> reflectance(w, h);
+      ImageView<float> sum(w, h), norm(w, h);
+      ImageView<int32> num_samples(w, h);
+
+      BlockMapping refl_map(m_reflectance_tx, bbox, bounding_box(m_reflectance));
+      if (!refl_map.source_bbox().empty()) {
+        SourceBlock<PixelMask<PixelGray<float> > > refl(m_reflectance, refl_map.source_bbox());
+        for (int32 k = 0; k < h; ++k) {
+          for (int32 l = 0; l < w; ++l) {
+            if (!is_valid(input(l,k)))
+              continue;
+            Vector2 pix(bbox.min().x() + l, bbox.min().y() + k);
+            Vector2 refl_pix = refl_map(pix);
+            if (!refl_map.contains(refl_pix))
+              continue;
+            PixelMask<PixelGray<float> > r = refl(refl_pix[0], refl_pix[1]);
+            if (!is_valid(r) || (float)r == 0.0)
+              continue;
+            reflectance(l,k) = r;
+
+            if (shadow(l,k) == 0) {
+              float weight = 1;
+              if (m_global.useWeights != 0)
+                weight = ComputeLineWeights(pix, m_params.centerLine, m_params.maxDistArray);
+              sum(l,k) = ((float)input(l,k)*weight)/(m_params.exposureTime*reflectance(l,k));
+              norm(l,k) = weight;
+              num_samples(l,k) = 1;
+            }
+          }
+        }
+      }
 
-                  //image dependent part of the code  - END
-               }
-             }
+      for (size_t i = 0; i < m_overlaps.size(); ++i) {
+        OverlapImage const& overlap = *m_overlaps[i];
+        if (!overlap.region.intersects(bbox))
+          continue;
+        BlockMapping map(overlap.tx, bbox, bounding_box(overlap.image));
+        if (map.source_bbox().empty())
+          continue;
+        SourceBlock<PixelMask<PixelGray<uint8> > > overlap_img(overlap.image, map.source_bbox());
+        SourceBlock<PixelMask<PixelGray<uint8> > > overlap_shadow(overlap.shadow, map.source_bbox());
+
+        for (int32 k = 0; k < h; ++k) {
+          for (int32 l = 0; l < w; ++l) {
+            if (reflectance(l,k) == 0.0)
+              continue;
+            Vector2 overlap_pix = map(Vector2(bbox.min().x() + l, bbox.min().y() + k));
+            if (!map.contains(overlap_pix) || !(overlap_shadow(overlap_pix[0], overlap_pix[1]) == 0))
+              continue;
+            PixelMask<PixelGray<uint8> > overlap_img_pixel = overlap_img(overlap_pix[0], overlap_pix[1]);
+            if (!is_valid(overlap_img_pixel))
+              continue;
+
+            float weight = 1;
+            if (m_global.useWeights != 0)
+              weight = ComputeLineWeights(overlap_pix, overlap.params.centerLine, overlap.params.maxDistArray);
+            sum(l,k) += ((float)overlap_img_pixel*weight)/(overlap.params.exposureTime*reflectance(l,k));
+            norm(l,k) += weight;
+            num_samples(l,k) += 1;
           }
         }
       }
+
+      ImageView<pixel_type> out(w, h);
+      for (int32 k = 0; k < h; ++k) {
+        for (int32 l = 0; l < w; ++l) {
+          if (num_samples(l,k) == 0)
+            continue;
+          if (m_global.useWeights == 0)
+            out(l,k) = sum(l,k)/num_samples(l,k);
+          else
+            out(l,k) = sum(l,k)/norm(l,k);
+        }
+      }
+      return prerasterize_type(out, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()));
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const { vw::rasterize(prerasterize(bbox), dest, bbox); }
+  };
+
+  // One step of gradient descent on the albedo of each pixel of the
+  // input image, against the input image and the overlapping ones, with
+  // the reflectance computed from the mean DEM.  Computed a block at a
+  // time, like InitAlbedoView.
+  class UpdateAlbedoView : public ImageViewBase<UpdateAlbedoView> {
+    ModelParams m_params;
+    GlobalParams m_global;
+    DiskImageView<PixelMask<PixelGray<uint8> > > m_input, m_shadow, m_albedo;
+    DiskImageView<PixelGray<float> > m_dem;
+    GeoReference m_input_geo;
+    GeoTransform m_dem_tx;
+    std::vector<boost::shared_ptr<OverlapImage> > m_overlaps;
+
+  public:
+    typedef PixelMask<PixelGray<float> > pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<UpdateAlbedoView> pixel_accessor;
+
+    UpdateAlbedoView(ModelParams const& input_img_params,
+                     std::vector<ModelParams> const& overlap_img_params,
+                     GlobalParams const& globalParams)
+      : m_params(input_img_params), m_global(globalParams),
+        m_input(input_img_params.inputFilename), m_shadow(input_img_params.shadowFilename),
+        m_albedo(input_img_params.reliefFilename), m_dem(input_img_params.meanDEMFilename),
+        m_input_geo(OverlapIndex::instance().georef(input_img_params.inputFilename)),
+        m_dem_tx(OverlapIndex::instance().georef(input_img_params.meanDEMFilename), m_input_geo),
+        m_overlaps(open_overlaps(overlap_img_params, input_img_params.inputFilename, m_input_geo)) {
+      m_dem_tx.set_tolerance(mapping_tolerance);
     }
 
-    //compute the mean albedo value
-    int numValid = 0;
-    for (k = 0 ; k < input_img.rows(); ++k) {
-       for (l = 0; l < input_img.cols(); ++l) {
+    inline int32 cols() const { return m_input.cols(); }
+    inline int32 rows() const { return m_input.rows(); }
+    inline int32 planes() const { return 1; }
 
-         //output_img(l,k).invalidate();
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
 
-         if ( (is_valid(input_img(l,k))) && (numSamples(l, k)!=0) ) {
-
-              output_img(l,k).validate();
+    // Maps a whole block per pixel: rasterize instead.
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
 
-              if (globalParams.useWeights == 0){
-                  output_img(l, k) = output_img(l, k)/numSamples(l,k);
-              }
-              else{
-		output_img(l, k) = output_img(l, k)/norm(l,k);
-              }
-	      numValid++;
-         }
+    GeoReference const& georeference() const { return m_input_geo; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(BBox2i const& bbox) const {
+      const int32 w = bbox.width(), h = bbox.height();
+      ImageView<PixelMask<PixelGray<uint8> > > input = crop(m_input, bbox);
+      ImageView<PixelMask<PixelGray<uint8> > > shadow = crop(m_shadow, bbox);
+      ImageView<PixelMask<PixelGray<uint8> > > albedo = crop(m_albedo, bbox);
+
+      // Each normal needs the pixels left of and above it, so the
+      // block's DEM and lon/lat grid start one pixel up and left.
+      BBox2i grid(bbox.min() - Vector2i(1,1), bbox.max());
+      std::vector<Vector2> pixels, lonlats;
+      pixels.reserve(size_t(w+1)*(h+1));
+      for (int32 k = 0; k <= h; ++k)
+        for (int32 l = 0; l <= w; ++l)
+          pixels.push_back(Vector2(grid.min().x() + l, grid.min().y() + k));
+      m_input_geo.pixels_to_lonlats(pixels, lonlats);
+      #define LONLAT(l,k) lonlats[size_t((k)+1)*(w+1) + (l)+1]
+
+      // Each pixel's surface point, and the points left of and above it
+      // (halo, with the DEM interpolated there) that give its normal.
+      // Only the pixels with both get a reflectance.
+      SurfaceTile surface, halo;
+      surface.resize(size_t(w)*h);
+      BlockMapping dem_map(m_dem_tx, grid, bounding_box(m_dem));
+      if (!dem_map.source_bbox().empty()) {
+        SourceBlock<PixelGray<float> > dem(m_dem, dem_map.source_bbox());
+        halo.resize(lonlats.size());
+        for (int32 k = 0; k <= h; ++k) {
+          for (int32 l = 0; l <= w; ++l) {
+            const size_t i = size_t(k)*(w+1) + l;
+            Vector2 dem_pix = dem_map(Vector2(grid.min().x() + l, grid.min().y() + k));
+            halo.set_point(i, m_input_geo.datum().geodetic_to_cartesian(Vector3(lonlats[i](0), lonlats[i](1),
+                                                                                dem(dem_pix[0], dem_pix[1]))));
+          }
+        }
+        for (int32 k = 0; k < h; ++k) {
+          for (int32 l = 0; l < w; ++l) {
+            const int32 col = bbox.min().x() + l, row = bbox.min().y() + k;
+            if (!is_valid(input(l,k)) || col < 1 || row < 1)
+              continue;
+            Vector2 dem_pix = dem_map(Vector2(col, row));
+            int32 x = (int32)dem_pix[0], y = (int32)dem_pix[1];
+            if (x < 0 || x >= m_dem.cols() || y < 0 || y >= m_dem.rows() || !dem_map.contains(Vector2(x,y)))
+              continue;
+            float height = dem(x, y);
+            if (height == m_global.noDEMDataValue)
+              continue;
+            Vector2 const& lon_lat = LONLAT(l,k);
+            surface.set_point(size_t(k)*w + l, m_input_geo.datum().geodetic_to_cartesian(Vector3(lon_lat(0), lon_lat(1), height)));
+          }
+        }
+        compute_tile_normals(surface, halo, w, h);
+      }
+      #undef LONLAT
+      #define HAS_NORMAL(l,k) surface.valid[size_t(k)*w + (l)]
+
+      // Only the pixels the input image itself sees get a new albedo.
+      std::vector<float> reflectance;
+      ReflectanceModel(m_params, m_global)(surface, reflectance);
+      ImageView<float> nominator(w, h), denominator(w, h);
+      ImageView<uint8> updated(w, h);
+      for (int32 k = 0; k < h; ++k) {
+        for (int32 l = 0; l < w; ++l) {
+          if (!HAS_NORMAL(l,k) || !(shadow(l,k) == 0))
+            continue;
+          float input_img_reflectance = reflectance[size_t(k)*w + l];
+          if (input_img_reflectance <= 0)
+            continue;
+          float input_img_error = ComputeError((float)input(l,k), m_params.exposureTime,
+                                               (float)albedo(l,k), input_img_reflectance);
+          float input_albedo_grad = ComputeGradient_Albedo(m_params.exposureTime, input_img_reflectance);
+          float weight = 1;
+          if (m_global.useWeights != 0)
+            weight = ComputeLineWeights(Vector2(bbox.min().x() + l, bbox.min().y() + k),
+                                        m_params.centerLine, m_params.maxDistArray);
+          nominator(l,k) = input_albedo_grad*input_img_error*weight;
+          denominator(l,k) = input_albedo_grad*input_albedo_grad*weight;
+          updated(l,k) = 1;
+        }
+      }
 
+      for (size_t i = 0; i < m_overlaps.size(); ++i) {
+        OverlapImage const& overlap = *m_overlaps[i];
+        if (!overlap.region.intersects(bbox))
+          continue;
+        BlockMapping map(overlap.tx, bbox, bounding_box(overlap.image));
+        if (map.source_bbox().empty())
+          continue;
+        SourceBlock<PixelMask<PixelGray<uint8> > > overlap_img(overlap.image, map.source_bbox());
+        SourceBlock<PixelMask<PixelGray<uint8> > > overlap_shadow(overlap.shadow, map.source_bbox());
+
+        ReflectanceModel(overlap.params, m_global)(surface, reflectance);
+        for (int32 k = 0; k < h; ++k) {
+          for (int32 l = 0; l < w; ++l) {
+            if (!HAS_NORMAL(l,k))
+              continue;
+            Vector2 overlap_pix = map(Vector2(bbox.min().x() + l, bbox.min().y() + k));
+            int32 x = (int32)overlap_pix[0], y = (int32)overlap_pix[1];
+            if (x < 0 || x >= overlap.image.cols() || y < 0 || y >= overlap.image.rows() ||
+                !map.contains(Vector2(x,y)) || !(overlap_shadow(x, y) == 0))
+              continue;
+            PixelMask<PixelGray<uint8> > overlap_img_pixel = overlap_img(x, y);
+            if (!is_valid(overlap_img_pixel))
+              continue;
+
+            float overlap_img_reflectance = reflectance[size_t(k)*w + l];
+            if (overlap_img_reflectance <= 0)
+              continue;
+            float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap.params.exposureTime,
+                                                   (float)albedo(l,k), overlap_img_reflectance);
+            float overlap_albedo_grad = ComputeGradient_Albedo(overlap.params.exposureTime, overlap_img_reflectance);
+            float weight = 1;
+            if (m_global.useWeights != 0)
+              weight = ComputeLineWeights(overlap_pix, overlap.params.centerLine, overlap.params.maxDistArray);
+            nominator(l,k) += overlap_albedo_grad*overlap_img_error*weight;
+            denominator(l,k) += overlap_albedo_grad*overlap_albedo_grad*weight;
+          }
+        }
       }
+      #undef HAS_NORMAL
+
+      ImageView<pixel_type> out(w, h);
+      for (int32 k = 0; k < h; ++k)
+        for (int32 l = 0; l < w; ++l)
+          if (updated(l,k) && denominator(l,k) != 0)
+            out(l,k) = (float)albedo(l,k) + nominator(l,k)/denominator(l,k);
+      return prerasterize_type(out, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()));
     }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const { vw::rasterize(prerasterize(bbox), dest, bbox); }
+  };
+
+  // Writes an albedo view as 8 bits, a tile at a time, through a
+  // temporary file (the albedo may be updated in place).
+  template <class ViewT>
+  void write_albedo(std::string const& filename, ViewT const& albedo) {
+    std::string::size_type slash = filename.rfind('/');
+    slash = (slash == std::string::npos) ? 0 : slash + 1;
+    const std::string tmp_filename = filename.substr(0, slash) + "tmp_" + filename.substr(slash);
+
+    ImageViewRef<PixelMask<PixelGray<uint8> > > out = channel_cast<uint8>(clamp(albedo, 0.0, 255.0));
+    {
+      boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(tmp_filename, out.format()));
+      if (r->has_block_write())
+        r->set_block_write_size(Vector2i(vw_settings().default_tile_size(),
+                                         vw_settings().default_tile_size()));
+      write_georeference(*r, albedo.georeference());
+      block_write_image(*r, out, TerminalProgressCallback("photometry", "Processing:"));
+    }
+    boost::filesystem::rename(tmp_filename, filename);
+  }
 
-    printf("numValid = %d, total = %d\n", numValid, input_img.rows()*input_img.cols());
-    
-    //TODO: compute the albedo variance (standard deviation)
-   
-   
-    //write in the albedo image
-    write_georeferenced_image(output_img_file,
-                              channel_cast<uint8>(clamp(output_img,0.0,255.0)),
-                              input_img_geo, TerminalProgressCallback("{Core}","Processing:"));
-    
+} // namespace
+
+//initializes the albedo mosaic, a block at a time
+void
+vw::photometry::InitAlbedoMosaic(ModelParams input_img_params,
+                                 std::vector<ModelParams> overlap_img_params,
+                                 GlobalParams globalParams) {
+  write_albedo(input_img_params.outputFilename,
+               InitAlbedoView(input_img_params, overlap_img_params, globalParams));
 }
 
 
@@ -735,276 +964,8 @@ void
 vw::photometry::UpdateAlbedoMosaic(ModelParams input_img_params,
                                    std::vector<ModelParams> overlap_img_params,
                                    GlobalParams globalParams) {
-    int i, l, k;
-
-    std::string input_img_file = input_img_params.inputFilename;
-    std::string DEM_file = input_img_params.meanDEMFilename;
-    std::string shadow_file = input_img_params.shadowFilename;
-    std::string output_img_file = input_img_params.reliefFilename;
-
-  
-    DiskImageView<PixelMask<PixelGray<uint8> > >  input_img(input_img_file);
-    GeoReference input_img_geo;
-    read_georeference(input_img_geo, input_img_file);
-
-    DiskImageView<PixelGray<float> >  input_dem_image(DEM_file);
-    GeoReference input_dem_geo;
-    read_georeference(input_dem_geo, DEM_file);
-
-    //TO DO: read the reflectance image instead.
- 
-    DiskImageView<PixelMask<PixelGray<uint8> > >  shadowImage(shadow_file);
-
-    DiskImageView<PixelMask<PixelGray<uint8> > > output_img_r(output_img_file);
-
-
-    ImageView<PixelMask<PixelGray<float> > > output_img (output_img_r.cols(), output_img_r.rows());
-
-    ImageView<PixelGray<float> > nominator(input_img.cols(), input_img.rows());
-    ImageView<PixelGray<float> > denominator(input_img.cols(), input_img.rows());
-
-    Vector3 xyz;
-    Vector3 xyz_prior;
-    int x, y;
-
-    ImageViewRef<PixelGray<float> >  interp_dem_image = interpolate(edge_extend(input_dem_image.impl(),
-                                                                                ConstantEdgeExtension()),
-                                                                                BilinearInterpolation());
-
-    //initialize the nominator and denomitor images
-    for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-           nominator(l, k) = 0;
-           denominator(l, k) = 0;
-
-           Vector2 input_image_pix(l,k);
-
-           //reject invalid pixels and pixels that are in shadow.
-           if ( is_valid(input_img(l,k)) && ( shadowImage(l, k) == 0)) {
-
-              //get the corresponding DEM value
-
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_image_pix);
-              Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_image_pix));
-
-              x = (int)input_dem_pix[0];
-              y = (int)input_dem_pix[1];
-
-
-              //check for valid DEM coordinates
-              if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-                //Vector3 longlat3(lon_lat(0),lon_lat(1),(input_dem_image)(x, y));
-                Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-                Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);//3D coordinates in the img coordinates
-
-
-                Vector2 input_img_left_pix;
-                input_img_left_pix(0) = l-1;
-                input_img_left_pix(1) = k;
-
-                Vector2 input_img_top_pix;
-                input_img_top_pix(0) = l;
-                input_img_top_pix(1) = k-1;
-
-                //check for valid DEM pixel value and valid left and top coordinates
-                //if ((input_dem_left_pix(0) >= 0) && (input_dem_top_pix(1) >= 0) && (input_dem_image(x,y) != -10000)){
-                if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != globalParams.noDEMDataValue)){
-
-                  //determine the 3D coordinates of the pixel left of the current pixel
-                  Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-                  Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-                  Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-
-                  //Vector3 xyz_left = input_dem_geo.datum().geodetic_to_cartesian(longlat3_left);
-                  Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-                  //determine the 3D coordinates of the pixel top of the current pixel
-                  Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-                  Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-                  Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-                  Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-                  //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-                  Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
-
-                  //This part is the only image depedent part - START
-                  float input_img_reflectance;
-                  input_img_reflectance = ComputeReflectance(normal, xyz, input_img_params, globalParams);
-
-                  if (input_img_reflectance > 0){
-                     float input_img_error = ComputeError((float)input_img(l,k), input_img_params.exposureTime,
-                                                                 (float)output_img_r(l, k),  input_img_reflectance);
-
-//                     float input_img_error = ComputeError_Albedo((float)input_img(l,k), input_img_params.exposureTime,
-//                                                                 (float)output_img_r(l, k),  input_img_reflectance, xyz, xyz_prior);
-
-                     float input_albedo_grad = ComputeGradient_Albedo(input_img_params.exposureTime, input_img_reflectance);
-
-
-                     if (globalParams.useWeights == 0){
-                         nominator(l, k) = input_albedo_grad*input_img_error;
-                         denominator(l, k) = input_albedo_grad*input_albedo_grad;
-                         }
-                     else{
-                         float weight = ComputeLineWeights(input_image_pix, input_img_params.centerLine, input_img_params.maxDistArray);
-                         nominator(l, k)   = input_albedo_grad*input_img_error*weight;
-                         denominator(l, k) = input_albedo_grad*input_albedo_grad*weight;
-                     }
-
-                     output_img(l, k) = 0;//(float)(output_img_r(l, k));
-                  }
-
-                  //This part is the only image depedent part - END
-                }
-              }
-           }
-        }
-    }
-
-
-    //update from the overlapping images
-    for (i = 0; i < (int)overlap_img_params.size(); i++){
-
-      printf("overlap_img = %s\n", overlap_img_params[i].inputFilename.c_str());
-
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlap_img(overlap_img_params[i].inputFilename);
-      GeoReference overlap_geo;
-     
-      read_georeference(overlap_geo, overlap_img_params[i].inputFilename);
-
-      DiskImageView<PixelMask<PixelGray<uint8> > >  overlapShadowImage(overlap_img_params[i].shadowFilename);
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interp_overlap_img = interpolate(edge_extend(overlap_img.impl(),
-                                                                                    ConstantEdgeExtension()),
-                                                                                    BilinearInterpolation());
-
-      ImageViewRef<PixelMask<PixelGray<uint8> > >  interpOverlapShadowImage = interpolate(edge_extend(overlapShadowImage.impl(),
-                                                                                           ConstantEdgeExtension()),
-                                                                                           BilinearInterpolation());
-
-      for (k = 0 ; k < input_img.rows(); ++k) {
-        for (l = 0; l < input_img.cols(); ++l) {
-
-         Vector2 input_img_pix(l,k);
-
-         if ( is_valid(input_img(l,k)) ) {
-
-              //get the corresponding DEM value
-              Vector2 lon_lat = input_img_geo.pixel_to_lonlat(input_img_pix);
-              Vector2 input_dem_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-
-              x = (int)input_dem_pix[0];
-              y = (int)input_dem_pix[1];
-
-              //check for valid DEM coordinates
-              if ((x>=0) && (x < input_dem_image.cols()) && (y>=0) && (y< input_dem_image.rows())){
-
-                //get the top and left DEM value
-                Vector3 longlat3(lon_lat(0),lon_lat(1),(interp_dem_image)(x, y));
-                Vector3 xyz = input_img_geo.datum().geodetic_to_cartesian(longlat3);
-
-                Vector2 input_img_left_pix;
-                input_img_left_pix(0) = l-1;
-                input_img_left_pix(1) = k;
-
-                Vector2 input_img_top_pix;
-                input_img_top_pix(0) = l;
-                input_img_top_pix(1) = k-1;
-
-                //check for valid DEM pixel value and valid left and top coordinates
-                if ((input_img_left_pix(0) >= 0) && (input_img_top_pix(1) >= 0) && (input_dem_image(x,y) != globalParams.noDEMDataValue)){
-
-
-                  //determine the 3D coordinates of the pixel left of the current pixel
-                  Vector2 input_dem_left_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_left_pix));
-                  Vector2 lon_lat_left = input_img_geo.pixel_to_lonlat(input_img_left_pix);
-                  Vector3 longlat3_left(lon_lat_left(0),lon_lat_left(1),(interp_dem_image)(input_dem_left_pix(0), input_dem_left_pix(1)));
-                  Vector3 xyz_left = input_img_geo.datum().geodetic_to_cartesian(longlat3_left);
-
-
-                  Vector2 input_dem_top_pix = input_dem_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_top_pix));
-                  Vector2 lon_lat_top = input_img_geo.pixel_to_lonlat(input_img_top_pix);
-                  Vector3 longlat3_top(lon_lat_top(0),lon_lat_top(1),(interp_dem_image)(input_dem_top_pix(0), input_dem_top_pix(1)));
-                  Vector3 xyz_top = input_img_geo.datum().geodetic_to_cartesian(longlat3_top);
-
-                  //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
-                  Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
-
-                  //check for overlap between the output image and the input DEM image
-                  Vector2 overlap_pix = overlap_geo.lonlat_to_pixel(input_img_geo.pixel_to_lonlat(input_img_pix));
-                  x = (int)overlap_pix[0];
-                  y = (int)overlap_pix[1];
-
-                  //image dependent part of the code  - START
-                  PixelMask<PixelGray<uint8> > overlap_img_pixel = interp_overlap_img(x, y);
-
-                  //check for valid overlap_img coordinates
-                  //TO DO: remove shadow pixels in the overlap_img.
-                  if ((x>=0) && (x < overlap_img.cols()) && (y>=0) && (y< overlap_img.rows()) && interpOverlapShadowImage(x, y) == 0){
-
-                    if ( is_valid(overlap_img_pixel) ) { //common area between input_img and overlap_img
-
-                      float overlap_img_reflectance;
-                      overlap_img_reflectance = ComputeReflectance(normal, xyz, overlap_img_params[i], globalParams);
-                      if (overlap_img_reflectance > 0){
-                         float overlap_img_error = ComputeError((float)overlap_img_pixel, overlap_img_params[i].exposureTime,
-                                                                       (float)output_img_r(l, k), overlap_img_reflectance);
-//                         float overlap_img_error = ComputeError_Albedo((float)overlap_img_pixel, overlap_img_params[i].exposureTime,
-//                                                                       (float)output_img_r(l, k), overlap_img_reflectance, xyz, xyz_prior);
-
-                         float overlap_albedo_grad = ComputeGradient_Albedo(overlap_img_params[i].exposureTime, overlap_img_reflectance);
-                         if (globalParams.useWeights == 0){
-                             nominator(l, k) = nominator(l, k) + overlap_albedo_grad*overlap_img_error;
-                             denominator(l, k) = denominator(l, k) + overlap_albedo_grad*overlap_albedo_grad;
-                         }
-                         else{
-
-                           //float weight = ComputeWeights(overlap_pix, overlap_img_params[i].center2D, overlap_img_params[i].maxDistance);
-                            float weight = ComputeLineWeights(overlap_pix, overlap_img_params[i].centerLine, overlap_img_params[i].maxDistArray);
-                            nominator(l, k)   = nominator(l,k) + overlap_albedo_grad*overlap_img_error*weight;
-                            denominator(l, k) = denominator(l,k) + overlap_albedo_grad*overlap_albedo_grad*weight;
-                         }
-                      }
-                    }//if
-                  }//if
-
-                  //image dependent part of the code  - START
-               }
-            }
-          }
-        }// for l
-      } // for k
-    } //for i
-
-
-    //finalize the output image
-    for (k = 0 ; k < output_img.rows(); ++k) {
-       for (l = 0; l < output_img.cols(); ++l) {
-           
-           output_img(l,k).invalidate();
-           
-           if ( is_valid(output_img(l,k)) ) {
-             if ((float)denominator(l, k) != 0){
-                float delta = (float)nominator(l, k)/(float)denominator(l, k);
-                //printf("k = %d, l = %d, output_img = %f, delta = %f\n", k, l, (float)output_img(l,k), delta);
-                output_img(l,k) = (float)output_img_r(l, k) + delta;
-                output_img(l,k).validate();
-             }
-           }
-
-       }
-    }
-
-
-
-    //write the output (albedo) image
-     write_georeferenced_image(output_img_file,
-                              channel_cast<uint8>(clamp(output_img,0.0,255.0)),
-                              input_img_geo, TerminalProgressCallback("photometry","Processing:"));
-
-
+  write_albedo(input_img_params.reliefFilename,
+               UpdateAlbedoView(input_img_params, overlap_img_params, globalParams));
 }
 //input_files[i], input_files[i-1], output_files[i], output_files[i-1]
 //writes the current albedo of the current image in the area of overlap with the previous mage
@@ -22,6 +22,7 @@ using namespace vw::cartography;
 #include <vw/Photometry/Misc.h>
 #include <vw/Photometry/Weights.h>
 #include <vw/Photometry/Exposure.h>
+#include <vw/Photometry/Index.h>
 using namespace vw::photometry;
 
 //determines the best guess for the exposure time from the reflectance model
@@ -131,9 +132,6 @@ void vw::photometry::ComputeExposure(ModelParams *currModelParams,
   DiskImageView<PixelMask<PixelGray<uint8> > > curr_image(curr_input_file);
   DiskImageView<PixelMask<PixelGray<uint8> > > curr_albedo(curr_albedo_file);
 
-  GeoReference curr_geo;
-  read_georeference(curr_geo, curr_input_file);
-
   float currReflectance;
 
   printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, curr_input_file.c_str());
@@ -177,15 +175,14 @@ void vw::photometry::ComputeExposureAlbedo(ModelParams *currModelParams,
   DiskImageView<PixelMask<PixelGray<uint8> > > curr_image(curr_input_file);
   DiskImageView<PixelMask<PixelGray<uint8> > > curr_albedo(curr_albedo_file);
 
-  GeoReference curr_geo;
-  read_georeference(curr_geo, curr_input_file);
+  GeoReference curr_geo = OverlapIndex::instance().georef(curr_input_file);
 
   float currReflectance;
+  ReflectanceModel reflectance_model(*currModelParams, globalParams);
 
   //read the DEM file
   DiskImageView<PixelGray<float> >  dem_image(DEM_file);
-  GeoReference curr_dem_geo;
-  read_georeference(curr_dem_geo, DEM_file);
+  GeoReference curr_dem_geo = OverlapIndex::instance().georef(DEM_file);
 
   printf("init exposure time = %f, file = %s\n", currModelParams->exposureTime, curr_input_file.c_str());
 
@@ -234,7 +231,7 @@ void vw::photometry::ComputeExposureAlbedo(ModelParams *currModelParams,
             //Vector3 normal = computeNormalFrom3DPoints(xyz, xyz_left, xyz_top);
             Vector3 normal = computeNormalFrom3DPointsGeneral(xyz, xyz_left, xyz_top);
 
-            currReflectance = ComputeReflectance(normal, xyz, *currModelParams, globalParams);
+            currReflectance = reflectance_model(normal, xyz);
             float error = ComputeError((float)curr_image(l,k), currModelParams->exposureTime,
                                                 (float)curr_albedo(l,k), currReflectance);
 //            float error = ComputeError_Exposure((float)curr_image(l,k), currModelParams->exposureTime,
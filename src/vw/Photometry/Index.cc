@@ -59,3 +59,82 @@ std::vector<float> build_histogram(ImageViewBase<ViewT> const& view) {
         return result;
 }
 
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/filesystem/operations.hpp>
+
+using namespace vw::photometry;
+
+RunOnce OverlapIndex::s_once = VW_RUNONCE_INIT;
+OverlapIndex* OverlapIndex::s_instance = 0;
+
+void OverlapIndex::init() { s_instance = new OverlapIndex(); }
+
+OverlapIndex& OverlapIndex::instance() {
+  s_once.run(init);
+  return *s_instance;
+}
+
+// Reads the file's header outside the lock; two threads may both read
+// a new file, and the last one in wins.
+OverlapIndex::Entry OverlapIndex::entry(std::string const& filename) {
+  const std::time_t mtime = boost::filesystem::last_write_time(filename);
+  {
+    Mutex::Lock lock(m_mutex);
+    std::map<std::string, Entry>::const_iterator it = m_footprints.find(filename);
+    if (it != m_footprints.end() && it->second.mtime == mtime)
+      return it->second;
+  }
+
+  Entry e;
+  e.mtime = mtime;
+  boost::scoped_ptr<DiskImageResource> r(DiskImageResource::open(filename));
+  read_georeference(e.footprint.georef, *r);
+  e.footprint.cols = r->cols();
+  e.footprint.rows = r->rows();
+
+  Mutex::Lock lock(m_mutex);
+  m_footprints[filename] = e;
+  return e;
+}
+
+ImageFootprint OverlapIndex::footprint(std::string const& filename) {
+  return entry(filename).footprint;
+}
+
+BBox2i OverlapIndex::overlap(std::string const& image, std::string const& other) {
+  const Entry a = entry(image), b = entry(other);
+  const std::pair<std::string, std::string> key(image, other);
+  {
+    Mutex::Lock lock(m_mutex);
+    std::map<std::pair<std::string, std::string>, Overlap>::const_iterator it = m_overlaps.find(key);
+    if (it != m_overlaps.end() && it->second.image_mtime == a.mtime && it->second.other_mtime == b.mtime)
+      return it->second.bbox;
+  }
+
+  Overlap o;
+  o.image_mtime = a.mtime;
+  o.other_mtime = b.mtime;
+  o.bbox = GeoTransform(b.footprint.georef, a.footprint.georef).forward_bbox(b.footprint.bbox());
+  o.bbox.expand(1);
+  o.bbox.crop(a.footprint.bbox());
+
+  Mutex::Lock lock(m_mutex);
+  m_overlaps[key] = o;
+  return o.bbox;
+}
+
+std::vector<size_t> OverlapIndex::overlapping(std::string const& image,
+                                              std::vector<std::string> const& candidates) {
+  std::vector<size_t> result;
+  for (size_t i = 0; i < candidates.size(); ++i)
+    if (!overlap(image, candidates[i]).empty())
+      result.push_back(i);
+  return result;
+}
+
+void OverlapIndex::clear() {
+  Mutex::Lock lock(m_mutex);
+  m_footprints.clear();
+  m_overlaps.clear();
+}
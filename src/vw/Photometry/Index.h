@@ -12,11 +12,72 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <ctime>
+
+#include <vw/Core/Thread.h>
+#include <vw/Math/BBox.h>
+#include <vw/Cartography/GeoReference.h>
 
 namespace vw {
 namespace photometry {
 
+  /// What the overlap index keeps about one georeferenced image (or
+  /// DEM) file.
+  struct ImageFootprint {
+    cartography::GeoReference georef;
+    int32 cols, rows;
+
+    BBox2i bbox() const { return BBox2i(0, 0, cols, rows); }
+  };
+
+  /// The footprints of the images and DEMs of a photometry run, and the
+  /// regions where they overlap.  Each file's georeference is read, and
+  /// each overlap is computed, once per process, and every stage shares
+  /// them.  An entry is redone when its file changes on disk.  Thread
+  /// safe.
+  class OverlapIndex {
+      struct Entry {
+        std::time_t mtime;
+        ImageFootprint footprint;
+      };
+      struct Overlap {
+        std::time_t image_mtime, other_mtime;
+        BBox2i bbox;
+      };
+
+      Mutex m_mutex;
+      std::map<std::string, Entry> m_footprints;
+      std::map<std::pair<std::string, std::string>, Overlap> m_overlaps;
+
+      static RunOnce s_once;
+      static OverlapIndex* s_instance;
+      static void init();
+
+      OverlapIndex() {}
+      Entry entry(std::string const& filename);
+
+    public:
+      static OverlapIndex& instance();
+
+      /// The georeference and size of filename.
+      ImageFootprint footprint(std::string const& filename);
+
+      cartography::GeoReference georef(std::string const& filename) {
+        return footprint(filename).georef;
+      }
+
+      /// The pixels of image that other covers, padded by a pixel for
+      /// interpolation; empty if they don't overlap.
+      BBox2i overlap(std::string const& image, std::string const& other);
+
+      /// The indices of the candidates that overlap image.
+      std::vector<size_t> overlapping(std::string const& image,
+                                      std::vector<std::string> const& candidates);
 
+      /// Forgets every footprint and overlap.
+      void clear();
+  };
 
 }} // end vw::photometry
 
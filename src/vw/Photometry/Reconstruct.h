@@ -14,6 +14,9 @@
 #define LAMBERT 1
 #define LUNAR_LAMBERT 2
 
+#define THRESHOLD_SHADOWS 0
+#define CAST_SHADOWS 1
+
 #include <iostream>
 #include <string>
 #include <vw/Math/Vector.h>
@@ -14,6 +14,7 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <cmath>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -315,32 +316,106 @@ vw::photometry::computeLunarLambertianReflectanceFromNormal(Vector3 sunPos, Vect
 }
 
 float
-vw::photometry::ComputeReflectance(Vector3 normal, Vector3 xyz,
-                                   ModelParams input_img_params,
-                                   GlobalParams globalParams) {
-  float input_img_reflectance;
-
-  switch ( globalParams.reflectanceType )
-    {
-    case LUNAR_LAMBERT:
-      //printf("Lunar Lambert\n");
-      input_img_reflectance = computeLunarLambertianReflectanceFromNormal(input_img_params.sunPosition,
-                                                                          input_img_params.spacecraftPosition,
-                                                                          xyz,  normal);
-      break;
-    case LAMBERT:
-      //printf("Lambert\n");
-      input_img_reflectance = computeLambertianReflectanceFromNormal(input_img_params.sunPosition,
-                                                                     xyz,  normal);
-      break;
-
-    default:
-      //printf("No reflectance model\n");
-      input_img_reflectance = 1;
+vw::photometry::ComputeReflectance(Vector3 const& normal, Vector3 const& xyz,
+                                   ModelParams const& input_img_params,
+                                   GlobalParams const& globalParams) {
+  return ReflectanceModel(input_img_params, globalParams)(normal, xyz);
+}
+
+void
+vw::photometry::SurfaceTile::resize(size_t n) {
+  x.assign(n, 0);  y.assign(n, 0);  z.assign(n, 0);
+  nx.assign(n, 0); ny.assign(n, 0); nz.assign(n, 0);
+  valid.assign(n, 0);
+}
+
+void
+vw::photometry::compute_tile_normals(SurfaceTile& tile, SurfaceTile const& halo,
+                                     int32 cols, int32 rows) {
+  const size_t hcols = cols + 1;
+  for (int32 j = 0; j < rows; ++j) {
+    const size_t t = size_t(j)*cols;       // this row of the tile
+    const size_t c = size_t(j+1)*hcols + 1; // the same row of the halo
+    const size_t u = size_t(j)*hcols + 1;   // the row above it
+    for (int32 i = 0; i < cols; ++i) {
+      // -(p2-p1) x (p3-p1), with p2 the left and p3 the top neighbour
+      const double ax = halo.x[c+i-1] - tile.x[t+i], ay = halo.y[c+i-1] - tile.y[t+i], az = halo.z[c+i-1] - tile.z[t+i];
+      const double bx = halo.x[u+i] - tile.x[t+i],   by = halo.y[u+i] - tile.y[t+i],   bz = halo.z[u+i] - tile.z[t+i];
+      const double cx = ay*bz - az*by, cy = az*bx - ax*bz, cz = ax*by - ay*bx;
+      const double len = std::sqrt(cx*cx + cy*cy + cz*cz);
+      const double s = len > 0 ? -1.0/len : 0.0;
+      tile.nx[t+i] = cx*s;
+      tile.ny[t+i] = cy*s;
+      tile.nz[t+i] = cz*s;
+      tile.valid[t+i] = tile.valid[t+i] && halo.valid[c+i-1] && halo.valid[u+i];
     }
+  }
+}
 
-  return input_img_reflectance;
+vw::photometry::ReflectanceModel::ReflectanceModel(ModelParams const& params,
+                                                   GlobalParams const& globalParams)
+  : m_type(globalParams.reflectanceType),
+    m_sun(params.sunPosition), m_view(params.spacecraftPosition) {}
 
+float
+vw::photometry::ReflectanceModel::operator()(Vector3 const& normal, Vector3 const& xyz) const {
+  switch (m_type) {
+  case LUNAR_LAMBERT:
+    return computeLunarLambertianReflectanceFromNormal(m_sun, m_view, xyz, normal);
+  case LAMBERT:
+    return computeLambertianReflectanceFromNormal(m_sun, xyz, normal);
+  default:
+    return 1;
+  }
+}
+
+// The same models as the per-point functions above, over arrays.  The
+// cosines are found in one pass and the model applied in another, so
+// that both are straight-line loops.
+void
+vw::photometry::ReflectanceModel::operator()(SurfaceTile const& tile,
+                                             std::vector<float>& reflectance) const {
+  const size_t n = tile.size();
+  reflectance.resize(n);
+  if (m_type != LUNAR_LAMBERT && m_type != LAMBERT) {
+    for (size_t i = 0; i < n; ++i)
+      reflectance[i] = tile.valid[i] ? 1.0f : 0.0f;
+    return;
+  }
+
+  // cos(incidence), cos(emission) and cos(phase) of each point.
+  std::vector<float> mu_0(n), mu(n), cos_alpha(n);
+  for (size_t i = 0; i < n; ++i) {
+    double sx = m_sun[0] - tile.x[i], sy = m_sun[1] - tile.y[i], sz = m_sun[2] - tile.z[i];
+    double vx = m_view[0] - tile.x[i], vy = m_view[1] - tile.y[i], vz = m_view[2] - tile.z[i];
+    const double sl = 1.0/std::sqrt(sx*sx + sy*sy + sz*sz);
+    const double vl = 1.0/std::sqrt(vx*vx + vy*vy + vz*vz);
+    sx *= sl; sy *= sl; sz *= sl;
+    vx *= vl; vy *= vl; vz *= vl;
+    mu_0[i] = float(sx*tile.nx[i] + sy*tile.ny[i] + sz*tile.nz[i]);
+    mu[i] = float(vx*tile.nx[i] + vy*tile.ny[i] + vz*tile.nz[i]);
+    cos_alpha[i] = float(sx*vx + sy*vy + sz*vz);
+  }
+
+  if (m_type == LAMBERT) {
+    for (size_t i = 0; i < n; ++i)
+      reflectance[i] = tile.valid[i] ? mu_0[i] : 0.0f;
+    return;
+  }
+
+  //Alfred McEwen's model
+  const float A = -0.019;
+  const float B =  0.000242;
+  const float C = -0.00000146;
+  for (size_t i = 0; i < n; ++i) {
+    const float deg_alpha = acos(cos_alpha[i])*180.0/M_PI;
+    const float L = 1.0 + A*deg_alpha + B*deg_alpha*deg_alpha + C*deg_alpha*deg_alpha*deg_alpha;
+    const float m = mu[i] < 0 ? 0.0f : mu[i];
+    float r = (mu_0[i] + m == 0) ? 0.0f : 2*L*mu_0[i]/(mu_0[i]+m) + (1-L)*mu_0[i];
+    if (mu_0[i] < 0 || r < 0 || !tile.valid[i])
+      r = 0;
+    reflectance[i] = r;
+  }
 }
 
 float vw::photometry::computeImageReflectanceNoWrite(ModelParams input_img_params,
@@ -409,43 +484,32 @@ float vw::photometry::computeImageReflectanceNoWrite(ModelParams input_img_param
     }
   }  
 
-  // convert xyz pixels to surface normals
-  ImageView<Vector3> surface_normal(dem_xyz.cols(), dem_xyz.rows());
-  for (int y=1; y < (int)surface_normal.rows(); y++) {
-    for (int x=1; x < (int)surface_normal.cols(); x++) {
-      Vector3& result = surface_normal(x, y);
-      result = Vector3();
-      
-      Vector3 base = dem_xyz(x, y);
-      if (base == Vector3()) {
-        continue;
-      }
-      Vector3 x1 = dem_xyz(x-1, y);
-      if (x1 == Vector3()) {
-        continue;
-      }
-      Vector3 y1 = dem_xyz(x, y-1);
-      if (y1 == Vector3()) {
-        continue;
+  // convert xyz pixels to surface normals and reflectance, the whole
+  // DEM (but its first row and column) as one tile
+  const int32 cols = dem_xyz.cols() - 1, rows = dem_xyz.rows() - 1;
+  output_img.set_size(input_img.cols(), input_img.rows());
+  if (cols > 0 && rows > 0) {
+    SurfaceTile halo, surface;
+    halo.resize(size_t(cols+1)*(rows+1));
+    surface.resize(size_t(cols)*rows);
+    for (int y=0; y <= rows; y++) {
+      for (int x=0; x <= cols; x++) {
+        if (dem_xyz(x, y) == Vector3())
+          continue;
+        halo.set_point(size_t(y)*(cols+1) + x, dem_xyz(x, y));
+        if (x > 0 && y > 0)
+          surface.set_point(size_t(y-1)*cols + x-1, dem_xyz(x, y));
       }
-
-      Vector3 dx = base - x1;
-      Vector3 dy = base - y1;
-      result = -normalize(cross_prod(dx, dy));
     }
-  }
-
-  // compute reflectance
-  output_img.set_size(input_img.cols(), input_img.rows());
-  for (int y=0; y < (int)output_img.rows(); y++) {
-    for (int x=0; x < (int)output_img.cols(); x++) {
-      Vector3 normal = surface_normal(x, y);
-      if (normal == Vector3()) {
-        continue;
+    compute_tile_normals(surface, halo, cols, rows);
+
+    std::vector<float> reflectance;
+    ReflectanceModel(input_img_params, globalParams)(surface, reflectance);
+    for (int y=1; y <= rows && y < (int)output_img.rows(); y++) {
+      for (int x=1; x <= cols && x < (int)output_img.cols(); x++) {
+        if (surface.valid[size_t(y-1)*cols + x-1])
+          output_img(x, y) = reflectance[size_t(y-1)*cols + x-1];
       }
-      Vector3 xyz = dem_xyz(x, y);
-      
-      output_img(x, y) = ComputeReflectance(normal, xyz, input_img_params, globalParams);
     }
   }
 
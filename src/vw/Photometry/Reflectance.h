@@ -17,6 +17,7 @@
 #endif
 
 #include <string>
+#include <vector>
 #include <vw/Math/Vector.h>
 
 #include <vw/Photometry/Reconstruct.h>
@@ -38,12 +39,11 @@ namespace photometry {
   };
   
   template <class ImageT>
-    UnaryPerPixelView<BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, cartography::DemToPointImageFunctor<typename ImageT::pixel_type> >, LLAtoXYZFunctor>
+    UnaryPerPixelView<cartography::DemToPointImageView<ImageT>, LLAtoXYZFunctor>
     dem_to_point_cloud( ImageViewBase<ImageT> const& image,
                         cartography::GeoReference const& georef ) {
-    typedef cartography::DemToPointImageFunctor<typename ImageT::pixel_type> func1_type;
     typedef LLAtoXYZFunctor func2_type;
-    typedef BinaryPerPixelView<PerPixelIndexView<VectorIndexFunctor>, ImageT, func1_type> inner_view;
+    typedef cartography::DemToPointImageView<ImageT> inner_view;
     return UnaryPerPixelView<inner_view,func2_type>(dem_to_point_image( image.impl(), georef ), func2_type(georef.datum()) );
   }
 
@@ -69,16 +69,60 @@ namespace photometry {
                                                     Vector3 normal);
   float computeImageReflectance(ModelParams input_img_params,
                                 GlobalParams globalParams);
-  float ComputeReflectance(Vector3 normal, Vector3 xyz,
-                           ModelParams input_img_params,
-                           GlobalParams globalParams);
+  float ComputeReflectance(Vector3 const& normal, Vector3 const& xyz,
+                           ModelParams const& input_img_params,
+                           GlobalParams const& globalParams);
   float computeImageReflectance(ModelParams input_img_params,
                                 ModelParams overlap_img_params,
                                 GlobalParams globalParams);
   float computeImageReflectanceNoWrite(ModelParams input_img_params,
                                        GlobalParams globalParams,
                                        ImageView<PixelMask<PixelGray<float> > >& output_img);
-  
+
+  /// The surface points of a tile and their normals, one array per
+  /// coordinate (structure of arrays) so that the loops over them
+  /// vectorize.  Point i is only used where valid[i] is nonzero.
+  struct SurfaceTile {
+    std::vector<double> x, y, z;
+    std::vector<double> nx, ny, nz;
+    std::vector<uint8> valid;
+
+    void resize(size_t n);
+    size_t size() const { return x.size(); }
+
+    void set_point(size_t i, Vector3 const& p) {
+      x[i] = p[0]; y[i] = p[1]; z[i] = p[2]; valid[i] = 1;
+    }
+    Vector3 point(size_t i) const { return Vector3(x[i], y[i], z[i]); }
+    Vector3 normal(size_t i) const { return Vector3(nx[i], ny[i], nz[i]); }
+  };
+
+  /// Fills in the normals of a cols x rows tile of points, a row at a
+  /// time, as computeNormalFrom3DPointsGeneral(point, left, top) does.
+  /// The left and top neighbours come from halo, a (cols+1) x (rows+1)
+  /// grid of points whose (i+1, j+1) is the tile's (i, j).  A point
+  /// stays valid only if both of its neighbours are.
+  void compute_tile_normals(SurfaceTile& tile, SurfaceTile const& halo,
+                            int32 cols, int32 rows);
+
+  /// One image's reflectance model (globalParams.reflectanceType), with
+  /// the sun and spacecraft positions looked up once.  Gives the same
+  /// values as ComputeReflectance, a point at a time or over a whole
+  /// SurfaceTile.
+  class ReflectanceModel {
+    int m_type;
+    Vector3 m_sun, m_view;
+  public:
+    ReflectanceModel(ModelParams const& params, GlobalParams const& globalParams);
+
+    float operator()(Vector3 const& normal, Vector3 const& xyz) const;
+
+    /// Writes the reflectance of each of tile's points to reflectance
+    /// (0 for invalid points).
+    void operator()(SurfaceTile const& tile, std::vector<float>& reflectance) const;
+  };
+
+
 }}
 
 #endif//__VW_PHOTOMETRY_REFLECTANCE_H__
@@ -26,40 +26,219 @@ using namespace vw;
 using namespace vw::cartography;
 
 #include <math.h>
+#include <algorithm>
+#include <limits>
+#include <boost/scoped_ptr.hpp>
+#include <vw/Photometry/Index.h>
 #include <vw/Photometry/Shadow.h>
 #include <vw/Photometry/Reconstruct.h>
 using namespace vw::photometry;
 
-void vw::photometry::ComputeSaveShadowMap( ModelParams input_img_params,
-                                           GlobalParams globalParams) {
-  std::string shadowMapFile = input_img_params.shadowFilename;
-  std::string origfile = input_img_params.inputFilename;
-  DiskImageView<PixelMask<PixelGray<uint8> > > originalImage(origfile);
-  ImageView<PixelMask<PixelGray<uint8> > > shadowImage(originalImage.cols(), originalImage.rows());
+namespace {
 
-  GeoReference originalGeo;
-  read_georeference(originalGeo, origfile);
+  // Marks "no terrain" in the sweep's height and horizon lines.
+  const double no_height = -1e30;
 
-  for (int k=0; k < (int)originalImage.rows(); ++k) {
-    for (int l=0; l < (int)originalImage.cols(); ++l) {
+  // Marks the pixels of heights (metres, or no_height) that terrain
+  // between them and the sun hides.  The sweep starts at the side
+  // nearest the sun and walks away from it a line of pixels at a time,
+  // carrying along each line the height of the lowest line of sight to
+  // the sun that clears everything behind it (the horizon).  A pixel's
+  // horizon is its upstream neighbour's, interpolated between two
+  // pixels of the previous line and lowered by drop for each pixel
+  // travelled.  toward_sun is the unit direction to the sun in pixels.
+  void sweep_cast_shadows(ImageView<double> const& heights, Vector2 const& toward_sun,
+                          double drop, ImageView<uint8>& shadowed) {
+    shadowed.set_size(heights.cols(), heights.rows());
+    fill(shadowed, 0);
 
+    // Sweep along the axis the sun direction is closest to, so each
+    // step moves one line along it and at most a pixel across.
+    const bool major_x = fabs(toward_sun[0]) >= fabs(toward_sun[1]);
+    const double a = major_x ? toward_sun[0] : toward_sun[1];
+    const double b = major_x ? toward_sun[1] : toward_sun[0];
+    const int32 n_major = major_x ? heights.cols() : heights.rows();
+    const int32 n_minor = major_x ? heights.rows() : heights.cols();
+    const double shift = b / fabs(a), step_drop = drop / fabs(a);
+    const int32 first = a > 0 ? n_major - 1 : 0, dir = a > 0 ? -1 : 1;
+
+    std::vector<double> prev(n_minor, no_height), cur(n_minor);
+    for (int32 n = 0, i = first; n < n_major; ++n, i += dir) {
+      for (int32 j = 0; j < n_minor; ++j) {
+        const int32 x = major_x ? i : j, y = major_x ? j : i;
+        double horizon = no_height;
+        const double pos = j + shift;
+        const int32 j0 = (int32)floor(pos);
+        if (j0 >= 0 && j0 < n_minor) {
+          const double f = pos - j0;
+          double up = prev[j0];
+          if (f > 0 && j0 + 1 < n_minor)
+            up = (prev[j0] <= no_height || prev[j0+1] <= no_height) ? std::max(prev[j0], prev[j0+1])
+                                                                    : (1-f)*prev[j0] + f*prev[j0+1];
+          if (up > no_height)
+            horizon = up - step_drop;
+        }
+        const double h = heights(x, y);
+        if (h > no_height && h < horizon)
+          shadowed(x, y) = 1;
+        cur[j] = std::max(h, horizon);
+      }
+      prev.swap(cur);
+    }
+  }
 
-      Vector2 sample_pix(l,k);
+  // The shadow map of an image, a block at a time: the pixels darker
+  // than shadowThresh and, if shadowInitType is CAST_SHADOWS, the ones
+  // that the DEM hides from the sun.  The sun direction is found at
+  // each block's centre.
+  class ShadowMapView : public ImageViewBase<ShadowMapView> {
+    ModelParams m_params;
+    GlobalParams m_global;
+    DiskImageView<PixelMask<PixelGray<uint8> > > m_input;
+    GeoReference m_input_geo;
+    bool m_cast;
+    ImageViewRef<PixelMask<PixelGray<float> > > m_height; // the DEM on the input's pixels
+    double m_relief;
 
-      if ( is_valid(originalImage(l,k)) ) {
-        shadowImage(l, k) = 0;
-        //printf("shadowThresh = %d\n", globalParams.shadowThresh);
-        if (originalImage(l, k) < globalParams.shadowThresh){
-          shadowImage(l, k) = 255;
+    // The DEM's highest minus its lowest height, which bounds how far
+    // a shadow can reach.
+    static double relief(DiskImageView<PixelGray<float> > const& dem, float nodata) {
+      float lo = std::numeric_limits<float>::max(), hi = -lo;
+      const int32 tile = vw_settings().default_tile_size();
+      for (int32 y = 0; y < dem.rows(); y += tile) {
+        for (int32 x = 0; x < dem.cols(); x += tile) {
+          BBox2i bbox(x, y, std::min(tile, dem.cols() - x), std::min(tile, dem.rows() - y));
+          ImageView<PixelGray<float> > block = crop(dem, bbox);
+          for (int32 k = 0; k < block.rows(); ++k)
+            for (int32 l = 0; l < block.cols(); ++l)
+              if (block(l,k) != nodata) {
+                lo = std::min(lo, (float)block(l,k));
+                hi = std::max(hi, (float)block(l,k));
+              }
         }
       }
+      return hi >= lo ? hi - lo : 0;
+    }
+
+  public:
+    typedef PixelMask<PixelGray<uint8> > pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<ShadowMapView> pixel_accessor;
 
+    ShadowMapView(ModelParams const& params, GlobalParams const& global)
+      : m_params(params), m_global(global), m_input(params.inputFilename),
+        m_input_geo(OverlapIndex::instance().georef(params.inputFilename)),
+        m_cast(global.shadowInitType == CAST_SHADOWS), m_relief(0) {
+      if (!m_cast)
+        return;
+      DiskImageView<PixelGray<float> > dem(params.meanDEMFilename);
+      GeoTransform tx(OverlapIndex::instance().georef(params.meanDEMFilename), m_input_geo);
+      tx.set_tolerance(0.05);
+      m_height = transform(create_mask(dem, PixelGray<float>(global.noDEMDataValue)), tx,
+                           m_input.cols(), m_input.rows(), ConstantEdgeExtension());
+      m_relief = relief(dem, global.noDEMDataValue);
     }
-  }
 
-  write_georeferenced_image(shadowMapFile,
-                            channel_cast<uint8>(shadowImage),
-                            originalGeo, TerminalProgressCallback("photometry","Processing:"));
+    inline int32 cols() const { return m_input.cols(); }
+    inline int32 rows() const { return m_input.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    // Sweeps a whole block per pixel: rasterize instead.
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    GeoReference const& georeference() const { return m_input_geo; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(BBox2i const& bbox) const {
+      const int32 w = bbox.width(), h = bbox.height();
+      ImageView<PixelMask<PixelGray<uint8> > > input = crop(m_input, bbox);
+      ImageView<pixel_type> out(w, h);
+      for (int32 k = 0; k < h; ++k)
+        for (int32 l = 0; l < w; ++l)
+          if (is_valid(input(l,k)))
+            out(l,k) = input(l,k) < m_global.shadowThresh ? 255 : 0;
+      if (m_cast)
+        cast_shadows(bbox, out);
+      return prerasterize_type(out, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()));
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const { vw::rasterize(prerasterize(bbox), dest, bbox); }
+
+  private:
+    void cast_shadows(BBox2i const& bbox, ImageView<pixel_type>& out) const {
+      // The sun's direction at the block's centre, in the local
+      // horizontal frame and in pixels, and the metres a pixel spans
+      // along it.
+      Datum const& datum = m_input_geo.datum();
+      Vector2 center = (bbox.min() + bbox.max()) / 2;
+      Vector2 lon_lat = m_input_geo.pixel_to_lonlat(center);
+      Vector3 p = datum.geodetic_to_cartesian(Vector3(lon_lat[0], lon_lat[1], 0));
+      Vector3 up = datum.geodetic_to_cartesian(Vector3(lon_lat[0], lon_lat[1], 1)) - p;
+      Vector3 sun = normalize(m_params.sunPosition - p);
+      const double sin_elev = dot_prod(sun, up);
+      Vector3 sun_h = sun - sin_elev * up;
+      if (sin_elev <= 0) {
+        // The sun is below the horizon.
+        for (int32 k = 0; k < out.rows(); ++k)
+          for (int32 l = 0; l < out.cols(); ++l)
+            if (is_valid(out(l,k)))
+              out(l,k) = 255;
+        return;
+      }
+      if (m_relief == 0 || norm_2(sun_h) < 1e-9)
+        return;
+
+      Vector2 lon_lat_x = m_input_geo.pixel_to_lonlat(center + Vector2(1,0));
+      const double pixel_size = norm_2(datum.geodetic_to_cartesian(Vector3(lon_lat_x[0], lon_lat_x[1], 0)) - p);
+      const double probe = 16 * pixel_size;
+      Vector3 q = datum.cartesian_to_geodetic(p + probe * normalize(sun_h));
+      Vector2 toward_sun = m_input_geo.lonlat_to_pixel(Vector2(q[0], q[1])) - center;
+      if (norm_2(toward_sun) == 0)
+        return;
+      const double metres_per_pixel = probe / norm_2(toward_sun);
+      toward_sun = normalize(toward_sun);
+      const double drop = metres_per_pixel * sin_elev / norm_2(sun_h);
+
+      // Terrain further upstream than the longest shadow the DEM's
+      // relief can cast doesn't matter.
+      const double reach = std::min(m_relief / drop + 2, double(std::max(cols(), rows())));
+      const Vector2 shift = reach * toward_sun;
+      BBox2i region = bbox;
+      region.grow(bbox.min() + Vector2i((int32)floor(shift[0]), (int32)floor(shift[1])));
+      region.grow(bbox.max() + Vector2i((int32)ceil(shift[0]), (int32)ceil(shift[1])));
+      region.crop(bounding_box(m_input));
+
+      ImageView<PixelMask<PixelGray<float> > > dem = crop(m_height, region);
+      ImageView<double> heights(region.width(), region.height());
+      for (int32 k = 0; k < heights.rows(); ++k)
+        for (int32 l = 0; l < heights.cols(); ++l)
+          heights(l,k) = is_valid(dem(l,k)) ? double(dem(l,k)) : no_height;
+
+      ImageView<uint8> shadowed;
+      sweep_cast_shadows(heights, toward_sun, drop, shadowed);
+      const Vector2i offset = bbox.min() - region.min();
+      for (int32 k = 0; k < out.rows(); ++k)
+        for (int32 l = 0; l < out.cols(); ++l)
+          if (is_valid(out(l,k)) && shadowed(l + offset.x(), k + offset.y()))
+            out(l,k) = 255;
+    }
+  };
+
+} // anonymous namespace
+
+void vw::photometry::ComputeSaveShadowMap( ModelParams input_img_params,
+                                           GlobalParams globalParams) {
+  ShadowMapView shadow(input_img_params, globalParams);
+
+  boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(input_img_params.shadowFilename, shadow.format()));
+  if (r->has_block_write())
+    r->set_block_write_size(Vector2i(vw_settings().default_tile_size(),
+                                     vw_settings().default_tile_size()));
+  write_georeference(*r, shadow.georeference());
+  block_write_image(*r, shadow, TerminalProgressCallback("photometry","Processing:"));
 }
 
 
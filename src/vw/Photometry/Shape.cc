@@ -18,6 +18,7 @@
 using namespace vw;
 using namespace vw::cartography;
 
+#include <vw/Photometry/Index.h>
 #include <vw/Photometry/Shape.h>
 #include <vw/Photometry/Reconstruct.h>
 #include <vw/Photometry/Weights.h>
@@ -56,8 +57,7 @@ void vw::photometry::InitDEM( ModelParams input_img_params,
   std::string var2_DEM_file = input_img_params.var2DEMFilename;
 
   DiskImageView<PixelGray<float> >  input_DEM_image(input_DEM_file);
-  GeoReference input_DEM_geo;
-  read_georeference(input_DEM_geo, input_DEM_file);
+  GeoReference input_DEM_geo = OverlapIndex::instance().georef(input_DEM_file);
 
   ImageView<PixelGray<float> > mean_DEM_image(input_DEM_image.cols(), input_DEM_image.rows());
   ImageView<PixelMask<PixelGray<float> > >var2_DEM_image(input_DEM_image.cols(), input_DEM_image.rows());
@@ -99,17 +99,22 @@ void vw::photometry::InitDEM( ModelParams input_img_params,
   for (i = 0; i < (int) overlap_img_params.size(); i++){
 
     printf("DEM = %s\n", overlap_img_params[i].DEMFilename.c_str());
+
+    //only the part of the input DEM that the overlap DEM covers
+    BBox2i region = OverlapIndex::instance().overlap(input_DEM_file, overlap_img_params[i].DEMFilename);
+    if (region.empty())
+      continue;
+
     DiskImageView<PixelGray<float> >  overlap_DEM_image(overlap_img_params[i].DEMFilename);
-    GeoReference overlap_DEM_geo;
-    read_georeference(overlap_DEM_geo, overlap_img_params[i].DEMFilename);
+    GeoReference overlap_DEM_geo = OverlapIndex::instance().georef(overlap_img_params[i].DEMFilename);
 
 
     ImageViewRef<PixelGray<float> >  interp_overlap_DEM_image = interpolate(edge_extend(overlap_DEM_image.impl(),
                                                                                         ConstantEdgeExtension()),
                                                                             BilinearInterpolation());
 
-    for (k = 0 ; k < (unsigned)input_DEM_image.rows(); ++k) {
-      for (l = 0; l < (unsigned)input_DEM_image.cols(); ++l) {
+    for (k = region.min().y() ; k < (unsigned)region.max().y(); ++k) {
+      for (l = region.min().x(); l < (unsigned)region.max().x(); ++l) {
 
         Vector2 input_DEM_pix(l,k);
 
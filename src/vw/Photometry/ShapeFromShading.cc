@@ -31,6 +31,8 @@
 #include <vw/Photometry/Misc.h>
 
 #include <cmath>
+#include <algorithm>
+#include <boost/scoped_ptr.hpp>
 //#include <ctime>
 
 using namespace std;
@@ -41,6 +43,7 @@ using namespace vw::cartography;
 #include <vw/Photometry/Reconstruct.h>
 #include <vw/Photometry/ReconstructError.h>
 #include <vw/Photometry/ShapeFromShading.h>
+#include <vw/Photometry/Index.h>
 using namespace vw::photometry;
 
 #define horBlockSize 16 //8 //4
@@ -294,7 +297,8 @@ ComputeBlockJacobian(ImageViewBase<ViewT1> const& inputImage, GeoReference const
       Vector2 input_img_pix(jj,ii);
 
       //update from the main image
-      if (is_valid(inputImage.impl()(jj,ii)) && (shadowImage.impl()(jj, ii) == 0)){
+      //pixels without a normal (at the DEM's edge or nodata) have no geometry to differentiate
+      if (is_valid(inputImage.impl()(jj,ii)) && (shadowImage.impl()(jj, ii) == 0) && (normalArray[r] != Vector3())){
 
         c = k*horBlockSize + l;//same point
         //not computed for the last row and last column of the extended block
@@ -397,8 +401,8 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
       float x = overlap_pix[0];
       float y = overlap_pix[1];
 
-      //compute and update Jacobian for non shadow pixels
-      if ((x>=0) && (x < overlapImage.impl().cols()) && (y>=0) && (y< interpOverlapImage.impl().rows()) && (interpOverlapShadowImage.impl()(x, y) == 0)){
+      //compute and update Jacobian for non shadow pixels that have a normal
+      if ((normalArray[r] != Vector3()) && (x>=0) && (x < overlapImage.impl().cols()) && (y>=0) && (y< interpOverlapImage.impl().rows()) && (interpOverlapShadowImage.impl()(x, y) == 0)){
 
         c = k*horBlockSize + l;//same point
         //not computed for the last row and last column of the extended block
@@ -462,99 +466,83 @@ ComputeBlockJacobianOverlap(ImageViewBase<ViewT1> const& inputImage, GeoReferenc
 
 
 
-//call function for the update of the height map. main call function for shape from shading - from multiple images
-void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<ModelParams> overlapImgParams, GlobalParams globalParams)
-{
-  std::string inputImgFilename = inputImgParams.inputFilename;//the original DRG
-  std::string shadowFilename = inputImgParams.shadowFilename; //shadow map
-  std::string albedoFilename = inputImgParams.outputFilename; //albedo map
-  std::string meanDEMFilename = inputImgParams.meanDEMFilename; //original mean DEM
-  std::string sfsDEMFilename = inputImgParams.sfsDEMFilename; //DEM from sfs
-  std::string errorHeightFilename = inputImgParams.errorHeightFilename; //error in terms of height
-
-  int numOverlapImages = overlapImgParams.size();
-  //numOverlapImages = 0;//1;
-
-  DiskImageView<PixelGray<float> >  meanDEM(meanDEMFilename);
-  GeoReference DEM_geo;
-  read_georeference(DEM_geo, meanDEMFilename);
-
-  /*
-  //upsample the meanDEM;
-  int upsampleFactor = 2;
-  upsample_image(sfsDEMFilename, meanDEMFilename, upsampleFactor);
-  DiskImageView<PixelGray<float> >  meanDEM(upDEMFilename);
-  GeoReference DEM_geo;
-  read_georeference(DEM_geo, meanDEMFilename);
-  */
-
-  ImageView<PixelGray<float> > sfsDEM(meanDEM.cols(), meanDEM.rows());
+namespace {
 
-  //copy meanDEM 2 sfsDEM
-  sfsDEM = copy(meanDEM);
-
-
-  DiskImageView<PixelMask<PixelGray<uint8> > >  shadowImage(shadowFilename);
-
-  DiskImageView<PixelMask<PixelGray<uint8> > >  inputImage(inputImgFilename);
-  GeoReference inputImg_geo;
-  read_georeference(inputImg_geo, inputImgFilename);
-
-  DiskImageView<PixelMask<PixelGray<uint8> > >  albedoImage(albedoFilename);
-
-  ImageViewRef<PixelGray<float> >  interp_dem_image = interpolate(edge_extend(meanDEM.impl(),
-        ConstantEdgeExtension()),
-      BilinearInterpolation());
-
-  Vector<float, numJacobianCols> lhs;
-  Matrix<float, numJacobianCols, numJacobianCols> rhs;
-
-  vector<Matrix<float, numJacobianRows, numJacobianCols> >jacobianArray;
-  vector<Matrix<float, numJacobianRows, numJacobianRows> >weightsArray;
-  vector<Vector<float, numJacobianRows> > errorVectorArray;
-  jacobianArray.resize(numOverlapImages+1);
-  weightsArray.resize(numOverlapImages+1);
-  errorVectorArray.resize(numOverlapImages+1);
-
-  float recDer, recDerLEFT, recDerTOP, recErr;
-
-  int numHorBlocks = meanDEM.cols()/horBlockSize + 1;
-  int numVerBlocks = meanDEM.rows()/verBlockSize + 1;
-  printf("numVerBlocks = %d, numHorBlocks = %d\n", numVerBlocks, numHorBlocks);
-
-  vector<Vector3> normalArray;
-  vector<Vector3> xyzArray;
-  vector<Vector3> xyzTOPArray;
-  vector<Vector3> xyzLEFTArray;
-  vector<float> reliefArray;
-
-  normalArray.resize((verBlockSize+1)*(horBlockSize+1));
-  xyzArray.resize((verBlockSize+1)*(horBlockSize+1));
-  xyzTOPArray.resize((verBlockSize+1)*(horBlockSize+1));
-  xyzLEFTArray.resize((verBlockSize+1)*(horBlockSize+1));
-
-  //josh - create image for error in terms of height and initialize to zero
-  ImageView<PixelMask<PixelGray<float> > > errorHeight(meanDEM.cols(), meanDEM.rows());
-  for (int k = 0; k < meanDEM.rows(); ++k){
-    for (int l = 0; l < meanDEM.cols(); ++l){
-      errorHeight(l, k) = 0;
+  // rhs += J^T W J and lhs += J^T W e.  W is diagonal and each row of J
+  // has at most three nonzeros (the pixel and its left and top
+  // neighbours), so this only touches those entries instead of
+  // multiplying the dense matrices.
+  void AccumulateNormalEquations(Matrix<float, numJacobianRows, numJacobianCols> const& jacobian,
+                                 Matrix<float, numJacobianRows, numJacobianRows> const& weights,
+                                 Vector<float, numJacobianRows> const& errorVector,
+                                 Matrix<float, numJacobianCols, numJacobianCols>& rhs,
+                                 Vector<float, numJacobianCols>& lhs)
+  {
+    int cols[numJacobianCols];
+    for (int r = 0; r < numJacobianRows; r++){
+      int n = 0;
+      for (int c = 0; c < numJacobianCols; c++)
+        if (jacobian(r,c) != 0)
+          cols[n++] = c;
+      const float w = weights(r,r);
+      for (int a = 0; a < n; a++){
+        const float wja = w*jacobian(r,cols[a]);
+        lhs(cols[a]) += wja*errorVector(r);
+        for (int b = 0; b < n; b++)
+          rhs(cols[a], cols[b]) += wja*jacobian(r,cols[b]);
+      }
     }
   }
 
-  for (int kb = 0 ; kb < numVerBlocks; ++kb) {
-    for (int lb = 0; lb < numHorBlocks; ++lb) {
-
-      printf("kb = %d, lb=%d, numVerBlocks = %d, numHorBlocks = %d\n", kb, lb, numVerBlocks, numHorBlocks);
+  // The per-block arrays of the height update; big, so they live on
+  // the heap, one set per tile being processed.
+  struct HeightBlockWorkspace {
+    vector<Matrix<float, numJacobianRows, numJacobianCols> > jacobianArray;
+    vector<Matrix<float, numJacobianRows, numJacobianRows> > weightsArray;
+    vector<Vector<float, numJacobianRows> > errorVectorArray;
+    Matrix<float, numJacobianCols, numJacobianCols> rhs;
+    Vector<float, numJacobianCols> lhs;
+    vector<Vector3> normalArray, xyzArray, xyzTOPArray, xyzLEFTArray;
+
+    HeightBlockWorkspace(int numImages)
+      : jacobianArray(numImages), weightsArray(numImages), errorVectorArray(numImages),
+        normalArray((verBlockSize+1)*(horBlockSize+1)), xyzArray((verBlockSize+1)*(horBlockSize+1)),
+        xyzTOPArray((verBlockSize+1)*(horBlockSize+1)), xyzLEFTArray((verBlockSize+1)*(horBlockSize+1)) {}
+  };
+
+  // The shape from shading DEM: the mean DEM plus a Gauss-Newton
+  // height update, solved independently for each horBlockSize x
+  // verBlockSize block from the block and a one pixel halo.  Each tile
+  // solves the blocks it covers, so tiles can be rasterized in
+  // parallel and only the tiles being written are held in memory.
+  class SfsDEMView : public ImageViewBase<SfsDEMView> {
+    typedef DiskImageView<PixelMask<PixelGray<uint8> > > image_t;
+
+    ModelParams m_params;
+    vector<ModelParams> m_overlapParams;
+    GlobalParams m_global;
+    DiskImageView<PixelGray<float> > m_meanDEM;
+    GeoReference m_DEM_geo;
+    ImageViewRef<PixelGray<float> > m_interp_dem;
+    image_t m_shadow, m_input, m_albedo;
+    GeoReference m_input_geo;
+    vector<boost::shared_ptr<image_t> > m_overlapImgs, m_overlapShadowImgs;
+    vector<GeoReference> m_overlapGeos;
+    vector<BBox2i> m_overlapRegions;
+
+    // Solves for the height update of block (kb, lb) into ws.lhs;
+    // returns false if the block is skipped.
+    bool solve_block(int kb, int lb, HeightBlockWorkspace& ws) const {
+      const int numOverlapImages = m_overlapParams.size();
 
       int n = 0;
-
       //josh - shouldn't we check the extended image for valid points?
       for (int k = 0 ; k < verBlockSize; ++k){
         for (int l = 0; l < horBlockSize; ++l) {
           int ii = kb*verBlockSize+k; //row index for the entire image
           int jj = lb*horBlockSize+l; //col index for the entire image
-          if ((ii < inputImage.rows()) && (jj < inputImage.cols())){
-            if ( is_valid(inputImage(jj,ii)) ){
+          if ((ii < m_input.rows()) && (jj < m_input.cols())){
+            if ( is_valid(m_input(jj,ii)) ){
               n++;
             }
           }
@@ -563,62 +551,45 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
 
       if ( n < numJacobianCols ) {
         printf("kb = %d, lb=%d is skipped\n", kb, lb);
-        continue;
-      }
-
-      //initialization of the error vector
-      for (int m = 0; m < numOverlapImages + 1; m++){
-        for (int ii = 0; ii < numJacobianRows; ii++) {
-          errorVectorArray[m](ii) = 0.0;
-        }
-      }
-
-      //initialization of the Jacobian matrix
-      for (int m = 0; m < numOverlapImages + 1; m++){
-        for (int ii = 0; ii < numJacobianRows; ii++){
-          for (int jj = 0; jj < numJacobianCols; jj++){
-            jacobianArray[m](ii, jj) = 0.0;
-          }
-        }
+        return false;
       }
 
-      //initialization of the weights matrix
       for (int m = 0; m < numOverlapImages + 1; m++){
-        for (int ii = 0; ii < numJacobianRows; ii++) {
-          for (int jj = 0; jj < numJacobianRows; jj++){
-            weightsArray[m](ii, jj) = 0.0;
-            if (ii == jj){
-              weightsArray[m](ii, jj) = 1.0;
-            }
-          }
-        }
+        std::fill(ws.errorVectorArray[m].begin(), ws.errorVectorArray[m].end(), 0.0f);
+        std::fill(ws.jacobianArray[m].begin(), ws.jacobianArray[m].end(), 0.0f);
+        std::fill(ws.weightsArray[m].begin(), ws.weightsArray[m].end(), 0.0f);
+        for (int ii = 0; ii < numJacobianRows; ii++)
+          ws.weightsArray[m](ii, ii) = 1.0;
       }
 
-      //TO DO: reset xyzArray, xyzLEFT and xyzTOP
-      ComputeBlockGeometry(interp_dem_image, DEM_geo,
-          inputImage, inputImg_geo, kb, lb,
-          inputImgParams, globalParams,
-          xyzArray, xyzLEFTArray,
-          xyzTOPArray, normalArray);
+      // Pixels without a normal must not see another block's geometry.
+      std::fill(ws.normalArray.begin(), ws.normalArray.end(), Vector3());
+      std::fill(ws.xyzArray.begin(), ws.xyzArray.end(), Vector3());
+      std::fill(ws.xyzTOPArray.begin(), ws.xyzTOPArray.end(), Vector3());
+      std::fill(ws.xyzLEFTArray.begin(), ws.xyzLEFTArray.end(), Vector3());
 
-      ComputeBlockJacobian(inputImage, inputImg_geo, shadowImage, albedoImage,
-          kb, lb, inputImgParams, globalParams,
-          xyzArray, xyzLEFTArray, xyzTOPArray,normalArray,
-          jacobianArray[0], errorVectorArray[0], weightsArray[0]);
+      ComputeBlockGeometry(m_interp_dem, m_DEM_geo,
+          m_input, m_input_geo, kb, lb,
+          m_params, m_global,
+          ws.xyzArray, ws.xyzLEFTArray,
+          ws.xyzTOPArray, ws.normalArray);
 
-      //printJacobian(jacobianArray[0], "mujapenas.txt");
+      ComputeBlockJacobian(m_input, m_input_geo, m_shadow, m_albedo,
+          kb, lb, m_params, m_global,
+          ws.xyzArray, ws.xyzLEFTArray, ws.xyzTOPArray, ws.normalArray,
+          ws.jacobianArray[0], ws.errorVectorArray[0], ws.weightsArray[0]);
 
       for (int m = 0; m < numOverlapImages; m++){
 
-        printf("overlap_img = %s\n", overlapImgParams[m].inputFilename.c_str());
-
-        DiskImageView<PixelMask<PixelGray<uint8> > >  overlapImg(overlapImgParams[m].inputFilename);
-        GeoReference overlapImg_geo;
-        read_georeference(overlapImg_geo, overlapImgParams[m].inputFilename);
-        DiskImageView<PixelMask<PixelGray<uint8> > >  overlapShadowImage(overlapImgParams[m].shadowFilename);
+        //skip overlap images that miss this block entirely
+        if (!m_overlapRegions[m].intersects(BBox2i(lb*horBlockSize, kb*verBlockSize, horBlockSize, verBlockSize))) {
+          printf("OVERLAP kb = %d, lb=%d is skipped\n", kb, lb);
+          continue;
+        }
 
-        //GeoTransform trans(overlapImg_geo, inputImg_geo);
-        //transform(overlapImg, trans);
+        image_t const& overlapImg = *m_overlapImgs[m];
+        GeoReference const& overlapImg_geo = m_overlapGeos[m];
+        image_t const& overlapShadowImage = *m_overlapShadowImgs[m];
 
         //determine invalid blocks in the overlap image - START
         int n = 0;
@@ -628,7 +599,7 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
             int ii = kb*verBlockSize+k; //row index for the entire image
             int jj = lb*horBlockSize+l; //col index for the entire image
             Vector2 input_img_pix(jj, ii);
-            Vector2 overlap_pix = overlapImg_geo.lonlat_to_pixel(inputImg_geo.pixel_to_lonlat(input_img_pix));
+            Vector2 overlap_pix = overlapImg_geo.lonlat_to_pixel(m_input_geo.pixel_to_lonlat(input_img_pix));
             float x = overlap_pix[0];
             float y = overlap_pix[1];
 
@@ -647,83 +618,122 @@ void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<Mod
 
         //determine invalid blocks in the overlap image - END
 
-        ComputeBlockJacobianOverlap(inputImage, inputImg_geo,
+        ComputeBlockJacobianOverlap(m_input, m_input_geo,
             overlapImg, overlapImg_geo,
-            shadowImage, overlapShadowImage,
-            albedoImage, kb, lb,
-            inputImgParams, overlapImgParams[m], globalParams,
-            xyzArray, xyzLEFTArray, xyzTOPArray,normalArray,
-            jacobianArray[m+1], errorVectorArray[m+1], weightsArray[m+1]);
-
+            m_shadow, overlapShadowImage,
+            m_albedo, kb, lb,
+            m_params, m_overlapParams[m], m_global,
+            ws.xyzArray, ws.xyzLEFTArray, ws.xyzTOPArray, ws.normalArray,
+            ws.jacobianArray[m+1], ws.errorVectorArray[m+1], ws.weightsArray[m+1]);
       }
 
-
-      //reset the right hand side - square matrix of size BlockArea x BlockArea: rhs = J^T x J
-      for (int ii = 0; ii < numJacobianCols; ii++) {
-        for (int jj = 0; jj < numJacobianCols; jj++){
-          rhs(ii, jj) = 0.0;
-        }
-      }
-      //reset the left hand side
-      for (int ii = 0; ii < numJacobianCols; ii++){
-        lhs(ii) = 0.0;
-      }
-
-      //compute lhs and rhs
-      for (int m = 0; m < numOverlapImages+1; m++){
-        rhs = rhs + transpose(jacobianArray[m])*weightsArray[m]*jacobianArray[m];
-        lhs = lhs + transpose(jacobianArray[m])*weightsArray[m]*errorVectorArray[m];
-      }
+      //compute lhs and rhs: rhs = J^T x W x J, lhs = J^T x W x e
+      std::fill(ws.rhs.begin(), ws.rhs.end(), 0.0f);
+      std::fill(ws.lhs.begin(), ws.lhs.end(), 0.0f);
+      for (int m = 0; m < numOverlapImages+1; m++)
+        AccumulateNormalEquations(ws.jacobianArray[m], ws.weightsArray[m], ws.errorVectorArray[m], ws.rhs, ws.lhs);
 
       //solves lhs = rhs*x and stores results in lhs
       try {
+        solve_symmetric_nocopy(ws.rhs, ws.lhs);
+      } catch (const ArgumentErr& /*e*/) {
+        std::cout << "Error @ (kb,lb) = (" << kb << "," << lb << ")\n";
+        printf("Error\n");
+        return false;
+      }
+      printf("Go, kb = %d, lb = %d\n", kb, lb);
+      return true;
+    }
 
-        solve_symmetric_nocopy(rhs,lhs);
-
-        for (int k = 0 ; k < verBlockSize; ++k) {
-          for (int l = 0; l < horBlockSize; ++l) {
+  public:
+    typedef PixelGray<float> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<SfsDEMView> pixel_accessor;
+
+    SfsDEMView(ModelParams const& inputImgParams, vector<ModelParams> const& overlapImgParams,
+               GlobalParams const& globalParams)
+      : m_params(inputImgParams), m_overlapParams(overlapImgParams), m_global(globalParams),
+        m_meanDEM(inputImgParams.meanDEMFilename),
+        m_DEM_geo(OverlapIndex::instance().georef(inputImgParams.meanDEMFilename)),
+        m_interp_dem(interpolate(edge_extend(m_meanDEM, ConstantEdgeExtension()), BilinearInterpolation())),
+        m_shadow(inputImgParams.shadowFilename), m_input(inputImgParams.inputFilename),
+        m_albedo(inputImgParams.outputFilename),
+        m_input_geo(OverlapIndex::instance().georef(inputImgParams.inputFilename)),
+        m_overlapImgs(overlapImgParams.size()), m_overlapShadowImgs(overlapImgParams.size()),
+        m_overlapGeos(overlapImgParams.size()), m_overlapRegions(overlapImgParams.size())
+    {
+      //open the overlap images once, with the region of the input image each covers
+      for (size_t m = 0; m < overlapImgParams.size(); m++){
+        printf("overlap_img = %s\n", overlapImgParams[m].inputFilename.c_str());
+        m_overlapRegions[m] = OverlapIndex::instance().overlap(inputImgParams.inputFilename, overlapImgParams[m].inputFilename);
+        if (m_overlapRegions[m].empty())
+          continue;
+        m_overlapImgs[m].reset(new image_t(overlapImgParams[m].inputFilename));
+        m_overlapShadowImgs[m].reset(new image_t(overlapImgParams[m].shadowFilename));
+        m_overlapGeos[m] = OverlapIndex::instance().georef(overlapImgParams[m].inputFilename);
+      }
+    }
 
-            int ii = kb*verBlockSize+k; //row index for the entire image
-            int jj = lb*horBlockSize+l; //col index for the entire image
+    inline int32 cols() const { return m_meanDEM.cols(); }
+    inline int32 rows() const { return m_meanDEM.rows(); }
+    inline int32 planes() const { return 1; }
 
-            if ((ii < inputImage.rows()) && (jj < inputImage.cols())){
-              //local index in the vector that describes the block image; assumes row-wise concatenation.
-              int l_index = k*horBlockSize+l;
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
 
-              //std::cout << "sfs_before( " << jj << "," << ii << ")=" << (float)sfsDEM(jj,ii) <<  std::endl;
-              sfsDEM(jj, ii) = sfsDEM(jj, ii) + lhs(l_index);
-              errorHeight(jj, ii) = lhs(l_index);
-              std::cout << "sfs_after( " << jj << "," << ii << ")=" << (float)sfsDEM(jj,ii) << ", lhs after= " << lhs(l_index) << std::endl;
+    // Solves a whole block per pixel: rasterize instead.
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
 
+    GeoReference const& georeference() const { return m_DEM_geo; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize(BBox2i const& bbox) const {
+      ImageView<pixel_type> sfsDEM = crop(m_meanDEM, bbox);
+      HeightBlockWorkspace ws(m_overlapParams.size() + 1);
+
+      // Every block that touches bbox; a block that straddles two tiles
+      // is solved by both, with the same result.
+      const int kb0 = bbox.min().y()/verBlockSize, kb1 = (bbox.max().y()-1)/verBlockSize;
+      const int lb0 = bbox.min().x()/horBlockSize, lb1 = (bbox.max().x()-1)/horBlockSize;
+      for (int kb = kb0; kb <= kb1; ++kb) {
+        for (int lb = lb0; lb <= lb1; ++lb) {
+          if (!solve_block(kb, lb, ws))
+            continue;
+          for (int k = 0 ; k < verBlockSize; ++k) {
+            for (int l = 0; l < horBlockSize; ++l) {
+              int ii = kb*verBlockSize+k; //row index for the entire image
+              int jj = lb*horBlockSize+l; //col index for the entire image
+              if ((ii < m_input.rows()) && (jj < m_input.cols()) && bbox.contains(Vector2i(jj, ii))){
+                //local index in the vector that describes the block image; assumes row-wise concatenation.
+                int l_index = k*horBlockSize+l;
+                sfsDEM(jj - bbox.min().x(), ii - bbox.min().y()) += ws.lhs(l_index);
+                vw_out(VerboseDebugMessage, "photometry") << "sfs_after( " << jj << "," << ii << ")="
+                                                          << (float)sfsDEM(jj - bbox.min().x(), ii - bbox.min().y())
+                                                          << ", lhs after= " << ws.lhs(l_index) << "\n";
+              }
             }
           }
         }
-
-        printf("Go, kb = %d, lb = %d\n", kb, lb);
-
-      } catch (const ArgumentErr& /*e*/) {
-
-        std::cout << "Error @ (kb,lb) = (" << kb << "," << lb << ")\n";
-        //std::cout << "Exception caught: " << ArgumentErr.what() << "\n";
-        //std::cout << "PRERHS: " << pre_rhs << "\n";
-        //std::cout << "PRELHS: " << pre_lhs << "\n\n";
-        //std::cout << "RHS: " << rhs << "\n";
-        //std::cout << "LHS: " << lhs << "\n\n";
-        //std::cout << "DEBUG: " << rhs(0,1) << "   " << rhs(1,0) << "\n\n";
-        printf("Error\n");
       }
+      return prerasterize_type(sfsDEM, BBox2i(-bbox.min().x(), -bbox.min().y(), cols(), rows()));
+    }
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const { vw::rasterize(prerasterize(bbox), dest, bbox); }
+  };
 
-      //solve_symmetric_nocopy(rhs, lhs);
-
-      //copy lhs to back meanDEM
-
-    }//lb
-  }//kb
+} // namespace
 
-  //write in the updated DEM
-  write_georeferenced_image(sfsDEMFilename, sfsDEM,
-      DEM_geo, TerminalProgressCallback("photometry","Processing:"));
-  //write in the error in terms of height
-  //write_georeferenced_image(errorHeightFilename, errorHeight,
-  //    DEM_geo, TerminalProgressCallback("photometry","Processing:"));
+//call function for the update of the height map. main call function for shape from shading - from multiple images
+void vw::photometry::UpdateHeightMap(ModelParams inputImgParams, std::vector<ModelParams> overlapImgParams, GlobalParams globalParams)
+{
+  SfsDEMView sfsDEM(inputImgParams, overlapImgParams, globalParams);
+
+  //write in the updated DEM, in tiles that hold whole blocks
+  const int32 tile = vw_settings().default_tile_size();
+  boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(inputImgParams.sfsDEMFilename, sfsDEM.format()));
+  if (r->has_block_write())
+    r->set_block_write_size(Vector2i(std::max(tile / horBlockSize, 1) * horBlockSize,
+                                     std::max(tile / verBlockSize, 1) * verBlockSize));
+  write_georeference(*r, sfsDEM.georeference());
+  block_write_image(*r, sfsDEM, TerminalProgressCallback("photometry","Processing:"));
 }
@@ -13,11 +13,19 @@
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/PerfCounters.h>
 
-#include <fstream>
 #include <string>
+#include <cstring>
+#include <cerrno>
 #include <boost/shared_array.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/foreach.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define WHEREAMI (vw::vw_out(VerboseDebugMessage, "platefile.blob") << VW_CURRENT_FUNCTION << ": ")
 
@@ -25,65 +33,79 @@
 FileSize       = uint64
 BlobRecordSize = uint16
 TileData       = uint8*
-Blob = FileSize FileSize FileSize (BlobRecordSize BlobRecord TileHeader TileData)*
+Blob = FileSize FileSize FileSize (BlobRecordSize BlobRecord TileHeader TileData)* [Offset* Count Magic]
 #endif
 
 namespace {
   typedef vw::uint16 BlobRecordSizeType;
+
+  // "VWBLOBIX", marking the end of the record index.
+  const vw::uint64 BLOB_INDEX_MAGIC = 0x5857424f4c425756ULL;
+
+  // Enough to read the size and metadata of a record at once.
+  const size_t BLOB_RECORD_PREFETCH = 64;
 }
 
 namespace vw {
 namespace platefile {
   using detail::BlobRecord;
 
-void ReadBlob::check_fail(const char* c1, const char* c2) const {
-  if (m_fstream->fail()) {
-    m_fstream->clear();
-    vw_throw(BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << c1 << " " << c2);
+void ReadBlob::read_at(uint64 offset, char* dst, uint64 size, const char* context) const {
+  static PerfCounter& bytes = vw_perf_counters().counter("blob.read_bytes");
+  static PerfHistogram& time = vw_perf_counters().histogram("blob.read_us");
+  PerfTimer timer(time);
+  bytes.add(size);
+  while (size > 0) {
+    ssize_t ret = ::pread(m_fd, dst, boost::numeric_cast<size_t>(size), boost::numeric_cast<off_t>(offset));
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      vw_throw(BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << context << ": "
+                           << (ret < 0 ? strerror(errno) : "unexpected end of file"));
+    dst    += ret;
+    offset += ret;
+    size   -= ret;
   }
 }
 
-void ReadBlob::read_at(uint64 offset64, char* dst, uint64 size, const char* context) const {
-  if (m_fstream->eof())
-    m_fstream->clear();
-
-  std::streamoff offset = boost::numeric_cast<std::streamoff>(offset64);
-  m_fstream->seekg(offset, std::ios_base::beg);
-  check_fail(context, "while seeking");
-  m_fstream->read(dst, boost::numeric_cast<std::streamsize>(size));
-  check_fail(context, "while reading data");
-}
-
-uint32 tile_header_offset(const uint32& base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) {
+uint64 tile_header_offset(uint64 base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) {
   // The overall blob metadata includes the uint16 of the blob_record_size in
   // addition to the size of the blob_record itself.  The offsets stored in the
   // blob_record are relative to the END of the blob_record.  We compute this
   // offset here.
   uint64 blob_offset_metadata = sizeof(BlobRecordSizeType) + blob_record_size;
-  uint64 offset64 = base_offset + blob_offset_metadata + blob_record.header_offset();
-  return boost::numeric_cast<uint32>(offset64);
+  return base_offset + blob_offset_metadata + blob_record.header_offset();
 }
 
-uint32 tile_data_offset(const uint32& base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) {
+uint64 tile_data_offset(uint64 base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) {
   uint64 blob_offset_metadata = sizeof(BlobRecordSizeType) + blob_record_size;
-  uint64 offset64 = base_offset + blob_offset_metadata + blob_record.data_offset();
-  return boost::numeric_cast<uint32>(offset64);
+  return base_offset + blob_offset_metadata + blob_record.data_offset();
 }
 
-BlobRecord ReadBlob::read_blob_record(const uint32& base_offset, BlobRecordSizeType& blob_record_size) const {
-  read_at(base_offset, (char*)&blob_record_size, sizeof(BlobRecordSizeType), "reading blob record size");
-
-  boost::shared_array<uint8> blob_rec_data(new uint8[blob_record_size]);
-  m_fstream->read(reinterpret_cast<char*>(blob_rec_data.get()), blob_record_size);
-  check_fail("reading a blob record");
+BlobRecord ReadBlob::read_blob_record(uint64 base_offset, BlobRecordSizeType& blob_record_size) const {
+  // The size and the record are read together, unless the record runs
+  // past the end of the blob's valid data.
+  uint8 buf[BLOB_RECORD_PREFETCH];
+  uint64 prefetch = std::min(uint64(BLOB_RECORD_PREFETCH), m_end_of_file_ptr > base_offset ? m_end_of_file_ptr - base_offset : 0);
+  prefetch = std::max(prefetch, uint64(sizeof(BlobRecordSizeType)));
+  read_at(base_offset, (char*)buf, prefetch, "reading blob record size");
+  memcpy(&blob_record_size, buf, sizeof(BlobRecordSizeType));
+
+  boost::scoped_array<uint8> big;
+  const uint8* blob_rec_data = buf + sizeof(BlobRecordSizeType);
+  if (sizeof(BlobRecordSizeType) + blob_record_size > prefetch) {
+    big.reset(new uint8[blob_record_size]);
+    read_at(base_offset + sizeof(BlobRecordSizeType), (char*)big.get(), blob_record_size, "reading a blob record");
+    blob_rec_data = big.get();
+  }
 
   BlobRecord blob_record;
-  bool worked = blob_record.ParseFromArray(blob_rec_data.get(),  boost::numeric_cast<int>(blob_record_size));
+  bool worked = blob_record.ParseFromArray(blob_rec_data,  boost::numeric_cast<int>(blob_record_size));
   VW_ASSERT(worked, BlobIoErr() << "failed to parse blob record in " << m_blob_filename << " at base_offset " << base_offset);
   return blob_record;
 }
 
-TileHeader ReadBlob::read_tile_header(const uint32& base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const {
+TileHeader ReadBlob::read_tile_header(uint64 base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const {
   uint64 offset = tile_header_offset(base_offset, blob_record, blob_record_size);
   uint64 size   = blob_record.header_size();
 
@@ -92,16 +114,17 @@ TileHeader ReadBlob::read_tile_header(const uint32& base_offset, const BlobRecor
 
   TileHeader header;
   bool worked = header.ParseFromArray(data.get(), boost::numeric_cast<int>(size));
-  VW_ASSERT(worked, BlobIoErr() << "read_tile_record() failed in " << m_blob_filename << " at offset " << m_fstream->tellg());
+  VW_ASSERT(worked, BlobIoErr() << "read_tile_record() failed in " << m_blob_filename << " at offset " << offset);
   return header;
 }
 
-TileData ReadBlob::read_tile_data(const uint32& base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const {
+TileData ReadBlob::read_tile_data(uint64 base_offset, const BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const {
   uint64 offset = tile_data_offset(base_offset, blob_record, blob_record_size);
   uint64 size   = blob_record.data_size();
 
   TileData data(new std::vector<uint8>(size));
-  read_at(offset, (char*)(&data->operator[](0)), size, "reading tile data");
+  if (size)
+    read_at(offset, (char*)(&data->operator[](0)), size, "reading tile data");
   return data;
 }
 
@@ -118,31 +141,26 @@ BlobTileRecord ReadBlob::iterator::dereference() const {
   return m_blob->read_record(m_current_base_offset);
 }
 
-ReadBlob::iterator::iterator( ReadBlob *blob, uint64 base_offset )
+ReadBlob::iterator::iterator( const ReadBlob *blob, uint64 base_offset )
   : m_blob(blob), m_current_base_offset(base_offset) {}
 
 uint64 ReadBlob::iterator::current_base_offset() const { return m_current_base_offset; }
 
-TileHeader ReadBlob::read_header(uint64 base_offset64) {
-  vw_out(VerboseDebugMessage, "platefile::blob") << "Entering read_header() -- " <<" base_offset: " <<  base_offset64 << "\n";
-  std::streamoff base_offset = boost::numeric_cast<std::streamoff>(base_offset64);
+TileHeader ReadBlob::read_header(uint64 base_offset) const {
+  vw_out(VerboseDebugMessage, "platefile::blob") << "Entering read_header() -- " <<" base_offset: " <<  base_offset << "\n";
   // Read the blob record
   BlobRecordSizeType blob_record_size;
   BlobRecord blob_record = this->read_blob_record(base_offset, blob_record_size);
   return this->read_tile_header(base_offset, blob_record, blob_record_size);
 }
 
-TileData ReadBlob::read_data(vw::uint64 base_offset) {
-  uint64 offset, size;
-  std::string dontcare;
-  read_sendfile(base_offset, dontcare, offset, size);
-
-  TileData data(new std::vector<uint8>(size));
-  read_at(offset, (char*)(&data->operator[](0)), size, "reading tile data");
-  return data;
+TileData ReadBlob::read_data(vw::uint64 base_offset) const {
+  BlobRecordSizeType blob_record_size;
+  BlobRecord blob_record = this->read_blob_record(base_offset, blob_record_size);
+  return this->read_tile_data(base_offset, blob_record, blob_record_size);
 }
 
-BlobTileRecord ReadBlob::read_record(vw::uint64 base_offset) {
+BlobTileRecord ReadBlob::read_record(vw::uint64 base_offset) const {
   VW_ASSERT(base_offset >= 24, LogicErr() << "No base_offset will ever be < 24. Something's wrong.");
 
   BlobTileRecord ret;
@@ -153,7 +171,7 @@ BlobTileRecord ReadBlob::read_record(vw::uint64 base_offset) {
   return ret;
 }
 
-uint64 ReadBlob::next_base_offset(uint64 current_base_offset) {
+uint64 ReadBlob::next_base_offset(uint64 current_base_offset) const {
   BlobRecordSizeType blob_record_size;
   BlobRecord blob_record = this->read_blob_record(current_base_offset, blob_record_size);
 
@@ -165,6 +183,15 @@ uint64 ReadBlob::next_base_offset(uint64 current_base_offset) {
   return next_offset;
 }
 
+std::vector<uint64> ReadBlob::record_offsets() const {
+  if (m_has_index)
+    return m_offsets;
+  std::vector<uint64> offsets;
+  for (uint64 offset = 3*sizeof(uint64); offset < m_end_of_file_ptr; offset = next_base_offset(offset))
+    offsets.push_back(offset);
+  return offsets;
+}
+
 /// Returns the data size
 uint64 ReadBlob::data_size(uint64 base_offset) const {
 
@@ -176,41 +203,122 @@ uint64 ReadBlob::data_size(uint64 base_offset) const {
 }
 
 ReadBlob::ReadBlob(const std::string& filename, bool skip_init)
-  : m_blob_filename(filename)
+  : m_blob_filename(filename), m_end_of_file_ptr(0), m_fd(-1), m_has_index(false)
 {
   if (!skip_init)
     init();
 }
 
 ReadBlob::ReadBlob(const std::string& filename)
-  : m_blob_filename(filename)
+  : m_blob_filename(filename), m_end_of_file_ptr(0), m_fd(-1), m_has_index(false)
 { init(); }
 
 void ReadBlob::init() {
-  m_fstream.reset(new std::fstream(m_blob_filename.c_str(), std::ios::in | std::ios::binary));
-  VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not open blob file " << m_blob_filename);
+  m_fd = ::open(m_blob_filename.c_str(), O_RDONLY);
+  VW_ASSERT(m_fd >= 0, BlobIoErr() << "Could not open blob file " << m_blob_filename);
   m_end_of_file_ptr = read_end_of_file_ptr();
+  read_index();
   WHEREAMI << m_blob_filename << std::endl;
 }
 
 ReadBlob::~ReadBlob() {
+  if (m_fd >= 0)
+    ::close(m_fd);
   WHEREAMI << m_blob_filename << "\n";
 }
 
-void ReadBlob::read_sendfile(uint64 base_offset, std::string& filename, uint64& offset, uint64& size) {
+// The index is only trusted if it exactly fills the space between the
+// end of the records and the end of the file, and its offsets are in
+// order within the records.
+void ReadBlob::read_index() {
+  m_offsets.clear();
+  m_has_index = false;
+
+  struct stat st;
+  if (::fstat(m_fd, &st) != 0)
+    return;
+  uint64 file_size = st.st_size;
+  if (file_size < m_end_of_file_ptr + 2*sizeof(uint64))
+    return;
+
+  uint64 tail[2];
+  read_at(file_size - sizeof(tail), (char*)tail, sizeof(tail), "reading the record index");
+  uint64 count = tail[0];
+  if (tail[1] != BLOB_INDEX_MAGIC || count != (file_size - m_end_of_file_ptr - sizeof(tail)) / sizeof(uint64)
+      || file_size != m_end_of_file_ptr + sizeof(tail) + count*sizeof(uint64))
+    return;
+
+  std::vector<uint64> offsets(count);
+  if (count)
+    read_at(m_end_of_file_ptr, (char*)&offsets[0], count*sizeof(uint64), "reading the record index");
+  for (uint64 i = 0; i < count; ++i) {
+    uint64 prev = i ? offsets[i-1] : 3*sizeof(uint64)-1;
+    if (offsets[i] <= prev || offsets[i] >= m_end_of_file_ptr)
+      return;
+  }
+  if (count == 0 && m_end_of_file_ptr != 3*sizeof(uint64))
+    return;
+
+  m_offsets.swap(offsets);
+  m_has_index = true;
+}
+
+void ReadBlob::read_sendfile(uint64 base_offset, std::string& filename, uint64& offset, uint64& size,
+                             std::vector<BlobSendfileRange>* variants) const {
   // Read the blob record
   BlobRecordSizeType blob_record_size;
-  BlobRecord blob_record = this->read_blob_record(boost::numeric_cast<std::streamoff>(base_offset), blob_record_size);
-
-  // The overall blob metadata includes the uint16 of the
-  // blob_record_size in addition to the size of the blob_record
-  // itself.  The offsets stored in the blob_record are relative to
-  // the END of the blob_record.  We compute this offset here.
-  uint64 blob_offset_metadata = sizeof(BlobRecordSizeType) + blob_record_size;
+  BlobRecord blob_record = this->read_blob_record(base_offset, blob_record_size);
 
   size     = blob_record.data_size();
-  offset   = base_offset + blob_offset_metadata + blob_record.data_offset();
+  offset   = tile_data_offset(base_offset, blob_record, blob_record_size);
   filename = m_blob_filename;
+
+  if (!variants)
+    return;
+  variants->clear();
+  const uint64 metadata_end = base_offset + sizeof(BlobRecordSizeType) + blob_record_size;
+  for (int i = 0; i < blob_record.variants_size(); ++i) {
+    const detail::BlobVariant& v = blob_record.variants(i);
+    BlobSendfileRange range;
+    range.filetype = v.filetype();
+    range.offset   = metadata_end + v.offset();
+    range.size     = v.size();
+    variants->push_back(range);
+  }
+}
+
+TileData ReadBlob::read_variant(uint64 base_offset, const std::string& filetype) const {
+  std::string filename;
+  uint64 offset, size;
+  std::vector<BlobSendfileRange> variants;
+  this->read_sendfile(base_offset, filename, offset, size, &variants);
+
+  BOOST_FOREACH(const BlobSendfileRange& v, variants) {
+    if (v.filetype != filetype)
+      continue;
+    TileData data(new std::vector<uint8>(v.size));
+    if (v.size)
+      read_at(v.offset, reinterpret_cast<char*>(&data->operator[](0)), v.size, "reading a tile variant");
+    return data;
+  }
+  return TileData();
+}
+
+void Blob::write_at(uint64 offset, const char* src, uint64 size, const char* context) {
+  static PerfCounter& bytes = vw_perf_counters().counter("blob.write_bytes");
+  static PerfHistogram& time = vw_perf_counters().histogram("blob.write_us");
+  PerfTimer timer(time);
+  bytes.add(size);
+  while (size > 0) {
+    ssize_t ret = ::pwrite(m_fd, src, boost::numeric_cast<size_t>(size), boost::numeric_cast<off_t>(offset));
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret < 0)
+      vw_throw(BlobIoErr() << "BlobIoErr occured on blob " << m_blob_filename << " while " << context << ": " << strerror(errno));
+    src    += ret;
+    offset += ret;
+    size   -= ret;
+  }
 }
 
 void Blob::write_end_of_file_ptr(uint64 ptr) {
@@ -223,24 +331,15 @@ void Blob::write_end_of_file_ptr(uint64 ptr) {
   data[1] = ptr;
   data[2] = ptr;
 
-  if (m_fstream->eof())
-    m_fstream->clear();
   // The end of file ptr is stored at the beginning of the blob file.
-  m_fstream->seekp(0, std::ios_base::beg);
-  check_fail("Failed to seek to beginning of blob for EOF ptr write");
-  m_fstream->write(reinterpret_cast<char*>(&data), 3*sizeof(uint64));
-  check_fail("Failed to write end of file ptr");
+  write_at(0, reinterpret_cast<char*>(&data), 3*sizeof(uint64), "writing the end of file ptr");
 }
 
 uint64 ReadBlob::read_end_of_file_ptr() const {
   uint64 data[3];
 
   // The end of file ptr is stored at the beginning of the blob file.
-  if (m_fstream->eof())
-    m_fstream->clear();
-  m_fstream->seekg(0, std::ios_base::beg);
-  m_fstream->read(reinterpret_cast<char*>(data), 3*sizeof(uint64));
-  check_fail("Failed to read end of file ptr");
+  read_at(0, reinterpret_cast<char*>(data), 3*sizeof(uint64), "reading the end of file ptr");
 
   // Make sure the read ptr is valid by comparing the three
   // entries.
@@ -258,33 +357,35 @@ uint64 ReadBlob::read_end_of_file_ptr() const {
     return data[1];
   else {
     vw_out(ErrorMessage) << "end of file ptr in blobfile " << m_blob_filename << " is inconsistent. This file may be corrupt. Proceed with caution.\n";
-    if (m_fstream->eof())
-      m_fstream->seekg(0, std::ios_base::end);
-    return m_fstream->tellg();
+    struct stat st;
+    VW_ASSERT(::fstat(m_fd, &st) == 0, BlobIoErr() << "Could not stat blob file " << m_blob_filename);
+    return st.st_size;
   }
 }
 
 // Constructor stores the blob filename for reading & writing
 Blob::Blob(const std::string& filename_)
-  : ReadBlob(filename_, true), m_write_count(0)
+  : ReadBlob(filename_, true), m_write_count(0), m_index_on_disk(false)
 {
-  m_fstream.reset(new std::fstream(m_blob_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary));
-
-  // If the file is not open, then that means that we need to create it.
-  // (Note: the C++ standard does not let you create a file when you specify
-  // std::ios::in., hence the gymnastics here.)
-  if (!m_fstream->is_open()) {
-    m_fstream->clear();
-    m_fstream->open(m_blob_filename.c_str(), std::ios::out|std::ios::binary);
-    VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not create blob file " << m_blob_filename);
+  m_fd = ::open(m_blob_filename.c_str(), O_RDWR | O_CREAT, 0666);
+  VW_ASSERT(m_fd >= 0, BlobIoErr() << "Could not create blob file " << m_blob_filename);
 
+  struct stat st;
+  VW_ASSERT(::fstat(m_fd, &st) == 0, BlobIoErr() << "Could not stat blob file " << m_blob_filename);
+  if (st.st_size == 0) {
     m_end_of_file_ptr = 3 * sizeof(uint64);
+    m_has_index = true;
     flush();
-    m_fstream->close();
-    m_fstream->open(m_blob_filename.c_str(), std::ios::out|std::ios::in|std::ios::binary);
-    VW_ASSERT(m_fstream->is_open(), BlobIoErr() << "Could not create blob file " << m_blob_filename);
   }
   m_end_of_file_ptr = read_end_of_file_ptr();
+
+  // A blob without an index, from before they were written or from a
+  // writer that never flushed, gets one the next time this one is.
+  read_index();
+  if (!m_has_index) {
+    m_offsets = record_offsets();
+    m_has_index = true;
+  }
   WHEREAMI << m_blob_filename << std::endl;
 }
 
@@ -294,53 +395,87 @@ Blob::~Blob() {
   WHEREAMI << m_blob_filename << "\n";
 }
 
+// The index goes first, so that the records it lists are all in place
+// before the end of file pointer makes them valid.
 void Blob::flush() {
+  std::vector<uint64> footer(m_offsets);
+  footer.push_back(m_offsets.size());
+  footer.push_back(BLOB_INDEX_MAGIC);
+  uint64 footer_size = footer.size()*sizeof(uint64);
+  write_at(m_end_of_file_ptr, reinterpret_cast<char*>(&footer[0]), footer_size, "writing the record index");
+  VW_ASSERT(::ftruncate(m_fd, boost::numeric_cast<off_t>(m_end_of_file_ptr + footer_size)) == 0,
+            BlobIoErr() << "Could not truncate blob file " << m_blob_filename);
   this->write_end_of_file_ptr(m_end_of_file_ptr);
-  m_fstream->flush();
+  m_index_on_disk = true;
   WHEREAMI << m_blob_filename << "\n";
 }
 
 
 uint64 Blob::write(TileHeader const& header, const uint8* data, uint64 data_size) {
+  return this->write(header, data, data_size, TileVariants());
+}
+
+uint64 Blob::write(TileHeader const& header, const uint8* data, uint64 data_size, const TileVariants& variants) {
   VW_ASSERT(m_end_of_file_ptr >= 24, LogicErr() << "What? This shouldn't happen.");
 
   // Store the current offset of the end of the file.  We'll
   // return that at the end of this function.
-  std::streamoff base_offset = boost::numeric_cast<std::streamoff>(m_end_of_file_ptr);
-  if (m_fstream->eof())
-    m_fstream->clear();
-  m_fstream->seekp(base_offset, std::ios_base::beg);
-  check_fail("seeking to write a tile header");
+  uint64 base_offset = m_end_of_file_ptr;
+
+  // Drop the index on disk first, so no reader can mistake the new
+  // tile for part of it.
+  if (m_index_on_disk) {
+    VW_ASSERT(::ftruncate(m_fd, boost::numeric_cast<off_t>(base_offset)) == 0,
+              BlobIoErr() << "Could not truncate blob file " << m_blob_filename);
+    m_index_on_disk = false;
+  }
 
-  // Create the blob record and write it to the blob file.
+  // Create the blob record.
   BlobRecord blob_record;
   blob_record.set_header_offset(0);
   blob_record.set_header_size(header.ByteSize());
-  blob_record.set_data_offset(header.ByteSize());
-  blob_record.set_data_size(data_size);
 
-  // Write the actual blob record size first.  This will help us
-  // read and deserialize this protobuffer later on.
-  BlobRecordSizeType blob_record_size = boost::numeric_cast<BlobRecordSizeType>(blob_record.ByteSize());
-  m_fstream->write(reinterpret_cast<char*>(&blob_record_size), sizeof(BlobRecordSizeType));
-  check_fail("writing a blob record size");
-  blob_record.SerializeToOstream(m_fstream.get());
-  check_fail("writing a blob record");
+  // The variants go between the header and the data, so the data still
+  // ends the record and next_base_offset() works without knowing of them.
+  uint64 variant_offset = header.ByteSize();
+  BOOST_FOREACH(const TileVariant& v, variants) {
+    detail::BlobVariant* bv = blob_record.add_variants();
+    bv->set_filetype(v.filetype);
+    bv->set_offset(variant_offset);
+    bv->set_size(v.data->size());
+    variant_offset += v.data->size();
+  }
+  const uint64 variants_size = variant_offset - header.ByteSize();
 
-  // Serialize the header.
-  header.SerializeToOstream(m_fstream.get());
-  check_fail("writing a tile header");
+  blob_record.set_data_offset(variant_offset);
+  blob_record.set_data_size(data_size);
 
-  // And write the data.
-  m_fstream->write(reinterpret_cast<const char*>(data), boost::numeric_cast<size_t>(data_size));
-  check_fail("writing tile data");
+  // The blob record size comes first.  This will help us read and
+  // deserialize this protobuffer later on.  The size, the record and
+  // the header are assembled and written together.
+  BlobRecordSizeType blob_record_size = boost::numeric_cast<BlobRecordSizeType>(blob_record.ByteSize());
+  size_t meta_size = sizeof(BlobRecordSizeType) + blob_record_size + header.ByteSize();
+  boost::scoped_array<uint8> meta(new uint8[meta_size]);
+  memcpy(meta.get(), &blob_record_size, sizeof(BlobRecordSizeType));
+  bool worked = blob_record.SerializeToArray(meta.get() + sizeof(BlobRecordSizeType), blob_record_size)
+             && header.SerializeToArray(meta.get() + sizeof(BlobRecordSizeType) + blob_record_size, header.ByteSize());
+  VW_ASSERT(worked, BlobIoErr() << "Failed to serialize a tile header for blob " << m_blob_filename);
+
+  write_at(base_offset, reinterpret_cast<char*>(meta.get()), meta_size, "writing a tile header");
+  uint64 offset = base_offset + meta_size;
+  BOOST_FOREACH(const TileVariant& v, variants) {
+    if (!v.data->empty())
+      write_at(offset, reinterpret_cast<const char*>(&v.data->operator[](0)), v.data->size(), "writing a tile variant");
+    offset += v.data->size();
+  }
+  write_at(offset, reinterpret_cast<const char*>(data), data_size, "writing tile data");
 
-  // Write the data at the end of the file and return the offset
-  // of the beginning of this data file.
   vw_out(VerboseDebugMessage, "platefile::blob") << "Blob::write() -- wrote " << data_size << " bytes to " << m_blob_filename << "\n";
 
-  // Update the in-memory copy of the end-of-file pointer
-  m_end_of_file_ptr = m_fstream->tellg();
+  // Update the in-memory copy of the end-of-file pointer, and the
+  // index.
+  m_end_of_file_ptr = base_offset + meta_size + variants_size + data_size;
+  m_offsets.push_back(base_offset);
 
   // The write_count is used to keep track of when we last wrote
   // the end_of_file_ptr to disk.  We don't want to write this too
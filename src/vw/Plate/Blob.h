@@ -30,18 +30,38 @@
 ///
 ///   [ HEADER ]            [ uint8 - serialized IndexRecord protobuffer ]
 ///
+///   [ VARIANTS ]          [ uint8 - other encodings of the data, if any ]
+///
 ///   [ DATA ]              [ uint8 - N raw bytes of data ]
 ///
+/// The variants (a jpg of a png tile, say) are listed in the BLOB HEADER.
+/// Since they come before the data, readers that don't know about them
+/// still find the next stanza after DATA.
+///
+/// The stanzas may be followed by an index of their offsets, which a
+/// Blob writes whenever it is flushed and which lets readers list the
+/// tiles without walking the whole file:
+///
+///   [ OFFSETS ]           [ uint64 - base offset of each stanza ]
+///   [ COUNT ]             [ uint64 - number of offsets ]
+///   [ MAGIC ]             [ uint64 - "VWBLOBIX" ]
+///
+/// The index lies past the end-of-file pointer, where older readers
+/// ignore it, and new tiles are written over it.  Reads use pread(2)
+/// with no shared file position, so one ReadBlob can be read from
+/// several threads at once.
 ///
 
 #include <vw/Plate/IndexData.pb.h>
 #include <vw/Plate/IndexDataPrivate.pb.h>
+#include <vw/Plate/Datastore.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
 #include <boost/shared_array.hpp>
-#include <fstream>
+#include <boost/iterator/iterator_facade.hpp>
 #include <string>
+#include <vector>
 
 namespace vw {
 namespace platefile {
@@ -54,23 +74,35 @@ namespace platefile {
     TileData data;
   };
 
+  /// Where one encoding of a tile lies in the blob file, for sendfile(2).
+  struct BlobSendfileRange {
+    std::string filetype;
+    vw::uint64 offset, size;
+  };
+
   class ReadBlob : boost::noncopyable {
     protected:
       std::string m_blob_filename;
       uint64 m_end_of_file_ptr;
-      boost::shared_ptr<std::fstream> m_fstream;
+      int m_fd;
+      // The base offset of each record, filled in from the index (and
+      // kept up to date by a Blob) when m_has_index is set.
+      std::vector<uint64> m_offsets;
+      bool m_has_index;
 
       void read_at(uint64 offset, char* dst, uint64 size, const char* context) const;
-      void check_fail(const char* context, const char* context2 = "") const;
 
       typedef vw::uint16 BlobRecordSizeType;
       /// Returns the metadata (i.e. BlobRecord) for a blob entry.
-      detail::BlobRecord read_blob_record(const uint32& base_offset, BlobRecordSizeType &blob_record_size) const;
-      TileHeader         read_tile_header(const uint32& base_offset, const detail::BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const;
-      TileData           read_tile_data  (const uint32& base_offset, const detail::BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const;
+      detail::BlobRecord read_blob_record(uint64 base_offset, BlobRecordSizeType &blob_record_size) const;
+      TileHeader         read_tile_header(uint64 base_offset, const detail::BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const;
+      TileData           read_tile_data  (uint64 base_offset, const detail::BlobRecord& blob_record, const BlobRecordSizeType& blob_record_size) const;
 
       uint64 read_end_of_file_ptr() const;
 
+      // Loads the index following the records, if there is a valid one.
+      void read_index();
+
       void init();
 
       // protected constructor so WriteBlob can do its own initialization
@@ -81,14 +113,14 @@ namespace platefile {
           // This is required for boost::iterator_facade
           friend class boost::iterator_core_access;
           // Private variables
-          ReadBlob* m_blob;
+          const ReadBlob* m_blob;
           uint64 m_current_base_offset;
 
           bool equal (iterator const& iter) const;
           void increment();
           BlobTileRecord dereference() const;
         public:
-          iterator( ReadBlob *blob, uint64 base_offset );
+          iterator( const ReadBlob *blob, uint64 base_offset );
           uint64 current_base_offset() const;
       };
 
@@ -109,26 +141,42 @@ namespace platefile {
       /// 3*sizeof(uint64) is the very first byte in the file after the
       /// end-of-file pointer.  (See the *_end_of_file_ptr() routines
       /// above for more info...)
-      iterator begin() { return iterator(this, 3*sizeof(uint64) ); }
+      iterator begin() const { return iterator(this, 3*sizeof(uint64) ); }
 
       /// Returns an iterator pointing one past the last TileHeader in the blob.
-      iterator end() { return iterator(this, m_end_of_file_ptr ); }
+      iterator end() const { return iterator(this, m_end_of_file_ptr ); }
 
       /// Seek to the next base offset given the current base offset.
-      uint64 next_base_offset(uint64 current_base_offset);
+      uint64 next_base_offset(uint64 current_base_offset) const;
+
+      /// True if the base offsets of the records are known without
+      /// walking the blob, from the index that follows them.
+      bool has_index() const { return m_has_index; }
+
+      /// Returns the base offset of every record, in order.  These
+      /// come from the index if there is one, or else from reading
+      /// each record's metadata in turn.
+      std::vector<uint64> record_offsets() const;
 
       /// Returns binary index record (a serialized protobuffer) for an
       /// entry starting at base_offset.
-      TileHeader read_header(vw::uint64 base_offset64);
+      TileHeader read_header(vw::uint64 base_offset64) const;
 
       /// Returns the binary data for an entry starting at base_offset.
-      TileData read_data(vw::uint64 base_offset);
+      TileData read_data(vw::uint64 base_offset) const;
 
       /// Returns the whole blob record (this is faster than calling read_header then real_tile_data)
-      BlobTileRecord read_record(vw::uint64 base_offset);
+      BlobTileRecord read_record(vw::uint64 base_offset) const;
 
-      /// Returns the parameters necessary to call sendfile(2)
-      void read_sendfile(vw::uint64 base_offset, std::string& filename, vw::uint64& offset, vw::uint64& size);
+      /// Returns the parameters necessary to call sendfile(2).  If
+      /// variants is given, it is filled in with the tile's other
+      /// encodings (see Blob::write()).
+      void read_sendfile(vw::uint64 base_offset, std::string& filename, vw::uint64& offset, vw::uint64& size,
+                         std::vector<BlobSendfileRange>* variants = 0) const;
+
+      /// Returns the data of the tile's variant with the given
+      /// filetype, or a null TileData if it has none.
+      TileData read_variant(vw::uint64 base_offset, const std::string& filetype) const;
 
       /// Returns the data size
       uint64 data_size(uint64 base_offset) const;
@@ -137,6 +185,9 @@ namespace platefile {
   class Blob : public ReadBlob {
     private:
       uint64 m_write_count;
+      // Whether the index following the records is current on disk.
+      bool m_index_on_disk;
+      void write_at(uint64 offset, const char* src, uint64 size, const char* context);
       void write_end_of_file_ptr(uint64 ptr);
     public:
       explicit Blob(const std::string& filename);
@@ -151,7 +202,12 @@ namespace platefile {
       /// written to the blob file.
       vw::uint64 write(TileHeader const& header, const uint8* data, uint64 data_size);
 
-      // Flush all pending changes
+      /// Like write(), but stores other encodings of the tile in the
+      /// same record.  Readers that don't ask for them never see them.
+      vw::uint64 write(TileHeader const& header, const uint8* data, uint64 data_size, const TileVariants& variants);
+
+      /// Flush all pending changes, writing the end of file pointer
+      /// and the index of record offsets.
       void flush();
   };
 
@@ -19,12 +19,17 @@
 #include <boost/foreach.hpp>
 #include <boost/regex.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
 
 namespace fs = boost::filesystem;
 
 namespace {
   static const vw::uint64 BLOB_MAX_SIZE = 1717986920; // 1.6 GB
   static const boost::format blob_tmpl("%s/plate_%u.blob");
+
+  bool can_write(vw::uint64 size) { return size <= BLOB_MAX_SIZE; }
 }
 
 #define WHEREAMI (vw::vw_out(VerboseDebugMessage, "platefile.blob") << VW_CURRENT_FUNCTION << ": ")
@@ -32,91 +37,120 @@ namespace {
 namespace vw {
 namespace platefile {
 
-const uint64 BlobManager::BLOB_MIN_WRITABLE_SCORE = 2;
-
-uint64 BlobManager::BlobKey::score() const {
-  if (locked)          return 1;
-  if (size > BLOB_MAX_SIZE) return 0;
-  return size + BLOB_MIN_WRITABLE_SCORE;
+std::string BlobManager::name_from_id(uint32 blob_id) const {
+  boost::format blob_name(blob_tmpl);
+  return boost::str(blob_name % m_directory % blob_id);
 }
 
-bool BlobManager::BlobKey::can_write() const {
-  return score() >= BLOB_MIN_WRITABLE_SCORE;
+BlobManager::Slot& BlobManager::slot(uint32 blob_id) const {
+  return m_segments[blob_id / SEGMENT_SIZE].load()[blob_id % SEGMENT_SIZE];
 }
 
-std::string BlobManager::name_from_id(uint32 blob_id) const {
-  boost::format blob_name(blob_tmpl);
-  return boost::str(blob_name % m_directory % blob_id);
+uint32 BlobManager::affinity_slot() {
+  return uint32(boost::hash<boost::thread::id>()(boost::this_thread::get_id()) % AFFINITY_SLOTS);
 }
 
 uint32 BlobManager::num_blobs() const {
-  Mutex::Lock lock(m_mutex);
-  return m_blobs.size();
+  return m_num_blobs.load();
 }
 
 uint64 BlobManager::blob_size(uint32 blob_id) const {
-  Mutex::Lock lock(m_mutex);
-  const blob_by_id_t& lookup = m_blobs.get<0>();
-  blob_by_id_t::const_iterator i = lookup.find(blob_id);
-  VW_ASSERT(i != lookup.end(), ArgumentErr() << "No such blob id " << blob_id);
-  return i->size;
+  VW_ASSERT(blob_id < m_num_blobs.load(), ArgumentErr() << "No such blob id " << blob_id);
+  return slot(blob_id).size.load();
+}
+
+bool BlobManager::try_lock(uint32 blob_id) {
+  Slot& s = slot(blob_id);
+  return can_write(s.size.load()) && s.locked.compare_and_swap(0, 1);
 }
 
 uint32 BlobManager::request_lock() {
   WHEREAMI << std::endl;
-  Mutex::Lock lock(m_mutex);
-  blob_by_score_t& lookup = m_blobs.get<1>();
 
-  blob_by_score_t::iterator i = lookup.begin();
-  if (i == lookup.end() || !i->can_write())
-    return locked_add_blob();
+  // Fast path: the blob this thread's affinity slot last released.
+  uint32 hint = m_affinity[affinity_slot()].load();
+  if (hint && try_lock(hint - 1))
+    return hint - 1;
 
-  VW_ASSERT(!i->locked, LogicErr() << "Tried to lock an already-locked blob");
-  lookup.modify(i, BlobKey::SetLock(true));
+  Mutex::Lock lock(m_mutex);
+  while (!m_free.empty()) {
+    uint32 blob_id = m_free.back();
+    m_free.pop_back();
+    if (try_lock(blob_id))
+      return blob_id;
+  }
+
+  // Blobs left in the slots of threads that are gone (or busy elsewhere).
+  for (uint32 i = 0; i < AFFINITY_SLOTS; ++i) {
+    uint32 h = m_affinity[i].load();
+    if (h && try_lock(h - 1))
+      return h - 1;
+  }
 
-  return i->id;
+  return locked_add_blob();
 }
 
 uint32 BlobManager::locked_add_blob() {
   WHEREAMI << std::endl;
 
-  uint32 next_id = 0;
-  const blob_by_id_t& lookup = m_blobs.get<0>();
-  blob_by_id_t::const_reverse_iterator i = lookup.rbegin();
+  const uint32 next_id = m_num_blobs.load();
+  const uint32 segment = next_id / SEGMENT_SIZE;
+  VW_ASSERT(segment < MAX_SEGMENTS, LogicErr() << "Failed to add blob " << next_id << ": too many blobs");
+  if (!m_segments[segment].load())
+    m_segments[segment].store(new Slot[SEGMENT_SIZE]);
 
-  if (i != lookup.rend())
-    next_id = i->id + 1;
-
-  std::pair<blob_tracker_t::iterator, bool> ret = m_blobs.insert(BlobKey(0, next_id, true));
-  VW_ASSERT(ret.second, LogicErr() << "Failed to add blob " << next_id);
+  Slot& s = slot(next_id);
+  s.size.store(0);
+  s.locked.store(1);
+  m_num_blobs.store(next_id + 1);
   return next_id;
 }
 
 void BlobManager::release_lock(uint32 blob_id) {
-  WHEREAMI << "release " << blob_id << std::endl;
-  Mutex::Lock lock(m_mutex);
-  blob_by_id_t& lookup = m_blobs.get<0>();
-  blob_by_id_t::iterator i = lookup.find(blob_id);
-  VW_ASSERT(i != lookup.end(), ArgumentErr() << "No such blob id " << blob_id);
-  VW_ASSERT(i->locked, LogicErr() << "Tried to unlock already-unlocked blob");
-
   std::string fn = name_from_id(blob_id);
 
   uint64 size = 0;
   if (fs::exists(fn))
     size = fs::file_size(fn);
 
-  lookup.modify(i, BlobKey::SetUnlockSize(size));
+  release_lock(blob_id, size);
+}
+
+void BlobManager::release_lock(uint32 blob_id, uint64 blob_size) {
+  WHEREAMI << "release " << blob_id << std::endl;
+  VW_ASSERT(blob_id < m_num_blobs.load(), ArgumentErr() << "No such blob id " << blob_id);
+  Slot& s = slot(blob_id);
+
+  s.size.store(blob_size);
+  bool was_locked = s.locked.compare_and_swap(1, 0);
+  VW_ASSERT(was_locked, LogicErr() << "Tried to unlock already-unlocked blob");
+
+  if (!can_write(blob_size))
+    return;
+
+  // Keep the blob for this thread.  The blob it had before (if this
+  // thread held two at once) goes on the free list.
+  Atomic<uint32>& affinity = m_affinity[affinity_slot()];
+  uint32 old;
+  do {
+    old = affinity.load();
+  } while (!affinity.compare_and_swap(old, blob_id + 1));
+
+  if (old && old != blob_id + 1) {
+    Mutex::Lock lock(m_mutex);
+    m_free.push_back(old - 1);
+  }
 }
 
 BlobManager::BlobManager(const std::string& directory)
-  : m_directory(directory)
+  : m_num_blobs(0), m_directory(directory)
 {
   if (!fs::exists(directory))
     return;
   boost::regex re("plate_(\\d+)\\.blob");
   typedef fs::directory_iterator iter_t;
 
+  std::vector<std::pair<uint64, uint32> > found;
   BOOST_FOREACH(const fs::path& p, boost::make_iterator_range(iter_t(directory), iter_t())) {
     boost::cmatch matches;
     if (!boost::regex_match(p.filename().c_str(), matches, re))
@@ -124,10 +158,32 @@ BlobManager::BlobManager(const std::string& directory)
 
     std::string blob_id_str(matches[1].first, matches[1].second);
     uint32 blob_id = boost::lexical_cast<uint32>(blob_id_str);
+    found.push_back(std::make_pair(uint64(fs::file_size(p)), blob_id));
+  }
 
-    std::pair<blob_tracker_t::iterator, bool> ret = m_blobs.insert(BlobKey(fs::file_size(p), blob_id, false));
-    VW_ASSERT(ret.second, LogicErr() << "Failed to add blob " << blob_id);
+  // Ids are handed out densely, so a gap is a blob that was deleted.
+  // Mark it full, so that it's never written again.
+  uint32 count = 0;
+  for (size_t i = 0; i < found.size(); ++i)
+    count = std::max(count, found[i].second + 1);
+  for (uint32 i = 0; i < count; ++i) {
+    locked_add_blob();
+    slot(i).size.store(BLOB_MAX_SIZE + 1);
+    slot(i).locked.store(0);
   }
+
+  // The fullest writable blob is handed out first, as before.
+  std::sort(found.begin(), found.end());
+  for (size_t i = 0; i < found.size(); ++i) {
+    slot(found[i].second).size.store(found[i].first);
+    if (can_write(found[i].first))
+      m_free.push_back(found[i].second);
+  }
+}
+
+BlobManager::~BlobManager() {
+  for (uint32 i = 0; i < MAX_SEGMENTS; ++i)
+    delete [] m_segments[i].load();
 }
 
 }} // namespace vw::platefile
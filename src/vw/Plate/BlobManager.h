@@ -9,12 +9,10 @@
 #define __VW_PLATE_BLOB_MANAGER__
 
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
 #include <vw/Core/Log.h>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/member.hpp>
+#include <vector>
 
 namespace vw {
 namespace platefile {
@@ -25,49 +23,40 @@ namespace platefile {
   // locking/unlocking of blobs, and can load balance blobs writes by
   // alternating which blob is offered up for writing data.
   //
-  // The BlobManager is thread safe.
-  class BlobManager {
-
-    static const uint64 BLOB_MIN_WRITABLE_SCORE;
-    struct BlobKey {
-      uint64 size;
-      uint32 id;
-      bool locked;
-
-      BlobKey(uint64 size, uint32 id, bool locked) : size(size), id(id), locked(locked) {}
-
-      uint64 score() const;
-      bool can_write() const;
-
-      struct SetLock {
-        bool lock;
-        SetLock(bool lock) : lock(lock) {}
-        void operator()(BlobKey& k) {k.locked = lock;}
-      };
-
-      struct SetUnlockSize {
-        uint64 size;
-        SetUnlockSize(uint64 size) : size(size) {}
-        void operator()(BlobKey& k) {k.size = size; k.locked = false;}
-      };
+  // The BlobManager is thread safe.  A blob is locked by a compare-and-swap
+  // on its own lock word, so writers only contend when they want the same
+  // blob.  To find one, a writer first tries the blob that was last
+  // released by a thread with the same affinity slot (usually itself), and
+  // only then takes a mutex to pop a blob off the free list or add a new one.
+  class BlobManager : private boost::noncopyable {
+
+    struct Slot {
+      Atomic<uint32> locked;
+      Atomic<uint64> size;
     };
 
-    // largest unlocked blob (ordered_non_unique<score>)
-    // largest blob id       (ordered_unique<id>)
-    // blob id key           (ordered_unique<id>)
-    typedef boost::multi_index_container<BlobKey,
-              boost::multi_index::indexed_by<boost::multi_index::ordered_unique<boost::multi_index::member<BlobKey, uint32, &BlobKey::id> >,
-                                             boost::multi_index::ordered_non_unique<boost::multi_index::const_mem_fun<BlobKey, uint64, &BlobKey::score>, std::greater<uint64> > > >
-            blob_tracker_t;
+    // Slots live in fixed-size segments that never move, so they can be
+    // found without a lock while new ones are added.
+    static const uint32 SEGMENT_SIZE = 1024;
+    static const uint32 MAX_SEGMENTS = 4096;
+    Atomic<Slot*> m_segments[MAX_SEGMENTS];
+    Atomic<uint32> m_num_blobs;
 
-    typedef blob_tracker_t::nth_index<0>::type blob_by_id_t;
-    typedef blob_tracker_t::nth_index<1>::type blob_by_score_t;
+    // Blob id + 1 of the blob each affinity slot released last; 0 is none.
+    static const uint32 AFFINITY_SLOTS = 64;
+    Atomic<uint32> m_affinity[AFFINITY_SLOTS];
 
+    // Unlocked blobs that no affinity slot holds.  Entries are only hints:
+    // a blob is whoever's compare-and-swap on its lock word wins.
     mutable vw::Mutex m_mutex;
+    std::vector<uint32> m_free;
+
     std::string m_directory;
-    blob_tracker_t m_blobs;
 
+    Slot& slot(uint32 blob_id) const;
+    bool try_lock(uint32 blob_id);
     uint32 locked_add_blob();
+    static uint32 affinity_slot();
 
   public:
 
@@ -79,6 +68,7 @@ namespace platefile {
 
     // Create a new blob manager.
     BlobManager(const std::string& directory);
+    ~BlobManager();
 
     // Request a blob to write to that has sufficient space. Returns the blob
     // index of a locked blob that you have sole access to write to.
@@ -87,8 +77,12 @@ namespace platefile {
     // Given a blob id, return the filename of the corresponding blob
     std::string name_from_id(uint32 blob_id) const;
 
-    // Release the blob lock
+    // Release the blob lock.  The blob's size is read from the disk.
     void release_lock(uint32 blob_id);
+
+    // Release the blob lock, given the blob's size (the writer knows it),
+    // which saves a stat.
+    void release_lock(uint32 blob_id, uint64 blob_size);
   };
 
 
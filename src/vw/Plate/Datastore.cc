@@ -2,6 +2,7 @@
 #include <vw/Plate/HTTPUtils.h>
 #include <vw/Plate/detail/Blobstore.h>
 #include <vw/Plate/detail/Dirstore.h>
+#include <boost/foreach.hpp>
 
 namespace vw { namespace platefile {
 
@@ -31,4 +32,10 @@ Datastore::TileSearch& Datastore::get(TileSearch& buf, uint32 level,   const BBo
   return this->populate(buf);
 }
 
+void Datastore::write_updates(WriteState& state, const TileSearch& tiles) {
+  BOOST_FOREACH(const Tile& t, tiles)
+    this->write_update(state, t.hdr.level(), t.hdr.row(), t.hdr.col(), t.hdr.filetype(),
+                       t.data->empty() ? 0 : &t.data->operator[](0), t.data->size());
+}
+
 }}
@@ -34,9 +34,22 @@ class WriteState {
     virtual std::string what() const = 0;
 };
 
+// Another encoding of a tile (a jpg of a png tile, say) that is stored with
+// it, so a server can hand out whichever one a client prefers.
+struct TileVariant {
+  std::string filetype;
+  TileData    data;
+  TileVariant() {}
+  TileVariant(const std::string& filetype, TileData data)
+    : filetype(filetype), data(data) {}
+};
+typedef std::vector<TileVariant> TileVariants;
+
 struct Tile {
   TileHeader hdr;
   TileData   data;
+  // Only written; the Blobstore stores them, the Dirstore drops them.
+  TileVariants variants;
   Tile() {}
   Tile(const TileHeader& hdr)
     : hdr(hdr) {}
@@ -84,6 +97,10 @@ class Datastore {
     // TILE WRITE
     virtual WriteState* write_request(const Transaction& id) VW_WARN_UNUSED = 0;
     virtual void write_update(WriteState& state, uint32 level, uint32 row, uint32 col, const std::string& filetype, const uint8* data, uint64 size) = 0;
+    // Writes several tiles, taking the location and filetype of each from its
+    // header, and commits their index records together where the datastore
+    // can.
+    virtual void write_updates(WriteState& state, const TileSearch& tiles);
     virtual void write_complete(WriteState& id) = 0;
     virtual void flush() = 0;
 
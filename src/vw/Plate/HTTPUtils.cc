@@ -366,4 +366,66 @@ string url_escape(const string& str, const string& safe) {
       to_hex_formatter);
 }
 
+double accept_quality(const string& accept, const string& mime) {
+  if (boost::trim_copy(accept).empty())
+    return 1;
+
+  const size_t slash = mime.find('/');
+  const string mime_type = mime.substr(0, slash);
+
+  // 3 for type/subtype, 2 for type/*, 1 for */*
+  int best_match = 0;
+  double quality = 0;
+
+  vector<string> ranges;
+  boost::split(ranges, accept, boost::is_any_of(","));
+  BOOST_FOREACH(const string& range, ranges) {
+    vector<string> params;
+    boost::split(params, range, boost::is_any_of(";"));
+    const string media = boost::to_lower_copy(boost::trim_copy(params[0]));
+
+    int match = 0;
+    if (media == mime)
+      match = 3;
+    else if (media == mime_type + "/*")
+      match = 2;
+    else if (media == "*/*")
+      match = 1;
+    if (match <= best_match)
+      continue;
+
+    double q = 1;
+    for (size_t i = 1; i < params.size(); ++i) {
+      string param = boost::trim_copy(params[i]);
+      if (!boost::starts_with(param, "q="))
+        continue;
+      try {
+        q = boost::lexical_cast<double>(param.substr(2));
+      } catch (const boost::bad_lexical_cast&) {
+        q = 0;
+      }
+    }
+    best_match = match;
+    quality = std::max(0.0, std::min(1.0, q));
+  }
+  return quality;
+}
+
+bool etag_matches(const string& if_none_match, const string& etag) {
+  const string want = boost::starts_with(etag, "W/") ? etag.substr(2) : etag;
+
+  vector<string> items;
+  boost::split(items, if_none_match, boost::is_any_of(","));
+  BOOST_FOREACH(string& item, items) {
+    boost::trim(item);
+    if (item == "*")
+      return true;
+    if (boost::starts_with(item, "W/"))
+      item.erase(0, 2);
+    if (!item.empty() && item == want)
+      return true;
+  }
+  return false;
+}
+
 }} // namespace vw::platefile
@@ -26,6 +26,16 @@ std::string url_unescape(const std::string& str);
 // Returns a copy of the string, url-escaped.
 std::string url_escape(const std::string& str, const std::string& safe = "");
 
+// Returns true if an If-None-Match header value matches the etag (which
+// includes its quotes). The header is "*" or a comma-separated list of
+// etags; as the spec asks, a weak (W/) etag matches its strong twin.
+bool etag_matches(const std::string& if_none_match, const std::string& etag);
+
+// Returns how much an Accept header value says the client wants a mime type
+// (its q value, from 0 to 1), taken from the most specific media range that
+// matches it. An empty header accepts anything.
+double accept_quality(const std::string& accept, const std::string& mime);
+
 class QueryMap {
     typedef std::map<std::string,std::string> map_t;
     map_t m_map;
@@ -230,6 +230,62 @@ METHOD_IMPL(ReadRequest, IndexReadRequest, IndexReadReply) {
                             request->transaction_id(), request->exact_transaction_match());
 }
 
+METHOD_IMPL(MultiRead, IndexMultiReadRequest, IndexMultiReadReply) {
+  METHOD_BOILERPLATE(read_lock_t);
+  IndexServiceRecord rec = find_id_throw(request->platefile_id());
+
+  std::vector<TileHeader> tiles(request->tiles().begin(), request->tiles().end());
+  Index::ReadResults results = rec.index->read_requests(tiles, request->exact_transaction_match());
+
+  BOOST_FOREACH(const Index::ReadResult& r, results) {
+    IndexReadResult* out = response->add_results();
+    out->set_found(r.found);
+    if (r.found) {
+      *(out->mutable_header()) = r.header;
+      *(out->mutable_record()) = r.record;
+    }
+  }
+}
+
+METHOD_IMPL(RegionRead, IndexRegionReadRequest, IndexRegionReadReply) {
+  METHOD_BOILERPLATE(read_lock_t);
+  IndexServiceRecord rec = find_id_throw(request->platefile_id());
+
+  VW_ASSERT(request->min_col() >= 0 && request->min_row() >= 0 &&
+            request->min_col() < request->max_col() && request->min_row() < request->max_row(),
+            ArgumentErr() << "RegionRead: empty or negative region");
+  const BBox2i region(request->min_col(), request->min_row(),
+                      request->max_col() - request->min_col(), request->max_row() - request->min_row());
+
+  // The pages overlapping the region, in row-major order
+  const Vector2i page = rec.index->page_size();
+  const int32 first_col = request->min_col() / page.x(), first_row = request->min_row() / page.y();
+  const uint32 cols = (request->max_col() - 1) / page.x() - first_col + 1;
+  const uint32 pages = cols * ((request->max_row() - 1) / page.y() - first_row + 1);
+
+  for (uint32 p = request->start_page(); p < pages; ++p) {
+    BBox2i sub((first_col + p % cols) * page.x(), (first_row + p / cols) * page.y(), page.x(), page.y());
+    sub.crop(region);
+
+    std::list<TileHeader> found = rec.index->search_by_region(request->level(), sub,
+                                                              request->start_transaction_id(),
+                                                              request->end_transaction_id());
+    std::vector<TileHeader> tiles(found.begin(), found.end());
+    Index::ReadResults results = rec.index->read_requests(tiles, true);
+    BOOST_FOREACH(const Index::ReadResult& r, results) {
+      if (!r.found)
+        continue;
+      *(response->add_headers()) = r.header;
+      *(response->add_records()) = r.record;
+    }
+
+    if (uint32(response->headers_size()) >= request->max_results() && p + 1 < pages) {
+      response->set_next_page(p + 1);
+      break;
+    }
+  }
+}
+
 METHOD_IMPL(WriteRequest, IndexWriteRequest, IndexWriteReply) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
@@ -257,7 +313,7 @@ METHOD_IMPL_NOREPLY(MultiWriteUpdate, IndexMultiWriteUpdate) {
 METHOD_IMPL_NOREPLY(WriteComplete, IndexWriteComplete) {
   METHOD_BOILERPLATE(read_lock_t);
   IndexServiceRecord rec = find_id_throw(request->platefile_id());
-  rec.index->write_complete(request->blob_id());
+  rec.index->write_complete(request->blob_id(), request->blob_size());
 }
 
 METHOD_IMPL(TransactionRequest, IndexTransactionRequest, IndexTransactionReply) {
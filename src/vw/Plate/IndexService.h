@@ -81,6 +81,19 @@ namespace platefile {
                              IndexReadReply* response,
                              ::google::protobuf::Closure* done);
 
+    // Like ReadRequest, but for many tiles at once.
+    virtual void MultiRead(::google::protobuf::RpcController* controller,
+                           const IndexMultiReadRequest* request,
+                           IndexMultiReadReply* response,
+                           ::google::protobuf::Closure* done);
+
+    // Returns the headers and records of the tiles in a region, a
+    // few pages per reply.
+    virtual void RegionRead(::google::protobuf::RpcController* controller,
+                            const IndexRegionReadRequest* request,
+                            IndexRegionReadReply* response,
+                            ::google::protobuf::Closure* done);
+
     virtual void WriteRequest(::google::protobuf::RpcController* controller,
                               const IndexWriteRequest* request,
                               IndexWriteReply* response,
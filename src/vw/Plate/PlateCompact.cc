@@ -0,0 +1,247 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Plate/PlateCompact.h>
+#include <vw/Plate/Blob.h>
+#include <vw/Plate/BlobManager.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Plate/detail/LocalIndex.h>
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Log.h>
+
+#include <boost/foreach.hpp>
+#include <boost/regex.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/convenience.hpp>
+namespace fs = boost::filesystem;
+
+using namespace vw;
+using namespace vw::platefile;
+namespace d = vw::platefile::detail;
+
+namespace {
+
+  // Interleaves the bits of col and row, col in the even bits.
+  uint64 morton_code(uint32 col, uint32 row) {
+    uint64 code = 0;
+    for (uint32 bit = 0; bit < 32; ++bit) {
+      code |= uint64((col >> bit) & 1) << (2*bit);
+      code |= uint64((row >> bit) & 1) << (2*bit + 1);
+    }
+    return code;
+  }
+
+  struct LiveTile {
+    uint32 level;
+    uint64 morton;
+    uint32 transaction_id;
+    uint32 blob_id;
+    uint64 blob_offset;
+
+    bool operator<(const LiveTile& b) const {
+      if (level  != b.level)  return level  < b.level;
+      if (morton != b.morton) return morton < b.morton;
+      // newest first, as the index pages keep them
+      return transaction_id > b.transaction_id;
+    }
+  };
+
+  // The blobs of a plate, indexed by blob id.  Missing ids are empty.
+  std::vector<std::string> blob_filenames(const std::string& plate) {
+    std::vector<std::string> result;
+    boost::regex re("plate_(\\d+)\\.blob");
+    for (fs::directory_iterator i(plate), end; i != end; ++i) {
+      boost::cmatch matches;
+      if (!boost::regex_match(i->path().filename().c_str(), matches, re))
+        continue;
+      uint32 blob_id = boost::lexical_cast<uint32>(matches.str(1));
+      if (result.size() < blob_id+1)
+        result.resize(blob_id+1);
+      result[blob_id] = i->path().string();
+    }
+    return result;
+  }
+
+  // Collects the tiles in the blobs that the index still points at.
+  // With latest_only, a tile that is committed (at or below the read
+  // cursor) is kept only if it is the newest committed one at its
+  // location.
+  std::vector<LiveTile> find_live_tiles(d::LocalIndex& index, const std::vector<std::string>& blobs,
+                                        bool latest_only, uint64& dead_bytes) {
+    const Transaction cursor = index.transaction_cursor();
+    std::vector<LiveTile> live;
+    dead_bytes = 0;
+
+    for (uint32 blob_id = 0; blob_id < blobs.size(); ++blob_id) {
+      if (blobs[blob_id].empty())
+        continue;
+
+      TerminalProgressCallback tpc("plate", "\t--> Scanning blob " + stringify(blob_id) + " : ");
+      ReadBlob blob(blobs[blob_id]);
+      std::vector<uint64> offsets = blob.record_offsets();
+
+      std::vector<TileHeader> hdrs;
+      hdrs.reserve(offsets.size());
+      BOOST_FOREACH(uint64 offset, offsets)
+        hdrs.push_back(blob.read_header(offset));
+      tpc.report_progress(0.5);
+
+      // Where the index says each tile is...
+      d::Index::ReadResults exact = index.read_requests(hdrs, true);
+
+      // ...and, for committed tiles, where the newest committed tile there is.
+      d::Index::ReadResults newest;
+      if (latest_only) {
+        std::vector<TileHeader> at_cursor(hdrs);
+        BOOST_FOREACH(TileHeader& h, at_cursor)
+          h.set_transaction_id(cursor);
+        newest = index.read_requests(at_cursor, false);
+      }
+
+      for (size_t i = 0; i < hdrs.size(); ++i) {
+        bool keep = exact[i].found
+                 && exact[i].record.blob_id() == blob_id
+                 && exact[i].record.blob_offset() == offsets[i];
+        if (keep && latest_only && hdrs[i].transaction_id() <= cursor)
+          keep = newest[i].found
+              && newest[i].record.blob_id() == blob_id
+              && newest[i].record.blob_offset() == offsets[i];
+
+        if (!keep) {
+          dead_bytes += blob.data_size(offsets[i]);
+          continue;
+        }
+
+        LiveTile t;
+        t.level          = hdrs[i].level();
+        t.morton         = morton_code(hdrs[i].col(), hdrs[i].row());
+        t.transaction_id = hdrs[i].transaction_id();
+        t.blob_id        = blob_id;
+        t.blob_offset    = offsets[i];
+        live.push_back(t);
+      }
+      tpc.report_finished();
+    }
+
+    std::sort(live.begin(), live.end());
+    return live;
+  }
+
+  // Copies the tiles, in order, into the plate at dst_plate.  It writes
+  // one blob at a time until the BlobManager rolls over to the next.
+  void copy_tiles(const std::vector<LiveTile>& live, const std::vector<std::string>& src_blobs,
+                  const std::string& dst_plate, size_t batch_size) {
+    d::LocalIndex index(dst_plate);
+    BlobManager blob_manager(dst_plate);
+    std::vector<boost::shared_ptr<ReadBlob> > src(src_blobs.size());
+
+    TerminalProgressCallback tpc("plate", "\t--> Copying tiles : ");
+    for (size_t begin = 0; begin < live.size(); begin += batch_size) {
+      const size_t end = std::min(begin + batch_size, live.size());
+
+      uint32 blob_id = blob_manager.request_lock();
+      d::Index::WriteUpdates updates;
+      updates.reserve(end - begin);
+      {
+        Blob blob(blob_manager.name_from_id(blob_id));
+        for (size_t i = begin; i < end; ++i) {
+          const LiveTile& t = live[i];
+          if (!src[t.blob_id])
+            src[t.blob_id].reset(new ReadBlob(src_blobs[t.blob_id]));
+          BlobTileRecord r = src[t.blob_id]->read_record(t.blob_offset);
+
+          d::IndexRecord rec;
+          rec.set_blob_id(blob_id);
+          rec.set_blob_offset(blob.write(r.hdr, &r.data->operator[](0), r.data->size()));
+          rec.set_filetype(r.hdr.filetype());
+          updates.push_back(std::make_pair(r.hdr, rec));
+        }
+        blob.flush();
+      }
+      blob_manager.release_lock(blob_id);
+
+      index.write_updates(updates);
+      tpc.report_fractional_progress(end, live.size());
+    }
+    tpc.report_finished();
+
+    // The copied index header makes LocalIndex open the new plate as an
+    // existing one, which has no tile filters until they're built.
+    index.build_tile_filters();
+  }
+
+  uint64 total_blob_size(const std::vector<std::string>& blobs) {
+    uint64 total = 0;
+    BOOST_FOREACH(const std::string& name, blobs)
+      if (!name.empty())
+        total += fs::file_size(name);
+    return total;
+  }
+}
+
+CompactResult vw::platefile::compact_plate(std::string const& plate_name, CompactOptions const& options) {
+  VW_ASSERT(options.batch_size > 0, ArgumentErr() << "compact_plate: batch_size must be positive");
+
+  // A trailing slash would put the new plate inside the old one.
+  fs::path plate(plate_name);
+  if (plate.filename() == ".")
+    plate = plate.parent_path();
+  const std::string plate_str = plate.string();
+  const std::string new_str   = plate_str + ".compact";
+  const std::string old_str   = plate_str + ".precompact";
+
+  if (!fs::exists(plate_str + "/plate.index"))
+    vw_throw(IOErr() << "Could not open platefile \"" << plate_str << "\": no plate.index");
+  if (fs::exists(new_str) || fs::exists(old_str))
+    vw_throw(IOErr() << "Refusing to compact: \"" << new_str << "\" or \"" << old_str
+                     << "\" is left over from an earlier run. Remove it first.");
+
+  CompactResult result;
+  std::vector<std::string> blobs = blob_filenames(plate_str);
+  result.old_size = total_blob_size(blobs);
+
+  std::vector<LiveTile> live;
+  {
+    d::LocalIndex index(plate_str);
+    live = find_live_tiles(index, blobs, options.latest_only, result.dead_bytes);
+  }
+  result.live_tiles = live.size();
+  if (options.dry_run)
+    return result;
+
+  // The new plate starts out with the old plate's header and log.
+  fs::create_directories(new_str + "/index");
+  fs::copy_file(plate_str + "/plate.index", new_str + "/plate.index");
+  if (fs::exists(plate_str + "/plate.log"))
+    fs::copy_file(plate_str + "/plate.log", new_str + "/plate.log");
+
+  copy_tiles(live, blobs, new_str, options.batch_size);
+  {
+    d::LocalIndex index(new_str);
+    index.log() << "Compacted by platecompact: kept " << live.size() << " tiles, dropped "
+                << result.dead_bytes << " bytes of tile data.\n";
+  }
+
+  result.new_size = total_blob_size(blob_filenames(new_str));
+
+  // Two renames, not an atomic swap: in between there is no plate at
+  // plate_str.  If the second one fails, put the old plate back.
+  fs::rename(plate_str, old_str);
+  try {
+    fs::rename(new_str, plate_str);
+  } catch (const fs::filesystem_error&) {
+    fs::rename(old_str, plate_str);
+    throw;
+  }
+  if (!options.keep_old)
+    fs::remove_all(old_str);
+
+  return result;
+}
@@ -0,0 +1,73 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file PlateCompact.h
+///
+/// Rewrites a local platefile so that its blobs hold only the tiles
+/// the index still refers to.  Blobs only ever grow: a tile written
+/// twice leaves its first copy behind, and so does a failed
+/// transaction.  This is what the platecompact tool runs.
+///
+#ifndef __VW_PLATE_PLATECOMPACT_H__
+#define __VW_PLATE_PLATECOMPACT_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <string>
+
+namespace vw {
+namespace platefile {
+
+  /// How compact_plate() should treat a plate.
+  struct CompactOptions {
+    /// Also drop committed tiles that a newer committed tile at the
+    /// same location hides.
+    bool latest_only;
+    /// Keep the old plate as <plate>.precompact instead of deleting it.
+    bool keep_old;
+    /// Only count the dead tiles; leave the plate alone.
+    bool dry_run;
+    /// Tiles to copy between index updates.
+    size_t batch_size;
+
+    CompactOptions() : latest_only(false), keep_old(false), dry_run(false), batch_size(1024) {}
+  };
+
+  /// What compact_plate() found.
+  struct CompactResult {
+    /// Tiles the compacted plate holds.
+    uint64 live_tiles;
+    /// Bytes of tile data that were dropped.
+    uint64 dead_bytes;
+    /// Bytes of blobs before and after.  new_size is zero for a dry run.
+    uint64 old_size, new_size;
+
+    CompactResult() : live_tiles(0), dead_bytes(0), old_size(0), new_size(0) {}
+  };
+
+  /// Compacts the local platefile at plate.
+  ///
+  /// The live tiles are found by walking each blob and asking the
+  /// index whether it points at that record.  They are then copied
+  /// into a fresh plate at <plate>.compact, level by level, each
+  /// level in Morton (Z) order, so that tiles near each other on the
+  /// map end up near each other on disk.  The new plate keeps the old
+  /// index header (platefile id, transaction cursors and all).
+  ///
+  /// Once the new plate is complete, the old one is renamed to
+  /// <plate>.precompact and the new one to <plate>.  These are two
+  /// renames, not one atomic swap: between them there is no plate at
+  /// that path, so nothing may read or write the plate while it is
+  /// compacted.  If the second rename fails, the old plate is moved
+  /// back.
+  ///
+  /// Throws IOErr if plate has no index, or if a .compact or
+  /// .precompact directory is left over from an earlier run.
+  CompactResult compact_plate(std::string const& plate, CompactOptions const& options = CompactOptions());
+
+}} // namespace vw::platefile
+
+#endif
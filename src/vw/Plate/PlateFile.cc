@@ -45,11 +45,19 @@ ReadOnlyPlateFile::ReadOnlyPlateFile(const Url& url, std::string type, std::stri
 }
 
 PlateFile::PlateFile(const Url& url)
-  : ReadOnlyPlateFile(url) {}
+  : ReadOnlyPlateFile(url), m_write_batch_size(1) {}
 
 PlateFile::PlateFile(const Url& url, std::string type, std::string description, uint32 tile_size, std::string tile_filetype,
                      PixelFormatEnum pixel_format, ChannelTypeEnum channel_type)
-  : ReadOnlyPlateFile(url, type, description, tile_size, tile_filetype, pixel_format, channel_type) {}
+  : ReadOnlyPlateFile(url, type, description, tile_size, tile_filetype, pixel_format, channel_type), m_write_batch_size(1) {}
+
+PlateFile::~PlateFile() {
+  try {
+    this->flush_writes();
+  } catch (const vw::Exception& e) {
+    vw_out(ErrorMessage, "platefile") << "Lost " << m_write_batch.size() << " unwritten tiles: " << e.what() << "\n";
+  }
+}
 
 IndexHeader ReadOnlyPlateFile::index_header() const { return m_data->index_header(); }
 
@@ -63,7 +71,10 @@ ChannelTypeEnum ReadOnlyPlateFile::channel_type() const { return m_data->channel
 
 uint32 ReadOnlyPlateFile::num_levels() const { return m_data->num_levels(); }
 
-void PlateFile::sync() const { m_data->flush(); }
+void PlateFile::sync() {
+  this->flush_writes();
+  m_data->flush();
+}
 
 void PlateFile::log(std::string message) { m_data->audit_log()() << message; }
 
@@ -133,11 +144,17 @@ void PlateFile::write_request() {
 /// Writing, pt. 3: Signal the completion of the write operation.
 void PlateFile::write_complete() {
   VW_ASSERT(m_write_state, LogicErr() << "Must start a transaction before completing it");
+  this->flush_writes();
   m_data->write_complete(*m_write_state);
   m_write_state.reset();
 }
 
-void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type_) {
+void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type) {
+  this->write_update(data, data_size, col, row, level, type, TileVariants());
+}
+
+void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type_,
+                             const TileVariants& variants) {
 
   std::string type = type_;
   if (type.empty())
@@ -148,7 +165,50 @@ void PlateFile::write_update(const uint8* data, uint64 data_size, int col, int r
   if (type == "auto")
     vw_throw(NoImplErr() << "write_update() does not support filetype 'auto'");
 
-  m_data->write_update(*m_write_state, level, row, col, type, data, data_size);
+  BOOST_FOREACH(const TileVariant& v, variants)
+    VW_ASSERT(v.data && !v.filetype.empty() && v.filetype != "auto",
+              ArgumentErr() << "write_update(): tile variants need data and a filetype");
+
+  if (m_write_batch_size <= 1 && variants.empty()) {
+    m_data->write_update(*m_write_state, level, row, col, type, data, data_size);
+    return;
+  }
+
+  // The data may be a reused buffer (m_encode_buffer, say), so the batch
+  // keeps a copy.  Only write_updates() takes variants, so a tile with
+  // some comes this way even when writes aren't batched.
+  m_write_batch.push_back(Tile());
+  Tile& t = m_write_batch.back();
+  t.hdr.set_level(level);
+  t.hdr.set_row(row);
+  t.hdr.set_col(col);
+  t.hdr.set_filetype(type);
+  t.data.reset(new std::vector<uint8>(data, data + data_size));
+  t.variants = variants;
+
+  if (m_write_batch.size() >= m_write_batch_size)
+    this->flush_writes();
+}
+
+void PlateFile::set_write_batch_size(size_t tiles) {
+  m_write_batch_size = std::max(tiles, size_t(1));
+  if (m_write_batch.size() >= m_write_batch_size)
+    this->flush_writes();
+}
+
+void PlateFile::set_tile_variants(const std::vector<std::string>& filetypes) {
+  BOOST_FOREACH(const std::string& filetype, filetypes)
+    VW_ASSERT(!filetype.empty() && filetype != "auto",
+              ArgumentErr() << "set_tile_variants(): a variant needs a filetype other than 'auto'");
+  m_tile_variants = filetypes;
+}
+
+void PlateFile::flush_writes() {
+  if (m_write_batch.empty())
+    return;
+  VW_ASSERT(m_write_state, LogicErr() << "flush_writes(): the write was completed with tiles still pending");
+  m_data->write_updates(*m_write_state, m_write_batch);
+  m_write_batch.clear();
 }
 
 std::list<TileHeader>
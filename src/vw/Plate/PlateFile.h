@@ -105,6 +105,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Algorithms.h>
 
+#include <boost/foreach.hpp>
 #include <sstream>
 
 namespace vw {
@@ -180,6 +181,14 @@ namespace platefile {
   class PlateFile : public ReadOnlyPlateFile {
       boost::shared_ptr<Transaction> m_transaction;
       boost::shared_ptr<WriteState> m_write_state;
+      // Tiles are encoded here, so once it has grown to fit the largest
+      // one, write_update() stops allocating for them.
+      std::vector<uint8> m_encode_buffer;
+      // Tiles written but not yet sent to the datastore.
+      Datastore::TileSearch m_write_batch;
+      size_t m_write_batch_size;
+      // Filetypes each tile is also encoded in, see set_tile_variants().
+      std::vector<std::string> m_tile_variants;
     public:
       PlateFile(const Url& url);
 
@@ -187,7 +196,11 @@ namespace platefile {
                 uint32 tile_size, std::string tile_filetype,
                 PixelFormatEnum pixel_format, ChannelTypeEnum channel_type);
 
-      void sync() const;
+      /// Flushes any tiles still waiting in the write batch.
+      ~PlateFile();
+
+      /// Flushes the write batch, and then the datastore.
+      void sync();
 
       std::ostream& audit_log();
       std::ostream& error_log();
@@ -201,8 +214,20 @@ namespace platefile {
       /// in the plate file.
       template <class ViewT>
       void write_update(ImageViewBase<ViewT> const& view, int col, int row, int level) {
+        std::string type = encode_tile(view, this->default_file_type(), m_encode_buffer);
+        if (m_tile_variants.empty())
+          this->write_update(&m_encode_buffer[0], m_encode_buffer.size(), col, row, level, type);
+        else
+          this->write_update(&m_encode_buffer[0], m_encode_buffer.size(), col, row, level, type,
+                             encode_variants(view, type, m_tile_variants));
+      }
 
-        std::string type = this->default_file_type();
+      /// Encodes a tile into buf the way write_update() does, and returns
+      /// the filetype used.  It touches nothing but its arguments, so
+      /// tiles can be encoded on several threads and then written with
+      /// the raw write_update().
+      template <class ViewT>
+      static std::string encode_tile(ImageViewBase<ViewT> const& view, std::string type, std::vector<uint8>& buf) {
         if (type == "auto") {
           // This specialization saves us TONS of space by storing opaque tiles
           // as jpgs.  However it does come at a small cost of having to conduct
@@ -212,9 +237,26 @@ namespace platefile {
           else
             type = "png";
         }
-        boost::scoped_ptr<DstMemoryImageResource> r(DstMemoryImageResource::create(type, view.format()));
+        boost::scoped_ptr<DstMemoryImageResource> r(DstMemoryImageResource::create(type, view.format(), &buf));
         write_image(*r, view);
-        this->write_update(r->data(), r->size(), col, row, level, type);
+        VW_ASSERT(r->data() == &buf[0] && r->size() == buf.size(),
+                  LogicErr() << "encode_tile(): the tile was not encoded into the buffer");
+        return type;
+      }
+
+      /// Encodes a tile in each of filetypes but the one it was already
+      /// encoded in (type), as variants to store with it.
+      template <class ViewT>
+      static TileVariants encode_variants(ImageViewBase<ViewT> const& view, const std::string& type,
+                                          const std::vector<std::string>& filetypes) {
+        TileVariants variants;
+        BOOST_FOREACH(const std::string& filetype, filetypes) {
+          if (filetype == type)
+            continue;
+          TileData data(new std::vector<uint8>());
+          variants.push_back(TileVariant(encode_tile(view, filetype, *data), data));
+        }
+        return variants;
       }
 
       /// Writing, pt. 2, alternate: Write raw data (as a tile) to a specified
@@ -222,9 +264,32 @@ namespace platefile {
       /// means "platefile default".
       void write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type = "");
 
+      /// As above, storing other encodings of the tile with it.  mod_plate
+      /// serves whichever encoding the client's Accept header prefers.
+      void write_update(const uint8* data, uint64 data_size, int col, int row, int level, const std::string& type,
+                        const TileVariants& variants);
+
+      /// Sets the filetypes (say, "jpg" for a png plate) every tile written
+      /// as an image is also encoded in.  The encodings are stored with the
+      /// tile, in the same blob record.  Empty (the default) stores none.
+      void set_tile_variants(const std::vector<std::string>& filetypes);
+      const std::vector<std::string>& tile_variants() const { return m_tile_variants; }
+
       /// Writing, pt. 3: Signal the completion of the write operation.
       void write_complete();
 
+      /// Sets the number of tiles write_update() collects before sending
+      /// them to the datastore together, which appends them to the blob in
+      /// one go and commits their index records in one message.  Batched
+      /// tiles are not visible to reads until the batch is flushed, by
+      /// filling up or by flush_writes(), sync(), write_complete() or
+      /// destruction.  The default, 1, writes each tile as it comes.
+      void set_write_batch_size(size_t tiles);
+      size_t write_batch_size() const { return m_write_batch_size; }
+
+      /// Sends any tiles waiting in the write batch to the datastore.
+      void flush_writes();
+
       // --------------------- TRANSACTIONS ------------------------
 
       // Clients are expected to make a transaction request whenever
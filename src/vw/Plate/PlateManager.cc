@@ -212,46 +212,102 @@ uint32 approximate_total_tiles(const BBox2i& region, uint32 bottom_tile_count) {
 
 template <typename PixelT>
 void cache_consume_tiles(PlateFile& plate, Datastore::TileSearch& headers, tile_cache_t<PixelT>& cache) {
-  BOOST_FOREACH(const Tile& t, plate.batch_read(headers)) {
-    ImageView<PixelT>& image = cache[d::rowcol_t(t.hdr.row(), t.hdr.col())];
-    boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
-    read_image(image, *r);
-  }
+  // batch_read() already reads the tiles blob by blob; decoding them is
+  // the slow part, so that is spread over the threads.
+  const Datastore::TileSearch& tiles = plate.batch_read(headers);
+  std::vector<ImageView<PixelT>*> images;
+  images.reserve(tiles.size());
+  BOOST_FOREACH(const Tile& t, tiles)
+    images.push_back(&cache[d::rowcol_t(t.hdr.row(), t.hdr.col())]);
+  d::parallel_ranges(tiles.size(), d::DecodeTiles<PixelT>(tiles, images));
   headers.clear();
 }
 
+// One parent tile to build, and (once built) its encoding.
+template <typename PixelT, typename HeaderT>
+struct ParentTile {
+  d::rowcol_t parent;
+  const std::vector<HeaderT>* children;
+  ImageView<PixelT>* keep;   // where to keep the tile, if anywhere
+  std::string type;          // empty if the tile was transparent
+  std::vector<uint8> data;
+  TileVariants variants;
+};
+
+template <typename PixelT, typename HeaderT>
+class BuildParents {
+    typedef ImageView<PixelT> image_t;
+    std::vector<ParentTile<PixelT, HeaderT> >& m_parents;
+    const tile_cache_t<PixelT>& m_input_tiles;
+    uint32 m_tile_size;
+    std::string m_filetype;
+    const std::vector<std::string>& m_variants;
+    bool m_preblur;
+  public:
+    BuildParents(std::vector<ParentTile<PixelT, HeaderT> >& parents, const tile_cache_t<PixelT>& input_tiles,
+                 uint32 tile_size, const std::string& filetype, const std::vector<std::string>& variants, bool preblur)
+      : m_parents(parents), m_input_tiles(input_tiles), m_tile_size(tile_size), m_filetype(filetype), m_variants(variants), m_preblur(preblur) {}
+
+    void operator()(size_t begin, size_t end) const {
+      for (size_t k = begin; k < end; ++k) {
+        ParentTile<PixelT, HeaderT>& p = m_parents[k];
+        std::map<uint32, image_t> c;
+        BOOST_FOREACH(const HeaderT& child, *p.children) {
+          typename tile_cache_t<PixelT>::const_iterator i = m_input_tiles.find(d::rowcol_t(d::therow(child), d::thecol(child)));
+          if (i != m_input_tiles.end())
+            c[d::calc_composite_id(p.parent, child)] = i->second;
+        }
+
+        image_t scratch;
+        image_t& new_image = p.keep ? *p.keep : scratch;
+        mipmap_one_tile(new_image, m_tile_size, c[0], c[1], c[2], c[3], m_preblur);
+        // As with the base tiles, a tile with no data in it is not written.
+        if (!is_transparent(new_image)) {
+          p.type = PlateFile::encode_tile(new_image, m_filetype, p.data);
+          p.variants = PlateFile::encode_variants(new_image, p.type, m_variants);
+        }
+      }
+    }
+};
+
 template <typename PixelT, typename CompositeT>
 void build_tiles(PlateFile& plate, const CompositeT& output_hdrs, const tile_cache_t<PixelT>& input_tiles, uint32 level, bool preblur, tile_cache_t<PixelT> *output_tiles, const d::RememberCallback& pc) {
-  typedef ImageView<PixelT> image_t;
   typedef typename CompositeT::mapped_type VectorT;
   typedef typename     VectorT::value_type HeaderT;
-
-  // build the new tiles
-  BOOST_FOREACH(const typename CompositeT::value_type& v, output_hdrs) {
-    const d::rowcol_t& parent = v.first;
-    const std::vector<HeaderT>& children = v.second;
-    VW_ASSERT(children.size() > 0,  LogicErr() << "How can there be zero here?");
-    VW_ASSERT(children.size() <= 4, LogicErr() << "How can there be more than four here?");
-
-    std::map<uint32, image_t> c;
-    BOOST_FOREACH(const HeaderT& child, children) {
-      typename tile_cache_t<PixelT>::const_iterator i = input_tiles.find(d::rowcol_t(d::therow(child), d::thecol(child)));
-      if (i != input_tiles.end())
-        c[d::calc_composite_id(parent, child)] = i->second;
+  typedef ParentTile<PixelT, HeaderT> parent_t;
+
+  // The parents are independent, so they are built and encoded in
+  // parallel, a chunk at a time. The PlateFile is not thread-safe, so
+  // the writes happen here afterwards, in order.
+  const size_t CHUNK = d::tile_chunk_size();
+  const std::string filetype = plate.default_file_type();
+  std::vector<parent_t> parents;
+  parents.reserve(std::min(CHUNK, output_hdrs.size()));
+
+  typename CompositeT::const_iterator v = output_hdrs.begin(), end = output_hdrs.end();
+  while (v != end) {
+    parents.clear();
+    for (; v != end && parents.size() < CHUNK; ++v) {
+      VW_ASSERT(v->second.size() > 0,  LogicErr() << "How can there be zero here?");
+      VW_ASSERT(v->second.size() <= 4, LogicErr() << "How can there be more than four here?");
+      parents.push_back(parent_t());
+      parent_t& p = parents.back();
+      p.parent   = v->first;
+      p.children = &v->second;
+      // Insert the output entries now; the map can't be changed in parallel.
+      p.keep     = output_tiles ? &output_tiles->operator[](v->first) : 0;
     }
 
-    boost::shared_ptr<image_t> new_image;
-
-    if (output_tiles)
-      new_image.reset(&output_tiles->operator[](parent), NOP());
-    else
-      new_image.reset(new image_t());
+    d::parallel_ranges(parents.size(), BuildParents<PixelT, HeaderT>(parents, input_tiles, plate.default_tile_size(), filetype, plate.tile_variants(), preblur));
 
-    mipmap_one_tile(*new_image, plate.default_tile_size(), c[0], c[1], c[2], c[3], preblur);
-    plate.write_update(*new_image, d::thecol(parent), d::therow(parent), level);
-    pc.tick();
+    BOOST_FOREACH(const parent_t& p, parents) {
+      if (!p.type.empty())
+        plate.write_update(&p.data[0], p.data.size(), d::thecol(p.parent), d::therow(p.parent), level, p.type, p.variants);
+      pc.tick();
+    }
   }
 }
+
 }
 
 template <class PixelT>
@@ -342,6 +398,7 @@ void PlateManager<PixelT>::mipmap(uint32 starting_level, BBox2i const& starting_
                                   uint32 stopping_level ) const
 {
   const uint64 CACHE_TILES = calc_cache_tile_count();
+  d::BatchWrites batch(*m_platefile, d::tile_chunk_size());
 
   BBox2i input_region(starting_region);
 
@@ -365,8 +422,12 @@ void PlateManager<PixelT>::mipmap(uint32 starting_level, BBox2i const& starting_
       break;
     }
     input_region = move_up(input_region);
+
+    // The next level is built from this one, so it must be readable.
+    m_platefile->flush_writes();
   }
 
+  m_platefile->flush_writes();
   progress_callback.report_finished();
 }
 
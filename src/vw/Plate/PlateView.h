@@ -10,18 +10,28 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/UtilityViews.h>
 #include <vw/Plate/PlateFile.h>
+#include <vw/Plate/detail/TileCache.h>
 #include <vw/Image/Transform.h>
 #include <boost/foreach.hpp>
 
 namespace vw {
 namespace platefile {
 
-  /// An image view for accessing tiles from a plate file.  Tiles are
-  /// cached by this view to increase read speeds.
+  /// An image view for accessing tiles from a plate file.
+  ///
+  /// Rasterizing a region finds all of its tiles with one index query,
+  /// reads the ones that aren't cached in one batch, and decodes them in
+  /// parallel.  Decoded tiles are kept in the system cache, shared by
+  /// every PlateView of the same pixel type, so neighbouring regions (and
+  /// other views of the same plate) don't read them again.
   template <class PixelT>
   class PlateView : public ImageViewBase<PlateView<PixelT> > {
+    typedef detail::TileCache<PixelT> tile_cache_t;
+
     boost::shared_ptr<ReadOnlyPlateFile> m_platefile;
+    uint32 m_platefile_id;
     int m_current_level;
     TransactionOrNeg m_transaction_id;
 
@@ -32,12 +42,14 @@ namespace platefile {
 
     PlateView(const Url& url)
       : m_platefile( new PlateFile(url) ),
+        m_platefile_id(m_platefile->index_header().platefile_id()),
         m_current_level(m_platefile->num_levels()-1),
         m_transaction_id(-1)
     { }
 
     PlateView(boost::shared_ptr<PlateFile> plate)
       : m_platefile( plate ),
+        m_platefile_id(m_platefile->index_header().platefile_id()),
         m_current_level(m_platefile->num_levels()-1),
         m_transaction_id(-1)
     { }
@@ -65,6 +77,9 @@ namespace platefile {
 
     int num_levels() const { return m_platefile->num_levels(); }
 
+    /// Drops every tile the PlateViews of this pixel type have cached.
+    static void clear_tile_cache() { tile_cache_t::instance().clear(); }
+
     std::list<TileHeader>
     search_for_tiles( BBox2i image_bbox ) const {
       const float tile_size = m_platefile->default_tile_size();
@@ -97,11 +112,18 @@ namespace platefile {
       // Create an image of the appropriate size to rasterize tiles into.
       ImageView<pixel_type> level_image(bbox.width(),bbox.height());
 
-      // Access the tiles needed for this level and copy them into place
-      BOOST_FOREACH( TileHeader const& theader, tileheaders ) {
-        ImageView<PixelT> tile;
-        m_platefile->read( tile, theader.col(), theader.row(), theader.level(),
-                           theader.transaction_id(), true );
+      // Read ahead: fetch every tile the region needs at once.
+      std::vector<TileHeader> hdrs(tileheaders.begin(), tileheaders.end());
+      std::vector<typename tile_cache_t::handle_t> tiles =
+        tile_cache_t::instance().get( m_platefile, m_platefile_id, hdrs );
+
+      // Copy the tiles into place
+      for ( size_t i = 0; i < hdrs.size(); ++i ) {
+        // The datastore skips tiles it can't read
+        if ( !tiles[i].attached() )
+          continue;
+        const TileHeader& theader = hdrs[i];
+        boost::shared_ptr<ImageView<PixelT> > tile = tiles[i];
 
         BBox2i src_bbox_cropped( tile_size*theader.col(), tile_size*theader.row(),
                                     tile_size, tile_size );
@@ -117,7 +139,7 @@ namespace platefile {
         dst_bbox_cropped.max() -= bbox.min();
 
         crop( level_image, dst_bbox_cropped ) =
-          crop( tile, src_bbox_cropped );
+          crop( *tile, src_bbox_cropped );
       }
 
       return crop( level_image,
@@ -263,3 +263,27 @@ void RpcClientBase::set_retries(uint32 t) {
   VW_ASSERT(m_chan, LogicErr() << "Cannot set retries before constructing channel");
   m_chan->set_retries(t);
 }
+
+void RpcClientBase::set_async(bool on) {
+  m_chan->set_async(on);
+}
+
+bool RpcClientBase::async() const {
+  return m_chan->async();
+}
+
+void RpcClientBase::set_max_outstanding(uint32 n) {
+  m_chan->set_max_outstanding(n);
+}
+
+size_t RpcClientBase::outstanding() const {
+  return m_chan->outstanding();
+}
+
+bool RpcClientBase::complete_one() {
+  return m_chan->complete_one();
+}
+
+void RpcClientBase::complete_all() {
+  m_chan->complete_all();
+}
@@ -110,6 +110,26 @@ namespace platefile {
       // -1 means "never", other values in ms
       void set_timeout(int32 t);
       void set_retries(uint32 t);
+
+      // Asynchronous calls (see IChannel). While async is on, each call
+      // through the stub sends its request and returns; its response is
+      // filled in and its done closure run by complete_one() or
+      // complete_all(), so the response must outlive the call.
+      void set_async(bool on);
+      bool async() const;
+      void set_max_outstanding(uint32 n);
+      size_t outstanding() const;
+      bool complete_one();
+      void complete_all();
+
+      // Turns async on for its lifetime.
+      class AsyncScope : private boost::noncopyable {
+          RpcClientBase& m_client;
+          bool m_was_async;
+        public:
+          AsyncScope(RpcClientBase& client) : m_client(client), m_was_async(client.async()) { m_client.set_async(true); }
+          ~AsyncScope() { m_client.set_async(m_was_async); }
+      };
   };
 
   template <typename ServiceT>
@@ -18,16 +18,34 @@
 #endif
 
 #include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Plate/FundamentalTypes.h>
+#include <vw/Plate/Rpc.pb.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/PerfCounters.h>
 #include <google/protobuf/descriptor.h>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/foreach.hpp>
+#include <limits>
 
 namespace pb = ::google::protobuf;
 
 namespace vw {
 namespace platefile {
 
+namespace {
+  PerfCounter& rpc_calls() {
+    static PerfCounter& calls = vw_perf_counters().counter("rpc.calls");
+    return calls;
+  }
+  PerfHistogram& rpc_call_time() {
+    static PerfHistogram& time = vw_perf_counters().histogram("rpc.call_us");
+    return time;
+  }
+}
+
 std::string unique_name(const std::string& identifier, const std::string& join) {
   // Start by generating a unique name based on our hostname, PID, and thread ID.
   char hostname[255];
@@ -48,12 +66,19 @@ void IChannel::send_message(RpcWrapper& message) {
   boost::scoped_array<uint8> bytes(new uint8[len]);
   message.SerializeToArray(bytes.get(), boost::numeric_cast<int>(len));
   send_bytes(bytes.get(), len);
+
+  static PerfCounter& sent = vw_perf_counters().counter("rpc.bytes_sent");
+  sent.add(len);
 }
 
 int32 IChannel::recv_message(RpcWrapper& message) {
   std::vector<uint8> bytes;
   if (!recv_bytes(&bytes))
     return 0;
+
+  static PerfCounter& received = vw_perf_counters().counter("rpc.bytes_received");
+  received.add(bytes.size());
+
   if (!message.ParseFromArray(&bytes[0], boost::numeric_cast<int>(bytes.size())))
     return -1;
   if (this->checksum(message) != message.checksum())
@@ -61,6 +86,103 @@ int32 IChannel::recv_message(RpcWrapper& message) {
   return 1;
 }
 
+IChannel::~IChannel() {
+  // Nobody is left to see the replies.  The closures haven't run, so
+  // they're still ours to delete.
+  BOOST_FOREACH(const async_map_t::value_type& c, m_outstanding)
+    delete c.second.done;
+}
+
+int32 IChannel::next_seq() {
+  // Wrap before going negative; -1 means "no sequence number"
+  if (m_seq == std::numeric_limits<int32>::max())
+    m_seq = 0;
+  return ++m_seq;
+}
+
+void IChannel::CallMethod(const pb::MethodDescriptor* method,
+                          pb::RpcController* controller,
+                          const pb::Message* request,
+                          pb::Message* response,
+                          pb::Closure* done)
+{
+  if (m_async) {
+    call_async(method, request, response, done);
+    return;
+  }
+  // A synchronous call would otherwise receive the replies to the
+  // outstanding ones.
+  complete_all();
+  rpc_calls().add();
+  PerfTimer timer(rpc_call_time());
+  call_sync(method, controller, request, response, done);
+}
+
+void IChannel::call_async(const pb::MethodDescriptor* method,
+                          const pb::Message* request,
+                          pb::Message* response,
+                          pb::Closure* done)
+{
+  while (m_outstanding.size() >= m_max_outstanding)
+    complete_one();
+
+  RpcWrapper q_wrap;
+  q_wrap.set_method(method->name());
+  q_wrap.set_payload(request->SerializeAsString());
+  q_wrap.set_requestor(this->name());
+  q_wrap.set_seq(next_seq());
+
+  send_message(q_wrap);
+
+  AsyncCall& call = m_outstanding[q_wrap.seq()];
+  call.method   = method->name();
+  call.response = response;
+  call.done     = done;
+  call.start    = Stopwatch::microtime();
+  rpc_calls().add();
+}
+
+bool IChannel::complete_one() {
+  while (!m_outstanding.empty()) {
+    RpcWrapper a_wrap;
+    switch (recv_message(a_wrap)) {
+      case 0:
+        vw_throw(NetworkErr() << "Timed out waiting for one of " << m_outstanding.size() << " outstanding calls.");
+      case -1:
+        vw_out(WarningMessage) << "complete_one(): corrupted message. " << std::endl;
+        continue;
+      default:
+        break;
+    }
+
+    async_map_t::iterator i = m_outstanding.find(a_wrap.seq());
+    if (i == m_outstanding.end() || i->second.method != a_wrap.method()) {
+      // Probably the reply to a call that timed out earlier.
+      vw_out(WarningMessage) << "Dropping unexpected reply on \"" << this->name() << "\" (seq " << a_wrap.seq() << ")" << std::endl;
+      continue;
+    }
+
+    AsyncCall call = i->second;
+    m_outstanding.erase(i);
+    rpc_call_time().record(Stopwatch::microtime() - call.start);
+
+    detail::RequireCall require(call.done);
+    throw_rpc_error(a_wrap.error());
+    call.response->ParseFromString(a_wrap.payload());
+    return true;
+  }
+  return false;
+}
+
+void IChannel::complete_all() {
+  while (complete_one());
+}
+
+void IChannel::set_max_outstanding(uint32 n) {
+  VW_ASSERT(n > 0, ArgumentErr() << "At least one call must be allowed to be outstanding");
+  m_max_outstanding = n;
+}
+
 IChannel* IChannel::make(const std::string& scheme, const std::string& clientname) {
 
 #if defined(VW_HAVE_PKG_RABBITMQ_C) && VW_HAVE_PKG_RABBITMQ_C==1
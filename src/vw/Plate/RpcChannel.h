@@ -11,6 +11,7 @@
 #include <vw/Core/FundamentalTypes.h>
 #include <google/protobuf/service.h>
 #include <vector>
+#include <map>
 
 namespace vw {
 namespace platefile {
@@ -26,6 +27,35 @@ std::string unique_name(const std::string& identifier, const std::string& join =
 // IChannel has thread affinity, and must not be called from any thread other
 // than the constructing one
 class IChannel : public ::google::protobuf::RpcChannel {
+    struct AsyncCall {
+      std::string method;
+      google::protobuf::Message* response;
+      google::protobuf::Closure* done;
+      uint64 start;
+    };
+    typedef std::map<int32, AsyncCall> async_map_t;
+    async_map_t m_outstanding;
+    bool m_async;
+    uint32 m_max_outstanding;
+    int32 m_seq;
+
+    void call_async(const google::protobuf::MethodDescriptor* method,
+                    const google::protobuf::Message* request,
+                    google::protobuf::Message* response,
+                    google::protobuf::Closure* done);
+
+  protected:
+    // A sequence number for a new request.  Replies carry the number of the
+    // request they answer.
+    int32 next_seq();
+
+    // Makes one call and waits for its reply.
+    virtual void call_sync(const google::protobuf::MethodDescriptor*,
+                           google::protobuf::RpcController*,
+                           const google::protobuf::Message*,
+                           google::protobuf::Message*,
+                           google::protobuf::Closure*) = 0;
+
   public:
     virtual void send_bytes(const uint8* message, size_t len) = 0;
     virtual bool recv_bytes(std::vector<uint8>* bytes) VW_WARN_UNUSED = 0;
@@ -38,11 +68,32 @@ class IChannel : public ::google::protobuf::RpcChannel {
     // Calculate checksum.
     static uint32 checksum(const RpcWrapper& message);
 
-    virtual void CallMethod(const google::protobuf::MethodDescriptor*,
-                            google::protobuf::RpcController*,
-                            const google::protobuf::Message*,
-                            google::protobuf::Message*,
-                            google::protobuf::Closure*) = 0;
+    // Synchronous calls wait for their reply before returning.  Asynchronous
+    // calls send the request and return at once; the response is filled in
+    // and done is run when complete_one() or complete_all() receives the
+    // reply.  A synchronous call first completes any outstanding ones.
+    void CallMethod(const google::protobuf::MethodDescriptor*,
+                    google::protobuf::RpcController*,
+                    const google::protobuf::Message*,
+                    google::protobuf::Message*,
+                    google::protobuf::Closure*);
+
+    // While async is on, calls through CallMethod are asynchronous.  At most
+    // max_outstanding() of them wait for replies at once; a call beyond that
+    // first completes the oldest.
+    void set_async(bool on) { m_async = on; }
+    bool async() const { return m_async; }
+    void set_max_outstanding(uint32 n);
+    uint32 max_outstanding() const { return m_max_outstanding; }
+    size_t outstanding() const { return m_outstanding.size(); }
+
+    // Receives one reply and completes its call.  Returns false if no calls
+    // are outstanding.  A reply carrying an error is thrown from here, after
+    // its call is removed (and its done run); a timeout throws NetworkErr
+    // and leaves the calls outstanding.
+    bool complete_one();
+    // Completes every outstanding call.
+    void complete_all();
 
     // -1 means "never timeout", other values in ms
     virtual void set_timeout(int32 val) = 0;
@@ -54,12 +105,13 @@ class IChannel : public ::google::protobuf::RpcChannel {
     // Defaults for all channels, if none is provided
     static const int32  DEFAULT_TIMEOUT = 10000; // ms
     static const uint32 DEFAULT_RETRIES = 10;
+    static const uint32 DEFAULT_MAX_OUTSTANDING = 32;
 
     //virtual uint64 queue_depth() const = 0;
     virtual std::string name() const = 0;
 
-    IChannel() {}
-    virtual ~IChannel() {}
+    IChannel() : m_async(false), m_max_outstanding(DEFAULT_MAX_OUTSTANDING), m_seq(0) {}
+    virtual ~IChannel();
 
     // Factories
     static IChannel* make(const std::string& scheme, const std::string& clientname);
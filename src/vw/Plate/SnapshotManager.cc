@@ -27,13 +27,6 @@ namespace {
   template <typename PixelT>
   struct tile_cache_t : public std::map<d::rowcoltid_t, ImageView<PixelT> > {};
 
-  template <typename PixelT>
-  void parse_image_and_store(const Tile& t, tile_cache_t<PixelT>& tile_cache) {
-    ImageView<PixelT>& image = tile_cache[d::rowcoltid_t(t.hdr.row(), t.hdr.col(), t.hdr.transaction_id())];
-    boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
-    read_image(image, *r);
-  }
-
   template <typename PixelT>
   void mosaic_in_tid_order(ImageView<PixelT>& out, const size_t size, const tile_cache_t<PixelT>& tile_cache, std::vector<TileHeader>& tiles) {
     typedef ImageView<PixelT> image_t;
@@ -64,6 +57,54 @@ namespace {
         return;
     }
   }
+
+  // One location to snapshot, and (once built) its encoding.
+  struct CompositeTile {
+    d::rowcol_t location;
+    std::vector<TileHeader>* tiles;
+    std::string type;         // empty if there was nothing to write
+    std::vector<uint8> data;
+  };
+
+  template <typename PixelT>
+  class BuildComposites {
+      std::vector<CompositeTile>& m_jobs;
+      const tile_cache_t<PixelT>& m_tile_cache;
+      uint32 m_tile_size;
+      std::string m_filetype;
+    public:
+      BuildComposites(std::vector<CompositeTile>& jobs, const tile_cache_t<PixelT>& tile_cache,
+                      uint32 tile_size, const std::string& filetype)
+        : m_jobs(jobs), m_tile_cache(tile_cache), m_tile_size(tile_size), m_filetype(filetype) {}
+
+      void operator()(size_t begin, size_t end) const {
+        for (size_t k = begin; k < end; ++k) {
+          CompositeTile& c = m_jobs[k];
+          std::vector<TileHeader>& tiles = *c.tiles;
+
+          // Early exit condition if there is only one tile
+          if (tiles.size() == 1) {
+            typename tile_cache_t<PixelT>::const_iterator i =
+              m_tile_cache.find(d::rowcoltid_t(d::therow(tiles[0]), d::thecol(tiles[0]), d::thetid(tiles[0])));
+            if ( i == m_tile_cache.end() ) {
+              vw_out(WarningMessage, "platefile.snapshot") << "Failed to load image for " << tiles[0] << std::endl;
+              continue;
+            }
+            c.type = PlateFile::encode_tile(i->second, m_filetype, c.data);
+            continue;
+          }
+
+          // Perform an actual composite if there are multiple tiles to be inserted
+          ImageView<PixelT> tile;
+          mosaic_in_tid_order<PixelT>(tile, m_tile_size, m_tile_cache, tiles);
+          if (!tile) {
+            vw_out(WarningMessage, "platefile.snapshot") << "Empty tile list, skipping writing tile row=" << d::therow(c.location) << " col=" << d::thecol(c.location) << std::endl;
+            continue;
+          }
+          c.type = PlateFile::encode_tile(tile, m_filetype, c.data);
+        }
+      }
+  };
 }
 
 namespace vw {
@@ -81,6 +122,8 @@ void SnapshotManager<PixelT>::snapshot(uint32 level, BBox2i const& tile_region,
   if ( CACHE_TILES < 100 )
     vw_out(WarningMessage) << "You will lose a lot speed to thrashing if you can't cache at least 100 tiles (you can only store " << CACHE_TILES << ")\n";
 
+  d::BatchWrites batch(*m_write_plate, d::tile_chunk_size());
+
   // Divide up the region into moderately-sized chunks
   std::list<BBox2i> regions = bbox_tiles(tile_region, 1024, 1024);
   BOOST_FOREACH(const BBox2i& region, regions) {
@@ -124,46 +167,50 @@ void SnapshotManager<PixelT>::snapshot(uint32 level, BBox2i const& tile_region,
       Datastore::TileSearch tile_lookup;
       tile_cache_t<PixelT> tile_cache;
 
-      BOOST_FOREACH(const composite_map_t::value_type& t, composite_batch) {
-        //std::cerr << "Batching tiles for " << t.first << ": ";
-        //std::transform(t.second.begin(), t.second.end(), std::ostream_iterator<uint32>(std::cerr, ", "), boost::bind(&TileHeader::transaction_id, _1));
-        //std::cerr << " (currently have " << tile_lookup.size() << "/" << CACHE_TILES << ")" << std::endl;
+      BOOST_FOREACH(const composite_map_t::value_type& t, composite_batch)
         std::copy(t.second.begin(), t.second.end(), std::back_inserter(tile_lookup));
-      }
 
-      BOOST_FOREACH(const Tile& t, m_read_plate->batch_read(tile_lookup))
-        parse_image_and_store(t, tile_cache);
+      // batch_read() reads the tiles blob by blob; they are decoded in parallel.
+      {
+        const Datastore::TileSearch& tiles = m_read_plate->batch_read(tile_lookup);
+        std::vector<ImageView<PixelT>*> images;
+        images.reserve(tiles.size());
+        BOOST_FOREACH(const Tile& t, tiles)
+          images.push_back(&tile_cache[d::rowcoltid_t(t.hdr.row(), t.hdr.col(), t.hdr.transaction_id())]);
+        d::parallel_ranges(tiles.size(), d::DecodeTiles<PixelT>(tiles, images));
+      }
       tile_lookup.clear();
 
-      BOOST_FOREACH(composite_map_t::value_type& t, composite_batch) {
-
-        // Early exit condition if there is only one tile
-        if (t.second.size() == 1 ) {
-          typename tile_cache_t<PixelT>::const_iterator i =
-            tile_cache.find(d::rowcoltid_t(d::therow(t.second[0]), d::thecol(t.second[0]), d::thetid(t.second[0])));
-          if ( i == tile_cache.end() ) {
-            vw_out(WarningMessage, "platefile.snapshot") << "Failed to load image for " << t.second[0] << std::endl;
-            continue;
-          }
-          m_write_plate->write_update(i->second, d::thecol(t.first), d::therow(t.first), level);
-          continue;
+      // Composite and encode a chunk of locations at a time in parallel,
+      // then write them here; the PlateFile is not thread-safe.
+      const size_t CHUNK = d::tile_chunk_size();
+      std::vector<CompositeTile> jobs;
+      jobs.reserve(std::min(CHUNK, composite_batch.size()));
+
+      composite_map_t::iterator j = composite_batch.begin(), batch_end = composite_batch.end();
+      while (j != batch_end) {
+        jobs.clear();
+        for (; j != batch_end && jobs.size() < CHUNK; ++j) {
+          jobs.push_back(CompositeTile());
+          jobs.back().location = j->first;
+          jobs.back().tiles = &j->second;
         }
 
-        // Perform an actual composite if there are multiple tiles to be inserted
-        ImageView<PixelT> tile;
-        mosaic_in_tid_order<PixelT>(tile, m_write_plate->default_tile_size(), tile_cache, t.second);
-        if (!tile) {
-          vw_out(WarningMessage, "platefile.snapshot") << "Empty tile list, skipping writing tile row=" << d::therow(t.first) << " col=" << d::thecol(t.first) << std::endl;
-          continue;
+        d::parallel_ranges(jobs.size(), BuildComposites<PixelT>(jobs, tile_cache, m_write_plate->default_tile_size(),
+                                                                m_write_plate->default_file_type()));
+
+        BOOST_FOREACH(const CompositeTile& c, jobs) {
+          if (!c.type.empty())
+            m_write_plate->write_update(&c.data[0], c.data.size(), d::thecol(c.location), d::therow(c.location), level, c.type);
+          pc.tick();
         }
-        m_write_plate->write_update(tile, d::thecol(t.first), d::therow(t.first), level);
-        pc.tick();
       }
       composite_batch.clear();
       size = 0;
     } while (i != end);
     region_pc.report_finished();
   }
+  m_write_plate->flush_writes();
   progress.report_finished();
 }
 
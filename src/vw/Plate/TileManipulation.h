@@ -14,6 +14,8 @@
 #include <vw/Image/Interpolation.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Filter.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/BoxReduce.h>
 #include <vw/Math/BBox.h>
 #include <list>
 
@@ -34,22 +36,22 @@ namespace platefile {
     VW_ASSERT(!LL || (LL.cols() == int32(tile_size) && LL.rows() == int32(tile_size)), LogicErr() << "Tiles must be the same size as tile_size");
     VW_ASSERT(!LR || (LR.cols() == int32(tile_size) && LR.rows() == int32(tile_size)), LogicErr() << "Tiles must be the same size as tile_size");
     VW_ASSERT(UL || UR || LL || LR, LogicErr() << "Must compose at least one tile");
-
-    ImageView<PixelT> super(2*tile_size, 2*tile_size);
-
-    if (UL) crop(super, 0,         0,         tile_size, tile_size) = UL;
-    if (UR) crop(super, tile_size, 0,         tile_size, tile_size) = UR;
-    if (LL) crop(super, 0,         tile_size, tile_size, tile_size) = LL;
-    if (LR) crop(super, tile_size, tile_size, tile_size, tile_size) = LR;
-
-    // We subsample after blurring with a standard 2x2 box filter.
-    std::vector<float> kernel(2);
-    kernel[0] = kernel[1] = 0.5;
-
-    if (blur)
-      dest = subsample( separable_convolution_filter( super, kernel, kernel, 1, 1, ConstantEdgeExtension() ), 2);
-    else
-      dest = subsample( super, 2 );
+    VW_ASSERT(tile_size % 2 == 0, LogicErr() << "Tile size must be even");
+
+    // Each child reduces straight into its quarter of dest, with a
+    // 2x2 box filter or by keeping every other pixel.
+    const int32 half = tile_size/2;
+    dest.set_size(tile_size, tile_size);
+    const ImageView<PixelT>* children[4] = { &UL, &UR, &LL, &LR };
+    for (int32 i = 0; i < 4; ++i) {
+      int32 x = (i%2) * half, y = (i/2) * half;
+      if (!*children[i])
+        fill(crop(dest, x, y, half, half), PixelT());
+      else if (blur)
+        box_reduce(*children[i], dest, x, y);
+      else
+        crop(dest, x, y, half, half) = subsample(*children[i], 2);
+    }
   }
 
   // Resample image by reaching up a few levels and using the data there.
@@ -13,6 +13,7 @@ using namespace vw::platefile;
 
 #include <boost/program_options.hpp>
 #include <boost/foreach.hpp>
+#include <fstream>
 namespace po = boost::program_options;
 
 int main( int argc, char *argv[] ) {
@@ -70,15 +71,18 @@ int main( int argc, char *argv[] ) {
 
   std::cout << "Started!\n";
 
-  BOOST_FOREACH(const BlobTileRecord& rec, blob) {
-    if (transaction_id >= 0 && rec.hdr.transaction_id() != transaction_id)
+  BOOST_FOREACH(uint64 offset, blob.record_offsets()) {
+    TileHeader hdr = blob.read_header(offset);
+    if (transaction_id >= 0 && hdr.transaction_id() != transaction_id)
       continue;
     std::ostringstream ostr;
-    ostr << blob_prefix << "_" << rec.hdr.level() << "_" << rec.hdr.row() << "_" << rec.hdr.col() << "." << rec.hdr.filetype();
+    ostr << blob_prefix << "_" << hdr.level() << "_" << hdr.row() << "_" << hdr.col() << "." << hdr.filetype();
 
+    TileData data = blob.read_data(offset);
     std::ofstream ofile(ostr.str().c_str(), std::ios::binary);
     VW_ASSERT(ofile.is_open(), IOErr() << "could not open dst file for writing (" << ostr.str() << ")");
-    ofile.write(reinterpret_cast<char*>(&rec.data->operator[](0)), rec.data->size());
+    if (!data->empty())
+      ofile.write(reinterpret_cast<char*>(&data->operator[](0)), data->size());
     VW_ASSERT(!ofile.fail(), IOErr() << ": failed to write to " << ostr.str());
     ofile.close();
   }
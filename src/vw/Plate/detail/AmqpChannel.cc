@@ -247,11 +247,11 @@ bool AmqpChannel::recv_bytes(std::vector<uint8>* bytes) {
   return true;
 }
 
-void AmqpChannel::CallMethod(const pb::MethodDescriptor* method,
-                             pb::RpcController* /*controller*/,
-                             const pb::Message* request,
-                             pb::Message* response,
-                             pb::Closure* done)
+void AmqpChannel::call_sync(const pb::MethodDescriptor* method,
+                            pb::RpcController* /*controller*/,
+                            const pb::Message* request,
+                            pb::Message* response,
+                            pb::Closure* done)
 {
   detail::RequireCall call(done);
   RpcWrapper q_wrap, a_wrap;
@@ -263,7 +263,7 @@ void AmqpChannel::CallMethod(const pb::MethodDescriptor* method,
   for (uint32 trial = 0; trial <= m_retries; ++trial) {
     if (trial > 0)
       vw_out(WarningMessage) << "Retry (" << trial << "/" << m_retries << ")" << std::endl;
-    q_wrap.set_seq(++m_seq);
+    q_wrap.set_seq(next_seq());
 
     send_message(q_wrap);
 
@@ -277,7 +277,7 @@ CallMethod_receive_again:
         continue;
       default:
         if (a_wrap.seq() != q_wrap.seq()) {
-          vw_out(WarningMessage) << "Sequence mismatch on \"" << this->name() << "\" (expected " << m_seq << ", got " << a_wrap.seq() << ") ";
+          vw_out(WarningMessage) << "Sequence mismatch on \"" << this->name() << "\" (expected " << q_wrap.seq() << ", got " << a_wrap.seq() << ") ";
           // If we get a seq less than we were expecting, one of the messages
           // we timed out waiting for finally arrived. Drop it on the floor and
           // wait again rather than retrying completely.
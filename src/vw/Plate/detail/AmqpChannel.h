@@ -55,7 +55,6 @@ namespace platefile {
       std::string m_local_name;
       std::string m_remote_name;
       int32 m_timeout;
-      uint32 m_seq;
       uint32 m_retries;
     protected:
       void locked_check_error(const amqp_rpc_reply_t& x, const std::string& context);
@@ -72,9 +71,15 @@ namespace platefile {
       void send_bytes(const uint8* message, size_t len);
       bool recv_bytes(std::vector<uint8>* bytes);
 
+      virtual void call_sync(const google::protobuf::MethodDescriptor*,
+                             google::protobuf::RpcController*,
+                             const google::protobuf::Message*,
+                             google::protobuf::Message*,
+                             google::protobuf::Closure*);
+
     public:
       AmqpChannel(const std::string& human_name)
-        : m_human_name(human_name), m_timeout(DEFAULT_TIMEOUT), m_seq(0), m_retries(DEFAULT_RETRIES) {}
+        : m_human_name(human_name), m_timeout(DEFAULT_TIMEOUT), m_retries(DEFAULT_RETRIES) {}
       virtual ~AmqpChannel() VW_NOTHROW;
 
       int32  timeout() const;
@@ -86,12 +91,6 @@ namespace platefile {
       //uint64 queue_depth() const;
       std::string name() const;
 
-      virtual void CallMethod(const google::protobuf::MethodDescriptor*,
-                              google::protobuf::RpcController*,
-                              const google::protobuf::Message*,
-                              google::protobuf::Message*,
-                              google::protobuf::Closure*);
-
       // url format:
       // amqp://${rabbit_ip}:${port}/${exchange}
       // or
@@ -276,6 +276,37 @@ void Blobstore::write_update(WriteState& state_, uint32 level, uint32 row, uint3
   m_index->write_update(header, write_record);
 }
 
+// The tiles all go into the blob first, and then their index records go to
+// the index in one batch.
+void Blobstore::write_updates(WriteState& state_, const TileSearch& tiles) {
+  BlobWriteState* state = dynamic_cast<BlobWriteState*>(&state_);
+  VW_ASSERT(state, LogicErr() << "Cannot pass write states between different implementations!");
+
+  Index::WriteUpdates updates;
+  updates.reserve(tiles.size());
+  BOOST_FOREACH(const Tile& t, tiles) {
+    if (t.hdr.filetype() == "auto")
+      vw_throw(NoImplErr() << "write_update() does not support filetype 'auto'");
+
+    TileHeader header;
+    header.set_level(t.hdr.level());
+    header.set_row(t.hdr.row());
+    header.set_col(t.hdr.col());
+    header.set_transaction_id(state->transaction);
+    header.set_filetype(t.hdr.filetype());
+
+    uint64 blob_offset = state->blob->write(header, t.data->empty() ? 0 : &t.data->operator[](0), t.data->size(), t.variants);
+
+    IndexRecord write_record;
+    write_record.set_blob_id(state->blob_id);
+    write_record.set_blob_offset(blob_offset);
+    write_record.set_filetype(header.filetype());
+    updates.push_back(std::make_pair(header, write_record));
+  }
+
+  m_index->write_updates(updates);
+}
+
 void Blobstore::write_complete(WriteState& state_) {
   BlobWriteState* state = dynamic_cast<BlobWriteState*>(&state_);
   VW_ASSERT(state, LogicErr() << "Cannot pass write states between different implementations!");
@@ -296,7 +327,7 @@ void Blobstore::write_complete(WriteState& state_) {
   vw_out(DebugMessage, "blob") << "Closed blob " << state->blob_id << " ( size = " << new_blob_size << " )\n";
 
   // Release the blob lock.
-  m_index->write_complete(state->blob_id);
+  m_index->write_complete(state->blob_id, new_blob_size);
 
   // Release cache
   m_write_cache.erase(state->blob_id);
@@ -63,6 +63,7 @@ class Blobstore : public Datastore {
 
     virtual WriteState* write_request(const Transaction& id);
     virtual void write_update(WriteState& state, uint32 level, uint32 row, uint32 col, const std::string& filetype, const uint8* data, uint64 size);
+    virtual void write_updates(WriteState& state, const TileSearch& tiles);
     virtual void write_complete(WriteState& id);
     virtual void flush();
 
@@ -1,6 +1,5 @@
 #include <vw/Plate/detail/Dirstore.h>
 #include <vw/Plate/Exception.h>
-#include <vw/FileIO/TemporaryFile.h>
 #include <vw/Plate/detail/Seed.h>
 #include <boost/foreach.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -10,7 +9,10 @@
 
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <dirent.h>
+#include <errno.h>
+#include <cstring>
 #include <limits.h>
 #include <stddef.h>
 #include <unistd.h>
@@ -41,6 +43,19 @@ namespace {
       uint32(col / BUCKET_SIZE);
   }
 
+  // splitmix64's finalizer, to spread the buckets over the shards.
+  uint64 mix(uint64 x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  const uint32 NUM_SHARDS = 256;
+  uint32 calc_shard(uint32 level, uint64 bucket) {
+    return uint32(mix((uint64(level) << 40) ^ bucket) % NUM_SHARDS);
+  }
+
   void noop() {}
   void cleanup(const fs::path& path) {
     fs::remove(path);
@@ -73,6 +88,10 @@ namespace {
     return hdr;
   }
 
+  bool TidLess(const std::pair<uint32, std::string>& a, uint32 b) {
+    return a.first < b;
+  }
+
   bool HasData(const Tile& t) {
     return t.data;
   }
@@ -81,6 +100,7 @@ namespace {
 # define FMT_LEVEL  "%03u"
 # define FMT_ROWCOL "%08u"
 # define FMT_BUCKET "%07u"
+# define FMT_SHARD  "%02x"
 
   std::string format_tid(const Transaction& id) {
     static const boost::format fmt_(FMT_TID);
@@ -144,6 +164,10 @@ namespace {
   BUCKET_SIZE = 32 (32x32 slot buckets)
   bucket = int(row / BUCKET_SIZE) * BUCKET_SIZE + int(col / BUCKET_SIZE)
 
+  Plates from version 1 on put a shard between the level and the bucket:
+  shard = mix(level, bucket) % 256, so the deep levels are spread over 256
+  directories.  Below, <bucket> means <shard>/<bucket> for those.
+
   4 possible cases
     1) Single-ID, Single-Location
       -> map(/by-tid/tid/level/bucket/row/col/+) reduce()
@@ -154,61 +178,77 @@ namespace {
     4) Multiple-ID, Multiple-Loc
       -> map(/by-loc/level/bucket/+) reduce(match-ids)
 
+  The by-loc listing of each location is cached in memory, keyed on the
+  location directory's mtime.
+
 Tile add procedure
   tid_dir = /by-tid/<tid>/<level>/<bucket>/<row>/<col>/
   loc_dir = /by-loc/<level>/<bucket>/<row>/<col>/<tid>/
-  bak_dir   = /tmpdir/XXXXXX
+  tmp     = /tmp/<pid>.<seq> (unique to the writer)
 
-  open,write,close bak_dir/new
+  open,write,close $tmp; hardlink($tmp, $tmp.loc)
 
   mkdir $tid_dir, ignore EEXIST
   mkdir $loc_dir, ignore EEXIST
 
-  boost::file_lock(tid_dir/lock)
+  lock(location mutex); lock(tid_dir/lock) once per process
 
   old_filetype = get_filetype($tid_dir)
 
-  rename $tid_dir/old_filetype -> $bak_dir/tid [sentinel: reverse rename]
-  rename $loc_dir/old_filetype -> $bak_dir/loc [sentinel: reverse rename]
+  if old_filetype and old_filetype != new_filetype:
+    rm $loc_dir/old_filetype                  [sentinel: relink]
+    rename $tid_dir/old_filetype -> $tmp.old  [sentinel: reverse rename]
+
+  rename($tmp, $tid_dir/$new_filetype);     [sentinel: rm $tid_dir/$new_filetype]
+  rename($tmp.loc, $loc_dir/$new_filetype); [sentinel: rm $loc_dir/$new_filetype]
 
-  hardlink($bak_dir/new, $tid_dir/$new_filetype); [sentinel: rm $tid_dir/$new_filetype]
-  hardlink($bak_dir/new, $loc_dir/$new_filetype); [sentinel: rm $loc_dir/$new_filetype]
+  (rename replaces a tile of the same filetype atomically, so readers see
+   the old tile or the new one, and there's nothing to roll back.)
 
   disarm_sentinels
 
-  ~file_lock()
-  rm -rf bak_dir
+  unlock
+  rm $tmp $tmp.loc $tmp.old
 #endif
 
 namespace vw { namespace platefile { namespace detail {
 
 
+std::string Dirstore::bucket_dir(uint32 level, uint64 bucket) const {
+  static const boost::format fmt_(FMT_LEVEL "/" FMT_BUCKET);
+  static const boost::format sharded_fmt_(FMT_LEVEL "/" FMT_SHARD "/" FMT_BUCKET);
+  if (m_sharded) {
+    boost::format fmt(sharded_fmt_);
+    return boost::str(fmt % level % calc_shard(level, bucket) % bucket);
+  }
+  boost::format fmt(fmt_);
+  return boost::str(fmt % level % bucket);
+}
+
 std::string Dirstore::path_by_tid(const platefile::Transaction& id, uint32 level, uint32 row, uint32 col, const std::string& filetype) const {
   // path, tid, level, bucket, row, col, filetype
-  static const boost::format fmt_("%s/by-tid/" FMT_TID "/" FMT_LEVEL "/" FMT_BUCKET "/" FMT_ROWCOL "/" FMT_ROWCOL "/%s");
+  static const boost::format fmt_("%s/by-tid/" FMT_TID "/%s/" FMT_ROWCOL "/" FMT_ROWCOL "/%s");
   boost::format fmt(fmt_);
-  return boost::str(fmt % m_plate_path % id % level % calc_bucket(row, col) % row % col % filetype);
+  return boost::str(fmt % m_plate_path % id % bucket_dir(level, calc_bucket(row, col)) % row % col % filetype);
 }
 
 std::string Dirstore::path_by_loc(const platefile::Transaction& id, uint32 level, uint32 row, uint32 col, const std::string& filetype) const {
   // path, level, bucket, row, col, tid, filetype
-  static const boost::format fmt_("%s/by-loc/" FMT_LEVEL "/" FMT_BUCKET "/" FMT_ROWCOL "/" FMT_ROWCOL "/" FMT_TID "/%s");
+  static const boost::format fmt_("%s/by-loc/%s/" FMT_ROWCOL "/" FMT_ROWCOL "/" FMT_TID "/%s");
   boost::format fmt(fmt_);
-  return boost::str(fmt % m_plate_path % level % calc_bucket(row, col) % row % col % id % filetype);
+  return boost::str(fmt % m_plate_path % bucket_dir(level, calc_bucket(row, col)) % row % col % id % filetype);
 }
 
 std::string Dirstore::path_by_loc_no_tid(uint32 level, uint32 row, uint32 col) const {
   // path, level, bucket, row, col
-  static const boost::format fmt_("%s/by-loc/" FMT_LEVEL "/" FMT_BUCKET "/" FMT_ROWCOL "/" FMT_ROWCOL);
+  static const boost::format fmt_("%s/by-loc/%s/" FMT_ROWCOL "/" FMT_ROWCOL);
   boost::format fmt(fmt_);
-  return boost::str(fmt % m_plate_path % level % calc_bucket(row, col) % row % col);
+  return boost::str(fmt % m_plate_path % bucket_dir(level, calc_bucket(row, col)) % row % col);
 }
 
 std::string Dirstore::path_by_bucket(uint32 level, uint64 bucket) const {
-  // path, level, bucket, row, col
-  static const boost::format fmt_("%s/by-loc/" FMT_LEVEL "/" FMT_BUCKET);
-  boost::format fmt(fmt_);
-  return boost::str(fmt % m_plate_path % level % bucket);
+  // path, level, bucket
+  return m_plate_path + "/by-loc/" + bucket_dir(level, bucket);
 }
 
 std::string Dirstore::tid_dir(const Transaction& id) const {
@@ -221,6 +261,7 @@ std::string Dirstore::tid_dir(const Transaction& id) const {
 # undef FMT_LEVEL
 # undef FMT_ROWCOL
 # undef FMT_BUCKET
+# undef FMT_SHARD
 
 void Dirstore::save_index_file() const {
   fs::path header_path = m_plate_path + "/header";
@@ -242,17 +283,19 @@ void Dirstore::init() {
   bool worked = m_hdr.ParseFromIstream(&f);
   VW_ASSERT(worked, IOErr() << "Dirstore: Could not parse index header " << header_path);
   f.close();
+
+  m_sharded = m_hdr.version() >= 1;
 }
 
 Dirstore::Dirstore(const Url& u)
-  : m_plate_path(u.path())
+  : m_plate_path(u.path()), m_sharded(false), m_tmp_seq(0), m_cache_gen(0)
 {
   VW_ASSERT(u.scheme() == "dir", ArgumentErr() << "Dirstore must be local");
   init();
 }
 
 Dirstore::Dirstore(const Url& u, const IndexHeader& d)
-  : m_plate_path(u.path())
+  : m_plate_path(u.path()), m_sharded(false), m_tmp_seq(0), m_cache_gen(0)
 {
   VW_ASSERT(u.scheme() == "dir", ArgumentErr() << "Dirstore must be local");
 
@@ -286,7 +329,7 @@ Dirstore::Dirstore(const Url& u, const IndexHeader& d)
   m_hdr.set_platefile_id(vw::uint32(random()));
 
   // Set up the IndexHeader and write it to disk.
-  m_hdr.set_version(0);
+  m_hdr.set_version(1);                  // Version 1 shards the level directories
   m_hdr.set_transaction_read_cursor(0);  // Transaction 0 is the empty mosaic
   m_hdr.set_transaction_write_cursor(1); // Transaction 1 is the first valid transaction to write into
   m_hdr.set_num_levels(0);               // Index initially contains zero levels
@@ -296,6 +339,7 @@ Dirstore::Dirstore(const Url& u, const IndexHeader& d)
 
 Transaction Dirstore::transaction_begin(const std::string& description, TransactionOrNeg override) {
   boost::optional<Transaction> id;
+  Mutex::Lock lock(m_hdr_mutex);
   if (override == -1) {
     id = m_hdr.transaction_write_cursor();
     m_hdr.set_transaction_write_cursor(id.get() + 1);
@@ -314,6 +358,7 @@ Transaction Dirstore::transaction_begin(const std::string& description, Transact
 }
 
 void Dirstore::transaction_end(Transaction id, bool update_read_cursor) {
+   Mutex::Lock lock(m_hdr_mutex);
    if ( update_read_cursor ) {
      if (id > m_hdr.transaction_read_cursor()) {
        m_hdr.set_transaction_read_cursor(id);
@@ -351,53 +396,90 @@ struct PathCompareByLeaf {
   }
 };
 
-void Dirstore::add_one_id(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col, const Transaction& id) const {
-  std::string type(get_filetype(level, row, col, id));
-  if (!type.empty())
-    tiles.push_back(make_hdr(level, row, col, id, type));
-}
-
-void Dirstore::add_top_id(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col) const {
+// returns false if the location has no tiles
+bool Dirstore::loc_tiles(uint32 level, uint32 row, uint32 col, LocTiles& tiles) const {
   const std::string dir_name(path_by_loc_no_tid(level, row, col));
-  const std::string high = format_tid(m_hdr.transaction_read_cursor());
+  const loc_t loc(level, row, col);
+
+  // A new transaction at this location adds an entry to the directory,
+  // so its mtime tells whether the cached listing is still good.
+  struct stat st;
+  if (::stat(dir_name.c_str(), &st) != 0) {
+    VW_ASSERT(errno == ENOENT || errno == ENOTDIR,
+              IOErr() << "Dirstore: failed to stat directory " << dir_name << ": " << ::strerror(errno));
+    forget_loc(level, row, col);
+    return false;
+  }
 
-  if (!check_dir(dir_name))
-    return;
+  uint64 gen;
+  {
+    Mutex::Lock lock(m_cache_mutex);
+    gen = m_cache_gen;
+    std::map<loc_t, LocEntry>::const_iterator i = m_loc_cache.find(loc);
+    if (i != m_loc_cache.end() && i->second.mtime == st.st_mtime) {
+      tiles = i->second.tiles;
+      return !tiles.empty();
+    }
+  }
 
-  fs::path top;
+  tiles.clear();
   BOOST_FOREACH(const fs::path& p, std::make_pair(iter_t(dir_name), iter_t())) {
-    if (p > top && p <= high)
-      top = p;
+    uint32 tid = boost::lexical_cast<uint32>(p.filename());
+    std::string type = get_filetype(level, row, col, tid);
+    VW_ASSERT(!type.empty(), LogicErr() << "Dirstore: matching tile exists in " << dir_name << "but not in by-tid in " << path_by_tid(tid, level, row, col, ""));
+    tiles.push_back(std::make_pair(tid, type));
+  }
+  std::sort(tiles.begin(), tiles.end());
+
+  // mtimes only have a resolution of a second, so a listing made in the
+  // same second as a change might miss it.  Don't keep one of those, or
+  // one that raced with a write of ours.
+  if (st.st_mtime < std::time(0) - 1) {
+    Mutex::Lock lock(m_cache_mutex);
+    if (gen != m_cache_gen)
+      return !tiles.empty();
+    if (m_loc_cache.size() >= 1024*1024)
+      m_loc_cache.clear();
+    LocEntry& e = m_loc_cache[loc];
+    e.mtime = st.st_mtime;
+    e.tiles = tiles;
   }
+  return !tiles.empty();
+}
+
+void Dirstore::forget_loc(uint32 level, uint32 row, uint32 col) const {
+  Mutex::Lock lock(m_cache_mutex);
+  m_loc_cache.erase(loc_t(level, row, col));
+  ++m_cache_gen;
+}
 
-  if (top.empty())
+void Dirstore::add_one_id(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col, const Transaction& id) const {
+  LocTiles loc;
+  if (!loc_tiles(level, row, col, loc))
     return;
+  LocTiles::const_iterator i = std::lower_bound(loc.begin(), loc.end(), uint32(id), TidLess);
+  if (i != loc.end() && i->first == uint32(id))
+    tiles.push_back(make_hdr(level, row, col, id, i->second));
+}
 
-  uint32 tid = boost::lexical_cast<uint32>(top.filename());
-  std::string type = get_filetype(level, row, col, tid);
-  VW_ASSERT(!type.empty(), LogicErr() << "Dirstore: matching tile exists in " << dir_name << "but not in by-tid in " << path_by_tid(tid, level, row, col, ""));
-  tiles.push_back(make_hdr(level, row, col, tid, type));
+void Dirstore::add_top_id(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col) const {
+  LocTiles loc;
+  if (!loc_tiles(level, row, col, loc))
+    return;
+  tiles.push_back(make_hdr(level, row, col, loc.back().first, loc.back().second));
 }
 
 void Dirstore::add_ids_in_range(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col, const TransactionRange& r, uint32 limit) const {
-  const std::string dir_name(path_by_loc_no_tid(level, row, col));
-  const std::string low  = format_tid(r.first().promote());
-  const std::string high = format_tid(r.last().newest() ? Transaction::MAX_POSSIBLE() : uint32(r.last().promote()));
-
-  if (!check_dir(dir_name))
+  LocTiles loc;
+  if (!loc_tiles(level, row, col, loc))
     return;
 
-  Datastore::TileSearch new_tiles;
-  BOOST_FOREACH(const fs::path& p, std::make_pair(iter_t(dir_name), iter_t())) {
-    const std::string& tid_s = p.filename();
-    if (tid_s < low || tid_s > high)
-      continue;
-    uint32 tid = boost::lexical_cast<uint32>(tid_s);
+  const uint32 low  = r.first().promote();
+  const uint32 high = r.last().newest() ? Transaction::MAX_POSSIBLE() : uint32(r.last().promote());
 
-    std::string type = get_filetype(level, row, col, tid);
-    VW_ASSERT(!type.empty(), LogicErr() << "Dirstore: matching tile exists in " << dir_name << "but not in by-tid in " << path_by_tid(tid, level, row, col, ""));
-    new_tiles.push_back(make_hdr(level, row, col, tid, type));
-  }
+  Datastore::TileSearch new_tiles;
+  for (LocTiles::const_iterator i = std::lower_bound(loc.begin(), loc.end(), low, TidLess); i != loc.end() && i->first <= high; ++i)
+    new_tiles.push_back(make_hdr(level, row, col, i->first, i->second));
   sort_and_limit_size(new_tiles, limit);
   tiles.insert(tiles.end(), new_tiles.begin(), new_tiles.end());
 }
@@ -426,8 +508,8 @@ namespace {
 
     std::vector<uint64> buckets;
     for (; col < end_col; col += BUCKET_SIZE)
-      for (; row < end_row; row += BUCKET_SIZE)
-        buckets.push_back(calc_bucket(row, col));
+      for (uint32 r = row; r < end_row; r += BUCKET_SIZE)
+        buckets.push_back(calc_bucket(r, col));
     return buckets;
   }
 }
@@ -570,16 +652,55 @@ Datastore::TileSearch& Dirstore::populate(TileSearch& tiles) {
 }
 
 WriteState* Dirstore::write_request(const Transaction& id) {
+  fs::create_directories(m_plate_path + "/tmp");
   return new DirWriteState(id);
 }
 
 std::string Dirstore::get_lockfile(const Transaction& id) const {
   std::string lockfile = tid_dir(id) + "/lock";
   if (!fs::exists(lockfile))
-    std::ofstream f(lockfile.c_str());
+    std::ofstream f(lockfile.c_str(), std::ios::app);
   return lockfile;
 }
 
+// A file lock belongs to the whole process, so the threads of one process
+// can't each hold it (the first to let go would drop it for all of them).
+// The first writer in takes it for the process, and the last one out
+// releases it.  Writers in the same process keep out of each other's way
+// with the location locks.
+class TidLock : private boost::noncopyable {
+    Mutex m_mutex;
+    uint32 m_count;
+    ipc::file_lock m_lock;
+  public:
+    TidLock(const std::string& lockfile) : m_count(0), m_lock(lockfile.c_str()) {}
+    void enter() {
+      Mutex::Lock lock(m_mutex);
+      if (m_count == 0)
+        m_lock.lock();
+      ++m_count;
+    }
+    void leave() {
+      Mutex::Lock lock(m_mutex);
+      if (--m_count == 0)
+        m_lock.unlock();
+    }
+};
+
+boost::shared_ptr<TidLock> Dirstore::tid_lock(const Transaction& id) {
+  Mutex::Lock lock(m_tid_lock_mutex);
+  boost::shared_ptr<TidLock>& l = m_tid_locks[id];
+  if (!l)
+    l.reset(new TidLock(get_lockfile(id)));
+  return l;
+}
+
+std::string Dirstore::tmp_filename() {
+  static const boost::format fmt_("%s/tmp/%u.%u");
+  boost::format fmt(fmt_);
+  return boost::str(fmt % m_plate_path % ::getpid() % m_tmp_seq.add(1));
+}
+
 void Dirstore::write_update(WriteState& state_, uint32 level, uint32 row, uint32 col, const std::string& filetype, const uint8* data, uint64 size) {
   VW_ASSERT(filetype != "auto", ArgumentErr() << "write_update(): unsupported filetype 'auto'");
   VW_ASSERT(!filetype.empty(),  ArgumentErr() << "write_update(): unsupported empty filetype");
@@ -590,50 +711,75 @@ void Dirstore::write_update(WriteState& state_, uint32 level, uint32 row, uint32
   const fs::path tid_dir  = path_by_tid(state->id, level, row, col, "");
   const fs::path loc_dir  = path_by_loc(state->id, level, row, col, "");
 
-  TemporaryDir tmp_dir(m_plate_path + "/tmp", true, "update");
-  const std::string tmp_tile = tmp_dir.filename() + "/new";
-
-  spit(tmp_tile, data, size);
-  fs::create_directories(tid_dir);
-  fs::create_directories(loc_dir);
-
-  const fs::path old_filetype = get_filetype(level, row, col, state->id);
-  const fs::path old_tile_tid = tid_dir / old_filetype;
-  const fs::path old_tile_loc = loc_dir / old_filetype;
-  const fs::path old_tile_bak = fs::path(tmp_dir.filename()) / "old";
-
-  const std::string lockfile = get_lockfile(state->id);
-  ipc::file_lock lock(lockfile.c_str());
-
   bool (*remove)(const fs::path&)                  = &fs::remove;
   void   (*link)(const fs::path&, const fs::path&) = &fs::create_hard_link;
   void (*rename)(const fs::path&, const fs::path&) = &fs::rename;
 
-  raii loc_remove(boost::bind(remove, old_tile_loc),
-                  boost::bind(  link, old_tile_tid, old_tile_loc),
-                  old_filetype.empty());
-
-  raii tid_save(boost::bind(rename, old_tile_tid, old_tile_bak),
-                boost::bind(rename, old_tile_bak, old_tile_tid),
-                old_filetype.empty());
-
-  const fs::path new_tile_tid = tid_dir / filetype,
-                 new_tile_loc = loc_dir / filetype;
+  // Each writer gets its own temporary names, so there's no temporary
+  // directory to make and remove for every tile.
+  const fs::path tmp_tile = tmp_filename(),
+                 tmp_loc  = tmp_tile.string() + ".loc",
+                 tmp_old  = tmp_tile.string() + ".old";
+  raii tmp_cleanup(&noop, boost::bind(&cleanup, tmp_tile));
+  raii loc_cleanup(&noop, boost::bind(&cleanup, tmp_loc));
+  raii old_cleanup(&noop, boost::bind(&cleanup, tmp_old));
+
+  spit(tmp_tile.string(), data, size);
+  link(tmp_tile, tmp_loc);
+  fs::create_directories(tid_dir);
+  fs::create_directories(loc_dir);
 
-  raii tid_create(boost::bind(  link, tmp_tile, new_tile_tid),
-                  boost::bind(remove, new_tile_tid));
-  raii loc_create(boost::bind(  link, tmp_tile, new_tile_loc),
-                  boost::bind(remove, new_tile_loc));
+  {
+    Mutex::Lock loc_lock(m_loc_locks[mix((uint64(level) << 48) ^ (uint64(row) << 24) ^ col) % LOC_LOCKS]);
+    boost::shared_ptr<TidLock> tlock = tid_lock(state->id);
+    raii tid_locked(boost::bind(&TidLock::enter, tlock), boost::bind(&TidLock::leave, tlock));
+
+    const fs::path old_filetype = get_filetype(level, row, col, state->id);
+    const fs::path old_tile_tid = tid_dir / old_filetype;
+    const fs::path old_tile_loc = loc_dir / old_filetype;
+
+    // A tile of another filetype has to go first (a directory only holds
+    // one); one of the same filetype is replaced by the renames below.
+    const bool other_type = !old_filetype.empty() && old_filetype != fs::path(filetype);
+
+    raii loc_remove(boost::bind(remove, old_tile_loc),
+                    boost::bind(  link, old_tile_tid, old_tile_loc),
+                    !other_type);
+
+    raii tid_save(boost::bind(rename, old_tile_tid, tmp_old),
+                  boost::bind(rename, tmp_old, old_tile_tid),
+                  !other_type);
+
+    const fs::path new_tile_tid = tid_dir / filetype,
+                   new_tile_loc = loc_dir / filetype;
+
+    // Taking a tile's place can't be undone, and doesn't need to be: what
+    // replaced it is a complete tile.
+    const bool replace = !old_filetype.empty() && !other_type;
+    raii tid_create(boost::bind(rename, tmp_tile, new_tile_tid),
+                    boost::bind(remove, new_tile_tid));
+    if (replace)
+      tid_create.disarm();
+    raii loc_create(boost::bind(rename, tmp_loc, new_tile_loc),
+                    boost::bind(remove, new_tile_loc));
+    if (replace)
+      loc_create.disarm();
+
+    {
+      Mutex::Lock lock(m_hdr_mutex);
+      if (level >= m_hdr.num_levels()) {
+        m_hdr.set_num_levels(level+1);
+        save_index_file();
+      }
+    }
 
-  if (level >= num_levels()) {
-    m_hdr.set_num_levels(level+1);
-    save_index_file();
+    loc_create.disarm();
+    tid_create.disarm();
+    tid_save.disarm();
+    loc_remove.disarm();
   }
 
-  loc_create.disarm();
-  tid_create.disarm();
-  tid_save.disarm();
-  loc_remove.disarm();
+  forget_loc(level, row, col);
 }
 
 void Dirstore::write_complete(WriteState& state_) {
@@ -645,10 +791,16 @@ void Dirstore::write_complete(WriteState& state_) {
 void Dirstore::flush() { }
 
 IndexHeader Dirstore::index_header() const {
+  Mutex::Lock lock(m_hdr_mutex);
   return m_hdr;
 }
 
-vw::uint32 Dirstore::num_levels() const            { return m_hdr.num_levels();   }
+vw::uint32 Dirstore::num_levels() const {
+  Mutex::Lock lock(m_hdr_mutex);
+  return m_hdr.num_levels();
+}
+
+
 vw::uint32 Dirstore::id() const                    { return m_hdr.platefile_id(); }
 vw::uint32 Dirstore::tile_size() const             { return m_hdr.tile_size();    }
 std::string Dirstore::tile_filetype() const        { return m_hdr.tile_filetype();}
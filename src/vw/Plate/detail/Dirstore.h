@@ -10,16 +10,57 @@
 
 #include <vw/Plate/Datastore.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <ctime>
+#include <map>
 
 namespace vw { namespace platefile {
 namespace detail {
   class Index;
+  class TidLock;
 
 class Dirstore : public Datastore {
   private:
     void init();
     std::string m_plate_path;
     IndexHeader m_hdr;
+    // Guards m_hdr (and the header file), which writers update.
+    mutable Mutex m_hdr_mutex;
+
+    // Plates from version 1 on put a hashed shard directory between the
+    // level and the bucket, so no directory gets too big at deep levels.
+    bool m_sharded;
+
+    // Writers of the same location take the same one of these; writers
+    // of different locations run concurrently.
+    static const uint32 LOC_LOCKS = 64;
+    Mutex m_loc_locks[LOC_LOCKS];
+
+    // The cross-process lock on each transaction's lockfile.
+    Mutex m_tid_lock_mutex;
+    std::map<uint32, boost::shared_ptr<TidLock> > m_tid_locks;
+    boost::shared_ptr<TidLock> tid_lock(const Transaction& id);
+
+    // Names this process's temporary tile files.
+    Atomic<uint64> m_tmp_seq;
+
+    // The tiles (transaction id and filetype, by ascending id) at each
+    // location that was looked at, with the mtime its by-loc directory had.
+    typedef std::vector<std::pair<uint32, std::string> > LocTiles;
+    struct LocEntry {
+      std::time_t mtime;
+      LocTiles tiles;
+    };
+    typedef boost::tuple<uint32, uint32, uint32> loc_t; // level, row, col
+    mutable Mutex m_cache_mutex;
+    mutable std::map<loc_t, LocEntry> m_loc_cache;
+    mutable uint64 m_cache_gen; // bumped by every forget_loc()
+    bool loc_tiles(uint32 level, uint32 row, uint32 col, LocTiles& tiles) const;
+    void forget_loc(uint32 level, uint32 row, uint32 col) const;
 
     TileSearch& top_id_one_loc(TileSearch& tiles, uint32 level, uint32 row, uint32 col) const;
     TileSearch& one_id_one_loc(TileSearch& tiles, uint32 level, uint32 row, uint32 col, const Transaction& id) const;
@@ -33,6 +74,7 @@ class Dirstore : public Datastore {
     std::string path_by_loc(const platefile::Transaction& id, uint32 level, uint32 row, uint32 col, const std::string& filetype) const;
     std::string path_by_loc_no_tid(uint32 level, uint32 row, uint32 col) const;
     std::string path_by_bucket(uint32 level, uint64 bucket) const;
+    std::string bucket_dir(uint32 level, uint64 bucket) const;
     std::string tid_dir(const Transaction& id) const;
 
     void add_one_id(Datastore::TileSearch& tiles, uint32 level, uint32 row, uint32 col, const Transaction& id) const;
@@ -45,6 +87,7 @@ class Dirstore : public Datastore {
 
     std::string get_filetype(uint32 level, uint32 row, uint32 col, const Transaction& id) const;
     std::string get_lockfile(const Transaction& id) const;
+    std::string tmp_filename();
 
     void save_index_file() const;
 
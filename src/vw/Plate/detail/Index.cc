@@ -27,3 +27,7 @@ boost::shared_ptr<Index> Index::construct_open(const Url& url) {
     return boost::shared_ptr<Index>(new RemoteIndex(url));
 }
 
+void Index::write_updates(WriteUpdates const& updates) {
+  for (WriteUpdates::const_iterator i = updates.begin(); i != updates.end(); ++i)
+    this->write_update(i->first, i->second);
+}
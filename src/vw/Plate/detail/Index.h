@@ -15,6 +15,8 @@
 #include <vw/Math/BBox.h>
 #include <boost/shared_ptr.hpp>
 #include <list>
+#include <vector>
+#include <utility>
 
 #define VW_PLATE_INDEX_VERSION 3
 
@@ -64,6 +66,10 @@ namespace detail {
 
     virtual uint64 page_id(uint32 col, uint32 row, uint32 level) const = 0;
 
+    /// The size, in tiles, of the pages a level is stored in.  Searching
+    /// a region a page at a time costs no more than searching it whole.
+    virtual Vector2i page_size() const = 0;
+
     /// Attempt to access a tile in the index.  Throws an
     /// TileNotFoundErr if the tile cannot be found.
     ///
@@ -78,6 +84,22 @@ namespace detail {
     /// most recent tile, regardless of its transaction id.
     virtual IndexRecord read_request(uint32 col, uint32 row, uint32 depth, TransactionOrNeg transaction_id, bool exact_transaction_match = false) = 0;
 
+    /// The result of one read in read_requests().
+    struct ReadResult {
+      bool found;
+      TileHeader header;   // with the transaction id of the record found
+      IndexRecord record;
+      ReadResult() : found(false) {}
+    };
+    typedef std::vector<ReadResult> ReadResults;
+
+    /// Reads several tiles at once.  Each header gives a location and
+    /// the transaction id to read it at, as read_request() takes them
+    /// (-1 for the most recent).  There is one result per tile, in the
+    /// same order; tiles that aren't found are marked, not thrown.
+    virtual ReadResults read_requests(std::vector<TileHeader> const& tiles,
+                                      bool exact_transaction_match = false) = 0;
+
     /// Writing, pt. 1: Locks a blob and returns the blob id that can
     /// be used to write a tile.
     virtual uint32 write_request() = 0;
@@ -86,8 +108,18 @@ namespace detail {
     /// unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record) = 0;
 
+    typedef std::vector<std::pair<TileHeader, IndexRecord> > WriteUpdates;
+
+    /// Writing, pt. 2, batched: Supply the index records of several
+    /// tiles at once.  Indexes that can commit them together (in one
+    /// message, say) override this; by default they are written one
+    /// at a time.
+    virtual void write_updates(WriteUpdates const& updates);
+
     /// Writing, pt. 3: Signal the completion of the write operation.
-    virtual void write_complete(uint32 blob_id) = 0;
+    /// A writer that knows the blob's new size passes it, which saves
+    /// the index from asking the disk; 0 means unknown.
+    virtual void write_complete(uint32 blob_id, uint64 blob_size = 0) = 0;
 
 
     // ----------------------- PROPERTIES  ----------------------
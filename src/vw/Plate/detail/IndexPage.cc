@@ -11,8 +11,11 @@
 #include <vw/Math/BBox.h>
 #include <vw/Core/Debugging.h>
 
-#include <boost/shared_array.hpp>
+#include <vw/Plate/google/sparsetable>
+
+#include <boost/numeric/conversion/cast.hpp>
 #include <boost/foreach.hpp>
+#include <algorithm>
 
 #define WHEREAMI (vw::vw_out(VerboseDebugMessage, "platefile.index") << VW_CURRENT_FUNCTION << ": ")
 using namespace vw;
@@ -23,14 +26,57 @@ using namespace vw::platefile::detail;
 //                            INDEX PAGE
 // ----------------------------------------------------------------------
 
+namespace {
+  // Columnar pages start with this (in place of the page width that
+  // begins a legacy page) and a format version.
+  const uint32 PAGE_MAGIC = 0x50495756; // "VWIP"
+  const uint32 PAGE_VERSION = 2;
+
+  template <class T>
+  void write_column(std::ostream& ostr, std::vector<T> const& col) {
+    if (!col.empty())
+      ostr.write(reinterpret_cast<const char*>(&col[0]), col.size()*sizeof(T));
+  }
+
+  template <class T>
+  void read_column(std::istream& istr, std::vector<T>& col, size_t n) {
+    col.resize(n);
+    if (n)
+      istr.read(reinterpret_cast<char*>(&col[0]), n*sizeof(T));
+    VW_ASSERT(istr.good(), IOErr() << "while reading a page column.");
+  }
+
+  template <class T>
+  void write_pod(std::ostream& ostr, T const& x) {
+    ostr.write(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  template <class T>
+  void read_pod(std::istream& istr, T& x, const char* what) {
+    istr.read(reinterpret_cast<char*>(&x), sizeof(T));
+    VW_ASSERT(istr.good(), IOErr() << "while reading " << what << ".");
+  }
+
+  // Records sort by cell, and then newest first.
+  inline bool record_less(uint32 cell_a, uint32 tid_a, uint32 cell_b, uint32 tid_b) {
+    return cell_a < cell_b || (cell_a == cell_b && tid_a > tid_b);
+  }
+
+  struct PendingLess {
+    template <class T>
+    bool operator()(T const& a, T const& b) const {
+      return record_less(a.cell, a.transaction_id, b.cell, b.transaction_id);
+    }
+  };
+}
+
+const uint32 IndexPage::NO_FILETYPE;
+
 IndexPage::IndexPage(uint32 level, uint32 base_col, uint32 base_row,
                      uint32 page_width, uint32 page_height) :
   m_level(level), m_base_col(base_col), m_base_row(base_row),
   m_page_width(page_width), m_page_height(page_height) {
 
-  // Set the size of the sparse table.
-  m_sparse_table.resize(page_width*page_height);
-
   WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
 }
 
@@ -38,40 +84,107 @@ IndexPage::~IndexPage() {
   WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
 }
 
-void IndexPage::serialize(std::ostream& ostr) {
-  WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
-
-  // Part 1: Write out the page size
-  ostr.write(reinterpret_cast<char*>(&m_page_width), sizeof(m_page_width));
-  ostr.write(reinterpret_cast<char*>(&m_page_height), sizeof(m_page_height));
-
-  // Part 2: Write the sparsetable metadata
-  m_sparse_table.write_metadata(&ostr);
-
-  // Part 3: Write sparse entries
-  for (nonempty_iterator it = m_sparse_table.nonempty_begin(); it != m_sparse_table.nonempty_end(); ++it) {
-
-    // Iterate over transaction_id list.
-    uint32 transaction_list_size = boost::numeric_cast<uint32>(it->size());
-    ostr.write(reinterpret_cast<char*>(&transaction_list_size), sizeof(transaction_list_size));
+// Sort the pending records, keep the last one set for each cell and
+// transaction, and merge them into the columns, replacing any record
+// they share a cell and transaction with.
+void IndexPage::merge_pending() const {
+  Mutex::Lock lock(m_pending_mutex);
+  if (m_pending.empty())
+    return;
+
+  std::stable_sort(m_pending.begin(), m_pending.end(), PendingLess());
+  std::vector<PendingRecord> pending;
+  pending.reserve(m_pending.size());
+  for (size_t i = 0; i < m_pending.size(); ++i) {
+    if (i+1 < m_pending.size() && m_pending[i+1].cell == m_pending[i].cell
+        && m_pending[i+1].transaction_id == m_pending[i].transaction_id)
+      continue;
+    pending.push_back(m_pending[i]);
+  }
+  m_pending.clear();
+
+  size_t n = m_cells.size(), total = n + pending.size();
+  std::vector<uint64> blob_offsets;  blob_offsets.reserve(total);
+  std::vector<uint32> cells;         cells.reserve(total);
+  std::vector<uint32> transactions;  transactions.reserve(total);
+  std::vector<uint32> filetype_ids;  filetype_ids.reserve(total);
+  std::vector<int32> blob_ids;       blob_ids.reserve(total);
+
+  size_t i = 0, j = 0;
+  while (i < n || j < pending.size()) {
+    bool take_pending = i == n ||
+      (j < pending.size() && !record_less(m_cells[i], m_transactions[i], pending[j].cell, pending[j].transaction_id));
+    if (take_pending) {
+      PendingRecord const& p = pending[j++];
+      if (i < n && m_cells[i] == p.cell && m_transactions[i] == p.transaction_id)
+        ++i;
+      blob_offsets.push_back(p.blob_offset);
+      cells.push_back(p.cell);
+      transactions.push_back(p.transaction_id);
+      filetype_ids.push_back(p.filetype_id);
+      blob_ids.push_back(p.blob_id);
+    } else {
+      blob_offsets.push_back(m_blob_offsets[i]);
+      cells.push_back(m_cells[i]);
+      transactions.push_back(m_transactions[i]);
+      filetype_ids.push_back(m_filetype_ids[i]);
+      blob_ids.push_back(m_blob_ids[i]);
+      ++i;
+    }
+  }
 
-    multi_value_type::iterator transaction_iter = (*it).begin();
-    while (transaction_iter != (*it).end()) {
+  m_blob_offsets.swap(blob_offsets);
+  m_cells.swap(cells);
+  m_transactions.swap(transactions);
+  m_filetype_ids.swap(filetype_ids);
+  m_blob_ids.swap(blob_ids);
+}
 
-      // Save the transaction id
-      uint32 t_id = (*transaction_iter).first;
-      ostr.write(reinterpret_cast<char*>(&t_id), sizeof(t_id));
+std::pair<size_t, size_t> IndexPage::cell_records(uint32 cell) const {
+  merge_pending();
+  std::pair<std::vector<uint32>::const_iterator, std::vector<uint32>::const_iterator> range =
+    std::equal_range(m_cells.begin(), m_cells.end(), cell);
+  return std::make_pair(range.first - m_cells.begin(), range.second - m_cells.begin());
+}
 
-      // Save the size of each protobuf, and then serialize it to disk.
-      uint16 protobuf_size = boost::numeric_cast<uint16>(transaction_iter->second.ByteSize());
-      boost::shared_array<uint8> protobuf_bytes( new uint8[protobuf_size] );
-      (*transaction_iter).second.SerializeToArray(protobuf_bytes.get(), protobuf_size);
-      ostr.write(reinterpret_cast<char*>(&protobuf_size), sizeof(protobuf_size));
-      ostr.write(reinterpret_cast<char*>(protobuf_bytes.get()), protobuf_size);
+// A columnar page is laid out as
+//
+//   magic, version, page width, page height   (uint32 each)
+//   record count, filetype count              (uint32 each)
+//   filetypes                                 (uint32 length, then bytes, each)
+//   zero padding to a multiple of 8 bytes
+//   blob offsets                              (uint64 per record)
+//   cells, transaction ids, filetype ids      (uint32 per record each)
+//   blob ids                                  (int32 per record)
+//
+// in native byte order, so every column is aligned for use in place.
+void IndexPage::serialize(std::ostream& ostr) {
+  WHEREAMI << "[" << m_base_col << " " << m_base_row << " @ " << m_level << "]\n";
 
-      ++transaction_iter;
-    }
+  merge_pending();
+
+  uint64 written = 0;
+  write_pod(ostr, PAGE_MAGIC);
+  write_pod(ostr, PAGE_VERSION);
+  write_pod(ostr, m_page_width);
+  write_pod(ostr, m_page_height);
+  write_pod(ostr, boost::numeric_cast<uint32>(m_cells.size()));
+  write_pod(ostr, boost::numeric_cast<uint32>(m_filetypes.size()));
+  written += 6*sizeof(uint32);
+
+  BOOST_FOREACH(std::string const& type, m_filetypes) {
+    write_pod(ostr, boost::numeric_cast<uint32>(type.size()));
+    ostr.write(type.data(), type.size());
+    written += sizeof(uint32) + type.size();
   }
+  static const char padding[8] = {0};
+  ostr.write(padding, (8 - written % 8) % 8);
+
+  write_column(ostr, m_blob_offsets);
+  write_column(ostr, m_cells);
+  write_column(ostr, m_transactions);
+  write_column(ostr, m_filetype_ids);
+  write_column(ostr, m_blob_ids);
 }
 
 void IndexPage::deserialize(std::istream& istr) {
@@ -80,56 +193,99 @@ void IndexPage::deserialize(std::istream& istr) {
 
   VW_ASSERT(istr.good(), IOErr() << "while beginning to deserialize.");
 
-  // Part 1: Read the page size
-  istr.read(reinterpret_cast<char*>(&m_page_width), sizeof(m_page_width));
-  istr.read(reinterpret_cast<char*>(&m_page_height), sizeof(m_page_height));
+  Mutex::Lock lock(m_pending_mutex);
+  m_pending.clear();
 
-  VW_ASSERT(istr.good(), IOErr() << "while reading page size.");
+  uint32 magic;
+  read_pod(istr, magic, "page magic");
+  if (magic != PAGE_MAGIC) {
+    // The legacy format starts with the page width.
+    m_page_width = magic;
+    deserialize_legacy(istr);
+    return;
+  }
+
+  uint32 version, count, filetype_count;
+  read_pod(istr, version, "page version");
+  if (version != PAGE_VERSION)
+    vw_throw(IOErr() << "unknown index page version " << version << ".");
+  read_pod(istr, m_page_width, "page size");
+  read_pod(istr, m_page_height, "page size");
+  read_pod(istr, count, "record count");
+  read_pod(istr, filetype_count, "filetype count");
+  uint64 read = 6*sizeof(uint32);
+
+  m_filetypes.resize(filetype_count);
+  BOOST_FOREACH(std::string& type, m_filetypes) {
+    uint32 size;
+    read_pod(istr, size, "a filetype");
+    type.resize(size);
+    if (size)
+      istr.read(&type[0], size);
+    VW_ASSERT(istr.good(), IOErr() << "while reading a filetype.");
+    read += sizeof(uint32) + size;
+  }
+  istr.ignore((8 - read % 8) % 8);
 
-  // Part 2: Read the sparsetable metadata
-  if (!m_sparse_table.read_metadata(&istr))
+  read_column(istr, m_blob_offsets, count);
+  read_column(istr, m_cells, count);
+  read_column(istr, m_transactions, count);
+  read_column(istr, m_filetype_ids, count);
+  read_column(istr, m_blob_ids, count);
+
+  if (istr.peek() != EOF)
+    vw_out(WarningMessage, "platefile.index") << "Unparsed data remaining in index page.\n";
+}
+
+// The legacy format: the page size, the metadata of a
+// google::sparsetable over the cells, and then for each occupied cell
+// in order, its number of records and each record as its transaction
+// id, a uint16 size and a serialized IndexRecord, newest first.
+void IndexPage::deserialize_legacy(std::istream& istr) {
+  read_pod(istr, m_page_height, "page size");
+
+  google::sparsetable<uint8> occupied;
+  if (!occupied.read_metadata(&istr))
     vw_throw(IOErr() << "while reading sparse table metadata.");
 
   VW_ASSERT(istr.good(), IOErr() << "after reading sparse table metadata.");
 
-  // make sure we initialize everything before we continue
-  BOOST_FOREACH(multi_value_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end()))
-    new (&x) multi_value_type();
+  m_blob_offsets.clear();
+  m_cells.clear();
+  m_transactions.clear();
+  m_filetype_ids.clear();
+  m_blob_ids.clear();
+  m_filetypes.clear();
 
-  size_t count = 0, total = m_sparse_table.num_nonempty();
+  std::vector<uint8> protobuf_bytes;
+  for (uint32 cell = 0; cell < occupied.size(); ++cell) {
+    if (!occupied.test(cell))
+      continue;
 
-  // Part 3: Read sparse entries
-  BOOST_FOREACH(multi_value_type& x, std::make_pair(m_sparse_table.nonempty_begin(), m_sparse_table.nonempty_end())) {
-    if (count++ % 4000 == 0)
-      WHEREAMI << "reading tile slot " << count << " of " << total << std::endl;
-    // Iterate over transaction_id list.
     uint32 transaction_list_size;
-    istr.read(reinterpret_cast<char*>(&transaction_list_size), sizeof(transaction_list_size));
-
-    VW_ASSERT(istr.good(), IOErr() << "while reading transaction list size.");
+    read_pod(istr, transaction_list_size, "transaction list size");
 
     for (uint32 tid = 0; tid < transaction_list_size; ++tid) {
-
-      // Read the transaction id
       uint32 t_id;
-      istr.read(reinterpret_cast<char*>(&t_id), sizeof(t_id));
-      VW_ASSERT(istr.good(), IOErr() << "while reading a transaction id.");
+      read_pod(istr, t_id, "a transaction id");
 
-      // Read the size (in bytes) of this protobuffer and then read
-      // the protobuffer and deserialize it.
       uint16 protobuf_size;
-      istr.read(reinterpret_cast<char*>(&protobuf_size), sizeof(protobuf_size));
-      VW_ASSERT(istr.good(), IOErr() << "while reading a message size.");
+      read_pod(istr, protobuf_size, "a message size");
 
-      boost::shared_array<uint8> protobuf_bytes( new uint8[protobuf_size] );
-      istr.read(reinterpret_cast<char*>(protobuf_bytes.get()), protobuf_size);
+      protobuf_bytes.resize(protobuf_size);
+      if (protobuf_size)
+        istr.read(reinterpret_cast<char*>(&protobuf_bytes[0]), protobuf_size);
       VW_ASSERT(istr.good(), IOErr() << "while reading a message.");
 
       IndexRecord rec;
-      if (!rec.ParseFromArray(protobuf_bytes.get(), protobuf_size))
+      if (!rec.ParseFromArray(protobuf_size ? &protobuf_bytes[0] : 0, protobuf_size))
         vw_throw(IOErr() << "while parsing a message.");
 
-      x.push_back(value_type(t_id, rec));
+      m_blob_offsets.push_back(rec.blob_offset());
+      m_cells.push_back(cell);
+      m_transactions.push_back(t_id);
+      m_filetype_ids.push_back(rec.has_filetype() ? filetype_id(rec.filetype()) : NO_FILETYPE);
+      m_blob_ids.push_back(rec.blob_id());
     }
   }
 
@@ -137,48 +293,91 @@ void IndexPage::deserialize(std::istream& istr) {
     vw_out(WarningMessage, "platefile.index") << "Unparsed data remaining in index page.\n";
 }
 
-// ----------------------- ACCESSORS  ----------------------
+// ----------------------- RECORDS  ----------------------
 
-void IndexPage::set(TileHeader const& header, IndexRecord const& record) {
+uint32 IndexPage::filetype_id(std::string const& filetype) {
+  size_t id = std::find(m_filetypes.begin(), m_filetypes.end(), filetype) - m_filetypes.begin();
+  if (id == m_filetypes.size())
+    m_filetypes.push_back(filetype);
+  return boost::numeric_cast<uint32>(id);
+}
 
-  uint32 page_col = header.col() % m_page_width;
-  uint32 page_row = header.row() % m_page_height;
+TileHeader IndexPage::make_header(size_t i) const {
+  TileHeader hdr;
+  hdr.set_col( m_base_col + m_cells[i] % m_page_width );
+  hdr.set_row( m_base_row + m_cells[i] / m_page_width );
+  hdr.set_level(m_level);
+  hdr.set_transaction_id(m_transactions[i]);
+  if (m_filetype_ids[i] != NO_FILETYPE)
+    hdr.set_filetype(m_filetypes[m_filetype_ids[i]]);
+  return hdr;
+}
 
-  value_type p(header.transaction_id(), record);
-  uint32 elmnt = page_row*m_page_width + page_col;
-  if (m_sparse_table.test(elmnt)) {
+IndexRecord IndexPage::make_record(size_t i) const {
+  IndexRecord rec;
+  rec.set_blob_id(m_blob_ids[i]);
+  rec.set_blob_offset(m_blob_offsets[i]);
+  if (m_filetype_ids[i] != NO_FILETYPE)
+    rec.set_filetype(m_filetypes[m_filetype_ids[i]]);
+  return rec;
+}
 
-    // Add to existing entry.
-    multi_value_type *entries = m_sparse_table[elmnt].operator&();
+size_t IndexPage::num_records() const {
+  merge_pending();
+  return m_cells.size();
+}
 
-    // We need to keep this list sorted in decreasing order of
-    // transaction ID, do a simple insertion sort here.
-    multi_value_type::iterator it = entries->begin();
-    while (it != entries->end() && (*it).first >= header.transaction_id() ) {
+TileHeader IndexPage::header(size_t i) const {
+  merge_pending();
+  return make_header(i);
+}
 
-      // Handle the case where we replace an entry
-      if ( (*it).first == header.transaction_id() ) {
-        (*it).second = record;
-        return;
-      }
+IndexRecord IndexPage::record(size_t i) const {
+  merge_pending();
+  return make_record(i);
+}
 
-      // Otherwise, we search forward in the list.
-      ++it;
-    }
+// ----------------------- ACCESSORS  ----------------------
 
-    // If we reach this point, we are either at the end of the list,
-    // or we have found the correct position.  Either way, we call
-    // insert().
-    entries->insert(it, p);
+void IndexPage::set(TileHeader const& header, IndexRecord const& record) {
+  Mutex::Lock lock(m_pending_mutex);
+  PendingRecord p;
+  p.cell = cell(header.col(), header.row());
+  p.transaction_id = header.transaction_id();
+  p.blob_id = record.blob_id();
+  p.blob_offset = record.blob_offset();
+  p.filetype_id = record.has_filetype() ? filetype_id(record.filetype()) : NO_FILETYPE;
+  m_pending.push_back(p);
+}
 
-  } else {
+size_t IndexPage::find_record(std::pair<size_t, size_t> const& range,
+                              TransactionOrNeg transaction_id_neg, bool exact_match) const {
+  if ( range.first == range.second )
+    return range.second;
 
-    // Create a new entry
-    multi_value_type l;
-    l.push_front(p);
-    m_sparse_table[elmnt] = l;
+  // A transaction ID of -1 indicates that we should return the most
+  // recent tile (which is the first record for the cell, since they
+  // are sorted from most recent to least recent), regardless of its
+  // transaction id.
+  if (transaction_id_neg.newest())
+    return range.first;
 
+  Transaction transaction_id = transaction_id_neg.promote();
+
+  // Otherwise, we search through the records for the cell, looking
+  // for the requested t_id.  Most cells have very few records, and
+  // for those with many (i.e. tiles near the root of the mosaic), you
+  // will rarely search for old tiles.
+  for (size_t i = range.first; i < range.second; ++i) {
+    if (exact_match) {
+      if (m_transactions[i] == transaction_id)
+        return i;
+    } else {
+      if (m_transactions[i] <= transaction_id)
+        return i;
+    }
   }
+  return range.second;
 }
 
 /// Return the IndexRecord for a the given transaction_id at
@@ -194,63 +393,78 @@ void IndexPage::set(TileHeader const& header, IndexRecord const& record) {
 ///   - Setting exact_match to true forces an exact transaction_id
 ///   match.
 ///
-IndexRecord IndexPage::get(uint32 col, uint32 row, TransactionOrNeg transaction_id_neg, bool exact_match) const {
-
-  // Compute page_col and row
-  int32 page_col = col % m_page_width;
-  int32 page_row = row % m_page_height;
+IndexRecord IndexPage::get(uint32 col, uint32 row, TransactionOrNeg transaction_id, bool exact_match) const {
 
-  // Interate over entries.
-  multi_value_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
-  multi_value_type::const_iterator it = entries.begin();
+  std::pair<size_t, size_t> range = cell_records(cell(col, row));
 
-  if ( entries.begin() == entries.end() )
+  if ( range.first == range.second )
     vw_throw(TileNotFoundErr() << "No Tiles exist at this location.");
 
-  // A transaction ID of -1 indicates that we should return the most
-  // recent tile (which is the first entry in the list, since it is
-  // sorted from most recent to least recent), regardless of its
-  // transaction id.
-  if (transaction_id_neg.newest())
-    return (*it).second;
-
-  Transaction transaction_id = transaction_id_neg.promote();
-
-  // Otherwise, we search through the entries in the list, looking for
-  // the requested t_id.  Note: this search is O(n), so it can be slow
-  // if there are a lot of entries and the entry you are looking for
-  // is near the end.  However, most pages will contain very few
-  // entries, and for those with many entries (i.e. tiles near the
-  // root of the mosaic), you will rarely search for old tiles.
-  while (it != entries.end()) {
-    if (exact_match) {
-      if ((*it).first == transaction_id)
-        return (*it).second;
-    } else {
-      if ((*it).first <= transaction_id)
-        return (*it).second;
-    }
-    ++it;
-  }
+  size_t i = find_record(range, transaction_id, exact_match);
 
   // If we reach this point, then there are no entries before
   // the given transaction_id, so we return an empty (and invalid) record.
-  vw_throw(TileNotFoundErr() << "Tiles exist at this location, "
-           << "but none before transaction_id = "  << transaction_id);
-  return IndexRecord(); // never reached
+  if (i == range.second)
+    vw_throw(TileNotFoundErr() << "Tiles exist at this location, "
+             << "but none before transaction_id = "  << transaction_id);
+
+  return make_record(i);
 }
 
+bool IndexPage::find(uint32 col, uint32 row, TransactionOrNeg transaction_id, bool exact_match,
+                     TileHeader& header, IndexRecord& record) const {
+  std::pair<size_t, size_t> range = cell_records(cell(col, row));
+  size_t i = find_record(range, transaction_id, exact_match);
+  if (i == range.second)
+    return false;
+  header = make_header(i);
+  record = make_record(i);
+  return true;
+}
 
-void IndexPage::append_if_in_region( std::list<TileHeader> &results,
-                                     multi_value_type const& candidates,
-                                     uint32 col, uint32 row, BBox2i const& region) const {
+IndexPage::multi_value_type
+IndexPage::multi_get(uint32 col, uint32 row,
+                     TransactionOrNeg begin_transaction_id, TransactionOrNeg end_transaction_id) const {
+  std::pair<size_t, size_t> range = cell_records(cell(col, row));
+
+  multi_value_type results;
+  for (size_t i = range.first; i < range.second; ++i) {
+    if (m_transactions[i] < begin_transaction_id)
+      break;
+    if (m_transactions[i] <= end_transaction_id)
+      results.push_back(value_type(m_transactions[i], make_record(i)));
+  }
+  return results;
+}
 
-  BOOST_FOREACH(const value_type& t, candidates) {
-    Vector2i loc( m_base_col + col, m_base_row + row);
-    if ( region.contains( loc ) )
-      results.push_back(hdr_from_index(col, row, t));
+uint32 IndexPage::sparse_size() const {
+  merge_pending();
+  uint32 cells = 0;
+  for (size_t i = 0; i < m_cells.size(); ++i)
+    if (i == 0 || m_cells[i] != m_cells[i-1])
+      ++cells;
+  return cells;
+}
+
+void IndexPage::append_headers(std::list<TileHeader>& results, size_t begin, size_t end,
+                               TransactionOrNeg start_transaction_id,
+                               TransactionOrNeg end_transaction_id) const {
+  if (start_transaction_id.newest() && end_transaction_id.newest()) {
+    // If the user has specified a transaction range of [-1, -1],
+    // then we only return the last valid tile.
+    if (begin < end)
+      results.push_back(make_header(begin));
+    return;
+  }
+
+  // Records are newest first, so stop at the first one older than
+  // the range.
+  for (size_t i = begin; i < end; ++i) {
+    if (m_transactions[i] < start_transaction_id)
+      break;
+    if (m_transactions[i] <= end_transaction_id)
+      results.push_back(make_header(i));
   }
-  // Check to see if the tile is in the specified region.
 }
 
 /// Returns a list of valid tiles in this IndexPage.  Returns a list
@@ -274,40 +488,19 @@ IndexPage::search_by_region(BBox2i const& region,
   if (region.max().x() > MAX_IDX || region.max().y() > MAX_IDX)
     vw_out(WarningMessage) << VW_CURRENT_FUNCTION << ": " << "asked for a region outside valid area for level " << m_level << ": " << region << std::endl;
 
+  merge_pending();
+
   std::list<TileHeader> results;
-  for (uint32 row = 0; row < m_page_height; ++row) {
-    for (uint32 col = 0; col < m_page_width; ++col) {
-      if (m_sparse_table.test(row*m_page_width + col)) {
-
-        // Iterate over entries.
-        multi_value_type const& entries = m_sparse_table[row*m_page_width + col];
-        multi_value_type candidates;
-
-        if (start_transaction_id.newest() && end_transaction_id.newest()) {
-          // If the user has specified a transaction range of [-1, -1],
-          // then we only return the last valid tile.
-          if (entries.size() > 0)
-            candidates.push_back( *(entries.begin()) );
-        } else {
-          // Search through the entries in the list, looking entries
-          // that match the requested transaction_id range.  Note: this
-          // search is O(n), so it can be slow if there are a lot of
-          // entries and the entry you are looking for is near the end.
-          // However, most pages will contain very few entries, and for
-          // those with many entries (i.e. tiles near the root of the
-          // mosaic), you will most likely be searching for recently
-          // added tiles, which are sorted to the beginning.
-          BOOST_FOREACH(const value_type& elt, entries) {
-            if (elt.first < start_transaction_id)
-              break;
-            if (elt.first <= end_transaction_id)
-              candidates.push_back(elt);
-          }
-        }
-
-        append_if_in_region( results, candidates, col, row, region );
-      }
-    }
+  size_t n = m_cells.size();
+  for (size_t begin = 0, end = 0; begin < n; begin = end) {
+    uint32 cell = m_cells[begin];
+    while (end < n && m_cells[end] == cell)
+      ++end;
+
+    // Check to see if the tile is in the specified region.
+    Vector2i loc( m_base_col + cell % m_page_width, m_base_row + cell / m_page_width );
+    if ( region.contains( loc ) )
+      append_headers(results, begin, end, start_transaction_id, end_transaction_id);
   }
 
   return results;
@@ -323,29 +516,9 @@ IndexPage::search_by_location(uint32 col, uint32 row,
             ArgumentErr() << VW_CURRENT_FUNCTION << ": received a null set range ["
                           << start_transaction_id << "," << end_transaction_id << "]");
 
-  uint32 page_col = col % m_page_width;
-  uint32 page_row = row % m_page_height;
+  std::pair<size_t, size_t> range = cell_records(cell(col, row));
 
   std::list<TileHeader> results;
-
-  // Check first to make sure that there are actually tiles at this location.
-  if (!m_sparse_table.test(page_row*m_page_width + page_col))
-    return results;
-
-  multi_value_type const& entries = m_sparse_table[page_row*m_page_width + page_col];
-  if (entries.size() == 0)
-    return results;
-
-  if (start_transaction_id.newest() && end_transaction_id.newest())
-    results.push_back(hdr_from_index(page_col, page_row, *entries.begin()));
-  else {
-    BOOST_FOREACH(const value_type& elt, entries) {
-      if (elt.first < start_transaction_id)
-        break;
-      if (elt.first <= end_transaction_id)
-        results.push_back(hdr_from_index(page_col, page_row, elt));
-    }
-  }
-
+  append_headers(results, range.first, range.second, start_transaction_id, end_transaction_id);
   return results;
 }
@@ -11,11 +11,11 @@
 #include <vw/Plate/FundamentalTypes.h>
 #include <vw/Plate/IndexData.pb.h>
 #include <vw/Plate/IndexDataPrivate.pb.h>
-#include <vw/Plate/google/sparsetable>
 #include <vw/Math/BBox.h>
-#include <boost/numeric/conversion/cast.hpp>
+#include <vw/Core/Thread.h>
 #include <boost/shared_ptr.hpp>
 #include <string>
+#include <vector>
 #include <list>
 
 namespace vw {
@@ -26,33 +26,69 @@ namespace detail {
   //                            INDEX PAGE
   // ----------------------------------------------------------------------
 
+  /// An IndexPage holds the index records of a page_width by
+  /// page_height block of tiles at one level.  The records are kept
+  /// in columns, one per field, sorted by cell (row-major within the
+  /// page) and then by decreasing transaction id, and are saved in the
+  /// same layout, so loading a page is a handful of bulk reads.
   class IndexPage {
 
   public:
     typedef std::pair<uint32, IndexRecord> value_type;
     typedef std::list<value_type> multi_value_type;
-    typedef google::sparsetable<multi_value_type>::nonempty_iterator nonempty_iterator;
 
   protected:
     uint32 m_level, m_base_col, m_base_row;
     uint32 m_page_width, m_page_height;
-    google::sparsetable<multi_value_type> m_sparse_table;
-
-    void append_if_in_region( std::list<TileHeader> &results,
-                              multi_value_type const& candidates,
-                              uint32 col, uint32 row, BBox2i const& region) const;
-
-    TileHeader hdr_from_index(uint32 rel_col, uint32 rel_row, const value_type& elt) const {
-      TileHeader hdr;
-      hdr.set_col( m_base_col + rel_col );
-      hdr.set_row( m_base_row + rel_row );
-      hdr.set_level(m_level);
-      hdr.set_transaction_id(elt.first);
-      if (elt.second.has_filetype())
-        hdr.set_filetype(elt.second.filetype());
-      return hdr;
+
+    // The columns.  Filetypes are indices into m_filetypes, or
+    // NO_FILETYPE for records without one.
+    static const uint32 NO_FILETYPE = 0xffffffff;
+    mutable std::vector<uint64> m_blob_offsets;
+    mutable std::vector<uint32> m_cells, m_transactions, m_filetype_ids;
+    mutable std::vector<int32>  m_blob_ids;
+    std::vector<std::string> m_filetypes;
+
+    // Records set since the columns were last sorted.  They are merged
+    // in before the next read, so a run of writes costs one merge
+    // rather than an insertion into the columns each.
+    struct PendingRecord {
+      uint32 cell, transaction_id, filetype_id;
+      int32 blob_id;
+      uint64 blob_offset;
+    };
+    mutable std::vector<PendingRecord> m_pending;
+    mutable Mutex m_pending_mutex;
+
+    void merge_pending() const;
+
+    // The id of a filetype, added to m_filetypes if it's new.
+    uint32 filetype_id(std::string const& filetype);
+
+    // The header and record of the i'th record, assuming nothing is
+    // pending.
+    TileHeader make_header(size_t i) const;
+    IndexRecord make_record(size_t i) const;
+
+    // The records for a cell are [first, second).
+    std::pair<size_t, size_t> cell_records(uint32 cell) const;
+
+    // The record of a cell that get() returns, or range.second if
+    // there isn't one.
+    size_t find_record(std::pair<size_t, size_t> const& range,
+                       TransactionOrNeg transaction_id, bool exact_match) const;
+    uint32 cell(uint32 col, uint32 row) const {
+      return (row % m_page_height)*m_page_width + (col % m_page_width);
     }
 
+    // Appends headers for the records in [begin, end) of one cell that
+    // fall in the transaction range.
+    void append_headers(std::list<TileHeader>& results, size_t begin, size_t end,
+                        TransactionOrNeg start_transaction_id,
+                        TransactionOrNeg end_transaction_id) const;
+
+    void deserialize_legacy(std::istream& istr);
+
   public:
 
     /// Create or open a page file.
@@ -65,13 +101,20 @@ namespace detail {
     virtual void sync() = 0;
 
     // For reading/writing to/from disk or a network byte stream.
+    // Pages in the older format, a sparse table of protobuf records,
+    // can still be read; they are written back in the columnar one.
     void serialize(std::ostream& ostr);
     void deserialize(std::istream& istr);
 
-    // ----------------------- ITERATORS  ----------------------
+    // ----------------------- RECORDS  ----------------------
 
-    nonempty_iterator begin() { return m_sparse_table.nonempty_begin(); }
-    nonempty_iterator end() { return m_sparse_table.nonempty_end(); }
+    /// The number of records in the page, counting every transaction.
+    size_t num_records() const;
+
+    /// The tile header and index record of the i'th record, in order
+    /// of location and then decreasing transaction id.
+    TileHeader header(size_t i) const;
+    IndexRecord record(size_t i) const;
 
     // ----------------------- ACCESSORS  ----------------------
 
@@ -93,6 +136,12 @@ namespace detail {
     ///
     IndexRecord get(uint32 col, uint32 row, TransactionOrNeg transaction_id, bool exact_match = false) const;
 
+    /// Like get(), but also returns the header of the record (with
+    /// its transaction id), and returns false rather than throwing if
+    /// there isn't one.
+    bool find(uint32 col, uint32 row, TransactionOrNeg transaction_id, bool exact_match,
+              TileHeader& header, IndexRecord& record) const;
+
     /// Return multiple index entries that match the specified
     /// transaction id range.  This range is inclusive of the first
     /// entry AND the last entry: [ begin_transaction_id, end_transaction_id ]
@@ -107,7 +156,7 @@ namespace detail {
 
     /// Return the number of valid entries in this page.  (Remember
     /// that this is a sparse store of IndexRecords.)
-    uint32 sparse_size() { return boost::numeric_cast<uint32>(m_sparse_table.num_nonempty()); }
+    uint32 sparse_size() const;
 
     /// Returns a list of valid tiles in this IndexPage.
     ///
@@ -155,6 +204,9 @@ namespace detail {
              uint32 page_width, uint32 page_height) = 0;
     // Who is this factory manufacturing pages for? (human-readable)
     virtual std::string who() const = 0;
+    // Whether its generators can run on a background thread, alongside
+    // each other and the caller, to prefetch pages.
+    virtual bool can_prefetch() const { return true; }
   };
 
 }}}
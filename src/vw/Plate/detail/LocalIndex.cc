@@ -7,6 +7,8 @@
 
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/FileIO/TemporaryFile.h>
 #include <vw/Plate/detail/LocalIndex.h>
 #include <vw/Plate/detail/RemoteIndex.h>
@@ -22,7 +24,9 @@ using namespace vw::platefile::detail;
 #include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
+#include <boost/bind.hpp>
 #include <algorithm>
+#include <set>
 namespace fs = boost::filesystem;
 
 LocalIndexPage::LocalIndexPage(std::string filename, uint32 level, uint32 base_col,
@@ -152,6 +156,10 @@ std::string LocalIndex::log_filename() const {
   return m_plate_filename + "/plate.log";
 }
 
+std::string LocalIndex::filter_filename() const {
+  return m_plate_filename + "/index/tile_filters";
+}
+
 std::vector<std::string> LocalIndex::blob_filenames() const {
 
   std::vector<std::string> result;
@@ -179,6 +187,64 @@ std::vector<std::string> LocalIndex::blob_filenames() const {
   return result;
 }
 
+// The filters file holds the number of levels, then each level's
+// TileFilter.  It is only there while it holds every tile in the index.
+void LocalIndex::load_tile_filters() {
+  std::ifstream istr(this->filter_filename().c_str(), std::ios::binary);
+  if (!istr.is_open()) {
+    vw_out(DebugMessage, "plate") << "No tile filters for " << m_plate_filename << std::endl;
+    return;
+  }
+
+  try {
+    uint32 levels;
+    istr.read(reinterpret_cast<char*>(&levels), sizeof(levels));
+    VW_ASSERT(istr.good(), IOErr() << "could not read the level count.");
+    VW_ASSERT(levels == m_levels.size(), IOErr() << "they are for " << levels << " levels, not " << m_levels.size() << ".");
+
+    std::vector<boost::shared_ptr<TileFilter> > filters;
+    for (uint32 level = 0; level < levels; ++level) {
+      filters.push_back(boost::shared_ptr<TileFilter>(new TileFilter()));
+      filters.back()->deserialize(istr);
+    }
+    this->set_tile_filters(filters);
+    this->mark_tile_filters_clean();
+  } catch (const IOErr& e) {
+    vw_out(WarningMessage, "plate") << "Ignoring the tile filters of " << m_plate_filename << ": " << e.what() << std::endl;
+  }
+}
+
+void LocalIndex::save_tile_filters() {
+  fs::path filename(this->filter_filename());
+  fs::create_directories(filename.parent_path());
+
+  std::string tmpname;
+  {
+    TemporaryFile tmp(filename.parent_path().file_string(), false);
+    std::vector<boost::shared_ptr<TileFilter> > filters = this->tile_filters();
+    uint32 levels = boost::numeric_cast<uint32>(filters.size());
+    tmp.write(reinterpret_cast<const char*>(&levels), sizeof(levels));
+    BOOST_FOREACH(boost::shared_ptr<TileFilter> const& f, filters)
+      f->serialize(tmp);
+    if (!tmp.good())
+      vw_throw(IOErr() << "LocalIndex::save_tile_filters(): failed to write " << tmp.filename());
+    tmpname = tmp.filename();
+  }
+
+  if (::rename(tmpname.c_str(), filename.string().c_str()) == -1)
+    vw_throw(IOErr() << "LocalIndex::save_tile_filters(): failed to rename temp file to " << filename.string() << ": " << ::strerror(errno));
+
+  this->mark_tile_filters_clean();
+}
+
+void LocalIndex::tile_filters_changed() {
+  try {
+    fs::remove(this->filter_filename());
+  } catch (const fs::filesystem_error& e) {
+    vw_throw(IOErr() << "LocalIndex: could not remove stale tile filters: " << e.what());
+  }
+}
+
 void LocalIndex::save_index_file() const {
 
   std::ofstream ofstr( this->index_filename().c_str() );
@@ -253,6 +319,10 @@ void LocalIndex::save_index_file() const {
    m_header.set_num_levels(0);               // Index initially contains zero levels
    this->save_index_file();
 
+   // A new index is empty, so its filters are trivially complete.
+   this->set_tile_filters();
+   this->save_tile_filters();
+
    // Create the logging facility
    m_log = boost::shared_ptr<LogInstance>( new LogInstance(this->log_filename()) );
    this->log() << "Created new index: \"" << this->index_filename() << "\n"
@@ -277,17 +347,69 @@ void LocalIndex::save_index_file() const {
     ifstr.close();
 
     // Load Index Levels for PagedIndex
-    for (uint32 level = 0; level < this->num_levels(); ++level) {
-      boost::shared_ptr<IndexLevel> new_level( new IndexLevel(m_page_gen_factory, level,
-            m_page_width, m_page_height,
-            m_default_cache_size) );
-      m_levels.push_back(new_level);
-    }
+    for (uint32 level = 0; level < this->num_levels(); ++level)
+      m_levels.push_back(make_level(level));
+    this->load_tile_filters();
 
     m_log = boost::shared_ptr<LogInstance>( new LogInstance(this->log_filename()) );
     this->log() << "Reopened index \"" << this->index_filename() << "\n" << m_header.DebugString() << "\n";
   }
 
+LocalIndex::~LocalIndex() {
+  if (!this->has_tile_filters() || !this->tile_filters_dirty())
+    return;
+  try {
+    this->sync();
+  } catch (const vw::Exception& e) {
+    vw_out(WarningMessage, "plate") << "Could not save the tile filters of " << m_plate_filename << ": " << e.what() << std::endl;
+  }
+}
+
+void LocalIndex::sync() {
+  PagedIndex::sync();
+  // Only once the pages are saved do the filters describe what's on disk.
+  if (this->has_tile_filters() && this->tile_filters_dirty())
+    this->save_tile_filters();
+}
+
+void LocalIndex::build_tile_filters() {
+  this->sync();
+
+  const Vector2i page = this->page_size();
+  std::vector<boost::shared_ptr<TileFilter> > filters;
+  for (uint32 level = 0; level < m_levels.size(); ++level) {
+    filters.push_back(make_filter(level));
+    fs::path level_dir = fs::path(m_plate_filename) / "index" / boost::lexical_cast<std::string>(level);
+    if (!fs::exists(level_dir))
+      continue;
+
+    // Page files are index/<level>/<base_row>/<base_col>
+    for (fs::directory_iterator row(level_dir), end; row != end; ++row) {
+      if (!fs::is_directory(row->path()))
+        continue;
+      for (fs::directory_iterator col(row->path()); col != end; ++col) {
+        uint32 base_row, base_col;
+        try {
+          base_row = boost::lexical_cast<uint32>(row->path().filename().c_str());
+          base_col = boost::lexical_cast<uint32>(col->path().filename().c_str());
+        } catch (const boost::bad_lexical_cast&) {
+          vw_out(DebugMessage, "plate") << "Skipping non-page file " << col->path().string() << std::endl;
+          continue;
+        }
+        LocalIndexPage p(col->path().string(), level, base_col, base_row, page[0], page[1]);
+        for (size_t i = 0; i < p.num_records(); ++i) {
+          TileHeader hdr = p.header(i);
+          filters.back()->insert(hdr.col(), hdr.row());
+        }
+      }
+    }
+  }
+
+  this->set_tile_filters(filters);
+  this->save_tile_filters();
+  this->log() << "Built tile filters for " << m_levels.size() << " levels.\n";
+}
+
 /// Open an existing index from a file on disk.
 LocalIndex::LocalIndex(std::string plate_filename) :
   PagedIndex(boost::shared_ptr<PageGeneratorFactory>( new LocalPageGeneratorFactory(plate_filename) ) ),  // superclass constructor
@@ -369,39 +491,243 @@ Transaction LocalIndex::transaction_request(std::string transaction_description,
    return m_header.transaction_read_cursor();
  }
 
- // Load index entries by iterating through TileHeaders saved in the
- // blob file.  This function essentially rebuilds an index in memory
- // using entries that had been previously saved to disk.
- void LocalIndex::rebuild_index() {
-
-   vw_out(InfoMessage) << "Rebuilding index: " << m_plate_filename <<"\n";
-
-   // index in blob_filenames is the blobfile id
-   std::vector<std::string> blob_files = this->blob_filenames();
-   for (uint32 blob_id = 0; blob_id < blob_files.size(); ++blob_id) {
-     const std::string& name = blob_files[blob_id];
-     if (name.empty())
-       continue;
-
-     TerminalProgressCallback tpc("plate", "\t --> Rebuild from blob" + vw::stringify(blob_id) + " : ");
-     tpc.report_progress(0);
-
-     ReadBlob blob(name);
-
-     IndexRecord rec;
-     typedef Blob::iterator iter_t;
-     for (iter_t tile = blob.begin(), end = blob.end(); tile != end; ++tile) {
-       const BlobTileRecord& hdr = *tile;
-       rec.set_blob_id(blob_id);
-       rec.set_blob_offset(tile.current_base_offset());
-       rec.set_filetype(hdr.hdr.filetype());
-       this->write_update(hdr.hdr, rec);
-       tpc.report_progress(float(tile.current_base_offset()) / float(blob.size()));
+namespace {
+
+  // A tile found by rebuild_index(), and the index page it goes in.
+  struct RebuildRecord {
+    uint32 level, page_row, page_col;
+    uint32 blob_id;
+    uint64 blob_offset;
+    TileHeader hdr;
+
+    // By page, then in the order the tiles were written, so that the
+    // later of two tiles with the same transaction id wins, as it did
+    // when they were written.
+    bool operator<(const RebuildRecord& b) const {
+      if (level    != b.level)    return level    < b.level;
+      if (page_row != b.page_row) return page_row < b.page_row;
+      if (page_col != b.page_col) return page_col < b.page_col;
+      if (blob_id  != b.blob_id)  return blob_id  < b.blob_id;
+      return blob_offset < b.blob_offset;
+    }
+    bool same_page(const RebuildRecord& b) const {
+      return level == b.level && page_row == b.page_row && page_col == b.page_col;
     }
-    tpc.report_finished();
+  };
+
+  // Reads the tile headers (but not the tiles) of one blob.
+  class ScanBlob {
+    public:
+      typedef void result_type;
+    private:
+      std::string m_name;
+      uint32 m_blob_id;
+      Vector2i m_page_size;
+      std::vector<RebuildRecord>& m_out;
+    public:
+      ScanBlob(std::string const& name, uint32 blob_id, Vector2i page_size, std::vector<RebuildRecord>& out)
+        : m_name(name), m_blob_id(blob_id), m_page_size(page_size), m_out(out) {}
+
+      void operator()() const {
+        ReadBlob blob(m_name);
+        std::vector<uint64> offsets = blob.record_offsets();
+        m_out.resize(offsets.size());
+        for (size_t i = 0; i < offsets.size(); ++i) {
+          RebuildRecord& r = m_out[i];
+          r.hdr         = blob.read_header(offsets[i]);
+          r.level       = r.hdr.level();
+          r.page_row    = r.hdr.row() / m_page_size[1];
+          r.page_col    = r.hdr.col() / m_page_size[0];
+          r.blob_id     = m_blob_id;
+          r.blob_offset = offsets[i];
+        }
+      }
+  };
+
+  // Adds the records of the pages starting at page_starts[begin, end) to
+  // the page files, one page at a time.
+  class WritePages {
+    public:
+      typedef void result_type;
+    private:
+      boost::shared_ptr<PageGeneratorFactory> m_pages;
+      Vector2i m_page_size;
+      std::vector<RebuildRecord> const& m_records;
+      std::vector<size_t> const& m_page_starts;
+      std::vector<boost::shared_ptr<TileFilter> > const& m_filters;
+      size_t m_begin, m_end;
+    public:
+      WritePages(boost::shared_ptr<PageGeneratorFactory> pages, Vector2i page_size,
+                 std::vector<RebuildRecord> const& records, std::vector<size_t> const& page_starts,
+                 std::vector<boost::shared_ptr<TileFilter> > const& filters, size_t begin, size_t end)
+        : m_pages(pages), m_page_size(page_size), m_records(records), m_page_starts(page_starts),
+          m_filters(filters), m_begin(begin), m_end(end) {}
+
+      void operator()() const {
+        IndexRecord rec;
+        for (size_t p = m_begin; p < m_end; ++p) {
+          const RebuildRecord& first = m_records[m_page_starts[p]];
+          boost::shared_ptr<IndexPage> page =
+            m_pages->create(first.level, first.page_col * m_page_size[0], first.page_row * m_page_size[1],
+                            m_page_size[0], m_page_size[1])->generate();
+          TileFilter* filter = first.level < m_filters.size() ? m_filters[first.level].get() : 0;
+
+          for (size_t i = m_page_starts[p]; i < m_page_starts[p+1]; ++i) {
+            const RebuildRecord& r = m_records[i];
+            rec.set_blob_id(r.blob_id);
+            rec.set_blob_offset(r.blob_offset);
+            rec.set_filetype(r.hdr.filetype());
+            page->set(r.hdr, rec);
+            if (filter)
+              filter->insert(r.hdr.col(), r.hdr.row());
+          }
+          page->sync();
+        }
+      }
+  };
+
+  // Runs the tasks on a thread pool and waits for them.
+  template <class TaskT>
+  void run_all(std::vector<TaskT> const& tasks) {
+    FifoWorkQueue queue(std::max(vw_settings().default_num_threads(), 1u));
+    std::vector<Future<void> > futures;
+    BOOST_FOREACH(TaskT const& t, tasks)
+      futures.push_back(queue.submit(t));
+    when_all(futures);
   }
 }
 
+std::string LocalIndex::rebuild_checkpoint_filename() const {
+  return m_plate_filename + "/index/rebuild_checkpoint";
+}
+
+// Rebuilds the index from the tile headers saved in the blobs.  The
+// blobs are scanned a batch at a time, several at once; each batch's
+// records are sorted by page, and each page file it touches is loaded,
+// given all of its new records, and saved once.  After each batch its
+// blob ids are appended to the checkpoint file, and a rebuild that
+// finds a checkpoint skips those blobs.
+void LocalIndex::rebuild_index(const ProgressCallback& progress) {
+
+  vw_out(InfoMessage) << "Rebuilding index: " << m_plate_filename <<"\n";
+
+  // Pages are written behind the levels' backs, so save and drop
+  // whatever they have cached, and stop using the (now wrong) filters.
+  this->sync();
+  if (this->has_tile_filters())
+    this->tile_filters_changed();
+  this->clear_tile_filters();
+  m_levels.clear();
+  for (uint32 level = 0; level < m_header.num_levels(); ++level)
+    m_levels.push_back(make_level(level));
+
+  fs::create_directories(m_plate_filename + "/index");
+  std::set<uint32> done;
+  {
+    std::ifstream checkpoint(this->rebuild_checkpoint_filename().c_str());
+    uint32 blob_id;
+    while (checkpoint >> blob_id)
+      done.insert(blob_id);
+  }
+  const bool resumed = !done.empty();
+  if (resumed)
+    vw_out(InfoMessage) << "\t--> Resuming: " << done.size() << " blobs were already indexed.\n";
+
+  // index in blob_filenames is the blobfile id
+  std::vector<std::string> blob_files = this->blob_filenames();
+  std::vector<uint32> todo;
+  uint64 total_bytes = 0, done_bytes = 0;
+  for (uint32 blob_id = 0; blob_id < blob_files.size(); ++blob_id) {
+    if (blob_files[blob_id].empty() || done.count(blob_id))
+      continue;
+    todo.push_back(blob_id);
+    total_bytes += fs::file_size(blob_files[blob_id]);
+  }
+
+  const Vector2i page_size = this->page_size();
+  boost::shared_ptr<PageGeneratorFactory> pages(new LocalPageGeneratorFactory(m_plate_filename));
+  std::vector<boost::shared_ptr<TileFilter> > filters;
+  for (uint32 level = 0; level < m_levels.size(); ++level)
+    filters.push_back(make_filter(level));
+
+  const uint32 num_threads = std::max(vw_settings().default_num_threads(), 1u);
+  const size_t blobs_per_batch = 2 * num_threads;
+  progress.report_progress(0);
+
+  for (size_t batch = 0; batch < todo.size(); batch += blobs_per_batch) {
+    progress.abort_if_requested();
+    const size_t batch_end = std::min(batch + blobs_per_batch, todo.size());
+
+    // Scan the batch's blobs in parallel...
+    std::vector<std::vector<RebuildRecord> > scanned(batch_end - batch);
+    {
+      std::vector<ScanBlob> tasks;
+      for (size_t i = batch; i < batch_end; ++i)
+        tasks.push_back(ScanBlob(blob_files[todo[i]], todo[i], page_size, scanned[i - batch]));
+      run_all(tasks);
+    }
+
+    std::vector<RebuildRecord> records;
+    BOOST_FOREACH(std::vector<RebuildRecord>& v, scanned) {
+      records.insert(records.end(), v.begin(), v.end());
+      std::vector<RebuildRecord>().swap(v);
+    }
+    std::sort(records.begin(), records.end());
+
+    // ...make room for any new levels...
+    uint32 levels = boost::numeric_cast<uint32>(m_levels.size());
+    if (!records.empty() && records.back().level >= levels) {
+      for (uint32 level = levels; level <= records.back().level; ++level) {
+        m_levels.push_back(make_level(level));
+        filters.push_back(make_filter(level));
+      }
+      m_header.set_num_levels(boost::numeric_cast<uint32>(m_levels.size()));
+      this->save_index_file();
+    }
+
+    // ...then write each page the batch touches, several at once.
+    std::vector<size_t> page_starts;
+    for (size_t i = 0; i < records.size(); ++i)
+      if (i == 0 || !records[i].same_page(records[i-1]))
+        page_starts.push_back(i);
+    const size_t num_pages = page_starts.size();
+    page_starts.push_back(records.size());
+
+    if (num_pages > 0) {
+      std::vector<WritePages> tasks;
+      const size_t chunk = std::max(num_pages / (4 * num_threads), size_t(1));
+      for (size_t p = 0; p < num_pages; p += chunk)
+        tasks.push_back(WritePages(pages, page_size, records, page_starts, filters, p, std::min(p + chunk, num_pages)));
+      run_all(tasks);
+    }
+
+    {
+      std::ofstream checkpoint(this->rebuild_checkpoint_filename().c_str(), std::ios::app);
+      for (size_t i = batch; i < batch_end; ++i)
+        checkpoint << todo[i] << "\n";
+      if (!checkpoint.good())
+        vw_throw(IOErr() << "LocalIndex::rebuild_index(): could not update " << this->rebuild_checkpoint_filename());
+    }
+
+    for (size_t i = batch; i < batch_end; ++i)
+      done_bytes += fs::file_size(blob_files[todo[i]]);
+    progress.report_fractional_progress(double(done_bytes), double(total_bytes));
+    this->log() << "Rebuilt index from " << batch_end << " of " << todo.size() << " blobs ("
+                << records.size() << " tiles in " << num_pages << " pages).\n";
+  }
+
+  // The inline filters only saw this run's blobs.
+  if (resumed) {
+    this->build_tile_filters();
+  } else {
+    this->set_tile_filters(filters);
+    this->save_tile_filters();
+  }
+
+  fs::remove(this->rebuild_checkpoint_filename());
+  progress.report_finished();
+}
+
 // -----------------------    I/O      ----------------------
 
 /// Writing, pt. 1: Reserve a blob lock
@@ -426,8 +752,23 @@ void LocalIndex::write_update(TileHeader const& header, IndexRecord const& recor
   }
 }
 
+void LocalIndex::write_updates(WriteUpdates const& updates) {
+  size_t starting_size = m_levels.size();
+
+  BOOST_FOREACH(WriteUpdates::value_type const& u, updates)
+    PagedIndex::write_update(u.first, u.second);
+
+  if (m_levels.size() != starting_size) {
+    m_header.set_num_levels(boost::numeric_cast<uint32>(m_levels.size()));
+    this->save_index_file();
+  }
+}
+
 /// Writing, pt. 3: Signal the completion
-void LocalIndex::write_complete(uint32 blob_id) {
-  m_blob_manager->release_lock(blob_id);
+void LocalIndex::write_complete(uint32 blob_id, uint64 blob_size) {
+  if (blob_size)
+    m_blob_manager->release_lock(blob_id, blob_size);
+  else
+    m_blob_manager->release_lock(blob_id);
 }
 
@@ -10,6 +10,7 @@
 
 #include <vw/Plate/FundamentalTypes.h>
 #include <vw/Image/PixelTypeInfo.h>
+#include <vw/Core/ProgressCallback.h>
 #include <vw/Plate/detail/PagedIndex.h>
 
 namespace vw {
@@ -97,9 +98,19 @@ namespace detail {
     void save_index_file() const;
     std::string index_filename() const;
     std::string log_filename() const;
+    std::string filter_filename() const;
+    std::string rebuild_checkpoint_filename() const;
     std::vector<std::string> blob_filenames() const;
 
     void open_impl();
+    void load_tile_filters();
+    void save_tile_filters();
+
+  protected:
+    /// Removes the saved filters, so that a crash before the next
+    /// sync() leaves an index without filters rather than one whose
+    /// filters miss tiles.
+    virtual void tile_filters_changed();
 
   public:
 
@@ -109,13 +120,23 @@ namespace detail {
     /// Open an existing index from a file on disk.
     LocalIndex( std::string plate_filename );
 
-    /// Destructor
-    virtual ~LocalIndex() {}
+    /// Destructor.  Saves the tile filters if they changed.
+    virtual ~LocalIndex();
 
     // Rebuild an index from blob file entries.  You should only do
     // this if you lose or corrupt an index.  This may take a long
-    // time.
-    void rebuild_index();
+    // time.  The blobs are scanned in parallel, and an interrupted
+    // rebuild picks up after the last batch of blobs it finished.
+    void rebuild_index(const ProgressCallback& progress = ProgressCallback::dummy_instance());
+
+    /// Builds the tile filters from the index pages on disk and saves
+    /// them.  Indexes made before there were tile filters, or whose
+    /// filters were lost in a crash, don't use filters until this is
+    /// run.
+    void build_tile_filters();
+
+    /// Saves the index pages, and the tile filters if they changed.
+    virtual void sync();
 
     /// Use this to send data to the index's logfile like this:
     ///
@@ -133,8 +154,12 @@ namespace detail {
     // unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record);
 
+    /// Writing, pt. 2, batched: the index header is saved at most
+    /// once for the whole batch.
+    virtual void write_updates(WriteUpdates const& updates);
+
     /// Writing, pt. 3: Signal the completion
-    virtual void write_complete(uint32 blob_id);
+    virtual void write_complete(uint32 blob_id, uint64 blob_size = 0);
 
     // ----------------------- PROPERTIES  ----------------------
 
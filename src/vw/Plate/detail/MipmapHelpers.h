@@ -10,9 +10,18 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <boost/tuple/tuple_comparison.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <vw/Plate/IndexData.pb.h>
+#include <vw/Plate/Datastore.h>
+#include <vw/Plate/PlateFile.h>
+#include <vw/FileIO/MemoryImageResource.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageIO.h>
 #include <vw/Math/BBox.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Core/Settings.h>
 
 namespace vw { namespace platefile { namespace detail {
 
@@ -81,6 +90,66 @@ struct SortByTid {
   }
 };
 
+// How many tiles to build between writes: enough to keep every thread
+// busy, few enough that the encoded tiles waiting to be written stay small.
+inline size_t tile_chunk_size() {
+  return 8 * std::max(vw_settings().default_num_threads(), 1u);
+}
+
+// Calls func(begin, end) on ranges covering [0, count), a few per thread,
+// and returns when they have all finished.  An exception thrown by func
+// is rethrown here.
+template <typename FuncT>
+void parallel_ranges(size_t count, const FuncT& func) {
+  const uint32 num_threads = vw_settings().default_num_threads();
+  if (num_threads < 2 || count < 2) {
+    func(0, count);
+    return;
+  }
+  const size_t range = std::max(count / (4 * size_t(num_threads)), size_t(1));
+  FifoWorkQueue queue(num_threads);
+  std::vector<Future<void> > futures;
+  for (size_t begin = 0; begin < count; begin += range)
+    futures.push_back(queue.submit(boost::bind<void>(boost::cref(func), begin, std::min(begin + range, count))));
+  when_all(futures);
+}
+
+// Decodes tiles[i] into *images[i].  The images must be distinct.
+template <typename PixelT>
+class DecodeTiles {
+    const Datastore::TileSearch& m_tiles;
+    const std::vector<ImageView<PixelT>*>& m_images;
+  public:
+    DecodeTiles(const Datastore::TileSearch& tiles, const std::vector<ImageView<PixelT>*>& images)
+      : m_tiles(tiles), m_images(images) {}
+    void operator()(size_t begin, size_t end) const {
+      for (size_t i = begin; i < end; ++i) {
+        const Tile& t = m_tiles[i];
+        boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
+        read_image(*m_images[i], *r);
+      }
+    }
+};
+
+// Turns on batched writes for the life of the object, if they were off.
+// Flush before it goes away; it only tries to on the way out of an error.
+class BatchWrites {
+    PlateFile& m_plate;
+    size_t m_old_size;
+  public:
+    BatchWrites(PlateFile& plate, size_t size) : m_plate(plate), m_old_size(plate.write_batch_size()) {
+      if (m_old_size <= 1)
+        m_plate.set_write_batch_size(size);
+    }
+    ~BatchWrites() {
+      try {
+        m_plate.set_write_batch_size(m_old_size);
+      } catch (const vw::Exception& e) {
+        vw_out(ErrorMessage, "platefile") << "Failed to write batched tiles: " << e.what() << "\n";
+      }
+    }
+};
+
 class RememberCallback : public SubProgressCallback {
     mutable double m_count;
     double m_total;
@@ -10,6 +10,8 @@
 #include <vw/Core/Debugging.h>
 
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -66,7 +68,7 @@ namespace {
   }
 }
 
-boost::shared_ptr<IndexPage> IndexLevel::load_page(uint32 col, uint32 row) const {
+IndexLevel::handle_t IndexLevel::page_handle(uint32 col, uint32 row) const {
   size_t idx = boost::numeric_cast<size_t>(this->page_id(col,row));
 
   Mutex::Lock lock(m_cache_mutex);
@@ -81,6 +83,35 @@ boost::shared_ptr<IndexPage> IndexLevel::load_page(uint32 col, uint32 row) const
   return m_cache_handles[idx];
 }
 
+boost::shared_ptr<IndexPage> IndexLevel::load_page(uint32 col, uint32 row) const {
+  handle_t handle = page_handle(col, row);
+
+  // Only pages loaded on demand set off prefetches, so prefetched
+  // pages don't go on to prefetch their own neighbors.
+  if (m_miss_hook && handle.missing())
+    m_miss_hook(m_level, col, row);
+  return handle;
+}
+
+void IndexLevel::set_cache_size(uint32 pages) {
+  m_cache.resize(pages);
+}
+
+void IndexLevel::prefetch_page(int32 col, int32 row) const {
+  const int32 tiles_per_side = 1 << m_level;
+  if (col < 0 || row < 0 || col >= tiles_per_side || row >= tiles_per_side)
+    return;
+  page_handle(col, row).prefetch();
+}
+
+void IndexLevel::prefetch_neighbors(uint32 col, uint32 row) const {
+  int32 page_col = floorto(col, m_page_width), page_row = floorto(row, m_page_height);
+  for (int32 j = -1; j <= 1; ++j)
+    for (int32 i = -1; i <= 1; ++i)
+      if (i != 0 || j != 0)
+        prefetch_page(page_col + i*int32(m_page_width), page_row + j*int32(m_page_height));
+}
+
 
 IndexLevel::~IndexLevel() {
   Mutex::Lock lock(m_cache_mutex);
@@ -110,14 +141,29 @@ void IndexLevel::sync() {
 
 /// Fetch the value of an index node at this level.
 IndexRecord IndexLevel::get(int32 col, int32 row, TransactionOrNeg transaction_id, bool exact_match) const {
+  if (!may_contain(col, row))
+    vw_throw(TileNotFoundErr() << "No Tiles exist at this location.");
   boost::shared_ptr<IndexPage> page = load_page(col, row);
   return page->get(col, row, transaction_id, exact_match);
 }
 
+bool IndexLevel::find(int32 col, int32 row, TransactionOrNeg transaction_id, bool exact_match,
+                      TileHeader& header, IndexRecord& record) const {
+  const int32 tiles_per_side = 1 << m_level;
+  if (col < 0 || row < 0 || col >= tiles_per_side || row >= tiles_per_side)
+    return false;
+  if (!may_contain(col, row))
+    return false;
+  boost::shared_ptr<IndexPage> page = load_page(col, row);
+  return page->find(col, row, transaction_id, exact_match, header, record);
+}
+
 /// Set the value of an index node at this level.
 void IndexLevel::set(TileHeader const& header, IndexRecord const& rec) {
   boost::shared_ptr<IndexPage> page = load_page(header.col(), header.row());
   page->set(header, rec);
+  if (m_filter)
+    m_filter->insert(header.col(), header.row());
 }
 
 namespace {
@@ -161,6 +207,8 @@ IndexLevel::search_by_location(uint32 col, uint32 row,
                                TransactionOrNeg start_transaction_id,
                                TransactionOrNeg end_transaction_id) const {
 
+  if (!may_contain(col, row))
+    return std::list<TileHeader>();
   boost::shared_ptr<IndexPage> page = load_page(col, row);
   return page->search_by_location(col, row, start_transaction_id, end_transaction_id);
 }
@@ -174,12 +222,84 @@ IndexLevel::search_by_location(uint32 col, uint32 row,
 PagedIndex::PagedIndex(boost::shared_ptr<PageGeneratorFactory> page_gen_factory,
                        uint32 page_width, uint32 page_height, uint32 default_cache_size)
   : m_page_gen_factory(page_gen_factory), m_page_width(page_width), m_page_height(page_height),
-    m_default_cache_size(default_cache_size) {}
+    m_default_cache_size(default_cache_size), m_prefetch(true),
+    m_use_filters(false), m_filters_dirty(false) {}
 
 /// Open an existing index from a file on disk.
 PagedIndex::PagedIndex(uint32 page_width, uint32 page_height, uint32 default_cache_size)
   : m_page_width(page_width), m_page_height(page_height),
-    m_default_cache_size(default_cache_size) {}
+    m_default_cache_size(default_cache_size), m_prefetch(true),
+    m_use_filters(false), m_filters_dirty(false) {}
+
+uint32 PagedIndex::level_cache_size(uint32 level) const {
+  uint32 tiles_per_side = 1 << level;
+  uint32 pages = ((tiles_per_side + m_page_width - 1) / m_page_width) *
+                 ((tiles_per_side + m_page_height - 1) / m_page_height);
+  return std::min(pages, m_default_cache_size);
+}
+
+boost::shared_ptr<IndexLevel> PagedIndex::make_level(uint32 level) const {
+  boost::shared_ptr<IndexLevel> new_level(
+      new IndexLevel(m_page_gen_factory, level, m_page_width, m_page_height, level_cache_size(level)) );
+  new_level->set_miss_hook(boost::bind(&PagedIndex::prefetch_around, this, _1, _2, _3));
+  if (m_use_filters)
+    new_level->set_filter(make_filter(level));
+  return new_level;
+}
+
+boost::shared_ptr<TileFilter> PagedIndex::make_filter(uint32 level) {
+  // Small levels don't need the default first stage.
+  const uint64 tiles = level < 6 ? uint64(1) << (2*level) : 4096;
+  return boost::shared_ptr<TileFilter>(new TileFilter(tiles));
+}
+
+void PagedIndex::set_tile_filters(std::vector<boost::shared_ptr<TileFilter> > const& filters) {
+  VW_ASSERT(filters.empty() || filters.size() == m_levels.size(),
+            LogicErr() << "set_tile_filters(): got " << filters.size() << " filters for " << m_levels.size() << " levels");
+  m_use_filters = true;
+  for (uint32 level = 0; level < m_levels.size(); ++level)
+    m_levels[level]->set_filter(filters.empty() ? make_filter(level) : filters[level]);
+}
+
+void PagedIndex::clear_tile_filters() {
+  m_use_filters = false;
+  m_filters_dirty = false;
+  for (uint32 level = 0; level < m_levels.size(); ++level)
+    m_levels[level]->set_filter(boost::shared_ptr<TileFilter>());
+}
+
+std::vector<boost::shared_ptr<TileFilter> > PagedIndex::tile_filters() const {
+  std::vector<boost::shared_ptr<TileFilter> > filters;
+  if (m_use_filters)
+    for (uint32 level = 0; level < m_levels.size(); ++level)
+      filters.push_back(m_levels[level]->filter());
+  return filters;
+}
+
+void PagedIndex::set_default_cache_size(uint32 size) {
+  m_default_cache_size = size;
+  for (uint32 level = 0; level < m_levels.size(); ++level)
+    m_levels[level]->set_cache_size(level_cache_size(level));
+}
+
+// A page at one level covers a quarter as many tiles' worth of pages
+// at the level below, and four times as many at the level above, so
+// the pages over and under it are the parent page and at most four
+// child pages.
+void PagedIndex::prefetch_around(uint32 level, uint32 col, uint32 row) const {
+  if (!this->prefetch())
+    return;
+
+  m_levels[level]->prefetch_neighbors(col, row);
+
+  uint32 page_col = col - col % m_page_width, page_row = row - row % m_page_height;
+  if (level > 0)
+    m_levels[level-1]->prefetch_page(page_col / 2, page_row / 2);
+  if (level+1 < m_levels.size())
+    for (uint32 j = 0; j < 2*m_page_height; j += m_page_height)
+      for (uint32 i = 0; i < 2*m_page_width; i += m_page_width)
+        m_levels[level+1]->prefetch_page(2*page_col + i, 2*page_row + j);
+}
 
 void PagedIndex::sync() {
   for (unsigned i = 0; i < m_levels.size(); ++i) {
@@ -213,18 +333,52 @@ IndexRecord PagedIndex::read_request(uint32 col, uint32 row, uint32 level,
   return rec;
 }
 
+PagedIndex::ReadResults PagedIndex::read_requests(std::vector<TileHeader> const& tiles,
+                                                  bool exact_transaction_match) {
+  // Visit the tiles sorted by level and page, remembering where each
+  // one's result goes.
+  std::vector<std::pair<uint64, size_t> > order;
+  order.reserve(tiles.size());
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    const TileHeader& t = tiles[i];
+    if (t.level() >= m_levels.size())
+      continue;
+    const uint32 tiles_per_side = 1u << t.level();
+    if (t.col() >= tiles_per_side || t.row() >= tiles_per_side)
+      continue;
+    uint64 key = (uint64(t.level()) << 32) | m_levels[t.level()]->page_id(t.col(), t.row());
+    order.push_back(std::make_pair(key, i));
+  }
+  std::sort(order.begin(), order.end());
+
+  ReadResults results(tiles.size());
+  for (size_t j = 0; j < order.size(); ++j) {
+    const TileHeader& t = tiles[order[j].second];
+    ReadResult& r = results[order[j].second];
+    r.found = m_levels[t.level()]->find(t.col(), t.row(), int32(t.transaction_id()),
+                                        exact_transaction_match, r.header, r.record);
+    if (r.found && r.record.filetype() == "default_to_index") {
+      r.record.set_filetype(this->tile_filetype());
+      r.header.set_filetype(this->tile_filetype());
+    }
+  }
+  return results;
+}
+
 void PagedIndex::write_update(TileHeader const& header, IndexRecord const& record) {
   // First, we check to make sure we have a sufficient number of
   // levels to save the requested data.  If not, we grow the levels
   // vector to the correct size.
 
-  for (uint32 level = m_levels.size(); level <= header.level(); ++level) {
-    boost::shared_ptr<IndexLevel> new_level(
-        new IndexLevel(m_page_gen_factory, level, m_page_width, m_page_height, m_default_cache_size) );
-    m_levels.push_back(new_level);
-  }
+  for (uint32 level = m_levels.size(); level <= header.level(); ++level)
+    m_levels.push_back(make_level(level));
 
   m_levels[header.level()]->set(header, record);
+
+  if (m_use_filters && !m_filters_dirty) {
+    m_filters_dirty = true;
+    this->tile_filters_changed();
+  }
 }
 
 
@@ -12,6 +12,9 @@
 #include <vw/Core/Cache.h>
 #include <vw/Plate/detail/Index.h>
 #include <vw/Plate/detail/IndexPage.h>
+#include <vw/Plate/detail/TileFilter.h>
+
+#include <boost/function.hpp>
 
 #include <vector>
 #include <list>
@@ -37,11 +40,21 @@ namespace detail {
     mutable std::vector<handle_t> m_cache_handles;
     mutable vw::Cache m_cache;
     mutable Mutex m_cache_mutex;
+    boost::function<void (uint32, uint32, uint32)> m_miss_hook;
+    boost::shared_ptr<TileFilter> m_filter;
+
+    // False if the filter rules out a tile at (col,row).
+    bool may_contain(int32 col, int32 row) const {
+      return !m_filter || m_filter->may_contain(col, row);
+    }
 
+    // The cache handle of the page holding (col,row), created if need be.
+    handle_t page_handle(uint32 col, uint32 row) const;
     boost::shared_ptr<IndexPage> load_page(uint32 col, uint32 row) const;
 
   public:
     typedef IndexPage::multi_value_type multi_value_type;
+    typedef boost::function<void (uint32 level, uint32 col, uint32 row)> MissHook;
 
     IndexLevel(boost::shared_ptr<PageGeneratorFactory> page_gen_factory,
                uint32 level, uint32 page_width, uint32 page_height, uint32 cache_size);
@@ -51,6 +64,30 @@ namespace detail {
     /// Sync any unsaved data in the index to disk.
     void sync();
 
+    /// The number of pages this level is divided into.
+    uint32 num_pages() const { return m_horizontal_pages * m_vertical_pages; }
+
+    /// Sets the number of pages this level keeps in memory.
+    void set_cache_size(uint32 pages);
+
+    /// Sets a function to call with the level and a tile location
+    /// whenever the page holding that tile is loaded on demand.
+    void set_miss_hook(MissHook const& hook) { m_miss_hook = hook; }
+
+    /// Sets the filter of the tile locations in this level.  While
+    /// there is one, reads of locations it rules out don't load a
+    /// page, and set() adds to it, so it must start out with every
+    /// tile the level already has.
+    void set_filter(boost::shared_ptr<TileFilter> filter) { m_filter = filter; }
+    boost::shared_ptr<TileFilter> filter() const { return m_filter; }
+
+    /// Starts loading the page holding (col,row) in the background, if
+    /// it is in the level and not already loaded or being loaded.
+    void prefetch_page(int32 col, int32 row) const;
+
+    /// Starts loading the eight pages around the one holding (col,row).
+    void prefetch_neighbors(uint32 col, uint32 row) const;
+
     // Returns the page id for a page within the level
     uint32 page_id(uint32 col, uint32 row) const;
 
@@ -60,6 +97,11 @@ namespace detail {
     /// Fetch the value of an index node at this level.
     IndexRecord get(int32 col, int32 row, TransactionOrNeg transaction_id, bool exact_match = false) const;
 
+    /// Like get(), but fills in the header too, and returns false
+    /// rather than throwing if there's no such record.
+    bool find(int32 col, int32 row, TransactionOrNeg transaction_id, bool exact_match,
+              TileHeader& header, IndexRecord& record) const;
+
     /// Set the value of an index node at this level.
     void set(TileHeader const& hdr, IndexRecord const& rec);
 
@@ -85,11 +127,47 @@ namespace detail {
     mutable std::vector<boost::shared_ptr<IndexLevel> > m_levels;
     uint32 m_page_width, m_page_height;
     uint32 m_default_cache_size;
+    bool m_prefetch;
+    bool m_use_filters, m_filters_dirty;
 
     void set_page_generator_factory(boost::shared_ptr<PageGeneratorFactory> page_gen_factory) {
       m_page_gen_factory = page_gen_factory;
     }
 
+    // Creates an IndexLevel for level, with its share of the cache and
+    // hooked up for prefetching.
+    boost::shared_ptr<IndexLevel> make_level(uint32 level) const;
+
+    // The number of pages to keep in memory for a level: the default
+    // cache size, but no more than the level has.
+    uint32 level_cache_size(uint32 level) const;
+
+    // Prefetches the pages around a page that was just loaded, and the
+    // pages over and under it in the levels above and below.
+    void prefetch_around(uint32 level, uint32 col, uint32 row) const;
+
+    // A new, empty tile filter for a level.
+    static boost::shared_ptr<TileFilter> make_filter(uint32 level);
+
+    /// Gives the levels tile filters: the ones given, or new, empty
+    /// ones if there are none.  The filters must hold every tile
+    /// already in the index; new levels get empty ones.
+    void set_tile_filters(std::vector<boost::shared_ptr<TileFilter> > const& filters
+                          = std::vector<boost::shared_ptr<TileFilter> >());
+
+    /// Stops using tile filters, e.g. while pages are written directly.
+    void clear_tile_filters();
+
+    /// Whether the tile filters changed since mark_tile_filters_clean().
+    bool tile_filters_dirty() const { return m_filters_dirty; }
+    void mark_tile_filters_clean() { m_filters_dirty = false; }
+
+    /// Called by write_update() the first time the tile filters change
+    /// after they were marked clean, before anything else about the
+    /// write can be saved.  A subclass that saves the filters should
+    /// make the saved copy unusable here.
+    virtual void tile_filters_changed() {}
+
   public:
     typedef IndexLevel::multi_value_type multi_value_type;
 
@@ -107,9 +185,24 @@ namespace detail {
     /// Sync any unsaved data in the index to disk.
     virtual void sync();
 
-    virtual void set_default_cache_size(uint32 size) {
-      m_default_cache_size = size;
-    }
+    /// Sets the number of pages each level keeps in memory.  Levels
+    /// with fewer pages than that keep them all.
+    virtual void set_default_cache_size(uint32 size);
+
+    /// Turns prefetching on or off.  When a page has to be loaded, its
+    /// neighbors and the pages over and under it in the adjacent levels
+    /// are loaded in the background, since region searches and
+    /// mipmapping are likely to want them next.  It is on by default,
+    /// for indexes whose pages can be loaded concurrently.
+    void set_prefetch(bool prefetch) { m_prefetch = prefetch; }
+
+    /// True if reads of tiles that were never written are answered
+    /// from per-level tile filters, without loading a page.
+    bool has_tile_filters() const { return m_use_filters; }
+
+    /// The levels' tile filters, if the index has them.
+    std::vector<boost::shared_ptr<TileFilter> > tile_filters() const;
+    bool prefetch() const { return m_prefetch && m_page_gen_factory && m_page_gen_factory->can_prefetch(); }
 
     // ----------------------- READ/WRITE REQUESTS  ----------------------
 
@@ -120,6 +213,8 @@ namespace detail {
     // come from the same page (no other ordering is implied)
     virtual uint64 page_id(uint32 col, uint32 row, uint32 level) const;
 
+    virtual Vector2i page_size() const { return Vector2i(m_page_width, m_page_height); }
+
     /// Attempt to access a tile in the index.  Throws an
     /// TileNotFoundErr if the tile cannot be found.
     ///
@@ -135,6 +230,11 @@ namespace detail {
     virtual IndexRecord read_request(uint32 col, uint32 row, uint32 level,
                                      TransactionOrNeg transaction_id, bool exact_transaction_match = false);
 
+    /// Reads the tiles a page at a time, so each page is looked up
+    /// once however the tiles are ordered.
+    virtual ReadResults read_requests(std::vector<TileHeader> const& tiles,
+                                      bool exact_transaction_match = false);
+
     // Writing, pt. 2: Supply information to update the index and
     // unlock the blob id.
     virtual void write_update(TileHeader const& header, IndexRecord const& record);
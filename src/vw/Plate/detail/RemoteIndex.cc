@@ -20,6 +20,7 @@ using namespace vw::platefile::detail;
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/foreach.hpp>
 #include <unistd.h>
 
 std::string split_url(Url& url) {
@@ -50,12 +51,69 @@ class RemoteIndex::LogRequestSink : public io::sink {
 };
 
 
+// ----------------------------------------------------------------------
+//                         REMOTE WRITE QUEUE
+// ----------------------------------------------------------------------
+
+namespace {
+  template <typename MessageT>
+  void delete_message(MessageT* msg) { delete msg; }
+}
+
+RemoteWriteQueue::RemoteWriteQueue(int platefile_id, boost::shared_ptr<IndexClient> client)
+  : m_platefile_id(platefile_id), m_client(client), m_pending(new IndexMultiWriteUpdate()),
+    m_packet_size(50), m_held(false) {}  // 50 is arbitrary, but probably good.
+
+RemoteWriteQueue::~RemoteWriteQueue() {
+  this->flush();
+}
+
+void RemoteWriteQueue::push(TileHeader const& header, IndexRecord const& record) {
+  Mutex::Lock lock(m_mutex);
+  IndexWriteUpdate* request = m_pending->mutable_write_updates()->Add();
+  request->set_platefile_id(m_platefile_id);
+  *(request->mutable_header()) = header;
+  *(request->mutable_record()) = record;
+  if (!m_held && size_t(m_pending->write_updates_size()) >= m_packet_size)
+    this->send();
+}
+
+void RemoteWriteQueue::hold() {
+  Mutex::Lock lock(m_mutex);
+  m_held = true;
+}
+
+void RemoteWriteQueue::flush() {
+  Mutex::Lock lock(m_mutex);
+  m_held = false;
+  this->send();
+  m_client->complete_all();
+}
+
+// Packets are sent without waiting for the reply, so the next one can be
+// filled while the server works on this one.  Any error turns up the next
+// time the client waits: at the latest, in flush().
+void RemoteWriteQueue::send() {
+  if (m_pending->write_updates_size() == 0)
+    return;
+  RpcNullMsg* response = new RpcNullMsg();
+  IndexClient::AsyncScope async(*m_client);
+  m_client->MultiWriteUpdate(m_client.get(), m_pending.get(), response,
+                             google::protobuf::NewCallback(&delete_message<RpcNullMsg>, response));
+  m_pending->Clear();
+}
+
+// ----------------------------------------------------------------------
+//                         REMOTE INDEX PAGE
+// ----------------------------------------------------------------------
+
 RemoteIndexPage::RemoteIndexPage(int platefile_id,
                                  boost::shared_ptr<IndexClient> client,
+                                 boost::shared_ptr<RemoteWriteQueue> write_queue,
                                  uint32 level, uint32 base_col, uint32 base_row,
                                  uint32 page_width, uint32 page_height)
   : IndexPage(level, base_col, base_row, page_width, page_height),
-    m_platefile_id(platefile_id), m_client(client)
+    m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue)
 {
   // Use the PageRequest RPC to fetch the remote page from the index
   // server.
@@ -92,39 +150,13 @@ void RemoteIndexPage::set(TileHeader const& header, IndexRecord const& record) {
   // First call up to the parent class and let the original code run.
   IndexPage::set(header, record);
 
-  // Save this write request to the queue, and flush the queue if it
-  // has gotten too full.  (We send an update to the index_server
-  // every 50 writes!)
-  IndexWriteUpdate request;
-  request.set_platefile_id(m_platefile_id);
-  *(request.mutable_header()) = header;
-  *(request.mutable_record()) = record;
-  m_write_queue.push(request);
-  static const unsigned write_queue_size = 50; // arbitrary, but probably good.
-  if (m_write_queue.size() >= write_queue_size)
-    this->flush_write_queue();
-}
-
-void RemoteIndexPage::flush_write_queue() {
-  if (m_write_queue.size() > 0) {
-
-    // For debugging:
-    //    std::cout << "Call to the new flush_write_queue() with "
-    //              << m_write_queue.size() << " entries.\n";
-
-    IndexMultiWriteUpdate request;
-    while (m_write_queue.size() > 0) {
-      *(request.mutable_write_updates()->Add()) = m_write_queue.front();
-      m_write_queue.pop();
-    }
-    RpcNullMsg response;
-    m_client->MultiWriteUpdate(m_client.get(), &request, &response, null_callback());
-
-  }
+  // Save this write request to the queue shared by all the pages,
+  // which sends them to the index_server in packets.
+  m_write_queue->push(header, record);
 }
 
 void RemoteIndexPage::sync() {
-  this->flush_write_queue();
+  m_write_queue->flush();
 }
 
 // ----------------------------------------------------------------------
@@ -133,16 +165,17 @@ void RemoteIndexPage::sync() {
 
 RemotePageGenerator::RemotePageGenerator( int platefile_id,
                                           boost::shared_ptr<IndexClient> client,
+                                          boost::shared_ptr<RemoteWriteQueue> write_queue,
                                           uint32 level, uint32 base_col, uint32 base_row,
                                           uint32 page_width, uint32 page_height)
-  : m_platefile_id(platefile_id), m_client(client), m_level(level),
+  : m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue), m_level(level),
     m_base_col(base_col), m_base_row(base_row),
     m_page_width(page_width), m_page_height(page_height) {}
 
 boost::shared_ptr<IndexPage>
 RemotePageGenerator::generate() const {
   return boost::shared_ptr<IndexPage>(
-      new RemoteIndexPage(m_platefile_id, m_client, m_level,
+      new RemoteIndexPage(m_platefile_id, m_client, m_write_queue, m_level,
                           m_base_col, m_base_row, m_page_width, m_page_height) );
 }
 
@@ -153,7 +186,7 @@ RemotePageGeneratorFactory::create(uint32 level, uint32 base_col, uint32 base_ro
 
   // Create the proper type of page generator.
   boost::shared_ptr<PageGeneratorBase> page_gen(
-    new RemotePageGenerator(m_platefile_id, m_client,
+    new RemotePageGenerator(m_platefile_id, m_client, m_write_queue,
                             level, base_col, base_row,
                             page_width, page_height) );
 
@@ -192,9 +225,11 @@ RemoteIndex::RemoteIndex(const Url& url_)
   m_short_plate_filename = response.short_plate_filename();
   m_full_plate_filename = response.full_plate_filename();
 
-  // Properly initialize the PageGenFactory and set it.
+  // Properly initialize the PageGenFactory and set it.  Its pages
+  // share one queue for their writes.
+  m_write_queue.reset(new RemoteWriteQueue(m_platefile_id, m_client));
   boost::shared_ptr<PageGeneratorFactory> factory(
-      new RemotePageGeneratorFactory(m_platefile_id, m_client));
+      new RemotePageGeneratorFactory(m_platefile_id, m_client, m_write_queue));
 
   this->set_page_generator_factory(factory);
   this->set_default_cache_size(m_url.query().get("cache_size", 100u));
@@ -232,9 +267,11 @@ RemoteIndex::RemoteIndex(const Url& url_, IndexHeader index_header_info)
   m_short_plate_filename = response.short_plate_filename();
   m_full_plate_filename = response.full_plate_filename();
 
-  // Properly initialize the PageGenFactory and set it.
+  // Properly initialize the PageGenFactory and set it.  Its pages
+  // share one queue for their writes.
+  m_write_queue.reset(new RemoteWriteQueue(m_platefile_id, m_client));
   boost::shared_ptr<PageGeneratorFactory> factory(
-      new RemotePageGeneratorFactory(m_platefile_id, m_client));
+      new RemotePageGeneratorFactory(m_platefile_id, m_client, m_write_queue));
 
   this->set_page_generator_factory(factory);
   this->set_default_cache_size(m_url.query().get("cache_size", 100u));
@@ -264,13 +301,54 @@ uint32 RemoteIndex::write_request() {
   return response.blob_id();
 }
 
+void RemoteIndex::write_updates(WriteUpdates const& updates) {
+  m_write_queue->hold();
+  try {
+    Index::write_updates(updates);
+  } catch (...) {
+    m_write_queue->flush();
+    throw;
+  }
+  m_write_queue->flush();
+}
+
+Index::ReadResults RemoteIndex::read_requests(std::vector<TileHeader> const& tiles,
+                                             bool exact_transaction_match) {
+  // Make sure the server has seen our own writes
+  m_write_queue->flush();
+
+  IndexMultiReadRequest request;
+  request.set_platefile_id(m_platefile_id);
+  request.set_exact_transaction_match(exact_transaction_match);
+  BOOST_FOREACH(const TileHeader& t, tiles)
+    *(request.add_tiles()) = t;
+
+  IndexMultiReadReply response;
+  m_client->MultiRead(m_client.get(), &request, &response, null_callback());
+
+  VW_ASSERT(response.results_size() == request.tiles_size(),
+            LogicErr() << "MultiRead returned " << response.results_size()
+                       << " results for " << request.tiles_size() << " tiles");
+
+  ReadResults results(tiles.size());
+  for (int i = 0; i < response.results_size(); ++i) {
+    const IndexReadResult& r = response.results(i);
+    results[i].found = r.found();
+    if (r.found()) {
+      results[i].header = r.header();
+      results[i].record = r.record();
+    }
+  }
+  return results;
+}
+
 /// Log a message to the platefile log.
 std::ostream& RemoteIndex::log() {
   return *m_logger;
 }
 
 /// Writing, pt. 3: Signal the completion
-void RemoteIndex::write_complete(uint32 blob_id) {
+void RemoteIndex::write_complete(uint32 blob_id, uint64 blob_size) {
 
   // First we make sure that we flush the write queue by synchronizing
   // all of the pages back to the index_server!  Otherwise the write
@@ -281,6 +359,8 @@ void RemoteIndex::write_complete(uint32 blob_id) {
   IndexWriteComplete request;
   request.set_platefile_id(m_platefile_id);
   request.set_blob_id(blob_id);
+  if (blob_size)
+    request.set_blob_size(blob_size);
 
   RpcNullMsg response;
   m_client->WriteComplete(m_client.get(), &request, &response, null_callback());
@@ -295,11 +375,8 @@ void RemoteIndex::update_header() const {
 
   // Make sure that the local (cached) number of levels matches the
   // number of levels on the server.
-  for (uint32 level = m_levels.size(); level < m_index_header.num_levels(); ++level) {
-    boost::shared_ptr<IndexLevel> new_level(
-        new IndexLevel(m_page_gen_factory, level, m_page_width, m_page_height, m_default_cache_size) );
-    m_levels.push_back(new_level);
-  }
+  for (uint32 level = m_levels.size(); level < m_index_header.num_levels(); ++level)
+    m_levels.push_back(make_level(level));
 }
 
 vw::uint32 RemoteIndex::num_levels() const {
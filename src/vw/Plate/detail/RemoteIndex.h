@@ -11,7 +11,8 @@
 #include <vw/Plate/detail/PagedIndex.h>
 #include <vw/Plate/detail/IndexPage.h>
 #include <vw/Plate/HTTPUtils.h>
-#include <queue>
+#include <vw/Core/Thread.h>
+#include <boost/scoped_ptr.hpp>
 
 namespace vw {
 namespace platefile {
@@ -20,14 +21,50 @@ namespace platefile {
   class RpcClient;
 
   class IndexService;
-  class IndexWriteUpdate;
+  class IndexMultiWriteUpdate;
 
   typedef RpcClient<IndexService> IndexClient;
 
 namespace detail {
 
   // ----------------------------------------------------------------------
-  //                         LOCAL INDEX PAGE
+  //                         REMOTE WRITE QUEUE
+  // ----------------------------------------------------------------------
+
+  /// Packetizes the index writes of all the pages of a RemoteIndex,
+  /// sending them to the index server together in MultiWriteUpdate
+  /// messages.
+  class RemoteWriteQueue {
+    int m_platefile_id;
+    boost::shared_ptr<IndexClient> m_client;
+    boost::scoped_ptr<IndexMultiWriteUpdate> m_pending;
+    size_t m_packet_size;
+    bool m_held;
+    Mutex m_mutex;
+
+    void send();
+
+  public:
+    RemoteWriteQueue(int platefile_id, boost::shared_ptr<IndexClient> client);
+    ~RemoteWriteQueue();
+
+    /// Queues a write, sending the queue once it holds packet_size()
+    /// writes unless it is being held.
+    void push(TileHeader const& header, IndexRecord const& record);
+
+    /// Holds the queue until the next flush(), so a batch of writes
+    /// goes to the server in a single message.
+    void hold();
+
+    /// Sends any queued writes, and releases the queue.
+    void flush();
+
+    size_t packet_size() const { return m_packet_size; }
+    void set_packet_size(size_t size) { m_packet_size = size; }
+  };
+
+  // ----------------------------------------------------------------------
+  //                         REMOTE INDEX PAGE
   // ----------------------------------------------------------------------
 
   class RemoteIndexPage : public IndexPage {
@@ -35,13 +72,13 @@ namespace detail {
     boost::shared_ptr<IndexClient> m_client;
 
     // For packetizing write requests.
-    std::queue<IndexWriteUpdate> m_write_queue;
-    void flush_write_queue();
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
   public:
 
     RemoteIndexPage(int platefile_id,
                     boost::shared_ptr<IndexClient> client,
+                    boost::shared_ptr<RemoteWriteQueue> write_queue,
                     uint32 level, uint32 base_col, uint32 base_row,
                     uint32 page_width, uint32 page_height);
 
@@ -61,12 +98,14 @@ namespace detail {
   class RemotePageGenerator : public PageGeneratorBase {
     int m_platefile_id;
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
     uint32 m_level, m_base_col, m_base_row;
     uint32 m_page_width, m_page_height;
 
   public:
     RemotePageGenerator( int platefile_id,
                          boost::shared_ptr<IndexClient> client,
+                         boost::shared_ptr<RemoteWriteQueue> write_queue,
                          uint32 level, uint32 base_col, uint32 base_row,
                          uint32 page_width, uint32 page_height );
     virtual ~RemotePageGenerator() {}
@@ -81,16 +120,21 @@ namespace detail {
   class RemotePageGeneratorFactory : public PageGeneratorFactory {
     int m_platefile_id;
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
   public:
-    RemotePageGeneratorFactory(int platefile_id, boost::shared_ptr<IndexClient> client)
-      : m_platefile_id(platefile_id), m_client(client) {}
+    RemotePageGeneratorFactory(int platefile_id, boost::shared_ptr<IndexClient> client,
+                               boost::shared_ptr<RemoteWriteQueue> write_queue)
+      : m_platefile_id(platefile_id), m_client(client), m_write_queue(write_queue) {}
     virtual ~RemotePageGeneratorFactory() {}
 
     virtual boost::shared_ptr<PageGeneratorBase>
     create(uint32 level, uint32 base_col, uint32 base_row, uint32 page_width, uint32 page_height);
 
     virtual std::string who() const;
+
+    // The pages all share one connection to the index server.
+    virtual bool can_prefetch() const { return false; }
   };
 
   // -------------------------------------------------------------------
@@ -106,6 +150,7 @@ namespace detail {
 
     // Remote connection
     boost::shared_ptr<IndexClient> m_client;
+    boost::shared_ptr<RemoteWriteQueue> m_write_queue;
 
     // Log streamer
     struct LogRequestSink;
@@ -128,12 +173,21 @@ namespace detail {
     // be used to write a tile.
     virtual uint32 write_request();
 
+    /// Writing, pt. 2, batched: The records are sent to the index
+    /// server in a single message.
+    virtual void write_updates(WriteUpdates const& updates);
+
     /// Writing, pt. 3: Signal the completion
-    virtual void write_complete(uint32 blob_id);
+    virtual void write_complete(uint32 blob_id, uint64 blob_size = 0);
 
     /// Log a message to the platefile log.
     virtual std::ostream& log();
 
+    /// Reads all the tiles with one MultiRead call to the index server
+    /// instead of fetching each of their pages.
+    virtual ReadResults read_requests(std::vector<TileHeader> const& tiles,
+                                      bool exact_transaction_match = false);
+
     virtual IndexHeader index_header() const;
 
     virtual uint32 platefile_id() const;
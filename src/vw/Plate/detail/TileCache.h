@@ -0,0 +1,220 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#ifndef __VW_PLATE_DETAIL_TILECACHE_H__
+#define __VW_PLATE_DETAIL_TILECACHE_H__
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/System.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Plate/PlateFile.h>
+#include <vw/FileIO/MemoryImageResource.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageIO.h>
+
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/bind.hpp>
+#include <map>
+
+namespace vw {
+namespace platefile {
+namespace detail {
+
+  /// Generates one decoded tile for the TileCache.  A tile that was just
+  /// read and decoded is handed over as the seed, so the first generate()
+  /// costs nothing.  If the cache evicts the tile and someone still holds
+  /// the handle, it's read again from the plate it came from.
+  template <class PixelT>
+  class TileGenerator {
+      boost::weak_ptr<ReadOnlyPlateFile> m_plate;
+      TileHeader m_hdr;
+      size_t m_size;
+      mutable boost::shared_ptr<ImageView<PixelT> > m_seed;
+    public:
+      typedef ImageView<PixelT> value_type;
+
+      TileGenerator(boost::shared_ptr<ReadOnlyPlateFile> plate, const TileHeader& hdr,
+                    boost::shared_ptr<ImageView<PixelT> > seed)
+        : m_plate(plate), m_hdr(hdr), m_seed(seed) {
+        const size_t tile_size = plate->default_tile_size();
+        m_size = tile_size * tile_size * sizeof(PixelT);
+      }
+
+      size_t size() const { return m_size; }
+
+      boost::shared_ptr<ImageView<PixelT> > generate() const {
+        boost::shared_ptr<ImageView<PixelT> > image;
+        if (m_seed) {
+          image.swap(m_seed);
+          return image;
+        }
+        boost::shared_ptr<ReadOnlyPlateFile> plate = m_plate.lock();
+        VW_ASSERT(plate, LogicErr() << "TileCache: the plate of evicted tile " << m_hdr << " is closed");
+        image.reset(new ImageView<PixelT>());
+        plate->read(*image, m_hdr.col(), m_hdr.row(), m_hdr.level(), m_hdr.transaction_id(), true);
+        return image;
+      }
+  };
+
+  /// Decoded plate tiles, shared by every PlateView of the same pixel type
+  /// and kept in the system cache.  Tiles are keyed by the platefile id and
+  /// the tile's exact location and transaction, so a tile that is
+  /// rewritten (in a later transaction) is never served stale.
+  template <class PixelT>
+  class TileCache {
+    public:
+      typedef Cache::Handle<TileGenerator<PixelT> > handle_t;
+
+    private:
+      typedef boost::tuple<uint32, uint32, uint32, uint32, uint32> key_t; // id, level, col, row, tid
+      typedef std::map<key_t, handle_t> map_t;
+
+      Mutex m_mutex;
+      map_t m_tiles;
+      size_t m_prune_at;
+
+      static RunOnce s_once;
+      static TileCache* s_instance;
+      static void init() { s_instance = new TileCache(); }
+
+      TileCache() : m_prune_at(1024) {}
+
+      static key_t key(uint32 platefile_id, const TileHeader& hdr) {
+        return key_t(platefile_id, hdr.level(), hdr.col(), hdr.row(), hdr.transaction_id());
+      }
+
+      // Evicted tiles keep their map entries (a handle is small), so drop
+      // them now and then, or the map would grow without bound.
+      void locked_prune() {
+        if (m_tiles.size() < m_prune_at)
+          return;
+        for (typename map_t::iterator i = m_tiles.begin(); i != m_tiles.end();) {
+          if (i->second.missing())
+            m_tiles.erase(i++);
+          else
+            ++i;
+        }
+        m_prune_at = std::max(2 * m_tiles.size(), size_t(1024));
+      }
+
+      class DecodeRange {
+          const Datastore::TileSearch& m_tiles;
+          std::vector<boost::shared_ptr<ImageView<PixelT> > >& m_images;
+        public:
+          typedef void result_type;
+          DecodeRange(const Datastore::TileSearch& tiles, std::vector<boost::shared_ptr<ImageView<PixelT> > >& images)
+            : m_tiles(tiles), m_images(images) {}
+          void operator()(size_t begin, size_t end) const {
+            for (size_t i = begin; i < end; ++i) {
+              const Tile& t = m_tiles[i];
+              boost::scoped_ptr<SrcImageResource> r(SrcMemoryImageResource::open(t.hdr.filetype(), &t.data->operator[](0), t.data->size()));
+              m_images[i].reset(new ImageView<PixelT>());
+              read_image(*m_images[i], *r);
+            }
+          }
+      };
+
+      // Decodes tiles[i] into images[i], a range of tiles per task.
+      static void decode(const Datastore::TileSearch& tiles, std::vector<boost::shared_ptr<ImageView<PixelT> > >& images) {
+        images.resize(tiles.size());
+        DecodeRange func(tiles, images);
+        const uint32 num_threads = vw_settings().default_num_threads();
+        if (num_threads < 2 || tiles.size() < 2) {
+          func(0, tiles.size());
+          return;
+        }
+        const size_t range = std::max(tiles.size() / (4 * size_t(num_threads)), size_t(1));
+        FifoWorkQueue queue(num_threads);
+        std::vector<Future<void> > futures;
+        for (size_t begin = 0; begin < tiles.size(); begin += range)
+          futures.push_back(queue.submit(boost::bind<void>(boost::cref(func), begin, std::min(begin + range, tiles.size()))));
+        when_all(futures);
+      }
+
+    public:
+      static TileCache& instance() {
+        s_once.run(init);
+        return *s_instance;
+      }
+
+      /// Returns a handle to each of hdrs' tiles, in the same order.  The
+      /// tiles that aren't cached are read from the plate in one batch and
+      /// decoded in parallel.
+      std::vector<handle_t> get(boost::shared_ptr<ReadOnlyPlateFile> plate, uint32 platefile_id,
+                                const std::vector<TileHeader>& hdrs) {
+        std::vector<handle_t> handles(hdrs.size());
+        std::map<key_t, size_t> wanted;
+        Datastore::TileSearch misses;
+        {
+          Mutex::Lock lock(m_mutex);
+          for (size_t i = 0; i < hdrs.size(); ++i) {
+            key_t k = key(platefile_id, hdrs[i]);
+            typename map_t::const_iterator it = m_tiles.find(k);
+            if (it != m_tiles.end() && !it->second.missing())
+              handles[i] = it->second;
+            else if (wanted.insert(std::make_pair(k, i)).second)
+              misses.push_back(Tile(hdrs[i]));
+          }
+        }
+        if (misses.empty())
+          return handles;
+
+        // The datastore sorts the tiles to keep blob reads together, and
+        // drops any it can't read.
+        plate->batch_read(misses);
+        std::vector<boost::shared_ptr<ImageView<PixelT> > > images;
+        decode(misses, images);
+
+        // Hand each image to its cache line before the line is published,
+        // so nobody else sees it as missing and reads the tile again.
+        std::vector<handle_t> fresh(misses.size());
+        for (size_t i = 0; i < misses.size(); ++i) {
+          fresh[i] = vw_system_cache().insert(TileGenerator<PixelT>(plate, misses[i].hdr, images[i]));
+          images[i].reset();
+          boost::shared_ptr<ImageView<PixelT> > filled = fresh[i];
+        }
+
+        Mutex::Lock lock(m_mutex);
+        for (size_t i = 0; i < misses.size(); ++i) {
+          key_t k = key(platefile_id, misses[i].hdr);
+          m_tiles[k] = fresh[i];
+          handles[wanted[k]] = fresh[i];
+        }
+        // Headers asked for twice share the first one's handle.
+        for (size_t i = 0; i < hdrs.size(); ++i)
+          if (!handles[i].attached()) {
+            std::map<key_t, size_t>::const_iterator w = wanted.find(key(platefile_id, hdrs[i]));
+            if (w != wanted.end())
+              handles[i] = handles[w->second];
+          }
+        locked_prune();
+        return handles;
+      }
+
+      /// Forgets every cached tile.
+      void clear() {
+        Mutex::Lock lock(m_mutex);
+        m_tiles.clear();
+        m_prune_at = 1024;
+      }
+
+      size_t size() {
+        Mutex::Lock lock(m_mutex);
+        return m_tiles.size();
+      }
+  };
+
+  template <class PixelT> RunOnce TileCache<PixelT>::s_once = VW_RUNONCE_INIT;
+  template <class PixelT> TileCache<PixelT>* TileCache<PixelT>::s_instance = 0;
+
+}}} // namespace vw::platefile::detail
+
+#endif // __VW_PLATE_DETAIL_TILECACHE_H__
@@ -0,0 +1,169 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/Plate/detail/TileFilter.h>
+#include <vw/Core/Exception.h>
+#include <boost/foreach.hpp>
+#include <cmath>
+#include <istream>
+#include <ostream>
+
+using namespace vw;
+using namespace vw::platefile::detail;
+
+namespace {
+  const uint32 FILTER_MAGIC = 0x46545756; // "VWTF"
+  const uint32 FILTER_VERSION = 1;
+
+  // The false-positive rate of the first stage; each later stage has
+  // half the rate of the one before, so the total stays under twice this.
+  const double FIRST_STAGE_RATE = 0.01;
+
+  // splitmix64's finalizer: a cheap, well-mixed 64-bit hash.
+  uint64 mix(uint64 x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+  }
+
+  // The two hashes of a location.  The stages' probes are h1 + i*h2.
+  void tile_hash(uint32 col, uint32 row, uint64& h1, uint64& h2) {
+    uint64 key = (uint64(col) << 32) | row;
+    h1 = mix(key);
+    h2 = mix(key ^ 0x9e3779b97f4a7c15ULL) | 1;
+  }
+
+  template <class T>
+  void write_pod(std::ostream& ostr, T const& x) {
+    ostr.write(reinterpret_cast<const char*>(&x), sizeof(T));
+  }
+
+  template <class T>
+  void read_pod(std::istream& istr, T& x, const char* what) {
+    istr.read(reinterpret_cast<char*>(&x), sizeof(T));
+    VW_ASSERT(istr.good(), IOErr() << "TileFilter: while reading " << what << ".");
+  }
+}
+
+TileFilter::TileFilter(uint64 first_capacity)
+  : m_first_capacity(std::max(first_capacity, uint64(64))) {}
+
+void TileFilter::add_stage() {
+  const size_t i = m_stages.size();
+  const double rate = FIRST_STAGE_RATE / double(uint64(1) << std::min(i, size_t(32)));
+
+  Stage s;
+  s.capacity = m_first_capacity << std::min(i, size_t(32));
+  s.count    = 0;
+  s.hashes   = uint32(std::ceil(-std::log(rate) / std::log(2.0)));
+  const uint64 bits = uint64(std::ceil(double(s.capacity) * s.hashes / std::log(2.0)));
+  s.bits.assign((bits + 63) / 64, 0);
+  m_stages.push_back(s);
+}
+
+bool TileFilter::locked_may_contain(uint64 h1, uint64 h2) const {
+  BOOST_FOREACH(const Stage& s, m_stages) {
+    const uint64 nbits = s.bits.size() * 64;
+    bool all = true;
+    for (uint32 i = 0; i < s.hashes && all; ++i) {
+      uint64 bit = (h1 + i*h2) % nbits;
+      all = (s.bits[bit / 64] >> (bit % 64)) & 1;
+    }
+    if (all)
+      return true;
+  }
+  return false;
+}
+
+void TileFilter::insert(uint32 col, uint32 row) {
+  uint64 h1, h2;
+  tile_hash(col, row, h1, h2);
+
+  Mutex::Lock lock(m_mutex);
+  // Don't count a location twice (it's usually there already, from an
+  // earlier transaction), or the stages would fill up early.
+  if (locked_may_contain(h1, h2))
+    return;
+
+  if (m_stages.empty() || m_stages.back().count >= m_stages.back().capacity)
+    add_stage();
+
+  Stage& s = m_stages.back();
+  const uint64 nbits = s.bits.size() * 64;
+  for (uint32 i = 0; i < s.hashes; ++i) {
+    uint64 bit = (h1 + i*h2) % nbits;
+    s.bits[bit / 64] |= uint64(1) << (bit % 64);
+  }
+  ++s.count;
+}
+
+bool TileFilter::may_contain(uint32 col, uint32 row) const {
+  uint64 h1, h2;
+  tile_hash(col, row, h1, h2);
+  Mutex::Lock lock(m_mutex);
+  return locked_may_contain(h1, h2);
+}
+
+uint64 TileFilter::size() const {
+  Mutex::Lock lock(m_mutex);
+  uint64 n = 0;
+  BOOST_FOREACH(const Stage& s, m_stages)
+    n += s.count;
+  return n;
+}
+
+uint64 TileFilter::memory_size() const {
+  Mutex::Lock lock(m_mutex);
+  uint64 n = 0;
+  BOOST_FOREACH(const Stage& s, m_stages)
+    n += s.bits.size() * sizeof(uint64);
+  return n;
+}
+
+void TileFilter::serialize(std::ostream& ostr) const {
+  Mutex::Lock lock(m_mutex);
+  write_pod(ostr, FILTER_MAGIC);
+  write_pod(ostr, FILTER_VERSION);
+  write_pod(ostr, m_first_capacity);
+  write_pod(ostr, uint32(m_stages.size()));
+  BOOST_FOREACH(const Stage& s, m_stages) {
+    write_pod(ostr, s.hashes);
+    write_pod(ostr, s.capacity);
+    write_pod(ostr, s.count);
+    write_pod(ostr, uint64(s.bits.size()));
+    ostr.write(reinterpret_cast<const char*>(&s.bits[0]), s.bits.size() * sizeof(uint64));
+  }
+}
+
+void TileFilter::deserialize(std::istream& istr) {
+  uint32 magic, version, num_stages;
+  uint64 first_capacity;
+  read_pod(istr, magic, "the magic number");
+  VW_ASSERT(magic == FILTER_MAGIC, IOErr() << "TileFilter: not a tile filter.");
+  read_pod(istr, version, "the version");
+  VW_ASSERT(version == FILTER_VERSION, IOErr() << "TileFilter: unknown version " << version << ".");
+  read_pod(istr, first_capacity, "the first capacity");
+  read_pod(istr, num_stages, "the stage count");
+
+  std::vector<Stage> stages(num_stages);
+  BOOST_FOREACH(Stage& s, stages) {
+    uint64 words;
+    read_pod(istr, s.hashes, "a stage");
+    read_pod(istr, s.capacity, "a stage");
+    read_pod(istr, s.count, "a stage");
+    read_pod(istr, words, "a stage");
+    VW_ASSERT(words > 0 && s.hashes > 0, IOErr() << "TileFilter: corrupt stage.");
+    s.bits.resize(words);
+    istr.read(reinterpret_cast<char*>(&s.bits[0]), words * sizeof(uint64));
+    VW_ASSERT(istr.good(), IOErr() << "TileFilter: while reading a stage's bits.");
+  }
+
+  Mutex::Lock lock(m_mutex);
+  m_first_capacity = first_capacity;
+  m_stages.swap(stages);
+}
@@ -0,0 +1,68 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#ifndef __VW_PLATEFILE_TILE_FILTER_H__
+#define __VW_PLATEFILE_TILE_FILTER_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+#include <iosfwd>
+#include <vector>
+
+namespace vw {
+namespace platefile {
+namespace detail {
+
+  /// A TileFilter remembers which tile locations of a level have been
+  /// written, so that reads of locations that never were can fail
+  /// without loading their index page.  It is a Bloom filter: it never
+  /// misses a location that was inserted, and says yes to about one in
+  /// a hundred that weren't.
+  ///
+  /// The number of tiles a level will hold isn't known up front, so the
+  /// filter grows in stages (a "scalable" Bloom filter).  When a stage
+  /// is full, a new one twice its size with half its false-positive
+  /// rate is added; lookups check every stage.
+  class TileFilter {
+      struct Stage {
+        std::vector<uint64> bits;
+        uint32 hashes;
+        uint64 capacity, count;
+      };
+      std::vector<Stage> m_stages;
+      uint64 m_first_capacity;
+      mutable Mutex m_mutex;
+
+      void add_stage();
+      bool locked_may_contain(uint64 h1, uint64 h2) const;
+
+    public:
+      /// The first stage has room for first_capacity tiles.
+      explicit TileFilter(uint64 first_capacity = 4096);
+
+      /// Records that there is a tile at (col,row).
+      void insert(uint32 col, uint32 row);
+
+      /// False if no tile was ever inserted at (col,row).
+      bool may_contain(uint32 col, uint32 row) const;
+
+      /// The number of distinct locations inserted (give or take the
+      /// false positives, which aren't counted).
+      uint64 size() const;
+
+      /// The bytes of bitmap the filter uses.
+      uint64 memory_size() const;
+
+      void serialize(std::ostream& ostr) const;
+
+      /// Throws an IOErr if the stream doesn't hold a filter.
+      void deserialize(std::istream& istr);
+  };
+
+}}} // namespace vw::platefile::detail
+
+#endif // __VW_PLATEFILE_TILE_FILTER_H__
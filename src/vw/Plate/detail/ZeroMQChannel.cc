@@ -23,6 +23,11 @@ namespace pb = ::google::protobuf;
 
 static const uint8_t THREAD_COUNT = 10;
 
+// zeromq 2.0 only has the old name
+#ifndef ZMQ_DEALER
+#  define ZMQ_DEALER ZMQ_XREQ
+#endif
+
 namespace {
   vw::RunOnce zmq_init_once = VW_RUNONCE_INIT;
   boost::shared_ptr<zmq::context_t> zmq_ctx_ptr;
@@ -44,7 +49,7 @@ namespace {
   VW_ASSERT(m_id == Thread::id(), LogicErr() << "ZeroMQChannel created on thread " <<  m_id << " and used on thread " << Thread::id() << ". function: " << VW_CURRENT_FUNCTION)
 
 ZeroMQChannel::ZeroMQChannel(const std::string& human_name)
-  : m_ctx(get_ctx()), m_human_name(human_name), m_timeout(DEFAULT_TIMEOUT), m_retries(DEFAULT_RETRIES) {}
+  : m_ctx(get_ctx()), m_human_name(human_name), m_dealer(false), m_timeout(DEFAULT_TIMEOUT), m_retries(DEFAULT_RETRIES) {}
 
 ZeroMQChannel::~ZeroMQChannel() VW_NOTHROW {
   if (m_sock) {
@@ -55,6 +60,13 @@ ZeroMQChannel::~ZeroMQChannel() VW_NOTHROW {
 
 void ZeroMQChannel::send_bytes(const uint8* message, size_t len) {
   THREAD_CHECK();
+
+  if (m_dealer) {
+    zmq::message_t delimiter;
+    while (!m_sock->send(delimiter, ZMQ_SNDMORE))
+      Thread::sleep_ms(10);
+  }
+
   // send() just queues the message. need to copy it.
   zmq::message_t rmsg(len);
   ::memcpy(rmsg.data(), message, len);
@@ -102,6 +114,12 @@ bool ZeroMQChannel::recv_bytes(std::vector<uint8>* bytes) {
   while (!m_sock->recv(&rmsg))
     Thread::sleep_ms(10);
 
+  // Skip the delimiter. The rest of the message arrived with it.
+  if (m_dealer && rmsg.size() == 0) {
+    while (!m_sock->recv(&rmsg))
+      Thread::sleep_ms(10);
+  }
+
   bytes->clear();
   bytes->reserve(rmsg.size());
   std::copy(reinterpret_cast<const char*>(rmsg.data()),
@@ -111,11 +129,11 @@ bool ZeroMQChannel::recv_bytes(std::vector<uint8>* bytes) {
   return true;
 }
 
-void ZeroMQChannel::CallMethod(const pb::MethodDescriptor* method,
-                               pb::RpcController* /*controller*/,
-                               const pb::Message* request,
-                               pb::Message* response,
-                               pb::Closure* done)
+void ZeroMQChannel::call_sync(const pb::MethodDescriptor* method,
+                              pb::RpcController* /*controller*/,
+                              const pb::Message* request,
+                              pb::Message* response,
+                              pb::Closure* done)
 {
   detail::RequireCall call(done);
   RpcWrapper q_wrap, a_wrap;
@@ -123,20 +141,26 @@ void ZeroMQChannel::CallMethod(const pb::MethodDescriptor* method,
   q_wrap.set_method(method->name());
   q_wrap.set_payload(request->SerializeAsString());
   q_wrap.set_requestor(this->name());
+  q_wrap.set_seq(next_seq());
 
   for (uint32 trial = 0; trial <= m_retries; ++trial) {
     if (trial > 0)
       vw_out(WarningMessage) << "Retry (" << trial << "/" << m_retries << ")" << std::endl;
 
     send_message(q_wrap);
+CallMethod_receive_again:
     switch (recv_message(a_wrap)) {
       case 0:
-        // we can't recover from a timeout, since we can't send twice in a row
+        // The server may still be working on it, and sending it again would
+        // just queue up behind. Give up; a later call skips the late reply.
         vw_throw(NetworkErr() << "CallMethod Timeout.");
       case -1:
         vw_out(WarningMessage) << "CallMethod(): corrupted message. ";
         continue;
       default:
+        // A reply to an asynchronous call that timed out earlier
+        if (a_wrap.seq() != q_wrap.seq())
+          goto CallMethod_receive_again;
         throw_rpc_error(a_wrap.error());
         response->ParseFromString(a_wrap.payload());
         return;
@@ -186,7 +210,8 @@ void ZeroMQChannel::conn(const Url& endpoint_) {
   std::string url = endpoint.string();
   boost::algorithm::trim_right_if(url, boost::is_any_of("/"));
 
-  m_sock.reset(new zmq::socket_t(*m_ctx, ZMQ_REQ));
+  m_sock.reset(new zmq::socket_t(*m_ctx, ZMQ_DEALER));
+  m_dealer = true;
 
   // We use the c interface rather than the c++ one here to avoid having to
   // catch an exception and rethrow
@@ -31,6 +31,10 @@ namespace platefile {
       boost::shared_ptr<zmq::socket_t>  m_sock;
       std::string m_human_name;
       uint64 m_id;
+      // Clients use a DEALER socket, so several requests can be waiting for
+      // replies at once.  Their messages carry the empty delimiter frame a
+      // REP socket expects.
+      bool m_dealer;
       int32 m_timeout;
       uint32 m_retries;
 
@@ -39,6 +43,12 @@ namespace platefile {
       bool recv_bytes(std::vector<uint8>* bytes);
       void init_endpoint(Url& u);
 
+      virtual void call_sync(const google::protobuf::MethodDescriptor*,
+                             google::protobuf::RpcController*,
+                             const google::protobuf::Message*,
+                             google::protobuf::Message*,
+                             google::protobuf::Closure*);
+
     public:
       ZeroMQChannel(const std::string& human_name);
       virtual ~ZeroMQChannel() VW_NOTHROW;
@@ -52,12 +62,6 @@ namespace platefile {
       //uint64 queue_depth() const;
       std::string name() const;
 
-      virtual void CallMethod(const google::protobuf::MethodDescriptor*,
-                              google::protobuf::RpcController*,
-                              const google::protobuf::Message*,
-                              google::protobuf::Message*,
-                              google::protobuf::Closure*);
-
       // url format:
       // zmq://x -> maps directly to zmq urls
       void conn(const Url& server);
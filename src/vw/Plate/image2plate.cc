@@ -56,6 +56,8 @@ struct Options {
   optional<float> jpeg_quality;
   optional<unsigned> png_compression;
   size_t cache_size;
+  size_t write_batch;
+  std::vector<std::string> tile_variants;
   bool terrain;
   double nudge_x;
   double nudge_y;
@@ -74,6 +76,7 @@ struct Options {
     filetype("png"),
     tile_size(256),
     cache_size(0),
+    write_batch(64),
     terrain(false),
     nudge_x(0),
     nudge_y(0),
@@ -163,6 +166,8 @@ bool handle_options( int argc, char *argv[], Options& opt ) {
     ("jpeg-quality",          po::value(&opt.jpeg_quality),      "JPEG quality factor (0.0 to 1.0)")
     ("png-compression",       po::value(&opt.png_compression),   "PNG compression level (0 to 9)")
     ("cache",                 po::value(&opt.cache_size),        "Source data cache size, in megabytes")
+    ("write-batch",           po::value(&opt.write_batch),       "Number of tiles to write to the platefile at once")
+    ("tile-variant",          po::value(&opt.tile_variants)->composing(), "Also store each tile in this file type (e.g. jpg), for mod_plate to serve to clients that prefer it. May be repeated.")
     ("terrain",               po::bool_switch(&opt.terrain),     "Tweak a few settings that are best for terrain platefiles. Turns on nearest neighbor sampling in mipmapping and zero out semi-transparent pixels.")
     ("nudge-x",               po::value(&opt.nudge_x),           "Nudge the image, in projected coordinates")
     ("nudge-y",               po::value(&opt.nudge_y),           "Nudge the image, in projected coordinates")
@@ -242,6 +247,8 @@ void run(const Options& opt) {
     std::cout << "\nOpening plate file: " << opt.url.get() << std::endl;
     platefile.reset( new PlateFile(opt.url.get(), opt.mode, "", opt.tile_size, filetype, pixel_format, channel_type) );
   }
+  platefile->set_write_batch_size(opt.write_batch);
+  platefile->set_tile_variants(opt.tile_variants);
 
   BOOST_FOREACH(const std::string& filename, opt.image_files) {
     VW_ASSERT(fs::exists(filename), ArgumentErr() << "No such file: " << filename);
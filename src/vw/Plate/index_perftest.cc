@@ -5,69 +5,370 @@
 // __END_LICENSE__
 
 
+// index_perftest times the plate storage layers, so that regressions show
+// up and clusters can be sized.  Each benchmark runs --threads workers,
+// each of which opens its own connection (or plate) and does --count
+// operations; the report gives the throughput and latency percentiles.
+//
+//   rpc          Echo requests to the index server at --rpc-url.
+//   index-write  Index records written through the Index at --url.
+//   index-read   Index lookups (--batch at a time) of those records.
+//   store-write  Tiles of --tile-size bytes written to the Datastore at --url.
+//   store-read   Reads (index and data) of those tiles.
+//
+// A plain path or file:// url is a local plate (LocalIndex/Blobstore),
+// dir:// a Dirstore, and pf:// or zmq:// a remote index (RemoteIndex).
+// The read benchmarks read what the write benchmarks wrote, so run them
+// after: "index_perftest -u bench.plate index-write index-read".  Don't
+// point it at a plate you care about.
+
 #include <vw/Plate/Rpc.h>
 #include <vw/Plate/IndexService.h>
 #include <vw/Plate/HTTPUtils.h>
+#include <vw/Plate/Datastore.h>
+#include <vw/Plate/Exception.h>
+#include <vw/Plate/detail/Index.h>
 #include <vw/Core/Stopwatch.h>
-#include  <iostream>
+#include <vw/Core/ThreadPool.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
 
+#include <boost/foreach.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
 using namespace vw;
 using namespace vw::platefile;
-
-const static size_t BATCH_SIZE = 5000;
+namespace d = vw::platefile::detail;
 
 typedef RpcClient<IndexService> IndexClient;
 
-IndexClient* conn(const Url& url) {
-  std::cerr << "Connecting to index server at " << url.string() << std::endl;
-  return new IndexClient(url);
+namespace {
+
+  struct Options {
+    Url url, rpc_url;
+    uint32 threads, count, batch, tile_size, level;
+  };
+
+  // What one worker measured: the latency of each operation, in us.
+  struct WorkerResult {
+    std::vector<uint64> latencies;
+    uint64 errors;
+    WorkerResult() : errors(0) {}
+  };
+
+  struct BenchResult {
+    std::string name;
+    uint32 threads;
+    uint64 ops, errors, bytes;
+    double seconds;
+    uint64 p50, p90, p99, max;
+  };
+
+  IndexHeader bench_header(const Options& opt) {
+    IndexHeader hdr;
+    hdr.set_type("perftest");
+    hdr.set_description("index_perftest scratch plate");
+    hdr.set_tile_size(256);
+    hdr.set_tile_filetype("raw");
+    hdr.set_pixel_format(VW_PIXEL_GRAY);
+    hdr.set_channel_type(VW_CHANNEL_UINT8);
+    return hdr;
+  }
+
+  // Worker w's i'th tile: the workers cover the level row by row.
+  void tile_location(const Options& opt, uint32 worker, uint32 i, uint32& col, uint32& row) {
+    const uint64 n = uint64(worker) * opt.count + i;
+    const uint64 width = uint64(1) << opt.level;
+    col = uint32(n % width);
+    row = uint32(n / width);
+  }
+
+  bool is_local(const Url& url) {
+    return url.scheme() == "file" || url.scheme() == "" || url.scheme() == "dir";
+  }
+
+  // One worker of a benchmark.
+  class Worker {
+    public:
+      typedef void result_type;
+    private:
+      const std::string& m_name;
+      const Options& m_opt;
+      uint32 m_id;
+      WorkerResult& m_result;
+
+      void rpc() const {
+        boost::scoped_ptr<IndexClient> client(new IndexClient(m_opt.rpc_url));
+        for (uint32 i = 0; i < m_opt.count; ++i) {
+          IndexTestRequest request;
+          request.set_value(i);
+          IndexTestReply response;
+          uint64 t0 = Stopwatch::microtime();
+          client->TestRequest(client.get(), &request, &response, null_callback());
+          m_result.latencies.push_back(Stopwatch::microtime() - t0);
+          if (i != response.value())
+            m_result.errors++;
+        }
+      }
+
+      void index_write() const {
+        boost::shared_ptr<d::Index> index = d::Index::construct_create(m_opt.url, bench_header(m_opt));
+        Transaction t = index->transaction_request("index_perftest worker " + stringify(m_id), -1);
+        uint32 blob_id = index->write_request();
+        for (uint32 i = 0; i < m_opt.count; ++i) {
+          TileHeader hdr;
+          uint32 col, row;
+          tile_location(m_opt, m_id, i, col, row);
+          hdr.set_col(col);
+          hdr.set_row(row);
+          hdr.set_level(m_opt.level);
+          hdr.set_transaction_id(t);
+          hdr.set_filetype("raw");
+          d::IndexRecord rec;
+          rec.set_blob_id(blob_id);
+          rec.set_blob_offset(uint64(i) * m_opt.tile_size);
+          rec.set_filetype("raw");
+
+          uint64 t0 = Stopwatch::microtime();
+          index->write_update(hdr, rec);
+          m_result.latencies.push_back(Stopwatch::microtime() - t0);
+        }
+        index->write_complete(blob_id);
+        index->transaction_complete(t, true);
+        index->sync();
+      }
+
+      void index_read() const {
+        boost::shared_ptr<d::Index> index = d::Index::construct_open(m_opt.url);
+        for (uint32 i = 0; i < m_opt.count; i += m_opt.batch) {
+          const uint32 n = std::min(m_opt.batch, m_opt.count - i);
+          if (n == 1) {
+            uint32 col, row;
+            tile_location(m_opt, m_id, i, col, row);
+            uint64 t0 = Stopwatch::microtime();
+            try {
+              index->read_request(col, row, m_opt.level, -1);
+            } catch (const TileNotFoundErr&) {
+              m_result.errors++;
+            }
+            m_result.latencies.push_back(Stopwatch::microtime() - t0);
+            continue;
+          }
+
+          std::vector<TileHeader> tiles(n);
+          for (uint32 j = 0; j < n; ++j) {
+            uint32 col, row;
+            tile_location(m_opt, m_id, i+j, col, row);
+            tiles[j].set_col(col);
+            tiles[j].set_row(row);
+            tiles[j].set_level(m_opt.level);
+            tiles[j].set_transaction_id(-1);
+          }
+          uint64 t0 = Stopwatch::microtime();
+          d::Index::ReadResults res = index->read_requests(tiles);
+          m_result.latencies.push_back(Stopwatch::microtime() - t0);
+          BOOST_FOREACH(const d::Index::ReadResult& r, res)
+            if (!r.found)
+              m_result.errors++;
+        }
+      }
+
+      void store_write() const {
+        boost::scoped_ptr<Datastore> store(Datastore::open(m_opt.url, bench_header(m_opt)));
+        std::vector<uint8> data(m_opt.tile_size, uint8(m_id));
+        Transaction t = store->transaction_begin("index_perftest worker " + stringify(m_id));
+        boost::scoped_ptr<WriteState> state(store->write_request(t));
+        for (uint32 i = 0; i < m_opt.count; ++i) {
+          uint32 col, row;
+          tile_location(m_opt, m_id, i, col, row);
+          uint64 t0 = Stopwatch::microtime();
+          store->write_update(*state, m_opt.level, row, col, "raw", &data[0], data.size());
+          m_result.latencies.push_back(Stopwatch::microtime() - t0);
+        }
+        store->write_complete(*state);
+        store->transaction_end(t, true);
+        store->flush();
+      }
+
+      void store_read() const {
+        boost::scoped_ptr<Datastore> store(Datastore::open(m_opt.url));
+        Datastore::TileSearch tiles;
+        for (uint32 i = 0; i < m_opt.count; ++i) {
+          uint32 col, row;
+          tile_location(m_opt, m_id, i, col, row);
+          uint64 t0 = Stopwatch::microtime();
+          store->get(tiles, m_opt.level, row, col, TransactionRange(-1), 1);
+          m_result.latencies.push_back(Stopwatch::microtime() - t0);
+          if (tiles.size() != 1 || tiles[0].data->size() != m_opt.tile_size)
+            m_result.errors++;
+        }
+      }
+
+    public:
+      Worker(const std::string& name, const Options& opt, uint32 id, WorkerResult& result)
+        : m_name(name), m_opt(opt), m_id(id), m_result(result) {}
+
+      void operator()() const {
+        m_result.latencies.reserve(m_opt.count);
+        if      (m_name == "rpc")         rpc();
+        else if (m_name == "index-write") index_write();
+        else if (m_name == "index-read")  index_read();
+        else if (m_name == "store-write") store_write();
+        else if (m_name == "store-read")  store_read();
+        else vw_throw(ArgumentErr() << "Unknown benchmark \"" << m_name << "\"");
+      }
+  };
+
+  uint64 percentile(const std::vector<uint64>& sorted, double p) {
+    if (sorted.empty())
+      return 0;
+    size_t i = size_t(p * double(sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+  }
+
+  BenchResult run(const std::string& name, const Options& opt) {
+    const bool writes = name == "index-write" || name == "store-write";
+    if (writes && opt.threads > 1 && is_local(opt.url))
+      vw_throw(ArgumentErr() << name << ": a local plate takes one writer at a time; use --threads 1 or an index server url");
+    if (name == "rpc" && opt.rpc_url.string().empty())
+      vw_throw(ArgumentErr() << "rpc: needs --rpc-url");
+    if (name != "rpc" && opt.url.string().empty())
+      vw_throw(ArgumentErr() << name << ": needs --url");
+
+    std::vector<WorkerResult> results(opt.threads);
+    uint64 t0 = Stopwatch::microtime();
+    {
+      FifoWorkQueue queue(opt.threads);
+      std::vector<Future<void> > futures;
+      for (uint32 w = 0; w < opt.threads; ++w)
+        futures.push_back(queue.submit(Worker(name, opt, w, results[w])));
+      when_all(futures);
+    }
+    uint64 t1 = Stopwatch::microtime();
+
+    BenchResult r;
+    r.name    = name;
+    r.threads = opt.threads;
+    r.errors  = 0;
+    r.seconds = double(t1 - t0) / 1e6;
+    std::vector<uint64> all;
+    BOOST_FOREACH(const WorkerResult& w, results) {
+      all.insert(all.end(), w.latencies.begin(), w.latencies.end());
+      r.errors += w.errors;
+    }
+    r.ops   = uint64(opt.threads) * opt.count;
+    r.bytes = (name == "store-write" || name == "store-read") ? r.ops * opt.tile_size : 0;
+
+    std::sort(all.begin(), all.end());
+    r.p50 = percentile(all, 0.50);
+    r.p90 = percentile(all, 0.90);
+    r.p99 = percentile(all, 0.99);
+    r.max = all.empty() ? 0 : all.back();
+    return r;
+  }
+
+  void print(std::ostream& out, const BenchResult& r) {
+    out << r.name << ": " << r.ops << " ops in " << r.seconds << " s ("
+        << double(r.ops) / r.seconds << " ops/s";
+    if (r.bytes)
+      out << ", " << double(r.bytes) / r.seconds / (1024*1024) << " MiB/s";
+    out << ") with " << r.threads << " threads; latency us p50 " << r.p50 << ", p90 " << r.p90
+        << ", p99 " << r.p99 << ", max " << r.max;
+    if (r.errors)
+      out << "; " << r.errors << " ERRORS";
+    out << std::endl;
+  }
+
+  void write_json(std::ostream& out, const std::vector<BenchResult>& results, const Options& opt) {
+    out << "{\n  \"tile_size\": " << opt.tile_size << ", \"level\": " << opt.level
+        << ", \"batch\": " << opt.batch << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+      const BenchResult& r = results[i];
+      out << (i ? ",\n" : "\n")
+          << "    {\"name\": \"" << r.name << "\", \"threads\": " << r.threads
+          << ", \"ops\": " << r.ops << ", \"errors\": " << r.errors
+          << ", \"seconds\": " << r.seconds << ", \"ops_per_sec\": " << double(r.ops) / r.seconds
+          << ", \"bytes_per_sec\": " << double(r.bytes) / r.seconds
+          << ", \"latency_us\": {\"p50\": " << r.p50 << ", \"p90\": " << r.p90
+          << ", \"p99\": " << r.p99 << ", \"max\": " << r.max << "}}";
+    }
+    out << "\n  ]\n}\n";
+  }
 }
 
 int main(int argc, char** argv) {
-  Url url;
+  Options opt;
+  std::string json;
+  std::vector<std::string> benches;
 
-  po::options_description general_options("AMQP Performance Test Program");
+  po::options_description general_options("Plate storage benchmarks: rpc, index-write, index-read, store-write, store-read");
   general_options.add_options()
-    ("url,u", po::value(&url), "Run requests against this index url.")
+    ("url,u", po::value(&opt.url), "The plate, datastore or index url to benchmark.")
+    ("rpc-url", po::value(&opt.rpc_url), "The index server url for the rpc benchmark.")
+    ("threads,t", po::value(&opt.threads)->default_value(1), "Workers, each with its own connection.")
+    ("count,n", po::value(&opt.count)->default_value(5000), "Operations per worker.")
+    ("batch", po::value(&opt.batch)->default_value(1), "Tiles per index-read request.")
+    ("tile-size", po::value(&opt.tile_size)->default_value(65536), "Bytes per tile in the store benchmarks.")
+    ("level", po::value(&opt.level)->default_value(10), "The level the tiles are written to.")
+    ("json", po::value(&json), "Also write the results to this file as JSON.")
     ("help,h", "Display this help message");
 
-  po::variables_map vm;
-  po::store( po::command_line_parser( argc, argv ).options(general_options).run(), vm );
-  po::notify( vm );
+  po::options_description hidden_options("");
+  hidden_options.add_options()
+    ("bench", po::value(&benches));
+
+  po::options_description options("Allowed Options");
+  options.add(general_options).add(hidden_options);
+
+  po::positional_options_description p;
+  p.add("bench", -1);
 
   std::ostringstream usage;
-  usage << "Usage: " << argv[0] << "\n\n";
+  usage << "Usage: " << argv[0] << " [options] <benchmark>...\n\n";
   usage << general_options << std::endl;
 
-  if( vm.count("help") ) {
+  po::variables_map vm;
+  try {
+    po::store( po::command_line_parser( argc, argv ).options(options).positional(p).run(), vm );
+    po::notify( vm );
+  } catch (const po::error& e) {
+    std::cout << "An error occured while parsing command line arguments.\n\n";
     std::cout << usage.str();
-    return 0;
+    return 1;
   }
 
-  boost::scoped_ptr<IndexClient> client(conn(url));
-
-  uint64 t0, t1;
-
-  while (1) {
-    t0 = Stopwatch::microtime();
-
-    for (size_t i = 0; i < BATCH_SIZE; i++) {
-      IndexTestRequest request;
-      request.set_value(i);
+  if( vm.count("help") || benches.empty() || opt.threads == 0 || opt.count == 0 || opt.batch == 0 ) {
+    std::cout << usage.str();
+    return 1;
+  }
 
-      IndexTestReply response;
-      client->TestRequest(client.get(), &request, &response, null_callback());
+  if (opt.level > 31 || (uint64(opt.threads) * opt.count) > (uint64(1) << (2*opt.level))) {
+    std::cout << "Level " << opt.level << " can't hold " << opt.threads << " x " << opt.count << " tiles.\n";
+    return 1;
+  }
 
-      if (i != response.value())
-        std::cerr << "Error: IndexTestMessage failed!\n";
+  std::vector<BenchResult> results;
+  try {
+    BOOST_FOREACH(const std::string& name, benches) {
+      results.push_back(run(name, opt));
+      print(std::cout, results.back());
     }
+  } catch (const vw::Exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
 
-    t1 = Stopwatch::microtime();
-    std::cout << 1000000. * float(BATCH_SIZE) / float(t1-t0) << " msg/s" << std::endl;
+  if (!json.empty()) {
+    std::ofstream out(json.c_str());
+    write_json(out, results, opt);
+    if (!out.good()) {
+      std::cerr << "Error: could not write " << json << std::endl;
+      return 1;
+    }
   }
-}
 
+  return 0;
+}
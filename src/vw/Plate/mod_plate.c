@@ -154,6 +154,8 @@ ADD_INT_CONFIG(index_timeout, is_gt_zero);
 ADD_INT_CONFIG(index_tries, is_gt_zero);
 ADD_FLAG_CONFIG(unknown_resync);
 ADD_FLAG_CONFIG(use_blob_cache);
+ADD_INT_CONFIG(blob_cache_size, is_gt_zero);
+ADD_INT_CONFIG(index_cache_size, is_gt_zero);
 ADD_STRING_CONFIG(index_url, noop);
 
 static const command_rec my_cmds[] = {
@@ -166,6 +168,8 @@ static const command_rec my_cmds[] = {
   AP_INIT_TAKE2("PlateAlias",         handle_alias,          NULL, RSRC_CONF, "Name-to-platefile_id mappings"),
   AP_INIT_FLAG("PlateUnknownResync",  handle_unknown_resync, NULL, RSRC_CONF, "Should we resync the platefile list when someone asks for an unknown one?"),
   AP_INIT_FLAG("PlateBlobCache",      handle_use_blob_cache, NULL, RSRC_CONF, "Should the blob cache be used?"),
+  AP_INIT_TAKE1("PlateBlobCacheSize", handle_blob_cache_size, NULL, RSRC_CONF, "How many blobs (and open files) to cache per child"),
+  AP_INIT_TAKE1("PlateIndexCacheSize",handle_index_cache_size,NULL, RSRC_CONF, "How many platefile indexes to keep open per child"),
   { NULL }
 };
 
@@ -183,6 +187,8 @@ static void* create_plate_config(apr_pool_t* p, server_rec* s) {
   conf->alias = apr_table_make(p, 4);
   conf->unknown_resync = 1;
   conf->use_blob_cache = 1;
+  conf->blob_cache_size  = 256;
+  conf->index_cache_size = 64;
   return conf;
   // This is the default config file
 #if 0
@@ -192,6 +198,8 @@ static void* create_plate_config(apr_pool_t* p, server_rec* s) {
   PlateIndexTries 3
   PlateUnknownResync on
   PlateBlobCache on
+  PlateBlobCacheSize 256
+  PlateIndexCacheSize 64
 #endif
 
 // these keys not set by default, but here are examples of possible valid ones
@@ -28,10 +28,34 @@ namespace platefile {
 
 PlateModule::~PlateModule() { }
 
-const PlateModule::IndexCacheEntry& PlateModule::get_index(const string& id_str) const {
+bool PlateModule::find_index(int32 id, IndexCacheEntry& entry) const {
+  if (index_cache.get(id, entry))
+    return true;
+
+  std::string name;
+  {
+    Mutex::Lock lock(m_platefiles_mutex);
+    std::map<int32, std::string>::const_iterator i = m_platefiles.find(id);
+    if (i == m_platefiles.end())
+      return false;
+    name = i->second;
+  }
+
+  int32 opened_id;
+  entry = open_index(name, opened_id);
+
+  // The platefile was replaced since the last sync
+  if (opened_id != id)
+    return false;
+
+  index_cache.insert(id, entry);
+  return true;
+}
+
+PlateModule::IndexCacheEntry PlateModule::get_index(const string& id_str) const {
 
   int id;
-  PlateModule::IndexCache::const_iterator index_i;
+  IndexCacheEntry entry;
 
   std::ostringstream msg_name;
 
@@ -45,10 +69,9 @@ const PlateModule::IndexCacheEntry& PlateModule::get_index(const string& id_str)
 
   // try it as an id (unless it's clearly wrong)
   if (id != 0) {
-    index_i = index_cache.find(id);
-    if (index_i != index_cache.end()) {
+    if (find_index(id, entry)) {
       logger(VerboseDebugMessage) << msg_name.str() << std::endl;
-      return index_i->second;
+      return entry;
     }
   }
 
@@ -57,10 +80,10 @@ const PlateModule::IndexCacheEntry& PlateModule::get_index(const string& id_str)
     int id2 = reinterpret_cast<intptr_t>(apr_table_get(m_conf->alias, id_str.c_str()));
     if (id2) {
       msg_name << " resolved as alias to " << id2;
-      index_i = index_cache.find(id2);
-      if (index_i != index_cache.end()) {
+      id = id2;
+      if (find_index(id, entry)) {
         logger(VerboseDebugMessage) << msg_name.str() << std::endl;
-        return index_i->second;
+        return entry;
       }
     }
   }
@@ -72,11 +95,31 @@ const PlateModule::IndexCacheEntry& PlateModule::get_index(const string& id_str)
   logger(WarningMessage) << "Platefile [" << msg_name.str() << "] not in platefile cache. Resyncing." << std::endl;
   sync_index_cache();
 
-  index_i = index_cache.find(id);
-  if (index_i == index_cache.end())
+  if (!find_index(id, entry))
     vw_throw(UnknownPlatefile() << "No such platefile (after resync) for " << msg_name.str());
 
-  return index_i->second;
+  return entry;
+}
+
+std::vector<std::pair<int32, PlateModule::IndexCacheEntry> > PlateModule::get_indexes() const {
+  std::map<int32, std::string> platefiles;
+  {
+    Mutex::Lock lock(m_platefiles_mutex);
+    platefiles = m_platefiles;
+  }
+
+  std::vector<std::pair<int32, IndexCacheEntry> > ret;
+  typedef std::pair<int32, std::string> platefile_t;
+  BOOST_FOREACH(const platefile_t& p, platefiles) {
+    IndexCacheEntry entry;
+    try {
+      if (find_index(p.first, entry))
+        ret.push_back(std::make_pair(p.first, entry));
+    } catch (const vw::Exception& e) {
+      logger(ErrorMessage) << "Tried to reopen " << p.second << ", but failed: " << e.what() << std::endl;
+    }
+  }
+  return ret;
 }
 
 
@@ -123,7 +166,7 @@ void mod_plate_init(const plate_config *conf) {
 }
 
 PlateModule::PlateModule(const plate_config* conf)
-  : m_connected(false), m_conf(conf), m_base_url(conf->index_url)
+  : blob_cache(conf->blob_cache_size), index_cache(conf->index_cache_size), m_connected(false), m_conf(conf), m_base_url(conf->index_url)
 {
 
   // Disable the config file
@@ -147,17 +190,20 @@ PlateModule::PlateModule(const plate_config* conf)
 
 void PlateModule::connect_index() {
 
-  if (m_connected)
-    return;
+  {
+    Mutex::Lock lock(m_client_mutex);
+    if (m_connected)
+      return;
 
-  m_client.reset( new IndexClient(m_base_url) );
+    m_client.reset( new IndexClient(m_base_url) );
 
-  // Total possible wait is timeout*tries
-  m_client->set_timeout(m_conf->index_timeout);
-  m_client->set_retries(m_conf->index_tries-1);
+    // Total possible wait is timeout*tries
+    m_client->set_timeout(m_conf->index_timeout);
+    m_client->set_retries(m_conf->index_tries-1);
 
-  m_connected = true;
-  logger(DebugMessage) << "child connected to url[" << m_base_url.string() << "]" << std::endl;
+    m_connected = true;
+    logger(DebugMessage) << "child connected to url[" << m_base_url.string() << "]" << std::endl;
+  }
 
   mod_plate().sync_index_cache();
 }
@@ -177,14 +223,26 @@ int PlateModule::operator()(const ApacheRequest& r) const {
   return DECLINED;
 }
 
+namespace {
+  template <typename CacheT>
+  void cache_status(std::ostream& out, const char* name, const CacheT& cache) {
+    out << name << "Size: "      << cache.size() << " of " << cache.max_size() << "<br>"
+        << name << "Hits: "      << cache.hits()      << "<br>"
+        << name << "Misses: "    << cache.misses()    << "<br>"
+        << name << "Evictions: " << cache.evictions() << "<br>";
+  }
+}
+
 int PlateModule::status(const ApacheRequest& r, int /*flags*/) const {
   apache_stream out(r.writer());
 
   out << "IndexCache:<br>" << std::endl;
-  BOOST_FOREACH(const IndexCache::value_type& c, get_index_cache())
+  typedef std::pair<int32, IndexCacheEntry> id_cache;
+  BOOST_FOREACH(const id_cache& c, get_index_cache().entries())
     out << c.second.shortname << ": " << c.first << "<br>";
 
-  out << "BlobCacheSize: " << get_blob_cache().size() << "<br>";
+  cache_status(out, "IndexCache", get_index_cache());
+  cache_status(out, "BlobCache",  get_blob_cache());
 
   return OK;
 }
@@ -196,22 +254,43 @@ const boost::shared_ptr<ReadBlob> PlateModule::get_blob(int platefile_id, const
 
   if (m_conf->use_blob_cache) {
 
-    BlobCache::const_iterator blob = blob_cache.find(filename);
+    BlobCacheEntry blob;
 
     // Check the platefile id to make sure the blob wasn't deleted and recreated
     // with a different platefile
-    if (blob != blob_cache.end() && blob->second.platefile_id == platefile_id)
-      return blob->second.blob;
+    if (blob_cache.get(filename, blob) && blob.platefile_id == platefile_id)
+      return blob.blob;
   }
 
   boost::shared_ptr<ReadBlob> ret( new ReadBlob(filename) );
 
   if (m_conf->use_blob_cache)
-    blob_cache.insert(std::make_pair(filename, BlobCacheEntry(ret, platefile_id)));
+    blob_cache.insert(filename, BlobCacheEntry(ret, platefile_id));
 
   return ret;
 }
 
+PlateModule::IndexCacheEntry PlateModule::open_index(const string& name, int32& id) const {
+  Url index_url = get_base_url();
+  index_url.query().set("cache_size", "1");
+  Url::split_t path = index_url.path_split();
+  path.push_back(name);
+  index_url.path_join(path);
+
+  logger(VerboseDebugMessage) << "Trying to load index: " << index_url.string() << std::endl;
+
+  IndexCacheEntry entry;
+  entry.index = detail::Index::construct_open(index_url);
+  const IndexHeader& hdr = entry.index->index_header();
+
+  entry.shortname   = name;
+  entry.filename    = entry.index->platefile_name();
+  entry.read_cursor = entry.index->transaction_cursor();
+  entry.description = (hdr.has_description() && ! hdr.description().empty()) ? hdr.description() : entry.shortname + "." + vw::stringify(entry.read_cursor);
+  id                = hdr.platefile_id();
+  return entry;
+}
+
 void PlateModule::sync_index_cache() const {
 
   VW_ASSERT(m_connected, LogicErr() << "Must connect before trying to sync cache");
@@ -219,14 +298,15 @@ void PlateModule::sync_index_cache() const {
   IndexListRequest request;
   IndexListReply id_list;
 
-  index_cache.clear();
-
-  m_client->ListRequest(m_client.get(), &request, &id_list, null_callback());
+  {
+    Mutex::Lock lock(m_client_mutex);
+    m_client->ListRequest(m_client.get(), &request, &id_list, null_callback());
+  }
 
-  Url base_url = get_base_url();
-  base_url.query().set("cache_size", "1");
-  Url::split_t path = base_url.path_split();
-  path.push_back("");
+  // Open every platefile to learn its id.  The cache keeps as many of them
+  // as it can hold; the rest are opened again when they're asked for.
+  std::map<int32, std::string> platefiles;
+  index_cache.clear();
 
   BOOST_FOREACH( const string& name, id_list.platefile_names() ) {
 
@@ -234,27 +314,19 @@ void PlateModule::sync_index_cache() const {
     int32 id;
 
     try {
-      Url index_url(base_url);
-      path.back() = name;
-      index_url.path_join(path);
-      logger(VerboseDebugMessage) << "Trying to load index: " << index_url.string() << std::endl;
-
-      entry.index = detail::Index::construct_open(index_url);
-      const IndexHeader& hdr = entry.index->index_header();
-
-      entry.shortname   = name;
-      entry.filename    = entry.index->platefile_name();
-      entry.read_cursor = entry.index->transaction_cursor();
-      entry.description = (hdr.has_description() && ! hdr.description().empty()) ? hdr.description() : entry.shortname + "." + vw::stringify(entry.read_cursor);
-      id                = hdr.platefile_id();
+      entry = open_index(name, id);
     } catch (const vw::Exception& e) {
       logger(ErrorMessage) << "Tried to add " << name << " to the index cache, but failed: " << e.what() << std::endl;
       continue;
     }
 
-    index_cache[id] = entry;
+    platefiles[id] = name;
+    index_cache.insert(id, entry);
     logger(DebugMessage) << "Adding " << entry.shortname << " to index cache [cursor=" << entry.read_cursor << "]" << std::endl;
   }
+
+  Mutex::Lock lock(m_platefiles_mutex);
+  m_platefiles.swap(platefiles);
 }
 
 
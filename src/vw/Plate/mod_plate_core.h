@@ -17,6 +17,7 @@
 #include <boost/function.hpp>
 #include <string>
 #include <map>
+#include <vector>
 
 
 namespace vw {
@@ -55,17 +56,27 @@ class PlateModule {
     struct BlobCacheEntry {
       boost::shared_ptr<ReadBlob> blob;
       int platefile_id;
+      BlobCacheEntry() : platefile_id(0) {}
       BlobCacheEntry(boost::shared_ptr<ReadBlob> b, int id) :
         blob(b), platefile_id(id) {}
     };
 
-    typedef std::map<int32, IndexCacheEntry> IndexCache;
-    typedef std::map<std::string, BlobCacheEntry> BlobCache;
+    // Both caches are bounded (PlateIndexCacheSize and PlateBlobCacheSize)
+    // and safe to share between threads.
+    typedef LruCache<int32, IndexCacheEntry> IndexCache;
+    typedef LruCache<std::string, BlobCacheEntry> BlobCache;
 
     const IndexCache& get_index_cache() const { return index_cache; }
     const BlobCache&  get_blob_cache() const {return blob_cache; }
 
-    const IndexCacheEntry& get_index(const std::string& id_str) const;
+    // Looks up a platefile by id or alias, opening its index if it isn't
+    // cached.
+    IndexCacheEntry get_index(const std::string& id_str) const;
+
+    // Every platefile the index server listed at the last sync, by id.
+    // Indexes that have fallen out of the cache are opened again, and any
+    // that fail to open are left out.
+    std::vector<std::pair<int32, IndexCacheEntry> > get_indexes() const;
 
     const boost::shared_ptr<ReadBlob> get_blob(int platefile_id, const std::string& plate_filename, uint32 blob_id) const;
     void sync_index_cache() const;
@@ -79,9 +90,19 @@ class PlateModule {
 
   private:
     boost::shared_ptr<IndexClient> m_client;
+    mutable Mutex m_client_mutex;
+
+    // Opens the index for a platefile the index server listed as name.
+    IndexCacheEntry open_index(const std::string& name, int32& id) const;
+    // Finds the index for an id in the cache, or opens it if the id was
+    // listed at the last sync.  Returns false if it wasn't.
+    bool find_index(int32 id, IndexCacheEntry& entry) const;
 
     mutable BlobCache  blob_cache;
     mutable IndexCache index_cache;
+    // The name of every platefile the index server listed, by id.
+    mutable std::map<int32, std::string> m_platefiles;
+    mutable Mutex m_platefiles_mutex;
     bool m_connected;
     // We don't manage the data, and I think apache might modify it behind the scenes.
     // As such, mark it volatile.
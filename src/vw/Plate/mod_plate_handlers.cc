@@ -23,6 +23,8 @@
 
 #include <boost/regex.hpp>
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+#include <sstream>
 
 using namespace vw;
 using namespace vw::platefile;
@@ -30,6 +32,19 @@ using namespace vw::platefile::detail;
 
 using std::string;
 
+namespace {
+  const char* mime_type(const string& filetype) {
+    if (filetype == "png")
+      return "image/png";
+    else if (filetype == "jpg")
+      return "image/jpeg";
+    else if (filetype == "tif")
+      return "image/tiff";
+    else
+      return "application/octet-stream";
+  }
+}
+
 int vw::platefile::handle_image(const ApacheRequest& r) {
   static const boost::regex match_regex("/(\\w+)/(\\d+)/(\\d+)/(\\d+)\\.(\\w+)$");
 
@@ -53,21 +68,22 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
                                    << "] row["    << row
                                    << "] format[" << format << "]" << std::endl;
 
-  const PlateModule::IndexCacheEntry& index = mod_plate().get_index(sid);
+  const PlateModule::IndexCacheEntry index = mod_plate().get_index(sid);
 
   int id = index.index->index_header().platefile_id();
 
   // --------------  Access Plate Index -----------------
 
+  int transaction_id = r.args.get("transaction_id", int(-1));
+  bool exact = r.args.get("exact", false);
+  const int cursor = index.index->transaction_cursor();
+
   IndexRecord idx_record;
   try {
-    int transaction_id = r.args.get("transaction_id", int(-1));
-    bool exact = r.args.get("exact", false);
-
     VW_ASSERT(transaction_id >= -1, BadRequest() << "Illegal transaction_id");
 
     if (transaction_id == -1) {
-      transaction_id = index.index->transaction_cursor();
+      transaction_id = cursor;
       exact = false;
     }
 
@@ -81,38 +97,12 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
     vw_throw(ServerError() << "Could not read plate index: " << e.what());
   }
 
-  // ---------------- Return the image ------------------
-
-  mod_plate().logger(VerboseDebugMessage) << "Figuring out mime content type from filetype " << idx_record.filetype() << std::endl;
-  // Okay, we've gotten this far without error. Set content type now, so HTTP
-  // HEAD returns the correct file type
-  if (idx_record.filetype() == "png")
-    ap_set_content_type(r.writer(), "image/png");
-  else if (idx_record.filetype() == "jpg")
-    ap_set_content_type(r.writer(), "image/jpeg");
-  else if (idx_record.filetype() == "tif")
-    ap_set_content_type(r.writer(), "image/tiff");
-  else
-    ap_set_content_type(r.writer(), "application/octet-stream");
-
-  if (r.args.get("nocache", 0u) == 1) {
-    apr_table_set(r.writer()->headers_out, "Cache-Control", "no-cache");
-  }
-  else {
-    if (level <= 7)
-      apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=604800");
-    else
-      apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=1200");
-  }
-
-  // This is as far as we can go without making the request heavyweight. Bail
-  // out on a header request now.
-  if (r.header_only())
-    return OK;
+  // ---------------- Find the tile in its blob ------------------
 
   // These are the sendfile(2) parameters
   string filename;
   vw::uint64 offset, size;
+  std::vector<BlobSendfileRange> variants;
 
   try {
     mod_plate().logger(VerboseDebugMessage) << "Fetching blob" << std::endl;
@@ -120,13 +110,72 @@ int vw::platefile::handle_image(const ApacheRequest& r) {
     boost::shared_ptr<ReadBlob> blob = mod_plate().get_blob(id, index.filename, idx_record.blob_id());
 
     mod_plate().logger(VerboseDebugMessage) << "Fetching data from blob" << std::endl;
-    // And calculate the sendfile(2) parameters
-    blob->read_sendfile(idx_record.blob_offset(), filename, offset, size);
+    // And calculate the sendfile(2) parameters. This only reads the tile's
+    // blob record, which also lists its other encodings.
+    blob->read_sendfile(idx_record.blob_offset(), filename, offset, size, &variants);
 
   } catch (const vw::Exception& e) {
     vw_throw(ServerError() << "Could not load blob data: " << e.what());
   }
 
+  // If the tile was stored in other encodings too, serve the one the client
+  // likes best. The stored one wins ties.
+  string filetype = idx_record.filetype();
+  const string accept = r.header("Accept");
+  if (!variants.empty() && !accept.empty()) {
+    double best = accept_quality(accept, mime_type(filetype));
+    BOOST_FOREACH(const BlobSendfileRange& v, variants) {
+      double q = accept_quality(accept, mime_type(v.filetype));
+      if (q > best) {
+        best     = q;
+        filetype = v.filetype;
+        offset   = v.offset;
+        size     = v.size;
+      }
+    }
+  }
+
+  // ---------------- Return the image ------------------
+
+  mod_plate().logger(VerboseDebugMessage) << "Serving filetype " << filetype << " of the tile's " << variants.size()+1 << std::endl;
+  // Okay, we've gotten this far without error. Set content type now, so HTTP
+  // HEAD returns the correct file type
+  ap_set_content_type(r.writer(), mime_type(filetype));
+  if (!variants.empty())
+    apr_table_merge(r.writer()->headers_out, "Vary", "Accept");
+
+  // Blobs are only ever appended to, so the bytes at a blob offset never
+  // change: the offset (and which encoding of the tile is sent) makes a
+  // strong etag. A tile asked for by its exact transaction, once that
+  // transaction is finished, can never change either, so caches may keep
+  // it forever. Anything else may be replaced by a newer transaction, so
+  // it gets the usual (shorter) lifetime, and the etag keeps revalidating
+  // it cheap.
+  std::ostringstream etag;
+  etag << "\"" << id << "-" << idx_record.blob_id() << "-" << idx_record.blob_offset();
+  if (exact)
+    etag << "-" << transaction_id;
+  if (!variants.empty())
+    etag << "-" << filetype;
+  etag << "\"";
+  apr_table_set(r.writer()->headers_out, "ETag", etag.str().c_str());
+
+  if (r.args.get("nocache", 0u) == 1)
+    apr_table_set(r.writer()->headers_out, "Cache-Control", "no-cache");
+  else if (exact && transaction_id <= cursor)
+    apr_table_set(r.writer()->headers_out, "Cache-Control", "public, max-age=31536000, immutable");
+  else if (level <= 7)
+    apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=604800");
+  else
+    apr_table_set(r.writer()->headers_out, "Cache-Control", "max-age=1200");
+
+  if (etag_matches(r.header("If-None-Match"), etag.str()))
+    return HTTP_NOT_MODIFIED;
+
+  // Bail out on a header request now, before sending anything.
+  if (r.header_only())
+    return OK;
+
   apr_file_t *fd = 0;
   // Open the blob as an apache file with raii (so it goes away when we return)
   raii file_opener(
@@ -163,14 +212,13 @@ int vw::platefile::handle_wtml(const ApacheRequest& r) {
 
   ap_set_content_type(r.writer(), "application/xml");
 
-  if (r.header_only())
-    return OK;
-
   if (mod_plate().allow_resync())
     mod_plate().sync_index_cache();
 
-  apache_stream out(r.writer());
-  mod_plate().logger(DebugMessage) << "Served WTML[" << filename << "]" << std::endl;
+  // The WTML is small, so build it first and use a hash of it as the etag.
+  // It changes whenever a layer does, so caches have to revalidate it, but
+  // that costs them nothing but the headers when it hasn't changed.
+  std::ostringstream out;
 
   out
     << "<?xml version='1.0' encoding='UTF-8'?>"              << std::endl
@@ -182,7 +230,7 @@ int vw::platefile::handle_wtml(const ApacheRequest& r) {
 
   bool show_all_layers =  r.args.get("all_layers", false);
 
-  BOOST_FOREACH( const id_cache& e, mod_plate().get_index_cache() ) {
+  BOOST_FOREACH( const id_cache& e, mod_plate().get_indexes() ) {
 
     const string filetype = e.second.index->index_header().tile_filetype();
     // WWT can only handle jpg, png, and tif
@@ -212,6 +260,22 @@ int vw::platefile::handle_wtml(const ApacheRequest& r) {
   }
   out << "</Folder>" << std::endl;
 
+  const string wtml = out.str();
+  std::ostringstream etag;
+  etag << "\"" << std::hex << boost::hash<string>()(wtml) << "\"";
+  apr_table_set(r.writer()->headers_out, "ETag", etag.str().c_str());
+  apr_table_set(r.writer()->headers_out, "Cache-Control", "no-cache");
+
+  if (etag_matches(r.header("If-None-Match"), etag.str()))
+    return HTTP_NOT_MODIFIED;
+
+  if (r.header_only())
+    return OK;
+
+  mod_plate().logger(DebugMessage) << "Served WTML[" << filename << "]" << std::endl;
+  apache_stream stream(r.writer());
+  stream << wtml;
+
   return OK;
 }
 
@@ -120,6 +120,11 @@ bool ApacheRequest::header_only() const {
   return r->header_only;
 }
 
+std::string ApacheRequest::header(const char* name) const {
+  const char* value = apr_table_get(r->headers_in, name);
+  return value ? string(value) : string();
+}
+
 request_rec* ApacheRequest::writer() const {
   return r;
 }
@@ -9,12 +9,16 @@
 #define __VW_PLATE_MOD_PLATE_UTILS_H__
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
 #include <vw/Plate/HTTPUtils.h>
 
 #include <boost/iostreams/stream.hpp>
 #include <boost/function.hpp>
 #include <set>
 #include <map>
+#include <list>
+#include <vector>
 #include <string>
 
 struct apr_pool_t;
@@ -52,6 +56,102 @@ struct raii {
   ~raii() {m_leave();}
 };
 
+// A map that holds at most max_size() entries, evicting the least recently
+// used one to make room for a new one.  Every method locks, so it can be
+// shared by the threads of a worker MPM child.  Values are handed out by
+// copy, so they should be cheap to copy (e.g. hold a shared_ptr) and stay
+// valid after they are evicted.
+template <typename KeyT, typename ValueT>
+class LruCache {
+    typedef std::list<std::pair<KeyT, ValueT> > list_t;
+    typedef std::map<KeyT, typename list_t::iterator> map_t;
+
+    mutable Mutex m_mutex;
+    mutable list_t m_entries; // most recently used first
+    map_t  m_lookup;
+    size_t m_max_size;
+    mutable uint64 m_hits, m_misses, m_evictions;
+
+    void evict_to(size_t size) {
+      while (m_entries.size() > size) {
+        m_lookup.erase(m_entries.back().first);
+        m_entries.pop_back();
+        m_evictions++;
+      }
+    }
+
+  public:
+    LruCache(size_t max_size) : m_max_size(max_size), m_hits(0), m_misses(0), m_evictions(0) {}
+
+    // Copies the value for key into value and marks it used.  Returns false
+    // (a miss) if there isn't one.
+    bool get(const KeyT& key, ValueT& value) const {
+      Mutex::Lock lock(m_mutex);
+      typename map_t::const_iterator i = m_lookup.find(key);
+      if (i == m_lookup.end()) {
+        m_misses++;
+        return false;
+      }
+      m_hits++;
+      m_entries.splice(m_entries.begin(), m_entries, i->second);
+      value = i->second->second;
+      return true;
+    }
+
+    // Sets the value for key, replacing any that's there, and marks it used.
+    void insert(const KeyT& key, const ValueT& value) {
+      Mutex::Lock lock(m_mutex);
+      typename map_t::iterator i = m_lookup.find(key);
+      if (i != m_lookup.end()) {
+        i->second->second = value;
+        m_entries.splice(m_entries.begin(), m_entries, i->second);
+        return;
+      }
+      evict_to(m_max_size ? m_max_size - 1 : 0);
+      if (m_max_size == 0)
+        return;
+      m_entries.push_front(std::make_pair(key, value));
+      m_lookup[key] = m_entries.begin();
+    }
+
+    void erase(const KeyT& key) {
+      Mutex::Lock lock(m_mutex);
+      typename map_t::iterator i = m_lookup.find(key);
+      if (i == m_lookup.end())
+        return;
+      m_entries.erase(i->second);
+      m_lookup.erase(i);
+    }
+
+    void clear() {
+      Mutex::Lock lock(m_mutex);
+      m_entries.clear();
+      m_lookup.clear();
+    }
+
+    // A copy of the entries, in key order.  Doesn't mark them used.
+    std::vector<std::pair<KeyT, ValueT> > entries() const {
+      Mutex::Lock lock(m_mutex);
+      std::vector<std::pair<KeyT, ValueT> > ret;
+      ret.reserve(m_entries.size());
+      for (typename map_t::const_iterator i = m_lookup.begin(); i != m_lookup.end(); ++i)
+        ret.push_back(*i->second);
+      return ret;
+    }
+
+    void set_max_size(size_t max_size) {
+      Mutex::Lock lock(m_mutex);
+      m_max_size = max_size;
+      evict_to(m_max_size);
+    }
+
+    size_t size()      const { Mutex::Lock lock(m_mutex); return m_entries.size(); }
+    size_t max_size()  const { Mutex::Lock lock(m_mutex); return m_max_size; }
+    uint64 hits()      const { Mutex::Lock lock(m_mutex); return m_hits; }
+    uint64 misses()    const { Mutex::Lock lock(m_mutex); return m_misses; }
+    uint64 evictions() const { Mutex::Lock lock(m_mutex); return m_evictions; }
+};
+
 class WTMLImageSet : public std::map<std::string, std::string> {
   typedef std::map<std::string, std::string> map_t;
   typedef std::set<std::string> child_t;
@@ -76,6 +176,8 @@ class ApacheRequest {
 
     ApacheRequest(request_rec* r);
     bool header_only() const;
+    // The value of a request header, or an empty string if it wasn't sent.
+    std::string header(const char* name) const;
     request_rec* writer() const;
 };
 
@@ -0,0 +1,90 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+// platecompact rewrites a local platefile so that its blobs hold only the
+// tiles the index still refers to; see compact_plate() in PlateCompact.h.
+// The new plate is built next to the old one and then swapped in with two
+// renames.  That swap is not atomic, so nothing may read or write the
+// plate while it is compacted.
+
+#include <vw/Plate/PlateCompact.h>
+#include <vw/Plate/Exception.h>
+using namespace vw;
+using namespace vw::platefile;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
+// --------------------------------------------------------------------------
+//                                    MAIN
+// --------------------------------------------------------------------------
+
+int main( int argc, char *argv[] ) {
+
+  std::string filename;
+  CompactOptions opts;
+
+  po::options_description general_options("\nRewrite a local platefile, dropping the tiles its index no longer refers to.\n"
+                                          "The old plate is swapped out with two renames, which is not atomic:\n"
+                                          "nothing may read or write the plate while it is compacted.\n");
+  general_options.add_options()
+    ("latest-only", po::bool_switch(&opts.latest_only), "Also drop committed tiles that a newer committed tile at the same location hides.")
+    ("keep-old", po::bool_switch(&opts.keep_old), "Keep the old plate as <plate>.precompact instead of deleting it.")
+    ("dry-run,n", po::bool_switch(&opts.dry_run), "Only report how much space compacting would save.")
+    ("batch-size", po::value(&opts.batch_size)->default_value(1024), "Tiles to copy between index updates.")
+    ("help,h", "Display this help message");
+
+  po::options_description hidden_options("");
+  hidden_options.add_options()
+    ("input-file", po::value<std::string>(&filename), "");
+
+  po::options_description options("Allowed Options");
+  options.add(general_options).add(hidden_options);
+
+  po::positional_options_description p;
+  p.add("input-file", -1);
+
+  std::ostringstream usage;
+  usage << "Usage: " << argv[0] << " [options] <plate_filename>\n";
+  usage << general_options << std::endl;
+
+  po::variables_map vm;
+  try {
+    po::store( po::command_line_parser( argc, argv ).options(options).positional(p).run(), vm );
+    po::notify( vm );
+  } catch (const po::error& e) {
+    std::cout << "An error occured while parsing command line arguments.\n\n";
+    std::cout << usage.str();
+    return 1;
+  }
+
+  if( vm.count("help") || filename.empty() || opts.batch_size == 0 ) {
+    std::cout << usage.str();
+    return 1;
+  }
+
+  try {
+    CompactResult r = compact_plate(filename, opts);
+
+    std::cout << "\t--> " << r.live_tiles << " live tiles in " << r.old_size << " bytes of blobs; "
+              << r.dead_bytes << " bytes of tile data are dead.\n";
+    if (!opts.dry_run)
+      std::cout << "\t--> Compacted " << filename << " from " << r.old_size << " to " << r.new_size << " bytes.\n";
+
+  }  catch (const vw::Exception& e) {
+    std::cout << "An error occured: " << e.what() << "\nExiting.\n\n";
+    return 1;
+  } catch (const fs::filesystem_error& e) {
+    std::cout << "An error occured: " << e.what() << "\nExiting.\n\n";
+    return 1;
+  }
+
+  return 0;
+}
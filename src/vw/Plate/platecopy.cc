@@ -4,8 +4,20 @@
 // All Rights Reserved.
 // __END_LICENSE__
 
+// platecopy copies the tiles of one transaction (or the newest tiles) of
+// a plate, or of a region of one of its levels, into a transaction of
+// another plate.  The tiles are copied as they are, without decoding.
+//
+// A local input plate is copied straight from its blobs: the tile
+// headers of several blobs are read at once, the tiles the index points
+// at are picked out, and those are read in parallel and written to the
+// output in large batches.  Other inputs go through the index, a region
+// at a time.  --clone copies a whole local plate file by file, history
+// and all, into a new local plate.
+
 #include <vw/Plate/PlateFile.h>
 #include <vw/Plate/detail/MipmapHelpers.h>
+#include <vw/Plate/detail/LocalIndex.h>
 #include <vw/Plate/TileManipulation.h>
 using namespace vw;
 using namespace vw::platefile;
@@ -15,8 +27,13 @@ namespace d = vw::platefile::detail;
 #include <boost/lexical_cast.hpp>
 #include <boost/program_options.hpp>
 #include <boost/foreach.hpp>
+#include <boost/regex.hpp>
 namespace po = boost::program_options;
 
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
 class CopyParameters {
 
   void error(std::string arg, std::string const& params) {
@@ -76,6 +93,196 @@ public:
   }
 };
 
+namespace {
+
+  // The blobs of a local plate, indexed by blob id.  Missing ids are empty.
+  std::vector<std::string> blob_filenames(const std::string& plate) {
+    std::vector<std::string> result;
+    boost::regex re("plate_(\\d+)\\.blob");
+    for (fs::directory_iterator i(plate), end; i != end; ++i) {
+      boost::cmatch matches;
+      if (!boost::regex_match(i->path().filename().c_str(), matches, re))
+        continue;
+      uint32 blob_id = boost::lexical_cast<uint32>(matches.str(1));
+      if (result.size() < blob_id+1)
+        result.resize(blob_id+1);
+      result[blob_id] = i->path().string();
+    }
+    return result;
+  }
+
+  // Reads the offsets and tile headers of a blob.
+  class ScanBlob {
+      std::string m_filename;
+      std::vector<uint64>& m_offsets;
+      std::vector<TileHeader>& m_hdrs;
+    public:
+      typedef void result_type;
+      ScanBlob(std::string const& filename, std::vector<uint64>& offsets, std::vector<TileHeader>& hdrs)
+        : m_filename(filename), m_offsets(offsets), m_hdrs(hdrs) {}
+      void operator()() const {
+        ReadBlob blob(m_filename);
+        m_offsets = blob.record_offsets();
+        m_hdrs.reserve(m_offsets.size());
+        BOOST_FOREACH(uint64 offset, m_offsets)
+          m_hdrs.push_back(blob.read_header(offset));
+      }
+  };
+
+  // Reads whole records (header and tile) from a blob.
+  struct ReadRecords {
+    std::string filename;
+    std::vector<uint64> offsets;
+    Datastore::TileSearch* out;
+
+    typedef void result_type;
+    void operator()() const {
+      ReadBlob blob(filename);
+      out->reserve(offsets.size());
+      BOOST_FOREACH(uint64 offset, offsets) {
+        BlobTileRecord r = blob.read_record(offset);
+        out->push_back(Tile(r.hdr, r.data));
+      }
+    }
+  };
+
+  class CopyFile {
+      fs::path m_from, m_to;
+    public:
+      typedef void result_type;
+      CopyFile(fs::path const& from, fs::path const& to) : m_from(from), m_to(to) {}
+      void operator()() const { fs::copy_file(m_from, m_to); }
+  };
+
+  // Copies every file of a local plate into a new one.  The blobs, which
+  // are most of it, are copied several at a time.
+  void clone_plate(const std::string& from, const std::string& to) {
+    if (fs::exists(to))
+      vw_throw(IOErr() << "--clone makes a new plate, and \"" << to << "\" exists.");
+
+    fs::create_directories(to);
+    std::vector<CopyFile> copies;
+    for (fs::recursive_directory_iterator i(from), end; i != end; ++i) {
+      fs::path rel = i->path().string().substr(fs::path(from).string().size());
+      fs::path dst = fs::path(to) / rel;
+      if (fs::is_directory(i->path()))
+        fs::create_directories(dst);
+      else
+        copies.push_back(CopyFile(i->path(), dst));
+    }
+
+    TerminalProgressCallback progress("plate.tools.platecopy", "Cloning: ");
+    FifoWorkQueue queue(std::max(vw_settings().default_num_threads(), 1u));
+    std::vector<Future<void> > futures;
+    BOOST_FOREACH(CopyFile const& c, copies)
+      futures.push_back(queue.submit(c));
+    for (size_t i = 0; i < futures.size(); ++i) {
+      futures[i].wait();
+      progress.report_fractional_progress(double(i+1), double(futures.size()));
+    }
+    when_all(futures);
+    progress.report_finished();
+  }
+
+  // Tiles per parallel read.
+  const size_t READ_CHUNK = 256;
+
+  // Copies the tiles that copy_job() would from a local plate, reading
+  // its blobs directly.  A tile is copied if it passes the level and
+  // region test and the index points at it: it is the newest tile at
+  // its location, or, given input_tid, the tile of that transaction.
+  void stream_copy( const std::string& input_path, int level, BBox2i const& region,
+                    TransactionOrNeg input_tid, PlateFile& output_plate,
+                    const ProgressCallback& progress ) {
+    d::LocalIndex index(input_path);
+    std::vector<std::string> blobs = blob_filenames(input_path);
+    const uint32 num_threads = std::max(vw_settings().default_num_threads(), 1u);
+    FifoWorkQueue queue(num_threads);
+    uint64 copied = 0;
+
+    const size_t old_batch_size = output_plate.write_batch_size();
+    output_plate.set_write_batch_size(std::max(old_batch_size, READ_CHUNK));
+
+    progress.report_progress(0);
+    for (size_t first = 0; first < blobs.size(); first += num_threads) {
+      progress.abort_if_requested();
+      const size_t last = std::min(first + num_threads, blobs.size());
+
+      // Read the headers of a few blobs at once...
+      std::vector<std::vector<uint64> > offsets(last - first);
+      std::vector<std::vector<TileHeader> > hdrs(last - first);
+      {
+        std::vector<Future<void> > futures;
+        for (size_t b = first; b < last; ++b)
+          if (!blobs[b].empty())
+            futures.push_back(queue.submit(ScanBlob(blobs[b], offsets[b-first], hdrs[b-first])));
+        when_all(futures);
+      }
+
+      // ...pick out the tiles to copy...
+      std::vector<ReadRecords> reads;
+      for (size_t b = first; b < last; ++b) {
+        std::vector<TileHeader> query;
+        std::vector<uint64> candidates;
+        for (size_t i = 0; i < hdrs[b-first].size(); ++i) {
+          const TileHeader& h = hdrs[b-first][i];
+          if (level != -1 && (int(h.level()) != level || !region.contains(Vector2i(h.col(), h.row()))))
+            continue;
+          if (!input_tid.newest() && h.transaction_id() != input_tid)
+            continue;
+          query.push_back(h);
+          if (input_tid.newest())
+            query.back().set_transaction_id(-1);
+          candidates.push_back(offsets[b-first][i]);
+        }
+        if (query.empty())
+          continue;
+
+        d::Index::ReadResults found = index.read_requests(query, !input_tid.newest());
+        ReadRecords r;
+        r.filename = blobs[b];
+        for (size_t i = 0; i < query.size(); ++i) {
+          if (!found[i].found || found[i].record.blob_id() != b || found[i].record.blob_offset() != candidates[i])
+            continue;
+          r.offsets.push_back(candidates[i]);
+          if (r.offsets.size() == READ_CHUNK) {
+            reads.push_back(r);
+            r.offsets.clear();
+          }
+        }
+        if (!r.offsets.empty())
+          reads.push_back(r);
+      }
+
+      // ...then read them in parallel, and write them a wave at a time.
+      const size_t wave = 4 * num_threads;
+      for (size_t w = 0; w < reads.size(); w += wave) {
+        const size_t wend = std::min(w + wave, reads.size());
+        std::vector<Datastore::TileSearch> tiles(wend - w);
+        std::vector<Future<void> > futures;
+        for (size_t i = w; i < wend; ++i) {
+          reads[i].out = &tiles[i-w];
+          futures.push_back(queue.submit(reads[i]));
+        }
+        when_all(futures);
+
+        BOOST_FOREACH(const Datastore::TileSearch& ts, tiles) {
+          BOOST_FOREACH(const Tile& t, ts)
+            output_plate.write_update(&t.data->operator[](0), t.data->size(),
+                                      t.hdr.col(), t.hdr.row(), t.hdr.level(), t.hdr.filetype());
+          copied += ts.size();
+        }
+      }
+      progress.report_fractional_progress(double(last), double(blobs.size()));
+    }
+
+    output_plate.flush_writes();
+    output_plate.set_write_batch_size(old_batch_size);
+    progress.report_finished();
+    vw_out(InfoMessage, "plate.tools.platecopy") << "Copied " << copied << " tiles from the blobs of " << input_path << "\n";
+  }
+}
+
 template <class PixelT>
 void copy_job( int level, BBox2i const& region,
                TransactionOrNeg input_tid,
@@ -114,10 +321,12 @@ void copy_job( int level, BBox2i const& region,
   progress.report_finished();
 }
 
+// With an input_path, the tiles are copied with stream_copy().
 template <class PixelT>
 void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
              boost::shared_ptr<PlateFile> output_plate,
-             CopyParameters& copy_parameters ) {
+             CopyParameters& copy_parameters,
+             std::string const& input_path ) {
   if (copy_parameters.level != -1 ) {
     output_plate->transaction_resume(copy_parameters.transaction_output_id.promote());
     output_plate->audit_log()
@@ -126,10 +335,15 @@ void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
       << " region: " << copy_parameters.region << "\n";
     output_plate->write_request();
 
-    copy_job<PixelT>(copy_parameters.level, copy_parameters.region,
-                     copy_parameters.transaction_input_id,
-                     input_plate, output_plate,
-                     TerminalProgressCallback("plate.tools.platecopy",""));
+    if (!input_path.empty())
+      stream_copy(input_path, copy_parameters.level, copy_parameters.region,
+                  copy_parameters.transaction_input_id, *output_plate,
+                  TerminalProgressCallback("plate.tools.platecopy",""));
+    else
+      copy_job<PixelT>(copy_parameters.level, copy_parameters.region,
+                       copy_parameters.transaction_input_id,
+                       input_plate, output_plate,
+                       TerminalProgressCallback("plate.tools.platecopy",""));
 
     output_plate->write_complete();
     output_plate->audit_log()
@@ -141,11 +355,17 @@ void do_copy(boost::shared_ptr<ReadOnlyPlateFile> input_plate,
     output_plate->transaction_begin("Full copy (requested t_if: " + vw::stringify(copy_parameters.transaction_output_id) + ")",
                                     copy_parameters.transaction_output_id );
 
-    for ( int32 level = 0; level < input_plate->num_levels(); level++ ) {
-      copy_job<PixelT>(level, d::move_down(BBox2i(0,0,1,1), level),
-                       copy_parameters.transaction_input_id,
-                       input_plate, output_plate,
-                       TerminalProgressCallback("plate.tools.platecopy","Level: " + stringify(level)));
+    if (!input_path.empty()) {
+      stream_copy(input_path, -1, BBox2i(),
+                  copy_parameters.transaction_input_id, *output_plate,
+                  TerminalProgressCallback("plate.tools.platecopy","All levels: "));
+    } else {
+      for ( int32 level = 0; level < input_plate->num_levels(); level++ ) {
+        copy_job<PixelT>(level, d::move_down(BBox2i(0,0,1,1), level),
+                         copy_parameters.transaction_input_id,
+                         input_plate, output_plate,
+                         TerminalProgressCallback("plate.tools.platecopy","Level: " + stringify(level)));
+      }
     }
 
     output_plate->transaction_end(true);
@@ -166,6 +386,8 @@ int main( int argc, char *argv[] ) {
     ("transaction-output,t",  po::value(&transaction_output_id), "Transaction ID to write to output plate")
     ("transaction-input,i", po::value(&transaction_input_id), "Transaction ID to read from input plate")
     ("region", po::value(&region_string), "where arg = <ul_x>, <ul_y>:<lr_x>, <lr_y>@<level> - Limit the snapshot to the region bounded by these upper left (ul) and lower right (lr) coordinates at the level specified.")
+    ("no-stream", "Copy through the index even from a local plate, instead of from its blobs.")
+    ("clone", "Copy a whole local plate, with every transaction, into a new local plate, file by file.")
     ("help,h", "Display this help message");
 
   po::options_description hidden_options("");
@@ -206,6 +428,20 @@ int main( int argc, char *argv[] ) {
 
     VW_ASSERT( output_url != input_url,
                IOErr() << "Input and output url must be different URLs." );
+
+    if (vm.count("clone")) {
+      VW_ASSERT( input_url.scheme() == "file" && output_url.scheme() == "file",
+                 ArgumentErr() << "--clone copies a local plate to a local plate." );
+      VW_ASSERT( region_string.empty() && transaction_input_id.newest(),
+                 ArgumentErr() << "--clone copies the whole plate; it takes no --region or --transaction-input." );
+      clone_plate(input_url.path(), output_url.path());
+      return 0;
+    }
+
+    // Local plates are copied from their blobs.
+    std::string input_path;
+    if (input_url.scheme() == "file" && !vm.count("no-stream"))
+      input_path = input_url.path();
     input_plate.reset( new ReadOnlyPlateFile( input_url ) );
     output_plate.reset( new PlateFile( output_url, "", "", input_plate->default_tile_size(),
                                        input_plate->default_file_type(),
@@ -233,11 +469,11 @@ int main( int argc, char *argv[] ) {
     case VW_PIXEL_GRAYA:
       switch(input_plate->channel_type()) {
       case VW_CHANNEL_UINT8:
-        do_copy<PixelGrayA<uint8> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<uint8> >(input_plate, output_plate, copy_params, input_path); break;
       case VW_CHANNEL_INT16:
-        do_copy<PixelGrayA<int16> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<int16> >(input_plate, output_plate, copy_params, input_path); break;
       case VW_CHANNEL_FLOAT32:
-        do_copy<PixelGrayA<float32> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelGrayA<float32> >(input_plate, output_plate, copy_params, input_path); break;
       default:
         vw_throw(ArgumentErr() << "Plate contains a channel type not supported by platecopy.\n");
         exit(1);
@@ -246,7 +482,7 @@ int main( int argc, char *argv[] ) {
     case VW_PIXEL_RGBA:
       switch(input_plate->channel_type()) {
       case VW_CHANNEL_UINT8:
-        do_copy<PixelRGBA<uint8> >(input_plate, output_plate, copy_params); break;
+        do_copy<PixelRGBA<uint8> >(input_plate, output_plate, copy_params, input_path); break;
       default:
         vw_throw(ArgumentErr() << "Plate contains a channel type not supported by platecopy.\n");
         exit(1);
@@ -26,9 +26,12 @@ namespace fs = boost::filesystem;
 int main( int argc, char *argv[] ) {
 
   std::string filename;
+  bool filters_only = false, resume = false;
 
   po::options_description general_options("\nRebuild a platefile index.\n");
   general_options.add_options()
+    ("resume", po::bool_switch(&resume), "Continue an interrupted rebuild instead of starting over.")
+    ("filters-only", po::bool_switch(&filters_only), "Keep the index, and only rebuild its tile filters.")
     ("help,h", "Display this help message");
 
   po::options_description hidden_options("");
@@ -76,7 +79,13 @@ int main( int argc, char *argv[] ) {
       exit(1);
     }
 
-    if (fs::exists(index_str)) {
+    if (filters_only) {
+      detail::LocalIndex index(filename);
+      index.build_tile_filters();
+      return 0;
+    }
+
+    if (fs::exists(index_str) && !resume) {
       std::cout << "Are you sure you want to delete & rebuild \"" << index_str << "\"? ";
       std::string user_input;
       std::cin >> user_input;
@@ -87,7 +96,7 @@ int main( int argc, char *argv[] ) {
     }
 
     detail::LocalIndex index(filename);
-    index.rebuild_index();
+    index.rebuild_index(TerminalProgressCallback("plate", "\t--> Rebuilding index: "));
 
  }  catch (const vw::Exception& e) {
     std::cout << "An error occured: " << e.what() << "\nExiting.\n\n";
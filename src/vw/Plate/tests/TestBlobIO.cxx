@@ -227,3 +227,82 @@ TEST_F(BlobIOTest, Iterator) {
   ++iter;
   EXPECT_EQ( blob.end(), iter );
 }
+
+TEST_F(BlobIOTest, RecordIndex) {
+  std::vector<uint64> offsets;
+  {
+    Blob blob(blob_path);
+    for (int i = 0; i < 3; ++i) {
+      hdr.set_col(i);
+      offsets.push_back(blob.write(hdr, test_data, data_size));
+    }
+    std::vector<uint64> found = blob.record_offsets();
+    EXPECT_RANGE_EQ(offsets.begin(), offsets.end(), found.begin(), found.end());
+  }
+
+  {
+    ReadBlob blob(blob_path);
+    EXPECT_TRUE(blob.has_index());
+    std::vector<uint64> found = blob.record_offsets();
+    EXPECT_RANGE_EQ(offsets.begin(), offsets.end(), found.begin(), found.end());
+    EXPECT_EQ(2, blob.read_header(found[2]).col());
+  }
+
+  // Appending replaces the index, and the new tile follows the old ones.
+  {
+    Blob blob(blob_path);
+    hdr.set_col(3);
+    offsets.push_back(blob.write(hdr, test_data, data_size));
+    EXPECT_EQ(offsets[2] + (offsets[2] - offsets[1]), offsets[3]);
+  }
+
+  {
+    ReadBlob blob(blob_path);
+    EXPECT_TRUE(blob.has_index());
+    std::vector<uint64> found = blob.record_offsets();
+    EXPECT_RANGE_EQ(offsets.begin(), offsets.end(), found.begin(), found.end());
+
+    // The iterator agrees with the index.
+    std::vector<uint64> walked;
+    for (ReadBlob::iterator i = blob.begin(), end = blob.end(); i != end; ++i)
+      walked.push_back(i.current_base_offset());
+    EXPECT_RANGE_EQ(offsets.begin(), offsets.end(), walked.begin(), walked.end());
+  }
+}
+
+TEST_F(BlobIOTest, Variants) {
+  TileVariants variants;
+  variants.push_back(TileVariant("jpg", TileData(new std::vector<uint8>(test_data, test_data+5))));
+  variants.push_back(TileVariant("png", TileData(new std::vector<uint8>(test_data+5, test_data+15))));
+
+  uint64 offset1, offset2;
+  {
+    Blob blob(blob_path);
+    offset1 = blob.write(hdr, test_data, data_size, variants);
+    offset2 = blob.write(hdr, test_data, data_size);
+  }
+
+  ReadBlob blob(blob_path);
+
+  // The variants don't get in the way of anything that doesn't ask for them
+  EXPECT_EQ(offset2, blob.next_base_offset(offset1));
+  TileData data = blob.read_data(offset1);
+  EXPECT_RANGE_EQ(test_data+0, test_data+data_size, data->begin(), data->end());
+
+  data = blob.read_variant(offset1, "png");
+  ASSERT_TRUE(data.get());
+  EXPECT_RANGE_EQ(test_data+5, test_data+15, data->begin(), data->end());
+  EXPECT_FALSE(blob.read_variant(offset1, "tif").get());
+  EXPECT_FALSE(blob.read_variant(offset2, "png").get());
+
+  std::string filename;
+  uint64 offset, size;
+  std::vector<BlobSendfileRange> ranges;
+  blob.read_sendfile(offset1, filename, offset, size, &ranges);
+  EXPECT_EQ(data_size, size);
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ("jpg", ranges[0].filetype);
+  EXPECT_EQ(5u, ranges[0].size);
+  EXPECT_EQ(ranges[0].offset + 5, ranges[1].offset);
+  EXPECT_EQ(ranges[1].offset + 10, offset);
+}
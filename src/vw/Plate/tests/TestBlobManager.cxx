@@ -9,6 +9,7 @@
 #include <test/Helpers.h>
 #include <vw/Plate/BlobManager.h>
 #include <vw/Plate/Exception.h>
+#include <vw/Core/ThreadPool.h>
 #include <boost/filesystem/convenience.hpp>
 #include <fstream>
 
@@ -17,6 +18,32 @@ using namespace vw::platefile;
 using namespace vw::test;
 namespace fs = boost::filesystem;
 
+namespace {
+  // Locks and releases blobs, and counts the times it was handed a blob
+  // someone else held.
+  class Churn {
+      BlobManager& m_bm;
+      Atomic<uint32>* m_held;
+      uint32 m_num_held;
+      Atomic<uint32>& m_clashes;
+    public:
+      typedef void result_type;
+      Churn(BlobManager& bm, Atomic<uint32>* held, uint32 num_held, Atomic<uint32>& clashes)
+        : m_bm(bm), m_held(held), m_num_held(num_held), m_clashes(clashes) {}
+      void operator()() const {
+        for (int i = 0; i < 2000; ++i) {
+          uint32 id = m_bm.request_lock();
+          if (id >= m_num_held || !m_held[id].compare_and_swap(0, 1)) {
+            ++m_clashes;
+            continue;
+          }
+          m_held[id].store(0);
+          m_bm.release_lock(id, i);
+        }
+      }
+  };
+}
+
 class BlobManagerTest : public ::testing::Test {
   protected:
     UnlinkName blob_dir;
@@ -117,3 +144,35 @@ TEST_F(BlobManagerTest, Scan) {
   EXPECT_EQ(4, bm->blob_size(id2));
   EXPECT_EQ(6, bm->blob_size(id3));
 }
+
+TEST_F(BlobManagerTest, GivenSize) {
+  uint32 blob_id = bm->request_lock();
+  bm->release_lock(blob_id, 1234);
+  EXPECT_EQ(1234, bm->blob_size(blob_id));
+}
+
+TEST_F(BlobManagerTest, Affinity) {
+  uint32 id1 = bm->request_lock(),
+         id2 = bm->request_lock();
+  bm->release_lock(id1);
+  bm->release_lock(id2);
+
+  // The blob released last comes back first; the other is still free.
+  EXPECT_EQ(id2, bm->request_lock());
+  EXPECT_EQ(id1, bm->request_lock());
+  EXPECT_EQ(2, bm->num_blobs());
+}
+
+TEST_F(BlobManagerTest, Threads) {
+  // More blobs than could ever be in use, so an id out of range is a bug.
+  Atomic<uint32> held[64];
+  Atomic<uint32> clashes(0);
+
+  FifoWorkQueue queue(8);
+  std::vector<Future<void> > futures;
+  for (int i = 0; i < 8; ++i)
+    futures.push_back(queue.submit(Churn(*bm, held, 64, clashes)));
+  when_all(futures);
+
+  EXPECT_EQ(0, clashes.load());
+}
@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+
+#include <vw/Plate/PlateCompact.h>
+#include <vw/Plate/detail/LocalIndex.h>
+#include <vw/Plate/Blob.h>
+
+#include <boost/filesystem/convenience.hpp>
+namespace fs = boost::filesystem;
+
+using namespace std;
+using namespace vw;
+using namespace vw::platefile;
+using namespace vw::platefile::detail;
+using namespace vw::test;
+
+class CompactTest : public ::testing::Test {
+  protected:
+
+  virtual void SetUp() {
+    index_hdr.set_tile_size(256);
+    index_hdr.set_tile_filetype("tiff");
+    index_hdr.set_pixel_format(VW_PIXEL_RGB);
+    index_hdr.set_channel_type(VW_CHANNEL_UINT8);
+    index_hdr.set_type("rawr");
+
+    plate = UnlinkName("Compact");
+    fs::create_directories(plate);
+    index.reset(new LocalIndex(plate, index_hdr));
+  }
+
+  virtual void TearDown() {
+    index.reset();
+    fs::remove_all(plate + ".compact");
+    fs::remove_all(plate + ".precompact");
+  }
+
+  static std::string blob_name(const std::string& plate, uint32 blob_id) {
+    return plate + "/plate_" + vw::stringify(blob_id) + ".blob";
+  }
+
+  // Writes a tile whose payload is size bytes of value.
+  void write_tile(uint32 col, uint32 row, uint32 level, uint8 value, size_t size) {
+    TileHeader hdr;
+    hdr.set_filetype("tiff");
+    hdr.set_col(col);
+    hdr.set_row(row);
+    hdr.set_level(level);
+    hdr.set_transaction_id(1);
+    std::vector<uint8> data(size, value);
+
+    IndexRecord rec;
+    rec.set_blob_id(index->write_request());
+    rec.set_filetype("tiff");
+    {
+      Blob blob(blob_name(plate, rec.blob_id()));
+      rec.set_blob_offset(blob.write(hdr, &data[0], data.size()));
+    }
+    index->write_update(hdr, rec);
+    index->write_complete(rec.blob_id());
+  }
+
+  // Checks that the tile reads back from the plate with the payload
+  // write_tile() gave it.
+  void expect_tile(uint32 col, uint32 row, uint32 level, uint8 value, size_t size) {
+    SCOPED_TRACE(::testing::Message() << "tile " << col << "," << row << "@" << level);
+    LocalIndex idx(plate);
+    IndexRecord rec;
+    ASSERT_NO_THROW(rec = idx.read_request(col, row, level, 1, true));
+    ReadBlob blob(blob_name(plate, rec.blob_id()));
+    BlobTileRecord r = blob.read_record(rec.blob_offset());
+    EXPECT_EQ(col,   r.hdr.col());
+    EXPECT_EQ(row,   r.hdr.row());
+    EXPECT_EQ(level, r.hdr.level());
+    ASSERT_EQ(size, r.data->size());
+    std::vector<uint8> expected(size, value);
+    EXPECT_RANGE_EQ(expected.begin(), expected.end(), r.data->begin(), r.data->end());
+  }
+
+  IndexHeader index_hdr;
+  UnlinkName plate;
+  boost::shared_ptr<LocalIndex> index;
+};
+
+TEST_F(CompactTest, DropsDeadTiles) {
+  write_tile(0, 0, 0, 10, 100);
+  write_tile(0, 0, 1, 11, 100);
+  write_tile(1, 0, 1, 12, 100);
+  write_tile(0, 1, 1, 13, 100);
+  write_tile(1, 1, 1, 14, 500);
+  // Same tile, same transaction: the index now points here, and the
+  // 500 bytes written first are dead.
+  write_tile(1, 1, 1, 15, 100);
+  index.reset();
+
+  CompactResult r = compact_plate(plate);
+  EXPECT_EQ(5u,   r.live_tiles);
+  EXPECT_EQ(500u, r.dead_bytes);
+  EXPECT_GT(r.old_size, r.new_size);
+
+  EXPECT_TRUE(fs::exists(plate + "/plate.index"));
+  EXPECT_FALSE(fs::exists(plate + ".compact"));
+  EXPECT_FALSE(fs::exists(plate + ".precompact"));
+
+  expect_tile(0, 0, 0, 10, 100);
+  expect_tile(0, 0, 1, 11, 100);
+  expect_tile(1, 0, 1, 12, 100);
+  expect_tile(0, 1, 1, 13, 100);
+  expect_tile(1, 1, 1, 15, 100);
+
+  // Nothing is dead any more.
+  CompactOptions dry;
+  dry.dry_run = true;
+  r = compact_plate(plate, dry);
+  EXPECT_EQ(5u, r.live_tiles);
+  EXPECT_EQ(0u, r.dead_bytes);
+}
+
+TEST_F(CompactTest, KeepOld) {
+  write_tile(0, 0, 0, 10, 100);
+  write_tile(0, 0, 0, 11, 100);
+  index.reset();
+
+  CompactOptions opts;
+  opts.keep_old = true;
+  CompactResult r = compact_plate(plate, opts);
+  EXPECT_EQ(1u,   r.live_tiles);
+  EXPECT_EQ(100u, r.dead_bytes);
+  EXPECT_TRUE(fs::exists(plate + ".precompact/plate.index"));
+  expect_tile(0, 0, 0, 11, 100);
+
+  // The old plate is left over, so a second run refuses.
+  EXPECT_THROW(compact_plate(plate), IOErr);
+}
@@ -9,7 +9,9 @@
 #include <test/Helpers.h>
 #include <vw/Plate/Datastore.h>
 #include <vw/FileIO/TemporaryFile.h>
+#include <vw/Core/ThreadPool.h>
 #include <boost/filesystem/operations.hpp>
+#include <boost/foreach.hpp>
 namespace fs = boost::filesystem;
 
 using namespace std;
@@ -185,6 +187,41 @@ TEST_P(IDatastore, InsertRegion) {
   store->transaction_end(id, true);
 }
 
+TEST_P(IDatastore, BatchInsert) {
+  boost::scoped_ptr<Datastore> store;
+  ASSERT_NO_THROW(store.reset(Datastore::open(m_url, m_hdr)));
+
+  boost::scoped_ptr<WriteState> state;
+  Transaction id(0);
+
+  ASSERT_NO_THROW(id = store->transaction_begin("batch test"));
+  ASSERT_NO_THROW(state.reset(store->write_request(id)));
+
+  const val_t vals[] = {vA, vB, vC};
+  Datastore::TileSearch batch;
+  for (uint32 i = 0; i < 3; ++i) {
+    TileHeader hdr;
+    hdr.set_level(1);
+    hdr.set_row(i / 2);
+    hdr.set_col(i % 2);
+    hdr.set_filetype(TYPE1);
+    const uint8* data = reinterpret_cast<const uint8*>(&vals[i]);
+    batch.push_back(Tile(hdr, TileData(new std::vector<uint8>(data, data + sizeof(val_t)))));
+  }
+  store->write_updates(*state, batch);
+
+  Datastore::TileSearch r;
+  store->get(r, 1, BBox2u(0,0,2,2), TransactionRange(id));
+  ASSERT_EQ(3, r.size());
+  BOOST_FOREACH(const Tile& t, r) {
+    EXPECT_EQ(id, t.hdr.transaction_id());
+    EXPECT_EQ(vals[t.hdr.row()*2 + t.hdr.col()], *reinterpret_cast<val_t*>(&t.data->operator[](0)));
+  }
+
+  store->write_complete(*state);
+  store->transaction_end(id, true);
+}
+
 TEST_P(IDatastore, Logging) {
   boost::scoped_ptr<Datastore> store;
   ASSERT_NO_THROW(store.reset(Datastore::open(m_url, m_hdr)));
@@ -193,6 +230,73 @@ TEST_P(IDatastore, Logging) {
   store->error_log()() << "This should produce output" << std::endl;
 }
 
+namespace {
+  // Writes a row of tiles, each holding its column, with its own write state.
+  struct WriteRow {
+    typedef void result_type;
+    Datastore& store;
+    Transaction id;
+    uint32 level, row, cols;
+    WriteRow(Datastore& store, Transaction id, uint32 level, uint32 row, uint32 cols)
+      : store(store), id(id), level(level), row(row), cols(cols) {}
+    void operator()() const {
+      boost::scoped_ptr<WriteState> state(store.write_request(id));
+      for (val_t col = 0; col < cols; ++col)
+        store.write_update(*state, level, row, col, TYPE1, reinterpret_cast<const uint8*>(&col), sizeof(val_t));
+      store.write_complete(*state);
+    }
+  };
+}
+
+TEST(Dirstore, ConcurrentWrites) {
+  TemporaryDir tmpdir(TEST_OBJDIR);
+  Url url;
+  url.scheme("dir");
+  url.path(tmpdir.filename() + "/test.plate");
+  IndexHeader hdr;
+  hdr.set_tile_size(256);
+  hdr.set_tile_filetype("jpg");
+  hdr.set_pixel_format(VW_PIXEL_RGBA);
+  hdr.set_channel_type(VW_CHANNEL_UINT8);
+  hdr.set_type("test");
+
+  boost::scoped_ptr<Datastore> store;
+  ASSERT_NO_THROW(store.reset(Datastore::open(url, hdr)));
+  Transaction id = store->transaction_begin("concurrent test");
+
+  // Two writers per row, so every tile is also written twice at once.
+  const uint32 level = 8, rows = 8, cols = 40;
+  FifoWorkQueue queue(4);
+  std::vector<Future<void> > futures;
+  for (uint32 row = 0; row < 2*rows; ++row)
+    futures.push_back(queue.submit(WriteRow(*store, id, level, row % rows, cols)));
+  when_all(futures);
+
+  EXPECT_EQ(level + 1, store->num_levels());
+
+  Datastore::TileSearch r;
+  store->get(r, level, BBox2u(0, 0, cols, rows), TransactionRange(id));
+  ASSERT_EQ(rows * cols, r.size());
+  BOOST_FOREACH(const Tile& t, r)
+    EXPECT_EQ(t.hdr.col(), *reinterpret_cast<val_t*>(&t.data->operator[](0)));
+
+  // A second look comes from the cache, and must agree.
+  store->head(r, level, BBox2u(0, 0, cols, rows), TransactionRange(-1));
+  EXPECT_EQ(rows * cols, r.size());
+
+  // The level is sharded: the buckets live below two-digit shard directories.
+  size_t shards = 0;
+  BOOST_FOREACH(const fs::path& p, std::make_pair(fs::directory_iterator(url.path() + "/by-loc/008"), fs::directory_iterator())) {
+    const std::string& name = p.filename();
+    EXPECT_EQ(2u, name.size());
+    ++shards;
+  }
+  EXPECT_LT(0u, shards);
+  EXPECT_EQ(0, std::distance(fs::directory_iterator(url.path() + "/tmp"), fs::directory_iterator()));
+
+  store->transaction_end(id, true);
+}
+
 std::vector<string> test_urls() {
   std::vector<string> v;
   v.push_back("file");
@@ -277,3 +277,32 @@ TEST(HTTPUtils, PlatefileUrl) {
   EXPECT_EQ("pants2.plate", u.name());
   EXPECT_EQ("moo://moo/?bob=waffles", u.base().string());
 }
+
+TEST(HTTPUtils, EtagMatches) {
+  const string etag("\"1-2-3\"");
+  EXPECT_TRUE(etag_matches("\"1-2-3\"", etag));
+  EXPECT_TRUE(etag_matches("*", etag));
+  EXPECT_TRUE(etag_matches("\"a\", \"1-2-3\"", etag));
+  EXPECT_TRUE(etag_matches("\"a\",W/\"1-2-3\"", etag));
+  EXPECT_TRUE(etag_matches("\"1-2-3\"", "W/" + etag));
+
+  EXPECT_FALSE(etag_matches("", etag));
+  EXPECT_FALSE(etag_matches("\"1-2-4\"", etag));
+  EXPECT_FALSE(etag_matches("1-2-3", etag));
+  EXPECT_FALSE(etag_matches("\"1-2-3\" \"a\"", etag));
+}
+
+TEST(HTTPUtils, AcceptQuality) {
+  EXPECT_EQ(1, accept_quality("", "image/png"));
+  EXPECT_EQ(1, accept_quality("image/png", "image/png"));
+  EXPECT_EQ(0, accept_quality("image/png", "image/jpeg"));
+
+  const string browser("image/webp,image/png;q=0.9,image/*;q=0.8,*/*;q=0.5");
+  EXPECT_EQ(0.9, accept_quality(browser, "image/png"));
+  EXPECT_EQ(0.8, accept_quality(browser, "image/jpeg"));
+  EXPECT_EQ(0.5, accept_quality(browser, "application/octet-stream"));
+
+  // The most specific range wins, even with a lower q
+  EXPECT_EQ(0.1, accept_quality("*/*, image/jpeg; q=0.1", "image/jpeg"));
+  EXPECT_EQ(0,   accept_quality("image/*;q=bogus", "image/jpeg"));
+}
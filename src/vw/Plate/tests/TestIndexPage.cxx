@@ -9,6 +9,9 @@
 #include <test/Helpers.h>
 #include <vw/Plate/detail/LocalIndex.h>
 #include <vw/Plate/Exception.h>
+#include <vw/Plate/google/sparsetable>
+
+#include <fstream>
 
 using namespace std;
 using namespace vw;
@@ -158,3 +161,97 @@ TEST_F(IndexPageTest, Serialization) {
   EXPECT_EQ( rec[2].blob_id(),     out_rec.blob_id() );
   EXPECT_EQ( rec[2].blob_offset(), out_rec.blob_offset() );
 }
+
+TEST_F(IndexPageTest, OutOfOrder) {
+  // Set every other transaction of a few cells, in an order the
+  // records don't sort in, and some of them twice.
+  TileHeader hdr;
+  IndexRecord rec;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int32 tid = 9; tid >= 0; tid -= 2) {
+      for (uint32 col = 0; col < 3; ++col) {
+        hdr.set_col(col);
+        hdr.set_row(7);
+        hdr.set_transaction_id(tid);
+        rec.set_blob_id(pass);
+        rec.set_blob_offset(100*col + tid);
+        page->set(hdr, rec);
+      }
+    }
+  }
+
+  EXPECT_EQ(3, page->sparse_size());
+  EXPECT_EQ(15u, page->num_records());
+
+  IndexRecord out_rec = page->get(1, 7, 4);
+  EXPECT_EQ( 1,   out_rec.blob_id() );
+  EXPECT_EQ( 103, out_rec.blob_offset() );
+
+  IndexPage::multi_value_type recs = page->multi_get(2, 7, 2, 8);
+  ASSERT_EQ(3u, recs.size());
+  EXPECT_EQ(7u, recs.front().first);
+  EXPECT_EQ(3u, recs.back().first);
+
+  // Records are in order of location and then newest first.
+  EXPECT_EQ(0, page->header(0).col());
+  EXPECT_EQ(9, page->header(0).transaction_id());
+  EXPECT_EQ(2, page->header(14).col());
+  EXPECT_EQ(1, page->header(14).transaction_id());
+}
+
+TEST_F(IndexPageTest, LegacyFormat) {
+  // Write a page in the sparse table format pages used to be saved in.
+  {
+    std::ofstream ostr(page_path.c_str(), std::ios::binary);
+    uint32 width = 1024, height = 1024;
+    ostr.write(reinterpret_cast<char*>(&width), sizeof(width));
+    ostr.write(reinterpret_cast<char*>(&height), sizeof(height));
+
+    google::sparsetable<uint8> table(width*height);
+    table.set(5*width + 3, 1);
+    table.set(6*width + 3, 1);
+    table.write_metadata(&ostr);
+
+    // Two records at (3,5), newest first, and one at (3,6)
+    const uint32 counts[] = {2, 1};
+    const uint32 tids[] = {2, 1, 4};
+    for (int i = 0, r = 0; i < 2; ++i) {
+      ostr.write(reinterpret_cast<const char*>(&counts[i]), sizeof(uint32));
+      for (uint32 j = 0; j < counts[i]; ++j, ++r) {
+        IndexRecord rec;
+        rec.set_blob_id(r);
+        rec.set_blob_offset(1000 + r);
+        if (r == 2)
+          rec.set_filetype("png");
+        std::string bytes = rec.SerializeAsString();
+        uint16 size = bytes.size();
+        ostr.write(reinterpret_cast<const char*>(&tids[r]), sizeof(uint32));
+        ostr.write(reinterpret_cast<char*>(&size), sizeof(size));
+        ostr.write(bytes.data(), size);
+      }
+    }
+  }
+
+  for (int reopen = 0; reopen < 2; ++reopen) {
+    SCOPED_TRACE(reopen ? "columnar" : "legacy");
+    page.reset(new LocalIndexPage(page_path,0,0,0,1024,1024));
+    EXPECT_EQ(2, page->sparse_size());
+
+    IndexRecord out_rec = page->get(3, 5, 1);
+    EXPECT_EQ( 1,    out_rec.blob_id() );
+    EXPECT_EQ( 1001, out_rec.blob_offset() );
+    EXPECT_FALSE( out_rec.has_filetype() );
+
+    out_rec = page->get(3, 6, -1);
+    EXPECT_EQ( 2,     out_rec.blob_id() );
+    EXPECT_EQ( "png", out_rec.filetype() );
+
+    // Touch the page, so it is saved in the columnar format.
+    TileHeader hdr;
+    hdr.set_col(3);
+    hdr.set_row(5);
+    hdr.set_transaction_id(2);
+    page->set(hdr, page->get(3, 5, 2));
+    page->sync();
+  }
+}
@@ -137,6 +137,40 @@ TEST(LocalIndex, BasicAccess) {
   }
 }
 
+namespace {
+  struct CountMisses {
+    std::vector<Vector2i>* misses;
+    CountMisses(std::vector<Vector2i>* misses) : misses(misses) {}
+    void operator()(uint32 /*level*/, uint32 col, uint32 row) const { misses->push_back(Vector2i(col, row)); }
+  };
+}
+
+TEST(LocalIndex, Prefetch) {
+  UnlinkName file("index");
+  boost::shared_ptr<LocalPageGeneratorFactory> page_gen_factory( new LocalPageGeneratorFactory(file) );
+
+  // Four pages of 2x2 tiles each.
+  IndexLevel level(page_gen_factory, 2, 2, 2, 4);
+  EXPECT_EQ(4u, level.num_pages());
+
+  std::vector<Vector2i> misses;
+  level.set_miss_hook(CountMisses(&misses));
+
+  EXPECT_THROW(level.get(0, 0, -1, false), TileNotFoundErr);
+  ASSERT_EQ(1u, misses.size());
+  EXPECT_VECTOR_EQ(Vector2i(0,0), misses[0]);
+
+  // Same page, already loaded
+  EXPECT_THROW(level.get(1, 1, -1, false), TileNotFoundErr);
+  EXPECT_EQ(1u, misses.size());
+
+  // The neighbors are loading or loaded, so reading them is no miss.
+  level.prefetch_neighbors(0, 0);
+  EXPECT_THROW(level.get(3, 3, -1, false), TileNotFoundErr);
+  EXPECT_THROW(level.get(2, 0, -1, false), TileNotFoundErr);
+  EXPECT_EQ(1u, misses.size());
+}
+
 TEST(LocalIndex, IndexRecord) {
 
   UnlinkName name("foo.bar");
@@ -239,6 +273,45 @@ TEST_F(LocalIndexTest, SkipTransactions) {
   EXPECT_EQ(   14u, tx3 );
 }
 
+TEST_F(LocalIndexTest, Rebuild) {
+  const uint8 data[4] = {1,2,3,4};
+  TileHeader a = tile_hdr, b = tile_hdr, c = tile_hdr;
+  a.set_level(1); a.set_col(1); a.set_row(0);
+  b.set_level(1); b.set_col(1); b.set_row(0); b.set_transaction_id(5);
+  c.set_level(3); c.set_col(7); c.set_row(2);
+
+  uint64 off_a, off_b, off_c;
+  {
+    Blob plate_blob(plate_path + "/plate_0.blob");
+    off_a = plate_blob.write(a, data, 4);
+    off_b = plate_blob.write(b, data, 4);
+  }
+  {
+    Blob plate_blob(plate_path + "/plate_3.blob");
+    off_c = plate_blob.write(c, data, 4);
+  }
+
+  index->rebuild_index();
+  EXPECT_EQ(4u, index->num_levels());
+  EXPECT_FALSE(fs::exists(plate_path + "/index/rebuild_checkpoint"));
+
+  IndexRecord rec = index->read_request(1, 0, 1, 4, true);
+  EXPECT_EQ(0u, rec.blob_id());
+  EXPECT_EQ(off_a, rec.blob_offset());
+  rec = index->read_request(1, 0, 1, -1);
+  EXPECT_EQ(off_b, rec.blob_offset());
+  rec = index->read_request(7, 2, 3, -1);
+  EXPECT_EQ(3u, rec.blob_id());
+  EXPECT_EQ(off_c, rec.blob_offset());
+  EXPECT_THROW(index->read_request(0, 0, 1, -1), TileNotFoundErr);
+
+  // The pages, header and filters are all on disk.
+  LocalIndex index2(plate_path);
+  EXPECT_EQ(4u, index2.num_levels());
+  EXPECT_TRUE(index2.has_tile_filters());
+  EXPECT_EQ(off_c, index2.read_request(7, 2, 3, -1).blob_offset());
+}
+
 TEST_F(LocalIndexTiles, BasicReadWrite) {
 
   IndexRecord in, out;
@@ -282,6 +355,79 @@ TEST_F(LocalIndexTiles, Simple) {
   EXPECT_THROW(index->read_request(0, 0, 2, -1), TileNotFoundErr);
 }
 
+TEST_F(LocalIndexTiles, ReadRequests) {
+  IndexRecord r1, r4;
+  index_write(hdrs[1], r1);
+  index_write(hdrs[4], r4);
+
+  std::vector<TileHeader> tiles;
+  tiles.push_back(hdrs[4]);
+  tiles.push_back(hdrs[0]);   // never written
+  tiles.push_back(hdrs[1]);
+  tiles.push_back(hdrs[1]);
+  tiles.back().set_level(12); // beyond the index
+  tiles.push_back(hdrs[1]);
+  tiles.back().set_transaction_id(-1);
+
+  Index::ReadResults res = index->read_requests(tiles);
+  ASSERT_EQ(tiles.size(), res.size());
+
+  ASSERT_TRUE(res[0].found);
+  check_tile_hdr(hdrs[4], res[0].header);
+  EXPECT_EQ(r4.blob_offset(), res[0].record.blob_offset());
+
+  EXPECT_FALSE(res[1].found);
+  EXPECT_FALSE(res[3].found);
+
+  ASSERT_TRUE(res[2].found);
+  EXPECT_EQ(r1.blob_offset(), res[2].record.blob_offset());
+  ASSERT_TRUE(res[4].found);
+  EXPECT_EQ(hdrs[1].transaction_id(), res[4].header.transaction_id());
+
+  // An exact match at a transaction that wasn't written finds nothing
+  tiles.assign(1, hdrs[4]);
+  tiles[0].set_transaction_id(hdrs[4].transaction_id() + 1);
+  EXPECT_FALSE(index->read_requests(tiles, true)[0].found);
+  EXPECT_TRUE(index->read_requests(tiles, false)[0].found);
+}
+
+TEST_F(LocalIndexTiles, TileFilters) {
+  ASSERT_TRUE(index->has_tile_filters());
+
+  IndexRecord rec;
+  index_write(hdrs[1], rec);
+  index_write(hdrs[4], rec);
+  index->sync();
+
+  // A reopened index gets the saved filters, and still finds the tiles.
+  index.reset();
+  index.reset(new LocalIndex(plate_path));
+  ASSERT_TRUE(index->has_tile_filters());
+  EXPECT_NO_THROW(index->read_request(0, 0, 1, -1));
+  EXPECT_NO_THROW(index->read_request(1, 1, 1, -1));
+  EXPECT_THROW(index->read_request(1, 0, 1, -1), TileNotFoundErr);
+  EXPECT_TRUE(index->search_by_location(1, 0, 1, 0, 100).empty());
+
+  // A write drops the saved filters until the next sync, so an index
+  // opened in between doesn't use them.
+  index_write(hdrs[2], rec);
+  {
+    LocalIndex other(plate_path);
+    EXPECT_FALSE(other.has_tile_filters());
+  }
+  index->sync();
+  {
+    LocalIndex other(plate_path);
+    EXPECT_TRUE(other.has_tile_filters());
+    EXPECT_NO_THROW(other.read_request(1, 0, 1, -1));
+  }
+
+  // Filters built from the pages find the same tiles.
+  index->build_tile_filters();
+  EXPECT_NO_THROW(index->read_request(1, 0, 1, -1));
+  EXPECT_THROW(index->read_request(0, 1, 1, -1), TileNotFoundErr);
+}
+
 TEST_F(LocalIndexTiles, ReadWrite) {
 
   {
@@ -6,6 +6,7 @@
 
 
 #include <gtest/gtest.h>
+#include <vw/Plate/mod_plate_utils.h>
 
 using namespace std;
 
@@ -63,3 +64,39 @@ TEST(ModPlate, HAS_APACHE(Assumptions)) {
   apr_pool_destroy(pool);
 #endif
 }
+
+TEST(ModPlate, LruCache) {
+  vw::platefile::LruCache<int, string> cache(2);
+  string value;
+
+  cache.insert(1, "one");
+  cache.insert(2, "two");
+  EXPECT_TRUE(cache.get(1, value));
+  EXPECT_EQ("one", value);
+
+  // 2 is the least recently used now
+  cache.insert(3, "three");
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_FALSE(cache.get(2, value));
+  EXPECT_TRUE(cache.get(1, value));
+  EXPECT_TRUE(cache.get(3, value));
+  EXPECT_EQ("three", value);
+
+  // Replacing a value doesn't evict anything
+  cache.insert(3, "drei");
+  EXPECT_TRUE(cache.get(1, value));
+  EXPECT_TRUE(cache.get(3, value));
+  EXPECT_EQ("drei", value);
+
+  EXPECT_EQ(5u, cache.hits());
+  EXPECT_EQ(1u, cache.misses());
+  EXPECT_EQ(1u, cache.evictions());
+
+  cache.set_max_size(1);
+  ASSERT_EQ(1u, cache.entries().size());
+  EXPECT_EQ(3, cache.entries()[0].first);
+
+  cache.clear();
+  EXPECT_FALSE(cache.get(3, value));
+  EXPECT_EQ(0u, cache.size());
+}
@@ -0,0 +1,70 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Plate/PlateView.h>
+
+using namespace std;
+using namespace vw;
+using namespace vw::platefile;
+using namespace vw::test;
+
+class PlateViewTest : public ::testing::Test {
+  protected:
+    typedef PixelGray<uint8> PixelT;
+
+    virtual void SetUp() {
+      PlateView<PixelT>::clear_tile_cache();
+      platename = UnlinkName("view.plate");
+      plate.reset(new PlateFile(Url(platename), "equi", "", 16, "png", VW_PIXEL_GRAY, VW_CHANNEL_UINT8));
+    }
+
+    // Writes a level 1 tile whose every pixel is value
+    void write_tile(int col, int row, uint8 value) {
+      plate->transaction_begin("test", -1);
+      plate->write_request();
+      plate->write_update(ImageView<PixelT>(constant_view(PixelT(value), 16, 16)), col, row, 1);
+      plate->write_complete();
+      plate->transaction_end(true);
+    }
+
+    UnlinkName platename;
+    boost::shared_ptr<PlateFile> plate;
+};
+
+TEST_F(PlateViewTest, ReadAhead) {
+  write_tile(0, 0, 10);
+  write_tile(1, 0, 20);
+  write_tile(0, 1, 30);
+  write_tile(1, 1, 40);
+
+  PlateView<PixelT> view(plate);
+  view.set_level(1);
+  ASSERT_EQ(32, view.cols());
+
+  // A region that touches all four tiles
+  ImageView<PixelT> img = crop(view, BBox2i(8, 8, 16, 16));
+  EXPECT_EQ(10, img(0, 0).v());
+  EXPECT_EQ(20, img(15, 0).v());
+  EXPECT_EQ(30, img(0, 15).v());
+  EXPECT_EQ(40, img(15, 15).v());
+  EXPECT_EQ(4u, platefile::detail::TileCache<PixelT>::instance().size());
+
+  // Another view of the same plate finds the tiles in the cache
+  PlateView<PixelT> view2(plate);
+  view2.set_level(1);
+  img = crop(view2, BBox2i(0, 0, 32, 32));
+  EXPECT_EQ(40, img(31, 31).v());
+  EXPECT_EQ(4u, platefile::detail::TileCache<PixelT>::instance().size());
+
+  // A rewritten tile is a new transaction, so it isn't served stale
+  write_tile(1, 1, 50);
+  img = crop(view2, BBox2i(16, 16, 16, 16));
+  EXPECT_EQ(50, img(0, 0).v());
+  EXPECT_EQ(5u, platefile::detail::TileCache<PixelT>::instance().size());
+}
@@ -136,6 +136,62 @@ TEST_P(RpcTest, Err) {
   EXPECT_EQ(1, server->stats().get("server_error"));
 }
 
+namespace {
+  void count_call(int* calls) { (*calls)++; }
+}
+
+TEST_P(RpcTest, Async) {
+  ASSERT_NO_FATAL_FAILURE(make_things(1));
+  Client& c = clients[0];
+
+  static const uint32 COUNT = 100;
+  vector<DoubleMessage> a(COUNT);
+  DoubleMessage q;
+  int calls = 0;
+
+  c->set_max_outstanding(8);
+  {
+    TestClient::AsyncScope async(*c);
+    for (uint32 i = 0; i < COUNT; ++i) {
+      q.set_num(i);
+      ASSERT_NO_THROW(c->DoubleRequest(c.get(), &q, &a[i], pb::NewCallback(&count_call, &calls)));
+      EXPECT_LE(c->outstanding(), 8u);
+    }
+    EXPECT_NO_THROW(c->complete_all());
+  }
+  EXPECT_FALSE(c->async());
+  EXPECT_EQ(0u, c->outstanding());
+  EXPECT_EQ(int(COUNT), calls);
+  for (uint32 i = 0; i < COUNT; ++i)
+    EXPECT_EQ(i*2, a[i].num());
+
+  // An error is thrown by the wait that receives it, and the other calls
+  // still complete.
+  {
+    TestClient::AsyncScope async(*c);
+    q.set_num(TestServiceImpl::CLIENT_ERROR);
+    c->DoubleRequest(c.get(), &q, &a[0], null_callback());
+    q.set_num(21);
+    c->DoubleRequest(c.get(), &q, &a[1], null_callback());
+    EXPECT_THROW(c->complete_one(), PlatefileErr);
+    EXPECT_TRUE(c->complete_one());
+    EXPECT_EQ(42, a[1].num());
+    EXPECT_FALSE(c->complete_one());
+  }
+
+  // A synchronous call completes the outstanding ones first.
+  {
+    TestClient::AsyncScope async(*c);
+    q.set_num(5);
+    c->DoubleRequest(c.get(), &q, &a[0], null_callback());
+  }
+  q.set_num(6);
+  ASSERT_NO_THROW(c->DoubleRequest(c.get(), &q, &a[1], null_callback()));
+  EXPECT_EQ(10, a[0].num());
+  EXPECT_EQ(12, a[1].num());
+  EXPECT_EQ(0u, c->outstanding());
+}
+
 TEST(TestRpc, HAS_ZEROMQ(KillServerDeathTest)) {
   Url u("zmq+ipc://" TEST_OBJDIR "/unittest2");
   Server server;
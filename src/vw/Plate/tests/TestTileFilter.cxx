@@ -0,0 +1,72 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <gtest/gtest.h>
+#include <test/Helpers.h>
+#include <vw/Plate/detail/TileFilter.h>
+
+#include <sstream>
+
+using namespace vw;
+using namespace vw::platefile::detail;
+
+TEST(TileFilter, Empty) {
+  TileFilter f;
+  EXPECT_EQ(0u, f.size());
+  EXPECT_FALSE(f.may_contain(0, 0));
+  EXPECT_FALSE(f.may_contain(17, 42));
+}
+
+TEST(TileFilter, NoFalseNegatives) {
+  // Small first stage, so the filter has to grow several times.
+  TileFilter f(64);
+  for (uint32 row = 0; row < 100; ++row)
+    for (uint32 col = 0; col < 100; ++col)
+      f.insert(col, row);
+
+  for (uint32 row = 0; row < 100; ++row)
+    for (uint32 col = 0; col < 100; ++col)
+      ASSERT_TRUE(f.may_contain(col, row)) << "(" << col << "," << row << ")";
+
+  // Inserting a location again doesn't count it twice.
+  f.insert(5, 5);
+  EXPECT_EQ(10000u, f.size());
+}
+
+TEST(TileFilter, FalsePositiveRate) {
+  TileFilter f(1000);
+  for (uint32 i = 0; i < 10000; ++i)
+    f.insert(i, 2*i);
+
+  uint32 hits = 0;
+  for (uint32 i = 0; i < 100000; ++i)
+    if (f.may_contain(i, 2*i+1))
+      hits++;
+  // The rate is at most 2% by design; allow some slack.
+  EXPECT_LT(hits, 3000u);
+}
+
+TEST(TileFilter, Serialize) {
+  TileFilter f(64);
+  for (uint32 i = 0; i < 500; ++i)
+    f.insert(3*i, i);
+
+  std::stringstream stream;
+  f.serialize(stream);
+
+  TileFilter g;
+  g.deserialize(stream);
+  EXPECT_EQ(f.size(), g.size());
+  EXPECT_EQ(f.memory_size(), g.memory_size());
+  for (uint32 i = 0; i < 2000; ++i)
+    EXPECT_EQ(f.may_contain(i, i/3), g.may_contain(i, i/3));
+
+  std::stringstream garbage("not a filter");
+  EXPECT_THROW(g.deserialize(garbage), IOErr);
+  // A failed load leaves the filter alone.
+  EXPECT_TRUE(g.may_contain(3, 1));
+}
@@ -272,16 +272,15 @@ int main( int argc, char *argv[] ) {
     return 1;
   }
 
-  SrcImageResource *rsrc = DiskImageResource::open(first_handler.get_path().string());
-  PixelFormatEnum pixel_format = rsrc->pixel_format();
-  ChannelTypeEnum channel_type = rsrc->channel_type();
-  int32 tile_size = rsrc->rows();
+  ImageFormat first_format = DiskImageResource::peek_format(first_handler.get_path().string());
+  PixelFormatEnum pixel_format = first_format.pixel_format;
+  ChannelTypeEnum channel_type = first_format.channel_type;
+  int32 tile_size = first_format.rows;
 
   if (pixel_format == VW_PIXEL_GRAY)
     pixel_format = VW_PIXEL_GRAYA;
   if (pixel_format == VW_PIXEL_RGB)
     pixel_format = VW_PIXEL_RGBA;
-  delete rsrc;
 
   if( !vm.count("file-type") ) {
     if (channel_type == VW_CHANNEL_FLOAT32)
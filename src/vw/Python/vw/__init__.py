@@ -24,6 +24,7 @@ from pixel import channel_type, pixel_type, pixel_format, channel_range
 # Images
 import image
 from image import Image, isimage
+from image import from_numpy, to_numpy
 
 # Pixel type casting for pixels and images
 import pixelcast
@@ -67,6 +68,13 @@ from qtree import QuadTreeGenerator
 import composite
 from composite import ImageComposite
 
+# Plate files, when the Plate module was built
+try:
+  import plate
+  from plate import PlateFile
+except ImportError:
+  pass
+
 # Cartography
 import cartography
 from cartography import Datum, GeoReference, read_georeference, geotransform, PixelAsPoint, PixelAsArea
@@ -8,12 +8,15 @@
 %module fileio
 %include "std_string.i"
 %import "_image.i"
+%include "vwutil.i"
 
 %{
 #include <vw/Image.h>
 #include <vw/FileIO.h>
 %}
 
+HANDLE_VW_EXCEPTIONS(_read_block)
+
 namespace vw {
   class DiskImageResource {
   public:
@@ -88,6 +91,12 @@ namespace vw {
       int get_channels() const { return self->channels(); }
       std::string get_filename() const { return self->filename(); }
       vw::ImageViewRef<PixelT> ref() const { return *self; }
+      int _block_cols() const { return self->resource()->block_read_size().x(); }
+      int _block_rows() const { return self->resource()->block_read_size().y(); }
+      vw::ImageView<PixelT> _read_block( int x, int y, int cols, int rows ) const {
+        ReleaseGIL nogil;
+        return crop( *self, x, y, cols, rows );
+      }
     }
 
     %pythoncode {
@@ -96,6 +105,16 @@ namespace vw {
       planes = property(get_planes)
       channels = property(get_channels)
       filename = property(get_filename)
+      block_size = property(lambda self: (self._block_cols(), self._block_rows()))
+
+      def read_block(self, x, y, cols=None, rows=None):
+        '''Reads the region at (x,y), by default the size of the
+        file's blocks, as a NumPy array that shares the pixels read.
+        The GIL is released while reading.'''
+        import numpy
+        if cols is None: cols = min(self._block_cols(), self.cols - x)
+        if rows is None: rows = min(self._block_rows(), self.rows - y)
+        return numpy.asarray(self._read_block(x, y, cols, rows))
     }
   };
 }
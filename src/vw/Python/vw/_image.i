@@ -9,11 +9,15 @@
 %include "std_string.i"
 %include "std_vector.i"
 %import "_pixel.i"
+%include "vwutil.i"
 
 %{
 #include <vw/Image.h>
 %}
 
+HANDLE_VW_EXCEPTIONS(rasterize)
+HANDLE_VW_EXCEPTIONS(_block_rasterize_into)
+
 %template(vector_float32) std::vector<vw::float32>;
 
 %pythoncode {
@@ -52,6 +56,23 @@
     else:
       return image.get_pixel(*pos)
 
+  # NumPy finds this through the __array_interface__ property, so
+  # numpy.asarray(image) shares the image's memory instead of copying
+  # it.  The array keeps the image (and so its memory) alive.
+  def Image_array_interface(image):
+    import numpy
+    if image.cols == 0 or image.rows == 0:
+      raise ValueError, 'Cannot export an empty image to NumPy'
+    ctype = numpy.dtype(image.channel_type)
+    shape = (image.rows, image.cols)
+    strides = (image._rstride(), image.channels * ctype.itemsize)
+    if image.channels > 1:
+      shape, strides = shape + (image.channels,), strides + (ctype.itemsize,)
+    if image.planes > 1:
+      shape, strides = (image.planes,) + shape, (image._pstride(),) + strides
+    return { 'version': 3, 'shape': shape, 'strides': strides, 'typestr': ctype.str,
+             'data': (image._data_address(), False) }
+
   def Image_setitem(image, pos, val):
     if isinstance(pos, slice):
       image.set_region(val, pos.start[0], pos.start[1], pos.stop[0]-pos.start[0], pos.stop[1]-pos.start[1])
@@ -105,10 +126,14 @@ namespace vw {
       ImageView get_plane( int index ) { return select_plane(*self,index); }
       void set_plane( ImageView const& val, int index ) { select_plane(*self,index) = val; }
       void set_plane( PixelT const& val, int index ) { fill( select_plane(*self,index), val ); }
+      size_t _data_address() const { return reinterpret_cast<size_t>( self->data() ); }
+      long _rstride() const { return long( self->buffer().rstride ); }
+      long _pstride() const { return long( self->buffer().pstride ); }
     }
     %pythoncode {
       __getitem__ = Image_getitem
       __setitem__ = Image_setitem
+      __array_interface__ = property(Image_array_interface)
       cols = property(get_cols)
       rows = property(get_rows)
       planes = property(get_planes)
@@ -127,7 +152,12 @@ namespace vw {
       int get_rows() const { return self->rows(); }
       int get_planes() const { return self->planes(); }
       int get_channels() const { return self->channels(); }
-      ImageView<PixelT> rasterize() const { return vw::copy(*self); }
+      ImageView<PixelT> rasterize() const { ReleaseGIL nogil; return vw::copy(*self); }
+      void _block_rasterize_into( ImageView<PixelT> const& dest, int x, int y, int block_cols, int block_rows, int threads ) const {
+        ReleaseGIL nogil;
+        vw::block_rasterize( crop( *self, x, y, dest.cols(), dest.rows() ), vw::Vector2i( block_cols, block_rows ), threads )
+          .rasterize( dest, vw::BBox2i( 0, 0, dest.cols(), dest.rows() ) );
+      }
       pixel_type get_pixel( int x, int y, int p=0 ) { return self->operator()(x,y,p); }
       ImageView<pixel_type> get_region( int x, int y, int cols, int rows ) { return crop(*self,x,y,cols,rows); }
       ImageView<pixel_type> get_col( int index ) { return select_col(*self,index); }
@@ -172,13 +202,77 @@ namespace vw {
 
     __getitem__ = Image_getitem
     __setitem__ = Image_setitem
+
+  _numpy_pixel_formats = { 1: pixel.PixelGray, 2: pixel.PixelGrayA, 3: pixel.PixelRGB, 4: pixel.PixelRGBA }
+
+  def from_numpy(array, ptype=None):
+    '''Wraps a C-contiguous NumPy array as an image, without copying.
+    The array is (rows, cols) for scalar pixels, or (rows, cols,
+    channels) for gray, gray-alpha, RGB and RGBA pixels.  Writes to
+    either one show up in the other.'''
+    if not array.flags['C_CONTIGUOUS']:
+      raise ValueError, 'Array must be C-contiguous; see numpy.ascontiguousarray'
+    ctype = array.dtype.type
+    if ctype not in pixel._channel_range_table:
+      raise TypeError, 'Unsupported channel type %s' % array.dtype
+    if array.ndim == 2:
+      pformat = pixel.PixelScalar
+    elif array.ndim == 3 and array.shape[2] in _numpy_pixel_formats:
+      pformat = _numpy_pixel_formats[array.shape[2]]
+    else:
+      raise ValueError, 'Cannot make an image of an array of shape %s' % (array.shape,)
+    if ptype is None:
+      ptype = pformat[ctype]
+    elif ptype is not pformat[ctype]:
+      raise TypeError, 'Array does not hold pixels of type %s' % ptype
+    wrap = _wrap_buffer_table[ptype]
+    return wrap(array, array.__array_interface__['data'][0], array.shape[1], array.shape[0])
+
+  def to_numpy(image, bbox=None, block_size=(256,256), threads=0, out=None):
+    '''Rasterizes image, or the bbox region of it, into a NumPy array,
+    a block at a time on threads threads (0 for the default).  The GIL
+    is released while it runs.  The result goes into out if it is
+    given, which must be a C-contiguous array of the right shape and
+    type, and otherwise into a new array.'''
+    import numpy
+    ref = image.ref()
+    if bbox is None:
+      x, y, cols, rows = 0, 0, ref.cols, ref.rows
+    else:
+      x, y, cols, rows = bbox.minx, bbox.miny, bbox.width, bbox.height
+    if out is None:
+      dest = _pixel_image_table[ref.pixel_type](cols, rows)
+    else:
+      dest = from_numpy(out, ref.pixel_type)
+      if dest.cols != cols or dest.rows != rows:
+        raise ValueError, 'Output array is %dx%d, not %dx%d' % (dest.cols, dest.rows, cols, rows)
+    ref._block_rasterize_into(dest, x, y, block_size[0], block_size[1], threads)
+    if out is None:
+      return numpy.asarray(dest)
+    return out
+}
+
+%inline %{
+  // Shares owner's memory, which must hold rows*cols packed pixels at
+  // address.  Owner is kept alive for as long as the image is.
+  template <class PixelT>
+  vw::ImageView<PixelT> _wrap_buffer( PyObject *owner, size_t address, int cols, int rows ) {
+    boost::shared_array<PixelT> data( reinterpret_cast<PixelT*>( address ), GILDecrefDeleter( owner ) );
+    return vw::ImageView<PixelT>( data, cols, rows );
+  }
+%}
+
+%pythoncode {
+  _wrap_buffer_table = dict()
 }
 
 %define %instantiate_image_types(cname,ctype,pname,ptype,...)
   %template(ImageView_##pname) vw::ImageView<ptype >;
   %template(ImageViewRef_##pname) vw::ImageViewRef<ptype >;
+  %template(_wrap_buffer_##pname) _wrap_buffer<ptype >;
   %pythoncode {
     _pixel_image_table[pixel.pname] = ImageView_##pname
+    _wrap_buffer_table[pixel.pname] = _wrap_buffer_##pname
     ImageView_##pname.pixel_type = pixel.pname
     ImageViewRef_##pname.pixel_type = pixel.pname
     try:
@@ -0,0 +1,296 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file _plate.i
+///
+/// Bindings for writing tiles to and reading them from plate files, so
+/// that ingest can run in-process instead of through image2plate and
+/// platecopy.  The batch calls take and return whole lists of tiles,
+/// and release the GIL for the encoding, decoding and I/O, so Python
+/// threads can prepare the next batch while one is written.
+///
+
+%module plate
+%include "std_string.i"
+%include "std_vector.i"
+%import "_image.i"
+%include "vwutil.i"
+
+%{
+#include <vw/Image.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Plate/PlateFile.h>
+%}
+
+HANDLE_VW_EXCEPTIONS(PlateFile)
+HANDLE_VW_EXCEPTIONS(transaction_begin)
+HANDLE_VW_EXCEPTIONS(transaction_end)
+HANDLE_VW_EXCEPTIONS(write_request)
+HANDLE_VW_EXCEPTIONS(write_complete)
+HANDLE_VW_EXCEPTIONS(flush_writes)
+HANDLE_VW_EXCEPTIONS(sync)
+HANDLE_VW_EXCEPTIONS(_write_encoded)
+HANDLE_VW_EXCEPTIONS(_write_images)
+HANDLE_VW_EXCEPTIONS(_read_encoded)
+HANDLE_VW_EXCEPTIONS(_read_images)
+
+%template(vector_int) std::vector<int>;
+%template(vector_string) std::vector<std::string>;
+
+%{
+namespace {
+  // Encodes images[i] into buffers[i] with the plate's filetype (and
+  // variants), one job per tile on the thread pool.
+  template <class PixelT>
+  struct EncodeTile {
+    typedef void result_type;
+    vw::ImageView<PixelT> image;
+    std::string filetype;
+    std::vector<std::string> const* variant_types;
+    std::vector<vw::uint8> *buffer;
+    std::string *type;
+    vw::platefile::TileVariants *variants;
+    void operator()() const {
+      *type = vw::platefile::PlateFile::encode_tile( image, filetype, *buffer );
+      if( ! variant_types->empty() )
+        *variants = vw::platefile::PlateFile::encode_variants( image, *type, *variant_types );
+    }
+  };
+
+  template <class PixelT>
+  struct DecodeTile {
+    typedef void result_type;
+    vw::platefile::TileHeader const* header;
+    vw::platefile::TileData data;
+    vw::ImageView<PixelT> *image;
+    void operator()() const {
+      boost::scoped_ptr<vw::SrcImageResource> r( vw::SrcMemoryImageResource::open( header->filetype(), &(*data)[0], data->size() ) );
+      vw::read_image( *image, *r );
+    }
+  };
+
+  // Reads each tile, at the newest transaction at or before
+  // transaction_id, leaving a missing tile's data empty.
+  void read_tiles( vw::platefile::PlateFile const& plate, std::vector<int> const& cols, std::vector<int> const& rows,
+                   std::vector<int> const& levels, int transaction_id, vw::platefile::Datastore::TileSearch& tiles ) {
+    VW_ASSERT( cols.size() == rows.size() && cols.size() == levels.size(),
+               vw::ArgumentErr() << "PlateFile: cols, rows and levels must be the same length" );
+    tiles.resize( cols.size() );
+    for( size_t i = 0; i < cols.size(); ++i ) {
+      try {
+        std::pair<vw::platefile::TileHeader, vw::platefile::TileData> tile =
+          plate.read( cols[i], rows[i], levels[i], transaction_id );
+        tiles[i] = vw::platefile::Tile( tile.first, tile.second );
+      } catch( const vw::platefile::TileNotFoundErr& ) {
+        tiles[i] = vw::platefile::Tile();
+      }
+    }
+  }
+}
+%}
+
+namespace vw {
+namespace platefile {
+
+  class PlateFile {
+  public:
+    ~PlateFile();
+    void set_write_batch_size( size_t tiles );
+    size_t write_batch_size() const;
+    void set_tile_variants( const std::vector<std::string>& filetypes );
+
+    %extend {
+      PlateFile( std::string const& url ) {
+        ReleaseGIL nogil;
+        return new vw::platefile::PlateFile( vw::platefile::Url( url ) );
+      }
+      PlateFile( std::string const& url, std::string const& type, std::string const& description,
+                 int tile_size, std::string const& filetype,
+                 vw::PixelFormatEnum pixel_format, vw::ChannelTypeEnum channel_type ) {
+        ReleaseGIL nogil;
+        return new vw::platefile::PlateFile( vw::platefile::Url( url ), type, description, tile_size,
+                                             filetype, pixel_format, channel_type );
+      }
+
+      int get_tile_size() const { return self->default_tile_size(); }
+      std::string get_filetype() const { return self->default_file_type(); }
+      int get_num_levels() const { return self->num_levels(); }
+      vw::PixelFormatEnum _pixel_format() const { return self->pixel_format(); }
+      vw::ChannelTypeEnum _channel_type() const { return self->channel_type(); }
+
+      int transaction_begin( std::string const& description, int transaction_id_override = -1 ) {
+        ReleaseGIL nogil;
+        return int( vw::uint32( self->transaction_begin( description, transaction_id_override ) ) );
+      }
+      void transaction_end( bool update_read_cursor = true ) { ReleaseGIL nogil; self->transaction_end( update_read_cursor ); }
+      int get_transaction_id() const { return int( vw::uint32( self->transaction_id() ) ); }
+
+      void write_request() { ReleaseGIL nogil; self->write_request(); }
+      void write_complete() { ReleaseGIL nogil; self->write_complete(); }
+      void flush_writes() { ReleaseGIL nogil; self->flush_writes(); }
+      void sync() { ReleaseGIL nogil; self->sync(); }
+
+      // Already-encoded tiles: data[i] in filetypes[i], or the plate's
+      // default filetype where that is empty.
+      void _write_encoded( std::vector<std::string> const& data, std::vector<std::string> const& filetypes,
+                           std::vector<int> const& cols, std::vector<int> const& rows, std::vector<int> const& levels ) {
+        VW_ASSERT( data.size() == filetypes.size() && data.size() == cols.size() &&
+                   data.size() == rows.size() && data.size() == levels.size(),
+                   vw::ArgumentErr() << "PlateFile: tile arguments must be the same length" );
+        ReleaseGIL nogil;
+        for( size_t i = 0; i < data.size(); ++i )
+          self->write_update( reinterpret_cast<const vw::uint8*>( data[i].data() ), data[i].size(),
+                              cols[i], rows[i], levels[i], filetypes[i] );
+      }
+
+      // Returns a list with, for each tile, a (transaction_id, filetype,
+      // data) tuple, or None if there is no such tile.
+      PyObject* _read_encoded( std::vector<int> const& cols, std::vector<int> const& rows,
+                               std::vector<int> const& levels, int transaction_id ) const {
+        vw::platefile::Datastore::TileSearch tiles;
+        {
+          ReleaseGIL nogil;
+          read_tiles( *self, cols, rows, levels, transaction_id, tiles );
+        }
+        PyObject *result = PyList_New( tiles.size() );
+        for( size_t i = 0; i < tiles.size(); ++i ) {
+          if( ! tiles[i].data ) {
+            Py_INCREF( Py_None );
+            PyList_SET_ITEM( result, i, Py_None );
+            continue;
+          }
+          std::vector<vw::uint8> const& data = *tiles[i].data;
+          PyList_SET_ITEM( result, i, Py_BuildValue( "(is#)", int( tiles[i].hdr.transaction_id() ),
+                                                     tiles[i].hdr.filetype().c_str(),
+                                                     data.empty() ? "" : reinterpret_cast<const char*>( &data[0] ),
+                                                     int( data.size() ) ) );
+        }
+        return result;
+      }
+    }
+
+    %pythoncode {
+      tile_size = property(get_tile_size)
+      filetype = property(get_filetype)
+      num_levels = property(get_num_levels)
+      transaction_id = property(get_transaction_id)
+      def get_pixel_type(self):
+        return pixel._pixel_format_table[ self._pixel_format() ][ pixel._channel_type_table[ self._channel_type() ] ]
+      pixel_type = property(get_pixel_type)
+
+      def write_encoded(self, tiles):
+        '''Writes already-encoded tiles, given as a list of (col, row,
+        level, data, filetype) tuples; an empty filetype means the
+        plate's default.'''
+        cols, rows, levels, data, filetypes = zip(*tiles) if tiles else ((),)*5
+        self._write_encoded(vector_string(data), vector_string(filetypes),
+                            vector_int(cols), vector_int(rows), vector_int(levels))
+
+      def write_images(self, tiles):
+        '''Encodes and writes images, given as a list of (col, row, level,
+        image) tuples where each image is a vw image or a NumPy array of
+        the plate's pixel type.  Tiles are encoded in parallel.'''
+        if not tiles: return
+        cols, rows, levels, images = zip(*tiles)
+        images = [ image.from_numpy(im, self.pixel_type) if not isimage(im) else im.ref().rasterize() for im in images ]
+        _write_images_table[self.pixel_type](self, _image_vector_table[self.pixel_type](images),
+                                             vector_int(cols), vector_int(rows), vector_int(levels))
+
+      def read_encoded(self, locations, transaction_id=-1):
+        '''Reads the tiles at a list of (col, row, level) locations, as
+        they were at transaction_id (-1 for the newest), returning for
+        each a (transaction_id, filetype, data) tuple, or None where
+        there is no tile.'''
+        cols, rows, levels = zip(*locations) if locations else ((),)*3
+        return self._read_encoded(vector_int(cols), vector_int(rows), vector_int(levels), transaction_id)
+
+      def read_images(self, locations, transaction_id=-1):
+        '''As read_encoded(), but decodes the tiles, in parallel, and
+        returns a NumPy array (or None) for each.'''
+        import numpy
+        cols, rows, levels = zip(*locations) if locations else ((),)*3
+        images = _read_images_table[self.pixel_type](self, vector_int(cols), vector_int(rows),
+                                                     vector_int(levels), transaction_id)
+        return [ numpy.asarray(im) if im.cols > 0 else None for im in images ]
+    }
+  };
+
+}} // namespace vw::platefile
+
+%inline %{
+  template <class PixelT>
+  void _write_images( vw::platefile::PlateFile& plate, std::vector<vw::ImageView<PixelT> > const& images,
+                      std::vector<int> const& cols, std::vector<int> const& rows, std::vector<int> const& levels ) {
+    VW_ASSERT( images.size() == cols.size() && images.size() == rows.size() && images.size() == levels.size(),
+               vw::ArgumentErr() << "PlateFile: tile arguments must be the same length" );
+    ReleaseGIL nogil;
+
+    size_t n = images.size();
+    std::vector<std::vector<vw::uint8> > buffers( n );
+    std::vector<std::string> types( n );
+    std::vector<vw::platefile::TileVariants> variants( n );
+    {
+      vw::FifoWorkQueue queue;
+      std::vector<vw::Future<void> > futures;
+      for( size_t i = 0; i < n; ++i ) {
+        EncodeTile<PixelT> job = { images[i], plate.default_file_type(), &plate.tile_variants(),
+                                   &buffers[i], &types[i], &variants[i] };
+        futures.push_back( queue.submit( job ) );
+      }
+      vw::when_all( futures );
+    }
+
+    // The datastore takes tiles one writer at a time, in order.
+    for( size_t i = 0; i < n; ++i ) {
+      if( variants[i].empty() )
+        plate.write_update( &buffers[i][0], buffers[i].size(), cols[i], rows[i], levels[i], types[i] );
+      else
+        plate.write_update( &buffers[i][0], buffers[i].size(), cols[i], rows[i], levels[i], types[i], variants[i] );
+    }
+  }
+
+  template <class PixelT>
+  std::vector<vw::ImageView<PixelT> > _read_images( vw::platefile::PlateFile const& plate, std::vector<int> const& cols,
+                                                    std::vector<int> const& rows, std::vector<int> const& levels,
+                                                    int transaction_id ) {
+    ReleaseGIL nogil;
+    vw::platefile::Datastore::TileSearch tiles;
+    read_tiles( plate, cols, rows, levels, transaction_id, tiles );
+
+    std::vector<vw::ImageView<PixelT> > images( tiles.size() );
+    vw::FifoWorkQueue queue;
+    std::vector<vw::Future<void> > futures;
+    for( size_t i = 0; i < tiles.size(); ++i ) {
+      if( ! tiles[i].data || tiles[i].data->empty() ) continue;
+      DecodeTile<PixelT> job = { &tiles[i].hdr, tiles[i].data, &images[i] };
+      futures.push_back( queue.submit( job ) );
+    }
+    vw::when_all( futures );
+    return images;
+  }
+%}
+
+%pythoncode {
+  import pixel, image
+  from image import isimage
+  _write_images_table = dict()
+  _read_images_table = dict()
+  _image_vector_table = dict()
+}
+
+%define %instantiate_plate(cname,ctype,pname,ptype,...)
+  %template(vector_ImageView_##pname) std::vector<vw::ImageView<ptype > >;
+  %template(_write_images_##pname) _write_images<ptype >;
+  %template(_read_images_##pname) _read_images<ptype >;
+  %pythoncode {
+    _write_images_table[pixel.pname] = _write_images_##pname
+    _read_images_table[pixel.pname] = _read_images_##pname
+    _image_vector_table[pixel.pname] = vector_ImageView_##pname
+  }
+%enddef
+
+%instantiate_for_pixel_types(instantiate_plate)
@@ -47,4 +47,29 @@ public:
   }
 };
 
+// Releases the GIL for its lifetime, so that other Python threads can
+// run while we rasterize.  Code inside its scope must not touch any
+// Python object.
+class ReleaseGIL {
+  PyThreadState *m_state;
+public:
+  ReleaseGIL() : m_state( PyEval_SaveThread() ) {}
+  ~ReleaseGIL() { PyEval_RestoreThread( m_state ); }
+};
+
+// Like DecrefDeleter, but safe to run from any thread, with or without
+// the GIL.  Images wrapping memory owned by Python use it, because
+// their last copy may well be dropped inside a ReleaseGIL scope or on
+// one of our worker threads.
+class GILDecrefDeleter {
+  PyObject *m_obj;
+public:
+  GILDecrefDeleter( PyObject *obj ) : m_obj(obj) { Py_INCREF(obj); }
+  template <class T> void operator()(T) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    Py_DECREF(m_obj);
+    PyGILState_Release(state);
+  }
+};
+
 %}
@@ -18,6 +18,7 @@
 #include <vw/Stereo/OptimizedCorrelator.h>
 #include <vw/Stereo/ReferenceCorrelator.h>
 #include <vw/Stereo/PyramidCorrelator.h>
+#include <vw/Stereo/SemiGlobalMatcher.h>
 #include <vw/Stereo/CorrelatorView.h>
 #include <vw/Stereo/SubpixelView.h>
 #include <vw/Stereo/EMSubpixelCorrelatorView.h>
@@ -64,6 +64,53 @@ namespace vw {
 
 
 
+    // Resamples image over window under T with bilinear interpolation,
+    // treating pixels outside the image as zero, just as
+    // crop(transform(image, T), window) does.  T is affine, so the
+    // source position is stepped along each row rather than recomputed
+    // for every pixel, and the image is read straight from memory.
+    template <class PixelT>
+    void affine_warp_window(ImageView<PixelT> const& image, AffineTransformOrigin const& T,
+                            BBox2i const& window, ImageView<PixelT> & dest) {
+      typedef typename FloatType<typename CompoundChannelType<PixelT>::type>::type real_type;
+
+      if (dest.cols() != window.width() || dest.rows() != window.height())
+        dest.set_size(window.width(), window.height());
+
+      Vector2 origin = T.reverse(Vector2(window.min().x(), window.min().y()));
+      Vector2 step_x = T.reverse(Vector2(window.min().x()+1, window.min().y())) - origin;
+      Vector2 step_y = T.reverse(Vector2(window.min().x(), window.min().y()+1)) - origin;
+      const int32 cols = image.cols(), rows = image.rows();
+
+      for (int32 v = 0; v < dest.rows(); ++v) {
+        double sx = origin[0] + v*step_y[0];
+        double sy = origin[1] + v*step_y[1];
+        PixelT *out = &dest(0, v);
+        for (int32 u = 0; u < dest.cols(); ++u, sx += step_x[0], sy += step_x[1]) {
+          int32 x = math::impl::_floor(sx), y = math::impl::_floor(sy);
+          real_type normx = real_type(sx)-real_type(x), normy = real_type(sy)-real_type(y);
+          if (x >= 0 && y >= 0 && x+1 < cols && y+1 < rows) {
+            PixelT const* r0 = &image(x, y);
+            PixelT const* r1 = &image(x, y+1);
+            out[u] = (r0[0]*(1-normx) + r0[1]*normx)*(1-normy) + (r1[0]*(1-normx) + r1[1]*normx)*normy;
+          } else {
+            // Near the edges, fall back to testing each neighbour.
+            PixelT p00 = PixelT(), p10 = PixelT(), p01 = PixelT(), p11 = PixelT();
+            bool x0 = x >= 0 && x < cols, x1 = x+1 >= 0 && x+1 < cols;
+            if (y >= 0 && y < rows) {
+              if (x0) p00 = image(x, y);
+              if (x1) p10 = image(x+1, y);
+            }
+            if (y+1 >= 0 && y+1 < rows) {
+              if (x0) p01 = image(x, y+1);
+              if (x1) p11 = image(x+1, y+1);
+            }
+            out[u] = (p00*(1-normx) + p10*normx)*(1-normy) + (p01*(1-normx) + p11*normx)*normy;
+          }
+        }
+      }
+    }
+
     template<class PixelT, class PrecisionT>
     class AffineMixtureComponent : public MixtureComponentBase<AffineMixtureComponent<PixelT, PrecisionT> > {
     public:
@@ -137,8 +184,8 @@ namespace vw {
 
         T = AffineTransformOrigin(M_transform_linear, M_transform_offset, pos_linearize);
 
-        r_window = crop(transform(right_r, T), window);
-        l_window = crop(left_r, window);
+        affine_warp_window(right_r, T, window, r_window);
+        l_window = crop(edge_extend(left_r, ZeroEdgeExtension()), window);
         err = r_window - l_window;
 
         w_gaussian = g;
@@ -320,8 +367,8 @@ namespace vw {
         }
         // initialized cropped transformations of the right window under the current value of T; and err
         T = AffineTransformOrigin(M_transform_linear, M_transform_offset, Vector2(x, y));
-        r_window = crop(transform(right_r, T), window);
-        l_window = crop(left_r, window);
+        affine_warp_window(right_r, T, window, r_window);
+        l_window = crop(edge_extend(left_r, ZeroEdgeExtension()), window);
         err = r_window - l_window;
 
         double l_likelihood_old = sum_of_pixel_values(.5*w_adj*pow(err/s,2) - w*log(sqrt(w_gaussian))) + sum_of_pixel_values(w)*(log(s) + log(sqrt_2_pi)); //TODO: remove
@@ -337,8 +384,8 @@ namespace vw {
           inner_loop_window_timer.start();
 
           // compute the transformed derivatives
-          r_window_dx = crop(transform(r_image_dx, T), window);
-          r_window_dy = crop(transform(r_image_dy, T), window);
+          affine_warp_window(r_image_dx, T, window, r_window_dx);
+          affine_warp_window(r_image_dy, T, window, r_window_dy);
 
           err = r_window - l_window;
 
@@ -435,7 +482,7 @@ namespace vw {
               //std::cout << "updating" << std::endl;
               //PrecisionT determinant = matrix_data_linear[0]*matrix_data_linear[3] - matrix_data_linear[1]*matrix_data_linear[2]; // unused
               T = AffineTransformOrigin(M_transform_linear, M_transform_offset, Vector2(x, y));
-              r_window = crop(transform(right_r, T), window);
+              affine_warp_window(right_r, T, window, r_window);
               err = r_window - l_window;
               min_step_size_hit = true;
               //std::cout << "min_step_size_hit" << std::endl;
@@ -486,7 +533,7 @@ namespace vw {
             T = AffineTransformOrigin(M_transform_linear, M_transform_offset, Vector2(x, y));
 
             //std::cout << "updating values" << std::endl;
-            r_window = crop(transform(right_r, T), window);
+            affine_warp_window(right_r, T, window, r_window);
             err = r_window - l_window;
             f_value = sum_of_pixel_values(w_adj*pow(err, 2));
             //std::cout << "solved" << std::endl;
@@ -534,7 +581,7 @@ namespace vw {
 
         // recompute these with the final converged values
         T = AffineTransformOrigin(M_transform_linear, M_transform_offset, Vector2(x, y));
-        r_window = crop(transform(right_r, T), window);
+        affine_warp_window(right_r, T, window, r_window);
         err = r_window - l_window;
 
         PrecisionT sum_weights = sum_of_pixel_values(w); // this is the normalization constant for the weights
@@ -556,8 +603,10 @@ namespace vw {
     private:
       bool debug;
 
-      ImageViewRef<PixelT> left_r;
-      ImageViewRef<PixelT> right_r;
+      // The filtered images, rasterized once so that the windows can be
+      // read straight from memory.
+      ImageView<PixelT> left_r;
+      ImageView<PixelT> right_r;
 
       PrecisionT s, s0;
       PrecisionT s_min;
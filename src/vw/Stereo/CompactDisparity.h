@@ -0,0 +1,231 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file CompactDisparity.h
+///
+/// A disparity pixel that takes 4 bytes, or 2 for rectified pairs,
+/// rather than the 12 of a PixelMask<Vector2f>.
+///
+/// Each disparity is kept as an int16 in fixed point, with FracBitsN
+/// of its bits after the binary point, so the default of 4 holds
+/// disparities from -2047.9375 to 2047.9375 pixels in steps of
+/// 1/16.  The one int16 value left over, -32768, in the horizontal
+/// disparity marks the pixel invalid.  A one dimensional pixel keeps
+/// only the horizontal disparity, and its vertical one is always
+/// zero.
+///
+/// Conversion to and from PixelMask<Vector2f> is lossless for every
+/// disparity on the fixed point grid, which covers the integer
+/// disparities the correlators produce, and a compact pixel always
+/// converts back to itself.  Other disparities are rounded to the
+/// nearest step, and ones out of range become invalid pixels.
+///
+/// Views of these pixels work with disparity_mask(),
+/// remove_outliers(), get_disparity_range() and StereoView as they
+/// are, since the pixel reads like a masked Vector2f: operator[]
+/// returns the disparities as floats, is_valid() reads the flag and
+/// remove_mask() gives the Vector2f.  They may also be written to
+/// and read back from disk, e.g. by a DiskCacheImageView, as int16
+/// images holding the raw fixed point values.
+///
+#ifndef __VW_STEREO_COMPACTDISPARITY_H__
+#define __VW_STEREO_COMPACTDISPARITY_H__
+
+#include <cmath>
+#include <ostream>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/CompoundTypes.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <vw/Image/PerPixelViews.h>
+
+#include <boost/static_assert.hpp>
+
+namespace vw {
+
+  // Like PixelMask, this lives in vw so that the generic pixel
+  // functions in vw find its overloads.
+  template <int32 DimsN = 2, int32 FracBitsN = 4>
+  class PixelCompactDisparity {
+    BOOST_STATIC_ASSERT( DimsN == 1 || DimsN == 2 );
+    BOOST_STATIC_ASSERT( FracBitsN >= 0 && FracBitsN < 15 );
+
+    int16 m_disp[DimsN];
+
+    static const int16 invalid_value = -32768;
+
+    static int16 to_fixed( double d, bool& ok ) {
+      double scaled = std::floor( d * double(1 << FracBitsN) + 0.5 );
+      if ( !( scaled > -32768.0 && scaled <= 32767.0 ) ) {
+        ok = false;
+        return 0;
+      }
+      return int16(scaled);
+    }
+
+    template <class VectorT>
+    void set( VectorT const& disp ) {
+      bool ok = true;
+      for ( int32 i = 0; i < DimsN; i++ )
+        m_disp[i] = to_fixed( disp[i], ok );
+      if ( !ok )
+        invalidate();
+    }
+
+  public:
+    /// The number of bits of each disparity after the binary point.
+    static const int32 frac_bits = FracBitsN;
+
+    /// The smallest step between disparities.
+    static float32 step() { return 1.0f / float32(1 << FracBitsN); }
+
+    /// The default pixel is invalid.
+    PixelCompactDisparity() {
+      for ( int32 i = 0; i < DimsN; i++ )
+        m_disp[i] = 0;
+      invalidate();
+    }
+
+    /// A valid pixel with the given disparities.  The vertical one is
+    /// dropped by a one dimensional pixel.
+    PixelCompactDisparity( float32 dx, float32 dy = 0 ) {
+      set( Vector2f(dx, dy) );
+    }
+
+    /// Conversion from the masked disparities of the correlators.
+    template <class VectorT>
+    PixelCompactDisparity( PixelMask<VectorT> const& pix ) {
+      set( pix.child() );
+      if ( !pix.valid() )
+        invalidate();
+    }
+
+    /// Builds a pixel from its raw fixed point values.
+    static PixelCompactDisparity from_raw( int16 dx, int16 dy = 0 ) {
+      int16 disp[2] = { dx, dy };
+      PixelCompactDisparity result;
+      for ( int32 i = 0; i < DimsN; i++ )
+        result.m_disp[i] = disp[i];
+      return result;
+    }
+
+    /// The raw fixed point value of disparity i.
+    int16 raw( size_t i ) const { return m_disp[i]; }
+
+    /// Disparity i, in pixels, for i of 0 or 1.
+    float32 operator[]( size_t i ) const {
+      if ( int32(i) >= DimsN )
+        return 0;
+      return float32(m_disp[i]) * step();
+    }
+    float32 operator()( size_t i ) const { return (*this)[i]; }
+
+    bool valid() const { return m_disp[0] != invalid_value; }
+
+    /// Invalidates this pixel.  The disparities can't be kept.
+    void invalidate() { m_disp[0] = invalid_value; }
+
+    /// The disparities, whether or not the pixel is valid.
+    Vector2f disparity() const { return Vector2f( (*this)[0], (*this)[1] ); }
+
+    /// The pixel as the correlators output it.
+    PixelMask<Vector2f> expand() const {
+      PixelMask<Vector2f> result( disparity() );
+      if ( !valid() )
+        result.invalidate();
+      return result;
+    }
+
+    bool operator==( PixelCompactDisparity const& other ) const {
+      for ( int32 i = 0; i < DimsN; i++ )
+        if ( m_disp[i] != other.m_disp[i] )
+          return false;
+      return true;
+    }
+    bool operator!=( PixelCompactDisparity const& other ) const { return !(*this == other); }
+  };
+
+  template <int32 DimsN, int32 FracBitsN>
+  inline bool is_valid( PixelCompactDisparity<DimsN,FracBitsN> const& pix ) { return pix.valid(); }
+
+  template <int32 DimsN, int32 FracBitsN>
+  inline bool is_transparent( PixelCompactDisparity<DimsN,FracBitsN> const& pix ) { return !pix.valid(); }
+
+  template <int32 DimsN, int32 FracBitsN>
+  inline void invalidate( PixelCompactDisparity<DimsN,FracBitsN>& pix ) { pix.invalidate(); }
+
+  template <int32 DimsN, int32 FracBitsN>
+  inline Vector2f remove_mask( PixelCompactDisparity<DimsN,FracBitsN> const& pix ) { return pix.disparity(); }
+
+  template <int32 DimsN, int32 FracBitsN>
+  inline Vector2f remove_mask( PixelCompactDisparity<DimsN,FracBitsN>& pix ) { return pix.disparity(); }
+
+  template <int32 DimsN, int32 FracBitsN>
+  std::ostream& operator<<( std::ostream& os, PixelCompactDisparity<DimsN,FracBitsN> const& pix ) {
+    return os << "PixelCompactDisparity( " << pix.disparity() << " : " << pix.valid() << " )";
+  }
+
+  // The pixel is a compound of int16 channels, so that FileIO can
+  // store it, but it reads as a masked Vector2f.
+  template <int32 DimsN, int32 FracBitsN>
+  struct CompoundChannelType<PixelCompactDisparity<DimsN,FracBitsN> > { typedef int16 type; };
+  template <int32 DimsN, int32 FracBitsN>
+  struct CompoundNumChannels<PixelCompactDisparity<DimsN,FracBitsN> > { static const size_t value = DimsN; };
+  template <int32 DimsN, int32 FracBitsN>
+  struct UnmaskedPixelType<PixelCompactDisparity<DimsN,FracBitsN> > { typedef Vector2f type; };
+  template <int32 DimsN, int32 FracBitsN>
+  struct IsMasked<PixelCompactDisparity<DimsN,FracBitsN> > : public boost::true_type::type {};
+
+  template <int32 FracBitsN>
+  struct PixelFormatID<PixelCompactDisparity<1,FracBitsN> > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_1_CHANNEL; };
+  template <int32 FracBitsN>
+  struct PixelFormatID<PixelCompactDisparity<2,FracBitsN> > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_2_CHANNEL; };
+
+namespace stereo {
+
+  /// Functors for converting between the compact and PixelMask<Vector2f>
+  /// forms of a disparity map.
+  template <class CompactT>
+  struct CompactDisparityFunc : public ReturnFixedType<CompactT> {
+    template <class PixelT>
+    CompactT operator()( PixelT const& pix ) const { return CompactT(pix); }
+  };
+
+  struct ExpandDisparityFunc : public ReturnFixedType<PixelMask<Vector2f> > {
+    template <int32 DimsN, int32 FracBitsN>
+    PixelMask<Vector2f> operator()( PixelCompactDisparity<DimsN,FracBitsN> const& pix ) const {
+      return pix.expand();
+    }
+  };
+
+  /// Converts a disparity map to compact pixels, e.g.
+  /// compact_disparities<PixelCompactDisparity<1> >(map) for a
+  /// rectified pair.
+  template <class CompactT, class ViewT>
+  UnaryPerPixelView<ViewT, CompactDisparityFunc<CompactT> >
+  compact_disparities( ImageViewBase<ViewT> const& disparity_map ) {
+    return UnaryPerPixelView<ViewT, CompactDisparityFunc<CompactT> >( disparity_map.impl() );
+  }
+
+  template <class ViewT>
+  UnaryPerPixelView<ViewT, CompactDisparityFunc<PixelCompactDisparity<> > >
+  compact_disparities( ImageViewBase<ViewT> const& disparity_map ) {
+    return UnaryPerPixelView<ViewT, CompactDisparityFunc<PixelCompactDisparity<> > >( disparity_map.impl() );
+  }
+
+  /// Converts a compact disparity map back to PixelMask<Vector2f>.
+  template <class ViewT>
+  UnaryPerPixelView<ViewT, ExpandDisparityFunc>
+  expand_disparities( ImageViewBase<ViewT> const& disparity_map ) {
+    return UnaryPerPixelView<ViewT, ExpandDisparityFunc>( disparity_map.impl() );
+  }
+
+}} // namespace vw::stereo
+
+#endif // __VW_STEREO_COMPACTDISPARITY_H__
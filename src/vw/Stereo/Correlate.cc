@@ -14,6 +14,39 @@
 namespace vw {
 namespace stereo {
 
+  void census_transform(ImageView<float> const& image, int32 size, std::vector<uint64>& codes) {
+    VW_ASSERT( size >= 1 && size <= 7 && size % 2 == 1,
+               ArgumentErr() << "census_transform: the window must be odd and at most 7 pixels." );
+    const int32 cols = image.cols(), rows = image.rows(), half = size / 2;
+    codes.resize(size_t(cols) * rows);
+    for (int32 y = 0; y < rows; y++) {
+      for (int32 x = 0; x < cols; x++) {
+        const float center = image(x, y);
+        uint64 code = 0;
+        for (int32 v = -half; v <= half; v++) {
+          const int32 yy = std::min(std::max(y + v, 0), rows - 1);
+          for (int32 u = -half; u <= half; u++) {
+            if (u == 0 && v == 0)
+              continue;
+            const int32 xx = std::min(std::max(x + u, 0), cols - 1);
+            code = (code << 1) | (image(xx, yy) < center ? 1 : 0);
+          }
+        }
+        codes[size_t(y)*cols + x] = code;
+      }
+    }
+  }
+
+  ImageView<float> rank_transform(ImageView<float> const& image, int32 size) {
+    std::vector<uint64> codes;
+    census_transform(image, size, codes);
+    ImageView<float> result(image.cols(), image.rows());
+    for (int32 y = 0; y < image.rows(); y++)
+      for (int32 x = 0; x < image.cols(); x++)
+        result(x, y) = float(detail::popcount64(codes[size_t(y)*image.cols() + x]));
+    return result;
+  }
+
   /// This routine cross checks L2R and R2L, placing the final version
   /// of the disparity map in L2R.
   void cross_corr_consistency_check(ImageView<PixelMask<Vector2f> > &L2R,
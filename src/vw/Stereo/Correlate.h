@@ -8,19 +8,60 @@
 #ifndef __VW_STEREO_CORRELATE_H__
 #define __VW_STEREO_CORRELATE_H__
 
+#include <vw/config.h>
+#include <vw/Core/Settings.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageMath.h>
+#include <vw/Image/Filter.h>
 #include <vw/Math/LinearAlgebra.h>
 #include <limits.h>
+#include <algorithm>
+#include <vector>
+
+#include <boost/mpl/if.hpp>
+#include <boost/type_traits/is_floating_point.hpp>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+#include <xmmintrin.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#endif
 
 namespace vw {
 namespace stereo {
 
+  // The census and rank correlators compare census_transform() codes
+  // by their Hamming distance and rank_transform() values by their
+  // absolute difference.  Both only depend on the order of the pixel
+  // values, so they need no pre-processing and tolerate differences
+  // in gain and bias between the images.
   enum CorrelatorType { ABS_DIFF_CORRELATOR = 0,
                         SQR_DIFF_CORRELATOR = 1,
-                        NORM_XCORR_CORRELATOR = 2 };
+                        NORM_XCORR_CORRELATOR = 2,
+                        CENSUS_CORRELATOR = 3,
+                        RANK_CORRELATOR = 4 };
+
+  /// The census window used with a correlation kernel of the given
+  /// size: the kernel size made odd, from 3 to 7.
+  inline int32 census_window_size(int32 kernel_size) {
+    int32 size = std::min(std::max(kernel_size, 3), 7);
+    return (size % 2 == 0) ? size - 1 : size;
+  }
+
+  /// Fills codes with the census transform of image, one code per
+  /// pixel in row order.  Each has a bit for every other pixel of the
+  /// size x size window around it, set if that pixel is darker than
+  /// the centre, with the window clamped to the image at the edges.
+  /// The size must be odd and at most 7, so the bits fit in 64.
+  void census_transform(ImageView<float> const& image, int32 size, std::vector<uint64>& codes);
+
+  /// The rank transform of image: the number of pixels in the size x
+  /// size window around each pixel that are darker than it, which is
+  /// the number of bits set in its census code.
+  ImageView<float> rank_transform(ImageView<float> const& image, int32 size);
 
   /// Given a type, these traits classes help to determine a suitable
   /// working type for accumulation operations in the correlator
@@ -53,7 +94,9 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
 
   // Sign of the Laplacian of the Gaussian pre-processing
   //
-  // Default gaussian blur standard deviation is 1.5 pixels.
+  // Default gaussian blur standard deviation is 1.5 pixels.  The
+  // blur is the recursive approximation if the approximate_gaussian
+  // setting is on; likewise for the filters below.
   class SlogStereoPreprocessingFilter {
     float m_slog_width;
 
@@ -64,6 +107,8 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
 
     template <class ViewT>
     result_type operator()(ImageViewBase<ViewT> const& view) const {
+      if (vw_settings().approximate_gaussian())
+        return channel_cast<uint8>(threshold(laplacian_filter(recursive_gaussian_filter(channel_cast<float>(view.impl()),m_slog_width)),0.0));
       return channel_cast<uint8>(threshold(laplacian_filter(gaussian_filter(channel_cast<float>(view.impl()),m_slog_width)),0.0));
     }
 
@@ -83,6 +128,8 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
 
     template <class ViewT>
     result_type operator()(ImageViewBase<ViewT> const& view) const {
+      if (vw_settings().approximate_gaussian())
+        return laplacian_filter(recursive_gaussian_filter(channel_cast<float>(view.impl()),m_log_width));
       return laplacian_filter(gaussian_filter(channel_cast<float>(view.impl()),m_log_width));
     }
 
@@ -102,6 +149,8 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
 
     template <class ViewT>
     result_type operator()(ImageViewBase<ViewT> const& view) const {
+      if (vw_settings().approximate_gaussian())
+        return recursive_gaussian_filter(channel_cast<float>(view.impl()),m_blur_sigma);
       return gaussian_filter(channel_cast<float>(view.impl()),m_blur_sigma);
     }
 
@@ -148,6 +197,90 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
     }
   };
 
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The number of bits set in x, with the popcnt instruction where
+    // the compiler targets it.
+    inline int32 popcount64( uint64 x ) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+      return __builtin_popcountll( x );
+#else
+      x = x - ((x >> 1) & 0x5555555555555555ULL);
+      x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+      x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+      return int32((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    // Absolute differences of two rows of n channels, as
+    // AbsDiffCostFunc takes them.  The uint8 and float versions work
+    // 16 and 4 channels at a time with SSE2 and SSE where enabled.
+    template <class ChannelT>
+    inline void abs_diff_row( ChannelT const* a, ChannelT const* b, ChannelT* d, int32 n ) {
+      AbsDiffCostFunc cost_fn;
+      for( int32 i=0; i<n; ++i ) d[i] = cost_fn( a[i], b[i] );
+    }
+
+    inline void abs_diff_row( uint8 const* a, uint8 const* b, uint8* d, int32 n ) {
+      int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+      for( ; i+16<=n; i+=16 ) {
+        __m128i av = _mm_loadu_si128( (__m128i const*)(a+i) );
+        __m128i bv = _mm_loadu_si128( (__m128i const*)(b+i) );
+        _mm_storeu_si128( (__m128i*)(d+i), _mm_or_si128( _mm_subs_epu8(av,bv), _mm_subs_epu8(bv,av) ) );
+      }
+#endif
+      for( ; i<n; ++i ) d[i] = a[i] > b[i] ? a[i]-b[i] : b[i]-a[i];
+    }
+
+    inline void abs_diff_row( float const* a, float const* b, float* d, int32 n ) {
+      int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+      const __m128 sign = _mm_set1_ps(-0.0f);
+      for( ; i+4<=n; i+=4 )
+        _mm_storeu_ps( d+i, _mm_andnot_ps( sign, _mm_sub_ps( _mm_loadu_ps(a+i), _mm_loadu_ps(b+i) ) ) );
+#endif
+      for( ; i<n; ++i ) d[i] = fabs( a[i]-b[i] );
+    }
+
+    // Slides n column sums down a row: sum += add - sub.  Integer sums
+    // wrap just as compute_soad()'s do, so they come out the same.
+    template <class SumT, class ChannelT>
+    inline void slide_column_sums( SumT* sum, ChannelT const* add, ChannelT const* sub, int32 n ) {
+      for( int32 i=0; i<n; ++i ) sum[i] = SumT( sum[i] + SumT(add[i]) - SumT(sub[i]) );
+    }
+
+    inline void slide_column_sums( uint16* sum, uint8 const* add, uint8 const* sub, int32 n ) {
+      int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+      const __m128i zero = _mm_setzero_si128();
+      for( ; i+16<=n; i+=16 ) {
+        __m128i av = _mm_loadu_si128( (__m128i const*)(add+i) );
+        __m128i sv = _mm_loadu_si128( (__m128i const*)(sub+i) );
+        __m128i lo = _mm_loadu_si128( (__m128i const*)(sum+i) );
+        __m128i hi = _mm_loadu_si128( (__m128i const*)(sum+i+8) );
+        lo = _mm_sub_epi16( _mm_add_epi16( lo, _mm_unpacklo_epi8(av,zero) ), _mm_unpacklo_epi8(sv,zero) );
+        hi = _mm_sub_epi16( _mm_add_epi16( hi, _mm_unpackhi_epi8(av,zero) ), _mm_unpackhi_epi8(sv,zero) );
+        _mm_storeu_si128( (__m128i*)(sum+i), lo );
+        _mm_storeu_si128( (__m128i*)(sum+i+8), hi );
+      }
+#endif
+      for( ; i<n; ++i ) sum[i] = uint16( sum[i] + add[i] - sub[i] );
+    }
+
+    // What the sliding sums of compute_disparity() are kept in: the
+    // accumulator type, but double for floating point, so that adding
+    // and subtracting rows doesn't drift from what compute_soad() gets.
+    template <class ChannelT>
+    struct CorrelatorSumType {
+      typedef typename CorrelatorAccumulatorType<ChannelT>::type accum_type;
+      typedef typename boost::mpl::if_<boost::is_floating_point<accum_type>, float64, accum_type>::type type;
+    };
+
+  } // namespace detail
+  /// \endcond
+
   /// Compute the sum of the absolute difference between a template
   /// region taken from img1 and the window centered at (c,r) in img0.
   template <class PixelT>
@@ -261,6 +394,88 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
     return best_disparity;
   }
 
+  /// Computes the disparity of every pixel of left_image, as calling
+  /// the compute_disparity() above at each of them would, but in time
+  /// that does not grow with the kernel size.  For each disparity, the
+  /// absolute differences are summed down the columns of a window of
+  /// kern_height rows that slides down the image, and those column
+  /// sums across a window of kern_width columns that slides along each
+  /// row.  Floating point sums may round differently from
+  /// compute_soad()'s, which can break near ties the other way.
+  template <class ChannelT>
+  ImageView<PixelMask<Vector2f> >
+  compute_disparity(ImageView<ChannelT> const& left_image,
+                    ImageView<ChannelT> const& right_image,
+                    int32 kern_width, int32 kern_height,
+                    int32 min_h_disp, int32 max_h_disp,
+                    int32 min_v_disp, int32 max_v_disp) {
+    typedef typename CorrelatorAccumulatorType<ChannelT>::type accum_type;
+    typedef typename detail::CorrelatorSumType<ChannelT>::type sum_type;
+
+    const int32 width = left_image.cols(), height = left_image.rows();
+    VW_ASSERT( right_image.cols() == width && right_image.rows() == height,
+               ArgumentErr() << "compute_disparity: Primary and secondary image dimensions do not agree!" );
+
+    ImageView<PixelMask<Vector2f> > result(width, height);
+    ImageView<accum_type> min_soad(width, height);
+    fill(min_soad, std::numeric_limits<accum_type>::max());
+
+    // The differences of the last kern_height rows, and a row to
+    // compute the next one in.
+    std::vector<ChannelT> rows(size_t(kern_height+1) * width);
+    std::vector<ChannelT*> window(kern_height);
+    std::vector<sum_type> column_sums(width);
+
+    for (int32 ii = min_h_disp; ii <= max_h_disp; ++ii) {
+      for (int32 jj = min_v_disp; jj <= max_v_disp; ++jj) {
+        // The kernels whose top left corners lie in [c0,c1]x[r0,r1]
+        // pass compute_soad()'s bounds checks.
+        const int32 c0 = std::max(0, -ii), c1 = std::min(width-1 - kern_width, width-1 - kern_width - ii);
+        const int32 r0 = std::max(0, -jj), r1 = std::min(height-1 - kern_height, height-1 - kern_height - jj);
+        if (c0 > c1 || r0 > r1)
+          continue;
+        const int32 span = c1 - c0 + kern_width;
+
+        std::fill(rows.begin(), rows.end(), ChannelT());
+        for (int32 k = 0; k < kern_height; ++k)
+          window[k] = &rows[size_t(k) * width];
+        ChannelT* next = &rows[size_t(kern_height) * width];
+        std::fill(column_sums.begin(), column_sums.end(), sum_type());
+
+        for (int32 r = r0; r <= r1 + kern_height - 1; ++r) {
+          detail::abs_diff_row(&left_image(c0, r), &right_image(c0 + ii, r + jj), next, span);
+          ChannelT*& oldest = window[(r - r0) % kern_height];
+          detail::slide_column_sums(&column_sums[0], next, oldest, span);
+          std::swap(oldest, next);
+
+          const int32 top = r - kern_height + 1;
+          if (top < r0)
+            continue;
+
+          sum_type soad = 0;
+          for (int32 k = 0; k < kern_width; ++k)
+            soad += column_sums[k];
+          PixelMask<Vector2f>* disparity = &result(c0 + kern_width/2, top + kern_height/2);
+          accum_type* best = &min_soad(c0 + kern_width/2, top + kern_height/2);
+          for (int32 k = 0; ; ++k) {
+            accum_type value = accum_type(soad);
+            if (value != CorrelatorFailureValue<ChannelT>()
+                && value < best[k]) {
+              best[k] = value;
+              validate( disparity[k] );
+              disparity[k][0] = ii;
+              disparity[k][1] = jj;
+            }
+            if (k == c1 - c0)
+              break;
+            soad += column_sums[k + kern_width] - column_sums[k];
+          }
+        }
+      }
+    }
+    return result;
+  }
+
   inline int
   adjust_weight_image(ImageView<float> &weight,
                       ImageView<PixelMask<Vector2f> > const& disparity_map_patch,
@@ -306,6 +521,37 @@ VW_DEFINE_EXCEPTION(CorrelatorErr, vw::Exception);
     return num_good_pix;
   }
 
+  /// As above, for the patch of disparity_map in window, which must
+  /// lie inside it, without copying the patch out.
+  inline int
+  adjust_weight_image(ImageView<float> &weight,
+                      ImageView<PixelMask<Vector2f> > const& disparity_map,
+                      BBox2i const& window,
+                      ImageView<float> const& weight_template) {
+    float sum = 0;
+    int32 num_good_pix = 0;
+    for (int32 j = 0; j < weight_template.rows(); ++j) {
+      PixelMask<Vector2f> const* disp = &disparity_map(window.min().x(), window.min().y()+j);
+      float const* templ = &weight_template(0,j);
+      float* w = &weight(0,j);
+      for (int32 i = 0; i < weight_template.cols(); ++i ) {
+        if ( !is_valid(disp[i]) )
+          w[i] = 0;
+        else {
+          w[i] = templ[i];
+          sum += w[i];
+          ++num_good_pix;
+        }
+      }
+    }
+
+    if (sum == 0)
+      vw_throw(LogicErr() << "subpixel_weight: Sum of weight image was zero.  This isn't supposed to happen!");
+    else
+      weight /= sum;
+    return num_good_pix;
+  }
+
  void cross_corr_consistency_check(ImageView<PixelMask<Vector2f> > &L2R,
                                   ImageView<PixelMask<Vector2f> > const& R2L,
                                   double cross_corr_threshold, bool verbose = false);
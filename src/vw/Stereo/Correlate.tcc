@@ -12,48 +12,42 @@ namespace detail {
     return -b/(2.0*a);
   }
 
-// is_equal_elements, tells if all the elements are equal to each other
-template <class T>
-struct IsEqualElements {
-  bool result;
-
-  IsEqualElements() : result(true), m_comparing(false) {}
-
-  void operator()( T const& i ) {
-    if ( m_comparing ) {
-      result = result && (*m_first_element == i);
-    } else {
-      m_comparing = true;
-      m_first_element = &i;
-    }
-  }
-protected:
-  bool m_comparing;
-  T const* m_first_element;
-};
-
-// Find the minimun of a 2d hyperbolic surface that is fit to the
-// nine points around and including the peak in the disparity map.
+// Find the minimum of a 2d hyperbolic surface that is fit to the
+// nine costs around and including the peak in the disparity map.
 // This gives better subpixel resolution when both horizontal and
-// vertical subpixel is requested.
+// vertical subpixel is requested.  The costs are indexed by
+// 3*(dx+1) + (dy+1) for offsets dx and dy from -1 to 1.
 //
 // The equation of the surface we are fitting is:
 //    z = ax^2 + by^2 + cxy + dx + ey + f
-template <class VectorT, class MatrixT>
-static Vector2f find_minimum_2d(VectorBase<VectorT> &points,
-                                MatrixBase<MatrixT> &pinvA) {
-  IsEqualElements<typename VectorT::value_type> is_same =
-    std::for_each( points.impl().begin(), points.impl().end(),
-                   IsEqualElements<typename VectorT::value_type>() );
-  if ( is_same.result ) // Avoid divide zero errors later
+template <class T>
+inline Vector2f find_minimum_2d(T const* points) {
+  bool is_same = true;
+  for ( int32 i = 1; i < 9; ++i )
+    if ( !(points[i] == points[0]) ) {
+      is_same = false;
+      break;
+    }
+  if ( is_same ) // Avoid divide zero errors later
     return Vector2f();
-  Vector2f offset;
 
   // First, compute the parameters of the hyperbolic surface by
-  // fitting the nine points in 'points' using a linear least
-  // squares fit.  This process is fairly fast, since we have
-  // already pre-computed the inverse of the A matrix in Ax = b.
-  Vector<float> x = pinvA * points;
+  // fitting the nine points using a linear least squares fit.  The
+  // pseudoinverse of the A matrix in Ax = b, where each row in A is
+  // [ x^2 y^2 xy x y 1 ] for x and y from -1 to 1, is fixed, and the
+  // last parameter (the constant) is not needed.
+  static const float pinvA[5][9] =
+    { { 1.0/6,  1.0/6,  1.0/6, -1.0/3, -1.0/3, -1.0/3,  1.0/6,  1.0/6,  1.0/6 },
+      { 1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6 },
+      { 1.0/4,    0.0, -1.0/4,    0.0,    0.0,    0.0, -1.0/4,    0.0,  1.0/4 },
+      {-1.0/6, -1.0/6, -1.0/6,    0.0,    0.0,    0.0,  1.0/6,  1.0/6,  1.0/6 },
+      {-1.0/6,    0.0,  1.0/6, -1.0/6,    0.0,  1.0/6, -1.0/6,    0.0,  1.0/6 } };
+  float x[5];
+  for ( int32 k = 0; k < 5; ++k ) {
+    x[k] = 0;
+    for ( int32 i = 0; i < 9; ++i )
+      x[k] += pinvA[k][i] * points[i];
+  }
 
   // With these parameters, we have a closed form expression for
   // the surface.  We compute the derivative, and find the point
@@ -65,12 +59,136 @@ static Vector2f find_minimum_2d(VectorBase<VectorT> &points,
   //
   // Of course, we optimize this computation a bit by unrolling it
   // by hand beforehand.
-  float denom = 4 * x(0) * x(1) - (x(2) * x(2));
-  offset[0] = ( x(2) * x(4) - 2 * x(1) * x(3) ) / denom;
-  offset[1] = ( x(2) * x(3) - 2 * x(0) * x(4) ) / denom;
+  Vector2f offset;
+  float denom = 4 * x[0] * x[1] - (x[2] * x[2]);
+  offset[0] = ( x[2] * x[4] - 2 * x[1] * x[3] ) / denom;
+  offset[1] = ( x[2] * x[3] - 2 * x[0] * x[4] ) / denom;
   return offset;
 }
 
+// The sums of absolute differences, as compute_soad() finds them,
+// over the kernel windows at columns c0 to c1-1 of row r in img0,
+// each matched to the window offset by (hdisp,vdisp) in img1.  The
+// windows of neighbouring columns share all but one column, so the
+// columns are summed once each and the windows from the column
+// sums.  Windows that compute_soad() would reject get the failure
+// value.  col_sums and diffs are workspaces.
+template <class ChannelT>
+void compute_soad_run(ChannelT const* img0, ChannelT const* img1,
+                      int32 r, int32 c0, int32 c1,
+                      int32 hdisp, int32 vdisp,
+                      int32 kern_width, int32 kern_height,
+                      int32 width, int32 height,
+                      typename CorrelatorAccumulatorType<ChannelT>::type* result,
+                      std::vector<typename CorrelatorAccumulatorType<ChannelT>::type>& col_sums,
+                      std::vector<ChannelT>& diffs) {
+  typedef typename CorrelatorAccumulatorType<ChannelT>::type accum_type;
+
+  // The columns whose windows pass compute_soad()'s bounds check.
+  int32 row = r - kern_height/2;
+  int32 lo = c0, hi = c1;
+  if ( row < 0 || row + kern_height >= height ||
+       row + vdisp < 0 || row + vdisp + kern_height >= height ) {
+    hi = lo;
+  } else {
+    lo = std::max( lo, std::max( kern_width/2, kern_width/2 - hdisp ) );
+    hi = std::min( hi, std::min( width - kern_width + kern_width/2,
+                                 width - kern_width + kern_width/2 - hdisp ) );
+  }
+  for ( int32 c = c0; c < std::min(lo, c1); ++c )
+    result[c-c0] = CorrelatorFailureValue<ChannelT>();
+  for ( int32 c = std::max(hi, c0); c < c1; ++c )
+    result[c-c0] = CorrelatorFailureValue<ChannelT>();
+  if ( lo >= hi )
+    return;
+
+  int32 first = lo - kern_width/2;
+  int32 n = hi - lo + kern_width - 1;
+  col_sums.assign( n, accum_type(0) );
+  diffs.resize( n );
+  ChannelT const* row0 = img0 + first + row*width;
+  ChannelT const* row1 = img1 + first + hdisp + (row+vdisp)*width;
+  ChannelT* diff = &diffs[0];
+  accum_type* col_sum = &col_sums[0];
+  for ( int32 j = 0; j < kern_height; ++j ) {
+    abs_diff_row( row0, row1, diff, n );
+    for ( int32 i = 0; i < n; ++i )
+      col_sum[i] += diff[i];
+    row0 += width;
+    row1 += width;
+  }
+  for ( int32 c = lo; c < hi; ++c ) {
+    accum_type const* sum = col_sum + (c - lo);
+    accum_type ret = 0;
+    for ( int32 i = 0; i < kern_width; ++i )
+      ret += sum[i];
+    result[c-c0] = ret;
+  }
+}
+
+// Solves rhs * x = lhs for a symmetric positive definite rhs by its
+// Cholesky decomposition, writing x over lhs, as posv() does.  If
+// rhs is not positive definite lhs is left as it was.
+inline bool solve_symmetric_6x6(Matrix<float,6,6> const& rhs, Vector<float,6>& lhs) {
+  float L[6][6];
+  for (int32 j = 0; j < 6; ++j) {
+    float diag = rhs(j,j);
+    for (int32 k = 0; k < j; ++k)
+      diag -= L[j][k]*L[j][k];
+    if (!(diag > 0))
+      return false;
+    L[j][j] = sqrt(diag);
+    for (int32 i = j+1; i < 6; ++i) {
+      float sum = rhs(i,j);
+      for (int32 k = 0; k < j; ++k)
+        sum -= L[i][k]*L[j][k];
+      L[i][j] = sum / L[j][j];
+    }
+  }
+  float y[6];
+  for (int32 i = 0; i < 6; ++i) {
+    float sum = lhs(i);
+    for (int32 k = 0; k < i; ++k)
+      sum -= L[i][k]*y[k];
+    y[i] = sum / L[i][i];
+  }
+  for (int32 i = 5; i >= 0; --i) {
+    float sum = y[i];
+    for (int32 k = i+1; k < 6; ++k)
+      sum -= L[k][i]*lhs(k);
+    lhs(i) = sum / L[i][i];
+  }
+  return true;
+}
+
+// Samples image at (x,y) as the bilinear, zero edge extended
+// interpolation view does.  Float images are read directly inside
+// the image, with the same arithmetic, rather than through the view.
+template <class ChannelT, class InterpT>
+inline ChannelT sample_bilinear(ImageView<ChannelT> const& /*image*/,
+                                InterpT const& interp, float x, float y) {
+  return interp(x,y);
+}
+
+template <class InterpT>
+inline float sample_bilinear(ImageView<float> const& image,
+                             InterpT const& interp, float x, float y) {
+  int32 ix = int32(floorf(x)), iy = int32(floorf(y));
+  if (ix < 0 || iy < 0 || ix+1 >= image.cols() || iy+1 >= image.rows())
+    return interp(x,y);
+  float const* p = &image(ix,iy);
+  float normx = x - float(ix), normy = y - float(iy);
+  float norm1mx = 1 - normx, norm1my = 1 - normy;
+  float result = p[0] * norm1mx;
+  result += p[1] * normx;
+  result *= norm1my;
+  p += image.cols();
+  float row = p[0] * norm1mx;
+  row += p[1] * normx;
+  result += row * normy;
+  return result;
+}
+
 ///-------------------------------------------------------------------------
 
 inline ImageView<float>
@@ -577,8 +695,8 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
 
       // Compute the base weight image
       int32 good_pixels =
-        adjust_weight_image(w, crop(disparity_map, current_window),
-                                            weight_template);
+        adjust_weight_image(w, disparity_map, current_window,
+                            weight_template);
 
       // Skip over pixels for which there are very few good matches
       // in the neighborhood.
@@ -659,7 +777,8 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
               float delta_y = d_em[3] * ii + delta_y_partial;
 
               /// Expectation
-              ChannelT interpreted_px = right_interp_image(xx,yy);
+              ChannelT interpreted_px =
+                detail::sample_bilinear(right_image, right_interp_image, xx, yy);
               float I_e_val = interpreted_px - (*left_image_patch_ptr);
               in_curr_sum_I_e_val += I_e_val;
               float temp_plane = I_e_val - delta_x*(*I_x_ptr) -
@@ -770,10 +889,7 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
           rhs(5,4) = rhs(4,5);
 
           // Solves lhs = rhs * x, and stores the result in-place in lhs.
-          const math::f77_int n = 6;
-          const math::f77_int nrhs = 1;
-          math::f77_int info;
-          math::posv('L',n,nrhs,&(rhs(0,0)), n, &(lhs(0)), n, &info);
+          detail::solve_symmetric_6x6(rhs, lhs);
 
           //normalize the mean of the noise
           mean_noise = mean_noise_tmp/sum_gamma_noise;
@@ -825,6 +941,7 @@ subpixel_correlation_parabola(ImageView<PixelMask<Vector2f> > &disparity_map,
                               ImageView<ChannelT> const& left_image,
                               ImageView<ChannelT> const& right_image,
                               int32 kern_width, int32 kern_height,
+                              BBox2i region_of_interest,
                               bool do_horizontal_subpixel,
                               bool do_vertical_subpixel,
                               bool /*verbose*/ = false) {
@@ -837,123 +954,113 @@ subpixel_correlation_parabola(ImageView<PixelMask<Vector2f> > &disparity_map,
   int32 height = disparity_map.rows();
   int32 width = disparity_map.cols();
 
-  ChannelT *new_img0 = &(left_image(0,0));
-  ChannelT *new_img1 = &(right_image(0,0));
+  ChannelT const* new_img0 = &(left_image(0,0));
+  ChannelT const* new_img1 = &(right_image(0,0));
 
   // Bail out if no subpixel computation has been requested
   if (!do_horizontal_subpixel && !do_vertical_subpixel) return;
 
-  // We get a considerable speedup in our 2d subpixel correlation if
-  // we go ahead and compute the pseudoinverse of the A matrix (where
-  // each row in A is [ x^2 y^2 xy x y 1] (our 2d parabolic surface)
-  // for the range of x = [-1:1] and y = [-1:1].
-  static float pinvA_data[] =
-    { 1.0/6,  1.0/6,  1.0/6, -1.0/3, -1.0/3, -1.0/3,  1.0/6,  1.0/6,  1.0/6,
-      1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,  1.0/6, -1.0/3,  1.0/6,
-      1.0/4,    0.0, -1.0/4,    0.0,    0.0,    0.0, -1.0/4,    0.0,  1.0/4,
-      -1.0/6, -1.0/6, -1.0/6,    0.0,    0.0,   0.0,  1.0/6,  1.0/6,  1.0/6,
-      -1.0/6,    0.0,  1.0/6, -1.0/6,    0.0, 1.0/6, -1.0/6,    0.0,  1.0/6,
-      -1.0/9,  2.0/9, -1.0/9,  2.0/9,  5.0/9, 2.0/9, -1.0/9,  2.0/9, -1.0/9 };
-  MatrixProxy<float,6,9> pinvA(pinvA_data);
-  for (int32 r = 0; r < height; r++) {
-    for (int32 c = 0; c < width; c++) {
-      if ( !is_valid(disparity_map(c,r) ) )
+  region_of_interest.crop( BBox2i(0,0,width,height) );
+
+  // The costs needed at each pixel, as offsets from its disparity.
+  // For the 2d fit they are in the order find_minimum_2d() takes:
+  //
+  //     0  3  6
+  //     1  4  7
+  //     2  5  8
+  //
+  // and otherwise the middle one is always first.
+  std::vector<Vector2i> offsets;
+  if (do_horizontal_subpixel && do_vertical_subpixel) {
+    for (int32 dx = -1; dx <= 1; ++dx)
+      for (int32 dy = -1; dy <= 1; ++dy)
+        offsets.push_back( Vector2i(dx,dy) );
+  } else if (do_horizontal_subpixel) {
+    offsets.push_back( Vector2i(0,0) );
+    offsets.push_back( Vector2i(-1,0) );
+    offsets.push_back( Vector2i(1,0) );
+  } else {
+    offsets.push_back( Vector2i(0,0) );
+    offsets.push_back( Vector2i(0,-1) );
+    offsets.push_back( Vector2i(0,1) );
+  }
+  const int32 num_offsets = int32(offsets.size());
+
+  // The costs are found for a run of neighbouring pixels with the
+  // same integer disparity at once, so that their windows share the
+  // work, and then fit pixel by pixel.  These are the workspaces,
+  // with the costs of pixel i and offset k at costs[i*num_offsets+k].
+  std::vector<accum_type> costs, run_costs, col_sums;
+  std::vector<ChannelT> diffs;
+
+  for (int32 r = region_of_interest.min().y(); r < region_of_interest.max().y(); r++) {
+    int32 c = region_of_interest.min().x();
+    while (c < region_of_interest.max().x()) {
+      if ( !is_valid(disparity_map(c,r) ) ) {
+        c++;
         continue;
+      }
 
       int32 hdisp = int32(disparity_map(c,r)[0]);
       int32 vdisp = int32(disparity_map(c,r)[1]);
+      int32 run_end = c+1;
+      while (run_end < region_of_interest.max().x() &&
+             is_valid(disparity_map(run_end,r)) &&
+             int32(disparity_map(run_end,r)[0]) == hdisp &&
+             int32(disparity_map(run_end,r)[1]) == vdisp)
+        run_end++;
+      int32 run_length = run_end - c;
+
+      costs.resize( run_length * num_offsets );
+      run_costs.resize( run_length );
+      for (int32 k = 0; k < num_offsets; ++k) {
+        detail::compute_soad_run(new_img0, new_img1, r, c, run_end,
+                                 hdisp + offsets[k][0], vdisp + offsets[k][1],
+                                 kern_width, kern_height, width, height,
+                                 &run_costs[0], col_sums, diffs);
+        for (int32 i = 0; i < run_length; ++i)
+          costs[i*num_offsets + k] = run_costs[i];
+      }
 
-      accum_type mid = compute_soad(new_img0, new_img1,
-                                    r, c, hdisp, vdisp,
-                                    kern_width, kern_height,
-                                    width, height);
-
-      if (do_horizontal_subpixel && !do_vertical_subpixel) {
-        // If only horizontal subpixel resolution is requested
-        accum_type lt = compute_soad(new_img0, new_img1,
-                                     r, c, hdisp-1, vdisp,
-                                     kern_width, kern_height,
-                                     width, height);
-        accum_type rt = compute_soad(new_img0, new_img1,
-                                     r, c, hdisp+1, vdisp,
-                                     kern_width, kern_height,
-                                     width, height);
-
+      for (int32 i = 0; i < run_length; ++i, ++c) {
+        accum_type const* points = &costs[i*num_offsets];
+        if (num_offsets == 9) {
+          // If both vertical and horizontal subpixel resolution is
+          // requested, we try to fit a 2d hyperbolic surface using
+          // the 9 points surrounding the peak SOAD value.
+          Vector2f offset = detail::find_minimum_2d(points);
+
+          // This prevents us from adding in large offsets for
+          // poorly fit data, which keeps its integer disparity.
+          if (norm_2(offset) < 5.0)
+            remove_mask(disparity_map(c,r)) += offset;
+          continue;
+        }
+
+        // Otherwise a parabola is fit to the cost at the disparity
+        // and those on either side of it.
+        accum_type mid = points[0], lt = points[1], rt = points[2];
+        int32 axis = do_horizontal_subpixel ? 0 : 1;
         if ((mid <= lt && mid < rt) || (mid <= rt && mid < lt))
-          disparity_map(c,r)[0] += detail::find_minimum(lt, mid, rt);
+          disparity_map(c,r)[axis] += detail::find_minimum(lt, mid, rt);
         else
           invalidate( disparity_map(c,r) );
-      } else if (do_vertical_subpixel && !do_horizontal_subpixel) {
-        // If only vertical subpixel resolution is requested
-        accum_type up = compute_soad(new_img0, new_img1,
-                                     r, c, hdisp, vdisp-1,
-                                     kern_width, kern_height,
-                                     width, height);
-        accum_type dn = compute_soad(new_img0, new_img1,
-                                     r, c, hdisp, vdisp+1,
-                                     kern_width, kern_height,
-                                     width, height);
-
-        if ((mid <= up && mid < dn) || (mid <= dn && mid < up))
-          disparity_map(c,r)[1] += detail::find_minimum(up, mid, dn);
-        else
-          invalidate(disparity_map(c,r));
-      } else if (do_vertical_subpixel && do_horizontal_subpixel) {
-        // If both vertical and horizontal subpixel resolution is
-        // requested, we try to fit a 2d hyperbolic surface using
-        // the 9 points surrounding the peak SOAD value.
-        //
-        // We place the soad values into a vector using the
-        // following indices (i.e. index 4 is the max disparity
-        // value)
-        //
-        //     0  3  6
-        //     1  4  7
-        //     2  5  8
-        Vector<accum_type,9> points;
-
-        points(0) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp-1, vdisp-1,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(1) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp-1, vdisp,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(2) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp-1, vdisp+1,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(3) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp, vdisp-1,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(4) = mid;
-        points(5) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp, vdisp+1,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(6) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp+1, vdisp-1,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(7) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp+1, vdisp,
-                                 kern_width, kern_height,
-                                 width, height);
-        points(8) = compute_soad(new_img0, new_img1,
-                                 r, c, hdisp+1, vdisp+1,
-                                 kern_width, kern_height,
-                                 width, height);
-        Vector2f offset = detail::find_minimum_2d(points, pinvA);
-
-        // This prevents us from adding in large offsets for
-        // poorly fit data.
-        if (norm_2(offset) < 5.0)
-          remove_mask(disparity_map(c,r)) += offset;
-        else
-          invalidate(disparity_map);
       }
     } // c loop
   }   // r loop
 }
+
+template<class ChannelT> void
+subpixel_correlation_parabola(ImageView<PixelMask<Vector2f> > &disparity_map,
+                              ImageView<ChannelT> const& left_image,
+                              ImageView<ChannelT> const& right_image,
+                              int32 kern_width, int32 kern_height,
+                              bool do_horizontal_subpixel,
+                              bool do_vertical_subpixel,
+                              bool verbose = false) {
+  subpixel_correlation_parabola(disparity_map, left_image, right_image,
+                                kern_width, kern_height,
+                                BBox2i(0,0,disparity_map.cols(),disparity_map.rows()),
+                                do_horizontal_subpixel, do_vertical_subpixel,
+                                verbose);
+}
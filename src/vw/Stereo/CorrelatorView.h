@@ -11,6 +11,7 @@
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Stereo/Correlate.h>
 #include <vw/Stereo/PyramidCorrelator.h>
+#include <vw/Stereo/SemiGlobalMatcher.h>
 #include <vw/Stereo/DisparityMap.h>
 
 #include <ostream>
@@ -35,6 +36,10 @@ namespace stereo {
     stereo::CorrelatorType m_correlator_type;
     std::string m_debug_prefix;
     bool m_do_pyramid_correlator;
+    bool m_do_semi_global_matching;
+    SemiGlobalMatcher::CostType m_sgm_cost_type;
+    int32 m_sgm_penalty1, m_sgm_penalty2;
+    bool m_fused_cross_check;
 
     // Precalculated constants
     int32 m_num_pyramid_levels;
@@ -52,7 +57,9 @@ namespace stereo {
                    bool do_pyramid_correlator = true ) :
       m_left_image(left_image.impl()), m_right_image(right_image.impl()),
       m_left_mask(left_mask.impl()), m_right_mask(right_mask.impl()),
-      m_preproc_func(preproc_func), m_do_pyramid_correlator(do_pyramid_correlator) {
+      m_preproc_func(preproc_func), m_do_pyramid_correlator(do_pyramid_correlator),
+      m_do_semi_global_matching(false), m_sgm_cost_type(SemiGlobalMatcher::CENSUS_COST),
+      m_sgm_penalty1(10), m_sgm_penalty2(120), m_fused_cross_check(false) {
 
         // Basic assertions
         VW_ASSERT((left_image.impl().cols() == right_image.impl().cols()) &&
@@ -103,9 +110,31 @@ namespace stereo {
       int32 cost_blur() const { return m_cost_blur; }
       stereo::CorrelatorType correlator_type() const { return m_correlator_type; }
 
+      /// Match with a SemiGlobalMatcher in place of the window
+      /// correlators.  The kernel width sets the census window, as
+      /// census_window_size() has it, and the cross correlation threshold
+      /// the left-right check; the cost blur, correlator type and score
+      /// threshold do not apply.  See SemiGlobalMatcher.h.
+      void set_semi_global_matching(bool enable,
+                                    SemiGlobalMatcher::CostType cost_type = SemiGlobalMatcher::CENSUS_COST,
+                                    int32 penalty1 = 10, int32 penalty2 = 120) {
+        m_do_semi_global_matching = enable;
+        m_sgm_cost_type = cost_type;
+        m_sgm_penalty1 = penalty1;
+        m_sgm_penalty2 = penalty2;
+      }
+      bool semi_global_matching() const { return m_do_semi_global_matching; }
+
       void set_cross_corr_threshold(float threshold) { m_cross_corr_threshold = threshold; }
       float cross_corr_threshold() const { return m_cross_corr_threshold; }
 
+      /// Find the right to left disparities for the cross check from
+      /// the same costs as the left to right ones, rather than
+      /// correlating a second time.  See cross_checked_correlate() in
+      /// OptimizedCorrelator.h.
+      void set_fused_cross_check(bool fused) { m_fused_cross_check = fused; }
+      bool fused_cross_check() const { return m_fused_cross_check; }
+
       void set_corr_score_threshold(float threshold) { m_corr_score_threshold = threshold; }
       float corr_score_threshold() const { return m_corr_score_threshold; }
 
@@ -178,12 +207,24 @@ namespace stereo {
              sum_of_pixel_values(cropped_right_mask) != 0 ) {
           // We have all of the settings adjusted.  Now we just have to
           // run the correlator.
-          if ( m_do_pyramid_correlator ) {
+          if ( m_do_semi_global_matching ) {
+            SemiGlobalMatcher matcher(BBox2i(0,0,m_search_range.width(),
+                                             m_search_range.height()),
+                                      m_sgm_cost_type, census_window_size(m_kernel_size[0]),
+                                      m_cross_corr_threshold,
+                                      m_sgm_penalty1, m_sgm_penalty2);
+            disparity_map = disparity_mask(matcher( cropped_left_image,
+                                                    cropped_right_image,
+                                                    m_preproc_func ),
+                                           cropped_left_mask,
+                                           cropped_right_mask );
+          } else if ( m_do_pyramid_correlator ) {
             PyramidCorrelator correlator(BBox2(0,0,m_search_range.width(),
                                                m_search_range.height()),
                                          Vector2i(m_kernel_size[0], m_kernel_size[1]),
                                          m_cross_corr_threshold, m_corr_score_threshold,
                                          m_cost_blur, m_correlator_type, m_num_pyramid_levels);
+            correlator.set_fused_cross_check(m_fused_cross_check);
 
             // For debugging: this saves the disparity map at various
             // pyramid levels to disk.
@@ -203,6 +244,7 @@ namespace stereo {
                                            m_kernel_size[0],
                                            m_cross_corr_threshold, m_corr_score_threshold,
                                            m_cost_blur, m_correlator_type );
+            correlator.set_fused_cross_check(m_fused_cross_check);
             disparity_map = disparity_mask(correlator( cropped_left_image,
                                                        cropped_right_image,
                                                        m_preproc_func ),
@@ -243,6 +285,7 @@ namespace stereo {
     os << "\tcost blur: " << view.cost_blur() << "\n";
     os << "\tcorrelator type: " << view.correlator_type() << "\n";
     os << "\tcorrscore rejection thresh: " << view.corr_score_threshold() << "\n";
+    os << "\tsemi-global matching: " << (view.semi_global_matching() ? "yes" : "no") << "\n";
     os << "---------------------------------------------------------------\n";
     return os;
   }
@@ -9,6 +9,7 @@
 #define __VW_STEREO_DISPARITY_MAP_H__
 
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PerPixelViews.h>
@@ -18,9 +19,15 @@
 #include <vw/Image/Transform.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/Statistics.h>
+#include <vw/Stereo/CompactDisparity.h>
 
 // For the PixelDisparity math.
 #include <boost/operators.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
 
 namespace vw {
 
@@ -333,17 +340,266 @@ namespace stereo {
     return os;
   }
 
+  namespace detail {
+    // Sets out[i*stride+x] to the least (or with MaxB, the greatest)
+    // of in[i*stride+x] to in[(i+2r)*stride+x], for i from 0 to n-2r-1
+    // and x from 0 to width-1, with three comparisons per element
+    // whatever r is (van Herk and Gil-Werman).  The scratch holds
+    // 2*n*width floats.
+    template <bool MaxB>
+    inline float extreme( float a, float b ) { return MaxB ? std::max(a,b) : std::min(a,b); }
+
+    template <bool MaxB>
+    void sliding_extreme( float const* in, int32 n, int32 width, ptrdiff_t stride, int32 r,
+                          float* out, float* scratch ) {
+      const int32 k = 2*r+1;
+      if ( n < k )
+        return;
+      float *g = scratch, *h = scratch + size_t(n)*width;
+      for ( int32 b = 0; b < n; b += k ) {
+        int32 e = std::min( b+k, n );
+        // Running extremes from the start of each run of k to there...
+        std::copy( in + b*stride, in + b*stride + width, g + size_t(b)*width );
+        for ( int32 i = b+1; i < e; i++ ) {
+          float const* v = in + i*stride;
+          float* gi = g + size_t(i)*width;
+          for ( int32 x = 0; x < width; x++ )
+            gi[x] = extreme<MaxB>( v[x], gi[x-width] );
+        }
+        // ...and from there to the end of the run.
+        std::copy( in + (e-1)*stride, in + (e-1)*stride + width, h + size_t(e-1)*width );
+        for ( int32 i = e-2; i >= b; i-- ) {
+          float const* v = in + i*stride;
+          float* hi = h + size_t(i)*width;
+          for ( int32 x = 0; x < width; x++ )
+            hi[x] = extreme<MaxB>( v[x], hi[x+width] );
+        }
+      }
+      for ( int32 i = 0; i + k <= n; i++ ) {
+        float const* gi = g + size_t(i+k-1)*width;
+        float const* hi = h + size_t(i)*width;
+        float* o = out + i*stride;
+        for ( int32 x = 0; x < width; x++ )
+          o[x] = extreme<MaxB>( gi[x], hi[x] );
+      }
+    }
+  }
+
+  /// The block view behind remove_outliers().  It gives the same
+  /// result as RemoveOutliersFunc, but each block works from its own
+  /// rasterized copy of the input, in three steps that mostly don't
+  /// depend on the kernel size.  An integral image of validity counts
+  /// the valid pixels in each window: when too few are valid for the
+  /// pixel to pass, it is rejected straight away.  Sliding minimums
+  /// and maximums of the disparities then tell whether every valid
+  /// pixel in the window agrees with the center, in which case they
+  /// all match and the pixel is kept.  Only the pixels left, near
+  /// disparity edges, have their windows scanned.  Blocks share
+  /// nothing but the counters, so they may be rasterized in parallel.
+  template <class ViewT>
+  class RemoveOutliersView : public ImageViewBase<RemoveOutliersView<ViewT> > {
+    struct RemoveOutliersState {
+      Atomic<int64> rejected_points, total_points;
+    };
+
+    ViewT m_view;
+    int32 m_half_h_kernel, m_half_v_kernel;
+    float m_pixel_threshold;
+    float m_rejection_threshold;
+    boost::shared_ptr<RemoveOutliersState> m_state;
+
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<RemoveOutliersView> pixel_accessor;
+
+    RemoveOutliersView( ViewT const& view, int32 half_h_kernel, int32 half_v_kernel,
+                        float pixel_threshold, float rejection_threshold ) :
+      m_view(view), m_half_h_kernel(half_h_kernel), m_half_v_kernel(half_v_kernel),
+      m_pixel_threshold(pixel_threshold), m_rejection_threshold(rejection_threshold),
+      m_state( new RemoveOutliersState() ) {
+      VW_ASSERT(half_h_kernel > 0 && half_v_kernel > 0,
+                ArgumentErr() << "RemoveOutliersView: half kernel sizes must be non-zero.");
+    }
+
+    inline int32 cols() const { return m_view.cols(); }
+    inline int32 rows() const { return m_view.rows(); }
+    inline int32 planes() const { return m_view.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+    // Works out a single pixel the way a block is; rasterize this view
+    // rather than reading it a pixel at a time.
+    inline result_type operator()( int32 i, int32 j, int32 p = 0 ) const {
+      return prerasterize( BBox2i(i,j,1,1) )( i, j, p );
+    }
+
+    int32 half_h_kernel() const { return m_half_h_kernel; }
+    int32 half_v_kernel() const { return m_half_v_kernel; }
+    float rejection_threshold() const { return m_rejection_threshold; }
+    float pixel_threshold() const { return m_pixel_threshold; }
+    int64 rejected_points() const { return m_state->rejected_points.load(); }
+    int64 total_points() const { return m_state->total_points.load(); }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      const int32 hh = m_half_h_kernel, hv = m_half_v_kernel;
+      const int32 cols = bbox.width(), rows = bbox.height();
+      const int32 src_cols = cols + 2*hh, src_rows = rows + 2*hv;
+      const int32 total = (2*hh+1)*(2*hv+1);
+
+      // Outside the image, pixels read as invalid as they did through
+      // the zero edge extension of RemoveOutliersFunc.
+      ImageView<pixel_type> src =
+        crop( edge_extend( m_view, ZeroEdgeExtension() ),
+              bbox.min().x()-hh, bbox.min().y()-hv, src_cols, src_rows );
+
+      // Small windows are quicker to scan than to find the extremes
+      // of the disparities for.
+      const bool use_extremes = total > 49;
+
+      // Valid pixel counts, and the disparities with invalid pixels
+      // made neutral for the minimums and maximums.
+      ImageView<int32> valid_sum( src_cols+1, src_rows+1 );
+      std::vector<float> disp_lo[2], disp_hi[2];
+      for ( int32 c = 0; c < 2; c++ ) {
+        disp_lo[c].resize( size_t(src_cols)*src_rows );
+        if ( use_extremes )
+          disp_hi[c].resize( size_t(src_cols)*src_rows );
+      }
+      const float inf = std::numeric_limits<float>::infinity();
+      for ( int32 i = 0; i <= src_cols; i++ )
+        valid_sum(i,0) = 0;
+      for ( int32 j = 0; j < src_rows; j++ ) {
+        int32 row_sum = 0;
+        valid_sum(0,j+1) = 0;
+        for ( int32 i = 0; i < src_cols; i++ ) {
+          pixel_type const& pix = src(i,j);
+          size_t index = size_t(j)*src_cols + i;
+          if ( is_valid(pix) ) {
+            row_sum++;
+            for ( int32 c = 0; c < 2; c++ ) {
+              float d = pix[c];
+              // A NaN matches nothing, so it is set to spoil the maximum.
+              disp_lo[c][index] = d == d ? d : inf;
+              if ( use_extremes )
+                disp_hi[c][index] = d == d ? d : inf;
+            }
+          } else {
+            for ( int32 c = 0; c < 2; c++ ) {
+              disp_lo[c][index] = inf;
+              if ( use_extremes )
+                disp_hi[c][index] = -inf;
+            }
+          }
+          valid_sum(i+1,j+1) = valid_sum(i+1,j) + row_sum;
+        }
+      }
+
+      // The least and greatest of each disparity over each window.  The
+      // columns are done first, and then the rows by way of a
+      // transpose, so both passes run along whole rows of memory.  The
+      // results are transposed: window (i,j) is at i*rows+j.
+      std::vector<float> scratch, col_ext, col_ext_t;
+      std::vector<float> win_lo[2], win_hi[2];
+      if ( use_extremes ) {
+        scratch.resize( 2*size_t(src_rows)*src_cols );
+        col_ext.resize( size_t(src_cols)*rows );
+        col_ext_t.resize( col_ext.size() );
+      }
+      for ( int32 c = 0; c < 2 && use_extremes; c++ ) {
+        win_lo[c].resize( size_t(cols)*rows );
+        win_hi[c].resize( size_t(cols)*rows );
+        for ( int32 pass = 0; pass < 2; pass++ ) {
+          std::vector<float> const& in = pass ? disp_hi[c] : disp_lo[c];
+          std::vector<float>& out = pass ? win_hi[c] : win_lo[c];
+          void (*extreme)( float const*, int32, int32, ptrdiff_t, int32, float*, float* ) =
+            pass ? &detail::sliding_extreme<true> : &detail::sliding_extreme<false>;
+          extreme( &in[0], src_rows, src_cols, src_cols, hv, &col_ext[0], &scratch[0] );
+          for ( int32 j = 0; j < rows; j++ )
+            for ( int32 i = 0; i < src_cols; i++ )
+              col_ext_t[size_t(i)*rows + j] = col_ext[size_t(j)*src_cols + i];
+          extreme( &col_ext_t[0], src_cols, rows, rows, hh, &out[0], &scratch[0] );
+        }
+      }
+
+      // The fewest matches that keep a pixel, as RemoveOutliersFunc
+      // decides it.
+      int32 need = std::max( int32(std::ceil(m_rejection_threshold*total)), 0 );
+      while ( need > 0 && !( (float)(need-1)/(float)total < m_rejection_threshold ) )
+        need--;
+      while ( (float)need/(float)total < m_rejection_threshold )
+        need++;
+
+      ImageView<pixel_type> result( cols, rows );
+      int64 rejected = 0;
+      for ( int32 j = 0; j < rows; j++ ) {
+        for ( int32 i = 0; i < cols; i++ ) {
+          pixel_type const& center = src(i+hh,j+hv);
+          result(i,j) = center;
+          if ( !is_valid(center) )
+            continue;
+
+          int32 num_valid = valid_sum(i+2*hh+1,j+2*hv+1) - valid_sum(i,j+2*hv+1)
+            - valid_sum(i+2*hh+1,j) + valid_sum(i,j);
+          bool reject = num_valid < need;
+          if ( !reject ) {
+            size_t index = size_t(i)*rows + j;
+            float d0 = center[0], d1 = center[1];
+            bool all_match = use_extremes &&
+              win_hi[0][index] - d0 <= m_pixel_threshold && d0 - win_lo[0][index] <= m_pixel_threshold &&
+              win_hi[1][index] - d1 <= m_pixel_threshold && d1 - win_lo[1][index] <= m_pixel_threshold;
+            if ( !all_match ) {
+              // Invalid pixels hold infinities here, so they never match.
+              int32 matched = 0;
+              for ( int32 yk = 0; yk <= 2*hv && matched < need; yk++ ) {
+                if ( matched + (2*hv+1-yk)*(2*hh+1) < need )
+                  break;
+                size_t row = size_t(j+yk)*src_cols + i;
+                float const* lo0 = &disp_lo[0][row];
+                float const* lo1 = &disp_lo[1][row];
+                for ( int32 xk = 0; xk <= 2*hh; xk++ )
+                  matched += ( std::fabs(d0-lo0[xk]) <= m_pixel_threshold ) &
+                             ( std::fabs(d1-lo1[xk]) <= m_pixel_threshold );
+              }
+              reject = matched < need;
+            }
+          }
+          if ( reject ) {
+            result(i,j) = pixel_type();  // Return invalid pixel
+            rejected++;
+          }
+        }
+      }
+      m_state->rejected_points.add( rejected );
+      m_state->total_points.add( int64(cols)*rows );
+
+      return crop( result, -bbox.min().x(), -bbox.min().y(), this->cols(), this->rows() );
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  // Useful routine for printing how many points have been rejected
+  // using a particular RemoveOutliersView.
+  template <class ViewT>
+  inline std::ostream&
+  operator<<(std::ostream& os, RemoveOutliersView<ViewT> const& u) {
+    os << "\tKernel: [ " << u.half_h_kernel()*2 << ", " << u.half_v_kernel()*2 << "]\n";
+    os << "   Rejected " << u.rejected_points() << "/" << u.total_points() << " vertices ("
+       << double(u.rejected_points())/u.total_points()*100 << "%).\n";
+    return os;
+  }
+
   template <class ViewT>
-  UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, RemoveOutliersFunc<typename ViewT::pixel_type> >
+  RemoveOutliersView<ViewT>
   remove_outliers(ImageViewBase<ViewT> const& disparity_map,
                   int32 half_h_kernel, int32 half_v_kernel,
                   double pixel_threshold,
                   double rejection_threshold) {
-    typedef RemoveOutliersFunc<typename ViewT::pixel_type> func_type;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, func_type > view_type;
-    return view_type(edge_extend(disparity_map.impl(), ZeroEdgeExtension()),
-                     func_type(half_h_kernel, half_v_kernel,
-                               pixel_threshold, rejection_threshold));
+    return RemoveOutliersView<ViewT>(disparity_map.impl(), half_h_kernel, half_v_kernel,
+                                     pixel_threshold, rejection_threshold);
   }
 
 
@@ -359,10 +615,7 @@ namespace stereo {
   /// that must "match" the center pixel if that pixel is to be
   /// considered an inlier. ([0..1.0]).
   template <class ViewT>
-  inline UnaryPerPixelAccessorView< EdgeExtensionView< UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>,
-                                                                                 RemoveOutliersFunc<typename ViewT::pixel_type> >,
-                                                       ZeroEdgeExtension>,
-                                    RemoveOutliersFunc<typename ViewT::pixel_type> >
+  inline RemoveOutliersView<RemoveOutliersView<ViewT> >
   disparity_clean_up(ImageViewBase<ViewT> const& disparity_map,
                      int32 h_half_kernel, int32 v_half_kernel,
                      double pixel_threshold, double rejection_threshold) {
@@ -13,11 +13,14 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImagePyramid.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math.h>
 #include <ostream>
 
 // For the PixelDisparity math.
 #include <boost/operators.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace vw {
   namespace stereo {
@@ -87,11 +90,14 @@ namespace vw {
         }
       };
 
-      void set_pyramid_levels(int levels) { pyramid_levels = levels; }
+      void set_pyramid_levels(int levels) { pyramid_levels = levels; build_pyramids(); }
       // EM parameter setters
       void set_kernel_size(Vector2i size) { m_kernel_size = size; }
       void set_em_iter_max(int iter) { em_iter_max = iter; }
       void set_em_epsilon(double epsilon) { epsilon_em = epsilon; }
+      /// EM stops at a pixel once an iteration moves its disparity by
+      /// less than this many pixels.  Zero turns the test off.
+      void set_em_disparity_epsilon(double epsilon) { epsilon_em_disparity = epsilon; }
       void set_prob_inlier_0(double P) { P_inlier_0 = P; }
       void set_prob_inlier_min(double P) { P_inlier_min = P; }
       void set_prob_inlier_max(double P) { P_inlier_max = P; }
@@ -107,6 +113,15 @@ namespace vw {
 
       Vector2i kernel_size() const { return m_kernel_size; }
 
+      /// The number of pixels refined, at every pyramid level, by this
+      /// view and its copies so far, and the EM iterations they took.
+      uint64 em_pixels() const { return m_stats->pixels.load(); }
+      uint64 em_iterations() const { return m_stats->iterations.load(); }
+      double em_iterations_per_pixel() const {
+        uint64 pixels = em_pixels();
+        return pixels ? double(em_iterations())/double(pixels) : 0.0;
+      }
+
       // Standard ImageView interface methods
       inline int32 cols() const { return m_left_image.cols(); }
       inline int32 rows() const { return m_left_image.rows(); }
@@ -132,6 +147,18 @@ namespace vw {
       ImageViewRef<ImagePixelT> m_left_image, m_right_image;
       ImageViewRef<disparity_pixel> m_course_disparity;
 
+      // Pyramid levels of the whole left and right images.  Their
+      // blocks are kept in the system cache, so neighbouring tiles
+      // (and copies of this view) share them rather than each
+      // building their own pyramid.
+      std::vector<ImageViewRef<ImagePixelT> > m_left_levels, m_right_levels;
+
+      // EM iteration counts, shared by copies of the view.
+      struct EMStats {
+        Atomic<uint64> pixels, iterations;
+      };
+      boost::shared_ptr<EMStats> m_stats;
+
       // global settings
       int pyramid_levels;
 
@@ -139,6 +166,7 @@ namespace vw {
       Vector2i m_kernel_size;
       int em_iter_max;
       double epsilon_em;
+      double epsilon_em_disparity;
       double P_inlier_0;
       double P_inlier_min;
       double P_inlier_max;
@@ -157,6 +185,8 @@ namespace vw {
       BBox2i debug_region;
 
       // private helper methods
+      void build_pyramids();
+
       template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
         inline void
         m_subpixel_refine(ImageViewBase<ImageT> const& left_image, ImageViewBase<ImageT> const& right_image,
@@ -111,7 +111,7 @@ namespace vw {
     EMSubpixelCorrelatorView<ImagePixelT>::EMSubpixelCorrelatorView(ImageViewBase<ImageT> const& left_image, ImageViewBase<ImageT> const& right_image,
                                                                     ImageViewBase<DisparityT> const& course_disparity, int debug) :
       m_left_image(left_image.impl()), m_right_image(right_image.impl()),
-      m_course_disparity(course_disparity.impl()), debug_level(debug)
+      m_course_disparity(course_disparity.impl()), m_stats(new EMStats), debug_level(debug)
     {
       // Basic assertions
       VW_ASSERT((left_image.impl().cols() == right_image.impl().cols()) &&
@@ -139,12 +139,31 @@ namespace vw {
       sigma_n_min = 1e-4; // 1e-3 for apollo
       mu_n_0 = 0.;
       epsilon_em = 1;
+      epsilon_em_disparity = 1e-3;
       // affine model defaults
       inner_iter_max = 8; //8
       epsilon_inner = 1e-8; // 1e-8
       affine_min_det = .1; //.1
       affine_max_det = 1.9; //1.9
       debug_region = BBox2i(-1,-1, 0,0);
+
+      build_pyramids();
+    }
+
+
+    // build_pyramids()
+    template <class ImagePixelT>
+    void EMSubpixelCorrelatorView<ImagePixelT>::build_pyramids() {
+      VW_ASSERT(pyramid_levels >= 1,
+                ArgumentErr() << "EMSubpixelCorrelatorView: need at least one pyramid level.\n");
+      ImagePyramidView<ImagePixelT> left_pyramid(m_left_image, pyramid_levels, ZeroEdgeExtension());
+      ImagePyramidView<ImagePixelT> right_pyramid(m_right_image, pyramid_levels, ZeroEdgeExtension());
+      m_left_levels.clear();
+      m_right_levels.clear();
+      for (int i = 0; i < pyramid_levels; ++i) {
+        m_left_levels.push_back(left_pyramid[i]);
+        m_right_levels.push_back(right_pyramid[i]);
+      }
     }
 
 
@@ -175,35 +194,33 @@ namespace vw {
 
       // The area in the right image that we'll be searching is
       // determined by the bbox of the left image plus the search
-      // range.
-      BBox2i left_crop_bbox(bbox);
-      BBox2i right_crop_bbox(bbox.min() + search_range.min(),
-                             bbox.max() + search_range.max());
-
-      // The correlator requires the images to be the same size. The
-      // search bbox will always be larger than the given left image
-      // bbox, so we just make the left bbox the same size as the
-      // right bbox.
-      left_crop_bbox.max() = left_crop_bbox.min() + Vector2i(right_crop_bbox.width(), right_crop_bbox.height());
-
-      // Finally, we must adjust both bounding boxes to account for
-      // the size of the kernel itself.
-      right_crop_bbox.min() -= Vector2i(m_kernel_size[0], m_kernel_size[1]);
-      right_crop_bbox.max() += Vector2i(m_kernel_size[0], m_kernel_size[1]);
-      left_crop_bbox.min() -= Vector2i(m_kernel_size[0], m_kernel_size[1]);
-      left_crop_bbox.max() += Vector2i(m_kernel_size[0], m_kernel_size[1]);
-
-      // We crop the images to the expanded bounding box and edge
+      // range, and both must be padded by the size of the kernel
+      // itself.
+      BBox2i left_crop_bbox(bbox.min() - m_kernel_size, bbox.max() + m_kernel_size);
+      BBox2i right_crop_bbox(bbox.min() + search_range.min() - m_kernel_size,
+                             bbox.max() + search_range.max() + m_kernel_size);
+
+      // Each level of the pyramid below is a crop of the shared
+      // pyramid level, so the crops must start on a pixel of the
+      // coarsest level.
+      int32 align = 1 << (pyramid_levels-1);
+      for (int k = 0; k < 2; ++k) {
+        left_crop_bbox.min()[k] -= ((left_crop_bbox.min()[k] % align) + align) % align;
+        right_crop_bbox.min()[k] -= ((right_crop_bbox.min()[k] % align) + align) % align;
+      }
+
+      // The correlator requires the images to be the same size.
+      Vector2i crop_size(std::max(left_crop_bbox.width(), right_crop_bbox.width()),
+                         std::max(left_crop_bbox.height(), right_crop_bbox.height()));
+      left_crop_bbox.max() = left_crop_bbox.min() + crop_size;
+      right_crop_bbox.max() = right_crop_bbox.min() + crop_size;
+      Vector2i crop_offset = right_crop_bbox.min() - left_crop_bbox.min();
+
+      // We crop the disparities to the expanded bounding box and edge
       // extend in case the new bbox extends past the image bounds.
-      ImageView<ImagePixelT> left_image_patch, right_image_patch;
       ImageView<disparity_pixel> disparity_map_patch_in;
       ImageView<result_type> disparity_map_patch_out;
 
-
-      left_image_patch = crop(edge_extend(m_left_image, ZeroEdgeExtension()),
-                              left_crop_bbox);
-      right_image_patch = crop(edge_extend(m_right_image, ZeroEdgeExtension()),
-                               right_crop_bbox);
       disparity_map_patch_in = crop(edge_extend(m_course_disparity, ZeroEdgeExtension()),
                                     left_crop_bbox);
       disparity_map_patch_out.set_size(disparity_map_patch_in.cols(), disparity_map_patch_in.rows());
@@ -214,37 +231,38 @@ namespace vw {
       for (int v = 0; v < disparity_map_patch_in.rows(); ++v) {
         for (int u = 0; u < disparity_map_patch_in.cols(); ++u) {
           if (disparity_map_patch_in(u,v).valid())  {
-            disparity_map_patch_in(u,v).child().x() -= search_range.min().x();
-            disparity_map_patch_in(u,v).child().y() -= search_range.min().y();
+            disparity_map_patch_in(u,v).child().x() -= crop_offset.x();
+            disparity_map_patch_in(u,v).child().y() -= crop_offset.y();
           }
         }
       }
 
 
-      double blur_sigma_progressive = .5; // 3*sigma = 1.5 pixels
-
-      // create the pyramid first
+      // crop the pyramid first
       std::vector<ImageView<ImagePixelT> > left_pyramid(pyramid_levels), right_pyramid(pyramid_levels);
       std::vector<BBox2i> regions_of_interest(pyramid_levels);
       std::vector<ImageView<Matrix2x2> > warps(pyramid_levels);
       std::vector<ImageView<disparity_pixel> > disparity_map_pyramid(pyramid_levels);
 
 
-      // initialize the pyramid at level 0
-      left_pyramid[0] = channels_to_planes(left_image_patch);
-      right_pyramid[0] = channels_to_planes(right_image_patch);
+      // initialize the disparities at level 0
       disparity_map_pyramid[0] = disparity_map_patch_in;
-      regions_of_interest[0] = BBox2i(m_kernel_size[0], m_kernel_size[1],
-                                      bbox.width(),bbox.height());
-
-
-      // downsample the disparity map and the image pair to initialize the intermediate levels
-      for(int i = 1; i < pyramid_levels; i++) {
-        left_pyramid[i] = subsample(gaussian_filter(left_pyramid[i-1], blur_sigma_progressive), 2);
-        right_pyramid[i] = subsample(gaussian_filter(right_pyramid[i-1], blur_sigma_progressive), 2);
-
-        disparity_map_pyramid[i] = detail::subsample_disp_map_by_two(disparity_map_pyramid[i-1]);
-        regions_of_interest[i] = BBox2i(regions_of_interest[i-1].min()/2, regions_of_interest[i-1].max()/2);
+      regions_of_interest[0] = BBox2i(bbox.min() - left_crop_bbox.min(),
+                                      bbox.max() - left_crop_bbox.min());
+
+      Vector2i level_size = crop_size;
+      for(int i = 0; i < pyramid_levels; i++) {
+        left_pyramid[i] = crop(edge_extend(m_left_levels[i], ZeroEdgeExtension()),
+                               BBox2i(left_crop_bbox.min()/(1<<i), left_crop_bbox.min()/(1<<i) + level_size));
+        right_pyramid[i] = crop(edge_extend(m_right_levels[i], ZeroEdgeExtension()),
+                                BBox2i(right_crop_bbox.min()/(1<<i), right_crop_bbox.min()/(1<<i) + level_size));
+        level_size = (level_size + Vector2i(1,1))/2;
+
+        // downsample the disparity map to initialize the intermediate levels
+        if (i > 0) {
+          disparity_map_pyramid[i] = detail::subsample_disp_map_by_two(disparity_map_pyramid[i-1]);
+          regions_of_interest[i] = BBox2i(regions_of_interest[i-1].min()/2, regions_of_interest[i-1].max()/2);
+        }
       }
 
       // initialize warps at the lowest resolution level
@@ -310,8 +328,8 @@ namespace vw {
       for (int v = 0; v < disparity_map_patch_out.rows(); ++v) {
         for (int u = 0; u < disparity_map_patch_out.cols(); ++u) {
           if (disparity_map_patch_out(u,v).valid())  {
-            disparity_map_patch_out(u,v).child().x() += search_range.min().x();
-            disparity_map_patch_out(u,v).child().y() += search_range.min().y();
+            disparity_map_patch_out(u,v).child().x() += crop_offset.x();
+            disparity_map_patch_out(u,v).child().y() += crop_offset.y();
           }
         }
       }
@@ -322,8 +340,8 @@ namespace vw {
       }
 #endif
 
-      return crop(disparity_map_patch_out, BBox2i(m_kernel_size[0]-bbox.min().x(),
-                                                  m_kernel_size[1]-bbox.min().y(),
+      return crop(disparity_map_patch_out, BBox2i(-left_crop_bbox.min().x(),
+                                                  -left_crop_bbox.min().y(),
                                                   m_left_image.cols(),
                                                   m_left_image.rows()));
     }
@@ -422,6 +440,7 @@ namespace vw {
       // loop through all pixels
       int x, y;
       int num_pixels = 0;
+      uint64 num_em_iterations = 0;
       Stopwatch pixel_timer;
       bool debug = false;
 
@@ -552,6 +571,7 @@ namespace vw {
           affine_comp.update_posterior();
           outlier_comp1.update_posterior();
           outlier_comp2.update_posterior();
+          Vector2 disparity_last = affine_comp.affine_transform().reverse(pos) - pos;
           em_timer.start();
           for(em_iter = 0; em_iter < em_iter_max; em_iter++) {
             Stopwatch inner_loop_init_timer;
@@ -698,8 +718,15 @@ namespace vw {
             if(fabs(f_value_last - f_value) < epsilon_em) {
               break;
             }
+            // ... or once the disparity has stopped moving
+            Vector2 disparity_now = affine_comp.affine_transform().reverse(pos) - pos;
+            if(em_iter > 0 && norm_2(disparity_now - disparity_last) < epsilon_em_disparity) {
+              break;
+            }
+            disparity_last = disparity_now;
           } // end em loop
           em_timer.stop();
+          num_em_iterations += std::min(em_iter+1, em_iter_max);
 
           //vw_out() << "EM converged in " << em_iter << " iterations (" << 1000*em_timer.elapsed_seconds() << ")" <<  std::endl;
 
@@ -746,6 +773,13 @@ namespace vw {
         } // end x loop
       } // end y loop
 
+      m_stats->pixels.add(num_pixels);
+      m_stats->iterations.add(num_em_iterations);
+      if(num_pixels > 0) {
+        vw_out(DebugMessage, "stereo") << "EMSubpixelCorrelatorView: " << num_pixels << " pixels took "
+                                       << double(num_em_iterations)/num_pixels << " EM iterations each\n";
+      }
+
 #ifdef USE_GRAPHICS
       if(p_debug) {
         vw_destroy_window(r_window_p1_view);
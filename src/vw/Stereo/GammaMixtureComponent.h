@@ -42,6 +42,7 @@ namespace stereo {
                           Vector2i window_size,
                           PrecisionT k_0, PrecisionT theta_0,
                           PrecisionT pk_min, PrecisionT ptheta_min) : image_r(image.impl()), image_c(window_size(0), window_size(1)),
+      window(0, 0, window_size(0), window_size(1)),
       _k(k_0), k0(k_0),
       _theta(theta_0), theta0(theta_0), k_min(pk_min), theta_min(ptheta_min),
       w(window_size(0), window_size(1)), w_gaussian(window_size(0), window_size(1)), w_local(image.impl().cols(), image.impl().rows()),
@@ -25,6 +25,7 @@ namespace stereo {
     GaussianMixtureComponent(ImageViewBase<ImageT> const& image,
                              Vector2i window_size,
                              PrecisionT mu_0, PrecisionT sigma_0, PrecisionT sigma_min) : image_r(image.impl()), image_c(window_size(0), window_size(1)),
+      window(0, 0, window_size(0), window_size(1)),
       m(mu_0), m0(mu_0), s(sigma_0), s0(sigma_0), s_min(sigma_min), w(window_size(0), window_size(1)), w_local(image.impl().cols(), image.impl().rows()),
       p(window_size(0), window_size(1)) {
       sqrt_2_pi = sqrt(2*M_PI);
@@ -22,18 +22,6 @@ struct DisparityScore {
   }
 };
 
-struct AbsDifferenceFunctor : BinaryReturnTemplateType<DifferenceType> {
-  template <class Arg1T, class Arg2T>
-  typename result<AbsDifferenceFunctor(Arg1T, Arg2T)>::type
-  inline operator()(Arg1T const& arg1, Arg2T const& arg2) const { return fabs(arg1-arg2); }
-};
-
-template <class Image1T, class Image2T>
-inline BinaryPerPixelView<Image1T, Image2T, AbsDifferenceFunctor>
-abs_difference(ImageViewBase<Image1T> const& image1, ImageViewBase<Image2T> const& image2) {
-  return BinaryPerPixelView<Image1T, Image2T, AbsDifferenceFunctor>(image1.impl(), image2.impl(), AbsDifferenceFunctor());
-}
-
 struct SqDifferenceFunctor : BinaryReturnTemplateType<DifferenceType> {
   template <class Arg1T, class Arg2T>
   typename result<SqDifferenceFunctor(Arg1T, Arg2T)>::type
@@ -53,17 +41,57 @@ sq_difference(ImageViewBase<Image1T> const& image1, ImageViewBase<Image2T> const
 //                           COST FUNCTIONS
 // ---------------------------------------------------------------------------
 
-ImageView<float> AbsDifferenceCost::calculate(int32 dx, int32 dy) {
-  typedef ZeroEdgeExtension EdgeT;
-  typedef CropView<EdgeExtensionView<ImageView<float>, EdgeT > > OverCropT;
+// A pixel of image, or zero outside it, as ZeroEdgeExtension has it.
+static inline float zero_extended(ImageView<float> const& image, int32 x, int32 y) {
+  if (x < 0 || y < 0 || x >= image.cols() || y >= image.rows())
+    return 0;
+  return image(x, y);
+}
 
-  BBox2i right_bbox = this->bbox() + Vector2i(dx, dy);
-  OverCropT left_window(edge_extend(m_left, EdgeT()), this->bbox());
-  OverCropT right_window(edge_extend(m_right, EdgeT()), right_bbox);
-  return this->box_filter(abs_difference(left_window, right_window));
+// This is the abs_difference() of the zero-extended windows, as
+// SqDifferenceCost takes below, but filled in a row at a time with
+// the vectorized kernel wherever both rows lie inside their images.
+ImageView<float> AbsDifferenceCost::calculate(int32 dx, int32 dy) {
+  BBox2i const& bbox = this->bbox();
+  const int32 x0 = std::max(std::max(bbox.min().x(), 0), -dx);
+  const int32 x1 = std::min(std::min(bbox.max().x(), m_left.cols()), m_right.cols() - dx);
+
+  for (int32 y = bbox.min().y(); y < bbox.max().y(); y++) {
+    float* diff = &m_diff(0, y - bbox.min().y());
+    int32 x = bbox.min().x();
+    if (x0 < x1 && y >= 0 && y < m_left.rows() && y+dy >= 0 && y+dy < m_right.rows()) {
+      for (; x < x0; x++)
+        diff[x - bbox.min().x()] = fabs(zero_extended(m_left, x, y) - zero_extended(m_right, x+dx, y+dy));
+      detail::abs_diff_row(&m_left(x0, y), &m_right(x0+dx, y+dy), diff + (x0 - bbox.min().x()), x1 - x0);
+      x = x1;
+    }
+    for (; x < bbox.max().x(); x++)
+      diff[x - bbox.min().x()] = fabs(zero_extended(m_left, x, y) - zero_extended(m_right, x+dx, y+dy));
+  }
+  return this->box_filter(m_diff);
 }
 
 
+ImageView<float> CensusCost::calculate(int32 dx, int32 dy) {
+  BBox2i const& bbox = this->bbox();
+  for (int32 y = bbox.min().y(); y < bbox.max().y(); y++) {
+    float* diff = &m_diff(0, y - bbox.min().y());
+    const int32 ry = y + dy;
+    if (y < 0 || y >= m_rows || ry < 0 || ry >= m_rows) {
+      std::fill(diff, diff + bbox.width(), float(m_bits));
+      continue;
+    }
+    uint64 const* left = &m_left_codes[size_t(y) * m_cols];
+    uint64 const* right = &m_right_codes[size_t(ry) * m_cols];
+    for (int32 x = bbox.min().x(); x < bbox.max().x(); x++) {
+      const int32 rx = x + dx;
+      *diff++ = (x < 0 || x >= m_cols || rx < 0 || rx >= m_cols)
+        ? float(m_bits) : float(detail::popcount64(left[x] ^ right[rx]));
+    }
+  }
+  return this->box_filter(m_diff);
+}
+
 ImageView<float> SqDifferenceCost::calculate(int32 dx, int32 dy) {
   typedef ZeroEdgeExtension EdgeT;
   typedef CropView<EdgeExtensionView<ImageView<float>, EdgeT > > OverCropT;
@@ -168,3 +196,99 @@ ImageView<PixelMask<Vector2f> > vw::stereo::correlate(boost::shared_ptr<StereoCo
   return result;
 }
 
+// Each disparity's costs are kept twice as they go by: by left pixel,
+// as correlate() does, and by the right pixel they match, which gives
+// the scores the right to left pass would find for the negated
+// disparity.  A right pixel keeps the last of its tied disparities, as
+// the minimum over the negated window in its order.
+ImageView<PixelMask<Vector2f> > vw::stereo::cross_checked_correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                                                    BBox2i const& search_window,
+                                                                    float cross_corr_threshold,
+                                                                    ProgressCallback const& progress) {
+  if (cross_corr_threshold < 0)
+    vw_throw( vw::ArgumentErr() << "cross_checked_correlate: the crosscorr threshold was less than 0." );
+
+  const int32 width = cost_function->cols();
+  const int32 height = cost_function->rows();
+
+  ImageView<DisparityScore<float> > left_buf(width, height), right_buf(width, height);
+
+  int32 current_iteration = 0;
+  int32 total_iterations = (search_window.width() + 1) * (search_window.height() + 1);
+
+  BBox2i left_bbox = cost_function->bbox();
+  const int32 x_min = left_bbox.min().x();
+  const int32 left_box_width = left_bbox.width();
+
+  // The box filters leave a border of each cost buffer unwritten, or
+  // filtered from unwritten costs, so only the costs inside it are
+  // gathered for the right pixels.
+  const int32 margin_lo = cost_function->sample_size() / 2;
+  const int32 margin_hi = cost_function->sample_size() - margin_lo;
+  const int32 y_lo = margin_lo, y_hi = left_bbox.height() - margin_hi;
+
+  for (int32 dy = search_window.min().y(); dy <= search_window.max().y(); dy++) {
+    for (int32 dx = search_window.min().x(); dx <= search_window.max().x(); dx++) {
+      ImageView<float> cost = cost_function->calculate(dx,dy);
+
+      // The left pixels whose match at this disparity is in the right image.
+      const int32 x0 = std::max(margin_lo, -dx - x_min);
+      const int32 x1 = std::min(left_box_width - margin_hi, width - dx - x_min);
+      for (int32 y = 0; y < left_bbox.height(); y++) {
+        const int32 ly = left_bbox.min().y() + y;
+        float const* c = &cost(0, y);
+        DisparityScore<float>* l = &left_buf(x_min, ly);
+        for (int32 x = 0; x < left_box_width; x++) {
+          if (c[x] < l[x].best) {
+            l[x].best = c[x];
+            l[x].hdisp = dx;
+            l[x].vdisp = dy;
+          }
+          if (c[x] > l[x].worst)
+            l[x].worst = c[x];
+        }
+
+        const int32 ry = ly + dy;
+        if (y < y_lo || y >= y_hi || ry < 0 || ry >= height)
+          continue;
+        DisparityScore<float>* r = &right_buf(0, ry);
+        for (int32 x = x0; x < x1; x++) {
+          DisparityScore<float>& score = r[x_min + x + dx];
+          if (c[x] <= score.best) {
+            score.best = c[x];
+            score.hdisp = dx;
+            score.vdisp = dy;
+          }
+          if (c[x] > score.worst)
+            score.worst = c[x];
+        }
+      }
+
+      progress.report_fractional_progress(++current_iteration, total_iterations);
+      progress.abort_if_requested();
+    }
+  }
+
+  // Keep the left pixels whose match picks them back, as
+  // cross_corr_consistency_check() would.
+  ImageView<PixelMask<Vector2f> > result(width, height);
+  for (int32 y = 0; y < height; y++) {
+    for (int32 x = 0; x < width; x++) {
+      DisparityScore<float> const& l = left_buf(x, y);
+      if (l.best == ScalarTypeLimits<float>::highest() || l.best == l.worst)
+        continue;
+      const int32 rx = x + l.hdisp, ry = y + l.vdisp;
+      if (rx < 0 || ry < 0 || rx >= width || ry >= height)
+        continue;
+      DisparityScore<float> const& r = right_buf(rx, ry);
+      if (r.best == ScalarTypeLimits<float>::highest() || r.best == r.worst ||
+          cross_corr_threshold < fabs(float(l.hdisp - r.hdisp)) ||
+          cross_corr_threshold < fabs(float(l.vdisp - r.vdisp)))
+        continue;
+      result(x, y) = PixelMask<Vector2f>(Vector2f(l.hdisp, l.vdisp));
+    }
+  }
+  progress.report_finished();
+  return result;
+}
+
@@ -15,6 +15,7 @@
 // Boost
 #include <boost/thread/xtime.hpp>
 #include <numeric>
+#include <vector>
 #include <vw/Image.h>
 
 namespace vw {
@@ -123,6 +124,7 @@ namespace stereo {
 
   class AbsDifferenceCost : public StereoCostFunction {
     ImageView<float> m_left, m_right;
+    ImageView<float> m_diff; // The differences calculate() box filters
 
   public:
     template <class ViewT>
@@ -132,7 +134,8 @@ namespace stereo {
                       int32 kern_size) : StereoCostFunction(left.impl().cols(), left.impl().rows(),
                                                                  search_window, kern_size),
                                        m_left(left.impl()),
-                                       m_right(right.impl()) {
+                                       m_right(right.impl()),
+                                       m_diff(this->bbox().width(), this->bbox().height()) {
       VW_ASSERT(m_left.impl().cols() == m_right.impl().cols(), ArgumentErr() << "Left and right images not the same width");
       VW_ASSERT(m_left.impl().rows() == m_right.impl().rows(), ArgumentErr() << "Left and right images not the same height");
     }
@@ -145,6 +148,39 @@ namespace stereo {
   };
 
 
+  // Hamming distances between census_transform() codes, taken over a
+  // census_window_size() window, box filtered.  The codes are packed
+  // once per image and compared with a popcount, and a disparity off
+  // the right image costs as much as every bit differing.
+  class CensusCost : public StereoCostFunction {
+    int32 m_cols, m_rows, m_bits;
+    std::vector<uint64> m_left_codes, m_right_codes;
+    ImageView<float> m_diff; // The distances calculate() box filters
+
+  public:
+    template <class ViewT>
+    CensusCost(ImageViewBase<ViewT> const& left,
+               ImageViewBase<ViewT> const& right,
+               BBox2i const& search_window,
+               int32 kern_size) : StereoCostFunction(left.impl().cols(), left.impl().rows(),
+                                                     search_window, kern_size),
+                                  m_cols(left.impl().cols()), m_rows(left.impl().rows()),
+                                  m_diff(this->bbox().width(), this->bbox().height()) {
+      VW_ASSERT(left.impl().cols() == right.impl().cols(), ArgumentErr() << "Left and right images not the same width");
+      VW_ASSERT(left.impl().rows() == right.impl().rows(), ArgumentErr() << "Left and right images not the same height");
+      int32 census_size = census_window_size(kern_size);
+      m_bits = census_size * census_size - 1;
+      census_transform(ImageView<float>(left.impl()), census_size, m_left_codes);
+      census_transform(ImageView<float>(right.impl()), census_size, m_right_codes);
+    }
+
+    virtual ImageView<float> calculate(int32 dx, int32 dy);
+
+    virtual int32 cols() const { return m_cols; }
+    virtual int32 rows() const { return m_rows; }
+    virtual int32 sample_size() const { return this->kernel_size(); }
+  };
+
   class SqDifferenceCost : public StereoCostFunction {
     ImageView<float> m_left, m_right;
   public:
@@ -226,6 +262,21 @@ namespace stereo {
                                             BBox2i const& search_window,
                                             ProgressCallback const& progress = ProgressCallback::dummy_instance() );
 
+  /// correlate() and cross_corr_consistency_check() against the right
+  /// to left pass in one pass.  Each cost is the same for a pair of
+  /// pixels whichever image is taken first, so the right to left
+  /// scores are gathered from the left to right costs as they are
+  /// computed, without a second cost function or disparity map.
+  /// Unlike the right to left pass, a right pixel only sees the
+  /// matches whose left costs are away from the border the box
+  /// filters leave, so within the kernel and search range of the top
+  /// and left edges fewer disparities may pass, and at the bottom and
+  /// right edges more.
+  ImageView<PixelMask<Vector2f> > cross_checked_correlate(boost::shared_ptr<StereoCostFunction> const& cost_function,
+                                                          BBox2i const& search_window,
+                                                          float cross_corr_threshold,
+                                                          ProgressCallback const& progress = ProgressCallback::dummy_instance() );
+
   class OptimizedCorrelator {
 
     BBox2i m_search_window;
@@ -234,6 +285,7 @@ namespace stereo {
     float m_corrscore_rejection_threshold;
     int32 m_cost_blur;
     stereo::CorrelatorType m_correlator_type;
+    bool m_fused_cross_check;
 
   public:
 
@@ -249,7 +301,14 @@ namespace stereo {
       m_cross_correlation_threshold(cross_correlation_threshold),
       m_corrscore_rejection_threshold(corrscore_rejection_threshold),
       m_cost_blur(cost_blur),
-      m_correlator_type(correlator_type) {}
+      m_correlator_type(correlator_type),
+      m_fused_cross_check(false) {}
+
+    /// Check the disparities against the right to left ones found from
+    /// the same costs, with cross_checked_correlate(), rather than
+    /// correlating the images a second time the other way.
+    void set_fused_cross_check(bool fused) { m_fused_cross_check = fused; }
+    bool fused_cross_check() const { return m_fused_cross_check; }
 
     template <class ViewT, class PreProcFilterT>
     ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
@@ -275,27 +334,42 @@ namespace stereo {
       BBox2i r2l_window(-m_search_window.max().x(), -m_search_window.max().y(),
                         m_search_window.width(), m_search_window.height());
 
+      const bool r2l = !m_fused_cross_check;
       boost::shared_ptr<StereoCostFunction> l2r_cost, r2l_cost;
 
       if (m_correlator_type == ABS_DIFF_CORRELATOR) {
         l2r_cost.reset(new AbsDifferenceCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new AbsDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
+        if (r2l) r2l_cost.reset(new AbsDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
       } else if (m_correlator_type == SQR_DIFF_CORRELATOR) {
         l2r_cost.reset(new SqDifferenceCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new SqDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
+        if (r2l) r2l_cost.reset(new SqDifferenceCost(right_image, left_image, r2l_window, m_kern_size));
       } else if (m_correlator_type == NORM_XCORR_CORRELATOR) {
         l2r_cost.reset(new NormXCorrCost(left_image, right_image, m_search_window, m_kern_size));
-        r2l_cost.reset(new NormXCorrCost(right_image, left_image, r2l_window, m_kern_size));
+        if (r2l) r2l_cost.reset(new NormXCorrCost(right_image, left_image, r2l_window, m_kern_size));
+      } else if (m_correlator_type == CENSUS_CORRELATOR) {
+        l2r_cost.reset(new CensusCost(left_image, right_image, m_search_window, m_kern_size));
+        if (r2l) r2l_cost.reset(new CensusCost(right_image, left_image, r2l_window, m_kern_size));
+      } else if (m_correlator_type == RANK_CORRELATOR) {
+        int32 rank_size = census_window_size(m_kern_size);
+        ImageView<float> left_rank = rank_transform(ImageView<float>(left_image), rank_size);
+        ImageView<float> right_rank = rank_transform(ImageView<float>(right_image), rank_size);
+        l2r_cost.reset(new AbsDifferenceCost(left_rank, right_rank, m_search_window, m_kern_size));
+        if (r2l) r2l_cost.reset(new AbsDifferenceCost(right_rank, left_rank, r2l_window, m_kern_size));
       } else {
         vw_throw(ArgumentErr() << "OptimizedCorrelator: unknown correlator type " << m_correlator_type << ".");
       }
 
       boost::shared_ptr<StereoCostFunction> l2r_cost_and_blur = l2r_cost;
-      boost::shared_ptr<StereoCostFunction> r2l_cost_and_blur = r2l_cost;
-      if (m_cost_blur > 1) {
+      if (m_cost_blur > 1)
         l2r_cost_and_blur.reset(new BlurCost(l2r_cost, m_search_window, m_cost_blur));
+
+      if (m_fused_cross_check)
+        return stereo::cross_checked_correlate(l2r_cost_and_blur, m_search_window,
+                                               m_cross_correlation_threshold);
+
+      boost::shared_ptr<StereoCostFunction> r2l_cost_and_blur = r2l_cost;
+      if (m_cost_blur > 1)
         r2l_cost_and_blur.reset(new BlurCost(r2l_cost, r2l_window, m_cost_blur));
-      }
 
       ImageView<PixelMask<Vector2f> > result_l2r = stereo::correlate(l2r_cost_and_blur, m_search_window);
       ImageView<PixelMask<Vector2f> > result_r2l = stereo::correlate(r2l_cost_and_blur, r2l_window);
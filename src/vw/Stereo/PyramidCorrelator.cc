@@ -32,8 +32,9 @@ PyramidCorrelator::subdivide_bboxes(ImageView<PixelDisp > const& disparity_map,
     disp_range = BBox2f();
   }
 
-  if (disp_range.width()*disp_range.height() <= 4 ||
-      (box.width() < m_min_subregion_dim && box.height() < m_min_subregion_dim)) {
+  if ((disp_range.width()*disp_range.height() <= 4 ||
+       (box.width() < m_min_subregion_dim && box.height() < m_min_subregion_dim)) &&
+      box.width() <= m_max_subregion_dim && box.height() <= m_max_subregion_dim) {
     // The bounding box is small enough.
     result.push_back(box);
     return result;
@@ -54,6 +55,31 @@ PyramidCorrelator::subdivide_bboxes(ImageView<PixelDisp > const& disparity_map,
   }
 }
 
+// Halve the box along its longer side until the pieces are no more
+// than m_max_subregion_dim on a side.
+std::vector<vw::BBox2i>
+PyramidCorrelator::split_bbox(BBox2i const& box) {
+  std::vector<BBox2i> result;
+  if (box.width() <= m_max_subregion_dim && box.height() <= m_max_subregion_dim) {
+    result.push_back(box);
+    return result;
+  }
+
+  BBox2i subbox1 = box, subbox2 = box;
+  if (box.width() > box.height()) {
+    subbox1.max().x() = box.min().x() + box.width()/2;
+    subbox2.min().x() = box.min().x() + box.width()/2;
+  } else {
+    subbox1.max().y() = box.min().y() + box.height()/2;
+    subbox2.min().y() = box.min().y() + box.height()/2;
+  }
+
+  result = split_bbox(subbox1);
+  std::vector<BBox2i> l2 = split_bbox(subbox2);
+  result.insert(result.end(), l2.begin(), l2.end());
+  return result;
+}
+
 void draw_bbox(ImageView<PixelRGB<float> > &view, BBox2i const& bbox) {
   int32 u,v;
   // Top
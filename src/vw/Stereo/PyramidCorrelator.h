@@ -8,6 +8,7 @@
 #ifndef __VW_STEREO_CORRELATOR_H__
 #define __VW_STEREO_CORRELATOR_H__
 
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/MaskViews.h>
@@ -16,6 +17,8 @@
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/OptimizedCorrelator.h>
 
+#include <boost/bind.hpp>
+
 namespace vw {
 namespace stereo {
   class PyramidCorrelator {
@@ -27,7 +30,8 @@ namespace stereo {
     int32 m_cost_blur;
     stereo::CorrelatorType m_correlator_type;
     size_t m_pyramid_levels;
-    int32 m_min_subregion_dim;
+    int32 m_min_subregion_dim, m_max_subregion_dim;
+    bool m_fused_cross_check;
     typedef PixelMask<Vector2f> PixelDisp;
 
     std::string m_debug_prefix;
@@ -72,6 +76,7 @@ namespace stereo {
     subdivide_bboxes(ImageView<PixelDisp> const& disparity_map,
                      ImageView<PixelMask<uint8> > const& valid_pad,
                      BBox2i const& box);
+    std::vector<BBox2i> split_bbox(BBox2i const& box);
 
     template <class ViewT>
     size_t count_valid_pixels(ImageViewBase<ViewT> const& img) {
@@ -123,18 +128,20 @@ namespace stereo {
 
         // 1. Subdivide disparity map into subregions.  We build up
         //    the disparity map for the level, one subregion at a
-        //    time.  For now, subregions that are 512x512 pixels seems
-        //    to be an efficient size.
+        //    time.  Subregions are no bigger than m_max_subregion_dim
+        //    on a side; 512x512 pixels seems to be an efficient size.
         //
         //    We also build a list of search ranges from the previous
-        //    level's disparity map.  If this is the first level of the
-        //    pyramid, we go with the full search range.
+        //    level's disparity map, so that each subregion searches
+        //    only the disparities found around it.  If this is the
+        //    first level of the pyramid, we go with the full search
+        //    range.
         std::vector<BBox2f> search_ranges;
         std::vector<BBox2i> nominal_blocks;
         if (n == (ssize_t(m_pyramid_levels)-1) ) {
-          nominal_blocks.push_back(BBox2i(0,0,left_pyramid[n].cols(),
-                                          left_pyramid[n].rows()));
-          search_ranges.push_back(initial_search_range);
+          nominal_blocks = split_bbox(BBox2i(0,0,left_pyramid[n].cols(),
+                                             left_pyramid[n].rows()));
+          search_ranges.resize(nominal_blocks.size(), initial_search_range);
         } else {
           // valid_pad masks all the pixels already masked by
           // disparity_map, with the addition of a m_kernel_size/2 pad
@@ -151,55 +158,25 @@ namespace stereo {
           search_ranges = compute_search_ranges(disparity_map, nominal_blocks);
         }
 
-        for (size_t r = 0; r < nominal_blocks.size(); ++r) {
-          subbar.report_progress((float)r/nominal_blocks.size());
-
-          // Given a block from the left image, compute the bounding
-          // box of pixels we will be searching in the right image
-          // given the disparity range for the current left image
-          // bbox.
-          //
-          // There's no point in correlating in areas where the second
-          // image has no data, so we adjust the block sizes here to avoid
-          // doing unnecessary work.
-          BBox2i left_block, right_block;
-          BBox2i right_image_workarea =
-            BBox2i(Vector2i(nominal_blocks[r].min().x()+int(floor(search_ranges[r].min().x())),
-                            nominal_blocks[r].min().y()+int(floor(search_ranges[r].min().y()))),
-                   Vector2i(nominal_blocks[r].max().x()+int(ceil(search_ranges[r].max().x())),
-                            nominal_blocks[r].max().y()+int(ceil(search_ranges[r].max().y()))));
-          BBox2i right_image_bounds =
-            BBox2i(0,0, right_pyramid[n].cols(), right_pyramid[n].rows());
-          right_image_workarea.crop(right_image_bounds);
-          if (right_image_workarea.width() == 0 ||
-              right_image_workarea.height() == 0) { continue; }
-          BBox2f adjusted_search_range =
-            compute_matching_blocks(nominal_blocks[r],
-                                    search_ranges[r], left_block, right_block);
-
-          //   2. Run the correlation for this level.  We pass in the
-          //      offset (difference) between the adjusted_search_range
-          //      and original search_ranges[r] so that this can be added
-          //      back in when setting the final disparity.
-          float h_disp_offset =
-            search_ranges[r].min().x() - adjusted_search_range.min().x();
-          float v_disp_offset =
-            search_ranges[r].min().y() - adjusted_search_range.min().y();
-
-          // Place this block in the proper place in the complete
-          // disparity map.
-          ImageViewRef<ChannelT> block1 =
-            crop(edge_extend(left_pyramid[n],ReflectEdgeExtension()),left_block);
-          ImageViewRef<ChannelT> block2 =
-            crop(edge_extend(right_pyramid[n],ReflectEdgeExtension()),right_block);
-          ImageView<PixelDisp> disparity_block =
-            this->correlate( block1, block2, adjusted_search_range,
-                             Vector2f(h_disp_offset, v_disp_offset),
-                             preproc_filter );
-
-          crop(new_disparity_map, nominal_blocks[r]) =
-            crop(disparity_block, m_kernel_size[0], m_kernel_size[1],
-                 nominal_blocks[r].width(), nominal_blocks[r].height());
+        // 2. Correlate the blocks on the thread pool.  Each block
+        //    writes only its own part of new_disparity_map, and holds
+        //    its buffers only while it runs, so no more than one block
+        //    per thread is in memory at a time.
+        {
+          FifoWorkQueue queue(std::max(1, std::min(int(vw_settings().default_num_threads()),
+                                                   int(nominal_blocks.size()))));
+          std::vector<Future<void> > blocks;
+          for (size_t r = 0; r < nominal_blocks.size(); ++r)
+            blocks.push_back(queue.submit(boost::bind(&PyramidCorrelator::correlate_block<ChannelT,PreProcFilterT>,
+                                                      this, boost::cref(left_pyramid[n]),
+                                                      boost::cref(right_pyramid[n]),
+                                                      nominal_blocks[r], search_ranges[r],
+                                                      boost::cref(preproc_filter),
+                                                      boost::ref(new_disparity_map),
+                                                      boost::cref(subbar),
+                                                      1.0/double(nominal_blocks.size()))));
+          queue.join_all();
+          when_all(blocks);
         }
         subbar.report_finished();
 
@@ -253,6 +230,71 @@ namespace stereo {
       return disparity_map;
     }
 
+    // Correlates one nominal block of a pyramid level and writes it
+    // into its place in disparity_map.  This runs on a worker thread,
+    // alongside the other blocks of the level.
+    template <class ChannelT, class PreProcFilterT>
+    void correlate_block(ImageView<ChannelT> const& left_image,
+                         ImageView<ChannelT> const& right_image,
+                         BBox2i const& nominal_block,
+                         BBox2f const& search_range,
+                         PreProcFilterT const& preproc_filter,
+                         ImageView<PixelDisp> & disparity_map,
+                         ProgressCallback const& progress,
+                         double progress_step) {
+
+      // Given a block from the left image, compute the bounding
+      // box of pixels we will be searching in the right image
+      // given the disparity range for the current left image
+      // bbox.
+      //
+      // There's no point in correlating in areas where the second
+      // image has no data, so we adjust the block sizes here to avoid
+      // doing unnecessary work.
+      BBox2i left_block, right_block;
+      BBox2i right_image_workarea =
+        BBox2i(Vector2i(nominal_block.min().x()+int(floor(search_range.min().x())),
+                        nominal_block.min().y()+int(floor(search_range.min().y()))),
+               Vector2i(nominal_block.max().x()+int(ceil(search_range.max().x())),
+                        nominal_block.max().y()+int(ceil(search_range.max().y()))));
+      BBox2i right_image_bounds =
+        BBox2i(0,0, right_image.cols(), right_image.rows());
+      right_image_workarea.crop(right_image_bounds);
+      if (right_image_workarea.width() == 0 ||
+          right_image_workarea.height() == 0) {
+        progress.report_incremental_progress(progress_step);
+        return;
+      }
+      BBox2f adjusted_search_range =
+        compute_matching_blocks(nominal_block,
+                                search_range, left_block, right_block);
+
+      // Run the correlation for this block.  We pass in the
+      // offset (difference) between the adjusted_search_range
+      // and original search_range so that this can be added
+      // back in when setting the final disparity.
+      float h_disp_offset =
+        search_range.min().x() - adjusted_search_range.min().x();
+      float v_disp_offset =
+        search_range.min().y() - adjusted_search_range.min().y();
+
+      // Place this block in the proper place in the complete
+      // disparity map.
+      ImageViewRef<ChannelT> block1 =
+        crop(edge_extend(left_image,ReflectEdgeExtension()),left_block);
+      ImageViewRef<ChannelT> block2 =
+        crop(edge_extend(right_image,ReflectEdgeExtension()),right_block);
+      ImageView<PixelDisp> disparity_block =
+        this->correlate( block1, block2, adjusted_search_range,
+                         Vector2f(h_disp_offset, v_disp_offset),
+                         preproc_filter );
+
+      crop(disparity_map, nominal_block) =
+        crop(disparity_block, m_kernel_size[0], m_kernel_size[1],
+             nominal_block.width(), nominal_block.height());
+      progress.report_incremental_progress(progress_step);
+    }
+
     template <class ViewT, class PreProcFilterT>
     ImageView<PixelDisp > correlate(ImageViewBase<ViewT> const& left_image,
                                     ImageViewBase<ViewT> const& right_image,
@@ -266,6 +308,7 @@ namespace stereo {
                                               m_cross_correlation_threshold,
                                               m_corrscore_rejection_threshold,
                                               m_cost_blur, m_correlator_type);
+      correlator.set_fused_cross_check( m_fused_cross_check );
       return correlator( left_image.impl(),
                          right_image.impl(),
                          preproc_filter ) + PixelDisp(offset);
@@ -293,12 +336,23 @@ namespace stereo {
       m_pyramid_levels(pyramid_levels) {
       m_debug_prefix = "";
       m_min_subregion_dim = 128;
+      m_max_subregion_dim = 512;
+      m_fused_cross_check = false;
     }
 
     /// Turn on debugging output.  The debug_file_prefix string is
     /// used as a prefix for all debug image files.
     void set_debug_mode(std::string const& debug_file_prefix) { m_debug_prefix = debug_file_prefix; }
 
+    /// Limit the size of the subregions each pyramid level is split
+    /// into.  The subregions are correlated in parallel, so this also
+    /// bounds the memory each thread uses.
+    void set_max_subregion_dim(int32 dim) { m_max_subregion_dim = dim; }
+
+    /// Cross check each level with the fused pass of
+    /// OptimizedCorrelator::set_fused_cross_check().
+    void set_fused_cross_check(bool fused) { m_fused_cross_check = fused; }
+
     template <class ViewT, class MaskViewT, class PreProcFilterT>
     ImageView<PixelDisp > operator() (ImageViewBase<ViewT> const& left_image,
                                       ImageViewBase<ViewT> const& right_image,
@@ -55,22 +55,13 @@ public:
   ImageView<PixelMask<Vector2f> > correlate(ImageView<PixelT>& left_image,
                                             ImageView<PixelT>& right_image,
                                             bool swap, bool /*use_bit_image*/) {
-    ImageView<PixelMask<Vector2f> > result(left_image.cols(), left_image.rows());
-
-    for (int i = 0; i < left_image.cols(); i++) {
-      for (int j = 0; j < left_image.rows(); j++) {
-        if (swap) {
-          result(i,j) = compute_disparity(left_image, right_image, i, j,
-                                          m_lKernWidth, m_lKernHeight,
-                                          -m_lMaxH, -m_lMinH, -m_lMaxV, -m_lMinV);
-        } else {
-          result(i,j) = compute_disparity(left_image, right_image, i, j,
-                                          m_lKernWidth, m_lKernHeight,
-                                          m_lMinH, m_lMaxH, m_lMinV, m_lMaxV);
-        }
-      }
-    }
-    return result;
+    if (swap)
+      return compute_disparity(left_image, right_image,
+                               m_lKernWidth, m_lKernHeight,
+                               -m_lMaxH, -m_lMinH, -m_lMaxV, -m_lMinV);
+    return compute_disparity(left_image, right_image,
+                             m_lKernWidth, m_lKernHeight,
+                             m_lMinH, m_lMaxH, m_lMinV, m_lMaxV);
   }
 
   template <class ViewT, class PreProcFilterT>
@@ -0,0 +1,335 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+#include <vw/config.h>
+#include <vw/Core/Log.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/SemiGlobalMatcher.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace vw;
+using namespace stereo;
+
+namespace {
+
+  typedef int16 cost_t;
+
+  // Above any path cost, with room left to add a penalty to it.
+  const cost_t SGM_INF = 0x3FFF;
+
+  // Pixel costs run from 0 to this.
+  const int32 SGM_MAX_COST = 255;
+
+  // The cost of a disparity that leaves the right image: about what a
+  // wrong match costs, so that where the true match has left the image
+  // the paths carry its disparity in rather than settling on a wrong
+  // one inside, and the pixel is then invalidated.
+  const int32 SGM_OUTSIDE_COST = SGM_MAX_COST / 2;
+
+  // Rows each strip shares with its neighbours when the volume is
+  // matched a strip at a time.
+  const int32 SGM_STRIP_OVERLAP = 32;
+
+  // The disparities of a pixel are numbered l = j*nx + i for the
+  // disparity (search.min().x()+i, search.min().y()+j).  A path holds
+  // them in a buffer padded all round with SGM_INF, at (j+1)*stride +
+  // i + 1, so each label's four neighbours can be read without bounds
+  // checks.
+  struct LabelLayout {
+    int32 nx, ny, stride, padded;
+    LabelLayout(int32 nx, int32 ny) : nx(nx), ny(ny), stride(nx+2), padded((nx+2)*(ny+2)) {}
+    int32 labels() const { return nx*ny; }
+  };
+
+  // One row of labels of the path update
+  //   lc = c + min(lp, neighbours of lp + p1, min_p + p2) - min_p
+  // which also adds lc to s.  Returns the least of lc and lmin.
+  inline cost_t aggregate_row(cost_t const* lp, int32 stride, cost_t const* c,
+                              cost_t* lc, cost_t* s, int32 n,
+                              cost_t p1, cost_t cap, cost_t min_p, cost_t lmin) {
+    int32 i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+    if (n >= 8) {
+      const __m128i vp1 = _mm_set1_epi16(p1), vcap = _mm_set1_epi16(cap), vminp = _mm_set1_epi16(min_p);
+      __m128i vmin = _mm_set1_epi16(lmin);
+      for (; i + 8 <= n; i += 8) {
+        __m128i m = _mm_min_epi16(_mm_min_epi16(_mm_loadu_si128((const __m128i*)(lp + i - 1)),
+                                                _mm_loadu_si128((const __m128i*)(lp + i + 1))),
+                                  _mm_min_epi16(_mm_loadu_si128((const __m128i*)(lp + i - stride)),
+                                                _mm_loadu_si128((const __m128i*)(lp + i + stride))));
+        m = _mm_min_epi16(_mm_min_epi16(_mm_adds_epi16(m, vp1),
+                                        _mm_loadu_si128((const __m128i*)(lp + i))), vcap);
+        __m128i v = _mm_add_epi16(_mm_sub_epi16(m, vminp), _mm_loadu_si128((const __m128i*)(c + i)));
+        _mm_storeu_si128((__m128i*)(lc + i), v);
+        _mm_storeu_si128((__m128i*)(s + i), _mm_add_epi16(_mm_loadu_si128((const __m128i*)(s + i)), v));
+        vmin = _mm_min_epi16(vmin, v);
+      }
+      vmin = _mm_min_epi16(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(1,0,3,2)));
+      vmin = _mm_min_epi16(vmin, _mm_shuffle_epi32(vmin, _MM_SHUFFLE(2,3,0,1)));
+      vmin = _mm_min_epi16(vmin, _mm_shufflelo_epi16(vmin, _MM_SHUFFLE(2,3,0,1)));
+      lmin = cost_t(_mm_cvtsi128_si32(vmin));
+    }
+#endif
+    for (; i < n; i++) {
+      cost_t m = cost_t(std::min(std::min(lp[i-1], lp[i+1]), std::min(lp[i-stride], lp[i+stride])) + p1);
+      m = std::min(std::min(m, lp[i]), cap);
+      cost_t v = cost_t(m - min_p + c[i]);
+      lc[i] = v;
+      s[i] = cost_t(s[i] + v);
+      lmin = std::min(lmin, v);
+    }
+    return lmin;
+  }
+
+  // Steps one path on to a pixel whose costs are c, from the path's
+  // previous pixel lp with least cost min_p, or starts the path there
+  // if lp is null.  Returns the least cost of lc.
+  cost_t aggregate_pixel(LabelLayout const& layout, cost_t const* lp, cost_t min_p,
+                         cost_t const* c, cost_t* lc, cost_t* s, cost_t p1, cost_t p2) {
+    cost_t lmin = SGM_INF;
+    for (int32 j = 0; j < layout.ny; j++) {
+      const int32 k = (j+1)*layout.stride + 1, l = j*layout.nx;
+      if (lp) {
+        lmin = aggregate_row(lp + k, layout.stride, c + l, lc + k, s + l, layout.nx,
+                             p1, cost_t(min_p + p2), min_p, lmin);
+      } else {
+        for (int32 i = 0; i < layout.nx; i++) {
+          lc[k+i] = c[l+i];
+          s[l+i] = cost_t(s[l+i] + c[l+i]);
+          lmin = std::min(lmin, c[l+i]);
+        }
+      }
+    }
+    return lmin;
+  }
+
+  // Adds to s the four paths that reach each pixel from the pixel
+  // before it and from the three above it, scanning the rows top down,
+  // or with forward false the four from the other side, scanning them
+  // bottom up.  Only the previous row of each path is kept.
+  void aggregate_pass(std::vector<cost_t> const& c, std::vector<cost_t>& s,
+                      int32 cols, int32 rows, LabelLayout const& layout,
+                      cost_t p1, cost_t p2, bool forward) {
+    const size_t D = layout.labels(), PD = layout.padded;
+    const int32 step = forward ? 1 : -1;
+
+    // Three paths from the row before, previous and current rows.
+    std::vector<cost_t> row_paths(2 * 3 * cols * PD, SGM_INF);
+    std::vector<cost_t> row_mins(2 * 3 * cols, 0);
+    std::vector<cost_t> pixel_paths(2 * PD, SGM_INF);
+    cost_t *prev = &row_paths[0], *cur = &row_paths[3 * cols * PD];
+    cost_t *prev_min = &row_mins[0], *cur_min = &row_mins[3 * cols];
+    cost_t *prev_pixel = &pixel_paths[0], *cur_pixel = &pixel_paths[PD];
+    cost_t prev_pixel_min = 0;
+
+    for (int32 n = 0; n < rows; n++) {
+      const int32 y = forward ? n : rows - 1 - n;
+      for (int32 m = 0; m < cols; m++) {
+        const int32 x = forward ? m : cols - 1 - m;
+        cost_t const* cp = &c[(size_t(y)*cols + x) * D];
+        cost_t* sp = &s[(size_t(y)*cols + x) * D];
+
+        prev_pixel_min = aggregate_pixel(layout, m > 0 ? prev_pixel : 0, prev_pixel_min,
+                                         cp, cur_pixel, sp, p1, p2);
+        std::swap(prev_pixel, cur_pixel);
+
+        // Diagonal from behind, straight down and diagonal from ahead.
+        for (int32 r = 0; r < 3; r++) {
+          const int32 px = x + (r - 1) * step;
+          const bool from = n > 0 && px >= 0 && px < cols;
+          cur_min[r*cols + x] =
+            aggregate_pixel(layout, from ? prev + (size_t(r)*cols + px) * PD : 0,
+                            from ? prev_min[r*cols + px] : cost_t(0),
+                            cp, cur + (size_t(r)*cols + x) * PD, sp, p1, p2);
+        }
+      }
+      std::swap(prev, cur);
+      std::swap(prev_min, cur_min);
+    }
+  }
+
+  // Least of the n costs at s, and the first label it is at.
+  inline int32 best_label(cost_t const* s, int32 n) {
+    int32 best = 0;
+    for (int32 l = 1; l < n; l++)
+      if (s[l] < s[best])
+        best = l;
+    return best;
+  }
+
+  // The offset from the middle of three costs to the vertex of the
+  // parabola through them, or zero if it does not open upwards.
+  inline float32 parabola_offset(int32 a, int32 b, int32 c) {
+    const int32 den = a + c - 2*b;
+    if (den <= 0)
+      return 0;
+    return float32(a - c) / float32(2 * den);
+  }
+
+} // namespace
+
+SemiGlobalMatcher::SemiGlobalMatcher(BBox2i const& search_window, CostType cost_type,
+                                     int32 census_size, float cross_corr_threshold,
+                                     int32 penalty1, int32 penalty2, size_t max_volume_bytes)
+  : m_search_window(search_window), m_cost_type(cost_type),
+    m_census_size(census_size), m_cross_corr_threshold(cross_corr_threshold),
+    m_penalty1(penalty1), m_penalty2(std::max(penalty1, penalty2)),
+    m_max_volume_bytes(max_volume_bytes) {
+  VW_ASSERT( search_window.width() >= 0 && search_window.height() >= 0,
+             ArgumentErr() << "SemiGlobalMatcher: invalid search window " << search_window << "." );
+  VW_ASSERT( census_size >= 3 && census_size <= 7 && census_size % 2 == 1,
+             ArgumentErr() << "SemiGlobalMatcher: the census window must be 3, 5 or 7 pixels." );
+  VW_ASSERT( penalty1 >= 0 && m_penalty2 <= 2*SGM_MAX_COST,
+             ArgumentErr() << "SemiGlobalMatcher: penalties out of range." );
+}
+
+ImageView<PixelMask<Vector2f> >
+SemiGlobalMatcher::match(ImageView<float32> const& left_image,
+                         ImageView<float32> const& right_image) const {
+  VW_ASSERT( left_image.cols() == right_image.cols() && left_image.rows() == right_image.rows(),
+             ArgumentErr() << "SemiGlobalMatcher: primary and secondary image dimensions do not agree!" );
+
+  const int32 cols = left_image.cols(), rows = left_image.rows();
+  const int32 dx0 = m_search_window.min().x(), dy0 = m_search_window.min().y();
+  const LabelLayout layout(m_search_window.width() + 1, m_search_window.height() + 1);
+  const int32 D = layout.labels();
+  const cost_t p1 = cost_t(m_penalty1), p2 = cost_t(m_penalty2);
+
+  ImageView<PixelMask<Vector2f> > result(cols, rows);
+  if (cols == 0 || rows == 0)
+    return result;
+
+  // The pixel costs, as a table of census Hamming distances or a
+  // scale for the differences.
+  std::vector<uint64> left_census, right_census;
+  std::vector<cost_t> hamming_cost;
+  float32 diff_scale = 0;
+  if (m_cost_type == CENSUS_COST) {
+    census_transform(left_image, m_census_size, left_census);
+    census_transform(right_image, m_census_size, right_census);
+    const int32 bits = m_census_size * m_census_size - 1;
+    for (int32 b = 0; b <= bits; b++)
+      hamming_cost.push_back(cost_t((b * SGM_MAX_COST + bits/2) / bits));
+  } else {
+    float32 lo = left_image(0,0), hi = left_image(0,0);
+    for (int32 y = 0; y < rows; y++)
+      for (int32 x = 0; x < cols; x++) {
+        lo = std::min(lo, std::min(left_image(x,y), right_image(x,y)));
+        hi = std::max(hi, std::max(left_image(x,y), right_image(x,y)));
+      }
+    if (hi > lo)
+      diff_scale = SGM_MAX_COST / (hi - lo);
+  }
+
+  // Match a strip of rows at a time if the volume is too big.
+  const size_t row_bytes = 2 * sizeof(cost_t) * size_t(cols) * D;
+  int32 strip_rows = rows;
+  if (row_bytes * rows > m_max_volume_bytes) {
+    strip_rows = std::max(int32(m_max_volume_bytes / row_bytes), 2*SGM_STRIP_OVERLAP + 16);
+    if (strip_rows >= rows)
+      strip_rows = rows;
+    else
+      vw_out(DebugMessage, "stereo") << "SemiGlobalMatcher: matching " << cols << "x" << rows
+                                     << " pixels in strips of " << strip_rows << " rows.\n";
+  }
+  const int32 strip_step = strip_rows == rows ? rows : strip_rows - 2*SGM_STRIP_OVERLAP;
+
+  std::vector<cost_t> c, s;
+  std::vector<int32> right_best;
+  for (int32 i0 = 0; i0 < rows; i0 += strip_step) {
+    const int32 i1 = std::min(rows, i0 + strip_step);
+    const int32 r0 = std::max(0, i0 - SGM_STRIP_OVERLAP * (strip_rows < rows));
+    const int32 r1 = std::min(rows, i1 + SGM_STRIP_OVERLAP * (strip_rows < rows));
+    const int32 n = r1 - r0;
+
+    // Pixel costs for every row of the strip.
+    c.resize(size_t(n) * cols * D);
+    for (int32 y = r0; y < r1; y++) {
+      for (int32 x = 0; x < cols; x++) {
+        cost_t* cp = &c[(size_t(y - r0)*cols + x) * D];
+        for (int32 j = 0; j < layout.ny; j++) {
+          const int32 qy = y + dy0 + j;
+          for (int32 i = 0; i < layout.nx; i++) {
+            const int32 qx = x + dx0 + i;
+            cost_t& cost = cp[j*layout.nx + i];
+            if (qx < 0 || qy < 0 || qx >= cols || qy >= rows)
+              cost = SGM_OUTSIDE_COST;
+            else if (m_cost_type == CENSUS_COST)
+              cost = hamming_cost[detail::popcount64(left_census[size_t(y)*cols + x] ^
+                                           right_census[size_t(qy)*cols + qx])];
+            else
+              cost = cost_t(std::min(float32(SGM_MAX_COST),
+                                     std::fabs(left_image(x,y) - right_image(qx,qy)) * diff_scale + 0.5f));
+          }
+        }
+      }
+    }
+
+    s.assign(c.size(), 0);
+    aggregate_pass(c, s, cols, n, layout, p1, p2, true);
+    aggregate_pass(c, s, cols, n, layout, p1, p2, false);
+
+    // The best label of each pixel of the right image, over the
+    // left pixels of the strip that land on it.
+    const bool check = m_cross_corr_threshold >= 0;
+    if (check) {
+      right_best.assign(size_t(n) * cols, -1);
+      std::vector<cost_t> right_cost(size_t(n) * cols, SGM_INF);
+      for (int32 y = r0; y < r1; y++)
+        for (int32 x = 0; x < cols; x++) {
+          cost_t const* sp = &s[(size_t(y - r0)*cols + x) * D];
+          for (int32 l = 0; l < D; l++) {
+            const int32 qx = x + dx0 + l % layout.nx, qy = y + dy0 + l / layout.nx;
+            if (qx < 0 || qy < r0 || qx >= cols || qy >= r1)
+              continue;
+            const size_t q = size_t(qy - r0)*cols + qx;
+            // On a tie the later pixel, with the lower label, wins,
+            // as best_label() also breaks ties to the lower label.
+            if (sp[l] <= right_cost[q]) {
+              right_cost[q] = sp[l];
+              right_best[q] = l;
+            }
+          }
+        }
+    }
+
+    for (int32 y = i0; y < i1; y++) {
+      for (int32 x = 0; x < cols; x++) {
+        cost_t const* sp = &s[(size_t(y - r0)*cols + x) * D];
+        const int32 l = best_label(sp, D);
+        const int32 i = l % layout.nx, j = l / layout.nx;
+        const int32 qx = x + dx0 + i, qy = y + dy0 + j;
+        PixelMask<Vector2f>& out = result(x, y);
+        if (qx < 0 || qy < 0 || qx >= cols || qy >= rows)
+          continue;
+        if (check) {
+          if (qy < r0 || qy >= r1)
+            continue;
+          const int32 rl = right_best[size_t(qy - r0)*cols + qx];
+          if (rl < 0 ||
+              std::abs(rl % layout.nx - i) > m_cross_corr_threshold ||
+              std::abs(rl / layout.nx - j) > m_cross_corr_threshold)
+            continue;
+        }
+        float32 fx = float32(dx0 + i), fy = float32(dy0 + j);
+        if (i > 0 && i + 1 < layout.nx)
+          fx += parabola_offset(sp[l-1], sp[l], sp[l+1]);
+        if (j > 0 && j + 1 < layout.ny)
+          fy += parabola_offset(sp[l-layout.nx], sp[l], sp[l+layout.nx]);
+        out = PixelMask<Vector2f>(Vector2f(fx, fy));
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,107 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file SemiGlobalMatcher.h
+///
+/// Semi-global matching (Hirschmuller, "Stereo Processing by
+/// Semiglobal Matching and Mutual Information", PAMI 30(2), 2008).
+///
+/// Rather than summing a matching cost over a window, as the other
+/// correlators do, each pixel's cost for each disparity is smoothed
+/// along eight straight paths through the image.  Along a path, a
+/// step to a neighbouring disparity costs penalty1 and a larger jump
+/// costs penalty2, so disparities stay smooth across untextured
+/// areas yet can jump at depth edges.  Each pixel takes the
+/// disparity with the least total over all the paths.  The result
+/// is usually denser and sharper at edges than window correlation,
+/// without the subpixel refinement.
+///
+/// The pixel costs are either a census transform, compared by the
+/// Hamming distance, or the absolute difference of the images scaled
+/// to [0,255].  Costs are kept in 16 bits and the paths are
+/// aggregated eight disparities at a time with SSE2 where it is
+/// enabled.  The search window may be two dimensional: each pixel
+/// then has a cost for every (dx,dy) in it, and the two are
+/// neighbours if they differ by one in either direction.  The cost
+/// volume takes 4 bytes per pixel and disparity, so a large window
+/// suits rectified images with a small vertical range best.  Images
+/// whose volume is over max_volume_bytes are matched in horizontal
+/// strips that overlap, so the vertical paths are cut short at the
+/// ends of each strip.
+///
+#ifndef __VW_STEREO_SEMIGLOBALMATCHER_H__
+#define __VW_STEREO_SEMIGLOBALMATCHER_H__
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelMath.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+
+namespace vw {
+namespace stereo {
+
+  class SemiGlobalMatcher {
+  public:
+    enum CostType { CENSUS_COST = 0, ABS_DIFF_COST = 1 };
+
+  private:
+    BBox2i m_search_window;
+    CostType m_cost_type;
+    int32 m_census_size;
+    float m_cross_corr_threshold;
+    int32 m_penalty1, m_penalty2;
+    size_t m_max_volume_bytes;
+
+  public:
+    /// The search window holds the disparities (inclusive) from the
+    /// left image to the right, as for OptimizedCorrelator.  The
+    /// census window is census_size pixels square, odd and from 3 to
+    /// 7.  Pixels whose disparities from left to right and back again
+    /// differ by more than cross_corr_threshold are invalidated; a
+    /// negative threshold skips the check.  The penalties are in the
+    /// units of the costs, which run from 0 to 255, and penalty2 is
+    /// raised to penalty1 if it is smaller.
+    SemiGlobalMatcher(BBox2i const& search_window,
+                      CostType cost_type = CENSUS_COST,
+                      int32 census_size = 5,
+                      float cross_corr_threshold = 1.0,
+                      int32 penalty1 = 10,
+                      int32 penalty2 = 120,
+                      size_t max_volume_bytes = size_t(512)*1024*1024 );
+
+    template <class ViewT, class PreProcFilterT>
+    ImageView<PixelMask<Vector2f> > operator()(ImageViewBase<ViewT> const& image0,
+                                               ImageViewBase<ViewT> const& image1,
+                                               PreProcFilterT const& preproc_filter) const {
+
+      // Check to make sure that image0 and image1 have equal dimensions
+      if ((image0.impl().cols() != image1.impl().cols()) ||
+          (image0.impl().rows() != image1.impl().rows())) {
+        vw_throw( ArgumentErr() << "Primary and secondary image dimensions do not agree!" );
+      }
+
+      // Check to make sure that the images are single channel/single plane
+      if (!(image0.channels() == 1 && image0.impl().planes() == 1 &&
+            image1.channels() == 1 && image1.impl().planes() == 1)) {
+        vw_throw( ArgumentErr() << "Both images must be single channel/single plane images!" );
+      }
+
+      ImageView<float32> left_image = channel_cast<float32>(preproc_filter(image0));
+      ImageView<float32> right_image = channel_cast<float32>(preproc_filter(image1));
+      return match(left_image, right_image);
+    }
+
+    /// Matches left_image to right_image, which must be the same size.
+    ImageView<PixelMask<Vector2f> > match(ImageView<float32> const& left_image,
+                                          ImageView<float32> const& right_image) const;
+  };
+
+}}   // namespace vw::stereo
+
+#endif // __VW_STEREO_SEMIGLOBALMATCHER_H__
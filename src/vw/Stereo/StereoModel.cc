@@ -5,10 +5,17 @@
 // __END_LICENSE__
 
 
+#include <vw/config.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Math/LevenbergMarquardt.h>
 
+#include <cmath>
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace vw {
 namespace stereo {
   namespace detail {
@@ -31,6 +38,111 @@ namespace stereo {
         return output;
       }
     };
+
+    // The lanes that a batch is triangulated on: one double, or two
+    // in an SSE2 register.  A mask is nonzero in the lanes where it
+    // holds.
+    struct Lane1 {
+      double v;
+      Lane1() {}
+      explicit Lane1( double x ) : v(x) {}
+      static Lane1 load( Vector3 const* p, size_t k ) { return Lane1(p[0][k]); }
+      void store( Vector3* p, size_t k ) const { p[0][k] = v; }
+      void store( double* p ) const { p[0] = v; }
+    };
+    inline Lane1 operator+( Lane1 a, Lane1 b ) { return Lane1(a.v + b.v); }
+    inline Lane1 operator-( Lane1 a, Lane1 b ) { return Lane1(a.v - b.v); }
+    inline Lane1 operator*( Lane1 a, Lane1 b ) { return Lane1(a.v * b.v); }
+    inline Lane1 operator/( Lane1 a, Lane1 b ) { return Lane1(a.v / b.v); }
+    inline Lane1 lane_sqrt( Lane1 a ) { return Lane1(std::sqrt(a.v)); }
+    inline Lane1 lane_less( Lane1 a, Lane1 b ) { return Lane1(a.v < b.v ? 1.0 : 0.0); }
+    inline Lane1 lane_or( Lane1 a, Lane1 b ) { return Lane1(a.v != 0 || b.v != 0 ? 1.0 : 0.0); }
+    inline Lane1 lane_select( Lane1 mask, Lane1 a, Lane1 b ) { return mask.v != 0 ? a : b; }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+    struct Lane2 {
+      __m128d v;
+      Lane2() {}
+      Lane2( __m128d x ) : v(x) {}
+      explicit Lane2( double x ) : v(_mm_set1_pd(x)) {}
+      static Lane2 load( Vector3 const* p, size_t k ) { return _mm_set_pd(p[1][k], p[0][k]); }
+      void store( Vector3* p, size_t k ) const { _mm_storel_pd(&p[0][k], v); _mm_storeh_pd(&p[1][k], v); }
+      void store( double* p ) const { _mm_storeu_pd(p, v); }
+    };
+    inline Lane2 operator+( Lane2 a, Lane2 b ) { return _mm_add_pd(a.v, b.v); }
+    inline Lane2 operator-( Lane2 a, Lane2 b ) { return _mm_sub_pd(a.v, b.v); }
+    inline Lane2 operator*( Lane2 a, Lane2 b ) { return _mm_mul_pd(a.v, b.v); }
+    inline Lane2 operator/( Lane2 a, Lane2 b ) { return _mm_div_pd(a.v, b.v); }
+    inline Lane2 lane_sqrt( Lane2 a ) { return _mm_sqrt_pd(a.v); }
+    inline Lane2 lane_less( Lane2 a, Lane2 b ) { return _mm_cmplt_pd(a.v, b.v); }
+    inline Lane2 lane_or( Lane2 a, Lane2 b ) { return _mm_or_pd(a.v, b.v); }
+    inline Lane2 lane_select( Lane2 mask, Lane2 a, Lane2 b ) {
+      return _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v));
+    }
+#endif
+
+    template <class T>
+    inline T lane_dot( T const* a, T const* b ) { return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+
+    template <class T>
+    inline void lane_cross( T const* a, T const* b, T* c ) {
+      c[0] = a[1]*b[2] - a[2]*b[1];
+      c[1] = a[2]*b[0] - a[0]*b[2];
+      c[2] = a[0]*b[1] - a[1]*b[0];
+    }
+
+    // Triangulates as many rays as T has lanes, in the same steps as
+    // StereoModel::operator() and triangulate_point() take for one,
+    // with branches turned into masks.  Parallel rays give a zero
+    // point and error, and points behind a camera are reflected if
+    // reflect is set.
+    template <class T>
+    inline void triangulate_lanes( Vector3 const* originA, Vector3 const* vecA,
+                                   Vector3 const* originB, Vector3 const* vecB,
+                                   T const& threshold, bool reflect,
+                                   Vector3* points, double* errors ) {
+      T oA[3], a[3], oB[3], b[3];
+      for ( size_t k = 0; k < 3; k++ ) {
+        oA[k] = T::load(originA, k);  a[k] = T::load(vecA, k);
+        oB[k] = T::load(originB, k);  b[k] = T::load(vecB, k);
+      }
+      T parallel = lane_less( T(1.0) - lane_dot(a, b), threshold );
+
+      T v12[3], v1[3], v2[3], dBA[3], dAB[3];
+      lane_cross(a, b, v12);
+      lane_cross(v12, a, v1);
+      lane_cross(v12, b, v2);
+      for ( size_t k = 0; k < 3; k++ ) {
+        dBA[k] = oB[k] - oA[k];
+        dAB[k] = oA[k] - oB[k];
+      }
+      T tA = lane_dot(v2, dBA) / lane_dot(v2, a);
+      T tB = lane_dot(v1, dAB) / lane_dot(v1, b);
+
+      T p[3], e[3];
+      for ( size_t k = 0; k < 3; k++ ) {
+        T cA = oA[k] + tA*a[k], cB = oB[k] + tB*b[k];
+        e[k] = cA - cB;
+        p[k] = T(0.5) * (cA + cB);
+      }
+      T error = lane_sqrt( lane_dot(e, e) );
+
+      if ( reflect ) {
+        T pA[3], pB[3];
+        for ( size_t k = 0; k < 3; k++ ) {
+          pA[k] = p[k] - oA[k];
+          pB[k] = p[k] - oB[k];
+        }
+        T behind = lane_or( lane_less( lane_dot(pA, a), T(0.0) ),
+                            lane_less( lane_dot(pB, b), T(0.0) ) );
+        for ( size_t k = 0; k < 3; k++ )
+          p[k] = lane_select( behind, T(2.0)*oA[k] - p[k], p[k] );
+      }
+
+      for ( size_t k = 0; k < 3; k++ )
+        lane_select( parallel, T(0.0), p[k] ).store(points, k);
+      lane_select( parallel, T(0.0), error ).store(errors);
+    }
   }
 
 ImageView<Vector3> StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
@@ -46,35 +158,47 @@ ImageView<Vector3> StereoModel::operator()(ImageView<PixelMask<Vector2f> > const
   ImageView<Vector3> xyz(disparity_map.cols(), disparity_map.rows());
   error.set_size(disparity_map.cols(), disparity_map.rows());
 
-  // Compute 3D position for each pixel in the disparity map
+  // Compute 3D position for each pixel in the disparity map, a row
+  // of pixels at a time.
   vw_out() << "StereoModel: Applying camera models\n";
+  std::vector<Vector2> pix1, pix2;
+  std::vector<Vector3> points;
+  std::vector<double> errors;
+  std::vector<int32> columns;
   for (int32 y = 0; y < disparity_map.rows(); y++) {
     if (y % 100 == 0) {
       printf("\tStereoModel computing points: %0.2f%% complete.\r", 100.0f*float(y)/disparity_map.rows());
       fflush(stdout);
     }
+    pix1.clear();
+    pix2.clear();
+    columns.clear();
     for (int32 x = 0; x < disparity_map.cols(); x++) {
+      xyz(x,y) = Vector3();
+      error(x,y) = 0;
       if ( is_valid(disparity_map(x,y)) ) {
-        xyz(x,y) = (*this)(Vector2( x, y),
-                           Vector2( x+disparity_map(x,y)[0], y+disparity_map(x,y)[1]),
-                           error(x,y) );
-
-        if (error(x,y) >= 0) {
-          // Keep track of error statistics
-          if (error(x,y) > max_error)
-            max_error = error(x,y);
-          mean_error += error(x,y);
-            ++point_count;
-        } else {
-          // rays diverge or are parallel
-          xyz(x,y) = Vector3();
-          divergent++;
-        }
-      } else {
-        xyz(x,y) = Vector3();
-        error(x,y) = 0;
+        pix1.push_back( Vector2( x, y) );
+        pix2.push_back( Vector2( x+disparity_map(x,y)[0], y+disparity_map(x,y)[1]) );
+        columns.push_back( x );
       }
+    }
+    (*this)(pix1, pix2, points, errors);
+
+    for (size_t i = 0; i < columns.size(); i++) {
+      int32 x = columns[i];
+      if (errors[i] >= 0) {
+        xyz(x,y) = points[i];
+        error(x,y) = errors[i];
+        // Keep track of error statistics
+        if (errors[i] > max_error)
+          max_error = errors[i];
+        mean_error += errors[i];
+        ++point_count;
+      } else {
+        // rays diverge or are parallel
+        divergent++;
       }
+    }
   }
 
   if (divergent != 0)
@@ -137,6 +261,58 @@ Vector3 StereoModel::operator()(Vector2 const& pix1,
   }
 }
 
+void StereoModel::operator()(std::vector<Vector2> const& pix1,
+                             std::vector<Vector2> const& pix2,
+                             std::vector<Vector3>& points,
+                             std::vector<double>& errors ) const {
+  VW_ASSERT( pix1.size() == pix2.size(),
+             ArgumentErr() << "StereoModel: there must be as many pixels in each image." );
+  size_t n = pix1.size();
+  points.resize(n);
+  errors.resize(n);
+  if (n == 0)
+    return;
+
+  std::vector<Vector3> originA, vecFromA, originB, vecFromB;
+  try {
+    m_camera1->pixels_to_rays(pix1, originA, vecFromA);
+    m_camera2->pixels_to_rays(pix2, originB, vecFromB);
+  } catch (const camera::PixelToRayErr& /*e*/) {
+    // Some pixel has no ray.  Going a pixel at a time loses just those.
+    for (size_t i = 0; i < n; i++)
+      points[i] = (*this)(pix1[i], pix2[i], errors[i]);
+    return;
+  }
+
+  // The same thresholds on nearly parallel rays as above.
+  double threshold = m_least_squares ? 1e-5 : 1e-4;
+  size_t i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1) && defined(__SSE2__)
+  for ( ; i + 2 <= n; i += 2 )
+    detail::triangulate_lanes( &originA[i], &vecFromA[i], &originB[i], &vecFromB[i],
+                               detail::Lane2(threshold), !m_least_squares,
+                               &points[i], &errors[i] );
+#endif
+  for ( ; i < n; i++ )
+    detail::triangulate_lanes( &originA[i], &vecFromA[i], &originB[i], &vecFromB[i],
+                               detail::Lane1(threshold), !m_least_squares,
+                               &points[i], &errors[i] );
+
+  // The refinement needs the cameras, so it goes a point at a time,
+  // and points are reflected only after it.
+  if ( m_least_squares ) {
+    for ( i = 0; i < n; i++ ) {
+      if ( 1-dot_prod(vecFromA[i], vecFromB[i]) < threshold )
+        continue;
+      refine_point(pix1[i], pix2[i], points[i]);
+      if ( dot_prod(points[i] - originA[i], vecFromA[i]) < 0 ||
+           dot_prod(points[i] - originB[i], vecFromB[i]) < 0 ) {
+        points[i] = -points[i] + 2*originA[i];
+      }
+    }
+  }
+}
+
 double StereoModel::convergence_angle(Vector2 const& pix1, Vector2 const& pix2) const {
   return acos(dot_prod(m_camera1->pixel_to_vector(pix1),
                        m_camera2->pixel_to_vector(pix2)));
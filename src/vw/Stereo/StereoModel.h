@@ -10,6 +10,8 @@
 
 #include <vw/Stereo/DisparityMap.h>
 
+#include <vector>
+
 namespace vw {
 
 // forward declaration
@@ -54,6 +56,17 @@ namespace stereo {
     /// intersection.
     Vector3 operator()(Vector2 const& pix1, Vector2 const& pix2, double& error ) const;
 
+    /// Apply a stereo model to a batch of pairs of image coordinates,
+    /// e.g. the valid pixels of a tile of a disparity map, setting
+    /// points[i] and errors[i] as the method above does for pix1[i]
+    /// and pix2[i].  Each camera finds the rays of all its pixels in
+    /// one call to pixels_to_rays(), and the rays are intersected two
+    /// at a time with SSE2 where it is enabled.
+    void operator()(std::vector<Vector2> const& pix1,
+                    std::vector<Vector2> const& pix2,
+                    std::vector<Vector3>& points,
+                    std::vector<double>& errors ) const;
+
     /// Returns the dot product of the two rays emanating from camera
     /// 1 and camera 2 through pix1 and pix2 respectively.  This can
     /// effectively be interpreted as the angle (in radians) between
@@ -8,10 +8,13 @@
 #ifndef __VW_STEREO_STEREOVIEW_H__
 #define __VW_STEREO_STEREOVIEW_H__
 
+#include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Camera/CameraModel.h>
 #include <limits>
+#include <vector>
 
 namespace vw {
 
@@ -34,26 +37,30 @@ namespace stereo {
       static const bool value = (1 != CompoundNumChannels<typename UnmaskedPixelType<PixelT>::type>::value);
     };
 
+    // The offset from a pixel in the left image to its match in the
+    // right.
     template <class T>
-    inline typename boost::enable_if<IsScalar<T>,Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity, index[1] ), error );
+    static inline typename boost::enable_if<IsScalar<T>,Vector2>::type
+    DisparityOffset( T const& disparity ) {
+      return Vector2( disparity, 0 );
     }
 
     template <class T>
-    inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value == 1),Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity, index[1] ), error );
+    static inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value == 1),Vector2>::type
+    DisparityOffset( T const& disparity ) {
+      return Vector2( disparity, 0 );
     }
 
     template <class T>
-    inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value != 1),Vector3>::type
-    StereoModelHelper( StereoModel const& model, Vector2 const& index,
-                       T const& disparity, double& error ) const {
-      return model( index, Vector2( index[0] + disparity[0],
-                                    index[1] + disparity[1] ), error );
+    static inline typename boost::enable_if_c<IsCompound<T>::value && (CompoundNumChannels<typename UnmaskedPixelType<T>::type>::value != 1),Vector2>::type
+    DisparityOffset( T const& disparity ) {
+      return Vector2( disparity[0], disparity[1] );
+    }
+
+    template <class T>
+    inline Vector3 StereoModelHelper( StereoModel const& model, Vector2 const& index,
+                                      T const& disparity, double& error ) const {
+      return model( index, index + DisparityOffset( disparity ), error );
     }
 
   public:
@@ -107,8 +114,34 @@ namespace stereo {
     DisparityImageT const& disparity_map() const { return m_disparity_map; }
 
     /// \cond INTERNAL
-    typedef StereoView<typename DisparityImageT::prerasterize_type> prerasterize_type;
-    inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_disparity_map.prerasterize(bbox), m_stereo_model ); }
+    // A block is triangulated a row at a time, so that each camera
+    // finds the rays of a whole row at once.
+    typedef CropView<ImageView<Vector3> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<dpixel_type> disparity = crop( m_disparity_map, bbox );
+      // For missing pixels in the disparity map, we return a null 3D position.
+      ImageView<Vector3> xyz( bbox.width(), bbox.height() );
+      std::vector<Vector2> pix1, pix2;
+      std::vector<Vector3> points;
+      std::vector<double> errors;
+      std::vector<int32> columns;
+      for ( int32 j = 0; j < disparity.rows(); j++ ) {
+        pix1.clear();
+        pix2.clear();
+        columns.clear();
+        for ( int32 i = 0; i < disparity.cols(); i++ )
+          if ( is_valid(disparity(i,j)) ) {
+            Vector2 pix( bbox.min().x() + i, bbox.min().y() + j );
+            pix1.push_back( pix );
+            pix2.push_back( pix + DisparityOffset( disparity(i,j) ) );
+            columns.push_back( i );
+          }
+        m_stereo_model( pix1, pix2, points, errors );
+        for ( size_t k = 0; k < columns.size(); k++ )
+          xyz( columns[k], j ) = points[k];
+      }
+      return crop( xyz, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
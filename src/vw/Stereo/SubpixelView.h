@@ -10,6 +10,7 @@
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/BlockProcessor.h>
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/Correlate.h>
 #include <vw/Image/Filter.h>
@@ -31,6 +32,7 @@ namespace stereo {
     int32 m_which_subpixel;
     PreprocFilterT m_preproc_filter;
     bool m_verbose;
+    Vector2i m_block_size;
 
   public:
     typedef PixelMask<Vector2f> pixel_type;
@@ -54,7 +56,8 @@ namespace stereo {
                                  m_do_v_subpixel(do_vertical_subpixel),
                                  m_which_subpixel(which_subpixel),
                                  m_preproc_filter(preproc_filter),
-                                 m_verbose(verbose) {
+                                 m_verbose(verbose),
+                                 m_block_size(default_block_size()) {
       // Basic assertions
       VW_ASSERT((left_image.impl().cols() == right_image.impl().cols()) &&
                 (left_image.impl().rows() == right_image.impl().rows()) &&
@@ -67,6 +70,19 @@ namespace stereo {
                 ArgumentErr() << "SubpixelView::SubpixelView(): multi-channel, multi-plane images not supported.\n");
     }
 
+    /// Regions larger than this are refined in blocks of this size,
+    /// several at once, as block_rasterize() would.  Each block is
+    /// refined from its own patches of the images, which reach past
+    /// it by the kernel size and disparity range, so blocks much
+    /// smaller than the default waste work on their margins.
+    static Vector2i default_block_size() { return Vector2i(256,256); }
+    void set_block_size(Vector2i const& size) {
+      VW_ASSERT( size.x() > 0 && size.y() > 0,
+                 ArgumentErr() << "SubpixelView::set_block_size(): the block size must be positive.\n" );
+      m_block_size = size;
+    }
+    Vector2i block_size() const { return m_block_size; }
+
     // Standard ImageView interface methods
     inline int32 cols() const { return m_left_image.cols(); }
     inline int32 rows() const { return m_left_image.rows(); }
@@ -83,6 +99,45 @@ namespace stereo {
     /// \cond INTERNAL
     typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize(BBox2i bbox) const {
+      if ( fits_in_block(bbox) )
+        return refine_block(bbox);
+      ImageView<pixel_type> buf(bbox.width(), bbox.height());
+      rasterize(buf, bbox);
+      return crop(buf, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i bbox) const {
+      if ( fits_in_block(bbox) )
+        vw::rasterize(refine_block(bbox), dest, bbox);
+      else {
+        BlockProcessor<RefineFunctor<DestT> > process( RefineFunctor<DestT>(*this, dest, bbox.min()),
+                                                       m_block_size );
+        process(bbox);
+      }
+    }
+    /// \endcond
+
+  private:
+    // Refines one block into its part of dest, whose origin is at
+    // offset in the view.
+    template <class DestT>
+    class RefineFunctor {
+      SubpixelView const& m_view;
+      DestT const& m_dest;
+      Vector2i m_offset;
+    public:
+      RefineFunctor(SubpixelView const& view, DestT const& dest, Vector2i const& offset)
+        : m_view(view), m_dest(dest), m_offset(offset) {}
+      void operator()(BBox2i const& bbox) const {
+        vw::rasterize(m_view.refine_block(bbox), crop(m_dest, bbox - m_offset), bbox);
+      }
+    };
+
+    bool fits_in_block(BBox2i const& bbox) const {
+      return bbox.width() <= m_block_size.x() && bbox.height() <= m_block_size.y();
+    }
+
+    prerasterize_type refine_block(BBox2i bbox) const {
 
       // Find the range of disparity values for this patch.
       BBox2i search_range = get_disparity_range(crop(m_disparity_map, bbox));
@@ -133,6 +188,8 @@ namespace stereo {
                                       left_image_patch,
                                       right_image_patch,
                                       m_kernel_size[0], m_kernel_size[1],
+                                      BBox2i(m_kernel_size[0],m_kernel_size[1],
+                                             bbox.width(), bbox.height()),
                                       m_do_h_subpixel, m_do_v_subpixel,
                                       m_verbose);
         break;
@@ -215,11 +272,6 @@ namespace stereo {
                                               m_left_image.cols(),
                                               m_left_image.rows() ));
     }
-
-    template <class DestT> inline void rasterize(DestT const& dest, BBox2i bbox) const {
-      vw::rasterize(prerasterize(bbox), dest, bbox);
-    }
-    /// \endcond
   };
 
   template <class PreprocFilterT, class ImageT, class DisparityT>
@@ -7,6 +7,7 @@
 
 // TestCorrelator.h
 #include <gtest/gtest.h>
+#include <test/Helpers.h>
 
 #include <vw/Image/UtilityViews.h>
 #include <vw/Stereo/CorrelatorView.h>
@@ -85,6 +86,87 @@ TEST_F( BasicCorrelationTest, NullPreprocess ) {
     correlate( image1, image2, mask, FilterT(),
                stereo::NORM_XCORR_CORRELATOR );
   check_error( disparity_map, 0.95 );
+
+  disparity_map =
+    correlate( image1, image2, mask, FilterT(),
+               stereo::CENSUS_CORRELATOR );
+  check_error( disparity_map, 0.92 );
+
+  disparity_map =
+    correlate( image1, image2, mask, FilterT(),
+               stereo::RANK_CORRELATOR );
+  check_error( disparity_map, 0.9 );
+}
+
+TEST_F( BasicCorrelationTest, CensusGainAndBias ) {
+  typedef NullStereoPreprocessingFilter FilterT;
+
+  // Census and rank only see the order of the pixel values.
+  ImageView<uint8> image3 = 20 + image2 / 2;
+  ImageView<PixelMask<Vector2f> > disparity_map =
+    correlate( image1, image3, mask, FilterT(),
+               stereo::CENSUS_CORRELATOR );
+  check_error( disparity_map, 0.92 );
+
+  disparity_map =
+    correlate( image1, image3, mask, FilterT(),
+               stereo::RANK_CORRELATOR );
+  check_error( disparity_map, 0.9 );
+}
+
+TEST_F( BasicCorrelationTest, FusedCrossCheck ) {
+  stereo::CorrelatorType types[] = { stereo::ABS_DIFF_CORRELATOR, stereo::SQR_DIFF_CORRELATOR,
+                                     stereo::NORM_XCORR_CORRELATOR, stereo::CENSUS_CORRELATOR,
+                                     stereo::RANK_CORRELATOR };
+  for ( int32 t = 0; t < 5; t++ ) {
+    for ( int32 blur = 1; blur <= 3; blur += 2 ) {
+      OptimizedCorrelator correlator( BBox2i(0,0,6,6), 7, 1, 1.0, blur, types[t] );
+      ImageView<PixelMask<Vector2f> > two_pass =
+        correlator( image1, image2, NullStereoPreprocessingFilter() );
+      correlator.set_fused_cross_check( true );
+      ImageView<PixelMask<Vector2f> > fused =
+        correlator( image1, image2, NullStereoPreprocessingFilter() );
+      ASSERT_EQ( two_pass.cols(), fused.cols() );
+      ASSERT_EQ( two_pass.rows(), fused.rows() );
+
+      // Away from the edges, where the costs of the two passes are
+      // filtered from the same pixels, the matches are the same.
+      const int32 margin = 7 + blur + 6;
+      int32 count = 0, count_same = 0;
+      for ( int32 j = margin; j < fused.rows() - margin; j++ )
+        for ( int32 i = margin; i < fused.cols() - margin; i++ ) {
+          count++;
+          if ( is_valid(fused(i,j)) == is_valid(two_pass(i,j)) &&
+               ( !is_valid(fused(i,j)) || fused(i,j).child() == two_pass(i,j).child() ) )
+            count_same++;
+        }
+      EXPECT_EQ( count, count_same ) << "type " << types[t] << " blur " << blur;
+      check_error( fused, 0.9 );
+    }
+  }
+
+  CorrelatorView<uint8,PixelMask<uint8>,NullStereoPreprocessingFilter> corr =
+    correlate( image1, image2, mask, NullStereoPreprocessingFilter() );
+  corr.set_fused_cross_check( true );
+  ImageView<PixelMask<Vector2f> > disparity_map = corr;
+  check_error( disparity_map, 0.95 );
+}
+
+TEST( Correlate, CensusTransform ) {
+  ImageView<float> image(3,3);
+  image(0,0) = 1; image(1,0) = 9; image(2,0) = 2;
+  image(0,1) = 8; image(1,1) = 5; image(2,1) = 3;
+  image(0,2) = 7; image(1,2) = 4; image(2,2) = 6;
+
+  std::vector<uint64> codes;
+  census_transform( image, 3, codes );
+  ASSERT_EQ( 9u, codes.size() );
+  // Around the centre, in row order: 1 9 2 / 8 3 / 7 4 6.
+  EXPECT_EQ( uint64(0xAA), codes[4] );
+
+  ImageView<float> ranks = rank_transform( image, 3 );
+  EXPECT_EQ( 4, ranks(1,1) );
+  EXPECT_EQ( 0, ranks(0,0) );
 }
 
 TEST_F( BasicCorrelationTest, SlogPreprocess ) {
@@ -143,3 +225,116 @@ TEST_F( BasicCorrelationTest, BlurPreprocess ) {
                stereo::NORM_XCORR_CORRELATOR );
   check_error( disparity_map, 0.79 );
 }
+
+// The fraction of valid disparities within half a pixel of (3,3),
+// as semi-global matching finds them to a subpixel.  Pixels within
+// margin of the edges, where the census windows of the two images are
+// clamped differently, are not counted.
+template <class ViewT>
+float fraction_near_shift( ImageViewBase<ViewT> const& input, int margin = 6 ) {
+  ViewT const& disparity_map = input.impl();
+  int count_correct = 0;
+  int count_valid = 0;
+  int count = 0;
+  for (int j = margin; j < disparity_map.rows() - margin; ++j)
+    for (int i = margin; i < disparity_map.cols() - margin; ++i) {
+      count++;
+      if ( is_valid( disparity_map(i,j) ) ) {
+        count_valid++;
+        if ( norm_2( disparity_map(i,j).child() - Vector2f(3,3) ) < 0.5 )
+          count_correct++;
+      }
+    }
+  EXPECT_GT( count_valid, count*9/10 );
+  return float(count_correct)/float(count_valid);
+}
+
+TEST_F( BasicCorrelationTest, SemiGlobalMatching ) {
+  typedef NullStereoPreprocessingFilter FilterT;
+
+  CorrelatorView<uint8,PixelMask<uint8>,FilterT> corr =
+    correlate( image1, image2, mask, FilterT() );
+  corr.set_semi_global_matching( true );
+  ImageView<PixelMask<Vector2f> > disparity_map = corr;
+  EXPECT_GT( fraction_near_shift( disparity_map ), 0.95 );
+
+  corr.set_semi_global_matching( true, SemiGlobalMatcher::ABS_DIFF_COST );
+  disparity_map = corr;
+  EXPECT_GT( fraction_near_shift( disparity_map ), 0.95 );
+}
+
+TEST( SemiGlobalMatcher, Strips ) {
+  boost::rand48 gen(7);
+  ImageView<float> left = 255*uniform_noise_view( gen, 40, 200 );
+  ImageView<float> right = transform(left, TranslateTransform(3,3),
+                                     ZeroEdgeExtension(), NearestPixelInterpolation());
+  // Room for 90 rows of the 40x49 volume, so three strips.
+  SemiGlobalMatcher matcher( BBox2i(0,0,6,6), SemiGlobalMatcher::CENSUS_COST,
+                             5, 1.0, 10, 120, 90*40*49*4 );
+  ImageView<PixelMask<Vector2f> > disparity_map = matcher.match( left, right );
+  ASSERT_EQ( left.cols(), disparity_map.cols() );
+  ASSERT_EQ( left.rows(), disparity_map.rows() );
+  EXPECT_GT( fraction_near_shift( disparity_map ), 0.95 );
+}
+
+TEST( PyramidCorrelator, Subregions ) {
+  boost::rand48 gen(3);
+  ImageView<uint8> left = 255*uniform_noise_view( gen, 300, 200 );
+  ImageView<uint8> right = transform(left, TranslateTransform(11,5),
+                                     ZeroEdgeExtension(), NearestPixelInterpolation());
+  ImageView<PixelMask<uint8> > mask(300,200);
+  fill(mask, PixelMask<uint8>(255));
+
+  PyramidCorrelator correlator( BBox2f(0,0,24,12), Vector2i(9,9), 1, 1.0, 1,
+                                ABS_DIFF_CORRELATOR, 3 );
+  // Small enough that each level is correlated in several pieces.
+  correlator.set_max_subregion_dim( 64 );
+  ImageView<PixelMask<Vector2f> > disparity_map =
+    correlator( left, right, mask, mask, NullStereoPreprocessingFilter() );
+  ASSERT_EQ( left.cols(), disparity_map.cols() );
+  ASSERT_EQ( left.rows(), disparity_map.rows() );
+
+  int count_correct = 0, count_valid = 0;
+  for (int j = 20; j < disparity_map.rows() - 20; ++j)
+    for (int i = 20; i < disparity_map.cols() - 20; ++i)
+      if ( is_valid( disparity_map(i,j) ) ) {
+        count_valid++;
+        if ( norm_2( disparity_map(i,j).child() - Vector2f(11,5) ) < 0.5 )
+          count_correct++;
+      }
+  EXPECT_GT( count_valid, (260*160)*9/10 );
+  EXPECT_GT( float(count_correct)/float(count_valid), 0.95 );
+}
+
+template <class ChannelT>
+void check_sliding_disparity( ImageView<ChannelT> left, ImageView<ChannelT> right,
+                              int32 kern_width, int32 kern_height ) {
+  ImageView<PixelMask<Vector2f> > result =
+    compute_disparity( left, right, kern_width, kern_height, -2, 3, -1, 2 );
+  ASSERT_EQ( left.cols(), result.cols() );
+  ASSERT_EQ( left.rows(), result.rows() );
+  for (int j = 0; j < left.rows(); ++j)
+    for (int i = 0; i < left.cols(); ++i) {
+      PixelMask<Vector2f> expected =
+        compute_disparity( left, right, i, j, kern_width, kern_height, -2, 3, -1, 2 );
+      ASSERT_EQ( is_valid(expected), is_valid(result(i,j)) ) << i << "," << j;
+      if ( is_valid(expected) )
+        EXPECT_VECTOR_EQ( expected.child(), result(i,j).child() ) << i << "," << j;
+    }
+}
+
+TEST( Correlate, SlidingSumDisparity ) {
+  boost::rand48 gen(5);
+  ImageView<uint8> left = 255*uniform_noise_view( gen, 37, 29 );
+  ImageView<uint8> right = transform(left, TranslateTransform(2,1),
+                                     ZeroEdgeExtension(), NearestPixelInterpolation());
+  check_sliding_disparity( left, right, 5, 5 );
+  check_sliding_disparity( left, right, 4, 7 );
+  // Big enough for the 16-bit sums to wrap, as compute_soad()'s do.
+  check_sliding_disparity( left, right, 21, 17 );
+
+  ImageView<float> leftf = channel_cast<float>(left) / 255.0;
+  ImageView<float> rightf = channel_cast<float>(right) / 255.0;
+  check_sliding_disparity( leftf, rightf, 5, 5 );
+  check_sliding_disparity( leftf, rightf, 4, 7 );
+}
@@ -15,6 +15,9 @@
 #include <vw/Image/Transform.h>
 #include <test/Helpers.h>
 
+#include <limits>
+#include <boost/random/linear_congruential.hpp>
+
 using namespace vw;
 using namespace vw::stereo;
 
@@ -206,3 +209,140 @@ TEST( DisparityMap, GetDisparityRange ) {
   EXPECT_VECTOR_EQ( Vector2f(), range.min() );
   EXPECT_VECTOR_EQ( Vector2f(), range.max() );
 }
+
+TEST( DisparityMap, CompactDisparity ) {
+  typedef PixelCompactDisparity<> Compact;
+  typedef PixelCompactDisparity<1> Compact1D;
+  EXPECT_EQ( 4u, sizeof(Compact) );
+  EXPECT_EQ( 2u, sizeof(Compact1D) );
+
+  EXPECT_FALSE( is_valid(Compact()) );
+  EXPECT_FALSE( is_valid(Compact(PixelDisp())) );
+
+  // Disparities on the fixed point grid survive the round trip
+  // exactly, and others are rounded to it.
+  ImageView<PixelDisp> disparity(5,3);
+  for ( int32 j = 0; j < 3; j++ )
+    for ( int32 i = 0; i < 5; i++ )
+      disparity(i,j) = PixelDisp(Vector2f(i*31.25-60, j-1.5));
+  disparity(2,1).invalidate();
+  ImageView<Compact> compact = compact_disparities(disparity);
+  ImageView<PixelDisp> expanded = expand_disparities(compact);
+  for ( int32 j = 0; j < 3; j++ )
+    for ( int32 i = 0; i < 5; i++ ) {
+      EXPECT_EQ( is_valid(disparity(i,j)), is_valid(expanded(i,j)) );
+      if ( is_valid(disparity(i,j)) ) {
+        EXPECT_VECTOR_EQ( disparity(i,j).child(), expanded(i,j).child() );
+        EXPECT_EQ( disparity(i,j)[0], compact(i,j)[0] );
+        EXPECT_EQ( disparity(i,j)[1], compact(i,j)[1] );
+      }
+      EXPECT_EQ( compact(i,j), Compact(expanded(i,j)) );
+    }
+
+  EXPECT_EQ( 1.3125, Compact(1.3,0)[0] );
+  EXPECT_EQ( -16, Compact(-1,0.5).raw(0) );
+  EXPECT_EQ( 8, Compact(-1,0.5).raw(1) );
+  EXPECT_TRUE( is_valid(Compact(2047.9,-2047.9)) );
+  EXPECT_FALSE( is_valid(Compact(2048.5,0)) );
+  EXPECT_FALSE( is_valid(Compact(0,-2048.5)) );
+  EXPECT_FALSE( is_valid(Compact(std::numeric_limits<float>::quiet_NaN(),0)) );
+
+  // The one dimensional pixel has no vertical disparity.
+  Compact1D rectified( PixelDisp(Vector2f(-3.5,2)) );
+  EXPECT_TRUE( is_valid(rectified) );
+  EXPECT_VECTOR_EQ( Vector2f(-3.5,0), remove_mask(rectified) );
+}
+
+TEST( DisparityMap, CompactDisparityViews ) {
+  typedef PixelCompactDisparity<> Compact;
+
+  // A smooth disparity map with a few outliers and holes.
+  ImageView<PixelDisp> disparity(20,20);
+  for ( int32 j = 0; j < 20; j++ )
+    for ( int32 i = 0; i < 20; i++ )
+      disparity(i,j) = PixelDisp(Vector2f(2 + (i/4)*0.25, -1 + (j/5)*0.5));
+  disparity(5,5) = PixelDisp(Vector2f(40,3));
+  disparity(12,3) = PixelDisp(Vector2f(-30,0));
+  disparity(7,14).invalidate();
+  disparity(8,14).invalidate();
+  ImageView<Compact> compact = compact_disparities(disparity);
+
+  BBox2f range = get_disparity_range(compact);
+  EXPECT_VECTOR_EQ( Vector2f(-30,-1), range.min() );
+  EXPECT_VECTOR_EQ( Vector2f(40,3), range.max() );
+
+  ImageView<PixelDisp> filtered = remove_outliers(disparity, 2, 2, 1.0, 0.5);
+  ImageView<Compact> compact_filtered = remove_outliers(compact, 2, 2, 1.0, 0.5);
+  EXPECT_FALSE( is_valid(compact_filtered(5,5)) );
+  EXPECT_FALSE( is_valid(compact_filtered(12,3)) );
+
+  ImageView<uint8> mask1(20,20), mask2(40,40);
+  fill(mask1, 255); fill(mask2, 255);
+  mask1(3,4) = 0;
+  mask2(3,0) = 0;  // Where (1,1) lands
+  ImageView<PixelDisp> masked = disparity_mask(disparity, mask1, mask2);
+  ImageView<Compact> compact_masked = disparity_mask(compact, mask1, mask2);
+  EXPECT_FALSE( is_valid(compact_masked(3,4)) );
+  EXPECT_FALSE( is_valid(compact_masked(1,1)) );
+
+  for ( int32 j = 0; j < 20; j++ )
+    for ( int32 i = 0; i < 20; i++ ) {
+      EXPECT_EQ( Compact(filtered(i,j)), compact_filtered(i,j) );
+      EXPECT_EQ( Compact(masked(i,j)), compact_masked(i,j) );
+    }
+}
+
+TEST( DisparityMap, RemoveOutliers ) {
+  // Planes at a few depths, with scattered outliers and holes.
+  boost::rand48 gen(42);
+  ImageView<PixelDisp> disparity(60,45);
+  for ( int32 j = 0; j < disparity.rows(); j++ )
+    for ( int32 i = 0; i < disparity.cols(); i++ ) {
+      float dx = i < 25 ? 3 + 0.05*i : -7 + 0.02*j;
+      float dy = j < 20 ? 0.5 : -0.25*(i/10);
+      int32 r = gen() % 100;
+      if ( r < 8 )
+        dx += float(gen() % 200)/10 - 10;
+      disparity(i,j) = PixelDisp(Vector2f(dx,dy));
+      if ( r >= 90 )
+        disparity(i,j).invalidate();
+    }
+
+  int32 kernels[3][2] = { {1,1}, {2,3}, {5,4} };
+  for ( int32 k = 0; k < 3; k++ ) {
+    int32 hh = kernels[k][0], hv = kernels[k][1];
+    ImageView<PixelDisp> expected =
+      per_pixel_accessor_filter( edge_extend(disparity, ZeroEdgeExtension()),
+                                 RemoveOutliersFunc<PixelDisp>(hh, hv, 1.0, 0.5) );
+
+    // Rasterize in uneven blocks, as the block processors would.
+    RemoveOutliersView<ImageView<PixelDisp> > outliers =
+      remove_outliers(disparity, hh, hv, 1.0, 0.5);
+    ImageView<PixelDisp> result(disparity.cols(), disparity.rows());
+    for ( int32 j = 0; j < result.rows(); j += 11 )
+      for ( int32 i = 0; i < result.cols(); i += 13 ) {
+        BBox2i block(i, j, 13, 11);
+        block.crop( bounding_box(result) );
+        crop(result, block) = crop(outliers, block);
+      }
+
+    int32 rejected = 0;
+    for ( int32 j = 0; j < result.rows(); j++ )
+      for ( int32 i = 0; i < result.cols(); i++ ) {
+        ASSERT_EQ( is_valid(expected(i,j)), is_valid(result(i,j)) ) << i << "," << j;
+        if ( is_valid(disparity(i,j)) && !is_valid(result(i,j)) )
+          rejected++;
+      }
+    EXPECT_GT( rejected, 0 );
+    EXPECT_EQ( rejected, outliers.rejected_points() );
+    EXPECT_EQ( disparity.cols()*disparity.rows(), outliers.total_points() );
+  }
+
+  // Single pixel access agrees with rasterizing.
+  RemoveOutliersView<ImageView<PixelDisp> > outliers =
+    remove_outliers(disparity, 2, 2, 1.0, 0.5);
+  ImageView<PixelDisp> result = outliers;
+  for ( int32 j = 0; j < result.rows(); j += 7 )
+    for ( int32 i = 0; i < result.cols(); i += 5 )
+      EXPECT_EQ( is_valid(result(i,j)), is_valid(outliers(i,j)) );
+}
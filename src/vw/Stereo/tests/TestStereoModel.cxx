@@ -11,6 +11,7 @@
 
 #include <vw/Stereo/StereoModel.h>
 #include <vw/Stereo/StereoView.h>
+#include <vw/Stereo/CompactDisparity.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/Math/EulerAngles.h>
@@ -96,6 +97,72 @@ TEST( StereoModel, AdjustedStereo ) {
   }
 }
 
+TEST( StereoModel, Batch ) {
+  camera::PinholeModel pin1( Vector3(), math::identity_matrix<3>(),
+                             500, 500, 250, 250 );
+  camera::PinholeModel pin2( Vector3(1,0.1,0),
+                             euler_to_rotation_matrix(0.01,-0.1,0.02,"xyz"),
+                             510, 490, 240, 260 );
+  boost::shared_ptr<CameraModel> pin2_ptr( new camera::PinholeModel(pin2) );
+  AdjustedCameraModel adj2( pin2_ptr );
+  adj2.set_translation( Vector3(0.01,0,0) );
+
+  std::vector<Vector2> pix1, pix2;
+  for ( int32 i = 0; i < 41; i++ ) {
+    Vector3 point( -2 + 0.1*i, 1 - 0.05*i, 5 + 0.13*i );
+    pix1.push_back( pin1.point_to_pixel(point) );
+    pix2.push_back( pin2.point_to_pixel(point) + Vector2(0.3*(i%3),-0.2*(i%2)) );
+  }
+  // Rays that are parallel, and ones that meet behind the cameras.
+  pix1.push_back( Vector2(250,250) );
+  pix2.push_back( Vector2(250,250) );
+  pix1.push_back( Vector2(200,250) );
+  pix2.push_back( pix1.back() + Vector2(200,0) );
+
+  const CameraModel* right[2] = { &pin2, &adj2 };
+  for ( int32 c = 0; c < 2; c++ ) {
+    for ( int32 lsq = 0; lsq < 2; lsq++ ) {
+      StereoModel st( &pin1, right[c], lsq == 1 );
+      std::vector<Vector3> points;
+      std::vector<double> errors;
+      st( pix1, pix2, points, errors );
+      ASSERT_EQ( pix1.size(), points.size() );
+      ASSERT_EQ( pix1.size(), errors.size() );
+      for ( size_t i = 0; i < pix1.size(); i++ ) {
+        double error;
+        Vector3 point = st( pix1[i], pix2[i], error );
+        EXPECT_VECTOR_NEAR( point, points[i], 1e-8 );
+        EXPECT_NEAR( error, errors[i], 1e-8 );
+      }
+    }
+  }
+}
+
+TEST( StereoView, Blocks ) {
+  camera::PinholeModel pin1( Vector3(), math::identity_matrix<3>(),
+                             50, 50, 20, 10 );
+  camera::PinholeModel pin2( Vector3(1,0,0), math::identity_matrix<3>(),
+                             50, 50, 20, 10 );
+
+  ImageView<PixelMask<Vector2f> > disparity(37,23);
+  for ( int32 j = 0; j < disparity.rows(); j++ )
+    for ( int32 i = 0; i < disparity.cols(); i++ )
+      if ( (i*7 + j*3) % 5 != 0 )
+        disparity(i,j) = PixelMask<Vector2f>( Vector2f(-10 - 0.1f*i, 0.05f*(j%4)) );
+
+  StereoView<ImageView<PixelMask<Vector2f> > > view( disparity, &pin1, &pin2 );
+  ImageView<Vector3> pc = view;
+  ImageView<Vector3> part = crop( view, BBox2i(5,3,20,11) );
+  for ( int32 j = 0; j < disparity.rows(); j++ )
+    for ( int32 i = 0; i < disparity.cols(); i++ ) {
+      EXPECT_VECTOR_NEAR( view(i,j), pc(i,j), 1e-10 );
+      if ( !is_valid(disparity(i,j)) )
+        EXPECT_VECTOR_DOUBLE_EQ( pc(i,j), Vector3() );
+      if ( i >= 5 && i < 25 && j >= 3 && j < 14 )
+        EXPECT_VECTOR_NEAR( view(i,j), part(i-5,j-3), 1e-10 );
+    }
+}
+
 TEST( StereoView, PixelMaskVec2 ) {
   Vector3 pos1, pos2;
   pos2 = Vector3(1,0,0);
@@ -215,3 +282,30 @@ TEST( StereoView, Float ) {
   EXPECT_VECTOR_NEAR( lpc(2,0), Vector3(0.769,0,0.769), 1e-2 );
 
 }
+
+TEST( StereoView, CompactDisparity ) {
+  camera::PinholeModel pin1( Vector3(),
+                             math::identity_matrix<3>(),
+                             1, 1, 1, 0);
+
+  camera::PinholeModel pin2( Vector3(1,0,0),
+                             math::identity_matrix<3>(),
+                             1, 1, 1, 0);
+
+  ImageView<PixelCompactDisparity<> > disparity(3,1);
+  disparity(1,0) = PixelCompactDisparity<>( -1, 0 );
+  disparity(2,0) = PixelCompactDisparity<>( -1.25, 0 );
+
+  ImageView<Vector3> pc = stereo_triangulate( disparity, &pin1, &pin2 );
+  EXPECT_VECTOR_DOUBLE_EQ( pc(0,0), Vector3() );
+  EXPECT_VECTOR_NEAR( pc(1,0), Vector3(0,0,1), 1e-2 );
+  EXPECT_VECTOR_NEAR( pc(2,0), Vector3(0.8,0,0.8), 1e-2 );
+
+  ImageView<PixelCompactDisparity<1> > rectified(3,1);
+  rectified(1,0) = PixelCompactDisparity<1>( -1 );
+  rectified(2,0) = PixelCompactDisparity<1>( -1.25 );
+  pc = stereo_triangulate( rectified, &pin1, &pin2 );
+  EXPECT_VECTOR_DOUBLE_EQ( pc(0,0), Vector3() );
+  EXPECT_VECTOR_NEAR( pc(1,0), Vector3(0,0,1), 1e-2 );
+  EXPECT_VECTOR_NEAR( pc(2,0), Vector3(0.8,0,0.8), 1e-2 );
+}
@@ -11,6 +11,7 @@
 #include <vw/Image/UtilityViews.h>
 #include <vw/Stereo/CorrelatorView.h>
 #include <vw/Stereo/SubpixelView.h>
+#include <vw/Stereo/EMSubpixelCorrelatorView.h>
 #include <vw/Image/Transform.h>
 #include <vw/Image.h>  // write_image
 #include <vw/FileIO.h>
@@ -149,6 +150,38 @@ TEST_F( SubPixelCorrelate95Test, BayesEM95 ) {
   EXPECT_LE(invalid_count, 12);
 }
 
+TEST_F( SubPixelCorrelate95Test, EMSubpixelCorrelatorView ) {
+  EMSubpixelCorrelatorView<float> corr( channel_cast_rescale<float>(image1),
+                                        channel_cast_rescale<float>(image2),
+                                        starting_disp );
+  corr.set_kernel_size( Vector2i(11,11) );
+  corr.set_pyramid_levels( 2 );
+
+  // Rasterize in four tiles, which share the pyramid.
+  ImageView<PixelMask<Vector<float,5> > > result(corr.cols(), corr.rows());
+  for ( int32 j = 0; j < corr.rows(); j += 50 )
+    for ( int32 i = 0; i < corr.cols(); i += 50 ) {
+      BBox2i tile(i, j, 50, 50);
+      crop(result, tile) = crop(corr, tile);
+    }
+
+  double error = 0;
+  int32 count = 0;
+  for ( int32 j = 10; j < corr.rows()-10; j++ )
+    for ( int32 i = 10; i < corr.cols()-10; i++ )
+      if ( is_valid(result(i,j)) ) {
+        float expected = stretch * float(i) + translation - i;
+        error += fabs(result(i,j)[0] - expected) + fabs(result(i,j)[1]);
+        count++;
+      }
+  EXPECT_GT( count, 80*80*8/10 );
+  EXPECT_LT( error/count, 0.1 );
+
+  EXPECT_GE( corr.em_pixels(), uint64(100*100) );
+  EXPECT_GE( corr.em_iterations_per_pixel(), 1.0 );
+  EXPECT_LE( corr.em_iterations_per_pixel(), 20.0 );
+}
+
 TEST_F( SubPixelCorrelate90Test, BayesEM90 ) {
   ImageView<PixelMask<Vector2f> > disparity_map =
     subpixel_refine( starting_disp,
@@ -196,3 +229,83 @@ TEST_F( SubPixelCorrelate70Test, BayesEM70 ) {
   EXPECT_LT(error, 0.9);
   EXPECT_LE(invalid_count, 48);
 }
+
+// The costs of the parabola fit are found for runs of pixels at a
+// time; for integer images they must match compute_soad() exactly.
+TEST( SubpixelCorrelation, ParabolaRuns ) {
+  boost::rand48 gen(4);
+  ImageView<uint8> left = channel_cast_rescale<uint8>(uniform_noise_view( gen, 60, 40 ));
+  ImageView<uint8> right = channel_cast_rescale<uint8>(uniform_noise_view( gen, 60, 40 ));
+  ImageView<PixelMask<Vector2f> > disparity(60, 40);
+  for ( int32 j = 0; j < 40; j++ )
+    for ( int32 i = 0; i < 60; i++ ) {
+      // Runs of several lengths, reaching off the images at the edges.
+      disparity(i,j) = PixelMask<Vector2f>( Vector2f( (i/7) % 3 - 1 + (i > 50 ? 4 : 0), j % 11 == 3 ? 1 : 0 ) );
+      if ( (i*7 + j*3) % 23 == 0 )
+        invalidate( disparity(i,j) );
+    }
+
+  for ( int32 axes = 1; axes <= 3; axes++ ) {
+    bool horizontal = axes & 1, vertical = axes & 2;
+    ImageView<PixelMask<Vector2f> > result = copy(disparity);
+    subpixel_correlation_parabola( result, left, right, 5, 3, horizontal, vertical );
+
+    uint8* l = &left(0,0);
+    uint8* r = &right(0,0);
+    for ( int32 j = 0; j < 40; j++ )
+      for ( int32 i = 0; i < 60; i++ ) {
+        PixelMask<Vector2f> expected = disparity(i,j);
+        if ( is_valid(expected) ) {
+          int32 h = int32(expected[0]), v = int32(expected[1]);
+          uint16 points[9];
+          for ( int32 dx = -1; dx <= 1; dx++ )
+            for ( int32 dy = -1; dy <= 1; dy++ )
+              points[3*(dx+1)+dy+1] = compute_soad( l, r, j, i, h+dx, v+dy, 5, 3, 60, 40 );
+          if ( horizontal && vertical ) {
+            Vector2f offset = vw::stereo::detail::find_minimum_2d( points );
+            if ( norm_2(offset) < 5.0 )
+              remove_mask(expected) += offset;
+          } else {
+            uint16 lt = horizontal ? points[1] : points[3];
+            uint16 rt = horizontal ? points[7] : points[5];
+            uint16 mid = points[4];
+            if ( (mid <= lt && mid < rt) || (mid <= rt && mid < lt) )
+              expected[horizontal ? 0 : 1] += vw::stereo::detail::find_minimum( lt, mid, rt );
+            else
+              invalidate( expected );
+          }
+        }
+        ASSERT_EQ( is_valid(expected), is_valid(result(i,j)) ) << i << "," << j;
+        EXPECT_EQ( expected[0], result(i,j)[0] ) << i << "," << j;
+        EXPECT_EQ( expected[1], result(i,j)[1] ) << i << "," << j;
+      }
+  }
+}
+
+// Large regions are refined in blocks, several at once, and each
+// block comes out as if it were rasterized on its own.
+TEST_F( SubPixelCorrelate90Test, Blocks ) {
+  typedef SubpixelView<PreFilter, ImageView<uint8> > view_type;
+  view_type view =
+    subpixel_refine( starting_disp, image1, image2, 7, 7, true, true, 1, PreFilter(1.4) );
+  EXPECT_EQ( view_type::default_block_size(), view.block_size() );
+  view.set_block_size( Vector2i(32, 48) );
+
+  ImageView<PixelMask<Vector2f> > result = view;
+  for ( int32 j = 0; j < view.rows(); j += 48 )
+    for ( int32 i = 0; i < view.cols(); i += 32 ) {
+      BBox2i block( i, j, 32, 48 );
+      block.crop( bounding_box(view) );
+      ImageView<PixelMask<Vector2f> > expected = crop( view, block );
+      for ( int32 y = 0; y < block.height(); y++ )
+        for ( int32 x = 0; x < block.width(); x++ ) {
+          PixelMask<Vector2f> const& pix = result( block.min().x()+x, block.min().y()+y );
+          ASSERT_EQ( is_valid(expected(x,y)), is_valid(pix) );
+          EXPECT_EQ( expected(x,y)[0], pix[0] );
+          EXPECT_EQ( expected(x,y)[1], pix[1] );
+        }
+    }
+
+  int32 invalid_count = 0;
+  EXPECT_LT( check_error( result, invalid_count ), 0.383 );
+}
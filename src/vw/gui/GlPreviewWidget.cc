@@ -440,6 +440,11 @@ void GlPreviewWidget::drawImage() {
   std::list<TileLocator> tiles = bbox_to_tiles(tile_size, m_current_viewport, level, max_level, m_current_transaction_id, m_exact_transaction_id_match);
   std::list<TileLocator>::iterator tile_iter = tiles.begin();
 
+  // Tiles are fetched nearest the center of the view first, and
+  // requests for tiles that are no longer in view are dropped.
+  m_gl_texture_cache->begin_frame();
+  Vector2 view_center = m_current_viewport.center();
+
   while (tile_iter != tiles.end()) {
     BBox2i texture_bbox = tile_to_bbox(tile_size, tile_iter->col, tile_iter->row, tile_iter->level, max_level);
     texture_bbox.crop(image_bbox);
@@ -450,7 +455,23 @@ void GlPreviewWidget::drawImage() {
       // generated so that it is available at some point in the
       // future. will be generated if necessary. Note that this
       // happens outside the m_gl_mutex to avoid deadlock.
-      GLuint texture_id = m_gl_texture_cache->get_texture_id(*tile_iter, this);
+      float priority = norm_2(Vector2(texture_bbox.min() + texture_bbox.max()) / 2 - view_center);
+      GLuint texture_id = m_gl_texture_cache->get_texture_id(*tile_iter, this, priority);
+
+      // Until it arrives, draw the matching part of the nearest
+      // coarser tile that is on hand, upsampled.
+      BBox2 tex_coords(0, 0, 1, 1);
+      bool exact = (texture_id != 0);
+      if (!exact) {
+        TileLocator parent;
+        texture_id = m_gl_texture_cache->get_parent_texture_id(*tile_iter, parent);
+        if (texture_id) {
+          BBox2 parent_bbox = tile_to_bbox(tile_size, parent.col, parent.row, parent.level, max_level);
+          parent_bbox.crop(image_bbox);
+          tex_coords = BBox2(elem_quot(Vector2(texture_bbox.min()) - parent_bbox.min(), parent_bbox.size()),
+                             elem_quot(Vector2(texture_bbox.max()) - parent_bbox.min(), parent_bbox.size()));
+        }
+      }
 
       if (texture_id) {
         glUseProgram(m_glsl_program);
@@ -473,13 +494,13 @@ void GlPreviewWidget::drawImage() {
         // Draw the texture onto a quad.
         qglColor(Qt::white);
         glBegin(GL_QUADS);
-        glTexCoord2d( 0.0 , 0.0);
+        glTexCoord2d( tex_coords.min().x() , tex_coords.min().y() );
         glVertex2d( texture_bbox.min().x() , -(texture_bbox.min().y()) );
-        glTexCoord2d( 0.0 , 1 );
+        glTexCoord2d( tex_coords.min().x() , tex_coords.max().y() );
         glVertex2d( texture_bbox.min().x() , -(texture_bbox.max().y()) );
-        glTexCoord2d( 1.0 , 1.0 );
+        glTexCoord2d( tex_coords.max().x() , tex_coords.max().y() );
         glVertex2d( texture_bbox.max().x() , -(texture_bbox.max().y()) );
-        glTexCoord2d( 1.0 , 0.0 );
+        glTexCoord2d( tex_coords.max().x() , tex_coords.min().y() );
         glVertex2d( texture_bbox.max().x() , -(texture_bbox.min().y()) );
         glEnd();
 
@@ -487,9 +508,10 @@ void GlPreviewWidget::drawImage() {
         glDisable( GL_TEXTURE_2D );
         glUseProgram(0);
 
-        // Optional: draw a border around the texture
+        // Optional: draw a border around the texture, red if it is
+        // still a stand-in.
         if (m_show_tile_boundaries) {
-          qglColor(Qt::blue);
+          qglColor(exact ? Qt::blue : Qt::red);
           glBegin(GL_LINES);
           glVertex2d( texture_bbox.min().x() , -(texture_bbox.min().y()) );
           glVertex2d( texture_bbox.min().x() , -(texture_bbox.max().y()) );
@@ -10,22 +10,190 @@
 #include <vw/Image/ViewImageResource.h>
 #include <vw/Core/Debugging.h>
 
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+#include <vw/FileIO/DiskImageResourceGDAL.h>
+#endif
+
+#include <boost/filesystem/operations.hpp>
+namespace fs = boost::filesystem;
+
 namespace vw { namespace gui {
 
+namespace {
+  // The region of an image reduced by factor that subsampling bbox
+  // would keep, for bbox starting on a multiple of factor.
+  BBox2i reduce_bbox(BBox2i const& bbox, int32 factor) {
+    return BBox2i(bbox.min() / factor,
+                  Vector2i(1 + (bbox.max().x() - 1) / factor,
+                           1 + (bbox.max().y() - 1) / factor));
+  }
+
+  std::string overview_filename(std::string const& filename) {
+    return filename + ".vwv.tif";
+  }
+}
+
+// --------------------------------------------------------------
+//                     OverviewTask
+// --------------------------------------------------------------
+
+// Writes the sidecar from every other pixel of every other row of the
+// image, the pixels subsampling keeps, a block of the sidecar at a
+// time.  It reads through a resource of its own so as not to hold up
+// tile reads, and writes to a scratch name first, so that a build
+// that is cut short never leaves a sidecar behind.
+class OverviewTask {
+  ImageTileGenerator& m_generator;
+  std::string m_filename;
+
+  bool cancelled() {
+    Mutex::Lock lock(m_generator.m_overview_mutex);
+    return m_generator.m_overview_cancel;
+  }
+
+public:
+  OverviewTask(ImageTileGenerator& generator, std::string const& filename) :
+    m_generator(generator), m_filename(filename) {}
+
+  void operator()() {
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+    std::string sidecar = overview_filename(m_filename);
+    std::string scratch = m_filename + ".vwv-partial.tif";
+    try {
+      boost::scoped_ptr<SrcImageResource> src( DiskImageResource::open(m_filename) );
+      ImageFormat src_fmt = src->format();
+      ImageFormat fmt = src_fmt;
+      fmt.cols = 1 + (src_fmt.cols - 1) / 2;
+      fmt.rows = 1 + (src_fmt.rows - 1) / 2;
+
+      vw_out() << "\t--> Building overviews in " << sidecar << ".\n";
+      {
+        DiskImageResourceGDAL::Options options;
+        options["COG"] = "YES";
+        options["COMPRESS"] = "DEFLATE";
+        DiskImageResourceGDAL out(scratch, fmt, Vector2i(-1,-1), options);
+
+        Vector2i block = out.block_write_size();
+        std::vector<uint8> data;
+        for (int32 y = 0; y < int32(fmt.rows); y += block.y()) {
+          for (int32 x = 0; x < int32(fmt.cols); x += block.x()) {
+            if (cancelled())
+              vw_throw(Aborted() << "ImageTileGenerator was closed.");
+
+            BBox2i bbox(Vector2i(x, y), Vector2i(std::min(x + block.x(), int32(fmt.cols)),
+                                                 std::min(y + block.y(), int32(fmt.rows))));
+            BBox2i src_bbox(bbox.min() * 2, bbox.max() * 2 - Vector2i(1, 1));
+
+            ImageFormat read_fmt = src_fmt;
+            read_fmt.cols = src_bbox.width();
+            read_fmt.rows = src_bbox.height();
+            data.resize(read_fmt.byte_size());
+            ImageBuffer read_buf(read_fmt, &data[0]);
+            src->read(read_buf, src_bbox);
+
+            // The kept pixels, by doubling the strides.
+            ImageBuffer kept = read_buf;
+            kept.format.cols = bbox.width();
+            kept.format.rows = bbox.height();
+            kept.cstride *= 2;
+            kept.rstride *= 2;
+            out.write(kept, bbox);
+          }
+        }
+        out.flush();
+      }
+      fs::rename(scratch, sidecar);
+
+      boost::shared_ptr<SrcImageResource> overview( DiskImageResource::open(sidecar) );
+      Mutex::Lock lock(m_generator.m_overview_mutex);
+      m_generator.m_overview = overview;
+      vw_out() << "\t--> Overviews of " << m_filename << " are ready.\n";
+
+    } catch (const std::exception& e) {
+      if (!dynamic_cast<const vw::Aborted*>(&e))
+        vw_out(WarningMessage) << "ImageTileGenerator: could not build overviews of "
+                               << m_filename << ": " << e.what() << "\n";
+      boost::system::error_code ec;
+      fs::remove(scratch, ec);
+    }
+#endif
+  }
+};
+
+// --------------------------------------------------------------
+//                     ImageTileGenerator
+// --------------------------------------------------------------
+
 ImageTileGenerator::ImageTileGenerator(std::string filename) :
-  m_rsrc( DiskImageResource::open(filename) ) {
+  m_rsrc( DiskImageResource::open(filename) ), m_overview_cancel(false) {
   vw_out() << "\t--> Loading image: " << filename << ".\n";
+  open_overview(filename);
+}
+
+ImageTileGenerator::~ImageTileGenerator() {
+  if (m_overview_thread) {
+    {
+      Mutex::Lock lock(m_overview_mutex);
+      m_overview_cancel = true;
+    }
+    m_overview_thread->join();
+  }
 }
 
+void ImageTileGenerator::open_overview(std::string const& filename) {
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+  // Small images are quick enough to subsample, and some files carry
+  // overviews of their own, which reduced reads already use.
+  if (this->num_levels() <= 3 || m_rsrc->reduced_read_factor(2) > 1 ||
+      m_rsrc->format().planes != 1)
+    return;
 
-// This little template makes the code below much cleaner.
+  std::string sidecar = overview_filename(filename);
+  try {
+    if (fs::exists(sidecar) && fs::last_write_time(sidecar) >= fs::last_write_time(filename)) {
+      boost::shared_ptr<SrcImageResource> overview( DiskImageResource::open(sidecar) );
+      if (overview->cols() == 1 + (m_rsrc->cols() - 1) / 2 &&
+          overview->rows() == 1 + (m_rsrc->rows() - 1) / 2 &&
+          overview->pixel_format() == m_rsrc->pixel_format() &&
+          overview->channel_type() == m_rsrc->channel_type()) {
+        vw_out() << "\t--> Using overviews in " << sidecar << ".\n";
+        m_overview = overview;
+        return;
+      }
+    }
+  } catch (const vw::Exception& e) {
+    // Unreadable; build it again.
+  }
+
+  m_overview_task.reset(new OverviewTask(*this, filename));
+  m_overview_thread.reset(new Thread(m_overview_task));
+#endif
+}
+
+// This little template makes the code below much cleaner.  Coarse
+// levels are read from the resource at a reduced resolution when it
+// can do that cheaply (from GDAL overviews, say), so that the top of
+// the pyramid doesn't read the whole image; whatever reduction is
+// left is made by subsampling.  tile_bbox starts on a multiple of
+// scale.
 template <class PixelT>
 boost::shared_ptr<SrcImageResource> do_image_tilegen(boost::shared_ptr<SrcImageResource> rsrc,
-                                                      BBox2i tile_bbox,
-                                                      int level, int num_levels) {
-  ImageView<PixelT> tile(tile_bbox.width(), tile_bbox.height());
-  rsrc->read(tile.buffer(), tile_bbox);
-  ImageView<PixelT> reduced_tile = subsample(tile, (1 << ((num_levels-1) - level)));
+                                                      Mutex& rsrc_mutex, BBox2i tile_bbox,
+                                                      int32 scale) {
+  int32 factor = rsrc->reduced_read_factor(scale);
+  if (factor < 1 || scale % factor != 0)
+    factor = 1;
+
+  BBox2i read_bbox = reduce_bbox(tile_bbox, factor);
+  ImageView<PixelT> tile(read_bbox.width(), read_bbox.height());
+  {
+    Mutex::Lock lock(rsrc_mutex);
+    if (factor > 1)
+      rsrc->read_reduced(tile.buffer(), read_bbox, factor);
+    else
+      rsrc->read(tile.buffer(), read_bbox);
+  }
+  ImageView<PixelT> reduced_tile = subsample(tile, scale / factor);
   return boost::shared_ptr<SrcImageResource>( new ViewImageResource(reduced_tile) );
 }
 
@@ -49,20 +217,30 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
   // by cropping the tile to the image dimensions.
   tile_bbox.crop(image_bbox);
 
+  // Coarse tiles come from the sidecar overviews when they're ready.
+  boost::shared_ptr<SrcImageResource> rsrc = m_rsrc;
+  Mutex* rsrc_mutex = &m_rsrc_mutex;
+  int32 scale = 1 << ((this->num_levels()-1) - tile_info.level);
+  if (scale > 1) {
+    Mutex::Lock lock(m_overview_mutex);
+    if (m_overview) {
+      rsrc = m_overview;
+      rsrc_mutex = &m_overview_mutex;
+      tile_bbox = reduce_bbox(tile_bbox, 2);
+      scale /= 2;
+    }
+  }
+
   switch (this->pixel_format()) {
   case VW_PIXEL_GRAY:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelGray<uint8> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<uint8> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_INT16) {
-      return do_image_tilegen<PixelGray<int16> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<int16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelGray<uint16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<uint16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_FLOAT32) {
-      return do_image_tilegen<PixelGray<float> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGray<float> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else {
       std::cout << "This platefile has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -72,17 +250,13 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_GRAYA:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelGrayA<uint8> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<uint8> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_INT16) {
-      return do_image_tilegen<PixelGrayA<int16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<int16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelGrayA<uint16> >(m_rsrc, tile_bbox,
-                                                   tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<uint16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_FLOAT32) {
-      return do_image_tilegen<PixelGrayA<float> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelGrayA<float> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -93,11 +267,9 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_RGB:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelRGB<uint8> >(m_rsrc, tile_bbox,
-                                                tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGB<uint8> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelRGB<uint16> >(m_rsrc, tile_bbox,
-                                                tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGB<uint16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
@@ -108,11 +280,9 @@ boost::shared_ptr<SrcImageResource> ImageTileGenerator::generate_tile(TileLocato
 
   case VW_PIXEL_RGBA:
     if (this->channel_type() == VW_CHANNEL_UINT8) {
-      return do_image_tilegen<PixelRGBA<uint8> >(m_rsrc, tile_bbox,
-                                                 tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGBA<uint8> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else if (this->channel_type() == VW_CHANNEL_UINT16) {
-      return do_image_tilegen<PixelRGBA<uint16> >(m_rsrc, tile_bbox,
-                                                  tile_info.level, this->num_levels());
+      return do_image_tilegen<PixelRGBA<uint16> >(rsrc, *rsrc_mutex, tile_bbox, scale);
     } else {
       std::cout << "This image has a channel type that is not yet support by vwv.\n";
       std::cout << "Exiting...\n\n";
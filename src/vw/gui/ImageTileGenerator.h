@@ -9,16 +9,38 @@
 #define __VW_GUI_IMAGETILEGENERATOR_H__
 
 #include <vw/gui/TileGenerator.h>
+#include <vw/Core/Thread.h>
 
 namespace vw {
 namespace gui {
 
+  class OverviewTask;
+
+  // Images big enough to need it, and without overviews of their own,
+  // get a sidecar file next to them (filename + ".vwv.tif") holding
+  // the image at half resolution as a compressed, tiled GeoTIFF with
+  // overviews down to a single tile.  It is built on a background
+  // thread the first time the image is opened, while coarse tiles are
+  // still read from the image itself, and reused on later opens until
+  // the image changes.
   class ImageTileGenerator : public TileGenerator {
+    friend class OverviewTask;
+
     boost::shared_ptr<SrcImageResource> m_rsrc;
+    Mutex m_rsrc_mutex; // Tiles are generated in parallel; reads are not.
+
+    // The sidecar, once it is ready, and the thread building it.
+    boost::shared_ptr<SrcImageResource> m_overview;
+    Mutex m_overview_mutex;
+    bool m_overview_cancel;
+    boost::shared_ptr<OverviewTask> m_overview_task;
+    boost::shared_ptr<Thread> m_overview_thread;
+
+    void open_overview(std::string const& filename);
 
   public:
     ImageTileGenerator(std::string filename);
-    virtual ~ImageTileGenerator() {}
+    virtual ~ImageTileGenerator();
     virtual PixelRGBA<float> sample(int x, int y, int level, int transaction_id);
 
     virtual boost::shared_ptr<SrcImageResource> generate_tile(TileLocator const& tile_info);
@@ -128,6 +128,7 @@ boost::shared_ptr<SrcImageResource> PlatefileTileGenerator::generate_tile(TileLo
 
   vw_out(DebugMessage, "gui.platefile") << "generate_tile: " << tile_info << std::endl;
 
+  Mutex::Lock lock(m_platefile_mutex);
   VW_DELEGATE_BY_PIXEL_TYPE(generate_tile_impl, tile_info, m_platefile)
 
   // If we get to here, then there was no support for the pixel format.
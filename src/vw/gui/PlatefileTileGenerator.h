@@ -9,6 +9,7 @@
 #define __VW_GUI_PLATEFILETILEGENERATOR_H__
 
 #include <vw/gui/TileGenerator.h>
+#include <vw/Core/Thread.h>
 
 namespace vw {
 
@@ -19,6 +20,7 @@ namespace gui {
   class PlatefileTileGenerator : public TileGenerator {
     boost::shared_ptr<vw::platefile::PlateFile> m_platefile;
     int m_num_levels;
+    Mutex m_platefile_mutex; // Tiles are generated in parallel; reads are not.
 
   public:
     PlatefileTileGenerator(const std::string& platefile_name);
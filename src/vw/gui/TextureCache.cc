@@ -6,6 +6,9 @@
 
 
 #include <vw/gui/TextureCache.h>
+
+#include <algorithm>
+
 using namespace vw;
 using namespace vw::gui;
 
@@ -83,50 +86,23 @@ void CachedTextureRenderer::process_allocation_requests() {
 // --------------------------------------------------------------
 
 class vw::gui::TextureFetchTask {
-  bool terminate;
-  vw::Mutex &m_request_mutex;
-  std::list<boost::shared_ptr<TextureRecord> > &m_requests;
+  GlTextureCache& m_cache;
 
 public:
-  TextureFetchTask(vw::Mutex &request_queue_mutex,
-                   std::list<boost::shared_ptr<TextureRecord> > &request_queue) :
-    terminate(false), m_request_mutex(request_queue_mutex), m_requests(request_queue) {}
+  TextureFetchTask(GlTextureCache& cache) : m_cache(cache) {}
 
   void operator()() {
-    while (!terminate) {
-
-      // Drain the request queue
-      bool found = false;
-      boost::shared_ptr<TextureRecord> r;
-      {
-        vw::Mutex::Lock lock(m_request_mutex);
-        if (!m_requests.empty()) {
-          r = m_requests.front();
-          m_requests.pop_front();
-          found = true;
-        }
-      }
-
-      if (found) {
-
-        // Force the texture to regenerate.  Doing so will cause the
-        // image tile to be loaded into memory, and then a texture
-        // allocation request to be generated to be handled later by
-        // the OpenGL thread.  This may cause one or more texture
-        // deallocation requests to be produced as well if cache tile
-        // need to be deallocated to make room for the new tile.
-        (*(r->handle)).texture_id();
-
-      } else {
-
-        // If there were no requests, sleep for a short time.
-        vw::Thread::sleep_ms(100);
-
-      }
+    boost::shared_ptr<TextureRecord> r;
+    while ((r = m_cache.next_request())) {
+      // Force the texture to regenerate.  Doing so will cause the
+      // image tile to be loaded into memory, and then a texture
+      // allocation request to be generated to be handled later by
+      // the OpenGL thread.  This may cause one or more texture
+      // deallocation requests to be produced as well if cache tile
+      // need to be deallocated to make room for the new tile.
+      (*(r->handle)).texture_id();
     }
   }
-
-  void kill() { terminate = true; }
 };
 
 
@@ -134,60 +110,104 @@ public:
 //                     GlTextureCache
 // --------------------------------------------------------------
 
-vw::gui::GlTextureCache::GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator) :
-  m_tile_generator(tile_generator) {
+vw::gui::GlTextureCache::GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator,
+                                        int num_fetch_threads,
+                                        size_t texture_memory_budget) :
+  m_frame(0), m_terminate(false), m_tile_generator(tile_generator) {
 
-  // Create the texture cache
-  int gl_texture_cache_size = 256 * 1024 * 1024; // Use 128-MB of
-                                                 // texture cache
-
-  m_gl_texture_cache_ptr = new vw::Cache( gl_texture_cache_size );
-
-  // Start the texture fetch thread
-  m_texture_fetch_task.reset(new TextureFetchTask(m_request_mutex, m_requests));
-  m_texture_fetch_thread = new vw::Thread( m_texture_fetch_task );
+  // Create the texture cache.  Its lines are sized by what their
+  // textures take on the card, and evicting one deletes its texture,
+  // so the cache's size is the budget for texture memory.
+  m_gl_texture_cache_ptr = new vw::Cache( texture_memory_budget );
 
   // Create the texture record tree for storing cache handles and
   // other useful texture-related metadata.
   m_texture_records.reset( new gui::TreeNode<boost::shared_ptr<TextureRecord> >() );
-  m_previous_level = 0;
+
+  // Start the texture fetch threads
+  for (int i = 0; i < std::max(num_fetch_threads, 1); ++i) {
+    m_texture_fetch_tasks.push_back(boost::shared_ptr<TextureFetchTask>(new TextureFetchTask(*this)));
+    m_texture_fetch_threads.push_back(new vw::Thread( m_texture_fetch_tasks.back() ));
+  }
 }
 
 vw::gui::GlTextureCache::~GlTextureCache() {
-  // Stop the Texture Fetch thread
-  m_texture_fetch_task->kill();
-  m_texture_fetch_thread->join();
-  delete m_texture_fetch_thread;
+  // Stop the Texture Fetch threads
+  {
+    Mutex::Lock lock(m_request_mutex);
+    m_terminate = true;
+    m_request_cond.notify_all();
+  }
+  for (size_t i = 0; i < m_texture_fetch_threads.size(); ++i) {
+    m_texture_fetch_threads[i]->join();
+    delete m_texture_fetch_threads[i];
+  }
 
   // Free up remaining texture handles, and then the cache itself.
   m_requests.clear();
   delete m_gl_texture_cache_ptr;
 }
 
+boost::shared_ptr<TextureRecord> vw::gui::GlTextureCache::next_request() {
+  Mutex::Lock lock(m_request_mutex);
+  while (!m_terminate) {
+    while (!m_requests.empty()) {
+      std::pop_heap(m_requests.begin(), m_requests.end());
+      TextureFetchRequest request = m_requests.back();
+      m_requests.pop_back();
+
+      // Skip requests that have left the view, that were made again
+      // later (that entry is the live one), and textures that another
+      // thread has already generated or is generating.
+      if (request.frame < m_frame - 1 ||
+          request.frame != request.record->requested_frame ||
+          !request.record->handle.missing())
+        continue;
+      return request.record;
+    }
+    m_request_cond.wait(lock);
+  }
+  return boost::shared_ptr<TextureRecord>();
+}
+
 void vw::gui::GlTextureCache::clear() {
   Mutex::Lock lock(m_request_mutex);
   m_requests.clear();
 
   // Delete all of the existing texture records
   m_texture_records.reset( new gui::TreeNode<boost::shared_ptr<TextureRecord> >() );
-  m_previous_level = 0;
+}
+
+void vw::gui::GlTextureCache::set_texture_memory_budget(size_t bytes) {
+  m_gl_texture_cache_ptr->resize(bytes);
+}
+
+size_t vw::gui::GlTextureCache::texture_memory_budget() const {
+  return m_gl_texture_cache_ptr->max_size();
+}
+
+void vw::gui::GlTextureCache::begin_frame() {
+  Mutex::Lock lock(m_request_mutex);
+  ++m_frame;
+
+  // Prune what next_request() would skip anyway, so that the heap
+  // doesn't grow while the view keeps moving.
+  std::vector<TextureFetchRequest> live;
+  live.reserve(m_requests.size());
+  for (size_t i = 0; i < m_requests.size(); ++i)
+    if (m_requests[i].frame >= m_frame - 1 && m_requests[i].frame == m_requests[i].record->requested_frame)
+      live.push_back(m_requests[i]);
+  m_requests.swap(live);
+  std::make_heap(m_requests.begin(), m_requests.end());
 }
 
 GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_info,
-                                               CachedTextureRenderer* requestor) {
+                                               CachedTextureRenderer* requestor,
+                                               float priority) {
   // Bail early if the tile_info request is totally invalid.
   if (!tile_info.is_valid())
     return 0;
 
-  // We purge the outgoing request queue whenever there is a change
-  // in LOD so that we can immediately begin serving tiles at the
-  // new level of detail.
-  if (tile_info.level != m_previous_level) {
-    Mutex::Lock lock(m_request_mutex);
-    m_requests.clear();
-    m_previous_level = tile_info.level;
-  }
-
   try {
 
     // First, see if the texture record is already in the cache.
@@ -206,16 +226,26 @@ GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_
       vw_throw(gui::TileNotFoundErr() << "invalid record. regenerating...");
 
     // If the texture_id of this record is 0, then we need to send a
-    // request to regenerate the texture.  It will get rendered in the
-    // future after it has been loaded.
+    // request to regenerate the texture, unless it is already on its
+    // way.  It will get rendered in the future after it has been
+    // loaded.
     if (rec->texture_id == 0) {
-      Mutex::Lock lock(m_request_mutex);
-      m_requests.push_back( rec );
+      if (rec->handle.missing()) {
+        Mutex::Lock lock(m_request_mutex);
+        if (rec->requested_frame != m_frame) {
+          rec->requested_frame = m_frame;
+          m_requests.push_back( TextureFetchRequest(priority, m_frame, rec) );
+          std::push_heap(m_requests.begin(), m_requests.end());
+          m_request_cond.notify_one();
+        }
+      }
       return 0;
     }
 
-    // If the texture_id is valid, then the tile must be good.  Return
+    // If the texture_id is valid, then the tile must be good.  Mark
+    // it as drawn, so that it is the last to be evicted, and return
     // the texture_id to satisfy the request.
+    rec->handle.touch();
     return rec->texture_id;
 
   } catch (const gui::TileNotFoundErr& e) {
@@ -236,10 +266,40 @@ GLuint vw::gui::GlTextureCache::get_texture_id(vw::gui::TileLocator const& tile_
                                tile_info.level, tile_info.transaction_id );
 
     Mutex::Lock lock(m_request_mutex);
-    m_requests.push_back( new_record_ptr );
+    new_record->requested_frame = m_frame;
+    m_requests.push_back( TextureFetchRequest(priority, m_frame, new_record_ptr) );
+    std::push_heap(m_requests.begin(), m_requests.end());
+    m_request_cond.notify_one();
     return 0;
 
   }
 
   return 0; // never reached
 }
+
+GLuint vw::gui::GlTextureCache::get_parent_texture_id(vw::gui::TileLocator const& tile_info,
+                                                      vw::gui::TileLocator& parent) {
+  if (!tile_info.is_valid())
+    return 0;
+
+  parent = tile_info;
+  while (parent.level > 0) {
+    parent.col /= 2;
+    parent.row /= 2;
+    parent.level -= 1;
+
+    try {
+      boost::shared_ptr<TextureRecord> rec = m_texture_records->search(parent.col, parent.row,
+                                                                       parent.level,
+                                                                       parent.transaction_id,
+                                                                       false);
+      if (rec && rec->texture_id) {
+        rec->handle.touch();
+        return rec->texture_id;
+      }
+    } catch (const gui::TileNotFoundErr& e) {
+      // Not loaded at this level; keep looking further up.
+    }
+  }
+  return 0;
+}
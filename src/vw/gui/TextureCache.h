@@ -141,9 +141,12 @@ namespace gui {
       m_tile_generator( generator ), m_tile_info(tile_info), m_record(record) {
     }
 
+    // What the texture takes on the card: the preview widget stores
+    // tiles as 32-bit float textures with mipmaps, which add a third.
     size_t size() const {
-      int size =  m_tile_generator->tile_size()[0] * m_tile_generator->tile_size()[1] * num_channels(m_tile_generator->pixel_format()) * channel_size(m_tile_generator->channel_type());
-      return size;
+      size_t size = size_t(m_tile_generator->tile_size()[0]) * m_tile_generator->tile_size()[1] *
+        num_channels(m_tile_generator->pixel_format()) * sizeof(float32);
+      return size + size / 3;
     }
 
     boost::shared_ptr<GlTextureHandleBase> generate() const {
@@ -158,24 +161,43 @@ namespace gui {
 
   struct TextureRecord : public TextureRecordBase {
     vw::Cache::Handle<GlTextureGenerator> handle;
+    // The last frame this texture was asked for in.
+    int requested_frame;
+    TextureRecord() : requested_frame(-1) {}
     virtual ~TextureRecord() {}
   };
 
+  // A queued fetch.  Fetches are served most urgent (lowest priority
+  // value) first.
+  struct TextureFetchRequest {
+    float priority;
+    int frame;
+    boost::shared_ptr<TextureRecord> record;
+    TextureFetchRequest(float p, int f, boost::shared_ptr<TextureRecord> const& r)
+      : priority(p), frame(f), record(r) {}
+    // For the std heap functions, which keep the greatest on top.
+    bool operator<(TextureFetchRequest const& other) const { return priority > other.priority; }
+  };
+
   // --------------------------------------------------------------
   //                     GlTextureCache
   // --------------------------------------------------------------
 
   class GlTextureCache {
+    friend class TextureFetchTask;
 
-    // We purge the outgoing request queue whenever there is a change
-    // in LOD so that we can immediately begin serving tiles at the
-    // new level of detail.  We keep track of the previous LOD here.
-    int m_previous_level;
+    // Requests are stamped with the frame they were made in, and a
+    // request that wasn't made again in the latest frame is for a tile
+    // that has left the view: it is dropped rather than fetched.
+    int m_frame;
 
-    // Communication to/from the texture caching thread is handled using
-    // a pair of request queues.  These queues are locked with a mutex.
-    std::list<boost::shared_ptr<TextureRecord> > m_requests;
+    // Outstanding requests, as a heap on priority.  A record asked for
+    // again in a later frame gets a new entry, and older entries are
+    // skipped when they come up or pruned at the start of a frame.
+    std::vector<TextureFetchRequest> m_requests;
     vw::Mutex m_request_mutex;
+    vw::Condition m_request_cond;
+    bool m_terminate;
 
     // We store texure records in a quad tree structure.  For now we are
     // going to use the tree structure provided by the plate module,
@@ -183,16 +205,23 @@ namespace gui {
     // module someday.
     boost::shared_ptr<gui::TreeNode<boost::shared_ptr<TextureRecord> > > m_texture_records;
     vw::Cache* m_gl_texture_cache_ptr;
-    boost::shared_ptr<TextureFetchTask> m_texture_fetch_task;
-    vw::Thread *m_texture_fetch_thread;
+    std::vector<boost::shared_ptr<TextureFetchTask> > m_texture_fetch_tasks;
+    std::vector<vw::Thread*> m_texture_fetch_threads;
 
     // Shared ptr to the texture generator
     boost::shared_ptr<TileGenerator> m_tile_generator;
 
+    // Blocks until there is a live request to serve, and returns its
+    // record, or returns an empty pointer when the cache is shutting
+    // down.
+    boost::shared_ptr<TextureRecord> next_request();
+
   public:
 
-    // Constructor/destructor
-    GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator);
+    // Constructor/destructor.  num_fetch_threads tiles are generated at
+    // once.
+    GlTextureCache(boost::shared_ptr<TileGenerator> tile_generator, int num_fetch_threads = 4,
+                   size_t texture_memory_budget = 256 * 1024 * 1024);
     ~GlTextureCache();
 
     // Get a handle on the generator being used to produce tiles.
@@ -203,13 +232,32 @@ namespace gui {
     // Clear all entries from the texture cache.
     void clear();
 
+    // Textures are kept on the card within this many bytes, and the
+    // least recently drawn are deleted first to make room.
+    void set_texture_memory_budget(size_t bytes);
+    size_t texture_memory_budget() const;
+
+    // Starts a new frame.  Requests from before the previous frame that
+    // haven't been repeated since are cancelled.
+    void begin_frame();
+
     // Fetch a texture from the cache.  This is a non-blocking call that
     // will immediately return the GL texture id of the texture *if it
     // is available*.  If the texture is not available, this function
     // will add it to the queue to be rendered by the texture fetch
-    // thread and return 0 immediately.
+    // threads and return 0 immediately.  Queued textures are fetched
+    // lowest priority first; the preview widget passes the distance
+    // from the center of the view.
     GLuint get_texture_id(vw::gui::TileLocator const& tile_info,
-                          CachedTextureRenderer* requestor);
+                          CachedTextureRenderer* requestor,
+                          float priority = 0);
+
+    // Finds the nearest coarser tile covering tile_info whose texture
+    // is already on the card, for drawing upsampled until tile_info
+    // itself arrives.  Returns its texture id and sets parent to its
+    // locator, or returns 0 if there is none.  Requests nothing.
+    GLuint get_parent_texture_id(vw::gui::TileLocator const& tile_info,
+                                 vw::gui::TileLocator& parent);
   };
 
 }} // namespace vw::gui
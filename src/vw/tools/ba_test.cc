@@ -62,6 +62,13 @@
  *    generated by BundleAjustReport. To use outlier removal, this option must
  *    be set to at least 35 so that the image_mean.err file is generated.
  *
+ *    The --timing-file option appends a record of the run to the named file:
+ *    the problem size, the number of iterations, and the seconds spent in
+ *    all and in each phase of the adjuster's update (Jacobians, Schur
+ *    complement, factorization and update step). The record is a line of
+ *    JSON if the file name ends in .json, and a CSV row otherwise, with a
+ *    header line when the file is new. run_ba_benchmarks collects these.
+ *
  *  OUTPUT:
  *
  *    ba_test generates several output files.
@@ -110,6 +117,7 @@ using namespace vw::camera;
 using namespace vw::ba;
 
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <iomanip>
 
@@ -173,6 +181,7 @@ struct ProgramOptions {
   fs::path cnet_file;
   fs::path data_dir;
   fs::path results_dir;
+  fs::path timing_file;
   std::string config_file;
   friend std::ostream& operator<<(std::ostream& ostr, const ProgramOptions& o);
 };
@@ -216,6 +225,7 @@ std::ostream& operator<<(std::ostream& ostr, const ProgramOptions& o) {
   ostr << "Use bundle adjustment type dirs? " << std::boolalpha << o.use_ba_type_dirs << endl;
   ostr << "Remove outliers? " << std::boolalpha << o.remove_outliers << endl;
   ostr << "Outlier SD cutoff: " << o.outlier_sd_cutoff << endl;
+  ostr << "Timing file: " << o.timing_file << endl;
   return ostr;
 }
 /* }}} operator<< */
@@ -328,7 +338,10 @@ ProgramOptions parse_options(int argc, char* argv[]) {
         "Remove outliers using naive heuristic")
     ("outlier-sd-cutoff",
         po::value<double>(&opts.outlier_sd_cutoff)->default_value(2),
-        "Remove outliers more than this number of std devs from the mean (implies -M)");
+        "Remove outliers more than this number of std devs from the mean (implies -M)")
+    ("timing-file",
+        po::value<fs::path>(&opts.timing_file),
+        "Append the time spent in each phase of bundle adjustment to this file (.json or CSV)");
 
   // Hidden options, aka command line arguments (hidden_options)
   po::options_description hidden_options("");
@@ -364,7 +377,9 @@ ProgramOptions parse_options(int argc, char* argv[]) {
     ("euler-outlier-sigma","")
     ("euler-outlier-freq","")
     ("min-tiepoints-per-image","")
-    ("number-of-cameras","");
+    ("number-of-points","")
+    ("number-of-cameras","")
+    ("seed","");
 
   // Allowed options (includes generic and ba)
   po::options_description allowed_options("Allowed Options");
@@ -691,6 +706,41 @@ public:
   }
 /* }}} */
 
+/* {{{ analytic jacobians */
+  // The AdjustedCameraModel differentiates against a small turn
+  // composed on the right of the pose correction. The columns of
+  // 'rate' carry each euler angle onto that turn: for
+  // R = Rz(p2)*Ry(p1)*Rx(p0) they are x, Rx'*y and (Ry*Rx)'*z.
+  bool A_jacobian_analytic( unsigned /*i*/, unsigned j, camera_vector_t const& a_j,
+                            point_vector_t const& b_i, Matrix<double,2,6>& J ) const {
+    Vector3 p = subvector(a_j,3,3);
+    AdjustedCameraModel cam(m_cameras[j], subvector(a_j,0,3),
+                            vw::math::euler_to_quaternion(p[0], p[1], p[2], "xyz"));
+    Matrix<double,2,3> translation_jacobian, rotation_jacobian;
+    cam.adjustment_jacobian(b_i, translation_jacobian, rotation_jacobian);
+
+    Matrix<double,3,3> rx = vw::math::rotation_x_axis(p[0]);
+    Matrix<double,3,3> ryx = vw::math::rotation_y_axis(p[1]) * rx;
+    Matrix<double,3,3> rate;
+    select_col(rate,0) = Vector3(1,0,0);
+    select_col(rate,1) = select_row(rx,1);
+    select_col(rate,2) = select_row(ryx,2);
+
+    submatrix(J,0,0,2,3) = translation_jacobian;
+    submatrix(J,0,3,2,3) = rotation_jacobian * rate;
+    return true;
+  }
+
+  bool B_jacobian_analytic( unsigned /*i*/, unsigned j, camera_vector_t const& a_j,
+                            point_vector_t const& b_i, Matrix<double,2,3>& J ) const {
+    Vector3 p = subvector(a_j,3,3);
+    AdjustedCameraModel cam(m_cameras[j], subvector(a_j,0,3),
+                            vw::math::euler_to_quaternion(p[0], p[1], p[2], "xyz"));
+    cam.point_to_pixel_jacobian(b_i, J);
+    return true;
+  }
+/* }}} */
+
 /* {{{ write_adjustment */
   void write_adjustment(int j, std::string const& filename) const {
     Vector3 position_correction = subvector(a[j],0,3);
@@ -912,6 +962,52 @@ void run_bundle_adjustment(AdjusterT &adjuster,
 }
 /* }}} */
 
+/* {{{ write_timing */
+template <class AdjusterT>
+void write_timing(fs::path const& file,
+        std::string const& ba_type,
+        AdjusterT const& adjuster,
+        BundleAdjustmentModel &ba_model,
+        double total_seconds)
+{
+  bool is_new = !fs::exists(file);
+  fs::ofstream ostr(file, std::ios::app);
+  if (!ostr)
+    vw_throw(IOErr() << "Could not open timing file " << file.string());
+
+  AdjustPhase phases[NumAdjustPhases] = { JacobianPhase, SchurPhase, FactorPhase, UpdatePhase };
+  if (fs::extension(file) == ".json") {
+    ostr << "{\"time\": " << time(0)
+         << ", \"ba_type\": \"" << ba_type << "\""
+         << ", \"cameras\": " << ba_model.num_cameras()
+         << ", \"points\": " << ba_model.num_points()
+         << ", \"measures\": " << ba_model.num_pixel_observations()
+         << ", \"threads\": " << vw_settings().default_num_threads()
+         << ", \"iterations\": " << adjuster.iterations()
+         << ", \"total_seconds\": " << total_seconds;
+    for (int p = 0; p < NumAdjustPhases; ++p)
+      ostr << ", \"" << adjust_phase_name(phases[p]) << "_seconds\": "
+           << adjuster.phase_seconds(phases[p]);
+    ostr << "}" << endl;
+  } else {
+    if (is_new) {
+      ostr << "time,ba_type,cameras,points,measures,threads,iterations,total_seconds";
+      for (int p = 0; p < NumAdjustPhases; ++p)
+        ostr << "," << adjust_phase_name(phases[p]) << "_seconds";
+      ostr << endl;
+    }
+    ostr << time(0) << "," << ba_type << ","
+         << ba_model.num_cameras() << "," << ba_model.num_points() << ","
+         << ba_model.num_pixel_observations() << ","
+         << vw_settings().default_num_threads() << ","
+         << adjuster.iterations() << "," << total_seconds;
+    for (int p = 0; p < NumAdjustPhases; ++p)
+      ostr << "," << adjuster.phase_seconds(phases[p]);
+    ostr << endl;
+  }
+}
+/* }}} write_timing */
+
 /* {{{ adjust_bundles */
 template <class AdjusterT, class CostT>
 void adjust_bundles(BundleAdjustmentModel &ba_model, CostT const &cost_func,
@@ -944,8 +1040,15 @@ void adjust_bundles(BundleAdjustmentModel &ba_model, CostT const &cost_func,
       reporter(ba_type_str, ba_model, bundle_adjuster, config.report_level );
 
   // Run bundle adjustment
+  Stopwatch total_watch;
+  total_watch.start();
   run_bundle_adjustment<AdjusterT>(bundle_adjuster, reporter, results_dir,
       config.max_iterations, config.save_iteration_data);
+  total_watch.stop();
+
+  if (!config.timing_file.empty())
+    write_timing(config.timing_file, ba_type_to_string(config.bundle_adjustment_type),
+        bundle_adjuster, ba_model, total_watch.elapsed_seconds());
 
  // If we want to remove outliers, do the process again
   if (config.remove_outliers) {
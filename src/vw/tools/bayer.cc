@@ -13,11 +13,16 @@
 
 #include <iostream>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ProgressCallback.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageView.h>
 #include <vw/Camera/BayerFilter.h>
 
 using namespace vw;
@@ -30,7 +35,8 @@ int main( int argc, char *argv[] ) {
   desc.add_options()
     ("help,h", "Display this help message")
     ("input-file", po::value<std::string>(&input_file_name), "Explicitly specify the input file")
-    ("output-file,o", po::value<std::string>(&output_file_name)->default_value("output.png"), "Specify the output file");
+    ("output-file,o", po::value<std::string>(&output_file_name)->default_value("output.png"), "Specify the output file")
+    ("malvar", "Use gradient-corrected (Malvar-He-Cutler) rather than bilinear interpolation");
   po::positional_options_description p;
   p.add("input-file", 1);
 
@@ -57,11 +63,20 @@ int main( int argc, char *argv[] ) {
   }
 
   try {
-    ImageView<PixelGray<float> > image;
-    read_image( image, input_file_name );
+    // The demosaic views are lazy, so the image is read, filtered and
+    // written a tile at a time on all threads.
+    DiskImageView<PixelGray<float> > image( input_file_name );
+    ImageViewRef<PixelRGB<float> > result;
+    if( vm.count("malvar") )
+      result = camera::bayer_demosaic_malvar(image);
+    else
+      result = camera::bayer_demosaic(image);
 
-    ImageView<PixelRGB<float> > result = camera::inverse_bayer_filter(image);
-    write_image( output_file_name, result );
+    boost::scoped_ptr<DiskImageResource> r( DiskImageResource::create( output_file_name, result.format() ) );
+    if( r->has_block_write() )
+      r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                         vw_settings().default_tile_size() ) );
+    block_write_image( *r, result, TerminalProgressCallback( "tools.bayer", "Writing:" ) );
   }
   catch (const Exception& e) {
     std::cerr << "Error: " << e.what() << std::endl;
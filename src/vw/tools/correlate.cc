@@ -60,7 +60,7 @@ int main( int argc, char *argv[] ) {
       ("lrthresh", po::value(&lrthresh)->default_value(2), "Left/right correspondence threshold")
       ("csthresh", po::value(&corrscore_thresh)->default_value(1.0), "Correlation score rejection threshold (1.0 is Off <--> 2.0 is Aggressive outlier rejection")
       ("cost-blur", po::value(&cost_blur)->default_value(1), "Kernel size for bluring the cost image")
-      ("correlator-type", po::value(&correlator_type)->default_value(0), "0 - Abs difference; 1 - Sq Difference; 2 - NormXCorr")
+      ("correlator-type", po::value(&correlator_type)->default_value(0), "0 - Abs difference; 1 - Sq Difference; 2 - NormXCorr; 3 - Census; 4 - Rank")
       ("hsubpix", "Enable horizontal sub-pixel correlation")
       ("vsubpix", "Enable vertical sub-pixel correlation")
       ("affine-subpix", "Enable affine adaptive sub-pixel correlation (slower, but more accurate)")
@@ -128,6 +128,10 @@ int main( int argc, char *argv[] ) {
       corr_type = SQR_DIFF_CORRELATOR;
     else if (correlator_type == 2)
       corr_type = NORM_XCORR_CORRELATOR;
+    else if (correlator_type == 3)
+      corr_type = CENSUS_CORRELATOR;
+    else if (correlator_type == 4)
+      corr_type = RANK_CORRELATOR;
 
     ImageView<PixelMask<Vector2f> > disparity_map;
     if (vm.count("reference")) {
@@ -19,6 +19,7 @@
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/Filter.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/Core/ThreadPool.h>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
@@ -38,6 +39,8 @@ bool tile_output = false;
 unsigned int patch_size, patch_overlap;
 float nodata_value;
 bool has_nodata_value = false;
+bool tiled = false;
+unsigned int num_threads, max_open_files;
 
 // Creates an alpha channel based on pixels with a value of zero.  The
 // first version covers scalar types.  The remaining versions cover
@@ -100,6 +103,49 @@ mask_to_nodata(vw::ImageViewBase<ViewT> const& view, float nodata_value = 0 ) {
   return vw::per_pixel_filter(view.impl(), MaskToNodataFunctor<typename ViewT::pixel_type>(nodata_value));
 }
 
+// Writes one tile of --tile-output, georeferenced at its upper left.
+template <class ImageT>
+void write_tile( ImageViewBase<ImageT> const& image, BBox2i const& tile_bbox, GeoReference const& georef,
+                 ProgressCallback const& progress_callback ) {
+  ImageView<typename ImageT::pixel_type> tile_view = crop(image.impl(), tile_bbox);
+  GeoReference tile_georef = georef;
+
+  // Adjust the affine transformation's offset to point to the upper
+  // left of this tile.
+  Vector2 upper_left = georef.pixel_to_point( Vector2(tile_bbox.min()) );
+  Matrix3x3 tile_transform = tile_georef.transform();
+  tile_transform(0,2) += upper_left[0];
+  tile_transform(1,2) += upper_left[1];
+  tile_georef.set_transform(tile_transform);
+
+  // Filename for this tile.
+  std::stringstream tile_filename;
+  tile_filename << mosaic_name;
+  tile_filename << '.' << tile_bbox.min().x() << '.' << tile_bbox.min().y() << '.';
+  tile_filename << output_file_type;
+
+  // Finally, write.
+  write_georeferenced_image( tile_filename.str(), tile_view, tile_georef, progress_callback );
+}
+
+// Writes one tile of --tile-output on a work queue thread.
+template <class ImageT>
+class WriteTileTask : public Task {
+  ImageT const& m_image;
+  BBox2i m_tile_bbox;
+  GeoReference const& m_georef;
+  SubProgressCallback m_progress;
+public:
+  WriteTileTask( ImageT const& image, BBox2i const& tile_bbox, GeoReference const& georef,
+                 ProgressCallback const& progress_callback, int num_tiles )
+    : m_image(image), m_tile_bbox(tile_bbox), m_georef(georef),
+      m_progress(progress_callback, 0.0, 1.0/float(num_tiles)) {}
+  virtual void operator()() {
+    write_tile( m_image, m_tile_bbox, m_georef, ProgressCallback::dummy_instance() );
+    m_progress.report_incremental_progress(1.0);
+  }
+};
+
 // do_blend()
 //
 template <class PixelT>
@@ -177,12 +223,14 @@ void do_blend() {
 
   tpc.set_progress_text( "Status (assembling): " );
   SubProgressCallback assembling_pc( tpc, 0.05, 0.1 );
-  // Second pass: add files to the image composite.
+  // Second pass: add files to the image composite.  In tiled mode
+  // the inputs are read uncached, so each tile reads just the windows
+  // of the inputs it overlaps, through the pool of open files.
   for(unsigned i = 0; i < image_files.size(); ++i) {
     assembling_pc.report_fractional_progress(i, image_files.size() );
     GeoReference input_georef;
     read_georeference(input_georef, image_files[i]);
-    DiskImageView<PixelT> source_disk_image( image_files[i] );
+    DiskImageView<PixelT> source_disk_image( image_files[i], tiled ? 0 : &vw_system_cache() );
 
     GeoTransform trans(input_georef, output_georef);
     BBox2 output_bbox = trans.forward_bbox( BBox2(0,0,source_disk_image.cols(),source_disk_image.rows()) );
@@ -213,36 +261,32 @@ void do_blend() {
   // Output the image in tiles, or one large image.
   if(tile_output) {
     const int dim = patch_size - patch_overlap;
-    const int tile_width = composite.cols() / dim;
-    const int tile_height = composite.rows() / dim;
-    vw_out(vw::VerboseDebugMessage) << "Outputting composite in " << tile_width * tile_height << " tiles." << std::endl;
-
+    const BBox2i composite_bbox(0, 0, composite.cols(), composite.rows());
+    std::vector<BBox2i> tile_bboxes;
     for(int i=0; i < composite.rows(); i += dim) {
       for(int j=0; j < composite.cols(); j += dim) {
         BBox2i tile_bbox(j, i, dim, dim);
-        if(tile_bbox.max().x() >= composite.cols()) tile_bbox.max().x() = composite.cols();
-        if(tile_bbox.max().y() >= composite.rows()) tile_bbox.max().y() = composite.cols();
-        ImageView<PixelT> tile_view = crop(channel_cast_rescale<typename PixelChannelType<PixelT>::type>(composite), tile_bbox);
-        GeoReference tile_georef = output_georef;
-
-        // Adjust the affine transformation's offset to point to the upper
-        // left of this tile.
-        Vector2 upper_left = output_georef.pixel_to_point( Vector2(j, i) );
-        Matrix3x3 tile_transform = tile_georef.transform();
-        tile_transform(0,2) += upper_left[0];
-        tile_transform(1,2) += upper_left[1];
-        tile_georef.set_transform(tile_transform);
-
-        // Filename for this tile.
-        std::stringstream tile_filename;
-        tile_filename << mosaic_name;
-        tile_filename << '.' << j << '.' << i << '.';
-        tile_filename << output_file_type;
-
-        // Finally, write.
-        write_georeferenced_image( tile_filename.str(), tile_view, tile_georef, blending_pc );
+        tile_bbox.crop(composite_bbox);
+        tile_bboxes.push_back(tile_bbox);
       }
     }
+    vw_out(vw::VerboseDebugMessage) << "Outputting composite in " << tile_bboxes.size() << " tiles." << std::endl;
+
+    typedef typename PixelChannelType<PixelT>::type output_channel_type;
+    typedef UnaryPerPixelView<vw::mosaic::ImageComposite<float_pixel_type>, PixelChannelCastRescaleFunctor<output_channel_type> > output_view_type;
+    output_view_type output_view = channel_cast_rescale<output_channel_type>(composite);
+    if(tiled) {
+      // Blend and write the tiles in parallel, each from the inputs
+      // that overlap it.
+      FifoWorkQueue queue( num_threads ? num_threads : vw_settings().default_num_threads() );
+      for(size_t t = 0; t < tile_bboxes.size(); ++t)
+        queue.add_task( boost::shared_ptr<Task>( new WriteTileTask<output_view_type>( output_view, tile_bboxes[t], output_georef,
+                                                                                     blending_pc, int(tile_bboxes.size()) ) ) );
+      queue.join_all();
+    } else {
+      for(size_t t = 0; t < tile_bboxes.size(); ++t)
+        write_tile( output_view, tile_bboxes[t], output_georef, blending_pc );
+    }
   } else {
     vw_out(vw::VerboseDebugMessage) << "Output image:" << std::endl
                                     << "\tTransform: " << output_affine << std::endl
@@ -265,9 +309,17 @@ void do_blend() {
     else
       out_resource = new DiskImageResourceGDAL( mosaic_filename, out_image.format() );
 
-    // Finally, write.
+    // Finally, write.  Tiled mode blends patch-size blocks in parallel,
+    // or the blocks of a tiled TIFF.
     write_georeference(*out_resource, output_georef);
-    write_image(*out_resource, out_image, blending_pc);
+    if(tiled) {
+      BlockWriteConfig config;
+      if(tilesize == 0) config.block_size = Vector2i(patch_size, patch_size);
+      config.num_threads = num_threads;
+      block_write_image(*out_resource, out_image, config, blending_pc);
+    } else {
+      write_image(*out_resource, out_image, blending_pc);
+    }
     delete out_resource;
   }
   blending_pc.report_finished();
@@ -287,6 +339,9 @@ int main( int argc, char *argv[] ) {
       ("patch-size", po::value<unsigned int>(&patch_size)->default_value(256), "Patch size for tiled output, in pixels")
       ("patch-overlap", po::value<unsigned int>(&patch_overlap)->default_value(0), "Patch overlap for tiled output, in pixels")
       ("draft", "Draft mode (no blending)")
+      ("tiled", "Blend in parallel patch-size tiles, reading for each only the inputs it overlaps, so memory follows the tile size and overlap depth rather than the number of inputs")
+      ("threads", po::value<unsigned int>(&num_threads)->default_value(0), "Number of threads for tiled blending (0 for the default)")
+      ("max-open-files", po::value<unsigned int>(&max_open_files)->default_value(64), "The most input files to hold open at once in tiled mode")
       ("ignore-alpha", "Ignore the alpha channel of the input images, and don't write an alpha channel in output.")
       ("nodata-value", po::value<float>(&nodata_value), "Pixel value to use for nodata in input and output (when there's no alpha channel)")
       ("channel-type", po::value<std::string>(&channel_type_str), "Images' channel type. One of [uint8, uint16, int16, float].")
@@ -336,6 +391,14 @@ int main( int argc, char *argv[] ) {
 
     if(vm.count("tile-output")) tile_output = true;
 
+    // Tiled mode opens the inputs through the pool of open files,
+    // unless it has already been sized (e.g. in ~/.vwrc).
+    if(vm.count("tiled")) {
+      tiled = true;
+      if(vw_settings().max_open_resources() == 0)
+        vw_settings().set_max_open_resources( (std::max)(max_open_files, 1u) );
+    }
+
     if( patch_size <= 0 ) {
       std::cerr << "Error: The patch size must be a positive number!  (You specified " << patch_size << ".)" << std::endl;
       std::cerr << usage << std::endl;
@@ -120,7 +120,7 @@ create_alpha( ImageViewBase<Image1T> const& image1,
 }
 
 struct Options {
-  Options() : nodata(-1), feather_min(0), feather_max(0) {}
+  Options() : nodata(-1), feather_min(0), feather_max(0), euclidean(false) {}
   // Input
   std::vector<std::string> input_files;
 
@@ -132,8 +132,30 @@ struct Options {
   std::string output_filename;
   bool force_float;
   float blur_sigma;
+  bool euclidean;
 };
 
+// The distance of each valid pixel from the nearest invalid one.
+// Without a feather length, the whole image's distances are needed
+// to find their maximum.  With one, the Euclidean distance is only
+// needed out to that length, and is computed a block at a time as
+// the output is written.
+template <class ViewT>
+ImageViewRef<float> feather_distance( Options& opt, ImageViewBase<ViewT> const& valid ) {
+  if ( !opt.euclidean ) {
+    ImageView<int32> distance = grassfire(valid);
+    if (opt.feather_max < 1)
+      opt.feather_max = max_pixel_value( distance );
+    return pixel_cast<float>(distance);
+  }
+  if (opt.feather_max < 1) {
+    ImageView<float> distance = euclidean_distance(valid);
+    opt.feather_max = max_pixel_value( distance );
+    return distance;
+  }
+  return capped_euclidean_distance(valid, opt.feather_max);
+}
+
 // Operation code for data that uses nodata
 template <class PixelT>
 void grassfire_nodata( Options& opt,
@@ -145,27 +167,24 @@ void grassfire_nodata( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance =
-    grassfire(notnodata(input_image,
-                        inter_type(opt.nodata)));
-
-  // Check to see if the user has specified a feather length.  If not,
-  // then we send the feather_max to the max pixel value (which
-  // results in a full grassfire blend all the way to the center of the image.)
-  if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+  // If the user has not specified a feather length, feather_max is
+  // set to the max distance (which results in a full grassfire blend
+  // all the way to the center of the image.)
+  ImageViewRef<float> distance =
+    feather_distance(opt, notnodata(input_image,
+                                    inter_type(opt.nodata)));
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   ImageViewRef<inter_type> norm_dist;
   norm_dist = pixel_cast<inter_type>(range_type::max() / (opt.feather_max - opt.feather_min) *
-                                     clamp(pixel_cast<float>(distance) - opt.feather_min,
+                                     clamp(distance - opt.feather_min,
                                            0.0, opt.feather_max - opt.feather_min));
 
   // The user may wish to blur the grassfire result before applying
   // the transfer function.  This makes for an even smoother blend.
   if (opt.blur_sigma > 0)
     norm_dist = gaussian_filter(pixel_cast<inter_type>(range_type::max() / (opt.feather_max - opt.feather_min) *
-                                                       clamp(pixel_cast<float>(distance) - opt.feather_min,
+                                                       clamp(distance - opt.feather_min,
                                                              0.0, opt.feather_max - opt.feather_min)), opt.blur_sigma);
 
   ImageViewRef<typename PixelWithAlpha<PixelT>::type> result;
@@ -191,13 +210,11 @@ void grassfire_alpha( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance = grassfire(apply_mask(invert_mask(alpha_to_mask(input_image)),1));
-
-  // Check to see if the user has specified a feather length.  If not,
-  // then we send the feather_max to the max pixel value (which
-  // results in a full grassfire blend all the way to the center of the image.)
-  if (opt.feather_max < 1)
-    opt.feather_max = max_pixel_value( distance );
+  // If the user has not specified a feather length, feather_max is
+  // set to the max distance (which results in a full grassfire blend
+  // all the way to the center of the image.)
+  ImageViewRef<float> distance =
+    feather_distance(opt, apply_mask(invert_mask(alpha_to_mask(input_image)),1));
   vw_out() << "\t--> Distance range: [ " << opt.feather_min << " " << opt.feather_max << " ]\n";
 
   typedef typename CompoundChannelType<PixelT>::type inter_type;
@@ -205,7 +222,7 @@ void grassfire_alpha( Options& opt,
 
   ImageViewRef<inter_type> norm_dist;
   norm_dist = pixel_cast<inter_type>(range_type::max() / (opt.feather_max - opt.feather_min) *
-                                     clamp(pixel_cast<float>(distance) - opt.feather_min,
+                                     clamp(distance - opt.feather_min,
                                            0.0, opt.feather_max - opt.feather_min));
 
   ImageViewRef<PixelT> result;
@@ -236,6 +253,7 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("output-filename,o", po::value(&opt.output_filename), "Filename to use for output files.")
     ("cache", po::value(&cache_size)->default_value(1024), "Source data cache size, in megabytes")
     ("blur-sigma", po::value<float>(&opt.blur_sigma)->default_value(0), "Blur the grassfire result before appyling the tranfer function to create an even smoother blend.")
+    ("euclidean", "Feather by straight-line distance from an edge rather than by 4-connected (Manhattan) distance.")
     ("force-float", "Force the data to be read in as a float.  This option also turns off auto-rescaling.  Useful for reading 16-bit integer DEMs as though they were full of floats.")
     ("help,h", "Display this help message");
 
@@ -268,6 +286,8 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     vw_throw( ArgumentErr() << "Missing input files!\n"
               << usage.str() << general_options );
 
+  opt.euclidean = vm.count("euclidean");
+
   if ( vm.count("force-float") )
     opt.force_float = true;
   else
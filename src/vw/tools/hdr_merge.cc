@@ -30,6 +30,8 @@ namespace po = boost::program_options;
 #include <vw/FileIO.h>
 #include <vw/HDR.h>
 
+#include <boost/scoped_ptr.hpp>
+
 #include <vector>
 #include <string>
 
@@ -110,8 +112,16 @@ int main( int argc, char *argv[] ) {
     }
 
     TerminalProgressCallback tpc( "tools.hdr_merge", "Processing");
-    // Create the HDR images and write the results to the file
-    write_image(output_filename, HighDynamicRangeView<PixelRGB<float> > (images, curves, brightness_values), tpc);
+    // Create the HDR image and write it to the file a block at a time,
+    // so the exposures are never all in memory.
+    ImageFormat fmt(images[0].format());
+    fmt.pixel_format = PixelFormatID<PixelRGB<float> >::value;
+    fmt.channel_type = VW_CHANNEL_FLOAT32;
+    boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(output_filename, fmt));
+    if ( r->has_block_write() )
+      r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                         vw_settings().default_tile_size() ) );
+    write_hdr_image(*r, images, curves, brightness_values, tpc);
 
   } catch (const vw::Exception& e) {
     vw_out() << argv[0] << ": a Vision Workbench error occurred: \n\t"
@@ -30,10 +30,11 @@ namespace fs = boost::filesystem;
 #include <vw/Image/Filter.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/MaskViews.h>
-#include <vw/Image/PerPixelAccessorViews.h>
+#include <vw/Image/PerPixelViews.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/DemGradient.h>
 #include <vw/tools/Common.h>
 
 using namespace vw;
@@ -54,46 +55,26 @@ struct Options {
 
 //  compute_normals()
 //
-// Compute a vector normal to the surface of a DEM for each given
-// pixel.  The normal is computed by forming a plane with three points
-// in the vicinity of the requested pixel, and then finding the vector
-// normal to that plane.  The user must specify the scale in the [u,v]
-// directions so that the direction of the vector in physical space
-// can be properly ascertained.  This is often contained in the (0,0)
-// and (1,1) entry of the georeference transform.
+// Compute a vector normal to the surface of a DEM from its gradient
+// in the map's x and y directions.  The normal is that of the plane
+// spanned by one pixel step in each direction, so it follows the
+// handedness given by the signs of the pixel scale in [u,v].
 class ComputeNormalsFunc : public ReturnFixedType<PixelMask<Vector3f> >
 {
-  float m_u_scale, m_v_scale;
+  float m_u_sign, m_v_sign;
 
 public:
   ComputeNormalsFunc(float u_scale, float v_scale) :
-    m_u_scale(u_scale), m_v_scale(v_scale) {}
+    m_u_sign(u_scale < 0 ? -1 : 1), m_v_sign(v_scale < 0 ? -1 : 1) {}
 
-  BBox2i work_area() const { return BBox2i(Vector2i(0, 0), Vector2i(1, 1)); }
-
-  template <class PixelAccessorT>
-  PixelMask<Vector3f> operator() (PixelAccessorT const& accessor_loc) const {
-    PixelAccessorT acc = accessor_loc;
-
-    // Pick out the three altitude values.
-    if (is_transparent(*acc))
-      return PixelMask<Vector3f>();
-    float alt1 = *acc;
-
-    acc.advance(1,0);
-    if (is_transparent(*acc))
+  PixelMask<Vector3f> operator() (PixelMask<Vector2f> const& gradient) const {
+    if (is_transparent(gradient))
       return PixelMask<Vector3f>();
-    float alt2 = *acc;
 
-    acc.advance(-1,1);
-    if (is_transparent(*acc))
-      return PixelMask<Vector3f>();
-    float alt3 = *acc;
-
-    // Form two orthogonal vectors in the plane containing the three
-    // altitude points
-    Vector3f n1(m_u_scale, 0, alt2-alt1);
-    Vector3f n2(0, m_v_scale, alt3-alt1);
+    // Form two vectors in the plane of the local surface, one pixel
+    // step apart in each direction.
+    Vector3f n1(m_u_sign, 0, m_u_sign*gradient.child()[0]);
+    Vector3f n2(0, m_v_sign, m_v_sign*gradient.child()[1]);
 
     // Return the vector normal to the local plane.
     return normalize(cross_prod(n1,n2));
@@ -101,10 +82,9 @@ public:
 };
 
 template <class ViewT>
-UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, ComputeNormalsFunc> compute_normals(ImageViewBase<ViewT> const& image,
-                                                                                                              float u_scale, float v_scale) {
-  return UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, ComputeNormalsFunc>(edge_extend(image.impl(), ConstantEdgeExtension()),
-                                                                                                       ComputeNormalsFunc (u_scale, v_scale));
+UnaryPerPixelView<ViewT, ComputeNormalsFunc> compute_normals(ImageViewBase<ViewT> const& gradient,
+                                                             float u_scale, float v_scale) {
+  return UnaryPerPixelView<ViewT, ComputeNormalsFunc>(gradient.impl(), ComputeNormalsFunc(u_scale, v_scale));
 }
 
 class DotProdFunc : public ReturnFixedType<PixelMask<PixelGray<float> > > {
@@ -132,17 +112,12 @@ void do_hillshade(Options& opt) {
   cartography::GeoReference georef;
   cartography::read_georeference(georef, opt.input_file_name);
 
-  // Select the pixel scale.
+  // Select the pixel scale.  Unless it is given, it comes from the
+  // georeference, per row and following the datum for geographic DEMs.
   float u_scale, v_scale;
   if (opt.scale == 0) {
-    if (georef.is_projected()) {
-      u_scale = georef.transform()(0,0);
-      v_scale = georef.transform()(1,1);
-    } else {
-      double meters_per_degree = 2*M_PI*georef.datum().semi_major_axis()/360.0;
-      u_scale = georef.transform()(0,0) * meters_per_degree;
-      v_scale = georef.transform()(1,1) * meters_per_degree;
-    }
+    u_scale = georef.transform()(0,0);
+    v_scale = georef.transform()(1,1);
   } else {
     u_scale = opt.scale;
     v_scale = -opt.scale;
@@ -176,9 +151,17 @@ void do_hillshade(Options& opt) {
     dem = gaussian_filter(dem, opt.blur_sigma);
   }
 
+  // Horn's gradient over each pixel's neighborhood, computed a tile at
+  // a time as the result is written.
+  ImageViewRef<PixelMask<Vector2f> > gradient;
+  if (opt.scale == 0)
+    gradient = cartography::dem_gradient(dem, georef);
+  else
+    gradient = cartography::dem_gradient(dem, Vector2(u_scale, v_scale));
+
   // The final result is the dot product of the light source with the normals
   ImageViewRef<PixelMask<PixelGray<uint8> > > shaded_image =
-    channel_cast_rescale<uint8>(clamp(dot_prod(compute_normals(dem, u_scale, v_scale), light)));
+    channel_cast_rescale<uint8>(clamp(dot_prod(compute_normals(gradient, u_scale, v_scale), light)));
 
   // Save the result
   vw_out() << "Writing shaded relief image: " << opt.output_file_name << "\n";
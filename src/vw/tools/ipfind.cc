@@ -108,7 +108,7 @@ static void write_debug_image( std::string const& out_file_name,
 
 int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
-  std::string interest_operator, descriptor_generator;
+  std::string interest_operator, descriptor_generator, cache_dir;
   float ip_gain;
   uint32 max_points;
   int tile_size, num_threads;
@@ -124,8 +124,11 @@ int main(int argc, char** argv) {
     ("num-threads", po::value(&num_threads)->default_value(0), "Set the number of threads for interest point detection.  Setting the num_threads to zero causes ipfind to use the visionworkbench default number of threads.")
     ("tile-size,t", po::value(&tile_size), "Specify the tile size for processing interest points. (Useful when working with large images).")
     ("lowe,l", "Save the interest points in an ASCII data format that is compatible with the Lowe-SIFT toolchain.")
+    ("compact", "Save the interest points in the columnar .vwip2 format, which can be read in place.")
     ("normalize", "Normalize the input, use for images that have non standard values such as ISIS cube files.")
     ("debug-image,d", "Write out debug images.")
+    ("cache", "Reuse the interest points found by an earlier run on the same image with the same options.  They are kept in a .vwip2 file next to the image.")
+    ("cache-dir", po::value(&cache_dir), "Keep the cached interest points in this directory instead.  Implies --cache.")
 
     // Interest point detector options
     ("interest-operator", po::value(&interest_operator)->default_value("OBALoG"), "Choose an interest point metric from [LoG, Harris, OBALoG]")
@@ -134,7 +137,7 @@ int main(int argc, char** argv) {
     ("single-scale", "Turn off scale-invariant interest point detection.  This option only searches for interest points in the first octave of the scale space.")
 
     // Descriptor generator options
-    ("descriptor-generator", po::value(&descriptor_generator)->default_value("sgrad"), "Choose a descriptor generator from [patch,pca,sgrad,sgrad2]");
+    ("descriptor-generator", po::value(&descriptor_generator)->default_value("sgrad"), "Choose a descriptor generator from [patch,pca,sgrad,sgrad2,brief]");
 
   po::options_description hidden_options("");
   hidden_options.add_options()
@@ -192,12 +195,28 @@ int main(int argc, char** argv) {
   if ( !( descriptor_generator == "patch" ||
           descriptor_generator == "pca"   ||
           descriptor_generator == "sgrad" ||
-          descriptor_generator == "sgrad2" ) ) {
+          descriptor_generator == "sgrad2" ||
+          descriptor_generator == "brief" ) ) {
     vw_out() << "Unkown descriptor generator: " << descriptor_generator
-              << ". Options are : [ Patch, PCA, SGrad, SGrad2 ]\n";
+              << ". Options are : [ Patch, PCA, SGrad, SGrad2, BRIEF ]\n";
     exit(0);
   }
 
+  // Everything that changes the points found, other than the image
+  // itself, goes into the cache key.
+  bool use_cache = vm.count("cache") || vm.count("cache-dir");
+  InterestPointCache cache( cache_dir );
+  std::string cache_settings;
+  if ( use_cache ) {
+    std::ostringstream ostr;
+    ostr << "ipfind 1 " << interest_operator << " " << ip_gain << " " << max_points
+         << " " << vm.count("single-scale") << " " << vm.count("normalize")
+         << " " << vw_settings().default_tile_size() << " " << descriptor_generator;
+    if ( descriptor_generator == "pca" )
+      ostr << " " << hash_file("pca_basis.exr") << " " << hash_file("pca_avg.exr");
+    cache_settings = ostr.str();
+  }
+
   // Iterate over the input files and find interest points in each.
   for (size_t i = 0; i < input_file_names.size(); ++i) {
 
@@ -216,117 +235,132 @@ int main(int argc, char** argv) {
       vw_out(DebugMessage,"interest_point") << "Image has a nodata value: "
                                             << image_rsrc->nodata_read() << "\n";
 
-    // The max points sent to IP Detector class is applied to each
-    // tile of an image. In order to curb memory use we'll set the max
-    // size for each tile smaller (proportional to the number of
-    // tiles).
-    int number_tiles = (image.cols()/vw_settings().default_tile_size()+1) *
-      (image.rows()/vw_settings().default_tile_size()+1);
-    uint32 tile_max_points = uint32(float(max_points)/float(number_tiles))*2; // A little over shoot
-                                                                     // incase the tile is empty
-    if ( max_points == 0 ) tile_max_points = 0; // No culling
-    else if ( tile_max_points < 50 ) tile_max_points = 50;
-
-    // Detecting Interest Points
     InterestPointList ip;
-    if ( interest_operator == "harris" ) {
-      // Harris threshold is inversely proportional to gain.
-      HarrisInterestOperator interest_operator(IDEAL_HARRIS_THRESHOLD/ip_gain);
-      if (!vm.count("single-scale")) {
-        ScaledInterestPointDetector<HarrisInterestOperator> detector(interest_operator,
-                                                                     tile_max_points);
-        ip = detect_interest_points(image, detector);
-      } else {
-        InterestPointDetector<HarrisInterestOperator> detector(interest_operator,
-                                                               tile_max_points);
-        ip = detect_interest_points(image, detector);
-      }
-    } else if ( interest_operator == "log") {
-      // Use a scale-space Laplacian of Gaussian feature detector. The
-      // associated threshold is abs(interest) > interest_threshold.
-      // LoG threshold is inversely proportional to gain..
-      LogInterestOperator interest_operator(IDEAL_LOG_THRESHOLD/ip_gain);
-      if (!vm.count("single-scale")) {
-        ScaledInterestPointDetector<LogInterestOperator> detector(interest_operator,
-                                                                  tile_max_points);
-        ip = detect_interest_points(image, detector);
-      } else {
-        InterestPointDetector<LogInterestOperator> detector(interest_operator,
-                                                            tile_max_points);
+    std::string cache_file;
+    if ( use_cache )
+      cache_file = cache.cache_file( input_file_names[i], cache_settings );
+    if ( use_cache && cache.load( cache_file, ip ) ) {
+      vw_out() << "\t Read " << ip.size() << " cached points.\n";
+    } else {
+      // The max points sent to IP Detector class is applied to each
+      // tile of an image. In order to curb memory use we'll set the max
+      // size for each tile smaller (proportional to the number of
+      // tiles).
+      int number_tiles = (image.cols()/vw_settings().default_tile_size()+1) *
+        (image.rows()/vw_settings().default_tile_size()+1);
+      uint32 tile_max_points = uint32(float(max_points)/float(number_tiles))*2; // A little over shoot
+                                                                       // incase the tile is empty
+      if ( max_points == 0 ) tile_max_points = 0; // No culling
+      else if ( tile_max_points < 50 ) tile_max_points = 50;
+
+      // Detecting Interest Points
+      if ( interest_operator == "harris" ) {
+        // Harris threshold is inversely proportional to gain.
+        HarrisInterestOperator interest_operator(IDEAL_HARRIS_THRESHOLD/ip_gain);
+        if (!vm.count("single-scale")) {
+          ScaledInterestPointDetector<HarrisInterestOperator> detector(interest_operator,
+                                                                       tile_max_points);
+          ip = detect_interest_points(image, detector);
+        } else {
+          InterestPointDetector<HarrisInterestOperator> detector(interest_operator,
+                                                                 tile_max_points);
+          ip = detect_interest_points(image, detector);
+        }
+      } else if ( interest_operator == "log") {
+        // Use a scale-space Laplacian of Gaussian feature detector. The
+        // associated threshold is abs(interest) > interest_threshold.
+        // LoG threshold is inversely proportional to gain..
+        LogInterestOperator interest_operator(IDEAL_LOG_THRESHOLD/ip_gain);
+        if (!vm.count("single-scale")) {
+          ScaledInterestPointDetector<LogInterestOperator> detector(interest_operator,
+                                                                    tile_max_points);
+          ip = detect_interest_points(image, detector);
+        } else {
+          InterestPointDetector<LogInterestOperator> detector(interest_operator,
+                                                              tile_max_points);
+          ip = detect_interest_points(image, detector);
+        }
+      } else if ( interest_operator == "obalog") {
+        // OBALoG threshold is inversely proportional to gain ..
+        OBALoGInterestOperator interest_operator(IDEAL_OBALOG_THRESHOLD/ip_gain);
+        IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator,
+                                                                        tile_max_points );
         ip = detect_interest_points(image, detector);
       }
-    } else if ( interest_operator == "obalog") {
-      // OBALoG threshold is inversely proportional to gain ..
-      OBALoGInterestOperator interest_operator(IDEAL_OBALOG_THRESHOLD/ip_gain);
-      IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator,
-                                                                      tile_max_points );
-      ip = detect_interest_points(image, detector);
-    }
-
-    // Removing Interest Points on nodata or within 1/px
-    if ( image_rsrc->has_nodata_read() ) {
-      ImageViewRef<PixelMask<PixelGray<float> > > image_mask =
-        create_mask(raw_image,image_rsrc->nodata_read());
-      BBox2i bound = bounding_box( image_mask );
-      bound.contract(1);
-      int before_size = ip.size();
-      for ( InterestPointList::iterator point = ip.begin();
-            point != ip.end(); ++point ) {
-
-        // To Avoid out of index issues
-        if ( !bound.contains( Vector2i(point->ix,
-                                       point->iy ))) {
-          point = ip.erase(point);
-          point--;
-          continue;
-        }
 
-        if ( !image_mask(point->ix,point->iy).valid() ||
-             !image_mask(point->ix+1,point->iy+1).valid() ||
-             !image_mask(point->ix+1,point->iy).valid() ||
-             !image_mask(point->ix+1,point->iy-1).valid() ||
-             !image_mask(point->ix,point->iy+1).valid() ||
-             !image_mask(point->ix,point->iy-1).valid() ||
-             !image_mask(point->ix-1,point->iy+1).valid() ||
-             !image_mask(point->ix-1,point->iy).valid() ||
-             !image_mask(point->ix-1,point->iy-1).valid() ) {
-          point = ip.erase(point);
-          point--;
-          continue;
+      // Removing Interest Points on nodata or within 1/px
+      if ( image_rsrc->has_nodata_read() ) {
+        ImageViewRef<PixelMask<PixelGray<float> > > image_mask =
+          create_mask(raw_image,image_rsrc->nodata_read());
+        BBox2i bound = bounding_box( image_mask );
+        bound.contract(1);
+        int before_size = ip.size();
+        for ( InterestPointList::iterator point = ip.begin();
+              point != ip.end(); ++point ) {
+
+          // To Avoid out of index issues
+          if ( !bound.contains( Vector2i(point->ix,
+                                         point->iy ))) {
+            point = ip.erase(point);
+            point--;
+            continue;
+          }
+
+          if ( !image_mask(point->ix,point->iy).valid() ||
+               !image_mask(point->ix+1,point->iy+1).valid() ||
+               !image_mask(point->ix+1,point->iy).valid() ||
+               !image_mask(point->ix+1,point->iy-1).valid() ||
+               !image_mask(point->ix,point->iy+1).valid() ||
+               !image_mask(point->ix,point->iy-1).valid() ||
+               !image_mask(point->ix-1,point->iy+1).valid() ||
+               !image_mask(point->ix-1,point->iy).valid() ||
+               !image_mask(point->ix-1,point->iy-1).valid() ) {
+            point = ip.erase(point);
+            point--;
+            continue;
+          }
         }
+        vw_out(InfoMessage,"interest_point") << "Removed " << before_size-ip.size() << " points close to nodata.\n";
       }
-      vw_out(InfoMessage,"interest_point") << "Removed " << before_size-ip.size() << " points close to nodata.\n";
-    }
 
-    vw_out() << "\t Found " << ip.size() << " points.\n";
+      vw_out() << "\t Found " << ip.size() << " points.\n";
 
-    // Additional Culling for the entire image
-    if ( max_points > 0  && ip.size() > max_points ) {
-      ip.sort();
-      ip.resize(max_points);
-      vw_out() << "\t Culled to " << ip.size() << " points.\n";
-    }
+      // Additional Culling for the entire image
+      if ( max_points > 0  && ip.size() > max_points ) {
+        ip.sort();
+        ip.resize(max_points);
+        vw_out() << "\t Culled to " << ip.size() << " points.\n";
+      }
+
+      // Generate descriptors for interest points.
+      vw_out(InfoMessage) << "\tRunning " << descriptor_generator << " descriptor generator.\n";
+      if (descriptor_generator == "patch") {
+        PatchDescriptorGenerator descriptor;
+        descriptor(image, ip);
+      } else if (descriptor_generator == "pca") {
+        PCASIFTDescriptorGenerator descriptor("pca_basis.exr", "pca_avg.exr");
+        descriptor(image, ip);
+      } else if (descriptor_generator == "sgrad") {
+        SGradDescriptorGenerator descriptor;
+        descriptor(image, ip);
+      } else if (descriptor_generator == "sgrad2") {
+        SGrad2DescriptorGenerator descriptor;
+        descriptor(image, ip);
+      } else if (descriptor_generator == "brief") {
+        BRIEFDescriptorGenerator descriptor;
+        descriptor(image, ip);
+      }
 
-    // Generate descriptors for interest points.
-    vw_out(InfoMessage) << "\tRunning " << descriptor_generator << " descriptor generator.\n";
-    if (descriptor_generator == "patch") {
-      PatchDescriptorGenerator descriptor;
-      descriptor(image, ip);
-    } else if (descriptor_generator == "pca") {
-      PCASIFTDescriptorGenerator descriptor("pca_basis.exr", "pca_avg.exr");
-      descriptor(image, ip);
-    } else if (descriptor_generator == "sgrad") {
-      SGradDescriptorGenerator descriptor;
-      descriptor(image, ip);
-    } else if (descriptor_generator == "sgrad2") {
-      SGrad2DescriptorGenerator descriptor;
-      descriptor(image, ip);
+      if ( use_cache )
+        cache.store( cache_file, ip );
     }
 
     // If ASCII output was requested, write it out.  Otherwise stick
     // with binary output.
     if (vm.count("lowe"))
       write_lowe_ascii_ip_file(file_prefix + ".key", ip);
+    else if (vm.count("compact"))
+      write_compact_ip_file(file_prefix + ".vwip2", ip);
     else
       write_binary_ip_file(file_prefix + ".vwip", ip);
 
@@ -25,6 +25,7 @@ using namespace vw::ip;
 namespace po = boost::program_options;
 
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
 // Draw the two images side by side with matching interest points
@@ -93,17 +94,31 @@ static void write_match_image(std::string const& out_file_name,
 		     TerminalProgressCallback( "tools.ipmatch", "Writing Debug:" ) );
 }
 
+// Reads the interest points found by ipfind for an image, from its
+// .vwip file or else its .vwip2 file.
+static std::vector<InterestPoint> read_image_ip_file(std::string const& image_file) {
+  std::string ip_file = fs::path(image_file).replace_extension("vwip").string();
+  std::string compact_file = fs::path(image_file).replace_extension("vwip2").string();
+  if ( !fs::exists(ip_file) && fs::exists(compact_file) )
+    return read_compact_ip_file(compact_file);
+  return read_binary_ip_file(ip_file);
+}
+
 int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
   double matcher_threshold;
   std::string ransac_constraint;
   float inlier_threshold;
+  size_t checks;
+  double duplicate_radius;
 
   po::options_description general_options("Options");
   general_options.add_options()
     ("help,h", "Display this help message")
     ("matcher-threshold,t", po::value(&matcher_threshold)->default_value(0.6), "Threshold for the interest point matcher.")
     ("non-kdtree", "Use an implementation of the interest matcher that is not reliant on a KDTree algorithm")
+    ("checks", po::value(&checks)->default_value(0), "Descriptors the KDTree matcher compares per point, or 0 for an exact search.")
+    ("duplicate-radius", po::value(&duplicate_radius)->default_value(0), "Keep only one match within this many pixels, or only drop matches at the same location for 0.")
     ("ransac-constraint,r", po::value(&ransac_constraint)->default_value("similarity"), "RANSAC constraint type.  Choose one of: [similarity, homography, fundamental, or none].")
     ("inlier-threshold,i", po::value(&inlier_threshold)->default_value(10), "RANSAC inlier threshold.")
     ("debug-image,d", "Write out debug images.");
@@ -144,23 +159,35 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  // Iterate over combinations of the input files and find interest points in each.
-  for (size_t i = 0; i < input_file_names.size(); ++i) {
-    for (size_t j = i+1; j < input_file_names.size(); ++j) {
+  // Iterate over combinations of the input files and match their
+  // interest points.  Each file is matched against those before it,
+  // so the index over its points is built once for all of them.
+  for (size_t j = 1; j < input_file_names.size(); ++j) {
+    std::vector<InterestPoint> ip2 = read_image_ip_file(input_file_names[j]);
+    boost::shared_ptr<InterestPointIndex> index2;
+
+    for (size_t i = 0; i < j; ++i) {
 
       // Read each file off disk
-      std::vector<InterestPoint> ip1, ip2;
-      ip1 = read_binary_ip_file(fs::path(input_file_names[i]).replace_extension("vwip").string() );
-      ip2 = read_binary_ip_file(fs::path(input_file_names[j]).replace_extension("vwip").string() );
+      std::vector<InterestPoint> ip1;
+      ip1 = read_image_ip_file(input_file_names[i]);
       vw_out() << "Matching between " << input_file_names[i] << " (" << ip1.size() << " points) and " << input_file_names[j] << " (" << ip2.size() << " points).\n";
 
       std::vector<InterestPoint> matched_ip1, matched_ip2;
 
-      if ( !vm.count("non-kdtree") ) {
-        // Run interest point matcher that uses KDTree algorithm.
-        InterestPointMatcher<L2NormMetric,NullConstraint> matcher(matcher_threshold);
+      bool binary = !ip1.empty() && !ip1.front().binary_descriptor.empty();
+      if ( binary ) {
+        // Binary descriptors are compared by their Hamming distance.
+        BinaryMatcher matcher(matcher_threshold);
         matcher(ip1, ip2, matched_ip1, matched_ip2, false,
                 TerminalProgressCallback( "tools.ipmatch","Matching:"));
+      } else if ( !vm.count("non-kdtree") ) {
+        // Run interest point matcher that uses KDTree algorithm.
+        if ( !index2 )
+          index2.reset( new InterestPointIndex( ip2 ) );
+        InterestPointMatcher<L2NormMetric,NullConstraint> matcher(matcher_threshold, L2NormMetric(), NullConstraint(), checks);
+        matcher(ip1, *index2, matched_ip1, matched_ip2, false,
+                TerminalProgressCallback( "tools.ipmatch","Matching:"));
       } else {
         // Run interest point matcher that does not use KDTree algorithm.
         InterestPointMatcherSimple<L2NormMetric,NullConstraint> matcher(matcher_threshold);
@@ -168,7 +195,7 @@ int main(int argc, char** argv) {
                 TerminalProgressCallback( "tools.ipmatch","Matching:"));
       }
 
-      remove_duplicates(matched_ip1, matched_ip2);
+      remove_duplicates(matched_ip1, matched_ip2, duplicate_radius);
       vw_out() << "Found " << matched_ip1.size() << " putative matches.\n";
 
       std::vector<Vector3> ransac_ip1 = iplist_to_vectorlist(matched_ip1),
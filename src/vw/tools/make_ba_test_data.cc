@@ -70,7 +70,10 @@
  *    it is visible in at least two cameras. If so, it is added to the
  *    synthetic control network, along with control measures representing the
  *    pixel coordinates in the image reference frame of each camera in which
- *    it is visible.
+ *    it is visible. Points are generated until every camera sees at least
+ *    min-tiepoints-per-image of them, and the network holds at least
+ *    number-of-points, so that problems of a given size can be made for
+ *    benchmarking.
  *
  *    NB: A more flexible camera generation framework may be necessary at
  *    some point. To implement this you would need to make changes both to the
@@ -90,6 +93,9 @@
  *    by noise generation since they are not used as initial measurements by
  *    bundle adjustment.
  *
+ *    The random number generator is seeded from the clock, unless a nonzero
+ *    seed is given, in which case the same options always give the same data.
+ *
  *  OUTPUT:
  *
  *    make_ba_test_data generates multiple output files:
@@ -277,7 +283,9 @@ struct ProgramOptions {
   fs::path    data_dir;
   std::string config_file;
   int         min_tiepoints;
+  int         num_points;
   int         num_cameras;
+  unsigned    seed;
   friend std::ostream& operator<<(std::ostream& ostr, ProgramOptions o);
 };
 
@@ -293,6 +301,8 @@ std::ostream& operator<<(std::ostream& ostr, ProgramOptions o) {
   ostr << o.camera_euler_params << endl;
   ostr << "# of Cameras: " << o.num_cameras << endl;
   ostr << "Min # of Tiepoints per camera: " << o.min_tiepoints << endl;
+  ostr << "Min # of Points: " << o.num_points << endl;
+  ostr << "Random seed: " << o.seed << endl;
   ostr << "Data output directory: " << o.data_dir << endl;
   return ostr;
 }
@@ -394,9 +404,15 @@ ProgramOptions parse_options(int argc, char* argv[]) {
     ("min-tiepoints-per-image",
         po::value<int>(&opts.min_tiepoints)->default_value(50),
         "Minimum number of tiepoints that must be visible in each image")
+    ("number-of-points",
+        po::value<int>(&opts.num_points)->default_value(0),
+        "Minimum number of points to generate")
     ("number-of-cameras",
         po::value<int>(&opts.num_cameras)->default_value(4),
         "Number of cameras to generate")
+    ("seed",
+        po::value<unsigned>(&opts.seed)->default_value(0),
+        "Seed for the random number generator (0 seeds it from the clock)")
     ("data-dir", po::value<std::string>(&data_dir_tmp)->default_value("."),
         "Directory to write generated data files into");
 
@@ -421,6 +437,7 @@ ProgramOptions parse_options(int argc, char* argv[]) {
     ("use-ba-type-dirs","")
     ("remove-outliers","")
     ("outlier-sd-cutoff","")
+    ("timing-file","")
     ("input-files","");
 
   // Allowed options includes generic and test config options
@@ -716,9 +733,9 @@ Vector2 add_noise_to_pixel(Vector2 const pixel, base_rng_type &rng, NoiseParams
 //* }}} add_noise_to_pixel */
 
 /* {{{ initialize_rng */
-base_rng_type initialize_rng() {
+base_rng_type initialize_rng(unsigned seed) {
   base_rng_type rng(42u);
-  rng.seed(static_cast<unsigned int>(std::time(0)));
+  rng.seed(seed ? seed : static_cast<unsigned int>(std::time(0)));
   return rng;
 }
 /* }}} */
@@ -860,7 +877,8 @@ RNGVector generate_xyz_rngs(base_rng_type &rng, CameraVector &cameras) {
 
 /* {{{ generate_control_network */
 boost::shared_ptr<ControlNetwork>
-generate_control_network(base_rng_type &rng, CameraVector &cameras, int &min_tiepoints)
+generate_control_network(base_rng_type &rng, CameraVector &cameras, int &min_tiepoints,
+                         int num_points)
 {
   boost::shared_ptr<ControlNetwork> control_network(new ControlNetwork("Synthetic Control Network"));
   int num_cameras = cameras.size();
@@ -923,8 +941,9 @@ generate_control_network(base_rng_type &rng, CameraVector &cameras, int &min_tie
     vw_out(VerboseDebugMessage) << "Min point count: " << min_point_count << endl;
   }
   // keep going until each camera has at least min_tiepoints visible
-  // points
-  while (*min_element(point_counts.begin(), point_counts.end()) < min_tiepoints);
+  // points, and there are at least num_points in all
+  while (*min_element(point_counts.begin(), point_counts.end()) < min_tiepoints ||
+         int(control_network->size()) < num_points);
 
   return control_network;
 }
@@ -1057,7 +1076,7 @@ int main(int argc, char* argv[]) {
   ProgramOptions config = parse_options(argc, argv);
   create_data_dir(config.data_dir);
 
-  base_rng_type rng = initialize_rng();
+  base_rng_type rng = initialize_rng(config.seed);
 
   // Generate ground truth camera parameters
   CameraParamVector camera_params = generate_camera_params(config.num_cameras);
@@ -1074,7 +1093,8 @@ int main(int argc, char* argv[]) {
 
   // Generate random control network
   boost::shared_ptr<ControlNetwork>
-      cnet = generate_control_network(rng, cameras, config.min_tiepoints);
+      cnet = generate_control_network(rng, cameras, config.min_tiepoints,
+                                      config.num_points);
 
   // Add configured noise to control network
   boost::shared_ptr<ControlNetwork>
@@ -17,6 +17,7 @@
 #include <vw/Math/Vector.h>
 #include <vw/Math/LinearAlgebra.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/Cartography/DemGradient.h>
 #include <vw/tools/Common.h>
 
 /*
@@ -244,12 +245,105 @@ Vector2 interpolate_plane (int x, int y, DiskImageView<ImageT> img, GeoReference
   return gradient_aspect_from_normals(center_normal, plane_normal);
 }
 
+// The same aspect and gradient angle as gradient_aspect_from_normals()
+// gives for the local tangent plane, from the eastward and northward
+// rates of change of altitude.
+Vector2 gradient_aspect_from_east_north(double east, double north) {
+  double gradient=sqrt(east*east+north*north);
+  if(gradient==0) return Vector2(0,0);
+  double aspect=acos(-north/gradient);
+  if(east<0) aspect=M_PI+aspect;
+  else aspect=M_PI-aspect;
+  if(aspect>=2*M_PI) aspect=aspect-2*M_PI;
+  return Vector2(aspect,atan(gradient));
+}
+
+// Aspect (index 0) or gradient angle (index 1) of a gradient pixel.
+class AspectGradientFunc : public ReturnFixedType<double> {
+  int m_index;
+public:
+  AspectGradientFunc(int index) : m_index(index) {}
+  double operator()(PixelMask<Vector2f> const& g) const {
+    if(is_transparent(g)) return 0;
+    return gradient_aspect_from_east_north(g.child()[0],g.child()[1])[m_index];
+  }
+};
+
+// The colored output, with the channels normalized as in do_slopemap().
+class PrettyFunc : public ReturnFixedType<PixelRGB<uint8> > {
+  double m_value_max;
+public:
+  PrettyFunc(double value_max) : m_value_max(value_max) {}
+  PixelRGB<uint8> operator()(PixelMask<Vector2f> const& g) const {
+    Vector2 res;
+    if(!is_transparent(g)) res=gradient_aspect_from_east_north(g.child()[0],g.child()[1]);
+    double value=res(1)+0.2*fabs(M_PI-res(0));
+    PixelHSV<double> hsv(res(0)/(2*M_PI),0.1+0.9*res(1)/(M_PI/2),
+                         m_value_max>0 ? 0.3+0.3*value/m_value_max : 0.3);
+    return PixelRGB<uint8>(255,255,255)-pixel_cast_rescale<PixelRGB<uint8> >(hsv);
+  }
+};
+
+template <class ViewT>
+void write_tiled_image(std::string const& filename, ImageViewBase<ViewT> const& image,
+                       GeoReference const& GR, bool georeferenced) {
+  boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(filename, image.format()));
+  if( r->has_block_write() )
+    r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                       vw_settings().default_tile_size() ) );
+  if(georeferenced) write_georeference( *r, GR );
+  block_write_image( *r, image, TerminalProgressCallback( "tools.slopemap", "Writing:") );
+}
+
+// The finite difference algorithms on the datum, computed a tile at a
+// time as the outputs are written.
+template <class imageT>
+void do_slopemap_gradient (const ::Options &opt, GeoReference const& GR) {
+  DiskImageView<imageT> img(opt.input_file_name);
+
+  DemGradientMethod method=HornGradient;
+  if(opt.algorithm==SA) method=SharpnackAkinGradient;
+  if(opt.algorithm==FH) method=ZevenbergenThorneGradient;
+  ImageViewRef<PixelMask<Vector2f> > gradient=dem_gradient(pixel_cast<PixelMask<imageT> >(img),GR,method);
+
+  if(opt.output_gradient)
+    write_tiled_image( opt.output_prefix + "_gradient.tif",
+                       per_pixel_filter(gradient,AspectGradientFunc(1)), GR, true );
+  if(opt.output_aspect)
+    write_tiled_image( opt.output_prefix + "_aspect.tif",
+                       per_pixel_filter(gradient,AspectGradientFunc(0)), GR, true );
+  if(opt.output_pretty) {
+    // The value channel is stretched to its largest value, so that
+    // takes a pass of its own.
+    double value_max=0;
+    int32 tile=vw_settings().default_tile_size();
+    for(int32 y=0;y<gradient.rows();y+=tile) {
+      for(int32 x=0;x<gradient.cols();x+=tile) {
+        ImageView<PixelMask<Vector2f> > block=crop(gradient,BBox2i(x,y,std::min(tile,gradient.cols()-x),std::min(tile,gradient.rows()-y)));
+        for(int32 j=0;j<block.rows();j++)
+          for(int32 i=0;i<block.cols();i++) {
+            if(is_transparent(block(i,j))) continue;
+            Vector2 res=gradient_aspect_from_east_north(block(i,j).child()[0],block(i,j).child()[1]);
+            value_max=std::max(value_max,res(1)+0.2*fabs(M_PI-res(0)));
+          }
+      }
+    }
+    write_tiled_image( opt.output_prefix + "_pretty.tif",
+                       per_pixel_filter(gradient,PrettyFunc(value_max)), GR, false );
+  }
+}
+
 template <class imageT>
 void do_slopemap (const ::Options &opt) { //not sure what the arguments are
 
   GeoReference GR;
   read_georeference( GR, opt.input_file_name );
 
+  if(opt.spherically_defined && opt.algorithm!=PLANEFIT) {
+    do_slopemap_gradient<imageT>(opt,GR);
+    return;
+  }
+
   DiskImageView<imageT> img(opt.input_file_name);
 
   int x;
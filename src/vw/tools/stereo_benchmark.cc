@@ -0,0 +1,505 @@
+// __BEGIN_LICENSE__
+// Copyright (C) 2006-2011 United States Government as represented by
+// the Administrator of the National Aeronautics and Space Administration.
+// All Rights Reserved.
+// __END_LICENSE__
+
+
+/// \file stereo_benchmark.cc
+///
+/// Times the stereo correlators over a grid of image sizes, kernel
+/// sizes and disparity ranges, and prints one JSON object per line
+/// for each case, so that runs can be compared for regressions.
+///
+/// Each case is correlated from a pair whose disparities are known:
+/// a random texture, and any images given with --texture, are warped
+/// by a slanted plane with a raised block in the middle.  A pair of
+/// images given with --left and --right is correlated as it is, and
+/// its accuracy is not reported.
+///
+/// The modes are
+///
+///   optimized        OptimizedCorrelator
+///   optimized-fused  OptimizedCorrelator with the fused cross check
+///   pyramid          PyramidCorrelator
+///   parabola         optimized, then SubpixelView parabola refinement
+///   affine-em        optimized, then SubpixelView affine EM refinement
+///   em               optimized, then EMSubpixelCorrelatorView
+///
+/// Each case reports the seconds spent preprocessing, correlating
+/// and refining (the pyramid correlator preprocesses as it goes, so
+/// its preprocessing is counted with its correlation), the millions
+/// of pixel disparities searched per second, the peak resident set
+/// size and, when the disparities are known, the fraction of valid
+/// pixels, their RMS error and the fraction of pixels off by more
+/// than a pixel.  On Linux the peak is reset before each case; on
+/// other systems it is the peak of the whole run so far.
+///
+#ifdef _MSC_VER
+#pragma warning(disable:4244)
+#pragma warning(disable:4267)
+#pragma warning(disable:4996)
+#endif
+
+#include <boost/program_options.hpp>
+#include <boost/random/linear_congruential.hpp>
+namespace po = boost::program_options;
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <vw/Core/Debugging.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Image.h>
+#include <vw/FileIO.h>
+#include <vw/Stereo/Correlate.h>
+#include <vw/Stereo/OptimizedCorrelator.h>
+#include <vw/Stereo/PyramidCorrelator.h>
+#include <vw/Stereo/SubpixelView.h>
+#include <vw/Stereo/EMSubpixelCorrelatorView.h>
+
+using namespace vw;
+using namespace vw::stereo;
+
+namespace {
+
+  // A pair of images to correlate, and the true disparities of the
+  // left image if they are known.
+  struct StereoPair {
+    std::string name;
+    ImageView<float> left, right;
+    ImageView<float> truth;
+    bool has_truth;
+  };
+
+  struct StageTimes {
+    double preprocess, correlate, subpixel;
+    StageTimes() : preprocess(0), correlate(0), subpixel(0) {}
+    double total() const { return preprocess + correlate + subpixel; }
+  };
+
+  struct Accuracy {
+    double valid_fraction, rms_error, bad_fraction;
+    Accuracy() : valid_fraction(0), rms_error(0), bad_fraction(0) {}
+  };
+
+  template <class T>
+  std::vector<T> parse_list( std::string const& text, std::string const& option ) {
+    std::vector<T> result;
+    std::istringstream stream( text );
+    std::string item;
+    while ( std::getline( stream, item, ',' ) ) {
+      if ( item.empty() )
+        continue;
+      std::istringstream item_stream( item );
+      T value;
+      if ( !( item_stream >> value ) )
+        vw_throw( ArgumentErr() << "Bad value \"" << item << "\" for --" << option << "." );
+      result.push_back( value );
+    }
+    if ( result.empty() )
+      vw_throw( ArgumentErr() << "--" << option << " needs at least one value." );
+    return result;
+  }
+
+  std::string json_string( std::string const& text ) {
+    std::ostringstream out;
+    out << '"';
+    for ( size_t i = 0; i < text.size(); i++ ) {
+      char c = text[i];
+      if ( c == '"' || c == '\\' )
+        out << '\\' << c;
+      else if ( (unsigned char)c < 0x20 )
+        out << ' ';
+      else
+        out << c;
+    }
+    out << '"';
+    return out.str();
+  }
+
+  // Resets the peak resident set size, where the system allows it.
+  bool reset_peak_rss() {
+#ifdef __linux__
+    std::ofstream clear_refs( "/proc/self/clear_refs" );
+    if ( !clear_refs )
+      return false;
+    clear_refs << "5";
+    clear_refs.close();
+    return !clear_refs.fail();
+#else
+    return false;
+#endif
+  }
+
+  // The peak resident set size in kilobytes, or 0 if it is unknown.
+  int64 peak_rss_kb() {
+#ifdef __linux__
+    std::ifstream status( "/proc/self/status" );
+    std::string line;
+    while ( std::getline( status, line ) )
+      if ( line.compare( 0, 6, "VmHWM:" ) == 0 )
+        return atol( line.c_str() + 6 );
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) == 0 ) {
+#ifdef __APPLE__
+      return usage.ru_maxrss / 1024;
+#else
+      return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+  }
+
+  // The disparities of the synthetic pairs: a plane sloping from 30%
+  // to 60% of the range across the image, with a block at 90% of the
+  // range in its middle third.
+  ImageView<float> make_disparities( int32 cols, int32 rows, int32 range ) {
+    ImageView<float> truth( cols, rows );
+    for ( int32 j = 0; j < rows; j++ )
+      for ( int32 i = 0; i < cols; i++ ) {
+        bool block = i >= cols/3 && i < 2*cols/3 && j >= rows/3 && j < 2*rows/3;
+        truth(i,j) = block ? 0.9f*range : range*(0.3f + 0.3f*float(i)/float(cols));
+      }
+    return truth;
+  }
+
+  // Builds a pair whose left image at (x,y) is the texture at
+  // (x+d,y) for the disparity d there.
+  StereoPair warp_pair( std::string const& name, ImageView<float> const& texture,
+                        int32 range ) {
+    StereoPair pair;
+    pair.name = name;
+    pair.right = texture;
+    pair.truth = make_disparities( texture.cols(), texture.rows(), range );
+    pair.has_truth = true;
+    pair.left.set_size( texture.cols(), texture.rows() );
+    InterpolationView<EdgeExtensionView<ImageView<float>, ConstantEdgeExtension>, BilinearInterpolation> source =
+      interpolate( texture, BilinearInterpolation(), ConstantEdgeExtension() );
+    for ( int32 j = 0; j < texture.rows(); j++ )
+      for ( int32 i = 0; i < texture.cols(); i++ )
+        pair.left(i,j) = source( i + pair.truth(i,j), j );
+    return pair;
+  }
+
+  ImageView<float> random_texture( int32 size, uint32 seed ) {
+    boost::rand48 gen( seed );
+    return gaussian_filter( uniform_noise_view( gen, size, size ), 1.0 );
+  }
+
+  ImageView<float> read_gray( std::string const& file ) {
+    ImageView<PixelGray<float> > image;
+    read_image( image, file );
+    return pixel_cast<float>( image );
+  }
+
+  Accuracy measure( ImageView<PixelMask<Vector2f> > const& disparities,
+                    StereoPair const& pair, int32 margin ) {
+    Accuracy result;
+    int64 count = 0, valid = 0, bad = 0;
+    double sum_sq = 0;
+    for ( int32 j = margin; j < disparities.rows() - margin; j++ )
+      for ( int32 i = margin; i < disparities.cols() - margin; i++ ) {
+        // Pixels whose match is off the right image are left out.
+        if ( i + pair.truth(i,j) >= disparities.cols() - margin )
+          continue;
+        count++;
+        if ( !is_valid( disparities(i,j) ) ) {
+          bad++;
+          continue;
+        }
+        double dx = disparities(i,j)[0] - pair.truth(i,j);
+        double dy = disparities(i,j)[1];
+        double error_sq = dx*dx + dy*dy;
+        valid++;
+        sum_sq += error_sq;
+        if ( error_sq > 1.0 )
+          bad++;
+      }
+    if ( count ) {
+      result.valid_fraction = double(valid) / double(count);
+      result.bad_fraction = double(bad) / double(count);
+    }
+    if ( valid )
+      result.rms_error = std::sqrt( sum_sq / double(valid) );
+    return result;
+  }
+
+  struct BenchmarkOptions {
+    float log_sigma;
+    float cross_corr_threshold;
+    int32 cost_blur;
+    int32 v_range;
+    int32 search_min;
+    int32 pyramid_levels;
+    int32 repeat;
+  };
+
+  // Runs one mode over a pair.  The integer correlation of the
+  // subpixel modes uses the optimized correlator.
+  ImageView<PixelMask<Vector2f> > run_mode( std::string const& mode, StereoPair const& pair,
+                                            BBox2i const& search_window, int32 kernel,
+                                            CorrelatorType correlator_type,
+                                            BenchmarkOptions const& options,
+                                            StageTimes& times ) {
+    LogStereoPreprocessingFilter preproc( options.log_sigma );
+    ImageView<PixelMask<Vector2f> > disparities;
+    Stopwatch stage;
+
+    if ( mode == "pyramid" ) {
+      ImageView<uint8> mask( pair.left.cols(), pair.left.rows() );
+      fill( mask, uint8(255) );
+      PyramidCorrelator correlator( BBox2f( Vector2f( search_window.min() ),
+                                            Vector2f( search_window.max() ) ),
+                                    Vector2i(kernel, kernel),
+                                    options.cross_corr_threshold, 1.0,
+                                    options.cost_blur, correlator_type,
+                                    options.pyramid_levels );
+      stage.start();
+      disparities = correlator( pair.left, pair.right, mask, mask, preproc );
+      stage.stop();
+      times.correlate = stage.elapsed_seconds();
+      return disparities;
+    }
+
+    stage.start();
+    ImageView<float> left = preproc( pair.left );
+    ImageView<float> right = preproc( pair.right );
+    stage.stop();
+    times.preprocess = stage.elapsed_seconds();
+
+    OptimizedCorrelator correlator( search_window, kernel,
+                                    options.cross_corr_threshold, 1.0,
+                                    options.cost_blur, correlator_type );
+    correlator.set_fused_cross_check( mode == "optimized-fused" );
+    Stopwatch correlate;
+    correlate.start();
+    disparities = correlator( left, right, NullStereoPreprocessingFilter() );
+    correlate.stop();
+    times.correlate = correlate.elapsed_seconds();
+
+    Stopwatch subpixel;
+    if ( mode == "parabola" || mode == "affine-em" ) {
+      subpixel.start();
+      disparities = subpixel_refine( disparities, pair.left, pair.right,
+                                     kernel, kernel, true, true,
+                                     mode == "parabola" ? 1 : 2, preproc );
+      subpixel.stop();
+    } else if ( mode == "em" ) {
+      subpixel.start();
+      EMSubpixelCorrelatorView<float> em( pair.left, pair.right, disparities );
+      em.set_kernel_size( Vector2i(kernel, kernel) );
+      em.set_pyramid_levels( 2 );
+      ImageView<PixelMask<Vector<float,5> > > refined = em;
+      disparities = per_pixel_filter( refined, EMSubpixelCorrelatorView<float>::ExtractDisparityFunctor() );
+      subpixel.stop();
+    } else if ( mode != "optimized" && mode != "optimized-fused" ) {
+      vw_throw( ArgumentErr() << "Unknown mode \"" << mode << "\"." );
+    }
+    times.subpixel = subpixel.elapsed_seconds();
+    return disparities;
+  }
+
+  void run_case( std::ostream& out, std::string const& mode, StereoPair const& pair,
+                 int32 kernel, int32 range, CorrelatorType correlator_type,
+                 BenchmarkOptions const& options ) {
+    BBox2i search_window( Vector2i( options.search_min, -options.v_range ),
+                          Vector2i( options.search_min + range, options.v_range ) );
+    double pixels = double(pair.left.cols()) * double(pair.left.rows());
+    double disparities_searched = double(range + 1) * double(2*options.v_range + 1);
+
+    bool peak_reset = reset_peak_rss();
+    ImageView<PixelMask<Vector2f> > disparities;
+    StageTimes best;
+    for ( int32 r = 0; r < options.repeat; r++ ) {
+      StageTimes times;
+      disparities = run_mode( mode, pair, search_window, kernel, correlator_type,
+                              options, times );
+      if ( r == 0 || times.total() < best.total() )
+        best = times;
+    }
+    int64 peak = peak_rss_kb();
+
+    std::ostringstream line;
+    line.precision( 6 );
+    line << "{\"mode\": " << json_string( mode )
+         << ", \"dataset\": " << json_string( pair.name )
+         << ", \"cols\": " << pair.left.cols()
+         << ", \"rows\": " << pair.left.rows()
+         << ", \"kernel\": " << kernel
+         << ", \"h_range\": " << range
+         << ", \"v_range\": " << options.v_range
+         << ", \"disparities\": " << disparities_searched
+         << ", \"correlator_type\": " << int(correlator_type)
+         << ", \"repeat\": " << options.repeat
+         << ", \"seconds\": {\"preprocess\": " << best.preprocess
+         << ", \"correlate\": " << best.correlate
+         << ", \"subpixel\": " << best.subpixel
+         << ", \"total\": " << best.total() << "}"
+         << ", \"mpix_per_s\": " << ( best.total() > 0 ? pixels / 1e6 / best.total() : 0 )
+         << ", \"mpix_disp_per_s\": "
+         << ( best.total() > 0 ? pixels * disparities_searched / 1e6 / best.total() : 0 )
+         << ", \"peak_rss_kb\": " << peak
+         << ", \"peak_rss_scope\": " << json_string( peak_reset ? "case" : "process" );
+    if ( pair.has_truth ) {
+      Accuracy accuracy = measure( disparities, pair, kernel/2 + options.cost_blur + 2 );
+      line << ", \"valid_fraction\": " << accuracy.valid_fraction
+           << ", \"rms_error\": " << accuracy.rms_error
+           << ", \"bad_fraction\": " << accuracy.bad_fraction;
+    }
+    line << "}";
+    out << line.str() << std::endl;
+  }
+
+} // namespace
+
+int main( int argc, char *argv[] ) {
+  try {
+
+    std::string left_file_name, right_file_name, output_file_name;
+    std::string modes_text, sizes_text, kernels_text, ranges_text, types_text;
+    std::vector<std::string> texture_files;
+    BenchmarkOptions options;
+    uint32 seed;
+
+    po::options_description desc("Options");
+    desc.add_options()
+      ("help,h", "Display this help message")
+      ("modes", po::value(&modes_text)->default_value("optimized,optimized-fused,pyramid,parabola,affine-em,em"),
+       "Comma separated modes: optimized, optimized-fused, pyramid, parabola, affine-em, em")
+      ("sizes", po::value(&sizes_text)->default_value("256,512"), "Comma separated image sizes of the synthetic pairs")
+      ("kernels", po::value(&kernels_text)->default_value("9,15"), "Comma separated correlation kernel sizes")
+      ("ranges", po::value(&ranges_text)->default_value("16,48"), "Comma separated horizontal disparity ranges")
+      ("v-range", po::value(&options.v_range)->default_value(1), "Vertical disparities searched each way")
+      ("search-min", po::value(&options.search_min)->default_value(0), "Least horizontal disparity searched")
+      ("correlator-types", po::value(&types_text)->default_value("0"),
+       "Comma separated correlator types: 0 - Abs difference; 1 - Sq Difference; 2 - NormXCorr; 3 - Census; 4 - Rank")
+      ("texture", po::value(&texture_files)->composing(),
+       "An image, e.g. src/vw/FileIO/tests/mural.png, to warp into a pair in place of the random texture; may be repeated")
+      ("no-synthetic", "Skip the random texture pairs")
+      ("left", po::value(&left_file_name), "The left image of a real pair to correlate")
+      ("right", po::value(&right_file_name), "The right image of a real pair to correlate")
+      ("log", po::value(&options.log_sigma)->default_value(1.5), "Sigma of the LOG preprocessing filter")
+      ("lrthresh", po::value(&options.cross_corr_threshold)->default_value(2), "Left/right correspondence threshold")
+      ("cost-blur", po::value(&options.cost_blur)->default_value(1), "Kernel size for bluring the cost image")
+      ("pyramid-levels", po::value(&options.pyramid_levels)->default_value(3), "Levels of the pyramid correlator")
+      ("repeat", po::value(&options.repeat)->default_value(1), "Runs of each case; the fastest is reported")
+      ("seed", po::value(&seed)->default_value(5), "Seed of the random textures")
+      ("output,o", po::value(&output_file_name), "Append the results to this file rather than printing them")
+      ("verbose", "Print the correlators' progress messages")
+      ;
+
+    po::variables_map vm;
+    try {
+      po::store( po::command_line_parser( argc, argv ).options(desc).run(), vm );
+      po::notify( vm );
+    } catch (const po::error& e) {
+      std::cout << "An error occured while parsing command line arguments.\n";
+      std::cout << "\t" << e.what() << "\n\n";
+      std::cout << desc << std::endl;
+      return 1;
+    }
+
+    if( vm.count("help") ) {
+      vw_out() << desc << std::endl;
+      return 1;
+    }
+
+    if( vm.count("left") != vm.count("right") ) {
+      vw_out() << "Error: --left and --right must be given together!" << std::endl;
+      vw_out() << desc << std::endl;
+      return 1;
+    }
+
+    // Keep the correlators' progress messages out of the results.
+    if ( !vm.count("verbose") ) {
+      vw_log().console_log().rule_set().clear();
+      vw_log().console_log().rule_set().add_rule( WarningMessage, "*" );
+    }
+
+    if ( options.repeat < 1 )
+      vw_throw( ArgumentErr() << "--repeat must be at least 1." );
+
+    std::vector<std::string> modes = parse_list<std::string>( modes_text, "modes" );
+    std::vector<int32> sizes = parse_list<int32>( sizes_text, "sizes" );
+    std::vector<int32> kernels = parse_list<int32>( kernels_text, "kernels" );
+    std::vector<int32> ranges = parse_list<int32>( ranges_text, "ranges" );
+    std::vector<int32> types = parse_list<int32>( types_text, "correlator-types" );
+    for ( size_t m = 0; m < modes.size(); m++ )
+      if ( modes[m] != "optimized" && modes[m] != "optimized-fused" && modes[m] != "pyramid" &&
+           modes[m] != "parabola" && modes[m] != "affine-em" && modes[m] != "em" )
+        vw_throw( ArgumentErr() << "Unknown mode \"" << modes[m] << "\"." );
+
+    std::vector<std::pair<std::string, ImageView<float> > > textures;
+    for ( size_t i = 0; i < texture_files.size(); i++ )
+      textures.push_back( std::make_pair( texture_files[i], read_gray( texture_files[i] ) ) );
+
+    std::ofstream output_file;
+    if ( vm.count("output") ) {
+      output_file.open( output_file_name.c_str(), std::ios::app );
+      if ( !output_file )
+        vw_throw( IOErr() << "Could not open " << output_file_name << " for writing." );
+    }
+    std::ostream& out = vm.count("output") ? output_file : std::cout;
+
+    for ( size_t r = 0; r < ranges.size(); r++ ) {
+      std::vector<StereoPair> pairs;
+      for ( size_t s = 0; s < sizes.size(); s++ ) {
+        if ( !vm.count("no-synthetic") ) {
+          std::ostringstream name;
+          name << "random-" << sizes[s];
+          pairs.push_back( warp_pair( name.str(), random_texture( sizes[s], seed ), ranges[r] ) );
+        }
+        for ( size_t t = 0; t < textures.size(); t++ ) {
+          ImageView<float> const& texture = textures[t].second;
+          if ( texture.cols() < sizes[s] || texture.rows() < sizes[s] ) {
+            vw_out(WarningMessage) << textures[t].first << " is smaller than " << sizes[s]
+                                   << " pixels; skipping it at that size.\n";
+            continue;
+          }
+          std::ostringstream name;
+          name << textures[t].first << "-" << sizes[s];
+          ImageView<float> patch = crop( texture, (texture.cols() - sizes[s])/2,
+                                         (texture.rows() - sizes[s])/2, sizes[s], sizes[s] );
+          pairs.push_back( warp_pair( name.str(), patch, ranges[r] ) );
+        }
+      }
+      if ( vm.count("left") ) {
+        StereoPair pair;
+        pair.name = left_file_name + "," + right_file_name;
+        pair.left = read_gray( left_file_name );
+        pair.right = read_gray( right_file_name );
+        pair.has_truth = false;
+        int32 cols = std::min( pair.left.cols(), pair.right.cols() );
+        int32 rows = std::min( pair.left.rows(), pair.right.rows() );
+        pair.left = crop( pair.left, 0, 0, cols, rows );
+        pair.right = crop( pair.right, 0, 0, cols, rows );
+        pairs.push_back( pair );
+      }
+
+      for ( size_t p = 0; p < pairs.size(); p++ )
+        for ( size_t k = 0; k < kernels.size(); k++ )
+          for ( size_t c = 0; c < types.size(); c++ )
+            for ( size_t m = 0; m < modes.size(); m++ )
+              run_case( out, modes[m], pairs[p], kernels[k], ranges[r],
+                        CorrelatorType( types[c] ), options );
+    }
+  }
+  catch (const vw::Exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}